@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+# Author: Dr. Mazharuddin Mohammed
+"""
+SemiPRO Benchmark Comparator
+============================
+
+Compares a run of the `benchmarks` target against a stored baseline, both
+in Google Benchmark's JSON format (--benchmark_out). Each benchmark needs
+several repetitions in both files (the CMake targets run them with
+--benchmark_repetitions). A benchmark counts as regressed when its median
+real time grew by more than the threshold and a two-sided Mann-Whitney U
+test on the repetitions rejects equal timings, so noise alone does not
+fail a run. Exits 1 on a regression, 0 otherwise.
+
+    compare_baseline.py baseline.json current.json [--threshold 0.05] [--alpha 0.05]
+"""
+
+import argparse
+import json
+import math
+import statistics
+import sys
+from typing import Dict, List
+
+
+def load_samples(path: str) -> Dict[str, List[float]]:
+    """Real times per repetition, by benchmark name, in nanoseconds"""
+    scale = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+    with open(path) as f:
+        report = json.load(f)
+    samples: Dict[str, List[float]] = {}
+    for entry in report.get("benchmarks", []):
+        if entry.get("run_type", "iteration") != "iteration" or entry.get("error_occurred"):
+            continue
+        name = entry.get("run_name", entry["name"])
+        samples.setdefault(name, []).append(entry["real_time"] * scale[entry.get("time_unit", "ns")])
+    return samples
+
+
+def mann_whitney_p(a: List[float], b: List[float]) -> float:
+    """Two-sided p-value of the U test, by the normal approximation with
+    a tie correction"""
+    n1, n2 = len(a), len(b)
+    ranked = sorted([(x, 0) for x in a] + [(x, 1) for x in b])
+    ranks = [0.0] * len(ranked)
+    ties = 0.0
+    i = 0
+    while i < len(ranked):
+        j = i
+        while j + 1 < len(ranked) and ranked[j + 1][0] == ranked[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2.0 + 1.0
+        t = j - i + 1
+        ties += t ** 3 - t
+        i = j + 1
+    r1 = sum(r for r, (_, group) in zip(ranks, ranked) if group == 0)
+    u = r1 - n1 * (n1 + 1) / 2.0
+    n = n1 + n2
+    variance = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(variance)
+    return max(0.0, min(1.0, math.erfc(max(z, 0.0) / math.sqrt(2.0))))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Compare benchmark results against a baseline")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="Relative growth of the median time that counts as a regression")
+    parser.add_argument("--alpha", type=float, default=0.05,
+                        help="Significance level of the U test")
+    args = parser.parse_args()
+
+    baseline = load_samples(args.baseline)
+    current = load_samples(args.current)
+    regressions = 0
+    width = max([len(name) for name in current] + [9])
+    print(f"{'Benchmark':<{width}}  {'Baseline':>12}  {'Current':>12}  {'Change':>8}  {'p':>6}")
+    for name in sorted(current):
+        if name not in baseline:
+            print(f"{name:<{width}}  {'(new)':>12}")
+            continue
+        old, new = baseline[name], current[name]
+        old_median, new_median = statistics.median(old), statistics.median(new)
+        change = (new_median - old_median) / old_median if old_median > 0 else 0.0
+        if len(old) < 3 or len(new) < 3:
+            p, verdict = float("nan"), "  (too few repetitions)"
+        else:
+            p = mann_whitney_p(old, new)
+            significant = p < args.alpha
+            verdict = ""
+            if significant and change > args.threshold:
+                verdict = "  REGRESSION"
+                regressions += 1
+            elif significant and change < -args.threshold:
+                verdict = "  faster"
+        print(f"{name:<{width}}  {old_median / 1e6:>10.3f}ms  {new_median / 1e6:>10.3f}ms"
+              f"  {change:>+7.1%}  {p:>6.3f}{verdict}")
+    for name in sorted(set(baseline) - set(current)):
+        print(f"{name:<{width}}  (not run)")
+
+    if regressions:
+        print(f"{regressions} benchmark(s) regressed", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
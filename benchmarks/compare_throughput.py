@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+# Author: Dr. Mazharuddin Mohammed
+"""
+SemiPRO Throughput Report Comparator
+====================================
+
+Lines up two reports of the throughput_harness (--out), typically from two
+releases, by target, scaling series, grid, batch and threads, and prints
+each configuration's wafers/hour, p99 step latency, scaling efficiency and
+peak memory side by side. Configurations whose throughput dropped by more
+than the threshold are marked; with --fail they also make the exit status
+1. Reports from hosts with different core counts or workloads are still
+compared, with a warning.
+
+    compare_throughput.py old.json new.json [--threshold 0.10] [--fail]
+"""
+
+import argparse
+import json
+import sys
+from typing import Dict, Tuple
+
+Key = Tuple[str, str, int, int, int]
+
+
+def load(path: str) -> Tuple[dict, Dict[Key, dict]]:
+    with open(path) as f:
+        report = json.load(f)
+    results = {(r["target"], r["scaling"], r["grid"], r["batch"], r["threads"]): r
+               for r in report.get("results", [])}
+    return report, results
+
+
+def change(old: float, new: float) -> str:
+    return f"{(new - old) / old:+7.1%}" if old > 0 else "    n/a"
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Compare two throughput harness reports")
+    parser.add_argument("old")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="Relative drop in wafers/hour that counts as a regression")
+    parser.add_argument("--fail", action="store_true", help="Exit 1 when a configuration regressed")
+    args = parser.parse_args()
+
+    old_report, old = load(args.old)
+    new_report, new = load(args.new)
+    for field in ("hardware_threads", "workload", "orchestrator_mode"):
+        if old_report.get(field) != new_report.get(field):
+            print(f"warning: reports differ in {field}; numbers may not be comparable", file=sys.stderr)
+    print(f"{old_report.get('label', args.old)} -> {new_report.get('label', args.new)}")
+    print(f"{'target':<12} {'series':<6} {'grid':>5} {'batch':>5} {'thr':>4}  {'wafers/h':>10} {'change':>7}"
+          f"  {'p99_ms':>9} {'change':>7}  {'eff':>11}  {'rss_MiB':>15}")
+
+    regressions = 0
+    for key in sorted(new):
+        if key not in old:
+            continue
+        a, b = old[key], new[key]
+        verdict = ""
+        if a["wafers_per_hour"] > 0 and (b["wafers_per_hour"] - a["wafers_per_hour"]) / a["wafers_per_hour"] < -args.threshold:
+            verdict = "  SLOWER"
+            regressions += 1
+        target, scaling, grid, batch, threads = key
+        print(f"{target:<12} {scaling:<6} {grid:>5} {batch:>5} {threads:>4}"
+              f"  {b['wafers_per_hour']:>10.1f} {change(a['wafers_per_hour'], b['wafers_per_hour'])}"
+              f"  {b['step_p99_ms']:>9.2f} {change(a['step_p99_ms'], b['step_p99_ms'])}"
+              f"  {a['efficiency']:>4.2f} -> {b['efficiency']:>4.2f}"
+              f"  {a.get('peak_rss_bytes', 0) / 2**20:>6.1f} -> {b.get('peak_rss_bytes', 0) / 2**20:>6.1f}{verdict}")
+    only_old = sorted(set(old) - set(new))
+    only_new = sorted(set(new) - set(old))
+    if only_old or only_new:
+        print(f"{len(only_old)} configuration(s) only in {args.old}, {len(only_new)} only in {args.new}")
+
+    if regressions:
+        print(f"{regressions} configuration(s) lost more than {args.threshold:.0%} throughput", file=sys.stderr)
+        return 1 if args.fail else 0
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,45 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "benchmark_support.hpp"
+#include "../../src/cpp/core/distributed_field.hpp"
+#include "../../src/cpp/modules/doping/diffusion_solver.hpp"
+#include "../../src/cpp/modules/doping/monte_carlo_solver.hpp"
+
+// Ions traced per implant: 10^4 to 10^6, times the thread counts
+static void BM_MonteCarloImplant(benchmark::State& state) {
+  const long ions = static_cast<long>(state.range(0));
+  bench::useThreads(static_cast<int>(state.range(1)));
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(128, 128);
+  MonteCarloSolver solver(42);
+  solver.setParticleCount(ions);
+  for (auto _ : state) {
+    Eigen::ArrayXd profile = solver.simulateImplantation(wafer, 50.0, 1e15);
+    benchmark::DoNotOptimize(profile.data());
+  }
+  state.counters["ions/s"] = benchmark::Counter(static_cast<double>(ions) * state.iterations(),
+                                                benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_MonteCarloImplant)
+    ->ArgNames({"ions", "threads"})
+    ->ArgsProduct({{10000, 100000, 1000000}, bench::threadCounts()})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Lateral diffusion of a doping map on one rank: FTCS steps over the tiles
+static void BM_LateralDiffusion(benchmark::State& state) {
+  const int side = static_cast<int>(state.range(0));
+  bench::useThreads(static_cast<int>(state.range(1)));
+  DistributedField field(LocalCommunicator::group(1)[0], side, side);
+  Eigen::ArrayXXd initial = Eigen::ArrayXXd::Zero(side, side);
+  initial.block(side / 4, side / 4, side / 2, side / 2).setConstant(1e18);
+  DiffusionSolver solver;
+  // Long enough for tens of steps at 1000 C on 10 nm cells
+  const double dx = 1e-6, temperature = 1273.0;
+  const double time = 40.0 * 0.25 * dx * dx / DiffusionSolver::diffusivity(temperature);
+  for (auto _ : state) {
+    field.loadLocal(initial);
+    solver.simulateLateralDiffusion(field, temperature, time, dx);
+  }
+  bench::countCells(state, static_cast<double>(side) * side * 40);
+}
+BENCHMARK(BM_LateralDiffusion)->Apply(bench::gridsAndThreads<>);
@@ -0,0 +1,63 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "benchmark_support.hpp"
+#include "../../src/cpp/modules/design_rule_check/polygon_drc.hpp"
+#include "../../src/cpp/modules/etching/etching_model.hpp"
+#include "../../src/cpp/modules/reliability/reliability_model.hpp"
+
+// Spacing checks from the resist grid: contour extraction, then the
+// scanline sweep over its edges. The 10-cell spaces break the rule, so
+// violations are recorded too.
+static void BM_DrcSpacing(benchmark::State& state) {
+  const int side = static_cast<int>(state.range(0));
+  bench::useThreads(static_cast<int>(state.range(1)));
+  const BitMask resist = bench::lineMask(side, side);
+  const std::vector<DRCRule> rules = {DRCRule("M1_SPACING", ViolationType::SPACING, "metal1", 0.12)};
+  std::size_t violations = 0;
+  for (auto _ : state) {
+    PolygonLayers layers;
+    layers["metal1"] = PolygonLayer::fromEdgeMap(EdgeMap::extract(resist), 0.01);
+    violations = PolygonDRC::check(rules, layers).size();
+  }
+  state.counters["violations"] = static_cast<double>(violations);
+  bench::countCells(state, static_cast<double>(side) * side);
+}
+BENCHMARK(BM_DrcSpacing)->Apply(bench::gridsAndThreads<>);
+
+// Level-set etch stencils through the resist openings, from a flat
+// surface. The voxel columns make these some hundred times the cost of
+// the 2D kernels per cell, so they stop at 512 unless raised here.
+static void BM_EtchStencil(benchmark::State& state, const char* type) {
+  const int side = static_cast<int>(state.range(0));
+  bench::useThreads(static_cast<int>(state.range(1)));
+  auto wafer = bench::patternedWafer(side);
+  EtchingModel etching;
+  for (auto _ : state) {
+    wafer->getGrid().setZero();
+    etching.simulateEtching(wafer, 0.05, type);
+  }
+  bench::countCells(state, static_cast<double>(side) * side);
+}
+BENCHMARK_CAPTURE(BM_EtchStencil, isotropic, "isotropic")->Apply(bench::gridsAndThreads<512>);
+BENCHMARK_CAPTURE(BM_EtchStencil, anisotropic, "anisotropic")->Apply(bench::gridsAndThreads<512>);
+
+// Electromigration, stress and field maps from a current density map
+static void BM_ReliabilityMaps(benchmark::State& state) {
+  const int side = static_cast<int>(state.range(0));
+  bench::useThreads(static_cast<int>(state.range(1)));
+  auto wafer = bench::patternedWafer(side);
+  wafer->addMetalLayer(0.5, "Cu");
+  wafer->setTemperatureProfile(Eigen::ArrayXXd::Constant(side, side, 350.0));
+  const BitMask& lines = wafer->getPhotoresistMask();
+  Eigen::ArrayXXd current_density(side, side);
+  for (int j = 0; j < side; ++j) {
+    for (int i = 0; i < side; ++i) {
+      current_density(i, j) = lines.test(i, j) ? 1e10 : 0.0;
+    }
+  }
+  ReliabilityModel reliability;
+  for (auto _ : state) {
+    reliability.performReliabilityTest(wafer, current_density, 5.0);
+  }
+  bench::countCells(state, static_cast<double>(side) * side);
+}
+BENCHMARK(BM_ReliabilityMaps)->Apply(bench::gridsAndThreads<>);
@@ -0,0 +1,29 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "benchmark_support.hpp"
+#include "../../src/cpp/modules/photolithography/hopkins_imaging.hpp"
+
+// Imaging a new mask each iteration: the kernels and their spectra stay
+// cached, as across the iterations of OPC, but the mask's spectrum is
+// recomputed. Nudging one pixel gives every iteration distinct content.
+static void BM_AerialImage(benchmark::State& state) {
+  const int side = static_cast<int>(state.range(0));
+  bench::useThreads(static_cast<int>(state.range(1)));
+  HopkinsImaging imaging;
+  HopkinsImaging::Optics optics;
+  const BitMask resist = bench::lineMask(side, side);
+  Eigen::ArrayXXd mask(side, side);
+  for (int j = 0; j < side; ++j) {
+    for (int i = 0; i < side; ++i) {
+      mask(i, j) = resist.test(i, j) ? 0.0 : 1.0;
+    }
+  }
+  benchmark::DoNotOptimize(imaging.aerialImage(mask, optics, side, side));
+  std::int64_t nudge = 0;
+  for (auto _ : state) {
+    mask(0, 0) = 1.0 - 1e-9 * static_cast<double>(++nudge);
+    Eigen::ArrayXXd image = imaging.aerialImage(mask, optics, side, side);
+    benchmark::DoNotOptimize(image.data());
+  }
+  bench::countCells(state, static_cast<double>(side) * side);
+}
+BENCHMARK(BM_AerialImage)->Apply(bench::gridsAndThreads<>);
@@ -0,0 +1,29 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "benchmark_support.hpp"
+#include "../../src/cpp/core/multigrid.hpp"
+
+// Steady heat conduction from zero to the default tolerance: silicon with
+// oxide lines, heated over the lines
+static void BM_ThermalSolve(benchmark::State& state) {
+  const int side = static_cast<int>(state.range(0));
+  bench::useThreads(static_cast<int>(state.range(1)));
+  const BitMask lines = bench::lineMask(side, side);
+  Eigen::ArrayXXd conductivity(side, side), source(side, side);
+  for (int j = 0; j < side; ++j) {
+    for (int i = 0; i < side; ++i) {
+      conductivity(i, j) = lines.test(i, j) ? 1.4 : 148.0;
+      source(i, j) = lines.test(i, j) ? 1.0 : 0.0;
+    }
+  }
+  const MultigridSolver solver(conductivity);
+  Eigen::ArrayXXd temperature(side, side);
+  MultigridSolver::Statistics statistics;
+  for (auto _ : state) {
+    temperature.setConstant(300.0);
+    solver.solve(temperature, source, MultigridSolver::Options(), &statistics);
+    benchmark::DoNotOptimize(temperature.data());
+  }
+  state.counters["iterations"] = statistics.iterations;
+  bench::countCells(state, static_cast<double>(side) * side);
+}
+BENCHMARK(BM_ThermalSolve)->Apply(bench::gridsAndThreads<>);
@@ -0,0 +1,81 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "../../src/cpp/core/bit_mask.hpp"
+#include "../../src/cpp/core/task_scheduler.hpp"
+#include "../../src/cpp/core/wafer.hpp"
+#include <benchmark/benchmark.h>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <omp.h>
+
+// Largest grid side registered, set by SEMIPRO_BENCHMARK_MAX_GRID in CMake
+#ifndef SEMIPRO_BENCHMARK_MAX_GRID
+#define SEMIPRO_BENCHMARK_MAX_GRID 2048
+#endif
+
+namespace bench {
+
+inline int maxThreads() {
+  return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+// Thread counts 1, 2, 4, ... and the hardware's own
+inline std::vector<std::int64_t> threadCounts() {
+  std::vector<std::int64_t> counts;
+  for (int t = 1; t < maxThreads(); t *= 2) {
+    counts.push_back(t);
+  }
+  counts.push_back(maxThreads());
+  return counts;
+}
+
+// Arguments {grid side, threads} for sides 128, 512, 2048 and 8192 up to
+// SEMIPRO_BENCHMARK_MAX_GRID, or up to MaxSide when that is smaller
+template <int MaxSide = SEMIPRO_BENCHMARK_MAX_GRID>
+void gridsAndThreads(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"side", "threads"});
+  for (std::int64_t side = 128; side <= std::min(MaxSide, SEMIPRO_BENCHMARK_MAX_GRID); side *= 4) {
+    for (std::int64_t threads : threadCounts()) {
+      b->Args({side, threads});
+    }
+  }
+  b->UseRealTime()->Unit(benchmark::kMillisecond);
+}
+
+// Runs OpenMP regions and TaskScheduler work on `threads` threads
+inline void useThreads(int threads) {
+  omp_set_num_threads(threads);
+  auto& scheduler = TaskScheduler::getInstance();
+  if (scheduler.threadCount() != threads) {
+    scheduler.resize(threads);
+  }
+}
+
+// Grid points processed per second, reported beside the times
+inline void countCells(benchmark::State& state, double cells_per_iteration) {
+  state.counters["cells/s"] =
+      benchmark::Counter(cells_per_iteration * state.iterations(), benchmark::Counter::kIsRate);
+}
+
+// Vertical lines of `width` on a `pitch`, broken every so often so the
+// layout has line ends and corners as well as long runs
+inline BitMask lineMask(int rows, int cols, int pitch = 16, int width = 6) {
+  return BitMask::fromPredicate(rows, cols, [=](int i, int j) {
+    const int line = j / pitch;
+    const bool broken = ((i / (4 * pitch)) + line) % 5 == 0 && (i % (4 * pitch)) < pitch / 2;
+    return j % pitch < width && !broken;
+  });
+}
+
+// side x side wafer with lineMask() as its resist
+inline std::shared_ptr<Wafer> patternedWafer(int side) {
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(side, side);
+  wafer->setPhotoresistMask(lineMask(side, side));
+  return wafer;
+}
+
+} // namespace bench
@@ -0,0 +1,437 @@
+// Author: Dr. Mazharuddin Mohammed
+//
+// Batch throughput and scaling harness. Sweeps batch size, wafer grid
+// size and thread count over SimulationEngine::executeBatch and
+// SimulationOrchestrator::executeBatch, running the same four-step flow
+// on fresh wafers, and reports for each configuration:
+//
+//   wafers/hour          batch size over the median wall time
+//   step p50/p99         per-step latencies; the engine's process timers
+//                        for the engine, the orchestrator's step timers
+//                        (dispatch included) for the orchestrator
+//   strong efficiency    T(b, t0) * t0 / (T(b, t) * t) at a fixed batch b,
+//                        t0 the smallest thread count swept
+//   weak efficiency      T(w * t0, t0) / T(w * t, t) with w wafers per thread
+//   peak memory          MemoryManager::getPeakUsage over the run, and the
+//                        process's resident high-water mark where Linux
+//                        lets it be reset (/proc/self/clear_refs)
+//
+// The JSON report (--out) keys every result by target, scaling series,
+// grid, batch and threads, and records the label, compiler and host, so
+// reports from different releases line up in benchmarks/compare_throughput.py.
+//
+//   throughput_harness --grids 32,64,128 --batches 1,4,16 --threads 1,2,4
+//                      --weak 2 --repetitions 3 --label v1.4.0 --out report.json
+
+#include "../../src/cpp/core/advanced_logger.hpp"
+#include "../../src/cpp/core/json_value.hpp"
+#include "../../src/cpp/core/memory_manager.hpp"
+#include "../../src/cpp/core/simulation_engine.hpp"
+#include "../../src/cpp/core/simulation_orchestrator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <omp.h>
+
+namespace {
+
+using SemiPRO::SimulationOrchestrator;
+
+struct WorkloadStep {
+  const char* name;
+  const char* operation;
+  SimulationOrchestrator::StepType type;
+  std::vector<std::pair<const char*, double>> parameters;
+};
+
+// Front-end-like flow; parameters use the names both the engine's process
+// schemas and the orchestrator's step handlers accept. The implant runs
+// last because the level-set deposition and etch read the grid as surface
+// heights.
+const std::vector<WorkloadStep>& workload() {
+  using Type = SimulationOrchestrator::StepType;
+  static const std::vector<WorkloadStep> steps = {
+      {"gate_oxide", "oxidation", Type::OXIDATION, {{"temperature", 1000.0}, {"time", 0.1}}},
+      {"poly_deposition", "deposition", Type::DEPOSITION, {{"thickness", 0.1}, {"temperature", 400.0}}},
+      {"poly_etch", "etching", Type::ETCHING, {{"depth", 0.05}}},
+      {"source_drain_implant", "doping", Type::DOPING, {{"energy", 50.0}, {"dose", 1e15}}},
+  };
+  return steps;
+}
+
+const char* const kFlowName = "throughput";
+
+struct Options {
+  std::vector<std::string> targets{"engine", "orchestrator"};
+  std::vector<int> grids{32, 64, 128};
+  std::vector<int> batches{1, 4, 16};
+  std::vector<int> threads;  // Empty: 1, 2, 4, ... and the core count
+  int weak_per_thread = 2;   // 0 skips the weak-scaling series
+  int repetitions = 3;
+  std::string mode = "batch"; // Orchestrator execution mode
+  std::string label = "unlabelled";
+  std::string out;
+};
+
+struct Result {
+  std::string target;
+  std::string scaling; // "strong" or "weak"
+  int grid = 0;
+  int batch = 0;
+  int threads = 0;
+  double wall_seconds = 0.0; // Median over the repetitions
+  double wafers_per_hour = 0.0;
+  double step_p50_ms = 0.0;
+  double step_p99_ms = 0.0;
+  size_t steps = 0;
+  double efficiency = 1.0;
+  size_t peak_memory_bytes = 0;
+  size_t peak_rss_bytes = 0; // 0 where it cannot be measured per run
+  size_t failures = 0;
+};
+
+std::vector<int> parseInts(const std::string& list) {
+  std::vector<int> values;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    values.push_back(std::stoi(item));
+  }
+  return values;
+}
+
+std::vector<std::string> parseNames(const std::string& list) {
+  std::vector<std::string> names;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    names.push_back(item);
+  }
+  return names;
+}
+
+std::vector<int> defaultThreadCounts() {
+  const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  std::vector<int> counts;
+  for (int t = 1; t < cores; t *= 2) {
+    counts.push_back(t);
+  }
+  counts.push_back(cores);
+  return counts;
+}
+
+// Nearest-rank percentile of sorted values
+double percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+  return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  const size_t n = values.size();
+  return n % 2 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+// The workload as an orchestrator flow file, loaded once
+void loadFlow() {
+  const auto path = std::filesystem::temp_directory_path() / "semipro_throughput_flow.yaml";
+  {
+    static const std::map<SimulationOrchestrator::StepType, const char*> type_names = {
+        {SimulationOrchestrator::StepType::OXIDATION, "oxidation"},
+        {SimulationOrchestrator::StepType::DOPING, "doping"},
+        {SimulationOrchestrator::StepType::DEPOSITION, "deposition"},
+        {SimulationOrchestrator::StepType::ETCHING, "etching"},
+    };
+    std::ofstream file(path);
+    file << "name: " << kFlowName << "\nsteps:\n";
+    for (const auto& step : workload()) {
+      file << "  - name: " << step.name << "\n    type: " << type_names.at(step.type) << "\n    parameters:\n";
+      for (const auto& [key, value] : step.parameters) {
+        file << "      " << key << ": " << value << "\n";
+      }
+    }
+  }
+  SimulationOrchestrator::getInstance().loadSimulationFlow(path.string());
+  std::filesystem::remove(path);
+}
+
+// Starts a new resident high-water mark; false if the kernel lacks it
+bool resetPeakRss() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  return static_cast<bool>(clear_refs.flush());
+}
+
+size_t peakRss() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("VmHWM:", 0) == 0) {
+      return std::stoull(line.substr(6)) * 1024; // Reported in kB
+    }
+  }
+  return 0;
+}
+
+void useThreads(int threads) {
+  SimulationEngine::getInstance().setThreadCount(threads);
+  omp_set_num_threads(threads);
+}
+
+// One timed batch on fresh wafers; appends the step latencies in ms
+double runBatch(const Options& options, const std::string& target, int grid, int batch, int threads,
+                std::vector<double>& latencies, size_t& failures) {
+  auto& engine = SimulationEngine::getInstance();
+  auto& orchestrator = SimulationOrchestrator::getInstance();
+  auto& monitor = SemiPRO::AdvancedLogger::getInstance().getPerformanceMonitor();
+
+  std::vector<std::string> names;
+  for (int i = 0; i < batch; ++i) {
+    auto wafer = engine.createWafer(300.0, 775.0, "silicon");
+    wafer->initializeGrid(grid, grid);
+    names.push_back("throughput_" + std::to_string(i));
+    engine.registerWafer(wafer, names.back());
+  }
+
+  monitor.clearMetrics();
+  std::vector<bool> results;
+  const auto start = std::chrono::steady_clock::now();
+  if (target == "engine") {
+    for (const auto& name : names) {
+      for (const auto& step : workload()) {
+        SimulationEngine::ProcessParameters params(step.operation, 0.0);
+        for (const auto& [key, value] : step.parameters) {
+          params.parameters[key] = value;
+        }
+        engine.addProcessToBatch(name, params);
+      }
+    }
+    results = engine.executeBatch().get();
+  } else {
+    orchestrator.clearBatch();
+    orchestrator.resetSimulation();
+    if (options.mode == "batch") {
+      for (const auto& step : workload()) {
+        orchestrator.setStageWorkers(step.type, threads);
+      }
+    }
+    for (const auto& name : names) {
+      orchestrator.addWaferToBatch(name, kFlowName);
+    }
+    results = orchestrator.executeBatch().get();
+    orchestrator.clearBatch();
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  const std::string module = target == "engine" ? "SimulationEngine" : "SimulationOrchestrator";
+  for (const auto& metrics : monitor.getMetrics()) {
+    if (metrics.module_name == module) {
+      latencies.push_back(metrics.getDurationMs());
+    }
+  }
+  failures += static_cast<size_t>(std::count(results.begin(), results.end(), false));
+  for (const auto& name : names) {
+    engine.unregisterWafer(name);
+  }
+  return seconds;
+}
+
+Result measure(const Options& options, const std::string& target, const std::string& scaling, int grid, int batch,
+               int threads) {
+  useThreads(threads);
+  Result result;
+  result.target = target;
+  result.scaling = scaling;
+  result.grid = grid;
+  result.batch = batch;
+  result.threads = threads;
+
+  auto& memory = SemiPRO::MemoryManager::getInstance();
+  memory.resetPeakUsage();
+  const bool rss = resetPeakRss();
+  std::vector<double> walls;
+  std::vector<double> latencies;
+  for (int r = 0; r < options.repetitions; ++r) {
+    walls.push_back(runBatch(options, target, grid, batch, threads, latencies, result.failures));
+  }
+  result.peak_memory_bytes = memory.getPeakUsage();
+  result.peak_rss_bytes = rss ? peakRss() : 0;
+  result.wall_seconds = median(walls);
+  result.wafers_per_hour = result.wall_seconds > 0.0 ? batch * 3600.0 / result.wall_seconds : 0.0;
+  std::sort(latencies.begin(), latencies.end());
+  result.steps = latencies.size();
+  result.step_p50_ms = percentile(latencies, 50.0);
+  result.step_p99_ms = percentile(latencies, 99.0);
+  return result;
+}
+
+std::string timestamp() {
+  const std::time_t now = std::time(nullptr);
+  char text[32];
+  std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+  return text;
+}
+
+void writeReport(const Options& options, const std::vector<int>& threads, const std::vector<Result>& results) {
+  std::ofstream file(options.out);
+  if (!file) {
+    throw std::runtime_error("Cannot write throughput report: " + options.out);
+  }
+  SemiPRO::JsonWriter json(file, 64 * 1024, 2);
+  json.beginObject();
+  json.key("schema").integer(1);
+  json.key("label").string(options.label);
+  json.key("timestamp").string(timestamp());
+  json.key("compiler").string(__VERSION__);
+  json.key("hardware_threads").integer(std::thread::hardware_concurrency());
+  json.key("orchestrator_mode").string(options.mode);
+  json.key("repetitions").integer(options.repetitions);
+  json.key("weak_wafers_per_thread").integer(options.weak_per_thread);
+  json.key("thread_counts").beginArray();
+  for (int t : threads) {
+    json.integer(t);
+  }
+  json.endArray();
+  json.key("workload").beginArray();
+  for (const auto& step : workload()) {
+    json.beginObject();
+    json.key("step").string(step.name);
+    json.key("operation").string(step.operation);
+    for (const auto& [key, value] : step.parameters) {
+      json.key(key).number(value);
+    }
+    json.endObject();
+  }
+  json.endArray();
+  json.key("results").beginArray();
+  for (const auto& r : results) {
+    json.beginObject();
+    json.key("target").string(r.target);
+    json.key("scaling").string(r.scaling);
+    json.key("grid").integer(r.grid);
+    json.key("batch").integer(r.batch);
+    json.key("threads").integer(r.threads);
+    json.key("wall_seconds").number(r.wall_seconds);
+    json.key("wafers_per_hour").number(r.wafers_per_hour);
+    json.key("step_p50_ms").number(r.step_p50_ms);
+    json.key("step_p99_ms").number(r.step_p99_ms);
+    json.key("steps").integer(static_cast<long long>(r.steps));
+    json.key("efficiency").number(r.efficiency);
+    json.key("peak_memory_bytes").integer(static_cast<long long>(r.peak_memory_bytes));
+    json.key("peak_rss_bytes").integer(static_cast<long long>(r.peak_rss_bytes));
+    json.key("failures").integer(static_cast<long long>(r.failures));
+    json.endObject();
+  }
+  json.endArray();
+  json.endObject();
+}
+
+void printResult(const Result& r) {
+  std::printf("%-12s %-6s %6d %6d %7d %10.3f %12.1f %10.2f %10.2f %6.2f %10.1f %10.1f %4zu\n", r.target.c_str(),
+              r.scaling.c_str(), r.grid, r.batch, r.threads, r.wall_seconds, r.wafers_per_hour, r.step_p50_ms,
+              r.step_p99_ms, r.efficiency, r.peak_memory_bytes / (1024.0 * 1024.0),
+              r.peak_rss_bytes / (1024.0 * 1024.0), r.failures);
+  std::fflush(stdout);
+}
+
+int usage(const char* program) {
+  std::cerr << "Usage: " << program
+            << " [--targets engine,orchestrator] [--grids 32,64,128] [--batches 1,4,16]\n"
+               "       [--threads 1,2,4] [--weak N] [--repetitions N] [--mode batch|sequential]\n"
+               "       [--label NAME] [--out report.json]\n";
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      return usage(argv[0]);
+    }
+    const std::string value = argv[++i];
+    if (arg == "--targets") options.targets = parseNames(value);
+    else if (arg == "--grids") options.grids = parseInts(value);
+    else if (arg == "--batches") options.batches = parseInts(value);
+    else if (arg == "--threads") options.threads = parseInts(value);
+    else if (arg == "--weak") options.weak_per_thread = std::stoi(value);
+    else if (arg == "--repetitions") options.repetitions = std::max(1, std::stoi(value));
+    else if (arg == "--mode") options.mode = value;
+    else if (arg == "--label") options.label = value;
+    else if (arg == "--out") options.out = value;
+    else return usage(argv[0]);
+  }
+  for (const auto& target : options.targets) {
+    if (target != "engine" && target != "orchestrator") {
+      return usage(argv[0]);
+    }
+  }
+  if (options.mode != "batch" && options.mode != "sequential") {
+    return usage(argv[0]);
+  }
+  std::vector<int> threads = options.threads.empty() ? defaultThreadCounts() : options.threads;
+  std::sort(threads.begin(), threads.end());
+
+  SemiPRO::AdvancedLogger::getInstance().setMinLevel(SemiPRO::LogLevel::WARNING);
+  SimulationEngine::getInstance().initialize("");
+  auto& orchestrator = SimulationOrchestrator::getInstance();
+  orchestrator.setExecutionMode(options.mode == "batch" ? SimulationOrchestrator::ExecutionMode::BATCH
+                                                        : SimulationOrchestrator::ExecutionMode::SEQUENTIAL);
+  loadFlow();
+
+  std::printf("%-12s %-6s %6s %6s %7s %10s %12s %10s %10s %6s %10s %10s %4s\n", "target", "series", "grid",
+              "batch", "threads", "wall_s", "wafers/h", "p50_ms", "p99_ms", "eff", "peak_MiB", "rss_MiB", "fail");
+  std::vector<Result> results;
+  for (const auto& target : options.targets) {
+    for (int grid : options.grids) {
+      // Strong scaling: fixed batch, more threads
+      for (int batch : options.batches) {
+        double base = 0.0;
+        for (int t : threads) {
+          Result r = measure(options, target, "strong", grid, batch, t);
+          if (t == threads.front()) {
+            base = r.wall_seconds * t;
+          }
+          r.efficiency = r.wall_seconds > 0.0 ? base / (r.wall_seconds * t) : 0.0;
+          printResult(r);
+          results.push_back(r);
+        }
+      }
+      // Weak scaling: the batch grows with the threads
+      if (options.weak_per_thread > 0) {
+        double base = 0.0;
+        for (int t : threads) {
+          Result r = measure(options, target, "weak", grid, options.weak_per_thread * t, t);
+          if (t == threads.front()) {
+            base = r.wall_seconds;
+          }
+          r.efficiency = r.wall_seconds > 0.0 ? base / r.wall_seconds : 0.0;
+          printResult(r);
+          results.push_back(r);
+        }
+      }
+    }
+  }
+
+  if (!options.out.empty()) {
+    writeReport(options, threads, results);
+    std::cout << "Report written to " << options.out << std::endl;
+  }
+  SimulationEngine::getInstance().shutdown();
+  return 0;
+}
@@ -70,7 +70,7 @@ cpp_dir = os.path.abspath("src/cpp")
 
 extension = Extension(
     "{module_name}",
-    ["{pyx_file}", "src/cpp/core/wafer.cpp", "src/cpp/core/utils.cpp"],
+    ["{pyx_file}", "src/cpp/core/wafer.cpp", "src/cpp/core/field_store.cpp", "src/cpp/core/bit_mask.cpp", "src/cpp/core/utils.cpp", "src/cpp/core/log_ring.cpp", "src/cpp/core/depth_mesh.cpp", "src/cpp/core/field_precision.cpp"],
     language="c++",
     include_dirs=[
         numpy.get_include(),
@@ -99,15 +99,81 @@ def get_cpp_sources(module_name):
 # Core C++ sources
 CORE_SOURCES = [
     str(CPP_SRC_DIR / "core" / "wafer.cpp"),
+    str(CPP_SRC_DIR / "core" / "field_store.cpp"),
+    str(CPP_SRC_DIR / "core" / "bit_mask.cpp"),
     str(CPP_SRC_DIR / "core" / "utils.cpp"),
+    str(CPP_SRC_DIR / "core" / "log_ring.cpp"),
     str(CPP_SRC_DIR / "core" / "simulation_orchestrator.cpp"),
     str(CPP_SRC_DIR / "core" / "input_parser.cpp"),
+    str(CPP_SRC_DIR / "core" / "json_value.cpp"),
+    str(CPP_SRC_DIR / "core" / "job_manifest.cpp"),
     str(CPP_SRC_DIR / "core" / "output_generator.cpp"),
+    str(CPP_SRC_DIR / "core" / "adaptive_mesh.cpp"),
+    str(CPP_SRC_DIR / "core" / "adaptive_ode.cpp"),
+    str(CPP_SRC_DIR / "core" / "advanced_logger.cpp"),
+    str(CPP_SRC_DIR / "core" / "autotuner.cpp"),
+    str(CPP_SRC_DIR / "core" / "checkpoint_io.cpp"),
+    str(CPP_SRC_DIR / "core" / "config_manager.cpp"),
+    str(CPP_SRC_DIR / "core" / "depth_mesh.cpp"),
+    str(CPP_SRC_DIR / "core" / "distance_transform.cpp"),
+    str(CPP_SRC_DIR / "core" / "distributed_batch.cpp"),
+    str(CPP_SRC_DIR / "core" / "distributed_fft.cpp"),
+    str(CPP_SRC_DIR / "core" / "distributed_field.cpp"),
+    str(CPP_SRC_DIR / "core" / "edge_map.cpp"),
+    str(CPP_SRC_DIR / "core" / "enhanced_error_handling.cpp"),
+    str(CPP_SRC_DIR / "core" / "fft.cpp"),
+    str(CPP_SRC_DIR / "core" / "field_precision.cpp"),
+    str(CPP_SRC_DIR / "core" / "field_stream_writer.cpp"),
+    str(CPP_SRC_DIR / "core" / "field_volume.cpp"),
+    str(CPP_SRC_DIR / "core" / "flux_tracer.cpp"),
+    str(CPP_SRC_DIR / "core" / "gpu_compute.cpp"),
+    str(CPP_SRC_DIR / "core" / "grid_comm.cpp"),
+    str(CPP_SRC_DIR / "core" / "grid_stencil_matrix.cpp"),
+    str(CPP_SRC_DIR / "core" / "hardware_counters.cpp"),
+    str(CPP_SRC_DIR / "core" / "iso_mesh.cpp"),
+    str(CPP_SRC_DIR / "core" / "kernel_status.cpp"),
+    str(CPP_SRC_DIR / "core" / "keyframe_store.cpp"),
+    str(CPP_SRC_DIR / "core" / "laminate_plate_solver.cpp"),
+    str(CPP_SRC_DIR / "core" / "layer_connectivity.cpp"),
+    str(CPP_SRC_DIR / "core" / "layered_heat_solver.cpp"),
+    str(CPP_SRC_DIR / "core" / "level_set.cpp"),
+    str(CPP_SRC_DIR / "core" / "memory_manager.cpp"),
+    str(CPP_SRC_DIR / "core" / "multigrid.cpp"),
+    str(CPP_SRC_DIR / "core" / "pattern_density.cpp"),
+    str(CPP_SRC_DIR / "core" / "performance_utils.cpp"),
+    str(CPP_SRC_DIR / "core" / "phase_correlation.cpp"),
+    str(CPP_SRC_DIR / "core" / "plugin_manager.cpp"),
+    str(CPP_SRC_DIR / "core" / "point_grid.cpp"),
+    str(CPP_SRC_DIR / "core" / "profiler.cpp"),
+    str(CPP_SRC_DIR / "core" / "reproducibility.cpp"),
+    str(CPP_SRC_DIR / "core" / "result_store.cpp"),
+    str(CPP_SRC_DIR / "core" / "simulation_engine.cpp"),
+    str(CPP_SRC_DIR / "core" / "spectrum_cache.cpp"),
+    str(CPP_SRC_DIR / "core" / "state_history.cpp"),
+    str(CPP_SRC_DIR / "core" / "stencil.cpp"),
+    str(CPP_SRC_DIR / "core" / "task_scheduler.cpp"),
+    str(CPP_SRC_DIR / "core" / "telemetry.cpp"),
+    str(CPP_SRC_DIR / "core" / "temperature_schedule.cpp"),
+    str(CPP_SRC_DIR / "core" / "thermal_fatigue.cpp"),
+    str(CPP_SRC_DIR / "core" / "tiled_grid.cpp"),
+    str(CPP_SRC_DIR / "core" / "vector_math.cpp"),
+    str(CPP_SRC_DIR / "core" / "wafer_enhanced.cpp"),
+    str(CPP_SRC_DIR / "core" / "wafer_residency.cpp"),
+]
+
+# Physics and integration sources the core reaches
+SUPPORT_SOURCES = [
+    str(CPP_SRC_DIR / "integration" / "gds_library.cpp"),
+    str(CPP_SRC_DIR / "physics" / "enhanced_deposition.cpp"),
+    str(CPP_SRC_DIR / "physics" / "enhanced_doping.cpp"),
+    str(CPP_SRC_DIR / "physics" / "enhanced_etching.cpp"),
+    str(CPP_SRC_DIR / "physics" / "enhanced_oxidation.cpp"),
 ]
 
 # Renderer sources
 RENDERER_SOURCES = [
     str(CPP_SRC_DIR / "renderer" / "vulkan_renderer.cpp"),
+    str(CPP_SRC_DIR / "renderer" / "vulkan_compute.cpp"),
 ]
 
 # Module sources
@@ -115,7 +181,7 @@ MODULE_SOURCES = {
     "geometry": get_cpp_sources("geometry"),
     "oxidation": get_cpp_sources("oxidation"),
     "doping": get_cpp_sources("doping"),
-    "lithography": get_cpp_sources("lithography"),
+    "photolithography": get_cpp_sources("photolithography"),
     "deposition": get_cpp_sources("deposition"),
     "etching": get_cpp_sources("etching"),
     "metallization": get_cpp_sources("metallization"),
@@ -138,7 +204,7 @@ extensions = []
 
 if not BUILDING_DOCS:
     # Core extension
-    core_sources = CORE_SOURCES + RENDERER_SOURCES
+    core_sources = CORE_SOURCES + SUPPORT_SOURCES + RENDERER_SOURCES
     for module_name, sources in MODULE_SOURCES.items():
         core_sources.extend(sources)
 
@@ -21,7 +21,12 @@ extensions = [
         [
             "src/cython/geometry.pyx",
             "src/cpp/core/wafer.cpp",
+            "src/cpp/core/field_store.cpp",
+            "src/cpp/core/bit_mask.cpp",
             "src/cpp/core/utils.cpp",
+            "src/cpp/core/log_ring.cpp",
+            "src/cpp/core/depth_mesh.cpp",
+            "src/cpp/core/field_precision.cpp",
         ],
         language="c++",
         include_dirs=[
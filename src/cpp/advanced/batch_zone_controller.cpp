@@ -0,0 +1,184 @@
+#include "batch_zone_controller.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace SemiPRO {
+
+BatchZoneController::ZonePlant BatchZoneController::ZonePlant::firstOrder(
+    int zones, double tau, double coupling, double ambient, double dt) {
+
+    if (zones < 1 || !(tau > 0.0) || !(dt > 0.0)) {
+        throw std::invalid_argument("Zone plant needs zones, a positive time constant and a positive step");
+    }
+    // T' = M T + (u + ambient) / tau with M = -I / tau - coupling * L, L
+    // the chain Laplacian; M is symmetric, so e^{M dt} comes from its
+    // eigendecomposition and the input matrix is M^-1 (e^{M dt} - I) / tau
+    Eigen::MatrixXd M = Eigen::MatrixXd::Identity(zones, zones) * (-1.0 / tau);
+    for (int z = 0; z + 1 < zones; ++z) {
+        M(z, z) -= coupling;
+        M(z + 1, z + 1) -= coupling;
+        M(z, z + 1) += coupling;
+        M(z + 1, z) += coupling;
+    }
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen(M);
+    const Eigen::VectorXd& lambda = eigen.eigenvalues();
+    const Eigen::MatrixXd& V = eigen.eigenvectors();
+    Eigen::VectorXd decay(zones), gain(zones);
+    for (int z = 0; z < zones; ++z) {
+        decay(z) = std::exp(lambda(z) * dt);
+        gain(z) = std::expm1(lambda(z) * dt) / (lambda(z) * tau);
+    }
+    ZonePlant plant;
+    plant.A = V * decay.asDiagonal() * V.transpose();
+    plant.B = V * gain.asDiagonal() * V.transpose();
+    plant.d = plant.B * Eigen::VectorXd::Constant(zones, ambient);
+    return plant;
+}
+
+BatchZoneController::BatchZoneController(int wafers, const ZonePlant& plant, double time_step_seconds,
+                                         const PIDParameters& pid)
+    : plant_(plant), dt_(time_step_seconds) {
+
+    const Eigen::Index zones = plant.A.rows();
+    if (wafers < 1 || zones < 1 || plant.A.cols() != zones || plant.B.rows() != zones ||
+        plant.B.cols() != zones || plant.d.size() != zones) {
+        throw std::invalid_argument("Batch zone controller needs wafers and a square zone plant with one input per zone");
+    }
+    if (!(time_step_seconds > 0.0)) {
+        throw std::invalid_argument("Batch zone controller time step must be positive");
+    }
+    for (Eigen::ArrayXXd* a : {&kp_, &ki_, &kd_, &integral_limit_, &output_min_, &output_max_,
+                               &setpoint_, &temperature_, &output_, &integral_, &previous_error_}) {
+        a->setZero(zones, wafers);
+    }
+    setPIDParameters(pid);
+    setpoint_.setConstant(pid.setpoint);
+    temperature_.setConstant(25.0);
+}
+
+void BatchZoneController::setPIDParameters(const PIDParameters& params) {
+    kp_.setConstant(params.kp);
+    ki_.setConstant(params.ki);
+    kd_.setConstant(params.kd);
+    integral_limit_.setConstant(params.integral_limit);
+    output_min_.setConstant(params.output_limit_min);
+    output_max_.setConstant(params.output_limit_max);
+}
+
+void BatchZoneController::setPIDParameters(int wafer, int zone, const PIDParameters& params) {
+    kp_(zone, wafer) = params.kp;
+    ki_(zone, wafer) = params.ki;
+    kd_(zone, wafer) = params.kd;
+    integral_limit_(zone, wafer) = params.integral_limit;
+    output_min_(zone, wafer) = params.output_limit_min;
+    output_max_(zone, wafer) = params.output_limit_max;
+}
+
+void BatchZoneController::setSetpoints(double setpoint) {
+    setpoint_.setConstant(setpoint);
+}
+
+void BatchZoneController::setSetpoints(const Eigen::ArrayXXd& setpoints) {
+    if (setpoints.rows() != setpoint_.rows() || setpoints.cols() != setpoint_.cols()) {
+        throw std::invalid_argument("Setpoints must be zones x wafers");
+    }
+    setpoint_ = setpoints;
+}
+
+void BatchZoneController::setTemperatures(const Eigen::ArrayXXd& temperatures) {
+    if (temperatures.rows() != temperature_.rows() || temperatures.cols() != temperature_.cols()) {
+        throw std::invalid_argument("Temperatures must be zones x wafers");
+    }
+    temperature_ = temperatures;
+}
+
+void BatchZoneController::setMPCParameters(const MPCParameters& params) {
+    if (params.horizon < 1) {
+        throw std::invalid_argument("MPC horizon must be at least one step");
+    }
+    gains(params);
+    mpc_ = params;
+    mode_ = Mode::MPC;
+}
+
+void BatchZoneController::step() {
+    if (mode_ == Mode::MPC) {
+        controlMPC();
+    } else {
+        controlPID();
+    }
+    temperature_.matrix() = plant_.A * temperature_.matrix() + plant_.B * output_.matrix();
+    temperature_.colwise() += plant_.d.array();
+}
+
+void BatchZoneController::run(int steps) {
+    for (int k = 0; k < steps; ++k) {
+        step();
+    }
+}
+
+void BatchZoneController::controlPID() {
+    // The discrete law of AdvancedTemperatureController::calculatePIDOutput,
+    // one pass per term over every controller
+    const Eigen::ArrayXXd error = setpoint_ - temperature_;
+    integral_ = (integral_ + error * dt_).min(integral_limit_).max(-integral_limit_);
+    output_ = kp_ * error + ki_ * integral_ + kd_ * (error - previous_error_) / dt_;
+    output_ = output_.min(output_max_).max(output_min_);
+    previous_error_ = error;
+}
+
+void BatchZoneController::controlMPC() {
+    const MPCGains& k = gains(mpc_);
+    Eigen::MatrixXd u = k.Kr * setpoint_.matrix() + k.Ku * output_.matrix() - k.Kx * temperature_.matrix();
+    u.colwise() -= k.kd;
+    output_ = u.array().min(output_max_).max(output_min_);
+}
+
+const BatchZoneController::MPCGains& BatchZoneController::gains(const MPCParameters& params) {
+    const auto key = std::make_tuple(params.horizon, params.tracking_weight, params.move_weight);
+    auto cached = gain_cache_.find(key);
+    if (cached != gain_cache_.end()) {
+        return cached->second;
+    }
+
+    // Condensed over U = [u_0 .. u_{N-1}]: the predictions are
+    // X = Phi U + Psi T + g, and minimizing
+    //   q |X - S r|^2 + rho |D U - E u_prev|^2
+    // (D differencing successive moves, E picking the first) gives
+    //   U = H^-1 (q Phi' (S r - Psi T - g) + rho D' E u_prev),
+    // H = q Phi' Phi + rho D' D, of which only u_0 is applied
+    const int n = zones(), N = params.horizon;
+    const double q = params.tracking_weight, rho = params.move_weight;
+    Eigen::MatrixXd Phi = Eigen::MatrixXd::Zero(N * n, N * n);
+    Eigen::MatrixXd Psi(N * n, n), S(N * n, n);
+    Eigen::VectorXd g(N * n);
+    Eigen::MatrixXd power = Eigen::MatrixXd::Identity(n, n); // A^k
+    Eigen::VectorXd drift = Eigen::VectorXd::Zero(n);        // sum_{j<k} A^j d
+    for (int k = 0; k < N; ++k) {
+        const Eigen::MatrixXd impulse = power * plant_.B;    // A^k B
+        for (int j = 0; j + k < N; ++j) {
+            Phi.block((j + k) * n, j * n, n, n) = impulse;
+        }
+        drift += power * plant_.d;
+        power = plant_.A * power;
+        Psi.block(k * n, 0, n, n) = power;
+        g.segment(k * n, n) = drift;
+        S.block(k * n, 0, n, n).setIdentity();
+    }
+    Eigen::MatrixXd D = Eigen::MatrixXd::Identity(N * n, N * n);
+    for (int k = 1; k < N; ++k) {
+        D.block(k * n, (k - 1) * n, n, n) = -Eigen::MatrixXd::Identity(n, n);
+    }
+    const Eigen::MatrixXd H = q * Phi.transpose() * Phi + rho * D.transpose() * D;
+    const Eigen::MatrixXd first = H.ldlt().solve(Eigen::MatrixXd::Identity(N * n, N * n)).topRows(n);
+    const Eigen::MatrixXd tracking = q * first * Phi.transpose();
+
+    MPCGains gains;
+    gains.Kr = tracking * S;
+    gains.Kx = tracking * Psi;
+    gains.kd = tracking * g;
+    gains.Ku = rho * first.leftCols(n);
+    return gain_cache_.emplace(key, std::move(gains)).first->second;
+}
+
+} // namespace SemiPRO
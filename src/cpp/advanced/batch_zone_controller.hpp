@@ -0,0 +1,94 @@
+#pragma once
+
+#include "temperature_controller.hpp"
+#include <Eigen/Dense>
+#include <map>
+#include <tuple>
+
+namespace SemiPRO {
+
+/**
+ * Batch Zone Controller
+ * The lamp-zone controllers of many wafers stepped together. Controller
+ * state is kept as structure-of-arrays, one zones x wafers array per
+ * quantity, so a PID step is a handful of vectorized passes over every
+ * controller at once, and the plant step is one matrix product for the
+ * whole batch. In MPC mode each step applies precomputed gains of an
+ * unconstrained linear MPC; the gains are condensed once per horizon and
+ * weights and cached, so a step costs the same matrix products as PID.
+ */
+class BatchZoneController {
+public:
+    enum class Mode { PID, MPC };
+
+    // Linear zone plant shared by every wafer over one time step:
+    // T[k+1] = A T[k] + B u[k] + d, zones coupled through A and B
+    struct ZonePlant {
+        Eigen::MatrixXd A;
+        Eigen::MatrixXd B;
+        Eigen::VectorXd d;
+
+        // Zones relaxing with time constant tau (s) toward ambient plus
+        // their lamp output u (°C), each exchanging heat with its
+        // neighbours at `coupling` (1/s); exact for the linear ODE over dt
+        static ZonePlant firstOrder(int zones, double tau, double coupling, double ambient, double dt);
+    };
+
+    struct MPCParameters {
+        int horizon = 20;             // Steps predicted
+        double tracking_weight = 1.0; // On (T - setpoint)^2 per zone and step
+        double move_weight = 1e-3;    // On (u[k] - u[k-1])^2 per zone and step
+    };
+
+    BatchZoneController(int wafers, const ZonePlant& plant, double time_step_seconds,
+                        const PIDParameters& pid = PIDParameters());
+
+    int wafers() const { return static_cast<int>(temperature_.cols()); }
+    int zones() const { return static_cast<int>(temperature_.rows()); }
+
+    // Gains and limits of every controller, or of one zone of one wafer
+    void setPIDParameters(const PIDParameters& params);
+    void setPIDParameters(int wafer, int zone, const PIDParameters& params);
+    void setSetpoints(double setpoint);
+    void setSetpoints(const Eigen::ArrayXXd& setpoints); // zones x wafers
+    void setTemperatures(const Eigen::ArrayXXd& temperatures);
+
+    // Switches to MPC with these weights, condensing gains unless cached;
+    // outputs are clamped to each controller's limits
+    void setMPCParameters(const MPCParameters& params);
+    void setMode(Mode mode) { mode_ = mode; }
+    Mode mode() const { return mode_; }
+
+    // One control step of every controller, then the plant
+    void step();
+    void run(int steps);
+
+    const Eigen::ArrayXXd& temperatures() const { return temperature_; }
+    const Eigen::ArrayXXd& outputs() const { return output_; }
+    const Eigen::ArrayXXd& setpoints() const { return setpoint_; }
+    size_t cachedGainSets() const { return gain_cache_.size(); }
+
+private:
+    // First move of the condensed MPC: u = Kr r + Ku u_prev - Kx T - kd
+    struct MPCGains {
+        Eigen::MatrixXd Kr, Ku, Kx;
+        Eigen::VectorXd kd;
+    };
+
+    void controlPID();
+    void controlMPC();
+    const MPCGains& gains(const MPCParameters& params);
+
+    ZonePlant plant_;
+    double dt_;
+    Mode mode_ = Mode::PID;
+    MPCParameters mpc_;
+
+    // zones x wafers, one entry per controller
+    Eigen::ArrayXXd kp_, ki_, kd_, integral_limit_, output_min_, output_max_;
+    Eigen::ArrayXXd setpoint_, temperature_, output_, integral_, previous_error_;
+
+    std::map<std::tuple<int, double, double>, MPCGains> gain_cache_;
+};
+
+} // namespace SemiPRO
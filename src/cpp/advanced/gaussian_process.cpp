@@ -0,0 +1,153 @@
+#include "gaussian_process.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace SemiPRO {
+
+GaussianProcess::GaussianProcess() : GaussianProcess(Options()) {}
+
+GaussianProcess::GaussianProcess(const Options& options)
+    : options_(options), length_scale_(options.length_scale), next_refit_(options.first_refit) {}
+
+void GaussianProcess::clear() {
+    length_scale_ = options_.length_scale;
+    dimension_ = 0;
+    next_refit_ = options_.first_refit;
+    x_.clear();
+    y_.resize(0);
+    mean_ = 0.0;
+    scale_ = 1.0;
+    factor_.resize(0, 0);
+    weights_.resize(0);
+}
+
+double GaussianProcess::kernel(const double* a, const double* b) const {
+    double distance = 0.0;
+    for (int d = 0; d < dimension_; ++d) {
+        distance += (a[d] - b[d]) * (a[d] - b[d]);
+    }
+    return std::exp(-0.5 * distance / (length_scale_ * length_scale_));
+}
+
+void GaussianProcess::addSample(const std::vector<double>& x, double y) {
+    if (y_.size() == 0) {
+        dimension_ = static_cast<int>(x.size());
+    } else if (static_cast<int>(x.size()) != dimension_) {
+        throw std::invalid_argument("Gaussian process sample has " + std::to_string(x.size()) +
+                                    " dimensions, expected " + std::to_string(dimension_));
+    }
+    const int n = size();
+    x_.insert(x_.end(), x.begin(), x.end());
+    y_.conservativeResize(n + 1);
+    y_(n) = y;
+
+    if (next_refit_ > 0 && n + 1 >= next_refit_) {
+        next_refit_ *= 2;
+        refit();
+        return;
+    }
+
+    // Extend the factor by a row: l = L^-1 k, d = sqrt(k(x, x) - l.l)
+    if (factor_.rows() < n + 1) {
+        const Eigen::Index capacity = std::max<Eigen::Index>(16, 2 * factor_.rows());
+        factor_.conservativeResize(capacity, capacity);
+    }
+    Eigen::VectorXd k(n);
+    const double* point = x_.data() + static_cast<size_t>(n) * dimension_;
+    for (int i = 0; i < n; ++i) {
+        k(i) = kernel(x_.data() + static_cast<size_t>(i) * dimension_, point);
+    }
+    if (n > 0) {
+        factor_.topLeftCorner(n, n).triangularView<Eigen::Lower>().solveInPlace(k);
+        factor_.block(n, 0, 1, n) = k.transpose();
+    }
+    factor_.block(0, n, n + 1, 1).setZero();
+    factor_(n, n) = std::sqrt(std::max(1.0 + options_.noise - k.squaredNorm(), options_.noise));
+    updateWeights();
+}
+
+void GaussianProcess::updateWeights() {
+    const int n = size();
+    mean_ = y_.mean();
+    const double variance = n > 1 ? (y_.array() - mean_).square().sum() / (n - 1) : 0.0;
+    scale_ = variance > 0.0 ? std::sqrt(variance) : 1.0;
+    weights_ = (y_.array() - mean_) / scale_;
+    const auto lower = factor_.topLeftCorner(n, n).triangularView<Eigen::Lower>();
+    lower.solveInPlace(weights_);
+    lower.transpose().solveInPlace(weights_);
+}
+
+void GaussianProcess::factorize() {
+    const int n = size();
+    Eigen::MatrixXd k(n, n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j <= i; ++j) {
+            k(i, j) = k(j, i) = kernel(x_.data() + static_cast<size_t>(i) * dimension_,
+                                       x_.data() + static_cast<size_t>(j) * dimension_);
+        }
+        k(i, i) += options_.noise;
+    }
+    Eigen::LLT<Eigen::MatrixXd> llt(k);
+    factor_.resize(std::max(n, 16), std::max(n, 16));
+    factor_.topLeftCorner(n, n) = llt.matrixL();
+    updateWeights();
+}
+
+void GaussianProcess::refit() {
+    static const double kLadder[] = {0.05, 0.1, 0.2, 0.4, 0.8};
+    double best_scale = length_scale_, best = -std::numeric_limits<double>::infinity();
+    for (double scale : kLadder) {
+        length_scale_ = scale;
+        factorize();
+        const double likelihood = logMarginalLikelihood();
+        if (likelihood > best) {
+            best = likelihood;
+            best_scale = scale;
+        }
+    }
+    length_scale_ = best_scale;
+    factorize();
+}
+
+double GaussianProcess::logMarginalLikelihood() const {
+    const int n = size();
+    if (n == 0) return 0.0;
+    const Eigen::VectorXd z = (y_.array() - mean_) / scale_;
+    return -0.5 * z.dot(weights_) - factor_.diagonal().head(n).array().log().sum() - 0.5 * n * std::log(2.0 * M_PI);
+}
+
+GaussianProcess::Prediction GaussianProcess::predict(const std::vector<double>& x) const {
+    const int n = size();
+    if (n == 0) {
+        return {0.0, 1.0};
+    }
+    if (static_cast<int>(x.size()) != dimension_) {
+        throw std::invalid_argument("Gaussian process query has " + std::to_string(x.size()) +
+                                    " dimensions, expected " + std::to_string(dimension_));
+    }
+    Eigen::VectorXd k(n);
+    for (int i = 0; i < n; ++i) {
+        k(i) = kernel(x_.data() + static_cast<size_t>(i) * dimension_, x.data());
+    }
+    Prediction prediction;
+    prediction.mean = mean_ + scale_ * k.dot(weights_);
+    factor_.topLeftCorner(n, n).triangularView<Eigen::Lower>().solveInPlace(k);
+    prediction.stddev = scale_ * std::sqrt(std::max(1.0 - k.squaredNorm(), 0.0));
+    return prediction;
+}
+
+double GaussianProcess::expectedImprovement(const std::vector<double>& x, double best, double xi) const {
+    const Prediction p = predict(x);
+    const double gain = p.mean - best - xi;
+    if (p.stddev <= 0.0) {
+        return std::max(gain, 0.0);
+    }
+    const double z = gain / p.stddev;
+    const double cdf = 0.5 * std::erfc(-z / std::sqrt(2.0));
+    const double pdf = std::exp(-0.5 * z * z) / std::sqrt(2.0 * M_PI);
+    return gain * cdf + p.stddev * pdf;
+}
+
+} // namespace SemiPRO
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <vector>
+
+namespace SemiPRO {
+
+/**
+ * Gaussian Process Surrogate
+ * Regression over points in the unit cube with a squared-exponential
+ * kernel, for screening optimization candidates before simulating them.
+ * Samples are added one at a time by extending the Cholesky factor of the
+ * kernel matrix with a row, O(n^2) per sample. The length scale is refit
+ * from a ladder of candidates by marginal likelihood each time the sample
+ * count doubles, refactoring in O(n^3), so refits cost O(n^3) in all.
+ */
+class GaussianProcess {
+public:
+    struct Options {
+        double length_scale = 0.2;    // In the unit cube
+        double noise = 1e-6;          // Variance added on the diagonal, relative to the signal's
+        int first_refit = 8;          // Samples at the first length-scale refit; 0 never refits
+    };
+
+    struct Prediction {
+        double mean = 0.0;
+        double stddev = 0.0;
+    };
+
+    GaussianProcess();
+    explicit GaussianProcess(const Options& options);
+
+    // Throws std::invalid_argument for a point of another dimension than
+    // the first one added
+    void addSample(const std::vector<double>& x, double y);
+    void clear();
+
+    int size() const { return static_cast<int>(y_.size()); }
+    double lengthScale() const { return length_scale_; }
+    // Prior mean and stddev before any sample
+    Prediction predict(const std::vector<double>& x) const;
+    // Expected improvement over `best` for maximization, exploring by xi
+    double expectedImprovement(const std::vector<double>& x, double best, double xi = 0.01) const;
+    // Log marginal likelihood of the samples at the current length scale
+    double logMarginalLikelihood() const;
+
+private:
+    double kernel(const double* a, const double* b) const;
+    // Mean, scale and weights from the samples and factor
+    void updateWeights();
+    // Full factorization at the current length scale
+    void factorize();
+    void refit();
+
+    Options options_;
+    double length_scale_;
+    int dimension_ = 0;
+    int next_refit_;
+    std::vector<double> x_;            // Samples, dimension_ per row
+    Eigen::VectorXd y_;
+    double mean_ = 0.0, scale_ = 1.0; // Standardization of y_
+    Eigen::MatrixXd factor_;           // Lower Cholesky factor, first size() rows and columns
+    Eigen::VectorXd weights_;          // K^-1 (y - mean) / scale
+};
+
+} // namespace SemiPRO
@@ -0,0 +1,463 @@
+#include "model_calibration.hpp"
+#include "../core/task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+namespace SemiPRO {
+
+namespace {
+
+// Measurement uncertainty when none is given: 2% of the value
+double defaultSigma(double sigma, double value) {
+    if (sigma > 0.0) {
+        return sigma;
+    }
+    return std::max(0.02 * std::abs(value), 1e-12);
+}
+
+} // namespace
+
+ModelCalibrator::ModelCalibrator(std::vector<CalibrationParameter> parameters, std::vector<double> measured,
+                                 std::vector<double> sigma)
+    : parameters_(std::move(parameters)) {
+    if (parameters_.empty() || measured.empty()) {
+        throw std::invalid_argument("Calibration needs parameters and measurements");
+    }
+    if (!sigma.empty() && sigma.size() != measured.size()) {
+        throw std::invalid_argument("Calibration has " + std::to_string(sigma.size()) + " uncertainties for " +
+                                    std::to_string(measured.size()) + " measurements");
+    }
+    const auto m = static_cast<Eigen::Index>(measured.size());
+    measured_ = Eigen::Map<const Eigen::VectorXd>(measured.data(), m);
+    sigma_ = sigma.empty() ? Eigen::VectorXd::Ones(m)
+                           : Eigen::VectorXd(Eigen::Map<const Eigen::VectorXd>(sigma.data(), m));
+    if (!(sigma_.array() > 0.0).all()) {
+        throw std::invalid_argument("Measurement uncertainties must be positive");
+    }
+
+    const auto n = static_cast<Eigen::Index>(parameters_.size());
+    lower_.resize(n);
+    upper_.resize(n);
+    for (Eigen::Index j = 0; j < n; ++j) {
+        const CalibrationParameter& p = parameters_[j];
+        if (!(p.lower <= p.value && p.value <= p.upper)) {
+            throw std::invalid_argument("Calibration parameter " + p.name + " starts outside its bounds");
+        }
+        if (p.log_scale && !(p.value > 0.0)) {
+            throw std::invalid_argument("Log-scaled calibration parameter " + p.name + " must be positive");
+        }
+        if (p.log_scale) {
+            lower_[j] = p.lower > 0.0 ? std::log(p.lower) : -std::numeric_limits<double>::infinity();
+            upper_[j] = std::log(p.upper);
+        } else {
+            lower_[j] = p.lower;
+            upper_[j] = p.upper;
+        }
+    }
+}
+
+void ModelCalibrator::setModel(CalibrationModel model) {
+    model_ = std::move(model);
+}
+
+void ModelCalibrator::setDifferentiableModel(DifferentiableCalibrationModel model) {
+    differentiable_model_ = std::move(model);
+}
+
+std::vector<double> ModelCalibrator::toValues(const Eigen::VectorXd& x) const {
+    std::vector<double> values(parameters_.size());
+    for (std::size_t j = 0; j < values.size(); ++j) {
+        values[j] = parameters_[j].log_scale ? std::exp(x[j]) : x[j];
+    }
+    return values;
+}
+
+Eigen::VectorXd ModelCalibrator::toFitSpace(const std::vector<double>& values) const {
+    Eigen::VectorXd x(static_cast<Eigen::Index>(values.size()));
+    for (std::size_t j = 0; j < values.size(); ++j) {
+        x[j] = parameters_[j].log_scale ? std::log(values[j]) : values[j];
+    }
+    return x;
+}
+
+Eigen::VectorXd ModelCalibrator::project(Eigen::VectorXd x) const {
+    return x.cwiseMax(lower_).cwiseMin(upper_);
+}
+
+double ModelCalibrator::huberCost(const Eigen::VectorXd& residual) const {
+    const double delta = options_.huber_threshold;
+    if (delta <= 0.0) {
+        return 0.5 * residual.squaredNorm();
+    }
+    double cost = 0.0;
+    for (Eigen::Index i = 0; i < residual.size(); ++i) {
+        const double r = std::abs(residual[i]);
+        cost += r <= delta ? 0.5 * r * r : delta * (r - 0.5 * delta);
+    }
+    return cost;
+}
+
+ModelCalibrator::Evaluation ModelCalibrator::evaluate(const Eigen::VectorXd& x, bool with_jacobian,
+                                                      int& evaluations) const {
+    const int m = static_cast<int>(measured_.size());
+    const int n = static_cast<int>(parameters_.size());
+    Evaluation result;
+    result.residual.resize(m);
+    auto& scheduler = TaskScheduler::getInstance();
+
+    if (differentiable_model_ && (with_jacobian || !model_)) {
+        // One forward-mode pass per site gives the residual and its row
+        result.jacobian.setZero(m, n);
+        scheduler.parallelFor(0, m, [&](int begin, int end) {
+            std::vector<ADScalar> p(n);
+            for (int j = 0; j < n; ++j) {
+                p[j] = adVariable(x[j], j, n);
+                if (parameters_[j].log_scale) {
+                    p[j] = exp(p[j]);
+                }
+            }
+            for (int i = begin; i < end; ++i) {
+                const ADScalar y = differentiable_model_(static_cast<std::size_t>(i), p);
+                result.residual[i] = (y.value() - measured_[i]) / sigma_[i];
+                if (y.derivatives().size() == n) {
+                    result.jacobian.row(i) = y.derivatives().transpose() / sigma_[i];
+                }
+            }
+        });
+        evaluations += m;
+        if (!with_jacobian) {
+            result.jacobian.resize(0, 0);
+        }
+        result.cost = huberCost(result.residual);
+        return result;
+    }
+    if (!model_) {
+        throw std::logic_error("Model calibration has no model");
+    }
+
+    const std::vector<double> values = toValues(x);
+    scheduler.parallelFor(0, m, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            result.residual[i] = (model_(static_cast<std::size_t>(i), values) - measured_[i]) / sigma_[i];
+        }
+    });
+    evaluations += m;
+    result.cost = huberCost(result.residual);
+    if (!with_jacobian) {
+        return result;
+    }
+
+    // Forward differences, stepping back from an upper bound; every
+    // perturbed site prediction is a task of its own
+    Eigen::VectorXd step(n);
+    std::vector<std::vector<double>> perturbed(n);
+    for (int j = 0; j < n; ++j) {
+        step[j] = options_.finite_difference_step * std::max(1.0, std::abs(x[j]));
+        if (x[j] + step[j] > upper_[j]) {
+            step[j] = -step[j];
+        }
+        Eigen::VectorXd shifted = x;
+        shifted[j] += step[j];
+        perturbed[j] = toValues(shifted);
+    }
+    result.jacobian.resize(m, n);
+    scheduler.parallelFor(0, m * n, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            const int j = k / m;
+            const int i = k % m;
+            const double r = (model_(static_cast<std::size_t>(i), perturbed[j]) - measured_[i]) / sigma_[i];
+            result.jacobian(i, j) = (r - result.residual[i]) / step[j];
+        }
+    });
+    evaluations += m * n;
+    return result;
+}
+
+CalibrationResult ModelCalibrator::fit() const {
+    if (!model_ && !differentiable_model_) {
+        throw std::logic_error("Model calibration has no model");
+    }
+    const auto n = static_cast<Eigen::Index>(parameters_.size());
+    const Eigen::Index m = measured_.size();
+    const double delta = options_.huber_threshold;
+
+    CalibrationResult result;
+    std::vector<double> start(parameters_.size());
+    for (std::size_t j = 0; j < start.size(); ++j) {
+        start[j] = parameters_[j].value;
+    }
+    Eigen::VectorXd x = project(toFitSpace(start));
+    Evaluation current = evaluate(x, true, result.model_evaluations);
+    result.initial_cost = current.cost;
+
+    // Rows weighted so JᵀWJ and JᵀWr are the Gauss-Newton Hessian and the
+    // gradient of the Huber cost (iteratively reweighted least squares)
+    auto weights = [&](const Eigen::VectorXd& residual) {
+        Eigen::VectorXd w = Eigen::VectorXd::Ones(residual.size());
+        if (delta > 0.0) {
+            for (Eigen::Index i = 0; i < residual.size(); ++i) {
+                const double r = std::abs(residual[i]);
+                if (r > delta) {
+                    w[i] = delta / r;
+                }
+            }
+        }
+        return w;
+    };
+
+    double lambda = options_.initial_damping;
+    double nu = 2.0;
+    result.message = "Maximum iterations reached";
+    while (result.iterations < options_.max_iterations) {
+        const Eigen::VectorXd w = weights(current.residual);
+        const Eigen::MatrixXd hessian = current.jacobian.transpose() * w.asDiagonal() * current.jacobian;
+        const Eigen::VectorXd gradient = current.jacobian.transpose() * w.cwiseProduct(current.residual);
+
+        // A bound a parameter rests on stops the gradient pushing past it
+        Eigen::VectorXd projected = gradient;
+        for (Eigen::Index j = 0; j < n; ++j) {
+            if ((x[j] <= lower_[j] && gradient[j] > 0.0) || (x[j] >= upper_[j] && gradient[j] < 0.0)) {
+                projected[j] = 0.0;
+            }
+        }
+        if (projected.lpNorm<Eigen::Infinity>() <= options_.gradient_tolerance) {
+            result.converged = true;
+            result.message = "Gradient below tolerance";
+            break;
+        }
+
+        // Marquardt's scaling, floored so a parameter the data do not
+        // constrain still gets a finite step
+        Eigen::VectorXd scale = hessian.diagonal();
+        const double floor = std::max(1e-12 * scale.maxCoeff(), 1e-300);
+        scale = scale.cwiseMax(floor);
+        Eigen::MatrixXd damped = hessian;
+        damped.diagonal() += lambda * scale;
+        const Eigen::VectorXd delta_x = damped.ldlt().solve(-gradient);
+        const Eigen::VectorXd trial = project(x + delta_x);
+        const Eigen::VectorXd taken = trial - x;
+        ++result.iterations;
+
+        if (taken.norm() <= options_.step_tolerance * (x.norm() + options_.step_tolerance)) {
+            result.converged = true;
+            result.message = "Step below tolerance";
+            break;
+        }
+
+        Evaluation next = evaluate(trial, false, result.model_evaluations);
+        const double predicted = -(gradient.dot(taken) + 0.5 * taken.dot(hessian * taken));
+        const double actual = current.cost - next.cost;
+        if (actual > 0.0 && predicted > 0.0) {
+            const double rho = actual / predicted;
+            lambda *= std::max(1.0 / 3.0, 1.0 - std::pow(2.0 * rho - 1.0, 3));
+            nu = 2.0;
+            const double previous_cost = current.cost;
+            x = trial;
+            current = evaluate(x, true, result.model_evaluations);
+            if (actual <= options_.cost_tolerance * previous_cost) {
+                result.converged = true;
+                result.message = "Cost reduction below tolerance";
+                break;
+            }
+        } else {
+            lambda *= nu;
+            nu *= 2.0;
+        }
+    }
+
+    result.values = toValues(x);
+    result.final_cost = current.cost;
+    result.residuals.assign(current.residual.data(), current.residual.data() + current.residual.size());
+    for (std::size_t j = 0; j < parameters_.size(); ++j) {
+        result.parameters[parameters_[j].name] = result.values[j];
+    }
+
+    // Covariance s²(JᵀWJ)⁺ with the residual variance s² of the fit; with
+    // no more sites than parameters the errors are undetermined
+    result.standard_errors.assign(parameters_.size(), std::numeric_limits<double>::quiet_NaN());
+    if (m > n) {
+        const Eigen::VectorXd w = weights(current.residual);
+        const Eigen::MatrixXd hessian = current.jacobian.transpose() * w.asDiagonal() * current.jacobian;
+        const Eigen::MatrixXd covariance = hessian.completeOrthogonalDecomposition().pseudoInverse() *
+                                           (2.0 * current.cost / static_cast<double>(m - n));
+        for (Eigen::Index j = 0; j < n; ++j) {
+            const double error = std::sqrt(std::max(0.0, covariance(j, j)));
+            result.standard_errors[j] = parameters_[j].log_scale ? error * result.values[j] : error;
+        }
+    }
+    return result;
+}
+
+CalibrationResult calibrateDealGrove(EnhancedOxidationPhysics& physics, OxidationAtmosphere atmosphere,
+                                     const std::vector<OxideThicknessMeasurement>& measurements,
+                                     const CalibrationOptions& options) {
+    if (measurements.empty()) {
+        throw std::invalid_argument("Deal-Grove calibration needs thickness measurements");
+    }
+    const DealGroveParameters base = physics.getAtmosphereParameters(atmosphere);
+    bool several_temperatures = false;
+    for (const auto& measurement : measurements) {
+        if (measurement.conditions.atmosphere != atmosphere) {
+            throw std::invalid_argument("Thickness measurement grown in another atmosphere");
+        }
+        several_temperatures |= std::abs(measurement.conditions.temperature -
+                                         measurements.front().conditions.temperature) > 1e-9;
+    }
+
+    // The pressure, orientation and dopant factors of each site, taken out
+    // by evaluating the recipe with unit A and B at the base activation
+    // energies
+    std::vector<DealGroveParameters> factors(measurements.size());
+    DealGroveParameters unit = base;
+    unit.A = 1.0;
+    unit.B = 1.0;
+    physics.setAtmosphereParameters(atmosphere, unit);
+    try {
+        for (std::size_t i = 0; i < measurements.size(); ++i) {
+            const OxidationConditions& c = measurements[i].conditions;
+            factors[i] = physics.calculateEnhancedParameters(c);
+            factors[i].A /= physics.calculateTemperatureDependence(1.0, base.activation_energy_A, c.temperature);
+            factors[i].B /= physics.calculateTemperatureDependence(1.0, base.activation_energy_B, c.temperature);
+        }
+    } catch (...) {
+        physics.setAtmosphereParameters(atmosphere, base);
+        throw;
+    }
+    physics.setAtmosphereParameters(atmosphere, base);
+
+    std::vector<CalibrationParameter> parameters;
+    const double a = base.A > 0.0 ? base.A : 0.1;
+    parameters.push_back({"A", a, a * 1e-2, a * 1e2, true});
+    parameters.push_back({"B", base.B, base.B * 1e-2, base.B * 1e2, true});
+    if (several_temperatures) {
+        parameters.push_back({"activation_energy_A", base.activation_energy_A, 0.1, 5.0, false});
+        parameters.push_back({"activation_energy_B", base.activation_energy_B, 0.1, 5.0, false});
+    }
+
+    std::vector<double> measured, sigma;
+    for (const auto& measurement : measurements) {
+        measured.push_back(measurement.thickness);
+        sigma.push_back(defaultSigma(measurement.sigma, measurement.thickness));
+    }
+    ModelCalibrator calibrator(parameters, measured, sigma);
+    calibrator.setOptions(options);
+    const EnhancedOxidationPhysics& model = physics;
+    calibrator.setModel([&](std::size_t site, const std::vector<double>& v) {
+        const OxidationConditions& c = measurements[site].conditions;
+        const double ea_a = several_temperatures ? v[2] : base.activation_energy_A;
+        const double ea_b = several_temperatures ? v[3] : base.activation_energy_B;
+        DealGroveParameters p = factors[site];
+        p.A *= model.calculateTemperatureDependence(v[0], ea_a, c.temperature);
+        p.B *= model.calculateTemperatureDependence(v[1], ea_b, c.temperature);
+        return model.calculateThickness(p, c);
+    });
+    CalibrationResult result = calibrator.fit();
+
+    DealGroveParameters fitted = base;
+    fitted.A = result.values[0];
+    fitted.B = result.values[1];
+    if (several_temperatures) {
+        fitted.activation_energy_A = result.values[2];
+        fitted.activation_energy_B = result.values[3];
+    }
+    physics.setAtmosphereParameters(atmosphere, fitted);
+    return result;
+}
+
+CalibrationResult calibrateImplantMoments(EnhancedDopingPhysics& physics, IonSpecies species,
+                                          const std::vector<ImplantMomentMeasurement>& measurements,
+                                          const CalibrationOptions& options) {
+    if (measurements.empty()) {
+        throw std::invalid_argument("Implant moment calibration needs range measurements");
+    }
+    // The uncorrected moments at each energy; the corrections scale them
+    const MomentCorrection current = physics.getMomentCorrection(species);
+    std::vector<double> ranges, stragglings, measured, sigma;
+    for (const auto& measurement : measurements) {
+        const GaussianImplant<double> implant =
+            physics.calculateGaussianImplant<double>(species, measurement.energy, 1e13);
+        ranges.push_back(implant.projected_range / current.range);
+        stragglings.push_back(implant.range_straggling / current.straggling);
+        measured.push_back(measurement.projected_range);
+        sigma.push_back(defaultSigma(measurement.sigma, measurement.projected_range));
+        measured.push_back(measurement.range_straggling);
+        sigma.push_back(defaultSigma(measurement.sigma, measurement.range_straggling));
+    }
+
+    ModelCalibrator calibrator({{"range", current.range, 0.2, 5.0, true},
+                                {"straggling", current.straggling, 0.2, 5.0, true}},
+                               measured, sigma);
+    calibrator.setOptions(options);
+    // Sites alternate projected range and straggling, linear in the
+    // corrections, so the gradient comes exactly from differentiation
+    calibrator.setDifferentiableModel([&](std::size_t site, const std::vector<ADScalar>& v) {
+        return site % 2 == 0 ? ADScalar(v[0] * ranges[site / 2]) : ADScalar(v[1] * stragglings[site / 2]);
+    });
+    calibrator.setModel([&](std::size_t site, const std::vector<double>& v) {
+        return site % 2 == 0 ? v[0] * ranges[site / 2] : v[1] * stragglings[site / 2];
+    });
+    CalibrationResult result = calibrator.fit();
+
+    MomentCorrection fitted;
+    fitted.range = result.values[0];
+    fitted.straggling = result.values[1];
+    physics.setMomentCorrection(species, fitted);
+    return result;
+}
+
+CalibrationResult calibrateEtchRates(EnhancedEtchingPhysics& physics,
+                                     const std::vector<EtchRateMeasurement>& measurements,
+                                     const CalibrationOptions& options) {
+    if (measurements.empty()) {
+        throw std::invalid_argument("Etch rate calibration needs rate measurements");
+    }
+    // One base rate per (material, chemistry) pair measured, and each
+    // site's recipe factor, taken out by evaluating it at a unit rate
+    std::map<std::pair<EtchMaterial, EtchChemistry>, std::size_t> pairs;
+    std::vector<std::pair<EtchMaterial, EtchChemistry>> keys;
+    std::vector<std::size_t> pair_of(measurements.size());
+    std::vector<double> factors(measurements.size());
+    std::vector<double> measured, sigma;
+    for (std::size_t i = 0; i < measurements.size(); ++i) {
+        const EtchingConditions& c = measurements[i].conditions;
+        const auto key = std::make_pair(c.target_material, c.chemistry);
+        const auto found = pairs.emplace(key, keys.size());
+        if (found.second) {
+            keys.push_back(key);
+        }
+        pair_of[i] = found.first->second;
+
+        const double rate = physics.getEtchRate(key.first, key.second);
+        physics.setEtchRate(key.first, key.second, 1.0);
+        factors[i] = physics.calculateEtchRate(c);
+        physics.setEtchRate(key.first, key.second, rate);
+
+        measured.push_back(measurements[i].rate);
+        sigma.push_back(defaultSigma(measurements[i].sigma, measurements[i].rate));
+    }
+
+    std::vector<CalibrationParameter> parameters;
+    for (const auto& key : keys) {
+        const double rate = physics.getEtchRate(key.first, key.second);
+        const double start = rate > 0.0 ? rate : 0.01;
+        parameters.push_back({physics.materialToString(key.first) + "/" + physics.chemistryToString(key.second),
+                              start, start * 1e-3, start * 1e3, true});
+    }
+
+    ModelCalibrator calibrator(parameters, measured, sigma);
+    calibrator.setOptions(options);
+    calibrator.setModel([&](std::size_t site, const std::vector<double>& v) {
+        return v[pair_of[site]] * factors[site];
+    });
+    CalibrationResult result = calibrator.fit();
+
+    for (std::size_t k = 0; k < keys.size(); ++k) {
+        physics.setEtchRate(keys[k].first, keys[k].second, result.values[k]);
+    }
+    return result;
+}
+
+} // namespace SemiPRO
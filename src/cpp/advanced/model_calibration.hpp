@@ -0,0 +1,162 @@
+#pragma once
+
+#include "../core/autodiff.hpp"
+#include "../physics/enhanced_doping.hpp"
+#include "../physics/enhanced_etching.hpp"
+#include "../physics/enhanced_oxidation.hpp"
+#include <Eigen/Dense>
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SemiPRO {
+
+// A model parameter to calibrate, within [lower, upper]
+struct CalibrationParameter {
+    std::string name;
+    double value = 0.0;       // Starting guess
+    double lower = -std::numeric_limits<double>::infinity();
+    double upper = std::numeric_limits<double>::infinity();
+    bool log_scale = false;   // Fitted as log(value), for constants spanning decades; needs value > 0
+};
+
+// The model's prediction at measurement site `site` for parameter values
+// in the order the parameters were given. Called from several threads at
+// once, so it must not modify shared state.
+using CalibrationModel = std::function<double(std::size_t, const std::vector<double>&)>;
+// The same on ADScalar parameters seeded as variables, so the prediction
+// carries its gradient with respect to them
+using DifferentiableCalibrationModel = std::function<ADScalar(std::size_t, const std::vector<ADScalar>&)>;
+
+struct CalibrationOptions {
+    int max_iterations = 100;
+    double initial_damping = 1e-3;        // Marquardt's lambda at the start
+    double cost_tolerance = 1e-12;        // Converged when a step lowers the cost by less, relatively
+    double step_tolerance = 1e-10;        // Or moves the fitted parameters by less, relatively
+    double gradient_tolerance = 1e-10;    // Or the projected gradient falls below this
+    double finite_difference_step = 1e-6; // Of a fitted parameter's magnitude (at least 1)
+    // Normalized residuals beyond this count linearly (Huber loss), so a
+    // few bad sites do not drag the fit; 0 fits plain least squares
+    double huber_threshold = 0.0;
+};
+
+struct CalibrationResult {
+    std::unordered_map<std::string, double> parameters;
+    std::vector<double> values;           // In the order of the parameters
+    std::vector<double> standard_errors;  // From the Jacobian at the fit, scaled by the residual variance
+    std::vector<double> residuals;        // Normalized, (predicted - measured) / sigma, per site
+    double initial_cost = 0.0;            // Half the sum of the squared (Huber) normalized residuals
+    double final_cost = 0.0;
+    int iterations = 0;
+    int model_evaluations = 0;            // Site predictions, gradient evaluations included
+    bool converged = false;
+    std::string message;
+};
+
+/**
+ * Model Calibrator
+ * Fits model parameters to measurements by Levenberg-Marquardt: each
+ * iteration solves (JᵀJ + λ diag(JᵀJ)) δ = -Jᵀr for the normalized
+ * residuals r and their Jacobian J, accepts the step if it lowers the
+ * cost, and loosens or tightens λ by how well the linear model predicted
+ * the drop (Nielsen's update), so steps range from Gauss-Newton to short
+ * gradient steps inside a trust region. Steps are projected onto the
+ * parameter bounds, and log-scaled parameters are fitted in log space.
+ *
+ * Residuals are evaluated for every site in parallel on the TaskScheduler.
+ * The Jacobian comes from the differentiable model by automatic
+ * differentiation when one is set, a site per task; otherwise from
+ * forward differences, every (parameter, site) prediction a task of its
+ * own, so all the perturbed evaluations run concurrently.
+ */
+class ModelCalibrator {
+public:
+    // sigma, the uncertainty of each measurement, defaults to 1; throws
+    // std::invalid_argument if the sizes differ, a sigma is not positive
+    // or a parameter's bounds or starting value are inconsistent
+    ModelCalibrator(std::vector<CalibrationParameter> parameters, std::vector<double> measured,
+                    std::vector<double> sigma = {});
+
+    void setModel(CalibrationModel model);
+    void setDifferentiableModel(DifferentiableCalibrationModel model);
+    void setOptions(const CalibrationOptions& options) { options_ = options; }
+
+    // Throws std::logic_error without a model
+    CalibrationResult fit() const;
+
+    const std::vector<CalibrationParameter>& parameters() const { return parameters_; }
+    std::size_t siteCount() const { return measured_.size(); }
+
+private:
+    struct Evaluation {
+        Eigen::VectorXd residual; // Normalized
+        Eigen::MatrixXd jacobian; // Of the normalized residuals in fit space; empty unless asked for
+        double cost = 0.0;
+    };
+
+    // Parameter values from fit-space coordinates, and back
+    std::vector<double> toValues(const Eigen::VectorXd& x) const;
+    Eigen::VectorXd toFitSpace(const std::vector<double>& values) const;
+    Eigen::VectorXd project(Eigen::VectorXd x) const;
+    Evaluation evaluate(const Eigen::VectorXd& x, bool with_jacobian, int& evaluations) const;
+    double huberCost(const Eigen::VectorXd& residual) const;
+
+    std::vector<CalibrationParameter> parameters_;
+    Eigen::VectorXd measured_;
+    Eigen::VectorXd sigma_;
+    Eigen::VectorXd lower_; // In fit space
+    Eigen::VectorXd upper_;
+    CalibrationModel model_;
+    DifferentiableCalibrationModel differentiable_model_;
+    CalibrationOptions options_;
+};
+
+// Oxide thickness measured after an oxidation
+struct OxideThicknessMeasurement {
+    OxidationConditions conditions;
+    double thickness = 0.0; // μm
+    double sigma = 0.0;     // μm; 0 weighs the site by 2% of its thickness
+};
+
+// Projected range and range straggling of an implant, e.g. from SIMS
+struct ImplantMomentMeasurement {
+    double energy = 0.0;           // keV
+    double projected_range = 0.0;  // μm
+    double range_straggling = 0.0; // μm
+    double sigma = 0.0;            // μm, of both; 0 weighs each by 2% of its value
+};
+
+// Blanket etch rate measured at a recipe
+struct EtchRateMeasurement {
+    EtchingConditions conditions;
+    double rate = 0.0;  // μm/min
+    double sigma = 0.0; // μm/min; 0 weighs the site by 2% of its rate
+};
+
+// Calibrate the physics databases against fab metrology and write the
+// fitted values back into them, so every later simulation uses them.
+// Each throws std::invalid_argument without measurements. The constants
+// being fitted are set to 1 for a moment while their recipe factors are
+// taken out of the model, so none may run alongside a simulation on the
+// same physics object.
+
+// A and B of the atmosphere's Deal-Grove constants, and their activation
+// energies when the measurements span more than one temperature
+CalibrationResult calibrateDealGrove(EnhancedOxidationPhysics& physics, OxidationAtmosphere atmosphere,
+                                     const std::vector<OxideThicknessMeasurement>& measurements,
+                                     const CalibrationOptions& options = CalibrationOptions());
+
+// The species' range and straggling corrections ("range", "straggling")
+CalibrationResult calibrateImplantMoments(EnhancedDopingPhysics& physics, IonSpecies species,
+                                          const std::vector<ImplantMomentMeasurement>& measurements,
+                                          const CalibrationOptions& options = CalibrationOptions());
+
+// The base rate of every (material, chemistry) pair measured, named
+// "<material>/<chemistry>"
+CalibrationResult calibrateEtchRates(EnhancedEtchingPhysics& physics,
+                                     const std::vector<EtchRateMeasurement>& measurements,
+                                     const CalibrationOptions& options = CalibrationOptions());
+
+} // namespace SemiPRO
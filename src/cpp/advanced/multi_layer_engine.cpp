@@ -1,13 +1,140 @@
 #include "multi_layer_engine.hpp"
+#include "../core/task_scheduler.hpp"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <limits>
+#include <mutex>
 #include <random>
 
 namespace SemiPRO {
 
+namespace {
+
+void accumulate(LayerTerms& totals, const LayerTerms& terms, double sign) {
+    totals.thickness += sign * terms.thickness;
+    totals.stress_moment += sign * terms.stress_moment;
+    totals.uniformity_moment += sign * terms.uniformity_moment;
+    totals.interface_defects += sign * terms.interface_defects;
+    totals.reliability_penalty += sign * terms.reliability_penalty;
+}
+
+StackMetrics metricsFromTotals(const LayerTerms& totals) {
+    StackMetrics metrics;
+    metrics.thickness = totals.thickness;
+    if (totals.thickness > 0) {
+        metrics.stress = totals.stress_moment / totals.thickness;
+        metrics.uniformity = totals.uniformity_moment / totals.thickness;
+    }
+    metrics.stress += totals.interface_defects * 1e-6; // Interface stress (MPa)
+    metrics.defect_density = totals.interface_defects;
+    metrics.reliability = std::max(0.0, 100.0 - totals.reliability_penalty);
+    return metrics;
+}
+
+// A partial stack grown and shrunk at the top, each pushed layer's terms
+// derived once from those beneath it
+class DesignEvaluator {
+public:
+    void push(const AdvancedLayer& layer) {
+        const size_t index = stack_.layers.size();
+        stack_.layers.push_back(layer);
+        const LayerInterface* below = nullptr;
+        if (index > 0) {
+            LayerInterface interface;
+            interface.lower_layer_id = stack_.layers[index - 1].id;
+            interface.upper_layer_id = layer.id;
+            stack_.interfaces.push_back(interface);
+            below = &stack_.interfaces.back();
+        }
+        const LayerTerms terms = MultiLayerUtils::deriveLayerTerms(stack_, index, below, position_, terms_);
+        terms_.push_back(terms);
+        totals_.push_back(totals_.back());
+        accumulate(totals_.back(), terms, 1.0);
+        auto shadowed = position_.find(layer.id);
+        shadowed_.push_back(shadowed == position_.end() ? kNone : shadowed->second);
+        position_[layer.id] = index;
+    }
+    
+    void pop() {
+        totals_.pop_back();
+        terms_.pop_back();
+        const std::string& id = stack_.layers.back().id;
+        if (shadowed_.back() == kNone) {
+            position_.erase(id);
+        } else {
+            position_[id] = shadowed_.back();
+        }
+        shadowed_.pop_back();
+        if (stack_.layers.size() > 1) {
+            stack_.interfaces.pop_back();
+        }
+        stack_.layers.pop_back();
+    }
+    
+    size_t size() const { return stack_.layers.size(); }
+    const AdvancedLayer& top() const { return stack_.layers.back(); }
+    StackMetrics metrics() const { return metricsFromTotals(totals_.back()); }
+    
+private:
+    static constexpr size_t kNone = std::numeric_limits<size_t>::max();
+    
+    LayerStack stack_;
+    std::vector<LayerTerms> terms_;
+    std::vector<LayerTerms> totals_{LayerTerms()}; // Per depth, so values never depend on the path
+    std::unordered_map<std::string, size_t> position_; // Topmost layer with each id
+    std::vector<size_t> shadowed_;                     // Position each push replaced
+};
+
+// Values of the candidates that have thickness, which bound where
+// thickness-weighted averages can move
+struct CandidateRange {
+    bool any = false;
+    double stress_min = 0.0, stress_max = 0.0;
+    double uniformity_max = 0.0;
+};
+
+// The objective's value for a stack, as calculateObjectiveValue scores it
+double designValue(const StackMetrics& metrics, OptimizationObjective objective) {
+    switch (objective) {
+        case OptimizationObjective::MINIMIZE_STRESS:
+            return 1000.0 / (1.0 + std::abs(metrics.stress));
+        case OptimizationObjective::MAXIMIZE_UNIFORMITY:
+            return metrics.uniformity;
+        case OptimizationObjective::MINIMIZE_DEFECTS:
+            return 1e12 / (1.0 + metrics.defect_density);
+        case OptimizationObjective::MAXIMIZE_YIELD:
+            return metrics.reliability;
+        default:
+            return 50.0;
+    }
+}
+
+// No stack extending one with these metrics scores above this. Added
+// layers move the averages only toward candidate values, and only add
+// reliability penalties; interfaces formed in the search carry no defects.
+double designBound(const StackMetrics& metrics, OptimizationObjective objective, const CandidateRange& range) {
+    switch (objective) {
+        case OptimizationObjective::MINIMIZE_STRESS: {
+            double low = metrics.stress, high = metrics.stress;
+            if (range.any) {
+                low = std::min(low, range.stress_min);
+                high = std::max(high, range.stress_max);
+            }
+            const double least = (low <= 0.0 && high >= 0.0) ? 0.0 : std::min(std::abs(low), std::abs(high));
+            return 1000.0 / (1.0 + least);
+        }
+        case OptimizationObjective::MAXIMIZE_UNIFORMITY:
+            return range.any ? std::max(metrics.uniformity, range.uniformity_max) : metrics.uniformity;
+        default:
+            return designValue(metrics, objective);
+    }
+}
+
+} // namespace
+
 MultiLayerEngine::MultiLayerEngine() {
     initializeLayerTypeNames();
-    initializePhysicsEngines();
     
     SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
                       "Multi-Layer Processing Engine initialized", "MultiLayerEngine");
@@ -17,6 +144,7 @@ void MultiLayerEngine::createStack(const std::string& stack_id) {
     LayerStack stack;
     stack.stack_id = stack_id;
     stacks_[stack_id] = stack;
+    stack_caches_.erase(stack_id);
     
     SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
                       "Created layer stack: " + stack_id, "MultiLayerEngine");
@@ -28,6 +156,7 @@ void MultiLayerEngine::addLayerToStack(const std::string& stack_id, const Advanc
         throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION, "Stack not found: " + stack_id, "STACK_NOT_FOUND"));
     }
     
+    StackCache& cache = stackCache(stack_id);
     it->second.layers.push_back(layer);
     it->second.total_thickness += layer.target_thickness;
     
@@ -38,12 +167,175 @@ void MultiLayerEngine::addLayerToStack(const std::string& stack_id, const Advanc
         interface.upper_layer_id = layer.id;
         interface.type = InterfaceType::ABRUPT;
         it->second.interfaces.push_back(interface);
+        cache.interface_below[layer.id] = it->second.interfaces.size() - 1;
     }
     
+    // Nothing beneath reads the new top layer; it enters the totals when
+    // first derived, and its dependents follow if it is a dependency
+    const size_t index = it->second.layers.size() - 1;
+    cache.position[layer.id] = index;
+    cache.terms.emplace_back();
+    for (const auto& dependency : layer.dependencies) {
+        cache.dependents[dependency].push_back(layer.id);
+    }
+    cache.dirty.insert(index);
+    
     SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
                       "Added layer " + layer.id + " to stack " + stack_id, "MultiLayerEngine");
 }
 
+void MultiLayerEngine::removeLayerFromStack(const std::string& stack_id, const std::string& layer_id_ref) {
+    const std::string layer_id = layer_id_ref; // May name the layer being erased
+    auto& stack = getStack(stack_id);
+    StackCache& cache = stackCache(stack_id);
+    auto position = cache.position.find(layer_id);
+    if (position == cache.position.end()) {
+        throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION, "Layer not found: " + layer_id, "LAYER_NOT_FOUND"));
+    }
+    const size_t index = position->second;
+    
+    accumulate(cache.totals, cache.terms[index], -1.0);
+    cache.terms.erase(cache.terms.begin() + index);
+    stack.total_thickness -= stack.layers[index].target_thickness;
+    stack.layers.erase(stack.layers.begin() + index);
+    
+    // The layers either side now meet at a new interface
+    stack.interfaces.erase(std::remove_if(stack.interfaces.begin(), stack.interfaces.end(),
+        [&layer_id](const LayerInterface& interface) {
+            return interface.upper_layer_id == layer_id || interface.lower_layer_id == layer_id;
+        }), stack.interfaces.end());
+    if (index > 0 && index < stack.layers.size()) {
+        LayerInterface interface;
+        interface.lower_layer_id = stack.layers[index - 1].id;
+        interface.upper_layer_id = stack.layers[index].id;
+        interface.type = InterfaceType::ABRUPT;
+        stack.interfaces.push_back(interface);
+    }
+    
+    std::set<size_t> dirty;
+    for (size_t i : cache.dirty) {
+        if (i != index) dirty.insert(i < index ? i : i - 1);
+    }
+    cache.dirty = std::move(dirty);
+    auto dependents = cache.dependents.find(layer_id);
+    std::vector<std::string> orphans;
+    if (dependents != cache.dependents.end()) {
+        orphans = dependents->second;
+    }
+    indexStackCache(stack, cache);
+    if (index < stack.layers.size()) {
+        cache.dirty.insert(index);
+    }
+    for (const auto& dependent : orphans) {
+        auto it = cache.position.find(dependent);
+        if (it != cache.position.end()) cache.dirty.insert(it->second);
+    }
+    
+    SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                      "Removed layer " + layer_id + " from stack " + stack_id, "MultiLayerEngine");
+}
+
+void MultiLayerEngine::updateLayer(const std::string& stack_id, const AdvancedLayer& layer) {
+    auto& stack = getStack(stack_id);
+    StackCache& cache = stackCache(stack_id);
+    auto position = cache.position.find(layer.id);
+    if (position == cache.position.end()) {
+        throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION, "Layer not found: " + layer.id, "LAYER_NOT_FOUND"));
+    }
+    AdvancedLayer& current = stack.layers[position->second];
+    if (current.dependencies != layer.dependencies) {
+        for (const auto& dependency : current.dependencies) {
+            auto& dependents = cache.dependents[dependency];
+            dependents.erase(std::remove(dependents.begin(), dependents.end(), layer.id), dependents.end());
+        }
+        for (const auto& dependency : layer.dependencies) {
+            cache.dependents[dependency].push_back(layer.id);
+        }
+    }
+    current = layer;
+    markLayerModified(stack_id, layer.id);
+}
+
+void MultiLayerEngine::markLayerModified(const std::string& stack_id, const std::string& layer_id) {
+    StackCache& cache = stackCache(stack_id);
+    auto position = cache.position.find(layer_id);
+    if (position == cache.position.end()) {
+        throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION, "Layer not found: " + layer_id, "LAYER_NOT_FOUND"));
+    }
+    cache.dirty.insert(position->second);
+    if (position->second + 1 < cache.terms.size()) {
+        cache.dirty.insert(position->second + 1);
+    }
+}
+
+StackMetrics MultiLayerEngine::getStackMetrics(const std::string& stack_id) {
+    auto& stack = getStack(stack_id);
+    StackCache& cache = stackCache(stack_id);
+    refreshStackCache(stack, cache);
+    
+    const StackMetrics metrics = metricsFromTotals(cache.totals);
+    stack.total_stress = metrics.stress;
+    stack.overall_uniformity = metrics.uniformity;
+    return metrics;
+}
+
+MultiLayerEngine::StackCache& MultiLayerEngine::stackCache(const std::string& stack_id) {
+    auto it = stack_caches_.find(stack_id);
+    if (it != stack_caches_.end()) {
+        return it->second;
+    }
+    // First use: every layer starts underived, contributing nothing
+    const auto& stack = getStack(stack_id);
+    StackCache& cache = stack_caches_[stack_id];
+    cache.terms.assign(stack.layers.size(), LayerTerms());
+    for (size_t i = 0; i < stack.layers.size(); ++i) {
+        cache.dirty.insert(i);
+    }
+    indexStackCache(stack, cache);
+    return cache;
+}
+
+void MultiLayerEngine::indexStackCache(const LayerStack& stack, StackCache& cache) const {
+    cache.position.clear();
+    cache.interface_below.clear();
+    cache.dependents.clear();
+    for (size_t i = 0; i < stack.layers.size(); ++i) {
+        cache.position[stack.layers[i].id] = i;
+        for (const auto& dependency : stack.layers[i].dependencies) {
+            cache.dependents[dependency].push_back(stack.layers[i].id);
+        }
+    }
+    for (size_t i = 0; i < stack.interfaces.size(); ++i) {
+        cache.interface_below[stack.interfaces[i].upper_layer_id] = i;
+    }
+}
+
+void MultiLayerEngine::refreshStackCache(const LayerStack& stack, StackCache& cache) const {
+    while (!cache.dirty.empty()) {
+        const size_t index = *cache.dirty.begin();
+        cache.dirty.erase(cache.dirty.begin());
+        
+        const auto& id = stack.layers[index].id;
+        auto below = cache.interface_below.find(id);
+        const LayerInterface* interface = below == cache.interface_below.end() ? nullptr
+                                                                                : &stack.interfaces[below->second];
+        const LayerTerms terms = MultiLayerUtils::deriveLayerTerms(stack, index, interface, cache.position, cache.terms);
+        LayerTerms& cached = cache.terms[index];
+        const bool flipped = terms.ready != cached.ready || (terms.thickness > 0) != (cached.thickness > 0);
+        accumulate(cache.totals, cached, -1.0);
+        accumulate(cache.totals, terms, 1.0);
+        cached = terms;
+        
+        auto dependents = cache.dependents.find(id);
+        if (flipped && dependents != cache.dependents.end()) {
+            for (const auto& dependent : dependents->second) {
+                auto position = cache.position.find(dependent);
+                if (position != cache.position.end()) cache.dirty.insert(position->second);
+            }
+        }
+    }
+}
+
 bool MultiLayerEngine::processLayer(
     std::shared_ptr<WaferEnhanced> wafer,
     const std::string& stack_id,
@@ -81,6 +373,7 @@ bool MultiLayerEngine::processLayer(
         if (success) {
             // Update layer properties
             updateLayerFromProcess(*layer_it, process_type, parameters);
+            markLayerModified(stack_id, layer_id);
             
             // Calculate interface effects if enabled
             if (enable_interface_effects_) {
@@ -166,32 +459,12 @@ bool MultiLayerEngine::processStack(
 }
 
 void MultiLayerEngine::calculateStackStress(const std::string& stack_id) {
-    auto& stack = getStack(stack_id);
-    
-    double total_stress = 0.0;
-    double total_thickness = 0.0;
-    
-    for (const auto& layer : stack.layers) {
-        // Calculate layer contribution to total stress
-        double layer_contribution = layer.stress * layer.actual_thickness;
-        total_stress += layer_contribution;
-        total_thickness += layer.actual_thickness;
-    }
-    
-    // Calculate average stress
-    if (total_thickness > 0) {
-        stack.total_stress = total_stress / total_thickness;
-    }
-    
-    // Add interface stress contributions
-    for (const auto& interface : stack.interfaces) {
-        // Simplified interface stress model
-        double interface_stress = interface.defect_density * 1e-6; // Convert to MPa
-        stack.total_stress += interface_stress;
-    }
+    // Thickness-weighted layer stress plus interface stress, re-deriving
+    // only layers changed since the last query
+    const StackMetrics metrics = getStackMetrics(stack_id);
     
     SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::ADVANCED,
-                      "Stack stress calculated: " + std::to_string(stack.total_stress) + " MPa",
+                      "Stack stress calculated: " + std::to_string(metrics.stress) + " MPa",
                       "MultiLayerEngine");
 }
 
@@ -202,7 +475,7 @@ void MultiLayerEngine::propagateStressEffects(
     auto& stack = getStack(stack_id);
     
     // Create stress field based on stack stress
-    auto grid = wafer->getGrid();
+    const auto& grid = wafer->getGrid();
     int rows = grid.rows();
     int cols = grid.cols();
     
@@ -268,6 +541,157 @@ OptimizationResults MultiLayerEngine::optimizeStack(
     return results;
 }
 
+StackDesignResult MultiLayerEngine::designStack(
+    const StackDesignSpace& space,
+    OptimizationObjective objective) const {
+    
+    SEMIPRO_PERF_TIMER("stack_design", "MultiLayerEngine");
+    
+    const int count = static_cast<int>(space.candidates.size());
+    const size_t min_layers = static_cast<size_t>(std::max(space.min_layers, 0));
+    const size_t max_layers = static_cast<size_t>(std::max(space.max_layers, 0));
+    CandidateRange range;
+    for (const auto& candidate : space.candidates) {
+        if (candidate.actual_thickness > 0) {
+            range.stress_min = range.any ? std::min(range.stress_min, candidate.stress) : candidate.stress;
+            range.stress_max = range.any ? std::max(range.stress_max, candidate.stress) : candidate.stress;
+            range.uniformity_max = range.any ? std::max(range.uniformity_max, candidate.uniformity) : candidate.uniformity;
+            range.any = true;
+        }
+    }
+    
+    std::mutex best_mutex;
+    std::atomic<double> best_value(-std::numeric_limits<double>::infinity());
+    std::vector<int> best_choices;
+    bool found = false;
+    std::atomic<size_t> evaluated(0), pruned(0);
+    
+    auto record = [&](double value, const std::vector<int>& choices) {
+        std::lock_guard<std::mutex> lock(best_mutex);
+        if (!found || value > best_value.load() || (value == best_value.load() && choices < best_choices)) {
+            found = true;
+            best_choices = choices;
+            best_value.store(value);
+        }
+    };
+    // Whether no strict extension of the prefix can replace the best: its
+    // bound is lower, or equal with every extension ordering after it
+    auto beaten = [&](double bound, const std::vector<int>& prefix) {
+        const double best = best_value.load(std::memory_order_relaxed);
+        if (bound != best) {
+            return bound < best;
+        }
+        std::lock_guard<std::mutex> lock(best_mutex);
+        const size_t shared = std::min(prefix.size(), best_choices.size());
+        return std::lexicographical_compare(best_choices.begin(), best_choices.begin() + shared,
+                                            prefix.begin(), prefix.end()) ||
+               best_choices == prefix;
+    };
+    
+    // Subtrees down to split_depth run as tasks, about four per thread
+    TaskScheduler& scheduler = TaskScheduler::getInstance();
+    size_t split_depth = 0;
+    for (double subtrees = 1.0; count > 1 && subtrees < 4.0 * scheduler.threadCount() && split_depth < max_layers;
+         subtrees *= count) {
+        ++split_depth;
+    }
+    
+    std::function<void(DesignEvaluator&, std::vector<int>&)> explore =
+        [&](DesignEvaluator& evaluator, std::vector<int>& prefix) {
+        evaluated.fetch_add(1, std::memory_order_relaxed);
+        const StackMetrics metrics = evaluator.metrics();
+        if (prefix.size() >= min_layers) {
+            record(designValue(metrics, objective), prefix);
+        }
+        if (prefix.size() >= max_layers) {
+            return;
+        }
+        if (beaten(designBound(metrics, objective, range), prefix)) {
+            pruned.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        
+        std::vector<std::future<void>> subtrees;
+        for (int c = 0; c < count; ++c) {
+            if (!space.allow_repeats && std::find(prefix.begin(), prefix.end(), c) != prefix.end()) {
+                continue;
+            }
+            const AdvancedLayer& layer = space.candidates[c];
+            if (evaluator.size() > 0 && !MultiLayerUtils::areLayersCompatible(evaluator.top(), layer)) {
+                pruned.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (prefix.size() < split_depth) {
+                std::vector<int> child = prefix;
+                child.push_back(c);
+                subtrees.push_back(scheduler.submit([&, child]() mutable {
+                    DesignEvaluator subtree;
+                    for (const auto& base : space.base) subtree.push(base);
+                    for (int k : child) subtree.push(space.candidates[k]);
+                    explore(subtree, child);
+                }));
+                continue;
+            }
+            evaluator.push(layer);
+            prefix.push_back(c);
+            explore(evaluator, prefix);
+            prefix.pop_back();
+            evaluator.pop();
+        }
+        for (auto& subtree : subtrees) {
+            scheduler.wait(subtree);
+        }
+    };
+    
+    DesignEvaluator root;
+    for (const auto& base : space.base) {
+        root.push(base);
+    }
+    std::vector<int> prefix;
+    explore(root, prefix);
+    
+    StackDesignResult result;
+    result.found = found;
+    result.nodes_evaluated = evaluated.load();
+    result.nodes_pruned = pruned.load();
+    if (!found) {
+        return result;
+    }
+    
+    // The design as addLayerToStack would build it, repeated ids numbered
+    result.choices = best_choices;
+    result.objective_value = best_value.load();
+    result.stack.stack_id = "design";
+    std::vector<AdvancedLayer> layers = space.base;
+    for (int c : best_choices) {
+        layers.push_back(space.candidates[c]);
+    }
+    std::unordered_map<std::string, int> uses;
+    for (auto& layer : layers) {
+        const int use = ++uses[layer.id];
+        if (use > 1) {
+            layer.id += "_" + std::to_string(use);
+        }
+        if (!result.stack.layers.empty()) {
+            LayerInterface interface;
+            interface.lower_layer_id = result.stack.layers.back().id;
+            interface.upper_layer_id = layer.id;
+            result.stack.interfaces.push_back(interface);
+        }
+        result.stack.total_thickness += layer.target_thickness;
+        result.stack.layers.push_back(layer);
+    }
+    const StackMetrics metrics = MultiLayerUtils::calculateStackMetrics(result.stack);
+    result.stack.total_stress = metrics.stress;
+    result.stack.overall_uniformity = metrics.uniformity;
+    
+    SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                      "Stack design for " + objectiveToString(objective) + ": " +
+                      std::to_string(result.objective_value) + " after " +
+                      std::to_string(result.nodes_evaluated) + " partial stacks", "MultiLayerEngine");
+    return result;
+}
+
 std::unordered_map<std::string, double> MultiLayerEngine::analyzeStackQuality(
     const std::string& stack_id) const {
     
@@ -331,11 +755,32 @@ void MultiLayerEngine::initializeLayerTypeNames() {
     layer_type_names_[LayerType::PASSIVATION] = "Passivation";
 }
 
-void MultiLayerEngine::initializePhysicsEngines() {
-    oxidation_engine_ = std::make_unique<EnhancedOxidationPhysics>();
-    doping_engine_ = std::make_unique<EnhancedDopingPhysics>();
-    deposition_engine_ = std::make_unique<EnhancedDepositionPhysics>();
-    etching_engine_ = std::make_unique<EnhancedEtchingPhysics>();
+EnhancedOxidationPhysics& MultiLayerEngine::oxidationEngine() {
+    if (!oxidation_engine_) {
+        oxidation_engine_ = std::make_unique<EnhancedOxidationPhysics>();
+    }
+    return *oxidation_engine_;
+}
+
+EnhancedDopingPhysics& MultiLayerEngine::dopingEngine() {
+    if (!doping_engine_) {
+        doping_engine_ = std::make_unique<EnhancedDopingPhysics>();
+    }
+    return *doping_engine_;
+}
+
+EnhancedDepositionPhysics& MultiLayerEngine::depositionEngine() {
+    if (!deposition_engine_) {
+        deposition_engine_ = std::make_unique<EnhancedDepositionPhysics>();
+    }
+    return *deposition_engine_;
+}
+
+EnhancedEtchingPhysics& MultiLayerEngine::etchingEngine() {
+    if (!etching_engine_) {
+        etching_engine_ = std::make_unique<EnhancedEtchingPhysics>();
+    }
+    return *etching_engine_;
 }
 
 std::string MultiLayerEngine::layerTypeToString(LayerType type) const {
@@ -379,7 +824,7 @@ bool MultiLayerEngine::processOxidation(
     }
 
     // Run oxidation simulation
-    auto results = oxidation_engine_->simulateOxidation(wafer, conditions);
+    auto results = oxidationEngine().simulateOxidation(wafer, conditions);
 
     // Update layer properties
     layer.actual_thickness = results.final_thickness;
@@ -421,7 +866,7 @@ bool MultiLayerEngine::processDeposition(
     }
 
     // Run deposition simulation
-    auto results = deposition_engine_->simulateDeposition(wafer, conditions);
+    auto results = depositionEngine().simulateDeposition(wafer, conditions);
 
     // Update layer properties
     layer.actual_thickness = results.final_thickness;
@@ -465,7 +910,7 @@ bool MultiLayerEngine::processEtching(
     conditions.technique = EtchingTechnique::RIE;
 
     // Run etching simulation
-    auto results = etching_engine_->simulateEtching(wafer, conditions);
+    auto results = etchingEngine().simulateEtching(wafer, conditions);
 
     // Update layer properties (etching removes material)
     layer.actual_thickness -= results.final_depth;
@@ -499,7 +944,7 @@ bool MultiLayerEngine::processDoping(
     }
 
     // Run doping simulation
-    auto results = doping_engine_->simulateIonImplantation(wafer, conditions);
+    auto results = dopingEngine().simulateIonImplantation(wafer, conditions);
 
     // Update layer properties
     layer.properties["peak_concentration"] = results.peak_concentration;
@@ -530,6 +975,7 @@ void MultiLayerEngine::calculateInterfaceEffects(
             }
         }
     }
+    markLayerModified(stack_id, layer_id);
 }
 
 double MultiLayerEngine::calculateInterfaceRoughness(
@@ -631,6 +1077,9 @@ double MultiLayerEngine::calculateObjectiveValue(
             return 1e12 / (1.0 + total_defects);
         }
 
+        case OptimizationObjective::MAXIMIZE_YIELD:
+            return MultiLayerUtils::calculateReliabilityScore(stack);
+
         default:
             return 50.0; // Default score
     }
@@ -638,9 +1087,12 @@ double MultiLayerEngine::calculateObjectiveValue(
 
 void MultiLayerEngine::analyzeDependencies(const std::string& stack_id) {
     auto& stack = getStack(stack_id);
+    StackCache& cache = stackCache(stack_id);
 
     // Analyze layer dependencies
-    for (auto& layer : stack.layers) {
+    for (size_t i = 0; i < stack.layers.size(); ++i) {
+        auto& layer = stack.layers[i];
+        const std::vector<std::string> previous = std::move(layer.dependencies);
         layer.dependencies.clear();
 
         // Check for dependencies based on layer type
@@ -652,7 +1104,108 @@ void MultiLayerEngine::analyzeDependencies(const std::string& stack_id) {
                 }
             }
         }
+        if (layer.dependencies != previous) {
+            cache.dirty.insert(i);
+        }
+    }
+    indexStackCache(stack, cache);
+}
+
+LayerTerms MultiLayerUtils::deriveLayerTerms(const LayerStack& stack,
+                                             size_t index,
+                                             const LayerInterface* interface_below,
+                                             const std::unordered_map<std::string, size_t>& position,
+                                             const std::vector<LayerTerms>& terms_below) {
+    const AdvancedLayer& layer = stack.layers[index];
+    LayerTerms terms;
+    terms.thickness = layer.actual_thickness;
+    terms.stress_moment = layer.stress * layer.actual_thickness;
+    terms.uniformity_moment = layer.uniformity * layer.actual_thickness;
+    if (interface_below) {
+        terms.interface_defects = interface_below->defect_density;
+    }
+    
+    // 10 points per GPa of mismatch with the layer beneath, 5 per
+    // dependency missing, above, without thickness or not itself ready
+    if (index > 0) {
+        terms.reliability_penalty = 10.0 * std::abs(layer.stress - stack.layers[index - 1].stress) / 1000.0;
+    }
+    for (const auto& dependency : layer.dependencies) {
+        auto it = position.find(dependency);
+        const bool met = it != position.end() && it->second < index &&
+                         stack.layers[it->second].actual_thickness > 0 && terms_below[it->second].ready;
+        if (!met) {
+            terms.ready = false;
+            terms.reliability_penalty += 5.0;
+        }
+    }
+    return terms;
+}
+
+StackMetrics MultiLayerUtils::calculateStackMetrics(const LayerStack& stack) {
+    std::unordered_map<std::string, size_t> position;
+    std::unordered_map<std::string, const LayerInterface*> interface_below;
+    for (size_t i = 0; i < stack.layers.size(); ++i) {
+        position[stack.layers[i].id] = i;
     }
+    for (const auto& interface : stack.interfaces) {
+        interface_below[interface.upper_layer_id] = &interface;
+    }
+    
+    std::vector<LayerTerms> terms;
+    terms.reserve(stack.layers.size());
+    LayerTerms totals;
+    for (size_t i = 0; i < stack.layers.size(); ++i) {
+        auto below = interface_below.find(stack.layers[i].id);
+        terms.push_back(deriveLayerTerms(stack, i, below == interface_below.end() ? nullptr : below->second,
+                                         position, terms));
+        accumulate(totals, terms.back(), 1.0);
+    }
+    return metricsFromTotals(totals);
+}
+
+double MultiLayerUtils::calculateCompatibilityScore(const AdvancedLayer& layer1, const AdvancedLayer& layer2) {
+    // Falls off with stress mismatch, e-fold per GPa
+    double score = std::exp(-std::abs(layer1.stress - layer2.stress) / 1000.0);
+    
+    // Metal directly on silicon or a low-k dielectric spikes or diffuses
+    // in without a barrier; nothing forms on photoresist but a hard mask
+    auto is = [](const AdvancedLayer& layer, std::initializer_list<LayerType> types) {
+        return std::find(types.begin(), types.end(), layer.type) != types.end();
+    };
+    const auto silicon = {LayerType::SUBSTRATE, LayerType::EPITAXIAL, LayerType::POLYSILICON, LayerType::DIELECTRIC};
+    if ((is(layer1, {LayerType::METAL}) && is(layer2, silicon)) ||
+        (is(layer2, {LayerType::METAL}) && is(layer1, silicon))) {
+        score *= 0.2;
+    }
+    if (layer1.type == LayerType::PHOTORESIST && layer2.type != LayerType::HARD_MASK) {
+        score = 0.0;
+    }
+    return score;
+}
+
+bool MultiLayerUtils::areLayersCompatible(const AdvancedLayer& layer1, const AdvancedLayer& layer2) {
+    return calculateCompatibilityScore(layer1, layer2) >= 0.25;
+}
+
+double MultiLayerUtils::calculateStackThickness(const LayerStack& stack) {
+    return calculateStackMetrics(stack).thickness;
+}
+
+double MultiLayerUtils::calculateStackStress(const LayerStack& stack) {
+    return calculateStackMetrics(stack).stress;
+}
+
+double MultiLayerUtils::calculateStackUniformity(const LayerStack& stack) {
+    return calculateStackMetrics(stack).uniformity;
+}
+
+double MultiLayerUtils::calculateDefectDensity(const LayerStack& stack) {
+    return calculateStackMetrics(stack).defect_density;
+}
+
+double MultiLayerUtils::calculateReliabilityScore(const LayerStack& stack) {
+    return calculateStackMetrics(stack).reliability;
 }
 
 } // namespace SemiPRO
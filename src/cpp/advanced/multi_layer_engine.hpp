@@ -13,6 +13,7 @@
 #include <unordered_map>
 #include <functional>
 #include <cmath>
+#include <set>
 
 namespace SemiPRO {
 
@@ -124,6 +125,47 @@ struct OptimizationResults {
     OptimizationResults() : objective_value(0) {}
 };
 
+// Quantities derived from one layer and the interface beneath it, from
+// which the stack scores are sums
+struct LayerTerms {
+    double thickness = 0.0;           // Actual thickness (μm)
+    double stress_moment = 0.0;       // Stress × thickness (MPa·μm)
+    double uniformity_moment = 0.0;   // Uniformity × thickness (%·μm)
+    double interface_defects = 0.0;   // Defect density of the interface beneath (cm⁻²)
+    double reliability_penalty = 0.0; // Stress mismatch with the layer beneath and unmet dependencies
+    bool ready = true;                // Every dependency lies beneath, has thickness and is ready
+};
+
+// Stack-level scores
+struct StackMetrics {
+    double thickness = 0.0;           // Total actual thickness (μm)
+    double stress = 0.0;              // Thickness-weighted layer stress plus interface stress (MPa)
+    double uniformity = 100.0;        // Thickness-weighted uniformity (%)
+    double defect_density = 0.0;      // Summed interface defect density (cm⁻²)
+    double reliability = 100.0;       // 100 less the layers' reliability penalties
+};
+
+// Candidate stacks for designStack: the base layers, then min_layers to
+// max_layers layers drawn in any order from the candidates, each one a
+// choice of material, type and thickness
+struct StackDesignSpace {
+    std::vector<AdvancedLayer> base;       // Fixed bottom layers, e.g. the substrate
+    std::vector<AdvancedLayer> candidates; // Options for each layer above the base
+    int min_layers = 1;
+    int max_layers = 3;
+    bool allow_repeats = true;             // A candidate may be used more than once
+};
+
+// Best design found by designStack
+struct StackDesignResult {
+    LayerStack stack;                      // Base and chosen layers, with interfaces
+    std::vector<int> choices;              // Candidate index of each layer above the base
+    double objective_value = 0.0;
+    bool found = false;                    // Whether any compatible stack exists
+    size_t nodes_evaluated = 0;            // Partial stacks evaluated
+    size_t nodes_pruned = 0;               // Partial stacks cut by compatibility or bound
+};
+
 // Multi-layer processing engine
 class MultiLayerEngine {
 private:
@@ -131,7 +173,7 @@ private:
     std::unordered_map<std::string, ProcessSequence> sequences_;
     std::unordered_map<LayerType, std::string> layer_type_names_;
     
-    // Physics engines
+    // Physics engines, each created the first time a layer needs it
     std::unique_ptr<EnhancedOxidationPhysics> oxidation_engine_;
     std::unique_ptr<EnhancedDopingPhysics> doping_engine_;
     std::unique_ptr<EnhancedDepositionPhysics> deposition_engine_;
@@ -144,6 +186,21 @@ private:
     bool enable_optimization_ = true;
     double convergence_tolerance_ = 1e-6;
     
+    // Per-stack LayerTerms kept current incrementally. A change marks the
+    // layer and the one above it (whose interface and mismatch terms read
+    // it) dirty; a query re-derives only dirty layers, bottom up, adjusting
+    // the running totals by the difference, and marks a layer's dependents
+    // when its readiness or presence (nonzero thickness) flips.
+    struct StackCache {
+        std::vector<LayerTerms> terms;                               // In stack order
+        LayerTerms totals;                                           // Summed terms
+        std::unordered_map<std::string, size_t> position;            // Layer index by id
+        std::unordered_map<std::string, size_t> interface_below;     // Interface index by upper layer id
+        std::unordered_map<std::string, std::vector<std::string>> dependents; // Reverse dependencies
+        std::set<size_t> dirty;
+    };
+    std::unordered_map<std::string, StackCache> stack_caches_;
+    
 public:
     MultiLayerEngine();
     ~MultiLayerEngine() = default;
@@ -152,8 +209,19 @@ public:
     void createStack(const std::string& stack_id);
     void addLayerToStack(const std::string& stack_id, const AdvancedLayer& layer);
     void removeLayerFromStack(const std::string& stack_id, const std::string& layer_id);
+    // Replaces the stack's layer with layer.id
+    void updateLayer(const std::string& stack_id, const AdvancedLayer& layer);
     LayerStack& getStack(const std::string& stack_id);
     const LayerStack& getStack(const std::string& stack_id) const;
+    // For edits made through getStack(): the layer is re-derived at the
+    // next query, with whatever depends on it. Edits to its dependencies
+    // go through updateLayer or analyzeDependencies.
+    void markLayerModified(const std::string& stack_id, const std::string& layer_id);
+    
+    // Scores of the stack, re-deriving only the layers changed since the
+    // last query; also stores them in the stack's total_stress and
+    // overall_uniformity
+    StackMetrics getStackMetrics(const std::string& stack_id);
     
     // Layer processing
     bool processLayer(
@@ -220,6 +288,18 @@ public:
         OptimizationObjective objective
     );
     
+    // Branch-and-bound search for the stack that maximizes the objective's
+    // value (as in optimizeStack). Subtrees with adjacent layers that are
+    // not areLayersCompatible are cut, as are those whose optimistic bound
+    // cannot beat the best stack so far; ties go to the lexicographically
+    // first choices, so the result does not depend on scheduling. Each
+    // partial stack adds one layer's LayerTerms to its parent's, and
+    // subtrees near the root run as tasks on the work-stealing scheduler.
+    StackDesignResult designStack(
+        const StackDesignSpace& space,
+        OptimizationObjective objective
+    ) const;
+    
     // Quality analysis
     std::unordered_map<std::string, double> analyzeStackQuality(
         const std::string& stack_id
@@ -282,13 +362,22 @@ private:
         const std::unordered_map<std::string, double>& parameters
     );
 
+    // Stack cache maintenance
+    StackCache& stackCache(const std::string& stack_id);
+    // Positions, interfaces and reverse dependencies after a structural change
+    void indexStackCache(const LayerStack& stack, StackCache& cache) const;
+    void refreshStackCache(const LayerStack& stack, StackCache& cache) const;
+    
     // Interface analysis
     void calculateInterfaceEffects(
         const std::string& stack_id,
         const std::string& layer_id
     );
     void initializeLayerTypeNames();
-    void initializePhysicsEngines();
+    EnhancedOxidationPhysics& oxidationEngine();
+    EnhancedDopingPhysics& dopingEngine();
+    EnhancedDepositionPhysics& depositionEngine();
+    EnhancedEtchingPhysics& etchingEngine();
     
     // Optimization algorithms
     OptimizationResults geneticAlgorithmOptimization(
@@ -329,12 +418,20 @@ private:
 
 // Utility functions for multi-layer analysis
 namespace MultiLayerUtils {
-    // Stack analysis utilities
+    // Terms of layer `index`, given the terms of the layers beneath it
+    LayerTerms deriveLayerTerms(const LayerStack& stack,
+                                size_t index,
+                                const LayerInterface* interface_below,
+                                const std::unordered_map<std::string, size_t>& position,
+                                const std::vector<LayerTerms>& terms_below);
+    
+    // Stack analysis utilities, each deriving every layer afresh
+    StackMetrics calculateStackMetrics(const LayerStack& stack);
     double calculateStackThickness(const LayerStack& stack);
     double calculateStackStress(const LayerStack& stack);
     double calculateStackUniformity(const LayerStack& stack);
     
-    // Layer compatibility analysis
+    // Layer compatibility analysis, for layer2 formed on layer1
     bool areLayersCompatible(const AdvancedLayer& layer1, const AdvancedLayer& layer2);
     double calculateCompatibilityScore(const AdvancedLayer& layer1, const AdvancedLayer& layer2);
     
@@ -0,0 +1,140 @@
+#include "pareto_sorting.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace SemiPRO {
+
+namespace {
+
+std::vector<double> sanitized(std::vector<double> point) {
+    for (double& x : point) {
+        if (std::isnan(x)) {
+            x = std::numeric_limits<double>::infinity();
+        }
+    }
+    return point;
+}
+
+} // namespace
+
+bool dominates(const std::vector<double>& a, const std::vector<double>& b) {
+    bool better = false;
+    for (size_t d = 0; d < a.size(); ++d) {
+        if (a[d] > b[d]) return false;
+        better = better || a[d] < b[d];
+    }
+    return better;
+}
+
+std::vector<int> nonDominatedRanks(const std::vector<std::vector<double>>& points) {
+    const size_t n = points.size();
+    std::vector<std::vector<double>> clean;
+    clean.reserve(n);
+    for (const auto& point : points) {
+        clean.push_back(sanitized(point));
+    }
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return clean[a] < clean[b]; });
+
+    // A point dominated by a member of a front is dominated by a member of
+    // every earlier front, so the fronts that dominate it come first
+    const bool two_objectives = n > 0 && clean.front().size() == 2;
+    std::vector<std::vector<size_t>> fronts;
+    std::vector<int> ranks(n, 0);
+    auto dominated_in = [&](const std::vector<size_t>& front, size_t i) {
+        if (two_objectives) {
+            return dominates(clean[front.back()], clean[i]);
+        }
+        for (auto it = front.rbegin(); it != front.rend(); ++it) {
+            if (dominates(clean[*it], clean[i])) return true;
+        }
+        return false;
+    };
+    for (size_t i : order) {
+        size_t low = 0, high = fronts.size();
+        while (low < high) {
+            const size_t mid = (low + high) / 2;
+            if (dominated_in(fronts[mid], i)) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (low == fronts.size()) {
+            fronts.emplace_back();
+        }
+        fronts[low].push_back(i);
+        ranks[i] = static_cast<int>(low);
+    }
+    return ranks;
+}
+
+std::vector<double> crowdingDistances(const std::vector<std::vector<double>>& points,
+                                      const std::vector<size_t>& members) {
+    const size_t n = members.size();
+    std::vector<double> distance(n, 0.0);
+    if (n < 3) {
+        std::fill(distance.begin(), distance.end(), std::numeric_limits<double>::infinity());
+        return distance;
+    }
+    std::vector<size_t> order(n);
+    for (size_t d = 0; d < points[members.front()].size(); ++d) {
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return points[members[a]][d] < points[members[b]][d];
+        });
+        distance[order.front()] = distance[order.back()] = std::numeric_limits<double>::infinity();
+        const double range = points[members[order.back()]][d] - points[members[order.front()]][d];
+        if (!(range > 0.0) || !std::isfinite(range)) {
+            continue;
+        }
+        for (size_t k = 1; k + 1 < n; ++k) {
+            distance[order[k]] += (points[members[order[k + 1]]][d] - points[members[order[k - 1]]][d]) / range;
+        }
+    }
+    return distance;
+}
+
+bool ParetoArchive::insert(const std::vector<double>& point, size_t id) {
+    Entry entry{sanitized(point), id};
+    const auto position = std::lower_bound(entries_.begin(), entries_.end(), entry,
+        [](const Entry& a, const Entry& b) { return a.point < b.point; });
+    if (position != entries_.end() && position->point == entry.point) {
+        return false;
+    }
+    const auto index = position - entries_.begin();
+
+    if (entry.point.size() == 2) {
+        if (index > 0 && dominates(entries_[index - 1].point, entry.point)) {
+            return false;
+        }
+        auto last = position;
+        while (last != entries_.end() && dominates(entry.point, last->point)) {
+            ++last;
+        }
+        entries_.erase(position, last);
+    } else {
+        for (auto it = entries_.begin(); it != position; ++it) {
+            if (dominates(it->point, entry.point)) return false;
+        }
+        entries_.erase(std::remove_if(position, entries_.end(),
+                                      [&](const Entry& other) { return dominates(entry.point, other.point); }),
+                       entries_.end());
+    }
+    entries_.insert(entries_.begin() + index, std::move(entry));
+    return true;
+}
+
+std::vector<size_t> ParetoArchive::ids() const {
+    std::vector<size_t> result;
+    result.reserve(entries_.size());
+    for (const auto& entry : entries_) {
+        result.push_back(entry.id);
+    }
+    return result;
+}
+
+} // namespace SemiPRO
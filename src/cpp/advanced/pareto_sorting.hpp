@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace SemiPRO {
+
+/**
+ * Non-Dominated Sorting
+ * Pareto fronts of points that minimize every coordinate, by efficient
+ * non-dominated sorting with binary search (ENS-BS). Points are taken in
+ * lexicographic order, so none can be dominated by a later one, and each
+ * joins the first front, found by binary search, that has no member
+ * dominating it. Members are checked newest first: with two objectives the
+ * newest member decides, for O(n log n) in all, and with more the checks
+ * stay far below the O(m n^2) of comparing all pairs on typical fronts.
+ */
+
+// Whether a is no worse than b in every coordinate and better in one
+bool dominates(const std::vector<double>& a, const std::vector<double>& b);
+
+// Front of each point, 0 for the non-dominated; equal points share a
+// front. NaN coordinates count as +infinity.
+std::vector<int> nonDominatedRanks(const std::vector<std::vector<double>>& points);
+
+// NSGA-II crowding distance of each of `members`, which should make up one
+// front: the normalized side lengths of the box between each member's
+// neighbours, summed over the coordinates; infinite at the extremes
+std::vector<double> crowdingDistances(const std::vector<std::vector<double>>& points,
+                                      const std::vector<size_t>& members);
+
+/**
+ * Pareto Archive
+ * The non-dominated points of everything inserted, kept in lexicographic
+ * order: a point's dominators can only precede it and the points it
+ * dominates only follow it, so an insertion scans each side once. With
+ * two objectives the archive is a staircase, its predecessor alone can
+ * dominate it and what it dominates is the run that follows, so an
+ * insertion costs O(log n) plus the points removed.
+ */
+class ParetoArchive {
+public:
+    // Adds the point unless an archived one dominates or equals it, and
+    // drops the archived points it dominates; true if it was added
+    bool insert(const std::vector<double>& point, size_t id);
+    void clear() { entries_.clear(); }
+
+    size_t size() const { return entries_.size(); }
+    // Ids of the archived points, in lexicographic order of the points
+    std::vector<size_t> ids() const;
+
+private:
+    struct Entry {
+        std::vector<double> point;
+        size_t id;
+    };
+
+    std::vector<Entry> entries_;
+};
+
+} // namespace SemiPRO
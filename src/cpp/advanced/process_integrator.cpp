@@ -1,11 +1,95 @@
 #include "process_integrator.hpp"
+#include "../core/task_scheduler.hpp"
 #include <algorithm>
 #include <cmath>
 #include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
 #include <numeric>
+#include <set>
+#include <unordered_set>
 
 namespace SemiPRO {
 
+namespace {
+
+// Ordering constraints between the steps of a recipe
+struct RecipeGraph {
+    std::vector<std::vector<size_t>> successors;
+    std::vector<int> predecessor_count;
+    // Longest estimated time from the step to the end of the recipe,
+    // including its own, and the next step on that path (npos at the end)
+    std::vector<double> path_time;
+    std::vector<size_t> path_next;
+};
+
+// Prerequisites, dependencies and any extra (source, target) pairs become
+// edges; ids naming no step are ignored. Steps on a cycle never become
+// ready and count only their own time.
+RecipeGraph buildRecipeGraph(const ProcessRecipe& recipe,
+                             const std::vector<std::pair<std::string, std::string>>& extra_edges = {}) {
+    const size_t n = recipe.steps.size();
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < n; ++i) {
+        index.emplace(recipe.steps[i].step_id, i);
+    }
+
+    std::set<std::pair<size_t, size_t>> edges;
+    auto add = [&](const std::string& from, size_t to) {
+        auto it = index.find(from);
+        if (it != index.end() && it->second != to) {
+            edges.emplace(it->second, to);
+        }
+    };
+    for (size_t i = 0; i < n; ++i) {
+        for (const auto& id : recipe.steps[i].prerequisites) add(id, i);
+        for (const auto& id : recipe.steps[i].dependencies) add(id, i);
+    }
+    for (const auto& edge : extra_edges) {
+        auto it = index.find(edge.second);
+        if (it != index.end()) add(edge.first, it->second);
+    }
+
+    RecipeGraph graph;
+    graph.successors.resize(n);
+    graph.predecessor_count.assign(n, 0);
+    for (const auto& edge : edges) {
+        graph.successors[edge.first].push_back(edge.second);
+        graph.predecessor_count[edge.second]++;
+    }
+
+    std::vector<size_t> order;
+    std::vector<int> remaining = graph.predecessor_count;
+    for (size_t i = 0; i < n; ++i) {
+        if (remaining[i] == 0) order.push_back(i);
+    }
+    for (size_t k = 0; k < order.size(); ++k) {
+        for (size_t next : graph.successors[order[k]]) {
+            if (--remaining[next] == 0) order.push_back(next);
+        }
+    }
+
+    graph.path_next.assign(n, std::numeric_limits<size_t>::max());
+    graph.path_time.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        graph.path_time[i] = recipe.steps[i].estimated_time;
+    }
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        double longest = 0.0;
+        for (size_t next : graph.successors[*it]) {
+            if (graph.path_time[next] > longest) {
+                longest = graph.path_time[next];
+                graph.path_next[*it] = next;
+            }
+        }
+        graph.path_time[*it] += longest;
+    }
+    return graph;
+}
+
+} // namespace
+
 ProcessIntegrator::ProcessIntegrator() {
     initializeIntegrator();
     
@@ -223,14 +307,183 @@ ProcessIntegrationResults ProcessIntegrator::executeSequentialFlow(
 ProcessIntegrationResults ProcessIntegrator::executeParallelFlow(
     ProcessExecutionContext& context) {
     
+    if (!enable_parallel_execution_ || max_concurrent_processes_ <= 1) {
+        return executeSequentialFlow(context);
+    }
+    
     ProcessIntegrationResults results;
+    results.overall_status = ProcessStatus::RUNNING;
+    auto& steps = context.recipe.steps;
+    const size_t limit = static_cast<size_t>(max_concurrent_processes_);
+    
+    // Cross-process targets wait for their source, which sets their inputs
+    std::vector<std::pair<std::string, std::string>> transfers;
+    for (const auto& dependency : cross_dependencies_) {
+        transfers.emplace_back(dependency.second.source_process, dependency.second.target_process);
+    }
+    const RecipeGraph graph = buildRecipeGraph(context.recipe, transfers);
     
     SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
-                      "Parallel flow execution not fully implemented - using sequential flow",
+                      "Executing parallel process flow with " + std::to_string(steps.size()) +
+                      " steps on up to " + std::to_string(limit) + " workers",
                       "ProcessIntegrator");
     
-    // For now, fall back to sequential execution
-    return executeSequentialFlow(context);
+    // Longest remaining critical path first, then priority, then recipe order
+    auto runs_before = [&](size_t a, size_t b) {
+        if (graph.path_time[a] != graph.path_time[b]) return graph.path_time[a] > graph.path_time[b];
+        if (steps[a].priority != steps[b].priority) return steps[a].priority > steps[b].priority;
+        return a < b;
+    };
+    std::set<size_t, decltype(runs_before)> ready(runs_before);
+    std::vector<int> waiting = graph.predecessor_count;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        if (waiting[i] == 0) ready.insert(i);
+    }
+    auto release = [&](size_t i) {
+        for (size_t next : graph.successors[i]) {
+            if (--waiting[next] == 0) ready.insert(next);
+        }
+    };
+    
+    // Workers only run the physics; the step and context bookkeeping stays
+    // on this thread
+    struct Completion {
+        size_t index;
+        bool success;
+        double minutes;
+    };
+    struct Mailbox {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::vector<Completion> completions;
+    };
+    auto mailbox = std::make_shared<Mailbox>();
+    auto& scheduler = TaskScheduler::getInstance();
+    
+    const auto flow_start = std::chrono::steady_clock::now();
+    size_t in_flight = 0;
+    bool failed = false;
+    
+    while (true) {
+        while (!failed && in_flight < limit && !ready.empty()) {
+            const size_t i = *ready.begin();
+            ready.erase(ready.begin());
+            ProcessStep& step = steps[i];
+            
+            if (!validateStepPrerequisites(context, step)) {
+                SEMIPRO_LOG_MODULE(LogLevel::WARNING, LogCategory::ADVANCED,
+                                  "Step prerequisites not met: " + step.step_id,
+                                  "ProcessIntegrator");
+                step.status = ProcessStatus::SKIPPED;
+                release(i);
+                continue;
+            }
+            if (enable_thermal_budget_tracking_ && !checkThermalBudgetLimit(context, step)) {
+                SEMIPRO_LOG_MODULE(LogLevel::WARNING, LogCategory::ADVANCED,
+                                  "Thermal budget limit exceeded for step: " + step.step_id,
+                                  "ProcessIntegrator");
+                results.warnings.push_back("Thermal budget limit exceeded for step: " + step.step_id);
+            }
+            
+            step.status = ProcessStatus::RUNNING;
+            ++in_flight;
+            scheduler.submit([this, mailbox, i, wafer = context.wafer, type = step.process_type,
+                              parameters = mergeStepParameters(context, step)]() {
+                auto start = std::chrono::steady_clock::now();
+                bool success = executePhysicsProcess(wafer, type, parameters);
+                double minutes = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 60.0;
+                {
+                    std::lock_guard<std::mutex> lock(mailbox->mutex);
+                    mailbox->completions.push_back({i, success, minutes});
+                }
+                mailbox->done.notify_one();
+            });
+        }
+        if (in_flight == 0) {
+            break;
+        }
+        
+        // Helps the pool while waiting, so a single worker cannot stall
+        std::vector<Completion> completions;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mailbox->mutex);
+                completions.swap(mailbox->completions);
+            }
+            if (!completions.empty()) break;
+            if (!scheduler.runPendingTask()) {
+                std::unique_lock<std::mutex> lock(mailbox->mutex);
+                mailbox->done.wait_for(lock, std::chrono::microseconds(100),
+                                       [&] { return !mailbox->completions.empty(); });
+            }
+        }
+        
+        for (const auto& completion : completions) {
+            --in_flight;
+            ProcessStep& step = steps[completion.index];
+            step.actual_time = completion.minutes;
+            
+            if (completion.success) {
+                step.status = ProcessStatus::COMPLETED;
+                context.completed_steps.push_back(step.step_id);
+                recordStepSuccess(context, step);
+                results.executed_steps.push_back(step);
+                if (enable_dependency_checking_) {
+                    propagateCrossProcessDependencies(context, step);
+                }
+                SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::ADVANCED,
+                                  "Step completed: " + step.step_id +
+                                  " in " + std::to_string(step.actual_time) + " minutes",
+                                  "ProcessIntegrator");
+            } else {
+                step.status = ProcessStatus::FAILED;
+                context.failed_steps.push_back(step.step_id);
+                SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::ADVANCED,
+                                  "Step failed: " + step.step_id,
+                                  "ProcessIntegrator");
+                // As in the sequential flow, running steps finish but no
+                // new ones start once a step cannot be recovered
+                if (!attemptProcessRecovery(context, step)) {
+                    results.overall_status = ProcessStatus::FAILED;
+                    failed = true;
+                }
+            }
+            release(completion.index);
+        }
+    }
+    
+    if (results.overall_status != ProcessStatus::FAILED) {
+        bool all_completed = std::all_of(steps.begin(), steps.end(), [](const ProcessStep& step) {
+            return step.status == ProcessStatus::COMPLETED || step.status == ProcessStatus::SKIPPED;
+        });
+        results.overall_status = all_completed ? ProcessStatus::COMPLETED : ProcessStatus::FAILED;
+    }
+    
+    // Ideal: estimated work over the longer of the critical path and the
+    // work spread over all workers. Achieved: measured step time over the
+    // flow's wall time.
+    double estimated_work = 0.0;
+    double measured_work = 0.0;
+    for (const auto& step : steps) {
+        estimated_work += step.estimated_time;
+        measured_work += step.actual_time;
+    }
+    const double critical_path = graph.path_time.empty() ? 0.0 :
+        *std::max_element(graph.path_time.begin(), graph.path_time.end());
+    const double ideal_span = std::max(critical_path, estimated_work / limit);
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - flow_start).count() / 60.0;
+    results.final_results["critical_path_time"] = critical_path;
+    results.final_results["ideal_speedup"] = ideal_span > 0.0 ? estimated_work / ideal_span : 1.0;
+    results.final_results["achieved_speedup"] = wall > 0.0 ? measured_work / wall : 1.0;
+    
+    SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                      "Parallel flow execution completed with status: " +
+                      statusToString(results.overall_status) +
+                      ", speedup " + std::to_string(results.final_results["achieved_speedup"]) +
+                      " (ideal " + std::to_string(results.final_results["ideal_speedup"]) + ")",
+                      "ProcessIntegrator");
+    
+    return results;
 }
 
 ProcessIntegrationResults ProcessIntegrator::executeAdaptiveFlow(
@@ -256,23 +509,12 @@ bool ProcessIntegrator::executeProcessStep(
                           " (type: " + step.process_type + ")",
                           "ProcessIntegrator");
         
-        // Merge step parameters with runtime parameters
-        auto merged_parameters = step.parameters;
-        for (const auto& runtime_param : context.runtime_parameters) {
-            merged_parameters[runtime_param.first] = runtime_param.second;
-        }
-        
         // Execute the physics process
-        bool success = executePhysicsProcess(context.wafer, step.process_type, merged_parameters);
+        bool success = executePhysicsProcess(context.wafer, step.process_type,
+                                             mergeStepParameters(context, step));
         
         if (success) {
-            // Store results (simplified)
-            step.results["execution_time"] = step.actual_time;
-            step.results["success"] = 1.0;
-            
-            // Update context measurements
-            context.measured_results[step.step_id + "_time"] = step.actual_time;
-            context.measured_results[step.step_id + "_success"] = 1.0;
+            recordStepSuccess(context, step);
         }
         
         return success;
@@ -286,6 +528,31 @@ bool ProcessIntegrator::executeProcessStep(
     }
 }
 
+std::unordered_map<std::string, double> ProcessIntegrator::mergeStepParameters(
+    const ProcessExecutionContext& context,
+    const ProcessStep& step) const {
+    
+    // Runtime parameters override the step's own
+    auto merged_parameters = step.parameters;
+    for (const auto& runtime_param : context.runtime_parameters) {
+        merged_parameters[runtime_param.first] = runtime_param.second;
+    }
+    return merged_parameters;
+}
+
+void ProcessIntegrator::recordStepSuccess(
+    ProcessExecutionContext& context,
+    ProcessStep& step) {
+    
+    // Store results (simplified)
+    step.results["execution_time"] = step.actual_time;
+    step.results["success"] = 1.0;
+    
+    // Update context measurements
+    context.measured_results[step.step_id + "_time"] = step.actual_time;
+    context.measured_results[step.step_id + "_success"] = 1.0;
+}
+
 bool ProcessIntegrator::executePhysicsProcess(
     std::shared_ptr<WaferEnhanced> wafer,
     const std::string& process_type,
@@ -742,6 +1009,10 @@ bool ProcessIntegrator::hasCyclicDependencies(const ProcessRecipe& recipe) const
     return false;
 }
 
+void ProcessIntegrator::setMaxConcurrentProcesses(int max_processes) {
+    max_concurrent_processes_ = std::max(1, max_processes);
+}
+
 std::vector<std::string> ProcessIntegrator::getDiagnostics() const {
     std::vector<std::string> diagnostics;
 
@@ -776,7 +1047,7 @@ namespace ProcessIntegrationUtils {
         recipe.recipe_id = "cmos_basic";
         recipe.recipe_name = "Basic CMOS Process";
         recipe.description = "Standard CMOS fabrication sequence";
-        recipe.flow_type = ProcessFlowType::SEQUENTIAL;
+        recipe.flow_type = ProcessFlowType::PARALLEL; // Ordered by prerequisites
 
         // Gate oxidation
         ProcessStep gate_oxide;
@@ -826,6 +1097,21 @@ namespace ProcessIntegrationUtils {
         return recipe;
     }
 
+    std::vector<std::string> analyzeCriticalPath(const ProcessRecipe& recipe) {
+        std::vector<std::string> path;
+        if (recipe.steps.empty()) {
+            return path;
+        }
+        
+        const RecipeGraph graph = buildRecipeGraph(recipe);
+        size_t step = std::max_element(graph.path_time.begin(), graph.path_time.end()) - graph.path_time.begin();
+        while (step != std::numeric_limits<size_t>::max()) {
+            path.push_back(recipe.steps[step].step_id);
+            step = graph.path_next[step];
+        }
+        return path;
+    }
+
     double calculateRecipeComplexity(const ProcessRecipe& recipe) {
         double complexity = 0.0;
 
@@ -185,6 +185,11 @@ public:
         ProcessExecutionContext& context
     );
     
+    // Runs steps as soon as their prerequisites, dependencies and
+    // cross-process sources are done, up to max_concurrent_processes at a
+    // time, longest remaining critical path first. Reports
+    // "critical_path_time", "ideal_speedup" and "achieved_speedup" in
+    // final_results.
     ProcessIntegrationResults executeParallelFlow(
         ProcessExecutionContext& context
     );
@@ -291,6 +296,16 @@ private:
     void initializeIntegrator();
     
     // Process execution helpers
+    std::unordered_map<std::string, double> mergeStepParameters(
+        const ProcessExecutionContext& context,
+        const ProcessStep& step
+    ) const;
+    
+    void recordStepSuccess(
+        ProcessExecutionContext& context,
+        ProcessStep& step
+    );
+    
     bool executePhysicsProcess(
         std::shared_ptr<WaferEnhanced> wafer,
         const std::string& process_type,
@@ -346,7 +361,8 @@ namespace ProcessIntegrationUtils {
     ProcessRecipe generateMEMSRecipe();
     ProcessRecipe generatePowerDeviceRecipe();
     
-    // Dependency analysis
+    // Dependency analysis; the critical path is the chain of prerequisites
+    // and dependencies with the largest total estimated time
     std::vector<std::string> analyzeCriticalPath(const ProcessRecipe& recipe);
     double calculateRecipeComplexity(const ProcessRecipe& recipe);
     std::unordered_map<std::string, double> analyzeResourceUtilization(const ProcessRecipe& recipe);
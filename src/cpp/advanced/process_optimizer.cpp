@@ -1,11 +1,178 @@
 #include "process_optimizer.hpp"
+#include "../core/reproducibility.hpp"
+#include "../core/task_scheduler.hpp"
 #include <algorithm>
 #include <cmath>
 #include <chrono>
+#include <cstring>
+#include <map>
 #include <numeric>
+#include <set>
+#include "../core/simulation_engine.hpp"
 
 namespace SemiPRO {
 
+namespace {
+
+constexpr std::uint32_t kEvaluationCacheFormat = 1;
+
+std::vector<std::pair<std::string, double>> sortedEntries(const std::unordered_map<std::string, double>& values) {
+    std::vector<std::pair<std::string, double>> entries(values.begin(), values.end());
+    std::sort(entries.begin(), entries.end());
+    return entries;
+}
+
+template <typename T>
+void putValue(std::vector<unsigned char>& out, const T& value) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void putString(std::vector<unsigned char>& out, const std::string& value) {
+    putValue(out, static_cast<std::uint64_t>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+void putEntries(std::vector<unsigned char>& out, const std::unordered_map<std::string, double>& values) {
+    putValue(out, static_cast<std::uint64_t>(values.size()));
+    for (const auto& entry : sortedEntries(values)) {
+        putString(out, entry.first);
+        putValue(out, entry.second);
+    }
+}
+
+// Reads back what the put functions wrote; throws std::runtime_error past
+// the end of the record
+class RecordReader {
+public:
+    explicit RecordReader(const std::vector<unsigned char>& data) : data_(data) {}
+
+    template <typename T>
+    T value() {
+        T result;
+        std::memcpy(&result, take(sizeof(T)), sizeof(T));
+        return result;
+    }
+
+    std::string string() {
+        const auto size = value<std::uint64_t>();
+        const auto* bytes = take(size);
+        return std::string(reinterpret_cast<const char*>(bytes), size);
+    }
+
+    std::unordered_map<std::string, double> entries() {
+        std::unordered_map<std::string, double> result;
+        for (auto count = value<std::uint64_t>(); count > 0; --count) {
+            std::string name = string();
+            result[name] = value<double>();
+        }
+        return result;
+    }
+
+private:
+    const unsigned char* take(std::uint64_t size) {
+        if (size > data_.size() - position_) {
+            throw std::runtime_error("Truncated evaluation record");
+        }
+        const unsigned char* bytes = data_.data() + position_;
+        position_ += size;
+        return bytes;
+    }
+
+    const std::vector<unsigned char>& data_;
+    size_t position_ = 0;
+};
+
+std::vector<unsigned char> writeEvaluation(const OptimizationEvaluation& evaluation) {
+    std::vector<unsigned char> out;
+    putValue(out, kEvaluationCacheFormat);
+    putValue(out, evaluation.fitness_score);
+    putValue(out, static_cast<std::uint8_t>(evaluation.is_feasible));
+    putValue(out, evaluation.evaluation_time);
+    putString(out, evaluation.evaluation_id);
+    putEntries(out, evaluation.objectives);
+    putEntries(out, evaluation.constraints);
+    return out;
+}
+
+// Objectives calculateFitness rewards, and the electrical figure of
+// merit, are maximized; the rest are minimized
+double objectiveSign(const std::string& name) {
+    return name == "uniformity" || name == "yield" || name == "electrical" ? -1.0 : 1.0;
+}
+
+std::string objectiveKey(OptimizationObjective objective) {
+    switch (objective) {
+        case OptimizationObjective::MINIMIZE_STRESS: return "stress";
+        case OptimizationObjective::MAXIMIZE_UNIFORMITY: return "uniformity";
+        case OptimizationObjective::MINIMIZE_DEFECTS: return "defects";
+        case OptimizationObjective::OPTIMIZE_ELECTRICAL: return "electrical";
+        case OptimizationObjective::MINIMIZE_COST: return "cost";
+        case OptimizationObjective::MAXIMIZE_YIELD: return "yield";
+    }
+    return "";
+}
+
+// Non-dominated ranks with every infeasible point behind every feasible one
+std::vector<int> constrainedRanks(const std::vector<std::vector<double>>& points, const std::vector<bool>& feasible) {
+    std::vector<std::vector<double>> sets[2];
+    std::vector<size_t> members[2];
+    for (size_t i = 0; i < points.size(); ++i) {
+        const int set = feasible[i] ? 0 : 1;
+        sets[set].push_back(points[i]);
+        members[set].push_back(i);
+    }
+    std::vector<int> ranks(points.size());
+    int offset = 0;
+    for (int set = 0; set < 2; ++set) {
+        const auto set_ranks = nonDominatedRanks(sets[set]);
+        int fronts = 0;
+        for (size_t k = 0; k < set_ranks.size(); ++k) {
+            ranks[members[set][k]] = offset + set_ranks[k];
+            fronts = std::max(fronts, set_ranks[k] + 1);
+        }
+        offset += fronts;
+    }
+    return ranks;
+}
+
+// fn(index) for every index below sizes, the last position fastest
+template <typename Fn>
+void forEachIndex(const std::vector<size_t>& sizes, Fn&& fn) {
+    if (std::find(sizes.begin(), sizes.end(), size_t(0)) != sizes.end()) {
+        return;
+    }
+    std::vector<size_t> index(sizes.size(), 0);
+    while (true) {
+        fn(index);
+        size_t d = sizes.size();
+        while (d > 0 && ++index[d - 1] == sizes[d - 1]) {
+            index[d - 1] = 0;
+            --d;
+        }
+        if (d == 0) {
+            return;
+        }
+    }
+}
+
+OptimizationEvaluation readEvaluation(const std::vector<unsigned char>& record) {
+    RecordReader reader(record);
+    if (reader.value<std::uint32_t>() != kEvaluationCacheFormat) {
+        throw std::runtime_error("Unknown evaluation record format");
+    }
+    OptimizationEvaluation evaluation;
+    evaluation.fitness_score = reader.value<double>();
+    evaluation.is_feasible = reader.value<std::uint8_t>() != 0;
+    evaluation.evaluation_time = reader.value<double>();
+    evaluation.evaluation_id = reader.string();
+    evaluation.objectives = reader.entries();
+    evaluation.constraints = reader.entries();
+    return evaluation;
+}
+
+} // namespace
+
 ProcessOptimizer::ProcessOptimizer() {
     initializeOptimizer();
     
@@ -46,6 +213,8 @@ ProcessOptimizationResults ProcessOptimizer::optimizeProcess(
     ProcessOptimizationResults results;
     current_algorithm_ = algorithm;
     objectives_ = objectives;
+    cache_hits_ = 0;
+    simulation_cost_ = 0.0;
     
     auto start_time = std::chrono::steady_clock::now();
     
@@ -71,10 +240,13 @@ ProcessOptimizationResults ProcessOptimizer::optimizeProcess(
             }
             
             case OptimizationAlgorithm::GENETIC_ALGORITHM:
-            case OptimizationAlgorithm::MULTI_OBJECTIVE_GA:
                 results = geneticAlgorithmOptimization(wafer, process_type, objectives);
                 break;
                 
+            case OptimizationAlgorithm::MULTI_OBJECTIVE_GA:
+                results = multiObjectiveOptimization(wafer, process_type, objectives);
+                break;
+                
             case OptimizationAlgorithm::PARTICLE_SWARM:
                 results = particleSwarmOptimization(wafer, process_type, objectives);
                 break;
@@ -85,6 +257,18 @@ ProcessOptimizationResults ProcessOptimizer::optimizeProcess(
                 }
                 break;
                 
+            case OptimizationAlgorithm::BAYESIAN_OPTIMIZATION:
+                results = bayesianOptimization(wafer, process_type, objectives);
+                break;
+                
+            case OptimizationAlgorithm::GRADIENT_DESCENT:
+                results = gradientOptimization(wafer, process_type, objectives);
+                break;
+                
+            case OptimizationAlgorithm::HYPERBAND:
+                results = hyperbandOptimization(wafer, process_type, objectives);
+                break;
+                
             default:
                 // Default to genetic algorithm
                 results = geneticAlgorithmOptimization(wafer, process_type, objectives);
@@ -100,6 +284,10 @@ ProcessOptimizationResults ProcessOptimizer::optimizeProcess(
         
         // Calculate statistics
         results.statistics = analyzeOptimizationResults(results);
+        if (evaluation_cache_) {
+            results.statistics["cached_evaluations"] = static_cast<double>(cache_hits_);
+        }
+        results.statistics["simulation_cost"] = simulation_cost_;
         
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
                           "Process optimization completed: " + 
@@ -133,35 +321,37 @@ ProcessOptimizationResults ProcessOptimizer::parameterSweep(
         
         // Generate parameter combinations
         std::vector<std::unordered_map<std::string, double>> parameter_combinations;
-        
-        if (parameter_names.size() == 1) {
-            // Single parameter sweep
-            const std::string& param_name = parameter_names[0];
+        // Values of each parameter on a grid sweep
+        std::vector<std::vector<double>> axes;
+        for (const std::string& param_name : parameter_names) {
+            if (parameter_names.size() > 2) {
+                break;
+            }
             const auto& param = parameters_[param_name];
-            
+            axes.emplace_back();
             double current = param.min_value;
             while (current <= param.max_value) {
+                axes.back().push_back(current);
+                current += param.step_size;
+            }
+        }
+        
+        if (parameter_names.size() == 1) {
+            // Single parameter sweep
+            for (double value : axes[0]) {
                 std::unordered_map<std::string, double> params;
-                params[param_name] = current;
+                params[parameter_names[0]] = value;
                 parameter_combinations.push_back(params);
-                current += param.step_size;
             }
         } else if (parameter_names.size() == 2) {
             // Two-parameter grid search
-            const auto& param1 = parameters_[parameter_names[0]];
-            const auto& param2 = parameters_[parameter_names[1]];
-            
-            double val1 = param1.min_value;
-            while (val1 <= param1.max_value) {
-                double val2 = param2.min_value;
-                while (val2 <= param2.max_value) {
+            for (double val1 : axes[0]) {
+                for (double val2 : axes[1]) {
                     std::unordered_map<std::string, double> params;
                     params[parameter_names[0]] = val1;
                     params[parameter_names[1]] = val2;
                     parameter_combinations.push_back(params);
-                    val2 += param2.step_size;
                 }
-                val1 += param1.step_size;
             }
         } else {
             // Multi-parameter random sampling (too many combinations for exhaustive search)
@@ -179,13 +369,15 @@ ProcessOptimizationResults ProcessOptimizer::parameterSweep(
             }
         }
         
-        // Evaluate all parameter combinations
+        // Evaluate all parameter combinations; with the evaluation cache,
+        // points an earlier sweep covered are not simulated again
         double best_fitness = -std::numeric_limits<double>::infinity();
         
-        for (const auto& params : parameter_combinations) {
-            auto evaluation = evaluateProcess(wafer, process_type, params);
-            results.evaluations.push_back(evaluation);
-            
+        results.evaluations = evaluateBatch(wafer, process_type, parameter_combinations);
+        if (sweep_refinements_ > 0 && !axes.empty()) {
+            refineSweep(wafer, process_type, parameter_names, axes, results);
+        }
+        for (const auto& evaluation : results.evaluations) {
             if (evaluation.fitness_score > best_fitness) {
                 best_fitness = evaluation.fitness_score;
                 results.best_solution = evaluation;
@@ -225,6 +417,9 @@ ProcessOptimizationResults ProcessOptimizer::geneticAlgorithmOptimization(
                           ", generations=" + std::to_string(ga_params_.max_generations),
                           "ProcessOptimizer");
         
+        surrogate_.clear();
+        simulations_ = 0;
+        
         // Initialize population
         GAPopulation population = initializePopulation(ga_params_.population_size);
         
@@ -239,8 +434,11 @@ ProcessOptimizationResults ProcessOptimizer::geneticAlgorithmOptimization(
             // Evaluate population
             evaluatePopulation(population, wafer, process_type);
             
-            // Track best solution
+            // Track best solution, among the simulated
             for (const auto& individual : population.individuals) {
+                if (individual.is_predicted) {
+                    continue;
+                }
                 if (individual.fitness > best_fitness) {
                     best_fitness = individual.fitness;
                     generations_without_improvement = 0;
@@ -276,7 +474,7 @@ ProcessOptimizationResults ProcessOptimizer::geneticAlgorithmOptimization(
             }
         }
         
-        results.total_evaluations = ga_params_.max_generations * ga_params_.population_size;
+        results.total_evaluations = simulations_;
         
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
                           "Genetic algorithm completed: best fitness = " + std::to_string(best_fitness),
@@ -294,28 +492,34 @@ ProcessOptimizationResults ProcessOptimizer::geneticAlgorithmOptimization(
 OptimizationEvaluation ProcessOptimizer::evaluateProcess(
     std::shared_ptr<WaferEnhanced> wafer,
     const std::string& process_type,
-    const std::unordered_map<std::string, double>& parameters) {
+    const std::unordered_map<std::string, double>& parameters,
+    double fidelity) {
     
     OptimizationEvaluation evaluation;
     evaluation.parameters = parameters;
+    evaluation.fidelity = fidelity;
     
     auto start_time = std::chrono::steady_clock::now();
     
     try {
-        // Use the original wafer for evaluation (no copy needed for this simplified version)
-        auto eval_wafer = wafer;
+        if (process_evaluator_) {
+            evaluation.objectives = process_evaluator_(wafer, process_type, parameters, fidelity);
+        } else {
+            // Use the original wafer for evaluation (no copy needed for this simplified version)
+            auto eval_wafer = wafer;
         
-        // Simulate the process with given parameters
-        // This is a simplified evaluation - in practice, this would call the actual physics engines
+            // Simulate the process with given parameters
+            // This is a simplified evaluation - in practice, this would call the actual physics engines
         
-        // Example objectives calculation (simplified)
-        double uniformity = 95.0 + 5.0 * std::sin(parameters.begin()->second); // Mock uniformity
-        double yield = 90.0 + 10.0 * std::cos(parameters.begin()->second);     // Mock yield
-        double cost = 100.0 + 50.0 * parameters.begin()->second;               // Mock cost
+            // Example objectives calculation (simplified)
+            double uniformity = 95.0 + 5.0 * std::sin(parameters.begin()->second); // Mock uniformity
+            double yield = 90.0 + 10.0 * std::cos(parameters.begin()->second);     // Mock yield
+            double cost = 100.0 + 50.0 * parameters.begin()->second;               // Mock cost
         
-        evaluation.objectives["uniformity"] = uniformity;
-        evaluation.objectives["yield"] = yield;
-        evaluation.objectives["cost"] = cost;
+            evaluation.objectives["uniformity"] = uniformity;
+            evaluation.objectives["yield"] = yield;
+            evaluation.objectives["cost"] = cost;
+        }
         
         // Check constraints
         evaluation.is_feasible = checkConstraints(parameters);
@@ -334,6 +538,24 @@ OptimizationEvaluation ProcessOptimizer::evaluateProcess(
         evaluation.is_feasible = false;
     }
     
+    if (result_store_) {
+        ResultRecord record("optimizer", process_type, std::isfinite(evaluation.fitness_score),
+                            evaluation.evaluation_time);
+        record.addAll("parameter", evaluation.parameters);
+        record.addAll("objective", evaluation.objectives);
+        record.addAll("constraint", evaluation.constraints);
+        record.add("evaluation", "fitness", evaluation.fitness_score);
+        record.add("evaluation", "feasible", evaluation.is_feasible ? 1.0 : 0.0);
+        record.add("evaluation", "fidelity", evaluation.fidelity);
+        try {
+            result_store_->append(record);
+        } catch (const std::exception& e) {
+            SEMIPRO_LOG_MODULE(LogLevel::WARNING, LogCategory::ADVANCED,
+                              "Evaluation not recorded: " + std::string(e.what()),
+                              "ProcessOptimizer");
+        }
+    }
+    
     return evaluation;
 }
 
@@ -379,18 +601,27 @@ void ProcessOptimizer::evaluatePopulation(
     std::shared_ptr<WaferEnhanced> wafer,
     const std::string& process_type) {
     
-    double fitness_sum = 0.0;
-    
-    for (auto& individual : population.individuals) {
-        if (!individual.is_evaluated) {
-            auto params = decodeParameters(individual.genes);
-            auto evaluation = evaluateProcess(wafer, process_type, params);
-            individual.fitness = evaluation.fitness_score;
-            individual.is_evaluated = true;
+    std::vector<size_t> pending;
+    std::vector<std::vector<double>> candidates;
+    for (size_t i = 0; i < population.individuals.size(); ++i) {
+        if (!population.individuals[i].is_evaluated) {
+            pending.push_back(i);
+            candidates.push_back(population.individuals[i].genes);
         }
-        fitness_sum += individual.fitness;
+    }
+    std::vector<bool> simulated;
+    const auto evaluations = evaluateScreened(wafer, process_type, candidates, simulated);
+    for (size_t k = 0; k < pending.size(); ++k) {
+        auto& individual = population.individuals[pending[k]];
+        individual.fitness = evaluations[k].fitness_score;
+        individual.is_evaluated = true;
+        individual.is_predicted = !simulated[k];
     }
     
+    double fitness_sum = 0.0;
+    for (const auto& individual : population.individuals) {
+        fitness_sum += individual.fitness;
+    }
     population.average_fitness = fitness_sum / population.individuals.size();
     
     // Find best fitness
@@ -402,6 +633,150 @@ void ProcessOptimizer::evaluatePopulation(
     }
 }
 
+std::vector<OptimizationEvaluation> ProcessOptimizer::evaluateBatch(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const std::string& process_type,
+    const std::vector<std::unordered_map<std::string, double>>& batch,
+    double fidelity) {
+    
+    std::vector<OptimizationEvaluation> evaluations(batch.size());
+    std::vector<size_t> pending;              // Entries to simulate
+    std::vector<size_t> source(batch.size()); // Entry whose evaluation each one takes
+    std::vector<CacheKey> keys;
+    const auto cache = evaluation_cache_;
+    if (cache) {
+        ContentHasher state_hasher;
+        if (wafer) {
+            const auto image = wafer->stateImage();
+            state_hasher.update(image.data(), image.size());
+        }
+        const CacheKey wafer_state = state_hasher.finish();
+        
+        keys.resize(batch.size());
+        std::unordered_map<CacheKey, size_t, CacheKeyHash> first;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            keys[i] = evaluationKey(wafer_state, process_type, batch[i], fidelity);
+            const auto found = first.emplace(keys[i], i);
+            source[i] = found.first->second;
+            if (!found.second) {
+                cache_hits_++;
+                continue;
+            }
+            if (auto record = cache->lookup(keys[i])) {
+                try {
+                    evaluations[i] = readEvaluation(*record);
+                    evaluations[i].parameters = batch[i];
+                    evaluations[i].fidelity = fidelity;
+                    cache_hits_++;
+                    continue;
+                } catch (const std::exception& e) {
+                    SEMIPRO_LOG_MODULE(LogLevel::WARNING, LogCategory::ADVANCED,
+                                      "Discarding cached evaluation " + keys[i].to_hex() + ": " + e.what(),
+                                      "ProcessOptimizer");
+                }
+            }
+            pending.push_back(i);
+        }
+    } else {
+        pending.resize(batch.size());
+        std::iota(pending.begin(), pending.end(), 0);
+        std::iota(source.begin(), source.end(), 0);
+    }
+    
+    simulations_ += static_cast<int>(pending.size());
+    simulation_cost_ += fidelity * pending.size();
+    if (!enable_parallel_evaluation_ || pending.size() < 2) {
+        for (size_t i : pending) {
+            evaluations[i] = evaluateProcess(wafer, process_type, batch[i], fidelity);
+        }
+    } else {
+        // One evaluation per chunk: the pool hands the next one to whichever
+        // worker frees up, so evaluations of uneven cost do not hold up a
+        // whole block of the population
+        TaskScheduler::getInstance().parallelFor(0, static_cast<int>(pending.size()), [&](int begin, int end) {
+            for (int k = begin; k < end; ++k) {
+                const size_t i = pending[k];
+                evaluations[i] = evaluateProcess(wafer ? wafer->clone() : nullptr, process_type, batch[i], fidelity);
+            }
+        }, 1);
+    }
+    
+    if (cache) {
+        for (size_t i : pending) {
+            if (std::isfinite(evaluations[i].fitness_score)) {
+                cache->store(keys[i], writeEvaluation(evaluations[i]));
+            }
+        }
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (source[i] != i) {
+            evaluations[i] = evaluations[source[i]];
+            evaluations[i].parameters = batch[i];
+        }
+    }
+    return evaluations;
+}
+
+CacheKey ProcessOptimizer::evaluationKey(
+    const CacheKey& wafer_state,
+    const std::string& process_type,
+    const std::unordered_map<std::string, double>& parameters,
+    double fidelity) {
+    
+    // Levels by name, so the key does not depend on the order parameters
+    // were added in; a missing parameter gets a level no value reaches
+    std::vector<std::pair<std::string, std::int64_t>> levels;
+    const auto encoded = encodeParameters(parameters);
+    size_t index = 0;
+    for (const auto& param : parameters_) {
+        if (param.second.is_active) {
+            const double x = encoded[index++];
+            levels.emplace_back(param.first, std::isnan(x) ? std::numeric_limits<std::int64_t>::min()
+                                                           : std::llround(x / cache_resolution_));
+        }
+    }
+    std::sort(levels.begin(), levels.end());
+    
+    ContentHasher hasher;
+    hasher.update_value(kEvaluationCacheFormat);
+    hasher.update_value(wafer_state.high).update_value(wafer_state.low);
+    hasher.update_string(process_type);
+    hasher.update_value(cache_resolution_);
+    // Full-fidelity keys are those from before there were fidelities
+    if (fidelity != 1.0) {
+        hasher.update_string("fidelity");
+        hasher.update_value(fidelity);
+    }
+    hasher.update_value(static_cast<std::uint64_t>(levels.size()));
+    for (const auto& level : levels) {
+        hasher.update_string(level.first);
+        hasher.update_value(level.second);
+    }
+    // Values of parameters outside the active set are taken exactly
+    for (const auto& entry : sortedEntries(parameters)) {
+        const auto param = parameters_.find(entry.first);
+        if (param == parameters_.end() || !param->second.is_active) {
+            hasher.update_string(entry.first);
+            hasher.update_value(entry.second);
+        }
+    }
+    // Feasibility depends on the constraints
+    std::vector<std::string> names;
+    for (const auto& constraint : constraints_) {
+        names.push_back(constraint.first);
+    }
+    std::sort(names.begin(), names.end());
+    for (const auto& name : names) {
+        const auto& constraint = constraints_.at(name);
+        hasher.update_string(name);
+        hasher.update_string(constraint.parameter);
+        hasher.update_value(constraint.min_limit);
+        hasher.update_value(constraint.max_limit);
+        hasher.update_value(static_cast<std::uint8_t>(constraint.is_hard_constraint));
+    }
+    return hasher.finish();
+}
+
 std::vector<double> ProcessOptimizer::generateRandomParameters() {
     std::vector<double> params;
     std::uniform_real_distribution<double> dist(0.0, 1.0);
@@ -415,6 +790,25 @@ std::vector<double> ProcessOptimizer::generateRandomParameters() {
     return params;
 }
 
+std::vector<double> ProcessOptimizer::encodeParameters(const std::unordered_map<std::string, double>& params) {
+    std::vector<double> encoded;
+    
+    for (const auto& param : parameters_) {
+        if (param.second.is_active) {
+            const auto value = params.find(param.first);
+            const double range = param.second.max_value - param.second.min_value;
+            if (value == params.end()) {
+                encoded.push_back(std::numeric_limits<double>::quiet_NaN());
+            } else {
+                encoded.push_back(range > 0.0 ? (quantizeParameter(param.second, value->second) -
+                                                 param.second.min_value) / range : 0.0);
+            }
+        }
+    }
+    
+    return encoded;
+}
+
 std::unordered_map<std::string, double> ProcessOptimizer::decodeParameters(const std::vector<double>& encoded) {
     std::unordered_map<std::string, double> decoded;
     
@@ -424,7 +818,7 @@ std::unordered_map<std::string, double> ProcessOptimizer::decodeParameters(const
             double normalized = encoded[index];
             double actual = param.second.min_value + 
                            normalized * (param.second.max_value - param.second.min_value);
-            decoded[param.first] = actual;
+            decoded[param.first] = quantizeParameter(param.second, actual);
             index++;
         }
     }
@@ -432,6 +826,30 @@ std::unordered_map<std::string, double> ProcessOptimizer::decodeParameters(const
     return decoded;
 }
 
+double ProcessOptimizer::quantizeParameter(const OptimizationParameter& param, double value) const {
+    switch (param.type) {
+        case ParameterType::DISCRETE:
+        case ParameterType::INTEGER: {
+            double step = param.step_size > 0.0 ? param.step_size : 1.0;
+            if (param.type == ParameterType::INTEGER) {
+                step = std::max(1.0, std::round(step));
+            }
+            // Snapped to the steps from the minimum that stay in range
+            const double steps = std::floor((param.max_value - param.min_value) / step + 1e-9);
+            const double k = std::round((value - param.min_value) / step);
+            return param.min_value + step * std::max(0.0, std::min(steps, k));
+        }
+        case ParameterType::BOOLEAN:
+            return value >= 0.5 * (param.min_value + param.max_value) ? param.max_value : param.min_value;
+        case ParameterType::CATEGORICAL:
+        case ParameterType::ENUMERATED:
+            // Category indices
+            return std::max(param.min_value, std::min(param.max_value, std::round(value)));
+        default:
+            return value;
+    }
+}
+
 bool ProcessOptimizer::checkConstraints(const std::unordered_map<std::string, double>& parameters) {
     for (const auto& constraint : constraints_) {
         auto param_it = parameters.find(constraint.second.parameter);
@@ -466,7 +884,7 @@ double ProcessOptimizer::calculateConstraintPenalty(const std::unordered_map<std
 }
 
 void ProcessOptimizer::initializeOptimizer() {
-    random_generator_.seed(std::chrono::steady_clock::now().time_since_epoch().count());
+    random_generator_.seed(Reproducibility::key("process_optimizer"));
     current_algorithm_ = OptimizationAlgorithm::GENETIC_ALGORITHM;
 }
 
@@ -478,7 +896,10 @@ std::string ProcessOptimizer::algorithmToString(OptimizationAlgorithm algorithm)
         case OptimizationAlgorithm::GENETIC_ALGORITHM: return "Genetic Algorithm";
         case OptimizationAlgorithm::PARTICLE_SWARM: return "Particle Swarm";
         case OptimizationAlgorithm::SIMULATED_ANNEALING: return "Simulated Annealing";
+        case OptimizationAlgorithm::BAYESIAN_OPTIMIZATION: return "Bayesian Optimization";
+        case OptimizationAlgorithm::GRADIENT_DESCENT: return "Gradient Descent (L-BFGS-B)";
         case OptimizationAlgorithm::MULTI_OBJECTIVE_GA: return "Multi-Objective GA";
+        case OptimizationAlgorithm::HYPERBAND: return "Hyperband";
         default: return "Unknown";
     }
 }
@@ -589,19 +1010,1019 @@ GAPopulation ProcessOptimizer::mutation(const GAPopulation& offspring) {
     return mutated;
 }
 
+std::vector<OptimizationEvaluation> ProcessOptimizer::evaluateScreened(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const std::string& process_type,
+    const std::vector<std::vector<double>>& candidates,
+    std::vector<bool>& simulated) {
+    
+    const size_t n = candidates.size();
+    simulated.assign(n, true);
+    std::vector<OptimizationEvaluation> evaluations(n);
+    if (!enable_surrogate_screening_) {
+        std::vector<std::unordered_map<std::string, double>> batch;
+        batch.reserve(n);
+        for (const auto& x : candidates) {
+            batch.push_back(decodeParameters(x));
+        }
+        return evaluateBatch(wafer, process_type, batch);
+    }
+    
+    // Screen once the surrogate has seen two samples per parameter plus
+    // one, leading by the upper confidence bound so uncertain regions
+    // still get simulated
+    const size_t dimension = n > 0 ? candidates.front().size() : 0;
+    std::vector<GaussianProcess::Prediction> predictions(n);
+    if (surrogate_.size() >= static_cast<int>(2 * dimension + 1)) {
+        std::vector<size_t> order(n);
+        std::vector<double> bound(n);
+        for (size_t i = 0; i < n; ++i) {
+            predictions[i] = surrogate_.predict(candidates[i]);
+            bound[i] = predictions[i].mean + predictions[i].stddev;
+            order[i] = i;
+        }
+        const size_t kept = std::min(n, std::max<size_t>(1, static_cast<size_t>(std::ceil(screening_fraction_ * n))));
+        std::partial_sort(order.begin(), order.begin() + kept, order.end(),
+                          [&](size_t a, size_t b) { return bound[a] > bound[b]; });
+        for (size_t k = kept; k < n; ++k) {
+            simulated[order[k]] = false;
+        }
+    }
+    
+    std::vector<size_t> chosen;
+    std::vector<std::unordered_map<std::string, double>> batch;
+    for (size_t i = 0; i < n; ++i) {
+        if (simulated[i]) {
+            chosen.push_back(i);
+            batch.push_back(decodeParameters(candidates[i]));
+        } else {
+            evaluations[i].parameters = decodeParameters(candidates[i]);
+            evaluations[i].fitness_score = predictions[i].mean;
+            evaluations[i].evaluation_id = "surrogate";
+        }
+    }
+    const auto simulations = evaluateBatch(wafer, process_type, batch);
+    for (size_t k = 0; k < chosen.size(); ++k) {
+        evaluations[chosen[k]] = simulations[k];
+        if (std::isfinite(simulations[k].fitness_score)) {
+            surrogate_.addSample(candidates[chosen[k]], simulations[k].fitness_score);
+        }
+    }
+    return evaluations;
+}
+
 ProcessOptimizationResults ProcessOptimizer::particleSwarmOptimization(
     std::shared_ptr<WaferEnhanced> wafer,
     const std::string& process_type,
     const std::vector<OptimizationObjective>& objectives) {
 
+    SEMIPRO_PERF_TIMER("particle_swarm", "ProcessOptimizer");
+
     ProcessOptimizationResults results;
+    
+    try {
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                          "Starting particle swarm optimization: swarm=" + 
+                          std::to_string(ps_params_.swarm_size) + 
+                          ", iterations=" + std::to_string(ps_params_.max_iterations),
+                          "ProcessOptimizer");
+        
+        surrogate_.clear();
+        simulations_ = 0;
+        
+        // Particles move in the normalized parameter space, [0, 1] per
+        // active parameter
+        const int swarm_size = std::max(1, ps_params_.swarm_size);
+        std::vector<std::vector<double>> position(swarm_size), velocity(swarm_size);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::uniform_real_distribution<double> initial_velocity(-0.1, 0.1);
+        for (int p = 0; p < swarm_size; ++p) {
+            position[p] = generateRandomParameters();
+            for (size_t d = 0; d < position[p].size(); ++d) {
+                velocity[p].push_back(initial_velocity(random_generator_));
+            }
+        }
+        std::vector<std::vector<double>> personal_best = position;
+        std::vector<double> personal_best_fitness(swarm_size, -std::numeric_limits<double>::infinity());
+        std::vector<double> global_best = position.front();
+        double best_fitness = -std::numeric_limits<double>::infinity();
+        int iterations_without_improvement = 0;
+        const int max_stagnation = 20; // As the GA
+        
+        for (int iteration = 0; iteration < ps_params_.max_iterations; ++iteration) {
+            std::vector<bool> simulated;
+            const auto evaluations = evaluateScreened(wafer, process_type, position, simulated);
+            
+            const double previous_best = best_fitness;
+            for (int p = 0; p < swarm_size; ++p) {
+                if (!simulated[p]) {
+                    continue; // Only simulations move the bests
+                }
+                const auto& evaluation = evaluations[p];
+                if (evaluation.fitness_score > personal_best_fitness[p]) {
+                    personal_best_fitness[p] = evaluation.fitness_score;
+                    personal_best[p] = position[p];
+                }
+                if (evaluation.fitness_score > best_fitness) {
+                    best_fitness = evaluation.fitness_score;
+                    global_best = position[p];
+                    results.best_solution = evaluation;
+                }
+                results.evaluations.push_back(evaluation);
+            }
+            
+            if (best_fitness > previous_best + convergence_tolerance_) {
+                iterations_without_improvement = 0;
+            } else if (++iterations_without_improvement >= max_stagnation) {
+                SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                                  "PSO converged at iteration " + std::to_string(iteration),
+                                  "ProcessOptimizer");
+                results.has_converged = true;
+                break;
+            }
+            if (static_cast<int>(results.evaluations.size()) >= max_evaluations_) {
+                break;
+            }
+            
+            // Inertia falls linearly to 0.4 over the run, from exploring
+            // the space to refining the best found
+            const double progress = ps_params_.max_iterations > 1
+                ? static_cast<double>(iteration) / (ps_params_.max_iterations - 1) : 1.0;
+            const double inertia = ps_params_.inertia_weight + (0.4 - ps_params_.inertia_weight) * progress;
+            for (int p = 0; p < swarm_size; ++p) {
+                for (size_t d = 0; d < position[p].size(); ++d) {
+                    double& v = velocity[p][d];
+                    v = inertia * v
+                        + ps_params_.cognitive_weight * unit(random_generator_) * (personal_best[p][d] - position[p][d])
+                        + ps_params_.social_weight * unit(random_generator_) * (global_best[d] - position[p][d]);
+                    v = std::max(-0.5, std::min(0.5, v)); // Velocity clamp, half the range
+                    position[p][d] = std::max(0.0, std::min(1.0, position[p][d] + v));
+                }
+            }
+            
+            if (iteration % 10 == 0) {
+                SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::ADVANCED,
+                                  "PSO Iteration " + std::to_string(iteration) + 
+                                  ": best fitness = " + std::to_string(best_fitness),
+                                  "ProcessOptimizer");
+            }
+        }
+        
+        results.total_evaluations = static_cast<int>(results.evaluations.size());
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                          "Particle swarm optimization completed: best fitness = " + std::to_string(best_fitness),
+                          "ProcessOptimizer");
+        
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::ADVANCED,
+                          "Particle swarm optimization failed: " + std::string(e.what()),
+                          "ProcessOptimizer");
+    }
+    
+    return results;
+}
 
-    SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
-                      "Particle Swarm Optimization not fully implemented - using GA instead",
-                      "ProcessOptimizer");
+ProcessOptimizationResults ProcessOptimizer::bayesianOptimization(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const std::string& process_type,
+    const std::vector<OptimizationObjective>& objectives) {
 
-    // For now, fall back to genetic algorithm
-    return geneticAlgorithmOptimization(wafer, process_type, objectives);
+    SEMIPRO_PERF_TIMER("bayesian_optimization", "ProcessOptimizer");
+
+    ProcessOptimizationResults results;
+    
+    try {
+        const size_t dimension = generateRandomParameters().size();
+        const int budget = std::min(bo_params_.max_evaluations, max_evaluations_);
+        const int initial = std::min(budget, bo_params_.initial_samples > 0
+            ? bo_params_.initial_samples : static_cast<int>(2 * dimension + 1));
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                          "Starting Bayesian optimization: " + std::to_string(initial) + 
+                          " initial samples, budget=" + std::to_string(budget),
+                          "ProcessOptimizer");
+        
+        surrogate_.clear();
+        simulations_ = 0;
+        std::vector<double> best_point;
+        double best_fitness = -std::numeric_limits<double>::infinity();
+        std::vector<double> fitness_values;
+        
+        auto simulate = [&](const std::vector<std::vector<double>>& points) {
+            std::vector<std::unordered_map<std::string, double>> batch;
+            batch.reserve(points.size());
+            for (const auto& x : points) {
+                batch.push_back(decodeParameters(x));
+            }
+            const auto evaluations = evaluateBatch(wafer, process_type, batch);
+            for (size_t i = 0; i < points.size(); ++i) {
+                const auto& evaluation = evaluations[i];
+                results.evaluations.push_back(evaluation);
+                if (!std::isfinite(evaluation.fitness_score)) {
+                    continue;
+                }
+                surrogate_.addSample(points[i], evaluation.fitness_score);
+                fitness_values.push_back(evaluation.fitness_score);
+                if (evaluation.fitness_score > best_fitness) {
+                    best_fitness = evaluation.fitness_score;
+                    best_point = points[i];
+                    results.best_solution = evaluation;
+                }
+            }
+        };
+        
+        // Latin hypercube: each parameter's range cut into `initial`
+        // strata, one sample per stratum, strata shuffled per parameter
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::vector<std::vector<double>> design(initial, std::vector<double>(dimension));
+        for (size_t d = 0; d < dimension; ++d) {
+            std::vector<int> strata(initial);
+            std::iota(strata.begin(), strata.end(), 0);
+            std::shuffle(strata.begin(), strata.end(), random_generator_);
+            for (int i = 0; i < initial; ++i) {
+                design[i][d] = (strata[i] + unit(random_generator_)) / initial;
+            }
+        }
+        simulate(design);
+        
+        // Each pick maximizes expected improvement over random candidates,
+        // half spread over the space and half around the best point; picks
+        // of one batch see the earlier ones as if simulated at the
+        // surrogate's mean (kriging believer), which spreads them out
+        std::normal_distribution<double> nearby(0.0, 0.05);
+        int low_improvement_steps = 0;
+        while (simulations_ < budget && !best_point.empty()) {
+            const int simulations_before = simulations_;
+            const double spread = OptimizationUtils::calculateStandardDeviation(fitness_values);
+            const double margin = bo_params_.exploration * (spread > 0.0 ? spread : 1.0);
+            const int picks = std::max(1, std::min(bo_params_.batch_size, budget - simulations_));
+            GaussianProcess believer = surrogate_;
+            std::vector<std::vector<double>> batch;
+            double top_improvement = 0.0;
+            for (int q = 0; q < picks; ++q) {
+                std::vector<double> pick;
+                double pick_improvement = -1.0;
+                for (int c = 0; c < std::max(1, bo_params_.candidates); ++c) {
+                    std::vector<double> x(dimension);
+                    for (size_t d = 0; d < dimension; ++d) {
+                        x[d] = c % 2 == 0 ? unit(random_generator_)
+                                          : std::max(0.0, std::min(1.0, best_point[d] + nearby(random_generator_)));
+                    }
+                    const double improvement = believer.expectedImprovement(x, best_fitness, margin);
+                    if (improvement > pick_improvement) {
+                        pick_improvement = improvement;
+                        pick = std::move(x);
+                    }
+                }
+                top_improvement = std::max(top_improvement, pick_improvement);
+                believer.addSample(pick, believer.predict(pick).mean);
+                batch.push_back(std::move(pick));
+            }
+            simulate(batch);
+            
+            // Converged once three steps in a row expect to gain less than
+            // the tolerance, or only pick points evaluated before
+            if (top_improvement < convergence_tolerance_ || simulations_ == simulations_before) {
+                if (++low_improvement_steps >= 3) {
+                    results.has_converged = true;
+                    break;
+                }
+            } else {
+                low_improvement_steps = 0;
+            }
+        }
+        
+        results.total_evaluations = simulations_;
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                          "Bayesian optimization completed: best fitness = " + std::to_string(best_fitness) +
+                          " after " + std::to_string(simulations_) + " simulations",
+                          "ProcessOptimizer");
+        
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::ADVANCED,
+                          "Bayesian optimization failed: " + std::string(e.what()),
+                          "ProcessOptimizer");
+    }
+    
+    return results;
+}
+
+ProcessOptimizationResults ProcessOptimizer::multiObjectiveOptimization(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const std::string& process_type,
+    const std::vector<OptimizationObjective>& objectives) {
+
+    SEMIPRO_PERF_TIMER("multi_objective_optimization", "ProcessOptimizer");
+
+    ProcessOptimizationResults results;
+    
+    try {
+        objectives_ = objectives;
+        const size_t population_size = static_cast<size_t>(std::max(4, ga_params_.population_size));
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                          "Starting NSGA-II optimization: population=" + std::to_string(population_size) + 
+                          ", generations=" + std::to_string(ga_params_.max_generations) + 
+                          ", objectives=" + std::to_string(objectivePoint(OptimizationEvaluation()).size()),
+                          "ProcessOptimizer");
+        
+        simulations_ = 0;
+        ParetoArchive archive;
+        int archive_updates = 0;
+        std::vector<std::vector<double>> genes;    // Per evaluation
+        std::vector<std::vector<double>> points;   // Objective point per evaluation
+        std::vector<bool> feasible;                // Per evaluation
+        double best_fitness = -std::numeric_limits<double>::infinity();
+        
+        // Evaluates the candidates, returning their evaluation indices
+        auto evaluate = [&](const std::vector<std::vector<double>>& candidates) {
+            std::vector<std::unordered_map<std::string, double>> batch;
+            batch.reserve(candidates.size());
+            for (const auto& x : candidates) {
+                batch.push_back(decodeParameters(x));
+            }
+            const auto evaluations = evaluateBatch(wafer, process_type, batch);
+            std::vector<size_t> indices;
+            for (size_t i = 0; i < evaluations.size(); ++i) {
+                const auto& evaluation = evaluations[i];
+                const size_t index = results.evaluations.size();
+                results.evaluations.push_back(evaluation);
+                genes.push_back(candidates[i]);
+                points.push_back(objectivePoint(evaluation));
+                const bool ok = evaluation.is_feasible && std::isfinite(evaluation.fitness_score);
+                feasible.push_back(ok);
+                if (ok && archive.insert(points.back(), index)) {
+                    archive_updates++;
+                }
+                if (ok && evaluation.fitness_score > best_fitness) {
+                    best_fitness = evaluation.fitness_score;
+                    results.best_solution = evaluation;
+                }
+                indices.push_back(index);
+            }
+            return indices;
+        };
+        
+        // Survivors of a pool: whole fronts in rank order, and the front
+        // that does not fit thinned to its least crowded members. Each
+        // survivor's tournament fitness orders by rank, then crowding.
+        std::vector<size_t> population;
+        std::vector<double> selection_fitness;
+        auto survive = [&](const std::vector<size_t>& pool) {
+            std::vector<std::vector<double>> pool_points;
+            std::vector<bool> pool_feasible;
+            for (size_t index : pool) {
+                pool_points.push_back(points[index]);
+                pool_feasible.push_back(feasible[index]);
+            }
+            const auto ranks = constrainedRanks(pool_points, pool_feasible);
+            std::vector<std::vector<size_t>> fronts;
+            for (size_t k = 0; k < ranks.size(); ++k) {
+                if (ranks[k] >= static_cast<int>(fronts.size())) {
+                    fronts.resize(ranks[k] + 1);
+                }
+                fronts[ranks[k]].push_back(k);
+            }
+            population.clear();
+            selection_fitness.clear();
+            for (size_t r = 0; r < fronts.size() && population.size() < population_size; ++r) {
+                const auto crowding = crowdingDistances(pool_points, fronts[r]);
+                std::vector<size_t> order(fronts[r].size());
+                std::iota(order.begin(), order.end(), 0);
+                if (population.size() + order.size() > population_size) {
+                    std::sort(order.begin(), order.end(),
+                              [&](size_t a, size_t b) { return crowding[a] > crowding[b]; });
+                    order.resize(population_size - population.size());
+                }
+                for (size_t k : order) {
+                    population.push_back(pool[fronts[r][k]]);
+                    selection_fitness.push_back(-static_cast<double>(r) + std::atan(crowding[k]) / M_PI);
+                }
+            }
+        };
+        
+        std::vector<std::vector<double>> initial;
+        for (size_t i = 0; i < population_size; ++i) {
+            initial.push_back(generateRandomParameters());
+        }
+        survive(evaluate(initial));
+        
+        int generations_without_update = 0;
+        const int max_stagnation = 20; // Stop if the archive is unchanged for 20 generations
+        
+        for (int generation = 1; generation < ga_params_.max_generations; ++generation) {
+            if (simulations_ >= max_evaluations_) {
+                break;
+            }
+            
+            // Offspring by the GA's operators, tournaments won by rank and
+            // crowding; parents carried over unchanged are already in the pool
+            GAPopulation current;
+            for (size_t k = 0; k < population.size(); ++k) {
+                GAIndividual individual;
+                individual.genes = genes[population[k]];
+                individual.fitness = selection_fitness[k];
+                individual.is_evaluated = true;
+                current.individuals.push_back(std::move(individual));
+            }
+            const GAPopulation offspring = mutation(crossover(selection(current)));
+            std::vector<std::vector<double>> children;
+            for (const auto& individual : offspring.individuals) {
+                if (!individual.is_evaluated) {
+                    children.push_back(individual.genes);
+                }
+            }
+            
+            archive_updates = 0;
+            std::vector<size_t> pool = population;
+            const auto added = evaluate(children);
+            pool.insert(pool.end(), added.begin(), added.end());
+            survive(pool);
+            
+            if (archive_updates == 0) {
+                if (++generations_without_update >= max_stagnation) {
+                    SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                                      "NSGA-II converged at generation " + std::to_string(generation),
+                                      "ProcessOptimizer");
+                    results.has_converged = true;
+                    break;
+                }
+            } else {
+                generations_without_update = 0;
+            }
+            
+            if (generation % 10 == 0) {
+                SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::ADVANCED,
+                                  "NSGA-II Generation " + std::to_string(generation) + 
+                                  ": Pareto archive size = " + std::to_string(archive.size()),
+                                  "ProcessOptimizer");
+            }
+        }
+        
+        for (size_t index : archive.ids()) {
+            results.pareto_front.push_back(results.evaluations[index]);
+        }
+        results.total_evaluations = simulations_;
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                          "NSGA-II completed: Pareto front of " + std::to_string(results.pareto_front.size()) + 
+                          " after " + std::to_string(simulations_) + " simulations",
+                          "ProcessOptimizer");
+        
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::ADVANCED,
+                          "Multi-objective optimization failed: " + std::string(e.what()),
+                          "ProcessOptimizer");
+    }
+    
+    return results;
+}
+
+std::vector<OptimizationEvaluation> ProcessOptimizer::calculateParetoFront(
+    const std::vector<OptimizationEvaluation>& evaluations) {
+    
+    std::vector<size_t> candidates;
+    std::vector<std::vector<double>> points;
+    for (size_t i = 0; i < evaluations.size(); ++i) {
+        if (evaluations[i].is_feasible && std::isfinite(evaluations[i].fitness_score)) {
+            candidates.push_back(i);
+            points.push_back(objectivePoint(evaluations[i]));
+        }
+    }
+    const auto ranks = nonDominatedRanks(points);
+    std::vector<OptimizationEvaluation> front;
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        if (ranks[k] == 0) {
+            front.push_back(evaluations[candidates[k]]);
+        }
+    }
+    return front;
+}
+
+std::vector<double> ProcessOptimizer::objectivePoint(const OptimizationEvaluation& evaluation) const {
+    static const std::vector<OptimizationObjective> defaults = {
+        OptimizationObjective::MAXIMIZE_UNIFORMITY,
+        OptimizationObjective::MAXIMIZE_YIELD,
+        OptimizationObjective::MINIMIZE_COST
+    };
+    std::vector<double> point;
+    for (OptimizationObjective objective : objectives_.empty() ? defaults : objectives_) {
+        const std::string key = objectiveKey(objective);
+        const auto value = evaluation.objectives.find(key);
+        point.push_back(value == evaluation.objectives.end() ? std::numeric_limits<double>::infinity()
+                                                             : objectiveSign(key) * value->second);
+    }
+    return point;
+}
+
+ProcessOptimizationResults ProcessOptimizer::gradientOptimization(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const std::string& process_type,
+    const std::vector<OptimizationObjective>& objectives) {
+
+    SEMIPRO_PERF_TIMER("gradient_optimization", "ProcessOptimizer");
+
+    ProcessOptimizationResults results;
+    
+    try {
+        objectives_ = objectives;
+        simulations_ = 0;
+        
+        // Normalized coordinates of the active parameters; gradients only
+        // move the continuous ones, within [lower, upper]
+        std::vector<const OptimizationParameter*> active;
+        std::unordered_map<std::string, double> current;
+        for (const auto& param : parameters_) {
+            if (param.second.is_active) {
+                active.push_back(&param.second);
+                current[param.first] = param.second.current_value;
+            }
+        }
+        const int dimension = static_cast<int>(active.size());
+        Eigen::VectorXd x(dimension), lower = Eigen::VectorXd::Zero(dimension), upper = Eigen::VectorXd::Ones(dimension);
+        std::vector<int> free;
+        const std::vector<double> start = encodeParameters(current);
+        for (int d = 0; d < dimension; ++d) {
+            const OptimizationParameter& param = *active[d];
+            const double range = param.max_value - param.min_value;
+            if (param.type != ParameterType::CONTINUOUS || !(range > 0.0)) {
+                lower[d] = upper[d] = start[d];
+                x[d] = start[d];
+                continue;
+            }
+            for (const auto& constraint : constraints_) {
+                if (constraint.second.is_hard_constraint && constraint.second.parameter == param.name) {
+                    lower[d] = std::max(lower[d], (constraint.second.min_limit - param.min_value) / range);
+                    upper[d] = std::min(upper[d], (constraint.second.max_limit - param.min_value) / range);
+                }
+            }
+            if (lower[d] > upper[d]) {
+                throw std::runtime_error("Hard constraints leave no feasible value of " + param.name);
+            }
+            x[d] = std::max(lower[d], std::min(upper[d], start[d]));
+            free.push_back(d);
+        }
+        if (free.empty()) {
+            throw std::runtime_error("Gradient optimization needs an active continuous parameter");
+        }
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                          "Starting L-BFGS-B optimization: " + std::to_string(free.size()) + 
+                          " continuous parameters, gradients by " +
+                          (differentiable_fitness_ ? "automatic differentiation" : "finite differences"),
+                          "ProcessOptimizer");
+        
+        auto project = [&](Eigen::VectorXd point) {
+            return point.cwiseMax(lower).cwiseMin(upper).eval();
+        };
+        auto record = [&](const OptimizationEvaluation& evaluation) {
+            results.evaluations.push_back(evaluation);
+            if (std::isfinite(evaluation.fitness_score) &&
+                (results.evaluations.size() == 1 || evaluation.fitness_score > results.best_solution.fitness_score)) {
+                results.best_solution = evaluation;
+            }
+        };
+        
+        // Minimizes f = -fitness; the gradient is in normalized coordinates
+        const double h = std::max(gradient_params_.finite_difference_step,
+                                  evaluation_cache_ ? 100.0 * cache_resolution_ : 0.0);
+        auto evaluate = [&](const Eigen::VectorXd& point, Eigen::VectorXd& gradient) {
+            gradient = Eigen::VectorXd::Zero(dimension);
+            const std::vector<double> encoded(point.data(), point.data() + dimension);
+            if (differentiable_fitness_) {
+                const auto decoded = decodeParameters(encoded);
+                const int count = static_cast<int>(free.size());
+                std::unordered_map<std::string, ADScalar> inputs;
+                for (const auto& param : parameters_) {
+                    inputs[param.first] = adConstant(param.second.current_value, count);
+                }
+                for (const auto& value : decoded) {
+                    inputs[value.first] = adConstant(value.second, count);
+                }
+                for (int k = 0; k < count; ++k) {
+                    // d(value)/d(normalized) is the range
+                    const OptimizationParameter& param = *active[free[k]];
+                    inputs[param.name] = ADScalar(decoded.at(param.name),
+                                                  (param.max_value - param.min_value) * Eigen::VectorXd::Unit(count, k));
+                }
+                const ADScalar fitness = differentiable_fitness_(inputs);
+                OptimizationEvaluation evaluation;
+                evaluation.parameters = decoded;
+                evaluation.fitness_score = fitness.value();
+                evaluation.is_feasible = checkConstraints(decoded);
+                record(evaluation);
+                for (int k = 0; k < count && fitness.derivatives().size() == count; ++k) {
+                    gradient[free[k]] = -fitness.derivatives()[k];
+                }
+                return -fitness.value();
+            }
+            
+            // The point and a pair of neighbours per free parameter in one batch
+            std::vector<std::unordered_map<std::string, double>> batch{decodeParameters(encoded)};
+            std::vector<double> spans;
+            for (int d : free) {
+                std::vector<double> forward = encoded, backward = encoded;
+                forward[d] = std::min(upper[d], point[d] + h);
+                backward[d] = std::max(lower[d], point[d] - h);
+                spans.push_back(forward[d] - backward[d]);
+                batch.push_back(decodeParameters(forward));
+                batch.push_back(decodeParameters(backward));
+            }
+            const auto evaluations = evaluateBatch(wafer, process_type, batch);
+            for (const auto& evaluation : evaluations) {
+                record(evaluation);
+            }
+            for (size_t k = 0; k < free.size(); ++k) {
+                if (spans[k] > 0.0) {
+                    gradient[free[k]] = -(evaluations[2 * k + 1].fitness_score -
+                                          evaluations[2 * k + 2].fitness_score) / spans[k];
+                }
+            }
+            return -evaluations.front().fitness_score;
+        };
+        // The gradient with the components pushing out of the box zeroed
+        auto projectedGradient = [&](const Eigen::VectorXd& point, const Eigen::VectorXd& gradient) {
+            Eigen::VectorXd projected = gradient;
+            for (int d = 0; d < dimension; ++d) {
+                if ((point[d] <= lower[d] && gradient[d] > 0.0) || (point[d] >= upper[d] && gradient[d] < 0.0)) {
+                    projected[d] = 0.0;
+                }
+            }
+            return projected;
+        };
+        auto budgetLeft = [&]() {
+            return static_cast<int>(results.evaluations.size()) < max_evaluations_;
+        };
+        
+        Eigen::VectorXd g;
+        double f = evaluate(x, g);
+        std::vector<Eigen::VectorXd> s_history, y_history;
+        std::vector<double> rho_history;
+        int small_steps = 0;
+        for (int iteration = 0; iteration < gradient_params_.max_iterations && budgetLeft(); ++iteration) {
+            const Eigen::VectorXd pg = projectedGradient(x, g);
+            if (!std::isfinite(f) || !pg.allFinite() || pg.lpNorm<Eigen::Infinity>() < convergence_tolerance_) {
+                results.has_converged = std::isfinite(f);
+                break;
+            }
+            
+            // Two-loop recursion on the projected gradient; the parameters
+            // held at a bound stay there
+            Eigen::VectorXd q = pg;
+            std::vector<double> alpha(s_history.size());
+            for (int i = static_cast<int>(s_history.size()) - 1; i >= 0; --i) {
+                alpha[i] = rho_history[i] * s_history[i].dot(q);
+                q -= alpha[i] * y_history[i];
+            }
+            if (!s_history.empty()) {
+                q *= s_history.back().dot(y_history.back()) / y_history.back().squaredNorm();
+            }
+            for (size_t i = 0; i < s_history.size(); ++i) {
+                const double beta = rho_history[i] * y_history[i].dot(q);
+                q += (alpha[i] - beta) * s_history[i];
+            }
+            Eigen::VectorXd direction = -q;
+            for (int d = 0; d < dimension; ++d) {
+                if (pg[d] == 0.0) direction[d] = 0.0;
+            }
+            if (!(direction.dot(pg) < 0.0)) {
+                s_history.clear();
+                y_history.clear();
+                rho_history.clear();
+                direction = -pg;
+            }
+            
+            // Projected backtracking to the Armijo condition; the first
+            // step without curvature pairs moves at most a tenth of the box
+            double step = s_history.empty() ? std::min(1.0, 0.1 / direction.lpNorm<Eigen::Infinity>()) : 1.0;
+            Eigen::VectorXd x_next, g_next;
+            double f_next = f;
+            bool accepted = false;
+            for (int trial = 0; trial < 20 && budgetLeft(); ++trial, step *= 0.5) {
+                x_next = project(x + step * direction);
+                if ((x_next - x).lpNorm<Eigen::Infinity>() < 1e-12) break;
+                f_next = evaluate(x_next, g_next);
+                if (f_next <= f + 1e-4 * g.dot(x_next - x)) {
+                    accepted = true;
+                    break;
+                }
+            }
+            if (!accepted) {
+                if (s_history.empty()) {
+                    results.has_converged = true;
+                    break;
+                }
+                s_history.clear();
+                y_history.clear();
+                rho_history.clear();
+                continue;
+            }
+            
+            const Eigen::VectorXd s = x_next - x, y = g_next - g;
+            if (s.dot(y) > 1e-10 * s.norm() * y.norm()) {
+                if (static_cast<int>(s_history.size()) >= std::max(1, gradient_params_.memory)) {
+                    s_history.erase(s_history.begin());
+                    y_history.erase(y_history.begin());
+                    rho_history.erase(rho_history.begin());
+                }
+                s_history.push_back(s);
+                y_history.push_back(y);
+                rho_history.push_back(1.0 / s.dot(y));
+            }
+            
+            // Converged once three steps in a row gain less than the tolerance
+            const bool small = f - f_next < convergence_tolerance_ * (1.0 + std::abs(f));
+            small_steps = small ? small_steps + 1 : 0;
+            x = x_next;
+            g = g_next;
+            f = f_next;
+            if (small_steps >= 3) {
+                results.has_converged = true;
+                break;
+            }
+        }
+        
+        // With a differentiable fitness only the optimum is simulated
+        if (differentiable_fitness_) {
+            const auto evaluation = evaluateBatch(wafer, process_type, {results.best_solution.parameters}).front();
+            results.best_solution.objectives = evaluation.objectives;
+            results.best_solution.constraints = evaluation.constraints;
+            results.best_solution.evaluation_time = evaluation.evaluation_time;
+        }
+        results.convergence_metric = projectedGradient(x, g).lpNorm<Eigen::Infinity>();
+        results.total_evaluations = static_cast<int>(results.evaluations.size());
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                          "L-BFGS-B optimization completed: best fitness = " +
+                          std::to_string(results.best_solution.fitness_score) +
+                          " after " + std::to_string(results.total_evaluations) + " evaluations",
+                          "ProcessOptimizer");
+        
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::ADVANCED,
+                          "Gradient optimization failed: " + std::string(e.what()),
+                          "ProcessOptimizer");
+    }
+    
+    return results;
+}
+
+void ProcessOptimizer::refineSweep(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const std::string& process_type,
+    const std::vector<std::string>& parameter_names,
+    const std::vector<std::vector<double>>& axes,
+    ProcessOptimizationResults& results) {
+    
+    using Point = std::vector<double>;
+    struct Cell {
+        Point low;
+        Point high;
+    };
+    const size_t dimension = parameter_names.size();
+    std::map<Point, double> fitness;
+    for (const auto& evaluation : results.evaluations) {
+        Point point(dimension);
+        for (size_t d = 0; d < dimension; ++d) {
+            point[d] = evaluation.parameters.at(parameter_names[d]);
+        }
+        fitness[point] = evaluation.fitness_score;
+    }
+    
+    // One cell between each pair of neighbouring values on every axis
+    std::vector<Cell> cells;
+    std::vector<size_t> intervals;
+    for (const auto& axis : axes) {
+        intervals.push_back(axis.size() > 1 ? axis.size() - 1 : 0);
+    }
+    forEachIndex(intervals, [&](const std::vector<size_t>& index) {
+        Cell cell{Point(dimension), Point(dimension)};
+        for (size_t d = 0; d < dimension; ++d) {
+            cell.low[d] = axes[d][index[d]];
+            cell.high[d] = axes[d][index[d] + 1];
+        }
+        cells.push_back(std::move(cell));
+    });
+    
+    // The spread of fitness over a cell's corners, infinite between a
+    // feasible simulation and a failed one
+    const std::vector<size_t> two_each(dimension, 2);
+    auto spread = [&](const Cell& cell) {
+        double lowest = std::numeric_limits<double>::infinity();
+        double highest = -lowest;
+        bool failed = false;
+        forEachIndex(two_each, [&](const std::vector<size_t>& corner) {
+            Point point(dimension);
+            for (size_t d = 0; d < dimension; ++d) {
+                point[d] = corner[d] ? cell.high[d] : cell.low[d];
+            }
+            const auto found = fitness.find(point);
+            if (found == fitness.end() || !std::isfinite(found->second)) {
+                failed = true;
+            } else {
+                lowest = std::min(lowest, found->second);
+                highest = std::max(highest, found->second);
+            }
+        });
+        if (failed) {
+            return highest >= lowest ? std::numeric_limits<double>::infinity() : 0.0;
+        }
+        return highest - lowest;
+    };
+    
+    for (int round = 0; round < sweep_refinements_; ++round) {
+        if (static_cast<int>(results.evaluations.size()) >= max_evaluations_) {
+            break;
+        }
+        std::vector<std::pair<double, size_t>> ranked;
+        for (size_t i = 0; i < cells.size(); ++i) {
+            const double score = spread(cells[i]);
+            if (score > 0.0) {
+                ranked.emplace_back(score, i);
+            }
+        }
+        if (ranked.empty()) {
+            break;
+        }
+        const size_t count = std::min(ranked.size(), std::max<size_t>(1, static_cast<size_t>(
+            std::ceil(sweep_refined_fraction_ * cells.size()))));
+        std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+                          [](const auto& a, const auto& b) { return a.first > b.first; });
+        
+        // Each chosen cell halves along every parameter whose midpoint
+        // quantizes strictly between its ends; one already at its
+        // parameter's step is left whole along it
+        std::vector<bool> replaced(cells.size(), false);
+        std::vector<Cell> children;
+        std::set<Point> fresh;
+        for (size_t k = 0; k < count; ++k) {
+            const Cell& cell = cells[ranked[k].second];
+            std::vector<std::vector<double>> values(dimension);
+            std::vector<size_t> sizes(dimension);
+            bool divisible = false;
+            for (size_t d = 0; d < dimension; ++d) {
+                const double middle = quantizeParameter(parameters_[parameter_names[d]],
+                                                        0.5 * (cell.low[d] + cell.high[d]));
+                if (middle > cell.low[d] && middle < cell.high[d]) {
+                    values[d] = {cell.low[d], middle, cell.high[d]};
+                    divisible = true;
+                } else {
+                    values[d] = {cell.low[d], cell.high[d]};
+                }
+                sizes[d] = values[d].size();
+            }
+            replaced[ranked[k].second] = true;
+            if (!divisible) {
+                continue;
+            }
+            forEachIndex(sizes, [&](const std::vector<size_t>& index) {
+                Point point(dimension);
+                for (size_t d = 0; d < dimension; ++d) {
+                    point[d] = values[d][index[d]];
+                }
+                if (!fitness.count(point)) {
+                    fresh.insert(point);
+                }
+            });
+            std::vector<size_t> halves(dimension);
+            for (size_t d = 0; d < dimension; ++d) {
+                halves[d] = sizes[d] - 1;
+            }
+            forEachIndex(halves, [&](const std::vector<size_t>& index) {
+                Cell child{Point(dimension), Point(dimension)};
+                for (size_t d = 0; d < dimension; ++d) {
+                    child.low[d] = values[d][index[d]];
+                    child.high[d] = values[d][index[d] + 1];
+                }
+                children.push_back(std::move(child));
+            });
+        }
+        std::vector<Cell> next;
+        for (size_t i = 0; i < cells.size(); ++i) {
+            if (!replaced[i]) {
+                next.push_back(std::move(cells[i]));
+            }
+        }
+        next.insert(next.end(), children.begin(), children.end());
+        cells = std::move(next);
+        
+        std::vector<Point> points(fresh.begin(), fresh.end());
+        std::vector<std::unordered_map<std::string, double>> batch;
+        for (const auto& point : points) {
+            std::unordered_map<std::string, double> params;
+            for (size_t d = 0; d < dimension; ++d) {
+                params[parameter_names[d]] = point[d];
+            }
+            batch.push_back(std::move(params));
+        }
+        const auto evaluations = evaluateBatch(wafer, process_type, batch);
+        for (size_t i = 0; i < points.size(); ++i) {
+            fitness[points[i]] = evaluations[i].fitness_score;
+            results.evaluations.push_back(evaluations[i]);
+        }
+        
+        SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::ADVANCED,
+                          "Sweep refinement " + std::to_string(round + 1) + ": split " +
+                          std::to_string(count) + " cells, " + std::to_string(points.size()) + " new points",
+                          "ProcessOptimizer");
+    }
+}
+
+ProcessOptimizationResults ProcessOptimizer::hyperbandOptimization(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const std::string& process_type,
+    const std::vector<OptimizationObjective>& objectives) {
+
+    SEMIPRO_PERF_TIMER("hyperband", "ProcessOptimizer");
+
+    ProcessOptimizationResults results;
+    
+    try {
+        const double eta = std::max(2.0, hyperband_params_.eta);
+        const double min_fidelity = std::max(1e-6, std::min(1.0, hyperband_params_.min_fidelity));
+        // Rungs below the full fidelity; the tolerance keeps 1/27 at three
+        // for eta = 3
+        const int top = static_cast<int>(std::floor(std::log(1.0 / min_fidelity) / std::log(eta) + 1e-9));
+        const double budget = static_cast<double>(max_evaluations_);
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                          "Starting Hyperband: " + std::to_string(top + 1) + " fidelities, eta=" +
+                          std::to_string(eta) + ", budget=" + std::to_string(max_evaluations_),
+                          "ProcessOptimizer");
+        
+        simulations_ = 0;
+        const double cost_before = simulation_cost_;
+        double best_fitness = -std::numeric_limits<double>::infinity();
+        
+        // Brackets in turn from the most candidates started at the lowest
+        // fidelity to the fewest started at the full one, so a fidelity
+        // that ranks poorly still leaves some candidates judged in full
+        for (int bracket = 0; simulation_cost_ - cost_before < budget; ++bracket) {
+            const int s = top - bracket % (top + 1);
+            const double spent_before = simulation_cost_;
+            std::vector<std::vector<double>> candidates(static_cast<size_t>(
+                std::ceil((top + 1.0) / (s + 1.0) * std::pow(eta, s))));
+            for (auto& x : candidates) {
+                x = generateRandomParameters();
+            }
+            for (int rung = 0; rung <= s; ++rung) {
+                const double fidelity = rung == s ? 1.0 : std::pow(eta, rung - s);
+                std::vector<std::unordered_map<std::string, double>> batch;
+                for (const auto& x : candidates) {
+                    batch.push_back(decodeParameters(x));
+                }
+                const auto evaluations = evaluateBatch(wafer, process_type, batch, fidelity);
+                results.evaluations.insert(results.evaluations.end(), evaluations.begin(), evaluations.end());
+                if (rung == s) {
+                    for (const auto& evaluation : evaluations) {
+                        if (std::isfinite(evaluation.fitness_score) && evaluation.fitness_score > best_fitness) {
+                            best_fitness = evaluation.fitness_score;
+                            results.best_solution = evaluation;
+                        }
+                    }
+                    break;
+                }
+                
+                // The best 1 / eta go up a rung, failed simulations last
+                std::vector<size_t> order(candidates.size());
+                std::iota(order.begin(), order.end(), 0);
+                auto rank = [&](size_t i) {
+                    return std::isfinite(evaluations[i].fitness_score) ? evaluations[i].fitness_score
+                                                                        : -std::numeric_limits<double>::infinity();
+                };
+                const size_t kept = std::max<size_t>(1, static_cast<size_t>(std::floor(candidates.size() / eta)));
+                std::partial_sort(order.begin(), order.begin() + kept, order.end(),
+                                  [&](size_t a, size_t b) { return rank(a) > rank(b); });
+                std::vector<std::vector<double>> promoted;
+                for (size_t k = 0; k < kept; ++k) {
+                    promoted.push_back(std::move(candidates[order[k]]));
+                }
+                candidates = std::move(promoted);
+            }
+            // A bracket served wholly by the evaluation cache brings no
+            // closer to the budget
+            if (simulation_cost_ == spent_before) {
+                break;
+            }
+        }
+        
+        results.total_evaluations = simulations_;
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
+                          "Hyperband completed: best fitness = " + std::to_string(best_fitness) +
+                          " after " + std::to_string(simulations_) + " simulations costing " +
+                          std::to_string(simulation_cost_ - cost_before) + " full ones",
+                          "ProcessOptimizer");
+        
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::ADVANCED,
+                          "Hyperband failed: " + std::string(e.what()),
+                          "ProcessOptimizer");
+    }
+    
+    return results;
 }
 
 ProcessOptimizationResults ProcessOptimizer::simulatedAnnealingOptimization(
@@ -678,6 +2099,70 @@ std::unordered_map<std::string, double> ProcessOptimizer::analyzeOptimizationRes
     return statistics;
 }
 
+void ProcessOptimizer::setGAParameters(const GAParameters& params) {
+    ga_params_ = params;
+}
+
+void ProcessOptimizer::setPSParameters(const PSParameters& params) {
+    ps_params_ = params;
+}
+
+void ProcessOptimizer::setBOParameters(const BOParameters& params) {
+    bo_params_ = params;
+}
+
+void ProcessOptimizer::setGradientParameters(const GradientParameters& params) {
+    gradient_params_ = params;
+}
+
+void ProcessOptimizer::setHyperbandParameters(const HyperbandParameters& params) {
+    hyperband_params_ = params;
+}
+
+void ProcessOptimizer::setDifferentiableFitness(DifferentiableFitness fitness) {
+    differentiable_fitness_ = std::move(fitness);
+}
+
+void ProcessOptimizer::setProcessEvaluator(ProcessEvaluator evaluator) {
+    process_evaluator_ = std::move(evaluator);
+}
+
+void ProcessOptimizer::enableAdaptiveSweep(int refinements, double refined_fraction) {
+    sweep_refinements_ = std::max(0, refinements);
+    sweep_refined_fraction_ = std::max(0.0, std::min(1.0, refined_fraction));
+}
+
+void ProcessOptimizer::enableSurrogateScreening(bool enable, double simulated_fraction) {
+    enable_surrogate_screening_ = enable;
+    screening_fraction_ = std::max(0.0, std::min(1.0, simulated_fraction));
+}
+
+void ProcessOptimizer::enableEvaluationCache(bool enable, const std::string& cache_dir, double resolution) {
+    cache_resolution_ = resolution > 0.0 ? resolution : 1e-6;
+    if (!enable) {
+        evaluation_cache_.reset();
+        return;
+    }
+    evaluation_cache_ = cache_dir.empty() ? SimulationEngine::getInstance().getResultCache() : nullptr;
+    if (!evaluation_cache_) {
+        evaluation_cache_ = std::make_shared<SimulationCache>(cache_dir, size_t(1) << 30, 64 * 1024 * 1024);
+    }
+}
+
+void ProcessOptimizer::setConvergenceTolerance(double tolerance) {
+    convergence_tolerance_ = tolerance;
+}
+
+void ProcessOptimizer::setMaxEvaluations(int max_evals) {
+    max_evaluations_ = max_evals;
+}
+
+void ProcessOptimizer::enableFeatures(bool parallel, bool adaptive, bool constraints) {
+    enable_parallel_evaluation_ = parallel;
+    enable_adaptive_parameters_ = adaptive;
+    enable_constraint_handling_ = constraints;
+}
+
 bool ProcessOptimizer::validateOptimizationSetup(std::string& error_message) const {
     if (parameters_.empty()) {
         error_message = "No optimization parameters defined";
@@ -723,6 +2208,7 @@ std::vector<std::string> ProcessOptimizer::getDiagnostics() const {
     diagnostics.push_back("  Parallel Evaluation: " + std::string(enable_parallel_evaluation_ ? "Enabled" : "Disabled"));
     diagnostics.push_back("  Adaptive Parameters: " + std::string(enable_adaptive_parameters_ ? "Enabled" : "Disabled"));
     diagnostics.push_back("  Constraint Handling: " + std::string(enable_constraint_handling_ ? "Enabled" : "Disabled"));
+    diagnostics.push_back("  Evaluation Cache: " + std::string(evaluation_cache_ ? "Enabled" : "Disabled"));
 
     return diagnostics;
 }
@@ -771,6 +2257,49 @@ namespace OptimizationUtils {
         return (denominator > 0.0) ? numerator / denominator : 0.0;
     }
 
+    bool isDominated(const OptimizationEvaluation& a, const OptimizationEvaluation& b) {
+        std::vector<double> point_a, point_b;
+        for (const auto& entry : sortedEntries(a.objectives)) {
+            const auto other = b.objectives.find(entry.first);
+            if (other == b.objectives.end()) {
+                return false;
+            }
+            point_a.push_back(objectiveSign(entry.first) * entry.second);
+            point_b.push_back(objectiveSign(entry.first) * other->second);
+        }
+        return dominates(point_b, point_a);
+    }
+
+    std::vector<OptimizationEvaluation> findParetoFront(const std::vector<OptimizationEvaluation>& solutions) {
+        std::vector<std::string> keys;
+        for (const auto& solution : solutions) {
+            for (const auto& entry : solution.objectives) {
+                keys.push_back(entry.first);
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        
+        std::vector<std::vector<double>> points;
+        for (const auto& solution : solutions) {
+            std::vector<double> point;
+            for (const auto& key : keys) {
+                const auto value = solution.objectives.find(key);
+                point.push_back(value == solution.objectives.end() ? std::numeric_limits<double>::infinity()
+                                                                   : objectiveSign(key) * value->second);
+            }
+            points.push_back(std::move(point));
+        }
+        const auto ranks = nonDominatedRanks(points);
+        std::vector<OptimizationEvaluation> front;
+        for (size_t i = 0; i < solutions.size(); ++i) {
+            if (ranks[i] == 0) {
+                front.push_back(solutions[i]);
+            }
+        }
+        return front;
+    }
+
 } // namespace OptimizationUtils
 
 } // namespace SemiPRO
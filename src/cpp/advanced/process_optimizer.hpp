@@ -4,8 +4,13 @@
 #include "../core/enhanced_error_handling.hpp"
 #include "../core/config_manager.hpp"
 #include "../core/wafer_enhanced.hpp"
+#include "../core/performance_utils.hpp"
+#include "../core/autodiff.hpp"
+#include "../core/result_store.hpp"
 #include "multi_layer_engine.hpp"
 #include "temperature_controller.hpp"
+#include "gaussian_process.hpp"
+#include "pareto_sorting.hpp"
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -33,7 +38,8 @@ enum class OptimizationAlgorithm {
     GRADIENT_DESCENT,     // Gradient descent optimization
     BAYESIAN_OPTIMIZATION, // Bayesian optimization
     MULTI_OBJECTIVE_GA,   // Multi-objective genetic algorithm
-    DIFFERENTIAL_EVOLUTION // Differential evolution
+    DIFFERENTIAL_EVOLUTION, // Differential evolution
+    HYPERBAND             // Successive halving up a ladder of fidelities
 };
 
 // Use the OptimizationObjective from multi_layer_engine.hpp to avoid duplication
@@ -87,8 +93,9 @@ struct OptimizationEvaluation {
     bool is_feasible;             // Whether solution is feasible
     double evaluation_time;       // Time taken for evaluation (seconds)
     std::string evaluation_id;    // Unique evaluation identifier
+    double fidelity;              // Of the simulation, in (0, 1]; 1 is the full model
     
-    OptimizationEvaluation() : fitness_score(0.0), is_feasible(true), evaluation_time(0.0) {}
+    OptimizationEvaluation() : fitness_score(0.0), is_feasible(true), evaluation_time(0.0), fidelity(1.0) {}
 };
 
 // Use the OptimizationResults from multi_layer_engine.hpp to avoid duplication
@@ -113,8 +120,9 @@ struct GAIndividual {
     std::vector<double> genes;    // Parameter values (genes)
     double fitness;               // Fitness score
     bool is_evaluated;            // Whether fitness has been evaluated
+    bool is_predicted;            // Fitness from the surrogate rather than a simulation
     
-    GAIndividual() : fitness(0.0), is_evaluated(false) {}
+    GAIndividual() : fitness(0.0), is_evaluated(false), is_predicted(false) {}
 };
 
 // Genetic algorithm population
@@ -129,6 +137,18 @@ struct GAPopulation {
 };
 
 // Process optimization engine
+// Fitness of a parameter set as a differentiable model, the parameters
+// in their own units; see ProcessOptimizer::setDifferentiableFitness()
+using DifferentiableFitness = std::function<ADScalar(const std::unordered_map<std::string, ADScalar>&)>;
+
+// Objectives of a parameter set simulated at a fidelity in (0, 1]: 1 is
+// the full model, and lower levels cost about that fraction of it, e.g.
+// through a grid downsampled by it, that fraction of the Monte Carlo ions
+// or Gaussian in place of Hopkins imaging; see
+// ProcessOptimizer::setProcessEvaluator()
+using ProcessEvaluator = std::function<std::unordered_map<std::string, double>(
+    std::shared_ptr<WaferEnhanced>, const std::string&, const std::unordered_map<std::string, double>&, double)>;
+
 class ProcessOptimizer {
 private:
     std::unordered_map<std::string, OptimizationParameter> parameters_;
@@ -159,6 +179,47 @@ private:
         double social_weight = 2.0;
     } ps_params_;
     
+    struct BOParameters {
+        int initial_samples = 0;      // Latin hypercube start; 0 picks two per parameter plus one
+        int max_evaluations = 60;     // Simulations in all, within max_evaluations_
+        int batch_size = 1;           // Picks per step, simulated in parallel
+        int candidates = 2000;        // Candidates screened by expected improvement per pick
+        double exploration = 0.01;    // Expected improvement's margin, in fitness standard deviations
+    } bo_params_;
+    
+    struct GradientParameters {
+        int memory = 8;                       // L-BFGS correction pairs kept
+        int max_iterations = 200;
+        double finite_difference_step = 1e-4; // Of a parameter's range, without a differentiable fitness
+    } gradient_params_;
+    
+    struct HyperbandParameters {
+        double min_fidelity = 1.0 / 27.0; // Lowest rung of the ladder
+        double eta = 3.0;                 // Fidelity ratio between rungs; 1 / eta of the candidates go up each
+    } hyperband_params_;
+    
+    DifferentiableFitness differentiable_fitness_;
+    ProcessEvaluator process_evaluator_;
+    double simulation_cost_ = 0.0;    // Simulations of the current run, in full-fidelity equivalents
+    
+    // Refinement of grid sweeps
+    int sweep_refinements_ = 0;
+    double sweep_refined_fraction_ = 0.25;
+    
+    // Surrogate of the fitness over the normalized parameters, fed every
+    // simulation of the current run
+    GaussianProcess surrogate_;
+    bool enable_surrogate_screening_ = false;
+    double screening_fraction_ = 0.25;
+    int simulations_ = 0;             // evaluateProcess() calls in the current run
+    
+    // Evaluations filed by wafer state, process and quantized parameters
+    std::shared_ptr<SimulationCache> evaluation_cache_;
+    double cache_resolution_ = 1e-6;  // Of a continuous parameter's range
+    int cache_hits_ = 0;              // Evaluations served by the cache or a duplicate
+    
+    std::shared_ptr<ResultStore> result_store_;
+    
     // Configuration
     bool enable_parallel_evaluation_ = true;
     bool enable_adaptive_parameters_ = true;
@@ -184,6 +245,9 @@ public:
         const std::vector<OptimizationObjective>& objectives
     );
 
+    // A grid over one or two parameters, or random samples over more.
+    // With adaptive sweeps, the grid's cells then split where the fitness
+    // changes most across their corners; see enableAdaptiveSweep()
     ProcessOptimizationResults parameterSweep(
         std::shared_ptr<WaferEnhanced> wafer,
         const std::string& process_type,
@@ -202,28 +266,66 @@ public:
         const std::vector<OptimizationObjective>& objectives
     );
 
+    // Bayesian optimization: a Gaussian process surrogate of the fitness,
+    // and each step simulates the candidates of highest expected
+    // improvement over the best simulated so far
+    ProcessOptimizationResults bayesianOptimization(
+        std::shared_ptr<WaferEnhanced> wafer,
+        const std::string& process_type,
+        const std::vector<OptimizationObjective>& objectives
+    );
+
+    // Projected L-BFGS (L-BFGS-B) over the continuous parameters, from
+    // their current values, within their ranges narrowed by the hard
+    // constraints; the other parameters stay at their current values.
+    // Gradients come from the differentiable fitness by automatic
+    // differentiation when one is set, otherwise from central differences
+    // of evaluateProcess() batched through evaluateBatch(), one-sided at
+    // the bounds
+    ProcessOptimizationResults gradientOptimization(
+        std::shared_ptr<WaferEnhanced> wafer,
+        const std::string& process_type,
+        const std::vector<OptimizationObjective>& objectives
+    );
+
+    // Hyperband: brackets of successive halving, from many random
+    // candidates at the lowest fidelity to a few at the full one, each
+    // rung simulating the best 1 / eta of the one below at eta times its
+    // fidelity, until max evaluations' worth of full-fidelity simulations
+    // are spent; the best is taken among the full-fidelity simulations
+    ProcessOptimizationResults hyperbandOptimization(
+        std::shared_ptr<WaferEnhanced> wafer,
+        const std::string& process_type,
+        const std::vector<OptimizationObjective>& objectives
+    );
+
     ProcessOptimizationResults simulatedAnnealingOptimization(
         std::shared_ptr<WaferEnhanced> wafer,
         const std::string& process_type,
         OptimizationObjective objective
     );
     
-    // Multi-objective optimization
+    // Multi-objective optimization: NSGA-II over the GA's operators, with
+    // fronts from non-dominated sorting and a Pareto archive of every
+    // feasible evaluation, returned as the Pareto front
     ProcessOptimizationResults multiObjectiveOptimization(
         std::shared_ptr<WaferEnhanced> wafer,
         const std::string& process_type,
         const std::vector<OptimizationObjective>& objectives
     );
     
+    // The feasible evaluations no other feasible one dominates in the
+    // objectives of the current run
     std::vector<OptimizationEvaluation> calculateParetoFront(
         const std::vector<OptimizationEvaluation>& evaluations
     );
     
-    // Process evaluation
+    // Process evaluation, through the process evaluator when one is set
     OptimizationEvaluation evaluateProcess(
         std::shared_ptr<WaferEnhanced> wafer,
         const std::string& process_type,
-        const std::unordered_map<std::string, double>& parameters
+        const std::unordered_map<std::string, double>& parameters,
+        double fidelity = 1.0
     );
     
     double calculateFitness(
@@ -255,9 +357,55 @@ public:
     // Configuration and tuning
     void setGAParameters(const GAParameters& params);
     void setPSParameters(const PSParameters& params);
+    void setBOParameters(const BOParameters& params);
+    void setGradientParameters(const GradientParameters& params);
+    void setHyperbandParameters(const HyperbandParameters& params);
+    // A differentiable model of the fitness for gradientOptimization(),
+    // e.g. one built on EnhancedOxidationPhysics::calculateDifferentiableThickness
+    // or EnhancedDopingPhysics::calculateGaussianImplant instantiated on
+    // ADScalar; it stands in for evaluateProcess() there, whose objectives
+    // are only evaluated at the optimum. An empty function clears it.
+    void setDifferentiableFitness(DifferentiableFitness fitness);
+    // With screening, the GA and PSO rank each generation's new candidates
+    // by the surrogate (mean plus one standard deviation) once it has
+    // enough samples, simulate only the leading simulated_fraction of them
+    // and give the rest their predicted fitness
+    void enableSurrogateScreening(bool enable, double simulated_fraction = 0.25);
+    // Simulates the process for evaluateProcess() at the requested
+    // fidelity, in place of the built-in model; with parallel evaluation it
+    // is called from several threads at once, each on its own wafer clone.
+    // An empty function clears it.
+    void setProcessEvaluator(ProcessEvaluator evaluator);
+    // Grid sweeps then take `refinements` rounds that split the
+    // refined_fraction of cells whose corners' fitness differs most (cells
+    // between feasible and failed simulations first) into halves along
+    // each parameter, simulating only the new corners and centres, so the
+    // budget goes to steep slopes, ridges and feasibility edges rather than
+    // flat ground. Zero refinements turns it off.
+    void enableAdaptiveSweep(int refinements, double refined_fraction = 0.25);
+    // Memoizes evaluateProcess(): an evaluation of the same process on an
+    // identical wafer state, with parameters equal after quantization
+    // (discrete and integer ones to their step, continuous ones to
+    // `resolution` of their range), is served from the cache, and a batch
+    // evaluates each distinct parameter set once. With an empty cache_dir
+    // the evaluations are filed in the SimulationEngine's result cache
+    // when it is enabled, beside the process steps, and are kept across
+    // runs if that is; otherwise in a cache of their own, on disk when
+    // cache_dir is set. Evaluations are taken to be deterministic.
+    void enableEvaluationCache(bool enable, const std::string& cache_dir = "", double resolution = 1e-6);
+    bool isEvaluationCacheEnabled() const { return evaluation_cache_ != nullptr; }
+    // Every simulated evaluation is then appended to the store as it
+    // finishes, from the evaluating thread: source "optimizer", label the
+    // process type, with groups "parameter", "objective", "constraint" and
+    // "evaluation" (fitness, feasible, fidelity). Cache hits are not
+    // simulated and not recorded. Null stops recording.
+    void setResultStore(std::shared_ptr<ResultStore> store) { result_store_ = std::move(store); }
     void setConvergenceTolerance(double tolerance);
     void setMaxEvaluations(int max_evals);
     
+    // With parallel evaluation, a GA population or PSO swarm is evaluated
+    // as independent tasks on the TaskScheduler, each on its own clone of
+    // the wafer
     void enableFeatures(bool parallel = true, bool adaptive = true, bool constraints = true);
     
     // Validation and diagnostics
@@ -274,8 +422,51 @@ private:
     
     // Utility functions
     std::vector<double> generateRandomParameters();
+    // Active parameters normalized to [0, 1] after quantization, NaN for
+    // one missing from params; decoding quantizes too, so genes that
+    // differ within a step decode to the same parameter set
     std::vector<double> encodeParameters(const std::unordered_map<std::string, double>& params);
     std::unordered_map<std::string, double> decodeParameters(const std::vector<double>& encoded);
+    double quantizeParameter(const OptimizationParameter& param, double value) const;
+    // An evaluation's objectives as a point to minimize, one coordinate
+    // per objective of the run (uniformity, yield and cost without any);
+    // a missing objective counts as infinitely bad
+    std::vector<double> objectivePoint(const OptimizationEvaluation& evaluation) const;
+    // Evaluation cache key of a parameter set on a wafer state
+    CacheKey evaluationKey(const CacheKey& wafer_state, const std::string& process_type,
+                           const std::unordered_map<std::string, double>& parameters, double fidelity);
+    
+    // evaluateProcess() of every parameter set, in order. In parallel mode
+    // each runs as its own task on a clone of the wafer, so idle workers
+    // take the next evaluation while a slow one is still running;
+    // otherwise they run in turn on the wafer itself. With the evaluation
+    // cache, only the distinct parameter sets it misses are simulated.
+    std::vector<OptimizationEvaluation> evaluateBatch(
+        std::shared_ptr<WaferEnhanced> wafer,
+        const std::string& process_type,
+        const std::vector<std::unordered_map<std::string, double>>& batch,
+        double fidelity = 1.0
+    );
+    // evaluateBatch() of normalized candidates, feeding the surrogate; with
+    // screening on, only the surrogate's leading candidates are simulated
+    // and `simulated` is cleared for the others, whose evaluations carry
+    // the predicted fitness
+    std::vector<OptimizationEvaluation> evaluateScreened(
+        std::shared_ptr<WaferEnhanced> wafer,
+        const std::string& process_type,
+        const std::vector<std::vector<double>>& candidates,
+        std::vector<bool>& simulated
+    );
+    
+    // The adaptive rounds of a grid sweep over `axes`, the values each
+    // named parameter was swept through, adding to results
+    void refineSweep(
+        std::shared_ptr<WaferEnhanced> wafer,
+        const std::string& process_type,
+        const std::vector<std::string>& parameter_names,
+        const std::vector<std::vector<double>>& axes,
+        ProcessOptimizationResults& results
+    );
     
     // Constraint handling
     bool checkConstraints(const std::unordered_map<std::string, double>& parameters);
@@ -297,7 +488,10 @@ namespace OptimizationUtils {
     double calculateCorrelation(const std::vector<double>& x, const std::vector<double>& y);
     
     // Pareto analysis
+    // Whether b dominates a in a's objectives, uniformity, yield and
+    // electrical maximized and the others minimized
     bool isDominated(const OptimizationEvaluation& a, const OptimizationEvaluation& b);
+    // The solutions no other one dominates, by non-dominated sorting
     std::vector<OptimizationEvaluation> findParetoFront(const std::vector<OptimizationEvaluation>& solutions);
     double calculateHypervolume(const std::vector<OptimizationEvaluation>& pareto_front);
     
@@ -1,7 +1,11 @@
 #include "temperature_controller.hpp"
+#include "../core/adaptive_ode.hpp"
+#include "../core/vector_math.hpp"
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <random>
+#include <stdexcept>
 
 namespace SemiPRO {
 
@@ -34,6 +38,14 @@ void AdvancedTemperatureController::createCyclingProfile(const std::string& prof
                       "TemperatureController");
 }
 
+void AdvancedTemperatureController::createSpatialConfig(const std::string& config_id,
+                                                        const SpatialTemperatureConfig& config) {
+    spatial_configs_[config_id] = config;
+    if (config_id == pattern_config_id_) {
+        pattern_wafer_.reset();
+    }
+}
+
 bool AdvancedTemperatureController::startTemperatureControl(
     std::shared_ptr<WaferEnhanced> wafer,
     const std::string& profile_id,
@@ -83,36 +95,12 @@ bool AdvancedTemperatureController::executeTemperatureProfile(
                                                   "Temperature profile not found: " + profile_id, "PROFILE_NOT_FOUND"));
         }
         
-        const auto& ramp = ramp_it->second;
-        
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
                           "Executing temperature profile: " + profile_id + 
                           " for " + std::to_string(duration_minutes) + " minutes",
                           "TemperatureController");
         
-        // Simulate temperature profile execution
-        double time_step = 0.1; // 0.1 minute steps
-        int num_steps = static_cast<int>(duration_minutes / time_step);
-        
-        for (int step = 0; step < num_steps; ++step) {
-            double time_elapsed = step * time_step;
-            
-            // Calculate current temperature based on ramp profile
-            current_temperature_ = calculateRampTemperature(ramp, time_elapsed);
-            
-            // Apply spatial temperature if enabled
-            if (enable_spatial_gradients_) {
-                applySpatialTemperatureUniform(wafer, current_temperature_);
-            }
-            
-            // Model thermal effects if enabled
-            if (enable_thermal_coupling_) {
-                modelThermalEffectsSimplified(wafer, current_temperature_);
-            }
-        }
-        
-        // Final temperature
-        current_temperature_ = ramp.end_temperature;
+        followProfile(wafer, buildProfile({profile_id}), duration_minutes);
         
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
                           "Temperature profile execution completed. Final temperature: " + 
@@ -151,25 +139,8 @@ bool AdvancedTemperatureController::executeThermalCycling(
                           std::to_string(cycle.max_temperature) + "°C)",
                           "TemperatureController");
         
-        // Execute thermal cycles
-        for (int cycle_num = 0; cycle_num < cycle.num_cycles; ++cycle_num) {
-            // Heat up phase
-            executeRampPhase(wafer, current_temperature_, cycle.max_temperature, 10.0); // 10°C/min ramp
-            
-            // Hold at high temperature
-            holdTemperature(wafer, cycle.max_temperature, cycle.dwell_time_hot);
-            
-            // Cool down phase
-            executeRampPhase(wafer, cycle.max_temperature, cycle.min_temperature, -10.0); // -10°C/min ramp
-            
-            // Hold at low temperature
-            holdTemperature(wafer, cycle.min_temperature, cycle.dwell_time_cold);
-            
-            SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::ADVANCED,
-                              "Completed thermal cycle " + std::to_string(cycle_num + 1) + "/" + 
-                              std::to_string(cycle.num_cycles),
-                              "TemperatureController");
-        }
+        const ThermalProfile profile = buildCycleProfile(cycle_id);
+        followProfile(wafer, profile, profile.duration());
         
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::ADVANCED,
                           "Thermal cycling completed successfully",
@@ -194,7 +165,7 @@ TemperatureResults AdvancedTemperatureController::analyzeTemperatureUniformity(
     results.temperature_error = std::abs(current_temperature_ - target_temperature_);
     
     // Calculate spatial temperature profile (simplified)
-    auto grid = wafer->getGrid();
+    const auto& grid = wafer->getGrid();
     int rows = grid.rows();
     int cols = grid.cols();
     
@@ -271,6 +242,164 @@ double AdvancedTemperatureController::calculateRampTemperature(
     }
 }
 
+void AdvancedTemperatureController::applySpatialTemperature(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const std::string& spatial_config_id) {
+    
+    auto config_it = spatial_configs_.find(spatial_config_id);
+    if (config_it == spatial_configs_.end()) {
+        throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION,
+                                              "Spatial configuration not found: " + spatial_config_id, "CONFIG_NOT_FOUND"));
+    }
+    scaleSpatialTemperature(wafer, spatial_config_id, config_it->second.center_temperature, 1.0);
+}
+
+void AdvancedTemperatureController::scaleSpatialTemperature(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const std::string& spatial_config_id,
+    double base_temperature,
+    double amplitude) {
+    
+    auto config_it = spatial_configs_.find(spatial_config_id);
+    if (config_it == spatial_configs_.end()) {
+        throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION,
+                                              "Spatial configuration not found: " + spatial_config_id, "CONFIG_NOT_FOUND"));
+    }
+    const FieldStore& fields = wafer->getFieldStore();
+    const bool pattern_held = pattern_wafer_.lock() == wafer && pattern_config_id_ == spatial_config_id &&
+                              fields.isMaterialized(fields.channelIndex("lattice_temperature_pattern"));
+    if (pattern_held) {
+        wafer->scaleTemperaturePattern(base_temperature, amplitude);
+    } else {
+        wafer->setTemperaturePattern(base_temperature, amplitude,
+                                     spatialKernel(config_it->second, fields.rows(), fields.cols(), wafer->getDiameter()));
+        pattern_wafer_ = wafer;
+        pattern_config_id_ = spatial_config_id;
+    }
+    current_temperature_ = base_temperature;
+}
+
+std::function<void(int, int, int, int, FieldView&)> AdvancedTemperatureController::spatialKernel(
+    const SpatialTemperatureConfig& config,
+    int rows,
+    int cols,
+    double diameter_mm) const {
+    
+    // Cell centres in mm from the wafer centre; a column is contiguous, so
+    // each column of a block is one vectorized pass
+    const double radius = 0.5 * diameter_mm;
+    const double dy = diameter_mm / std::max(rows, 1), dx = diameter_mm / std::max(cols, 1);
+    auto columnX = [=](int j) { return (j + 0.5) * dx - radius; };
+    const double drop = config.edge_temperature - config.center_temperature;
+    
+    switch (config.distribution_type) {
+        case SpatialDistributionType::RADIAL_GRADIENT:
+            // Linear in radius, center to edge
+            return [=](int r0, int c0, int h, int w, FieldView& pattern) {
+                for (int j = c0; j < c0 + w; ++j) {
+                    const double x2 = columnX(j) * columnX(j);
+                    double* out = &pattern(r0, j);
+                    #pragma omp simd
+                    for (int i = 0; i < h; ++i) {
+                        const double y = (r0 + i + 0.5) * dy - radius;
+                        out[i] = drop * std::sqrt(x2 + y * y) / radius;
+                    }
+                }
+            };
+        case SpatialDistributionType::LINEAR_GRADIENT:
+            // gradient_strength across the columns
+            return [=](int r0, int c0, int h, int w, FieldView& pattern) {
+                for (int j = c0; j < c0 + w; ++j) {
+                    pattern.block(r0, j, h, 1).setConstant(config.gradient_strength * columnX(j));
+                }
+            };
+        case SpatialDistributionType::EDGE_COOLING:
+        case SpatialDistributionType::CENTER_HEATING: {
+            // Edge cooling decays inward over a tenth of the radius; center
+            // heating is a Gaussian of 0.3 radii, reaching the edge value
+            // at the rim
+            const bool edge = config.distribution_type == SpatialDistributionType::EDGE_COOLING;
+            const double length = (edge ? 0.1 : 0.3) * radius;
+            return [=](int r0, int c0, int h, int w, FieldView& pattern) {
+                for (int j = c0; j < c0 + w; ++j) {
+                    const double x2 = columnX(j) * columnX(j);
+                    double* out = &pattern(r0, j);
+                    #pragma omp simd
+                    for (int i = 0; i < h; ++i) {
+                        const double y = (r0 + i + 0.5) * dy - radius;
+                        const double r2 = x2 + y * y;
+                        out[i] = edge ? (std::sqrt(r2) - radius) / length : -0.5 * r2 / (length * length);
+                    }
+                    VectorMath::exp(out, out, h);
+                    const double scale = edge ? drop : -drop;
+                    const double offset = edge ? 0.0 : drop;
+                    #pragma omp simd
+                    for (int i = 0; i < h; ++i) {
+                        out[i] = offset + scale * out[i];
+                    }
+                }
+            };
+        }
+        case SpatialDistributionType::ZONE_BASED: {
+            // Linear between zones given as (radius in mm, temperature)
+            auto zones = config.zone_temperatures;
+            std::sort(zones.begin(), zones.end());
+            if (zones.empty()) {
+                zones.emplace_back(0.0, config.center_temperature);
+            }
+            const double center = config.center_temperature;
+            return [=](int r0, int c0, int h, int w, FieldView& pattern) {
+                for (int j = c0; j < c0 + w; ++j) {
+                    const double x2 = columnX(j) * columnX(j);
+                    for (int i = 0; i < h; ++i) {
+                        const double y = (r0 + i + 0.5) * dy - radius;
+                        const double r = std::sqrt(x2 + y * y);
+                        auto next = std::upper_bound(zones.begin(), zones.end(), std::make_pair(r, -HUGE_VAL));
+                        double temperature;
+                        if (next == zones.begin()) {
+                            temperature = zones.front().second;
+                        } else if (next == zones.end()) {
+                            temperature = zones.back().second;
+                        } else {
+                            const auto& a = *(next - 1);
+                            const double f = (r - a.first) / (next->first - a.first);
+                            temperature = a.second + f * (next->second - a.second);
+                        }
+                        pattern(r0 + i, j) = temperature - center;
+                    }
+                }
+            };
+        }
+        case SpatialDistributionType::HOTSPOT_MODEL: {
+            // A Gaussian at hotspot_locations "x", "y" (mm) of width
+            // "radius" (mm, a tenth of the wafer's by default) and peak
+            // "amplitude" (°C, the edge-center difference by default)
+            auto value = [&](const char* key, double fallback) {
+                auto it = config.hotspot_locations.find(key);
+                return it == config.hotspot_locations.end() ? fallback : it->second;
+            };
+            const double hx = value("x", 0.0), hy = value("y", 0.0);
+            const double width = value("radius", 0.1 * radius), peak = value("amplitude", drop);
+            return [=](int r0, int c0, int h, int w, FieldView& pattern) {
+                for (int j = c0; j < c0 + w; ++j) {
+                    const double offset = (columnX(j) - hx) / width;
+                    double* out = &pattern(r0, j);
+                    #pragma omp simd
+                    for (int i = 0; i < h; ++i) {
+                        out[i] = (r0 + i + 0.5) * dy - radius;
+                    }
+                    VectorMath::gaussian(out, out, h, hy, width, peak * std::exp(-0.5 * offset * offset));
+                }
+            };
+        }
+        case SpatialDistributionType::UNIFORM:
+        default:
+            return [](int r0, int c0, int h, int w, FieldView& pattern) {
+                pattern.block(r0, c0, h, w).setZero();
+            };
+    }
+}
+
 void AdvancedTemperatureController::applySpatialTemperatureUniform(
     std::shared_ptr<WaferEnhanced> wafer,
     double temperature) {
@@ -296,36 +425,348 @@ void AdvancedTemperatureController::modelThermalEffectsSimplified(
     // This would modify the wafer grid to account for thermal expansion
 }
 
-void AdvancedTemperatureController::executeRampPhase(
-    std::shared_ptr<WaferEnhanced> wafer,
-    double start_temp,
-    double end_temp,
-    double ramp_rate) {
+double AdvancedTemperatureController::calculateThermalBudget(
+    const std::vector<double>& temperature_profile,
+    const std::vector<double>& time_profile) const {
+    
+    if (temperature_profile.size() != time_profile.size()) {
+        throw std::invalid_argument("Temperature and time profiles differ in length");
+    }
+    
+    // Trapezoid of °C·min, as TemperatureUtils::calculateThermalBudget
+    double thermal_budget = 0.0;
+    for (size_t i = 1; i < time_profile.size(); ++i) {
+        thermal_budget += (temperature_profile[i - 1] + temperature_profile[i]) / 2.0 *
+                          (time_profile[i] - time_profile[i - 1]);
+    }
+    return thermal_budget;
+}
+
+TemperatureSchedule AdvancedTemperatureController::buildSchedule(
+    const std::vector<std::string>& profile_ids) const {
+    
+    const int exponential_knots = 16;
+    TemperatureSchedule schedule;
+    for (const auto& profile_id : profile_ids) {
+        auto ramp_it = ramp_profiles_.find(profile_id);
+        if (ramp_it == ramp_profiles_.end()) {
+            throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION,
+                                                  "Temperature profile not found: " + profile_id, "PROFILE_NOT_FOUND"));
+        }
+        const auto& ramp = ramp_it->second;
+        
+        if (schedule.empty()) {
+            schedule.add(0.0, ramp.start_temperature);
+        } else if (schedule.temperatures().back() != ramp.start_temperature) {
+            schedule.add(schedule.end(), ramp.start_temperature);
+        }
+        
+        const double rise = ramp.end_temperature - ramp.start_temperature;
+        if (ramp.mode == TemperatureControlMode::EXPONENTIAL_RAMP && rise != 0.0) {
+            // calculateRampTemperature's curve, which steps the last 5% to
+            // the end temperature once the ramp time is up
+            const double begin = schedule.end();
+            const double ramp_time = std::abs(rise) / ramp.ramp_rate;
+            for (int knot = 1; knot <= exponential_knots; ++knot) {
+                const double elapsed = ramp_time * knot / exponential_knots;
+                schedule.add(begin + elapsed, calculateRampTemperature(ramp, elapsed));
+            }
+            schedule.ramp(ramp.end_temperature, std::numeric_limits<double>::infinity(), ramp.hold_time);
+        } else {
+            schedule.ramp(ramp.end_temperature, std::copysign(ramp.ramp_rate, rise), ramp.hold_time);
+        }
+    }
+    return schedule;
+}
+
+double AdvancedTemperatureController::calculateDiffusionBudget(
+    const TemperatureSchedule& schedule,
+    double activation_energy,
+    double reference_temperature) const {
+    
+    if (schedule.empty()) {
+        return 0.0;
+    }
+    const double k_boltzmann = 8.617e-5; // eV/K
+    const double reference_kelvin = reference_temperature + 273.15;
+    auto rate = [&](double minutes, const AdaptiveOde::Vector&) {
+        const double kelvin = schedule.temperature(minutes) + 273.15;
+        return AdaptiveOde::Vector::Constant(
+            1, std::exp(-activation_energy * (1.0 / kelvin - 1.0 / reference_kelvin) / k_boltzmann));
+    };
+    AdaptiveOde::Options options;
+    options.absolute = 1e-9; // Minutes; cold stretches add next to nothing
+    return AdaptiveOde::integrate(rate, schedule.start(), schedule.end(), AdaptiveOde::Vector::Zero(1),
+                                  schedule.times(), options)(0);
+}
+
+double AdvancedTemperatureController::calculateDiffusionBudget(
+    const ThermalProfile& profile,
+    double activation_energy,
+    double reference_temperature) const {
     
-    double ramp_time = std::abs(end_temp - start_temp) / std::abs(ramp_rate);
-    double time_step = 0.1; // 0.1 minute steps
-    int num_steps = static_cast<int>(ramp_time / time_step);
+    if (profile.empty()) {
+        return 0.0;
+    }
+    const double k_boltzmann = 8.617e-5; // eV/K
+    const double reference_kelvin = reference_temperature + 273.15;
+    auto rate = [&](double minutes, const AdaptiveOde::Vector&) {
+        const double kelvin = profile.temperature(minutes) + 273.15;
+        return AdaptiveOde::Vector::Constant(
+            1, std::exp(-activation_energy * (1.0 / kelvin - 1.0 / reference_kelvin) / k_boltzmann));
+    };
+    AdaptiveOde::Options options;
+    options.absolute = 1e-9; // Minutes; cold stretches add next to nothing
+    return AdaptiveOde::integrate(rate, profile.start(), profile.end(), AdaptiveOde::Vector::Zero(1),
+                                  profile.breakpoints(), options)(0);
+}
+
+double AdvancedTemperatureController::calculateThermalBudget(const ThermalProfile& profile) const {
+    return profile.integral(profile.start(), profile.end());
+}
+
+ThermalProfile AdvancedTemperatureController::buildProfile(
+    const std::vector<std::string>& profile_ids) const {
     
-    for (int step = 0; step <= num_steps; ++step) {
-        double progress = static_cast<double>(step) / num_steps;
-        current_temperature_ = start_temp + (end_temp - start_temp) * progress;
+    ThermalProfile profile;
+    for (size_t i = 0; i < profile_ids.size(); ++i) {
+        auto ramp_it = ramp_profiles_.find(profile_ids[i]);
+        if (ramp_it == ramp_profiles_.end()) {
+            throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION,
+                                                  "Temperature profile not found: " + profile_ids[i], "PROFILE_NOT_FOUND"));
+        }
+        const auto& ramp = ramp_it->second;
+        if (i == 0) {
+            profile = ThermalProfile(ramp.start_temperature);
+        } else {
+            profile.step(ramp.start_temperature);
+        }
         
+        const double rise = ramp.end_temperature - ramp.start_temperature;
+        if (ramp.mode == TemperatureControlMode::EXPONENTIAL_RAMP && rise != 0.0) {
+            // Three time constants over the ramp time, then the last 5%
+            // as a step, as calculateRampTemperature has it
+            const double ramp_time = std::abs(rise) / ramp.ramp_rate;
+            profile.exponential(ramp_time, ramp.end_temperature, ramp_time / 3.0);
+            profile.step(ramp.end_temperature);
+            profile.hold(ramp.hold_time);
+        } else {
+            profile.ramp(ramp.end_temperature, ramp.ramp_rate, ramp.hold_time);
+        }
+    }
+    return profile;
+}
+
+ThermalProfile AdvancedTemperatureController::buildCycleProfile(const std::string& cycle_id) const {
+    auto cycle_it = cycling_profiles_.find(cycle_id);
+    if (cycle_it == cycling_profiles_.end()) {
+        throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION,
+                                              "Thermal cycle not found: " + cycle_id, "CYCLE_NOT_FOUND"));
+    }
+    const auto& cycle = cycle_it->second;
+    
+    const double ramp_rate = 10.0; // °C/min each way
+    ThermalProfile profile(current_temperature_);
+    for (int cycle_num = 0; cycle_num < cycle.num_cycles; ++cycle_num) {
+        profile.ramp(cycle.max_temperature, ramp_rate, cycle.dwell_time_hot);
+        profile.ramp(cycle.min_temperature, ramp_rate, cycle.dwell_time_cold);
+    }
+    return profile;
+}
+
+void AdvancedTemperatureController::accumulateThermalFatigue(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const std::string& cycle_id,
+    ThermalFatigueCounter& counter,
+    double step_minutes) const {
+    
+    if (!(step_minutes > 0.0)) {
+        throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION,
+                                              "Fatigue sampling step must be positive", "INVALID_STEP"));
+    }
+    const ThermalProfile profile = buildCycleProfile(cycle_id);
+    const FieldStore& fields = wafer->getFieldStore();
+    const int pattern_channel = fields.channelIndex("lattice_temperature_pattern");
+    const bool patterned = pattern_channel >= 0 && fields.isMaterialized(pattern_channel);
+    auto sample = [&](double time) {
+        if (patterned) {
+            counter.addSample(profile.temperature(time), wafer->getTemperaturePattern());
+        } else {
+            counter.addSample(profile.temperature(time));
+        }
+    };
+    
+    // Reversals of the ramps and holds fall on segment boundaries; the
+    // steps between them only matter for curved segments
+    double previous = 0.0;
+    sample(previous);
+    for (double knot : profile.breakpoints()) {
+        if (knot <= previous) {
+            continue;
+        }
+        const int steps = static_cast<int>(std::ceil((knot - previous) / step_minutes));
+        for (int s = 1; s <= steps; ++s) {
+            sample(previous + (knot - previous) * s / steps);
+        }
+        previous = knot;
+    }
+}
+
+void AdvancedTemperatureController::followProfile(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const ThermalProfile& profile,
+    double duration_minutes) {
+    
+    for (double time : profile.breakpoints()) {
+        if (time >= duration_minutes) {
+            break;
+        }
+        current_temperature_ = profile.temperature(time);
+        if (enable_spatial_gradients_) {
+            applySpatialTemperatureUniform(wafer, current_temperature_);
+        }
         if (enable_thermal_coupling_) {
             modelThermalEffectsSimplified(wafer, current_temperature_);
         }
     }
+    current_temperature_ = profile.temperature(duration_minutes);
 }
 
-void AdvancedTemperatureController::holdTemperature(
+void AdvancedTemperatureController::createPIDController(const std::string& controller_id, const PIDParameters& params) {
+    pid_controllers_[controller_id] = params;
+}
+
+TemperatureResults AdvancedTemperatureController::pidControl(
     std::shared_ptr<WaferEnhanced> wafer,
-    double temperature,
-    double hold_time_minutes) {
+    const std::string& controller_id,
+    double current_temp,
+    double time_step_seconds) {
     
-    current_temperature_ = temperature;
+    auto pid_it = pid_controllers_.find(controller_id);
+    if (pid_it == pid_controllers_.end()) {
+        throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION,
+                                              "PID controller not found: " + controller_id, "CONTROLLER_NOT_FOUND"));
+    }
+    const auto& params = pid_it->second;
+    
+    TemperatureResults results;
+    results.current_temperature = current_temp;
+    results.target_temperature = params.setpoint;
+    results.temperature_error = params.setpoint - current_temp;
+    results.thermal_metrics["pid_output"] = calculatePIDOutput(results.temperature_error, time_step_seconds, params);
+    return results;
+}
+
+double AdvancedTemperatureController::calculatePIDOutput(
+    double error,
+    double time_step_seconds,
+    const PIDParameters& params) {
+    
+    pid_integral_ = std::max(-params.integral_limit,
+                             std::min(params.integral_limit, pid_integral_ + error * time_step_seconds));
+    const double derivative = time_step_seconds > 0.0 ? (error - pid_previous_error_) / time_step_seconds : 0.0;
+    pid_previous_error_ = error;
+    const double output = params.kp * error + params.ki * pid_integral_ + params.kd * derivative;
+    return std::max(params.output_limit_min, std::min(params.output_limit_max, output));
+}
+
+PIDResponse AdvancedTemperatureController::simulatePIDResponse(
+    const std::string& controller_id,
+    const ThermalProfile& setpoint,
+    double initial_temperature,
+    double time_constant_minutes) const {
+    
+    auto pid_it = pid_controllers_.find(controller_id);
+    if (pid_it == pid_controllers_.end()) {
+        throw SemiPROException(SimulationError(ErrorSeverity::ERROR, ErrorCategory::VALIDATION,
+                                              "PID controller not found: " + controller_id, "CONTROLLER_NOT_FOUND"));
+    }
+    if (!(time_constant_minutes > 0.0)) {
+        throw std::invalid_argument("Plant time constant must be positive");
+    }
+    const PIDParameters& pid = pid_it->second;
+    const double tau = time_constant_minutes;
+    
+    // State: temperature, ∫e dt (°C·s), ∫|e| dt (°C·min). With the plant
+    // T' = (u - T) / tau the derivative term's dT/dt depends on u itself;
+    // solving for u gives the unsaturated output in closed form.
+    auto error = [&](double t, const AdaptiveOde::Vector& y) { return setpoint.temperature(t) - y(0); };
+    auto demand = [&](double t, const AdaptiveOde::Vector& y) {
+        return (pid.kp * error(t, y) + pid.ki * y(1) + pid.kd * (setpoint.slope(t) + y(0) / tau) / 60.0) /
+               (1.0 + pid.kd / (60.0 * tau));
+    };
+    
+    // The loop's regime, fixed between events: output saturated high (1),
+    // low (-1) or not (0); integral held at its limit; sign of the error
+    struct Regime {
+        int saturation = 0;
+        bool clamped = false;
+        double sign = 1.0;
+    };
+    auto regimeAt = [&](double t, const AdaptiveOde::Vector& y) {
+        Regime regime;
+        const double u = demand(t, y), e = error(t, y);
+        regime.saturation = u >= pid.output_limit_max ? 1 : (u <= pid.output_limit_min ? -1 : 0);
+        regime.clamped = (y(1) >= pid.integral_limit && e > 0.0) || (y(1) <= -pid.integral_limit && e < 0.0);
+        regime.sign = e >= 0.0 ? 1.0 : -1.0;
+        return regime;
+    };
+    Regime regime;
+    auto output = [&](double t, const AdaptiveOde::Vector& y) {
+        return regime.saturation > 0 ? pid.output_limit_max
+             : regime.saturation < 0 ? pid.output_limit_min : demand(t, y);
+    };
+    auto rhs = [&](double t, const AdaptiveOde::Vector& y) {
+        const double e = error(t, y);
+        AdaptiveOde::Vector dy(3);
+        dy << (output(t, y) - y(0)) / tau, regime.clamped ? 0.0 : 60.0 * e, regime.sign * e;
+        return dy;
+    };
+    // Regime switches, then the error's slope for its extrema
+    auto events = [&](double t, const AdaptiveOde::Vector& y) {
+        const double u = demand(t, y);
+        AdaptiveOde::Vector g(6);
+        g << u - pid.output_limit_max, u - pid.output_limit_min, y(1) - pid.integral_limit,
+             y(1) + pid.integral_limit, error(t, y), setpoint.slope(t) - (output(t, y) - y(0)) / tau;
+        return g;
+    };
     
-    if (enable_thermal_coupling_) {
-        modelThermalEffectsSimplified(wafer, current_temperature_);
+    PIDResponse response;
+    AdaptiveOde::Vector y(3);
+    y << initial_temperature, 0.0, 0.0;
+    auto record = [&](double t) {
+        regime = regimeAt(t, y);
+        response.times.push_back(t);
+        response.temperatures.push_back(y(0));
+        response.setpoints.push_back(setpoint.temperature(t));
+        response.outputs.push_back(output(t, y));
+        response.max_overshoot = std::max(response.max_overshoot, -error(t, y));
+    };
+    
+    AdaptiveOde::Options options;
+    options.relative = 1e-8;
+    options.absolute = 1e-9;
+    options.initial_step = time_step_ / 60.0;
+    double t = 0.0;
+    record(t);
+    const std::vector<double> breakpoints = setpoint.breakpoints();
+    for (size_t piece = 1; piece < breakpoints.size(); ++piece) {
+        const double end = breakpoints[piece];
+        while (t < end) {
+            if (static_cast<int>(response.times.size()) > options.max_steps) {
+                throw std::runtime_error("PID response switches too often to follow");
+            }
+            AdaptiveOde::Stop stop = AdaptiveOde::integrateUntil(rhs, events, t, end, y, {}, options);
+            t = stop.time;
+            y = std::move(stop.y);
+            if (stop.event >= 0 && stop.event < 4) {
+                response.switches++;
+            }
+            record(t);
+        }
     }
+    response.integrated_absolute_error = y(2);
+    return response;
 }
 
 void AdvancedTemperatureController::setTemperature(double temperature) {
@@ -333,6 +774,13 @@ void AdvancedTemperatureController::setTemperature(double temperature) {
     target_temperature_ = temperature;
 }
 
+void AdvancedTemperatureController::setTimeStep(double time_step_seconds) {
+    if (!(time_step_seconds > 0.0)) {
+        throw std::invalid_argument("Time step must be positive");
+    }
+    time_step_ = time_step_seconds;
+}
+
 void AdvancedTemperatureController::enableFeatures(bool spatial, bool cycling, bool pid, bool coupling) {
     enable_spatial_gradients_ = spatial;
     enable_thermal_cycling_ = cycling;
@@ -551,37 +999,23 @@ namespace TemperatureUtils {
     }
 
     std::vector<double> generateLinearRamp(double start_temp, double end_temp, int num_points) {
-        std::vector<double> ramp(num_points);
-
-        for (int i = 0; i < num_points; ++i) {
-            double progress = static_cast<double>(i) / (num_points - 1);
-            ramp[i] = start_temp + (end_temp - start_temp) * progress;
-        }
-
-        return ramp;
+        ThermalProfile ramp(start_temp);
+        ramp.linear(1.0, end_temp);
+        return ramp.sample(num_points);
     }
 
     std::vector<double> generateExponentialRamp(double start_temp, double end_temp, double time_constant, int num_points) {
-        std::vector<double> ramp(num_points);
-
-        for (int i = 0; i < num_points; ++i) {
-            double time = static_cast<double>(i) / (num_points - 1);
-            double progress = 1.0 - std::exp(-time / time_constant);
-            ramp[i] = start_temp + (end_temp - start_temp) * progress;
-        }
-
-        return ramp;
+        // Over unit time
+        ThermalProfile ramp(start_temp);
+        ramp.exponential(1.0, end_temp, time_constant);
+        return ramp.sample(num_points);
     }
 
     std::vector<double> generateSinusoidalCycle(double mean_temp, double amplitude, double period, int num_points) {
-        std::vector<double> cycle(num_points);
-
-        for (int i = 0; i < num_points; ++i) {
-            double time = static_cast<double>(i) / (num_points - 1) * period;
-            cycle[i] = mean_temp + amplitude * std::sin(2.0 * M_PI * time / period);
-        }
-
-        return cycle;
+        // One period
+        ThermalProfile cycle(mean_temp);
+        cycle.sinusoid(period, amplitude, period);
+        return cycle.sample(num_points);
     }
 
 } // namespace TemperatureUtils
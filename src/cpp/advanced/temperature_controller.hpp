@@ -4,6 +4,9 @@
 #include "../core/enhanced_error_handling.hpp"
 #include "../core/config_manager.hpp"
 #include "../core/wafer_enhanced.hpp"
+#include "../core/temperature_schedule.hpp"
+#include "../core/thermal_profile.hpp"
+#include "../core/thermal_fatigue.hpp"
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -127,6 +130,20 @@ struct TemperatureResults {
                           uniformity(100.0), stability(0.0) {}
 };
 
+// Closed-loop response of a PID controller driving a first-order thermal
+// plant, recorded at the setpoint's segment boundaries, at each switch of
+// the loop (the output saturating or leaving saturation, the integral
+// reaching its limit) and at each extremum of the error
+struct PIDResponse {
+    std::vector<double> times;           // Minutes
+    std::vector<double> temperatures;    // Plant temperature (°C)
+    std::vector<double> setpoints;       // Setpoint (°C)
+    std::vector<double> outputs;         // Controller output (°C)
+    int switches = 0;                    // Saturation and windup switches located
+    double max_overshoot = 0.0;          // Largest excess of temperature over setpoint (°C)
+    double integrated_absolute_error = 0.0; // ∫|setpoint - temperature| dt (°C·min)
+};
+
 // Advanced temperature controller
 class AdvancedTemperatureController {
 private:
@@ -151,7 +168,11 @@ private:
     bool enable_thermal_cycling_ = true;
     bool enable_pid_control_ = true;
     bool enable_thermal_coupling_ = true;
-    double time_step_ = 0.1; // seconds
+    double time_step_ = 0.1; // seconds; the first step of adaptive integration
+    
+    // The wafer and configuration whose pattern that wafer's field store holds
+    std::weak_ptr<WaferEnhanced> pattern_wafer_;
+    std::string pattern_config_id_;
     
 public:
     AdvancedTemperatureController();
@@ -187,6 +208,8 @@ public:
         double time_elapsed_minutes
     );
     
+    // One discrete PID step of time_step_seconds against the controller's
+    // setpoint; the output is in thermal_metrics["pid_output"]
     TemperatureResults pidControl(
         std::shared_ptr<WaferEnhanced> wafer,
         const std::string& controller_id,
@@ -194,12 +217,24 @@ public:
         double time_step_seconds
     );
     
-    // Spatial temperature management
+    // Spatial temperature management: the configuration's field written
+    // straight into the wafer's field store by its distribution's kernel
     void applySpatialTemperature(
         std::shared_ptr<WaferEnhanced> wafer,
         const std::string& spatial_config_id
     );
     
+    // base_temperature + amplitude * (the configuration's deviation from
+    // its center temperature), for gradients that follow a ramp. While the
+    // wafer still holds this configuration's pattern only the scaling pass
+    // runs; otherwise the pattern is computed first.
+    void scaleSpatialTemperature(
+        std::shared_ptr<WaferEnhanced> wafer,
+        const std::string& spatial_config_id,
+        double base_temperature,
+        double amplitude
+    );
+    
     std::vector<double> calculateSpatialProfile(
         const SpatialTemperatureConfig& config,
         int grid_rows,
@@ -237,6 +272,61 @@ public:
         const std::vector<double>& time_profile
     ) const;
     
+    // °C·min under the profile, integrated exactly segment by segment
+    double calculateThermalBudget(const ThermalProfile& profile) const;
+    
+    // Ramp profiles run back to back as one schedule (minutes, °C). A
+    // profile starting away from where the last ended steps there first;
+    // exponential ramps are followed through knots along their curve.
+    TemperatureSchedule buildSchedule(const std::vector<std::string>& profile_ids) const;
+    
+    // The same recipe as analytic segments, exponential ramps exactly as
+    // calculateRampTemperature follows them
+    ThermalProfile buildProfile(const std::vector<std::string>& profile_ids) const;
+    
+    // executeThermalCycling's recipe, from the current temperature
+    ThermalProfile buildCycleProfile(const std::string& cycle_id) const;
+    
+    // Streams the cycle's recipe through a fatigue counter of the wafer's
+    // grid, sampled at every segment boundary and at most step_minutes
+    // apart in between; each cell follows the recipe plus the spatial
+    // pattern applySpatialTemperature left on the wafer, if any. Only the
+    // counter's state is kept, so thousands of cycles cost no memory.
+    void accumulateThermalFatigue(
+        std::shared_ptr<WaferEnhanced> wafer,
+        const std::string& cycle_id,
+        ThermalFatigueCounter& counter,
+        double step_minutes = 1.0
+    ) const;
+    
+    // Minutes at reference_temperature with the schedule's Dt for a
+    // diffusivity of activation energy Ea (eV): the integral of
+    // exp(-Ea (1/T - 1/T_ref) / k) over the schedule, taken adaptively
+    // between its knots rather than sampled at fixed steps
+    double calculateDiffusionBudget(
+        const TemperatureSchedule& schedule,
+        double activation_energy,
+        double reference_temperature
+    ) const;
+    double calculateDiffusionBudget(
+        const ThermalProfile& profile,
+        double activation_energy,
+        double reference_temperature
+    ) const;
+    
+    // The controller tracking the setpoint profile from initial_temperature,
+    // the plant relaxing toward the output with time_constant_minutes, over
+    // the profile's duration. Gains are per second, as in pidControl; the
+    // integral is clamped to ±integral_limit and the output to its limits.
+    // Integrated adaptively with every switch of the loop located as an
+    // event, so steps stay long wherever the loop is smooth.
+    PIDResponse simulatePIDResponse(
+        const std::string& controller_id,
+        const ThermalProfile& setpoint,
+        double initial_temperature,
+        double time_constant_minutes
+    ) const;
+    
     // Optimization and calibration
     TemperatureRamp optimizeRampProfile(
         double target_temperature,
@@ -284,19 +374,23 @@ private:
         double temperature
     );
 
-    void executeRampPhase(
+    // Steps through the profile's segment boundaries up to duration,
+    // applying the thermal effects at each, and ends at its temperature there
+    void followProfile(
         std::shared_ptr<WaferEnhanced> wafer,
-        double start_temp,
-        double end_temp,
-        double ramp_rate
-    );
-
-    void holdTemperature(
-        std::shared_ptr<WaferEnhanced> wafer,
-        double temperature,
-        double hold_time_minutes
+        const ThermalProfile& profile,
+        double duration_minutes
     );
     
+    // Writes the configuration's deviation from its center temperature
+    // into blocks of a rows x cols pattern spanning the wafer's diameter
+    std::function<void(int, int, int, int, FieldView&)> spatialKernel(
+        const SpatialTemperatureConfig& config,
+        int rows,
+        int cols,
+        double diameter_mm
+    ) const;
+    
     // Temperature calculation methods
     double calculateRampTemperature(
         const TemperatureRamp& ramp,
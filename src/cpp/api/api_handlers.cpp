@@ -0,0 +1,264 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "rest_server.hpp"
+#include "simulation_jobs.hpp"
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+namespace SemiPRO {
+
+namespace {
+
+HttpResponse jsonResponse(int status_code, const std::string& body) {
+    HttpResponse response;
+    response.status_code = status_code;
+    response.body = body;
+    return response;
+}
+
+HttpResponse errorResponse(int status_code, const std::string& message) {
+    return jsonResponse(status_code, JsonUtils::createErrorResponse(status_code, message));
+}
+
+void writeStatus(JsonWriter& json, const SimulationJobs::Status& status) {
+    json.beginObject();
+    json.key("id").string(status.id);
+    json.key("wafer").string(status.wafer);
+    json.key("process").string(status.process);
+    json.key("state").string(SimulationJobs::stateName(status.state));
+    json.key("seconds").number(status.seconds);
+    if (!status.error.empty()) {
+        json.key("error").string(status.error);
+    }
+    json.endObject();
+}
+
+std::string statusJson(const SimulationJobs::Status& status) {
+    std::string body;
+    JsonWriter json(body);
+    writeStatus(json, status);
+    return body;
+}
+
+std::string param(const HttpRequest& request, const std::string& key) {
+    auto it = request.query_params.find(key);
+    return it == request.query_params.end() ? std::string() : it->second;
+}
+
+// Body {"wafer", "process", "config"}; the process is fixed for the
+// per-process endpoints
+HttpResponse submitJob(const HttpRequest& request, std::string process) {
+    std::string wafer = "main_wafer";
+    JsonValue config;
+    try {
+        if (!request.body.empty()) {
+            const JsonValue body = JsonValue::parse(request.body);
+            if (const JsonValue* value = body.find("wafer")) {
+                wafer = value->asString();
+            }
+            if (process.empty() && body.find("process")) {
+                process = body["process"].asString();
+            }
+            config = body["config"];
+        }
+    } catch (const std::exception& e) {
+        return errorResponse(400, e.what());
+    }
+    if (process.empty()) {
+        return errorResponse(400, "No process given");
+    }
+    const std::string id = SimulationJobs::getInstance().submit(wafer, process, config);
+    std::string body;
+    JsonWriter(body).beginObject().key("id").string(id).key("state").string("queued").endObject();
+    HttpResponse response = jsonResponse(202, body);
+    response.headers["Location"] = "/api/simulations/" + id;
+    return response;
+}
+
+// A single "bytes=first-last", "bytes=first-" or "bytes=-suffix" range
+// over total bytes. Returns false for a range that cannot be served;
+// anything else, including several ranges, leaves [0, total).
+bool byteRange(const std::string& header, std::size_t total, std::size_t& first, std::size_t& end) {
+    first = 0;
+    end = total;
+    const std::string prefix = "bytes=";
+    if (header.compare(0, prefix.size(), prefix) != 0 || header.find(',') != std::string::npos) {
+        return true;
+    }
+    const std::string spec = header.substr(prefix.size());
+    const std::size_t dash = spec.find('-');
+    if (dash == std::string::npos) {
+        return true;
+    }
+    auto number = [&spec](std::size_t from, std::size_t to, std::size_t& value) {
+        const auto parsed = std::from_chars(spec.data() + from, spec.data() + to, value);
+        return from < to && parsed.ec == std::errc() && parsed.ptr == spec.data() + to;
+    };
+    std::size_t a = 0, b = 0;
+    const bool has_first = number(0, dash, a);
+    const bool has_last = number(dash + 1, spec.size(), b);
+    if (has_first) {
+        if (a >= total || (has_last && b < a)) {
+            return false;
+        }
+        first = a;
+        end = has_last ? std::min(b + 1, total) : total;
+    } else if (has_last && b > 0) {
+        first = total - std::min(b, total);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+HttpResponse fieldResponse(const HttpRequest& request, const SimulationResults& results, const std::string& name) {
+    const SimulationResults::Field* field = results.find(name);
+    const bool dopant = !field && name == "dopant";
+    if (!field && !dopant) {
+        return errorResponse(404, "No field " + name);
+    }
+    const int rows = dopant ? static_cast<int>(results.dopant_profile.size()) : field->snapshot.rows();
+    const int cols = dopant ? 1 : field->snapshot.cols();
+    const std::size_t row_bytes = static_cast<std::size_t>(cols) * sizeof(double);
+    const std::size_t total = static_cast<std::size_t>(rows) * row_bytes;
+
+    HttpResponse response;
+    response.content_type = "application/octet-stream";
+    response.headers["X-Shape"] = std::to_string(rows) + "," + std::to_string(cols);
+    response.headers["Accept-Ranges"] = "bytes";
+    std::size_t first = 0, end = total;
+    auto range = request.headers.find("range");
+    if (range != request.headers.end()) {
+        if (!byteRange(range->second, total, first, end)) {
+            response.status_code = 416;
+            response.headers["Content-Range"] = "bytes */" + std::to_string(total);
+            return response;
+        }
+        if (first > 0 || end < total) {
+            response.status_code = 206;
+            response.headers["Content-Range"] =
+                "bytes " + std::to_string(first) + "-" + std::to_string(end - 1) + "/" + std::to_string(total);
+        }
+    }
+    if (end == first) {
+        return response;
+    }
+
+    // Only the rows holding the range are copied out of the snapshot
+    const int row_begin = static_cast<int>(first / row_bytes);
+    const int row_end = static_cast<int>((end - 1) / row_bytes) + 1;
+    std::vector<double> values(static_cast<std::size_t>(row_end - row_begin) * cols);
+    if (dopant) {
+        std::copy(results.dopant_profile.data() + row_begin, results.dopant_profile.data() + row_end, values.data());
+    } else {
+        field->snapshot.copyBlock(row_begin, 0, row_end - row_begin, cols, values.data(), cols, true);
+    }
+    const char* bytes = reinterpret_cast<const char*>(values.data());
+    const std::size_t skip = first - static_cast<std::size_t>(row_begin) * row_bytes;
+    response.body.assign(bytes + skip, end - first);
+    return response;
+}
+
+} // namespace
+
+void ApiHandlers::registerSimulationRoutes(RestServer& server) {
+    server.post("/api/simulations", createSimulation);
+    server.get("/api/simulations", listSimulations);
+    server.get("/api/simulations/:id", getSimulation);
+    server.delete_("/api/simulations/:id", deleteSimulation);
+    // Copying a large field out takes a while; keep it off the event loops
+    server.offload("GET", "/api/simulations/:id/results", getSimulationResults);
+    server.post("/api/oxidation", runOxidation);
+    server.post("/api/doping", runDoping);
+    server.post("/api/deposition", runDeposition);
+    server.post("/api/etching", runEtching);
+    server.serveMetrics("/metrics");
+}
+
+HttpResponse ApiHandlers::createSimulation(const HttpRequest& request) {
+    return submitJob(request, "");
+}
+
+HttpResponse ApiHandlers::runOxidation(const HttpRequest& request) {
+    return submitJob(request, "oxidation");
+}
+
+HttpResponse ApiHandlers::runDoping(const HttpRequest& request) {
+    return submitJob(request, "doping");
+}
+
+HttpResponse ApiHandlers::runDeposition(const HttpRequest& request) {
+    return submitJob(request, "deposition");
+}
+
+HttpResponse ApiHandlers::runEtching(const HttpRequest& request) {
+    return submitJob(request, "etching");
+}
+
+HttpResponse ApiHandlers::getSimulation(const HttpRequest& request) {
+    SimulationJobs::Status status;
+    if (!SimulationJobs::getInstance().status(param(request, "id"), status)) {
+        return errorResponse(404, "No simulation " + param(request, "id"));
+    }
+    return jsonResponse(200, statusJson(status));
+}
+
+HttpResponse ApiHandlers::listSimulations(const HttpRequest&) {
+    const auto statuses = SimulationJobs::getInstance().list();
+    HttpResponse response = jsonResponse(200, "");
+    response.body.reserve(160 * statuses.size() + 32);
+    JsonWriter json(response.body);
+    json.beginObject().key("simulations").beginArray();
+    for (const auto& status : statuses) {
+        writeStatus(json, status);
+    }
+    json.endArray().endObject();
+    return response;
+}
+
+HttpResponse ApiHandlers::deleteSimulation(const HttpRequest& request) {
+    const std::string id = param(request, "id");
+    if (!SimulationJobs::getInstance().remove(id)) {
+        return errorResponse(404, "No simulation " + id);
+    }
+    std::string body;
+    JsonWriter(body).beginObject().key("id").string(id).key("deleted").boolean(true).endObject();
+    return jsonResponse(200, body);
+}
+
+HttpResponse ApiHandlers::getSimulationResults(const HttpRequest& request) {
+    const std::string id = param(request, "id");
+    SimulationJobs& jobs = SimulationJobs::getInstance();
+    SimulationJobs::Status status;
+    if (!jobs.status(id, status)) {
+        return errorResponse(404, "No simulation " + id);
+    }
+    const auto results = jobs.results(id);
+    if (!results) {
+        return jsonResponse(409, statusJson(status));
+    }
+    const std::string field = param(request, "field");
+    if (!field.empty()) {
+        return fieldResponse(request, *results, field);
+    }
+
+    std::string body;
+    JsonWriter json(body);
+    json.beginObject().key("id").string(id).key("fields").beginArray();
+    for (const auto& field : results->fields) {
+        json.beginObject();
+        json.key("name").string(field.name);
+        json.key("rows").integer(field.snapshot.rows());
+        json.key("cols").integer(field.snapshot.cols());
+        json.endObject();
+    }
+    json.beginObject();
+    json.key("name").string("dopant");
+    json.key("rows").integer(results->dopant_profile.size());
+    json.key("cols").integer(1);
+    json.endObject();
+    json.endArray().endObject();
+    return jsonResponse(200, body);
+}
+
+} // namespace SemiPRO
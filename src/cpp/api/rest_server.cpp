@@ -0,0 +1,1697 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "rest_server.hpp"
+#include "progress_events.hpp"
+#include "task_scheduler.hpp"
+#include "telemetry.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace SemiPRO {
+
+namespace {
+
+constexpr std::size_t kMaxHeadBytes = 64 << 10;
+constexpr std::size_t kMaxBodyBytes = 16 << 20;
+constexpr std::size_t kReadChunk = 16 << 10;
+constexpr std::size_t kMaxPendingOutput = 1 << 20; // Unsent bytes before a connection stops being read
+constexpr std::size_t kWebSocketBacklog = 64 << 10;  // Unsent bytes before WebSocket messages wait and coalesce
+constexpr std::size_t kMaxWaitingMessages = 4 << 20; // Waiting message bytes before a client is dropped
+constexpr std::size_t kMinDeflateBytes = 128;        // Smaller messages are sent uncompressed
+constexpr int kMaxEvents = 64;
+
+std::string systemError(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+std::string errorBody(const std::string& message) {
+    std::string body;
+    JsonWriter(body).beginObject().key("error").string(message).endObject();
+    return body;
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Percent-decoding; '+' is a space only in query strings
+std::string decode(std::string_view text, bool plus_is_space) {
+    std::string decoded;
+    decoded.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        const char c = text[i];
+        if (c == '%' && i + 2 < text.size() && hexDigit(text[i + 1]) >= 0 && hexDigit(text[i + 2]) >= 0) {
+            decoded += static_cast<char>(hexDigit(text[i + 1]) * 16 + hexDigit(text[i + 2]));
+            i += 2;
+        } else {
+            decoded += plus_is_space && c == '+' ? ' ' : c;
+        }
+    }
+    return decoded;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+std::string lowercase(std::string_view text) {
+    std::string lowered(text);
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lowered;
+}
+
+// Splits off the text before the first `separator`, consuming it
+std::string_view split(std::string_view& text, char separator) {
+    const std::size_t at = text.find(separator);
+    std::string_view head = text.substr(0, at);
+    text.remove_prefix(at == std::string_view::npos ? text.size() : at + 1);
+    return head;
+}
+
+// Matches pattern against path segment by segment, collecting ":name"
+// segments into params when given
+bool matchSegments(std::string_view pattern, std::string_view path,
+                   std::unordered_map<std::string, std::string>* params) {
+    while (!pattern.empty() || !path.empty()) {
+        const std::string_view expected = split(pattern, '/');
+        const std::string_view actual = split(path, '/');
+        if (!expected.empty() && expected.front() == ':') {
+            if (actual.empty()) {
+                return false;
+            }
+            if (params) {
+                (*params)[std::string(expected.substr(1))] = std::string(actual);
+            }
+        } else if (expected != actual) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* reasonPhrase(int status) {
+    switch (status) {
+    case 101: return "Switching Protocols";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 416: return "Range Not Satisfiable";
+    case 426: return "Upgrade Required";
+    case 429: return "Too Many Requests";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
+}
+
+// Incremental HTTP/1.x request parser over a connection's read buffer,
+// given the unconsumed input each time more arrives. The search for the
+// end of the head resumes where it stopped, so a request trickling in is
+// scanned once; the head is then parsed in place and the body awaited by
+// Content-Length. Only the decoded fields are copied out.
+class RequestParser {
+public:
+    enum Status { kIncomplete, kComplete, kError };
+
+    Status parse(const char* data, std::size_t size) {
+        if (head_ == 0) {
+            const std::string_view input(data, size);
+            const std::size_t end = input.find("\r\n\r\n", scanned_ > 3 ? scanned_ - 3 : 0);
+            if (end == std::string_view::npos) {
+                scanned_ = size;
+                if (size > kMaxHeadBytes) {
+                    reject(431);
+                    return kError;
+                }
+                return kIncomplete;
+            }
+            head_ = end + 4;
+            if (!parseHead(input.substr(0, end))) {
+                return kError;
+            }
+        }
+        if (size < head_ + body_) {
+            return kIncomplete;
+        }
+        request_.body.assign(data + head_, body_);
+        return kComplete;
+    }
+
+    HttpRequest& request() { return request_; }
+    bool keepAlive() const { return keep_alive_; }
+    // The status to answer a kError with
+    int errorStatus() const { return error_status_; }
+    // Bytes of the complete request
+    std::size_t consumed() const { return head_ + body_; }
+
+    void reset() {
+        request_ = HttpRequest();
+        scanned_ = head_ = body_ = 0;
+    }
+
+private:
+    bool reject(int status) {
+        error_status_ = status;
+        return false;
+    }
+
+    bool parseHead(std::string_view head) {
+        std::string_view line = head.substr(0, head.find("\r\n"));
+        head.remove_prefix(std::min(head.size(), line.size() + 2));
+        const std::string_view method = split(line, ' ');
+        std::string_view target = split(line, ' ');
+        const std::string_view version = line;
+        if (method.empty() || target.empty() || version.substr(0, 7) != "HTTP/1.") {
+            return reject(400);
+        }
+        request_.method = std::string(method);
+        request_.path = decode(split(target, '?'), false);
+        while (!target.empty()) {
+            std::string_view value = split(target, '&');
+            const std::string_view key = split(value, '=');
+            if (!key.empty()) {
+                request_.query_params[decode(key, true)] = decode(value, true);
+            }
+        }
+
+        std::string connection;
+        while (!head.empty()) {
+            std::string_view value = split(head, '\r');
+            if (!head.empty() && head.front() == '\n') {
+                head.remove_prefix(1);
+            }
+            const std::size_t colon = value.find(':');
+            if (colon == std::string_view::npos || colon == 0) {
+                return reject(400);
+            }
+            std::string name = lowercase(value.substr(0, colon));
+            value = trim(value.substr(colon + 1));
+            if (name == "content-length") {
+                std::size_t length = 0;
+                const auto parsed = std::from_chars(value.data(), value.data() + value.size(), length);
+                if (value.empty() || parsed.ec != std::errc() || parsed.ptr != value.data() + value.size()) {
+                    return reject(400);
+                }
+                if (length > kMaxBodyBytes) {
+                    return reject(413);
+                }
+                body_ = length;
+            } else if (name == "transfer-encoding") {
+                return reject(411); // Chunked request bodies are not accepted
+            } else if (name == "connection") {
+                connection = lowercase(value);
+            }
+            request_.headers[std::move(name)] = std::string(value);
+        }
+        keep_alive_ = version == "HTTP/1.1" ? connection.find("close") == std::string::npos
+                                            : connection.find("keep-alive") != std::string::npos;
+        return true;
+    }
+
+    HttpRequest request_;
+    std::size_t scanned_ = 0; // Input searched for the end of the head
+    std::size_t head_ = 0;    // Head length once parsed, else 0
+    std::size_t body_ = 0;
+    bool keep_alive_ = false;
+    int error_status_ = 400;
+};
+
+// SHA-1, for the WebSocket handshake only
+std::string sha1(const std::string& text) {
+    std::uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string data = text;
+    const std::uint64_t bits = static_cast<std::uint64_t>(text.size()) * 8;
+    data += static_cast<char>(0x80);
+    data.append((119 - text.size() % 64) % 64, '\0');
+    for (int i = 7; i >= 0; --i) {
+        data += static_cast<char>(bits >> (i * 8));
+    }
+    auto rotate = [](std::uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+    for (std::size_t block = 0; block < data.size(); block += 64) {
+        std::uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const auto* p = reinterpret_cast<const unsigned char*>(&data[block + 4 * i]);
+            w[i] = (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            std::uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            const std::uint32_t t = rotate(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotate(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    std::string digest;
+    for (std::uint32_t word : h) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            digest += static_cast<char>(word >> shift);
+        }
+    }
+    return digest;
+}
+
+// Whether one of the offers in a Sec-WebSocket-Extensions header is a
+// permessage-deflate this server can accept, one letting it compress with
+// the full window
+bool offersDeflate(std::string_view extensions) {
+    while (!extensions.empty()) {
+        std::string_view offer = split(extensions, ',');
+        if (trim(split(offer, ';')) != "permessage-deflate") {
+            continue;
+        }
+        bool acceptable = true;
+        while (!offer.empty()) {
+            std::string_view value = trim(split(offer, ';'));
+            const std::string_view name = trim(split(value, '='));
+            if (name == "server_max_window_bits" && trim(value) != "15" && trim(value) != "\"15\"") {
+                acceptable = false;
+            }
+        }
+        if (acceptable) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void appendFrameHeader(std::string& out, unsigned opcode, bool compressed, std::size_t length) {
+    out += static_cast<char>(0x80 | (compressed ? 0x40 : 0) | opcode);
+    if (length < 126) {
+        out += static_cast<char>(length);
+    } else if (length <= 0xFFFF) {
+        out += static_cast<char>(126);
+        out += static_cast<char>(length >> 8);
+        out += static_cast<char>(length);
+    } else {
+        out += static_cast<char>(127);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out += static_cast<char>(static_cast<std::uint64_t>(length) >> shift);
+        }
+    }
+}
+
+// Close frame with a status code
+void appendClose(std::string& out, unsigned code) {
+    appendFrameHeader(out, 0x8, false, 2);
+    out += static_cast<char>(code >> 8);
+    out += static_cast<char>(code);
+}
+
+// Raw deflate of whole messages without context between them
+// (server_no_context_takeover), so a message is compressed once for every
+// client. One stream per thread, reset for each message.
+class Deflater {
+public:
+    Deflater() { ok_ = ::deflateInit2(&stream_, Z_BEST_SPEED, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK; }
+    ~Deflater() {
+        if (ok_) {
+            ::deflateEnd(&stream_);
+        }
+    }
+
+    // The compressed message without its final empty block; false if it
+    // could not be compressed
+    bool compress(const char* data, std::size_t size, std::string& out) {
+        if (!ok_ || ::deflateReset(&stream_) != Z_OK) {
+            return false;
+        }
+        out.resize(::deflateBound(&stream_, static_cast<uLong>(size)) + 16);
+        stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream_.avail_in = static_cast<uInt>(size);
+        stream_.next_out = reinterpret_cast<Bytef*>(&out[0]);
+        stream_.avail_out = static_cast<uInt>(out.size());
+        if (::deflate(&stream_, Z_SYNC_FLUSH) != Z_OK || stream_.avail_in != 0 || stream_.total_out < 4) {
+            return false;
+        }
+        out.resize(stream_.total_out - 4); // The flush's 00 00 ff ff
+        return true;
+    }
+
+private:
+    z_stream stream_{};
+    bool ok_ = false;
+};
+
+// Inflates a client's compressed messages; one stream for the connection,
+// as a client may keep its compression context between messages
+class Inflater {
+public:
+    Inflater() { ok_ = ::inflateInit2(&stream_, -15) == Z_OK; }
+    ~Inflater() {
+        if (ok_) {
+            ::inflateEnd(&stream_);
+        }
+    }
+    Inflater(const Inflater&) = delete;
+    Inflater& operator=(const Inflater&) = delete;
+
+    // Replaces message with its inflated form; false if it is corrupt or
+    // inflates past limit bytes
+    bool inflate(std::string& message, std::size_t limit) {
+        if (!ok_) {
+            return false;
+        }
+        message.append("\x00\x00\xff\xff", 4);
+        stream_.next_in = reinterpret_cast<Bytef*>(&message[0]);
+        stream_.avail_in = static_cast<uInt>(message.size());
+        std::string inflated;
+        char chunk[16 << 10];
+        while (stream_.avail_in > 0) {
+            stream_.next_out = reinterpret_cast<Bytef*>(chunk);
+            stream_.avail_out = sizeof(chunk);
+            const int result = ::inflate(&stream_, Z_SYNC_FLUSH);
+            if (result != Z_OK && result != Z_BUF_ERROR) {
+                return false;
+            }
+            const std::size_t produced = sizeof(chunk) - stream_.avail_out;
+            if (produced == 0 && result == Z_BUF_ERROR) {
+                return false;
+            }
+            inflated.append(chunk, produced);
+            if (inflated.size() > limit) {
+                return false;
+            }
+        }
+        message.swap(inflated);
+        return true;
+    }
+
+private:
+    z_stream stream_{};
+    bool ok_ = false;
+};
+
+// One outgoing WebSocket message, framed once for every client it goes to
+struct WebSocketFrame {
+    WebSocketFrame(bool binary, const std::string& payload) : opcode(binary ? 0x2 : 0x1) {
+        plain.reserve(payload.size() + 10);
+        appendFrameHeader(plain, opcode, false, payload.size());
+        header = plain.size();
+        plain += payload;
+    }
+
+    // The frame for clients that negotiated permessage-deflate: the payload
+    // compressed on first use, or the plain frame when that does not pay
+    const std::string& deflated() const {
+        std::call_once(deflate_once, [this] {
+            const std::size_t size = plain.size() - header;
+            if (size < kMinDeflateBytes) {
+                return;
+            }
+            thread_local Deflater deflater;
+            std::string payload;
+            if (deflater.compress(plain.data() + header, size, payload) && payload.size() < size) {
+                appendFrameHeader(compressed, opcode, true, payload.size());
+                compressed += payload;
+            }
+        });
+        return compressed.empty() ? plain : compressed;
+    }
+
+    unsigned opcode;
+    std::size_t header;
+    std::string plain;
+    mutable std::once_flag deflate_once;
+    mutable std::string compressed;
+};
+
+struct WebSocketState {
+    std::string path;
+    std::string client_id;
+    std::unique_ptr<Inflater> inflater; // Set when permessage-deflate was negotiated
+    unsigned opcode = 0;                // Of the message being reassembled; 0 between messages
+    bool compressed = false;
+    std::string message;
+    // Messages waiting while the socket is backed up, with the place of
+    // each keyed one
+    std::vector<std::shared_ptr<const WebSocketFrame>> waiting;
+    std::unordered_map<std::string, std::size_t> keyed;
+    std::size_t waiting_bytes = 0;
+    bool touched = false;
+};
+
+struct Connection {
+    int fd;
+    std::uint64_t serial; // Tells a reused descriptor from the one a response was for
+    std::string client_ip;
+    std::string in;
+    RequestParser parser;
+    std::string out;
+    std::size_t sent = 0;
+    bool busy = false;        // An offloaded request is being handled
+    bool closing = false;     // Close once the responses are sent
+    bool peer_closed = false; // No more input will come
+    std::uint32_t interest = 0;
+    std::chrono::steady_clock::time_point last_active;
+    std::unique_ptr<WebSocketState> websocket; // Once upgraded
+};
+
+} // namespace
+
+// One thread's epoll loop over its own listening socket and the
+// connections accepted from it
+class RestServer::EventLoop : public std::enable_shared_from_this<EventLoop> {
+public:
+    // A WebSocket message queued for the loop's clients on path, or for
+    // the one client fd when fd >= 0
+    struct Post {
+        std::string path;
+        int fd;
+        std::uint64_t serial;
+        std::string key;
+        std::shared_ptr<const WebSocketFrame> frame;
+    };
+
+    // Takes ownership of listener; throws std::runtime_error (closing it)
+    // if the loop's descriptors cannot be created
+    EventLoop(RestServer& server, int index, int listener) : server_(server), index_(index), listener_(listener) {
+        epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+        wake_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_ < 0 || wake_ < 0 || !watch(listener_, EPOLLIN) || !watch(wake_, EPOLLIN)) {
+            const std::string error = systemError("event loop");
+            closeDescriptors();
+            throw std::runtime_error(error);
+        }
+    }
+    ~EventLoop() {
+        for (auto& entry : connections_) {
+            ::close(entry.first);
+            server_.open_connections_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        closeDescriptors();
+    }
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    void run() {
+        epoll_event events[kMaxEvents];
+        auto last_sweep = std::chrono::steady_clock::now();
+        while (server_.running_.load(std::memory_order_acquire)) {
+            const int count = ::epoll_wait(epoll_, events, kMaxEvents, 1000);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                Logger::getInstance().log(systemError("REST server epoll_wait"));
+                return;
+            }
+            for (int i = 0; i < count; ++i) {
+                const int fd = events[i].data.fd;
+                if (fd == listener_) {
+                    acceptConnections();
+                } else if (fd == wake_) {
+                    std::uint64_t wakes;
+                    ssize_t drained = ::read(wake_, &wakes, sizeof(wakes));
+                    (void)drained;
+                    drainCompletions();
+                    drainPosts();
+                } else {
+                    handleEvent(fd, events[i].events);
+                }
+            }
+            const auto now = std::chrono::steady_clock::now();
+            if (now - last_sweep >= std::chrono::seconds(1)) {
+                closeIdle(now);
+                server_.expireRateLimits();
+                last_sweep = now;
+            }
+        }
+    }
+
+    void wake() {
+        const std::uint64_t one = 1;
+        ssize_t written = ::write(wake_, &one, sizeof(one));
+        (void)written;
+    }
+
+    // From a TaskScheduler thread: the response to a connection's
+    // offloaded request, already formatted
+    void complete(int fd, std::uint64_t serial, std::string bytes) {
+        {
+            std::lock_guard<std::mutex> lock(completions_mutex_);
+            completions_.push_back({fd, serial, std::move(bytes)});
+        }
+        wake();
+    }
+
+    // From any thread. A keyed broadcast replaces one with the same path
+    // and key still queued here; the loop is woken only for the first post
+    // since it last drained.
+    void post(Post post) {
+        bool first = false;
+        {
+            std::lock_guard<std::mutex> lock(posts_mutex_);
+            first = posts_.empty();
+            if (!post.key.empty()) {
+                auto slot = post_keys_.try_emplace(post.path + '\n' + post.key, posts_.size());
+                if (!slot.second) {
+                    posts_[slot.first->second].frame = std::move(post.frame);
+                    return;
+                }
+            }
+            posts_.push_back(std::move(post));
+        }
+        if (first) {
+            wake();
+        }
+    }
+
+private:
+    struct Completion {
+        int fd;
+        std::uint64_t serial;
+        std::string bytes;
+    };
+
+    bool watch(int fd, std::uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        return ::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+
+    void closeDescriptors() {
+        for (int fd : {listener_, epoll_, wake_}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    void acceptConnections() {
+        for (;;) {
+            sockaddr_storage address{};
+            socklen_t length = sizeof(address);
+            const int fd = ::accept4(listener_, reinterpret_cast<sockaddr*>(&address), &length,
+                                     SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                return; // EAGAIN, or out of descriptors until some close
+            }
+            if (server_.open_connections_.fetch_add(1, std::memory_order_relaxed) >= server_.max_connections_) {
+                server_.open_connections_.fetch_sub(1, std::memory_order_relaxed);
+                ::close(fd);
+                continue;
+            }
+            const int no_delay = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+            auto connection = std::make_unique<Connection>();
+            connection->fd = fd;
+            connection->serial = ++next_serial_;
+            char ip[INET6_ADDRSTRLEN] = "";
+            if (address.ss_family == AF_INET) {
+                ::inet_ntop(AF_INET, &reinterpret_cast<sockaddr_in*>(&address)->sin_addr, ip, sizeof(ip));
+            } else if (address.ss_family == AF_INET6) {
+                ::inet_ntop(AF_INET6, &reinterpret_cast<sockaddr_in6*>(&address)->sin6_addr, ip, sizeof(ip));
+            }
+            connection->client_ip = ip;
+            connection->interest = EPOLLIN | EPOLLRDHUP;
+            connection->last_active = std::chrono::steady_clock::now();
+            if (!watch(fd, connection->interest)) {
+                ::close(fd);
+                server_.open_connections_.fetch_sub(1, std::memory_order_relaxed);
+                continue;
+            }
+            connections_[fd] = std::move(connection);
+        }
+    }
+
+    void handleEvent(int fd, std::uint32_t events) {
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+            return;
+        }
+        Connection& connection = *it->second;
+        if (events & (EPOLLERR | EPOLLHUP)) {
+            close(connection); // Nothing more can be sent either
+            return;
+        }
+        if ((events & (EPOLLIN | EPOLLRDHUP)) && !receive(connection)) {
+            return;
+        }
+        service(connection);
+    }
+
+    // Reads everything available; false if the connection was closed
+    bool receive(Connection& connection) {
+        for (;;) {
+            const std::size_t used = connection.in.size();
+            connection.in.resize(used + kReadChunk);
+            const ssize_t n = ::recv(connection.fd, &connection.in[used], kReadChunk, 0);
+            connection.in.resize(used + static_cast<std::size_t>(std::max<ssize_t>(n, 0)));
+            if (n > 0) {
+                continue;
+            }
+            if (n == 0) {
+                connection.peer_closed = true;
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            close(connection);
+            return false;
+        }
+        connection.last_active = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    // Answers the complete requests buffered, sends what it can and
+    // updates what the loop waits for; may close the connection
+    void service(Connection& connection) {
+        if (!connection.websocket) {
+            process(connection);
+        }
+        if (connection.websocket) {
+            if (connection.websocket->waiting_bytes > kMaxWaitingMessages) {
+                close(connection); // Too far behind to catch up
+                return;
+            }
+            readFrames(connection);
+            writeMessages(connection);
+        }
+        if (!flush(connection)) {
+            return;
+        }
+        if (connection.websocket && !connection.websocket->waiting.empty() && connection.out.empty()) {
+            writeMessages(connection);
+            if (!flush(connection)) {
+                return;
+            }
+        }
+        const bool idle = connection.busy || connection.closing || connection.peer_closed;
+        std::uint32_t interest = connection.peer_closed ? 0u : static_cast<std::uint32_t>(EPOLLRDHUP);
+        if (!idle && connection.out.size() - connection.sent < kMaxPendingOutput) {
+            interest |= EPOLLIN;
+        }
+        if (connection.sent < connection.out.size()) {
+            interest |= EPOLLOUT;
+        }
+        if (interest != connection.interest) {
+            epoll_event event{};
+            event.events = interest;
+            event.data.fd = connection.fd;
+            ::epoll_ctl(epoll_, EPOLL_CTL_MOD, connection.fd, &event);
+            connection.interest = interest;
+        }
+    }
+
+    void process(Connection& connection) {
+        std::size_t start = 0;
+        while (!connection.busy && !connection.closing &&
+               connection.out.size() - connection.sent < kMaxPendingOutput) {
+            RequestParser& parser = connection.parser;
+            const RequestParser::Status status =
+                parser.parse(connection.in.data() + start, connection.in.size() - start);
+            if (status == RequestParser::kIncomplete) {
+                break;
+            }
+            if (status == RequestParser::kError) {
+                HttpResponse response;
+                response.status_code = parser.errorStatus();
+                response.body = errorBody(reasonPhrase(response.status_code));
+                formatResponse(response, false, connection.out);
+                connection.closing = true;
+                break;
+            }
+            start += parser.consumed();
+            HttpRequest& request = parser.request();
+            request.client_ip = connection.client_ip;
+            const bool keep_alive = parser.keepAlive();
+            HttpResponse response;
+            RequestHandler handler;
+            if (server_.dispatch(request, response, handler)) {
+                formatResponse(response, keep_alive, connection.out);
+                if (response.status_code == 101) {
+                    upgrade(connection, request.path, response);
+                    parser.reset();
+                    break;
+                }
+            } else {
+                connection.busy = true;
+                std::weak_ptr<EventLoop> loop = shared_from_this();
+                TaskScheduler::getInstance().submit(
+                    [loop, fd = connection.fd, serial = connection.serial, handler = std::move(handler),
+                     request = std::move(request), response = std::move(response), keep_alive]() mutable {
+                        runHandler(handler, request, response);
+                        std::string bytes;
+                        formatResponse(response, keep_alive, bytes);
+                        if (auto owner = loop.lock()) {
+                            owner->complete(fd, serial, std::move(bytes));
+                        }
+                    });
+            }
+            connection.closing = !keep_alive;
+            parser.reset();
+        }
+        if (start > 0) {
+            connection.in.erase(0, start);
+        }
+        if (connection.peer_closed && !connection.busy) {
+            connection.closing = true;
+        }
+    }
+
+    void upgrade(Connection& connection, const std::string& path, const HttpResponse& response) {
+        auto websocket = std::make_unique<WebSocketState>();
+        websocket->path = path;
+        websocket->client_id = "ws-" + std::to_string(index_) + "-" + std::to_string(connection.fd) + "-" +
+                               std::to_string(connection.serial);
+        if (response.headers.count("Sec-WebSocket-Extensions")) {
+            websocket->inflater = std::make_unique<Inflater>();
+        }
+        channels_[path].push_back(&connection);
+        connection.websocket = std::move(websocket);
+    }
+
+    // Fails the WebSocket connection with a close frame
+    void failWebSocket(Connection& connection, unsigned code) {
+        appendClose(connection.out, code);
+        connection.closing = true;
+    }
+
+    // Handles the complete frames a WebSocket client has sent
+    void readFrames(Connection& connection) {
+        WebSocketState& websocket = *connection.websocket;
+        std::size_t start = 0;
+        while (!connection.closing) {
+            const auto* data = reinterpret_cast<const unsigned char*>(connection.in.data()) + start;
+            const std::size_t size = connection.in.size() - start;
+            if (size < 2) {
+                break;
+            }
+            const bool fin = data[0] & 0x80;
+            const bool compressed = data[0] & 0x40;
+            const unsigned opcode = data[0] & 0x0F;
+            std::uint64_t length = data[1] & 0x7F;
+            std::size_t header = 2;
+            if (length == 126) {
+                header = 4;
+            } else if (length == 127) {
+                header = 10;
+            }
+            if (size < header) {
+                break;
+            }
+            if (header > 2) {
+                length = 0;
+                for (std::size_t i = 2; i < header; ++i) {
+                    length = (length << 8) | data[i];
+                }
+            }
+            const bool control = opcode >= 0x8;
+            if (!(data[1] & 0x80) || (data[0] & 0x30) ||
+                (compressed && (!websocket.inflater || control || opcode == 0x0)) ||
+                (control && (!fin || length > 125))) {
+                failWebSocket(connection, 1002); // Clients must mask; no other extension bits
+                break;
+            }
+            if (length > kMaxBodyBytes || websocket.message.size() + length > kMaxBodyBytes) {
+                failWebSocket(connection, 1009);
+                break;
+            }
+            if (size < header + 4 + length) {
+                break;
+            }
+            const unsigned char* mask = data + header;
+            std::string payload(reinterpret_cast<const char*>(mask + 4), static_cast<std::size_t>(length));
+            for (std::size_t i = 0; i < payload.size(); ++i) {
+                payload[i] = static_cast<char>(payload[i] ^ mask[i & 3]);
+            }
+            start += header + 4 + static_cast<std::size_t>(length);
+
+            if (opcode == 0x8) {
+                const unsigned code = payload.size() >= 2
+                                          ? (static_cast<unsigned char>(payload[0]) << 8) |
+                                                static_cast<unsigned char>(payload[1])
+                                          : 1000;
+                failWebSocket(connection, code);
+                break;
+            }
+            if (opcode == 0x9) {
+                appendFrameHeader(connection.out, 0xA, false, payload.size());
+                connection.out += payload;
+                continue;
+            }
+            if (opcode == 0xA) {
+                continue;
+            }
+            if (opcode == 0x1 || opcode == 0x2) {
+                if (websocket.opcode != 0) {
+                    failWebSocket(connection, 1002);
+                    break;
+                }
+                websocket.opcode = opcode;
+                websocket.compressed = compressed;
+                websocket.message = std::move(payload);
+            } else if (opcode == 0x0 && websocket.opcode != 0) {
+                websocket.message += payload;
+            } else {
+                failWebSocket(connection, 1002);
+                break;
+            }
+            if (!fin) {
+                continue;
+            }
+            if (websocket.compressed && !websocket.inflater->inflate(websocket.message, kMaxBodyBytes)) {
+                failWebSocket(connection, 1007);
+                break;
+            }
+            WebSocketMessage message;
+            message.type = websocket.opcode == 0x1 ? WebSocketMessage::TEXT : WebSocketMessage::BINARY;
+            message.data = std::move(websocket.message);
+            message.client_id = websocket.client_id;
+            websocket.opcode = 0;
+            websocket.message.clear();
+            server_.handleWebSocketMessage(websocket.path, message);
+        }
+        if (start > 0) {
+            connection.in.erase(0, start);
+        }
+        if (connection.peer_closed) {
+            connection.closing = true;
+        }
+    }
+
+    // Moves the waiting messages into the output while the socket keeps up
+    void writeMessages(Connection& connection) {
+        WebSocketState& websocket = *connection.websocket;
+        if (connection.closing) {
+            websocket.waiting.clear();
+            websocket.keyed.clear();
+            websocket.waiting_bytes = 0;
+            return;
+        }
+        if (websocket.waiting.empty() || connection.out.size() - connection.sent >= kWebSocketBacklog) {
+            return;
+        }
+        for (const auto& frame : websocket.waiting) {
+            connection.out += websocket.inflater ? frame->deflated() : frame->plain;
+        }
+        websocket.waiting.clear();
+        websocket.keyed.clear();
+        websocket.waiting_bytes = 0;
+    }
+
+    void drainPosts() {
+        std::vector<Post> posts;
+        {
+            std::lock_guard<std::mutex> lock(posts_mutex_);
+            posts.swap(posts_);
+            post_keys_.clear();
+        }
+        std::vector<Connection*> touched;
+        auto enqueue = [&touched](Connection& connection, const Post& post) {
+            WebSocketState& websocket = *connection.websocket;
+            const std::size_t bytes = post.frame->plain.size();
+            auto slot = post.key.empty() ? std::make_pair(websocket.keyed.end(), true)
+                                         : websocket.keyed.try_emplace(post.key, websocket.waiting.size());
+            if (slot.second) {
+                websocket.waiting.push_back(post.frame);
+            } else {
+                auto& waiting = websocket.waiting[slot.first->second];
+                websocket.waiting_bytes -= waiting->plain.size();
+                waiting = post.frame;
+            }
+            websocket.waiting_bytes += bytes;
+            if (!websocket.touched) {
+                websocket.touched = true;
+                touched.push_back(&connection);
+            }
+        };
+        for (const Post& post : posts) {
+            if (post.fd >= 0) {
+                auto it = connections_.find(post.fd);
+                if (it != connections_.end() && it->second->serial == post.serial && it->second->websocket) {
+                    enqueue(*it->second, post);
+                }
+            } else {
+                auto channel = channels_.find(post.path);
+                if (channel != channels_.end()) {
+                    for (Connection* connection : channel->second) {
+                        enqueue(*connection, post);
+                    }
+                }
+            }
+        }
+        for (Connection* connection : touched) {
+            connection->websocket->touched = false;
+            service(*connection);
+        }
+    }
+
+    // Sends what the socket takes; false if the connection was closed
+    bool flush(Connection& connection) {
+        while (connection.sent < connection.out.size()) {
+            const ssize_t n = ::send(connection.fd, connection.out.data() + connection.sent,
+                                     connection.out.size() - connection.sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                connection.sent += static_cast<std::size_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                close(connection);
+                return false;
+            }
+        }
+        if (connection.sent == connection.out.size()) {
+            connection.out.clear();
+            connection.sent = 0;
+            if (connection.closing && !connection.busy) {
+                close(connection);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void close(Connection& connection) {
+        if (connection.websocket) {
+            auto channel = channels_.find(connection.websocket->path);
+            auto& members = channel->second;
+            members.erase(std::find(members.begin(), members.end(), &connection));
+            if (members.empty()) {
+                channels_.erase(channel);
+            }
+        }
+        const int fd = connection.fd;
+        ::close(fd); // Also leaves the epoll set
+        server_.open_connections_.fetch_sub(1, std::memory_order_relaxed);
+        connections_.erase(fd);
+    }
+
+    void drainCompletions() {
+        std::vector<Completion> done;
+        {
+            std::lock_guard<std::mutex> lock(completions_mutex_);
+            done.swap(completions_);
+        }
+        for (Completion& completion : done) {
+            auto it = connections_.find(completion.fd);
+            if (it == connections_.end() || it->second->serial != completion.serial) {
+                continue; // The client left while its request was handled
+            }
+            Connection& connection = *it->second;
+            connection.out += completion.bytes;
+            connection.busy = false;
+            connection.last_active = std::chrono::steady_clock::now();
+            service(connection);
+        }
+    }
+
+    void closeIdle(std::chrono::steady_clock::time_point now) {
+        std::vector<Connection*> idle;
+        for (auto& entry : connections_) {
+            Connection& connection = *entry.second;
+            if (!connection.busy && !connection.websocket && connection.out.empty() &&
+                now - connection.last_active > server_.keep_alive_timeout_) {
+                idle.push_back(&connection);
+            }
+        }
+        for (Connection* connection : idle) {
+            close(*connection);
+        }
+    }
+
+    RestServer& server_;
+    int index_;
+    int listener_;
+    int epoll_ = -1;
+    int wake_ = -1;
+    std::uint64_t next_serial_ = 0;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    std::mutex completions_mutex_;
+    std::vector<Completion> completions_;
+    std::unordered_map<std::string, std::vector<Connection*>> channels_; // WebSocket clients by path
+    std::mutex posts_mutex_;
+    std::vector<Post> posts_;
+    std::unordered_map<std::string, std::size_t> post_keys_; // Path and key of keyed posts, to their place
+};
+
+RestServer::RestServer(const std::string& host, int port, int max_connections)
+    : host_(host), port_(port), max_connections_(max_connections) {}
+
+RestServer::~RestServer() {
+    if (progress_subscription_ >= 0) {
+        ProgressEvents::getInstance().unsubscribe(progress_subscription_);
+    }
+    stop();
+}
+
+bool RestServer::start() {
+    if (running_) {
+        return true;
+    }
+    const int loop_count =
+        event_loops_ > 0 ? event_loops_ : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    const int resolved = ::getaddrinfo(host_.empty() ? nullptr : host_.c_str(), std::to_string(port_).c_str(),
+                                       &hints, &addresses);
+    if (resolved != 0) {
+        Logger::getInstance().log("REST server cannot resolve " + host_ + ": " + ::gai_strerror(resolved));
+        return false;
+    }
+    sockaddr_storage address{};
+    std::memcpy(&address, addresses->ai_addr, addresses->ai_addrlen);
+    const socklen_t address_length = addresses->ai_addrlen;
+    const int family = addresses->ai_family;
+    ::freeaddrinfo(addresses);
+
+    // Every loop listens on the same port; with port 0 the first picks it
+    std::vector<int> listeners;
+    std::string error;
+    for (int i = 0; i < loop_count && error.empty(); ++i) {
+        const int fd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        const int on = 1;
+        if (fd < 0 || ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0 ||
+            ::bind(fd, reinterpret_cast<const sockaddr*>(&address), address_length) != 0 ||
+            ::listen(fd, SOMAXCONN) != 0) {
+            error = systemError("REST server cannot listen on " + host_ + ":" + std::to_string(port_));
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            break;
+        }
+        listeners.push_back(fd);
+        if (i == 0) {
+            socklen_t length = sizeof(address);
+            ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+            port_ = ntohs(family == AF_INET6 ? reinterpret_cast<sockaddr_in6*>(&address)->sin6_port
+                                             : reinterpret_cast<sockaddr_in*>(&address)->sin_port);
+        }
+    }
+
+    running_ = true;
+    for (std::size_t i = 0; i < listeners.size(); ++i) {
+        if (!error.empty()) {
+            ::close(listeners[i]);
+            continue;
+        }
+        try {
+            auto loop = std::make_shared<EventLoop>(*this, static_cast<int>(loops_.size()), listeners[i]);
+            std::lock_guard<std::mutex> lock(websocket_mutex_);
+            loops_.push_back(std::move(loop));
+        } catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+    }
+    if (!error.empty()) {
+        running_ = false;
+        std::lock_guard<std::mutex> lock(websocket_mutex_);
+        loops_.clear();
+        Logger::getInstance().log(error);
+        return false;
+    }
+    for (const auto& loop : loops_) {
+        loop_threads_.emplace_back([loop] { loop->run(); });
+    }
+    Logger::getInstance().log("REST server listening on " + host_ + ":" + std::to_string(port_) + " with " +
+                              std::to_string(loops_.size()) + " event loops");
+    return true;
+}
+
+void RestServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (const auto& loop : loops_) {
+        loop->wake();
+    }
+    for (std::thread& thread : loop_threads_) {
+        thread.join();
+    }
+    loop_threads_.clear();
+    // Offloaded handlers still running keep their loop until they finish
+    std::lock_guard<std::mutex> lock(websocket_mutex_);
+    loops_.clear();
+}
+
+void RestServer::setRateLimit(const RateLimitConfig& config) {
+    rate_limit_config_ = config;
+    rate_limiting_ = config.enabled;
+    for (RateShard& shard : rate_shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.clients.clear();
+    }
+}
+
+bool RestServer::checkRateLimit(const std::string& client_ip) {
+    const double capacity = std::max(rate_limit_config_.burst_size, 1);
+    const double per_second = std::max(rate_limit_config_.requests_per_minute, 0) / 60.0;
+    const auto now = std::chrono::steady_clock::now();
+    RateShard& shard = rate_shards_[std::hash<std::string>()(client_ip) % kRateShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto inserted = shard.clients.try_emplace(client_ip, TokenBucket{capacity, now});
+    TokenBucket& bucket = inserted.first->second;
+    const double elapsed = std::chrono::duration<double>(now - bucket.updated).count();
+    bucket.tokens = std::min(capacity, bucket.tokens + elapsed * per_second);
+    bucket.updated = now;
+    if (bucket.tokens < 1.0) {
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    return true;
+}
+
+void RestServer::expireRateLimits() {
+    if (!rate_limiting_) {
+        return;
+    }
+    // A full bucket is the same as none
+    const double capacity = std::max(rate_limit_config_.burst_size, 1);
+    const double per_second = std::max(rate_limit_config_.requests_per_minute, 0) / 60.0;
+    const auto now = std::chrono::steady_clock::now();
+    RateShard& shard = rate_shards_[next_expiry_shard_.fetch_add(1, std::memory_order_relaxed) % kRateShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (auto it = shard.clients.begin(); it != shard.clients.end();) {
+        const double elapsed = std::chrono::duration<double>(now - it->second.updated).count();
+        if (it->second.tokens + elapsed * per_second >= capacity) {
+            it = shard.clients.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RestServer::addRoute(const std::string& method, const std::string& pattern, RequestHandler handler) {
+    routes_.push_back({method, pattern, std::move(handler), false});
+}
+
+void RestServer::get(const std::string& pattern, RequestHandler handler) {
+    addRoute("GET", pattern, std::move(handler));
+}
+
+void RestServer::post(const std::string& pattern, RequestHandler handler) {
+    addRoute("POST", pattern, std::move(handler));
+}
+
+void RestServer::put(const std::string& pattern, RequestHandler handler) {
+    addRoute("PUT", pattern, std::move(handler));
+}
+
+void RestServer::delete_(const std::string& pattern, RequestHandler handler) {
+    addRoute("DELETE", pattern, std::move(handler));
+}
+
+void RestServer::offload(const std::string& method, const std::string& pattern, RequestHandler handler) {
+    routes_.push_back({method, pattern, std::move(handler), true});
+}
+
+void RestServer::addMiddleware(Middleware middleware) {
+    middlewares_.push_back(std::move(middleware));
+}
+
+bool RestServer::dispatch(HttpRequest& request, HttpResponse& response, RequestHandler& handler) {
+    if (rate_limiting_ && !checkRateLimit(request.client_ip)) {
+        const double per_second = std::max(rate_limit_config_.requests_per_minute, 1) / 60.0;
+        response.status_code = 429;
+        response.content_type = "application/json";
+        response.headers["Retry-After"] = std::to_string(static_cast<int>(std::ceil(1.0 / per_second)));
+        response.body = errorBody("Rate limit exceeded");
+        return true;
+    }
+    for (const Middleware& middleware : middlewares_) {
+        if (!middleware(request, response)) {
+            return true;
+        }
+    }
+    if (isWebSocketUpgrade(request)) {
+        acceptWebSocket(request, response);
+        return true;
+    }
+    bool path_known = false;
+    for (const Route& route : routes_) {
+        if (!matchRoute(route.pattern, request.path)) {
+            continue;
+        }
+        path_known = true;
+        if (route.method != request.method) {
+            continue;
+        }
+        for (auto& param : extractPathParams(route.pattern, request.path)) {
+            request.query_params[param.first] = std::move(param.second);
+        }
+        if (route.offload) {
+            handler = route.handler;
+            return false;
+        }
+        runHandler(route.handler, request, response);
+        return true;
+    }
+    response.status_code = path_known ? 405 : 404;
+    response.content_type = "application/json";
+    response.body = errorBody("No route for " + request.method + " " + request.path);
+    return true;
+}
+
+void RestServer::runHandler(const RequestHandler& handler, const HttpRequest& request, HttpResponse& response) {
+    try {
+        HttpResponse result = handler(request);
+        for (const auto& header : response.headers) {
+            result.headers.insert(header);
+        }
+        response = std::move(result);
+    } catch (const std::exception& e) {
+        response.status_code = 500;
+        response.content_type = "application/json";
+        response.body = errorBody(e.what());
+    }
+}
+
+void RestServer::formatResponse(const HttpResponse& response, bool keep_alive, std::string& out) {
+    if (response.status_code == 101) {
+        out += "HTTP/1.1 101 Switching Protocols\r\n";
+        for (const auto& header : response.headers) {
+            out += header.first;
+            out += ": ";
+            out += header.second;
+            out += "\r\n";
+        }
+        out += "\r\n";
+        return;
+    }
+    out += "HTTP/1.1 ";
+    out += std::to_string(response.status_code);
+    out += ' ';
+    out += reasonPhrase(response.status_code);
+    out += "\r\nContent-Type: ";
+    out += response.content_type;
+    out += "\r\nContent-Length: ";
+    out += std::to_string(response.body.size());
+    out += keep_alive ? "\r\nConnection: keep-alive\r\n" : "\r\nConnection: close\r\n";
+    for (const auto& header : response.headers) {
+        out += header.first;
+        out += ": ";
+        out += header.second;
+        out += "\r\n";
+    }
+    out += "\r\n";
+    out += response.body;
+}
+
+bool RestServer::matchRoute(const std::string& pattern, const std::string& path) {
+    return matchSegments(pattern, path, nullptr);
+}
+
+std::unordered_map<std::string, std::string> RestServer::extractPathParams(const std::string& pattern,
+                                                                           const std::string& path) {
+    std::unordered_map<std::string, std::string> params;
+    matchSegments(pattern, path, &params);
+    return params;
+}
+
+std::string RestServer::urlDecode(const std::string& encoded) {
+    return decode(encoded, true);
+}
+
+std::string RestServer::urlEncode(const std::string& decoded) {
+    static const char* const kHex = "0123456789ABCDEF";
+    std::string encoded;
+    for (unsigned char c : decoded) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            encoded += static_cast<char>(c);
+        } else {
+            encoded += '%';
+            encoded += kHex[c >> 4];
+            encoded += kHex[c & 15];
+        }
+    }
+    return encoded;
+}
+
+std::string RestServer::base64Encode(const std::string& input) {
+    static const char* const kAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string encoded;
+    encoded.reserve((input.size() + 2) / 3 * 4);
+    for (std::size_t i = 0; i < input.size(); i += 3) {
+        const std::size_t count = std::min<std::size_t>(3, input.size() - i);
+        std::uint32_t group = 0;
+        for (std::size_t j = 0; j < 3; ++j) {
+            group = (group << 8) | (j < count ? static_cast<unsigned char>(input[i + j]) : 0u);
+        }
+        for (std::size_t j = 0; j < 4; ++j) {
+            encoded += j <= count ? kAlphabet[(group >> (18 - 6 * j)) & 63] : '=';
+        }
+    }
+    return encoded;
+}
+
+std::string RestServer::base64Decode(const std::string& encoded) {
+    auto digit = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        }
+        if (c >= 'a' && c <= 'z') {
+            return c - 'a' + 26;
+        }
+        if (c >= '0' && c <= '9') {
+            return c - '0' + 52;
+        }
+        return c == '+' ? 62 : c == '/' ? 63 : -1;
+    };
+    // Stops at the padding or the first character outside the alphabet
+    std::string decoded;
+    std::uint32_t group = 0;
+    int bits = 0;
+    for (char c : encoded) {
+        const int value = digit(c);
+        if (value < 0) {
+            break;
+        }
+        group = (group << 6) | static_cast<std::uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            decoded += static_cast<char>(group >> bits);
+        }
+    }
+    return decoded;
+}
+
+bool RestServer::isWebSocketUpgrade(const HttpRequest& request) {
+    auto upgrade = request.headers.find("upgrade");
+    auto connection = request.headers.find("connection");
+    return request.method == "GET" && upgrade != request.headers.end() && connection != request.headers.end() &&
+           lowercase(upgrade->second).find("websocket") != std::string::npos &&
+           lowercase(connection->second).find("upgrade") != std::string::npos;
+}
+
+void RestServer::acceptWebSocket(const HttpRequest& request, HttpResponse& response) {
+    auto header = [&request](const char* name) {
+        auto it = request.headers.find(name);
+        return it == request.headers.end() ? std::string() : it->second;
+    };
+    if (header("sec-websocket-version") != "13") {
+        response.status_code = 426;
+        response.headers["Sec-WebSocket-Version"] = "13";
+        response.body = errorBody("Only WebSocket version 13 is supported");
+        return;
+    }
+    const std::string key = header("sec-websocket-key");
+    if (base64Decode(key).size() != 16) {
+        response.status_code = 400;
+        response.body = errorBody("Bad Sec-WebSocket-Key");
+        return;
+    }
+    response.status_code = 101;
+    response.headers["Upgrade"] = "websocket";
+    response.headers["Connection"] = "Upgrade";
+    response.headers["Sec-WebSocket-Accept"] = base64Encode(sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+    if (offersDeflate(header("sec-websocket-extensions"))) {
+        response.headers["Sec-WebSocket-Extensions"] = "permessage-deflate; server_no_context_takeover";
+    }
+}
+
+void RestServer::addWebSocketHandler(const std::string& path, WebSocketHandler handler) {
+    websocket_handlers_[path] = std::move(handler);
+}
+
+void RestServer::handleWebSocketMessage(const std::string& path, const WebSocketMessage& message) {
+    auto it = websocket_handlers_.find(path);
+    if (it == websocket_handlers_.end()) {
+        return;
+    }
+    try {
+        it->second(message);
+    } catch (const std::exception& e) {
+        Logger::getInstance().log("WebSocket handler for " + path + " failed: " + e.what());
+    }
+}
+
+void RestServer::broadcastWebSocket(const std::string& path, const std::string& message) {
+    postWebSocket(path, "", message, false, "");
+}
+
+void RestServer::broadcastWebSocket(const std::string& path, const std::string& message, bool binary,
+                                    const std::string& coalesce_key) {
+    postWebSocket(path, "", message, binary, coalesce_key);
+}
+
+void RestServer::sendWebSocketMessage(const std::string& client_id, const std::string& message) {
+    postWebSocket("", client_id, message, false, "");
+}
+
+void RestServer::postWebSocket(const std::string& path, const std::string& client_id, const std::string& message,
+                               bool binary, const std::string& coalesce_key) {
+    auto frame = std::make_shared<const WebSocketFrame>(binary, message);
+    if (!client_id.empty()) {
+        // "ws-<loop>-<descriptor>-<serial>"
+        unsigned loop = 0;
+        int fd = -1;
+        unsigned long long serial = 0;
+        if (std::sscanf(client_id.c_str(), "ws-%u-%d-%llu", &loop, &fd, &serial) != 3 || fd < 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(websocket_mutex_);
+        if (loop < loops_.size()) {
+            loops_[loop]->post({"", fd, serial, "", std::move(frame)});
+        }
+        return;
+    }
+    std::lock_guard<std::mutex> lock(websocket_mutex_);
+    for (const auto& loop : loops_) {
+        loop->post({path, -1, 0, coalesce_key, frame});
+    }
+}
+
+void RestServer::streamProgressEvents(const std::string& path) {
+    ProgressEvents& events = ProgressEvents::getInstance();
+    if (progress_subscription_ >= 0) {
+        events.unsubscribe(progress_subscription_);
+        progress_subscription_ = -1;
+    }
+    if (path.empty()) {
+        return;
+    }
+    progress_subscription_ = events.subscribe([this, path](const ProgressEvent& event) {
+        const std::uint16_t source = static_cast<std::uint16_t>(std::min<std::size_t>(std::strlen(event.source), 0xFFFF));
+        const std::uint16_t name = static_cast<std::uint16_t>(std::min<std::size_t>(std::strlen(event.name), 0xFFFF));
+        const std::uint64_t thread = std::hash<std::thread::id>()(event.thread);
+        std::string message(32 + source + name, '\0');
+        char* record = &message[0];
+        record[0] = static_cast<char>(event.kind);
+        std::memcpy(record + 2, &source, sizeof(source));
+        std::memcpy(record + 4, &name, sizeof(name));
+        std::memcpy(record + 8, &thread, sizeof(thread));
+        std::memcpy(record + 16, &event.value, sizeof(event.value));
+        std::memcpy(record + 24, &event.total, sizeof(event.total));
+        std::memcpy(record + 32, event.source, source);
+        std::memcpy(record + 32 + source, event.name, name);
+        // A job's progress supersedes its earlier progress; the other
+        // kinds are all delivered
+        const bool coalesce = event.kind == ProgressEvent::Kind::Progress || event.kind == ProgressEvent::Kind::Metric;
+        broadcastWebSocket(path, message, true, coalesce ? message.substr(2, 14) + message.substr(32) : std::string());
+    });
+}
+
+void RestServer::serveMetrics(const std::string& path) {
+    get(path, [](const HttpRequest&) {
+        HttpResponse response;
+        response.content_type = MetricsRegistry::kPrometheusContentType;
+        response.body = MetricsRegistry::getInstance().prometheusText();
+        return response;
+    });
+}
+
+namespace {
+
+template <typename Map>
+std::vector<typename Map::const_pointer> sortedEntries(const Map& map) {
+    std::vector<typename Map::const_pointer> entries;
+    entries.reserve(map.size());
+    for (const auto& entry : map) {
+        entries.push_back(&entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](auto a, auto b) { return a->first < b->first; });
+    return entries;
+}
+
+void writeNumbers(JsonWriter& json, const std::unordered_map<std::string, double>& data) {
+    json.beginObject();
+    for (const auto* entry : sortedEntries(data)) {
+        json.key(entry->first).number(entry->second);
+    }
+    json.endObject();
+}
+
+std::string elementText(const JsonValue& value) {
+    return value.isScalar() ? value.scalarText() : value.dump();
+}
+
+} // namespace
+
+std::string JsonUtils::serialize(const std::unordered_map<std::string, std::string>& data) {
+    std::string out;
+    JsonWriter json(out);
+    json.beginObject();
+    for (const auto* entry : sortedEntries(data)) {
+        json.key(entry->first).string(entry->second);
+    }
+    json.endObject();
+    return out;
+}
+
+std::string JsonUtils::serialize(const std::vector<std::string>& data) {
+    std::string out;
+    JsonWriter json(out);
+    json.beginArray();
+    for (const std::string& item : data) {
+        json.string(item);
+    }
+    json.endArray();
+    return out;
+}
+
+std::string JsonUtils::serialize(const std::unordered_map<std::string, double>& data) {
+    std::string out;
+    JsonWriter json(out);
+    writeNumbers(json, data);
+    return out;
+}
+
+std::unordered_map<std::string, std::string> JsonUtils::parseObject(const std::string& json) {
+    const JsonValue document = JsonValue::parse(json);
+    if (!document.isObject()) {
+        throw std::invalid_argument(std::string("JSON value is ") + JsonValue::typeName(document.type()) +
+                                    ", not an object");
+    }
+    std::unordered_map<std::string, std::string> values;
+    for (const auto& member : document.members()) {
+        if (!member.second.isNull()) {
+            values[member.first] = elementText(member.second);
+        }
+    }
+    return values;
+}
+
+std::vector<std::string> JsonUtils::parseArray(const std::string& json) {
+    const JsonValue document = JsonValue::parse(json);
+    if (!document.isArray()) {
+        throw std::invalid_argument(std::string("JSON value is ") + JsonValue::typeName(document.type()) +
+                                    ", not an array");
+    }
+    std::vector<std::string> values;
+    values.reserve(document.size());
+    for (const JsonValue& item : document.items()) {
+        if (!item.isNull()) {
+            values.push_back(elementText(item));
+        }
+    }
+    return values;
+}
+
+std::string JsonUtils::createErrorResponse(int code, const std::string& message) {
+    std::string out;
+    JsonWriter(out).beginObject().key("error").string(message).key("code").integer(code).endObject();
+    return out;
+}
+
+std::string JsonUtils::createSuccessResponse(const std::string& data) {
+    std::string out;
+    JsonWriter json(out);
+    json.beginObject().key("success").boolean(true);
+    if (!data.empty()) {
+        json.key("data").raw(data);
+    }
+    json.endObject();
+    return out;
+}
+
+std::string JsonUtils::createSimulationResponse(const std::string& simulation_id, const std::string& status,
+                                                const std::unordered_map<std::string, double>& results) {
+    std::string out;
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("id").string(simulation_id);
+    json.key("status").string(status);
+    json.key("results");
+    writeNumbers(json, results);
+    json.endObject();
+    return out;
+}
+
+} // namespace SemiPRO
@@ -1,6 +1,7 @@
 // Author: Dr. Mazharuddin Mohammed
 #pragma once
 
+#include <array>
 #include <string>
 #include <memory>
 #include <unordered_map>
@@ -8,14 +9,17 @@
 #include <vector>
 #include <thread>
 #include <mutex>
-#include <condition_variable>
-#include <queue>
 #include <atomic>
+#include <chrono>
+#include "../core/json_value.hpp"
 
 namespace SemiPRO {
 
 /**
  * @brief HTTP request structure
+ *
+ * Header names are lowercased; the path and query are URL-decoded, and
+ * path parameters (":id" in a route pattern) join the query parameters.
  */
 struct HttpRequest {
     std::string method;
@@ -61,8 +65,20 @@ struct WebSocketMessage {
  */
 using WebSocketHandler = std::function<void(const WebSocketMessage&)>;
 
+/**
+ * @brief Source of float32 field data for serveFieldData
+ *
+ * Fills rows and cols; throws std::invalid_argument for unknown data.
+ * VisualizationEngine::getFieldData has this shape.
+ */
+using FieldDataSource = std::function<std::vector<float>(const std::string& id, const std::string& field,
+                                                         int level, int& rows, int& cols)>;
+
 /**
  * @brief Rate limiting configuration
+ *
+ * Each client IP gets a token bucket holding up to burst_size requests
+ * and refilled at requests_per_minute.
  */
 struct RateLimitConfig {
     int requests_per_minute = 60;
@@ -82,6 +98,29 @@ struct AuthConfig {
 
 /**
  * @brief REST API server
+ *
+ * HTTP/1.1 with keep-alive and pipelining, served by one epoll event loop
+ * per core. Each loop has its own listening socket on the shared port
+ * (SO_REUSEPORT), so the kernel spreads connections over the loops and no
+ * lock or queue sits between accept and response. Requests are parsed
+ * incrementally in the connection's read buffer as bytes arrive.
+ * Pipelined requests are answered in order; a loop stops reading from a
+ * connection whose unsent responses pass a limit.
+ *
+ * Handlers run on the loop that read the request, so they must be quick.
+ * Routes added with offload() run on the TaskScheduler instead; the
+ * connection waits for that response before its next request is parsed.
+ * Routes, middleware and WebSocket handlers are registered before start().
+ *
+ * A GET on any path may be upgraded to a WebSocket (RFC 6455, with
+ * permessage-deflate when the client offers it) once the middleware has
+ * passed it. Messages for WebSocket clients are queued per loop and
+ * written by the loop without blocking, so a broadcast from any thread
+ * holds a lock only to queue the message; each message is framed, and
+ * compressed, once for all its clients. While a client's socket is backed
+ * up its messages wait in its own queue, where a message with a coalescing
+ * key replaces an unsent one with the same key, so a slow client receives
+ * the latest value of each rather than every one.
  */
 class RestServer {
 private:
@@ -89,7 +128,9 @@ private:
         std::string method;
         std::string pattern;
         RequestHandler handler;
+        bool offload = false;
     };
+    class EventLoop;
     
     std::vector<Route> routes_;
     std::vector<Middleware> middlewares_;
@@ -99,42 +140,66 @@ private:
     std::string host_;
     int port_;
     int max_connections_;
-    bool running_;
+    int event_loops_ = 0;
+    std::chrono::seconds keep_alive_timeout_{30};
+    std::atomic<bool> running_{false};
     
-    // Threading
-    std::thread server_thread_;
-    std::vector<std::thread> worker_threads_;
-    std::queue<std::pair<int, HttpRequest>> request_queue_;
-    std::mutex queue_mutex_;
-    std::condition_variable queue_cv_;
+    // Event loops
+    std::vector<std::shared_ptr<EventLoop>> loops_;
+    std::vector<std::thread> loop_threads_;
+    std::atomic<int> open_connections_{0};
     
-    // Rate limiting
+    // Rate limiting: a token bucket per client, in lock-striped shards
+    struct TokenBucket {
+        double tokens;
+        std::chrono::steady_clock::time_point updated;
+    };
+    struct alignas(64) RateShard {
+        std::mutex mutex;
+        std::unordered_map<std::string, TokenBucket> clients;
+    };
+    static constexpr std::size_t kRateShards = 64;
     RateLimitConfig rate_limit_config_;
-    std::unordered_map<std::string, std::vector<std::chrono::steady_clock::time_point>> client_requests_;
-    std::mutex rate_limit_mutex_;
+    bool rate_limiting_ = false;
+    std::array<RateShard, kRateShards> rate_shards_;
+    std::atomic<std::size_t> next_expiry_shard_{0};
     
     // Authentication
     AuthConfig auth_config_;
     
-    // WebSocket connections
-    std::unordered_map<std::string, int> websocket_connections_;
+    // Guards loops_ for broadcasts from other threads
     std::mutex websocket_mutex_;
+    int progress_subscription_ = -1;
     
 public:
+    // max_connections caps open connections over all loops; further
+    // connections are closed as they are accepted
     RestServer(const std::string& host = "localhost", int port = 8080, int max_connections = 100);
     ~RestServer();
+    RestServer(const RestServer&) = delete;
+    RestServer& operator=(const RestServer&) = delete;
     
-    // Server lifecycle
+    // Server lifecycle. start() returns false, and logs why, if the port
+    // cannot be bound; port 0 picks a free one, reported by getPort().
     bool start();
     void stop();
     bool isRunning() const { return running_; }
+    int getPort() const { return port_; }
+    // Before start(); 0, the default, runs one loop per hardware thread
+    void setEventLoops(int loops) { event_loops_ = loops; }
+    // Idle keep-alive connections close after this long
+    void setKeepAliveTimeout(std::chrono::seconds timeout) { keep_alive_timeout_ = timeout; }
     
-    // Route registration
+    // Route registration. Patterns match segment by segment; a ":name"
+    // segment matches any value and passes it as parameter name.
     void addRoute(const std::string& method, const std::string& pattern, RequestHandler handler);
     void get(const std::string& pattern, RequestHandler handler);
     void post(const std::string& pattern, RequestHandler handler);
     void put(const std::string& pattern, RequestHandler handler);
     void delete_(const std::string& pattern, RequestHandler handler);
+    // A route whose handler runs on the TaskScheduler, for handlers that
+    // simulate or otherwise take long enough to stall an event loop
+    void offload(const std::string& method, const std::string& pattern, RequestHandler handler);
     
     // Middleware
     void addMiddleware(Middleware middleware);
@@ -142,13 +207,36 @@ public:
     void enableLogging();
     void enableCompression();
     
-    // WebSocket support
+    // WebSocket support. Handlers receive the text and binary messages of
+    // clients connected on their path and run on the event loop; a
+    // message's client_id addresses replies to that client.
     void addWebSocketHandler(const std::string& path, WebSocketHandler handler);
+    // A text message to every client connected on path; thread-safe
     void broadcastWebSocket(const std::string& path, const std::string& message);
+    // As above, sent as a binary frame if binary; a non-empty
+    // coalesce_key lets the message replace an unsent one with the same
+    // key on the same path
+    void broadcastWebSocket(const std::string& path, const std::string& message, bool binary,
+                            const std::string& coalesce_key = "");
     void sendWebSocketMessage(const std::string& client_id, const std::string& message);
+    // Broadcasts every solver progress event on path as a binary message,
+    // little-endian: u8 kind (begin, progress, metric, warning, end), u8 0,
+    // u16 source length, u16 name length, u16 0, u64 publishing thread,
+    // f64 value, f64 total, then the source and name bytes. Progress and
+    // metric events coalesce per thread, source and name. An empty path
+    // stops.
+    void streamProgressEvents(const std::string& path);
+    // A publisher for VisualizationEngine::publishRealTimeSnapshots that
+    // broadcasts each snapshot on path
+    std::function<void(const std::string&)> webSocketBroadcaster(const std::string& path) {
+        return [this, path](const std::string& message) { broadcastWebSocket(path, message); };
+    }
     
-    // Rate limiting
+    // Rate limiting, off until set; before start(). Requests over the
+    // limit are answered 429. A check takes only the lock of the client's
+    // shard, and a client's state is one bucket however fast it calls.
     void setRateLimit(const RateLimitConfig& config);
+    // Takes a token from the client's bucket; false if it is empty
     bool checkRateLimit(const std::string& client_ip);
     
     // Authentication
@@ -157,6 +245,17 @@ public:
     std::string generateToken(const std::string& user_id);
     bool validateToken(const std::string& token);
     
+    // Answers GET path?id=&field=&level= with the data as raw float32
+    // (host order, little-endian on every supported platform) and its
+    // shape in an X-Shape header, "rows,cols"; unknown data is a 404.
+    // Decimated reports fetch full resolution maps from here.
+    void serveFieldData(const std::string& path, FieldDataSource source);
+    
+    // Answers GET path with every MetricsRegistry series in the Prometheus
+    // text format, for a Prometheus scrape job; see MetricsRegistry for
+    // what the engine, orchestrator, scheduler and memory manager report
+    void serveMetrics(const std::string& path = "/metrics");
+    
     // Static file serving
     void serveStaticFiles(const std::string& path, const std::string& directory);
     
@@ -164,18 +263,29 @@ public:
     void setErrorHandler(int status_code, RequestHandler handler);
     
 private:
-    void serverLoop();
-    void workerLoop();
-    void handleRequest(int client_socket, const HttpRequest& request);
-    HttpRequest parseRequest(const std::string& raw_request);
-    std::string formatResponse(const HttpResponse& response);
+    // Runs the middleware and finds the route. Returns true with response
+    // filled in when the request is answered here; otherwise the route's
+    // handler must run on the TaskScheduler and is left in `handler`.
+    bool dispatch(HttpRequest& request, HttpResponse& response, RequestHandler& handler);
+    // Replaces response with the handler's, keeping headers the middleware
+    // set that the handler did not; an exception becomes a 500
+    static void runHandler(const RequestHandler& handler, const HttpRequest& request, HttpResponse& response);
+    // Appends the response, with its status line and framing headers, to out
+    static void formatResponse(const HttpResponse& response, bool keep_alive, std::string& out);
+    // Forgets the idle clients of the next shard in turn, those whose
+    // buckets have refilled; called by each event loop once a second
+    void expireRateLimits();
+    // Queues a framed message on every loop, or on the loop of client_id
+    void postWebSocket(const std::string& path, const std::string& client_id, const std::string& message,
+                       bool binary, const std::string& coalesce_key);
     bool matchRoute(const std::string& pattern, const std::string& path);
     std::unordered_map<std::string, std::string> extractPathParams(const std::string& pattern, const std::string& path);
     
     // WebSocket handling
     bool isWebSocketUpgrade(const HttpRequest& request);
-    void handleWebSocketUpgrade(int client_socket, const HttpRequest& request);
-    void handleWebSocketMessage(const std::string& client_id, const std::string& message);
+    // Fills in the 101 answer, or the error for a bad handshake
+    void acceptWebSocket(const HttpRequest& request, HttpResponse& response);
+    void handleWebSocketMessage(const std::string& path, const WebSocketMessage& message);
     
     // Utility functions
     std::string urlDecode(const std::string& encoded);
@@ -184,18 +294,52 @@ private:
     std::string base64Decode(const std::string& encoded);
 };
 
+inline void RestServer::serveFieldData(const std::string& path, FieldDataSource source) {
+    get(path, [source](const HttpRequest& request) {
+        HttpResponse response;
+        auto param = [&request](const std::string& key) {
+            auto it = request.query_params.find(key);
+            return it == request.query_params.end() ? std::string() : it->second;
+        };
+        try {
+            const std::string level = param("level");
+            int rows = 0, cols = 0;
+            const std::vector<float> values =
+                source(param("id"), param("field"), level.empty() ? 0 : std::stoi(level), rows, cols);
+            response.content_type = "application/octet-stream";
+            response.headers["X-Shape"] = std::to_string(rows) + "," + std::to_string(cols);
+            response.body.assign(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+        } catch (const std::invalid_argument& e) {
+            response.status_code = 404;
+            JsonValue error;
+            error.set("error", JsonValue::string(e.what()));
+            response.body = error.dump();
+        }
+        return response;
+    });
+}
+
 /**
  * @brief JSON utilities for API responses
+ *
+ * Text is written with JsonWriter and read with JsonValue. Map keys are
+ * written in sorted order, so equal maps give equal text.
  */
 class JsonUtils {
 public:
     static std::string serialize(const std::unordered_map<std::string, std::string>& data);
     static std::string serialize(const std::vector<std::string>& data);
     static std::string serialize(const std::unordered_map<std::string, double>& data);
+    // Scalars as their text (see JsonValue::scalarText), arrays and objects
+    // as compact JSON; null members are left out. Throw on malformed JSON
+    // or a document of another type.
     static std::unordered_map<std::string, std::string> parseObject(const std::string& json);
     static std::vector<std::string> parseArray(const std::string& json);
     
+    // {"error": message, "code": code}
     static std::string createErrorResponse(int code, const std::string& message);
+    // {"success": true, "data": data}, where data is JSON text; no "data"
+    // member when it is empty
     static std::string createSuccessResponse(const std::string& data = "");
     static std::string createSimulationResponse(const std::string& simulation_id, 
                                                const std::string& status,
@@ -207,6 +351,24 @@ public:
  */
 class ApiHandlers {
 public:
+    // Simulations run as SimulationJobs: submitting answers 202 with the
+    // job id at once, and the job is then polled and its results fetched.
+    //   POST   /api/simulations              {"wafer", "process", "config"}
+    //   GET    /api/simulations
+    //   GET    /api/simulations/:id          state, error, seconds
+    //   DELETE /api/simulations/:id          cancels and forgets the job
+    //   GET    /api/simulations/:id/results  fields and their shapes
+    //   GET    /api/simulations/:id/results?field=name
+    //   POST   /api/oxidation, /api/doping, /api/deposition, /api/etching
+    //                                        {"wafer", "config"}
+    //   GET    /metrics                      Prometheus text (serveMetrics)
+    // A field comes as raw float64, row-major, host order (little-endian
+    // on every supported platform), with its shape in an X-Shape header,
+    // "rows,cols"; "dopant" is the dopant profile as one column. Field
+    // requests honour a single byte Range, so large fields can be fetched
+    // in pieces as they are processed.
+    static void registerSimulationRoutes(RestServer& server);
+
     // Simulation endpoints
     static HttpResponse createSimulation(const HttpRequest& request);
     static HttpResponse getSimulation(const HttpRequest& request);
@@ -0,0 +1,249 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "simulation_jobs.hpp"
+#include "simulation_engine.hpp"
+#include "simulation_server.hpp"
+#include "task_scheduler.hpp"
+#include "telemetry.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace SemiPRO {
+
+namespace {
+
+std::shared_ptr<const SimulationResults> takeResults(const Wafer& wafer) {
+    auto results = std::make_shared<SimulationResults>();
+    wafer.getPhotoresistPattern(); // Brings the pattern channel up to date
+    const FieldStore& fields = wafer.getFieldStore();
+    for (int channel = 0; channel < fields.channelCount(); ++channel) {
+        if (fields.isMaterialized(channel)) {
+            results->fields.push_back({fields.channelName(channel), fields.snapshot(channel)});
+        }
+    }
+    results->dopant_profile = wafer.getDopantProfile();
+    return results;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+const SimulationResults::Field* SimulationResults::find(const std::string& name) const {
+    for (const Field& field : fields) {
+        if (field.name == name) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+SimulationJobs& SimulationJobs::getInstance() {
+    static SimulationJobs instance;
+    static const bool metrics_registered = [] {
+        for (State state : {State::QUEUED, State::RUNNING}) {
+            MetricsRegistry::getInstance().gaugeCallback(
+                "semipro_api_jobs", "REST simulation jobs by state",
+                [state] {
+                    std::lock_guard<std::mutex> lock(instance.mutex_);
+                    return static_cast<double>(std::count_if(instance.jobs_.begin(), instance.jobs_.end(),
+                        [state](const auto& entry) { return entry.second->status.state == state; }));
+                },
+                {{"state", stateName(state)}});
+        }
+        return true;
+    }();
+    (void)metrics_registered;
+    return instance;
+}
+
+const char* SimulationJobs::stateName(State state) {
+    switch (state) {
+    case State::QUEUED: return "queued";
+    case State::RUNNING: return "running";
+    case State::COMPLETED: return "completed";
+    case State::FAILED: return "failed";
+    case State::CANCELLED: return "cancelled";
+    }
+    return "unknown";
+}
+
+std::string SimulationJobs::submit(const std::string& wafer, const std::string& process, const JsonValue& config) {
+    auto job = std::make_shared<Job>();
+    job->status.wafer = wafer;
+    job->status.process = process;
+    job->config = config;
+    bool first = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job->status.id = "sim-" + std::to_string(++next_id_);
+        jobs_[job->status.id] = job;
+        auto& queue = wafer_queues_[wafer];
+        queue.push_back(job);
+        first = queue.size() == 1;
+    }
+    if (first) {
+        start(job);
+    }
+    return job->status.id;
+}
+
+void SimulationJobs::start(const std::shared_ptr<Job>& job) {
+    TaskScheduler::getInstance().submit([this, job] { run(job); });
+}
+
+void SimulationJobs::run(const std::shared_ptr<Job>& job) {
+    bool cancelled = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled = job->status.state == State::CANCELLED;
+        if (!cancelled) {
+            job->status.state = State::RUNNING;
+            job->started = std::chrono::steady_clock::now();
+        }
+    }
+
+    bool success = false;
+    std::string error;
+    std::shared_ptr<const SimulationResults> results;
+    if (!cancelled) {
+        const std::string& wafer = job->status.wafer;
+        const std::string& process = job->status.process;
+        try {
+            auto& engine = SimulationEngine::getInstance();
+            bool known = true;
+            try {
+                engine.getWafer(wafer);
+            } catch (const std::runtime_error&) {
+                known = false;
+            }
+            if (!known && process != "geometry_init") {
+                runBridgeProcess(wafer, "geometry_init", JsonValue());
+            }
+            std::future<bool> done;
+            {
+                CancellationScope scope(job->stop.token());
+                done = submitBridgeProcess(wafer, process, job->config);
+            }
+            success = TaskScheduler::getInstance().wait(done);
+            if (success) {
+                results = takeResults(*engine.getWafer(wafer));
+            } else {
+                error = "process failed";
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+    }
+
+    std::shared_ptr<Job> next;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Status& status = job->status;
+        if (!cancelled) {
+            status.seconds = secondsSince(job->started);
+            if (job->stop.stopRequested()) {
+                status.state = State::CANCELLED;
+            } else {
+                status.state = success ? State::COMPLETED : State::FAILED;
+                status.error = error;
+                job->results = std::move(results);
+            }
+            if (jobs_.count(status.id)) {
+                finished_.push_back(status.id);
+            }
+        }
+        auto queue = wafer_queues_.find(status.wafer);
+        queue->second.pop_front();
+        if (queue->second.empty()) {
+            wafer_queues_.erase(queue);
+        } else {
+            next = queue->second.front();
+        }
+        trim();
+    }
+    if (next) {
+        start(next);
+    }
+}
+
+bool SimulationJobs::status(const std::string& id, Status& status) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        return false;
+    }
+    status = it->second->status;
+    if (status.state == State::RUNNING) {
+        status.seconds = secondsSince(it->second->started);
+    }
+    return true;
+}
+
+std::vector<SimulationJobs::Status> SimulationJobs::list() const {
+    std::vector<Status> statuses;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& entry : jobs_) {
+            statuses.push_back(entry.second->status);
+            if (statuses.back().state == State::RUNNING) {
+                statuses.back().seconds = secondsSince(entry.second->started);
+            }
+        }
+    }
+    // Ids count up, so this is submission order
+    std::sort(statuses.begin(), statuses.end(), [](const Status& a, const Status& b) {
+        return a.id.size() != b.id.size() ? a.id.size() < b.id.size() : a.id < b.id;
+    });
+    return statuses;
+}
+
+std::shared_ptr<const SimulationResults> SimulationJobs::results(const std::string& id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    return it == jobs_.end() ? nullptr : it->second->results;
+}
+
+bool SimulationJobs::cancel(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        return false;
+    }
+    Job& job = *it->second;
+    if (job.status.state == State::QUEUED) {
+        // Skipped when its turn comes
+        job.status.state = State::CANCELLED;
+        finished_.push_back(id);
+        trim();
+        return true;
+    }
+    if (job.status.state == State::RUNNING) {
+        job.stop.requestStop();
+        return true;
+    }
+    return false;
+}
+
+bool SimulationJobs::remove(const std::string& id) {
+    cancel(id);
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_.erase(std::remove(finished_.begin(), finished_.end(), id), finished_.end());
+    return jobs_.erase(id) > 0;
+}
+
+void SimulationJobs::setRetention(std::size_t finished_jobs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    retention_ = finished_jobs;
+    trim();
+}
+
+void SimulationJobs::trim() {
+    while (finished_.size() > retention_) {
+        jobs_.erase(finished_.front());
+        finished_.pop_front();
+    }
+}
+
+} // namespace SemiPRO
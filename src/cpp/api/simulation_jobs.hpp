@@ -0,0 +1,106 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+
+#include "cancellation.hpp"
+#include "field_store.hpp"
+#include "json_value.hpp"
+#include <Eigen/Dense>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SemiPRO {
+
+/**
+ * @brief What a finished simulation job left on its wafer
+ *
+ * Field channels are copy-on-write snapshots taken as the job finished,
+ * so they cost no memory until a later job writes the wafer, and may be
+ * read from any thread meanwhile.
+ */
+struct SimulationResults {
+    struct Field {
+        std::string name;
+        FieldSnapshot snapshot;
+    };
+    std::vector<Field> fields;
+    Eigen::ArrayXd dopant_profile;
+
+    // nullptr when there is no such field
+    const Field* find(const std::string& name) const;
+};
+
+/**
+ * @brief Simulation jobs run for the REST API
+ *
+ * submit() queues a bridge process (see runBridgeProcess) and returns
+ * its id at once; the process runs on the engine's task pool. Jobs on
+ * the same wafer run one after another in submission order, so each
+ * job's results are those of its own run. A wafer the engine does not
+ * know is created with the "geometry_init" defaults first. Finished
+ * jobs are kept, oldest dropped first, up to the retention limit.
+ */
+class SimulationJobs {
+public:
+    enum class State { QUEUED, RUNNING, COMPLETED, FAILED, CANCELLED };
+
+    struct Status {
+        std::string id;
+        std::string wafer;
+        std::string process;
+        State state = State::QUEUED;
+        std::string error;
+        double seconds = 0.0; // Run time so far, or in total once finished
+    };
+
+    static SimulationJobs& getInstance();
+
+    SimulationJobs() = default;
+    SimulationJobs(const SimulationJobs&) = delete;
+    SimulationJobs& operator=(const SimulationJobs&) = delete;
+
+    std::string submit(const std::string& wafer, const std::string& process, const JsonValue& config);
+    // false for an unknown id
+    bool status(const std::string& id, Status& status) const;
+    std::vector<Status> list() const;
+    // nullptr unless the job completed
+    std::shared_ptr<const SimulationResults> results(const std::string& id) const;
+    // Stops a queued or running job, which then ends CANCELLED (a process
+    // that cannot stop early still runs to its end); false if the job is
+    // unknown or already finished
+    bool cancel(const std::string& id);
+    // Cancels the job if need be and forgets it; false for an unknown id
+    bool remove(const std::string& id);
+    void setRetention(std::size_t finished_jobs);
+
+    static const char* stateName(State state);
+
+private:
+    struct Job {
+        Status status;
+        JsonValue config;
+        CancellationSource stop;
+        std::chrono::steady_clock::time_point started;
+        std::shared_ptr<const SimulationResults> results;
+    };
+
+    void start(const std::shared_ptr<Job>& job);
+    void run(const std::shared_ptr<Job>& job);
+    // Under mutex_: drops the oldest finished jobs beyond the retention
+    void trim();
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Job>> jobs_;
+    std::unordered_map<std::string, std::deque<std::shared_ptr<Job>>> wafer_queues_; // Running job first
+    std::deque<std::string> finished_;
+    std::size_t retention_ = 64;
+    std::uint64_t next_id_ = 0;
+};
+
+} // namespace SemiPRO
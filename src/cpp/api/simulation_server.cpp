@@ -0,0 +1,372 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "simulation_server.hpp"
+#include "simulation_engine.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+
+namespace SemiPRO {
+
+namespace {
+
+// Numbers may also arrive quoted, as older bridge configs wrote them
+double number(const JsonValue& config, const std::string& key, double fallback) {
+    const JsonValue* value = config.find(key);
+    if (!value) {
+        return fallback;
+    }
+    if (value->isNumber()) {
+        return value->asNumber();
+    }
+    if (value->isString()) {
+        const std::string& spelled = value->asString();
+        size_t used = 0;
+        try {
+            const double parsed = std::stod(spelled, &used);
+            if (used == spelled.size()) {
+                return parsed;
+            }
+        } catch (const std::exception&) {
+        }
+    }
+    throw std::invalid_argument("Config key '" + key + "' must be a number");
+}
+
+std::string text(const JsonValue& config, const std::string& key, const std::string& fallback) {
+    const JsonValue* value = config.find(key);
+    if (!value) {
+        return fallback;
+    }
+    if (!value->isScalar()) {
+        throw std::invalid_argument("Config key '" + key + "' must be a string");
+    }
+    return value->scalarText();
+}
+
+std::string systemError(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+std::string jsonQuote(const std::string& value) {
+    std::string quoted = "\"";
+    for (char c : value) {
+        switch (c) {
+        case '"': quoted += "\\\""; break;
+        case '\\': quoted += "\\\\"; break;
+        case '\n': quoted += "\\n"; break;
+        case '\t': quoted += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                quoted += escaped;
+            } else {
+                quoted += c;
+            }
+        }
+    }
+    return quoted + "\"";
+}
+
+// Closes a file descriptor on scope exit
+class Descriptor {
+public:
+    explicit Descriptor(int fd) : fd_(fd) {}
+    ~Descriptor() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+    Descriptor(const Descriptor&) = delete;
+    Descriptor& operator=(const Descriptor&) = delete;
+    int get() const { return fd_; }
+
+private:
+    int fd_;
+};
+
+void sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(systemError("send"));
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+std::future<bool> readyResult(bool value) {
+    std::promise<bool> result;
+    result.set_value(value);
+    return result.get_future();
+}
+
+} // namespace
+
+bool runBridgeProcess(const std::string& wafer_name, const std::string& process_type, const JsonValue& config) {
+    return submitBridgeProcess(wafer_name, process_type, config).get();
+}
+
+std::future<bool> submitBridgeProcess(const std::string& wafer_name, const std::string& process_type,
+                                      const JsonValue& config) {
+    auto& engine = SimulationEngine::getInstance();
+
+    if (process_type == "geometry_init") {
+        auto wafer = engine.createWafer(number(config, "diameter", 300.0), number(config, "thickness", 775.0),
+                                        text(config, "material", "silicon"));
+        wafer->initializeGrid(50, 50);
+        engine.registerWafer(wafer, wafer_name);
+        Logger::getInstance().log("Geometry initialization completed");
+        return readyResult(true);
+    }
+    if (process_type == "grid_init") {
+        auto wafer = engine.getWafer(wafer_name);
+        wafer->initializeGrid(static_cast<int>(number(config, "x_dimension", 50)),
+                              static_cast<int>(number(config, "y_dimension", 50)));
+        Logger::getInstance().log("Grid initialization completed");
+        return readyResult(true);
+    }
+
+    SimulationEngine::ProcessParameters params(process_type, 1.0);
+    if (process_type == "oxidation") {
+        params.parameters["temperature"] = number(config, "temperature", 1000.0);
+        params.parameters["time"] = number(config, "time", 1.0);
+        params.parameters["ambient"] = text(config, "atmosphere", "dry") == "wet" ? 1.0 : 0.0;
+    } else if (process_type == "doping") {
+        params.parameters["energy"] = number(config, "energy", 50.0);
+        params.parameters["dose"] = number(config, "dose", 1e15);
+        params.parameters["mass"] = number(config, "mass", 11.0);
+        params.parameters["atomic_number"] = number(config, "atomic_number", 5.0);
+    } else if (process_type == "deposition") {
+        params.parameters["thickness"] = number(config, "thickness", 0.5);
+        params.parameters["temperature"] = number(config, "temperature", 400.0);
+        params.string_parameters["material"] = text(config, "material", "aluminum");
+    } else if (process_type == "etching") {
+        params.parameters["depth"] = number(config, "rate", 0.5);
+        params.parameters["type"] = text(config, "etch_type", "") == "isotropic" ? 0.0 : 1.0;
+        params.parameters["selectivity"] = number(config, "selectivity", 10.0);
+    } else {
+        Logger::getInstance().log("Unknown process type: " + process_type);
+        return readyResult(false);
+    }
+    return engine.simulateProcessAsync(wafer_name, params);
+}
+
+// A POSIX shared-memory mapping that a FieldStore adopts as its arena.
+// The FieldStore shares ownership, so the mapping outlives the server's
+// reference if the wafer still uses it.
+class SimulationServer::SharedArena {
+public:
+    SharedArena(const std::string& name, int generation, size_t field_doubles, size_t dopant_capacity)
+        : name_(name), generation_(generation), field_doubles_(field_doubles), dopant_capacity_(dopant_capacity),
+          bytes_((field_doubles + dopant_capacity) * sizeof(double)) {
+        Descriptor fd(::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600));
+        if (fd.get() < 0) {
+            throw std::runtime_error(systemError("shm_open " + name_));
+        }
+        if (::ftruncate(fd.get(), static_cast<off_t>(bytes_)) != 0) {
+            std::string error = systemError("ftruncate " + name_);
+            ::shm_unlink(name_.c_str());
+            throw std::runtime_error(error);
+        }
+        void* base = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+        if (base == MAP_FAILED) {
+            std::string error = systemError("mmap " + name_);
+            ::shm_unlink(name_.c_str());
+            throw std::runtime_error(error);
+        }
+        base_ = static_cast<double*>(base);
+    }
+    ~SharedArena() {
+        ::munmap(base_, bytes_);
+        unlink();
+    }
+    SharedArena(const SharedArena&) = delete;
+    SharedArena& operator=(const SharedArena&) = delete;
+
+    // Removes the name; mappings, including the client's, stay valid
+    void unlink() {
+        if (linked_) {
+            ::shm_unlink(name_.c_str());
+            linked_ = false;
+        }
+    }
+
+    const std::string& name() const { return name_; }
+    int generation() const { return generation_; }
+    size_t bytes() const { return bytes_; }
+    double* fields() const { return base_; }
+    double* dopant() const { return base_ + field_doubles_; }
+    size_t fieldDoubles() const { return field_doubles_; }
+    size_t dopantCapacity() const { return dopant_capacity_; }
+
+private:
+    std::string name_;
+    int generation_;
+    size_t field_doubles_;
+    size_t dopant_capacity_;
+    size_t bytes_;
+    double* base_ = nullptr;
+    bool linked_ = true;
+};
+
+SimulationServer::SimulationServer(const std::string& socket_path) : socket_path_(socket_path) {}
+
+SimulationServer::~SimulationServer() {
+    // Wafers may keep their mappings alive past the server; their names go now
+    for (auto& entry : arenas_) {
+        if (entry.second) {
+            entry.second->unlink();
+        }
+    }
+}
+
+std::string SimulationServer::nextSegmentName() {
+    return "/semipro-" + std::to_string(::getpid()) + "-" + std::to_string(++generation_);
+}
+
+std::string SimulationServer::publish(const std::string& wafer_name) {
+    auto wafer = SimulationEngine::getInstance().getWafer(wafer_name);
+    std::as_const(*wafer).getPhotoresistPattern(); // Brings the pattern channel up to date
+    FieldStore& store = wafer->getFieldStore();
+    const FieldStore& fields = store;
+    std::shared_ptr<SharedArena>& arena = arenas_[wafer_name];
+    if (fields.cellCount() == 0) {
+        return "null";
+    }
+
+    // Materializing lazy channels gives the client their defaults, not stale memory
+    for (int c = 0; c < fields.channelCount(); ++c) {
+        store.materialize(c);
+    }
+    const Eigen::ArrayXd& dopant = wafer->getDopantProfile();
+    const size_t dopant_length = static_cast<size_t>(dopant.size());
+    if (!arena || fields.data(0) != arena->fields() || dopant_length > arena->dopantCapacity()) {
+        constexpr size_t kDopantBlock = 512;
+        const size_t field_doubles = fields.stride() * fields.channelCount();
+        const size_t dopant_capacity = (std::max<size_t>(dopant_length, 1) + kDopantBlock - 1) / kDopantBlock * kDopantBlock;
+        auto next = std::make_shared<SharedArena>(nextSegmentName(), generation_, field_doubles, dopant_capacity);
+        std::memcpy(next->fields(), fields.data(0), field_doubles * sizeof(double));
+        store.adoptArena(fields.rows(), fields.cols(), fields.stride(),
+                         AlignedFieldBuffer(next->fields(), AlignedFieldFree{next}),
+                         std::vector<bool>(fields.channelCount(), true));
+        if (arena) {
+            arena->unlink();
+        }
+        arena = next;
+    }
+    std::copy(dopant.data(), dopant.data() + dopant_length, arena->dopant());
+
+    std::ostringstream json;
+    json << "{\"segment\": " << jsonQuote(arena->name()) << ", \"generation\": " << arena->generation()
+         << ", \"bytes\": " << arena->bytes() << ", \"rows\": " << fields.rows() << ", \"cols\": " << fields.cols()
+         << ", \"stride\": " << fields.stride() << ", \"channels\": [";
+    for (int c = 0; c < fields.channelCount(); ++c) {
+        json << (c ? ", " : "") << jsonQuote(fields.channelName(c));
+    }
+    json << "], \"dopant_offset\": " << arena->fieldDoubles() << ", \"dopant_length\": " << dopant_length << "}";
+    return json.str();
+}
+
+std::string SimulationServer::handle(const std::string& request) {
+    try {
+        const JsonValue node = JsonValue::parse(request);
+        const std::string op = node.find("op") ? node["op"].asString() : "";
+        if (op == "ping") {
+            return "{\"ok\": true}";
+        }
+        if (op == "shutdown") {
+            stopping_ = true;
+            return "{\"ok\": true}";
+        }
+
+        const std::string wafer = node.find("wafer") ? node["wafer"].asString() : "main_wafer";
+        if (op == "process") {
+            const std::string& process = node["process"].asString();
+            if (process != "geometry_init" && arenas_.find(wafer) == arenas_.end()) {
+                runBridgeProcess(wafer, "geometry_init", JsonValue());
+            }
+            const bool success = runBridgeProcess(wafer, process, node["config"]);
+            return std::string("{\"ok\": true, \"success\": ") + (success ? "true" : "false") +
+                   ", \"fields\": " + publish(wafer) + "}";
+        }
+        if (op == "fields") {
+            const bool known = arenas_.find(wafer) != arenas_.end();
+            return "{\"ok\": true, \"fields\": " + (known ? publish(wafer) : std::string("null")) + "}";
+        }
+        throw std::invalid_argument("Unknown request op '" + op + "'");
+    } catch (const std::exception& e) {
+        return "{\"ok\": false, \"error\": " + jsonQuote(e.what()) + "}";
+    }
+}
+
+void SimulationServer::run() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path_.empty() || socket_path_.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Invalid server socket path: " + socket_path_);
+    }
+    std::strncpy(address.sun_path, socket_path_.c_str(), sizeof(address.sun_path) - 1);
+
+    Descriptor listener(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (listener.get() < 0) {
+        throw std::runtime_error(systemError("socket"));
+    }
+    ::unlink(socket_path_.c_str());
+    if (::bind(listener.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listener.get(), 1) != 0) {
+        throw std::runtime_error(systemError("bind " + socket_path_));
+    }
+    Logger::getInstance().log("Simulation server listening on " + socket_path_);
+
+    while (!stopping_) {
+        Descriptor client(::accept(listener.get(), nullptr, nullptr));
+        if (client.get() < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(systemError("accept"));
+        }
+        std::string pending;
+        char buffer[4096];
+        while (!stopping_) {
+            ssize_t n = ::recv(client.get(), buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break; // Client went away; wait for the next one
+            }
+            pending.append(buffer, static_cast<size_t>(n));
+            size_t end;
+            while (!stopping_ && (end = pending.find('\n')) != std::string::npos) {
+                std::string reply = handle(pending.substr(0, end));
+                pending.erase(0, end + 1);
+                try {
+                    sendAll(client.get(), reply + "\n");
+                } catch (const std::runtime_error& e) {
+                    Logger::getInstance().log(e.what());
+                    pending.clear();
+                    break;
+                }
+            }
+        }
+    }
+    ::unlink(socket_path_.c_str());
+}
+
+} // namespace SemiPRO
@@ -0,0 +1,79 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+
+#include "json_value.hpp"
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace SemiPRO {
+
+/**
+ * @brief Runs one bridge operation on a wafer registered with the engine
+ *
+ * Understands "geometry_init" (registers a fresh wafer), "grid_init",
+ * "oxidation", "doping", "deposition" and "etching", and reads the
+ * loosely typed keys the Python bridge sends (e.g. "atmosphere": "wet").
+ * Shared by the command line driver and SimulationServer, so a config
+ * means the same thing on both paths. A null config uses the defaults.
+ * Returns false for unknown operations and failed processes; throws
+ * std::invalid_argument when a key holds the wrong type.
+ */
+bool runBridgeProcess(const std::string& wafer_name, const std::string& process_type, const JsonValue& config);
+
+/**
+ * @brief runBridgeProcess without waiting for the process
+ *
+ * The process runs on the engine's task pool; "geometry_init",
+ * "grid_init" and unknown operations complete before this returns.
+ */
+std::future<bool> submitBridgeProcess(const std::string& wafer_name, const std::string& process_type,
+                                      const JsonValue& config);
+
+/**
+ * @brief Long-lived simulator endpoint for the Python bridge
+ *
+ * Serves newline-delimited JSON requests on a Unix domain socket, one
+ * client at a time, and answers each with one JSON line. Wafers stay
+ * registered with the engine between requests. After each request the
+ * wafer's FieldStore arena lives in a POSIX shared-memory segment, so the
+ * client maps the fields as NumPy views of the live C++ storage instead
+ * of receiving copies. The dopant profile is copied in after the field
+ * channels. A reply describes the segment (name, generation, shape,
+ * channel stride in doubles). A new generation means the process
+ * reallocated the store and the fields moved to a new segment.
+ *
+ * Requests: {"op": "process", "wafer": w, "process": p, "config": {...}},
+ * {"op": "fields", "wafer": w}, {"op": "ping"} and {"op": "shutdown"}.
+ * A process request for a wafer the server has not seen first runs
+ * "geometry_init" with defaults; a fields request for one yields null.
+ */
+class SimulationServer {
+public:
+    explicit SimulationServer(const std::string& socket_path);
+    ~SimulationServer();
+    SimulationServer(const SimulationServer&) = delete;
+    SimulationServer& operator=(const SimulationServer&) = delete;
+
+    // Returns after a shutdown request; throws std::runtime_error if the
+    // socket cannot be set up
+    void run();
+    // One request line to one reply line (without the newline)
+    std::string handle(const std::string& request);
+
+private:
+    class SharedArena;
+
+    // Moves the wafer's fields into shared memory if they are not there
+    // yet and returns the segment description as a JSON object
+    std::string publish(const std::string& wafer_name);
+    std::string nextSegmentName();
+
+    std::string socket_path_;
+    std::unordered_map<std::string, std::shared_ptr<SharedArena>> arenas_;
+    int generation_ = 0;
+    bool stopping_ = false;
+};
+
+} // namespace SemiPRO
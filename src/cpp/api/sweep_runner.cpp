@@ -0,0 +1,197 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "sweep_runner.hpp"
+#include "simulation_engine.hpp"
+#include "simulation_server.hpp"
+#include "task_scheduler.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+
+namespace SemiPRO {
+
+namespace {
+
+const char* const kMetricColumns[] = {"success",   "film_layers", "film_thickness", "top_layer", "grid_min",
+                                      "grid_mean", "grid_max",    "dopant_peak",    "error"};
+
+struct PendingPoint {
+    size_t index;
+    std::string wafer;
+    std::future<bool> result;
+    std::string error; // Set when the point failed before its process ran
+};
+
+// The metric cells of one finished point, in kMetricColumns order
+std::vector<JsonValue> pointMetrics(PendingPoint& pending) {
+    std::vector<JsonValue> row(std::size(kMetricColumns));
+    bool success = false;
+    if (pending.error.empty()) {
+        try {
+            success = TaskScheduler::getInstance().wait(pending.result);
+            if (!success) {
+                pending.error = "process failed";
+            }
+        } catch (const std::exception& e) {
+            pending.error = e.what();
+        }
+    }
+    row[0] = JsonValue::boolean(success);
+    if (!success) {
+        row[8] = JsonValue::string(pending.error);
+        return row;
+    }
+
+    auto wafer = SimulationEngine::getInstance().getWafer(pending.wafer);
+    const auto& films = wafer->getFilmLayers();
+    double film_thickness = 0.0;
+    for (const auto& film : films) {
+        film_thickness += film.first;
+    }
+    row[1] = JsonValue::number(static_cast<double>(films.size()));
+    row[2] = JsonValue::number(film_thickness);
+    row[3] = films.empty() ? JsonValue::string(wafer->getMaterialId()) : JsonValue::string(films.back().second);
+    const auto grid = static_cast<const Wafer&>(*wafer).getGrid();
+    if (grid.size() > 0) {
+        row[4] = JsonValue::number(grid.minCoeff());
+        row[5] = JsonValue::number(grid.mean());
+        row[6] = JsonValue::number(grid.maxCoeff());
+    }
+    const auto& dopants = static_cast<const Wafer&>(*wafer).getDopantProfile();
+    row[7] = JsonValue::number(dopants.size() > 0 ? dopants.maxCoeff() : 0.0);
+    return row;
+}
+
+void writeCsvCell(std::ostream& out, const JsonValue& cell) {
+    if (cell.isNull()) {
+        return;
+    }
+    const std::string text = cell.scalarText();
+    if (text.find_first_of(",\"\r\n") == std::string::npos) {
+        out << text;
+        return;
+    }
+    out << '"';
+    for (char c : text) {
+        out << (c == '"' ? "\"\"" : std::string(1, c));
+    }
+    out << '"';
+}
+
+} // namespace
+
+SweepTable runSweep(const ConfigSweep& sweep, const std::string& default_process, int max_in_flight) {
+    auto& engine = SimulationEngine::getInstance();
+    if (max_in_flight <= 0) {
+        max_in_flight = 4 * std::max(1, TaskScheduler::getInstance().threadCount());
+    }
+
+    SweepTable table;
+    table.columns = {"point", "name"};
+    table.columns.insert(table.columns.end(), sweep.axes.begin(), sweep.axes.end());
+    table.columns.insert(table.columns.end(), std::begin(kMetricColumns), std::end(kMetricColumns));
+    table.cells.assign(table.columns.size(), {});
+    for (auto& column : table.cells) {
+        column.reserve(sweep.points.size());
+    }
+    const size_t metrics_begin = 2 + sweep.axes.size();
+
+    auto finish = [&](PendingPoint& pending) {
+        std::vector<JsonValue> metrics = pointMetrics(pending);
+        engine.unregisterWafer(pending.wafer);
+        const size_t point = pending.index;
+        table.cells[0].push_back(JsonValue::number(static_cast<double>(point)));
+        table.cells[1].push_back(JsonValue::string(sweep.points[point].name));
+        for (size_t a = 0; a < sweep.axes.size(); ++a) {
+            table.cells[2 + a].push_back(sweep.values[point][a]);
+        }
+        for (size_t m = 0; m < metrics.size(); ++m) {
+            table.cells[metrics_begin + m].push_back(std::move(metrics[m]));
+        }
+        if (!table.cells[metrics_begin].back().asBool()) {
+            ++table.failures;
+            Logger::getInstance().log("Sweep " + sweep.points[point].name + " failed: " + pending.error);
+        }
+    };
+
+    std::deque<PendingPoint> in_flight;
+    for (size_t point = 0; point < sweep.points.size(); ++point) {
+        const ConfigJob& job = sweep.points[point];
+        PendingPoint pending{point, "sweep" + std::to_string(point), {}, {}};
+        try {
+            bool ready = runBridgeProcess(pending.wafer, "geometry_init", job.geometry);
+            if (ready && !job.grid.isNull()) {
+                ready = runBridgeProcess(pending.wafer, "grid_init", job.grid);
+            }
+            if (!ready) {
+                pending.error = "wafer setup failed";
+            } else {
+                const std::string& process = job.process.empty() ? default_process : job.process;
+                pending.result = submitBridgeProcess(pending.wafer, process, job.parameters);
+            }
+        } catch (const std::exception& e) {
+            pending.error = e.what();
+        }
+        in_flight.push_back(std::move(pending));
+        if (in_flight.size() >= static_cast<size_t>(max_in_flight)) {
+            finish(in_flight.front());
+            in_flight.pop_front();
+        }
+    }
+    while (!in_flight.empty()) {
+        finish(in_flight.front());
+        in_flight.pop_front();
+    }
+
+    Logger::getInstance().log("Sweep completed: " + std::to_string(sweep.points.size() - table.failures) + " of " +
+                              std::to_string(sweep.points.size()) + " points succeeded");
+    return table;
+}
+
+void SweepTable::writeCsv(std::ostream& out) const {
+    for (size_t c = 0; c < columns.size(); ++c) {
+        out << (c > 0 ? "," : "");
+        writeCsvCell(out, JsonValue::string(columns[c]));
+    }
+    out << '\n';
+    for (size_t row = 0; row < rows(); ++row) {
+        for (size_t c = 0; c < columns.size(); ++c) {
+            out << (c > 0 ? "," : "");
+            writeCsvCell(out, cells[c][row]);
+        }
+        out << '\n';
+    }
+}
+
+void SweepTable::writeJson(std::ostream& out) const {
+    JsonWriter json(out);
+    json.beginObject().key("columns").beginObject();
+    for (size_t c = 0; c < columns.size(); ++c) {
+        json.key(columns[c]).beginArray();
+        for (const JsonValue& cell : cells[c]) {
+            json.value(cell);
+        }
+        json.endArray();
+    }
+    json.endObject().endObject().raw("\n");
+}
+
+void writeSweepTable(const SweepTable& table, const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Cannot write sweep results to " + path);
+    }
+    const std::string json = ".json";
+    if (path.size() >= json.size() && path.compare(path.size() - json.size(), json.size(), json) == 0) {
+        table.writeJson(out);
+    } else {
+        table.writeCsv(out);
+    }
+    if (!out.flush()) {
+        throw std::runtime_error("Cannot write sweep results to " + path);
+    }
+}
+
+} // namespace SemiPRO
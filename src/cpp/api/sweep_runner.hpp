@@ -0,0 +1,48 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+
+#include "job_manifest.hpp"
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace SemiPRO {
+
+/**
+ * @brief Per-point results of a sweep, stored column by column
+ *
+ * Columns: "point", "name", one per axis (the axis name), "success",
+ * "film_layers", "film_thickness", "top_layer", "grid_min", "grid_mean",
+ * "grid_max", "dopant_peak" and "error". Metrics of a failed point are
+ * null.
+ */
+struct SweepTable {
+    std::vector<std::string> columns;
+    std::vector<std::vector<JsonValue>> cells; // cells[column][point]
+    size_t failures = 0;
+
+    size_t rows() const { return cells.empty() ? 0 : cells.front().size(); }
+    // One header line, then one line per point
+    void writeCsv(std::ostream& out) const;
+    // {"columns": {"point": [...], ...}}
+    void writeJson(std::ostream& out) const;
+};
+
+/**
+ * @brief Runs every point of a sweep in this process
+ *
+ * Each point gets a wafer of its own, set up synchronously, whose process
+ * then runs on the engine's task pool. At most max_in_flight points
+ * (0: four per pool thread) are in flight; as each finishes, in point
+ * order, its metrics are read and its wafer is dropped, so memory stays
+ * bounded however large the sweep. Points without a process use
+ * default_process. A failing point is recorded in the table and does not
+ * stop the sweep.
+ */
+SweepTable runSweep(const ConfigSweep& sweep, const std::string& default_process, int max_in_flight = 0);
+
+// JSON when the path ends in ".json", CSV otherwise; throws
+// std::runtime_error if the file cannot be written
+void writeSweepTable(const SweepTable& table, const std::string& path);
+
+} // namespace SemiPRO
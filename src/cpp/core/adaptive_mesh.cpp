@@ -0,0 +1,290 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "adaptive_mesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <Eigen/Sparse>
+
+namespace SemiPRO {
+
+namespace {
+
+// Spreads the low 32 bits of x to the even bits of the result
+std::uint64_t spread(std::uint64_t x) {
+    x &= 0xFFFFFFFFull;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x << 2)) & 0x3333333333333333ull;
+    x = (x | (x << 1)) & 0x5555555555555555ull;
+    return x;
+}
+
+void split(const AdaptiveMesh::Leaf& leaf, int rows, int cols, std::vector<AdaptiveMesh::Leaf>& out) {
+    const int half = leaf.size() / 2;
+    for (int di = 0; di < 2; ++di) {
+        for (int dj = 0; dj < 2; ++dj) {
+            const int row = leaf.row + di * half;
+            const int col = leaf.col + dj * half;
+            if (row < rows && col < cols) {
+                out.push_back({row, col, leaf.level - 1});
+            }
+        }
+    }
+}
+
+} // namespace
+
+AdaptiveMesh::AdaptiveMesh(int rows, int cols, int max_levels)
+    : rows_(rows), cols_(cols), max_levels_(max_levels) {
+    if (rows < 1 || cols < 1) {
+        throw std::invalid_argument("AdaptiveMesh: grid must not be empty");
+    }
+    if (max_levels < 0 || max_levels > 15) {
+        throw std::invalid_argument("AdaptiveMesh: max_levels must be in 0..15");
+    }
+    const int block = 1 << max_levels;
+    std::vector<Leaf> pending;
+    for (int row = 0; row < rows; row += block) {
+        for (int col = 0; col < cols; col += block) {
+            pending.push_back({row, col, max_levels});
+        }
+    }
+    // Blocks overhanging the edge split until they fit
+    while (!pending.empty()) {
+        const Leaf leaf = pending.back();
+        pending.pop_back();
+        if (leaf.row + leaf.size() <= rows && leaf.col + leaf.size() <= cols) {
+            leaves_.push_back(leaf);
+        } else {
+            split(leaf, rows, cols, pending);
+        }
+    }
+    sort_leaves();
+}
+
+std::uint64_t AdaptiveMesh::morton(int i, int j) {
+    return spread(static_cast<std::uint64_t>(i)) << 1 | spread(static_cast<std::uint64_t>(j));
+}
+
+void AdaptiveMesh::sort_leaves() {
+    std::sort(leaves_.begin(), leaves_.end(),
+              [](const Leaf& a, const Leaf& b) { return morton(a.row, a.col) < morton(b.row, b.col); });
+    codes_.resize(leaves_.size());
+    for (std::size_t n = 0; n < leaves_.size(); ++n) {
+        codes_[n] = morton(leaves_[n].row, leaves_[n].col);
+    }
+}
+
+int AdaptiveMesh::find_leaf(int i, int j) const {
+    // An aligned square of 4^level cells is a contiguous run of codes
+    const auto it = std::upper_bound(codes_.begin(), codes_.end(), morton(i, j));
+    return static_cast<int>(it - codes_.begin()) - 1;
+}
+
+std::vector<std::pair<double, double>> AdaptiveMesh::get_mesh_points() const {
+    std::vector<std::pair<double, double>> points;
+    points.reserve(leaves_.size());
+    for (const Leaf& leaf : leaves_) {
+        points.emplace_back(leaf.row + 0.5 * leaf.size(), leaf.col + 0.5 * leaf.size());
+    }
+    return points;
+}
+
+void AdaptiveMesh::refine_mesh(const Eigen::ArrayXXd& indicator, double threshold) {
+    if (indicator.rows() != rows_ || indicator.cols() != cols_) {
+        throw std::invalid_argument("AdaptiveMesh: indicator does not match the grid");
+    }
+    // Extremes over every aligned block of each level, built bottom up
+    std::vector<Eigen::ArrayXXd> lows{indicator}, highs{indicator};
+    for (int level = 1; level <= max_levels_; ++level) {
+        const Eigen::ArrayXXd& low = lows.back();
+        const Eigen::ArrayXXd& high = highs.back();
+        const Eigen::Index m = (low.rows() + 1) / 2, n = (low.cols() + 1) / 2;
+        Eigen::ArrayXXd next_low(m, n), next_high(m, n);
+        for (Eigen::Index j = 0; j < n; ++j) {
+            for (Eigen::Index i = 0; i < m; ++i) {
+                const Eigen::Index h = std::min<Eigen::Index>(2, low.rows() - 2 * i);
+                const Eigen::Index w = std::min<Eigen::Index>(2, low.cols() - 2 * j);
+                next_low(i, j) = low.block(2 * i, 2 * j, h, w).minCoeff();
+                next_high(i, j) = high.block(2 * i, 2 * j, h, w).maxCoeff();
+            }
+        }
+        lows.push_back(std::move(next_low));
+        highs.push_back(std::move(next_high));
+    }
+
+    std::vector<Leaf> pending;
+    pending.swap(leaves_);
+    while (!pending.empty()) {
+        const Leaf leaf = pending.back();
+        pending.pop_back();
+        const int i = leaf.row >> leaf.level, j = leaf.col >> leaf.level;
+        if (leaf.level > 0 && highs[leaf.level](i, j) - lows[leaf.level](i, j) > threshold) {
+            split(leaf, rows_, cols_, pending);
+        } else {
+            leaves_.push_back(leaf);
+        }
+    }
+    sort_leaves();
+    while (balance_pass()) {
+    }
+}
+
+bool AdaptiveMesh::balance_pass() {
+    // A leaf splits when a face neighbour is more than one level finer
+    std::vector<char> coarse(leaves_.size(), 0);
+    for (std::size_t n = 0; n < leaves_.size(); ++n) {
+        const Leaf& leaf = leaves_[n];
+        if (leaf.level < 2) {
+            continue;
+        }
+        const int s = leaf.size();
+        const auto too_fine = [&](int i, int j) { return leaves_[find_leaf(i, j)].level < leaf.level - 1; };
+        for (int k = 0; k < s && !coarse[n]; ++k) {
+            coarse[n] = (leaf.row > 0 && too_fine(leaf.row - 1, leaf.col + k)) ||
+                        (leaf.row + s < rows_ && too_fine(leaf.row + s, leaf.col + k)) ||
+                        (leaf.col > 0 && too_fine(leaf.row + k, leaf.col - 1)) ||
+                        (leaf.col + s < cols_ && too_fine(leaf.row + k, leaf.col + s));
+        }
+    }
+    if (std::find(coarse.begin(), coarse.end(), 1) == coarse.end()) {
+        return false;
+    }
+    std::vector<Leaf> balanced;
+    balanced.reserve(leaves_.size());
+    for (std::size_t n = 0; n < leaves_.size(); ++n) {
+        if (coarse[n]) {
+            split(leaves_[n], rows_, cols_, balanced);
+        } else {
+            balanced.push_back(leaves_[n]);
+        }
+    }
+    leaves_.swap(balanced);
+    sort_leaves();
+    return true;
+}
+
+std::vector<AdaptiveMesh::Face> AdaptiveMesh::faces() const {
+    std::vector<Face> faces;
+    faces.reserve(2 * leaves_.size());
+    for (int a = 0; a < static_cast<int>(leaves_.size()); ++a) {
+        const Leaf& leaf = leaves_[a];
+        const double s = leaf.size();
+        const double centre_row = leaf.row + 0.5 * s, centre_col = leaf.col + 0.5 * s;
+        // Edge faces lie half a leaf from the centre
+        if (leaf.row == 0) {
+            faces.push_back({a, -1, 2.0, -0.5 * s, 0.0});
+        }
+        if (leaf.col == 0) {
+            faces.push_back({a, -1, 2.0, 0.0, -0.5 * s});
+        }
+        // Every interior face is taken once, from its west or north leaf
+        for (int side = 0; side < 2; ++side) {
+            const bool east = side == 0;
+            if ((east ? leaf.col : leaf.row) + leaf.size() == (east ? cols_ : rows_)) {
+                faces.push_back({a, -1, 2.0, east ? 0.0 : 0.5 * s, east ? 0.5 * s : 0.0});
+                continue;
+            }
+            for (int k = 0; k < leaf.size();) {
+                const int b = east ? find_leaf(leaf.row + k, leaf.col + leaf.size())
+                                   : find_leaf(leaf.row + leaf.size(), leaf.col + k);
+                const Leaf& other = leaves_[b];
+                const double t = other.size();
+                faces.push_back({a, b, std::min(s, t) / (0.5 * (s + t)), other.row + 0.5 * t - centre_row,
+                                 other.col + 0.5 * t - centre_col});
+                k = (east ? other.row - leaf.row : other.col - leaf.col) + other.size();
+            }
+        }
+    }
+    return faces;
+}
+
+Eigen::VectorXd AdaptiveMesh::restrict_from_regular_grid(const Eigen::ArrayXXd& grid) const {
+    if (grid.rows() != rows_ || grid.cols() != cols_) {
+        throw std::invalid_argument("AdaptiveMesh: grid field does not match the grid");
+    }
+    Eigen::VectorXd values(leaves_.size());
+#pragma omp parallel for schedule(static)
+    for (long n = 0; n < static_cast<long>(leaves_.size()); ++n) {
+        const Leaf& leaf = leaves_[n];
+        values(n) = grid.block(leaf.row, leaf.col, leaf.size(), leaf.size()).mean();
+    }
+    return values;
+}
+
+void AdaptiveMesh::interpolate_to_regular_grid(const Eigen::VectorXd& values, Eigen::ArrayXXd& grid,
+                                               double boundary) const {
+    if (values.size() != static_cast<Eigen::Index>(leaves_.size())) {
+        throw std::invalid_argument("AdaptiveMesh: expected one value per leaf");
+    }
+    // Normal equations of each leaf's gradient over its face neighbours
+    std::vector<Eigen::Matrix2d> normal(leaves_.size(), Eigen::Matrix2d::Zero());
+    std::vector<Eigen::Vector2d> moment(leaves_.size(), Eigen::Vector2d::Zero());
+    for (const Face& face : faces()) {
+        const Eigen::Vector2d offset(face.offset_row, face.offset_col);
+        const double change = (face.b >= 0 ? values(face.b) : boundary) - values(face.a);
+        normal[face.a] += offset * offset.transpose();
+        moment[face.a] += offset * change;
+        if (face.b >= 0) {
+            normal[face.b] += offset * offset.transpose();
+            moment[face.b] += offset * change;
+        }
+    }
+
+    grid.resize(rows_, cols_);
+#pragma omp parallel for schedule(static)
+    for (long n = 0; n < static_cast<long>(leaves_.size()); ++n) {
+        const Leaf& leaf = leaves_[n];
+        const int s = leaf.size();
+        Eigen::Vector2d gradient = Eigen::Vector2d::Zero();
+        if (s > 1 && std::abs(normal[n].determinant()) > 1e-12 * normal[n].trace() * normal[n].trace()) {
+            gradient = normal[n].ldlt().solve(moment[n]);
+        }
+        const double centre = 0.5 * s - 0.5; // Of the leaf's cells, relative to its first
+        for (int j = 0; j < s; ++j) {
+            for (int i = 0; i < s; ++i) {
+                grid(leaf.row + i, leaf.col + j) = values(n) + gradient(0) * (i - centre) + gradient(1) * (j - centre);
+            }
+        }
+    }
+}
+
+Eigen::VectorXd AdaptiveMesh::solve_diffusion(const Eigen::VectorXd& conductivity, const Eigen::VectorXd& source,
+                                              double boundary) const {
+    const Eigen::Index n = static_cast<Eigen::Index>(leaves_.size());
+    if (conductivity.size() != n || source.size() != n) {
+        throw std::invalid_argument("AdaptiveMesh: expected one conductivity and source per leaf");
+    }
+    if (!(conductivity.array() > 0.0).all()) {
+        throw std::invalid_argument("AdaptiveMesh: conductivity must be positive");
+    }
+    const std::vector<Face> all = faces();
+    std::vector<Eigen::Triplet<double>> entries;
+    entries.reserve(4 * all.size());
+    Eigen::VectorXd rhs = source;
+    for (const Face& face : all) {
+        const double ka = conductivity(face.a);
+        if (face.b < 0) {
+            const double g = ka * face.conductance_factor;
+            entries.emplace_back(face.a, face.a, g);
+            rhs(face.a) += g * boundary;
+            continue;
+        }
+        const double kb = conductivity(face.b);
+        const double g = 2.0 * ka * kb / (ka + kb) * face.conductance_factor;
+        entries.emplace_back(face.a, face.a, g);
+        entries.emplace_back(face.b, face.b, g);
+        entries.emplace_back(face.a, face.b, -g);
+        entries.emplace_back(face.b, face.a, -g);
+    }
+    Eigen::SparseMatrix<double> matrix(n, n);
+    matrix.setFromTriplets(entries.begin(), entries.end());
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver(matrix);
+    if (solver.info() != Eigen::Success) {
+        throw std::runtime_error("AdaptiveMesh: diffusion matrix factorization failed");
+    }
+    return solver.solve(rhs);
+}
+
+} // namespace SemiPRO
@@ -0,0 +1,107 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <Eigen/Dense>
+
+namespace SemiPRO {
+
+/**
+ * @brief Adaptive quadtree over a regular grid, stored flat
+ *
+ * Leaves are squares of 2^level grid cells, aligned to their size and
+ * kept in one vector sorted by the Morton code of their first cell, so
+ * the leaf holding a cell is a binary search away and no node points at
+ * another. The mesh starts from blocks of 2^max_levels cells (split
+ * further where they overhang the grid's edge) and is refined wherever an
+ * indicator, such as the conductivity or the heat source, varies across a
+ * leaf. Neighbouring leaves then differ by at most one level, so every
+ * face has one or two leaves on each side.
+ *
+ * On this mesh, solve_diffusion is the finite-volume counterpart of the
+ * regular grid's diffusion stencil, and fields move between the two grids
+ * by leaf averages one way and a least-squares linear reconstruction the
+ * other. Regions where nothing varies cost one unknown per block instead
+ * of one per cell.
+ */
+class AdaptiveMesh {
+public:
+    struct Leaf {
+        int row;   // First grid cell
+        int col;
+        int level; // Side of 2^level cells
+        int size() const { return 1 << level; }
+    };
+
+    // Throws std::invalid_argument for an empty grid or a max_levels
+    // outside 0..15
+    AdaptiveMesh(int rows, int cols, int max_levels = 5);
+
+    /**
+     * @brief Splits leaves over which indicator varies by more than
+     * threshold (max - min), down to single cells, then restores the
+     * 2:1 balance. Leaves are only ever split, so successive calls with
+     * different indicators refine for all of them.
+     */
+    void refine_mesh(const Eigen::ArrayXXd& indicator, double threshold);
+
+    const std::vector<Leaf>& leaves() const { return leaves_; }
+    std::size_t size() const { return leaves_.size(); }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    // Index of the leaf holding grid cell (i, j)
+    int find_leaf(int i, int j) const;
+    // Leaf centres in grid cells, (row, column)
+    std::vector<std::pair<double, double>> get_mesh_points() const;
+
+    /**
+     * @brief Average of a grid field over each leaf
+     */
+    Eigen::VectorXd restrict_from_regular_grid(const Eigen::ArrayXXd& grid) const;
+
+    /**
+     * @brief Grid field from leaf values, each leaf's value plus its
+     * least-squares gradient from its face neighbours; leaves on the edge
+     * also fit the boundary value there
+     */
+    void interpolate_to_regular_grid(const Eigen::VectorXd& values, Eigen::ArrayXXd& grid,
+                                     double boundary = 0.0) const;
+
+    /**
+     * @brief Solves -div(k grad u) = f over the leaves with u = boundary
+     * on the grid's outer edge
+     *
+     * conductivity holds each leaf's k and source each leaf's integral of
+     * f in units of the grid spacing squared, as restrict_from_regular_grid
+     * times the leaf area gives. A face between leaves conducts with the
+     * harmonic mean of their k over its length divided by the distance
+     * between their centres. Throws std::invalid_argument for vectors of
+     * the wrong size or a conductivity that is not positive.
+     */
+    Eigen::VectorXd solve_diffusion(const Eigen::VectorXd& conductivity, const Eigen::VectorXd& source,
+                                    double boundary = 0.0) const;
+
+private:
+    struct Face {
+        int a;       // West or north leaf
+        int b;       // East or south leaf, -1 for the grid's edge
+        double conductance_factor; // Length over centre distance
+        double offset_row; // From a's centre to b's (or to the edge), in cells
+        double offset_col;
+    };
+
+    static std::uint64_t morton(int i, int j);
+    void sort_leaves();
+    bool balance_pass();
+    std::vector<Face> faces() const;
+
+    int rows_;
+    int cols_;
+    int max_levels_;
+    std::vector<Leaf> leaves_;
+    std::vector<std::uint64_t> codes_; // Morton code of each leaf's first cell
+};
+
+} // namespace SemiPRO
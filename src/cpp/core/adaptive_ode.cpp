@@ -0,0 +1,175 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "adaptive_ode.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Dormand-Prince tableau; the fifth-order weights are the last row of a, and
+// e holds the fifth- minus fourth-order weights for the error estimate
+constexpr double c2 = 1.0 / 5.0, c3 = 3.0 / 10.0, c4 = 4.0 / 5.0, c5 = 8.0 / 9.0;
+constexpr double a21 = 1.0 / 5.0;
+constexpr double a31 = 3.0 / 40.0, a32 = 9.0 / 40.0;
+constexpr double a41 = 44.0 / 45.0, a42 = -56.0 / 15.0, a43 = 32.0 / 9.0;
+constexpr double a51 = 19372.0 / 6561.0, a52 = -25360.0 / 2187.0, a53 = 64448.0 / 6561.0, a54 = -212.0 / 729.0;
+constexpr double a61 = 9017.0 / 3168.0, a62 = -355.0 / 33.0, a63 = 46732.0 / 5247.0, a64 = 49.0 / 176.0,
+                 a65 = -5103.0 / 18656.0;
+constexpr double a71 = 35.0 / 384.0, a73 = 500.0 / 1113.0, a74 = 125.0 / 192.0, a75 = -2187.0 / 6784.0,
+                 a76 = 11.0 / 84.0;
+constexpr double e1 = 71.0 / 57600.0, e3 = -71.0 / 16695.0, e4 = 71.0 / 1920.0, e5 = -17253.0 / 339200.0,
+                 e6 = 22.0 / 525.0, e7 = -1.0 / 40.0;
+
+constexpr double kSafety = 0.9;
+constexpr double kMinFactor = 0.2;
+constexpr double kMaxFactor = 5.0;
+
+double scaledNorm(const AdaptiveOde::Vector& v, const AdaptiveOde::Vector& y, const AdaptiveOde::Vector& y_new,
+                  const AdaptiveOde::Options& options) {
+  const Eigen::ArrayXd scale = options.absolute + options.relative * y.cwiseAbs().cwiseMax(y_new.cwiseAbs()).array();
+  return std::sqrt((v.array() / scale).square().mean());
+}
+
+// y at t + step by the fifth-order solution, k1 = f(t, y); the error
+// estimate and f at the new point are returned beside it
+struct DormandPrinceStep {
+  AdaptiveOde::Vector y, k7, error;
+};
+
+DormandPrinceStep dormandPrinceStep(const AdaptiveOde::Rhs& f, double t, const AdaptiveOde::Vector& y,
+                                    const AdaptiveOde::Vector& k1, double step) {
+  const AdaptiveOde::Vector k2 = f(t + c2 * step, y + step * (a21 * k1));
+  const AdaptiveOde::Vector k3 = f(t + c3 * step, y + step * (a31 * k1 + a32 * k2));
+  const AdaptiveOde::Vector k4 = f(t + c4 * step, y + step * (a41 * k1 + a42 * k2 + a43 * k3));
+  const AdaptiveOde::Vector k5 = f(t + c5 * step, y + step * (a51 * k1 + a52 * k2 + a53 * k3 + a54 * k4));
+  const AdaptiveOde::Vector k6 = f(t + step, y + step * (a61 * k1 + a62 * k2 + a63 * k3 + a64 * k4 + a65 * k5));
+  DormandPrinceStep result;
+  result.y = y + step * (a71 * k1 + a73 * k3 + a74 * k4 + a75 * k5 + a76 * k6);
+  result.k7 = f(t + step, result.y);
+  result.error = step * (e1 * k1 + e3 * k3 + e4 * k4 + e5 * k5 + e6 * k6 + e7 * result.k7);
+  return result;
+}
+
+// First component whose sign differs between a and b, -1 for none
+int signChange(const AdaptiveOde::Vector& a, const AdaptiveOde::Vector& b) {
+  for (Eigen::Index i = 0; i < a.size(); ++i) {
+    if ((a(i) < 0.0) != (b(i) < 0.0)) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+} // namespace
+
+AdaptiveOde::Vector AdaptiveOde::integrate(const Rhs& f, double t0, double t1, Vector y0,
+                                           const std::vector<double>& breakpoints, const Options& options,
+                                           Statistics* statistics) {
+  return integrateUntil(f, Rhs(), t0, t1, std::move(y0), breakpoints, options, statistics).y;
+}
+
+AdaptiveOde::Stop AdaptiveOde::integrateUntil(const Rhs& f, const Rhs& event, double t0, double t1, Vector y0,
+                                              const std::vector<double>& breakpoints, const Options& options,
+                                              Statistics* statistics) {
+  if (!(t1 >= t0)) {
+    throw std::invalid_argument("AdaptiveOde: end time precedes start time");
+  }
+  if (!(options.relative > 0.0) || !(options.absolute > 0.0) || !(options.max_step > 0.0)) {
+    throw std::invalid_argument("AdaptiveOde: tolerances and maximum step must be positive");
+  }
+  if (event && !(options.event_tolerance > 0.0)) {
+    throw std::invalid_argument("AdaptiveOde: event tolerance must be positive");
+  }
+  Statistics local;
+  Statistics& stats = statistics ? *statistics : local;
+  stats = Statistics{};
+
+  std::vector<double> ends;
+  for (double t : breakpoints) {
+    if (t > t0 && t < t1) {
+      ends.push_back(t);
+    }
+  }
+  std::sort(ends.begin(), ends.end());
+  ends.erase(std::unique(ends.begin(), ends.end()), ends.end());
+  ends.push_back(t1);
+
+  Vector y = std::move(y0);
+  double t = t0;
+  double h = options.initial_step;
+  Vector g = event ? event(t, y) : Vector();
+  for (double end : ends) {
+    if (end <= t) {
+      continue;
+    }
+    Vector k1 = f(t, y);
+    ++stats.evaluations;
+    if (!(h > 0.0)) {
+      // Hairer's first guess: a step moving y by about 1% of its size
+      const double d0 = scaledNorm(y, y, y, options);
+      const double d1 = scaledNorm(k1, y, y, options);
+      h = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 * (t1 - t0) : 0.01 * d0 / d1;
+    }
+    while (t < end) {
+      h = std::min(h, options.max_step);
+      // Finish the piece exactly rather than leave a sliver before its end
+      const bool last = h >= (end - t) * (1.0 - 1e-12);
+      const double step = last ? end - t : h;
+      if (step <= 1e-14 * std::max(std::abs(t), 1.0)) {
+        throw std::runtime_error("AdaptiveOde: step size underflow");
+      }
+      if (stats.accepted + stats.rejected >= options.max_steps) {
+        throw std::runtime_error("AdaptiveOde: maximum number of steps reached");
+      }
+
+      DormandPrinceStep trial = dormandPrinceStep(f, t, y, k1, step);
+      stats.evaluations += 6;
+
+      const double norm = scaledNorm(trial.error, y, trial.y, options);
+      if (!std::isfinite(norm)) {
+        ++stats.rejected;
+        h = kMinFactor * step;
+        continue;
+      }
+      const double factor =
+          norm == 0.0 ? kMaxFactor : std::clamp(kSafety * std::pow(norm, -0.2), kMinFactor, kMaxFactor);
+      if (norm <= 1.0) {
+        ++stats.accepted;
+        if (event) {
+          Vector g_new = event(t + step, trial.y);
+          int changed = signChange(g, g_new);
+          if (changed >= 0) {
+            // Bisect the fraction of the step at which the sign changes;
+            // shorter steps from the same start only shrink the error
+            double low = 0.0, high = 1.0;
+            while ((high - low) * step > options.event_tolerance * (t1 - t0)) {
+              const double middle = 0.5 * (low + high);
+              DormandPrinceStep part = dormandPrinceStep(f, t, y, k1, middle * step);
+              stats.evaluations += 6;
+              Vector g_middle = event(t + middle * step, part.y);
+              const int changed_middle = signChange(g, g_middle);
+              if (changed_middle >= 0) {
+                high = middle;
+                changed = changed_middle;
+                trial = std::move(part);
+              } else {
+                low = middle;
+              }
+            }
+            return Stop{high == 1.0 && last ? end : t + high * step, std::move(trial.y), changed};
+          }
+          g = std::move(g_new);
+        }
+        t = last ? end : t + step;
+        y = std::move(trial.y);
+        k1 = std::move(trial.k7); // First same as last
+        // A step cut short at a breakpoint says nothing about the next one
+        h = last && step < h ? h : step * factor;
+      } else {
+        ++stats.rejected;
+        h = step * std::min(factor, 1.0);
+      }
+    }
+  }
+  return Stop{t, std::move(y), -1};
+}
@@ -0,0 +1,66 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <Eigen/Dense>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Integrates y' = f(t, y) with the embedded Dormand-Prince 5(4) pair, taking
+// each step as long as the error estimate allows. Across a plateau of a
+// thermal cycle the steps grow to the plateau's length; along a ramp they
+// shrink only as far as the solution's curvature needs. The caller names the
+// breakpoints where f has a kink (the knots of a temperature schedule), and
+// no step crosses one: the step there is cut short and the next starts from
+// a fresh evaluation, so the fifth order holds on every smooth piece.
+class AdaptiveOde {
+public:
+  using Vector = Eigen::VectorXd;
+  using Rhs = std::function<Vector(double, const Vector&)>;
+
+  struct Options {
+    double relative = 1e-6;
+    double absolute = 1e-12;
+    double initial_step = 0.0; // Picked from f at the start when not positive
+    double max_step = std::numeric_limits<double>::infinity();
+    int max_steps = 100000;
+    double event_tolerance = 1e-10; // Of t1 - t0, to which an event is located
+  };
+
+  struct Statistics {
+    int accepted = 0;
+    int rejected = 0;
+    int evaluations = 0;
+  };
+
+  // Where integrateUntil() stopped
+  struct Stop {
+    double time = 0.0;
+    Vector y;
+    int event = -1; // Component of the event function that changed sign; -1 at t1
+  };
+
+  // y at t1 starting from y0 at t0 (t1 >= t0). Throws std::invalid_argument
+  // for t1 < t0 or tolerances that are not positive, and std::runtime_error
+  // when the step size collapses or max_steps is reached.
+  static Vector integrate(const Rhs& f, double t0, double t1, Vector y0,
+                          const std::vector<double>& breakpoints, const Options& options,
+                          Statistics* statistics = nullptr);
+  static Vector integrate(const Rhs& f, double t0, double t1, Vector y0,
+                          const std::vector<double>& breakpoints = {});
+
+  // integrate() stopping early at the first sign change of a component of
+  // event(t, y), located by bisecting the step to event_tolerance; the stop
+  // lies just past it. For right-hand sides that switch form where an event
+  // function crosses zero (a saturating controller, a clamp): integrate
+  // with f frozen in the current regime and restart from each stop in the
+  // next, so no step straddles the switch.
+  static Stop integrateUntil(const Rhs& f, const Rhs& event, double t0, double t1, Vector y0,
+                             const std::vector<double>& breakpoints, const Options& options,
+                             Statistics* statistics = nullptr);
+};
+
+inline AdaptiveOde::Vector AdaptiveOde::integrate(const Rhs& f, double t0, double t1, Vector y0,
+                                                  const std::vector<double>& breakpoints) {
+  return integrate(f, t0, t1, std::move(y0), breakpoints, Options());
+}
@@ -9,7 +9,7 @@ namespace SemiPRO {
 
 // Static member definitions
 std::unique_ptr<AdvancedLogger> AdvancedLogger::instance_ = nullptr;
-std::mutex AdvancedLogger::instance_mutex_;
+std::once_flag AdvancedLogger::instance_once_;
 
 // LogEntry methods
 std::string LogEntry::getFormattedMessage() const {
@@ -28,7 +28,7 @@ std::string LogEntry::getFormattedMessage() const {
     oss << "[" << level_str[static_cast<int>(level)] << "] ";
     
     // Category
-    const char* cat_str[] = {"GEN", "PHYS", "PERF", "SYS", "SIM", "VAL", "NET", "UI", "MEM", "THR"};
+    const char* cat_str[] = {"GEN", "PHYS", "PERF", "SYS", "SIM", "VAL", "NET", "UI", "MEM", "THR", "ADV"};
     oss << "[" << cat_str[static_cast<int>(category)] << "] ";
     
     // Thread ID (shortened)
@@ -234,13 +234,54 @@ bool JSONOutput::isHealthy() const {
 
 // PerformanceMonitor implementation
 void PerformanceMonitor::recordMetrics(const PerformanceMetrics& metrics) {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-    
-    metrics_history_.push_back(metrics);
-    
-    if (metrics_history_.size() > max_history_size_) {
-        metrics_history_.erase(metrics_history_.begin());
+    std::shared_ptr<OtlpTraceWriter> writer;
+    {
+        std::lock_guard<std::mutex> lock(metrics_mutex_);
+        
+        metrics_history_.push_back(metrics);
+        
+        if (metrics_history_.size() > max_history_size_) {
+            metrics_history_.erase(metrics_history_.begin());
+        }
+
+        LatencyHistogram*& histogram = histograms_[metrics.module_name + '\0' + metrics.operation_name];
+        if (!histogram) {
+            histogram = &MetricsRegistry::getInstance().histogram(
+                "semipro_operation_duration_seconds", "Duration of timed operations",
+                {{"module", metrics.module_name}, {"operation", metrics.operation_name}});
+        }
+        histogram->observe(std::chrono::duration<double>(metrics.end_time - metrics.start_time).count());
+        writer = trace_writer_;
     }
+    if (!writer) {
+        return;
+    }
+
+    // The timer's clock has no fixed epoch; spans need Unix time
+    const auto unix_offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch() -
+        std::chrono::high_resolution_clock::now().time_since_epoch());
+    auto unixNs = [&unix_offset](std::chrono::high_resolution_clock::time_point t) {
+        return (std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()) + unix_offset).count();
+    };
+    TraceSpan span;
+    span.ids = metrics.span;
+    span.name = metrics.operation_name;
+    span.start_unix_ns = unixNs(metrics.start_time);
+    span.end_unix_ns = unixNs(metrics.end_time);
+    span.string_attributes.emplace_back("semipro.module", metrics.module_name);
+    if (metrics.cpu_cycles > 0) {
+        span.number_attributes.emplace_back("cpu_cycles", static_cast<double>(metrics.cpu_cycles));
+    }
+    for (const auto& [name, value] : metrics.custom_metrics) {
+        span.number_attributes.emplace_back(name, value);
+    }
+    writer->addSpan(std::move(span));
+}
+
+void PerformanceMonitor::setTraceWriter(std::shared_ptr<OtlpTraceWriter> writer) {
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    trace_writer_ = std::move(writer);
 }
 
 std::vector<PerformanceMetrics> PerformanceMonitor::getMetrics(const std::string& operation_name) const {
@@ -272,18 +313,43 @@ double PerformanceMonitor::getAverageExecutionTime(const std::string& operation_
     return total / metrics.size();
 }
 
+void PerformanceMonitor::clearMetrics() {
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    metrics_history_.clear();
+}
+
 // AdvancedLogger implementation
 AdvancedLogger::AdvancedLogger() 
-    : min_level_(LogLevel::INFO),
-      performance_monitor_(std::make_unique<PerformanceMonitor>()),
-      worker_thread_(&AdvancedLogger::workerThreadFunction, this) {
+    : performance_monitor_(std::make_unique<PerformanceMonitor>()) {
+    // Started here rather than in the initializer list: worker_thread_ is
+    // declared before the queue mutex, condition and flag it waits on, and
+    // a wait begun before they are constructed misses shutdown's wakeup
+    worker_thread_ = std::thread(&AdvancedLogger::workerThreadFunction, this);
+    dispatcher_sink_ = LogDispatcher::getInstance().addSink([this](const LogRecord& record, const std::string& message) {
+        bool has_outputs = false;
+        {
+            std::lock_guard<std::mutex> lock(outputs_mutex_);
+            has_outputs = !outputs_.empty();
+        }
+        if (!has_outputs) {
+            countEntry(record.level);
+            return;
+        }
+        LogEntry entry(record.level, record.category, message);
+        entry.timestamp = std::chrono::system_clock::time_point(std::chrono::microseconds(record.timestamp_us));
+        std::ostringstream thread_id;
+        thread_id << record.thread;
+        entry.thread_id = thread_id.str();
+        entry.module_name = std::string(record.textOf(record.module));
+        entry.function_name = std::string(record.textOf(record.function));
+        entry.file_name = std::string(record.textOf(record.file));
+        entry.line_number = record.line;
+        writeEntry(entry);
+    });
 }
 
 AdvancedLogger& AdvancedLogger::getInstance() {
-    std::lock_guard<std::mutex> lock(instance_mutex_);
-    if (!instance_) {
-        instance_ = std::unique_ptr<AdvancedLogger>(new AdvancedLogger());
-    }
+    std::call_once(instance_once_, [] { instance_ = std::unique_ptr<AdvancedLogger>(new AdvancedLogger()); });
     return *instance_;
 }
 
@@ -292,39 +358,54 @@ AdvancedLogger::~AdvancedLogger() {
 }
 
 void AdvancedLogger::shutdown() {
-    shutdown_requested_ = true;
+    if (dispatcher_sink_ >= 0) {
+        LogDispatcher::getInstance().flush();
+        LogDispatcher::getInstance().removeSink(dispatcher_sink_);
+        dispatcher_sink_ = -1;
+    }
+    {
+        // Under the lock, so the worker cannot miss the wakeup between
+        // checking the flag and blocking
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        shutdown_requested_ = true;
+    }
     queue_cv_.notify_all();
-    
     if (worker_thread_.joinable()) {
         worker_thread_.join();
     }
 }
 
+void AdvancedLogger::writeEntry(const LogEntry& entry) {
+    {
+        std::lock_guard<std::mutex> lock(outputs_mutex_);
+        for (auto& output : outputs_) {
+            if (output && output->isHealthy()) {
+                output->write(entry);
+            }
+        }
+    }
+    countEntry(entry.level);
+}
+
+void AdvancedLogger::countEntry(LogLevel level) {
+    total_log_entries_++;
+    if (level >= LogLevel::ERROR) {
+        error_count_++;
+    } else if (level == LogLevel::WARNING) {
+        warning_count_++;
+    }
+}
+
 void AdvancedLogger::workerThreadFunction() {
     while (!shutdown_requested_) {
         std::unique_lock<std::mutex> lock(queue_mutex_);
         queue_cv_.wait(lock, [this] { return !log_queue_.empty() || shutdown_requested_; });
         
         while (!log_queue_.empty()) {
-            LogEntry entry = log_queue_.front();
+            LogEntry entry = std::move(log_queue_.front());
             log_queue_.pop();
             lock.unlock();
-            
-            // Write to all outputs
-            for (auto& output : outputs_) {
-                if (output && output->isHealthy()) {
-                    output->write(entry);
-                }
-            }
-            
-            // Update statistics
-            total_log_entries_++;
-            if (entry.level >= LogLevel::ERROR) {
-                error_count_++;
-            } else if (entry.level == LogLevel::WARNING) {
-                warning_count_++;
-            }
-            
+            writeEntry(entry);
             lock.lock();
         }
     }
@@ -332,33 +413,37 @@ void AdvancedLogger::workerThreadFunction() {
 
 void AdvancedLogger::addOutput(std::unique_ptr<LogOutput> output) {
     if (output) {
+        std::lock_guard<std::mutex> lock(outputs_mutex_);
         outputs_.push_back(std::move(output));
     }
 }
 
 void AdvancedLogger::removeAllOutputs() {
+    std::lock_guard<std::mutex> lock(outputs_mutex_);
     outputs_.clear();
 }
 
 void AdvancedLogger::log(LogLevel level, LogCategory category, const std::string& message,
                         const std::string& function, const std::string& file, int line,
                         const std::string& module) {
-    if (level < min_level_) return;
-
-    LogEntry entry(level, category, message);
-    entry.function_name = function;
-    entry.file_name = file;
-    entry.line_number = line;
-    entry.module_name = module;
+    if (!logEnabled(level)) return;
 
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        log_queue_.push(entry);
-    }
-    queue_cv_.notify_one();
+    LogDispatcher& dispatcher = LogDispatcher::getInstance();
+    std::uint64_t position = 0;
+    LogRecord* record = dispatcher.claim(position);
+    if (!record) return;
+    record->begin(level, category, "{}");
+    record->add(message);
+    record->module = record->copyText(module);
+    record->function = record->copyText(function);
+    record->file = record->copyText(file);
+    record->line = line;
+    dispatcher.publish(position);
 }
 
 void AdvancedLogger::flush() {
+    LogDispatcher::getInstance().flush();
+    std::lock_guard<std::mutex> lock(outputs_mutex_);
     for (auto& output : outputs_) {
         if (output) {
             output->flush();
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "enhanced_error_handling.hpp"
+#include "hardware_counters.hpp"
+#include "log_ring.hpp"
+#include "telemetry.hpp"
 #include <string>
 #include <vector>
 #include <memory>
@@ -23,32 +26,6 @@ namespace SemiPRO {
  * Provides structured logging, performance metrics, and real-time monitoring
  */
 
-// Log levels (compatible with ErrorSeverity)
-enum class LogLevel {
-    TRACE = 0,
-    DEBUG = 1,
-    INFO = 2,
-    WARNING = 3,
-    ERROR = 4,
-    CRITICAL = 5,
-    FATAL = 6
-};
-
-// Log categories for better organization
-enum class LogCategory {
-    GENERAL,
-    PHYSICS,
-    PERFORMANCE,
-    SYSTEM,
-    SIMULATION,
-    VALIDATION,
-    NETWORK,
-    USER_INTERFACE,
-    MEMORY,
-    THREADING,
-    ADVANCED
-};
-
 // Performance metrics structure
 struct PerformanceMetrics {
     std::chrono::high_resolution_clock::time_point start_time;
@@ -58,6 +35,8 @@ struct PerformanceMetrics {
     size_t memory_used = 0;
     size_t cpu_cycles = 0;
     std::unordered_map<std::string, double> custom_metrics;
+    // The operation's span, see TraceContext
+    TraceContext::Ids span;
     
     double getDurationMs() const {
         auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
@@ -183,17 +162,24 @@ public:
     bool isHealthy() const override;
 };
 
-// Performance monitor
+// Performance monitor. Besides keeping the history, each recorded
+// operation is counted in the semipro_operation_duration_seconds
+// histogram of MetricsRegistry, by module and operation, and sent as a
+// span to the trace writer when one is set.
 class PerformanceMonitor {
 private:
     std::vector<PerformanceMetrics> metrics_history_;
     mutable std::mutex metrics_mutex_;
     size_t max_history_size_;
+    std::unordered_map<std::string, LatencyHistogram*> histograms_; // By module and operation
+    std::shared_ptr<OtlpTraceWriter> trace_writer_;
     
 public:
     PerformanceMonitor(size_t max_history = 10000) : max_history_size_(max_history) {}
     
     void recordMetrics(const PerformanceMetrics& metrics);
+    // Null stops exporting spans
+    void setTraceWriter(std::shared_ptr<OtlpTraceWriter> writer);
     std::vector<PerformanceMetrics> getMetrics(const std::string& operation_name = "") const;
     std::unordered_map<std::string, double> getAverageMetrics() const;
     void clearMetrics();
@@ -205,51 +191,69 @@ public:
     size_t getOperationCount(const std::string& operation_name) const;
 };
 
-// RAII performance timer
+// RAII performance timer. With HardwareCounters enabled it also records
+// the calling thread's cycles (cpu_cycles) and its instructions, cache and
+// branch misses and IPC (custom_metrics).
 class PerformanceTimer {
 private:
     std::string operation_name_;
     std::string module_name_;
-    std::chrono::high_resolution_clock::time_point start_time_;
     PerformanceMonitor* monitor_;
+    TraceContext::Ids span_;
+    HardwareCounters::Sample start_counters_;
+    std::chrono::high_resolution_clock::time_point start_time_;
     
 public:
     PerformanceTimer(const std::string& operation, const std::string& module, PerformanceMonitor* monitor)
         : operation_name_(operation), module_name_(module), monitor_(monitor),
+          span_(TraceContext::open()),
+          start_counters_(HardwareCounters::read()),
           start_time_(std::chrono::high_resolution_clock::now()) {}
     
     ~PerformanceTimer() {
+        TraceContext::close(span_);
         if (monitor_) {
             PerformanceMetrics metrics;
             metrics.operation_name = operation_name_;
             metrics.module_name = module_name_;
             metrics.start_time = start_time_;
             metrics.end_time = std::chrono::high_resolution_clock::now();
+            metrics.span = span_;
+            if (HardwareCounters::isEnabled()) {
+                const HardwareCounters::Sample counters = HardwareCounters::read() - start_counters_;
+                metrics.cpu_cycles = static_cast<size_t>(counters.cycles);
+                metrics.custom_metrics["instructions"] = static_cast<double>(counters.instructions);
+                metrics.custom_metrics["cache_misses"] = static_cast<double>(counters.cache_misses);
+                metrics.custom_metrics["branch_misses"] = static_cast<double>(counters.branch_misses);
+                metrics.custom_metrics["ipc"] = counters.ipc();
+            }
             monitor_->recordMetrics(metrics);
         }
     }
     
-    // Non-copyable, movable
+    // Neither copyable nor movable: its span must close on its own thread,
+    // innermost first
     PerformanceTimer(const PerformanceTimer&) = delete;
     PerformanceTimer& operator=(const PerformanceTimer&) = delete;
-    PerformanceTimer(PerformanceTimer&&) = default;
-    PerformanceTimer& operator=(PerformanceTimer&&) = default;
 };
 
 // Advanced Logger class
 class AdvancedLogger {
 private:
     static std::unique_ptr<AdvancedLogger> instance_;
-    static std::mutex instance_mutex_;
+    static std::once_flag instance_once_;
     
     std::vector<std::unique_ptr<LogOutput>> outputs_;
+    std::mutex outputs_mutex_;
+    int dispatcher_sink_ = -1;
+    // Entries carrying metadata or performance data; plain messages go
+    // through the LogDispatcher ring instead
     std::queue<LogEntry> log_queue_;
     std::thread worker_thread_;
     std::mutex queue_mutex_;
     std::condition_variable queue_cv_;
     std::atomic<bool> shutdown_requested_{false};
     
-    LogLevel min_level_;
     std::unique_ptr<PerformanceMonitor> performance_monitor_;
     
     // Statistics
@@ -259,17 +263,22 @@ private:
     
     AdvancedLogger();
     void workerThreadFunction();
+    void writeEntry(const LogEntry& entry);
+    void countEntry(LogLevel level);
     
 public:
     static AdvancedLogger& getInstance();
     ~AdvancedLogger();
     
     // Configuration
-    void setMinLevel(LogLevel level) { min_level_ = level; }
+    // Shared with Logger and SEMIPRO_LOGF
+    void setMinLevel(LogLevel level) { setLogLevel(level); }
     void addOutput(std::unique_ptr<LogOutput> output);
     void removeAllOutputs();
     
-    // Logging methods
+    // Logging methods. log() and the convenience methods only copy their
+    // strings into a ring record; formatting happens on the dispatcher
+    // thread.
     void log(LogLevel level, LogCategory category, const std::string& message,
              const std::string& function = "", const std::string& file = "", int line = 0,
              const std::string& module = "");
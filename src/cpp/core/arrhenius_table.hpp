@@ -0,0 +1,50 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Arrhenius factor exp(-Ea (1/T - 1/T_ref) / k) tabulated over a range of
+// temperatures and interpolated linearly between entries, so a rate over a
+// whole temperature map costs one exponential per step of the range rather
+// than one per cell. With steps of 0.1 K the interpolation is good to a few
+// parts in 10^7 for activation energies of a few eV at furnace temperatures.
+class ArrheniusTable {
+public:
+  static constexpr double kBoltzmann = 8.617e-5; // eV/K
+
+  // Kelvin range [low, high]; the factor is 1 at reference, and the plain
+  // exp(-Ea / kT) without one. Throws std::invalid_argument for a range
+  // that is not positive and ordered or a step that is not positive.
+  ArrheniusTable(double activation, double low, double high, double step = 0.1,
+                 double reference = std::numeric_limits<double>::infinity())
+      : low_(low), step_(step) {
+    if (!(low > 0.0) || !(high >= low) || !(step > 0.0)) {
+      throw std::invalid_argument("ArrheniusTable: needs 0 < low <= high and a positive step");
+    }
+    const int entries = static_cast<int>(std::ceil((high - low) / step)) + 2;
+    factors_.resize(entries);
+    for (int n = 0; n < entries; ++n) {
+      factors_[n] = std::exp(-activation * (1.0 / (low + n * step) - 1.0 / reference) / kBoltzmann);
+    }
+  }
+
+  double operator()(double kelvin) const {
+    const double position = (kelvin - low_) / step_;
+    const int n = std::clamp(static_cast<int>(std::floor(position)), 0, static_cast<int>(factors_.size()) - 2);
+    const double fraction = position - n;
+    return factors_[n] + fraction * (factors_[n + 1] - factors_[n]);
+  }
+
+  Eigen::ArrayXXd operator()(const Eigen::Ref<const Eigen::ArrayXXd>& kelvin) const {
+    return kelvin.unaryExpr([this](double t) { return (*this)(t); });
+  }
+
+private:
+  double low_;
+  double step_;
+  std::vector<double> factors_;
+};
@@ -0,0 +1,30 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <Eigen/Dense>
+#include <unsupported/Eigen/AutoDiff>
+
+// Forward-mode automatic differentiation on Eigen's AutoDiffScalar: a
+// value carrying its gradient with respect to the inputs seeded as
+// variables, for models templated on their scalar type. Each operation
+// also updates the gradient, so a model's value and its derivatives with
+// respect to n inputs cost about n + 1 evaluations' worth of arithmetic
+// in one pass, with none of the step-size error of finite differences.
+// Inside a templated model, bring std's functions in with using-
+// declarations (using std::exp;) and call them unqualified, so that
+// AutoDiffScalar's overloads are found. Declare results ADScalar rather
+// than auto: an expression's derivatives are lazy and may refer to
+// temporaries that are gone by the time they are read.
+using ADScalar = Eigen::AutoDiffScalar<Eigen::VectorXd>;
+
+// Input `index` of `count`, with a unit derivative for itself
+inline ADScalar adVariable(double value, int index, int count) {
+  return ADScalar(value, count, index);
+}
+
+// A constant with a zero gradient of `count` entries
+inline ADScalar adConstant(double value, int count) {
+  return ADScalar(value, Eigen::VectorXd::Zero(count));
+}
+
+inline double scalarValue(double x) { return x; }
+inline double scalarValue(const ADScalar& x) { return x.value(); }
@@ -0,0 +1,247 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "autotuner.hpp"
+#include "json_value.hpp"
+#include "task_scheduler.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace SemiPRO {
+
+namespace {
+
+constexpr int kDatabaseFormat = 1;
+
+} // namespace
+
+Autotuner::Autotuner() {
+    if (const char* path = std::getenv("SEMIPRO_TUNING_DB")) {
+        path_ = path;
+        path_explicit_ = true;
+        load(path_);
+    }
+}
+
+Autotuner& Autotuner::getInstance() {
+    static Autotuner instance;
+    return instance;
+}
+
+std::string Autotuner::sizeClass(std::size_t cells) {
+    int k = 0;
+    while ((std::size_t(1) << (k + 1)) <= cells && k < 62) {
+        ++k;
+    }
+    return "2^" + std::to_string(k);
+}
+
+std::string Autotuner::machineKey() {
+    static const std::string cpu = [] {
+        std::ifstream info("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(info, line)) {
+            if (line.compare(0, 10, "model name") == 0) {
+                const std::size_t colon = line.find(':');
+                return colon == std::string::npos ? std::string() : line.substr(line.find_first_not_of(" \t", colon + 1));
+            }
+        }
+        return std::string("unknown cpu");
+    }();
+    return cpu + " / " + std::to_string(std::thread::hardware_concurrency()) + " hw threads / " +
+           std::to_string(TaskScheduler::getInstance().threadCount()) + " workers";
+}
+
+std::string Autotuner::entryKey(const std::string& kernel, const std::string& size_class) {
+    return kernel + "@" + size_class;
+}
+
+std::string Autotuner::select(const std::string& kernel, std::size_t cells, const std::vector<Variant>& variants) {
+    if (variants.empty()) {
+        throw std::invalid_argument("No variants to tune for kernel: " + kernel);
+    }
+    if (!isEnabled() || variants.size() == 1) {
+        return variants.front().name;
+    }
+    const std::string known = lookup(kernel, cells);
+    if (!known.empty()) {
+        return known;
+    }
+
+    std::lock_guard<std::mutex> tuning(tuning_mutex_);
+    const std::string tuned = lookup(kernel, cells); // By another thread meanwhile
+    if (!tuned.empty()) {
+        return tuned;
+    }
+    int trials;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        trials = trials_;
+    }
+    std::string best;
+    double best_seconds = std::numeric_limits<double>::infinity();
+    for (const auto& variant : variants) {
+        double seconds = std::numeric_limits<double>::infinity();
+        try {
+            for (int t = 0; t < trials; ++t) {
+                const auto start = std::chrono::steady_clock::now();
+                variant.run();
+                seconds = std::min(seconds,
+                                   std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+        } catch (const std::exception& e) {
+            Logger::getInstance().log("Autotuner: " + kernel + " variant " + variant.name +
+                                      " left out: " + e.what());
+            continue;
+        }
+        if (seconds < best_seconds) {
+            best = variant.name;
+            best_seconds = seconds;
+        }
+    }
+    if (best.empty()) {
+        return variants.front().name;
+    }
+    record(kernel, cells, best, best_seconds);
+    Logger::getInstance().log("Autotuner: tuned " + kernel + " for " + sizeClass(cells) + ": " + best);
+    return best;
+}
+
+std::string Autotuner::lookup(const std::string& kernel, std::size_t cells) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto machine = database_.find(machineKey());
+    if (machine == database_.end()) {
+        return "";
+    }
+    auto entry = machine->second.find(entryKey(kernel, sizeClass(cells)));
+    return entry == machine->second.end() ? "" : entry->second.variant;
+}
+
+void Autotuner::record(const std::string& kernel, std::size_t cells, const std::string& variant, double seconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    database_[machineKey()][entryKey(kernel, sizeClass(cells))] = {variant, seconds};
+    save();
+}
+
+std::vector<Autotuner::Choice> Autotuner::choices() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Choice> result;
+    auto machine = database_.find(machineKey());
+    if (machine == database_.end()) {
+        return result;
+    }
+    for (const auto& entry : machine->second) {
+        const std::size_t at = entry.first.rfind('@');
+        result.push_back({entry.first.substr(0, at), entry.first.substr(at + 1), entry.second.variant,
+                          entry.second.seconds});
+    }
+    return result;
+}
+
+void Autotuner::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    database_.clear();
+}
+
+void Autotuner::setEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    enabled_ = enabled;
+}
+
+bool Autotuner::isEnabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return enabled_;
+}
+
+void Autotuner::setTrials(int trials) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trials_ = std::max(1, trials);
+}
+
+void Autotuner::setDatabasePath(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    path_explicit_ = true;
+    load(path_);
+}
+
+std::string Autotuner::getDatabasePath() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return path_;
+}
+
+void Autotuner::useConfigDirectory(const std::string& config_file) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (path_explicit_) {
+        return;
+    }
+    path_ = (std::filesystem::path(config_file).parent_path() / "tuning.json").string();
+    load(path_);
+}
+
+void Autotuner::load(const std::string& path) {
+    if (path.empty() || !std::filesystem::exists(path)) {
+        return;
+    }
+    try {
+        const JsonValue root = JsonValue::parseFile(path);
+        if (root["format"].isNumber() && root["format"].asNumber() > kDatabaseFormat) {
+            throw std::runtime_error("written by a newer version");
+        }
+        for (const auto& machine : root["machines"].members()) {
+            auto& entries = database_[machine.first];
+            for (const auto& entry : machine.second.members()) {
+                // Choices made in this process stand
+                entries.emplace(entry.first,
+                                Entry{entry.second["variant"].asString(), entry.second["seconds"].asNumber()});
+            }
+        }
+    } catch (const std::exception& e) {
+        Logger::getInstance().log("Warning: Ignoring tuning database " + path + ": " + e.what());
+    }
+}
+
+void Autotuner::save() const {
+    if (path_.empty()) {
+        return;
+    }
+    std::string text;
+    {
+        JsonWriter out(text, 2);
+        out.beginObject().key("format").integer(kDatabaseFormat).key("machines").beginObject();
+        for (const auto& machine : database_) {
+            out.key(machine.first).beginObject();
+            for (const auto& entry : machine.second) {
+                out.key(entry.first).beginObject();
+                out.key("variant").string(entry.second.variant);
+                out.key("seconds").number(entry.second.seconds);
+                out.endObject();
+            }
+            out.endObject();
+        }
+        out.endObject().endObject();
+    }
+    // Written aside and renamed, so readers never see half a database
+    const std::string temporary = path_ + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file << text << '\n';
+        if (!file) {
+            Logger::getInstance().log("Warning: Could not write tuning database: " + path_);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path_, error);
+    if (error) {
+        std::remove(temporary.c_str());
+    }
+}
+
+} // namespace SemiPRO
@@ -0,0 +1,95 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef AUTOTUNER_HPP
+#define AUTOTUNER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SemiPRO {
+
+// Picks the fastest of a kernel's variants (tile shapes, thread counts,
+// solver algorithms, backends) for this machine and problem size.
+//
+// The first select() for a kernel in a size class times every variant, a
+// few runs each, and keeps the one with the best run; later calls return
+// that choice without running anything. Choices are keyed by the machine
+// (machineKey()), so one database serves a cluster of unlike nodes, and
+// are kept in a JSON tuning database. Its path is SEMIPRO_TUNING_DB if
+// set, else "tuning.json" next to the configuration file ConfigManager
+// loaded last; with neither, choices last for the process only. A
+// variant that throws (e.g. a backend missing here) is left out.
+class Autotuner {
+public:
+    struct Variant {
+        std::string name;
+        std::function<void()> run; // One representative run
+    };
+
+    struct Choice {
+        std::string kernel;
+        std::string size_class;
+        std::string variant;
+        double seconds = 0.0; // Best run of the chosen variant
+    };
+
+    static Autotuner& getInstance();
+
+    // Problems within a factor of two of cells share a class, "2^k"
+    static std::string sizeClass(std::size_t cells);
+    // CPU model, hardware threads and the task scheduler's worker count
+    static std::string machineKey();
+
+    // The chosen variant's name; tunes on first use. Disabled, or with
+    // every variant failing, the first variant. Throws
+    // std::invalid_argument without variants.
+    std::string select(const std::string& kernel, std::size_t cells, const std::vector<Variant>& variants);
+    // "" if the kernel is not tuned for the class on this machine
+    std::string lookup(const std::string& kernel, std::size_t cells) const;
+    // Sets a choice by hand, e.g. from an offline sweep, and saves it
+    void record(const std::string& kernel, std::size_t cells, const std::string& variant, double seconds = 0.0);
+    // This machine's choices
+    std::vector<Choice> choices() const;
+    void clear();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void setTrials(int trials);
+    // "" keeps choices in memory only. Setting a path reloads from it and
+    // takes precedence over the defaults.
+    void setDatabasePath(const std::string& path);
+    std::string getDatabasePath() const;
+    // Called by ConfigManager::loadFromFile: "tuning.json" beside the
+    // file, unless SEMIPRO_TUNING_DB or setDatabasePath says otherwise
+    void useConfigDirectory(const std::string& config_file);
+
+private:
+    Autotuner();
+
+    struct Entry {
+        std::string variant;
+        double seconds = 0.0;
+    };
+    // machine -> "kernel@class" -> choice
+    using Database = std::map<std::string, std::map<std::string, Entry>>;
+
+    static std::string entryKey(const std::string& kernel, const std::string& size_class);
+    // Caller holds mutex_. Loading merges the file under what is known.
+    void load(const std::string& path);
+    void save() const;
+
+    mutable std::mutex mutex_;
+    std::mutex tuning_mutex_; // One benchmark at a time, so timings do not collide
+    Database database_;
+    std::string path_;
+    bool path_explicit_ = false;
+    bool enabled_ = true;
+    int trials_ = 3;
+};
+
+} // namespace SemiPRO
+
+#endif // AUTOTUNER_HPP
@@ -0,0 +1,68 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <Eigen/Dense>
+#include <cstddef>
+#include <vector>
+
+// The entries of a batch ordered by a small enum key, so each key's entries
+// lie in one contiguous run that a kernel built for that key can sweep
+// without looking at the key again. Columns are permuted into that order
+// and results permuted back; a batch already in key order stays as it is.
+class BatchGroups {
+public:
+  template <typename Enum>
+  BatchGroups(const std::vector<Enum>& keys, std::size_t key_count)
+      : offsets_(key_count + 1, 0), in_order_(true) {
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      const std::size_t key = static_cast<std::size_t>(keys[i]);
+      ++offsets_[key + 1];
+      in_order_ = in_order_ && (i == 0 || static_cast<std::size_t>(keys[i - 1]) <= key);
+    }
+    for (std::size_t key = 0; key < key_count; ++key) {
+      offsets_[key + 1] += offsets_[key];
+    }
+    if (!in_order_) {
+      std::vector<Eigen::Index> next(offsets_.begin(), offsets_.end() - 1);
+      order_.resize(keys.size());
+      for (std::size_t i = 0; i < keys.size(); ++i) {
+        order_[next[static_cast<std::size_t>(keys[i])]++] = static_cast<Eigen::Index>(i);
+      }
+    }
+  }
+
+  std::size_t keyCount() const { return offsets_.size() - 1; }
+  Eigen::Index begin(std::size_t key) const { return offsets_[key]; }
+  Eigen::Index size(std::size_t key) const { return offsets_[key + 1] - offsets_[key]; }
+
+  // True when the keys were already in order and nothing moves
+  bool inOrder() const { return in_order_; }
+
+  // A column in group order
+  template <typename Column>
+  Column permute(const Column& column) const {
+    if (in_order_) {
+      return column;
+    }
+    Column arranged(column.size());
+    for (std::size_t k = 0; k < order_.size(); ++k) {
+      arranged[static_cast<Eigen::Index>(k)] = column[order_[k]];
+    }
+    return arranged;
+  }
+
+  // Puts a column computed in group order back into the batch's order
+  void restore(Eigen::ArrayXd& column) const {
+    if (in_order_) {
+      return;
+    }
+    const Eigen::ArrayXd arranged = column;
+    for (std::size_t k = 0; k < order_.size(); ++k) {
+      column[order_[k]] = arranged[static_cast<Eigen::Index>(k)];
+    }
+  }
+
+private:
+  std::vector<Eigen::Index> offsets_;
+  std::vector<Eigen::Index> order_;
+  bool in_order_;
+};
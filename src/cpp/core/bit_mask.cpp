@@ -0,0 +1,142 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "bit_mask.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+BitMask::BitMask(int rows, int cols, bool value)
+    : rows_(rows), cols_(cols), words_per_row_((cols + 63) / 64) {
+  if (rows < 0 || cols < 0) {
+    throw std::invalid_argument("Mask dimensions must be non-negative");
+  }
+  words_.assign(static_cast<std::size_t>(rows) * words_per_row_, value ? ~std::uint64_t(0) : 0);
+  clearPadding();
+}
+
+BitMask BitMask::fromField(const Eigen::Ref<const Eigen::ArrayXXd>& field, double threshold) {
+  return fromPredicate(static_cast<int>(field.rows()), static_cast<int>(field.cols()),
+                       [&](int i, int j) { return field(i, j) >= threshold; });
+}
+
+BitMask BitMask::fromRuns(int rows, int cols, const std::vector<MaskRun>& runs) {
+  BitMask mask(rows, cols);
+  for (const auto& run : runs) {
+    if (run.row < 0 || run.row >= rows || run.col_begin < 0 || run.col_end > cols) {
+      throw std::out_of_range("Mask run outside mask bounds");
+    }
+    mask.setSpan(run.row, run.col_begin, run.col_end);
+  }
+  return mask;
+}
+
+void BitMask::setSpan(int i, int col_begin, int col_end) {
+  if (col_begin >= col_end) {
+    return;
+  }
+  std::uint64_t* row = words_.data() + static_cast<std::size_t>(i) * words_per_row_;
+  const int first = col_begin >> 6;
+  const int last = (col_end - 1) >> 6;
+  const std::uint64_t head = ~std::uint64_t(0) << (col_begin & 63);
+  const std::uint64_t tail = ~std::uint64_t(0) >> (63 - ((col_end - 1) & 63));
+  if (first == last) {
+    row[first] |= head & tail;
+    return;
+  }
+  row[first] |= head;
+  for (int w = first + 1; w < last; ++w) {
+    row[w] = ~std::uint64_t(0);
+  }
+  row[last] |= tail;
+}
+
+void BitMask::set(int i, int j, bool value) {
+  std::uint64_t bit = std::uint64_t(1) << (j & 63);
+  std::uint64_t& word = words_[wordIndex(i, j)];
+  word = value ? (word | bit) : (word & ~bit);
+}
+
+std::size_t BitMask::count() const {
+  std::size_t total = 0;
+  for (std::uint64_t word : words_) {
+    total += static_cast<std::size_t>(__builtin_popcountll(word));
+  }
+  return total;
+}
+
+BitMask& BitMask::operator|=(const BitMask& other) {
+  if (other.rows_ != rows_ || other.cols_ != cols_) {
+    throw std::invalid_argument("Mask shapes differ");
+  }
+  for (std::size_t w = 0; w < words_.size(); ++w) {
+    words_[w] |= other.words_[w];
+  }
+  return *this;
+}
+
+BitMask& BitMask::operator&=(const BitMask& other) {
+  if (other.rows_ != rows_ || other.cols_ != cols_) {
+    throw std::invalid_argument("Mask shapes differ");
+  }
+  for (std::size_t w = 0; w < words_.size(); ++w) {
+    words_[w] &= other.words_[w];
+  }
+  return *this;
+}
+
+void BitMask::invert() {
+  for (std::uint64_t& word : words_) {
+    word = ~word;
+  }
+  clearPadding();
+}
+
+std::vector<MaskRun> BitMask::runs() const {
+  std::vector<MaskRun> result;
+  for (int i = 0; i < rows_; ++i) {
+    int j = findNext(i, 0, true);
+    while (j < cols_) {
+      int end = findNext(i, j, false);
+      result.push_back({i, j, end});
+      j = findNext(i, end, true);
+    }
+  }
+  return result;
+}
+
+int BitMask::findNext(int i, int from, bool value) const {
+  if (from >= cols_) {
+    return cols_;
+  }
+  const std::uint64_t* row = words_.data() + static_cast<std::size_t>(i) * words_per_row_;
+  int w = from >> 6;
+  std::uint64_t bits = (value ? row[w] : ~row[w]) & (~std::uint64_t(0) << (from & 63));
+  // Whole words without a matching bit are skipped in one step. Padding bits
+  // are always clear, so a search for clear cells stops at cols_ at the latest.
+  while (!bits) {
+    if (++w >= words_per_row_) {
+      return cols_;
+    }
+    bits = value ? row[w] : ~row[w];
+  }
+  return std::min(cols_, (w << 6) + __builtin_ctzll(bits));
+}
+
+Eigen::ArrayXXd BitMask::toField() const {
+  Eigen::ArrayXXd field = Eigen::ArrayXXd::Zero(rows_, cols_);
+  forEachSet([&](int i, int j) { field(i, j) = 1.0; });
+  return field;
+}
+
+std::uint64_t BitMask::tailMask() const {
+  int used = cols_ & 63;
+  return used == 0 ? ~std::uint64_t(0) : (std::uint64_t(1) << used) - 1;
+}
+
+void BitMask::clearPadding() {
+  if (words_per_row_ == 0) {
+    return;
+  }
+  const std::uint64_t tail = tailMask();
+  for (int i = 0; i < rows_; ++i) {
+    words_[static_cast<std::size_t>(i) * words_per_row_ + words_per_row_ - 1] &= tail;
+  }
+}
@@ -0,0 +1,104 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <Eigen/Dense>
+#include <cstdint>
+#include <vector>
+
+// Horizontal span [col_begin, col_end) of set cells in one row.
+struct MaskRun {
+  int row;
+  int col_begin;
+  int col_end;
+};
+
+// Bit-packed 2D mask (one bit per cell, rows packed into 64-bit words).
+// Used for photoresist and etch masks: 64x smaller than a 0/1 double field,
+// and span iteration skips whole words that are fully set or fully clear.
+class BitMask {
+public:
+  BitMask() = default;
+  BitMask(int rows, int cols, bool value = false);
+
+  // Cells with field(i, j) >= threshold are set.
+  static BitMask fromField(const Eigen::Ref<const Eigen::ArrayXXd>& field, double threshold = 0.5);
+  template <typename Pred>
+  static BitMask fromPredicate(int rows, int cols, Pred&& pred);
+  static BitMask fromRuns(int rows, int cols, const std::vector<MaskRun>& runs);
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  bool empty() const { return rows_ == 0 || cols_ == 0; }
+  std::size_t memoryBytes() const { return words_.size() * sizeof(std::uint64_t); }
+
+  bool test(int i, int j) const { return (words_[wordIndex(i, j)] >> (j & 63)) & 1u; }
+  void set(int i, int j, bool value = true);
+  // Sets cells [col_begin, col_end) of row i a word at a time. Writes only
+  // row i's words, so threads may fill distinct rows concurrently.
+  void setSpan(int i, int col_begin, int col_end);
+  std::size_t count() const;
+
+  BitMask& operator|=(const BitMask& other);
+  BitMask& operator&=(const BitMask& other);
+  void invert();
+
+  // fn(i, j) for every set / clear cell in row-major order.
+  template <typename Fn>
+  void forEachSet(Fn&& fn) const { scan(false, fn); }
+  template <typename Fn>
+  void forEachClear(Fn&& fn) const { scan(true, fn); }
+
+  // Run-length encoding of the set cells.
+  std::vector<MaskRun> runs() const;
+
+  // Dense 0/1 field, for consumers that still need doubles.
+  Eigen::ArrayXXd toField() const;
+
+  // The packed rows, words_per_row() words each with the bits past cols()
+  // clear, so equal masks have equal words; for hashing mask content.
+  const std::vector<std::uint64_t>& words() const { return words_; }
+  int words_per_row() const { return words_per_row_; }
+
+private:
+  std::size_t wordIndex(int i, int j) const {
+    return static_cast<std::size_t>(i) * words_per_row_ + (j >> 6);
+  }
+  std::uint64_t tailMask() const;
+  int findNext(int i, int from, bool value) const; // cols_ if none
+  void clearPadding();
+
+  template <typename Fn>
+  void scan(bool inverted, Fn& fn) const {
+    const std::uint64_t tail = tailMask();
+    for (int i = 0; i < rows_; ++i) {
+      const std::uint64_t* row = words_.data() + static_cast<std::size_t>(i) * words_per_row_;
+      for (int w = 0; w < words_per_row_; ++w) {
+        std::uint64_t bits = inverted ? ~row[w] : row[w];
+        if (w == words_per_row_ - 1) {
+          bits &= tail;
+        }
+        while (bits) {
+          int b = __builtin_ctzll(bits);
+          fn(i, (w << 6) + b);
+          bits &= bits - 1;
+        }
+      }
+    }
+  }
+
+  int rows_ = 0;
+  int cols_ = 0;
+  int words_per_row_ = 0;
+  std::vector<std::uint64_t> words_;
+};
+
+template <typename Pred>
+BitMask BitMask::fromPredicate(int rows, int cols, Pred&& pred) {
+  BitMask mask(rows, cols);
+  for (int i = 0; i < rows; ++i) {
+    std::uint64_t* row = mask.words_.data() + static_cast<std::size_t>(i) * mask.words_per_row_;
+    for (int j = 0; j < cols; ++j) {
+      row[j >> 6] |= static_cast<std::uint64_t>(pred(i, j) ? 1u : 0u) << (j & 63);
+    }
+  }
+  return mask;
+}
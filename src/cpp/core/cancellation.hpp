@@ -0,0 +1,99 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef CANCELLATION_HPP
+#define CANCELLATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+// Cooperative stop signal for long-running process models.
+//
+// A CancellationSource owns a flag; the tokens it hands out are cheap to
+// copy and report a stop once the flag is raised or the token's own
+// deadline passes. Kernels poll stopRequested() every few hundred
+// iterations and return what they have computed so far, so a runaway
+// step releases its worker instead of running to completion. A default
+// constructed token never stops.
+class CancellationToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CancellationToken() = default;
+
+    bool stopRequested() const {
+        if (flag_ && flag_->load(std::memory_order_relaxed)) {
+            return true;
+        }
+        return deadline_ != Clock::time_point::max() && Clock::now() >= deadline_;
+    }
+    bool stopPossible() const { return flag_ || deadline_ != Clock::time_point::max(); }
+    bool cancelled() const { return flag_ && flag_->load(std::memory_order_relaxed); }
+    Clock::time_point deadline() const { return deadline_; }
+
+    // Same source, stopping at `deadline` at the latest
+    CancellationToken withDeadline(Clock::time_point deadline) const {
+        CancellationToken token = *this;
+        if (deadline < token.deadline_) {
+            token.deadline_ = deadline;
+        }
+        return token;
+    }
+    // Budgets <= 0 leave the token unchanged
+    CancellationToken withBudget(std::chrono::duration<double> budget) const {
+        if (budget.count() <= 0.0) {
+            return *this;
+        }
+        return withDeadline(Clock::now() + std::chrono::duration_cast<Clock::duration>(budget));
+    }
+
+    // Token installed for the calling thread by CancellationScope
+    static const CancellationToken& current() { return slot(); }
+
+private:
+    friend class CancellationSource;
+    friend class CancellationScope;
+
+    static CancellationToken& slot() {
+        static thread_local CancellationToken token;
+        return token;
+    }
+
+    std::shared_ptr<const std::atomic<bool>> flag_;
+    Clock::time_point deadline_ = Clock::time_point::max();
+};
+
+class CancellationSource {
+public:
+    CancellationSource() : flag_(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void requestStop() { flag_->store(true, std::memory_order_relaxed); }
+    bool stopRequested() const { return flag_->load(std::memory_order_relaxed); }
+
+    CancellationToken token() const {
+        CancellationToken token;
+        token.flag_ = flag_;
+        return token;
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+// Makes a token CancellationToken::current() on this thread for the
+// scope's lifetime, so models called through interfaces that take no
+// token still see it
+class CancellationScope {
+public:
+    explicit CancellationScope(const CancellationToken& token)
+        : previous_(CancellationToken::slot()) {
+        CancellationToken::slot() = token;
+    }
+    ~CancellationScope() { CancellationToken::slot() = previous_; }
+    CancellationScope(const CancellationScope&) = delete;
+    CancellationScope& operator=(const CancellationScope&) = delete;
+
+private:
+    CancellationToken previous_;
+};
+
+#endif // CANCELLATION_HPP
@@ -0,0 +1,363 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "checkpoint_io.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'P', 'R', 'O', 'C', 'K', 'P', 'T'};
+constexpr std::size_t kHeaderBytes = sizeof(kMagic) + 2 * sizeof(std::uint32_t);
+constexpr std::size_t kChunkHeaderBytes = 2 * sizeof(std::uint32_t) + sizeof(std::uint64_t);
+
+} // namespace
+
+CheckpointWriter::CheckpointWriter(const std::string& path, std::size_t block_alignment)
+    : path_(path), temp_path_(path + ".tmp"), block_alignment_(block_alignment) {
+    if (block_alignment < FieldStore::kAlignment || (block_alignment & (block_alignment - 1)) != 0 ||
+        block_alignment > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("Checkpoint block alignment must be a power of two of at least 64");
+    }
+    out_.open(temp_path_, std::ios::binary | std::ios::trunc);
+    if (!out_) {
+        throw std::runtime_error("Cannot open checkpoint for writing: " + temp_path_);
+    }
+    writeBytes(kMagic, sizeof(kMagic));
+    write(kCheckpointVersion);
+    write(static_cast<std::uint32_t>(block_alignment));
+}
+
+CheckpointWriter::CheckpointWriter(std::vector<unsigned char>& buffer, std::size_t block_alignment)
+    : path_("<memory>"), block_alignment_(block_alignment), buffer_(&buffer) {
+    if (block_alignment < FieldStore::kAlignment || (block_alignment & (block_alignment - 1)) != 0 ||
+        block_alignment > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("Checkpoint block alignment must be a power of two of at least 64");
+    }
+    buffer.clear();
+    writeBytes(kMagic, sizeof(kMagic));
+    write(kCheckpointVersion);
+    write(static_cast<std::uint32_t>(block_alignment));
+}
+
+std::size_t CheckpointWriter::pageAlignment() {
+    long size = ::sysconf(_SC_PAGESIZE);
+    return size >= static_cast<long>(FieldStore::kAlignment) ? static_cast<std::size_t>(size) : 4096;
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    if (!finished_ && !buffer_) {
+        out_.close();
+        std::remove(temp_path_.c_str());
+    }
+}
+
+void CheckpointWriter::beginChunk(std::uint32_t tag, std::uint32_t version) {
+    if (in_chunk_) {
+        throw std::logic_error("Checkpoint chunks cannot be nested");
+    }
+    write(tag);
+    write(version);
+    write(std::uint64_t(0)); // Patched by endChunk()
+    chunk_start_ = offset_;
+    in_chunk_ = true;
+}
+
+void CheckpointWriter::endChunk() {
+    if (!in_chunk_) {
+        throw std::logic_error("No open checkpoint chunk");
+    }
+    std::uint64_t size = offset_ - chunk_start_;
+    if (buffer_) {
+        std::memcpy(buffer_->data() + chunk_start_ - sizeof(size), &size, sizeof(size));
+        in_chunk_ = false;
+        return;
+    }
+    out_.seekp(static_cast<std::streamoff>(chunk_start_ - sizeof(size)));
+    out_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out_.seekp(static_cast<std::streamoff>(offset_));
+    in_chunk_ = false;
+}
+
+void CheckpointWriter::writeString(const std::string& value) {
+    write(static_cast<std::uint64_t>(value.size()));
+    writeBytes(value.data(), value.size());
+}
+
+void CheckpointWriter::beginBlock(int rows, int cols) {
+    write(static_cast<std::uint32_t>(rows));
+    write(static_cast<std::uint32_t>(cols));
+    pad(block_alignment_);
+}
+
+void CheckpointWriter::writeBlock(const Eigen::Ref<const Eigen::ArrayXXd>& block) {
+    beginBlock(static_cast<int>(block.rows()), static_cast<int>(block.cols()));
+    if (block.outerStride() == block.rows()) {
+        writeBytes(block.data(), static_cast<std::size_t>(block.size()) * sizeof(double));
+        return;
+    }
+    for (Eigen::Index j = 0; j < block.cols(); ++j) {
+        writeBytes(block.data() + j * block.outerStride(), static_cast<std::size_t>(block.rows()) * sizeof(double));
+    }
+}
+
+void CheckpointWriter::writeBytes(const void* data, std::size_t size) {
+    if (buffer_) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        buffer_->insert(buffer_->end(), bytes, bytes + size);
+        offset_ += size;
+        return;
+    }
+    out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    if (!out_) {
+        throw std::runtime_error("Write failed for checkpoint: " + temp_path_);
+    }
+    offset_ += size;
+}
+
+void CheckpointWriter::writeFill(double value, std::size_t count) {
+    const std::vector<double> run(std::min<std::size_t>(count, 4096), value);
+    while (count > 0) {
+        std::size_t n = std::min(count, run.size());
+        writeBytes(run.data(), n * sizeof(double));
+        count -= n;
+    }
+}
+
+void CheckpointWriter::pad(std::size_t alignment) {
+    static const char zeros[4096] = {};
+    std::size_t rem = static_cast<std::size_t>(offset_ % alignment);
+    for (std::size_t missing = rem ? alignment - rem : 0; missing > 0;) {
+        std::size_t n = std::min(missing, sizeof(zeros));
+        writeBytes(zeros, n);
+        missing -= n;
+    }
+}
+
+void CheckpointWriter::finish() {
+    if (in_chunk_) {
+        endChunk();
+    }
+    beginChunk(kCheckpointEndTag);
+    endChunk();
+    if (buffer_) {
+        finished_ = true;
+        return;
+    }
+    out_.close();
+    if (!out_ || std::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+        throw std::runtime_error("Cannot finalize checkpoint: " + path_);
+    }
+    finished_ = true;
+}
+
+CheckpointReader::CheckpointReader(const std::string& path, bool writable) : writable_(writable) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open checkpoint: " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < kHeaderBytes) {
+        ::close(fd);
+        throw std::runtime_error("Not a checkpoint file: " + path);
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* mapped = ::mmap(nullptr, size_, protection, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Cannot map checkpoint: " + path);
+    }
+    const std::size_t size = size_;
+    mapping_ = std::shared_ptr<const void>(mapped, [size](const void* p) {
+        ::munmap(const_cast<void*>(p), size);
+    });
+    data_ = static_cast<const unsigned char*>(mapped);
+    indexChunks(path);
+}
+
+CheckpointReader::CheckpointReader(std::shared_ptr<const std::vector<unsigned char>> image) {
+    if (!image || image->size() < kHeaderBytes) {
+        throw std::runtime_error("Not a checkpoint image");
+    }
+    data_ = image->data();
+    size_ = image->size();
+    mapping_ = std::shared_ptr<const void>(image, data_);
+    indexChunks("<memory>");
+
+    // Blocks are handed out as aligned views, but a vector only guarantees
+    // the allocator's alignment; realign the image when it falls short
+    if (reinterpret_cast<std::uintptr_t>(data_) % block_alignment_ != 0) {
+        const std::align_val_t alignment{block_alignment_};
+        auto* copy = static_cast<unsigned char*>(::operator new(size_, alignment));
+        std::memcpy(copy, data_, size_);
+        mapping_ = std::shared_ptr<const void>(copy, [alignment](const void* p) {
+            ::operator delete(const_cast<void*>(p), alignment);
+        });
+        data_ = copy;
+        chunks_.clear();
+        indexChunks("<memory>");
+    }
+}
+
+void CheckpointReader::indexChunks(const std::string& path) {
+    if (std::memcmp(data_, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a checkpoint file: " + path);
+    }
+    std::memcpy(&version_, data_ + sizeof(kMagic), sizeof(version_));
+    if (version_ == 0 || version_ > kCheckpointVersion) {
+        throw std::runtime_error("Unsupported checkpoint version " + std::to_string(version_) + ": " + path);
+    }
+    if (version_ >= 2) {
+        std::memcpy(&block_alignment_, data_ + sizeof(kMagic) + sizeof(version_), sizeof(block_alignment_));
+        if (block_alignment_ < FieldStore::kAlignment || (block_alignment_ & (block_alignment_ - 1)) != 0) {
+            throw std::runtime_error("Corrupt checkpoint header: " + path);
+        }
+    }
+
+    bool complete = false;
+    std::size_t pos = kHeaderBytes;
+    while (!complete && pos + kChunkHeaderBytes <= size_) {
+        Chunk chunk;
+        std::uint64_t payload;
+        std::memcpy(&chunk.tag, data_ + pos, sizeof(chunk.tag));
+        std::memcpy(&chunk.version, data_ + pos + 4, sizeof(chunk.version));
+        std::memcpy(&payload, data_ + pos + 8, sizeof(payload));
+        pos += kChunkHeaderBytes;
+        if (payload > size_ - pos) {
+            break;
+        }
+        chunk.begin = data_ + pos;
+        chunk.end = chunk.begin + payload;
+        pos += static_cast<std::size_t>(payload);
+        if (chunk.tag == kCheckpointEndTag) {
+            complete = true;
+        } else {
+            chunks_.push_back(chunk);
+        }
+    }
+    if (!complete) {
+        throw std::runtime_error("Truncated checkpoint: " + path);
+    }
+}
+
+CheckpointReader::Cursor::Cursor(const CheckpointReader& reader, const Chunk& chunk)
+    : reader_(reader), base_(reader.data_), pos_(chunk.begin), end_(chunk.end) {}
+
+const unsigned char* CheckpointReader::Cursor::take(std::size_t size) {
+    if (size > static_cast<std::size_t>(end_ - pos_)) {
+        throw std::runtime_error("Checkpoint chunk is truncated");
+    }
+    const unsigned char* p = pos_;
+    pos_ += size;
+    return p;
+}
+
+std::string CheckpointReader::Cursor::readString() {
+    auto size = read<std::uint64_t>();
+    if (size > static_cast<std::uint64_t>(end_ - pos_)) {
+        throw std::runtime_error("Checkpoint chunk is truncated");
+    }
+    const char* p = reinterpret_cast<const char*>(take(static_cast<std::size_t>(size)));
+    return std::string(p, static_cast<std::size_t>(size));
+}
+
+ConstFieldView CheckpointReader::Cursor::readBlock() {
+    auto rows = read<std::uint32_t>();
+    auto cols = read<std::uint32_t>();
+    const std::size_t alignment = reader_.block_alignment_;
+    std::size_t rem = static_cast<std::size_t>(pos_ - base_) % alignment;
+    if (rem != 0) {
+        take(alignment - rem);
+    }
+    // rows and cols come from the file: bound them before multiplying
+    if (cols != 0 && rows > static_cast<std::size_t>(end_ - pos_) / sizeof(double) / cols) {
+        throw std::runtime_error("Checkpoint chunk is truncated");
+    }
+    std::size_t bytes = static_cast<std::size_t>(rows) * cols * sizeof(double);
+    const double* values = reinterpret_cast<const double*>(take(bytes));
+    return ConstFieldView(values, rows, cols);
+}
+
+FieldView CheckpointReader::Cursor::readMutableBlock() {
+    if (!reader_.writable_) {
+        throw std::logic_error("Checkpoint reader is read-only");
+    }
+    ConstFieldView block = readBlock();
+    return FieldView(const_cast<double*>(block.data()), block.rows(), block.cols());
+}
+
+namespace {
+
+constexpr std::size_t kDeltaBlock = 64;
+
+void appendU64(std::vector<unsigned char>& out, std::uint64_t value) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+std::uint64_t readU64(const std::vector<unsigned char>& in, std::size_t& pos) {
+    std::uint64_t value;
+    if (in.size() - pos < sizeof(value)) {
+        throw std::runtime_error("Checkpoint delta is truncated");
+    }
+    std::memcpy(&value, in.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return value;
+}
+
+} // namespace
+
+std::vector<unsigned char> checkpointDelta(const std::vector<unsigned char>& before,
+                                           const std::vector<unsigned char>& after) {
+    std::vector<std::pair<std::size_t, std::size_t>> runs;
+    for (std::size_t offset = 0; offset < after.size(); offset += kDeltaBlock) {
+        const std::size_t length = std::min(kDeltaBlock, after.size() - offset);
+        const bool same = offset + length <= before.size() &&
+                          std::memcmp(before.data() + offset, after.data() + offset, length) == 0;
+        if (same) {
+            continue;
+        }
+        if (!runs.empty() && runs.back().first + runs.back().second == offset) {
+            runs.back().second += length;
+        } else {
+            runs.emplace_back(offset, length);
+        }
+    }
+
+    std::vector<unsigned char> delta;
+    appendU64(delta, after.size());
+    appendU64(delta, runs.size());
+    for (const auto& run : runs) {
+        appendU64(delta, run.first);
+        appendU64(delta, run.second);
+        delta.insert(delta.end(), after.begin() + run.first, after.begin() + run.first + run.second);
+    }
+    return delta;
+}
+
+std::vector<unsigned char> applyCheckpointDelta(std::vector<unsigned char> state,
+                                                const std::vector<unsigned char>& delta) {
+    std::size_t pos = 0;
+    const std::uint64_t size = readU64(delta, pos);
+    const std::uint64_t runs = readU64(delta, pos);
+    if (size > std::numeric_limits<std::size_t>::max()) {
+        throw std::runtime_error("Checkpoint delta is corrupt");
+    }
+    state.resize(static_cast<std::size_t>(size));
+    for (std::uint64_t i = 0; i < runs; ++i) {
+        const std::uint64_t offset = readU64(delta, pos);
+        const std::uint64_t length = readU64(delta, pos);
+        if (offset > size || length > size - offset || length > delta.size() - pos) {
+            throw std::runtime_error("Checkpoint delta is corrupt");
+        }
+        std::memcpy(state.data() + offset, delta.data() + pos, static_cast<std::size_t>(length));
+        pos += static_cast<std::size_t>(length);
+    }
+    return state;
+}
+
@@ -0,0 +1,180 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef CHECKPOINT_IO_HPP
+#define CHECKPOINT_IO_HPP
+
+#include "field_store.hpp"
+#include <Eigen/Dense>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Chunked binary checkpoint container.
+//
+// A file is a fixed header followed by a sequence of chunks:
+//
+//   header : char magic[8] = "SPROCKPT", u32 format version,
+//            u32 block alignment (version 1: reserved, blocks use 64)
+//   chunk  : u32 tag, u32 chunk version, u64 payload bytes, payload
+//
+// Chunk payloads may contain field blocks (u32 rows, u32 cols, doubles).
+// The doubles of every block start at a file offset that is a multiple of
+// the block alignment (at least 64), so a reader that maps the file gets
+// views that already satisfy the FieldStore alignment; page alignment
+// additionally lets each block be paged in on its own. Readers skip chunks
+// whose tag they do not know; a file is only complete once its terminating
+// end chunk is present.
+constexpr std::uint32_t kCheckpointVersion = 2;
+
+constexpr std::uint32_t checkpointTag(char a, char b, char c, char d) {
+    return static_cast<std::uint32_t>(static_cast<unsigned char>(a)) |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(b)) << 8 |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(c)) << 16 |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(d)) << 24;
+}
+
+constexpr std::uint32_t kCheckpointEndTag = checkpointTag('E', 'N', 'D', ' ');
+
+class CheckpointWriter {
+public:
+    // Writes to `path + ".tmp"`; finish() moves it over `path`, so an
+    // interrupted save never clobbers the previous checkpoint.
+    // block_alignment must be a power of two no smaller than 64.
+    explicit CheckpointWriter(const std::string& path,
+                              std::size_t block_alignment = FieldStore::kAlignment);
+    // Appends to `buffer` instead of a file; finish() only terminates it.
+    explicit CheckpointWriter(std::vector<unsigned char>& buffer,
+                              std::size_t block_alignment = FieldStore::kAlignment);
+    // The VM page size: blocks then start on their own pages and can be
+    // mapped in lazily.
+    static std::size_t pageAlignment();
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    void beginChunk(std::uint32_t tag, std::uint32_t version = 1);
+    void endChunk();
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Checkpoint values must be trivially copyable");
+        writeBytes(&value, sizeof(T));
+    }
+    void writeString(const std::string& value);
+    // Column-major block; an outer stride larger than rows is compacted.
+    void writeBlock(const Eigen::Ref<const Eigen::ArrayXXd>& block);
+    // Starts a block whose rows * cols doubles the caller then supplies
+    // through writeBytes/writeFill.
+    void beginBlock(int rows, int cols);
+    void writeFill(double value, std::size_t count);
+    void writeBytes(const void* data, std::size_t size);
+
+    // Appends the end chunk, flushes and renames into place.
+    void finish();
+
+private:
+    void pad(std::size_t alignment);
+
+    std::string path_;
+    std::string temp_path_;
+    std::size_t block_alignment_;
+    std::ofstream out_;
+    std::vector<unsigned char>* buffer_ = nullptr;
+    std::uint64_t offset_ = 0;
+    std::uint64_t chunk_start_ = 0;
+    bool in_chunk_ = false;
+    bool finished_ = false;
+};
+
+// Read-only view of a checkpoint file mapped into memory.
+class CheckpointReader {
+public:
+    struct Chunk {
+        std::uint32_t tag;
+        std::uint32_t version;
+        const unsigned char* begin;
+        const unsigned char* end;
+    };
+
+    // Sequential decoder over one chunk payload. Every read is bounds
+    // checked and throws std::runtime_error on a truncated chunk.
+    class Cursor {
+    public:
+        Cursor(const CheckpointReader& reader, const Chunk& chunk);
+
+        template <typename T>
+        T read() {
+            static_assert(std::is_trivially_copyable<T>::value, "Checkpoint values must be trivially copyable");
+            T value;
+            std::memcpy(&value, take(sizeof(T)), sizeof(T));
+            return value;
+        }
+        std::string readString();
+        void readBytes(void* data, std::size_t size) { std::memcpy(data, take(size), size); }
+        // View straight into the mapping; valid while the reader lives.
+        ConstFieldView readBlock();
+        // Writable view into a copy-on-write mapping; throws std::logic_error
+        // unless the reader was opened writable.
+        FieldView readMutableBlock();
+        bool atEnd() const { return pos_ == end_; }
+        const CheckpointReader& reader() const { return reader_; }
+
+    private:
+        const unsigned char* take(std::size_t size);
+
+        const CheckpointReader& reader_;
+        const unsigned char* base_;
+        const unsigned char* pos_;
+        const unsigned char* end_;
+    };
+
+    // Maps the file and indexes its chunks; throws std::runtime_error if the
+    // file is missing, of another format version, or incomplete. A writable
+    // reader maps the file privately: pages are read on first touch and
+    // copied on first write, and the file itself is never modified.
+    explicit CheckpointReader(const std::string& path, bool writable = false);
+    // Read-only reader over an image produced by the in-memory writer. The
+    // image is copied if its storage is not aligned for its blocks.
+    explicit CheckpointReader(std::shared_ptr<const std::vector<unsigned char>> image);
+    CheckpointReader(const CheckpointReader&) = delete;
+    CheckpointReader& operator=(const CheckpointReader&) = delete;
+
+    const std::vector<Chunk>& chunks() const { return chunks_; }
+    Cursor cursor(const Chunk& chunk) const { return Cursor(*this, chunk); }
+    std::uint32_t formatVersion() const { return version_; }
+    bool isWritable() const { return writable_; }
+    // Keeps the mapping alive independently of the reader, for consumers
+    // that hold on to block memory.
+    std::shared_ptr<const void> mapping() const { return mapping_; }
+
+private:
+    void indexChunks(const std::string& path);
+
+    std::shared_ptr<const void> mapping_;
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::uint32_t version_ = 0;
+    std::uint32_t block_alignment_ = FieldStore::kAlignment;
+    bool writable_ = false;
+    std::vector<Chunk> chunks_;
+};
+
+// Byte-level difference between two checkpoint images, e.g. the
+// in-memory records of one wafer before and after a process step.
+// Applying checkpointDelta(before, after) to `before` yields `after`; only
+// the 64-byte blocks that differ are stored, so a step that modifies a few
+// fields costs little more than those fields.
+//
+//   delta : u64 size of `after`, u64 run count,
+//           runs of (u64 offset, u64 length, bytes)
+std::vector<unsigned char> checkpointDelta(const std::vector<unsigned char>& before,
+                                           const std::vector<unsigned char>& after);
+// Throws std::runtime_error if the delta is malformed.
+std::vector<unsigned char> applyCheckpointDelta(std::vector<unsigned char> before,
+                                                const std::vector<unsigned char>& delta);
+
+#endif // CHECKPOINT_IO_HPP
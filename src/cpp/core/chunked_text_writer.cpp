@@ -0,0 +1,142 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "chunked_text_writer.hpp"
+#include "task_scheduler.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace {
+
+// write() text is handed on once this much is staged
+constexpr std::size_t kStagedBytes = 1 << 20;
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+ChunkedTextWriter::ChunkedTextWriter(const std::string& path) : ChunkedTextWriter(path, Options()) {}
+
+ChunkedTextWriter::ChunkedTextWriter(const std::string& path, const Options& options)
+    : path_(path), options_(options) {
+    options_.chunk_records = std::max<std::size_t>(1, options_.chunk_records);
+    if (options_.gzip || endsWith(path, ".gz")) {
+        const std::string mode = "wb" + std::to_string(std::clamp(options_.compression_level, 0, 9));
+        gz_ = gzopen(path.c_str(), mode.c_str());
+        if (gz_) {
+            gzbuffer(gz_, 1 << 20);
+        }
+    } else {
+        file_ = std::fopen(path.c_str(), "wb");
+    }
+    if (!file_ && !gz_) {
+        throw std::runtime_error("Cannot open text output file: " + path);
+    }
+}
+
+ChunkedTextWriter::~ChunkedTextWriter() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void ChunkedTextWriter::write(std::string_view text) {
+    staged_ << text;
+    if (staged_.size() >= kStagedBytes) {
+        stage();
+    }
+}
+
+void ChunkedTextWriter::stage() {
+    if (staged_.size() == 0) {
+        return;
+    }
+    std::vector<TextBuffer> chunks(1);
+    std::swap(chunks[0], staged_);
+    submit(std::move(chunks));
+}
+
+void ChunkedTextWriter::writeRecords(std::size_t count,
+                                     const std::function<void(std::size_t, TextBuffer&)>& format) {
+    stage();
+    const std::size_t per_chunk = options_.chunk_records;
+    const std::size_t chunks = (count + per_chunk - 1) / per_chunk;
+    // Enough chunks per batch to keep every worker busy while one is written
+    const std::size_t batch = 4 * static_cast<std::size_t>(std::max(1, TaskScheduler::getInstance().threadCount()));
+    for (std::size_t first = 0; first < chunks; first += batch) {
+        std::vector<TextBuffer> formatted(std::min(batch, chunks - first));
+        TaskScheduler::getInstance().parallelFor(0, static_cast<int>(formatted.size()), [&](int begin, int end) {
+            for (int c = begin; c < end; ++c) {
+                const std::size_t record = (first + c) * per_chunk;
+                TextBuffer& out = formatted[c];
+                for (std::size_t i = record; i < std::min(count, record + per_chunk); ++i) {
+                    format(i, out);
+                }
+            }
+        }, 1);
+        submit(std::move(formatted));
+    }
+}
+
+void ChunkedTextWriter::submit(std::vector<TextBuffer> chunks) {
+    if (pending_.valid()) {
+        pending_.get(); // Rethrows the last batch's error
+    }
+    if (!file_ && !gz_) {
+        throw std::runtime_error("Text output file is closed: " + path_);
+    }
+    for (const auto& chunk : chunks) {
+        bytes_ += chunk.size();
+    }
+    pending_ = std::async(std::launch::async, [this, chunks = std::move(chunks)] {
+        for (const auto& chunk : chunks) {
+            writeOut(chunk.str());
+        }
+    });
+}
+
+void ChunkedTextWriter::writeOut(const std::string& text) {
+    if (text.empty()) {
+        return;
+    }
+    bool ok;
+    if (gz_) {
+        // gzwrite takes an unsigned length, so very large chunks go in parts
+        ok = true;
+        for (std::size_t done = 0; ok && done < text.size(); done += 1u << 30) {
+            const unsigned part = static_cast<unsigned>(std::min<std::size_t>(text.size() - done, 1u << 30));
+            ok = gzwrite(gz_, text.data() + done, part) == static_cast<int>(part);
+        }
+    } else {
+        ok = std::fwrite(text.data(), 1, text.size(), file_) == text.size();
+    }
+    if (!ok) {
+        throw std::runtime_error("Failed writing text output file: " + path_);
+    }
+}
+
+void ChunkedTextWriter::close() {
+    if (!file_ && !gz_) {
+        return;
+    }
+    std::string error;
+    try {
+        stage();
+        if (pending_.valid()) {
+            pending_.get();
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    const bool closed = gz_ ? gzclose(gz_) == Z_OK : std::fclose(file_) == 0;
+    file_ = nullptr;
+    gz_ = nullptr;
+    if (error.empty() && !closed) {
+        error = "Failed closing text output file: " + path_;
+    }
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
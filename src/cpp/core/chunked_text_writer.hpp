@@ -0,0 +1,109 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef CHUNKED_TEXT_WRITER_HPP
+#define CHUNKED_TEXT_WRITER_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+struct gzFile_s;
+
+// Text built up in memory without stream formatting. Numbers are spelled
+// by std::to_chars: integers exactly, doubles in the shortest form that
+// reads back to the same value ("1e-07", "0.25", "3").
+class TextBuffer {
+public:
+    TextBuffer& operator<<(std::string_view text) {
+        text_.append(text.data(), text.size());
+        return *this;
+    }
+    TextBuffer& operator<<(char c) {
+        text_.push_back(c);
+        return *this;
+    }
+    TextBuffer& operator<<(double value) {
+        char digits[32];
+        text_.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+        return *this;
+    }
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value &&
+                                                      !std::is_same<T, bool>::value,
+                                                  int>::type = 0>
+    TextBuffer& operator<<(T value) {
+        char digits[24];
+        text_.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+        return *this;
+    }
+
+    const std::string& str() const { return text_; }
+    std::size_t size() const { return text_.size(); }
+    void clear() { text_.clear(); }
+    void reserve(std::size_t bytes) { text_.reserve(bytes); }
+
+private:
+    std::string text_;
+};
+
+// Writes a large text file (netlists, Liberty, DEF) whose records are
+// formatted in parallel.
+//
+// writeRecords() cuts the records into chunks of chunk_records, formats
+// a batch of chunks on the task scheduler, one TextBuffer each, and hands
+// the batch to an I/O thread that writes the chunks in order while the
+// next batch is formatted. Text passed to write() is staged and goes out
+// in order with the records. With gzip (or a path ending in ".gz") the
+// I/O thread deflates on the way out.
+//
+// I/O errors are rethrown as std::runtime_error by the next write,
+// writeRecords() or close().
+class ChunkedTextWriter {
+public:
+    struct Options {
+        bool gzip = false;                   // Also on for paths ending in ".gz"
+        int compression_level = 1;           // zlib level when gzipping
+        std::size_t chunk_records = 1 << 14; // Records formatted per task
+    };
+
+    // Creates or truncates the file; throws std::runtime_error if it
+    // cannot be opened
+    explicit ChunkedTextWriter(const std::string& path);
+    ChunkedTextWriter(const std::string& path, const Options& options);
+    // Closes the file; errors are dropped, call close() to see them
+    ~ChunkedTextWriter();
+    ChunkedTextWriter(const ChunkedTextWriter&) = delete;
+    ChunkedTextWriter& operator=(const ChunkedTextWriter&) = delete;
+
+    void write(std::string_view text);
+    void write(const TextBuffer& text) { write(std::string_view(text.str())); }
+    // format(i, out) appends record i to out, for i in [0, count); records
+    // come out in index order. format runs on several threads at once.
+    void writeRecords(std::size_t count, const std::function<void(std::size_t, TextBuffer&)>& format);
+    // Writes what is staged and closes the file; later calls are no-ops
+    void close();
+
+    const std::string& path() const { return path_; }
+    bool gzipped() const { return gz_ != nullptr; }
+    std::size_t bytesWritten() const { return bytes_; } // Before compression
+
+private:
+    // Hands chunks to the I/O thread once it has written the last batch
+    void submit(std::vector<TextBuffer> chunks);
+    void writeOut(const std::string& text); // On the I/O thread
+    void stage();                           // Submits what write() staged
+
+    std::string path_;
+    Options options_;
+    std::FILE* file_ = nullptr;
+    gzFile_s* gz_ = nullptr;
+    TextBuffer staged_;
+    std::future<void> pending_;
+    std::size_t bytes_ = 0;
+};
+
+#endif // CHUNKED_TEXT_WRITER_HPP
@@ -1,8 +1,12 @@
 #include "config_manager.hpp"
+#include "autotuner.hpp"
+#include "json_value.hpp"
 #include <sstream>
 #include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 
 namespace SemiPRO {
 
@@ -50,6 +54,19 @@ void ConfigSection::setValue(const std::string& key, const ConfigValue& value) {
                       "ConfigManager");
 }
 
+std::optional<ConfigValue> ConfigSection::getRawValue(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = values_.find(key);
+    if (it != values_.end()) {
+        return it->second;
+    }
+    auto def_it = definitions_.find(key);
+    if (def_it != definitions_.end()) {
+        return def_it->second.default_value;
+    }
+    return std::nullopt;
+}
+
 bool ConfigSection::hasValue(const std::string& key) const {
     std::lock_guard<std::mutex> lock(mutex_);
     return values_.find(key) != values_.end();
@@ -221,32 +238,113 @@ void ConfigSection::clear() {
     definitions_.clear();
 }
 
+// Pretty-printed two spaces a level; indent is prefixed to every line
+// after the first, for text nested in an outer document
 std::string ConfigSection::toJSON(int indent) const {
+    std::string out;
+    {
+        JsonWriter json(out, 2);
+        writeJSON(json);
+    }
+    if (indent > 0) {
+        const std::string margin = "\n" + std::string(indent, ' ');
+        for (std::size_t at = out.find('\n'); at != std::string::npos; at = out.find('\n', at + margin.size())) {
+            out.replace(at, 1, margin);
+        }
+    }
+    return out;
+}
+
+void ConfigSection::writeJSON(JsonWriter& json) const {
     std::lock_guard<std::mutex> lock(mutex_);
-    std::ostringstream oss;
-    std::string indent_str(indent, ' ');
-    
-    oss << "{\n";
-    
-    // Add values
-    bool first = true;
+    json.beginObject();
     for (const auto& [key, value] : values_) {
-        if (!first) oss << ",\n";
-        oss << indent_str << "  \"" << key << "\": ";
-        oss << ConfigUtils::configValueToString(value);
-        first = false;
+        json.key(key);
+        std::visit([&json](const auto& v) {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, bool>) {
+                json.boolean(v);
+            } else if constexpr (std::is_same_v<T, int>) {
+                json.integer(v);
+            } else if constexpr (std::is_same_v<T, double>) {
+                json.number(v);
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                json.string(v);
+            } else if constexpr (std::is_same_v<T, std::vector<double>>) {
+                json.numbers(v.data(), v.size());
+            } else {
+                json.beginArray();
+                for (const std::string& item : v) {
+                    json.string(item);
+                }
+                json.endArray();
+            }
+        }, value);
     }
-    
-    // Add subsections
     for (const auto& [name, subsection] : subsections_) {
-        if (!first) oss << ",\n";
-        oss << indent_str << "  \"" << name << "\": ";
-        oss << subsection->toJSON(indent + 2);
-        first = false;
+        json.key(name);
+        subsection->writeJSON(json);
+    }
+    json.endObject();
+}
+
+void ConfigSection::fromJSON(const std::string& json) {
+    fromJSON(JsonValue::parse(json));
+}
+
+void ConfigSection::fromJSON(const JsonValue& object) {
+    for (const auto& [key, value] : object.members()) {
+        switch (value.type()) {
+            case JsonValue::Type::Null:
+                break;
+            case JsonValue::Type::Object:
+                getOrCreateSubsection(key).fromJSON(value);
+                break;
+            case JsonValue::Type::Bool:
+                setValue(key, value.asBool());
+                break;
+            case JsonValue::Type::String:
+                setValue(key, value.asString());
+                break;
+            case JsonValue::Type::Number: {
+                bool holds_int = false;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto it = values_.find(key);
+                    holds_int = it != values_.end() && std::holds_alternative<int>(it->second);
+                }
+                const double number = value.asNumber();
+                if (!holds_int) {
+                    setValue(key, number);
+                } else if (std::floor(number) == number && std::abs(number) <= std::numeric_limits<int>::max()) {
+                    setValue(key, static_cast<int>(number));
+                } else {
+                    throw ValidationException("Parameter " + name_ + "." + key + " must be an integer");
+                }
+                break;
+            }
+            case JsonValue::Type::Array: {
+                std::vector<double> numbers;
+                std::vector<std::string> strings;
+                for (const auto& item : value.items()) {
+                    if (item.isNumber() && strings.empty()) {
+                        numbers.push_back(item.asNumber());
+                    } else if (item.isString() && numbers.empty()) {
+                        strings.push_back(item.asString());
+                    } else {
+                        throw ValidationException("Parameter " + name_ + "." + key +
+                                                  " must be an array of numbers or of strings");
+                    }
+                }
+                if (strings.empty()) {
+                    setValue(key, numbers);
+                } else {
+                    setValue(key, strings);
+                }
+                break;
+            }
+        }
     }
-    
-    oss << "\n" << indent_str << "}";
-    return oss.str();
 }
 
 // ConfigManager implementation
@@ -267,8 +365,6 @@ ConfigManager& ConfigManager::getInstance() {
 }
 
 bool ConfigManager::loadFromFile(const std::string& file_path) {
-    std::lock_guard<std::mutex> lock(config_mutex_);
-    
     std::ifstream file(file_path);
     if (!file.is_open()) {
         SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::SYSTEM,
@@ -280,7 +376,12 @@ bool ConfigManager::loadFromFile(const std::string& file_path) {
                        std::istreambuf_iterator<char>());
     file.close();
     
-    config_file_path_ = file_path;
+    {
+        // The loaders below take the lock themselves
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        config_file_path_ = file_path;
+    }
+    Autotuner::getInstance().useConfigDirectory(file_path);
     
     // Determine format by extension
     if (file_path.size() >= 5 && file_path.substr(file_path.size() - 5) == ".json") {
@@ -331,6 +432,7 @@ void ConfigManager::setValue(const std::string& path, const ConfigValue& value)
     if (section) {
         std::string param_name = getParameterFromPath(path);
         section->setValue(param_name, value);
+        version_.fetch_add(1, std::memory_order_release);
         notifyChange(path, value);
     }
 }
@@ -353,9 +455,51 @@ void ConfigManager::defineParameter(const std::string& path, const ParameterDefi
     auto section = navigateToSection(path, true);
     if (section) {
         section->defineParameter(def);
+        version_.fetch_add(1, std::memory_order_release);
     }
 }
 
+std::size_t ConfigManager::registerKey(const std::string& path) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    auto it = key_slots_.find(path);
+    if (it != key_slots_.end()) {
+        return it->second;
+    }
+    const std::size_t slot = key_paths_.size();
+    key_paths_.push_back(path);
+    key_slots_.emplace(path, slot);
+    // Older snapshots have no such slot
+    version_.fetch_add(1, std::memory_order_release);
+    publishSnapshot();
+    return slot;
+}
+
+const ConfigSnapshot& ConfigManager::snapshot() const {
+    const ConfigSnapshot* current = snapshot_.load(std::memory_order_acquire);
+    if (current && current->version() == version_.load(std::memory_order_acquire)) {
+        return *current;
+    }
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return *publishSnapshot();
+}
+
+const ConfigSnapshot* ConfigManager::publishSnapshot() const {
+    const std::uint64_t version = version_.load(std::memory_order_acquire);
+    const ConfigSnapshot* current = snapshot_.load(std::memory_order_acquire);
+    if (current && current->version() == version) {
+        return current;
+    }
+    std::vector<std::optional<ConfigValue>> slots;
+    slots.reserve(key_paths_.size());
+    for (const auto& path : key_paths_) {
+        const ConfigSection* section = navigateToSection(path, false);
+        slots.push_back(section ? section->getRawValue(getParameterFromPath(path)) : std::nullopt);
+    }
+    snapshots_.push_back(std::make_unique<const ConfigSnapshot>(version, std::move(slots)));
+    snapshot_.store(snapshots_.back().get(), std::memory_order_release);
+    return snapshots_.back().get();
+}
+
 void ConfigManager::defineParameter(const std::string& path, const ConfigValue& default_value,
                                    const std::string& description, bool required) {
     ParameterDefinition def(getParameterFromPath(path), default_value, description, required);
@@ -427,10 +571,20 @@ void ConfigManager::notifyChange(const std::string& path, const ConfigValue& val
 }
 
 bool ConfigManager::loadFromJSON(const std::string& json_content) {
-    // Simple JSON parsing - in a real implementation, use a proper JSON library
+    try {
+        const JsonValue document = JsonValue::parse(json_content);
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        // Values set before a failure stay, so publish either way
+        version_.fetch_add(1, std::memory_order_release);
+        root_section_->fromJSON(document);
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::VALIDATION,
+                          "Invalid JSON configuration: " + std::string(e.what()), "ConfigManager");
+        return false;
+    }
     SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::GENERAL,
-                      "Loading configuration from JSON", "ConfigManager");
-    return true; // Placeholder
+                      "Loaded configuration from JSON", "ConfigManager");
+    return true;
 }
 
 bool ConfigManager::loadFromYAML(const std::string& yaml_content) {
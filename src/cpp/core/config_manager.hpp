@@ -6,6 +6,9 @@
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <variant>
 #include <optional>
@@ -15,6 +18,9 @@
 
 namespace SemiPRO {
 
+class JsonValue;
+class JsonWriter;
+
 /**
  * Advanced Configuration Management System for SemiPRO
  * Provides hierarchical configuration, validation, defaults, and optimization
@@ -90,6 +96,8 @@ private:
     std::unordered_map<std::string, ParameterDefinition> definitions_;
     std::unordered_map<std::string, std::unique_ptr<ConfigSection>> subsections_;
     mutable std::mutex mutex_;
+
+    void writeJSON(JsonWriter& json) const;
     
 public:
     explicit ConfigSection(const std::string& name) : name_(name) {}
@@ -105,6 +113,8 @@ public:
     
     template<typename T>
     T getValue(const std::string& key, const T& default_value) const;
+    // The stored value, else the definition's default, of whatever type
+    std::optional<ConfigValue> getRawValue(const std::string& key) const;
     
     void setValue(const std::string& key, const ConfigValue& value);
     bool hasValue(const std::string& key) const;
@@ -127,11 +137,32 @@ public:
     // Serialization
     std::string toJSON(int indent = 0) const;
     std::string toYAML(int indent = 0) const;
+    // Values and subsections from a JSON object; nested objects become
+    // subsections. Defined parameters are validated as they are set, and a
+    // number stays an int where the parameter holds one. Throws on
+    // malformed JSON, mistyped values and failed validation.
     void fromJSON(const std::string& json);
+    void fromJSON(const JsonValue& object);
     
     const std::string& getName() const { return name_; }
 };
 
+// The values behind every registered ConfigKey at one configuration
+// version, indexed by the key's slot. Never modified once published.
+class ConfigSnapshot {
+public:
+    ConfigSnapshot(std::uint64_t version, std::vector<std::optional<ConfigValue>> slots)
+        : version_(version), slots_(std::move(slots)) {}
+
+    std::uint64_t version() const { return version_; }
+    // Empty when the path holds no value and has no default
+    const std::optional<ConfigValue>& slot(std::size_t index) const { return slots_[index]; }
+
+private:
+    std::uint64_t version_;
+    std::vector<std::optional<ConfigValue>> slots_;
+};
+
 // Main configuration manager
 class ConfigManager {
 private:
@@ -149,6 +180,16 @@ private:
     // Configuration change callbacks
     std::vector<std::function<void(const std::string&, const ConfigValue&)>> change_callbacks_;
     
+    // Registered key paths by slot, and the published snapshots. Every
+    // change bumps version_; the first read after it publishes a new
+    // snapshot. Superseded snapshots are kept, as a reader may still hold
+    // one, so a snapshot lives as long as the manager.
+    std::vector<std::string> key_paths_;
+    std::unordered_map<std::string, std::size_t> key_slots_;
+    std::atomic<std::uint64_t> version_{0};
+    mutable std::atomic<const ConfigSnapshot*> snapshot_{nullptr};
+    mutable std::vector<std::unique_ptr<const ConfigSnapshot>> snapshots_;
+    
     ConfigManager();
     
 public:
@@ -178,6 +219,13 @@ public:
     void setValue(const std::string& path, const ConfigValue& value);
     bool hasValue(const std::string& path) const;
     
+    // Precompiled lookups (see ConfigKey). registerKey returns the path's
+    // slot in every later snapshot. snapshot() is the current version: two
+    // atomic loads, unless the configuration changed since the last call.
+    std::size_t registerKey(const std::string& path);
+    const ConfigSnapshot& snapshot() const;
+    std::uint64_t version() const { return version_.load(std::memory_order_acquire); }
+    
     // Parameter definition
     void defineParameter(const std::string& path, const ParameterDefinition& def);
     void defineParameter(const std::string& path, const ConfigValue& default_value,
@@ -223,6 +271,8 @@ private:
     ConfigSection* navigateToSection(const std::string& path, bool create = false) const;
     std::string getParameterFromPath(const std::string& path) const;
     void notifyChange(const std::string& path, const ConfigValue& value);
+    // Caller holds config_mutex_
+    const ConfigSnapshot* publishSnapshot() const;
     
     // Built-in validators
     static bool validatePositiveNumber(const ConfigValue& value, std::string& error);
@@ -284,6 +334,33 @@ T ConfigManager::getValue(const std::string& path, const T& default_value) const
     return result.value_or(default_value);
 }
 
+// A configuration path resolved once, for reads on hot paths. get() reads
+// the key's slot in the current snapshot, without locks or path lookups,
+// and sees a reload as soon as it is published. As with getValue, a value
+// of another type than T reads as the default.
+//
+//   static const ConfigKey<double> temperature("physics.temperature.default", 1000.0);
+//   double t = temperature.get();
+template<typename T>
+class ConfigKey {
+public:
+    ConfigKey(const std::string& path, T default_value)
+        : manager_(&ConfigManager::getInstance()), slot_(manager_->registerKey(path)),
+          default_(std::move(default_value)) {}
+
+    // Snapshots outlive their readers, so the reference stays valid
+    const T& get() const {
+        const std::optional<ConfigValue>& value = manager_->snapshot().slot(slot_);
+        const T* typed = value ? std::get_if<T>(&*value) : nullptr;
+        return typed ? *typed : default_;
+    }
+
+private:
+    ConfigManager* manager_;
+    std::size_t slot_;
+    T default_;
+};
+
 // Utility macros for configuration access
 #define CONFIG_GET(path, type, default_val) \
     SemiPRO::ConfigManager::getInstance().getValue<type>(path, default_val)
@@ -0,0 +1,43 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef COPY_ON_WRITE_HPP
+#define COPY_ON_WRITE_HPP
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+// A value shared by its copies until one of them writes.
+//
+// Copying a CopyOnWrite costs one reference count whatever the size of the
+// value; write() gives the caller a private copy first if any other holder
+// still shares it. Reads through get() never copy. Like the containers it
+// wraps, one CopyOnWrite is not safe to write from two threads, but
+// distinct copies are: each only ever writes to a value it alone holds.
+template <typename T>
+class CopyOnWrite {
+public:
+    CopyOnWrite() : value_(std::make_shared<T>()) {}
+    explicit CopyOnWrite(T value) : value_(std::make_shared<T>(std::move(value))) {}
+
+    const T& get() const { return *value_; }
+    const T& operator*() const { return *value_; }
+    const T* operator->() const { return value_.get(); }
+
+    T& write() {
+        if (value_.use_count() > 1) {
+            value_ = std::make_shared<T>(*value_);
+        } else {
+            // The last other holder may have been reading the value on its
+            // way out; its reads must finish before ours write.
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *value_;
+    }
+
+    bool isShared() const { return value_.use_count() > 1; }
+
+private:
+    std::shared_ptr<T> value_;
+};
+
+#endif // COPY_ON_WRITE_HPP
@@ -0,0 +1,216 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "depth_mesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+DepthMesh::DepthMesh(const Eigen::ArrayXd& nodes)
+    : DepthMesh(nodes, nodes.size() > 0 ? nodes[0] : 0.0, nodes.size() > 0 ? nodes[nodes.size() - 1] : 0.0) {}
+
+DepthMesh::DepthMesh(const Eigen::ArrayXd& nodes, double lower, double upper)
+    : nodes_(nodes), lower_(lower), upper_(upper) {
+  for (int i = 1; i < nodes_.size(); ++i) {
+    if (!(nodes_[i] > nodes_[i - 1])) {
+      throw std::invalid_argument("Depth mesh nodes must increase strictly");
+    }
+  }
+  if (nodes_.size() > 0 && (lower_ > nodes_[0] || upper_ < nodes_[nodes_.size() - 1])) {
+    throw std::invalid_argument("Depth mesh bounds must enclose its nodes");
+  }
+}
+
+DepthMesh DepthMesh::cells(double depth, int count) {
+  if (count <= 0 || depth <= 0.0) {
+    return DepthMesh();
+  }
+  const double width = depth / count;
+  return DepthMesh(Eigen::ArrayXd::LinSpaced(count, 0.5 * width, depth - 0.5 * width), 0.0, depth);
+}
+
+DepthMesh DepthMesh::graded(double depth, double spacing, double extent, double growth) {
+  if (depth <= 0.0 || spacing <= 0.0 || growth < 1.0) {
+    throw std::invalid_argument("Graded mesh needs a positive depth and spacing and growth >= 1");
+  }
+  std::vector<double> nodes = {0.0};
+  double h = spacing;
+  while (nodes.back() + h < depth) {
+    nodes.push_back(nodes.back() + h);
+    if (nodes.back() >= extent) {
+      h *= growth;
+    }
+  }
+  // The last cell takes up the remainder, merged into its neighbour if short
+  if (depth - nodes.back() < 0.5 * h && nodes.size() > 1) {
+    nodes.back() = depth;
+  } else {
+    nodes.push_back(depth);
+  }
+  return DepthMesh(Eigen::Map<const Eigen::ArrayXd>(nodes.data(), nodes.size()));
+}
+
+DepthMesh DepthMesh::adapted(const DepthMesh& mesh, const Eigen::ArrayXd& values, const Refinement& refinement) {
+  const int n = mesh.size();
+  if (values.size() != n) {
+    throw std::invalid_argument("Profile and depth mesh sizes differ");
+  }
+  if (n < 3) {
+    return mesh;
+  }
+  const Eigen::ArrayXd& x = mesh.nodes_;
+  const double floor = std::max(refinement.floor * values.abs().maxCoeff(), std::numeric_limits<double>::min());
+
+  // Spacing keeping the linear interpolation error, h^2 |c''| / 8, under
+  // tolerance times the local value
+  Eigen::ArrayXd spacing(n);
+  for (int i = 1; i < n - 1; ++i) {
+    const double curvature = 2.0 *
+                             ((values[i + 1] - values[i]) / (x[i + 1] - x[i]) -
+                              (values[i] - values[i - 1]) / (x[i] - x[i - 1])) /
+                             (x[i + 1] - x[i - 1]);
+    const double scale = std::max(std::abs(values[i]), floor);
+    spacing[i] = curvature != 0.0 ? std::sqrt(8.0 * refinement.tolerance * scale / std::abs(curvature))
+                                  : refinement.max_spacing;
+  }
+  spacing[0] = std::min(spacing[1], refinement.surface_spacing);
+  spacing[n - 1] = spacing[n - 2];
+  for (int i = 0; i + 1 < n; ++i) {
+    if ((values[i] - refinement.background) * (values[i + 1] - refinement.background) < 0.0) {
+      spacing[i] = std::min(spacing[i], refinement.junction_spacing);
+      spacing[i + 1] = std::min(spacing[i + 1], refinement.junction_spacing);
+    }
+  }
+  spacing = spacing.max(refinement.min_spacing).min(refinement.max_spacing);
+
+  // Grade: a spacing may grow by (growth - 1) per unit of distance
+  const double slope = refinement.growth - 1.0;
+  for (int i = 1; i < n; ++i) {
+    spacing[i] = std::min(spacing[i], spacing[i - 1] + slope * (x[i] - x[i - 1]));
+  }
+  for (int i = n - 2; i >= 0; --i) {
+    spacing[i] = std::min(spacing[i], spacing[i + 1] + slope * (x[i + 1] - x[i]));
+  }
+
+  std::vector<double> nodes = {x[0]};
+  const double end = x[n - 1];
+  while (true) {
+    const double h = mesh.sample(spacing, nodes.back());
+    if (nodes.back() + 1.5 * h >= end) {
+      if (end - nodes.back() > h) {
+        nodes.push_back(0.5 * (nodes.back() + end));
+      }
+      nodes.push_back(end);
+      break;
+    }
+    nodes.push_back(nodes.back() + h);
+  }
+  return DepthMesh(Eigen::Map<const Eigen::ArrayXd>(nodes.data(), nodes.size()), mesh.lower_, mesh.upper_);
+}
+
+Eigen::ArrayXd DepthMesh::volumes() const {
+  const int n = size();
+  Eigen::ArrayXd volume(n);
+  for (int i = 0; i < n; ++i) {
+    const double left = i > 0 ? 0.5 * (nodes_[i - 1] + nodes_[i]) : lower_;
+    const double right = i + 1 < n ? 0.5 * (nodes_[i] + nodes_[i + 1]) : upper_;
+    volume[i] = right - left;
+  }
+  return volume;
+}
+
+int DepthMesh::cellAt(double depth) const {
+  const double* begin = nodes_.data();
+  const double* end = begin + nodes_.size();
+  const double* above = std::upper_bound(begin, end, depth);
+  if (above == begin) {
+    return 0;
+  }
+  if (above == end) {
+    return size() - 1;
+  }
+  const int i = static_cast<int>(above - begin);
+  return depth - nodes_[i - 1] < nodes_[i] - depth ? i - 1 : i;
+}
+
+double DepthMesh::sample(const Eigen::ArrayXd& values, double depth) const {
+  const double* begin = nodes_.data();
+  const double* end = begin + nodes_.size();
+  const double* above = std::upper_bound(begin, end, depth);
+  if (above == begin) {
+    return values[0];
+  }
+  if (above == end) {
+    return values[size() - 1];
+  }
+  const int i = static_cast<int>(above - begin);
+  const double t = (depth - nodes_[i - 1]) / (nodes_[i] - nodes_[i - 1]);
+  return values[i - 1] + t * (values[i] - values[i - 1]);
+}
+
+Eigen::ArrayXd DepthMesh::interpolate(const Eigen::ArrayXd& values, const DepthMesh& target) const {
+  Eigen::ArrayXd result(target.size());
+  for (int k = 0; k < target.size(); ++k) {
+    result[k] = sample(values, target.nodes_[k]);
+  }
+  return result;
+}
+
+Eigen::ArrayXd DepthMesh::cumulative(const Eigen::ArrayXd& values, const Eigen::ArrayXd& depths) const {
+  const int n = size();
+  Eigen::ArrayXd result(depths.size());
+  int i = 0;          // Interval [nodes_[i - 1], nodes_[i]) holding the depth
+  double prefix = 0;  // Integral from lower_ to nodes_[i - 1]
+  for (int k = 0; k < depths.size(); ++k) {
+    const double depth = std::min(std::max(depths[k], lower_), upper_);
+    while (i < n && nodes_[i] <= depth) {
+      prefix += i == 0 ? values[0] * (nodes_[0] - lower_)
+                       : 0.5 * (values[i - 1] + values[i]) * (nodes_[i] - nodes_[i - 1]);
+      ++i;
+    }
+    if (i == 0) {
+      result[k] = values[0] * (depth - lower_);
+    } else if (i == n) {
+      result[k] = prefix + values[n - 1] * (depth - nodes_[n - 1]);
+    } else {
+      const double h = nodes_[i] - nodes_[i - 1];
+      const double d = depth - nodes_[i - 1];
+      result[k] = prefix + values[i - 1] * d + (values[i] - values[i - 1]) * d * d / (2.0 * h);
+    }
+  }
+  return result;
+}
+
+Eigen::ArrayXd DepthMesh::remap(const Eigen::ArrayXd& values, const DepthMesh& target) const {
+  const int m = target.size();
+  if (m == 0) {
+    return Eigen::ArrayXd();
+  }
+  if (values.size() != size() || size() == 0) {
+    throw std::invalid_argument("Profile and depth mesh sizes differ");
+  }
+  // Faces of the target's control volumes
+  Eigen::ArrayXd faces(m + 1);
+  faces[0] = target.lower_;
+  for (int k = 1; k < m; ++k) {
+    faces[k] = 0.5 * (target.nodes_[k - 1] + target.nodes_[k]);
+  }
+  faces[m] = target.upper_;
+
+  Eigen::ArrayXd integral = cumulative(values, faces);
+  Eigen::ArrayXd result(m);
+  for (int k = 0; k < m; ++k) {
+    const double width = faces[k + 1] - faces[k];
+    result[k] = width > 0.0 ? (integral[k + 1] - integral[k]) / width : sample(values, target.nodes_[k]);
+  }
+  return result;
+}
+
+double DepthMesh::integrate(const Eigen::ArrayXd& values) const {
+  if (size() == 0) {
+    return 0.0;
+  }
+  Eigen::ArrayXd end(1);
+  end[0] = upper_;
+  return cumulative(values, end)[0];
+}
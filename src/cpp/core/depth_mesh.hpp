@@ -0,0 +1,79 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef DEPTH_MESH_HPP
+#define DEPTH_MESH_HPP
+
+#include <Eigen/Dense>
+
+// Non-uniform 1D mesh of depths (um from the surface) for dopant profiles.
+//
+// Values live on the nodes, and each node owns the control volume between
+// the midpoints to its neighbours; the outer volumes run to the mesh's
+// lower and upper bounds. Between nodes a profile is taken to be linear,
+// so remapping integrates that interpolant over the target's control
+// volumes: nothing is lost sampling a fine profile onto a coarse mesh,
+// and the dose carries over to second order either way.
+class DepthMesh {
+public:
+  // Spacing control for adapted()
+  struct Refinement {
+    double tolerance;        // Relative error of linear interpolation between nodes
+    double floor;            // Of the peak; weaker values count as this
+    double min_spacing;      // um
+    double max_spacing;      // um
+    double surface_spacing;  // First node spacing, um
+    double junction_spacing; // Where the profile crosses background, um
+    double background;
+    double growth;           // Largest ratio of neighbouring spacings
+
+    Refinement()
+        : tolerance(0.01), floor(1e-6), min_spacing(1e-4), max_spacing(10.0), surface_spacing(1e-3),
+          junction_spacing(1e-3), background(0.0), growth(1.25) {}
+  };
+
+  DepthMesh() = default;
+  // Nodes must increase strictly; bounds default to the end nodes
+  explicit DepthMesh(const Eigen::ArrayXd& nodes);
+  DepthMesh(const Eigen::ArrayXd& nodes, double lower, double upper);
+
+  // Centres of `count` equal cells over [0, depth], the layout of the
+  // wafer's uniform profile
+  static DepthMesh cells(double depth, int count);
+  // Spacing `spacing` down to `extent`, then growing by `growth` per node
+  // to `depth`
+  static DepthMesh graded(double depth, double spacing, double extent, double growth = 1.25);
+  // A mesh over the same span with its nodes placed for `values` (on
+  // `mesh`): fine where the profile curves, near the surface and at
+  // junctions, coarse in the flat bulk
+  static DepthMesh adapted(const DepthMesh& mesh, const Eigen::ArrayXd& values,
+                           const Refinement& refinement = Refinement());
+
+  int size() const { return static_cast<int>(nodes_.size()); }
+  bool empty() const { return nodes_.size() == 0; }
+  const Eigen::ArrayXd& nodes() const { return nodes_; }
+  double lower() const { return lower_; }
+  double upper() const { return upper_; }
+  // Control volume (um) of each node
+  Eigen::ArrayXd volumes() const;
+  // Node whose control volume holds `depth`, clamped to the mesh
+  int cellAt(double depth) const;
+
+  // Linear between nodes, the end values beyond them
+  double sample(const Eigen::ArrayXd& values, double depth) const;
+  Eigen::ArrayXd interpolate(const Eigen::ArrayXd& values, const DepthMesh& target) const;
+  // Averages of the interpolant over the target's control volumes, the
+  // profile being zero outside [lower, upper]
+  Eigen::ArrayXd remap(const Eigen::ArrayXd& values, const DepthMesh& target) const;
+  // Integral of the interpolant over [lower, upper], in value um
+  double integrate(const Eigen::ArrayXd& values) const;
+
+private:
+  // Integral of the interpolant from lower_ to each of the sorted depths,
+  // clamped to the bounds
+  Eigen::ArrayXd cumulative(const Eigen::ArrayXd& values, const Eigen::ArrayXd& depths) const;
+
+  Eigen::ArrayXd nodes_;
+  double lower_ = 0.0;
+  double upper_ = 0.0;
+};
+
+#endif // DEPTH_MESH_HPP
@@ -0,0 +1,176 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "distance_transform.hpp"
+#include "task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+// Buffers for one 1D transform of up to n samples
+struct Envelope {
+  explicit Envelope(int n) : sites(n), bounds(n + 1), in(n), out(n) {}
+  std::vector<int> sites;     // Parabolas on the lower envelope
+  std::vector<double> bounds; // Where each takes over from the last
+  std::vector<double> in;
+  std::vector<double> out;
+};
+
+// out[p] = min over q of f[q] + w (p - q)^2: the parabolas rooted at the
+// finite samples are kept in order of where they come to the bottom, so
+// each sample is pushed and popped at most once
+void lowerEnvelope(const double* f, double* out, int n, double w, Envelope& e) {
+  int k = -1;
+  for (int q = 0; q < n; ++q) {
+    if (f[q] == kInfinity) {
+      continue;
+    }
+    double s = -kInfinity;
+    while (k >= 0) {
+      const int v = e.sites[k];
+      s = ((f[q] + w * q * q) - (f[v] + w * v * v)) / (2.0 * w * (q - v));
+      if (s > e.bounds[k]) {
+        break;
+      }
+      --k;
+    }
+    if (k < 0) {
+      s = -kInfinity;
+    }
+    ++k;
+    e.sites[k] = q;
+    e.bounds[k] = s;
+    e.bounds[k + 1] = kInfinity;
+  }
+  if (k < 0) {
+    std::fill(out, out + n, kInfinity);
+    return;
+  }
+  k = 0;
+  for (int p = 0; p < n; ++p) {
+    while (e.bounds[k + 1] < p) {
+      ++k;
+    }
+    const int v = e.sites[k];
+    out[p] = f[v] + w * (p - v) * (p - v);
+  }
+}
+
+// DistanceTransform::squared between column-major buffers: down the
+// columns, then along the rows through a contiguous copy of each
+void transform(const double* cost, double* out, int rows, int cols, double w) {
+  TaskScheduler& scheduler = TaskScheduler::getInstance();
+  scheduler.parallelFor(0, cols, [&](int first, int last) {
+    Envelope e(rows);
+    for (int j = first; j < last; ++j) {
+      lowerEnvelope(cost + static_cast<std::size_t>(j) * rows, out + static_cast<std::size_t>(j) * rows, rows, w, e);
+    }
+  }, 16);
+  scheduler.parallelFor(0, rows, [&](int first, int last) {
+    Envelope e(cols);
+    for (int i = first; i < last; ++i) {
+      for (int j = 0; j < cols; ++j) {
+        e.in[j] = out[static_cast<std::size_t>(j) * rows + i];
+      }
+      lowerEnvelope(e.in.data(), e.out.data(), cols, w, e);
+      for (int j = 0; j < cols; ++j) {
+        out[static_cast<std::size_t>(j) * rows + i] = e.out[j];
+      }
+    }
+  }, 16);
+}
+
+} // namespace
+
+Eigen::ArrayXXd DistanceTransform::squared(const Eigen::Ref<const Eigen::ArrayXXd>& cost, double spacing) {
+  if (!(spacing > 0.0)) {
+    throw std::invalid_argument("Distance transform spacing must be positive");
+  }
+  const Eigen::ArrayXXd source = cost;
+  Eigen::ArrayXXd result(source.rows(), source.cols());
+  if (source.size() > 0) {
+    transform(source.data(), result.data(), static_cast<int>(source.rows()), static_cast<int>(source.cols()),
+              spacing * spacing);
+  }
+  return result;
+}
+
+void DistanceTransform::offsetHeights(Eigen::Ref<Eigen::ArrayXXd> heights, double spacing, double thickness,
+                                      const BitMask* protect) {
+  if (!(spacing > 0.0)) {
+    throw std::invalid_argument("Distance transform spacing must be positive");
+  }
+  if (!(thickness >= 0.0)) {
+    throw std::invalid_argument("Film thickness must not be negative");
+  }
+  if (protect && (protect->rows() != heights.rows() || protect->cols() != heights.cols())) {
+    throw std::invalid_argument("Protect mask does not match the height map");
+  }
+  if (thickness == 0.0 || heights.size() == 0) {
+    return;
+  }
+  const int rows = static_cast<int>(heights.rows());
+  const int cols = static_cast<int>(heights.cols());
+  const Eigen::ArrayXXd tops = heights;
+  std::vector<char> held(tops.size(), 0);
+  if (protect) {
+    protect->forEachSet([&](int i, int j) { held[static_cast<std::size_t>(j) * rows + i] = 1; });
+  }
+
+  // Every column reaches at least thickness above itself, and nothing
+  // reaches thickness above the highest surface, so only the layers in
+  // between can hold a column's new top
+  const double base = tops.minCoeff() + thickness;
+  const int layers = static_cast<int>(std::ceil((tops.maxCoeff() - tops.minCoeff()) / spacing)) + 1;
+  const double reach = thickness * thickness;
+  Eigen::ArrayXXd grown = tops + thickness;
+  Eigen::ArrayXXd cost(rows, cols);
+  Eigen::ArrayXXd below(rows, cols);
+  Eigen::ArrayXXd above(rows, cols);
+  TaskScheduler& scheduler = TaskScheduler::getInstance();
+  for (int k = 0; k < layers && layers > 1; ++k) {
+    const double z = base + k * spacing;
+    // Squared height above each column's solid; the solid under resist
+    // ends at the resist, whose own walls take no film
+    scheduler.parallelFor(0, cols, [&](int first, int last) {
+      for (int j = first; j < last; ++j) {
+        for (int i = 0; i < rows; ++i) {
+          const std::size_t c = static_cast<std::size_t>(j) * rows + i;
+          const double rise = z - tops.data()[c];
+          cost.data()[c] = held[c] ? (rise <= 0.0 ? 0.0 : kInfinity) : (rise > 0.0 ? rise * rise : 0.0);
+        }
+      }
+    }, 16);
+    transform(cost.data(), above.data(), rows, cols, spacing * spacing);
+    if (k > 0) {
+      // The squared distance never falls going up a column, so it passes
+      // thickness once; the crossing is interpolated in the distance
+      scheduler.parallelFor(0, cols, [&](int first, int last) {
+        for (int j = first; j < last; ++j) {
+          for (int i = 0; i < rows; ++i) {
+            const std::size_t c = static_cast<std::size_t>(j) * rows + i;
+            const double lower = below.data()[c];
+            const double upper = above.data()[c];
+            if (lower <= reach && upper > reach) {
+              const double a = std::sqrt(lower);
+              const double b = std::sqrt(upper);
+              const double top = z - spacing + (b > a ? spacing * (thickness - a) / (b - a) : 0.0);
+              grown.data()[c] = std::max(grown.data()[c], top);
+            }
+          }
+        }
+      }, 16);
+    }
+    std::swap(below, above);
+  }
+  for (int j = 0; j < cols; ++j) {
+    for (int i = 0; i < rows; ++i) {
+      heights(i, j) = held[static_cast<std::size_t>(j) * rows + i] ? tops(i, j) : grown(i, j);
+    }
+  }
+}
@@ -0,0 +1,31 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "bit_mask.hpp"
+#include <Eigen/Dense>
+
+// Exact Euclidean distance transforms on the wafer grid, after
+// Felzenszwalb and Huttenlocher: a 2D transform is a 1D lower envelope of
+// parabolas down every column and then along every row, each linear in its
+// length, with the columns and then the rows shared out between threads.
+class DistanceTransform {
+public:
+  // min over q of cost(q) + (spacing |p - q|)^2 at every cell p, with p and
+  // q in cells. Cells of infinite cost are not sources; a cell no source
+  // reaches is infinite. Throws std::invalid_argument unless spacing is
+  // positive.
+  static Eigen::ArrayXXd squared(const Eigen::Ref<const Eigen::ArrayXXd>& cost, double spacing = 1.0);
+
+  // Grows a film of the given thickness conformally on the solid below a
+  // height map, in place: each column rises to the top of everything within
+  // thickness of the solid, so walls and floors take the same film and
+  // narrow gaps close. The distance is sampled in layers spacing apart
+  // between the lowest and highest surface, each one 2D transform, and the
+  // crossing interpolated between layers, so the cost follows the surface's
+  // relief and not the thickness. Set cells of protect, when given, are
+  // under resist: they keep their height, and their solid lines the film
+  // beside them only up to its top. Throws std::invalid_argument for a
+  // spacing that is not positive, a negative thickness or a protect mask
+  // of another shape.
+  static void offsetHeights(Eigen::Ref<Eigen::ArrayXXd> heights, double spacing, double thickness,
+                            const BitMask* protect = nullptr);
+};
@@ -0,0 +1,629 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "distributed_batch.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace SemiPRO {
+
+namespace {
+
+// The coordinator looks for stragglers at least this often
+constexpr std::chrono::milliseconds kSpeculationPoll(20);
+
+CacheKey stateHash(const std::vector<unsigned char>& state) {
+    return ContentHasher().update(state.data(), state.size()).finish();
+}
+
+std::string stateKey(const std::string& prefix, const std::string& wafer, const CacheKey& state) {
+    return prefix + "/" + wafer + "/" + state.to_hex();
+}
+
+} // namespace
+
+DirectoryObjectStore::DirectoryObjectStore(std::string root) : root_(std::move(root)) {}
+
+std::string DirectoryObjectStore::pathFor(const std::string& key) const {
+    return root_ + "/" + key;
+}
+
+void DirectoryObjectStore::put(const std::string& key, const std::vector<unsigned char>& data) {
+    static std::atomic<unsigned long> serial{0};
+    const std::filesystem::path path = pathFor(key);
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    const std::string temporary = path.string() + ".tmp" + std::to_string(serial++);
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            throw std::runtime_error("Cannot write object " + key + " to " + root_);
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        throw std::runtime_error("Cannot write object " + key + " to " + root_);
+    }
+}
+
+bool DirectoryObjectStore::get(const std::string& key, std::vector<unsigned char>& data) {
+    std::ifstream file(pathFor(key), std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+bool DirectoryObjectStore::contains(const std::string& key) {
+    std::error_code error;
+    return std::filesystem::is_regular_file(pathFor(key), error);
+}
+
+void DirectoryObjectStore::erase(const std::string& key) {
+    std::error_code error;
+    std::filesystem::remove(pathFor(key), error);
+}
+
+LocalExecutionNode::LocalExecutionNode(std::string name, int slots, FlowRunner runner)
+    : name_(std::move(name)), slots_(std::max(1, slots)), runner_(std::move(runner)) {}
+
+bool LocalExecutionNode::holds(const std::string& wafer, const CacheKey& state) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = held_.find(wafer);
+    return it != held_.end() && it->second.hash == state;
+}
+
+void LocalExecutionNode::release(const std::string& wafer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    held_.erase(wafer);
+}
+
+void LocalExecutionNode::run(const ShardTask& task, ObjectStore& store, const CancellationToken& stop,
+                             const ChainDone& done) {
+    for (size_t c = 0; c < task.chains.size(); ++c) {
+        const ShardChain& chain = task.chains[c];
+        if (stop.stopRequested()) {
+            return;
+        }
+        std::vector<unsigned char> state;
+        if (chain.input_key.empty()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = held_.find(chain.wafer);
+            if (it == held_.end() || it->second.hash != chain.input) {
+                throw std::runtime_error(name_ + " no longer holds wafer " + chain.wafer);
+            }
+            state = it->second.state;
+        } else if (!store.get(chain.input_key, state)) {
+            throw std::runtime_error(name_ + " found no object " + chain.input_key);
+        }
+
+        ChainOutcome outcome;
+        for (const std::string& flow : chain.flows) {
+            outcome.success.push_back(runner_(flow, state, stop));
+            if (stop.stopRequested()) {
+                return; // A partial state is not a result
+            }
+        }
+        outcome.output = stateHash(state);
+        outcome.output_key = stateKey(task.output_prefix, chain.wafer, outcome.output);
+        if (!store.contains(outcome.output_key)) {
+            store.put(outcome.output_key, state);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            held_[chain.wafer] = Held{outcome.output, std::move(state)};
+        }
+        done(c, outcome);
+    }
+}
+
+// The state of one run(), shared with its attempt threads, which may
+// outlive it when superseded
+struct DistributedBatchExecutor::Run {
+    using Clock = std::chrono::steady_clock;
+
+    struct Chain {
+        std::string wafer;
+        std::vector<size_t> items;
+        double cost = 0.0;
+        CacheKey input;
+        int preferred = -1;   // Node holding the input
+        bool uploaded = false;
+        bool claimed = false; // An attempt is delivering it
+        bool committed = false;
+        int node = -1;        // That delivered it
+        CacheKey output;
+        std::string output_key;
+    };
+    struct Attempt {
+        int node;
+        int number;
+        Clock::time_point started;
+        CancellationSource stop;
+        bool ended = false;
+    };
+    struct Shard {
+        std::vector<size_t> chains;
+        double cost = 0.0;
+        int preferred = -1;
+        size_t remaining = 0; // Chains not committed
+        std::vector<std::shared_ptr<Attempt>> attempts;
+        int running = 0;
+        bool pending = true;
+    };
+    struct Worker {
+        std::thread thread;
+        bool ended = false;
+    };
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::mutex sink_mutex;
+    Clock::time_point start = Clock::now();
+    std::vector<Chain> chains;
+    std::vector<Shard> shards;
+    std::vector<ItemResult> results;
+    std::vector<int> busy; // Running attempts per node
+    std::vector<double> rates; // Seconds per cost unit of finished shards
+    size_t committed = 0;
+    int max_attempts = 1;
+    bool cancelled = false;
+    bool finished = false;
+    std::vector<Worker> workers;
+    std::vector<std::string> uploads; // Objects the coordinator wrote
+
+    // Set for the duration of run()
+    const WaferStates* states = nullptr;
+    const ResultSink* sink = nullptr;
+
+    double elapsed() const { return std::chrono::duration<double>(Clock::now() - start).count(); }
+
+    // Under mutex: fails every chain of the shard no attempt is delivering
+    void failShard(Shard& shard, const std::string& error) {
+        for (size_t c : shard.chains) {
+            Chain& chain = chains[c];
+            if (chain.committed || chain.claimed) {
+                continue;
+            }
+            chain.committed = true;
+            ++committed;
+            --shard.remaining;
+            for (size_t item : chain.items) {
+                results[item].error = error;
+                results[item].seconds = elapsed();
+                if (*sink) {
+                    std::lock_guard<std::mutex> sink_lock(sink_mutex);
+                    (*sink)(results[item]);
+                }
+            }
+        }
+        shard.pending = false;
+        changed.notify_all();
+    }
+};
+
+DistributedBatchExecutor::DistributedBatchExecutor(std::shared_ptr<ObjectStore> store)
+    : DistributedBatchExecutor(std::move(store), Options()) {}
+
+DistributedBatchExecutor::DistributedBatchExecutor(std::shared_ptr<ObjectStore> store, const Options& options)
+    : store_(std::move(store)), options_(options) {}
+
+DistributedBatchExecutor::~DistributedBatchExecutor() {
+    reapRuns(true);
+}
+
+void DistributedBatchExecutor::addNode(std::shared_ptr<ExecutionNode> node) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_.push_back(std::move(node));
+}
+
+size_t DistributedBatchExecutor::nodeCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nodes_.size();
+}
+
+void DistributedBatchExecutor::reapRuns(bool wait) {
+    for (auto run = lingering_.begin(); run != lingering_.end();) {
+        bool all_ended = true;
+        for (auto& worker : (*run)->workers) {
+            bool ended = false;
+            {
+                std::lock_guard<std::mutex> lock((*run)->mutex);
+                ended = worker.ended;
+            }
+            if ((ended || wait) && worker.thread.joinable()) {
+                worker.thread.join();
+            }
+            all_ended = all_ended && !worker.thread.joinable();
+        }
+        run = all_ended ? lingering_.erase(run) : run + 1;
+    }
+}
+
+std::vector<DistributedBatchExecutor::ItemResult> DistributedBatchExecutor::run(
+    const std::vector<Item>& items, const WaferStates& states, const ResultSink& sink, const CancellationToken& stop) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    reapRuns(false);
+    std::vector<std::shared_ptr<ExecutionNode>> nodes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nodes = nodes_;
+    }
+    if (nodes.empty()) {
+        throw std::runtime_error("Distributed batch has no execution nodes");
+    }
+
+    auto run = std::make_shared<Run>();
+    run->states = &states;
+    run->sink = &sink;
+    run->results.resize(items.size());
+    run->busy.assign(nodes.size(), 0);
+    run->max_attempts = std::max(1, options_.max_attempts);
+    for (size_t i = 0; i < items.size(); ++i) {
+        run->results[i].index = i;
+    }
+
+    // Chains in order of each wafer's first item; their starting states
+    // go to the store now unless a node already holds them
+    std::unordered_map<std::string, size_t> chain_of;
+    for (size_t i = 0; i < items.size(); ++i) {
+        auto inserted = chain_of.emplace(items[i].wafer, run->chains.size());
+        if (inserted.second) {
+            run->chains.emplace_back();
+            run->chains.back().wafer = items[i].wafer;
+        }
+        Run::Chain& chain = run->chains[inserted.first->second];
+        chain.items.push_back(i);
+        chain.cost += std::max(0.0, items[i].cost);
+    }
+    for (Run::Chain& chain : run->chains) {
+        std::vector<unsigned char> state = states.capture(chain.wafer);
+        chain.input = stateHash(state);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto holder = holders_.find(chain.wafer);
+            if (holder != holders_.end() && holder->second.second == chain.input &&
+                nodes[holder->second.first]->holds(chain.wafer, chain.input)) {
+                chain.preferred = static_cast<int>(holder->second.first);
+            }
+        }
+        if (chain.preferred < 0) {
+            const std::string key = stateKey(options_.prefix, chain.wafer, chain.input);
+            if (!store_->contains(key)) {
+                store_->put(key, state);
+                run->uploads.push_back(key);
+            }
+            chain.uploaded = true;
+        }
+    }
+
+    // Shards: chains with the same preferred node, largest first, packed
+    // up to the target cost; a chain above it makes a shard on its own
+    double total_cost = 0.0;
+    int total_slots = 0;
+    for (const auto& chain : run->chains) {
+        total_cost += chain.cost;
+    }
+    if (total_cost <= 0.0) {
+        for (auto& chain : run->chains) { // No estimates: count items
+            chain.cost = static_cast<double>(chain.items.size());
+            total_cost += chain.cost;
+        }
+    }
+    for (const auto& node : nodes) {
+        total_slots += std::max(1, node->slots());
+    }
+    const double target = total_cost / (total_slots * std::max(1.0, options_.shards_per_slot));
+    std::vector<size_t> order(run->chains.size());
+    for (size_t c = 0; c < order.size(); ++c) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const Run::Chain& x = run->chains[a];
+        const Run::Chain& y = run->chains[b];
+        return x.preferred != y.preferred ? x.preferred < y.preferred : x.cost > y.cost;
+    });
+    for (size_t c : order) {
+        const Run::Chain& chain = run->chains[c];
+        if (run->shards.empty() || run->shards.back().preferred != chain.preferred ||
+            (run->shards.back().cost > 0.0 && run->shards.back().cost + chain.cost > target)) {
+            run->shards.emplace_back();
+            run->shards.back().preferred = chain.preferred;
+        }
+        Run::Shard& shard = run->shards.back();
+        shard.chains.push_back(c);
+        shard.cost += chain.cost;
+        ++shard.remaining;
+    }
+    std::vector<size_t> dispatch_order(run->shards.size());
+    for (size_t s = 0; s < dispatch_order.size(); ++s) {
+        dispatch_order[s] = s;
+    }
+    std::stable_sort(dispatch_order.begin(), dispatch_order.end(),
+                     [&](size_t a, size_t b) { return run->shards[a].cost > run->shards[b].cost; });
+
+    std::shared_ptr<ObjectStore> store = store_;
+    const std::string prefix = options_.prefix;
+    const int max_attempts = run->max_attempts;
+
+    // Under run->mutex: a chain an attempt finished
+    auto deliver = [run, store](size_t shard_index, std::shared_ptr<Run::Attempt> attempt, const std::string& node_name,
+                                size_t c, const ChainOutcome& outcome) {
+        std::unique_lock<std::mutex> lock(run->mutex);
+        Run::Chain& chain = run->chains[c];
+        if (run->finished || chain.claimed || chain.committed) {
+            return;
+        }
+        chain.claimed = true;
+        lock.unlock();
+
+        std::vector<unsigned char> state;
+        std::string error;
+        bool ok = store->get(outcome.output_key, state);
+        if (!ok) {
+            error = "no object " + outcome.output_key;
+        } else {
+            try {
+                run->states->restore(chain.wafer, std::move(state));
+            } catch (const std::exception& e) {
+                ok = false;
+                error = e.what();
+            }
+        }
+        if (ok) {
+            std::lock_guard<std::mutex> sink_lock(run->sink_mutex);
+            for (size_t k = 0; k < chain.items.size(); ++k) {
+                ItemResult& result = run->results[chain.items[k]];
+                result.success = k < outcome.success.size() && outcome.success[k];
+                result.node = node_name;
+                result.attempt = attempt->number;
+                result.seconds = run->elapsed();
+                if (!result.success) {
+                    result.error = "flow failed";
+                }
+                if (*run->sink) {
+                    (*run->sink)(result);
+                }
+            }
+        }
+
+        lock.lock();
+        if (!ok) {
+            Logger::getInstance().log("Distributed batch: " + chain.wafer + " from " + node_name + ": " + error);
+            chain.claimed = false;
+            return;
+        }
+        Run::Shard& shard = run->shards[shard_index];
+        chain.committed = true;
+        chain.node = attempt->node;
+        chain.output = outcome.output;
+        chain.output_key = outcome.output_key;
+        ++run->committed;
+        if (--shard.remaining == 0) {
+            const double seconds = std::chrono::duration<double>(Run::Clock::now() - attempt->started).count();
+            if (shard.cost > 0.0) {
+                run->rates.push_back(seconds / shard.cost);
+            }
+            for (auto& other : shard.attempts) {
+                other->stop.requestStop();
+            }
+        }
+        run->changed.notify_all();
+    };
+
+    // Under run->mutex
+    auto launch = [&](size_t shard_index, int node) {
+        Run::Shard& shard = run->shards[shard_index];
+        auto attempt = std::make_shared<Run::Attempt>();
+        attempt->node = node;
+        attempt->number = static_cast<int>(shard.attempts.size()) + 1;
+        attempt->started = Run::Clock::now();
+        shard.attempts.push_back(attempt);
+        shard.pending = false;
+        ++shard.running;
+        ++run->busy[node];
+
+        ShardTask task;
+        task.shard = shard_index;
+        task.attempt = attempt->number;
+        task.output_prefix = prefix;
+        std::vector<size_t> chain_ids;
+        for (size_t c : shard.chains) {
+            Run::Chain& chain = run->chains[c];
+            if (chain.committed) {
+                continue;
+            }
+            ShardChain work;
+            work.wafer = chain.wafer;
+            work.input = chain.input;
+            if (chain.preferred != node || !nodes[node]->holds(chain.wafer, chain.input)) {
+                work.input_key = stateKey(prefix, chain.wafer, chain.input);
+                if (!chain.uploaded) {
+                    if (!store->contains(work.input_key)) {
+                        store->put(work.input_key, states.capture(chain.wafer));
+                        run->uploads.push_back(work.input_key);
+                    }
+                    chain.uploaded = true;
+                }
+            }
+            for (size_t item : chain.items) {
+                work.flows.push_back(items[item].flow);
+            }
+            task.chains.push_back(std::move(work));
+            chain_ids.push_back(c);
+        }
+
+        const size_t worker = run->workers.size();
+        run->workers.emplace_back();
+        std::shared_ptr<ExecutionNode> executor = nodes[node];
+        run->workers[worker].thread = std::thread([run, store, executor, attempt, shard_index, worker, deliver,
+                                                   task = std::move(task), chain_ids = std::move(chain_ids)] {
+            std::string error;
+            try {
+                executor->run(task, *store, attempt->stop.token(), [&](size_t c, const ChainOutcome& outcome) {
+                    deliver(shard_index, attempt, executor->name(), chain_ids.at(c), outcome);
+                });
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+
+            std::lock_guard<std::mutex> lock(run->mutex);
+            attempt->ended = true;
+            --run->busy[attempt->node];
+            Run::Shard& shard = run->shards[shard_index];
+            --shard.running;
+            if (!error.empty()) {
+                Logger::getInstance().log("Distributed batch: shard " + std::to_string(shard_index) + " failed on " +
+                                          executor->name() + ": " + error);
+            }
+            if (!run->finished && shard.remaining > 0 && shard.running == 0) {
+                if (run->cancelled) {
+                    run->failShard(shard, "cancelled");
+                } else if (static_cast<int>(shard.attempts.size()) < run->max_attempts) {
+                    shard.pending = true; // Another node may pick it up
+                    shard.preferred = -1;
+                } else {
+                    run->failShard(shard, error.empty() ? "shard did not finish" : error);
+                }
+            }
+            run->workers[worker].ended = true;
+            run->changed.notify_all();
+        });
+    };
+
+    std::unique_lock<std::mutex> lock(run->mutex);
+    while (run->committed < run->chains.size()) {
+        if (stop.stopRequested() && !run->cancelled) {
+            run->cancelled = true;
+            for (auto& shard : run->shards) {
+                for (auto& attempt : shard.attempts) {
+                    attempt->stop.requestStop();
+                }
+                if (shard.running == 0) {
+                    run->failShard(shard, "cancelled");
+                }
+            }
+            continue;
+        }
+
+        // Seconds per cost unit: the median over the shards finished so far
+        double rate = 0.0;
+        if (!run->rates.empty()) {
+            std::vector<double> rates = run->rates;
+            std::nth_element(rates.begin(), rates.begin() + rates.size() / 2, rates.end());
+            rate = rates[rates.size() / 2];
+        }
+        auto expectedSeconds = [&](const Run::Shard& shard) { return std::max(1e-3, shard.cost * rate); };
+
+        // Pending shards: a node takes those whose wafers it holds first,
+        // then those nobody holds, and those that have waited for their
+        // busy node longer than locality_wait times their expected time
+        const auto now = Run::Clock::now();
+        for (int pass = 0; pass < 2 && !run->cancelled; ++pass) {
+            for (size_t n = 0; n < nodes.size(); ++n) {
+                for (size_t s : dispatch_order) {
+                    if (run->busy[n] >= std::max(1, nodes[n]->slots())) {
+                        break;
+                    }
+                    Run::Shard& shard = run->shards[s];
+                    if (!shard.pending || shard.remaining == 0) {
+                        continue;
+                    }
+                    const bool eligible =
+                        pass == 0 ? shard.preferred == static_cast<int>(n)
+                                  : shard.preferred < 0 ||
+                                        (rate > 0.0 && std::chrono::duration<double>(now - run->start).count() >
+                                                           options_.locality_wait * expectedSeconds(shard));
+                    if (eligible) {
+                        launch(s, static_cast<int>(n));
+                    }
+                }
+            }
+        }
+
+        // A slot left with nothing to take backs up the worst straggler
+        if (!run->cancelled && rate > 0.0) {
+            for (size_t n = 0; n < nodes.size(); ++n) {
+                if (run->busy[n] >= std::max(1, nodes[n]->slots())) {
+                    continue;
+                }
+                double worst = 0.0;
+                size_t straggler = run->shards.size();
+                for (size_t s = 0; s < run->shards.size(); ++s) {
+                    const Run::Shard& shard = run->shards[s];
+                    if (shard.remaining == 0 || shard.running != 1 ||
+                        static_cast<int>(shard.attempts.size()) >= max_attempts) {
+                        continue;
+                    }
+                    const Run::Attempt* current = nullptr;
+                    for (const auto& attempt : shard.attempts) {
+                        if (!attempt->ended) {
+                            current = attempt.get();
+                        }
+                    }
+                    if (!current || current->node == static_cast<int>(n)) {
+                        continue;
+                    }
+                    const double behind =
+                        std::chrono::duration<double>(now - current->started).count() / expectedSeconds(shard);
+                    if (behind >= options_.speculation_factor && behind > worst) {
+                        worst = behind;
+                        straggler = s;
+                    }
+                }
+                if (straggler < run->shards.size()) {
+                    launch(straggler, static_cast<int>(n));
+                }
+            }
+        }
+
+        if (run->committed < run->chains.size()) {
+            run->changed.wait_for(lock, kSpeculationPoll);
+        }
+    }
+    run->finished = true;
+    for (auto& shard : run->shards) {
+        for (auto& attempt : shard.attempts) {
+            attempt->stop.requestStop();
+        }
+    }
+    std::vector<ItemResult> results = run->results;
+    std::vector<Run::Chain> chains = run->chains;
+    lock.unlock();
+
+    // Nodes keep what they computed; the store only has to hold states
+    // while they are in flight
+    {
+        std::lock_guard<std::mutex> holders_lock(mutex_);
+        for (const Run::Chain& chain : chains) {
+            if (chain.node < 0) {
+                continue;
+            }
+            auto holder = holders_.find(chain.wafer);
+            if (holder != holders_.end() && holder->second.first != static_cast<size_t>(chain.node)) {
+                nodes[holder->second.first]->release(chain.wafer);
+            }
+            holders_[chain.wafer] = {static_cast<size_t>(chain.node), chain.output};
+            store_->erase(chain.output_key);
+        }
+    }
+    for (const std::string& key : run->uploads) {
+        store_->erase(key);
+    }
+
+    lingering_.push_back(run);
+    reapRuns(false);
+    return results;
+}
+
+} // namespace SemiPRO
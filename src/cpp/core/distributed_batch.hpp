@@ -0,0 +1,210 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef DISTRIBUTED_BATCH_HPP
+#define DISTRIBUTED_BATCH_HPP
+
+#include "cancellation.hpp"
+#include "performance_utils.hpp"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace SemiPRO {
+
+// Byte objects filed under string keys, shared by the coordinator and
+// every execution node: the stand-in for a bucket. Thread-safe.
+class ObjectStore {
+public:
+    virtual ~ObjectStore() = default;
+    virtual void put(const std::string& key, const std::vector<unsigned char>& data) = 0;
+    // false if there is no such object
+    virtual bool get(const std::string& key, std::vector<unsigned char>& data) = 0;
+    virtual bool contains(const std::string& key) = 0;
+    virtual void erase(const std::string& key) = 0;
+};
+
+// One file per object under a root directory, e.g. a mounted bucket. Keys
+// may contain '/'. Objects are written to a temporary file and renamed
+// into place, so a reader never sees half an object. Throws
+// std::runtime_error if an object cannot be written.
+class DirectoryObjectStore : public ObjectStore {
+public:
+    explicit DirectoryObjectStore(std::string root);
+
+    void put(const std::string& key, const std::vector<unsigned char>& data) override;
+    bool get(const std::string& key, std::vector<unsigned char>& data) override;
+    bool contains(const std::string& key) override;
+    void erase(const std::string& key) override;
+
+private:
+    std::string pathFor(const std::string& key) const;
+
+    std::string root_;
+};
+
+// A wafer's run of batch items, all on one node
+struct ShardChain {
+    std::string wafer;
+    CacheKey input;        // Hash of the wafer state the chain starts from
+    std::string input_key; // Object holding that state; "" when the node holds it
+    std::vector<std::string> flows;
+};
+
+struct ShardTask {
+    size_t shard = 0;
+    int attempt = 0;
+    std::string output_prefix; // Outputs go to "<prefix>/<wafer>/<state hash>"
+    std::vector<ShardChain> chains;
+};
+
+struct ChainOutcome {
+    std::vector<bool> success; // One per flow
+    CacheKey output;
+    std::string output_key;
+};
+
+// A worker that runs shards against its own copies of wafer states. The
+// state a chain leaves is uploaded to the store and also kept by the
+// node, so a later chain on the same wafer can skip the download.
+class ExecutionNode {
+public:
+    using ChainDone = std::function<void(size_t chain, const ChainOutcome& outcome)>;
+
+    virtual ~ExecutionNode() = default;
+    virtual const std::string& name() const = 0;
+    // Shards it runs at once
+    virtual int slots() const = 0;
+    virtual bool holds(const std::string& wafer, const CacheKey& state) const = 0;
+    // Forgets the node's copy of a wafer
+    virtual void release(const std::string& wafer) = 0;
+    // Runs the chains in order, reporting each as it finishes; returns
+    // early once stop is raised. Throws if the node fails.
+    virtual void run(const ShardTask& task, ObjectStore& store, const CancellationToken& stop,
+                     const ChainDone& done) = 0;
+};
+
+// A node in this process. The runner applies one flow to a wafer state
+// image in place and reports whether the flow succeeded.
+class LocalExecutionNode : public ExecutionNode {
+public:
+    using FlowRunner =
+        std::function<bool(const std::string& flow, std::vector<unsigned char>& state, const CancellationToken& stop)>;
+
+    LocalExecutionNode(std::string name, int slots, FlowRunner runner);
+
+    const std::string& name() const override { return name_; }
+    int slots() const override { return slots_; }
+    bool holds(const std::string& wafer, const CacheKey& state) const override;
+    void release(const std::string& wafer) override;
+    void run(const ShardTask& task, ObjectStore& store, const CancellationToken& stop, const ChainDone& done) override;
+
+private:
+    struct Held {
+        CacheKey hash;
+        std::vector<unsigned char> state;
+    };
+
+    std::string name_;
+    int slots_;
+    FlowRunner runner_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Held> held_;
+};
+
+// Runs a batch of (wafer, flow) items on a set of execution nodes.
+//
+// Items of one wafer form a chain that runs in batch order on a single
+// node, so the wafer's state never moves between them. Chains are packed
+// into shards of about total cost / (slots * shards_per_slot), so every
+// node slot gets a few shards and a slow one can be balanced out. A
+// shard goes to a node that already holds the starting state of its
+// wafers; only once it has waited locality_wait times its expected time
+// (see below) for that node may another take it. The starting states of
+// all other shards are uploaded to the object store, and any node may
+// take those. Large shards are dispatched first.
+//
+// Results stream back per chain: the first attempt to finish a chain has
+// its item results passed to the sink and its final wafer state
+// downloaded and restored on the coordinator. A node slot left with
+// nothing to take starts a speculative copy of the running shard
+// furthest behind its expected time (its cost at the median seconds per
+// cost unit of the shards finished so far), provided it has run
+// speculation_factor times that long. A node that fails has its
+// shard retried elsewhere, up to max_attempts attempts per shard.
+//
+// Every node keeps its own copy of the states it computed, and the
+// coordinator remembers which node holds which state: a later batch on
+// the same, unchanged wafers goes back to those nodes without any
+// transfer.
+class DistributedBatchExecutor {
+public:
+    struct Item {
+        std::string wafer;
+        std::string flow;
+        double cost = 1.0; // Any consistent unit, e.g. estimated seconds
+    };
+
+    struct ItemResult {
+        size_t index = 0; // Into the batch
+        bool success = false;
+        std::string node;
+        int attempt = 0;  // Of the shard that delivered it, from 1
+        double seconds = 0.0; // From batch start to delivery
+        std::string error;
+    };
+
+    struct Options {
+        double shards_per_slot = 2.0;
+        double locality_wait = 2.0;
+        double speculation_factor = 2.0;
+        int max_attempts = 3;
+        std::string prefix = "batch"; // Object key prefix
+    };
+
+    // The coordinator's copies of wafer states
+    struct WaferStates {
+        std::function<std::vector<unsigned char>(const std::string& wafer)> capture;
+        std::function<void(const std::string& wafer, std::vector<unsigned char> state)> restore;
+    };
+
+    using ResultSink = std::function<void(const ItemResult&)>;
+
+    explicit DistributedBatchExecutor(std::shared_ptr<ObjectStore> store);
+    DistributedBatchExecutor(std::shared_ptr<ObjectStore> store, const Options& options);
+    // Waits for superseded attempts still running on their nodes
+    ~DistributedBatchExecutor();
+    DistributedBatchExecutor(const DistributedBatchExecutor&) = delete;
+    DistributedBatchExecutor& operator=(const DistributedBatchExecutor&) = delete;
+
+    void addNode(std::shared_ptr<ExecutionNode> node);
+    size_t nodeCount() const;
+
+    // Blocks until every item has a result, in batch order. The sink is
+    // called once per item as results arrive, never concurrently. Raising
+    // stop cancels the running shards; items without a result fail.
+    std::vector<ItemResult> run(const std::vector<Item>& items, const WaferStates& states,
+                                const ResultSink& sink = {}, const CancellationToken& stop = {});
+
+private:
+    struct Run;
+
+    // Joins the attempt threads of earlier runs that have ended
+    void reapRuns(bool wait);
+
+    std::shared_ptr<ObjectStore> store_;
+    Options options_;
+    mutable std::mutex mutex_; // Guards nodes_ and holders_; run() holds run_mutex_
+    std::mutex run_mutex_;
+    std::vector<std::shared_ptr<ExecutionNode>> nodes_;
+    // Wafer -> node holding its coordinator state, and that state's hash
+    std::unordered_map<std::string, std::pair<size_t, CacheKey>> holders_;
+    std::vector<std::shared_ptr<Run>> lingering_; // Runs with attempts left over
+};
+
+} // namespace SemiPRO
+
+#endif // DISTRIBUTED_BATCH_HPP
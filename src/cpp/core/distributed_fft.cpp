@@ -0,0 +1,93 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "distributed_fft.hpp"
+#include <stdexcept>
+
+DistributedFft::DistributedFft(std::shared_ptr<GridCommunicator> comm, int rows, int cols,
+                               std::shared_ptr<FftBackend> backend)
+    : comm_(std::move(comm)), backend_(backend ? std::move(backend) : Fft::defaultBackend()) {
+  if (!comm_) {
+    throw std::invalid_argument("A distributed transform needs a communicator");
+  }
+  row_slabs_ = SlabDecomposition::balanced(rows, comm_->size());
+  column_slabs_ = SlabDecomposition::balanced(cols, comm_->size());
+}
+
+void DistributedFft::transformRuns(Complex* data, int count, int n, bool inverse) const {
+  // A one-row 2D transform is the 1D transform of that row, scaled by 1 / n
+  // when inverse
+#pragma omp parallel for schedule(static)
+  for (int k = 0; k < count; ++k) {
+    backend_->transform(data + static_cast<std::size_t>(k) * n, 1, n, inverse);
+  }
+}
+
+void DistributedFft::transpose(std::vector<Complex>& data, bool to_columns) const {
+  const int me = comm_->rank(), size = comm_->size();
+  const int rows = this->rows(), cols = this->cols();
+  const int my_first_row = row_slabs_.firstRow(me), my_rows = row_slabs_.rowCount(me);
+  const int my_first_col = column_slabs_.firstRow(me), my_cols = column_slabs_.rowCount(me);
+
+  // A block is a peer's rows crossed with another's columns, sent column
+  // by column; a complex number travels as two doubles
+  std::vector<std::vector<double>> send(size), recv;
+  for (int r = 0; r < size; ++r) {
+    const int first_row = to_columns ? my_first_row : row_slabs_.firstRow(r);
+    const int block_rows = to_columns ? my_rows : row_slabs_.rowCount(r);
+    const int first_col = to_columns ? column_slabs_.firstRow(r) : my_first_col;
+    const int block_cols = to_columns ? column_slabs_.rowCount(r) : my_cols;
+    std::vector<double>& block = send[r];
+    block.reserve(2 * static_cast<std::size_t>(block_rows) * block_cols);
+    for (int c = first_col; c < first_col + block_cols; ++c) {
+      for (int i = first_row; i < first_row + block_rows; ++i) {
+        const Complex value = to_columns ? data[static_cast<std::size_t>(i - first_row) * cols + c]
+                                         : data[static_cast<std::size_t>(c - first_col) * rows + i];
+        block.push_back(value.real());
+        block.push_back(value.imag());
+      }
+    }
+  }
+  comm_->allToAll(send, recv);
+
+  data.assign(to_columns ? static_cast<std::size_t>(my_cols) * rows : static_cast<std::size_t>(my_rows) * cols,
+              Complex());
+  for (int r = 0; r < size; ++r) {
+    const int first_row = to_columns ? row_slabs_.firstRow(r) : my_first_row;
+    const int block_rows = to_columns ? row_slabs_.rowCount(r) : my_rows;
+    const int first_col = to_columns ? my_first_col : column_slabs_.firstRow(r);
+    const int block_cols = to_columns ? my_cols : column_slabs_.rowCount(r);
+    if (recv[r].size() != 2 * static_cast<std::size_t>(block_rows) * block_cols) {
+      throw std::runtime_error("Transpose block does not match the decomposition");
+    }
+    const double* in = recv[r].data();
+    for (int c = first_col; c < first_col + block_cols; ++c) {
+      for (int i = first_row; i < first_row + block_rows; ++i, in += 2) {
+        const Complex value(in[0], in[1]);
+        if (to_columns) {
+          data[static_cast<std::size_t>(c - first_col) * rows + i] = value;
+        } else {
+          data[static_cast<std::size_t>(i - first_row) * cols + c] = value;
+        }
+      }
+    }
+  }
+}
+
+void DistributedFft::forward(std::vector<Complex>& data) const {
+  const int me = comm_->rank();
+  if (data.size() != static_cast<std::size_t>(row_slabs_.rowCount(me)) * cols()) {
+    throw std::invalid_argument("Data is not this rank's rows of the transform");
+  }
+  transformRuns(data.data(), row_slabs_.rowCount(me), cols(), false);
+  transpose(data, true);
+  transformRuns(data.data(), column_slabs_.rowCount(me), rows(), false);
+}
+
+void DistributedFft::inverse(std::vector<Complex>& data) const {
+  const int me = comm_->rank();
+  if (data.size() != static_cast<std::size_t>(column_slabs_.rowCount(me)) * rows()) {
+    throw std::invalid_argument("Data is not this rank's columns of the spectrum");
+  }
+  transformRuns(data.data(), column_slabs_.rowCount(me), rows(), true);
+  transpose(data, false);
+  transformRuns(data.data(), row_slabs_.rowCount(me), cols(), true);
+}
@@ -0,0 +1,51 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef DISTRIBUTED_FFT_HPP
+#define DISTRIBUTED_FFT_HPP
+
+#include "fft.hpp"
+#include "grid_comm.hpp"
+#include <memory>
+#include <vector>
+
+// Complex 2D transforms of a rows x cols grid split by rows across the
+// ranks of a communicator, for grids whose spectrum does not fit on one
+// node. Each rank transforms its rows, one all-to-all exchange transposes
+// the grid so every rank holds whole columns, and the columns are
+// transformed there. The spectrum is left in that transposed layout:
+// elementwise products of two spectra, as in a convolution, need no
+// further exchange, and inverse() undoes the layout along with the
+// transform. Both sizes must be ones the backend transforms.
+class DistributedFft {
+public:
+  using Complex = FftBackend::Complex;
+
+  // Fft::defaultBackend() without a backend
+  DistributedFft(std::shared_ptr<GridCommunicator> comm, int rows, int cols,
+                 std::shared_ptr<FftBackend> backend = nullptr);
+
+  int rows() const { return row_slabs_.rows; }
+  int cols() const { return column_slabs_.rows; }
+  // Rows of the grid, and columns of the spectrum, per rank
+  const SlabDecomposition& rowSlabs() const { return row_slabs_; }
+  const SlabDecomposition& columnSlabs() const { return column_slabs_; }
+
+  // Collective. data holds this rank's rows, row-major; it is replaced by
+  // this rank's columns of the spectrum, column c of them at
+  // data[(c - first column) * rows + row].
+  void forward(std::vector<Complex>& data) const;
+  // Collective. The reverse, scaled by 1 / (rows cols).
+  void inverse(std::vector<Complex>& data) const;
+
+private:
+  // Transforms count contiguous sequences of n points each
+  void transformRuns(Complex* data, int count, int n, bool inverse) const;
+  // Between this rank's rows and its columns, each held contiguously
+  void transpose(std::vector<Complex>& data, bool to_columns) const;
+
+  std::shared_ptr<GridCommunicator> comm_;
+  std::shared_ptr<FftBackend> backend_;
+  SlabDecomposition row_slabs_;
+  SlabDecomposition column_slabs_;
+};
+
+#endif // DISTRIBUTED_FFT_HPP
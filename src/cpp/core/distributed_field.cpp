@@ -0,0 +1,84 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "distributed_field.hpp"
+#include <stdexcept>
+#include <vector>
+
+DistributedField::DistributedField(std::shared_ptr<GridCommunicator> comm, int global_rows, int global_cols,
+                                   int tile_size, int halo)
+    : comm_(std::move(comm)) {
+    if (!comm_) {
+        throw std::invalid_argument("A distributed field needs a communicator");
+    }
+    slabs_ = SlabDecomposition::balanced(global_rows, comm_->size());
+    if (comm_->size() > 1 && slabs_.rowCount(comm_->size() - 1) < halo) {
+        throw std::invalid_argument("Every slab of a distributed field must hold at least the halo's rows");
+    }
+    grid_ = TiledGrid(slabs_.rowCount(comm_->rank()), global_cols, tile_size, halo);
+}
+
+void DistributedField::loadLocal(const Eigen::Ref<const Eigen::ArrayXXd>& slab) {
+    grid_.load(slab);
+}
+
+void DistributedField::storeLocal(Eigen::Ref<Eigen::ArrayXXd> slab) const {
+    grid_.store(slab);
+}
+
+void DistributedField::scatter(const Eigen::ArrayXXd& global, int root) {
+    const int size = comm_->size();
+    std::vector<std::vector<double>> send(size), recv;
+    if (comm_->rank() == root) {
+        if (global.rows() != globalRows() || global.cols() != globalCols()) {
+            throw std::invalid_argument("Field shape does not match the distributed field");
+        }
+        for (int r = 0; r < size; ++r) {
+            Eigen::ArrayXXd slab = global.middleRows(slabs_.firstRow(r), slabs_.rowCount(r));
+            send[r].assign(slab.data(), slab.data() + slab.size());
+        }
+    }
+    comm_->allToAll(send, recv);
+    grid_.load(Eigen::Map<const Eigen::ArrayXXd>(recv[root].data(), localRows(), globalCols()));
+}
+
+Eigen::ArrayXXd DistributedField::gather(int root) const {
+    Eigen::ArrayXXd slab(localRows(), globalCols());
+    grid_.store(slab);
+    std::vector<std::vector<double>> send(comm_->size()), recv;
+    send[root].assign(slab.data(), slab.data() + slab.size());
+    comm_->allToAll(send, recv);
+    if (comm_->rank() != root) {
+        return Eigen::ArrayXXd();
+    }
+    Eigen::ArrayXXd global(globalRows(), globalCols());
+    for (int r = 0; r < comm_->size(); ++r) {
+        global.middleRows(slabs_.firstRow(r), slabs_.rowCount(r)) =
+            Eigen::Map<const Eigen::ArrayXXd>(recv[r].data(), slabs_.rowCount(r), globalCols());
+    }
+    return global;
+}
+
+void DistributedField::exchangeHalos() {
+    grid_.exchangeHalos();
+    const int halo = grid_.halo();
+    const int rank = comm_->rank();
+    if (halo == 0 || comm_->size() == 1) {
+        return;
+    }
+    const int above = rank > 0 ? rank - 1 : GridCommunicator::kNoRank;
+    const int below = rank + 1 < comm_->size() ? rank + 1 : GridCommunicator::kNoRank;
+    const std::size_t count = static_cast<std::size_t>(halo) * globalCols();
+    std::vector<double> edge(count), ghost(count);
+
+    // Bottom rows down, then top rows up; each pairs with the matching
+    // send of the neighbour
+    grid_.copyInteriorRows(localRows() - halo, halo, edge.data());
+    comm_->sendRecv(below, edge.data(), count, above, ghost.data(), count);
+    if (above != GridCommunicator::kNoRank) {
+        grid_.fillGhostRows(true, ghost.data());
+    }
+    grid_.copyInteriorRows(0, halo, edge.data());
+    comm_->sendRecv(above, edge.data(), count, below, ghost.data(), count);
+    if (below != GridCommunicator::kNoRank) {
+        grid_.fillGhostRows(false, ghost.data());
+    }
+}
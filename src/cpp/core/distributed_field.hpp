@@ -0,0 +1,67 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef DISTRIBUTED_FIELD_HPP
+#define DISTRIBUTED_FIELD_HPP
+
+#include "grid_comm.hpp"
+#include "tiled_grid.hpp"
+#include <Eigen/Dense>
+#include <memory>
+#include <utility>
+
+// A 2D field too large for one node, split by rows across the ranks of a
+// communicator. Each rank keeps its slab as a TiledGrid, so the stencil
+// work inside a slab is the same tiled, threaded sweep as on one node;
+// only the ghost rows along the slab edges come from the neighbouring
+// ranks. Ghost cells past the global field edge replicate it (zero-flux),
+// as in TiledGrid. Every slab must hold at least `halo` rows.
+//
+// The members marked collective must be called by every rank in the same
+// order.
+class DistributedField {
+public:
+    // Collective only in that all ranks must agree on the arguments. Throws
+    // std::invalid_argument for a slab thinner than the halo.
+    DistributedField(std::shared_ptr<GridCommunicator> comm, int global_rows, int global_cols, int tile_size = 64,
+                     int halo = 1);
+
+    GridCommunicator& communicator() const { return *comm_; }
+    const SlabDecomposition& decomposition() const { return slabs_; }
+    int globalRows() const { return slabs_.rows; }
+    int globalCols() const { return grid_.cols(); }
+    int firstRow() const { return slabs_.firstRow(comm_->rank()); }
+    int localRows() const { return grid_.rows(); }
+    // This rank's slab; tile origins are local to it, add firstRow() for
+    // global rows
+    TiledGrid& grid() { return grid_; }
+
+    // This rank's localRows() x globalCols() rows
+    void loadLocal(const Eigen::Ref<const Eigen::ArrayXXd>& slab);
+    void storeLocal(Eigen::Ref<Eigen::ArrayXXd> slab) const;
+
+    // Collective: root's global field to every rank's slab, and back. The
+    // other ranks pass an empty array and gather() returns them one.
+    void scatter(const Eigen::ArrayXXd& global, int root = 0);
+    Eigen::ArrayXXd gather(int root = 0) const;
+
+    // Collective: refreshes the ghost cells inside the slab, then the ghost
+    // rows along its edges from the neighbouring ranks
+    void exchangeHalos();
+
+    // Collective: TiledGrid::applyStencil with halos exchanged across ranks
+    template <typename Kernel>
+    void applyStencil(int steps, Kernel&& kernel) {
+        grid_.applyStencil(steps, std::forward<Kernel>(kernel), [this] { exchangeHalos(); });
+    }
+
+    template <typename Fn>
+    void forEachTile(Fn&& fn) {
+        grid_.forEachTile(std::forward<Fn>(fn));
+    }
+
+private:
+    std::shared_ptr<GridCommunicator> comm_;
+    SlabDecomposition slabs_;
+    TiledGrid grid_;
+};
+
+#endif // DISTRIBUTED_FIELD_HPP
@@ -0,0 +1,187 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "distributed_multigrid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+DistributedMultigridSolver::DistributedMultigridSolver(std::shared_ptr<GridCommunicator> comm,
+                                                       const Eigen::ArrayXXd& conductivity, int global_rows)
+    : comm_(std::move(comm)) {
+  build(conductivity, nullptr, global_rows);
+}
+
+DistributedMultigridSolver::DistributedMultigridSolver(std::shared_ptr<GridCommunicator> comm,
+                                                       const Eigen::ArrayXXd& conductivity,
+                                                       const Eigen::ArrayXXd& capacity, int global_rows)
+    : comm_(std::move(comm)), has_capacity_(true) {
+  if (capacity.rows() != conductivity.rows() || capacity.cols() != conductivity.cols()) {
+    throw std::invalid_argument("DistributedMultigridSolver: capacity does not match the conductivity");
+  }
+  if (!(capacity >= 0.0).all() || !capacity.allFinite()) {
+    throw std::invalid_argument("DistributedMultigridSolver: capacity must be non-negative and finite");
+  }
+  build(conductivity, &capacity, global_rows);
+}
+
+void DistributedMultigridSolver::build(const Eigen::ArrayXXd& conductivity, const Eigen::ArrayXXd* capacity,
+                                       int global_rows) {
+  if (!comm_) {
+    throw std::invalid_argument("DistributedMultigridSolver: no communicator");
+  }
+  const int rank = comm_->rank(), size = comm_->size();
+  slabs_ = SlabDecomposition::balanced(global_rows, size);
+  if (slabs_.rowCount(size - 1) < 2) {
+    throw std::invalid_argument("DistributedMultigridSolver: every rank needs at least two rows");
+  }
+  rows_ = slabs_.rowCount(rank);
+  cols_ = conductivity.cols();
+  if (conductivity.rows() != rows_) {
+    throw std::invalid_argument("DistributedMultigridSolver: conductivity is not this rank's slab");
+  }
+  if (!(conductivity > 0.0).all() || !conductivity.allFinite()) {
+    throw std::invalid_argument("DistributedMultigridSolver: conductivity must be positive and finite");
+  }
+  top_ = rank > 0 ? 1 : 0;
+  extended_rows_ = rows_ + top_ + (rank + 1 < size ? 1 : 0);
+  const Eigen::Index first = slabs_.firstRow(rank);
+  first_interior_ = std::max<Eigen::Index>(1 - first, 0);
+  last_interior_ = std::min<Eigen::Index>(global_rows - 2 - first, rows_ - 1);
+
+  const Eigen::ArrayXXd k = extend(conductivity);
+  const auto harmonic = [](double a, double b) { return 2.0 * a * b / (a + b); };
+  west_.setZero(extended_rows_, cols_);
+  north_.setZero(extended_rows_, cols_);
+  for (Eigen::Index j = 0; j < cols_; ++j) {
+    for (Eigen::Index e = 0; e < extended_rows_; ++e) {
+      if (j > 0) {
+        west_(e, j) = harmonic(k(e, j - 1), k(e, j));
+      }
+      if (e > 0) {
+        north_(e, j) = harmonic(k(e - 1, j), k(e, j));
+      }
+    }
+  }
+  if (capacity) {
+    capacity_ = extend(*capacity);
+    block_ = std::make_unique<MultigridSolver>(k, capacity_);
+  } else {
+    block_ = std::make_unique<MultigridSolver>(k);
+  }
+}
+
+Eigen::ArrayXXd DistributedMultigridSolver::extend(const Eigen::ArrayXXd& local) const {
+  const int rank = comm_->rank();
+  const int above = rank > 0 ? rank - 1 : GridCommunicator::kNoRank;
+  const int below = rank + 1 < comm_->size() ? rank + 1 : GridCommunicator::kNoRank;
+  Eigen::ArrayXXd extended(extended_rows_, cols_);
+  extended.middleRows(top_, rows_) = local;
+  const std::size_t n = static_cast<std::size_t>(cols_);
+  std::vector<double> edge(n), ghost(n);
+  // Last row down, then first row up
+  Eigen::Map<Eigen::ArrayXd>(edge.data(), cols_) = local.row(rows_ - 1).transpose();
+  comm_->sendRecv(below, edge.data(), n, above, ghost.data(), n);
+  if (above != GridCommunicator::kNoRank) {
+    extended.row(0) = Eigen::Map<const Eigen::ArrayXd>(ghost.data(), cols_).transpose();
+  }
+  Eigen::Map<Eigen::ArrayXd>(edge.data(), cols_) = local.row(0).transpose();
+  comm_->sendRecv(above, edge.data(), n, below, ghost.data(), n);
+  if (below != GridCommunicator::kNoRank) {
+    extended.row(extended_rows_ - 1) = Eigen::Map<const Eigen::ArrayXd>(ghost.data(), cols_).transpose();
+  }
+  return extended;
+}
+
+void DistributedMultigridSolver::apply(const Eigen::ArrayXXd& x, double capacity_scale, Eigen::ArrayXXd& y) const {
+  y.setZero(rows_, cols_);
+  const bool capacity = has_capacity_ && capacity_scale != 0.0;
+  #pragma omp parallel for
+  for (Eigen::Index j = 1; j < cols_ - 1; ++j) {
+    for (Eigen::Index i = first_interior_; i <= last_interior_; ++i) {
+      const Eigen::Index e = i + top_;
+      const double centre = x(e, j);
+      double value = west_(e, j) * (centre - x(e, j - 1)) + west_(e, j + 1) * (centre - x(e, j + 1)) +
+                     north_(e, j) * (centre - x(e - 1, j)) + north_(e + 1, j) * (centre - x(e + 1, j));
+      if (capacity) {
+        value += capacity_scale * capacity_(e, j) * centre;
+      }
+      y(i, j) = value;
+    }
+  }
+}
+
+double DistributedMultigridSolver::dot(const Eigen::ArrayXXd& a, const Eigen::ArrayXXd& b) const {
+  double sum = 0.0;
+  if (last_interior_ >= first_interior_ && cols_ > 2) {
+    const Eigen::Index m = last_interior_ - first_interior_ + 1;
+    sum = (a.block(first_interior_, 1, m, cols_ - 2) * b.block(first_interior_, 1, m, cols_ - 2)).sum();
+  }
+  return comm_->allReduce(sum, GridCommunicator::Reduce::SUM);
+}
+
+void DistributedMultigridSolver::solve(Eigen::ArrayXXd& u, const Eigen::ArrayXXd& source, const Options& options,
+                                       Statistics* statistics) const {
+  if (u.rows() != rows_ || u.cols() != cols_ || source.rows() != rows_ || source.cols() != cols_) {
+    throw std::invalid_argument("DistributedMultigridSolver: arrays are not this rank's slab");
+  }
+  if (!(options.capacity_scale >= 0.0)) {
+    throw std::invalid_argument("DistributedMultigridSolver: capacity scale must be non-negative");
+  }
+  Statistics local;
+  Statistics& stats = statistics ? *statistics : local;
+  stats = Statistics{};
+  stats.levels = block_->levels();
+  const double s = has_capacity_ ? options.capacity_scale : 0.0;
+  if (cols_ <= 2 || slabs_.rows <= 2) {
+    return; // Every point is on the ring
+  }
+  const Eigen::Index m = std::max<Eigen::Index>(last_interior_ - first_interior_ + 1, 0);
+  const auto interior = [&](Eigen::ArrayXXd& a) { return a.block(first_interior_, 1, m, cols_ - 2); };
+
+  // The tolerance is relative to the residual of a zero interior, as in
+  // the serial solver
+  Eigen::ArrayXXd r, ring = u;
+  interior(ring).setZero();
+  apply(extend(ring), s, r);
+  interior(r) = source.block(first_interior_, 1, m, cols_ - 2) - interior(r);
+  const double scale = std::sqrt(dot(r, r));
+  if (scale == 0.0) {
+    interior(u).setZero();
+    return;
+  }
+  apply(extend(u), s, r);
+  interior(r) = source.block(first_interior_, 1, m, cols_ - 2) - interior(r);
+  stats.residual = std::sqrt(dot(r, r)) / scale;
+  if (stats.residual <= options.tolerance) {
+    return;
+  }
+
+  Eigen::ArrayXXd extended_r = Eigen::ArrayXXd::Zero(extended_rows_, cols_);
+  Eigen::ArrayXXd correction, z, p, q;
+  double rz = 0.0;
+  for (stats.iterations = 1; stats.iterations <= options.max_iterations; ++stats.iterations) {
+    // The neighbours' rows of r stay zero: they are the block's fixed ring
+    extended_r.middleRows(top_, rows_) = r;
+    block_->precondition(extended_r, correction, options.smoothing_steps, s);
+    z = correction.middleRows(top_, rows_);
+    const double rz_new = dot(r, z);
+    if (stats.iterations == 1) {
+      p = z;
+    } else {
+      p = z + (rz_new / rz) * p;
+    }
+    rz = rz_new;
+    apply(extend(p), s, q);
+    const double alpha = rz / dot(p, q);
+    interior(u) += alpha * interior(p);
+    r -= alpha * q;
+    stats.residual = std::sqrt(dot(r, r)) / scale;
+    if (stats.residual <= options.tolerance) {
+      return;
+    }
+  }
+  stats.iterations = options.max_iterations;
+  throw std::runtime_error("DistributedMultigridSolver: tolerance not met in " +
+                           std::to_string(options.max_iterations) + " iterations");
+}
@@ -0,0 +1,66 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "grid_comm.hpp"
+#include "multigrid.hpp"
+#include <Eigen/Dense>
+#include <memory>
+
+// MultigridSolver's problem, s c u - div(k grad u) = f with the outer ring
+// of the global grid fixed, on a grid split by rows across the ranks of a
+// communicator (SlabDecomposition::balanced). Each rank passes and gets
+// back only its own rows.
+//
+// The outer iteration is conjugate gradients over the whole grid: one row
+// exchange with each neighbouring rank per operator application and two
+// reductions per iteration. It is preconditioned block-Jacobi style by a
+// V-cycle of a MultigridSolver on each rank's slab, the neighbours' edge
+// rows held at zero, so the cycles run without communication. The ranks'
+// blocks couple only through CG, which therefore needs more iterations as
+// the rank count grows, but each iteration's work and memory per rank
+// shrink with it. The tolerance has the serial solver's meaning, so the
+// two agree to it.
+class DistributedMultigridSolver {
+public:
+  using Options = MultigridSolver::Options;       // conjugate_gradient and mixed_precision are ignored
+  using Statistics = MultigridSolver::Statistics; // levels is the local hierarchy's
+
+  // conductivity and capacity hold this rank's rows of a global_rows-row
+  // grid. Every rank must hold at least two rows. Throws
+  // std::invalid_argument as MultigridSolver does, or for slabs of the
+  // wrong shape.
+  DistributedMultigridSolver(std::shared_ptr<GridCommunicator> comm, const Eigen::ArrayXXd& conductivity,
+                             int global_rows);
+  DistributedMultigridSolver(std::shared_ptr<GridCommunicator> comm, const Eigen::ArrayXXd& conductivity,
+                             const Eigen::ArrayXXd& capacity, int global_rows);
+
+  // Collective. u and source are this rank's rows; as in
+  // MultigridSolver::solve, u holds the ring's fixed values and the guess.
+  // Throws std::runtime_error, on every rank, when the tolerance is not met.
+  void solve(Eigen::ArrayXXd& u, const Eigen::ArrayXXd& source, const Options& options,
+             Statistics* statistics = nullptr) const;
+
+  const SlabDecomposition& decomposition() const { return slabs_; }
+
+private:
+  void build(const Eigen::ArrayXXd& conductivity, const Eigen::ArrayXXd* capacity, int global_rows);
+  // This rank's rows with the neighbours' edge rows above and below
+  Eigen::ArrayXXd extend(const Eigen::ArrayXXd& local) const;
+  // y = A x on the owned interior points and zero elsewhere
+  void apply(const Eigen::ArrayXXd& extended, double capacity_scale, Eigen::ArrayXXd& y) const;
+  // Over the owned interior points, summed across the ranks
+  double dot(const Eigen::ArrayXXd& a, const Eigen::ArrayXXd& b) const;
+
+  std::shared_ptr<GridCommunicator> comm_;
+  SlabDecomposition slabs_;
+  Eigen::Index rows_ = 0; // Owned rows
+  Eigen::Index cols_ = 0;
+  Eigen::Index top_ = 0;  // Extended row of owned row 0
+  Eigen::Index extended_rows_ = 0;
+  Eigen::Index first_interior_ = 0; // Owned rows off the global ring
+  Eigen::Index last_interior_ = 0;
+  bool has_capacity_ = false;
+  Eigen::ArrayXXd west_;  // Extended (e, j) to (e, j - 1)
+  Eigen::ArrayXXd north_; // Extended (e, j) to (e - 1, j)
+  Eigen::ArrayXXd capacity_;
+  std::unique_ptr<MultigridSolver> block_;
+};
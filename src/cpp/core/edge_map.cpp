@@ -0,0 +1,143 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "edge_map.hpp"
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+
+constexpr double kNone = std::numeric_limits<double>::quiet_NaN();
+
+// Columns are swept in order and each cell links back to its upper and
+// left neighbors, so the square above and left of it has all four sides'
+// crossings once the cell is reached. Only the previous column's vertical
+// crossings are kept to close its squares.
+template <typename At>
+void march(int rows, int cols, At at, double level, std::vector<EdgeSegment>& segments,
+           std::vector<std::vector<EdgeCrossing>>& row_crossings,
+           std::vector<std::vector<EdgeCrossing>>& col_crossings) {
+  // Fraction of the way from value a to b at which the level is crossed
+  auto cross = [level](double a, double b) {
+    return (a > level) == (b > level) ? kNone : (level - a) / (b - a);
+  };
+  // Keeps the inside of a segment on its left, (row, col) taken as (x, y),
+  // from a corner of its square and whether that corner is inside
+  auto add = [&segments](EdgeSegment::Point from, EdgeSegment::Point to, double row, double col, bool inside) {
+    const double side = (to.row - from.row) * (col - from.col) - (to.col - from.col) * (row - from.row);
+    if ((side > 0.0) != inside) {
+      std::swap(from, to);
+    }
+    segments.push_back({from, to});
+  };
+  std::vector<double> horizontal(rows, kNone); // Row i, between columns j - 1 and j
+  std::vector<double> previous(rows, kNone);   // Column j - 1, between rows i and i + 1
+  std::vector<double> current(rows, kNone);    // Column j, between rows i and i + 1
+  for (int j = 0; j < cols; ++j) {
+    for (int i = 0; i < rows; ++i) {
+      const double value = at(i, j);
+      if (i > 0) {
+        const double above = at(i - 1, j);
+        current[i - 1] = cross(above, value);
+        if (!std::isnan(current[i - 1])) {
+          col_crossings[j].push_back({i - 1 + current[i - 1], value > level});
+        }
+      }
+      if (j > 0) {
+        const double left = at(i, j - 1);
+        horizontal[i] = cross(left, value);
+        if (!std::isnan(horizontal[i])) {
+          row_crossings[i].push_back({j - 1 + horizontal[i], value > level});
+        }
+      }
+      if (i == 0 || j == 0) {
+        continue;
+      }
+      // Square with corners (i - 1, j - 1) and (i, j)
+      const double top = horizontal[i - 1], bottom = horizontal[i];
+      const double west = previous[i - 1], east = current[i - 1];
+      const int sides = !std::isnan(top) + !std::isnan(bottom) + !std::isnan(west) + !std::isnan(east);
+      if (sides == 0) {
+        continue;
+      }
+      const EdgeSegment::Point t{i - 1.0, j - 1 + top}, b{static_cast<double>(i), j - 1 + bottom};
+      const EdgeSegment::Point w{i - 1 + west, j - 1.0}, e{i - 1 + east, static_cast<double>(j)};
+      if (sides == 4) {
+        // Saddle: the mean decides whether the top left corner's side joins
+        // the bottom right's through the middle
+        const double corner = at(i - 1, j - 1);
+        const bool inside = corner > level;
+        const double mean = 0.25 * (corner + at(i - 1, j) + at(i, j - 1) + value);
+        if ((mean > level) == inside) {
+          add(t, e, i - 1.0, j, !inside);
+          add(b, w, i, j - 1.0, !inside);
+        } else {
+          add(t, w, i - 1.0, j - 1.0, inside);
+          add(b, e, i, j, inside);
+        }
+        continue;
+      }
+      EdgeSegment::Point ends[2];
+      int n = 0;
+      for (const auto& [side, point] : {std::pair{top, t}, std::pair{bottom, b}, std::pair{west, w},
+                                        std::pair{east, e}}) {
+        if (!std::isnan(side)) {
+          ends[n++] = point;
+        }
+      }
+      // Any corner tells the sides apart; the one farthest from the
+      // segment, as a crossing may sit on a corner
+      double far_row = i, far_col = j, far = -1.0;
+      for (int di = -1; di <= 0; ++di) {
+        for (int dj = -1; dj <= 0; ++dj) {
+          const double side = std::abs((ends[1].row - ends[0].row) * (j + dj - ends[0].col) -
+                                       (ends[1].col - ends[0].col) * (i + di - ends[0].row));
+          if (side > far) {
+            far = side;
+            far_row = i + di;
+            far_col = j + dj;
+          }
+        }
+      }
+      add(ends[0], ends[1], far_row, far_col,
+          at(static_cast<int>(far_row), static_cast<int>(far_col)) > level);
+    }
+    std::swap(previous, current);
+  }
+}
+
+} // namespace
+
+EdgeMap EdgeMap::extract(const Eigen::Ref<const Eigen::ArrayXXd>& field, double level) {
+  EdgeMap map;
+  map.rows_ = static_cast<int>(field.rows());
+  map.cols_ = static_cast<int>(field.cols());
+  map.row_crossings_.resize(map.rows_);
+  map.col_crossings_.resize(map.cols_);
+  march(map.rows_, map.cols_, [&](int i, int j) { return field(i, j); }, level, map.segments_, map.row_crossings_,
+        map.col_crossings_);
+  return map;
+}
+
+EdgeMap EdgeMap::extract(const BitMask& mask) {
+  EdgeMap map;
+  map.rows_ = mask.rows();
+  map.cols_ = mask.cols();
+  map.row_crossings_.resize(map.rows_);
+  map.col_crossings_.resize(map.cols_);
+  march(map.rows_, map.cols_, [&](int i, int j) { return mask.test(i, j) ? 1.0 : 0.0; }, 0.5, map.segments_,
+        map.row_crossings_, map.col_crossings_);
+  return map;
+}
+
+std::vector<EdgeRun> EdgeMap::stretches(const std::vector<std::vector<EdgeCrossing>>& cuts, bool inside) {
+  std::vector<EdgeRun> runs;
+  for (std::size_t cut = 0; cut < cuts.size(); ++cut) {
+    const std::vector<EdgeCrossing>& crossings = cuts[cut];
+    for (std::size_t k = 1; k < crossings.size(); ++k) {
+      if (crossings[k - 1].rising == inside && crossings[k].rising != inside) {
+        runs.push_back({static_cast<int>(cut), crossings[k - 1].position, crossings[k].position});
+      }
+    }
+  }
+  return runs;
+}
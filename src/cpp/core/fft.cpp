@@ -0,0 +1,311 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "fft.hpp"
+#include "gpu_compute.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+using Complex = FftBackend::Complex;
+
+// Transforms below this many points stay on the calling thread
+constexpr long kParallelPoints = 1 << 14;
+
+// a * b without the NaN and inf recovery of std::complex's operator*
+inline Complex multiply(Complex a, Complex b) {
+  return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+}
+
+// Twiddles and bit reversal for one power-of-two length
+class Plan {
+public:
+  explicit Plan(int n) : n_(n), twiddles_(n / 2), reversed_(n) {
+    for (int k = 0; k < n / 2; ++k) {
+      const double angle = -2.0 * M_PI * k / n;
+      twiddles_[k] = {std::cos(angle), std::sin(angle)};
+    }
+    int bits = 0;
+    while ((1 << bits) < n) {
+      ++bits;
+    }
+    for (int i = 0; i < n; ++i) {
+      int r = 0;
+      for (int b = 0; b < bits; ++b) {
+        r |= ((i >> b) & 1) << (bits - 1 - b);
+      }
+      reversed_[i] = r;
+    }
+  }
+
+  // In place and unscaled; the inverse conjugates the twiddles
+  void transform(Complex* data, bool inverse) const {
+    for (int i = 0; i < n_; ++i) {
+      if (i < reversed_[i]) {
+        std::swap(data[i], data[reversed_[i]]);
+      }
+    }
+    for (int length = 2; length <= n_; length <<= 1) {
+      const int half = length / 2;
+      const int step = n_ / length;
+      for (int start = 0; start < n_; start += length) {
+        for (int j = 0; j < half; ++j) {
+          const Complex w = inverse ? std::conj(twiddles_[j * step]) : twiddles_[j * step];
+          const Complex u = data[start + j];
+          const Complex v = multiply(data[start + j + half], w);
+          data[start + j] = u + v;
+          data[start + j + half] = u - v;
+        }
+      }
+    }
+  }
+
+private:
+  int n_;
+  std::vector<Complex> twiddles_;
+  std::vector<int> reversed_;
+};
+
+void checkSize(int rows, int cols) {
+  if (rows <= 0 || cols <= 0 || (rows & (rows - 1)) != 0 || (cols & (cols - 1)) != 0) {
+    throw std::invalid_argument("radix2 FFT sizes must be positive powers of two, got " + std::to_string(rows) +
+                                "x" + std::to_string(cols));
+  }
+}
+
+// The columns of a spectrum, transformed in place through a gathered copy
+void transformColumns(Complex* spectrum, int rows, int columns, bool inverse) {
+  const Plan plan(rows);
+#pragma omp parallel if (static_cast<long>(rows) * columns >= kParallelPoints)
+  {
+    std::vector<Complex> column(rows);
+#pragma omp for schedule(static)
+    for (int c = 0; c < columns; ++c) {
+      for (int r = 0; r < rows; ++r) {
+        column[r] = spectrum[static_cast<size_t>(r) * columns + c];
+      }
+      plan.transform(column.data(), inverse);
+      for (int r = 0; r < rows; ++r) {
+        spectrum[static_cast<size_t>(r) * columns + c] = column[r];
+      }
+    }
+  }
+}
+
+struct Registry {
+  std::mutex mutex;
+  std::map<std::string, Fft::Factory> factories{
+      {"radix2", [] { return std::shared_ptr<FftBackend>(std::make_shared<Radix2Fft>()); }},
+      {"gpu", [] { return std::shared_ptr<FftBackend>(std::make_shared<GpuFft>()); }}};
+  std::shared_ptr<FftBackend> default_backend = std::make_shared<Radix2Fft>();
+};
+
+Registry& registry() {
+  static Registry instance;
+  return instance;
+}
+
+} // namespace
+
+int Radix2Fft::goodSize(int n) const {
+  int size = 1;
+  while (size < n) {
+    size <<= 1;
+  }
+  return size;
+}
+
+void Radix2Fft::forward(const double* image, Complex* spectrum, int rows, int cols) const {
+  checkSize(rows, cols);
+  const int half_cols = cols / 2 + 1;
+  const Plan plan(cols);
+  const int pairs = (rows + 1) / 2;
+
+  // Rows a and b go through one transform of z = a + i b, and the two
+  // spectra separate by the symmetry of a real signal's:
+  // A[k] = (Z[k] + conj Z[-k]) / 2, B[k] = (Z[k] - conj Z[-k]) / 2i
+#pragma omp parallel if (static_cast<long>(rows) * cols >= kParallelPoints)
+  {
+    std::vector<Complex> z(cols);
+#pragma omp for schedule(static)
+    for (int p = 0; p < pairs; ++p) {
+      const int a = 2 * p;
+      const int b = a + 1;
+      const double* row_a = image + static_cast<size_t>(a) * cols;
+      const double* row_b = b < rows ? image + static_cast<size_t>(b) * cols : nullptr;
+      for (int k = 0; k < cols; ++k) {
+        z[k] = {row_a[k], row_b ? row_b[k] : 0.0};
+      }
+      plan.transform(z.data(), false);
+      Complex* out_a = spectrum + static_cast<size_t>(a) * half_cols;
+      Complex* out_b = row_b ? spectrum + static_cast<size_t>(b) * half_cols : nullptr;
+      for (int k = 0; k < half_cols; ++k) {
+        const Complex zk = z[k & (cols - 1)];
+        const Complex zm = std::conj(z[(cols - k) & (cols - 1)]);
+        out_a[k] = 0.5 * (zk + zm);
+        if (out_b) {
+          const Complex d = zk - zm;
+          out_b[k] = {0.5 * d.imag(), -0.5 * d.real()};
+        }
+      }
+    }
+  }
+  transformColumns(spectrum, rows, half_cols, false);
+}
+
+void Radix2Fft::inverse(const Complex* spectrum, double* image, int rows, int cols) const {
+  checkSize(rows, cols);
+  const int half_cols = cols / 2 + 1;
+  std::vector<Complex> work(spectrum, spectrum + static_cast<size_t>(rows) * half_cols);
+  transformColumns(work.data(), rows, half_cols, true);
+
+  const Plan plan(cols);
+  const int pairs = (rows + 1) / 2;
+  const double scale = 1.0 / (static_cast<double>(rows) * cols);
+
+  // The reverse of forward(): z = a + i b over the full row from the two
+  // Hermitian half spectra, whose real and imaginary parts come back as
+  // the rows
+#pragma omp parallel if (static_cast<long>(rows) * cols >= kParallelPoints)
+  {
+    std::vector<Complex> z(cols);
+#pragma omp for schedule(static)
+    for (int p = 0; p < pairs; ++p) {
+      const int a = 2 * p;
+      const int b = a + 1;
+      const Complex* in_a = work.data() + static_cast<size_t>(a) * half_cols;
+      const Complex* in_b = b < rows ? work.data() + static_cast<size_t>(b) * half_cols : nullptr;
+      for (int k = 0; k < cols; ++k) {
+        const bool upper = k >= half_cols;
+        const int source = upper ? cols - k : k;
+        const Complex spectrum_a = upper ? std::conj(in_a[source]) : in_a[source];
+        const Complex spectrum_b = in_b ? (upper ? std::conj(in_b[source]) : in_b[source]) : Complex();
+        z[k] = {spectrum_a.real() - spectrum_b.imag(), spectrum_a.imag() + spectrum_b.real()};
+      }
+      plan.transform(z.data(), true);
+      double* row_a = image + static_cast<size_t>(a) * cols;
+      double* row_b = in_b ? image + static_cast<size_t>(b) * cols : nullptr;
+      for (int k = 0; k < cols; ++k) {
+        row_a[k] = z[k].real() * scale;
+        if (row_b) {
+          row_b[k] = z[k].imag() * scale;
+        }
+      }
+    }
+  }
+}
+
+void Radix2Fft::transform(Complex* data, int rows, int cols, bool inverse) const {
+  checkSize(rows, cols);
+  const Plan plan(cols);
+  const double scale = 1.0 / (static_cast<double>(rows) * cols);
+#pragma omp parallel for schedule(static) if (static_cast<long>(rows) * cols >= kParallelPoints)
+  for (int r = 0; r < rows; ++r) {
+    plan.transform(data + static_cast<size_t>(r) * cols, inverse);
+  }
+  transformColumns(data, rows, cols, inverse);
+  if (inverse) {
+    for (size_t k = 0; k < static_cast<size_t>(rows) * cols; ++k) {
+      data[k] *= scale;
+    }
+  }
+}
+
+void GpuFft::forward(const double* image, Complex* spectrum, int rows, int cols) const {
+  checkSize(rows, cols);
+  if (auto gpu = Gpu::active()) {
+    const int half_cols = cols / 2 + 1;
+    std::vector<Complex> data(image, image + static_cast<size_t>(rows) * cols);
+    if (gpu->transform(data.data(), rows, cols, false)) {
+      for (int r = 0; r < rows; ++r) {
+        std::copy_n(data.data() + static_cast<size_t>(r) * cols, half_cols,
+                    spectrum + static_cast<size_t>(r) * half_cols);
+      }
+      return;
+    }
+  }
+  Radix2Fft::forward(image, spectrum, rows, cols);
+}
+
+void GpuFft::inverse(const Complex* spectrum, double* image, int rows, int cols) const {
+  checkSize(rows, cols);
+  if (auto gpu = Gpu::active()) {
+    // The full spectrum, the missing half by X[r, c] = conj X[-r, -c]
+    const int half_cols = cols / 2 + 1;
+    std::vector<Complex> data(static_cast<size_t>(rows) * cols);
+    for (int r = 0; r < rows; ++r) {
+      const Complex* in = spectrum + static_cast<size_t>(r) * half_cols;
+      const Complex* mirror = spectrum + static_cast<size_t>((rows - r) & (rows - 1)) * half_cols;
+      Complex* out = data.data() + static_cast<size_t>(r) * cols;
+      std::copy_n(in, half_cols, out);
+      for (int c = half_cols; c < cols; ++c) {
+        out[c] = std::conj(mirror[cols - c]);
+      }
+    }
+    if (gpu->transform(data.data(), rows, cols, true)) {
+      for (size_t k = 0; k < data.size(); ++k) {
+        image[k] = data[k].real();
+      }
+      return;
+    }
+  }
+  Radix2Fft::inverse(spectrum, image, rows, cols);
+}
+
+void GpuFft::transform(Complex* data, int rows, int cols, bool inverse) const {
+  checkSize(rows, cols);
+  if (auto gpu = Gpu::active(); gpu && gpu->transform(data, rows, cols, inverse)) {
+    return;
+  }
+  Radix2Fft::transform(data, rows, cols, inverse);
+}
+
+namespace Fft {
+
+void registerBackend(const std::string& name, Factory factory) {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.factories[name] = std::move(factory);
+}
+
+std::vector<std::string> backends() {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::vector<std::string> names;
+  for (const auto& [name, factory] : r.factories) {
+    names.push_back(name);
+  }
+  return names;
+}
+
+std::shared_ptr<FftBackend> create(const std::string& name) {
+  Factory factory;
+  {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto it = r.factories.find(name);
+    if (it == r.factories.end()) {
+      throw std::invalid_argument("Unknown FFT backend: " + name);
+    }
+    factory = it->second;
+  }
+  return factory();
+}
+
+std::shared_ptr<FftBackend> defaultBackend() {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  return r.default_backend;
+}
+
+void setDefaultBackend(const std::string& name) {
+  auto backend = create(name);
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.default_backend = std::move(backend);
+}
+
+} // namespace Fft
@@ -0,0 +1,73 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef FFT_HPP
+#define FFT_HPP
+
+#include <complex>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 2D discrete Fourier transforms of real images, behind an interface so
+// an optimised library can stand in for the built-in transform.
+//
+// Images are row-major, rows x cols. forward() gives the rows x
+// (cols / 2 + 1) half spectrum that determines a real image, also
+// row-major; inverse() takes it back scaled by 1 / (rows cols), so the
+// pair round-trips. transform() is the complex transform in place, with
+// the same scaling. All are safe to call from several threads at once.
+class FftBackend {
+public:
+  using Complex = std::complex<double>;
+
+  virtual ~FftBackend() = default;
+  virtual std::string name() const = 0;
+  // Smallest length >= n the backend transforms
+  virtual int goodSize(int n) const = 0;
+  virtual void forward(const double* image, Complex* spectrum, int rows, int cols) const = 0;
+  virtual void inverse(const Complex* spectrum, double* image, int rows, int cols) const = 0;
+  virtual void transform(Complex* data, int rows, int cols, bool inverse) const = 0;
+};
+
+// Iterative radix-2 transforms of power-of-two sizes. Real rows are
+// transformed two at a time as one complex row, and the row and column
+// passes each run in parallel under OpenMP.
+class Radix2Fft : public FftBackend {
+public:
+  std::string name() const override { return "radix2"; }
+  int goodSize(int n) const override;
+  void forward(const double* image, Complex* spectrum, int rows, int cols) const override;
+  void inverse(const Complex* spectrum, double* image, int rows, int cols) const override;
+  void transform(Complex* data, int rows, int cols, bool inverse) const override;
+};
+
+// Radix2Fft's transforms on the device of Gpu::active(), "gpu" in the
+// registry. Each transform stays on the device through both passes; the
+// real ones go through full complex transforms. Without a device, or for
+// a transform it declines, Radix2Fft runs instead.
+class GpuFft : public Radix2Fft {
+public:
+  std::string name() const override { return "gpu"; }
+  void forward(const double* image, Complex* spectrum, int rows, int cols) const override;
+  void inverse(const Complex* spectrum, double* image, int rows, int cols) const override;
+  void transform(Complex* data, int rows, int cols, bool inverse) const override;
+};
+
+namespace Fft {
+
+using Factory = std::function<std::shared_ptr<FftBackend>()>;
+
+// Makes a backend available by name, replacing one of the same name;
+// "radix2" and "gpu" are always registered
+void registerBackend(const std::string& name, Factory factory);
+std::vector<std::string> backends();
+// Throws std::invalid_argument for a name that is not registered
+std::shared_ptr<FftBackend> create(const std::string& name);
+
+// The backend consumers use unless given one, "radix2" until set
+std::shared_ptr<FftBackend> defaultBackend();
+void setDefaultBackend(const std::string& name);
+
+} // namespace Fft
+
+#endif // FFT_HPP
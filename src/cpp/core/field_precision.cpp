@@ -0,0 +1,129 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "field_precision.hpp"
+#include "field_store.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+const char* fieldPrecisionName(FieldPrecision precision) {
+  switch (precision) {
+  case FieldPrecision::FLOAT64:
+    return "float64";
+  case FieldPrecision::FLOAT32:
+    return "float32";
+  case FieldPrecision::LOG_FLOAT32:
+    return "log_float32";
+  case FieldPrecision::MASK8:
+    return "mask8";
+  }
+  return "unknown";
+}
+
+namespace {
+
+template <typename Codec>
+void encodeCells(const Eigen::Ref<const Eigen::ArrayXXd>& values, typename Codec::Storage* out) {
+  const Eigen::Index rows = values.rows();
+  const long cols = static_cast<long>(values.cols());
+#pragma omp parallel for schedule(static) if (values.size() >= (1 << 16))
+  for (long j = 0; j < cols; ++j) {
+    typename Codec::Storage* column = out + j * rows;
+    for (Eigen::Index i = 0; i < rows; ++i) {
+      column[i] = Codec::encode(values(i, j));
+    }
+  }
+}
+
+} // namespace
+
+CompactField CompactField::encode(const Eigen::Ref<const Eigen::ArrayXXd>& values, FieldPrecision precision) {
+  CompactField field;
+  field.precision_ = precision;
+  field.rows_ = static_cast<int>(values.rows());
+  field.cols_ = static_cast<int>(values.cols());
+  const std::size_t cells = static_cast<std::size_t>(values.size());
+  switch (precision) {
+  case FieldPrecision::FLOAT32:
+    field.narrow_.resize(cells);
+    encodeCells<FieldCodec<FieldPrecision::FLOAT32>>(values, field.narrow_.data());
+    break;
+  case FieldPrecision::LOG_FLOAT32:
+    field.narrow_.resize(cells);
+    encodeCells<FieldCodec<FieldPrecision::LOG_FLOAT32>>(values, field.narrow_.data());
+    break;
+  case FieldPrecision::MASK8:
+    field.mask_.resize(cells);
+    encodeCells<FieldCodec<FieldPrecision::MASK8>>(values, field.mask_.data());
+    break;
+  case FieldPrecision::FLOAT64:
+    field.wide_.resize(cells);
+    encodeCells<FieldCodec<FieldPrecision::FLOAT64>>(values, field.wide_.data());
+    break;
+  }
+  return field;
+}
+
+std::size_t CompactField::bytes() const {
+  return wide_.size() * sizeof(double) + narrow_.size() * sizeof(float) + mask_.size();
+}
+
+Eigen::ArrayXXd CompactField::decode() const {
+  Eigen::ArrayXXd out(rows_, cols_);
+  decodeInto(out);
+  return out;
+}
+
+void CompactField::decodeInto(Eigen::Ref<Eigen::ArrayXXd> out) const {
+  if (out.rows() != rows_ || out.cols() != cols_) {
+    throw std::invalid_argument("Compact field shape does not match the output");
+  }
+  visit([&](auto codec, const auto* cells) {
+    using Codec = decltype(codec);
+    for (int j = 0; j < cols_; ++j) {
+      for (int i = 0; i < rows_; ++i) {
+        out(i, j) = Codec::decode(cells[static_cast<std::size_t>(j) * rows_ + i]);
+      }
+    }
+  });
+}
+
+FieldPrecisionError compareFields(const Eigen::Ref<const Eigen::ArrayXXd>& reference,
+                                  const Eigen::Ref<const Eigen::ArrayXXd>& candidate, double floor) {
+  if (reference.rows() != candidate.rows() || reference.cols() != candidate.cols()) {
+    throw std::invalid_argument("Compared fields differ in shape");
+  }
+  FieldPrecisionError error;
+  for (Eigen::Index j = 0; j < reference.cols(); ++j) {
+    for (Eigen::Index i = 0; i < reference.rows(); ++i) {
+      const double abs = std::abs(candidate(i, j) - reference(i, j));
+      error.max_rel = std::max(error.max_rel, abs / std::max(std::abs(reference(i, j)), floor));
+      if (abs > error.max_abs || error.row < 0) {
+        error.max_abs = abs;
+        error.row = static_cast<int>(i);
+        error.col = static_cast<int>(j);
+      }
+    }
+  }
+  return error;
+}
+
+FieldPrecisionError precisionError(const Eigen::Ref<const Eigen::ArrayXXd>& values, FieldPrecision precision,
+                                   double floor) {
+  return compareFields(values, CompactField::encode(values, precision).decode(), floor);
+}
+
+std::vector<FieldPrecisionError> compareStores(const FieldStore& reference, const FieldStore& candidate,
+                                               double floor) {
+  if (reference.rows() != candidate.rows() || reference.cols() != candidate.cols()) {
+    throw std::invalid_argument("Compared field stores differ in shape");
+  }
+  std::vector<FieldPrecisionError> errors;
+  for (int c = 0; c < candidate.channelCount(); ++c) {
+    const int r = reference.channelIndex(candidate.channelName(c));
+    if (r < 0 || (!reference.isMaterialized(r) && !candidate.isMaterialized(c))) {
+      continue;
+    }
+    errors.push_back(compareFields(reference.view(r), candidate.view(c), floor));
+    errors.back().channel = candidate.channelName(c);
+  }
+  return errors;
+}
@@ -0,0 +1,124 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <Eigen/Dense>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+class FieldStore;
+
+// How a field channel is stored when narrower than double: the precision
+// policy of a FieldStore channel (see FieldStore::compact).
+//
+//   FLOAT64      as is
+//   FLOAT32      about 7 significant digits: temperature, stress, MTTF
+//   LOG_FLOAT32  the natural log as float32, a relative error near 1e-7
+//                across any number of decades: dopant concentrations.
+//                Values <= 0 come back as 0.
+//   MASK8        one byte, 0 or 1: masks. Nonzero values come back as 1.
+enum class FieldPrecision : std::uint8_t { FLOAT64, FLOAT32, LOG_FLOAT32, MASK8 };
+
+const char* fieldPrecisionName(FieldPrecision precision);
+
+// Storage type and conversions of each precision. Kernels templated over
+// the codec read the narrow type and do their arithmetic in double.
+template <FieldPrecision P>
+struct FieldCodec;
+
+template <>
+struct FieldCodec<FieldPrecision::FLOAT64> {
+  using Storage = double;
+  static Storage encode(double value) { return value; }
+  static double decode(Storage stored) { return stored; }
+};
+
+template <>
+struct FieldCodec<FieldPrecision::FLOAT32> {
+  using Storage = float;
+  static Storage encode(double value) { return static_cast<float>(value); }
+  static double decode(Storage stored) { return stored; }
+};
+
+template <>
+struct FieldCodec<FieldPrecision::LOG_FLOAT32> {
+  using Storage = float;
+  static Storage encode(double value) {
+    return value > 0.0 ? static_cast<float>(std::log(value)) : -std::numeric_limits<float>::infinity();
+  }
+  static double decode(Storage stored) { return std::exp(static_cast<double>(stored)); }
+};
+
+template <>
+struct FieldCodec<FieldPrecision::MASK8> {
+  using Storage = std::uint8_t;
+  static Storage encode(double value) { return value != 0.0 ? 1 : 0; }
+  static double decode(Storage stored) { return stored; }
+};
+
+// A column-major rows x cols field held at a given precision, e.g. a
+// read-only copy of a channel for kernels that stream it many times.
+class CompactField {
+public:
+  CompactField() = default;
+  static CompactField encode(const Eigen::Ref<const Eigen::ArrayXXd>& values, FieldPrecision precision);
+
+  FieldPrecision precision() const { return precision_; }
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  std::size_t bytes() const;
+
+  Eigen::ArrayXXd decode() const;
+  // Throws std::invalid_argument unless out has the field's shape
+  void decodeInto(Eigen::Ref<Eigen::ArrayXXd> out) const;
+
+  // Calls f(FieldCodec<P>(), const Storage* data) with the field's codec
+  // and its cells, column-major with leading dimension rows()
+  template <typename F>
+  decltype(auto) visit(F&& f) const {
+    switch (precision_) {
+    case FieldPrecision::FLOAT32:
+      return f(FieldCodec<FieldPrecision::FLOAT32>(), narrow_.data());
+    case FieldPrecision::LOG_FLOAT32:
+      return f(FieldCodec<FieldPrecision::LOG_FLOAT32>(), narrow_.data());
+    case FieldPrecision::MASK8:
+      return f(FieldCodec<FieldPrecision::MASK8>(), mask_.data());
+    case FieldPrecision::FLOAT64:
+    default:
+      return f(FieldCodec<FieldPrecision::FLOAT64>(), wide_.data());
+    }
+  }
+
+private:
+  FieldPrecision precision_ = FieldPrecision::FLOAT64;
+  int rows_ = 0;
+  int cols_ = 0;
+  std::vector<double> wide_;
+  std::vector<float> narrow_;
+  std::vector<std::uint8_t> mask_;
+};
+
+// Largest deviation of a field from a reference: the validation report
+// for a precision policy against an all-double run. The relative error
+// divides by max(|reference|, floor), so cells near zero do not dominate.
+struct FieldPrecisionError {
+  std::string channel;
+  double max_abs = 0.0;
+  double max_rel = 0.0;
+  int row = -1; // Cell of the largest absolute error, -1 if none
+  int col = -1;
+};
+
+// Throws std::invalid_argument if the shapes differ
+FieldPrecisionError compareFields(const Eigen::Ref<const Eigen::ArrayXXd>& reference,
+                                  const Eigen::Ref<const Eigen::ArrayXXd>& candidate, double floor = 1e-30);
+// The error a round trip through `precision` alone puts on the field
+FieldPrecisionError precisionError(const Eigen::Ref<const Eigen::ArrayXXd>& values, FieldPrecision precision,
+                                   double floor = 1e-30);
+// Every channel of `candidate` that `reference` also has, in candidate's
+// channel order, skipping channels neither store has materialized; throws
+// std::invalid_argument if the shapes differ
+std::vector<FieldPrecisionError> compareStores(const FieldStore& reference, const FieldStore& candidate,
+                                               double floor = 1e-30);
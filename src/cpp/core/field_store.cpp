@@ -0,0 +1,423 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "field_store.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// Fields at least this large are filled and copied by all OpenMP threads
+constexpr std::size_t kParallelCells = 1 << 14;
+
+std::uint64_t nextVersion() {
+  static std::atomic<std::uint64_t> counter{0};
+  return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+// `cells` copies of `value`, shared by every store reading an unmaterialized
+// channel with that default through a const accessor. Blocks live for the
+// process: there is one per default value and grid size read this way.
+const double* defaultBlock(double value, std::size_t cells) {
+  static std::mutex mutex;
+  static std::map<std::pair<std::uint64_t, std::size_t>, AlignedFieldBuffer> blocks;
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  std::lock_guard<std::mutex> lock(mutex);
+  AlignedFieldBuffer& block = blocks[{bits, cells}];
+  if (!block) {
+    block = allocateAlignedField(cells);
+    std::fill(block.get(), block.get() + cells, value);
+  }
+  return block.get();
+}
+
+} // namespace
+
+void AlignedFieldFree::operator()(double* p) const {
+  if (!owner) {
+    std::free(p);
+  }
+}
+
+AlignedFieldBuffer allocateAlignedField(std::size_t count) {
+  // aligned_alloc requires the size to be a multiple of the alignment.
+  constexpr std::size_t align = FieldStore::kAlignment;
+  std::size_t bytes = (std::max<std::size_t>(count, 1) * sizeof(double) + align - 1) / align * align;
+  void* p = std::aligned_alloc(FieldStore::kAlignment, bytes);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return AlignedFieldBuffer(static_cast<double*>(p));
+}
+
+ConstFieldView FieldSnapshot::view() const {
+  if (!buffer_ || !buffer_->data) {
+    return ConstFieldView(nullptr, 0, 0);
+  }
+  return ConstFieldView(buffer_->data, buffer_->rows, buffer_->cols);
+}
+
+void FieldSnapshot::copyBlock(int row, int col, int rows, int cols, double* out, int ld,
+                              bool row_major) const {
+  if (!buffer_) {
+    throw std::out_of_range("FieldSnapshot::copyBlock on an empty snapshot");
+  }
+  std::lock_guard<std::mutex> lock(buffer_->mutex);
+  if (!buffer_->data || row < 0 || col < 0 || rows < 0 || cols < 0 ||
+      row + rows > buffer_->rows || col + cols > buffer_->cols) {
+    throw std::out_of_range("FieldSnapshot::copyBlock outside the field");
+  }
+  ConstFieldView source(buffer_->data, buffer_->rows, buffer_->cols);
+  if (row_major) {
+    Eigen::Map<Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>, 0, Eigen::OuterStride<>>(
+        out, rows, cols, Eigen::OuterStride<>(ld)) = source.block(row, col, rows, cols);
+  } else {
+    Eigen::Map<Eigen::ArrayXXd, 0, Eigen::OuterStride<>>(out, rows, cols, Eigen::OuterStride<>(ld)) =
+        source.block(row, col, rows, cols);
+  }
+}
+
+FieldStore::~FieldStore() { detachAllSnapshots(); }
+
+FieldStore::FieldStore(const FieldStore& other)
+    : rows_(other.rows_), cols_(other.cols_), stride_(other.stride_), capacity_(other.capacity_),
+      arena_(other.arena_), channels_(other.channels_) {}
+
+FieldStore& FieldStore::operator=(const FieldStore& other) {
+  if (this != &other) {
+    FieldStore copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+FieldStore& FieldStore::operator=(FieldStore&& other) noexcept {
+  if (this != &other) {
+    detachAllSnapshots();
+    rows_ = other.rows_;
+    cols_ = other.cols_;
+    stride_ = other.stride_;
+    capacity_ = other.capacity_;
+    arena_ = std::move(other.arena_);
+    channels_ = std::move(other.channels_);
+    snapshots_ = std::move(other.snapshots_);
+    other.capacity_ = 0;
+  }
+  return *this;
+}
+
+int FieldStore::registerChannel(const std::string& name, double default_value, bool lazy,
+                                FieldPrecision precision) {
+  int existing = channelIndex(name);
+  if (existing >= 0) {
+    return existing;
+  }
+  channels_.push_back({name, default_value, lazy, false, nextVersion(), precision});
+  int index = static_cast<int>(channels_.size()) - 1;
+  if (cellCount() > 0) {
+    // Grow the arena, preserving the contents of the existing channels.
+    detachAllSnapshots();
+    // The stride depends on the shape alone, so the old channels keep it
+    std::shared_ptr<double[]> old = std::move(arena_);
+    reallocate();
+    if (old) {
+      copyColumns(arena_.get(), old.get(), static_cast<std::size_t>(index));
+    }
+    if (!lazy) {
+      materialize(index);
+    }
+  }
+  return index;
+}
+
+int FieldStore::channelIndex(const std::string& name) const {
+  for (std::size_t c = 0; c < channels_.size(); ++c) {
+    if (channels_[c].name == name) {
+      return static_cast<int>(c);
+    }
+  }
+  return -1;
+}
+
+int FieldStore::requireChannel(const std::string& name) const {
+  int index = channelIndex(name);
+  if (index < 0) {
+    throw std::out_of_range("Unknown field channel: " + name);
+  }
+  return index;
+}
+
+std::size_t FieldStore::paddedStride(std::size_t cells) {
+  // Pad each channel to a whole number of cache lines so every channel
+  // starts on a 64-byte boundary.
+  constexpr std::size_t per_line = kAlignment / sizeof(double);
+  return (cells + per_line - 1) / per_line * per_line;
+}
+
+void FieldStore::reallocate() {
+  detachAllSnapshots();
+  stride_ = paddedStride(cellCount());
+  capacity_ = stride_ * channels_.size();
+  arena_.reset();
+  if (capacity_ == 0) {
+    return;
+  }
+  try {
+    arena_ = allocateAlignedField(capacity_);
+  } catch (...) {
+    capacity_ = 0;
+    throw;
+  }
+}
+
+bool FieldStore::reshape(int rows, int cols) {
+  if (rows < 0 || cols < 0) {
+    throw std::invalid_argument("Field dimensions must be non-negative");
+  }
+  if (rows == rows_ && cols == cols_ && (arena_ || cellCount() == 0)) {
+    return false;
+  }
+  rows_ = rows;
+  cols_ = cols;
+  reallocate();
+  for (std::size_t c = 0; c < channels_.size(); ++c) {
+    resetChannel(static_cast<int>(c));
+  }
+  return true;
+}
+
+void FieldStore::adoptArena(int rows, int cols, std::size_t stride, AlignedFieldBuffer arena,
+                            const std::vector<bool>& materialized) {
+  constexpr std::size_t per_line = kAlignment / sizeof(double);
+  if (rows < 0 || cols < 0 || stride < static_cast<std::size_t>(rows) * cols || stride % per_line != 0) {
+    throw std::invalid_argument("Adopted arena stride does not fit the field shape");
+  }
+  if (materialized.size() != channels_.size() ||
+      reinterpret_cast<std::uintptr_t>(arena.get()) % kAlignment != 0) {
+    throw std::invalid_argument("Adopted arena does not match the registered channels");
+  }
+  detachAllSnapshots();
+  rows_ = rows;
+  cols_ = cols;
+  stride_ = stride;
+  capacity_ = stride * channels_.size();
+  arena_ = std::move(arena);
+  for (std::size_t c = 0; c < channels_.size(); ++c) {
+    channels_[c].version = nextVersion();
+    channels_[c].materialized = materialized[c] && cellCount() > 0;
+    if (!channels_[c].materialized) {
+      resetChannel(static_cast<int>(c));
+    }
+  }
+}
+
+void FieldStore::resetChannel(int channel) {
+  unshareArena();
+  detachSnapshots(channel);
+  Channel& ch = channels_[channel];
+  ch.materialized = false;
+  ch.version = nextVersion();
+  if (!ch.lazy) {
+    materialize(channel);
+  }
+}
+
+void FieldStore::materialize(int channel) {
+  Channel& ch = channels_[channel];
+  if (ch.materialized || cellCount() == 0) {
+    ch.materialized = cellCount() > 0;
+    return;
+  }
+  unshareArena();
+  fillColumns(arena_.get() + channel * stride_, ch.default_value);
+  ch.materialized = true;
+}
+
+void FieldStore::shift(int channel, double offset) {
+  double* p = data(channel);
+  const long cols = cols_;
+  const Eigen::Index rows = rows_;
+#pragma omp parallel for schedule(static) if (cellCount() >= kParallelCells)
+  for (long j = 0; j < cols; ++j) {
+    Eigen::Map<Eigen::ArrayXd>(p + j * rows, rows) += offset;
+  }
+}
+
+void FieldStore::quantize(int channel) {
+  const FieldPrecision precision = channels_[channel].precision;
+  if (precision == FieldPrecision::FLOAT64 || cellCount() == 0) {
+    return;
+  }
+  double* p = data(channel);
+  const long cols = cols_;
+  const Eigen::Index rows = rows_;
+  const auto round_trip = [&](auto codec) {
+    using Codec = decltype(codec);
+#pragma omp parallel for schedule(static) if (cellCount() >= kParallelCells)
+    for (long j = 0; j < cols; ++j) {
+      double* column = p + j * rows;
+      for (Eigen::Index i = 0; i < rows; ++i) {
+        column[i] = Codec::decode(Codec::encode(column[i]));
+      }
+    }
+  };
+  switch (precision) {
+  case FieldPrecision::FLOAT32:
+    round_trip(FieldCodec<FieldPrecision::FLOAT32>());
+    break;
+  case FieldPrecision::LOG_FLOAT32:
+    round_trip(FieldCodec<FieldPrecision::LOG_FLOAT32>());
+    break;
+  case FieldPrecision::MASK8:
+    round_trip(FieldCodec<FieldPrecision::MASK8>());
+    break;
+  default:
+    break;
+  }
+}
+
+void FieldStore::fillColumns(double* p, double value) const {
+  const long cols = cols_;
+  const std::size_t rows = static_cast<std::size_t>(rows_);
+#pragma omp parallel for schedule(static) if (cellCount() >= kParallelCells)
+  for (long j = 0; j < cols; ++j) {
+    std::fill(p + j * rows, p + (j + 1) * rows, value);
+  }
+}
+
+void FieldStore::copyColumns(double* to, const double* from, std::size_t channels) const {
+  const long cols = cols_;
+  const std::size_t rows = static_cast<std::size_t>(rows_);
+#pragma omp parallel for schedule(static) if (cellCount() >= kParallelCells)
+  for (long j = 0; j < cols; ++j) {
+    for (std::size_t c = 0; c < channels; ++c) {
+      std::memcpy(to + c * stride_ + j * rows, from + c * stride_ + j * rows, rows * sizeof(double));
+    }
+  }
+}
+
+void FieldStore::unshareArena() {
+  if (!arena_ || arena_.use_count() == 1) {
+    // The last other store may have been reading the arena on its way out;
+    // its reads must finish before ours write.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return;
+  }
+  // Snapshots alias the shared arena, which the other stores may write
+  // once this one lets go of it.
+  detachAllSnapshots();
+  AlignedFieldBuffer copy = allocateAlignedField(capacity_);
+  copyColumns(copy.get(), arena_.get(), channels_.size());
+  arena_ = std::move(copy);
+}
+
+double* FieldStore::data(int channel) {
+  unshareArena();
+  detachSnapshots(channel);
+  channels_[channel].version = nextVersion();
+  materialize(channel);
+  return arena_ ? arena_.get() + channel * stride_ : nullptr;
+}
+
+const double* FieldStore::data(int channel) const {
+  const Channel& ch = channels_[channel];
+  if (!ch.materialized && cellCount() > 0) {
+    return defaultBlock(ch.default_value, cellCount());
+  }
+  return arena_ ? arena_.get() + channel * stride_ : nullptr;
+}
+
+FieldView FieldStore::view(int channel) {
+  return FieldView(data(channel), rows_, cols_);
+}
+
+ConstFieldView FieldStore::view(int channel) const {
+  return ConstFieldView(data(channel), rows_, cols_);
+}
+
+void FieldStore::assign(int channel, const Eigen::Ref<const Eigen::ArrayXXd>& values) {
+  if (!arena_ || cellCount() == 0) {
+    reshape(static_cast<int>(values.rows()), static_cast<int>(values.cols()));
+  } else if (values.rows() != rows_ || values.cols() != cols_) {
+    throw std::invalid_argument("Field '" + channels_[channel].name + "' shape " +
+                                std::to_string(values.rows()) + "x" + std::to_string(values.cols()) +
+                                " does not match wafer grid " + std::to_string(rows_) + "x" +
+                                std::to_string(cols_));
+  }
+  channels_[channel].materialized = true;
+  if (cellCount() > 0) {
+    view(channel) = values;
+  }
+}
+
+FieldSnapshot FieldStore::snapshot(int channel) const {
+  auto buffer = std::make_shared<FieldSnapshot::Buffer>();
+  buffer->data = data(channel);
+  buffer->rows = rows_;
+  buffer->cols = cols_;
+  if (!channels_[channel].materialized) {
+    // The default block never changes, so there is nothing to detach
+    return FieldSnapshot(std::move(buffer));
+  }
+  if (snapshots_.size() < channels_.size()) {
+    snapshots_.resize(channels_.size());
+  }
+  auto& live = snapshots_[channel];
+  live.erase(std::remove_if(live.begin(), live.end(),
+                            [](const std::weak_ptr<FieldSnapshot::Buffer>& w) { return w.expired(); }),
+             live.end());
+  live.push_back(buffer);
+  return FieldSnapshot(std::move(buffer));
+}
+
+int FieldStore::liveSnapshotCount(int channel) const {
+  if (channel >= static_cast<int>(snapshots_.size())) {
+    return 0;
+  }
+  int count = 0;
+  for (const auto& weak : snapshots_[channel]) {
+    count += weak.expired() ? 0 : 1;
+  }
+  return count;
+}
+
+void FieldStore::detachSnapshots(int channel) const {
+  if (channel >= static_cast<int>(snapshots_.size()) || snapshots_[channel].empty()) {
+    return;
+  }
+  for (const auto& weak : snapshots_[channel]) {
+    auto buffer = weak.lock();
+    if (!buffer) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    if (buffer->owned || !buffer->data) {
+      continue;
+    }
+    std::size_t count = static_cast<std::size_t>(buffer->rows) * buffer->cols;
+    try {
+      buffer->owned = allocateAlignedField(count);
+      std::memcpy(buffer->owned.get(), buffer->data, count * sizeof(double));
+      buffer->data = buffer->owned.get();
+    } catch (const std::bad_alloc&) {
+      // Out of memory: drop the snapshot's contents rather than let it dangle.
+      buffer->data = nullptr;
+      buffer->rows = 0;
+      buffer->cols = 0;
+    }
+  }
+  snapshots_[channel].clear();
+}
+
+void FieldStore::detachAllSnapshots() const {
+  for (std::size_t c = 0; c < snapshots_.size(); ++c) {
+    detachSnapshots(static_cast<int>(c));
+  }
+}
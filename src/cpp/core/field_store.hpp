@@ -0,0 +1,199 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "field_precision.hpp"
+#include <Eigen/Dense>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Mutable/const views into a FieldStore channel. Channels are column-major,
+// share the store's shape and start on a 64-byte boundary.
+using FieldView = Eigen::Map<Eigen::ArrayXXd, Eigen::Aligned64>;
+using ConstFieldView = Eigen::Map<const Eigen::ArrayXXd, Eigen::Aligned64>;
+
+// Releases buffers obtained from std::aligned_alloc. Buffers carved out of
+// memory owned elsewhere (e.g. a file mapping) hold that owner instead and
+// are released together with it.
+struct AlignedFieldFree {
+  std::shared_ptr<const void> owner;
+  void operator()(double* p) const;
+};
+using AlignedFieldBuffer = std::unique_ptr<double[], AlignedFieldFree>;
+
+// Allocates `count` doubles on a 64-byte boundary; throws std::bad_alloc.
+AlignedFieldBuffer allocateAlignedField(std::size_t count);
+
+// Read-only, copy-on-write snapshot of one FieldStore channel. A snapshot
+// aliases the live channel until the store next writes to that channel (or
+// reallocates); only then are the old contents copied into the snapshot.
+// Snapshots of unchanged fields therefore cost no memory.
+class FieldSnapshot {
+public:
+  FieldSnapshot() = default;
+  bool valid() const { return static_cast<bool>(buffer_); }
+  int rows() const { return buffer_ ? buffer_->rows : 0; }
+  int cols() const { return buffer_ ? buffer_->cols : 0; }
+  // True while the snapshot still shares memory with the live store.
+  bool isShared() const { return buffer_ && !buffer_->owned; }
+  ConstFieldView view() const;
+  Eigen::ArrayXXd toArray() const { return view(); }
+  // Copies the rows x cols block at (row, col) to `out`, column-major with
+  // leading dimension `ld`, or row-major when `row_major` is set. Unlike
+  // view(), this may run on another thread while the store writes to the
+  // channel: the store waits for the copy before detaching the snapshot.
+  void copyBlock(int row, int col, int rows, int cols, double* out, int ld,
+                 bool row_major = false) const;
+
+private:
+  friend class FieldStore;
+  struct Buffer {
+    const double* data = nullptr;
+    AlignedFieldBuffer owned;
+    int rows = 0;
+    int cols = 0;
+    std::mutex mutex; // Held by copyBlock() and while detaching
+  };
+  explicit FieldSnapshot(std::shared_ptr<Buffer> buffer) : buffer_(std::move(buffer)) {}
+
+  std::shared_ptr<Buffer> buffer_;
+};
+
+// Structure-of-arrays registry of named 2D fields. All channels share one
+// grid shape and live in a single 64-byte aligned arena, so multi-field
+// kernels walk co-located memory and never need per-cell bounds tests.
+// Lazy channels reserve their arena slot but are only filled with their
+// default value the first time they are accessed for writing; until then
+// const reads see a process-wide block of the default value, so reading
+// a store never writes to it and concurrent readers need no lock.
+//
+// Channels are filled and copied column range by column range in OpenMP's
+// static schedule, so each page of the arena is first touched by the
+// thread whose share of the columns it holds. Kernels that loop over
+// columns with schedule(static) get the same shares and so, with threads
+// pinned (OMP_PROC_BIND), run on the NUMA node that holds their memory.
+//
+// Copies share the arena until either store next writes to any channel,
+// which then copies the whole arena for itself, so cloning a wafer costs
+// nothing until the clone diverges. Views handed out before a copy still
+// point into the shared arena: take mutable views after copying.
+class FieldStore {
+public:
+  static constexpr std::size_t kAlignment = 64;
+
+  FieldStore() = default;
+  ~FieldStore();
+  FieldStore(const FieldStore& other);
+  FieldStore& operator=(const FieldStore& other);
+  FieldStore(FieldStore&&) noexcept = default;
+  FieldStore& operator=(FieldStore&& other) noexcept;
+
+  // Registers a channel and returns its index. Registering an existing name
+  // returns the existing index. Must be called before reshape() for the
+  // channel to get an arena slot without a reallocation.
+  int registerChannel(const std::string& name, double default_value, bool lazy = false,
+                      FieldPrecision precision = FieldPrecision::FLOAT64);
+  int channelIndex(const std::string& name) const; // -1 if unknown
+  bool hasChannel(const std::string& name) const { return channelIndex(name) >= 0; }
+  bool isMaterialized(int channel) const { return channels_[channel].materialized; }
+  // Fills a lazy channel's arena slot with its default, for consumers of
+  // the raw arena; not a write point, as the contents read the same
+  void materialize(int channel);
+  // Changes at every write point of the channel (mutable access, assign,
+  // reset, reshape). Versions come from one process-wide counter, so equal
+  // versions mean equal contents even across stores: a copied store keeps
+  // its source's versions until it writes.
+  std::uint64_t version(int channel) const { return channels_[channel].version; }
+  int channelCount() const { return static_cast<int>(channels_.size()); }
+  const std::string& channelName(int channel) const { return channels_[channel].name; }
+
+  // Precision policy: what precision a channel needs. The arena itself
+  // stays double, as views, kernels and mapped checkpoints expect;
+  // compact() hands out a copy at the channel's precision for kernels
+  // that read it many times (half or an eighth of the bytes to stream),
+  // and quantize() rounds the channel to it, so a run quantizing after
+  // each step can be held against an all-double one (compareStores).
+  FieldPrecision channelPrecision(int channel) const { return channels_[channel].precision; }
+  void setChannelPrecision(int channel, FieldPrecision precision) { channels_[channel].precision = precision; }
+  CompactField compact(int channel) const { return CompactField::encode(view(channel), channels_[channel].precision); }
+  // A write point; a no-op for FLOAT64 channels
+  void quantize(int channel);
+
+  // Changes the shared shape. Every channel is reset to its default value
+  // (lazy channels are dematerialized). A no-op returning false if the
+  // shape is unchanged.
+  bool reshape(int rows, int cols);
+  void resetChannel(int channel);
+  // Adds `offset` to every cell of the channel
+  void shift(int channel, double offset);
+
+  // Takes over a filled arena holding channelCount() channels `stride`
+  // doubles apart (stride >= rows * cols, a multiple of 8). Channels not
+  // flagged in `materialized` are reset to their defaults. Used to run
+  // directly on a private file mapping without copying it.
+  void adoptArena(int rows, int cols, std::size_t stride, AlignedFieldBuffer arena,
+                  const std::vector<bool>& materialized);
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  std::size_t cellCount() const { return static_cast<std::size_t>(rows_) * cols_; }
+  std::size_t stride() const { return stride_; } // Doubles between channels
+  std::size_t arenaBytes() const { return capacity_ * sizeof(double); }
+  // True while another store copied from this one (or this one from it)
+  // still shares the arena.
+  bool sharesArena() const { return arena_ && arena_.use_count() > 1; }
+
+  // Mutable access is the write point for copy-on-write: any outstanding
+  // snapshots of the channel are detached before the view is returned.
+  // Only then: a mutable view or data() pointer kept across a later
+  // snapshot() or store copy writes straight into what they share, so
+  // re-acquire mutable views after taking either.
+  FieldView view(int channel);
+  ConstFieldView view(int channel) const;
+  FieldView view(const std::string& name) { return view(requireChannel(name)); }
+  ConstFieldView view(const std::string& name) const { return view(requireChannel(name)); }
+
+  // Raw aligned pointer to the first cell of a channel (column-major).
+  double* data(int channel);
+  const double* data(int channel) const;
+
+  // Copies a field into a channel. If the store has no shape yet it adopts
+  // the field's shape; otherwise the shapes must match.
+  void assign(int channel, const Eigen::Ref<const Eigen::ArrayXXd>& values);
+
+  // Zero-copy snapshot of a channel's current contents.
+  FieldSnapshot snapshot(int channel) const;
+  int liveSnapshotCount(int channel) const;
+
+private:
+  struct Channel {
+    std::string name;
+    double default_value;
+    bool lazy;
+    bool materialized;
+    std::uint64_t version;
+    FieldPrecision precision;
+  };
+
+  int requireChannel(const std::string& name) const;
+  static std::size_t paddedStride(std::size_t cells);
+  void reallocate();
+  // Column loops in the static schedule described above
+  void fillColumns(double* p, double value) const;
+  void copyColumns(double* to, const double* from, std::size_t channels) const;
+  // Gives this store its own arena before it writes, if others share it
+  void unshareArena();
+  void detachSnapshots(int channel) const;
+  void detachAllSnapshots() const;
+
+  int rows_ = 0;
+  int cols_ = 0;
+  std::size_t stride_ = 0;
+  std::size_t capacity_ = 0; // doubles in arena_
+  std::shared_ptr<double[]> arena_; // Shared by copies
+  std::vector<Channel> channels_;
+  // Snapshots still aliasing each channel, indexed by channel.
+  mutable std::vector<std::vector<std::weak_ptr<FieldSnapshot::Buffer>>> snapshots_;
+};
@@ -0,0 +1,523 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "field_stream_writer.hpp"
+#include "wafer.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <zlib.h>
+#ifdef SEMIPRO_HAVE_HDF5
+#include <hdf5.h>
+#endif
+
+// Storage backend of a FieldStreamWriter. Only the writer thread calls it.
+class FieldStreamSink {
+public:
+    virtual ~FieldStreamSink() = default;
+    // Called before the first frame, with the shape every frame has
+    virtual void begin(int rows, int cols) = 0;
+    // Returns the bytes the frame took up in the store
+    virtual std::size_t writeFrame(std::size_t index, double time, const std::vector<FieldSnapshot>& fields) = 0;
+    virtual void finish() = 0;
+};
+
+namespace {
+
+namespace fs = std::filesystem;
+
+struct Tile {
+    int row, col, rows, cols;
+};
+
+std::vector<Tile> tiles(int rows, int cols, int chunk_rows, int chunk_cols) {
+    std::vector<Tile> result;
+    for (int c = 0; c < cols; c += chunk_cols) {
+        for (int r = 0; r < rows; r += chunk_rows) {
+            result.push_back({r, c, std::min(chunk_rows, rows - r), std::min(chunk_cols, cols - c)});
+        }
+    }
+    return result;
+}
+
+// Zarr v2 directory store: one directory per array holding a .zarray
+// description and one file per chunk, named by its chunk indices.
+class ZarrSink : public FieldStreamSink {
+public:
+    static constexpr int kTimeChunk = 1024;
+
+    ZarrSink(const std::string& path, const std::vector<std::string>& channels,
+             const FieldStreamWriter::Options& options)
+        : root_(path), channels_(channels), options_(options) {
+        if (fs::exists(root_)) {
+            if (!fs::exists(root_ / ".zgroup")) {
+                throw std::runtime_error("Refusing to replace " + path + ": not a Zarr store");
+            }
+            fs::remove_all(root_);
+        }
+        fs::create_directories(root_);
+        writeFile(root_ / ".zgroup", "{\"zarr_format\": 2}\n");
+        for (const auto& channel : channels_) {
+            fs::create_directory(root_ / channel);
+        }
+        fs::create_directory(root_ / "time");
+    }
+
+    void begin(int rows, int cols) override {
+        rows_ = rows;
+        cols_ = cols;
+        chunk_rows_ = std::min(options_.chunk_rows, rows);
+        chunk_cols_ = std::min(options_.chunk_cols, cols);
+        tiles_ = tiles(rows, cols, chunk_rows_, chunk_cols_);
+        tile_.resize(static_cast<std::size_t>(chunk_rows_) * chunk_cols_);
+        for (const auto& channel : channels_) {
+            writeFile(root_ / channel / ".zattrs", "{\"_ARRAY_DIMENSIONS\": [\"time\", \"x\", \"y\"]}\n");
+        }
+        writeFile(root_ / "time" / ".zattrs", "{\"_ARRAY_DIMENSIONS\": [\"time\"]}\n");
+        writeMetadata(0);
+    }
+
+    std::size_t writeFrame(std::size_t index, double time, const std::vector<FieldSnapshot>& fields) override {
+        std::size_t stored = 0;
+        for (std::size_t k = 0; k < channels_.size(); ++k) {
+            for (const Tile& t : tiles_) {
+                // Edge chunks keep the full chunk shape, padded with the fill value
+                if (t.rows < chunk_rows_ || t.cols < chunk_cols_) {
+                    std::fill(tile_.begin(), tile_.end(), 0.0);
+                }
+                fields[k].copyBlock(t.row, t.col, t.rows, t.cols, tile_.data(), chunk_rows_);
+                std::ostringstream key;
+                key << index << '.' << t.row / chunk_rows_ << '.' << t.col / chunk_cols_;
+                stored += writeChunk(root_ / channels_[k] / key.str(), tile_.data(), tile_.size());
+            }
+        }
+
+        // The last time chunk is rewritten with every frame
+        times_.push_back(time);
+        std::size_t first = index / kTimeChunk * kTimeChunk;
+        std::vector<double> chunk(kTimeChunk, 0.0);
+        std::copy(times_.begin() + first, times_.end(), chunk.begin());
+        stored += writeChunk(root_ / "time" / std::to_string(index / kTimeChunk), chunk.data(), chunk.size());
+
+        // Readers see the frame only once the array shapes include it
+        writeMetadata(index + 1);
+        return stored;
+    }
+
+    void finish() override {}
+
+private:
+    static void writeFile(const fs::path& path, const void* data, std::size_t size) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        if (!out) {
+            throw std::runtime_error("Cannot write " + path.string());
+        }
+    }
+    static void writeFile(const fs::path& path, const std::string& text) {
+        writeFile(path, text.data(), text.size());
+    }
+    // Renames into place, so readers never see a partial description
+    static void replaceFile(const fs::path& path, const std::string& text) {
+        fs::path staged = path;
+        staged += ".tmp";
+        writeFile(staged, text);
+        fs::rename(staged, path);
+    }
+
+    std::size_t writeChunk(const fs::path& path, const double* values, std::size_t count) {
+        const uLong raw_bytes = static_cast<uLong>(count * sizeof(double));
+        if (options_.compression_level <= 0) {
+            writeFile(path, values, raw_bytes);
+            return raw_bytes;
+        }
+        uLongf packed_bytes = compressBound(raw_bytes);
+        packed_.resize(packed_bytes);
+        if (compress2(packed_.data(), &packed_bytes, reinterpret_cast<const Bytef*>(values), raw_bytes,
+                      std::min(options_.compression_level, 9)) != Z_OK) {
+            throw std::runtime_error("zlib failed to compress " + path.string());
+        }
+        writeFile(path, packed_.data(), packed_bytes);
+        return packed_bytes;
+    }
+
+    std::string arrayMetadata(const std::string& shape, const std::string& chunks, const char* order) const {
+        std::ostringstream json;
+        json << "{\n    \"zarr_format\": 2,\n    \"shape\": [" << shape << "],\n    \"chunks\": [" << chunks
+             << "],\n    \"dtype\": \"<f8\",\n    \"compressor\": ";
+        if (options_.compression_level > 0) {
+            json << "{\"id\": \"zlib\", \"level\": " << std::min(options_.compression_level, 9) << "}";
+        } else {
+            json << "null";
+        }
+        json << ",\n    \"fill_value\": 0.0,\n    \"order\": \"" << order << "\",\n    \"filters\": null\n}\n";
+        return json.str();
+    }
+
+    void writeMetadata(std::size_t frames) {
+        const std::string field = arrayMetadata(
+            std::to_string(frames) + ", " + std::to_string(rows_) + ", " + std::to_string(cols_),
+            "1, " + std::to_string(chunk_rows_) + ", " + std::to_string(chunk_cols_), "F");
+        for (const auto& channel : channels_) {
+            replaceFile(root_ / channel / ".zarray", field);
+        }
+        replaceFile(root_ / "time" / ".zarray", arrayMetadata(std::to_string(frames), std::to_string(kTimeChunk), "C"));
+    }
+
+    fs::path root_;
+    std::vector<std::string> channels_;
+    FieldStreamWriter::Options options_;
+    int rows_ = 0;
+    int cols_ = 0;
+    int chunk_rows_ = 0;
+    int chunk_cols_ = 0;
+    std::vector<Tile> tiles_;
+    std::vector<double> tile_;
+    std::vector<Bytef> packed_;
+    std::vector<double> times_;
+};
+
+#ifdef SEMIPRO_HAVE_HDF5
+// The serial HDF5 library is not thread-safe and every writer has a thread
+std::mutex& hdf5Mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+void checkHdf5(herr_t status, const char* what) {
+    if (status < 0) {
+        throw std::runtime_error(std::string("HDF5 ") + what + " failed");
+    }
+}
+
+// Closes an HDF5 handle on scope exit
+class Hdf5Handle {
+public:
+    Hdf5Handle(hid_t id, herr_t (*close)(hid_t), const char* what) : id_(id), close_(close) {
+        if (id_ < 0) {
+            throw std::runtime_error(std::string("HDF5 ") + what + " failed");
+        }
+    }
+    ~Hdf5Handle() { close_(id_); }
+    Hdf5Handle(const Hdf5Handle&) = delete;
+    Hdf5Handle& operator=(const Hdf5Handle&) = delete;
+    operator hid_t() const { return id_; }
+
+private:
+    hid_t id_;
+    herr_t (*close_)(hid_t);
+};
+
+// One file with a [time, rows, cols] dataset per channel, grown by one
+// frame at a time. HDF5 chunks are row-major and edge chunks are stored
+// clipped, so tiles are transposed and written at their exact size.
+class Hdf5Sink : public FieldStreamSink {
+public:
+    Hdf5Sink(const std::string& path, const std::vector<std::string>& channels,
+             const FieldStreamWriter::Options& options)
+        : channels_(channels), options_(options) {
+        std::lock_guard<std::mutex> lock(hdf5Mutex());
+        file_ = H5Fcreate(path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+        if (file_ < 0) {
+            throw std::runtime_error("Cannot create HDF5 file " + path);
+        }
+    }
+
+    ~Hdf5Sink() override {
+        std::lock_guard<std::mutex> lock(hdf5Mutex());
+        for (hid_t set : datasets_) {
+            H5Dclose(set);
+        }
+        H5Fclose(file_);
+    }
+
+    void begin(int rows, int cols) override {
+        std::lock_guard<std::mutex> lock(hdf5Mutex());
+        rows_ = rows;
+        cols_ = cols;
+        const int chunk_rows = std::min(options_.chunk_rows, rows);
+        const int chunk_cols = std::min(options_.chunk_cols, cols);
+        tiles_ = tiles(rows, cols, chunk_rows, chunk_cols);
+        tile_.resize(static_cast<std::size_t>(chunk_rows) * chunk_cols);
+
+        const hsize_t dims[3] = {0, static_cast<hsize_t>(rows), static_cast<hsize_t>(cols)};
+        const hsize_t max_dims[3] = {H5S_UNLIMITED, dims[1], dims[2]};
+        const hsize_t chunk[3] = {1, static_cast<hsize_t>(chunk_rows), static_cast<hsize_t>(chunk_cols)};
+        for (const auto& channel : channels_) {
+            datasets_.push_back(createDataset(channel, 3, dims, max_dims, chunk));
+        }
+        const hsize_t time_max = H5S_UNLIMITED;
+        const hsize_t time_chunk = 1024;
+        datasets_.push_back(createDataset("time", 1, dims, &time_max, &time_chunk));
+    }
+
+    std::size_t writeFrame(std::size_t index, double time, const std::vector<FieldSnapshot>& fields) override {
+        std::lock_guard<std::mutex> lock(hdf5Mutex());
+        const hsize_t extent[3] = {index + 1, static_cast<hsize_t>(rows_), static_cast<hsize_t>(cols_)};
+        for (std::size_t k = 0; k < channels_.size(); ++k) {
+            checkHdf5(H5Dset_extent(datasets_[k], extent), "extend");
+            Hdf5Handle file_space(H5Dget_space(datasets_[k]), H5Sclose, "dataspace");
+            for (const Tile& t : tiles_) {
+                fields[k].copyBlock(t.row, t.col, t.rows, t.cols, tile_.data(), t.cols, true);
+                const hsize_t start[3] = {index, static_cast<hsize_t>(t.row), static_cast<hsize_t>(t.col)};
+                const hsize_t count[3] = {1, static_cast<hsize_t>(t.rows), static_cast<hsize_t>(t.cols)};
+                checkHdf5(H5Sselect_hyperslab(file_space, H5S_SELECT_SET, start, nullptr, count, nullptr),
+                          "select");
+                Hdf5Handle memory_space(H5Screate_simple(3, count, nullptr), H5Sclose, "dataspace");
+                checkHdf5(H5Dwrite(datasets_[k], H5T_NATIVE_DOUBLE, memory_space, file_space, H5P_DEFAULT,
+                                   tile_.data()),
+                          "write");
+            }
+        }
+
+        const hid_t times = datasets_.back();
+        checkHdf5(H5Dset_extent(times, extent), "extend");
+        Hdf5Handle file_space(H5Dget_space(times), H5Sclose, "dataspace");
+        const hsize_t start = index, count = 1;
+        checkHdf5(H5Sselect_hyperslab(file_space, H5S_SELECT_SET, &start, nullptr, &count, nullptr), "select");
+        Hdf5Handle memory_space(H5Screate_simple(1, &count, nullptr), H5Sclose, "dataspace");
+        checkHdf5(H5Dwrite(times, H5T_NATIVE_DOUBLE, memory_space, file_space, H5P_DEFAULT, &time), "write");
+
+        std::size_t total = 0;
+        for (hid_t set : datasets_) {
+            total += H5Dget_storage_size(set);
+        }
+        const std::size_t stored = total - stored_;
+        stored_ = total;
+        return stored;
+    }
+
+    void finish() override {
+        std::lock_guard<std::mutex> lock(hdf5Mutex());
+        checkHdf5(H5Fflush(file_, H5F_SCOPE_LOCAL), "flush");
+    }
+
+private:
+    hid_t createDataset(const std::string& name, int rank, const hsize_t* dims, const hsize_t* max_dims,
+                        const hsize_t* chunk) {
+        Hdf5Handle space(H5Screate_simple(rank, dims, max_dims), H5Sclose, "dataspace");
+        Hdf5Handle properties(H5Pcreate(H5P_DATASET_CREATE), H5Pclose, "property list");
+        checkHdf5(H5Pset_chunk(properties, rank, chunk), "chunking");
+        if (options_.compression_level > 0) {
+            checkHdf5(H5Pset_deflate(properties, std::min(options_.compression_level, 9)), "deflate");
+        }
+        hid_t set = H5Dcreate2(file_, name.c_str(), H5T_IEEE_F64LE, space, H5P_DEFAULT, properties, H5P_DEFAULT);
+        if (set < 0) {
+            throw std::runtime_error("Cannot create HDF5 dataset " + name);
+        }
+        return set;
+    }
+
+    std::vector<std::string> channels_;
+    FieldStreamWriter::Options options_;
+    hid_t file_ = -1;
+    std::vector<hid_t> datasets_; // Channels, then time
+    int rows_ = 0;
+    int cols_ = 0;
+    std::vector<Tile> tiles_;
+    std::vector<double> tile_;
+    std::size_t stored_ = 0;
+};
+#endif
+
+} // namespace
+
+bool FieldStreamWriter::supports(Format format) {
+#ifdef SEMIPRO_HAVE_HDF5
+    return format == Format::ZARR || format == Format::HDF5;
+#else
+    return format == Format::ZARR;
+#endif
+}
+
+FieldStreamWriter::FieldStreamWriter(const std::string& path, const std::vector<std::string>& channels)
+    : FieldStreamWriter(path, channels, Options()) {}
+
+FieldStreamWriter::FieldStreamWriter(const std::string& path, const std::vector<std::string>& channels,
+                                     const Options& options)
+    : path_(path), channels_(channels), options_(options) {
+    if (channels_.empty()) {
+        throw std::invalid_argument("FieldStreamWriter needs at least one channel");
+    }
+    std::unordered_set<std::string> seen;
+    for (const auto& channel : channels_) {
+        // Channel names become array names, next to the "time" array
+        if (channel.empty() || channel == "time" || channel[0] == '.' ||
+            channel.find_first_of("/\\") != std::string::npos || !seen.insert(channel).second) {
+            throw std::invalid_argument("Invalid or duplicate stream channel: '" + channel + "'");
+        }
+    }
+    if (options_.chunk_rows <= 0 || options_.chunk_cols <= 0) {
+        throw std::invalid_argument("FieldStreamWriter chunk dimensions must be positive");
+    }
+    if (!supports(options_.format)) {
+        throw std::runtime_error("FieldStreamWriter: HDF5 output is not available in this build");
+    }
+
+    if (options_.format == Format::HDF5) {
+#ifdef SEMIPRO_HAVE_HDF5
+        sink_ = std::make_unique<Hdf5Sink>(path_, channels_, options_);
+#endif
+    } else {
+        sink_ = std::make_unique<ZarrSink>(path_, channels_, options_);
+    }
+    thread_ = std::thread(&FieldStreamWriter::run, this);
+}
+
+FieldStreamWriter::~FieldStreamWriter() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+std::vector<int> FieldStreamWriter::resolveChannels(const FieldStore& store) const {
+    if (store.cellCount() == 0) {
+        throw std::invalid_argument("FieldStreamWriter: the field store has no shape");
+    }
+    std::vector<int> indices;
+    for (const auto& channel : channels_) {
+        int index = store.channelIndex(channel);
+        if (index < 0) {
+            throw std::invalid_argument("FieldStreamWriter: unknown channel '" + channel + "'");
+        }
+        indices.push_back(index);
+    }
+    return indices;
+}
+
+void FieldStreamWriter::append(const FieldStore& store, double time) {
+    Frame frame;
+    frame.time = time;
+    for (int index : resolveChannels(store)) {
+        frame.fields.push_back(store.snapshot(index));
+    }
+    frame.bytes = store.cellCount() * sizeof(double) * channels_.size();
+    enqueue(std::move(frame), store.rows(), store.cols());
+}
+
+void FieldStreamWriter::append(const Wafer& wafer, double time) {
+    const FieldStore& store = wafer.getFieldStore();
+    Frame frame;
+    frame.time = time;
+    for (int index : resolveChannels(store)) {
+        frame.fields.push_back(wafer.snapshotField(static_cast<Wafer::FieldChannel>(index)));
+    }
+    frame.bytes = store.cellCount() * sizeof(double) * channels_.size();
+    enqueue(std::move(frame), store.rows(), store.cols());
+}
+
+void FieldStreamWriter::enqueue(Frame frame, int rows, int cols) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    rethrowError();
+    if (closing_) {
+        throw std::logic_error("FieldStreamWriter: append after close");
+    }
+    if (rows_ < 0) {
+        rows_ = rows;
+        cols_ = cols;
+    } else if (rows != rows_ || cols != cols_) {
+        throw std::invalid_argument("FieldStreamWriter: frame shape differs from the first frame");
+    }
+    // A frame larger than the whole budget is let through once the queue is empty
+    drained_.wait(lock, [&] {
+        return !error_.empty() || queued_bytes_ == 0 || queued_bytes_ + frame.bytes <= options_.queue_bytes;
+    });
+    rethrowError();
+    queued_bytes_ += frame.bytes;
+    queue_.push_back(std::move(frame));
+    queued_.notify_one();
+}
+
+void FieldStreamWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    drained_.wait(lock, [this] { return !error_.empty() || (queue_.empty() && !writing_); });
+    rethrowError();
+}
+
+void FieldStreamWriter::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closing_) {
+            return;
+        }
+        closing_ = true;
+    }
+    queued_.notify_all();
+    thread_.join();
+    sink_.reset();
+    std::lock_guard<std::mutex> lock(mutex_);
+    rethrowError();
+}
+
+std::size_t FieldStreamWriter::framesQueued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size() + (writing_ ? 1 : 0);
+}
+
+std::size_t FieldStreamWriter::framesWritten() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frames_written_;
+}
+
+std::size_t FieldStreamWriter::bytesWritten() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_written_;
+}
+
+void FieldStreamWriter::rethrowError() const {
+    if (!error_.empty()) {
+        throw std::runtime_error("FieldStreamWriter " + path_ + ": " + error_);
+    }
+}
+
+void FieldStreamWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        queued_.wait(lock, [this] { return !queue_.empty() || closing_; });
+        if (queue_.empty()) {
+            break;
+        }
+        Frame frame = std::move(queue_.front());
+        queue_.pop_front();
+        writing_ = true;
+        const std::size_t index = frames_written_;
+        const int rows = rows_, cols = cols_;
+        lock.unlock();
+
+        std::string failure;
+        std::size_t stored = 0;
+        try {
+            if (index == 0) {
+                sink_->begin(rows, cols);
+            }
+            stored = sink_->writeFrame(index, frame.time, frame.fields);
+        } catch (const std::exception& e) {
+            failure = e.what();
+        }
+        frame.fields.clear();
+
+        lock.lock();
+        writing_ = false;
+        queued_bytes_ -= frame.bytes;
+        if (!failure.empty()) {
+            // Later frames are dropped; the producer sees the error on its next call
+            error_ = failure;
+            queued_bytes_ = 0;
+            queue_.clear();
+            drained_.notify_all();
+            return;
+        }
+        ++frames_written_;
+        bytes_written_ += stored;
+        drained_.notify_all();
+    }
+    lock.unlock();
+    try {
+        sink_->finish();
+    } catch (const std::exception& e) {
+        lock.lock();
+        error_ = e.what();
+    }
+}
@@ -0,0 +1,110 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef FIELD_STREAM_WRITER_HPP
+#define FIELD_STREAM_WRITER_HPP
+
+#include "field_store.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Wafer;
+class FieldStreamSink; // Format backend, see field_stream_writer.cpp
+
+// Streams a time series of FieldStore channels to a chunked array store
+// from a background thread.
+//
+// append() takes copy-on-write snapshots of the channels and returns at
+// once. The writer thread cuts each frame into chunk_rows x chunk_cols
+// tiles, compresses them and writes them out. It reads the tiles straight
+// from the store, and a channel is copied only if the simulation writes
+// to it before its frame has been written. Each channel becomes a
+// [time, rows, cols] array with one tile per chunk. A 1-D "time" array
+// holds the frame times.
+//
+// At most queue_bytes of field data wait in the queue. Past that,
+// append() blocks, so a slow disk throttles the producer instead of
+// filling memory. A write error stops the writer and is rethrown as
+// std::runtime_error by the next append(), flush() or close().
+//
+// ZARR writes a Zarr v2 directory store that zarr-python and xarray can
+// open; chunks are zlib-compressed in "F" order. HDF5 writes one file of
+// extendible, chunked, deflate-compressed datasets. It is only available
+// in builds with SEMIPRO_HAVE_HDF5.
+class FieldStreamWriter {
+public:
+    enum class Format { ZARR, HDF5 };
+
+    struct Options {
+        Format format = Format::ZARR;
+        int chunk_rows = 256;
+        int chunk_cols = 256;
+        int compression_level = 4;             // zlib/deflate level, 0 stores chunks raw
+        std::size_t queue_bytes = 256u << 20;  // Queued field data before append() blocks
+    };
+
+    static bool supports(Format format);
+
+    // Creates (or truncates) the store at `path`; throws std::runtime_error
+    // if it cannot be created or the format is not built in
+    FieldStreamWriter(const std::string& path, const std::vector<std::string>& channels);
+    FieldStreamWriter(const std::string& path, const std::vector<std::string>& channels,
+                      const Options& options);
+    // Writes what is still queued; errors are dropped, call close() to see them
+    ~FieldStreamWriter();
+    FieldStreamWriter(const FieldStreamWriter&) = delete;
+    FieldStreamWriter& operator=(const FieldStreamWriter&) = delete;
+
+    // Queues one frame. Every frame must have the shape of the first one
+    // (std::invalid_argument), and every channel must exist in the store.
+    void append(const FieldStore& store, double time);
+    // Same, going through Wafer so the photoresist pattern is current
+    void append(const Wafer& wafer, double time);
+    // Blocks until every queued frame has been written
+    void flush();
+    // Writes the remaining frames and closes the store; later calls are no-ops
+    void close();
+
+    const std::string& path() const { return path_; }
+    const std::vector<std::string>& channels() const { return channels_; }
+    std::size_t framesQueued() const;
+    std::size_t framesWritten() const;
+    std::size_t bytesWritten() const; // Stored bytes, after compression
+
+private:
+    struct Frame {
+        double time = 0.0;
+        std::vector<FieldSnapshot> fields;
+        std::size_t bytes = 0;
+    };
+
+    std::vector<int> resolveChannels(const FieldStore& store) const;
+    void enqueue(Frame frame, int rows, int cols);
+    void run();
+    void rethrowError() const; // Expects mutex_ held
+
+    std::string path_;
+    std::vector<std::string> channels_;
+    Options options_;
+    std::unique_ptr<FieldStreamSink> sink_;
+    int rows_ = -1;
+    int cols_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable queued_;  // Producer to writer
+    std::condition_variable drained_; // Writer to producer
+    std::deque<Frame> queue_;
+    std::size_t queued_bytes_ = 0;
+    bool writing_ = false;
+    bool closing_ = false;
+    std::string error_;
+    std::size_t frames_written_ = 0;
+    std::size_t bytes_written_ = 0;
+    std::thread thread_;
+};
+
+#endif // FIELD_STREAM_WRITER_HPP
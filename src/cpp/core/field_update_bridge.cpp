@@ -0,0 +1,70 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "field_update_bridge.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+FieldRect FieldRect::united(const FieldRect& other) const {
+    if (empty()) return other;
+    if (other.empty()) return *this;
+    FieldRect result;
+    result.row = std::min(row, other.row);
+    result.col = std::min(col, other.col);
+    result.rows = std::max(row + rows, other.row + other.rows) - result.row;
+    result.cols = std::max(col + cols, other.col + other.cols) - result.col;
+    return result;
+}
+
+void FieldUpdateBridge::publish(const FieldStore& fields, int channel, const FieldRect& rect) {
+    if (rect.row < 0 || rect.col < 0 || rect.row + rect.rows > fields.rows() ||
+        rect.col + rect.cols > fields.cols()) {
+        throw std::invalid_argument("Dirty rectangle lies outside field '" + fields.channelName(channel) + "'");
+    }
+    if (rect.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++published_;
+    auto pending = std::find_if(pending_.begin(), pending_.end(),
+                                [&](const FieldUpdate& u) { return u.channel == channel; });
+    if (pending == pending_.end()) {
+        pending = pending_.insert(pending_.end(), FieldUpdate());
+        pending->channel = channel;
+    } else if (pending->field_rows == fields.rows() && pending->field_cols == fields.cols()) {
+        pending->rect = pending->rect.united(rect);
+    } else {
+        pending->rect = FieldRect();
+    }
+    if (pending->rect.empty()) {
+        pending->rect = rect;
+    }
+    pending->field_rows = fields.rows();
+    pending->field_cols = fields.cols();
+    pending->version = fields.version(channel);
+    const FieldRect& r = pending->rect;
+    pending->values.resize(static_cast<std::size_t>(r.rows) * r.cols);
+    Eigen::Map<Eigen::ArrayXXf>(pending->values.data(), r.rows, r.cols) =
+        fields.view(channel).block(r.row, r.col, r.rows, r.cols).cast<float>();
+}
+
+void FieldUpdateBridge::publish(const FieldStore& fields, int channel) {
+    publish(fields, channel, FieldRect{0, 0, fields.rows(), fields.cols()});
+}
+
+std::vector<FieldUpdate> FieldUpdateBridge::take() {
+    std::vector<FieldUpdate> updates;
+    std::lock_guard<std::mutex> lock(mutex_);
+    updates.swap(pending_);
+    return updates;
+}
+
+std::size_t FieldUpdateBridge::pendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
+std::uint64_t FieldUpdateBridge::publishedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return published_;
+}
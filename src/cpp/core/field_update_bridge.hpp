@@ -0,0 +1,60 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef FIELD_UPDATE_BRIDGE_HPP
+#define FIELD_UPDATE_BRIDGE_HPP
+
+#include "field_store.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Cells [row, row + rows) x [col, col + cols) of a field
+struct FieldRect {
+    int row = 0;
+    int col = 0;
+    int rows = 0;
+    int cols = 0;
+
+    bool empty() const { return rows <= 0 || cols <= 0; }
+    // Smallest rectangle holding both
+    FieldRect united(const FieldRect& other) const;
+};
+
+// One rectangle of a channel, copied out of the store as floats
+struct FieldUpdate {
+    int channel = 0;
+    int field_rows = 0;        // Shape of the whole field when published
+    int field_cols = 0;
+    FieldRect rect;
+    std::uint64_t version = 0; // FieldStore::version of the channel when published
+    std::vector<float> values; // Column-major over rect
+};
+
+// Hands the regions of fields a simulation changed to a renderer on
+// another thread, without either side waiting on the other.
+//
+// A simulation step publishes the rectangles it dirtied. publish() copies
+// them out of the store under a lock held only for that copy; a channel
+// that still has an update pending has it widened to the union of both
+// rectangles and recopied, so pending data never exceeds one field per
+// channel and the renderer always gets the latest values. A published
+// shape different from the pending one replaces it. take() swaps the
+// pending updates out in publish order.
+class FieldUpdateBridge {
+public:
+    // Throws std::invalid_argument if rect is not inside the field
+    void publish(const FieldStore& fields, int channel, const FieldRect& rect);
+    void publish(const FieldStore& fields, int channel); // Whole field
+
+    std::vector<FieldUpdate> take();
+
+    std::size_t pendingCount() const;
+    std::uint64_t publishedCount() const; // publish() calls so far
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<FieldUpdate> pending_; // At most one per channel
+    std::uint64_t published_ = 0;
+};
+
+#endif // FIELD_UPDATE_BRIDGE_HPP
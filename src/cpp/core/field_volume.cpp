@@ -0,0 +1,153 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "field_volume.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+FieldVolume::FieldVolume(int rows, int cols, int slices, float value)
+    : rows_(rows), cols_(cols), slices_(slices) {
+  if (rows < 1 || cols < 1 || slices < 1) {
+    throw std::invalid_argument("FieldVolume: dimensions must be positive");
+  }
+  values_.assign(static_cast<std::size_t>(rows) * cols * slices, value);
+}
+
+FieldVolume FieldVolume::fromPlanes(const std::vector<Eigen::ArrayXXd>& planes) {
+  if (planes.empty()) {
+    throw std::invalid_argument("FieldVolume: no planes");
+  }
+  FieldVolume volume(static_cast<int>(planes[0].rows()), static_cast<int>(planes[0].cols()),
+                     static_cast<int>(planes.size()));
+  for (int s = 0; s < volume.slices_; ++s) {
+    if (planes[s].rows() != volume.rows_ || planes[s].cols() != volume.cols_) {
+      throw std::invalid_argument("FieldVolume: planes differ in shape");
+    }
+    Eigen::Map<Eigen::ArrayXXf>(volume.data() + volume.index(0, 0, s), volume.rows_, volume.cols_) =
+        planes[s].cast<float>();
+  }
+  return volume;
+}
+
+FieldVolume FieldVolume::fromProfile(const Eigen::ArrayXXd& lateral, const DepthMesh& mesh,
+                                     const Eigen::ArrayXd& profile, int slices) {
+  if (mesh.empty() || profile.size() != mesh.size()) {
+    throw std::invalid_argument("FieldVolume: profile does not match its mesh");
+  }
+  FieldVolume volume(static_cast<int>(lateral.rows()), static_cast<int>(lateral.cols()), slices);
+  const Eigen::ArrayXd depth = mesh.remap(profile, DepthMesh::cells(mesh.upper(), slices));
+  const Eigen::ArrayXXf plane = lateral.cast<float>();
+  for (int s = 0; s < slices; ++s) {
+    Eigen::Map<Eigen::ArrayXXf>(volume.data() + volume.index(0, 0, s), volume.rows_, volume.cols_) =
+        plane * static_cast<float>(depth(s));
+  }
+  return volume;
+}
+
+std::pair<float, float> FieldVolume::range() const {
+  if (values_.empty()) {
+    return {0.0f, 0.0f};
+  }
+  const auto bounds = std::minmax_element(values_.begin(), values_.end());
+  return {*bounds.first, *bounds.second};
+}
+
+TransferFunction::TransferFunction(std::vector<Point> points) : points_(std::move(points)) {
+  if (points_.empty()) {
+    throw std::invalid_argument("TransferFunction: no control points");
+  }
+  for (std::size_t k = 1; k < points_.size(); ++k) {
+    if (!(points_[k].value > points_[k - 1].value)) {
+      throw std::invalid_argument("TransferFunction: control values must increase");
+    }
+  }
+}
+
+TransferFunction TransferFunction::heat(float low, float high) {
+  const float span = high - low;
+  return TransferFunction({{low, {0.0f, 0.0f, 0.0f, 0.0f}},
+                           {low + span / 3.0f, {0.0f, 0.0f, 1.0f, 0.1f}},
+                           {low + 2.0f * span / 3.0f, {1.0f, 0.0f, 0.0f, 0.4f}},
+                           {high, {1.0f, 1.0f, 0.0f, 1.0f}}});
+}
+
+std::array<float, 4> TransferFunction::operator()(float value) const {
+  if (value <= points_.front().value) {
+    return points_.front().rgba;
+  }
+  if (value >= points_.back().value) {
+    return points_.back().rgba;
+  }
+  const auto upper = std::upper_bound(points_.begin(), points_.end(), value,
+                                      [](float v, const Point& p) { return v < p.value; });
+  const Point& a = *(upper - 1);
+  const Point& b = *upper;
+  const float t = (value - a.value) / (b.value - a.value);
+  std::array<float, 4> rgba;
+  for (int c = 0; c < 4; ++c) {
+    rgba[c] = a.rgba[c] + t * (b.rgba[c] - a.rgba[c]);
+  }
+  return rgba;
+}
+
+std::vector<std::array<float, 4>> TransferFunction::table(int size) const {
+  std::vector<std::array<float, 4>> entries(std::max(size, 1));
+  const float step = size > 1 ? (high() - low()) / (size - 1) : 0.0f;
+  for (int k = 0; k < static_cast<int>(entries.size()); ++k) {
+    entries[k] = (*this)(low() + step * k);
+  }
+  return entries;
+}
+
+BrickMap::BrickMap(const FieldVolume& volume)
+    : rows_((volume.rows() + kBrick - 1) / kBrick), cols_((volume.cols() + kBrick - 1) / kBrick),
+      slices_((volume.slices() + kBrick - 1) / kBrick) {
+  const std::size_t bricks = static_cast<std::size_t>(rows_) * cols_ * slices_;
+  low_.resize(bricks);
+  high_.resize(bricks);
+#pragma omp parallel for schedule(static)
+  for (long b = 0; b < static_cast<long>(bricks); ++b) {
+    const int br = static_cast<int>(b % rows_);
+    const int bc = static_cast<int>((b / rows_) % cols_);
+    const int bs = static_cast<int>(b / (static_cast<long>(rows_) * cols_));
+    // The brick's cells and a border of one
+    const int r0 = std::max(br * kBrick - 1, 0), r1 = std::min((br + 1) * kBrick + 1, volume.rows());
+    const int c0 = std::max(bc * kBrick - 1, 0), c1 = std::min((bc + 1) * kBrick + 1, volume.cols());
+    const int s0 = std::max(bs * kBrick - 1, 0), s1 = std::min((bs + 1) * kBrick + 1, volume.slices());
+    float low = volume(r0, c0, s0), high = low;
+    for (int s = s0; s < s1; ++s) {
+      for (int c = c0; c < c1; ++c) {
+        const float* column =
+            volume.data() + static_cast<std::size_t>(volume.rows()) * (c + static_cast<std::size_t>(volume.cols()) * s);
+        for (int r = r0; r < r1; ++r) {
+          low = std::min(low, column[r]);
+          high = std::max(high, column[r]);
+        }
+      }
+    }
+    low_[b] = low;
+    high_[b] = high;
+  }
+}
+
+std::vector<uint8_t> BrickMap::occupancy(const TransferFunction& transfer, int table_size) const {
+  const std::vector<std::array<float, 4>> table = transfer.table(table_size);
+  const int last = static_cast<int>(table.size()) - 1;
+  // visible[k]: entries before k that are not transparent
+  std::vector<int> visible(table.size() + 1, 0);
+  for (int k = 0; k <= last; ++k) {
+    visible[k + 1] = visible[k] + (table[k][3] > 0.0f ? 1 : 0);
+  }
+  const float span = transfer.high() - transfer.low();
+  const float scale = span > 0.0f ? last / span : 0.0f;
+  // Filtered lookups between two entries blend both
+  auto entry = [&](float value, bool up) {
+    const float x = (value - transfer.low()) * scale;
+    const float e = up ? std::ceil(x) : std::floor(x);
+    return e <= 0.0f ? 0 : (e >= last ? last : static_cast<int>(e));
+  };
+  std::vector<uint8_t> occupied(low_.size());
+  for (std::size_t b = 0; b < low_.size(); ++b) {
+    occupied[b] = visible[entry(high_[b], true) + 1] > visible[entry(low_[b], false)] ? 1 : 0;
+  }
+  return occupied;
+}
@@ -0,0 +1,115 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "depth_mesh.hpp"
+#include <Eigen/Dense>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Scalar field over a rows x cols x slices block of cells, slices running
+// down from the surface. Stored as float with rows fastest, then columns,
+// then slices: each slice is a column-major rows x cols plane, the order
+// of a 3D texture whose width runs over rows.
+class FieldVolume {
+public:
+  FieldVolume() = default;
+  // Throws std::invalid_argument for a dimension below 1
+  FieldVolume(int rows, int cols, int slices, float value = 0.0f);
+
+  // One slice per plane, top first, as LayeredHeatSolver::solve returns
+  // them; throws std::invalid_argument for no planes or unequal shapes
+  static FieldVolume fromPlanes(const std::vector<Eigen::ArrayXXd>& planes);
+  // lateral(row, col) times the profile's average over each of `slices`
+  // equal cells from the surface to the mesh's upper bound, so the dose
+  // under every cell is kept (see DepthMesh::remap)
+  static FieldVolume fromProfile(const Eigen::ArrayXXd& lateral, const DepthMesh& mesh,
+                                 const Eigen::ArrayXd& profile, int slices);
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  int slices() const { return slices_; }
+  std::size_t size() const { return values_.size(); }
+  bool empty() const { return values_.empty(); }
+
+  float& operator()(int row, int col, int slice) { return values_[index(row, col, slice)]; }
+  float operator()(int row, int col, int slice) const { return values_[index(row, col, slice)]; }
+  float* data() { return values_.data(); }
+  const float* data() const { return values_.data(); }
+  Eigen::Map<const Eigen::ArrayXXf> slice(int s) const {
+    return Eigen::Map<const Eigen::ArrayXXf>(values_.data() + index(0, 0, s), rows_, cols_);
+  }
+  // Smallest and largest value
+  std::pair<float, float> range() const;
+
+private:
+  std::size_t index(int row, int col, int slice) const {
+    return static_cast<std::size_t>(row) +
+           static_cast<std::size_t>(rows_) * (col + static_cast<std::size_t>(cols_) * slice);
+  }
+
+  int rows_ = 0;
+  int cols_ = 0;
+  int slices_ = 0;
+  std::vector<float> values_;
+};
+
+// Colour and opacity over a value range, linear between control points
+// and held at the end points beyond them, sampled into a lookup table
+// for rendering.
+class TransferFunction {
+public:
+  struct Point {
+    float value;
+    std::array<float, 4> rgba; // Each in [0, 1]
+  };
+
+  // Throws std::invalid_argument for no points or values that do not
+  // increase strictly
+  explicit TransferFunction(std::vector<Point> points);
+  // Transparent at `low`, through blue and red to opaque yellow at `high`
+  static TransferFunction heat(float low, float high);
+
+  float low() const { return points_.front().value; }
+  float high() const { return points_.back().value; }
+  const std::vector<Point>& points() const { return points_; }
+  std::array<float, 4> operator()(float value) const;
+  // `size` entries evenly spaced over [low, high], ends included
+  std::vector<std::array<float, 4>> table(int size) const;
+
+private:
+  std::vector<Point> points_;
+};
+
+// Value range of each kBrick^3 brick of a volume, for empty-space
+// skipping. Each range also takes in the cells bordering the brick, so a
+// brick that looks empty stays empty under trilinear filtering from its
+// neighbours. Bricks at the far faces may be partial.
+class BrickMap {
+public:
+  static constexpr int kBrick = 8;
+
+  BrickMap() = default;
+  explicit BrickMap(const FieldVolume& volume);
+
+  int rows() const { return rows_; } // Bricks along each axis
+  int cols() const { return cols_; }
+  int slices() const { return slices_; }
+  std::size_t size() const { return low_.size(); }
+  // Brick ranges, in the volume's order
+  const std::vector<float>& low() const { return low_; }
+  const std::vector<float>& high() const { return high_; }
+
+  // One byte per brick, 1 where the transfer function, sampled as a
+  // `table_size` entry table, is not transparent anywhere in the brick's
+  // range. Values beyond the function's range take its end entries.
+  std::vector<uint8_t> occupancy(const TransferFunction& transfer, int table_size = 256) const;
+
+private:
+  int rows_ = 0;
+  int cols_ = 0;
+  int slices_ = 0;
+  std::vector<float> low_;
+  std::vector<float> high_;
+};
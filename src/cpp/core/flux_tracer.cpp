@@ -0,0 +1,576 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "flux_tracer.hpp"
+#include "philox.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+constexpr int kLanes = 8;
+constexpr int kLeafSize = 4;
+constexpr int kStackDepth = 64;
+constexpr int kChunks = 32;               // Summed apart and then in order, so totals never vary with threads
+constexpr int kMaxSegments = 256;         // Straight runs per ray, between walls and bounces
+constexpr double kRebuildFraction = 0.25; // Of the disks changed, past which patching stops paying
+constexpr double kRetrace = 0.5;          // Cells the fastest element moves between traces
+constexpr double kMinWeight = 1e-3;       // Below which a re-emitted ray is dropped
+constexpr double kPlaneTolerance = 0.5;   // Cells off a disk's plane a hit may land and still count
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+double surfaceArea(const double lo[3], const double hi[3]) {
+  const double x = hi[0] - lo[0], y = hi[1] - lo[1], z = hi[2] - lo[2];
+  return x * y + y * z + z * x;
+}
+
+// Unit vector with polar angle acos(cos_theta) and azimuth phi about axis
+Eigen::Vector3d around(const Eigen::Vector3d& axis, double cos_theta, double phi) {
+  const Eigen::Vector3d helper = std::abs(axis.x()) < 0.9 ? Eigen::Vector3d::UnitX() : Eigen::Vector3d::UnitY();
+  const Eigen::Vector3d u = axis.cross(helper).normalized();
+  const Eigen::Vector3d v = axis.cross(u);
+  const double sin_theta = std::sqrt(std::max(0.0, 1.0 - cos_theta * cos_theta));
+  return sin_theta * std::cos(phi) * u + sin_theta * std::sin(phi) * v + cos_theta * axis;
+}
+
+} // namespace
+
+// Eight rays side by side, one per lane, so each node's slab test and each
+// disk's hit test run across the lanes at once
+struct FluxTracer::Packet {
+  alignas(64) double ox[kLanes], oy[kLanes], oz[kLanes];
+  alignas(64) double dx[kLanes], dy[kLanes], dz[kLanes];
+  alignas(64) double ix[kLanes], iy[kLanes], iz[kLanes]; // Inverse directions
+  alignas(64) double t[kLanes];                           // Nearest hit so far
+  int hit[kLanes];                                        // Its slot, or -1
+  int live[kLanes];
+  double weight[kLanes];
+  int bounces[kLanes];
+  int segments[kLanes];
+
+  void aim(int l, const Eigen::Vector3d& origin, const Eigen::Vector3d& direction) {
+    ox[l] = origin.x();
+    oy[l] = origin.y();
+    oz[l] = origin.z();
+    dx[l] = direction.x();
+    dy[l] = direction.y();
+    dz[l] = direction.z();
+    // A tiny stand-in for a zero component keeps the slab test finite
+    ix[l] = 1.0 / (dx[l] != 0.0 ? dx[l] : 1e-300);
+    iy[l] = 1.0 / (dy[l] != 0.0 ? dy[l] : 1e-300);
+    iz[l] = 1.0 / (dz[l] != 0.0 ? dz[l] : 1e-300);
+  }
+};
+
+FluxTracer::FluxTracer(std::size_t rays_per_element, std::uint64_t seed)
+    : rays_per_element_(rays_per_element), seed_(seed) {
+  if (rays_per_element == 0) {
+    throw std::invalid_argument("Flux tracer needs at least one ray per element");
+  }
+}
+
+void FluxTracer::update(const LevelSet& surface) {
+  const bool same_grid = rows_ == surface.rows() && cols_ == surface.cols() && layers_ == surface.layers() &&
+                         spacing_ == surface.spacing() && z_min_ == surface.zMin();
+  rows_ = surface.rows();
+  cols_ = surface.cols();
+  layers_ = surface.layers();
+  spacing_ = surface.spacing();
+  z_min_ = surface.zMin();
+  radius_ = 0.5 * std::sqrt(3.0) * spacing_;
+  ++generation_;
+
+  const std::vector<LevelSet::Site> sites = surface.surface();
+  elements_.clear();
+  elements_.reserve(sites.size());
+  top_ = surface.zMin();
+  for (const LevelSet::Site& site : sites) {
+    const Eigen::Vector3d center(site.surface.x() * spacing_, site.surface.y() * spacing_, site.surface.z());
+    elements_.push_back({center, site.normal, site.i, site.j, site.k});
+    top_ = std::max(top_, center.z());
+  }
+  top_ += radius_ + spacing_;
+  if (!same_grid || nodes_.empty()) {
+    rebuild();
+    return;
+  }
+
+  // Disks whose voxel is still on the surface keep their slot and only
+  // move; the rest leave their leaves, and new ones descend into the leaf
+  // whose box grows least
+  std::vector<char> seen(slot_elements_.size(), 0);
+  std::vector<int> added;
+  for (int n = 0; n < static_cast<int>(elements_.size()); ++n) {
+    const Element& element = elements_[n];
+    auto it = slot_of_.find(key(element.i, element.j, element.k));
+    if (it == slot_of_.end()) {
+      added.push_back(n);
+      continue;
+    }
+    slot_elements_[it->second] = element;
+    slot_element_[it->second] = n;
+    seen[it->second] = 1;
+  }
+  std::vector<int> removed;
+  for (int slot = 0; slot < static_cast<int>(seen.size()); ++slot) {
+    if (slot_element_[slot] >= 0 && !seen[slot]) {
+      removed.push_back(slot);
+    }
+  }
+  if (added.size() + removed.size() > kRebuildFraction * elements_.size()) {
+    rebuild();
+    return;
+  }
+  for (int slot : removed) {
+    std::vector<int>& leaf = nodes_[slot_leaf_[slot]].slots;
+    leaf.erase(std::find(leaf.begin(), leaf.end(), slot));
+    const Element& element = slot_elements_[slot];
+    slot_of_.erase(key(element.i, element.j, element.k));
+    slot_element_[slot] = -1;
+    free_slots_.push_back(slot);
+  }
+  for (int n : added) {
+    int slot;
+    if (!free_slots_.empty()) {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    } else {
+      slot = static_cast<int>(slot_elements_.size());
+      slot_elements_.emplace_back();
+      slot_element_.push_back(-1);
+      slot_leaf_.push_back(-1);
+    }
+    const Element& element = elements_[n];
+    slot_elements_[slot] = element;
+    slot_element_[slot] = n;
+    slot_of_[key(element.i, element.j, element.k)] = slot;
+    insert(slot);
+  }
+  refit();
+  ++statistics_.refits;
+  statistics_.insertions += added.size();
+  statistics_.removals += removed.size();
+}
+
+void FluxTracer::rebuild() {
+  const int n = static_cast<int>(elements_.size());
+  slot_elements_ = elements_;
+  slot_element_.resize(n);
+  std::iota(slot_element_.begin(), slot_element_.end(), 0);
+  slot_leaf_.assign(n, -1);
+  free_slots_.clear();
+  slot_of_.clear();
+  for (int slot = 0; slot < n; ++slot) {
+    const Element& element = slot_elements_[slot];
+    slot_of_[key(element.i, element.j, element.k)] = slot;
+  }
+  nodes_.clear();
+  std::vector<int> slots(n);
+  std::iota(slots.begin(), slots.end(), 0);
+  build(slots, 0, n);
+  ++statistics_.rebuilds;
+}
+
+// Median split along the longest side of the disks' centers
+int FluxTracer::build(std::vector<int>& slots, int begin, int end) {
+  const int index = static_cast<int>(nodes_.size());
+  nodes_.emplace_back();
+  Node node;
+  std::fill(node.lo, node.lo + 3, kInfinity);
+  std::fill(node.hi, node.hi + 3, -kInfinity);
+  Eigen::Vector3d low = Eigen::Vector3d::Constant(kInfinity), high = -low;
+  for (int n = begin; n < end; ++n) {
+    double lo[3], hi[3];
+    bounds(slots[n], lo, hi);
+    for (int a = 0; a < 3; ++a) {
+      node.lo[a] = std::min(node.lo[a], lo[a]);
+      node.hi[a] = std::max(node.hi[a], hi[a]);
+    }
+    low = low.cwiseMin(slot_elements_[slots[n]].center);
+    high = high.cwiseMax(slot_elements_[slots[n]].center);
+  }
+  if (end - begin <= kLeafSize) {
+    node.slots.assign(slots.begin() + begin, slots.begin() + end);
+    for (int slot : node.slots) {
+      slot_leaf_[slot] = index;
+    }
+    nodes_[index] = std::move(node);
+    return index;
+  }
+  int axis;
+  (high - low).maxCoeff(&axis);
+  const int middle = begin + (end - begin) / 2;
+  std::nth_element(slots.begin() + begin, slots.begin() + middle, slots.begin() + end,
+                   [&](int a, int b) { return slot_elements_[a].center[axis] < slot_elements_[b].center[axis]; });
+  node.left = build(slots, begin, middle);
+  node.right = build(slots, middle, end);
+  nodes_[index] = std::move(node);
+  return index;
+}
+
+void FluxTracer::insert(int slot) {
+  double lo[3], hi[3];
+  bounds(slot, lo, hi);
+  int index = 0;
+  while (nodes_[index].left >= 0) {
+    double best = kInfinity;
+    int next = nodes_[index].left;
+    for (int child : {nodes_[index].left, nodes_[index].right}) {
+      const Node& node = nodes_[child];
+      double merged_lo[3], merged_hi[3];
+      for (int a = 0; a < 3; ++a) {
+        merged_lo[a] = node.empty() ? lo[a] : std::min(node.lo[a], lo[a]);
+        merged_hi[a] = node.empty() ? hi[a] : std::max(node.hi[a], hi[a]);
+      }
+      const double growth = surfaceArea(merged_lo, merged_hi) - (node.empty() ? 0.0 : surfaceArea(node.lo, node.hi));
+      if (growth < best) {
+        best = growth;
+        next = child;
+      }
+    }
+    index = next;
+  }
+  nodes_[index].slots.push_back(slot);
+  slot_leaf_[slot] = index;
+  for (int a = 0; a < 3; ++a) {
+    nodes_[index].lo[a] = std::min(nodes_[index].lo[a], lo[a]);
+    nodes_[index].hi[a] = std::max(nodes_[index].hi[a], hi[a]);
+  }
+}
+
+// Children come after their parents, so one backward pass reaches every
+// node after its children
+void FluxTracer::refit() {
+  for (int index = static_cast<int>(nodes_.size()) - 1; index >= 0; --index) {
+    Node& node = nodes_[index];
+    std::fill(node.lo, node.lo + 3, kInfinity);
+    std::fill(node.hi, node.hi + 3, -kInfinity);
+    auto merge = [&](const double lo[3], const double hi[3]) {
+      for (int a = 0; a < 3; ++a) {
+        node.lo[a] = std::min(node.lo[a], lo[a]);
+        node.hi[a] = std::max(node.hi[a], hi[a]);
+      }
+    };
+    if (node.left < 0) {
+      for (int slot : node.slots) {
+        double lo[3], hi[3];
+        bounds(slot, lo, hi);
+        merge(lo, hi);
+      }
+    } else {
+      for (int child : {node.left, node.right}) {
+        if (!nodes_[child].empty()) {
+          merge(nodes_[child].lo, nodes_[child].hi);
+        }
+      }
+    }
+  }
+}
+
+// A disk of radius r facing n reaches r sqrt(1 - n_a^2) along axis a
+void FluxTracer::bounds(int slot, double lo[3], double hi[3]) const {
+  const Element& element = slot_elements_[slot];
+  for (int a = 0; a < 3; ++a) {
+    const double reach = radius_ * std::sqrt(std::max(0.0, 1.0 - element.normal[a] * element.normal[a]));
+    lo[a] = element.center[a] - reach;
+    hi[a] = element.center[a] + reach;
+  }
+}
+
+void FluxTracer::intersect(Packet& p) const {
+  const double r2 = radius_ * radius_;
+  int stack[kStackDepth];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const Node& node = nodes_[stack[--top]];
+    if (node.empty()) {
+      continue;
+    }
+    int any = 0;
+#pragma omp simd reduction(| : any)
+    for (int l = 0; l < kLanes; ++l) {
+      const double x0 = (node.lo[0] - p.ox[l]) * p.ix[l], x1 = (node.hi[0] - p.ox[l]) * p.ix[l];
+      const double y0 = (node.lo[1] - p.oy[l]) * p.iy[l], y1 = (node.hi[1] - p.oy[l]) * p.iy[l];
+      const double z0 = (node.lo[2] - p.oz[l]) * p.iz[l], z1 = (node.hi[2] - p.oz[l]) * p.iz[l];
+      const double near = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::min(z0, z1));
+      const double far = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::max(z0, z1));
+      any |= p.live[l] & (near <= far) & (far >= 0.0) & (near < p.t[l]);
+    }
+    if (!any) {
+      continue;
+    }
+    if (node.left >= 0) {
+      stack[top++] = node.left;
+      stack[top++] = node.right;
+      continue;
+    }
+    for (int slot : node.slots) {
+      const Element& e = slot_elements_[slot];
+      const double cx = e.center.x(), cy = e.center.y(), cz = e.center.z();
+      const double nx = e.normal.x(), ny = e.normal.y(), nz = e.normal.z();
+#pragma omp simd
+      for (int l = 0; l < kLanes; ++l) {
+        // Only a disk's front face, the side away from the solid, is hit
+        const double facing = p.dx[l] * nx + p.dy[l] * ny + p.dz[l] * nz;
+        const double t = ((cx - p.ox[l]) * nx + (cy - p.oy[l]) * ny + (cz - p.oz[l]) * nz) / facing;
+        const double px = p.ox[l] + t * p.dx[l] - cx;
+        const double py = p.oy[l] + t * p.dy[l] - cy;
+        const double pz = p.oz[l] + t * p.dz[l] - cz;
+        const bool take = p.live[l] && facing < 0.0 && t > 0.0 && t < p.t[l] && px * px + py * py + pz * pz <= r2;
+        p.t[l] = take ? t : p.t[l];
+        p.hit[l] = take ? slot : p.hit[l];
+      }
+    }
+  }
+}
+
+// Visits every disk facing against direction that point lands in
+template <typename Visit>
+void FluxTracer::covering(const Eigen::Vector3d& point, const Eigen::Vector3d& direction, Visit visit) const {
+  const double tolerance = kPlaneTolerance * spacing_;
+  const double r2 = radius_ * radius_;
+  int stack[kStackDepth];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const Node& node = nodes_[stack[--top]];
+    bool inside = !node.empty();
+    for (int a = 0; a < 3 && inside; ++a) {
+      inside = point[a] >= node.lo[a] - tolerance && point[a] <= node.hi[a] + tolerance;
+    }
+    if (!inside) {
+      continue;
+    }
+    if (node.left >= 0) {
+      stack[top++] = node.left;
+      stack[top++] = node.right;
+      continue;
+    }
+    for (int slot : node.slots) {
+      const Element& e = slot_elements_[slot];
+      const Eigen::Vector3d offset = point - e.center;
+      const double along = offset.dot(e.normal);
+      if (direction.dot(e.normal) < 0.0 && std::abs(along) <= tolerance &&
+          offset.squaredNorm() - along * along <= r2) {
+        visit(slot);
+      }
+    }
+  }
+}
+
+std::vector<double> FluxTracer::trace(const Source& source) const {
+  const int n = static_cast<int>(elements_.size());
+  std::vector<double> flux(n, 0.0);
+  if (n == 0) {
+    return flux;
+  }
+  const std::size_t rays = rays_per_element_ * n;
+  const long long packets = static_cast<long long>((rays + kLanes - 1) / kLanes);
+  const double x0 = -0.5 * spacing_, x1 = (rows_ - 0.5) * spacing_;
+  const double y0 = -0.5 * spacing_, y1 = (cols_ - 0.5) * spacing_;
+  const double ground = (x1 - x0) * (y1 - y0);
+  const double inverse_exponent = 1.0 / (source.exponent + 1.0);
+  const Philox4x32 rng(seed_);
+  const std::uint64_t stream = generation_ << 32;
+
+  const long long chunks = std::min<long long>(kChunks, packets);
+  std::vector<std::vector<double>> sums(chunks);
+
+#pragma omp parallel
+  {
+    std::vector<double> local;
+    Packet p;
+    std::uint64_t ray[kLanes];
+    std::uint32_t draws[kLanes];
+    auto draw = [&](int l) { return rng(ray[l], stream | draws[l]++); };
+    // A hit lands on the disks around it, and on those across a side of
+    // the grid from it in the mirror image beyond
+    auto deposit = [&](const Eigen::Vector3d& point, const Eigen::Vector3d& direction, double weight) {
+      double xs[3] = {point.x()}, ys[3] = {point.y()};
+      double sx[3] = {1.0}, sy[3] = {1.0};
+      int nx = 1, ny = 1;
+      if (point.x() - x0 < radius_) {
+        xs[nx] = 2.0 * x0 - point.x();
+        sx[nx++] = -1.0;
+      }
+      if (x1 - point.x() < radius_) {
+        xs[nx] = 2.0 * x1 - point.x();
+        sx[nx++] = -1.0;
+      }
+      if (point.y() - y0 < radius_) {
+        ys[ny] = 2.0 * y0 - point.y();
+        sy[ny++] = -1.0;
+      }
+      if (y1 - point.y() < radius_) {
+        ys[ny] = 2.0 * y1 - point.y();
+        sy[ny++] = -1.0;
+      }
+      for (int a = 0; a < nx; ++a) {
+        for (int b = 0; b < ny; ++b) {
+          const Eigen::Vector3d image(xs[a], ys[b], point.z());
+          const Eigen::Vector3d heading(sx[a] * direction.x(), sy[b] * direction.y(), direction.z());
+          covering(image, heading, [&](int slot) { local[slot_element_[slot]] += weight; });
+        }
+      }
+    };
+
+#pragma omp for schedule(dynamic)
+    for (long long chunk = 0; chunk < chunks; ++chunk) {
+      local.assign(n, 0.0);
+      for (long long q = packets * chunk / chunks; q < packets * (chunk + 1) / chunks; ++q) {
+        int live = 0;
+        for (int l = 0; l < kLanes; ++l) {
+          ray[l] = static_cast<std::uint64_t>(q) * kLanes + l;
+          draws[l] = 0;
+          p.live[l] = ray[l] < rays;
+          p.weight[l] = 1.0;
+          p.bounces[l] = 0;
+          p.segments[l] = 0;
+          if (!p.live[l]) {
+            p.aim(l, Eigen::Vector3d::Zero(), Eigen::Vector3d::UnitZ());
+            continue;
+          }
+          ++live;
+          const Philox4x32::Counter position = draw(l);
+          const Philox4x32::Counter angle = draw(l);
+          const Eigen::Vector3d origin(x0 + Philox4x32::uniform(position[0], position[1]) * (x1 - x0),
+                                       y0 + Philox4x32::uniform(position[2], position[3]) * (y1 - y0), top_);
+          const double cos_theta = std::pow(Philox4x32::uniform(angle[0], angle[1]), inverse_exponent);
+          const double phi = 2.0 * M_PI * Philox4x32::uniform(angle[2], angle[3]);
+          p.aim(l, origin, around(-Eigen::Vector3d::UnitZ(), cos_theta, phi));
+        }
+
+        while (live > 0) {
+          for (int l = 0; l < kLanes; ++l) {
+            p.t[l] = kInfinity;
+            p.hit[l] = -1;
+          }
+          intersect(p);
+          for (int l = 0; l < kLanes; ++l) {
+            if (!p.live[l]) {
+              continue;
+            }
+            // Distances to the side of the grid and back up to the source plane
+            auto exit = [](double o, double d, double low, double high) {
+              return d > 0.0 ? (high - o) / d : d < 0.0 ? (low - o) / d : kInfinity;
+            };
+            const double tx = exit(p.ox[l], p.dx[l], x0, x1);
+            const double ty = exit(p.oy[l], p.dy[l], y0, y1);
+            const double tz = p.dz[l] > 0.0 ? (top_ - p.oz[l]) / p.dz[l] : kInfinity;
+            const double wall = std::min(tx, ty);
+            const Eigen::Vector3d origin(p.ox[l], p.oy[l], p.oz[l]);
+            const Eigen::Vector3d direction(p.dx[l], p.dy[l], p.dz[l]);
+            bool alive = ++p.segments[l] < kMaxSegments;
+            if (tz < std::min(p.t[l], wall)) {
+              alive = false; // Escaped back to the plasma
+            } else if (wall < p.t[l]) {
+              // Reflects off the side of the grid
+              Eigen::Vector3d turned = direction;
+              turned[tx < ty ? 0 : 1] *= -1.0;
+              p.aim(l, origin + wall * direction, turned);
+            } else if (p.hit[l] >= 0) {
+              const Eigen::Vector3d point = origin + p.t[l] * direction;
+              deposit(point, direction, p.weight[l]);
+              p.weight[l] *= 1.0 - source.sticking;
+              alive = alive && p.weight[l] >= kMinWeight && p.bounces[l]++ < source.max_bounces;
+              if (alive) {
+                const Eigen::Vector3d& normal = slot_elements_[p.hit[l]].normal;
+                const Philox4x32::Counter angle = draw(l);
+                const double cos_theta = std::sqrt(Philox4x32::uniform(angle[0], angle[1]));
+                p.aim(l, point + 1e-6 * spacing_ * normal,
+                      around(normal, cos_theta, 2.0 * M_PI * Philox4x32::uniform(angle[2], angle[3])));
+              }
+            } else {
+              alive = false; // Slipped past the surface
+            }
+            if (!alive) {
+              p.live[l] = 0;
+              --live;
+            }
+          }
+        }
+      }
+      sums[chunk] = std::move(local);
+    }
+  }
+  for (const std::vector<double>& sum : sums) {
+    for (int e = 0; e < n; ++e) {
+      flux[e] += sum[e];
+    }
+  }
+
+  // Open flat ground would see rays / ground hits per unit area
+  const double scale = ground / (static_cast<double>(rays) * M_PI * radius_ * radius_);
+  for (double& value : flux) {
+    value *= scale;
+  }
+  return flux;
+}
+
+LevelSet::Velocity FluxTracer::velocity(const std::vector<double>& speeds) const {
+  if (speeds.size() != elements_.size()) {
+    throw std::invalid_argument("Flux tracer needs one speed per element");
+  }
+  auto index = std::make_shared<std::unordered_map<std::int64_t, int>>();
+  auto centers = std::make_shared<std::vector<Eigen::Vector3d>>();
+  index->reserve(elements_.size());
+  centers->reserve(elements_.size());
+  for (int n = 0; n < static_cast<int>(elements_.size()); ++n) {
+    const Element& element = elements_[n];
+    (*index)[key(element.i, element.j, element.k)] = n;
+    centers->push_back(element.center);
+  }
+  const int rows = rows_, cols = cols_, layers = layers_;
+  const double spacing = spacing_, z_min = z_min_;
+  return [index, centers, speeds, rows, cols, layers, spacing, z_min](const LevelSet::Site& site) {
+    const Eigen::Vector3d point(site.surface.x() * spacing, site.surface.y() * spacing, site.surface.z());
+    const int ci = static_cast<int>(std::lround(site.surface.x()));
+    const int cj = static_cast<int>(std::lround(site.surface.y()));
+    const int ck = static_cast<int>(std::lround((site.surface.z() - z_min) / spacing));
+    int best = -1;
+    double nearest = kInfinity;
+    for (int reach = 1; reach <= 2 && best < 0; ++reach) {
+      for (int i = std::max(0, ci - reach); i <= std::min(rows - 1, ci + reach); ++i) {
+        for (int j = std::max(0, cj - reach); j <= std::min(cols - 1, cj + reach); ++j) {
+          for (int k = std::max(0, ck - reach); k <= std::min(layers - 1, ck + reach); ++k) {
+            auto it = index->find((static_cast<std::int64_t>(i) * cols + j) * layers + k);
+            if (it == index->end()) {
+              continue;
+            }
+            const double distance = ((*centers)[it->second] - point).squaredNorm();
+            if (distance < nearest) {
+              nearest = distance;
+              best = it->second;
+            }
+          }
+        }
+      }
+    }
+    return LevelSet::Speed{best >= 0 ? speeds[best] : 0.0, 0.0};
+  };
+}
+
+int FluxTracer::evolve(LevelSet& surface, double time,
+                       const std::function<std::vector<double>(const FluxTracer&)>& speeds) {
+  int traces = 0;
+  double remaining = time;
+  while (remaining > 0.0) {
+    update(surface);
+    const std::vector<double> speed = speeds(*this);
+    ++traces;
+    double fastest = 0.0;
+    for (double value : speed) {
+      fastest = std::max(fastest, std::abs(value));
+    }
+    if (fastest == 0.0) {
+      break;
+    }
+    const double dt = std::min(remaining, kRetrace * surface.spacing() / fastest);
+    surface.advance(dt, velocity(speed));
+    remaining -= dt;
+  }
+  return traces;
+}
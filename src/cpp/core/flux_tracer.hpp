@@ -0,0 +1,109 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "level_set.hpp"
+#include <Eigen/Dense>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Monte Carlo transport of a plasma or sputter flux onto a level-set
+// surface, so features shade their own floors and walls.
+//
+// The surface is taken as one disk per surface voxel, centered on its
+// surface point and facing along its normal, with a radius of sqrt(3)/2
+// cells so neighbors overlap and leave no gaps. Rays start on a plane just
+// above the highest disk, aimed down with a cos^n spread about the vertical,
+// and reflect off the sides of the grid as though it repeated mirrored. A
+// hit adds its weight to every disk it lands in; a sticking fraction of it
+// stays and the rest re-emits with a cosine spread about the normal. Rays
+// go through a bounding volume hierarchy of the disks in packets of eight,
+// one per lane, and packets are spread over threads. Each ray draws its
+// numbers from its own Philox counter, so a trace is repeatable whatever
+// the thread count. update() moves the hierarchy's disks with the surface
+// and patches in the ones that appear or vanish, rebuilding it only once
+// too much has changed.
+class FluxTracer {
+public:
+  struct Source {
+    double exponent = 1.0; // n of the cos^n spread: 1 for neutrals, large for ions a sheath accelerates
+    double sticking = 1.0; // Fraction of each hit that stays on the surface
+    int max_bounces = 10;  // Re-emissions followed before a ray is dropped
+  };
+  struct Element {
+    Eigen::Vector3d center; // um, x along the rows and y along the columns
+    Eigen::Vector3d normal; // Unit, out of the solid
+    int i, j, k;            // The level set voxel
+  };
+  struct Statistics {
+    std::size_t rebuilds = 0;
+    std::size_t refits = 0;     // Updates that kept the hierarchy
+    std::size_t insertions = 0; // Disks patched into a kept hierarchy
+    std::size_t removals = 0;
+  };
+
+  // Throws std::invalid_argument unless rays_per_element is positive
+  explicit FluxTracer(std::size_t rays_per_element = 200, std::uint64_t seed = 0x5EED);
+
+  // Takes the disks from the level set's surface as it is now
+  void update(const LevelSet& surface);
+
+  // Flux arriving at each element, per unit area, relative to what open
+  // flat ground receives straight from the source. Re-emitted flux counts
+  // at each surface it reaches, so the sticking fraction of the flux is
+  // what stays.
+  std::vector<double> trace(const Source& source) const;
+
+  // Level-set velocity moving each site's surface point along its normal
+  // at the speed of its nearest element, positive for growth
+  LevelSet::Velocity velocity(const std::vector<double>& speeds) const;
+
+  // Advances surface for time, updating and calling speeds for the normal
+  // speed of every element each time the fastest has moved half a cell;
+  // returns the number of traces
+  int evolve(LevelSet& surface, double time, const std::function<std::vector<double>(const FluxTracer&)>& speeds);
+
+  const std::vector<Element>& elements() const { return elements_; }
+  const Statistics& statistics() const { return statistics_; }
+  double radius() const { return radius_; }
+
+private:
+  struct Node {
+    double lo[3], hi[3];
+    int left = -1, right = -1; // Children of an inner node
+    std::vector<int> slots;    // Disks of a leaf
+    bool empty() const { return lo[0] > hi[0]; }
+  };
+  struct Packet;
+
+  std::int64_t key(int i, int j, int k) const { return (static_cast<std::int64_t>(i) * cols_ + j) * layers_ + k; }
+  void rebuild();
+  int build(std::vector<int>& slots, int begin, int end);
+  void insert(int slot);
+  void refit();
+  void bounds(int slot, double lo[3], double hi[3]) const;
+  void intersect(Packet& packet) const;
+  template <typename Visit>
+  void covering(const Eigen::Vector3d& point, const Eigen::Vector3d& direction, Visit visit) const;
+
+  std::size_t rays_per_element_;
+  std::uint64_t seed_;
+  std::uint64_t generation_ = 0; // Updates so far, to draw fresh numbers after each
+  // Grid of the level set last updated from
+  int rows_ = 0, cols_ = 0, layers_ = 0;
+  double spacing_ = 0.0, z_min_ = 0.0;
+  double radius_ = 0.0;
+  double top_ = 0.0; // Height rays start from
+
+  std::vector<Element> elements_; // Live disks in surface order
+  // The hierarchy indexes slots, which keep their place across updates
+  // so that only the disks that changed need touching
+  std::vector<Element> slot_elements_;
+  std::vector<int> slot_element_; // Index into elements_, -1 for a free slot
+  std::vector<int> slot_leaf_;
+  std::vector<int> free_slots_;
+  std::unordered_map<std::int64_t, int> slot_of_; // Voxel key to slot
+  std::vector<Node> nodes_;                       // Root first, children after their parents
+  Statistics statistics_;
+};
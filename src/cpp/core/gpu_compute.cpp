@@ -0,0 +1,34 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "gpu_compute.hpp"
+#include <mutex>
+#include <utility>
+
+namespace {
+
+struct ActiveDevice {
+    std::mutex mutex;
+    std::shared_ptr<GpuCompute> compute;
+};
+
+ActiveDevice& activeDevice() {
+    static ActiveDevice device;
+    return device;
+}
+
+} // namespace
+
+namespace Gpu {
+
+std::shared_ptr<GpuCompute> active() {
+    ActiveDevice& device = activeDevice();
+    std::lock_guard<std::mutex> lock(device.mutex);
+    return device.compute;
+}
+
+void setActive(std::shared_ptr<GpuCompute> compute) {
+    ActiveDevice& device = activeDevice();
+    std::lock_guard<std::mutex> lock(device.mutex);
+    device.compute = std::move(compute);
+}
+
+} // namespace Gpu
@@ -0,0 +1,65 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef GPU_COMPUTE_HPP
+#define GPU_COMPUTE_HPP
+
+#include <Eigen/Dense>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Grid kernels offloaded to a GPU, behind an interface so the simulation
+// does not depend on the graphics API that runs them (VulkanCompute).
+//
+// Each kernel either runs to completion on the device and returns true,
+// or does nothing and returns false, and the caller then takes its CPU
+// path. A kernel declines when the device lacks what it needs, its shader
+// did not load, the problem is too small to repay the transfers, or it
+// failed on an earlier call; the other kernels carry on. The fields of a
+// call stay on the device through all of its steps or stages, and only
+// the result is read back.
+class GpuCompute {
+public:
+    using Complex = std::complex<double>;
+
+    // Red-black Gauss-Seidel on a fixed five-point stencil, as
+    // MultigridSolver smooths its levels with. The coefficients are
+    // uploaded once and stay on the device for the smoother's lifetime.
+    class Smoother {
+    public:
+        virtual ~Smoother() = default;
+        // `sweeps` pairs of colour sweeps on u, red then black or, when
+        // reversed, black then red. A null source reuses the last one.
+        virtual bool smooth(Eigen::ArrayXXd& u, const Eigen::ArrayXXd* source, int sweeps, bool reverse) = 0;
+    };
+
+    virtual ~GpuCompute() = default;
+    virtual std::string deviceName() const = 0;
+
+    // FftBackend::transform: row-major, powers of two, the inverse scaled
+    virtual bool transform(Complex* data, int rows, int cols, bool inverse) = 0;
+    // `steps` FTCS steps of c += ratio (sum of the four neighbours - 4 c),
+    // the edge cells replicated (zero flux)
+    virtual bool diffuseExplicit(Eigen::ArrayXXd& field, double ratio, int steps) = 0;
+    // For arrays with a ring around the interior, indexed as in
+    // MultigridSolver's levels; null when the kernel declines
+    virtual std::unique_ptr<Smoother> smoother(const Eigen::ArrayXXd& west, const Eigen::ArrayXXd& north,
+                                               const Eigen::ArrayXXd& inverse_diagonal) = 0;
+    // Adds to counts[b] the ions n of [0, ions) with b = depth_n /
+    // bin_width below counts.size(), depth_n = max(0, mean + stdev z_n)
+    // and z_{2p}, z_{2p+1} the Box-Muller pair of Philox4x32(key) block
+    // (p, stream), as MonteCarloSolver draws them
+    virtual bool countGaussianDepths(std::uint64_t key, std::uint64_t stream, long ions, double mean, double stdev,
+                                     double bin_width, std::vector<std::uint64_t>& counts) = 0;
+};
+
+namespace Gpu {
+
+// The device the kernels offload to, null while GPU acceleration is off
+std::shared_ptr<GpuCompute> active();
+void setActive(std::shared_ptr<GpuCompute> compute);
+
+} // namespace Gpu
+
+#endif // GPU_COMPUTE_HPP
@@ -0,0 +1,310 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "grid_comm.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#ifdef SEMIPRO_HAVE_MPI
+#include <mpi.h>
+#endif
+
+// Point-to-point messages queue per (source, destination) pair. A
+// collective is a round: each rank deposits its contribution, the last
+// to arrive combines them, and all leave with the result once the round
+// is complete. Rounds are numbered, so a fast rank entering the next
+// collective cannot disturb one still being read.
+struct LocalCommunicator::Hub {
+    explicit Hub(int size) : size(size), contributions(size) {}
+
+    const int size;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<std::pair<int, int>, std::deque<std::vector<double>>> messages;
+
+    std::vector<std::vector<std::vector<double>>> contributions; // [rank][peer]
+    std::vector<std::vector<std::vector<double>>> delivered;     // The last round's, [rank][block]
+    int arrived = 0;
+    int leaving = 0; // Ranks yet to read the last round
+    unsigned long round = 0;
+
+    // Deposits this rank's part of a round and returns once the round is
+    // combined; combine runs once, on the last rank to arrive, under the lock
+    template <typename Combine>
+    std::vector<std::vector<double>> collect(int rank, std::vector<std::vector<double>> part, Combine combine) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return leaving == 0; });
+        contributions[rank] = std::move(part);
+        const unsigned long mine = round;
+        if (++arrived == size) {
+            delivered = combine(contributions);
+            arrived = 0;
+            leaving = size;
+            ++round;
+            changed.notify_all();
+        } else {
+            changed.wait(lock, [&] { return round != mine; });
+        }
+        std::vector<std::vector<double>> result = std::move(delivered[rank]);
+        if (--leaving == 0) {
+            changed.notify_all();
+        }
+        return result;
+    }
+};
+
+std::vector<std::shared_ptr<GridCommunicator>> LocalCommunicator::group(int size) {
+    if (size <= 0) {
+        throw std::invalid_argument("A communicator group needs at least one rank");
+    }
+    auto hub = std::make_shared<Hub>(size);
+    std::vector<std::shared_ptr<GridCommunicator>> ranks;
+    for (int r = 0; r < size; ++r) {
+        ranks.push_back(std::shared_ptr<GridCommunicator>(new LocalCommunicator(hub, r)));
+    }
+    return ranks;
+}
+
+int LocalCommunicator::size() const {
+    return hub_->size;
+}
+
+void LocalCommunicator::sendRecv(int dest, const double* send, std::size_t send_count, int source, double* recv,
+                                 std::size_t recv_count) {
+    std::unique_lock<std::mutex> lock(hub_->mutex);
+    if (dest != kNoRank) {
+        hub_->messages[{rank_, dest}].emplace_back(send, send + send_count);
+        hub_->changed.notify_all();
+    }
+    if (source != kNoRank) {
+        auto& queue = hub_->messages[{source, rank_}];
+        hub_->changed.wait(lock, [&] { return !queue.empty(); });
+        const std::vector<double>& message = queue.front();
+        if (message.size() != recv_count) {
+            throw std::runtime_error("Grid message size does not match the receive");
+        }
+        std::copy(message.begin(), message.end(), recv);
+        queue.pop_front();
+    }
+}
+
+void LocalCommunicator::allReduce(double* values, int count, Reduce op) {
+    std::vector<std::vector<double>> part(1, std::vector<double>(values, values + count));
+    auto result = hub_->collect(rank_, std::move(part), [op](const std::vector<std::vector<std::vector<double>>>& all) {
+        std::vector<double> combined = all[0][0];
+        for (std::size_t r = 1; r < all.size(); ++r) {
+            for (std::size_t k = 0; k < combined.size(); ++k) {
+                const double value = all[r][0][k];
+                combined[k] = op == Reduce::SUM   ? combined[k] + value
+                              : op == Reduce::MAX ? std::max(combined[k], value)
+                                                  : std::min(combined[k], value);
+            }
+        }
+        return std::vector<std::vector<std::vector<double>>>(all.size(), {combined});
+    });
+    std::copy(result[0].begin(), result[0].end(), values);
+}
+
+void LocalCommunicator::allToAll(const std::vector<std::vector<double>>& send,
+                                 std::vector<std::vector<double>>& recv) {
+    if (static_cast<int>(send.size()) != hub_->size) {
+        throw std::invalid_argument("allToAll needs one block per rank");
+    }
+    recv = hub_->collect(rank_, send, [](const std::vector<std::vector<std::vector<double>>>& all) {
+        std::vector<std::vector<std::vector<double>>> out(all.size(), std::vector<std::vector<double>>(all.size()));
+        for (std::size_t from = 0; from < all.size(); ++from) {
+            for (std::size_t to = 0; to < all.size(); ++to) {
+                out[to][from] = all[from][to];
+            }
+        }
+        return out;
+    });
+}
+
+void LocalCommunicator::barrier() {
+    hub_->collect(rank_, {}, [](const std::vector<std::vector<std::vector<double>>>& all) {
+        return std::vector<std::vector<std::vector<double>>>(all.size());
+    });
+}
+
+SlabDecomposition SlabDecomposition::balanced(int rows, int ranks) {
+    if (rows < 0 || ranks <= 0) {
+        throw std::invalid_argument("A slab decomposition needs non-negative rows and at least one rank");
+    }
+    SlabDecomposition slabs;
+    slabs.rows = rows;
+    slabs.ranks = ranks;
+    return slabs;
+}
+
+int SlabDecomposition::firstRow(int rank) const {
+    const int base = rows / ranks, extra = rows % ranks;
+    return rank * base + std::min(rank, extra);
+}
+
+int SlabDecomposition::owner(int row) const {
+    const int base = rows / ranks, extra = rows % ranks;
+    const int split = extra * (base + 1); // First row of the shorter slabs
+    return row < split ? row / (base + 1) : extra + (row - split) / base;
+}
+
+namespace GridComm {
+
+void redistributeRows(GridCommunicator& comm, const SlabDecomposition& from, const SlabDecomposition& to,
+                      std::size_t width, const double* in, double* out) {
+    const int me = comm.rank();
+    const int size = comm.size();
+    if (from.ranks != size || to.ranks != size) {
+        throw std::invalid_argument("Slab decompositions do not match the communicator");
+    }
+    // Rows of `from`'s slab `a` that land in `to`'s slab `b`
+    const auto overlap = [&](int a, int b) {
+        const int first = std::max(from.firstRow(a), to.firstRow(b));
+        const int last = std::min(from.firstRow(a) + from.rowCount(a), to.firstRow(b) + to.rowCount(b));
+        return std::make_pair(first, std::max(first, last));
+    };
+    std::vector<std::vector<double>> send(size), recv;
+    for (int r = 0; r < size; ++r) {
+        const auto rows = overlap(me, r);
+        if (rows.second > rows.first) {
+            const double* begin = in + static_cast<std::size_t>(rows.first - from.firstRow(me)) * width;
+            send[r].assign(begin, begin + static_cast<std::size_t>(rows.second - rows.first) * width);
+        }
+    }
+    comm.allToAll(send, recv);
+    std::fill(out, out + static_cast<std::size_t>(to.rowCount(me)) * width, 0.0);
+    for (int r = 0; r < size; ++r) {
+        const auto rows = overlap(r, me);
+        if (rows.second > rows.first) {
+            std::copy(recv[r].begin(), recv[r].end(), out + static_cast<std::size_t>(rows.first - to.firstRow(me)) * width);
+        }
+    }
+}
+
+} // namespace GridComm
+
+#ifdef SEMIPRO_HAVE_MPI
+
+namespace {
+
+MPI_Op mpiOp(GridCommunicator::Reduce op) {
+    switch (op) {
+    case GridCommunicator::Reduce::SUM: return MPI_SUM;
+    case GridCommunicator::Reduce::MAX: return MPI_MAX;
+    case GridCommunicator::Reduce::MIN: return MPI_MIN;
+    }
+    return MPI_SUM;
+}
+
+class MpiCommunicator : public GridCommunicator {
+public:
+    explicit MpiCommunicator(MPI_Comm comm) : comm_(comm) {
+        MPI_Comm_rank(comm_, &rank_);
+        MPI_Comm_size(comm_, &size_);
+    }
+
+    int rank() const override { return rank_; }
+    int size() const override { return size_; }
+
+    void sendRecv(int dest, const double* send, std::size_t send_count, int source, double* recv,
+                  std::size_t recv_count) override {
+        MPI_Sendrecv(send, static_cast<int>(send_count), MPI_DOUBLE, dest == kNoRank ? MPI_PROC_NULL : dest, 0, recv,
+                     static_cast<int>(recv_count), MPI_DOUBLE, source == kNoRank ? MPI_PROC_NULL : source, 0, comm_,
+                     MPI_STATUS_IGNORE);
+    }
+
+    void allReduce(double* values, int count, Reduce op) override {
+        MPI_Allreduce(MPI_IN_PLACE, values, count, MPI_DOUBLE, mpiOp(op), comm_);
+    }
+
+    void allToAll(const std::vector<std::vector<double>>& send, std::vector<std::vector<double>>& recv) override {
+        if (static_cast<int>(send.size()) != size_) {
+            throw std::invalid_argument("allToAll needs one block per rank");
+        }
+        std::vector<int> send_counts(size_), send_offsets(size_), recv_counts(size_), recv_offsets(size_);
+        std::vector<double> send_buffer;
+        for (int r = 0; r < size_; ++r) {
+            send_counts[r] = static_cast<int>(send[r].size());
+            send_offsets[r] = static_cast<int>(send_buffer.size());
+            send_buffer.insert(send_buffer.end(), send[r].begin(), send[r].end());
+        }
+        MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm_);
+        int total = 0;
+        for (int r = 0; r < size_; ++r) {
+            recv_offsets[r] = total;
+            total += recv_counts[r];
+        }
+        std::vector<double> recv_buffer(total);
+        MPI_Alltoallv(send_buffer.data(), send_counts.data(), send_offsets.data(), MPI_DOUBLE, recv_buffer.data(),
+                      recv_counts.data(), recv_offsets.data(), MPI_DOUBLE, comm_);
+        recv.assign(size_, {});
+        for (int r = 0; r < size_; ++r) {
+            recv[r].assign(recv_buffer.begin() + recv_offsets[r], recv_buffer.begin() + recv_offsets[r] + recv_counts[r]);
+        }
+    }
+
+    void barrier() override { MPI_Barrier(comm_); }
+
+private:
+    MPI_Comm comm_;
+    int rank_ = 0;
+    int size_ = 1;
+};
+
+} // namespace
+
+namespace GridComm {
+
+bool mpiAvailable() {
+    return true;
+}
+
+bool initializeMpi(int* argc, char*** argv) {
+    int initialized = 0;
+    MPI_Initialized(&initialized);
+    if (!initialized) {
+        int provided = 0;
+        MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+    }
+    return true;
+}
+
+void finalizeMpi() {
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if (!finalized) {
+        MPI_Finalize();
+    }
+}
+
+std::shared_ptr<GridCommunicator> mpiWorldCommunicator() {
+    int initialized = 0;
+    MPI_Initialized(&initialized);
+    return initialized ? std::make_shared<MpiCommunicator>(MPI_COMM_WORLD) : nullptr;
+}
+
+} // namespace GridComm
+
+#else
+
+namespace GridComm {
+
+bool mpiAvailable() {
+    return false;
+}
+
+bool initializeMpi(int*, char***) {
+    return false;
+}
+
+void finalizeMpi() {}
+
+std::shared_ptr<GridCommunicator> mpiWorldCommunicator() {
+    return nullptr;
+}
+
+} // namespace GridComm
+
+#endif
@@ -0,0 +1,98 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef GRID_COMM_HPP
+#define GRID_COMM_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Message passing between the ranks of a domain-decomposed solve.
+//
+// Every rank holds a slab of the grid and the ranks of one solve call the
+// collective operations (allReduce, allToAll, barrier) in the same order.
+// Two implementations exist: LocalCommunicator runs the ranks as threads
+// of one process, which tests and single-node runs use, and, when built
+// with MPI (SEMIPRO_HAVE_MPI), mpiWorldCommunicator() spans the processes
+// started by mpirun.
+class GridCommunicator {
+public:
+    enum class Reduce { SUM, MAX, MIN };
+
+    // A peer of kNoRank sends or receives nothing
+    static constexpr int kNoRank = -1;
+
+    virtual ~GridCommunicator() = default;
+    virtual int rank() const = 0;
+    virtual int size() const = 0;
+
+    // Sends send_count doubles to dest while receiving recv_count from
+    // source; matching calls on the two peers pair up in call order.
+    virtual void sendRecv(int dest, const double* send, std::size_t send_count, int source, double* recv,
+                          std::size_t recv_count) = 0;
+    // Combines values element-wise across all ranks; every rank gets the result
+    virtual void allReduce(double* values, int count, Reduce op) = 0;
+    // send[r] goes to rank r, recv[r] comes from rank r; sizes may differ
+    virtual void allToAll(const std::vector<std::vector<double>>& send, std::vector<std::vector<double>>& recv) = 0;
+    virtual void barrier() = 0;
+
+    double allReduce(double value, Reduce op) {
+        allReduce(&value, 1, op);
+        return value;
+    }
+};
+
+// Ranks as threads of this process, sharing a mailbox
+class LocalCommunicator : public GridCommunicator {
+public:
+    // One communicator per rank; hand each to its own thread
+    static std::vector<std::shared_ptr<GridCommunicator>> group(int size);
+
+    int rank() const override { return rank_; }
+    int size() const override;
+    void sendRecv(int dest, const double* send, std::size_t send_count, int source, double* recv,
+                  std::size_t recv_count) override;
+    void allReduce(double* values, int count, Reduce op) override;
+    void allToAll(const std::vector<std::vector<double>>& send, std::vector<std::vector<double>>& recv) override;
+    void barrier() override;
+
+    struct Hub;
+
+private:
+    LocalCommunicator(std::shared_ptr<Hub> hub, int rank) : hub_(std::move(hub)), rank_(rank) {}
+
+    std::shared_ptr<Hub> hub_;
+    int rank_;
+};
+
+// The rows of a grid split into one contiguous slab per rank, the first
+// rows - ranks * (rows / ranks) slabs one row longer
+struct SlabDecomposition {
+    int rows = 0;
+    int ranks = 1;
+
+    static SlabDecomposition balanced(int rows, int ranks);
+    int firstRow(int rank) const;
+    int rowCount(int rank) const { return firstRow(rank + 1) - firstRow(rank); }
+    int owner(int row) const;
+};
+
+namespace GridComm {
+
+// Moves rows of `width` doubles from one decomposition to another of the
+// same ranks: in holds this rank's `from` rows, out receives its `to`
+// rows, and rows `from` does not cover arrive as zeros. Collective.
+void redistributeRows(GridCommunicator& comm, const SlabDecomposition& from, const SlabDecomposition& to,
+                      std::size_t width, const double* in, double* out);
+
+// Whether this build can run across processes
+bool mpiAvailable();
+// MPI_Init_thread if nobody did yet; false without MPI support. Call
+// finalizeMpi() before the process exits.
+bool initializeMpi(int* argc, char*** argv);
+void finalizeMpi();
+// MPI_COMM_WORLD, or null without MPI support or before initializeMpi
+std::shared_ptr<GridCommunicator> mpiWorldCommunicator();
+
+} // namespace GridComm
+
+#endif // GRID_COMM_HPP
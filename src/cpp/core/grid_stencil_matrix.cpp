@@ -0,0 +1,86 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "grid_stencil_matrix.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Grids below this many cells are written on the calling thread
+constexpr long kParallelCells = 1 << 14;
+
+} // namespace
+
+GridStencilMatrix::GridStencilMatrix(int outer, int inner) : outer_(outer), inner_(inner) {
+  if (outer < 1 || inner < 1) {
+    throw std::invalid_argument("GridStencilMatrix: grid must not be empty");
+  }
+  // A run of inner cells holds its diagonal, both entries of each inner
+  // face and one entry per face to the neighbouring runs. Run a starts
+  // after all of that for the runs before it.
+  const long n = static_cast<long>(outer) * inner;
+  const auto start = [outer, inner](long a) {
+    return a * (3L * inner - 2) + inner * (std::max(a - 1, 0L) + std::min(a, outer - 1L));
+  };
+  matrix_.resize(n, n);
+  matrix_.resizeNonZeros(start(outer));
+  int* offsets = matrix_.outerIndexPtr();
+  int* rows = matrix_.innerIndexPtr();
+  std::fill(matrix_.valuePtr(), matrix_.valuePtr() + matrix_.nonZeros(), 0.0);
+
+#pragma omp parallel for schedule(static) if (n >= kParallelCells)
+  for (int a = 0; a < outer; ++a) {
+    long entry = start(a);
+    for (int b = 0; b < inner; ++b) {
+      const int c = cell(a, b);
+      offsets[c] = static_cast<int>(entry);
+      if (a > 0) {
+        rows[entry++] = c - inner;
+      }
+      if (b > 0) {
+        rows[entry++] = c - 1;
+      }
+      rows[entry++] = c;
+      if (b + 1 < inner) {
+        rows[entry++] = c + 1;
+      }
+      if (a + 1 < outer) {
+        rows[entry++] = c + inner;
+      }
+    }
+  }
+  offsets[n] = static_cast<int>(start(outer));
+}
+
+void GridStencilMatrix::assemble(const Eigen::ArrayXXd& outer_faces, const Eigen::ArrayXXd& inner_faces,
+                                 const Eigen::ArrayXXd& diagonal) {
+  if (outer_faces.rows() != outer_ - 1 || outer_faces.cols() != inner_ || inner_faces.rows() != outer_ ||
+      inner_faces.cols() != inner_ - 1 || diagonal.rows() != outer_ || diagonal.cols() != inner_) {
+    throw std::invalid_argument("GridStencilMatrix: face and diagonal arrays do not match the grid");
+  }
+  // Entries go in the order the pattern holds them, column by column
+  double* values = matrix_.valuePtr();
+  const long n = static_cast<long>(outer_) * inner_;
+#pragma omp parallel for schedule(static) if (n >= kParallelCells)
+  for (int a = 0; a < outer_; ++a) {
+    for (int b = 0; b < inner_; ++b) {
+      const double north = a > 0 ? outer_faces(a - 1, b) : 0.0;
+      const double west = b > 0 ? inner_faces(a, b - 1) : 0.0;
+      const double east = b + 1 < inner_ ? inner_faces(a, b) : 0.0;
+      const double south = a + 1 < outer_ ? outer_faces(a, b) : 0.0;
+      double* entry = values + matrix_.outerIndexPtr()[cell(a, b)];
+      if (a > 0) {
+        *entry++ = -north;
+      }
+      if (b > 0) {
+        *entry++ = -west;
+      }
+      *entry++ = diagonal(a, b) + north + west + east + south;
+      if (b + 1 < inner_) {
+        *entry++ = -east;
+      }
+      if (a + 1 < outer_) {
+        *entry = -south;
+      }
+    }
+  }
+}
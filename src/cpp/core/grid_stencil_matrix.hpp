@@ -0,0 +1,35 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <Eigen/Sparse>
+
+// Sparse matrix of a five-point stencil on an outer x inner grid, cell
+// (a, b) numbered a * inner + b. Every column's entries are known from the
+// grid alone, so the compressed pattern is written directly, a run of
+// cells per thread, instead of sorting triplets: no triplet buffer, no
+// sort and no second copy of the matrix. The pattern never changes, so a
+// factorization analysed once serves every later assemble().
+class GridStencilMatrix {
+public:
+  // Throws std::invalid_argument for an empty grid
+  GridStencilMatrix(int outer, int inner);
+
+  int outer() const { return outer_; }
+  int inner() const { return inner_; }
+  int cell(int a, int b) const { return a * inner_ + b; }
+  const Eigen::SparseMatrix<double>& matrix() const { return matrix_; }
+
+  // Writes the symmetric matrix of face conductances: outer_faces(a, b)
+  // joins cell (a, b) to (a + 1, b) and inner_faces(a, b) joins it to
+  // (a, b + 1), each entering its two cells' diagonals and, negated, the
+  // entries between them; diagonal(a, b) is added to cell (a, b)'s own,
+  // for boundary and reaction terms. Throws std::invalid_argument for
+  // arrays that are not (outer - 1) x inner, outer x (inner - 1) and
+  // outer x inner.
+  void assemble(const Eigen::ArrayXXd& outer_faces, const Eigen::ArrayXXd& inner_faces,
+                const Eigen::ArrayXXd& diagonal);
+
+private:
+  int outer_;
+  int inner_;
+  Eigen::SparseMatrix<double> matrix_;
+};
@@ -0,0 +1,193 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "hardware_counters.hpp"
+#include <atomic>
+#include <mutex>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<bool> g_enabled{false};
+std::mutex g_error_mutex;
+std::string g_last_error;
+
+void setError(const std::string& error) {
+    std::lock_guard<std::mutex> lock(g_error_mutex);
+    g_last_error = error;
+}
+
+#ifdef __linux__
+
+// Members of the group in Sample order; the first leads
+constexpr int kEvents = 4;
+constexpr std::uint64_t kEventConfigs[kEvents] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+int openEvent(std::uint64_t config, int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group_fd == -1 ? 1 : 0; // The leader starts the group
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+}
+
+// The calling thread's counter group, closed when the thread exits
+struct CounterGroup {
+    int fds[kEvents] = {-1, -1, -1, -1};
+    // Position of each event in the group's read, -1 if it did not open
+    int slot[kEvents] = {-1, -1, -1, -1};
+    int members = 0;
+    bool attempted = false;
+
+    ~CounterGroup() { close(); }
+
+    bool open() {
+        attempted = true;
+        fds[0] = openEvent(kEventConfigs[0], -1);
+        if (fds[0] < 0) {
+            setError(std::string("perf_event_open failed: ") + std::strerror(errno));
+            return false;
+        }
+        slot[0] = members++;
+        // A PMU may lack an event (LLC misses on some hypervisors); the
+        // others are still worth reading
+        for (int i = 1; i < kEvents; ++i) {
+            fds[i] = openEvent(kEventConfigs[i], fds[0]);
+            if (fds[i] >= 0) {
+                slot[i] = members++;
+            }
+        }
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+    }
+
+    void close() {
+        for (int i = kEvents - 1; i >= 0; --i) {
+            if (fds[i] >= 0) {
+                ::close(fds[i]);
+            }
+            fds[i] = -1;
+            slot[i] = -1;
+        }
+        members = 0;
+        attempted = false;
+    }
+
+    bool ready() {
+        return fds[0] >= 0 || (!attempted && open());
+    }
+
+    HardwareCounters::Sample read() const {
+        HardwareCounters::Sample sample;
+        // nr, time_enabled, time_running, then one value per member
+        std::uint64_t buffer[3 + kEvents] = {};
+        if (::read(fds[0], buffer, sizeof(buffer)) < static_cast<ssize_t>((3 + members) * sizeof(std::uint64_t))) {
+            return sample;
+        }
+        const std::uint64_t enabled = buffer[1];
+        const std::uint64_t running = buffer[2];
+        const double scale = running > 0 && running < enabled ? static_cast<double>(enabled) / running : 1.0;
+        std::uint64_t values[kEvents] = {};
+        for (int i = 0; i < kEvents; ++i) {
+            if (slot[i] >= 0) {
+                values[i] = static_cast<std::uint64_t>(buffer[3 + slot[i]] * scale);
+            }
+        }
+        sample.cycles = values[0];
+        sample.instructions = values[1];
+        sample.cache_misses = values[2];
+        sample.branch_misses = values[3];
+        return sample;
+    }
+};
+
+CounterGroup& threadGroup() {
+    thread_local CounterGroup group;
+    return group;
+}
+
+#endif // __linux__
+
+} // namespace
+
+HardwareCounters::Sample HardwareCounters::Sample::operator-(const Sample& earlier) const {
+    // Counts only grow, but a group reopened in between restarts at zero
+    auto diff = [](std::uint64_t a, std::uint64_t b) { return a > b ? a - b : 0; };
+    Sample result;
+    result.cycles = diff(cycles, earlier.cycles);
+    result.instructions = diff(instructions, earlier.instructions);
+    result.cache_misses = diff(cache_misses, earlier.cache_misses);
+    result.branch_misses = diff(branch_misses, earlier.branch_misses);
+    return result;
+}
+
+HardwareCounters::Sample& HardwareCounters::Sample::operator+=(const Sample& other) {
+    cycles += other.cycles;
+    instructions += other.instructions;
+    cache_misses += other.cache_misses;
+    branch_misses += other.branch_misses;
+    return *this;
+}
+
+double HardwareCounters::Sample::ipc() const {
+    return cycles > 0 ? static_cast<double>(instructions) / cycles : 0.0;
+}
+
+bool HardwareCounters::enable() {
+#ifdef __linux__
+    CounterGroup& group = threadGroup();
+    if (group.attempted && group.fds[0] < 0) {
+        group.close(); // Retry: permissions may have changed
+    }
+    if (!group.ready()) {
+        return false;
+    }
+    g_enabled.store(true, std::memory_order_relaxed);
+    return true;
+#else
+    setError("Hardware counters need Linux perf_event");
+    return false;
+#endif
+}
+
+void HardwareCounters::disable() {
+    g_enabled.store(false, std::memory_order_relaxed);
+}
+
+bool HardwareCounters::isEnabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+HardwareCounters::Sample HardwareCounters::read() {
+#ifdef __linux__
+    if (g_enabled.load(std::memory_order_relaxed)) {
+        CounterGroup& group = threadGroup();
+        if (group.ready()) {
+            return group.read();
+        }
+    }
+#endif
+    return Sample();
+}
+
+std::string HardwareCounters::lastError() {
+    std::lock_guard<std::mutex> lock(g_error_mutex);
+    return g_last_error;
+}
@@ -0,0 +1,47 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef HARDWARE_COUNTERS_HPP
+#define HARDWARE_COUNTERS_HPP
+
+#include <cstdint>
+#include <string>
+
+// CPU performance counters of the calling thread, read through Linux
+// perf_event.
+//
+// Each thread opens its own counter group (cycles leading instructions,
+// last-level cache misses and branch misses) the first time it reads, so
+// a read is a single read() system call and counts only that thread, in
+// user mode. Counts the kernel had to multiplex are scaled up to the time
+// the group was enabled. Collection is off until enable() succeeds, and
+// it fails where perf_event is missing or refused (no PMU in a VM,
+// perf_event_paranoid above 2, container seccomp); reads then return
+// zeros. Memory traffic is estimated as one cache line per LLC miss: the
+// memory controllers' own counters need system-wide access.
+class HardwareCounters {
+public:
+    static constexpr std::uint64_t kCacheLineBytes = 64;
+
+    struct Sample {
+        std::uint64_t cycles = 0;
+        std::uint64_t instructions = 0;
+        std::uint64_t cache_misses = 0;
+        std::uint64_t branch_misses = 0;
+
+        Sample operator-(const Sample& earlier) const;
+        Sample& operator+=(const Sample& other);
+        // Instructions per cycle, 0 without cycles
+        double ipc() const;
+        std::uint64_t memoryBytes() const { return cache_misses * kCacheLineBytes; }
+    };
+
+    // Opens the calling thread's group; false, with lastError() set, if
+    // the counters are unavailable
+    static bool enable();
+    static void disable();
+    static bool isEnabled();
+    // The calling thread's counts since its group was opened
+    static Sample read();
+    static std::string lastError();
+};
+
+#endif // HARDWARE_COUNTERS_HPP
@@ -4,16 +4,44 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cctype>
+#include <cstdint>
 #include <filesystem>
-#include <json/json.h>
 
 namespace SemiPRO {
 
+namespace {
+
+YAML::Node toYaml(const JsonValue& value) {
+    switch (value.type()) {
+        case JsonValue::Type::Null:
+            return YAML::Node(YAML::NodeType::Null);
+        case JsonValue::Type::Array: {
+            YAML::Node node(YAML::NodeType::Sequence);
+            for (const auto& item : value.items()) {
+                node.push_back(toYaml(item));
+            }
+            return node;
+        }
+        case JsonValue::Type::Object: {
+            YAML::Node node(YAML::NodeType::Map);
+            for (const auto& [key, member] : value.members()) {
+                node[key] = toYaml(member);
+            }
+            return node;
+        }
+        default:
+            return YAML::Node(value.scalarText());
+    }
+}
+
+} // namespace
+
 InputParser::InputParser(const std::string& base_directory) 
     : base_directory_(base_directory), verbose_(false) {
     
-    // Ensure base directory exists
-    if (!std::filesystem::exists(base_directory_)) {
+    // Ensure base directory exists; empty means the working directory
+    if (!base_directory_.empty() && !std::filesystem::exists(base_directory_)) {
         std::filesystem::create_directories(base_directory_);
     }
 }
@@ -90,27 +118,10 @@ bool InputParser::parseYAMLFile(const std::string& filename) {
 
 bool InputParser::parseJSONFile(const std::string& filename) {
     try {
-        std::string full_path = getFullPath(filename);
-        std::ifstream file(full_path);
-        
-        if (!file.is_open()) {
-            logError("Cannot open JSON file: " + filename);
-            return false;
-        }
-        
-        Json::Value root;
-        Json::CharReaderBuilder builder;
-        std::string errors;
-        
-        if (!Json::parseFromStream(builder, file, &root, &errors)) {
-            logError("JSON parsing error in " + filename + ": " + errors);
-            return false;
-        }
+        const JsonValue root = JsonValue::parseFile(getFullPath(filename));
         
         // Convert JSON to YAML for unified storage
-        YAML::Node yaml_node;
-        convertJsonToYaml(root, yaml_node);
-        yaml_data_[filename] = yaml_node;
+        yaml_data_[filename] = toYaml(root);
         
         logInfo("Successfully parsed JSON file: " + filename);
         return true;
@@ -121,6 +132,17 @@ bool InputParser::parseJSONFile(const std::string& filename) {
     }
 }
 
+std::vector<ConfigJob> InputParser::parseJobManifest(const std::string& filename) {
+    try {
+        std::vector<ConfigJob> jobs = readConfigJobs(JsonValue::parseFile(getFullPath(filename)));
+        logInfo("Read " + std::to_string(jobs.size()) + " jobs from " + filename);
+        return jobs;
+    } catch (const std::exception& e) {
+        logError("Invalid job manifest " + filename + ": " + e.what());
+        return {};
+    }
+}
+
 bool InputParser::parseGDSFile(const std::string& filename) {
     try {
         std::string full_path = getFullPath(filename);
@@ -372,4 +394,151 @@ bool InputParser::parseTCADFile(const std::string& filename) {
     }
 }
 
+bool InputParser::fileExists(const std::string& filename) const {
+    return std::filesystem::exists(getFullPath(filename));
+}
+
+std::string InputParser::getFullPath(const std::string& filename) const {
+    std::filesystem::path path(filename);
+    if (path.is_absolute() || base_directory_.empty()) {
+        return path.string();
+    }
+    return (std::filesystem::path(base_directory_) / path).string();
+}
+
+void InputParser::logError(const std::string& error) const {
+    last_error_ = error;
+    errors_.push_back(error);
+    if (verbose_) {
+        std::cerr << "InputParser error: " << error << std::endl;
+    }
+}
+
+void InputParser::logInfo(const std::string& info) const {
+    if (verbose_) {
+        std::cout << "InputParser: " << info << std::endl;
+    }
+}
+
+bool InputParser::parseGDSRecord(std::ifstream& file, MaskLayer& layer) {
+    // Record header: big-endian length including the header, record type
+    // and data type
+    unsigned char header[4];
+    if (!file.read(reinterpret_cast<char*>(header), 4)) {
+        return false;
+    }
+    const size_t length = (static_cast<size_t>(header[0]) << 8) | header[1];
+    const unsigned char record = header[2];
+    if (length < 4) {
+        return false;
+    }
+    std::vector<unsigned char> data(length - 4);
+    if (!data.empty() && !file.read(reinterpret_cast<char*>(data.data()), data.size())) {
+        return false;
+    }
+    auto int16 = [&](size_t offset) {
+        return static_cast<int16_t>((data[offset] << 8) | data[offset + 1]);
+    };
+    auto int32 = [&](size_t offset) {
+        return static_cast<int32_t>((static_cast<uint32_t>(data[offset]) << 24) |
+                                    (static_cast<uint32_t>(data[offset + 1]) << 16) |
+                                    (static_cast<uint32_t>(data[offset + 2]) << 8) | data[offset + 3]);
+    };
+
+    switch (record) {
+        case 0x04: // ENDLIB
+            return false;
+        case 0x0D: // LAYER
+            if (data.size() >= 2) {
+                layer.layer_number = int16(0);
+                if (layer.name.empty()) {
+                    layer.name = "layer_" + std::to_string(layer.layer_number);
+                }
+            }
+            break;
+        case 0x0E: // DATATYPE
+            if (data.size() >= 2) {
+                layer.datatype = int16(0);
+            }
+            break;
+        case 0x10: { // XY, in database units
+            std::vector<std::pair<double, double>> polygon;
+            for (size_t offset = 0; offset + 8 <= data.size(); offset += 8) {
+                polygon.emplace_back(int32(offset), int32(offset + 4));
+            }
+            if (!polygon.empty()) {
+                layer.polygons.push_back(std::move(polygon));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return true;
+}
+
+bool InputParser::parseSpiceNetlist(const std::string& content, std::vector<std::string>& components) {
+    std::istringstream stream(content);
+    std::string line;
+    bool title = true;
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        // The first line of a netlist is its title
+        if (title) {
+            title = false;
+            continue;
+        }
+        const size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '*') {
+            continue;
+        }
+        line = line.substr(start);
+        if (line[0] == '+') {
+            if (!components.empty()) {
+                components.back() += " " + line.substr(1);
+            }
+            continue;
+        }
+        if (line[0] == '.') {
+            if (line.compare(0, 4, ".end") == 0 && (line.size() == 4 || std::isspace(static_cast<unsigned char>(line[4])))) {
+                break;
+            }
+            continue; // Control and model cards
+        }
+        if (std::isalpha(static_cast<unsigned char>(line[0]))) {
+            components.push_back(line);
+        }
+    }
+    return !components.empty();
+}
+
+std::vector<std::string> InputParser::tokenizeLine(const std::string& line, char delimiter) const {
+    std::vector<std::string> tokens;
+    std::istringstream stream(line);
+    std::string token;
+    while (std::getline(stream, token, delimiter)) {
+        const size_t start = token.find_first_not_of(" \t\r");
+        const size_t end = token.find_last_not_of(" \t\r");
+        tokens.push_back(start == std::string::npos ? std::string() : token.substr(start, end - start + 1));
+    }
+    return tokens;
+}
+
+std::vector<std::pair<double, double>> MaskParser::parsePolygon(const std::string& polygon_str) {
+    // Coordinates as x,y pairs in any bracketing, e.g. "(0,0) (1,0) (1,1)"
+    static const std::regex number(R"([-+]?(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?)");
+    std::vector<double> values;
+    for (auto it = std::sregex_iterator(polygon_str.begin(), polygon_str.end(), number);
+         it != std::sregex_iterator(); ++it) {
+        values.push_back(std::stod(it->str()));
+    }
+    std::vector<std::pair<double, double>> polygon;
+    for (size_t i = 0; i + 1 < values.size(); i += 2) {
+        polygon.emplace_back(values[i], values[i + 1]);
+    }
+    return polygon;
+}
+
 } // namespace SemiPRO
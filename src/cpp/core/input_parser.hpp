@@ -2,6 +2,7 @@
 #ifndef INPUT_PARSER_HPP
 #define INPUT_PARSER_HPP
 
+#include "job_manifest.hpp"
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -115,6 +116,9 @@ public:
     
     // Configuration parsing
     ProcessParameters parseProcessConfig(const std::string& filename);
+    // All jobs of a JSON config or multi-job manifest (see readConfigJobs);
+    // empty, with the reason logged, if the file does not validate
+    std::vector<ConfigJob> parseJobManifest(const std::string& filename);
     std::vector<ProcessParameters> parseProcessFlow(const std::string& filename);
     TechnologyNode parseTechnologyFile(const std::string& filename);
     std::vector<MaterialProperties> parseMaterialsFile(const std::string& filename);
@@ -0,0 +1,492 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "iso_mesh.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+using Vec3 = std::array<float, 3>;
+
+// The six tetrahedra of a cell, corners numbered by their offsets (bit 0
+// along rows, 1 along columns, 2 along slices). Each runs from corner 0
+// to 7 through a corner of one offset and one of two, so every edge joins
+// a corner to one with more offsets, and opposite faces of a cell split
+// along the same diagonal, matching the neighbouring cells.
+constexpr int kTetrahedra[6][4] = {{0, 1, 3, 7}, {0, 1, 5, 7}, {0, 2, 3, 7},
+                                   {0, 2, 6, 7}, {0, 4, 5, 7}, {0, 4, 6, 7}};
+// Columns per parallel work item
+constexpr int kColumnBlock = 32;
+
+Vec3 cross(const Vec3& a, const Vec3& b) {
+  return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+Vec3 difference(const Vec3& a, const Vec3& b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+
+// Vertices are keyed by a point of the padded grid and a slot: 0 for the
+// point itself, 1 to 7 for the edge to the point at those offsets.
+// Numbering points slice by slice keeps a slab's keys sorted as they are
+// made.
+struct Slab {
+  int first_cell = 0; // Cells [first_cell, end_cell) along slices
+  int end_cell = 0;
+  int first_plane = 0; // Planes held in values and inside
+  std::vector<float> values;
+  std::vector<uint8_t> inside;
+  uint64_t first_vertex = 0;
+  std::vector<uint64_t> keys;
+  std::vector<Vec3> vertices;
+  std::vector<std::array<uint32_t, 3>> triangles;
+};
+
+// The field padded by one point on every side, below the isovalue
+class PaddedGrid {
+public:
+  PaddedGrid(int rows, int cols, int slices, const IsoMesher::SliceSource& source, float iso,
+             const IsoMesher::Options& options)
+      : nx_(rows + 2), ny_(cols + 2), nz_(slices + 2), source_(source), iso_(iso), options_(options) {}
+
+  int slabCount() const { return (nz_ - 1 + options_.slab_slices - 1) / options_.slab_slices; }
+
+  // Reads a slab's planes, from the one before its first cell, and keys
+  // its vertices: those on its planes, the last slab also owning the top
+  // plane.
+  void read(int index, Slab& slab) const {
+    slab.first_cell = index * options_.slab_slices;
+    slab.end_cell = std::min(slab.first_cell + options_.slab_slices, nz_ - 1);
+    slab.first_plane = std::max(slab.first_cell - 1, 0);
+    const std::size_t plane = static_cast<std::size_t>(nx_) * ny_;
+    const int planes = slab.end_cell - slab.first_plane + 1;
+    slab.values.assign(plane * planes, 0.0f);
+    slab.inside.assign(plane * planes, 0);
+#pragma omp parallel for schedule(dynamic)
+    for (int p = 0; p < planes; ++p) {
+      const int k = slab.first_plane + p;
+      if (k < 1 || k > nz_ - 2) {
+        continue;
+      }
+      std::vector<float> slice(static_cast<std::size_t>(nx_ - 2) * (ny_ - 2));
+      source_(k - 1, slice.data());
+      for (int j = 1; j < ny_ - 1; ++j) {
+        for (int i = 1; i < nx_ - 1; ++i) {
+          const float v = slice[(i - 1) + static_cast<std::size_t>(nx_ - 2) * (j - 1)];
+          slab.values[p * plane + i + static_cast<std::size_t>(nx_) * j] = v;
+          slab.inside[p * plane + i + static_cast<std::size_t>(nx_) * j] = v >= iso_ ? 1 : 0;
+        }
+      }
+    }
+
+    const int end_plane = index == slabCount() - 1 ? nz_ : slab.end_cell;
+    const int blocks = (ny_ + kColumnBlock - 1) / kColumnBlock;
+    const int items = (end_plane - slab.first_cell) * blocks;
+    std::vector<std::vector<uint64_t>> keys(items);
+    std::vector<std::vector<Vec3>> vertices(items);
+#pragma omp parallel for schedule(dynamic)
+    for (int item = 0; item < items; ++item) {
+      const int k = slab.first_cell + item / blocks;
+      const int j_end = std::min((item % blocks + 1) * kColumnBlock, ny_);
+      for (int j = (item % blocks) * kColumnBlock; j < j_end; ++j) {
+        for (int i = 0; i < nx_; ++i) {
+          if (!real(i, j, k)) {
+            continue;
+          }
+          const bool in = inside(slab, i, j, k);
+          const float value = this->value(slab, i, j, k);
+          if (in && pointVertex(slab, i, j, k, value)) {
+            keys[item].push_back(key(i, j, k, 0));
+            vertices[item].push_back(position(i, j, k));
+          }
+          for (int d = 1; d < 8; ++d) {
+            const int qi = i + (d & 1), qj = j + ((d >> 1) & 1), qk = k + (d >> 2);
+            if (!real(qi, qj, qk) || inside(slab, qi, qj, qk) == in) {
+              continue;
+            }
+            const float other = this->value(slab, qi, qj, qk);
+            // A crossing on an inside point at the isovalue is the point's
+            if ((in ? value : other) == iso_) {
+              continue;
+            }
+            const float t = (iso_ - value) / (other - value);
+            const Vec3 a = position(i, j, k), b = position(qi, qj, qk);
+            keys[item].push_back(key(i, j, k, d));
+            vertices[item].push_back({a[0] + t * (b[0] - a[0]), a[1] + t * (b[1] - a[1]), a[2] + t * (b[2] - a[2])});
+          }
+        }
+      }
+    }
+    slab.keys.clear();
+    slab.vertices.clear();
+    for (int item = 0; item < items; ++item) {
+      slab.keys.insert(slab.keys.end(), keys[item].begin(), keys[item].end());
+      slab.vertices.insert(slab.vertices.end(), vertices[item].begin(), vertices[item].end());
+    }
+  }
+
+  // Triangles of a slab's cells; vertices past its planes are the next
+  // slab's
+  void triangulate(Slab& slab, const Slab& next) const {
+    const int blocks = (ny_ - 1 + kColumnBlock - 1) / kColumnBlock;
+    const int items = (slab.end_cell - slab.first_cell) * blocks;
+    std::vector<std::vector<std::array<uint32_t, 3>>> triangles(items);
+#pragma omp parallel for schedule(dynamic)
+    for (int item = 0; item < items; ++item) {
+      const int k = slab.first_cell + item / blocks;
+      const int j_end = std::min((item % blocks + 1) * kColumnBlock, ny_ - 1);
+      for (int j = (item % blocks) * kColumnBlock; j < j_end; ++j) {
+        for (int i = 0; i < nx_ - 1; ++i) {
+          int corners_in = 0;
+          for (int c = 0; c < 8; ++c) {
+            corners_in += inside(slab, i + (c & 1), j + ((c >> 1) & 1), k + (c >> 2));
+          }
+          if (corners_in == 0 || corners_in == 8) {
+            continue;
+          }
+          for (const auto& tetrahedron : kTetrahedra) {
+            cutTetrahedron(slab, next, i, j, k, tetrahedron, triangles[item]);
+          }
+        }
+      }
+    }
+    slab.triangles.clear();
+    for (const auto& part : triangles) {
+      slab.triangles.insert(slab.triangles.end(), part.begin(), part.end());
+    }
+  }
+
+private:
+  struct Vertex {
+    uint32_t index;
+    Vec3 position;
+  };
+
+  bool real(int i, int j, int k) const {
+    return i >= 1 && i <= nx_ - 2 && j >= 1 && j <= ny_ - 2 && k >= 1 && k <= nz_ - 2;
+  }
+  std::size_t offset(const Slab& slab, int i, int j, int k) const {
+    return static_cast<std::size_t>(i) + static_cast<std::size_t>(nx_) * (j + static_cast<std::size_t>(ny_) * (k - slab.first_plane));
+  }
+  bool inside(const Slab& slab, int i, int j, int k) const {
+    return i >= 0 && i < nx_ && j >= 0 && j < ny_ && k >= 0 && k < nz_ && slab.inside[offset(slab, i, j, k)];
+  }
+  float value(const Slab& slab, int i, int j, int k) const { return slab.values[offset(slab, i, j, k)]; }
+  uint64_t key(int i, int j, int k, int slot) const {
+    return (static_cast<uint64_t>(i) + static_cast<uint64_t>(nx_) * (j + static_cast<uint64_t>(ny_) * k)) * 8 + slot;
+  }
+  Vec3 position(int i, int j, int k) const {
+    return {options_.origin[0] + (i - 1) * options_.spacing[0], options_.origin[1] + (j - 1) * options_.spacing[1],
+            options_.origin[2] + (k - 1) * options_.spacing[2]};
+  }
+
+  // An inside point carries a vertex when an edge leaves it for the
+  // padding, or for an outside point while it sits at the isovalue
+  bool pointVertex(const Slab& slab, int i, int j, int k, float value) const {
+    for (int d = 1; d < 8; ++d) {
+      for (int sign = -1; sign <= 1; sign += 2) {
+        const int qi = i + sign * (d & 1), qj = j + sign * ((d >> 1) & 1), qk = k + sign * (d >> 2);
+        if (qi < 0 || qi >= nx_ || qj < 0 || qj >= ny_ || qk < 0 || qk >= nz_) {
+          continue;
+        }
+        if (!real(qi, qj, qk) || (value == iso_ && !inside(slab, qi, qj, qk))) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  Vertex find(const Slab& slab, const Slab& next, uint64_t key, int plane) const {
+    const Slab& holder = plane >= slab.end_cell && &next != &slab ? next : slab;
+    const auto found = std::lower_bound(holder.keys.begin(), holder.keys.end(), key);
+    const std::size_t local = found - holder.keys.begin();
+    return {static_cast<uint32_t>(holder.first_vertex + local), holder.vertices[local]};
+  }
+
+  // Vertex on the edge between two corners of the cell at (i, j, k)
+  Vertex edgeVertex(const Slab& slab, const Slab& next, int i, int j, int k, int a, int b) const {
+    const int low = std::min(a, b), high = std::max(a, b);
+    const int li = i + (low & 1), lj = j + ((low >> 1) & 1), lk = k + (low >> 2);
+    const int hi = i + (high & 1), hj = j + ((high >> 1) & 1), hk = k + (high >> 2);
+    const bool low_real = real(li, lj, lk), high_real = real(hi, hj, hk);
+    if (low_real && high_real) {
+      const bool low_in = inside(slab, li, lj, lk);
+      const float at = low_in ? value(slab, li, lj, lk) : value(slab, hi, hj, hk);
+      if (at != iso_) {
+        return find(slab, next, key(li, lj, lk, low ^ high), lk);
+      }
+      return low_in ? find(slab, next, key(li, lj, lk, 0), lk) : find(slab, next, key(hi, hj, hk, 0), hk);
+    }
+    return low_real ? find(slab, next, key(li, lj, lk, 0), lk) : find(slab, next, key(hi, hj, hk, 0), hk);
+  }
+
+  void cutTetrahedron(const Slab& slab, const Slab& next, int i, int j, int k, const int (&corners)[4],
+                      std::vector<std::array<uint32_t, 3>>& triangles) const {
+    int in[4], out[4], ins = 0, outs = 0;
+    Vec3 in_sum = {0.0f, 0.0f, 0.0f}, out_sum = {0.0f, 0.0f, 0.0f};
+    for (int c : corners) {
+      const int ci = i + (c & 1), cj = j + ((c >> 1) & 1), ck = k + (c >> 2);
+      const Vec3 p = position(ci, cj, ck);
+      const bool is_in = inside(slab, ci, cj, ck);
+      (is_in ? in[ins++] : out[outs++]) = c;
+      Vec3& sum = is_in ? in_sum : out_sum;
+      for (int axis = 0; axis < 3; ++axis) {
+        sum[axis] += p[axis];
+      }
+    }
+    if (ins == 0 || outs == 0) {
+      return;
+    }
+    // From the inside corners' centroid to the outside corners': the field
+    // falls along it, so outward normals face it
+    Vec3 toward_out;
+    for (int axis = 0; axis < 3; ++axis) {
+      toward_out[axis] = out_sum[axis] / outs - in_sum[axis] / ins;
+    }
+    auto emit = [&](const Vertex& a, const Vertex& b, const Vertex& c) {
+      if (a.index == b.index || b.index == c.index || a.index == c.index) {
+        return;
+      }
+      const Vec3 normal = cross(difference(b.position, a.position), difference(c.position, a.position));
+      const float facing = normal[0] * toward_out[0] + normal[1] * toward_out[1] + normal[2] * toward_out[2];
+      triangles.push_back(facing >= 0.0f ? std::array<uint32_t, 3>{a.index, b.index, c.index}
+                                         : std::array<uint32_t, 3>{a.index, c.index, b.index});
+    };
+    auto on = [&](int a, int b) { return edgeVertex(slab, next, i, j, k, a, b); };
+    if (ins == 1) {
+      emit(on(in[0], out[0]), on(in[0], out[1]), on(in[0], out[2]));
+    } else if (ins == 3) {
+      emit(on(out[0], in[0]), on(out[0], in[1]), on(out[0], in[2]));
+    } else {
+      const Vertex ac = on(in[0], out[0]), ad = on(in[0], out[1]), bd = on(in[1], out[1]), bc = on(in[1], out[0]);
+      emit(ac, ad, bd);
+      emit(ac, bd, bc);
+    }
+  }
+
+  int nx_, ny_, nz_;
+  const IsoMesher::SliceSource& source_;
+  float iso_;
+  const IsoMesher::Options& options_;
+};
+
+} // namespace
+
+StlMeshWriter::StlMeshWriter(const std::string& path) : out_(path, std::ios::binary) {
+  if (!out_) {
+    throw std::runtime_error("StlMeshWriter: cannot create " + path);
+  }
+  char header[80] = "SemiPRO binary STL";
+  const uint32_t count = 0;
+  out_.write(header, sizeof(header));
+  out_.write(reinterpret_cast<const char*>(&count), sizeof(count));
+}
+
+void StlMeshWriter::add(const MeshChunk& chunk) {
+  auto vertex = [&](uint32_t index) -> const Vec3& {
+    return index >= chunk.first_vertex ? chunk.vertices[index - chunk.first_vertex]
+                                       : previous_[index - previous_first_];
+  };
+  // Normal, corners and a zero attribute count: 50 bytes, little-endian
+  // as every host we build for
+  std::vector<char> records(chunk.triangles.size() * 50, 0);
+  char* record = records.data();
+  for (const auto& triangle : chunk.triangles) {
+    const Vec3& a = vertex(triangle[0]);
+    const Vec3& b = vertex(triangle[1]);
+    const Vec3& c = vertex(triangle[2]);
+    Vec3 normal = cross(difference(b, a), difference(c, a));
+    const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    for (float& n : normal) {
+      n = length > 0.0f ? n / length : 0.0f;
+    }
+    std::memcpy(record, normal.data(), 12);
+    std::memcpy(record + 12, a.data(), 12);
+    std::memcpy(record + 24, b.data(), 12);
+    std::memcpy(record + 36, c.data(), 12);
+    record += 50;
+  }
+  out_.write(records.data(), static_cast<std::streamsize>(records.size()));
+  triangles_ += chunk.triangles.size();
+  previous_ = chunk.vertices;
+  previous_first_ = chunk.first_vertex;
+}
+
+void StlMeshWriter::finish() {
+  if (triangles_ > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("StlMeshWriter: too many triangles for STL");
+  }
+  const uint32_t count = static_cast<uint32_t>(triangles_);
+  out_.seekp(80);
+  out_.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  out_.close();
+  if (out_.fail()) {
+    throw std::runtime_error("StlMeshWriter: write failed");
+  }
+}
+
+PlyMeshWriter::PlyMeshWriter(const std::string& path)
+    : faces_path_(path + ".faces"), out_(path, std::ios::binary), faces_(faces_path_, std::ios::binary) {
+  if (!out_ || !faces_) {
+    throw std::runtime_error("PlyMeshWriter: cannot create " + path);
+  }
+  out_ << header(0, 0);
+}
+
+PlyMeshWriter::~PlyMeshWriter() {
+  if (faces_.is_open()) {
+    faces_.close();
+    std::remove(faces_path_.c_str());
+  }
+}
+
+std::string PlyMeshWriter::header(uint64_t vertices, uint64_t faces) {
+  // Counts are zero-padded to a fixed width so finish() can rewrite them
+  // in place
+  char text[256];
+  std::snprintf(text, sizeof(text),
+                "ply\nformat binary_little_endian 1.0\nelement vertex %020llu\n"
+                "property float x\nproperty float y\nproperty float z\nelement face %020llu\n"
+                "property list uchar uint vertex_indices\nend_header\n",
+                static_cast<unsigned long long>(vertices), static_cast<unsigned long long>(faces));
+  return text;
+}
+
+void PlyMeshWriter::add(const MeshChunk& chunk) {
+  out_.write(reinterpret_cast<const char*>(chunk.vertices.data()),
+             static_cast<std::streamsize>(chunk.vertices.size() * sizeof(Vec3)));
+  std::vector<char> records(chunk.triangles.size() * 13);
+  char* record = records.data();
+  for (const auto& triangle : chunk.triangles) {
+    record[0] = 3;
+    std::memcpy(record + 1, triangle.data(), 12);
+    record += 13;
+  }
+  faces_.write(records.data(), static_cast<std::streamsize>(records.size()));
+  vertices_ += chunk.vertices.size();
+  face_count_ += chunk.triangles.size();
+}
+
+void PlyMeshWriter::finish() {
+  faces_.close();
+  bool failed = faces_.fail();
+  if (!failed && face_count_ > 0) {
+    std::ifstream faces(faces_path_, std::ios::binary);
+    out_ << faces.rdbuf();
+  }
+  std::remove(faces_path_.c_str());
+  out_.seekp(0);
+  out_ << header(vertices_, face_count_);
+  out_.close();
+  if (failed || out_.fail()) {
+    throw std::runtime_error("PlyMeshWriter: write failed");
+  }
+}
+
+std::unique_ptr<MeshSink> openMeshWriter(const std::string& path) {
+  const std::size_t dot = path.find_last_of('.');
+  std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  if (extension == "stl") {
+    return std::make_unique<StlMeshWriter>(path);
+  }
+  if (extension == "ply") {
+    return std::make_unique<PlyMeshWriter>(path);
+  }
+  throw std::invalid_argument("openMeshWriter: unknown mesh format for " + path);
+}
+
+IsoMesher::IsoMesher(const Options& options) : options_(options) {
+  for (float spacing : options_.spacing) {
+    if (spacing == 0.0f || !std::isfinite(spacing)) {
+      throw std::invalid_argument("IsoMesher: spacing must be non-zero and finite");
+    }
+  }
+  if (options_.slab_slices < 1) {
+    throw std::invalid_argument("IsoMesher: slabs must hold a slice");
+  }
+}
+
+IsoMesher::Stats IsoMesher::extract(int rows, int cols, int slices, const SliceSource& source, float iso,
+                                    MeshSink& sink) const {
+  if (rows < 1 || cols < 1 || slices < 1) {
+    throw std::invalid_argument("IsoMesher: dimensions must be positive");
+  }
+  const PaddedGrid grid(rows, cols, slices, source, iso, options_);
+  const int count = grid.slabCount();
+  Stats stats;
+  auto checkIndices = [](const Slab& slab) {
+    if (slab.first_vertex + slab.vertices.size() > std::numeric_limits<uint32_t>::max()) {
+      throw std::overflow_error("IsoMesher: more than 2^32 vertices");
+    }
+  };
+  Slab previous, current, next;
+  grid.read(0, current);
+  checkIndices(current);
+  for (int s = 0; s < count; ++s) {
+    if (s + 1 < count) {
+      grid.read(s + 1, next);
+      next.first_vertex = current.first_vertex + current.vertices.size();
+      checkIndices(next);
+    }
+    grid.triangulate(current, s + 1 < count ? next : current);
+    // The previous slab's triangles reach into this slab's vertices
+    MeshChunk chunk;
+    chunk.first_vertex = current.first_vertex;
+    chunk.vertices = std::move(current.vertices);
+    chunk.triangles = std::move(previous.triangles);
+    sink.add(chunk);
+    stats.vertices += chunk.vertices.size();
+    stats.triangles += chunk.triangles.size();
+    current.vertices = std::move(chunk.vertices);
+    previous = std::move(current);
+    current = std::move(next);
+    next = Slab();
+  }
+  MeshChunk last;
+  last.first_vertex = stats.vertices;
+  last.triangles = std::move(previous.triangles);
+  sink.add(last);
+  stats.triangles += last.triangles.size();
+  sink.finish();
+  return stats;
+}
+
+IsoMesher::Stats IsoMesher::extract(const FieldVolume& volume, float iso, MeshSink& sink) const {
+  return extract(
+      volume.rows(), volume.cols(), volume.slices(),
+      [&volume](int slice, float* plane) {
+        Eigen::Map<Eigen::ArrayXXf>(plane, volume.rows(), volume.cols()) = volume.slice(slice);
+      },
+      iso, sink);
+}
+
+IsoMesher::Stats meshHeightField(const Eigen::Ref<const Eigen::ArrayXXd>& heights, float row_spacing, float col_spacing,
+                                 MeshSink& sink) {
+  if (heights.size() == 0) {
+    throw std::invalid_argument("meshHeightField: empty height map");
+  }
+  if (!(row_spacing > 0.0f) || !(col_spacing > 0.0f)) {
+    throw std::invalid_argument("meshHeightField: spacing must be positive");
+  }
+  const double top = heights.maxCoeff();
+  if (!(top > 0.0)) {
+    throw std::invalid_argument("meshHeightField: no positive height");
+  }
+  // Two slices, at the top and at z = 0, of height less z. The field is
+  // linear up each column, so vertical edges cross exactly at the surface.
+  IsoMesher::Options options;
+  options.spacing = {row_spacing, col_spacing, -static_cast<float>(top)};
+  options.origin = {0.0f, 0.0f, static_cast<float>(top)};
+  return IsoMesher(options).extract(
+      static_cast<int>(heights.rows()), static_cast<int>(heights.cols()), 2,
+      [&heights, top](int slice, float* plane) {
+        Eigen::Map<Eigen::ArrayXXf>(plane, heights.rows(), heights.cols()) =
+            (heights - (slice == 0 ? top : 0.0)).cast<float>();
+      },
+      0.0f, sink);
+}
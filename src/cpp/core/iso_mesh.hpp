@@ -0,0 +1,122 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "field_volume.hpp"
+#include <Eigen/Dense>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Part of a mesh streamed out by IsoMesher: the vertices numbered from
+// first_vertex on and triangles, counter-clockwise seen from outside.
+// Triangles refer only to vertices of their own chunk or the one before.
+struct MeshChunk {
+  uint64_t first_vertex = 0;
+  std::vector<std::array<float, 3>> vertices;
+  std::vector<std::array<uint32_t, 3>> triangles;
+};
+
+// Receives a mesh chunk by chunk, so no more than two chunks need be held
+class MeshSink {
+public:
+  virtual ~MeshSink() = default;
+  virtual void add(const MeshChunk& chunk) = 0;
+  // After the last chunk
+  virtual void finish() = 0;
+};
+
+// Binary STL. The triangle count in the header is patched by finish().
+class StlMeshWriter : public MeshSink {
+public:
+  // Throws std::runtime_error if the file cannot be created
+  explicit StlMeshWriter(const std::string& path);
+  void add(const MeshChunk& chunk) override;
+  // Throws std::runtime_error if writing failed or the mesh exceeds the
+  // format's 2^32 - 1 triangles
+  void finish() override;
+
+private:
+  std::ofstream out_;
+  std::vector<std::array<float, 3>> previous_;
+  uint64_t previous_first_ = 0;
+  uint64_t triangles_ = 0;
+};
+
+// Binary little-endian PLY with shared vertices. Vertices go straight to
+// the file; faces, which PLY puts after every vertex, go to a scratch file
+// beside it that finish() appends and removes.
+class PlyMeshWriter : public MeshSink {
+public:
+  // Throws std::runtime_error if either file cannot be created
+  explicit PlyMeshWriter(const std::string& path);
+  ~PlyMeshWriter() override;
+  void add(const MeshChunk& chunk) override;
+  // Throws std::runtime_error if writing failed
+  void finish() override;
+
+private:
+  static std::string header(uint64_t vertices, uint64_t faces);
+
+  std::string faces_path_;
+  std::ofstream out_;
+  std::ofstream faces_;
+  uint64_t vertices_ = 0;
+  uint64_t face_count_ = 0;
+};
+
+// StlMeshWriter or PlyMeshWriter by the path's extension, .stl or .ply in
+// any case; throws std::invalid_argument for any other
+std::unique_ptr<MeshSink> openMeshWriter(const std::string& path);
+
+// Isosurface of a scalar field on a rows x cols x slices grid by marching
+// tetrahedra: every cell splits into six tetrahedra around its main
+// diagonal, the same way in every cell, so the surface is watertight and
+// has no ambiguous cases. The field is taken as below the isovalue beyond
+// the grid, which closes the surface over the grid's faces. Vertices lie
+// on grid edges and each edge's vertex is shared by every triangle using
+// it, so the mesh is welded.
+//
+// Slices are read and meshed a slab of Options::slab_slices at a time,
+// each slab split into blocks of columns across the OpenMP threads. Only
+// the slabs next to the one being meshed are held; the rest is in the sink.
+class IsoMesher {
+public:
+  // Fills `plane` with one slice, column-major rows x cols. Called from
+  // several threads at once.
+  using SliceSource = std::function<void(int slice, float* plane)>;
+
+  struct Options {
+    std::array<float, 3> spacing = {1.0f, 1.0f, 1.0f}; // Along rows, cols and slices
+    std::array<float, 3> origin = {0.0f, 0.0f, 0.0f};  // Position of cell (0, 0, 0)
+    int slab_slices = 4;
+  };
+
+  struct Stats {
+    uint64_t vertices = 0;
+    uint64_t triangles = 0;
+  };
+
+  // Throws std::invalid_argument for a zero spacing or slabs under one
+  // slice. A negative spacing runs that axis backwards.
+  explicit IsoMesher(const Options& options);
+  IsoMesher() : IsoMesher(Options()) {}
+
+  // Surface where the field crosses `iso`, inside where it is at least
+  // `iso`. Throws std::invalid_argument for a dimension below 1 and
+  // std::overflow_error past 2^32 vertices.
+  Stats extract(int rows, int cols, int slices, const SliceSource& source, float iso, MeshSink& sink) const;
+  Stats extract(const FieldVolume& volume, float iso, MeshSink& sink) const;
+
+private:
+  Options options_;
+};
+
+// Closed solid under a height map: from z = 0 up to heights(row, col),
+// rows along x and columns along y at the given spacings, as the wafer's
+// grid field holds its surface. Throws std::invalid_argument for an empty
+// map, a spacing that is not positive or a map with no positive height.
+IsoMesher::Stats meshHeightField(const Eigen::Ref<const Eigen::ArrayXXd>& heights, float row_spacing, float col_spacing,
+                                 MeshSink& sink);
@@ -0,0 +1,344 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "job_manifest.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace SemiPRO {
+
+namespace {
+
+[[noreturn]] void invalid(const std::string& path, const std::string& requirement) {
+    throw std::invalid_argument(path + " must be " + requirement);
+}
+
+std::string member(const std::string& path, const std::string& key) {
+    return path.empty() ? key : path + "." + key;
+}
+
+std::string optionalText(const JsonValue& node, const std::string& key, const std::string& path) {
+    const JsonValue* value = node.find(key);
+    if (!value) {
+        return "";
+    }
+    if (!value->isString()) {
+        invalid(member(path, key), "a string");
+    }
+    return value->asString();
+}
+
+const JsonValue& checkedObject(const JsonValue& node, const std::string& path) {
+    if (!node.isObject()) {
+        invalid(path.empty() ? "The config document" : path, "an object");
+    }
+    return node;
+}
+
+void checkParameters(const JsonValue& parameters, const std::string& path) {
+    for (const auto& [key, value] : checkedObject(parameters, path).members()) {
+        if (!value.isScalar()) {
+            invalid(member(path, key), "a number, string or boolean");
+        }
+    }
+}
+
+void checkGeometry(const JsonValue& geometry, const std::string& path) {
+    checkedObject(geometry, path);
+    for (const char* key : {"diameter", "thickness"}) {
+        const JsonValue* value = geometry.find(key);
+        if (value && (!value->isNumber() || !(value->asNumber() > 0.0))) {
+            invalid(member(path, key), "a positive number");
+        }
+    }
+    optionalText(geometry, "material", path);
+}
+
+void checkGrid(const JsonValue& grid, const std::string& path) {
+    checkedObject(grid, path);
+    for (const char* key : {"x_dimension", "y_dimension"}) {
+        const JsonValue* value = grid.find(key);
+        if (value && (!value->isNumber() || value->asNumber() < 1.0 || value->asNumber() > 1e6 ||
+                      std::floor(value->asNumber()) != value->asNumber())) {
+            invalid(member(path, key), "a positive integer");
+        }
+    }
+}
+
+ConfigJob readJob(const JsonValue& node, const std::string& path, const std::string& default_name) {
+    checkedObject(node, path);
+    ConfigJob job;
+    job.name = optionalText(node, "name", path);
+    if (job.name.empty()) {
+        job.name = default_name;
+    }
+    job.wafer = optionalText(node, "wafer", path);
+
+    if (const JsonValue* simulation = node.find("simulation")) {
+        const std::string simulation_path = member(path, "simulation");
+        checkedObject(*simulation, simulation_path);
+        if (const JsonValue* geometry = simulation->find("wafer")) {
+            checkGeometry(*geometry, member(simulation_path, "wafer"));
+            job.geometry = *geometry;
+        }
+        if (const JsonValue* grid = simulation->find("grid")) {
+            checkGrid(*grid, member(simulation_path, "grid"));
+            job.grid = *grid;
+        }
+        if (const JsonValue* process = simulation->find("process")) {
+            const std::string process_path = member(simulation_path, "process");
+            checkedObject(*process, process_path);
+            job.process = optionalText(*process, "operation", process_path);
+            if (const JsonValue* parameters = process->find("parameters")) {
+                checkParameters(*parameters, member(process_path, "parameters"));
+                job.parameters = *parameters;
+            }
+        }
+        return job;
+    }
+
+    const JsonValue* process = node.find("process");
+    if (!process) {
+        // Flat layout: the whole object holds the process parameters
+        checkParameters(node, path);
+        job.parameters = node;
+        return job;
+    }
+    job.process = optionalText(node, "process", path);
+    if (const JsonValue* parameters = node.find("parameters")) {
+        checkParameters(*parameters, member(path, "parameters"));
+        job.parameters = *parameters;
+    }
+    if (const JsonValue* geometry = node.find("geometry")) {
+        checkGeometry(*geometry, member(path, "geometry"));
+        job.geometry = *geometry;
+    }
+    if (const JsonValue* grid = node.find("grid")) {
+        checkGrid(*grid, member(path, "grid"));
+        job.grid = *grid;
+    }
+    return job;
+}
+
+// Where an axis value goes in a job
+JsonValue& axisSection(ConfigJob& job, const std::string& axis, std::string& key) {
+    for (auto [prefix, section] : {std::make_pair("geometry.", &job.geometry), std::make_pair("grid.", &job.grid)}) {
+        const std::string start(prefix);
+        if (axis.compare(0, start.size(), start) == 0) {
+            key = axis.substr(start.size());
+            return *section;
+        }
+    }
+    key = axis;
+    return job.parameters;
+}
+
+struct SweepAxis {
+    std::string name;
+    std::vector<JsonValue> levels; // For lists, and ranges with a count
+    double min = 0.0;
+    double max = 0.0;
+    bool range = false;
+    bool integer = false;
+};
+
+double rangeNumber(const JsonValue& spec, const char* key, const std::string& path) {
+    const JsonValue* value = spec.find(key);
+    if (!value || !value->isNumber()) {
+        invalid(member(path, key), "a number");
+    }
+    return value->asNumber();
+}
+
+SweepAxis readAxis(const std::string& name, const JsonValue& spec, const std::string& path) {
+    SweepAxis axis;
+    axis.name = name;
+    if (spec.isArray()) {
+        if (spec.size() == 0) {
+            invalid(path, "a non-empty list");
+        }
+        for (const auto& level : spec.items()) {
+            if (!level.isScalar()) {
+                invalid(path, "a list of numbers, strings or booleans");
+            }
+            axis.levels.push_back(level);
+        }
+        return axis;
+    }
+    if (!spec.isObject()) {
+        invalid(path, "a list of levels or a {min, max} range");
+    }
+    axis.range = true;
+    axis.min = rangeNumber(spec, "min", path);
+    axis.max = rangeNumber(spec, "max", path);
+    if (!(axis.max >= axis.min)) {
+        invalid(member(path, "max"), "at least min");
+    }
+    if (const JsonValue* integer = spec.find("integer")) {
+        if (!integer->isBool()) {
+            invalid(member(path, "integer"), "a boolean");
+        }
+        axis.integer = integer->asBool();
+    }
+    if (const JsonValue* count = spec.find("count")) {
+        if (!count->isNumber() || count->asNumber() < 1.0 || std::floor(count->asNumber()) != count->asNumber()) {
+            invalid(member(path, "count"), "a positive integer");
+        }
+        const int n = static_cast<int>(count->asNumber());
+        for (int i = 0; i < n; ++i) {
+            const double t = n == 1 ? 0.0 : static_cast<double>(i) / (n - 1);
+            const double value = axis.min + (axis.max - axis.min) * t;
+            axis.levels.push_back(JsonValue::number(axis.integer ? std::round(value) : value));
+        }
+    }
+    return axis;
+}
+
+// splitmix64: the same draws on every platform, unlike <random>'s
+// distributions
+class SweepRandom {
+public:
+    explicit SweepRandom(std::uint64_t seed) : state_(seed) {}
+    std::uint64_t next() {
+        std::uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+private:
+    std::uint64_t state_;
+};
+
+constexpr std::size_t kMaxSweepPoints = 1000000;
+
+} // namespace
+
+ConfigSweep readConfigSweep(const JsonValue& document) {
+    const JsonValue& sweep = checkedObject(document["sweep"], "sweep");
+    const ConfigJob base = readJob(sweep["base"], "sweep.base", "");
+
+    const JsonValue& axes_spec = checkedObject(sweep["axes"], "sweep.axes");
+    if (axes_spec.size() == 0) {
+        invalid("sweep.axes", "a non-empty object");
+    }
+    std::vector<SweepAxis> axes;
+    for (const auto& [name, spec] : axes_spec.members()) {
+        axes.push_back(readAxis(name, spec, "sweep.axes." + name));
+    }
+
+    const std::string design = sweep.find("design") ? optionalText(sweep, "design", "sweep") : "cartesian";
+    std::vector<std::vector<JsonValue>> values;
+    if (design == "cartesian") {
+        std::size_t count = 1;
+        for (const auto& axis : axes) {
+            if (axis.levels.empty()) {
+                invalid("sweep.axes." + axis.name + ".count", "set for a cartesian range");
+            }
+            count *= axis.levels.size();
+            if (count > kMaxSweepPoints) {
+                invalid("sweep", "at most " + std::to_string(kMaxSweepPoints) + " points");
+            }
+        }
+        values.resize(count);
+        for (std::size_t point = 0; point < count; ++point) {
+            std::size_t rest = point;
+            values[point].resize(axes.size());
+            for (std::size_t a = axes.size(); a-- > 0;) {
+                values[point][a] = axes[a].levels[rest % axes[a].levels.size()];
+                rest /= axes[a].levels.size();
+            }
+        }
+    } else if (design == "latin_hypercube") {
+        const JsonValue& samples = sweep["samples"];
+        if (!samples.isNumber() || samples.asNumber() < 1.0 || samples.asNumber() > kMaxSweepPoints ||
+            std::floor(samples.asNumber()) != samples.asNumber()) {
+            invalid("sweep.samples", "a positive integer of at most " + std::to_string(kMaxSweepPoints));
+        }
+        const JsonValue& seed = sweep["seed"];
+        if (!seed.isNull() && (!seed.isNumber() || seed.asNumber() < 0.0)) {
+            invalid("sweep.seed", "a non-negative number");
+        }
+        const std::size_t n = static_cast<std::size_t>(samples.asNumber());
+        SweepRandom random(seed.isNull() ? 0 : static_cast<std::uint64_t>(seed.asNumber()));
+        values.assign(n, std::vector<JsonValue>(axes.size()));
+        std::vector<std::size_t> strata(n);
+        for (std::size_t a = 0; a < axes.size(); ++a) {
+            for (std::size_t i = 0; i < n; ++i) {
+                strata[i] = i;
+            }
+            for (std::size_t i = n; i-- > 1;) {
+                std::swap(strata[i], strata[random.next() % (i + 1)]);
+            }
+            const SweepAxis& axis = axes[a];
+            for (std::size_t point = 0; point < n; ++point) {
+                const double position = (strata[point] + random.uniform()) / n;
+                if (axis.range) {
+                    const double value = axis.min + (axis.max - axis.min) * position;
+                    values[point][a] = JsonValue::number(axis.integer ? std::round(value) : value);
+                } else {
+                    const std::size_t level = std::min(axis.levels.size() - 1,
+                                                       static_cast<std::size_t>(position * axis.levels.size()));
+                    values[point][a] = axis.levels[level];
+                }
+            }
+        }
+    } else {
+        invalid("sweep.design", "\"cartesian\" or \"latin_hypercube\"");
+    }
+
+    ConfigSweep result;
+    for (const auto& axis : axes) {
+        result.axes.push_back(axis.name);
+    }
+    result.output = sweep.find("output") ? optionalText(sweep, "output", "sweep") : "sweep_results.csv";
+    result.points.reserve(values.size());
+    for (std::size_t point = 0; point < values.size(); ++point) {
+        ConfigJob job = base;
+        job.name = "point" + std::to_string(point);
+        job.wafer.clear();
+        for (std::size_t a = 0; a < axes.size(); ++a) {
+            std::string key;
+            axisSection(job, axes[a].name, key).set(key, values[point][a]);
+        }
+        const std::string path = "sweep point " + std::to_string(point);
+        if (!job.parameters.isNull()) {
+            checkParameters(job.parameters, path + " parameters");
+        }
+        if (!job.geometry.isNull()) {
+            checkGeometry(job.geometry, path + " geometry");
+        }
+        if (!job.grid.isNull()) {
+            checkGrid(job.grid, path + " grid");
+        }
+        result.points.push_back(std::move(job));
+    }
+    result.values = std::move(values);
+    return result;
+}
+
+std::vector<ConfigJob> readConfigJobs(const JsonValue& document) {
+    if (document.find("sweep")) {
+        return readConfigSweep(document).points;
+    }
+    const JsonValue* jobs = document.isArray() ? &document : document.find("jobs");
+    if (!jobs) {
+        return {readJob(document, "", "job0")};
+    }
+    const std::string path = document.isArray() ? "" : "jobs";
+    if (!jobs->isArray()) {
+        invalid(path, "an array");
+    }
+
+    std::vector<ConfigJob> result;
+    result.reserve(jobs->size());
+    for (std::size_t i = 0; i < jobs->size(); ++i) {
+        const std::string index = std::to_string(i);
+        result.push_back(readJob(jobs->items()[i], path + "[" + index + "]", "job" + index));
+    }
+    return result;
+}
+
+} // namespace SemiPRO
@@ -0,0 +1,69 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef JOB_MANIFEST_HPP
+#define JOB_MANIFEST_HPP
+
+#include "json_value.hpp"
+#include <string>
+#include <vector>
+
+namespace SemiPRO {
+
+// One simulation job read from a config file
+struct ConfigJob {
+    std::string name;
+    std::string wafer;    // Empty: the caller's default wafer
+    std::string process;  // Empty: the caller's default process
+    JsonValue parameters; // Object of scalar process parameters
+    JsonValue geometry;   // diameter/thickness/material; null keeps the wafer
+    JsonValue grid;       // x_dimension/y_dimension; null keeps the grid
+};
+
+// Reads the jobs of a parsed config document, so a batch of N jobs is one
+// file parsed once rather than N process launches. Accepted layouts:
+//
+//   {"jobs": [job, ...]} or [job, ...]       a manifest of N jobs
+//   {"simulation": {"wafer": {...}, "grid": {...},
+//                   "process": {"operation": p, "parameters": {...}}}}
+//   {"process": p, "parameters": {...}, "geometry": {...}, "grid": {...}}
+//   {"temperature": 1000.0, ...}             flat parameters only
+//
+// Every job may use any single-job layout and may add "name" and "wafer"
+// (the name the wafer is registered under). Unnamed jobs are called
+// "job<index>". The document is checked against these layouts before any
+// job is returned: std::invalid_argument names the offending path, e.g.
+// "jobs[3].grid.x_dimension must be a positive integer". A sweep document
+// (see readConfigSweep) yields the jobs of its expanded points.
+std::vector<ConfigJob> readConfigJobs(const JsonValue& document);
+
+// One base job expanded over parameter axes
+struct ConfigSweep {
+    std::vector<std::string> axes;              // In declaration order
+    std::vector<ConfigJob> points;
+    std::vector<std::vector<JsonValue>> values; // values[point][axis]
+    std::string output;                         // Results table path
+};
+
+// Reads a sweep manifest:
+//
+//   {"sweep": {"base": job,
+//              "axes": {"temperature": [800, 900, 1000],
+//                       "time": {"min": 0.3, "max": 0.7, "count": 3},
+//                       "grid.x_dimension": {"min": 20, "max": 80, "integer": true}},
+//              "design": "cartesian" | "latin_hypercube",
+//              "samples": 20, "seed": 1, "output": "sweep_results.csv"}}
+//
+// The base job uses any single-job layout. An axis name is a process
+// parameter, or "geometry.<key>" / "grid.<key>" for the wafer and grid
+// sections. An axis is a list of levels or a {min, max} range. The
+// cartesian design (the default) crosses every level of every axis, the
+// first axis varying slowest; ranges then need a "count" of evenly spaced
+// levels. The Latin hypercube design draws "samples" points so that each
+// axis is split into that many equal strata, each hit exactly once;
+// ranges are sampled continuously (rounded when "integer" is set) and
+// lists by stratum. Draws depend only on "seed". Every point is validated
+// like a job of its own.
+ConfigSweep readConfigSweep(const JsonValue& document);
+
+} // namespace SemiPRO
+
+#endif // JOB_MANIFEST_HPP
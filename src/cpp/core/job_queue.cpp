@@ -0,0 +1,239 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "job_queue.hpp"
+#include "memory_manager.hpp"
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+
+namespace SemiPRO {
+
+namespace {
+
+// MemoryManager does not signal when usage drops, so runners held back by
+// memory pressure look again this often
+constexpr std::chrono::milliseconds kMemoryPollInterval(50);
+
+} // namespace
+
+bool JobQueue::Entry::operator<(const Entry& other) const {
+    return std::make_tuple(-priority, deadline, sequence) <
+           std::make_tuple(-other.priority, other.deadline, other.sequence);
+}
+
+JobQueue::JobQueue() : JobQueue(Limits()) {}
+
+JobQueue::JobQueue(const Limits& limits) : limits_(limits) {}
+
+size_t JobQueue::memoryBudget() const {
+    return limits_.memory_budget > 0 ? limits_.memory_budget : MemoryManager::getInstance().getMemoryLimit();
+}
+
+JobAdmission JobQueue::submit(const JobTicket& job) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+        return JobAdmission::CLOSED;
+    }
+    if (queued_ >= limits_.capacity) {
+        return JobAdmission::QUEUE_FULL;
+    }
+    auto tenant = tenants_.find(job.tenant);
+    if (tenant != tenants_.end() && tenant->second.queued.size() >= limits_.tenant_capacity) {
+        return JobAdmission::TENANT_LIMIT;
+    }
+    const size_t budget = memoryBudget();
+    if ((budget > 0 && job.memory_estimate > budget) ||
+        (queued_ >= limits_.max_running && MemoryManager::getInstance().isMemoryWarningTriggered())) {
+        return JobAdmission::INSUFFICIENT_MEMORY;
+    }
+
+    tenants_[job.tenant].queued.insert(Entry{job.priority, job.deadline, next_sequence_++, job});
+    ++queued_;
+    changed_.notify_one();
+    return JobAdmission::ACCEPTED;
+}
+
+void JobQueue::dropExpired(std::chrono::steady_clock::time_point now) {
+    for (auto tenant = tenants_.begin(); tenant != tenants_.end();) {
+        auto& queued = tenant->second.queued;
+        for (auto it = queued.begin(); it != queued.end();) {
+            if (it->deadline < now) {
+                expired_.push_back(it->ticket.id);
+                it = queued.erase(it);
+                --queued_;
+            } else {
+                ++it;
+            }
+        }
+        tenant = eraseIfIdle(tenant);
+    }
+}
+
+std::map<std::string, JobQueue::Tenant>::iterator JobQueue::eraseIfIdle(
+    std::map<std::string, Tenant>::iterator tenant) {
+    if (tenant->second.running == 0 && tenant->second.queued.empty()) {
+        return tenants_.erase(tenant);
+    }
+    return std::next(tenant);
+}
+
+std::map<std::string, JobQueue::Tenant>::iterator JobQueue::nextTenant() {
+    auto best = tenants_.end();
+    for (auto it = tenants_.begin(); it != tenants_.end(); ++it) {
+        if (it->second.queued.empty()) {
+            continue;
+        }
+        if (best == tenants_.end()) {
+            best = it;
+            continue;
+        }
+        const Entry& a = *it->second.queued.begin();
+        const Entry& b = *best->second.queued.begin();
+        if (std::make_tuple(-a.priority, it->second.running, a.deadline, a.sequence) <
+            std::make_tuple(-b.priority, best->second.running, b.deadline, b.sequence)) {
+            best = it;
+        }
+    }
+    return best;
+}
+
+bool JobQueue::startable(const Entry& entry) const {
+    if (running_ >= limits_.max_running) {
+        return false;
+    }
+    if (running_ == 0) {
+        return true;
+    }
+    const size_t budget = memoryBudget();
+    if (budget > 0 && reserved_memory_ + entry.ticket.memory_estimate > budget) {
+        return false;
+    }
+    return !MemoryManager::getInstance().isMemoryWarningTriggered();
+}
+
+bool JobQueue::tryStart(JobTicket& job, bool& memory_bound) {
+    dropExpired(std::chrono::steady_clock::now());
+    auto tenant = nextTenant();
+    if (tenant == tenants_.end()) {
+        return false;
+    }
+    auto first = tenant->second.queued.begin();
+    if (!startable(*first)) {
+        memory_bound = running_ < limits_.max_running;
+        return false;
+    }
+
+    job = first->ticket;
+    tenant->second.queued.erase(first);
+    --queued_;
+    ++running_;
+    ++tenant->second.running;
+    reserved_memory_ += job.memory_estimate;
+    return true;
+}
+
+bool JobQueue::acquireUntil(JobTicket& job, std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        bool memory_bound = false;
+        if (tryStart(job, memory_bound)) {
+            return true;
+        }
+        if (closed_ && queued_ == 0) {
+            return false;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return false;
+        }
+        if (memory_bound) {
+            changed_.wait_until(lock, std::min(deadline, now + kMemoryPollInterval));
+        } else if (deadline == std::chrono::steady_clock::time_point::max()) {
+            changed_.wait(lock);
+        } else {
+            changed_.wait_until(lock, deadline);
+        }
+    }
+}
+
+bool JobQueue::acquire(JobTicket& job) {
+    return acquireUntil(job, std::chrono::steady_clock::time_point::max());
+}
+
+bool JobQueue::acquireFor(JobTicket& job, std::chrono::milliseconds timeout) {
+    return acquireUntil(job, std::chrono::steady_clock::now() + timeout);
+}
+
+void JobQueue::finish(const JobTicket& job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ -= std::min<size_t>(running_, 1);
+        reserved_memory_ -= std::min(reserved_memory_, job.memory_estimate);
+        auto tenant = tenants_.find(job.tenant);
+        if (tenant != tenants_.end()) {
+            tenant->second.running -= std::min<size_t>(tenant->second.running, 1);
+            eraseIfIdle(tenant);
+        }
+    }
+    changed_.notify_all();
+}
+
+bool JobQueue::cancel(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto tenant = tenants_.begin(); tenant != tenants_.end(); ++tenant) {
+        auto& queued = tenant->second.queued;
+        auto it = std::find_if(queued.begin(), queued.end(),
+                               [&id](const Entry& entry) { return entry.ticket.id == id; });
+        if (it != queued.end()) {
+            queued.erase(it);
+            --queued_;
+            eraseIfIdle(tenant);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobQueue::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    changed_.notify_all();
+}
+
+void JobQueue::setLimits(const Limits& limits) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        limits_ = limits;
+    }
+    changed_.notify_all();
+}
+
+JobQueue::Limits JobQueue::limits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limits_;
+}
+
+size_t JobQueue::queuedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_;
+}
+
+size_t JobQueue::runningCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+size_t JobQueue::tenantCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tenants_.size();
+}
+
+std::vector<std::string> JobQueue::takeExpired() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> expired;
+    expired.swap(expired_);
+    return expired;
+}
+
+} // namespace SemiPRO
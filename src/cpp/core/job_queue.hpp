@@ -0,0 +1,121 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef JOB_QUEUE_HPP
+#define JOB_QUEUE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace SemiPRO {
+
+// A unit of work waiting for admission, e.g. one workflow execution
+struct JobTicket {
+    std::string id;
+    std::string tenant;          // Fairness domain; "" is a tenant too
+    int priority = 0;            // Higher runs first
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    size_t memory_estimate = 0;  // Peak bytes the job is expected to need
+};
+
+enum class JobAdmission {
+    ACCEPTED,
+    QUEUE_FULL,
+    TENANT_LIMIT,
+    INSUFFICIENT_MEMORY,
+    CLOSED
+};
+
+// Bounded admission queue in front of a pool of job runners.
+//
+// Jobs start in priority order. Among tenants with work of the same
+// priority, the tenant with the fewest running jobs goes first, so one
+// tenant's burst cannot occupy every runner; ties go to the nearest
+// deadline, then to submission order. Jobs whose deadline passes while
+// queued are dropped and reported through takeExpired().
+//
+// Memory is checked twice. submit() rejects work once the queue can no
+// longer drain it without swapping: a job larger than the budget, or any
+// job beyond a backlog of max_running while MemoryManager reports memory
+// pressure. acquire() holds the next job while running jobs' estimates
+// plus its own exceed the budget or while pressure lasts. The next job
+// stays first in line, so big jobs are not starved by small ones. With
+// nothing running the next job always starts.
+class JobQueue {
+public:
+    struct Limits {
+        size_t capacity = 256;        // Queued jobs in total
+        size_t tenant_capacity = 64;  // Queued jobs per tenant
+        size_t max_running = 4;
+        size_t memory_budget = 0;     // 0 uses MemoryManager's limit, if any
+    };
+
+    JobQueue();
+    explicit JobQueue(const Limits& limits);
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+
+    JobAdmission submit(const JobTicket& job);
+    // Blocks until a job may start and moves it to running; returns false
+    // once the queue is closed and empty. Every acquired ticket must be
+    // handed back to finish() as returned.
+    bool acquire(JobTicket& job);
+    bool acquireFor(JobTicket& job, std::chrono::milliseconds timeout);
+    void finish(const JobTicket& job);
+    // Removes a queued job; false if it is not queued (anymore)
+    bool cancel(const std::string& id);
+    // Rejects further submissions and wakes all waiting runners
+    void close();
+
+    void setLimits(const Limits& limits);
+    Limits limits() const;
+    size_t queuedCount() const;
+    size_t runningCount() const;
+    // Tenants with jobs queued or running; idle ones are not kept
+    size_t tenantCount() const;
+    std::vector<std::string> takeExpired();
+
+private:
+    struct Entry {
+        int priority;
+        std::chrono::steady_clock::time_point deadline;
+        std::uint64_t sequence;
+        JobTicket ticket;
+
+        bool operator<(const Entry& other) const;
+    };
+    struct Tenant {
+        std::set<Entry> queued;
+        size_t running = 0;
+    };
+
+    size_t memoryBudget() const;
+    void dropExpired(std::chrono::steady_clock::time_point now);
+    // Erases a tenant with nothing queued or running; returns the next one
+    std::map<std::string, Tenant>::iterator eraseIfIdle(std::map<std::string, Tenant>::iterator tenant);
+    // Tenant whose first job goes next, or tenants_.end()
+    std::map<std::string, Tenant>::iterator nextTenant();
+    bool startable(const Entry& entry) const;
+    bool tryStart(JobTicket& job, bool& memory_bound);
+    bool acquireUntil(JobTicket& job, std::chrono::steady_clock::time_point deadline);
+
+    Limits limits_;
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::map<std::string, Tenant> tenants_;
+    std::vector<std::string> expired_;
+    size_t queued_ = 0;
+    size_t running_ = 0;
+    size_t reserved_memory_ = 0;
+    std::uint64_t next_sequence_ = 0;
+    bool closed_ = false;
+};
+
+} // namespace SemiPRO
+
+#endif // JOB_QUEUE_HPP
@@ -0,0 +1,666 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "json_value.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace SemiPRO {
+
+// Recursive-descent reader over the raw text
+class JsonReader {
+public:
+    JsonReader(const char* data, std::size_t size) : begin_(data), pos_(data), end_(data + size) {}
+
+    JsonValue document() {
+        JsonValue value;
+        skipSpace();
+        readValue(value, 0);
+        skipSpace();
+        if (pos_ != end_) {
+            fail("unexpected trailing characters");
+        }
+        return value;
+    }
+
+private:
+    static constexpr int kMaxDepth = 256;
+
+    [[noreturn]] void fail(const std::string& message) const {
+        int line = 1;
+        const char* line_start = begin_;
+        for (const char* c = begin_; c < pos_; ++c) {
+            if (*c == '\n') {
+                ++line;
+                line_start = c + 1;
+            }
+        }
+        throw std::runtime_error("JSON parse error at line " + std::to_string(line) + ", column " +
+                                 std::to_string(pos_ - line_start + 1) + ": " + message);
+    }
+
+    void skipSpace() {
+        while (pos_ != end_ && (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\t' || *pos_ == '\r')) {
+            ++pos_;
+        }
+    }
+
+    void expect(char c) {
+        if (pos_ == end_ || *pos_ != c) {
+            fail(std::string("expected '") + c + "'");
+        }
+        ++pos_;
+    }
+
+    void readLiteral(const char* literal) {
+        const std::size_t length = std::strlen(literal);
+        if (static_cast<std::size_t>(end_ - pos_) < length || std::memcmp(pos_, literal, length) != 0) {
+            fail("invalid literal");
+        }
+        pos_ += length;
+    }
+
+    void readValue(JsonValue& value, int depth) {
+        if (pos_ == end_) {
+            fail("unexpected end of input");
+        }
+        switch (*pos_) {
+        case '{': readObject(value, depth); break;
+        case '[': readArray(value, depth); break;
+        case '"':
+            value.type_ = JsonValue::Type::String;
+            readString(value.text_);
+            break;
+        case 't':
+            readLiteral("true");
+            value.type_ = JsonValue::Type::Bool;
+            value.bool_ = true;
+            break;
+        case 'f':
+            readLiteral("false");
+            value.type_ = JsonValue::Type::Bool;
+            break;
+        case 'n': readLiteral("null"); break;
+        default: readNumber(value);
+        }
+    }
+
+    void readObject(JsonValue& value, int depth) {
+        if (depth >= kMaxDepth) {
+            fail("nesting too deep");
+        }
+        value.type_ = JsonValue::Type::Object;
+        ++pos_;
+        skipSpace();
+        if (pos_ != end_ && *pos_ == '}') {
+            ++pos_;
+            return;
+        }
+        while (true) {
+            if (pos_ == end_ || *pos_ != '"') {
+                fail("expected member name");
+            }
+            value.members_.emplace_back();
+            JsonValue::Member& member = value.members_.back();
+            readString(member.first);
+            skipSpace();
+            expect(':');
+            skipSpace();
+            readValue(member.second, depth + 1);
+            skipSpace();
+            if (pos_ != end_ && *pos_ == ',') {
+                ++pos_;
+                skipSpace();
+                continue;
+            }
+            expect('}');
+            return;
+        }
+    }
+
+    void readArray(JsonValue& value, int depth) {
+        if (depth >= kMaxDepth) {
+            fail("nesting too deep");
+        }
+        value.type_ = JsonValue::Type::Array;
+        ++pos_;
+        skipSpace();
+        if (pos_ != end_ && *pos_ == ']') {
+            ++pos_;
+            return;
+        }
+        while (true) {
+            value.items_.emplace_back();
+            readValue(value.items_.back(), depth + 1);
+            skipSpace();
+            if (pos_ != end_ && *pos_ == ',') {
+                ++pos_;
+                skipSpace();
+                continue;
+            }
+            expect(']');
+            return;
+        }
+    }
+
+    void readString(std::string& out) {
+        ++pos_; // Opening quote
+        const char* start = pos_;
+        while (pos_ != end_ && *pos_ != '"' && *pos_ != '\\') {
+            if (static_cast<unsigned char>(*pos_) < 0x20) {
+                fail("control character in string");
+            }
+            ++pos_;
+        }
+        out.assign(start, pos_);
+        while (pos_ != end_ && *pos_ != '"') {
+            if (*pos_ != '\\') {
+                if (static_cast<unsigned char>(*pos_) < 0x20) {
+                    fail("control character in string");
+                }
+                out += *pos_++;
+                continue;
+            }
+            if (++pos_ == end_) {
+                break;
+            }
+            switch (*pos_++) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': appendCodePoint(out); break;
+            default: --pos_; fail("invalid escape");
+            }
+        }
+        if (pos_ == end_) {
+            fail("unterminated string");
+        }
+        ++pos_; // Closing quote
+    }
+
+    unsigned readHex4() {
+        if (end_ - pos_ < 4) {
+            fail("truncated \\u escape");
+        }
+        unsigned code = 0;
+        for (int i = 0; i < 4; ++i, ++pos_) {
+            const char c = *pos_;
+            code <<= 4;
+            if (c >= '0' && c <= '9') {
+                code |= static_cast<unsigned>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                code |= static_cast<unsigned>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                code |= static_cast<unsigned>(c - 'A' + 10);
+            } else {
+                fail("invalid \\u escape");
+            }
+        }
+        return code;
+    }
+
+    // Decodes a \u escape (and its low surrogate, if any) to UTF-8
+    void appendCodePoint(std::string& out) {
+        unsigned code = readHex4();
+        if (code >= 0xD800 && code <= 0xDBFF) {
+            if (end_ - pos_ < 2 || pos_[0] != '\\' || pos_[1] != 'u') {
+                fail("unpaired surrogate");
+            }
+            pos_ += 2;
+            const unsigned low = readHex4();
+            if (low < 0xDC00 || low > 0xDFFF) {
+                fail("unpaired surrogate");
+            }
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        } else if (code >= 0xDC00 && code <= 0xDFFF) {
+            fail("unpaired surrogate");
+        }
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool digitAt(const char* c) const { return c != end_ && *c >= '0' && *c <= '9'; }
+
+    // Checks the JSON number grammar, which is stricter than from_chars
+    void readNumber(JsonValue& value) {
+        const char* start = pos_;
+        const char* c = pos_;
+        if (c != end_ && *c == '-') {
+            ++c;
+        }
+        if (!digitAt(c)) {
+            fail("unexpected character");
+        }
+        if (*c == '0') {
+            ++c;
+        } else {
+            while (digitAt(c)) ++c;
+        }
+        if (c != end_ && *c == '.') {
+            ++c;
+            if (!digitAt(c)) {
+                pos_ = c;
+                fail("expected digit");
+            }
+            while (digitAt(c)) ++c;
+        }
+        if (c != end_ && (*c == 'e' || *c == 'E')) {
+            ++c;
+            if (c != end_ && (*c == '+' || *c == '-')) {
+                ++c;
+            }
+            if (!digitAt(c)) {
+                pos_ = c;
+                fail("expected digit");
+            }
+            while (digitAt(c)) ++c;
+        }
+        const auto result = std::from_chars(start, c, value.number_);
+        if (result.ec != std::errc()) {
+            fail("number out of range");
+        }
+        value.type_ = JsonValue::Type::Number;
+        value.text_.assign(start, c);
+        pos_ = c;
+    }
+
+    const char* begin_;
+    const char* pos_;
+    const char* end_;
+};
+
+JsonValue JsonValue::boolean(bool value) {
+    JsonValue result;
+    result.type_ = Type::Bool;
+    result.bool_ = value;
+    return result;
+}
+
+JsonValue JsonValue::number(double value) {
+    JsonValue result;
+    result.type_ = Type::Number;
+    result.number_ = value;
+    char spelled[32];
+    const auto end = std::to_chars(spelled, spelled + sizeof(spelled), value).ptr;
+    result.text_.assign(spelled, end);
+    return result;
+}
+
+JsonValue JsonValue::string(const std::string& value) {
+    JsonValue result;
+    result.type_ = Type::String;
+    result.text_ = value;
+    return result;
+}
+
+JsonValue JsonValue::parse(const std::string& text) {
+    return parse(text.data(), text.size());
+}
+
+JsonValue JsonValue::parse(const char* data, std::size_t size) {
+    return JsonReader(data, size).document();
+}
+
+JsonValue JsonValue::parseFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open JSON file: " + path);
+    }
+    const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    try {
+        return parse(text);
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+const char* JsonValue::typeName(Type type) {
+    switch (type) {
+    case Type::Null: return "null";
+    case Type::Bool: return "a boolean";
+    case Type::Number: return "a number";
+    case Type::String: return "a string";
+    case Type::Array: return "an array";
+    case Type::Object: return "an object";
+    }
+    return "unknown";
+}
+
+namespace {
+
+[[noreturn]] void typeMismatch(JsonValue::Type expected, JsonValue::Type actual) {
+    throw std::invalid_argument(std::string("JSON value is ") + JsonValue::typeName(actual) + ", not " +
+                                JsonValue::typeName(expected));
+}
+
+} // namespace
+
+bool JsonValue::asBool() const {
+    if (type_ != Type::Bool) {
+        typeMismatch(Type::Bool, type_);
+    }
+    return bool_;
+}
+
+double JsonValue::asNumber() const {
+    if (type_ != Type::Number) {
+        typeMismatch(Type::Number, type_);
+    }
+    return number_;
+}
+
+const std::string& JsonValue::asString() const {
+    if (type_ != Type::String) {
+        typeMismatch(Type::String, type_);
+    }
+    return text_;
+}
+
+std::string JsonValue::scalarText() const {
+    if (type_ == Type::Bool) {
+        return bool_ ? "true" : "false";
+    }
+    if (type_ != Type::Number && type_ != Type::String) {
+        throw std::invalid_argument(std::string("JSON value is ") + typeName(type_) + ", not a scalar");
+    }
+    return text_;
+}
+
+std::size_t JsonValue::size() const {
+    return type_ == Type::Array ? items_.size() : type_ == Type::Object ? members_.size() : 0;
+}
+
+const std::vector<JsonValue>& JsonValue::items() const {
+    if (type_ != Type::Array) {
+        typeMismatch(Type::Array, type_);
+    }
+    return items_;
+}
+
+const std::vector<JsonValue::Member>& JsonValue::members() const {
+    if (type_ != Type::Object) {
+        typeMismatch(Type::Object, type_);
+    }
+    return members_;
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    for (auto it = members_.rbegin(); it != members_.rend(); ++it) {
+        if (it->first == key) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const {
+    static const JsonValue null_value;
+    const JsonValue* value = find(key);
+    return value ? *value : null_value;
+}
+
+void JsonValue::set(const std::string& key, JsonValue value) {
+    if (type_ == Type::Null) {
+        type_ = Type::Object;
+    } else if (type_ != Type::Object) {
+        typeMismatch(Type::Object, type_);
+    }
+    for (auto it = members_.rbegin(); it != members_.rend(); ++it) {
+        if (it->first == key) {
+            it->second = std::move(value);
+            return;
+        }
+    }
+    members_.emplace_back(key, std::move(value));
+}
+
+std::string JsonValue::dump(int indent) const {
+    std::string out;
+    JsonWriter(out, indent).value(*this);
+    return out;
+}
+
+JsonWriter::JsonWriter(std::string& out, int indent) : out_(out), indent_(indent) {}
+
+JsonWriter::JsonWriter(std::ostream& stream, std::size_t flush_bytes, int indent)
+    : out_(buffer_), stream_(&stream), flush_bytes_(flush_bytes), indent_(indent) {
+    buffer_.reserve(flush_bytes + 256);
+}
+
+JsonWriter::~JsonWriter() {
+    flush();
+}
+
+void JsonWriter::flush() {
+    if (stream_ && !buffer_.empty()) {
+        stream_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+}
+
+void JsonWriter::maybeFlush() {
+    if (stream_ && buffer_.size() >= flush_bytes_) {
+        flush();
+    }
+}
+
+void JsonWriter::newline(std::size_t depth) {
+    out_ += '\n';
+    out_.append(depth * static_cast<std::size_t>(indent_), ' ');
+}
+
+// Everything but a member value is preceded by a comma unless first in
+// its container
+void JsonWriter::separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (empty_.empty()) {
+        return;
+    }
+    if (!empty_.back()) {
+        out_ += ',';
+    }
+    empty_.back() = false;
+    if (indent_ > 0) {
+        newline(empty_.size());
+    }
+}
+
+void JsonWriter::close(char bracket) {
+    const bool was_empty = empty_.empty() || empty_.back();
+    if (!empty_.empty()) {
+        empty_.pop_back();
+    }
+    if (indent_ > 0 && !was_empty) {
+        newline(empty_.size());
+    }
+    out_ += bracket;
+    maybeFlush();
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separate();
+    out_ += '{';
+    empty_.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    close('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separate();
+    out_ += '[';
+    empty_.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    close(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    separate();
+    quote(name);
+    out_ += indent_ > 0 ? ": " : ":";
+    after_key_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::string(std::string_view text) {
+    separate();
+    quote(text);
+    maybeFlush();
+    return *this;
+}
+
+void JsonWriter::quote(std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    out_.reserve(out_.size() + text.size() + 2);
+    out_ += '"';
+    // Runs that need no escaping are appended whole
+    std::size_t run = 0;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        out_.append(text.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+        case '"': out_ += "\\\""; break;
+        case '\\': out_ += "\\\\"; break;
+        case '\n': out_ += "\\n"; break;
+        case '\r': out_ += "\\r"; break;
+        case '\t': out_ += "\\t"; break;
+        default:
+            out_ += "\\u00";
+            out_ += hex[c >> 4];
+            out_ += hex[c & 0xF];
+        }
+    }
+    out_.append(text.data() + run, text.size() - run);
+    out_ += '"';
+}
+
+JsonWriter& JsonWriter::number(double value) {
+    separate();
+    if (!std::isfinite(value)) {
+        out_ += "null";
+    } else {
+        char text[32];
+        const auto result = std::to_chars(text, text + sizeof(text), value);
+        out_.append(text, result.ptr);
+    }
+    maybeFlush();
+    return *this;
+}
+
+JsonWriter& JsonWriter::integer(long long value) {
+    separate();
+    char text[24];
+    const auto result = std::to_chars(text, text + sizeof(text), value);
+    out_.append(text, result.ptr);
+    maybeFlush();
+    return *this;
+}
+
+JsonWriter& JsonWriter::boolean(bool value) {
+    separate();
+    out_ += value ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separate();
+    out_ += "null";
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json) {
+    separate();
+    out_.append(json.data(), json.size());
+    maybeFlush();
+    return *this;
+}
+
+JsonWriter& JsonWriter::numbers(const double* values, std::size_t count) {
+    beginArray();
+    if (indent_ > 0) {
+        for (std::size_t i = 0; i < count; ++i) {
+            number(values[i]);
+        }
+        return endArray();
+    }
+    // Compact arrays skip the per-element bookkeeping: up to 24 characters
+    // and a comma per number
+    char text[32];
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            out_ += ',';
+        }
+        if (std::isfinite(values[i])) {
+            const auto result = std::to_chars(text, text + sizeof(text), values[i]);
+            out_.append(text, result.ptr);
+        } else {
+            out_ += "null";
+        }
+        if ((i & 1023) == 1023) {
+            maybeFlush();
+        }
+    }
+    empty_.back() = count == 0;
+    return endArray();
+}
+
+JsonWriter& JsonWriter::value(const JsonValue& value) {
+    switch (value.type()) {
+    case JsonValue::Type::Null: return null();
+    case JsonValue::Type::Bool: return boolean(value.asBool());
+    case JsonValue::Type::Number:
+        // Keeps the spelling the number was parsed with
+        return std::isfinite(value.number_) ? raw(value.text_) : null();
+    case JsonValue::Type::String: return string(value.asString());
+    case JsonValue::Type::Array:
+        beginArray();
+        for (const JsonValue& item : value.items()) {
+            this->value(item);
+        }
+        return endArray();
+    case JsonValue::Type::Object:
+        beginObject();
+        for (const auto& member : value.members()) {
+            key(member.first);
+            this->value(member.second);
+        }
+        return endObject();
+    }
+    return *this;
+}
+
+} // namespace SemiPRO
@@ -0,0 +1,147 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef JSON_VALUE_HPP
+#define JSON_VALUE_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace SemiPRO {
+
+// A parsed JSON document.
+//
+// parse() reads the text in one pass with no token stream or
+// intermediate string map: numbers are converted once, with
+// std::from_chars, and strings without escapes are copied straight out of
+// the input. Numbers also keep their spelling, so a value such as "1e15"
+// can be passed on as text unchanged. Objects keep their members in
+// document order; when a key repeats, the last occurrence wins.
+//
+// Syntax errors throw std::runtime_error naming the line and column.
+// Accessors throw std::invalid_argument when a value has another type.
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+    using Member = std::pair<std::string, JsonValue>;
+
+    JsonValue() = default;
+    static JsonValue boolean(bool value);
+    // Spelled in the shortest form that reads back to the same double
+    static JsonValue number(double value);
+    static JsonValue string(const std::string& value);
+
+    static JsonValue parse(const std::string& text);
+    static JsonValue parse(const char* data, std::size_t size);
+    // Throws std::runtime_error if the file cannot be read
+    static JsonValue parseFile(const std::string& path);
+
+    Type type() const { return type_; }
+    bool isNull() const { return type_ == Type::Null; }
+    bool isBool() const { return type_ == Type::Bool; }
+    bool isNumber() const { return type_ == Type::Number; }
+    bool isString() const { return type_ == Type::String; }
+    bool isArray() const { return type_ == Type::Array; }
+    bool isObject() const { return type_ == Type::Object; }
+    bool isScalar() const { return isBool() || isNumber() || isString(); }
+
+    bool asBool() const;
+    double asNumber() const;
+    const std::string& asString() const;
+    // Strings as they are, numbers as spelled in the source, "true" or
+    // "false"; throws for null, arrays and objects
+    std::string scalarText() const;
+
+    // Elements of an array or members of an object; 0 for anything else
+    std::size_t size() const;
+    const std::vector<JsonValue>& items() const;
+    const std::vector<Member>& members() const;
+    // nullptr when this is not an object or has no such member
+    const JsonValue* find(const std::string& key) const;
+    // A null value when the member is missing
+    const JsonValue& operator[](const std::string& key) const;
+    // Replaces or appends a member; a null value becomes an empty object
+    void set(const std::string& key, JsonValue value);
+
+    // Compact JSON text, or indented by indent spaces per level; numbers
+    // keep their spelling and non-finite numbers are written as null
+    std::string dump(int indent = 0) const;
+
+    static const char* typeName(Type type);
+
+private:
+    friend class JsonReader;
+    friend class JsonWriter;
+
+    Type type_ = Type::Null;
+    bool bool_ = false;
+    double number_ = 0.0;
+    std::string text_; // String contents or number spelling
+    std::vector<JsonValue> items_;
+    std::vector<Member> members_;
+};
+
+// Writes JSON text as it goes, for output too large or too hot to build
+// as a JsonValue first.
+//
+// Commas, colons, quoting and escaping are taken care of; numbers are
+// spelled with std::to_chars in the shortest form that reads back to the
+// same double (non-finite ones as null), and integers are written as
+// integers. Nesting is not checked: a document left unbalanced is simply
+// invalid JSON.
+//
+// The text is appended to a caller's string, or gathered into blocks of
+// about flush_bytes written to a stream as they fill; flush() (or the
+// destructor) writes the rest.
+class JsonWriter {
+public:
+    // indent > 0 puts each member and element on its own line, indented
+    // that many spaces per level
+    explicit JsonWriter(std::string& out, int indent = 0);
+    explicit JsonWriter(std::ostream& stream, std::size_t flush_bytes = 64 * 1024, int indent = 0);
+    ~JsonWriter();
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    // Member name; the next value written is its value
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& string(std::string_view text);
+    JsonWriter& number(double value);
+    JsonWriter& integer(long long value);
+    JsonWriter& boolean(bool value);
+    JsonWriter& null();
+    JsonWriter& value(const JsonValue& value);
+    // JSON text written as it is, e.g. a fragment dumped elsewhere
+    JsonWriter& raw(std::string_view json);
+    // A whole array of numbers, without a call per element
+    JsonWriter& numbers(const double* values, std::size_t count);
+
+    void flush();
+
+private:
+    void separate();
+    void quote(std::string_view text);
+    void close(char bracket);
+    void newline(std::size_t depth);
+    void maybeFlush();
+
+    std::string buffer_; // Stream mode only
+    std::string& out_;
+    std::ostream* stream_ = nullptr;
+    std::size_t flush_bytes_ = 0;
+    int indent_ = 0;
+    std::vector<bool> empty_; // Per open container: nothing written yet
+    bool after_key_ = false;
+};
+
+} // namespace SemiPRO
+
+#endif // JSON_VALUE_HPP
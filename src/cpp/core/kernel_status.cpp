@@ -0,0 +1,70 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "kernel_status.hpp"
+#include <array>
+
+namespace {
+
+struct FaultBuffer {
+    std::array<KernelFaults::Fault, KernelFaults::kCapacity> faults;
+    std::size_t size = 0;
+    std::size_t dropped = 0;
+};
+
+FaultBuffer& threadFaults() noexcept {
+    thread_local FaultBuffer buffer;
+    return buffer;
+}
+
+} // namespace
+
+const char* kernelStatusMessage(KernelStatus status) noexcept {
+    switch (status) {
+        case KernelStatus::Ok: return "ok";
+        case KernelStatus::TemperatureOutOfRange: return "temperature out of range";
+        case KernelStatus::TimeOutOfRange: return "time out of range";
+        case KernelStatus::PressureOutOfRange: return "pressure out of range";
+        case KernelStatus::ThicknessOutOfRange: return "thickness out of range";
+        case KernelStatus::DepthOutOfRange: return "depth out of range";
+        case KernelStatus::PowerOutOfRange: return "power out of range";
+        case KernelStatus::UnknownMaterial: return "unknown material";
+        case KernelStatus::NonFinite: return "result is not finite";
+        case KernelStatus::ResultOutOfRange: return "result out of range";
+        case KernelStatus::MissingWafer: return "wafer not registered";
+    }
+    return "unknown status";
+}
+
+void markFailed(std::vector<KernelStatus>& status, const Eigen::Array<bool, Eigen::Dynamic, 1>& passed,
+                KernelStatus failure) {
+    for (std::size_t i = 0; i < status.size(); ++i) {
+        if (status[i] == KernelStatus::Ok && !passed[static_cast<Eigen::Index>(i)]) {
+            status[i] = failure;
+        }
+    }
+}
+
+Eigen::Array<bool, Eigen::Dynamic, 1> statusOk(const std::vector<KernelStatus>& status) {
+    Eigen::Array<bool, Eigen::Dynamic, 1> ok(static_cast<Eigen::Index>(status.size()));
+    for (std::size_t i = 0; i < status.size(); ++i) {
+        ok[static_cast<Eigen::Index>(i)] = status[i] == KernelStatus::Ok;
+    }
+    return ok;
+}
+
+void KernelFaults::record(KernelStatus status, std::uint32_t entry) noexcept {
+    FaultBuffer& buffer = threadFaults();
+    if (buffer.size < kCapacity) {
+        buffer.faults[buffer.size++] = {status, entry};
+    } else {
+        ++buffer.dropped;
+    }
+}
+
+std::size_t KernelFaults::take(std::vector<Fault>& faults) {
+    FaultBuffer& buffer = threadFaults();
+    faults.insert(faults.end(), buffer.faults.begin(), buffer.faults.begin() + buffer.size);
+    const std::size_t dropped = buffer.dropped;
+    buffer.size = 0;
+    buffer.dropped = 0;
+    return dropped;
+}
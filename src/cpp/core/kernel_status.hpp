@@ -0,0 +1,62 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef KERNEL_STATUS_HPP
+#define KERNEL_STATUS_HPP
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Outcome of one entry of a batched kernel.
+//
+// Batched kernels check their inputs column by column and return a status
+// per entry instead of throwing on the first bad one, so one wafer with
+// out-of-range conditions costs its own entry and nothing else. Codes stay
+// codes, without messages, until a step boundary reports them.
+enum class KernelStatus : std::uint8_t {
+    Ok = 0,
+    TemperatureOutOfRange,
+    TimeOutOfRange,
+    PressureOutOfRange,
+    ThicknessOutOfRange,
+    DepthOutOfRange,
+    PowerOutOfRange,
+    UnknownMaterial,
+    NonFinite,          // The kernel's result was NaN or infinite
+    ResultOutOfRange,   // Finite, but outside what the process can produce
+    MissingWafer,
+};
+
+const char* kernelStatusMessage(KernelStatus status) noexcept;
+
+// Marks the entries that fail a check, unless an earlier check already
+// failed them, so checks applied in validateConditions order leave each
+// entry the status of the first it fails
+void markFailed(std::vector<KernelStatus>& status, const Eigen::Array<bool, Eigen::Dynamic, 1>& passed,
+                KernelStatus failure);
+// True for the entries whose status is Ok, for Eigen's select()
+Eigen::Array<bool, Eigen::Dynamic, 1> statusOk(const std::vector<KernelStatus>& status);
+
+// Faults of batch entries collected per thread until a step boundary.
+//
+// record() appends to a fixed buffer of the calling thread: no lock, no
+// allocation, no strings, and it cannot throw, so kernels and the loops
+// around them stay off the error mutex. The step that ran them take()s the
+// thread's faults once it finishes and reports them together. Faults past
+// kCapacity are counted rather than kept.
+class KernelFaults {
+public:
+    static constexpr std::size_t kCapacity = 1024;
+
+    struct Fault {
+        KernelStatus status;
+        std::uint32_t entry; // Index in the batch
+    };
+
+    static void record(KernelStatus status, std::uint32_t entry) noexcept;
+    // Moves the calling thread's faults into `faults` and returns how many
+    // more were dropped
+    static std::size_t take(std::vector<Fault>& faults);
+};
+
+#endif // KERNEL_STATUS_HPP
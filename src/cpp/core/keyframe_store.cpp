@@ -0,0 +1,144 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "keyframe_store.hpp"
+#include "task_scheduler.hpp"
+#include "wafer.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::uint32_t kKeyframeChunk = checkpointTag('K', 'F', 'R', 'M');
+
+} // namespace
+
+KeyframeWriter::KeyframeWriter(const std::string& path) : out_(path, CheckpointWriter::pageAlignment()) {}
+
+void KeyframeWriter::append(const FieldStore& fields, double time, const std::string& description) {
+    if (frames_ > 0 && time < last_time_) {
+        throw std::invalid_argument("Keyframe times must not decrease");
+    }
+    std::vector<int> channels;
+    for (int channel = 0; channel < fields.channelCount(); ++channel) {
+        if (fields.isMaterialized(channel)) {
+            channels.push_back(channel);
+        }
+    }
+    out_.beginChunk(kKeyframeChunk);
+    out_.write(time);
+    out_.writeString(description);
+    out_.write(static_cast<std::uint32_t>(channels.size()));
+    for (int channel : channels) {
+        out_.writeString(fields.channelName(channel));
+        out_.writeBlock(fields.view(channel));
+    }
+    out_.endChunk();
+    last_time_ = time;
+    ++frames_;
+}
+
+void KeyframeWriter::append(const Wafer& wafer, double time, const std::string& description) {
+    wafer.getPhotoresistPattern();
+    append(wafer.getFieldStore(), time, description);
+}
+
+void KeyframeWriter::finish() {
+    out_.finish();
+}
+
+KeyframeReader::KeyframeReader(const std::string& path) : in_(path) {
+    for (const auto& chunk : in_.chunks()) {
+        if (chunk.tag != kKeyframeChunk) {
+            continue;
+        }
+        auto cursor = in_.cursor(chunk);
+        Frame frame;
+        frame.time = cursor.read<double>();
+        frame.description = cursor.readString();
+        const auto count = cursor.read<std::uint32_t>();
+        for (std::uint32_t i = 0; i < count; ++i) {
+            Channel channel;
+            channel.name = cursor.readString();
+            // Only the block's header is read; its values stay on disk
+            ConstFieldView block = cursor.readBlock();
+            channel.data = block.data();
+            channel.rows = static_cast<int>(block.rows());
+            channel.cols = static_cast<int>(block.cols());
+            frame.channels.push_back(std::move(channel));
+        }
+        if (!frames_.empty() && frame.time < frames_.back().time) {
+            throw std::runtime_error("Keyframes out of order in file: " + path);
+        }
+        frames_.push_back(std::move(frame));
+    }
+}
+
+std::vector<std::string> KeyframeReader::channels(std::size_t frame) const {
+    std::vector<std::string> names;
+    for (const auto& channel : frames_.at(frame).channels) {
+        names.push_back(channel.name);
+    }
+    return names;
+}
+
+const KeyframeReader::Channel& KeyframeReader::find(std::size_t frame, const std::string& name) const {
+    for (const auto& channel : frames_.at(frame).channels) {
+        if (channel.name == name) {
+            return channel;
+        }
+    }
+    throw std::invalid_argument("Keyframe " + std::to_string(frame) + " has no channel " + name);
+}
+
+ConstFieldView KeyframeReader::channel(std::size_t frame, const std::string& name) const {
+    const Channel& channel = find(frame, name);
+    return ConstFieldView(channel.data, channel.rows, channel.cols);
+}
+
+std::size_t KeyframeReader::frameAt(double time) const {
+    auto after = std::upper_bound(frames_.begin(), frames_.end(), time,
+                                  [](double t, const Frame& frame) { return t < frame.time; });
+    return after == frames_.begin() ? 0 : static_cast<std::size_t>(after - frames_.begin()) - 1;
+}
+
+void KeyframeReader::sample(double at, const std::string& name, Eigen::ArrayXXd& out) const {
+    const std::size_t before = frameAt(at);
+    const double t0 = time(before);
+    if (before + 1 == frames_.size() || at <= t0) {
+        out = channel(before, name);
+        return;
+    }
+    const double t1 = time(before + 1);
+    const ConstFieldView a = channel(before, name);
+    const ConstFieldView b = channel(before + 1, name);
+    if (a.rows() != b.rows() || a.cols() != b.cols()) {
+        throw std::invalid_argument("Keyframes " + std::to_string(before) + " and " + std::to_string(before + 1) +
+                                    " differ in the shape of " + name);
+    }
+    const double w = t1 > t0 ? (at - t0) / (t1 - t0) : 0.0;
+    out = (1.0 - w) * a + w * b;
+}
+
+void KeyframeReader::prefetch(std::size_t first, std::size_t count) const {
+    if (first >= frames_.size()) {
+        return;
+    }
+    const std::size_t last = std::min(frames_.size(), first + count);
+    std::vector<std::pair<const double*, std::size_t>> blocks;
+    for (std::size_t frame = first; frame < last; ++frame) {
+        for (const auto& channel : frames_[frame].channels) {
+            blocks.emplace_back(channel.data, static_cast<std::size_t>(channel.rows) * channel.cols);
+        }
+    }
+    // Touch a value on every page; the mapping outlives the reader if need be
+    const std::size_t stride = std::max<std::size_t>(CheckpointWriter::pageAlignment() / sizeof(double), 1);
+    TaskScheduler::getInstance().submit([mapping = in_.mapping(), blocks = std::move(blocks), stride] {
+        double sum = 0.0;
+        for (const auto& block : blocks) {
+            for (std::size_t i = 0; i < block.second; i += stride) {
+                sum += block.first[i];
+            }
+        }
+        volatile double sink = sum;
+        (void)sink;
+    });
+}
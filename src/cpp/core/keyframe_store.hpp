@@ -0,0 +1,95 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef KEYFRAME_STORE_HPP
+#define KEYFRAME_STORE_HPP
+
+#include "checkpoint_io.hpp"
+#include "field_store.hpp"
+#include <Eigen/Dense>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Wafer;
+
+// Animation keyframes kept on disk instead of in memory.
+//
+// A keyframe file is a checkpoint (checkpoint_io.hpp) with one chunk per
+// frame, written as the frames come:
+//
+//   frame : f64 time, string description, u32 channel count,
+//           per channel (string name, field block)
+//
+// Blocks are page-aligned, so the reader maps the file and each frame is
+// paged in only when it is looked at; the kernel may drop it again under
+// memory pressure. Playing back a thousand frames of a full wafer thus
+// needs the frames around the cursor resident, not all of them.
+class KeyframeWriter {
+public:
+    // Writes to `path + ".tmp"` until finish(), like CheckpointWriter
+    explicit KeyframeWriter(const std::string& path);
+    KeyframeWriter(const KeyframeWriter&) = delete;
+    KeyframeWriter& operator=(const KeyframeWriter&) = delete;
+
+    // Every materialized channel of the store. Times must not decrease
+    // (std::invalid_argument).
+    void append(const FieldStore& fields, double time, const std::string& description = "");
+    // Same, going through Wafer so the photoresist pattern is current
+    void append(const Wafer& wafer, double time, const std::string& description = "");
+    std::size_t frames() const { return frames_; }
+    void finish();
+
+private:
+    CheckpointWriter out_;
+    std::size_t frames_ = 0;
+    double last_time_ = 0.0;
+};
+
+class KeyframeReader {
+public:
+    // Maps the file and indexes its frames, reading only their headers;
+    // throws std::runtime_error if it is not a complete keyframe file
+    explicit KeyframeReader(const std::string& path);
+    KeyframeReader(const KeyframeReader&) = delete;
+    KeyframeReader& operator=(const KeyframeReader&) = delete;
+
+    std::size_t size() const { return frames_.size(); }
+    double time(std::size_t frame) const { return frames_.at(frame).time; }
+    const std::string& description(std::size_t frame) const { return frames_.at(frame).description; }
+    std::vector<std::string> channels(std::size_t frame) const;
+    // View into the mapping, valid while the reader lives. Throws
+    // std::out_of_range for a missing frame and std::invalid_argument for
+    // a channel the frame does not have.
+    ConstFieldView channel(std::size_t frame, const std::string& name) const;
+    // The last frame at or before `time`, 0 before the first
+    std::size_t frameAt(double time) const;
+
+    // `name` at `time`, blended linearly between the frames on either side
+    // and held at the first and last frame beyond them. Throws
+    // std::invalid_argument if the two frames' channels differ in shape.
+    void sample(double time, const std::string& name, Eigen::ArrayXXd& out) const;
+
+    // Reads frames [first, first + count) into memory on the TaskScheduler
+    // and returns at once, so playback finds them resident
+    void prefetch(std::size_t first, std::size_t count) const;
+
+private:
+    struct Channel {
+        std::string name;
+        const double* data;
+        int rows;
+        int cols;
+    };
+    struct Frame {
+        double time;
+        std::string description;
+        std::vector<Channel> channels;
+    };
+
+    const Channel& find(std::size_t frame, const std::string& name) const;
+
+    CheckpointReader in_;
+    std::vector<Frame> frames_;
+};
+
+#endif // KEYFRAME_STORE_HPP
@@ -0,0 +1,726 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "laminate_plate_solver.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+using SparseRows = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+using ElementMatrix = Eigen::Matrix<double, 20, 20>;
+using StrainMatrix = Eigen::Matrix<double, 3, 20>;
+
+constexpr int kNodeDofs = 5;  // u, v, w and the two normal rotations
+constexpr int kModes = 6;     // Rigid motions of a free plate
+constexpr double kShearCorrection = 5.0 / 6.0;
+
+// Levels are coarsened until they have this many unknowns or fewer
+constexpr Eigen::Index kCoarsestUnknowns = 600;
+constexpr int kMaxLevels = 12;
+constexpr int kPowerIterations = 20;
+
+// Rows below this many are multiplied on the calling thread
+constexpr Eigen::Index kParallelRows = 1 << 13;
+
+// Nodes (xi, eta) of the element, counterclockwise from (-1, -1)
+constexpr double kXi[4] = {-1.0, 1.0, 1.0, -1.0};
+constexpr double kEta[4] = {-1.0, -1.0, 1.0, 1.0};
+
+// Plane-stress stiffness of an isotropic layer
+Eigen::Matrix3d planeStress(double modulus, double poisson) {
+  Eigen::Matrix3d q;
+  const double f = modulus / (1.0 - poisson * poisson);
+  q << f, f * poisson, 0.0, f * poisson, f, 0.0, 0.0, 0.0, 0.5 * f * (1.0 - poisson);
+  return q;
+}
+
+// Membrane and bending strains at (xi, eta) of a square element of side
+// h, the rotations taken as h phi so every unknown is a length
+void strainMatrices(double xi, double eta, double h, StrainMatrix& membrane, StrainMatrix& bending) {
+  membrane.setZero();
+  bending.setZero();
+  for (int a = 0; a < 4; ++a) {
+    const double dx = 0.25 * kXi[a] * (1.0 + eta * kEta[a]) * 2.0 / h;
+    const double dy = 0.25 * kEta[a] * (1.0 + xi * kXi[a]) * 2.0 / h;
+    const int c = kNodeDofs * a;
+    membrane(0, c) = dx;
+    membrane(1, c + 1) = dy;
+    membrane(2, c) = dy;
+    membrane(2, c + 1) = dx;
+    bending(0, c + 3) = dx / h;
+    bending(1, c + 4) = dy / h;
+    bending(2, c + 3) = dy / h;
+    bending(2, c + 4) = dx / h;
+  }
+}
+
+// Transverse shear strains (gamma_xz, gamma_yz) at (xi, eta) as
+// displacement-based in the element
+Eigen::Matrix<double, 2, 20> shearMatrix(double xi, double eta, double h) {
+  Eigen::Matrix<double, 2, 20> shear = Eigen::Matrix<double, 2, 20>::Zero();
+  for (int a = 0; a < 4; ++a) {
+    const double n = 0.25 * (1.0 + xi * kXi[a]) * (1.0 + eta * kEta[a]);
+    const double dx = 0.25 * kXi[a] * (1.0 + eta * kEta[a]) * 2.0 / h;
+    const double dy = 0.25 * kEta[a] * (1.0 + xi * kXi[a]) * 2.0 / h;
+    const int c = kNodeDofs * a;
+    shear(0, c + 2) = dx;
+    shear(0, c + 3) = n / h;
+    shear(1, c + 2) = dy;
+    shear(1, c + 4) = n / h;
+  }
+  return shear;
+}
+
+// MITC4: gamma_xz interpolated in eta between the midpoints of the edges
+// eta = -1 and 1, gamma_yz in xi between those of xi = -1 and 1
+Eigen::Matrix<double, 2, 20> assumedShear(double xi, double eta, double h) {
+  Eigen::Matrix<double, 2, 20> shear;
+  shear.row(0) = 0.5 * (1.0 - eta) * shearMatrix(0.0, -1.0, h).row(0) +
+                 0.5 * (1.0 + eta) * shearMatrix(0.0, 1.0, h).row(0);
+  shear.row(1) = 0.5 * (1.0 - xi) * shearMatrix(-1.0, 0.0, h).row(1) +
+                 0.5 * (1.0 + xi) * shearMatrix(1.0, 0.0, h).row(1);
+  return shear;
+}
+
+// y = a x, a run of rows per thread
+void multiply(const SparseRows& a, const Eigen::VectorXd& x, Eigen::VectorXd& y) {
+  y.resize(a.rows());
+  const int* outer = a.outerIndexPtr();
+  const int* inner = a.innerIndexPtr();
+  const double* values = a.valuePtr();
+  const Eigen::Index rows = a.rows();
+#pragma omp parallel for schedule(static) if (rows >= kParallelRows)
+  for (Eigen::Index i = 0; i < rows; ++i) {
+    double sum = 0.0;
+    for (int k = outer[i]; k < outer[i + 1]; ++k) {
+      sum += values[k] * x[inner[k]];
+    }
+    y[i] = sum;
+  }
+}
+
+// y = inverse block diagonal times x
+void blockSolve(const std::vector<double>& inverse, int block, const Eigen::VectorXd& x, Eigen::VectorXd& y) {
+  y.resize(x.size());
+  const Eigen::Index nodes = x.size() / block;
+  const int squared = block * block;
+#pragma omp parallel for schedule(static) if (x.size() >= kParallelRows)
+  for (Eigen::Index n = 0; n < nodes; ++n) {
+    const double* m = inverse.data() + n * squared;
+    for (int i = 0; i < block; ++i) {
+      double sum = 0.0;
+      for (int j = 0; j < block; ++j) {
+        sum += m[i * block + j] * x[n * block + j];
+      }
+      y[n * block + i] = sum;
+    }
+  }
+}
+
+// Node grid of a level: the fine one is the plate's, each coarser one
+// its 3 x 3 aggregates, a short edge run joining the last
+struct NodeGrid {
+  int rows;
+  int cols;
+  int coarse(int n) const { return std::max(1, n / 3); }
+  int aggregate(int r, int c) const {
+    return std::min(r / 3, coarse(rows) - 1) * coarse(cols) + std::min(c / 3, coarse(cols) - 1);
+  }
+};
+
+} // namespace
+
+LaminatePlateSolver::LaminatePlateSolver(const Eigen::ArrayXXi& stack_of_cell, double spacing,
+                                         std::vector<Material> materials, std::vector<Stack> stacks,
+                                         const Options& options)
+    : rows_(static_cast<int>(stack_of_cell.rows())), cols_(static_cast<int>(stack_of_cell.cols())),
+      spacing_(spacing), stack_of_cell_(stack_of_cell), materials_(std::move(materials)),
+      stacks_(std::move(stacks)), options_(options) {
+  if (rows_ < 2 || cols_ < 2) {
+    throw std::invalid_argument("Laminate plate needs at least two cells a side");
+  }
+  if (!(spacing_ > 0.0) || !std::isfinite(spacing_)) {
+    throw std::invalid_argument("Laminate plate spacing must be positive");
+  }
+  for (const Material& m : materials_) {
+    const bool softens = std::isfinite(m.glass_transition);
+    if (!(m.modulus > 0.0) || !(m.poisson >= 0.0 && m.poisson < 0.5) || (softens && !(m.rubbery_modulus > 0.0))) {
+      throw std::invalid_argument("Laminate material needs positive moduli and a Poisson ratio in [0, 0.5)");
+    }
+  }
+  for (const Stack& stack : stacks_) {
+    if (stack.empty()) {
+      throw std::invalid_argument("Laminate stacks must not be empty");
+    }
+    for (const Layer& layer : stack) {
+      if (layer.material < 0 || layer.material >= static_cast<int>(materials_.size())) {
+        throw std::invalid_argument("Laminate layer material out of range");
+      }
+      if (!(layer.thickness > 0.0)) {
+        throw std::invalid_argument("Laminate layers must be thicker than zero");
+      }
+    }
+  }
+  if (stack_of_cell_.minCoeff() < 0 || stack_of_cell_.maxCoeff() >= static_cast<int>(stacks_.size())) {
+    throw std::invalid_argument("Laminate stack index out of range");
+  }
+
+  // u, v and w at the center node, v and w one node along x from it and
+  // w one node along y: the six rigid motions and nothing more
+  const int node_cols = cols_ + 1;
+  const int center = (rows_ / 2) * node_cols + cols_ / 2;
+  pinned_ = {kNodeDofs * center,
+             kNodeDofs * center + 1,
+             kNodeDofs * center + 2,
+             kNodeDofs * (center + 1) + 1,
+             kNodeDofs * (center + 1) + 2,
+             kNodeDofs * (center + node_cols) + 2};
+  std::sort(pinned_.begin(), pinned_.end());
+}
+
+bool LaminatePlateSolver::pinned(int dof) const {
+  return std::binary_search(pinned_.begin(), pinned_.end(), dof);
+}
+
+std::vector<bool> LaminatePlateSolver::regime(double temperature) const {
+  std::vector<bool> above(materials_.size());
+  for (std::size_t m = 0; m < materials_.size(); ++m) {
+    above[m] = temperature > materials_[m].glass_transition;
+  }
+  return above;
+}
+
+double LaminatePlateSolver::thermalStrain(const Material& material, double temperature) const {
+  // The expansion integrated from the stress-free temperature, glassy
+  // below the transition and rubbery above
+  const double t0 = options_.stress_free_temperature;
+  const double tg = material.glass_transition;
+  if (!std::isfinite(tg)) {
+    return material.expansion * (temperature - t0);
+  }
+  return material.expansion * (std::min(temperature, tg) - std::min(t0, tg)) +
+         material.rubbery_expansion * (std::max(temperature, tg) - std::max(t0, tg));
+}
+
+LaminatePlateSolver::Laminate LaminatePlateSolver::laminate(int stack, const std::vector<bool>& above,
+                                                            double temperature) const {
+  Laminate result;
+  result.a.setZero();
+  result.b.setZero();
+  result.d.setZero();
+  result.thermal_force.setZero();
+  result.thermal_moment.setZero();
+  double top = 0.0;
+  for (const Layer& layer : stacks_[stack]) {
+    top += layer.thickness;
+  }
+  const Eigen::Vector3d isotropic(1.0, 1.0, 0.0);
+  for (const Layer& layer : stacks_[stack]) {
+    const Material& m = materials_[layer.material];
+    const double modulus = above[layer.material] ? m.rubbery_modulus : m.modulus;
+    const Eigen::Matrix3d q = planeStress(modulus, m.poisson);
+    const double bottom = top - layer.thickness;
+    const double first = 0.5 * (top * top - bottom * bottom);
+    const double second = (top * top * top - bottom * bottom * bottom) / 3.0;
+    result.a += q * layer.thickness;
+    result.b += q * first;
+    result.d += q * second;
+    result.shear += kShearCorrection * modulus / (2.0 * (1.0 + m.poisson)) * layer.thickness;
+    const Eigen::Vector3d stress = q * isotropic * thermalStrain(m, temperature);
+    result.thermal_force += stress * layer.thickness;
+    result.thermal_moment += stress * first;
+    top = bottom;
+  }
+  return result;
+}
+
+std::unique_ptr<LaminatePlateSolver::Operator> LaminatePlateSolver::build(const std::vector<bool>& above) const {
+  auto op = std::make_unique<Operator>();
+  const double h = spacing_;
+  const double gauss = 1.0 / std::sqrt(3.0);
+  const double area = 0.25 * h * h; // Jacobian of each Gauss point, of weight one
+
+  // Element matrix per stack; every cell of a stack shares it
+  std::vector<ElementMatrix> element(stacks_.size());
+  for (std::size_t s = 0; s < stacks_.size(); ++s) {
+    const Laminate lam = laminate(static_cast<int>(s), above, options_.stress_free_temperature);
+    ElementMatrix k = ElementMatrix::Zero();
+    StrainMatrix membrane, bending;
+    for (int g = 0; g < 4; ++g) {
+      const double xi = gauss * kXi[g], eta = gauss * kEta[g];
+      strainMatrices(xi, eta, h, membrane, bending);
+      const Eigen::Matrix<double, 2, 20> shear = assumedShear(xi, eta, h);
+      k += area * (membrane.transpose() * lam.a * membrane + membrane.transpose() * lam.b * bending +
+                   bending.transpose() * lam.b * membrane + bending.transpose() * lam.d * bending +
+                   lam.shear * shear.transpose() * shear);
+    }
+    element[s] = k;
+  }
+
+  // The fine matrix: each node row couples the 3 x 3 nodes around it, so
+  // the compressed pattern is written directly, node by node, gathering
+  // from the up to four cells around the node
+  const int node_rows = rows_ + 1, node_cols = cols_ + 1;
+  const int nodes = node_rows * node_cols;
+  const Eigen::Index unknowns = static_cast<Eigen::Index>(nodes) * kNodeDofs;
+  std::vector<int> outer(unknowns + 1, 0);
+  for (int r = 0; r < node_rows; ++r) {
+    for (int c = 0; c < node_cols; ++c) {
+      const int span_r = (r > 0) + 1 + (r + 1 < node_rows);
+      const int span_c = (c > 0) + 1 + (c + 1 < node_cols);
+      const int row = kNodeDofs * (r * node_cols + c);
+      for (int k = 0; k < kNodeDofs; ++k) {
+        outer[row + k + 1] = span_r * span_c * kNodeDofs;
+      }
+    }
+  }
+  for (Eigen::Index i = 0; i < unknowns; ++i) {
+    outer[i + 1] += outer[i];
+  }
+  std::vector<int> inner(outer.back());
+  std::vector<double> values(outer.back(), 0.0);
+#pragma omp parallel for schedule(static) if (unknowns >= kParallelRows)
+  for (int r = 0; r < node_rows; ++r) {
+    for (int c = 0; c < node_cols; ++c) {
+      const int node = r * node_cols + c;
+      const int r0 = std::max(0, r - 1), c0 = std::max(0, c - 1);
+      const int width = std::min(node_cols - 1, c + 1) - c0 + 1;
+      for (int k = 0; k < kNodeDofs; ++k) {
+        const int row = kNodeDofs * node + k;
+        int at = outer[row];
+        for (int nr = r0; nr <= std::min(node_rows - 1, r + 1); ++nr) {
+          for (int nc = c0; nc <= std::min(node_cols - 1, c + 1); ++nc) {
+            for (int kc = 0; kc < kNodeDofs; ++kc) {
+              inner[at++] = kNodeDofs * (nr * node_cols + nc) + kc;
+            }
+          }
+        }
+        if (pinned(row)) {
+          values[outer[row] + kNodeDofs * ((r - r0) * width + (c - c0)) + k] = 1.0;
+          continue;
+        }
+        // Cells with this node as their local node a
+        for (int a = 0; a < 4; ++a) {
+          const int ci = r - (kEta[a] > 0.0 ? 1 : 0);
+          const int cj = c - (kXi[a] > 0.0 ? 1 : 0);
+          if (ci < 0 || cj < 0 || ci >= rows_ || cj >= cols_) {
+            continue;
+          }
+          const ElementMatrix& ke = element[stack_of_cell_(ci, cj)];
+          for (int b = 0; b < 4; ++b) {
+            const int br = ci + (kEta[b] > 0.0 ? 1 : 0);
+            const int bc = cj + (kXi[b] > 0.0 ? 1 : 0);
+            const int offset = outer[row] + kNodeDofs * ((br - r0) * width + (bc - c0));
+            for (int kc = 0; kc < kNodeDofs; ++kc) {
+              if (!pinned(kNodeDofs * (br * node_cols + bc) + kc)) {
+                values[offset + kc] += ke(kNodeDofs * a + k, kNodeDofs * b + kc);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  SparseRows fine = Eigen::Map<const SparseRows>(unknowns, unknowns, static_cast<Eigen::Index>(values.size()),
+                                                 outer.data(), inner.data(), values.data());
+
+  // The rigid motions in units of the spacing, zero where pinned
+  Eigen::MatrixXd modes = Eigen::MatrixXd::Zero(unknowns, kModes);
+  for (int r = 0; r < node_rows; ++r) {
+    for (int c = 0; c < node_cols; ++c) {
+      const Eigen::Index d = kNodeDofs * static_cast<Eigen::Index>(r * node_cols + c);
+      const double x = c - 0.5 * cols_, y = r - 0.5 * rows_;
+      modes(d, 0) = 1.0;
+      modes(d + 1, 1) = 1.0;
+      modes(d + 2, 2) = 1.0;
+      modes(d, 3) = -y;
+      modes(d + 1, 3) = x;
+      modes(d + 2, 4) = x;
+      modes(d + 3, 4) = -1.0;
+      modes(d + 2, 5) = y;
+      modes(d + 4, 5) = -1.0;
+    }
+  }
+  for (int dof : pinned_) {
+    modes.row(dof).setZero();
+  }
+
+  NodeGrid grid{node_rows, node_cols};
+  int block = kNodeDofs;
+  op->levels.emplace_back();
+  op->levels.back().a = std::move(fine);
+  for (;;) {
+    Level& level = op->levels.back();
+    level.block = block;
+    const Eigen::Index n = level.a.rows();
+    const Eigen::Index level_nodes = n / block;
+
+    // Block Jacobi: the inverse of each node's diagonal block
+    level.inverse_diagonal.assign(static_cast<std::size_t>(n) * block, 0.0);
+    for (Eigen::Index node = 0; node < level_nodes; ++node) {
+      Eigen::MatrixXd diagonal = Eigen::MatrixXd::Zero(block, block);
+      for (int i = 0; i < block; ++i) {
+        for (SparseRows::InnerIterator it(level.a, node * block + i); it; ++it) {
+          const Eigen::Index j = it.col() - node * block;
+          if (j >= 0 && j < block) {
+            diagonal(i, j) = it.value();
+          }
+        }
+      }
+      const Eigen::MatrixXd inverse = diagonal.ldlt().solve(Eigen::MatrixXd::Identity(block, block));
+      Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
+          level.inverse_diagonal.data() + node * block * block, block, block) = inverse;
+    }
+    // Largest eigenvalue of D^-1 A by power iteration, padded a little
+    Eigen::VectorXd v(n), av, dav;
+    for (Eigen::Index i = 0; i < n; ++i) {
+      v[i] = 1.0 + 0.5 * std::sin(0.7 * static_cast<double>(i));
+    }
+    double rho = 1.0;
+    for (int k = 0; k < kPowerIterations; ++k) {
+      multiply(level.a, v, av);
+      blockSolve(level.inverse_diagonal, block, av, dav);
+      rho = dav.norm() / v.norm();
+      v = dav / dav.norm();
+    }
+    rho *= 1.1;
+    level.damping = 4.0 / (3.0 * rho);
+
+    const int coarse_rows = grid.coarse(grid.rows), coarse_cols = grid.coarse(grid.cols);
+    const Eigen::Index coarse_unknowns = static_cast<Eigen::Index>(coarse_rows) * coarse_cols * kModes;
+    if (n <= kCoarsestUnknowns || coarse_unknowns >= n || static_cast<int>(op->levels.size()) >= kMaxLevels) {
+      op->coarsest.compute(Eigen::MatrixXd(level.a));
+      break;
+    }
+
+    // Tentative prolongation: the modes on each aggregate, orthonormalized;
+    // their triangular factors are the coarse level's modes
+    std::vector<std::vector<Eigen::Index>> members(static_cast<std::size_t>(coarse_rows) * coarse_cols);
+    for (int r = 0; r < grid.rows; ++r) {
+      for (int c = 0; c < grid.cols; ++c) {
+        members[grid.aggregate(r, c)].push_back(static_cast<Eigen::Index>(r) * grid.cols + c);
+      }
+    }
+    std::vector<Eigen::Triplet<double>> entries;
+    entries.reserve(static_cast<std::size_t>(n) * kModes);
+    Eigen::MatrixXd coarse_modes(coarse_unknowns, kModes);
+    for (std::size_t agg = 0; agg < members.size(); ++agg) {
+      const auto& nodes_in = members[agg];
+      Eigen::MatrixXd local(static_cast<Eigen::Index>(nodes_in.size()) * block, kModes);
+      for (std::size_t m = 0; m < nodes_in.size(); ++m) {
+        local.middleRows(static_cast<Eigen::Index>(m) * block, block) = modes.middleRows(nodes_in[m] * block, block);
+      }
+      Eigen::HouseholderQR<Eigen::MatrixXd> qr(local);
+      const Eigen::MatrixXd q = qr.householderQ() * Eigen::MatrixXd::Identity(local.rows(), kModes);
+      coarse_modes.middleRows(static_cast<Eigen::Index>(agg) * kModes, kModes) =
+          qr.matrixQR().topRows(kModes).triangularView<Eigen::Upper>();
+      for (std::size_t m = 0; m < nodes_in.size(); ++m) {
+        for (int i = 0; i < block; ++i) {
+          for (int j = 0; j < kModes; ++j) {
+            const double value = q(static_cast<Eigen::Index>(m) * block + i, j);
+            if (value != 0.0) {
+              entries.emplace_back(nodes_in[m] * block + i, static_cast<Eigen::Index>(agg) * kModes + j, value);
+            }
+          }
+        }
+      }
+    }
+    SparseRows tentative(n, coarse_unknowns);
+    tentative.setFromTriplets(entries.begin(), entries.end());
+
+    // Smoothed by one damped Jacobi step, and the Galerkin coarse matrix
+    std::vector<Eigen::Triplet<double>> inverse_entries;
+    inverse_entries.reserve(level.inverse_diagonal.size());
+    for (Eigen::Index node = 0; node < level_nodes; ++node) {
+      for (int i = 0; i < block; ++i) {
+        for (int j = 0; j < block; ++j) {
+          inverse_entries.emplace_back(node * block + i, node * block + j,
+                                       level.inverse_diagonal[(node * block + i) * block + j]);
+        }
+      }
+    }
+    SparseRows inverse_diagonal(n, n);
+    inverse_diagonal.setFromTriplets(inverse_entries.begin(), inverse_entries.end());
+    const SparseRows scaled = inverse_diagonal * level.a;
+    level.p = tentative - level.damping * SparseRows(scaled * tentative);
+    level.p.prune(0.0);
+    level.r = level.p.transpose();
+    const SparseRows ap = level.a * level.p;
+    SparseRows coarse = level.r * ap;
+
+    modes = std::move(coarse_modes);
+    grid = NodeGrid{coarse_rows, coarse_cols};
+    block = kModes;
+    op->levels.emplace_back();
+    op->levels.back().a = std::move(coarse);
+  }
+  return op;
+}
+
+const LaminatePlateSolver::Operator& LaminatePlateSolver::op(const std::vector<bool>& above) const {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = operators_.find(above);
+    if (it != operators_.end()) {
+      return *it->second;
+    }
+  }
+  // Built outside the lock; a racing thread may build it too, and the
+  // first one stored is kept
+  std::unique_ptr<Operator> built = build(above);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto inserted = operators_.emplace(above, std::move(built));
+  if (first_levels_ == 0) {
+    first_levels_ = static_cast<int>(inserted.first->second->levels.size());
+  }
+  return *inserted.first->second;
+}
+
+std::size_t LaminatePlateSolver::operators() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return operators_.size();
+}
+
+int LaminatePlateSolver::levels() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return first_levels_;
+}
+
+Eigen::VectorXd LaminatePlateSolver::load(const std::vector<bool>& above, double temperature) const {
+  // Thermal resultants per stack, through the membrane and bending strains
+  // integrated over the element
+  const double h = spacing_;
+  const double gauss = 1.0 / std::sqrt(3.0);
+  const double area = 0.25 * h * h;
+  Eigen::Matrix<double, 20, 3> membrane_sum = Eigen::Matrix<double, 20, 3>::Zero();
+  Eigen::Matrix<double, 20, 3> bending_sum = Eigen::Matrix<double, 20, 3>::Zero();
+  StrainMatrix membrane, bending;
+  for (int g = 0; g < 4; ++g) {
+    strainMatrices(gauss * kXi[g], gauss * kEta[g], h, membrane, bending);
+    membrane_sum += area * membrane.transpose();
+    bending_sum += area * bending.transpose();
+  }
+  std::vector<Eigen::Matrix<double, 20, 1>> element(stacks_.size());
+  for (std::size_t s = 0; s < stacks_.size(); ++s) {
+    const Laminate lam = laminate(static_cast<int>(s), above, temperature);
+    element[s] = membrane_sum * lam.thermal_force + bending_sum * lam.thermal_moment;
+  }
+
+  const int node_rows = rows_ + 1, node_cols = cols_ + 1;
+  Eigen::VectorXd f = Eigen::VectorXd::Zero(static_cast<Eigen::Index>(node_rows) * node_cols * kNodeDofs);
+#pragma omp parallel for schedule(static) if (f.size() >= kParallelRows)
+  for (int r = 0; r < node_rows; ++r) {
+    for (int c = 0; c < node_cols; ++c) {
+      const int base = kNodeDofs * (r * node_cols + c);
+      for (int a = 0; a < 4; ++a) {
+        const int ci = r - (kEta[a] > 0.0 ? 1 : 0);
+        const int cj = c - (kXi[a] > 0.0 ? 1 : 0);
+        if (ci < 0 || cj < 0 || ci >= rows_ || cj >= cols_) {
+          continue;
+        }
+        f.segment<kNodeDofs>(base) += element[stack_of_cell_(ci, cj)].segment<kNodeDofs>(kNodeDofs * a);
+      }
+    }
+  }
+  for (int dof : pinned_) {
+    f[dof] = 0.0;
+  }
+  return f;
+}
+
+void LaminatePlateSolver::cycle(const Operator& op, std::size_t l, Eigen::VectorXd& x,
+                                const Eigen::VectorXd& f) const {
+  if (l + 1 == op.levels.size()) {
+    x = op.coarsest.solve(f);
+    return;
+  }
+  const Level& level = op.levels[l];
+  Eigen::VectorXd ax, step;
+  const auto smooth = [&]() {
+    for (int s = 0; s < options_.smoothing_steps; ++s) {
+      multiply(level.a, x, ax);
+      blockSolve(level.inverse_diagonal, level.block, f - ax, step);
+      x += level.damping * step;
+    }
+  };
+  x.setZero(f.size());
+  smooth();
+  multiply(level.a, x, ax);
+  const Eigen::VectorXd coarse_f = level.r * (f - ax);
+  Eigen::VectorXd coarse_x;
+  cycle(op, l + 1, coarse_x, coarse_f);
+  x += level.p * coarse_x;
+  smooth();
+}
+
+LaminatePlateSolver::Result LaminatePlateSolver::solve(const Operator& op, const std::vector<bool>& above,
+                                                       double temperature, Eigen::VectorXd& u) const {
+  const Eigen::VectorXd f = load(above, temperature);
+  const SparseRows& a = op.levels.front().a;
+  Result result;
+  result.temperature = temperature;
+  if (u.size() != f.size()) {
+    u = Eigen::VectorXd::Zero(f.size());
+  }
+  const double reference = f.norm();
+  if (reference == 0.0) {
+    u.setZero();
+    return postprocess(above, temperature, u, result);
+  }
+
+  Eigen::VectorXd au;
+  multiply(a, u, au);
+  Eigen::VectorXd r = f - au;
+  double residual = r.norm() / reference;
+  if (residual > options_.tolerance) {
+    Eigen::VectorXd z, p, ap;
+    cycle(op, 0, z, r);
+    p = z;
+    double rz = r.dot(z);
+    while (residual > options_.tolerance) {
+      if (result.iterations == options_.max_iterations) {
+        throw std::runtime_error("Laminate plate solve did not converge in " +
+                                 std::to_string(options_.max_iterations) + " iterations");
+      }
+      multiply(a, p, ap);
+      const double alpha = rz / p.dot(ap);
+      u += alpha * p;
+      r -= alpha * ap;
+      residual = r.norm() / reference;
+      ++result.iterations;
+      if (residual <= options_.tolerance) {
+        break;
+      }
+      cycle(op, 0, z, r);
+      const double next = r.dot(z);
+      p = z + (next / rz) * p;
+      rz = next;
+    }
+  }
+  result.residual = residual;
+  return postprocess(above, temperature, u, result);
+}
+
+LaminatePlateSolver::Result LaminatePlateSolver::postprocess(const std::vector<bool>& above, double temperature,
+                                                             const Eigen::VectorXd& u, Result result) const {
+  const int node_rows = rows_ + 1, node_cols = cols_ + 1;
+
+  // Warpage from the least-squares plane through the nodes
+  Eigen::ArrayXXd w(node_rows, node_cols);
+  Eigen::Matrix3d normal = Eigen::Matrix3d::Zero();
+  Eigen::Vector3d moments = Eigen::Vector3d::Zero();
+  for (int r = 0; r < node_rows; ++r) {
+    for (int c = 0; c < node_cols; ++c) {
+      w(r, c) = u[kNodeDofs * (r * node_cols + c) + 2];
+      const Eigen::Vector3d basis(1.0, c, r);
+      normal += basis * basis.transpose();
+      moments += basis * w(r, c);
+    }
+  }
+  const Eigen::Vector3d plane = normal.ldlt().solve(moments);
+  for (int r = 0; r < node_rows; ++r) {
+    for (int c = 0; c < node_cols; ++c) {
+      w(r, c) -= plane[0] + plane[1] * c + plane[2] * r;
+    }
+  }
+  result.warpage_range = w.maxCoeff() - w.minCoeff();
+  result.warpage = std::move(w);
+
+  // Layer stresses at the cell centers: sigma = Q (eps0 + z kappa - eps_T)
+  struct LayerFace {
+    Eigen::Matrix3d q;
+    double strain;
+    double top, bottom;
+  };
+  std::vector<std::vector<LayerFace>> faces(stacks_.size());
+  for (std::size_t s = 0; s < stacks_.size(); ++s) {
+    double top = 0.0;
+    for (const Layer& layer : stacks_[s]) {
+      top += layer.thickness;
+    }
+    for (const Layer& layer : stacks_[s]) {
+      const Material& m = materials_[layer.material];
+      const double modulus = above[layer.material] ? m.rubbery_modulus : m.modulus;
+      faces[s].push_back({planeStress(modulus, m.poisson), thermalStrain(m, temperature), top, top - layer.thickness});
+      top -= layer.thickness;
+    }
+  }
+  StrainMatrix membrane, bending;
+  strainMatrices(0.0, 0.0, spacing_, membrane, bending);
+  result.peak_stress.resize(rows_, cols_);
+  result.peak_layer.resize(rows_, cols_);
+#pragma omp parallel for schedule(static) if (static_cast<Eigen::Index>(rows_) * cols_ >= kParallelRows)
+  for (int i = 0; i < rows_; ++i) {
+    for (int j = 0; j < cols_; ++j) {
+      Eigen::Matrix<double, 20, 1> ue;
+      for (int a = 0; a < 4; ++a) {
+        const int node = (i + (kEta[a] > 0.0 ? 1 : 0)) * node_cols + j + (kXi[a] > 0.0 ? 1 : 0);
+        ue.segment<kNodeDofs>(kNodeDofs * a) = u.segment<kNodeDofs>(kNodeDofs * node);
+      }
+      const Eigen::Vector3d midplane = membrane * ue;
+      const Eigen::Vector3d curvature = bending * ue;
+      double peak = 0.0;
+      int peak_layer = 0;
+      const auto& layers = faces[stack_of_cell_(i, j)];
+      for (std::size_t k = 0; k < layers.size(); ++k) {
+        for (const double z : {layers[k].top, layers[k].bottom}) {
+          Eigen::Vector3d strain = midplane + z * curvature;
+          strain[0] -= layers[k].strain;
+          strain[1] -= layers[k].strain;
+          const Eigen::Vector3d s = layers[k].q * strain;
+          const double mises = std::sqrt(s[0] * s[0] - s[0] * s[1] + s[1] * s[1] + 3.0 * s[2] * s[2]);
+          if (mises > peak) {
+            peak = mises;
+            peak_layer = static_cast<int>(k);
+          }
+        }
+      }
+      result.peak_stress(i, j) = peak;
+      result.peak_layer(i, j) = peak_layer;
+    }
+  }
+  return result;
+}
+
+LaminatePlateSolver::Result LaminatePlateSolver::solve(double temperature) const {
+  const std::vector<bool> above = regime(temperature);
+  Eigen::VectorXd u;
+  return solve(op(above), above, temperature, u);
+}
+
+std::vector<LaminatePlateSolver::Result> LaminatePlateSolver::solve(const std::vector<double>& temperatures) const {
+  // The last two solutions of each regime; the load is affine in the
+  // temperature within one, and so is the solution
+  struct History {
+    std::vector<double> temperature;
+    std::vector<Eigen::VectorXd> solution;
+  };
+  std::map<std::vector<bool>, History> history;
+  std::vector<Result> results;
+  results.reserve(temperatures.size());
+  for (const double temperature : temperatures) {
+    const std::vector<bool> above = regime(temperature);
+    History& past = history[above];
+    Eigen::VectorXd u;
+    const std::size_t n = past.solution.size();
+    if (n == 1) {
+      u = past.solution[0];
+    } else if (n == 2) {
+      const double t = (temperature - past.temperature[1]) / (past.temperature[1] - past.temperature[0]);
+      u = past.solution[1] + t * (past.solution[1] - past.solution[0]);
+    }
+    results.push_back(solve(op(above), above, temperature, u));
+    if (n > 0 && past.temperature.back() == temperature) {
+      past.solution.back() = std::move(u);
+      continue;
+    }
+    if (n == 2) {
+      past.temperature.erase(past.temperature.begin());
+      past.solution.erase(past.solution.begin());
+    }
+    past.temperature.push_back(temperature);
+    past.solution.push_back(std::move(u));
+  }
+  return results;
+}
@@ -0,0 +1,150 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Thermo-mechanical warpage and stress of a layered plate, such as a
+// package or a stack of dies on an interposer, under a uniform
+// temperature. The plate is a rows x cols grid of square cells, each with
+// a stack of isotropic elastic layers; stacks may differ from cell to cell
+// (die, mold, underfill) but share the plate's bottom face. Each cell is a
+// four-node composite shell element in first-order shear deformation
+// theory: every node moves in the plane (u, v), out of it (w) and turns
+// its normal (phi_x, phi_y), and the layers enter through the laminate's
+// membrane, coupling and bending stiffnesses A, B and D, with the
+// transverse shear interpolated from the edge midpoints (MITC4) so thin
+// plates do not lock. Thermal strain loads the plate through the layers'
+// expansion from the stress-free temperature. The plate is free: six
+// displacements around its center are pinned, which is statically
+// determinate and so leaves the stresses untouched.
+//
+// The system is solved by conjugate gradients preconditioned by a
+// smoothed-aggregation algebraic multigrid V-cycle. Aggregates are 3 x 3
+// blocks of nodes, each level's prolongation carrying the plate's six rigid
+// motions exactly, with damped block Jacobi smoothing; the coarsest level
+// is factorized densely. Polymers soften past their glass transition, so
+// the stiffness depends on the temperature only through which materials
+// are above it: the matrix and its hierarchy are built once per such
+// regime and kept, and a temperature sweep warm-starts each solve from the
+// last two in its regime, on which the solution is linear in the
+// temperature.
+class LaminatePlateSolver {
+public:
+  struct Material {
+    double modulus;   // Pa
+    double poisson;
+    double expansion; // 1/K
+    // Above the glass transition the rubbery values hold; infinite for
+    // none
+    double glass_transition = std::numeric_limits<double>::infinity(); // K
+    double rubbery_modulus = 0.0;
+    double rubbery_expansion = 0.0;
+  };
+
+  struct Layer {
+    int material; // Index into the materials
+    double thickness; // m
+  };
+  using Stack = std::vector<Layer>; // From the top of the plate down
+
+  struct Options {
+    double stress_free_temperature = 298.15; // K, where the plate is flat and unstressed
+    double tolerance = 1e-8; // On the residual's norm, relative to the load's
+    int max_iterations = 500;
+    int smoothing_steps = 2; // Block Jacobi sweeps before and after each coarse correction
+  };
+
+  struct Result {
+    double temperature = 0.0;
+    // Out-of-plane displacement (m) of the (rows + 1) x (cols + 1) nodes
+    // from their best-fit plane, positive toward the top
+    Eigen::ArrayXXd warpage;
+    double warpage_range = 0.0; // Highest node less the lowest
+    // Highest in-plane von Mises stress (Pa) over the faces of each cell's
+    // layers, at the cell's center, and the layer it is in
+    Eigen::ArrayXXd peak_stress;
+    Eigen::ArrayXXi peak_layer;
+    int iterations = 0;
+    double residual = 0.0; // Relative to the load's norm
+  };
+
+  // stack_of_cell holds each cell's index into stacks. Throws
+  // std::invalid_argument for a grid with fewer than two cells a side, a
+  // spacing that is not positive, a stack index or layer material out of
+  // range, an empty stack, a layer that is not thicker than zero, or a
+  // material without positive moduli and a Poisson ratio in [0, 0.5).
+  LaminatePlateSolver(const Eigen::ArrayXXi& stack_of_cell, double spacing, std::vector<Material> materials,
+                      std::vector<Stack> stacks, const Options& options);
+  LaminatePlateSolver(const Eigen::ArrayXXi& stack_of_cell, double spacing, std::vector<Material> materials,
+                      std::vector<Stack> stacks)
+      : LaminatePlateSolver(stack_of_cell, spacing, std::move(materials), std::move(stacks), Options()) {}
+
+  // Throws std::runtime_error when the tolerance is not met in
+  // max_iterations
+  Result solve(double temperature) const;
+  // One result per temperature, in order, reusing operators and
+  // solutions along the way
+  std::vector<Result> solve(const std::vector<double>& temperatures) const;
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  // Operators and hierarchies built so far, one per regime met
+  std::size_t operators() const;
+  // Multigrid levels of the first operator built, 0 before any
+  int levels() const;
+
+private:
+  // One matrix with its preconditioner: the levels from fine to coarse
+  struct Level {
+    Eigen::SparseMatrix<double, Eigen::RowMajor> a;
+    Eigen::SparseMatrix<double, Eigen::RowMajor> p; // To this level from the next coarser; empty on the coarsest
+    Eigen::SparseMatrix<double, Eigen::RowMajor> r; // p transposed
+    int block = 0; // Unknowns per node
+    std::vector<double> inverse_diagonal; // block x block per node, row-major
+    double damping = 0.0;
+  };
+  struct Operator {
+    std::vector<Level> levels;
+    Eigen::LDLT<Eigen::MatrixXd> coarsest;
+  };
+  // Stiffnesses of a stack, and its thermal force and moment resultants
+  struct Laminate {
+    Eigen::Matrix3d a, b, d;
+    double shear = 0.0;
+    Eigen::Vector3d thermal_force, thermal_moment;
+  };
+
+  // Bit per material above its glass transition
+  std::vector<bool> regime(double temperature) const;
+  double thermalStrain(const Material& material, double temperature) const;
+  Laminate laminate(int stack, const std::vector<bool>& above, double temperature) const;
+  const Operator& op(const std::vector<bool>& above) const;
+  std::unique_ptr<Operator> build(const std::vector<bool>& above) const;
+  Eigen::VectorXd load(const std::vector<bool>& above, double temperature) const;
+  // One V-cycle from zero
+  void cycle(const Operator& op, std::size_t l, Eigen::VectorXd& x, const Eigen::VectorXd& f) const;
+  // From the guess in u, left holding the solution
+  Result solve(const Operator& op, const std::vector<bool>& above, double temperature, Eigen::VectorXd& u) const;
+  Result postprocess(const std::vector<bool>& above, double temperature, const Eigen::VectorXd& u,
+                     Result result) const;
+  bool pinned(int dof) const;
+
+  int rows_;
+  int cols_;
+  double spacing_;
+  Eigen::ArrayXXi stack_of_cell_;
+  std::vector<Material> materials_;
+  std::vector<Stack> stacks_;
+  Options options_;
+  std::vector<int> pinned_; // Sorted
+  mutable std::mutex mutex_; // Guards operators_
+  mutable std::map<std::vector<bool>, std::unique_ptr<Operator>> operators_;
+  mutable int first_levels_ = 0;
+};
@@ -0,0 +1,212 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "layer_connectivity.hpp"
+#include "task_scheduler.hpp"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+// Runs of one row of a layer
+struct RowRuns {
+  const MaskRun* begin;
+  const MaskRun* end;
+};
+
+// f(p, q) for every pair of overlapping runs p of a and q of b, both
+// sorted by column
+template <typename F>
+void forOverlaps(RowRuns a, RowRuns b, F&& f) {
+  while (a.begin != a.end && b.begin != b.end) {
+    if (a.begin->col_end > b.begin->col_begin && b.begin->col_end > a.begin->col_begin) {
+      f(a.begin, b.begin);
+    }
+    // The run ending first overlaps nothing further along the other row
+    if (a.begin->col_end < b.begin->col_end) {
+      ++a.begin;
+    } else {
+      ++b.begin;
+    }
+  }
+}
+
+std::vector<std::size_t> rowStarts(const std::vector<MaskRun>& runs, int rows) {
+  std::vector<std::size_t> starts(static_cast<std::size_t>(rows) + 1);
+  std::size_t r = 0;
+  for (int i = 0; i < rows; ++i) {
+    starts[i] = r;
+    while (r < runs.size() && runs[r].row == i) {
+      ++r;
+    }
+  }
+  starts[rows] = runs.size();
+  return starts;
+}
+
+int findRoot(std::vector<int>& parent, int r) {
+  while (parent[r] != r) {
+    r = parent[r] = parent[parent[r]];
+  }
+  return r;
+}
+
+// The lower index becomes the root, so a band only ever links its own runs
+void unite(std::vector<int>& parent, int a, int b) {
+  a = findRoot(parent, a);
+  b = findRoot(parent, b);
+  if (a < b) {
+    parent[b] = a;
+  } else if (b < a) {
+    parent[a] = b;
+  }
+}
+
+} // namespace
+
+int NetDatabase::layerIndex(const std::string& name) const {
+  const auto it = std::find(names_.begin(), names_.end(), name);
+  return it == names_.end() ? -1 : static_cast<int>(it - names_.begin());
+}
+
+int NetDatabase::netAt(int layer, int i, int j) const {
+  if (i < 0 || i >= rows_ || j < 0 || j >= cols_) {
+    return -1;
+  }
+  const auto first = runs_[layer].begin() + row_start_[layer][i];
+  const auto last = runs_[layer].begin() + row_start_[layer][i + 1];
+  // The last run starting at or before j
+  auto it = std::upper_bound(first, last, j, [](int col, const MaskRun& run) { return col < run.col_begin; });
+  if (it == first || (--it)->col_end <= j) {
+    return -1;
+  }
+  return run_nets_[layer][it - runs_[layer].begin()];
+}
+
+LayerConnectivity::LayerConnectivity(int rows, int cols) : rows_(rows), cols_(cols) {
+  if (rows < 0 || cols < 0) {
+    throw std::invalid_argument("Layer connectivity needs a grid of non-negative size");
+  }
+}
+
+int LayerConnectivity::addLayer(const std::string& name, const BitMask& mask) {
+  if (mask.rows() != rows_ || mask.cols() != cols_) {
+    throw std::invalid_argument("Layer " + name + " does not match the connectivity grid");
+  }
+  if (std::find(names_.begin(), names_.end(), name) != names_.end()) {
+    throw std::invalid_argument("Duplicate connectivity layer: " + name);
+  }
+  names_.push_back(name);
+  runs_.push_back(mask.runs());
+  row_start_.push_back(rowStarts(runs_.back(), rows_));
+  return static_cast<int>(names_.size()) - 1;
+}
+
+void LayerConnectivity::connect(const std::string& a, const std::string& b) {
+  const auto index = [this](const std::string& name) {
+    const auto it = std::find(names_.begin(), names_.end(), name);
+    if (it == names_.end()) {
+      throw std::invalid_argument("Unknown connectivity layer: " + name);
+    }
+    return static_cast<int>(it - names_.begin());
+  };
+  connections_.emplace_back(index(a), index(b));
+}
+
+NetDatabase LayerConnectivity::extract(int band_rows) const {
+  const int layers = static_cast<int>(names_.size());
+  std::vector<std::size_t> offset(layers + 1, 0);
+  for (int l = 0; l < layers; ++l) {
+    offset[l + 1] = offset[l] + runs_[l].size();
+  }
+  if (offset[layers] > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+    throw std::length_error("Too many runs for layer connectivity");
+  }
+  std::vector<int> parent(offset[layers]);
+  std::iota(parent.begin(), parent.end(), 0);
+
+  const auto row = [this](int l, int i) {
+    return RowRuns{runs_[l].data() + row_start_[l][i], runs_[l].data() + row_start_[l][i + 1]};
+  };
+  const auto index = [&](int l, const MaskRun* run) { return static_cast<int>(offset[l] + (run - runs_[l].data())); };
+  // Runs of each layer touching the row above
+  const auto joinRows = [&](int i) {
+    for (int l = 0; l < layers; ++l) {
+      forOverlaps(row(l, i - 1), row(l, i),
+                  [&](const MaskRun* p, const MaskRun* q) { unite(parent, index(l, p), index(l, q)); });
+    }
+  };
+
+  if (band_rows <= 0) {
+    const int bands = 4 * std::max(1, TaskScheduler::getInstance().threadCount());
+    band_rows = std::max(1, (rows_ + bands - 1) / bands);
+  }
+  const int bands = (rows_ + band_rows - 1) / band_rows;
+  TaskScheduler::getInstance().parallelFor(0, bands, [&](int first, int last) {
+    for (int b = first; b < last; ++b) {
+      const int i0 = b * band_rows;
+      const int i1 = std::min(rows_, i0 + band_rows);
+      for (int i = i0; i < i1; ++i) {
+        if (i > i0) {
+          joinRows(i);
+        }
+        for (const auto& c : connections_) {
+          forOverlaps(row(c.first, i), row(c.second, i), [&](const MaskRun* p, const MaskRun* q) {
+            unite(parent, index(c.first, p), index(c.second, q));
+          });
+        }
+      }
+    }
+  }, 1);
+  for (int b = 1; b < bands; ++b) {
+    joinRows(b * band_rows);
+  }
+
+  NetDatabase nets;
+  nets.rows_ = rows_;
+  nets.cols_ = cols_;
+  nets.names_ = names_;
+  nets.runs_ = runs_;
+  nets.row_start_ = row_start_;
+  nets.run_nets_.resize(layers);
+  std::vector<int> net_of_root(parent.size(), -1);
+  int count = 0;
+  for (int l = 0; l < layers; ++l) {
+    nets.run_nets_[l].resize(runs_[l].size());
+    for (std::size_t r = 0; r < runs_[l].size(); ++r) {
+      int& net = net_of_root[findRoot(parent, static_cast<int>(offset[l] + r))];
+      if (net < 0) {
+        net = count++;
+      }
+      nets.run_nets_[l][r] = net;
+    }
+  }
+
+  // A run's perimeter is its two ends and both long sides, less what it
+  // shares with the runs above and below, which are on its net
+  nets.area_.assign(static_cast<std::size_t>(count) * layers, 0);
+  nets.perimeter_.assign(static_cast<std::size_t>(count) * layers, 0);
+  nets.bounds_.assign(count, {rows_, 0, cols_, 0});
+  for (int l = 0; l < layers; ++l) {
+    for (std::size_t r = 0; r < runs_[l].size(); ++r) {
+      const MaskRun& run = runs_[l][r];
+      const int net = nets.run_nets_[l][r];
+      const std::size_t length = static_cast<std::size_t>(run.col_end - run.col_begin);
+      nets.area_[static_cast<std::size_t>(net) * layers + l] += length;
+      nets.perimeter_[static_cast<std::size_t>(net) * layers + l] += 2 * length + 2;
+      NetDatabase::Bounds& box = nets.bounds_[net];
+      box.row_begin = std::min(box.row_begin, run.row);
+      box.row_end = std::max(box.row_end, run.row + 1);
+      box.col_begin = std::min(box.col_begin, run.col_begin);
+      box.col_end = std::max(box.col_end, run.col_end);
+    }
+    for (int i = 1; i < rows_; ++i) {
+      forOverlaps(row(l, i - 1), row(l, i), [&](const MaskRun* p, const MaskRun* q) {
+        const int shared = std::min(p->col_end, q->col_end) - std::max(p->col_begin, q->col_begin);
+        const int net = nets.run_nets_[l][p - runs_[l].data()];
+        nets.perimeter_[static_cast<std::size_t>(net) * layers + l] -= 2 * static_cast<std::size_t>(shared);
+      });
+    }
+  }
+  return nets;
+}
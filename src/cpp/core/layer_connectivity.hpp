@@ -0,0 +1,86 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "bit_mask.hpp"
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Nets of a stack of rasterized conducting layers: each net is a connected
+// set of cells, 4-connected within a layer and joined across layers where
+// connected layers overlap. Built by LayerConnectivity; read by antenna
+// checks, parasitic extraction and netlisting alike.
+class NetDatabase {
+public:
+  // Cells [row_begin, row_end) x [col_begin, col_end) holding a net
+  struct Bounds {
+    int row_begin, row_end;
+    int col_begin, col_end;
+  };
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  int layerCount() const { return static_cast<int>(names_.size()); }
+  const std::string& layerName(int layer) const { return names_[layer]; }
+  // -1 if there is no such layer
+  int layerIndex(const std::string& name) const;
+  int netCount() const { return static_cast<int>(bounds_.size()); }
+
+  // Net of cell (i, j) of layer, -1 where the layer is clear
+  int netAt(int layer, int i, int j) const;
+  // Set cells of the net on layer
+  std::size_t area(int net, int layer) const { return area_[static_cast<std::size_t>(net) * names_.size() + layer]; }
+  // Sides of those cells facing a clear cell of the layer or the border
+  std::size_t perimeter(int net, int layer) const {
+    return perimeter_[static_cast<std::size_t>(net) * names_.size() + layer];
+  }
+  const Bounds& bounds(int net) const { return bounds_[net]; }
+
+  // A layer's set cells as runs, by row then column, and the net of each
+  const std::vector<MaskRun>& runs(int layer) const { return runs_[layer]; }
+  const std::vector<int>& runNets(int layer) const { return run_nets_[layer]; }
+
+private:
+  friend class LayerConnectivity;
+
+  int rows_ = 0;
+  int cols_ = 0;
+  std::vector<std::string> names_;
+  std::vector<std::vector<MaskRun>> runs_;
+  std::vector<std::vector<std::size_t>> row_start_; // Per layer, first run of each row and one past the last
+  std::vector<std::vector<int>> run_nets_;
+  std::vector<std::size_t> area_; // Net-major, layerCount() per net
+  std::vector<std::size_t> perimeter_;
+  std::vector<Bounds> bounds_;
+};
+
+// Connected components of a layer stack by union-find over the layers'
+// runs instead of comparing shapes pairwise. The rows are cut into bands
+// labelled in parallel, each band joining only runs within it: runs
+// touching the row above on their own layer, and runs overlapping on
+// connected layers in the same row. The runs either side of each cut are
+// then joined, and nets are numbered in order of their first run, layer
+// by layer, so the numbering does not depend on the banding.
+class LayerConnectivity {
+public:
+  LayerConnectivity(int rows, int cols);
+
+  // The layer's index. Throws std::invalid_argument if the mask is not
+  // rows x cols or the name is taken.
+  int addLayer(const std::string& name, const BitMask& mask);
+  // Cells set on both layers join their nets, e.g. a via layer with the
+  // metals above and below it, or contacts with poly and diffusion.
+  // Throws std::invalid_argument for an unknown layer.
+  void connect(const std::string& a, const std::string& b);
+
+  // band_rows <= 0 picks about four bands per thread
+  NetDatabase extract(int band_rows = 0) const;
+
+private:
+  int rows_;
+  int cols_;
+  std::vector<std::string> names_;
+  std::vector<std::vector<MaskRun>> runs_;
+  std::vector<std::vector<std::size_t>> row_start_;
+  std::vector<std::pair<int, int>> connections_;
+};
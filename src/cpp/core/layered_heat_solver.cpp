@@ -0,0 +1,214 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "layered_heat_solver.hpp"
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// Modes below this count go through the stack on the calling thread
+constexpr long kParallelModes = 1 << 12;
+
+// Cosine transform of length n diagonalizing the second difference with
+// zero-flux ends, as orthonormal rows
+Eigen::MatrixXd cosineBasis(int n) {
+  Eigen::MatrixXd basis(n, n);
+  for (int a = 0; a < n; ++a) {
+    const double scale = std::sqrt((a == 0 ? 1.0 : 2.0) / n);
+    for (int i = 0; i < n; ++i) {
+      basis(a, i) = scale * std::cos(M_PI * a * (i + 0.5) / n);
+    }
+  }
+  return basis;
+}
+
+// Solves the stack's tridiagonal for a run of consecutive modes in place,
+// plane by plane so each pass streams through memory. values[l * stride +
+// m] holds mode m's right-hand side on plane l; pivots needs one entry per
+// mode and factors one per plane and mode.
+template <typename T>
+void sweep(const std::vector<double>& below, const std::vector<double>& diagonal,
+           const std::vector<double>& lateral, const double* eigenvalues, std::size_t run, T* values,
+           std::size_t stride, double* pivots, double* factors) {
+  const std::size_t planes = diagonal.size();
+  for (std::size_t m = 0; m < run; ++m) {
+    pivots[m] = diagonal[0] + lateral[0] * eigenvalues[m];
+    values[m] /= pivots[m];
+  }
+  for (std::size_t l = 1; l < planes; ++l) {
+    T* value = values + l * stride;
+    const T* above = value - stride;
+    double* factor = factors + (l - 1) * run;
+    for (std::size_t m = 0; m < run; ++m) {
+      factor[m] = -below[l - 1] / pivots[m];
+      pivots[m] = diagonal[l] + lateral[l] * eigenvalues[m] + below[l - 1] * factor[m];
+      value[m] = (value[m] + below[l - 1] * above[m]) / pivots[m];
+    }
+  }
+  for (std::size_t l = planes - 1; l-- > 0;) {
+    T* value = values + l * stride;
+    const T* next = value + stride;
+    const double* factor = factors + l * run;
+    for (std::size_t m = 0; m < run; ++m) {
+      value[m] -= factor[m] * next[m];
+    }
+  }
+}
+
+} // namespace
+
+LayeredHeatSolver::LayeredHeatSolver(int rows, int cols, double spacing, std::vector<Plane> planes,
+                                     const Options& options, std::shared_ptr<FftBackend> backend)
+    : rows_(rows), cols_(cols), spacing_(spacing), planes_(std::move(planes)), backend_(std::move(backend)) {
+  if (rows < 1 || cols < 1 || planes_.empty()) {
+    throw std::invalid_argument("LayeredHeatSolver: the grid and the stack must not be empty");
+  }
+  if (!(spacing > 0.0) || !std::isfinite(spacing)) {
+    throw std::invalid_argument("LayeredHeatSolver: spacing must be positive and finite");
+  }
+  for (const Plane& plane : planes_) {
+    if (!(plane.thickness > 0.0) || !std::isfinite(plane.thickness) || !(plane.conductivity > 0.0) ||
+        !std::isfinite(plane.conductivity)) {
+      throw std::invalid_argument("LayeredHeatSolver: plane thickness and conductivity must be positive and finite");
+    }
+  }
+  if (!(options.top_transfer >= 0.0) || !(options.bottom_transfer >= 0.0)) {
+    throw std::invalid_argument("LayeredHeatSolver: transfer coefficients must be non-negative");
+  }
+  if (options.top_transfer == 0.0 && options.bottom_transfer == 0.0) {
+    throw std::invalid_argument("LayeredHeatSolver: an adiabatic top and bottom leave no path to the ambient");
+  }
+
+  // Conductance of half a plane in series with a face's transfer
+  // coefficient, zero for an adiabatic face
+  const auto half = [](const Plane& plane) { return plane.thickness / (2.0 * plane.conductivity); };
+  const auto boundary = [&](const Plane& plane, double transfer) {
+    return transfer == 0.0 ? 0.0 : 1.0 / (half(plane) + 1.0 / transfer);
+  };
+  const std::size_t count = planes_.size();
+  below_.resize(count);
+  diagonal_.resize(count);
+  lateral_.resize(count);
+  for (std::size_t l = 0; l + 1 < count; ++l) {
+    below_[l] = 1.0 / (half(planes_[l]) + half(planes_[l + 1]));
+  }
+  below_[count - 1] = boundary(planes_[count - 1], options.bottom_transfer);
+  for (std::size_t l = 0; l < count; ++l) {
+    const double above = l == 0 ? boundary(planes_[0], options.top_transfer) : below_[l - 1];
+    diagonal_[l] = above + below_[l];
+    lateral_[l] = planes_[l].conductivity * planes_[l].thickness;
+  }
+
+  use_fft_ = backend_ && backend_->goodSize(2 * rows) == 2 * rows && backend_->goodSize(2 * cols) == 2 * cols;
+  if (!use_fft_) {
+    row_basis_ = cosineBasis(rows);
+    col_basis_ = cosineBasis(cols);
+  }
+}
+
+double LayeredHeatSolver::eigenvalue(int a, int b) const {
+  return (4.0 - 2.0 * std::cos(M_PI * a / rows_) - 2.0 * std::cos(M_PI * b / cols_)) / (spacing_ * spacing_);
+}
+
+std::vector<Eigen::ArrayXXd> LayeredHeatSolver::solve(const std::vector<Eigen::ArrayXXd>& source) const {
+  if (source.size() != planes_.size()) {
+    throw std::invalid_argument("LayeredHeatSolver: expected one source per plane");
+  }
+  for (const Eigen::ArrayXXd& plane : source) {
+    if (plane.size() != 0 && (plane.rows() != rows_ || plane.cols() != cols_)) {
+      throw std::invalid_argument("LayeredHeatSolver: source does not match the grid");
+    }
+  }
+  return use_fft_ ? solveFft(source) : solveDense(source);
+}
+
+std::vector<Eigen::ArrayXXd> LayeredHeatSolver::solveFft(const std::vector<Eigen::ArrayXXd>& source) const {
+  using Complex = FftBackend::Complex;
+  const int mirrored_rows = 2 * rows_;
+  const int mirrored_cols = 2 * cols_;
+  const int half_cols = cols_ + 1; // mirrored_cols / 2 + 1
+  const std::size_t modes = static_cast<std::size_t>(mirrored_rows) * half_cols;
+  const std::size_t count = planes_.size();
+
+  // Spectra of every plane, plane-major, so a mode's stack is strided by
+  // the spectrum size. The mirror image is even about both edges, which is
+  // what makes its Fourier modes the plane's zero-flux cosine modes.
+  std::vector<Complex> spectra(count * modes, Complex(0.0, 0.0));
+  std::vector<double> image(static_cast<std::size_t>(mirrored_rows) * mirrored_cols);
+  for (std::size_t l = 0; l < count; ++l) {
+    if (source[l].size() == 0) {
+      continue;
+    }
+    const double thickness = planes_[l].thickness;
+    for (int i = 0; i < mirrored_rows; ++i) {
+      const int si = i < rows_ ? i : mirrored_rows - 1 - i;
+      double* row = image.data() + static_cast<std::size_t>(i) * mirrored_cols;
+      for (int j = 0; j < mirrored_cols; ++j) {
+        row[j] = thickness * source[l](si, j < cols_ ? j : mirrored_cols - 1 - j);
+      }
+    }
+    backend_->forward(image.data(), spectra.data() + l * modes, mirrored_rows, mirrored_cols);
+  }
+
+  // One spectrum row of modes at a time
+#pragma omp parallel if (static_cast<long>(modes) >= kParallelModes)
+  {
+    std::vector<double> eigenvalues(half_cols), pivots(half_cols), factors(count * half_cols);
+#pragma omp for schedule(static)
+    for (int a = 0; a < mirrored_rows; ++a) {
+      for (int b = 0; b < half_cols; ++b) {
+        eigenvalues[b] = eigenvalue(a, b);
+      }
+      sweep(below_, diagonal_, lateral_, eigenvalues.data(), half_cols,
+            spectra.data() + static_cast<std::size_t>(a) * half_cols, modes, pivots.data(), factors.data());
+    }
+  }
+
+  std::vector<Eigen::ArrayXXd> rise(count, Eigen::ArrayXXd(rows_, cols_));
+  for (std::size_t l = 0; l < count; ++l) {
+    backend_->inverse(spectra.data() + l * modes, image.data(), mirrored_rows, mirrored_cols);
+    for (int i = 0; i < rows_; ++i) {
+      const double* row = image.data() + static_cast<std::size_t>(i) * mirrored_cols;
+      for (int j = 0; j < cols_; ++j) {
+        rise[l](i, j) = row[j];
+      }
+    }
+  }
+  return rise;
+}
+
+std::vector<Eigen::ArrayXXd> LayeredHeatSolver::solveDense(const std::vector<Eigen::ArrayXXd>& source) const {
+  const std::size_t modes = static_cast<std::size_t>(rows_) * cols_;
+  const std::size_t count = planes_.size();
+
+  // Coefficients of every plane side by side, column-major, so a mode's
+  // stack is strided by the plane size
+  Eigen::MatrixXd coefficients = Eigen::MatrixXd::Zero(rows_, cols_ * static_cast<Eigen::Index>(count));
+  for (std::size_t l = 0; l < count; ++l) {
+    if (source[l].size() != 0) {
+      coefficients.middleCols(l * cols_, cols_) =
+          row_basis_ * (planes_[l].thickness * source[l].matrix()) * col_basis_.transpose();
+    }
+  }
+
+  // One coefficient column of modes at a time
+#pragma omp parallel if (static_cast<long>(modes) >= kParallelModes)
+  {
+    std::vector<double> eigenvalues(rows_), pivots(rows_), factors(count * rows_);
+#pragma omp for schedule(static)
+    for (int b = 0; b < cols_; ++b) {
+      for (int a = 0; a < rows_; ++a) {
+        eigenvalues[a] = eigenvalue(a, b);
+      }
+      sweep(below_, diagonal_, lateral_, eigenvalues.data(), rows_,
+            coefficients.data() + static_cast<std::size_t>(b) * rows_, modes, pivots.data(), factors.data());
+    }
+  }
+
+  std::vector<Eigen::ArrayXXd> rise(count);
+  for (std::size_t l = 0; l < count; ++l) {
+    rise[l] = (row_basis_.transpose() * coefficients.middleCols(l * cols_, cols_) * col_basis_).array();
+  }
+  return rise;
+}
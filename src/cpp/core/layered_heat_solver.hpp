@@ -0,0 +1,78 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "fft.hpp"
+#include <Eigen/Dense>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Steady heat conduction, -div(k grad T) = q, through a stack of planes
+// that each have one conductivity. Every plane is a rows x cols grid of
+// cells sharing the in-plane spacing; planes are listed from the top of
+// the stack down. The sides are adiabatic, and the top and bottom faces
+// lose heat to the ambient through transfer coefficients, the bottom one
+// an isothermal sink by default. Solutions are the rise above ambient.
+//
+// The in-plane operator is the same on every plane up to its factor k dz,
+// so it is diagonalized once by a cosine transform and each in-plane mode
+// leaves a tridiagonal system through the stack, as in fast Poisson
+// solvers. Vertical faces take the series conductance of the two
+// half-planes. The cosine transform is the FFT of the plane mirrored to
+// 2 rows x 2 cols when the backend transforms that size, costing
+// O(N log N) for N cells, and otherwise a dense transform costing
+// O(N (rows + cols)). Only planes carrying heat are transformed forward.
+class LayeredHeatSolver {
+public:
+  struct Plane {
+    double thickness;    // m
+    double conductivity; // W/m/K
+  };
+
+  struct Options {
+    double top_transfer = 0.0;                                       // W/m^2/K, 0 for adiabatic
+    double bottom_transfer = std::numeric_limits<double>::infinity(); // W/m^2/K, infinite for a sink
+  };
+
+  // Throws std::invalid_argument for an empty grid or stack, a spacing,
+  // thickness or conductivity that is not positive and finite, a negative
+  // transfer coefficient, or both transfer coefficients zero, which leaves
+  // the temperature undetermined.
+  LayeredHeatSolver(int rows, int cols, double spacing, std::vector<Plane> planes, const Options& options,
+                    std::shared_ptr<FftBackend> backend = Fft::defaultBackend());
+  LayeredHeatSolver(int rows, int cols, double spacing, std::vector<Plane> planes)
+      : LayeredHeatSolver(rows, cols, spacing, std::move(planes), Options()) {}
+
+  // Rise of every plane for heat sources in W/m^3, one per plane; an empty
+  // array stands for a plane without heat. Throws std::invalid_argument
+  // for a source of the wrong count or shape.
+  std::vector<Eigen::ArrayXXd> solve(const std::vector<Eigen::ArrayXXd>& source) const;
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  const std::vector<Plane>& planes() const { return planes_; }
+  // Whether the in-plane transform goes through the FFT backend
+  bool usesFft() const { return use_fft_; }
+
+private:
+  std::vector<Eigen::ArrayXXd> solveFft(const std::vector<Eigen::ArrayXXd>& source) const;
+  std::vector<Eigen::ArrayXXd> solveDense(const std::vector<Eigen::ArrayXXd>& source) const;
+  // In-plane eigenvalue of the mode with a half-periods over the rows
+  // and b over the columns
+  double eigenvalue(int a, int b) const;
+
+  int rows_;
+  int cols_;
+  double spacing_;
+  std::vector<Plane> planes_;
+  std::shared_ptr<FftBackend> backend_;
+  bool use_fft_ = false;
+  // Stack tridiagonal without the in-plane term: conductance to the plane
+  // below (to the sink for the last one), the diagonal, and k dz scaling
+  // each plane's in-plane eigenvalue
+  std::vector<double> below_;
+  std::vector<double> diagonal_;
+  std::vector<double> lateral_;
+  Eigen::MatrixXd row_basis_; // Orthonormal cosine bases for the dense transform
+  Eigen::MatrixXd col_basis_;
+};
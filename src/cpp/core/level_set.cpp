@@ -0,0 +1,465 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "level_set.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+constexpr int kBlockVoxels = 512;
+constexpr double kCfl = 0.5; // Fraction of a cell the fastest voxel moves per step
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+constexpr int kAxis[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+
+// First-order solution of |grad T| = h given the smallest known value
+// along each axis, infinite where none is known: each further axis joins
+// while the solution so far still lies above its value
+double eikonal(double a[3], double h) {
+  std::sort(a, a + 3);
+  double t = a[0] + h;
+  for (int n = 2; n <= 3 && t > a[n - 1]; ++n) {
+    double sum = 0.0;
+    double squares = 0.0;
+    for (int m = 0; m < n; ++m) {
+      sum += a[m];
+      squares += a[m] * a[m];
+    }
+    const double discriminant = sum * sum - n * (squares - h * h);
+    if (discriminant < 0.0) {
+      break;
+    }
+    t = (sum + std::sqrt(discriminant)) / n;
+  }
+  return t;
+}
+
+} // namespace
+
+LevelSet::LevelSet(const Eigen::Ref<const Eigen::ArrayXXd>& heights, double spacing, double z_min, double z_max,
+                   int band_width)
+    : rows_(static_cast<int>(heights.rows())), cols_(static_cast<int>(heights.cols())), spacing_(spacing),
+      z_min_(z_min), band_width_(band_width) {
+  if (rows_ == 0 || cols_ == 0) {
+    throw std::invalid_argument("Level set needs a non-empty height map");
+  }
+  if (!(spacing > 0.0)) {
+    throw std::invalid_argument("Level set spacing must be positive");
+  }
+  if (!(z_max > z_min)) {
+    throw std::invalid_argument("Level set height range is empty");
+  }
+  if (band_width < 2) {
+    throw std::invalid_argument("Level set band must be at least two cells wide");
+  }
+  layers_ = static_cast<int>(std::ceil((z_max - z_min) / spacing)) + 1;
+  far_ = (band_width_ + 1) * spacing_;
+  block_rows_ = (rows_ + 7) >> 3;
+  block_cols_ = (cols_ + 7) >> 3;
+  block_layers_ = (layers_ + 7) >> 3;
+  const std::size_t block_count = static_cast<std::size_t>(block_rows_) * block_cols_ * block_layers_;
+  blocks_.resize(block_count);
+  block_sign_.resize(block_count);
+
+  // Height above the column's surface; its linear interpolation between
+  // voxels seeds the distance
+  auto above = [&](int i, int j, int k) { return z_min_ + k * spacing_ - heights(i, j); };
+  // Blocks the surface misses lie wholly on the side of their first voxel
+  for (int bi = 0; bi < block_rows_; ++bi) {
+    for (int bj = 0; bj < block_cols_; ++bj) {
+      for (int bk = 0; bk < block_layers_; ++bk) {
+        block_sign_[blockIndex(bi << 3, bj << 3, bk << 3)] = above(bi << 3, bj << 3, bk << 3) < 0.0 ? -1 : 1;
+      }
+    }
+  }
+  // The surface crosses a column only between the lowest and highest of
+  // its own and its neighbors' heights
+  std::vector<Voxel> candidates;
+  for (int i = 0; i < rows_; ++i) {
+    for (int j = 0; j < cols_; ++j) {
+      double low = heights(i, j);
+      double high = low;
+      for (const auto& axis : kAxis) {
+        const int ni = i + axis[0], nj = j + axis[1];
+        if (axis[2] == 0 && ni >= 0 && ni < rows_ && nj >= 0 && nj < cols_) {
+          low = std::min(low, heights(ni, nj));
+          high = std::max(high, heights(ni, nj));
+        }
+      }
+      const int k0 = std::max(0, static_cast<int>(std::floor((low - z_min_) / spacing_)) - 1);
+      const int k1 = std::min(layers_ - 1, static_cast<int>(std::ceil((high - z_min_) / spacing_)) + 1);
+      for (int k = k0; k <= k1; ++k) {
+        candidates.push_back({i, j, k});
+      }
+    }
+  }
+  rebuild(candidates, above);
+}
+
+double LevelSet::value(int i, int j, int k) const {
+  const std::size_t b = blockIndex(i, j, k);
+  const Block* block = blocks_[b].get();
+  return block ? block->phi[blockOffset(i, j, k)] : block_sign_[b] * far_;
+}
+
+std::size_t LevelSet::allocatedBlocks() const {
+  return std::count_if(blocks_.begin(), blocks_.end(),
+                       [](const std::unique_ptr<Block>& block) { return block != nullptr; });
+}
+
+template <typename Lookup>
+void LevelSet::rebuild(const std::vector<Voxel>& candidates, Lookup old) {
+  struct Node {
+    double t; // Unsigned distance
+    bool inside;
+    bool known;
+  };
+  auto key = [&](int i, int j, int k) { return (static_cast<std::int64_t>(i) * cols_ + j) * layers_ + k; };
+  auto inBounds = [&](int i, int j, int k) {
+    return i >= 0 && i < rows_ && j >= 0 && j < cols_ && k >= 0 && k < layers_;
+  };
+  std::unordered_map<std::int64_t, Node> nodes;
+  // Sized for the band up front, as growing it rehashes every node and
+  // halves the speed of a step
+  nodes.reserve(2 * (band_.size() + candidates.size()));
+  using Entry = std::pair<double, std::int64_t>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+
+  // Voxels beside a sign change are seeded with the distance the linear
+  // interpolation along each axis puts the surface at
+  for (const Voxel& v : candidates) {
+    const std::int64_t id = key(v.i, v.j, v.k);
+    if (nodes.count(id)) {
+      continue;
+    }
+    const double p = old(v.i, v.j, v.k);
+    const bool inside = p < 0.0;
+    double inverse = 0.0;
+    bool on_surface = false;
+    for (int axis = 0; axis < 3; ++axis) {
+      double d = kInfinity;
+      for (int s = 2 * axis; s < 2 * axis + 2; ++s) {
+        const int ni = v.i + kAxis[s][0], nj = v.j + kAxis[s][1], nk = v.k + kAxis[s][2];
+        if (!inBounds(ni, nj, nk)) {
+          continue;
+        }
+        const double q = old(ni, nj, nk);
+        if ((q < 0.0) != inside) {
+          d = std::min(d, spacing_ * p / (p - q));
+        }
+      }
+      if (d == 0.0) {
+        on_surface = true;
+      } else if (d < kInfinity) {
+        inverse += 1.0 / (d * d);
+      }
+    }
+    if (!on_surface && inverse == 0.0) {
+      continue;
+    }
+    const double t = on_surface ? 0.0 : 1.0 / std::sqrt(inverse);
+    nodes.emplace(id, Node{t, inside, true});
+    heap.push({t, id});
+  }
+
+  // Fast marching outward on each side, out to the band's width
+  const double limit = band_width_ * spacing_;
+  while (!heap.empty()) {
+    const auto [t, id] = heap.top();
+    heap.pop();
+    Node& node = nodes.find(id)->second;
+    if (t > node.t) {
+      continue; // Superseded
+    }
+    node.known = true;
+    const int i = static_cast<int>(id / (static_cast<std::int64_t>(cols_) * layers_));
+    const int j = static_cast<int>(id / layers_ % cols_);
+    const int k = static_cast<int>(id % layers_);
+    for (const auto& step : kAxis) {
+      const int ni = i + step[0], nj = j + step[1], nk = k + step[2];
+      if (!inBounds(ni, nj, nk)) {
+        continue;
+      }
+      const std::int64_t nid = key(ni, nj, nk);
+      auto it = nodes.find(nid);
+      if (it != nodes.end() && it->second.known) {
+        continue;
+      }
+      const bool inside = it != nodes.end() ? it->second.inside : old(ni, nj, nk) < 0.0;
+      if (inside != node.inside) {
+        continue;
+      }
+      double a[3] = {kInfinity, kInfinity, kInfinity};
+      for (int s = 0; s < 6; ++s) {
+        const int mi = ni + kAxis[s][0], mj = nj + kAxis[s][1], mk = nk + kAxis[s][2];
+        if (!inBounds(mi, mj, mk)) {
+          continue;
+        }
+        auto m = nodes.find(key(mi, mj, mk));
+        if (m != nodes.end() && m->second.known && m->second.inside == inside) {
+          a[s / 2] = std::min(a[s / 2], m->second.t);
+        }
+      }
+      const double tn = eikonal(a, spacing_);
+      if (tn > limit) {
+        continue;
+      }
+      if (it == nodes.end()) {
+        nodes.emplace(nid, Node{tn, inside, false});
+        heap.push({tn, nid});
+      } else if (tn < it->second.t) {
+        it->second.t = tn;
+        heap.push({tn, nid});
+      }
+    }
+  }
+
+  // The old band goes back to the far value on its side, then the new band
+  // is written, allocating the blocks it has moved into
+  std::vector<std::size_t> touched;
+  for (const Voxel& v : band_) {
+    const std::size_t b = blockIndex(v.i, v.j, v.k);
+    Block& block = *blocks_[b];
+    double& phi = block.phi[blockOffset(v.i, v.j, v.k)];
+    phi = phi < 0.0 ? -far_ : far_;
+    block.band = 0;
+    touched.push_back(b);
+  }
+  band_.clear();
+  band_.reserve(nodes.size());
+  double fill[kBlockVoxels];
+  for (const auto& [id, node] : nodes) {
+    const int i = static_cast<int>(id / (static_cast<std::int64_t>(cols_) * layers_));
+    const int j = static_cast<int>(id / layers_ % cols_);
+    const int k = static_cast<int>(id % layers_);
+    const std::size_t b = blockIndex(i, j, k);
+    if (!blocks_[b]) {
+      // Read before the block exists, as old may be this level set
+      const int i0 = i & ~7, j0 = j & ~7, k0 = k & ~7;
+      for (int di = 0; di < 8; ++di) {
+        for (int dj = 0; dj < 8; ++dj) {
+          for (int dk = 0; dk < 8; ++dk) {
+            const bool in = inBounds(i0 + di, j0 + dj, k0 + dk);
+            fill[(di << 6) | (dj << 3) | dk] = in && old(i0 + di, j0 + dj, k0 + dk) < 0.0 ? -far_ : far_;
+          }
+        }
+      }
+      blocks_[b] = std::make_unique<Block>();
+      std::copy(fill, fill + kBlockVoxels, blocks_[b]->phi);
+    }
+    Block& block = *blocks_[b];
+    block.phi[blockOffset(i, j, k)] = node.inside ? -node.t : node.t;
+    ++block.band;
+    band_.push_back({i, j, k});
+    touched.push_back(b);
+  }
+  // Blocks the band has left lie wholly on one side
+  for (std::size_t b : touched) {
+    if (blocks_[b] && blocks_[b]->band == 0) {
+      block_sign_[b] = blocks_[b]->phi[0] < 0.0 ? -1 : 1;
+      blocks_[b].reset();
+    }
+  }
+}
+
+LevelSet::Site LevelSet::site(const Voxel& v) const {
+  Site site;
+  site.i = v.i;
+  site.j = v.j;
+  site.k = v.k;
+  site.z = z_min_ + v.k * spacing_;
+  site.distance = value(v.i, v.j, v.k);
+  const Eigen::Vector3d gradient(clamped(v.i + 1, v.j, v.k) - clamped(v.i - 1, v.j, v.k),
+                                 clamped(v.i, v.j + 1, v.k) - clamped(v.i, v.j - 1, v.k),
+                                 clamped(v.i, v.j, v.k + 1) - clamped(v.i, v.j, v.k - 1));
+  const double norm = gradient.norm();
+  site.normal = norm > 0.0 ? Eigen::Vector3d(gradient / norm) : Eigen::Vector3d::UnitZ();
+  site.surface = Eigen::Vector3d(v.i - site.distance * site.normal.x() / spacing_,
+                                 v.j - site.distance * site.normal.y() / spacing_,
+                                 site.z - site.distance * site.normal.z());
+  return site;
+}
+
+std::vector<LevelSet::Site> LevelSet::surface() const {
+  std::vector<Site> sites;
+  for (const Voxel& v : band_) {
+    if (value(v.i, v.j, v.k) >= 0.0) {
+      continue;
+    }
+    for (const auto& axis : kAxis) {
+      const int ni = v.i + axis[0], nj = v.j + axis[1], nk = v.k + axis[2];
+      if (ni >= 0 && ni < rows_ && nj >= 0 && nj < cols_ && nk >= 0 && nk < layers_ && value(ni, nj, nk) >= 0.0) {
+        sites.push_back(site(v));
+        break;
+      }
+    }
+  }
+  return sites;
+}
+
+int LevelSet::advance(double time, const Velocity& velocity) {
+  auto current = [this](int i, int j, int k) { return value(i, j, k); };
+  // Per band voxel, one array each: its value, then its neighbors along
+  // -x, +x, -y, +y, -z and +z, and the two parts of its speed
+  std::vector<double> stencil;
+  std::vector<double> normal;
+  std::vector<double> vertical;
+  double remaining = time;
+  double moved = 0.0; // Since the band was last rebuilt, in um
+  int steps = 0;
+  while (remaining > 0.0) {
+    const int n = static_cast<int>(band_.size());
+    stencil.resize(7 * static_cast<std::size_t>(n));
+    normal.resize(n);
+    vertical.resize(n);
+    double max_speed = 0.0;
+#pragma omp parallel for schedule(static) reduction(max : max_speed)
+    for (int b = 0; b < n; ++b) {
+      const Speed s = velocity(site(band_[b]));
+      normal[b] = s.normal;
+      vertical[b] = s.vertical;
+      max_speed = std::max(max_speed, std::abs(s.normal) + std::abs(s.vertical));
+    }
+    if (max_speed == 0.0) {
+      break;
+    }
+    const double dt = std::min(remaining, kCfl * spacing_ / max_speed);
+
+    // The stencils are gathered from the blocks before any voxel moves, so
+    // the update below reads only contiguous arrays and writes only its own
+    // voxel: no voxel sees another's new value whatever the thread count
+#pragma omp parallel for schedule(static)
+    for (int b = 0; b < n; ++b) {
+      const Voxel& v = band_[b];
+      stencil[b] = value(v.i, v.j, v.k);
+      for (int s = 0; s < 6; ++s) {
+        const int side = s ^ 1; // kAxis lists + before -
+        stencil[(s + 1) * static_cast<std::size_t>(n) + b] =
+            clamped(v.i + kAxis[side][0], v.j + kAxis[side][1], v.k + kAxis[side][2]);
+      }
+    }
+
+    // Upwind: growth reads the differences from inside the solid, removal
+    // those from outside. Both sums are formed and one taken, so the loop
+    // has no branches to keep it from vectorizing.
+    double* phi = stencil.data();
+    const double* x_minus = phi + n;
+    const double* x_plus = phi + 2 * static_cast<std::size_t>(n);
+    const double* y_minus = phi + 3 * static_cast<std::size_t>(n);
+    const double* y_plus = phi + 4 * static_cast<std::size_t>(n);
+    const double* z_minus = phi + 5 * static_cast<std::size_t>(n);
+    const double* z_plus = phi + 6 * static_cast<std::size_t>(n);
+    const double h = spacing_;
+#pragma omp parallel for simd schedule(static)
+    for (int b = 0; b < n; ++b) {
+      const double mx = (phi[b] - x_minus[b]) / h, px = (x_plus[b] - phi[b]) / h;
+      const double my = (phi[b] - y_minus[b]) / h, py = (y_plus[b] - phi[b]) / h;
+      const double mz = (phi[b] - z_minus[b]) / h, pz = (z_plus[b] - phi[b]) / h;
+      auto square = [](double d) { return d * d; };
+      const double grow = square(std::max(mx, 0.0)) + square(std::min(px, 0.0)) + square(std::max(my, 0.0)) +
+                          square(std::min(py, 0.0)) + square(std::max(mz, 0.0)) + square(std::min(pz, 0.0));
+      const double shrink = square(std::min(mx, 0.0)) + square(std::max(px, 0.0)) + square(std::min(my, 0.0)) +
+                            square(std::max(py, 0.0)) + square(std::min(mz, 0.0)) + square(std::max(pz, 0.0));
+      const double rate = normal[b] * std::sqrt(normal[b] > 0.0 ? grow : shrink) +
+                          vertical[b] * std::max(vertical[b] > 0.0 ? mz : pz, 0.0);
+      phi[b] -= dt * rate;
+    }
+#pragma omp parallel for schedule(static)
+    for (int b = 0; b < n; ++b) {
+      const Voxel& v = band_[b];
+      blocks_[blockIndex(v.i, v.j, v.k)]->phi[blockOffset(v.i, v.j, v.k)] = phi[b];
+    }
+
+    remaining -= dt;
+    moved += max_speed * dt;
+    ++steps;
+    if (moved >= spacing_) {
+      rebuild(band_, current);
+      moved = 0.0;
+    }
+  }
+  if (moved > 0.0) {
+    rebuild(band_, current);
+  }
+  return steps;
+}
+
+Eigen::ArrayXXd LevelSet::heights() const {
+  Eigen::ArrayXXd tops = Eigen::ArrayXXd::Constant(rows_, cols_, -kInfinity);
+  for (const Voxel& v : band_) {
+    if (v.k + 1 >= layers_) {
+      continue;
+    }
+    const double p = value(v.i, v.j, v.k);
+    const double q = value(v.i, v.j, v.k + 1);
+    if (p < 0.0 && q >= 0.0) {
+      tops(v.i, v.j) = std::max(tops(v.i, v.j), z_min_ + (v.k + p / (p - q)) * spacing_);
+    }
+  }
+  for (int i = 0; i < rows_; ++i) {
+    for (int j = 0; j < cols_; ++j) {
+      if (tops(i, j) == -kInfinity) {
+        tops(i, j) = value(i, j, layers_ - 1) < 0.0 ? zMax() : zMin();
+      }
+    }
+  }
+  return tops;
+}
+
+LevelSet::Velocity LevelSet::directional(double rate, double directionality) {
+  return [rate, directionality](const Site&) { return Speed{rate * (1.0 - directionality), rate * directionality}; };
+}
+
+LevelSet LevelSet::evolveHeights(Eigen::Ref<Eigen::ArrayXXd> heights, double spacing, double time, double reach,
+                             const Velocity& velocity, const BitMask* protect) {
+  if (protect && (protect->rows() != heights.rows() || protect->cols() != heights.cols())) {
+    throw std::invalid_argument("Protect mask does not match the height map");
+  }
+  const int band_width = 3;
+  const double margin = (band_width + 2) * spacing;
+  if (!protect || protect->count() == 0) {
+    LevelSet set(heights, spacing, heights.minCoeff() - reach - margin, heights.maxCoeff() + reach + margin,
+                 band_width);
+    set.advance(time, velocity);
+    heights = set.heights();
+    return set;
+  }
+
+  // The protected cells carry a block of resist, thicker than the band,
+  // that never moves: only its top and walls and the face under it are
+  // held, so the surface below its edge stays free to undercut it. A
+  // surface point is on the resist when a set cell within a quarter cell
+  // of it reaches above it.
+  const Eigen::ArrayXXd tops = heights;
+  Eigen::ArrayXXd covered = heights;
+  protect->forEachSet([&](int i, int j) { covered(i, j) += margin; });
+  LevelSet set(covered, spacing, heights.minCoeff() - reach - margin, covered.maxCoeff() + reach + margin,
+               band_width);
+  const int last_row = static_cast<int>(heights.rows()) - 1;
+  const int last_col = static_cast<int>(heights.cols()) - 1;
+  set.advance(time, [&](const Site& site) {
+    const int i0 = std::clamp(static_cast<int>(std::lround(site.surface.x() - 0.25)), 0, last_row);
+    const int j0 = std::clamp(static_cast<int>(std::lround(site.surface.y() - 0.25)), 0, last_col);
+    const int i1 = std::clamp(static_cast<int>(std::lround(site.surface.x() + 0.25)), 0, last_row);
+    const int j1 = std::clamp(static_cast<int>(std::lround(site.surface.y() + 0.25)), 0, last_col);
+    for (const auto& [i, j] : {std::pair{i0, j0}, std::pair{i0, j1}, std::pair{i1, j0}, std::pair{i1, j1}}) {
+      if (protect->test(i, j) && site.surface.z() > tops(i, j) - 0.5 * spacing) {
+        return Speed{};
+      }
+    }
+    return velocity(site);
+  });
+  // Protected cells keep their height; what moved elsewhere is read back
+  const Eigen::ArrayXXd moved = set.heights();
+  for (int i = 0; i <= last_row; ++i) {
+    for (int j = 0; j <= last_col; ++j) {
+      heights(i, j) = protect->test(i, j) ? tops(i, j) : moved(i, j);
+    }
+  }
+  return set;
+}
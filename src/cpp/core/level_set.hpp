@@ -0,0 +1,120 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "bit_mask.hpp"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Signed distance to the surface of a solid on a voxel grid, kept only in
+// a narrow band around the surface, for etch and deposition profiles.
+//
+// Voxel (i, j, k) sits at row i and column j of the wafer grid, at height
+// zMin() + k * spacing(); the distance is negative inside the solid.
+// Values live in 8^3 blocks allocated only where the band passes, and
+// every other block is wholly inside or outside, so memory and the work of
+// each step follow the surface's area rather than the volume. The surface
+// moves by first-order upwind steps of phi_t + V |grad phi| + W phi_z = 0,
+// with W only on faces looking up, and the band is rebuilt by fast marching from
+// the surface each time it has moved a cell.
+class LevelSet {
+public:
+  // A band voxel the velocity is evaluated at
+  struct Site {
+    int i, j, k;
+    double z;
+    double distance;        // Signed, um
+    Eigen::Vector3d normal; // Unit, out of the solid; +z is up
+    // Nearest surface point as (row, col) in cells and z in um. Speeds
+    // that depend on position should read it rather than the voxel, so
+    // each voxel near the surface moves as the surface point it tracks.
+    Eigen::Vector3d surface;
+  };
+  // Surface speed at a site in um per unit time, positive where the solid
+  // grows: normal moves the surface along its normal, vertical moves the
+  // faces that look up by that much straight up or down, as a flux
+  // arriving from directly above does. Either may be zero.
+  struct Speed {
+    double normal = 0.0;
+    double vertical = 0.0;
+  };
+  // Called from several threads at once
+  using Velocity = std::function<Speed(const Site&)>;
+
+  // Solid below heights(i, j) in every column, over [z_min, z_max].
+  // Throws std::invalid_argument for an empty grid, a spacing that is not
+  // positive, an empty height range or a band under two cells.
+  LevelSet(const Eigen::Ref<const Eigen::ArrayXXd>& heights, double spacing, double z_min, double z_max,
+           int band_width = 3);
+
+  // Moves the surface under velocity for time; returns the steps taken
+  int advance(double time, const Velocity& velocity);
+
+  // Topmost surface crossing of each column; columns that are all solid
+  // or all empty give zMax() or zMin()
+  Eigen::ArrayXXd heights() const;
+  // Signed distance, or +-(band width + 1) cells away from the band
+  double value(int i, int j, int k) const;
+  // The surface as the sites of the solid voxels with a face on the
+  // outside, one per voxel it passes through
+  std::vector<Site> surface() const;
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  int layers() const { return layers_; }
+  double spacing() const { return spacing_; }
+  double zMin() const { return z_min_; }
+  double zMax() const { return z_min_ + (layers_ - 1) * spacing_; }
+  std::size_t bandSize() const { return band_.size(); }
+  std::size_t allocatedBlocks() const;
+
+  // A flux arriving at rate (negative to remove material), a
+  // directionality fraction of it straight down and the rest evenly from
+  // every direction
+  static Velocity directional(double rate, double directionality);
+
+  // Evolves a height map in place for time, returning the level set for
+  // what the heights cannot show, such as undercuts. reach (>= 0) bounds
+  // how far the surface can move, to size the voxel columns. Set cells of
+  // protect, when given, keep their height under a block of resist that
+  // never moves, so only the profile below its edges evolves.
+  static LevelSet evolveHeights(Eigen::Ref<Eigen::ArrayXXd> heights, double spacing, double time, double reach,
+                            const Velocity& velocity, const BitMask* protect = nullptr);
+
+private:
+  struct Voxel {
+    int i, j, k;
+  };
+  struct Block {
+    double phi[512];
+    int band = 0; // Band voxels in the block
+  };
+
+  template <typename Lookup>
+  void rebuild(const std::vector<Voxel>& candidates, Lookup old);
+  std::size_t blockIndex(int i, int j, int k) const {
+    return (static_cast<std::size_t>(i >> 3) * block_cols_ + (j >> 3)) * block_layers_ + (k >> 3);
+  }
+  static int blockOffset(int i, int j, int k) { return ((i & 7) << 6) | ((j & 7) << 3) | (k & 7); }
+  // value() with the indices clamped to the grid
+  double clamped(int i, int j, int k) const {
+    return value(std::clamp(i, 0, rows_ - 1), std::clamp(j, 0, cols_ - 1), std::clamp(k, 0, layers_ - 1));
+  }
+  Site site(const Voxel& v) const;
+
+  int rows_ = 0;
+  int cols_ = 0;
+  int layers_ = 0;
+  double spacing_ = 0.0;
+  double z_min_ = 0.0;
+  int band_width_ = 0;
+  double far_ = 0.0; // Magnitude of every value off the band
+  int block_rows_ = 0;
+  int block_cols_ = 0;
+  int block_layers_ = 0;
+  std::vector<std::unique_ptr<Block>> blocks_;
+  std::vector<signed char> block_sign_; // Of a block left unallocated: -1 inside, +1 outside
+  std::vector<Voxel> band_;
+};
@@ -0,0 +1,230 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "log_ring.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace SemiPRO {
+
+namespace {
+
+constexpr std::size_t kRingCapacity = 8192;
+
+void appendArg(std::string& out, const LogRecord& record, const LogRecord::Arg& arg) {
+    using Kind = LogRecord::Arg::Kind;
+    char buffer[32];
+    std::to_chars_result converted{buffer, std::errc()};
+    switch (arg.kind) {
+    case Kind::None: return;
+    case Kind::Int: converted = std::to_chars(buffer, buffer + sizeof(buffer), arg.i); break;
+    case Kind::Unsigned: converted = std::to_chars(buffer, buffer + sizeof(buffer), arg.u); break;
+    case Kind::Double: converted = std::to_chars(buffer, buffer + sizeof(buffer), arg.d); break;
+    case Kind::Bool: out += arg.b ? "true" : "false"; return;
+    case Kind::Text:
+    case Kind::Literal: out += record.textOf(arg); return;
+    }
+    out.append(buffer, converted.ptr);
+}
+
+} // namespace
+
+const char* logLevelName(LogLevel level) {
+    static const char* const names[] = {"TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "CRITICAL", "FATAL"};
+    const int index = static_cast<int>(level);
+    return index >= 0 && index < 7 ? names[index] : "UNKNOWN";
+}
+
+void LogRecord::begin(LogLevel record_level, LogCategory record_category, const char* record_format) {
+    format = record_format ? record_format : "";
+    level = record_level;
+    category = record_category;
+    timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+    thread = std::this_thread::get_id();
+    module = Arg();
+    function = Arg();
+    file = Arg();
+    line = 0;
+    arg_count = 0;
+    text_used = 0;
+}
+
+LogRecord::Arg LogRecord::copyText(std::string_view value) {
+    Arg arg;
+    arg.kind = Arg::Kind::Text;
+    const std::size_t length = std::min(value.size(), kTextBytes - text_used);
+    std::memcpy(text + text_used, value.data(), length);
+    arg.offset = static_cast<std::uint16_t>(text_used);
+    arg.length = static_cast<std::uint16_t>(length);
+    text_used += length;
+    return arg;
+}
+
+LogRecord::Arg LogRecord::literalText(const char* value) {
+    Arg arg;
+    if (value) {
+        arg.kind = Arg::Kind::Literal;
+        arg.literal = value;
+    }
+    return arg;
+}
+
+std::string_view LogRecord::textOf(const Arg& arg) const {
+    if (arg.kind == Arg::Kind::Text) {
+        return std::string_view(text + arg.offset, arg.length);
+    }
+    if (arg.kind == Arg::Kind::Literal) {
+        return arg.literal;
+    }
+    return {};
+}
+
+std::string LogRecord::message() const {
+    std::string out;
+    out.reserve(std::strlen(format) + text_used + 16 * arg_count);
+    int next = 0;
+    for (const char* c = format; *c; ++c) {
+        if (c[0] == '{' && c[1] == '}' && next < arg_count) {
+            appendArg(out, *this, args[next++]);
+            ++c;
+        } else {
+            out += *c;
+        }
+    }
+    return out;
+}
+
+LogRing::LogRing(std::size_t capacity) {
+    std::size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    slots_.reset(new Slot[size]);
+    mask_ = size - 1;
+    for (std::size_t i = 0; i < size; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+LogRecord* LogRing::claim(std::uint64_t& position) {
+    std::uint64_t head = head_.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = slots_[head & mask_];
+        const std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == head) {
+            if (head_.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+                position = head;
+                return &slot.record;
+            }
+        } else if (sequence < head) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            head = head_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void LogRing::publish(std::uint64_t position) {
+    slots_[position & mask_].sequence.store(position + 1, std::memory_order_release);
+}
+
+LogDispatcher& LogDispatcher::getInstance() {
+    static LogDispatcher* instance = new LogDispatcher();
+    return *instance;
+}
+
+LogDispatcher::LogDispatcher() : ring_(kRingCapacity), thread_(&LogDispatcher::run, this) {
+    std::atexit([] { getInstance().stop(); });
+}
+
+void LogDispatcher::stop() {
+    stopping_.store(true);
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_.notify_one();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    stopped_.store(true, std::memory_order_release);
+    drainToSinks();
+}
+
+int LogDispatcher::addSink(Sink sink, std::function<void()> flush) {
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    const int id = next_sink_++;
+    sinks_.push_back({id, std::move(sink), std::move(flush)});
+    return id;
+}
+
+void LogDispatcher::removeSink(int id) {
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    sinks_.erase(std::remove_if(sinks_.begin(), sinks_.end(), [id](const SinkEntry& sink) { return sink.id == id; }),
+                 sinks_.end());
+}
+
+void LogDispatcher::publish(std::uint64_t position) {
+    ring_.publish(position);
+    if (stopped_.load(std::memory_order_acquire)) {
+        drainToSinks();
+        return;
+    }
+    // The dispatcher also polls, so a wakeup lost to this unlocked check
+    // only delays the record
+    if (idle_.load(std::memory_order_acquire)) {
+        wake_.notify_one();
+    }
+}
+
+void LogDispatcher::flush() {
+    const std::uint64_t target = ring_.claimed();
+    while (ring_.consumed() < target) {
+        if (stopped_.load(std::memory_order_acquire)) {
+            drainToSinks();
+            return;
+        }
+        wake_.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+// Whoever holds sinks_mutex_ is the ring's one consumer
+std::size_t LogDispatcher::drainToSinks() {
+    std::lock_guard<std::mutex> lock(sinks_mutex_);
+    const std::size_t taken = ring_.drain([this](const LogRecord& record) {
+        const std::string message = record.message();
+        for (auto& sink : sinks_) {
+            sink.write(record, message);
+        }
+    });
+    if (taken > 0) {
+        for (auto& sink : sinks_) {
+            if (sink.flush) {
+                sink.flush();
+            }
+        }
+    }
+    return taken;
+}
+
+void LogDispatcher::run() {
+    for (;;) {
+        const bool stopping = stopping_.load();
+        if (drainToSinks() > 0) {
+            continue;
+        }
+        if (stopping) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        idle_.store(true, std::memory_order_release);
+        wake_.wait_for(lock, std::chrono::milliseconds(10));
+        idle_.store(false, std::memory_order_release);
+    }
+}
+
+} // namespace SemiPRO
@@ -0,0 +1,281 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Calls below this level (0 = TRACE ... 6 = FATAL) are compiled out by
+// SEMIPRO_LOGF, arguments included
+#ifndef SEMIPRO_COMPILED_LOG_LEVEL
+#define SEMIPRO_COMPILED_LOG_LEVEL 0
+#endif
+
+namespace SemiPRO {
+
+// Log levels (compatible with ErrorSeverity)
+enum class LogLevel {
+    TRACE = 0,
+    DEBUG = 1,
+    INFO = 2,
+    WARNING = 3,
+    ERROR = 4,
+    CRITICAL = 5,
+    FATAL = 6
+};
+
+// Log categories for better organization
+enum class LogCategory {
+    GENERAL,
+    PHYSICS,
+    PERFORMANCE,
+    SYSTEM,
+    SIMULATION,
+    VALIDATION,
+    NETWORK,
+    USER_INTERFACE,
+    MEMORY,
+    THREADING,
+    ADVANCED
+};
+
+const char* logLevelName(LogLevel level);
+
+// One log call as the caller left it: a format string literal and the raw
+// arguments, formatted later on the dispatcher thread. Strings are copied
+// into the record's own buffer (truncated when it is full), so filling a
+// record never allocates.
+struct LogRecord {
+    struct Arg {
+        enum class Kind : std::uint8_t { None, Int, Unsigned, Double, Bool, Text, Literal };
+        Kind kind = Kind::None;
+        std::uint16_t offset = 0; // Text: bytes in LogRecord::text
+        std::uint16_t length = 0;
+        union {
+            std::int64_t i;
+            std::uint64_t u;
+            double d;
+            bool b;
+            const char* literal; // Static storage, never copied
+        };
+        Arg() : u(0) {}
+    };
+
+    static constexpr int kMaxArgs = 8;
+    static constexpr std::size_t kTextBytes = 320;
+
+    const char* format = "";       // "{}" marks each argument in turn
+    LogLevel level = LogLevel::INFO;
+    LogCategory category = LogCategory::GENERAL;
+    std::int64_t timestamp_us = 0; // System clock
+    std::thread::id thread;
+    Arg module;
+    Arg function;
+    Arg file;
+    int line = 0;
+    int arg_count = 0;
+    std::size_t text_used = 0;
+    Arg args[kMaxArgs];
+    char text[kTextBytes];
+
+    // Clears the arguments and stamps the time and calling thread
+    void begin(LogLevel record_level, LogCategory record_category, const char* record_format);
+
+    Arg copyText(std::string_view value);
+    static Arg literalText(const char* value);
+
+    template <typename T>
+    void add(const T& value) {
+        if (arg_count == kMaxArgs) {
+            return;
+        }
+        using U = std::decay_t<T>;
+        Arg arg;
+        if constexpr (std::is_same_v<U, bool>) {
+            arg.kind = Arg::Kind::Bool;
+            arg.b = value;
+        } else if constexpr (std::is_enum_v<U>) {
+            arg.kind = Arg::Kind::Int;
+            arg.i = static_cast<std::int64_t>(value);
+        } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+            arg.kind = Arg::Kind::Int;
+            arg.i = value;
+        } else if constexpr (std::is_integral_v<U>) {
+            arg.kind = Arg::Kind::Unsigned;
+            arg.u = value;
+        } else if constexpr (std::is_floating_point_v<U>) {
+            arg.kind = Arg::Kind::Double;
+            arg.d = static_cast<double>(value);
+        } else if constexpr (std::is_pointer_v<U>) {
+            static_assert(std::is_convertible_v<U, const char*>, "Unsupported log argument type");
+            arg = copyText(value ? std::string_view(value) : std::string_view("(null)"));
+        } else {
+            static_assert(std::is_convertible_v<const U&, std::string_view>, "Unsupported log argument type");
+            arg = copyText(std::string_view(value));
+        }
+        args[arg_count++] = arg;
+    }
+
+    std::string_view textOf(const Arg& arg) const;
+    // The format with its "{}" markers replaced by the arguments
+    std::string message() const;
+};
+
+// Bounded lock-free multi-producer, single-consumer queue of log records.
+// A producer claims a slot with one compare-and-swap, fills the record in
+// place and publishes it; the consumer takes records in claim order. When
+// the ring is full the record is dropped and counted rather than blocking
+// the caller.
+class LogRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit LogRing(std::size_t capacity);
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    // nullptr when the ring is full
+    LogRecord* claim(std::uint64_t& position);
+    void publish(std::uint64_t position);
+
+    // Consumer only: passes each published record to consume in order and
+    // returns how many it took
+    template <typename F>
+    std::size_t drain(F&& consume) {
+        std::size_t taken = 0;
+        for (;;) {
+            Slot& slot = slots_[tail_ & mask_];
+            if (slot.sequence.load(std::memory_order_acquire) != tail_ + 1) {
+                return taken;
+            }
+            consume(slot.record);
+            slot.sequence.store(tail_ + mask_ + 1, std::memory_order_release);
+            ++tail_;
+            ++taken;
+            consumed_.store(tail_, std::memory_order_release);
+        }
+    }
+
+    std::uint64_t claimed() const { return head_.load(std::memory_order_acquire); }
+    std::uint64_t consumed() const { return consumed_.load(std::memory_order_acquire); }
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> sequence;
+        LogRecord record;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    std::size_t mask_;
+    alignas(64) std::atomic<std::uint64_t> head_{0};
+    alignas(64) std::uint64_t tail_ = 0;
+    std::atomic<std::uint64_t> consumed_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+};
+
+// The process-wide log ring and the thread that formats its records and
+// hands them to the registered sinks. Every logging front end (Logger,
+// AdvancedLogger, SEMIPRO_LOGF) publishes here, so a call costs a slot
+// claim and a few copies on the calling thread; timestamps, thread ids and
+// message text are formatted on the dispatcher thread.
+class LogDispatcher {
+public:
+    using Sink = std::function<void(const LogRecord& record, const std::string& message)>;
+
+    // Never destroyed, so loggers stay usable from static destructors. At
+    // exit the thread writes out what is queued and stops; records
+    // published after that are written by the publishing thread.
+    static LogDispatcher& getInstance();
+    LogDispatcher(const LogDispatcher&) = delete;
+    LogDispatcher& operator=(const LogDispatcher&) = delete;
+
+    // Sinks run on the dispatcher thread, one record at a time; flush, if
+    // given, runs whenever the ring has been emptied. Once removeSink
+    // returns neither is called again.
+    int addSink(Sink sink, std::function<void()> flush = {});
+    void removeSink(int id);
+
+    LogRecord* claim(std::uint64_t& position) { return ring_.claim(position); }
+    void publish(std::uint64_t position);
+
+    // Returns once every record published before the call reached the sinks
+    void flush();
+    std::uint64_t droppedRecords() const { return ring_.dropped(); }
+
+private:
+    LogDispatcher();
+    void run();
+    void stop();
+    std::size_t drainToSinks();
+
+    LogRing ring_;
+    std::mutex sinks_mutex_;
+    struct SinkEntry {
+        int id;
+        Sink write;
+        std::function<void()> flush;
+    };
+    std::vector<SinkEntry> sinks_;
+    int next_sink_ = 0;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> idle_{false};
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> stopped_{false};
+    std::thread thread_;
+};
+
+namespace detail {
+inline std::atomic<int> runtime_log_level{static_cast<int>(LogLevel::INFO)};
+} // namespace detail
+
+// The runtime threshold shared by every front end
+inline void setLogLevel(LogLevel level) {
+    detail::runtime_log_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+inline bool logEnabled(LogLevel level) {
+    return static_cast<int>(level) >= detail::runtime_log_level.load(std::memory_order_relaxed);
+}
+
+template <typename... Args>
+void logDeferred(LogLevel level, LogCategory category, const char* function, const char* file, int line,
+                 const char* format, const Args&... args) {
+    static_assert(sizeof...(Args) <= LogRecord::kMaxArgs, "Too many log arguments");
+    LogDispatcher& dispatcher = LogDispatcher::getInstance();
+    std::uint64_t position = 0;
+    LogRecord* record = dispatcher.claim(position);
+    if (!record) {
+        return;
+    }
+    record->begin(level, category, format);
+    record->function = LogRecord::literalText(function);
+    record->file = LogRecord::literalText(file);
+    record->line = line;
+    (record->add(args), ...);
+    dispatcher.publish(position);
+}
+
+} // namespace SemiPRO
+
+// SEMIPRO_LOGF(INFO, PHYSICS, "Etched {} um in {} s", depth, time): the
+// arguments are only evaluated when the level passes both the compiled and
+// the runtime threshold, and are formatted off the calling thread.
+#define SEMIPRO_LOGF(level, category, ...)                                                                    \
+    do {                                                                                                     \
+        if constexpr (static_cast<int>(::SemiPRO::LogLevel::level) >= SEMIPRO_COMPILED_LOG_LEVEL) {          \
+            if (::SemiPRO::logEnabled(::SemiPRO::LogLevel::level)) {                                         \
+                ::SemiPRO::logDeferred(::SemiPRO::LogLevel::level, ::SemiPRO::LogCategory::category, __func__, \
+                                       __FILE__, __LINE__, __VA_ARGS__);                                     \
+            }                                                                                                \
+        }                                                                                                    \
+    } while (0)
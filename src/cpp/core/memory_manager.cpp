@@ -1,20 +1,184 @@
 #include "memory_manager.hpp"
+#include "telemetry.hpp"
 #include <algorithm>
 #include <cstdlib>
+#include <cstdint>
 #include <cstring>
+#include <new>
 #include <iostream>
 
 namespace SemiPRO {
 
+MemoryStats::~MemoryStats() {
+    for (auto& shard : shards_) {
+        for (auto& block : shard.context_blocks) {
+            delete[] block.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t MemoryStats::shardIndex() {
+    // Threads take shards round-robin, so up to SHARD_COUNT threads never
+    // share a cache line
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t index = next_shard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+    return index;
+}
+
+std::atomic<long long>& MemoryStats::contextCounter(Shard& shard, MemoryContextId context) {
+    if (context >= MAX_CONTEXTS) {
+        context = 0;
+    }
+    auto& slot = shard.context_blocks[context / CONTEXT_BLOCK];
+    std::atomic<long long>* block = slot.load(std::memory_order_acquire);
+    if (!block) {
+        // Threads sharing a shard may race to install the block
+        auto* fresh = new std::atomic<long long>[CONTEXT_BLOCK]();
+        if (slot.compare_exchange_strong(block, fresh, std::memory_order_acq_rel)) {
+            block = fresh;
+        } else {
+            delete[] fresh;
+        }
+    }
+    return block[context % CONTEXT_BLOCK];
+}
+
+void MemoryStats::recordAllocation(size_t size, MemoryContextId context) {
+    Shard& shard = shards_[shardIndex()];
+    shard.allocated.fetch_add(size, std::memory_order_relaxed);
+    shard.allocations.fetch_add(1, std::memory_order_relaxed);
+    contextCounter(shard, context).fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    if (shard.unsampled.fetch_add(size, std::memory_order_relaxed) + size >= PEAK_SAMPLE_BYTES) {
+        shard.unsampled.store(0, std::memory_order_relaxed);
+        samplePeak();
+    }
+}
+
+void MemoryStats::recordDeallocation(size_t size, MemoryContextId context) {
+    Shard& shard = shards_[shardIndex()];
+    shard.deallocated.fetch_add(size, std::memory_order_relaxed);
+    shard.deallocations.fetch_add(1, std::memory_order_relaxed);
+    contextCounter(shard, context).fetch_sub(static_cast<long long>(size), std::memory_order_relaxed);
+}
+
+size_t MemoryStats::getCurrentUsage() const {
+    // Shards are read one at a time, so a free seen before its allocation
+    // can make the sum transiently negative
+    long long usage = 0;
+    for (const auto& shard : shards_) {
+        usage += static_cast<long long>(shard.allocated.load(std::memory_order_relaxed)) -
+                 static_cast<long long>(shard.deallocated.load(std::memory_order_relaxed));
+    }
+    return usage > 0 ? static_cast<size_t>(usage) : 0;
+}
+
+void MemoryStats::samplePeak() const {
+    size_t usage = getCurrentUsage();
+    size_t peak = peak_usage_.load(std::memory_order_relaxed);
+    while (usage > peak && !peak_usage_.compare_exchange_weak(peak, usage, std::memory_order_relaxed)) {
+    }
+}
+
+size_t MemoryStats::getPeakUsage() const {
+    samplePeak();
+    return peak_usage_.load(std::memory_order_relaxed);
+}
+
+size_t MemoryStats::getTotalAllocated() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.allocated.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t MemoryStats::getTotalDeallocated() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.deallocated.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t MemoryStats::getAllocationCount() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.allocations.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t MemoryStats::getDeallocationCount() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.deallocations.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+long long MemoryStats::getContextUsage(MemoryContextId context) const {
+    if (context >= MAX_CONTEXTS) {
+        return 0;
+    }
+    long long total = 0;
+    for (const auto& shard : shards_) {
+        const auto* block = shard.context_blocks[context / CONTEXT_BLOCK].load(std::memory_order_acquire);
+        if (block) {
+            total += block[context % CONTEXT_BLOCK].load(std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+void MemoryStats::reset() {
+    for (auto& shard : shards_) {
+        shard.allocated.store(0, std::memory_order_relaxed);
+        shard.deallocated.store(0, std::memory_order_relaxed);
+        shard.allocations.store(0, std::memory_order_relaxed);
+        shard.deallocations.store(0, std::memory_order_relaxed);
+        shard.unsampled.store(0, std::memory_order_relaxed);
+        for (auto& slot : shard.context_blocks) {
+            if (auto* block = slot.load(std::memory_order_acquire)) {
+                for (size_t i = 0; i < CONTEXT_BLOCK; ++i) {
+                    block[i].store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+    peak_usage_.store(0, std::memory_order_relaxed);
+}
+
+void MemoryStats::resetPeakUsage() {
+    peak_usage_.store(getCurrentUsage(), std::memory_order_relaxed);
+}
+
 MemoryManager::MemoryManager() {
     // Initialize monitoring thread
     monitor_thread_ = std::thread(&MemoryManager::monitoringThread, this);
+
+    auto& metrics = MetricsRegistry::getInstance();
+    metrics.gaugeCallback("semipro_memory_tracked_bytes", "Bytes currently tracked by the memory manager",
+                          [this] { return static_cast<double>(getCurrentUsage()); });
+    metrics.gaugeCallback("semipro_memory_peak_bytes", "Peak tracked bytes since the last reset",
+                          [this] { return static_cast<double>(getPeakUsage()); });
+    metrics.gaugeCallback("semipro_memory_limit_bytes", "Memory limit, 0 when unlimited",
+                          [this] { return static_cast<double>(getMemoryLimit()); });
+    metrics.gaugeCallback("semipro_memory_pressure_ratio", "Tracked bytes over the limit, 0 when unlimited",
+                          [this] {
+                              const size_t limit = getMemoryLimit();
+                              return limit > 0 ? static_cast<double>(getCurrentUsage()) / limit : 0.0;
+                          });
     
     SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::MEMORY,
                       "Enhanced Memory Manager initialized", "MemoryManager");
 }
 
 MemoryManager::~MemoryManager() {
+    auto& metrics = MetricsRegistry::getInstance();
+    for (const char* name : {"semipro_memory_tracked_bytes", "semipro_memory_peak_bytes",
+                             "semipro_memory_limit_bytes", "semipro_memory_pressure_ratio"}) {
+        metrics.removeGaugeCallback(name);
+    }
     monitoring_enabled_ = false;
     monitor_cv_.notify_all();
     
@@ -35,13 +199,18 @@ MemoryManager& MemoryManager::getInstance() {
 }
 
 void* MemoryManager::allocate(size_t size, size_t alignment, const std::string& context) {
+    if (memory_limit_ > 0 && stats_.getCurrentUsage() + size > memory_limit_) {
+        relieveMemoryPressure(size);
+    }
     std::lock_guard<std::mutex> lock(mutex_);
     
+    const MemoryContextId context_id = internContext(context);
+
     // Check memory limit
-    if (memory_limit_ > 0 && stats_.current_usage + size > memory_limit_) {
+    if (memory_limit_ > 0 && stats_.getCurrentUsage() + size > memory_limit_) {
         if (auto_cleanup_enabled_) {
             performGarbageCollection();
-            if (stats_.current_usage + size > memory_limit_) {
+            if (stats_.getCurrentUsage() + size > memory_limit_) {
                 SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::MEMORY,
                                   "Memory allocation failed: limit exceeded", "MemoryManager");
                 return nullptr;
@@ -83,16 +252,10 @@ void* MemoryManager::allocate(size_t size, size_t alignment, const std::string&
     }
     
     // Update statistics
-    stats_.total_allocated += size;
-    stats_.current_usage += size;
-    stats_.allocation_count++;
-    
-    if (stats_.current_usage > stats_.peak_usage) {
-        stats_.peak_usage = stats_.current_usage.load();
-    }
+    stats_.recordAllocation(size, context_id);
     
     // Track allocation
-    allocations_[ptr] = AllocationInfo(size, context);
+    allocations_[ptr] = AllocationInfo(size, context_id);
     
     SEMIPRO_LOG_MODULE(LogLevel::TRACE, LogCategory::MEMORY,
                       "Allocated " + std::to_string(size) + " bytes for: " + context,
@@ -115,7 +278,7 @@ void MemoryManager::deallocate(void* ptr) {
     }
     
     size_t size = alloc_it->second.size;
-    std::string context = alloc_it->second.context;
+    MemoryContextId context_id = alloc_it->second.context_id;
     
     // Find and mark block as free
     for (auto& block : memory_blocks_) {
@@ -127,40 +290,61 @@ void MemoryManager::deallocate(void* ptr) {
     }
     
     // Update statistics
-    stats_.total_deallocated += size;
-    stats_.current_usage -= size;
-    stats_.deallocation_count++;
+    stats_.recordDeallocation(size, context_id);
     
     // Remove from tracking
     allocations_.erase(alloc_it);
     
     SEMIPRO_LOG_MODULE(LogLevel::TRACE, LogCategory::MEMORY,
-                      "Deallocated " + std::to_string(size) + " bytes from: " + context,
+                      "Deallocated " + std::to_string(size) + " bytes from: " + contextName(context_id),
                       "MemoryManager");
 }
 
-void MemoryManager::trackAllocation(size_t size, const std::string& context) {
-    stats_.total_allocated += size;
-    stats_.current_usage += size;
-    stats_.allocation_count++;
-    
-    if (stats_.current_usage > stats_.peak_usage) {
-        stats_.peak_usage = stats_.current_usage.load();
+MemoryContextId MemoryManager::internContext(const std::string& name) {
+    if (name.empty()) {
+        return 0;
     }
-    
-    SEMIPRO_LOG_MODULE(LogLevel::TRACE, LogCategory::MEMORY,
-                      "Tracked allocation: " + std::to_string(size) + " bytes for: " + context,
-                      "MemoryManager");
+    // Each thread caches the ids it has seen, so only a thread's first use
+    // of a name takes the registry lock
+    thread_local std::unordered_map<std::string, MemoryContextId> cache;
+    auto cached = cache.find(name);
+    if (cached != cache.end()) {
+        return cached->second;
+    }
+
+    std::lock_guard<std::mutex> lock(context_mutex_);
+    auto it = context_ids_.find(name);
+    if (it == context_ids_.end()) {
+        if (context_names_.size() >= MemoryStats::MAX_CONTEXTS) {
+            return 0;
+        }
+        auto id = static_cast<MemoryContextId>(context_names_.size());
+        context_names_.push_back(name);
+        it = context_ids_.emplace(name, id).first;
+    }
+    cache.emplace(name, it->second);
+    return it->second;
+}
+
+std::string MemoryManager::contextName(MemoryContextId context) const {
+    std::lock_guard<std::mutex> lock(context_mutex_);
+    return context < context_names_.size() ? context_names_[context] : std::string();
+}
+
+void MemoryManager::trackAllocation(size_t size, MemoryContextId context) {
+    stats_.recordAllocation(size, context);
+}
+
+void MemoryManager::trackDeallocation(size_t size, MemoryContextId context) {
+    stats_.recordDeallocation(size, context);
+}
+
+void MemoryManager::trackAllocation(size_t size, const std::string& context) {
+    stats_.recordAllocation(size, internContext(context));
 }
 
 void MemoryManager::trackDeallocation(size_t size, const std::string& context) {
-    stats_.total_deallocated += size;
-    stats_.current_usage -= size;
-    stats_.deallocation_count++;
-    
-    SEMIPRO_LOG_MODULE(LogLevel::TRACE, LogCategory::MEMORY,
-                      "Tracked deallocation: " + std::to_string(size) + " bytes from: " + context,
-                      "MemoryManager");
+    stats_.recordDeallocation(size, internContext(context));
 }
 
 std::vector<AllocationInfo> MemoryManager::getAllocations() const {
@@ -169,6 +353,7 @@ std::vector<AllocationInfo> MemoryManager::getAllocations() const {
     
     for (const auto& [ptr, info] : allocations_) {
         result.push_back(info);
+        result.back().context = contextName(info.context_id);
     }
     
     return result;
@@ -180,11 +365,19 @@ size_t MemoryManager::getActiveAllocations() const {
 }
 
 std::unordered_map<std::string, size_t> MemoryManager::getMemoryByContext() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(context_mutex_);
+        names = context_names_;
+    }
+
+    // Covers both pool allocations and externally tracked memory
     std::unordered_map<std::string, size_t> result;
-    
-    for (const auto& [ptr, info] : allocations_) {
-        result[info.context] += info.size;
+    for (size_t id = 0; id < names.size(); ++id) {
+        long long usage = stats_.getContextUsage(static_cast<MemoryContextId>(id));
+        if (usage > 0) {
+            result[names[id]] += static_cast<size_t>(usage);
+        }
     }
     
     return result;
@@ -265,20 +458,19 @@ void MemoryManager::optimizeMemoryUsage() {
                       "Optimizing memory usage", "MemoryManager");
     
     performGarbageCollection();
-    
-    // Additional optimization logic
+    relieveMemoryPressure();
     
     SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::MEMORY,
                       "Memory optimization complete", "MemoryManager");
 }
 
 bool MemoryManager::isMemoryLimitExceeded() const {
-    return memory_limit_ > 0 && stats_.current_usage > memory_limit_;
+    return memory_limit_ > 0 && stats_.getCurrentUsage() > memory_limit_;
 }
 
 bool MemoryManager::isMemoryWarningTriggered() const {
     return memory_limit_ > 0 && 
-           stats_.current_usage > static_cast<size_t>(memory_limit_ * warning_threshold_);
+           stats_.getCurrentUsage() > static_cast<size_t>(memory_limit_ * warning_threshold_);
 }
 
 void MemoryManager::emergencyCleanup() {
@@ -286,6 +478,7 @@ void MemoryManager::emergencyCleanup() {
                       "Emergency memory cleanup initiated", "MemoryManager");
     
     performGarbageCollection();
+    relieveMemoryPressure();
     
     if (isMemoryLimitExceeded()) {
         SEMIPRO_LOG_MODULE(LogLevel::CRITICAL, LogCategory::MEMORY,
@@ -293,6 +486,129 @@ void MemoryManager::emergencyCleanup() {
     }
 }
 
+size_t MemoryManager::addPressureHandler(PressureHandler handler) {
+    std::lock_guard<std::mutex> lock(pressure_mutex_);
+    pressure_handlers_.emplace_back(next_pressure_handler_, std::move(handler));
+    return next_pressure_handler_++;
+}
+
+void MemoryManager::removePressureHandler(size_t id) {
+    std::lock_guard<std::mutex> lock(pressure_mutex_);
+    pressure_handlers_.erase(std::remove_if(pressure_handlers_.begin(), pressure_handlers_.end(),
+                                            [id](const auto& handler) { return handler.first == id; }),
+                             pressure_handlers_.end());
+}
+
+size_t MemoryManager::relieveMemoryPressure(size_t incoming) {
+    if (memory_limit_ == 0) {
+        return 0;
+    }
+    // A pass already running, on this thread or another, is left to it
+    std::unique_lock<std::mutex> lock(pressure_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return 0;
+    }
+    const size_t target = static_cast<size_t>(memory_limit_ * warning_threshold_);
+    size_t freed = 0;
+    for (const auto& handler : pressure_handlers_) {
+        const size_t usage = stats_.getCurrentUsage() + incoming;
+        if (usage <= target) {
+            break;
+        }
+        freed += handler.second(usage - target);
+    }
+    if (freed > 0) {
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::MEMORY,
+                          "Memory pressure relieved: " + std::to_string(freed) + " bytes freed", "MemoryManager");
+    }
+    return freed;
+}
+
+namespace {
+
+MemoryContextId scratchContext() {
+    static const MemoryContextId id = MemoryManager::getInstance().internContext("scratch_arena");
+    return id;
+}
+
+} // namespace
+
+ScratchArena& ScratchArena::forThread() {
+    static thread_local ScratchArena arena;
+    return arena;
+}
+
+ScratchArena::~ScratchArena() {
+    for (const auto& chunk : chunks_) {
+        MemoryManager::getInstance().trackDeallocation(chunk.size, scratchContext());
+        std::free(chunk.data);
+    }
+}
+
+void* ScratchArena::allocate(size_t size, size_t alignment) {
+    // Try the current chunk, then chunks kept from earlier steps
+    for (; current_ < chunks_.size(); ++current_) {
+        Chunk& chunk = chunks_[current_];
+        uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data);
+        size_t offset = ((base + chunk.used + alignment - 1) & ~uintptr_t(alignment - 1)) - base;
+        if (offset + size <= chunk.size) {
+            chunk.used = offset + size;
+            return chunk.data + offset;
+        }
+        if (current_ + 1 < chunks_.size()) {
+            chunks_[current_ + 1].used = 0;
+        } else {
+            break;
+        }
+    }
+
+    // Chunks double in size so a step needs O(log n) of them
+    size_t chunk_size = std::max(MIN_CHUNK_SIZE, chunks_.empty() ? 0 : chunks_.back().size * 2);
+    while (chunk_size < size || chunk_size < alignment) {
+        chunk_size *= 2;
+    }
+    void* data = std::aligned_alloc(std::max<size_t>(alignment, 64), chunk_size);
+    if (!data) {
+        throw std::bad_alloc();
+    }
+    MemoryManager::getInstance().trackAllocation(chunk_size, scratchContext());
+    chunks_.push_back({static_cast<char*>(data), chunk_size, size});
+    current_ = chunks_.size() - 1;
+    return data;
+}
+
+void ScratchArena::release(const Marker& marker) {
+    if (chunks_.empty()) {
+        return;
+    }
+    current_ = std::min(marker.chunk, chunks_.size() - 1);
+    chunks_[current_].used = marker.chunk < chunks_.size() ? marker.offset : 0;
+}
+
+void ScratchArena::trim() {
+    while (chunks_.size() > current_ + 1) {
+        MemoryManager::getInstance().trackDeallocation(chunks_.back().size, scratchContext());
+        std::free(chunks_.back().data);
+        chunks_.pop_back();
+    }
+}
+
+size_t ScratchArena::bytesInUse() const {
+    size_t total = 0;
+    for (size_t i = 0; i < chunks_.size() && i <= current_; ++i) {
+        total += chunks_[i].used;
+    }
+    return total;
+}
+
+size_t ScratchArena::capacity() const {
+    size_t total = 0;
+    for (const auto& chunk : chunks_) {
+        total += chunk.size;
+    }
+    return total;
+}
+
 void MemoryManager::monitoringThread() {
     while (monitoring_enabled_) {
         std::unique_lock<std::mutex> lock(monitor_mutex_);
@@ -300,11 +616,19 @@ void MemoryManager::monitoringThread() {
         
         if (!monitoring_enabled_) break;
         
+        // Sample the peak even when no thread has crossed its sampling
+        // threshold recently
+        stats_.getPeakUsage();
+
         // Check memory status
         if (isMemoryWarningTriggered()) {
+            relieveMemoryPressure();
+        }
+        if (isMemoryWarningTriggered()) {
+            size_t usage = stats_.getCurrentUsage();
             SEMIPRO_LOG_MODULE(LogLevel::WARNING, LogCategory::MEMORY,
-                              "Memory usage warning: " + std::to_string(stats_.current_usage) + 
-                              " bytes (" + std::to_string(static_cast<double>(stats_.current_usage) / memory_limit_ * 100) + "%)",
+                              "Memory usage warning: " + std::to_string(usage) + 
+                              " bytes (" + std::to_string(static_cast<double>(usage) / memory_limit_ * 100) + "%)",
                               "MemoryManager");
         }
         
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "advanced_logger.hpp"
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <mutex>
@@ -13,45 +14,79 @@
 
 namespace SemiPRO {
 
-// Enhanced memory allocation statistics
-struct MemoryStats {
-    std::atomic<size_t> total_allocated{0};
-    std::atomic<size_t> total_deallocated{0};
-    std::atomic<size_t> current_usage{0};
-    std::atomic<size_t> peak_usage{0};
-    std::atomic<size_t> allocation_count{0};
-    std::atomic<size_t> deallocation_count{0};
-
-    size_t getCurrentUsage() const { return current_usage.load(); }
-    size_t getPeakUsage() const { return peak_usage.load(); }
-    size_t getTotalAllocated() const { return total_allocated.load(); }
-    size_t getAllocationCount() const { return allocation_count.load(); }
-
-    void reset() {
-        total_allocated = 0;
-        total_deallocated = 0;
-        current_usage = 0;
-        peak_usage = 0;
-        allocation_count = 0;
-        deallocation_count = 0;
-    }
+// Interned allocation context. Id 0 is the unnamed context.
+using MemoryContextId = uint32_t;
+
+// Enhanced memory allocation statistics. Counters are sharded: each thread
+// is assigned one cache-line aligned shard and updates it with relaxed
+// atomics, so accounting never contends across threads. Totals are summed
+// over the shards only when read. Peak usage is sampled on reads and each
+// time a shard has allocated another PEAK_SAMPLE_BYTES, so it can trail
+// the true peak by up to that much per thread.
+class MemoryStats {
+public:
+    MemoryStats() = default;
+    ~MemoryStats();
+    MemoryStats(const MemoryStats&) = delete;
+    MemoryStats& operator=(const MemoryStats&) = delete;
+
+    void recordAllocation(size_t size, MemoryContextId context = 0);
+    void recordDeallocation(size_t size, MemoryContextId context = 0);
+
+    size_t getCurrentUsage() const;
+    size_t getPeakUsage() const;
+    size_t getTotalAllocated() const;
+    size_t getTotalDeallocated() const;
+    size_t getAllocationCount() const;
+    size_t getDeallocationCount() const;
+    // Bytes allocated minus bytes freed under one context.
+    long long getContextUsage(MemoryContextId context) const;
+
+    void reset();
+    // Restarts peak tracking from the current usage
+    void resetPeakUsage();
+
+    static constexpr size_t MAX_CONTEXTS = 64 * 256;
+
+private:
+    static constexpr size_t SHARD_COUNT = 64;
+    static constexpr size_t CONTEXT_BLOCK = 256;
+    static constexpr size_t PEAK_SAMPLE_BYTES = 1024 * 1024;
+
+    struct alignas(64) Shard {
+        std::atomic<size_t> allocated{0};
+        std::atomic<size_t> deallocated{0};
+        std::atomic<size_t> allocations{0};
+        std::atomic<size_t> deallocations{0};
+        std::atomic<size_t> unsampled{0};
+        // Per-context byte counters in lazily allocated blocks
+        std::atomic<std::atomic<long long>*> context_blocks[MAX_CONTEXTS / CONTEXT_BLOCK] = {};
+    };
+
+    static size_t shardIndex();
+    std::atomic<long long>& contextCounter(Shard& shard, MemoryContextId context);
+    void samplePeak() const;
+
+    Shard shards_[SHARD_COUNT];
+    mutable std::atomic<size_t> peak_usage_{0};
 };
 
 // Memory allocation tracking
 struct AllocationInfo {
     size_t size;
     std::chrono::system_clock::time_point timestamp;
-    std::string context;
+    MemoryContextId context_id;
+    std::string context; // Resolved from context_id by getAllocations()
     std::thread::id thread_id;
 
     // Default constructor
     AllocationInfo() : size(0), timestamp(std::chrono::system_clock::now()),
-                      context(""), thread_id(std::this_thread::get_id()) {}
+                      context_id(0), thread_id(std::this_thread::get_id()) {}
 
     // Parameterized constructor
-    AllocationInfo(size_t s, const std::string& ctx = "")
+    AllocationInfo(size_t s, MemoryContextId ctx = 0)
         : size(s), timestamp(std::chrono::system_clock::now()),
-          context(ctx), thread_id(std::this_thread::get_id()) {}
+          context_id(ctx), thread_id(std::this_thread::get_id()) {}
 };
 
 // Enhanced Memory Manager
@@ -63,7 +98,12 @@ public:
     void* allocate(size_t size, size_t alignment = 16, const std::string& context = "");
     void deallocate(void* ptr);
 
-    // Memory tracking
+    // Memory tracking. The id overloads are the hot path: interning a name
+    // once and passing its id skips the string lookup.
+    MemoryContextId internContext(const std::string& name);
+    std::string contextName(MemoryContextId context) const;
+    void trackAllocation(size_t size, MemoryContextId context);
+    void trackDeallocation(size_t size, MemoryContextId context);
     void trackAllocation(size_t size, const std::string& context = "");
     void trackDeallocation(size_t size, const std::string& context = "");
     void trackPointer(void* ptr, size_t size, const std::string& context = "");
@@ -78,6 +118,8 @@ public:
     size_t getTotalAllocated() const { return stats_.getTotalAllocated(); }
     size_t getPeakUsage() const { return stats_.getPeakUsage(); }
     size_t getCurrentUsage() const { return stats_.getCurrentUsage(); }
+    // Starts a new peak window, e.g. per benchmark run
+    void resetPeakUsage() { stats_.resetPeakUsage(); }
 
     // Enhanced memory optimization
     void defragment();
@@ -85,9 +127,10 @@ public:
     void performGarbageCollection();
     void optimizeMemoryUsage();
     
-    // Configuration
-    void setMemoryLimit(size_t limit_bytes) { memory_limit_ = limit_bytes; }
-    void setWarningThreshold(double threshold) { warning_threshold_ = threshold; }
+    // Configuration. A new limit or threshold relieves pressure at once.
+    void setMemoryLimit(size_t limit_bytes) { memory_limit_ = limit_bytes; relieveMemoryPressure(); }
+    void setWarningThreshold(double threshold) { warning_threshold_ = threshold; relieveMemoryPressure(); }
+    size_t getMemoryLimit() const { return memory_limit_; }
     void setAutoCleanupEnabled(bool enabled) { auto_cleanup_enabled_ = enabled; }
 
     // Memory analysis
@@ -99,6 +142,20 @@ public:
     bool isMemoryWarningTriggered() const;
     void emergencyCleanup();
 
+    // Memory pressure: holders of memory the manager cannot free itself
+    // (idle wafers, caches) register a handler that is asked to free some
+    // number of bytes and returns how many it did. Once usage, plus
+    // `incoming` about to be allocated, passes the warning threshold, the
+    // handlers are asked in registration order until usage is back under
+    // it; this runs on a new limit or threshold, from the monitor, before
+    // an allocation past the limit, and from optimizeMemoryUsage and
+    // emergencyCleanup. Returns the bytes freed, 0 if a pass was already
+    // running. Removing a handler waits for a pass that is running it.
+    using PressureHandler = std::function<size_t(size_t bytes)>;
+    size_t addPressureHandler(PressureHandler handler);
+    void removePressureHandler(size_t id);
+    size_t relieveMemoryPressure(size_t incoming = 0);
+
 private:
     MemoryManager();
     ~MemoryManager();
@@ -122,12 +179,22 @@ private:
     std::unordered_map<void*, AllocationInfo> allocations_;
     mutable std::mutex mutex_;
 
+    // Context interning; names are only looked up when reporting
+    std::vector<std::string> context_names_{""};
+    std::unordered_map<std::string, MemoryContextId> context_ids_;
+    mutable std::mutex context_mutex_;
+
     // Memory monitoring
     std::thread monitor_thread_;
     std::atomic<bool> monitoring_enabled_{true};
     std::condition_variable monitor_cv_;
     std::mutex monitor_mutex_;
 
+    // Pressure handlers by id; pressure_mutex_ is held while they run
+    std::vector<std::pair<size_t, PressureHandler>> pressure_handlers_;
+    size_t next_pressure_handler_ = 0;
+    std::mutex pressure_mutex_;
+
     // Configuration
     size_t memory_limit_ = 0; // 0 = no limit
     double warning_threshold_ = 0.8; // 80% of limit
@@ -138,6 +205,79 @@ private:
     void monitoringThread();
 };
 
+// Per-thread bump allocator for step-local scratch memory. Allocating is a
+// pointer bump in the calling thread's arena and takes no lock; everything
+// allocated inside a MemoryScope is released at once when the scope ends.
+// Chunks are kept for reuse, so a steady-state step allocates no system
+// memory. Only chunk acquisition is reported to the MemoryManager.
+class ScratchArena {
+public:
+    // Position in the arena; release() rewinds to it.
+    struct Marker {
+        size_t chunk = 0;
+        size_t offset = 0;
+    };
+
+    static ScratchArena& forThread();
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    // Throws std::bad_alloc; alignment must be a power of two.
+    void* allocate(size_t size, size_t alignment = 64);
+    template<typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T) > 64 ? alignof(T) : 64));
+    }
+
+    Marker mark() const { return {current_, chunks_.empty() ? 0 : chunks_[current_].used}; }
+    void release(const Marker& marker);
+    void reset() { release(Marker{}); }
+    // Returns chunks past the current position to the system.
+    void trim();
+
+    size_t bytesInUse() const;
+    size_t capacity() const;
+    int scopeDepth() const { return scope_depth_; }
+
+private:
+    friend class MemoryScope;
+
+    ScratchArena() = default;
+    ~ScratchArena();
+
+    struct Chunk {
+        char* data;
+        size_t size;
+        size_t used;
+    };
+
+    std::vector<Chunk> chunks_;
+    size_t current_ = 0;
+    int scope_depth_ = 0;
+
+    static constexpr size_t MIN_CHUNK_SIZE = 1024 * 1024;
+};
+
+// STL allocator over the calling thread's scratch arena. deallocate() is a
+// no-op; containers using it must not outlive the enclosing MemoryScope.
+template<typename T>
+struct ScratchAllocator {
+    using value_type = T;
+
+    ScratchAllocator() = default;
+    template<typename U>
+    ScratchAllocator(const ScratchAllocator<U>&) {}
+
+    T* allocate(size_t count) { return ScratchArena::forThread().allocateArray<T>(count); }
+    void deallocate(T*, size_t) {}
+
+    template<typename U>
+    bool operator==(const ScratchAllocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const ScratchAllocator<U>&) const { return false; }
+};
+
 // Enhanced RAII memory wrapper with tracking
 template<typename T>
 class ManagedArray {
@@ -154,14 +294,18 @@ public:
                           std::to_string(sizeof(T) * count) + " bytes", "MemoryManager");
     }
 
-    ~ManagedArray() {
-        // Destroy elements
-        for (size_t i = 0; i < size_; ++i) {
-            data_[i].~T();
+    // Scratch array carved from `arena` without touching the MemoryManager.
+    // Its memory is reclaimed by the enclosing MemoryScope, so the array
+    // must not outlive that scope.
+    ManagedArray(size_t count, ScratchArena& arena)
+        : size_(count), data_(arena.allocateArray<T>(count)), scratch_(true) {
+        for (size_t i = 0; i < count; ++i) {
+            new(data_ + i) T();
         }
-        MemoryManager::getInstance().deallocate(data_);
-        SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::MEMORY,
-                          "Destroyed ManagedArray: " + context_, "MemoryManager");
+    }
+
+    ~ManagedArray() {
+        release();
     }
 
     // Non-copyable, movable
@@ -169,25 +313,21 @@ public:
     ManagedArray& operator=(const ManagedArray&) = delete;
 
     ManagedArray(ManagedArray&& other) noexcept
-        : size_(other.size_), context_(std::move(other.context_)), data_(other.data_) {
+        : size_(other.size_), context_(std::move(other.context_)), data_(other.data_),
+          scratch_(other.scratch_) {
         other.size_ = 0;
         other.data_ = nullptr;
     }
 
     ManagedArray& operator=(ManagedArray&& other) noexcept {
         if (this != &other) {
-            // Clean up current data
-            if (data_) {
-                for (size_t i = 0; i < size_; ++i) {
-                    data_[i].~T();
-                }
-                MemoryManager::getInstance().deallocate(data_);
-            }
+            release();
 
             // Move from other
             size_ = other.size_;
             context_ = std::move(other.context_);
             data_ = other.data_;
+            scratch_ = other.scratch_;
 
             other.size_ = 0;
             other.data_ = nullptr;
@@ -209,30 +349,56 @@ public:
     T* end() { return data_ + size_; }
     const T* begin() const { return data_; }
     const T* end() const { return data_ + size_; }
+    bool isScratch() const { return scratch_; }
 
 private:
+    void release() {
+        if (!data_) {
+            return;
+        }
+        for (size_t i = 0; i < size_; ++i) {
+            data_[i].~T();
+        }
+        if (!scratch_) {
+            MemoryManager::getInstance().deallocate(data_);
+            SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::MEMORY,
+                              "Destroyed ManagedArray: " + context_, "MemoryManager");
+        }
+        data_ = nullptr;
+    }
+
     size_t size_;
     std::string context_;
     T* data_;
+    bool scratch_ = false;
 };
 
-// RAII memory scope guard
+// RAII memory scope guard. Also delimits a step for the thread's scratch
+// arena: allocations made from it inside the scope are freed on exit.
 class MemoryScope {
 private:
     std::string scope_name_;
     size_t initial_usage_;
     std::chrono::high_resolution_clock::time_point start_time_;
+    ScratchArena& arena_;
+    ScratchArena::Marker arena_mark_;
 
 public:
     explicit MemoryScope(const std::string& name)
         : scope_name_(name),
           initial_usage_(MemoryManager::getInstance().getStats().getCurrentUsage()),
-          start_time_(std::chrono::high_resolution_clock::now()) {
+          start_time_(std::chrono::high_resolution_clock::now()),
+          arena_(ScratchArena::forThread()),
+          arena_mark_(arena_.mark()) {
+        ++arena_.scope_depth_;
         SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::MEMORY,
                           "Entering memory scope: " + scope_name_, "MemoryManager");
     }
 
     ~MemoryScope() {
+        arena_.release(arena_mark_);
+        --arena_.scope_depth_;
+
         auto end_time = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time_);
 
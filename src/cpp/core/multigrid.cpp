@@ -0,0 +1,454 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "multigrid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace {
+
+// Levels below this many points sweep on the calling thread
+constexpr long kParallelPoints = 1 << 14;
+// Coarsening stops once a level is this small and it is factorized
+constexpr Eigen::Index kCoarsestPoints = 64;
+
+bool parallel(Eigen::Index rows, Eigen::Index cols) {
+  return static_cast<long>(rows) * cols >= kParallelPoints;
+}
+
+// Coarse index of fine point i, both counting the ring as 0
+inline Eigen::Index parent(Eigen::Index i) {
+  return (i - 1) / 2 + 1;
+}
+
+// The finest level's sweeps on the device, when the workspace has a
+// smoother; single-precision cycles always sweep on the CPU
+bool smoothOnDevice(GpuCompute::Smoother* smoother, Eigen::ArrayXXd& u, const Eigen::ArrayXXd* f, int sweeps,
+                    bool reverse) {
+  return smoother && smoother->smooth(u, f, sweeps, reverse);
+}
+bool smoothOnDevice(GpuCompute::Smoother*, Eigen::ArrayXXf&, const Eigen::ArrayXXf*, int, bool) {
+  return false;
+}
+
+// Interior inner product
+template <typename T>
+T dot(const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>& a, const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>& b,
+      Eigen::Index rows, Eigen::Index cols) {
+  return (a.block(1, 1, rows, cols) * b.block(1, 1, rows, cols)).sum();
+}
+
+} // namespace
+
+MultigridSolver::MultigridSolver(const Eigen::ArrayXXd& conductivity)
+    : rows_(conductivity.rows()), cols_(conductivity.cols()) {
+  build(conductivity, nullptr);
+}
+
+MultigridSolver::MultigridSolver(const Eigen::ArrayXXd& conductivity, const Eigen::ArrayXXd& capacity)
+    : rows_(conductivity.rows()), cols_(conductivity.cols()), has_capacity_(true) {
+  if (capacity.rows() != rows_ || capacity.cols() != cols_) {
+    throw std::invalid_argument("MultigridSolver: capacity does not match the conductivity");
+  }
+  if (!(capacity >= 0.0).all() || !capacity.allFinite()) {
+    throw std::invalid_argument("MultigridSolver: capacity must be non-negative and finite");
+  }
+  build(conductivity, &capacity);
+}
+
+void MultigridSolver::build(const Eigen::ArrayXXd& conductivity, const Eigen::ArrayXXd* capacity) {
+  if (!(conductivity > 0.0).all() || !conductivity.allFinite()) {
+    throw std::invalid_argument("MultigridSolver: conductivity must be positive and finite");
+  }
+  Level<double> fine;
+  fine.rows = std::max<Eigen::Index>(rows_ - 2, 0);
+  fine.cols = std::max<Eigen::Index>(cols_ - 2, 0);
+  if (fine.rows == 0 || fine.cols == 0) {
+    return; // Every point is on the ring
+  }
+  setFaces(fine, conductivity);
+  if (capacity) {
+    fine.capacity.setZero(rows_, cols_);
+    fine.capacity.block(1, 1, fine.rows, fine.cols) = capacity->block(1, 1, fine.rows, fine.cols);
+  }
+  levels_.push_back(std::move(fine));
+
+  while (levels_.back().rows * levels_.back().cols > kCoarsestPoints) {
+    levels_.push_back(coarsen(levels_.back()));
+  }
+  for (Level<double>& level : levels_) {
+    sumFaces(level);
+  }
+}
+
+void MultigridSolver::updateConductivity(const Eigen::ArrayXXd& conductivity) {
+  if (conductivity.rows() != rows_ || conductivity.cols() != cols_) {
+    throw std::invalid_argument("MultigridSolver: conductivity does not match the grid");
+  }
+  if (!(conductivity > 0.0).all() || !conductivity.allFinite()) {
+    throw std::invalid_argument("MultigridSolver: conductivity must be positive and finite");
+  }
+  if (levels_.empty()) {
+    return;
+  }
+  setFaces(levels_.front(), conductivity);
+  sumFaces(levels_.front());
+  if (!single_levels_.empty()) {
+    single_levels_.front() = toSingle(levels_.front());
+  }
+}
+
+void MultigridSolver::setFaces(Level<double>& fine, const Eigen::ArrayXXd& conductivity) const {
+  fine.west.setZero(rows_, cols_);
+  fine.north.setZero(rows_, cols_);
+  const auto harmonic = [](double a, double b) { return 2.0 * a * b / (a + b); };
+  for (Eigen::Index j = 1; j <= fine.cols; ++j) {
+    for (Eigen::Index i = 1; i <= fine.rows; ++i) {
+      fine.west(i, j) = harmonic(conductivity(i, j - 1), conductivity(i, j));
+      fine.north(i, j) = harmonic(conductivity(i - 1, j), conductivity(i, j));
+    }
+    fine.north(fine.rows + 1, j) = harmonic(conductivity(fine.rows, j), conductivity(fine.rows + 1, j));
+  }
+  for (Eigen::Index i = 1; i <= fine.rows; ++i) {
+    fine.west(i, fine.cols + 1) = harmonic(conductivity(i, fine.cols), conductivity(i, fine.cols + 1));
+  }
+}
+
+void MultigridSolver::sumFaces(Level<double>& level) {
+  const Eigen::Index m = level.rows, n = level.cols;
+  level.faces.setZero(m + 2, n + 2);
+  level.faces.block(1, 1, m, n) = level.west.block(1, 1, m, n) + level.west.block(1, 2, m, n) +
+                                  level.north.block(1, 1, m, n) + level.north.block(2, 1, m, n);
+}
+
+MultigridSolver::Level<double> MultigridSolver::coarsen(const Level<double>& fine) const {
+  Level<double> coarse;
+  coarse.rows = (fine.rows + 1) / 2;
+  coarse.cols = (fine.cols + 1) / 2;
+  coarse.west.setZero(coarse.rows + 2, coarse.cols + 2);
+  coarse.north.setZero(coarse.rows + 2, coarse.cols + 2);
+  // A coarse face is made of the fine faces on the block's edge; the last
+  // block's far edge is the fine grid's even when that block is single
+  for (Eigen::Index j = 1; j <= fine.cols + 1; ++j) {
+    const bool edge = j % 2 == 1 || j == fine.cols + 1;
+    for (Eigen::Index i = 1; i <= fine.rows; ++i) {
+      if (edge) {
+        coarse.west(parent(i), j == fine.cols + 1 ? coarse.cols + 1 : parent(j)) += 0.5 * fine.west(i, j);
+      }
+    }
+  }
+  for (Eigen::Index j = 1; j <= fine.cols; ++j) {
+    for (Eigen::Index i = 1; i <= fine.rows + 1; ++i) {
+      if (i % 2 == 1 || i == fine.rows + 1) {
+        coarse.north(i == fine.rows + 1 ? coarse.rows + 1 : parent(i), parent(j)) += 0.5 * fine.north(i, j);
+      }
+    }
+  }
+  // The Galerkin product sums a block's capacities
+  if (fine.capacity.size() > 0) {
+    coarse.capacity.setZero(coarse.rows + 2, coarse.cols + 2);
+    for (Eigen::Index j = 1; j <= fine.cols; ++j) {
+      for (Eigen::Index i = 1; i <= fine.rows; ++i) {
+        coarse.capacity(parent(i), parent(j)) += 0.5 * fine.capacity(i, j);
+      }
+    }
+  }
+  return coarse;
+}
+
+std::size_t MultigridSolver::bytes() const {
+  std::size_t total = 0;
+  for (const Level<double>& level : levels_) {
+    total += static_cast<std::size_t>(level.west.size() + level.north.size() + level.faces.size() +
+                                      level.capacity.size()) *
+             sizeof(double);
+  }
+  std::lock_guard<std::mutex> lock(single_mutex_);
+  for (const Level<float>& level : single_levels_) {
+    total += static_cast<std::size_t>(level.west.size() + level.north.size() + level.faces.size() +
+                                      level.capacity.size()) *
+             sizeof(float);
+  }
+  return total;
+}
+
+MultigridSolver::Level<float> MultigridSolver::toSingle(const Level<double>& level) {
+  Level<float> single;
+  single.rows = level.rows;
+  single.cols = level.cols;
+  single.west = level.west.cast<float>();
+  single.north = level.north.cast<float>();
+  single.faces = level.faces.cast<float>();
+  single.capacity = level.capacity.cast<float>();
+  return single;
+}
+
+const std::vector<MultigridSolver::Level<float>>& MultigridSolver::singleLevels() const {
+  std::lock_guard<std::mutex> lock(single_mutex_);
+  if (single_levels_.empty()) {
+    for (const Level<double>& level : levels_) {
+      single_levels_.push_back(toSingle(level));
+    }
+  }
+  return single_levels_;
+}
+
+template <typename T>
+MultigridSolver::Workspace<T> MultigridSolver::workspace(const std::vector<Level<T>>& levels,
+                                                         double capacity_scale) const {
+  Workspace<T> work;
+  work.capacity_scale = has_capacity_ ? capacity_scale : 0.0;
+  for (const Level<T>& level : levels) {
+    const Eigen::Index m = level.rows, n = level.cols;
+    Grid<T> diagonal = level.faces;
+    if (work.capacity_scale != 0.0) {
+      diagonal += static_cast<T>(work.capacity_scale) * level.capacity;
+    }
+    Grid<T> inverse = Grid<T>::Zero(m + 2, n + 2);
+    inverse.block(1, 1, m, n) = T(1) / diagonal.block(1, 1, m, n);
+    work.inverse_diagonal.push_back(std::move(inverse));
+    work.u.push_back(Grid<T>::Zero(m + 2, n + 2));
+    work.f.push_back(Grid<T>::Zero(m + 2, n + 2));
+    work.r.push_back(Grid<T>::Zero(m + 2, n + 2));
+  }
+  if (auto gpu = Gpu::active(); gpu && levels.size() > 1) {
+    if constexpr (std::is_same_v<T, double>) {
+      work.smoother = gpu->smoother(levels.front().west, levels.front().north, work.inverse_diagonal.front());
+    }
+  }
+
+  // The coarsest level is factorized in double whatever the cycle's precision
+  const Level<T>& level = levels.back();
+  const Eigen::Index m = level.rows, n = level.cols;
+  const auto index = [m](Eigen::Index i, Eigen::Index j) { return (i - 1) + (j - 1) * m; };
+  Eigen::MatrixXd matrix = Eigen::MatrixXd::Zero(m * n, m * n);
+  for (Eigen::Index j = 1; j <= n; ++j) {
+    for (Eigen::Index i = 1; i <= m; ++i) {
+      const Eigen::Index p = index(i, j);
+      matrix(p, p) = level.faces(i, j);
+      if (work.capacity_scale != 0.0) {
+        matrix(p, p) += work.capacity_scale * level.capacity(i, j);
+      }
+      if (j > 1) {
+        matrix(p, index(i, j - 1)) = matrix(index(i, j - 1), p) = -level.west(i, j);
+      }
+      if (i > 1) {
+        matrix(p, index(i - 1, j)) = matrix(index(i - 1, j), p) = -level.north(i, j);
+      }
+    }
+  }
+  work.coarsest.compute(matrix);
+  return work;
+}
+
+// y = A x inside the ring; the ring of y is zero
+template <typename T>
+void MultigridSolver::apply(const Level<T>& level, double capacity_scale, const Grid<T>& x, Grid<T>& y) {
+  const Eigen::Index rows = level.rows, cols = level.cols;
+  const Grid<T>& west = level.west;
+  const Grid<T>& north = level.north;
+  y.setZero(rows + 2, cols + 2);
+#pragma omp parallel for schedule(static) if (parallel(rows, cols))
+  for (Eigen::Index j = 1; j <= cols; ++j) {
+    for (Eigen::Index i = 1; i <= rows; ++i) {
+      y(i, j) = level.faces(i, j) * x(i, j) - west(i, j) * x(i, j - 1) - west(i, j + 1) * x(i, j + 1) -
+                north(i, j) * x(i - 1, j) - north(i + 1, j) * x(i + 1, j);
+    }
+  }
+  if (capacity_scale != 0.0) {
+    y.block(1, 1, rows, cols) +=
+        static_cast<T>(capacity_scale) * level.capacity.block(1, 1, rows, cols) * x.block(1, 1, rows, cols);
+  }
+}
+
+template <typename T>
+void MultigridSolver::coarsestSolve(const Level<T>& level, Grid<T>& u, const Grid<T>& f,
+                                    const Workspace<T>& work) {
+  const Eigen::Index m = level.rows, n = level.cols;
+  Eigen::VectorXd b(m * n);
+  for (Eigen::Index j = 1; j <= n; ++j) {
+    b.segment((j - 1) * m, m) = f.col(j).segment(1, m).matrix().template cast<double>();
+  }
+  const Eigen::VectorXd x = work.coarsest.solve(b);
+  for (Eigen::Index j = 1; j <= n; ++j) {
+    u.col(j).segment(1, m) = x.segment((j - 1) * m, m).array().template cast<T>();
+  }
+}
+
+template <typename T>
+void MultigridSolver::cycle(const std::vector<Level<T>>& levels, std::size_t l, Grid<T>& u, const Grid<T>& f,
+                            Workspace<T>& work, int smoothing_steps) const {
+  const Level<T>& level = levels[l];
+  if (l + 1 == levels.size()) {
+    coarsestSolve(level, u, f, work);
+    return;
+  }
+  const Eigen::Index m = level.rows, n = level.cols;
+  const Grid<T>& inverse_diagonal = work.inverse_diagonal[l];
+  // Points with (i + j) of one parity depend only on the other's
+  const auto sweep = [&](int colour) {
+#pragma omp parallel for schedule(static) if (parallel(m, n))
+    for (Eigen::Index j = 1; j <= n; ++j) {
+      for (Eigen::Index i = 2 - ((j + colour) & 1); i <= m; i += 2) {
+        u(i, j) = (f(i, j) + level.west(i, j) * u(i, j - 1) + level.west(i, j + 1) * u(i, j + 1) +
+                   level.north(i, j) * u(i - 1, j) + level.north(i + 1, j) * u(i + 1, j)) *
+                  inverse_diagonal(i, j);
+      }
+    }
+  };
+  GpuCompute::Smoother* device = l == 0 ? work.smoother.get() : nullptr;
+  if (!smoothOnDevice(device, u, &f, smoothing_steps, false)) {
+    device = nullptr;
+    for (int s = 0; s < smoothing_steps; ++s) {
+      sweep(0);
+      sweep(1);
+    }
+  }
+
+  Grid<T>& r = work.r[l];
+  apply(level, work.capacity_scale, u, r);
+  r.block(1, 1, m, n) = f.block(1, 1, m, n) - r.block(1, 1, m, n);
+  const Level<T>& coarse = levels[l + 1];
+  Grid<T>& coarse_u = work.u[l + 1];
+  Grid<T>& coarse_f = work.f[l + 1];
+  // Each coarse point sums the residuals of its block
+#pragma omp parallel for schedule(static) if (parallel(m, n))
+  for (Eigen::Index jc = 1; jc <= coarse.cols; ++jc) {
+    coarse_f.col(jc).setZero();
+    for (Eigen::Index j = 2 * jc - 1; j <= std::min(2 * jc, n); ++j) {
+      for (Eigen::Index i = 1; i <= m; ++i) {
+        coarse_f(parent(i), jc) += r(i, j);
+      }
+    }
+  }
+  coarse_u.setZero();
+  cycle(levels, l + 1, coarse_u, coarse_f, work, smoothing_steps);
+#pragma omp parallel for schedule(static) if (parallel(m, n))
+  for (Eigen::Index j = 1; j <= n; ++j) {
+    for (Eigen::Index i = 1; i <= m; ++i) {
+      u(i, j) += coarse_u(parent(i), parent(j));
+    }
+  }
+
+  // The sweeps in reverse keep the cycle symmetric
+  if (!smoothOnDevice(device, u, nullptr, smoothing_steps, true)) {
+    for (int s = 0; s < smoothing_steps; ++s) {
+      sweep(1);
+      sweep(0);
+    }
+  }
+}
+
+void MultigridSolver::precondition(const Eigen::ArrayXXd& residual, Eigen::ArrayXXd& correction,
+                                   int smoothing_steps, double capacity_scale) const {
+  if (residual.rows() != rows_ || residual.cols() != cols_) {
+    throw std::invalid_argument("MultigridSolver: residual does not match the grid");
+  }
+  correction.setZero(rows_, cols_);
+  if (levels_.empty()) {
+    return;
+  }
+  Workspace<double> work = workspace(levels_, capacity_scale);
+  cycle(levels_, 0, correction, residual, work, smoothing_steps);
+}
+
+void MultigridSolver::solve(Eigen::ArrayXXd& u, const Eigen::ArrayXXd& source, const Options& options,
+                            Statistics* statistics) const {
+  if (u.rows() != rows_ || u.cols() != cols_ || source.rows() != rows_ || source.cols() != cols_) {
+    throw std::invalid_argument("MultigridSolver: arrays do not match the grid");
+  }
+  if (!(options.capacity_scale >= 0.0)) {
+    throw std::invalid_argument("MultigridSolver: capacity scale must be non-negative");
+  }
+  Statistics local;
+  Statistics& stats = statistics ? *statistics : local;
+  stats = Statistics{};
+  stats.levels = levels();
+  if (levels_.empty()) {
+    return;
+  }
+  const Level<double>& fine = levels_.front();
+  const Eigen::Index m = fine.rows, n = fine.cols;
+  const double s = has_capacity_ ? options.capacity_scale : 0.0;
+
+  // r = f - A u, with the ring's fixed values entering through A u. The
+  // tolerance is on the residual of a zero interior, which depends on the
+  // problem only, so a good guess needs fewer iterations.
+  Eigen::ArrayXXd r;
+  Eigen::ArrayXXd ring = u;
+  ring.block(1, 1, m, n).setZero();
+  apply(fine, s, ring, r);
+  r.block(1, 1, m, n) = source.block(1, 1, m, n) - r.block(1, 1, m, n);
+  const double scale = std::sqrt(dot(r, r, m, n));
+  if (scale == 0.0) {
+    u.block(1, 1, m, n).setZero();
+    return;
+  }
+  apply(fine, s, u, r);
+  r.block(1, 1, m, n) = source.block(1, 1, m, n) - r.block(1, 1, m, n);
+  stats.residual = std::sqrt(dot(r, r, m, n)) / scale;
+  if (stats.residual <= options.tolerance) {
+    return;
+  }
+
+  // Mixed precision cycles on the residual scaled to unit norm, which
+  // keeps it clear of single precision's range limits
+  const std::vector<Level<float>>* single = options.mixed_precision ? &singleLevels() : nullptr;
+  Workspace<double> work;
+  Workspace<float> single_work;
+  if (single) {
+    single_work = workspace(*single, s);
+  } else {
+    work = workspace(levels_, s);
+  }
+  Eigen::ArrayXXd z = Eigen::ArrayXXd::Zero(rows_, cols_);
+  Eigen::ArrayXXd p, q, previous;
+  Grid<float> single_r, single_z;
+  double rz = 0.0;
+  for (stats.iterations = 1; stats.iterations <= options.max_iterations; ++stats.iterations) {
+    if (single) {
+      const double norm = std::sqrt(dot(r, r, m, n));
+      single_r = (r / norm).cast<float>();
+      single_z.setZero(rows_, cols_);
+      cycle(*single, 0, single_z, single_r, single_work, options.smoothing_steps);
+      z = norm * single_z.cast<double>();
+    } else {
+      z.setZero();
+      cycle(levels_, 0, z, r, work, options.smoothing_steps);
+    }
+    if (options.conjugate_gradient) {
+      const double rz_new = dot(r, z, m, n);
+      if (stats.iterations == 1) {
+        p = z;
+      } else {
+        // Rounding makes the single-precision cycle a slightly different
+        // map each time, which the flexible (Polak-Ribiere) beta absorbs
+        const double beta = (single ? rz_new - dot(previous, z, m, n) : rz_new) / rz;
+        p.block(1, 1, m, n) = z.block(1, 1, m, n) + beta * p.block(1, 1, m, n);
+      }
+      rz = rz_new;
+      if (single) {
+        previous = r;
+      }
+      apply(fine, s, p, q);
+      const double alpha = rz / dot(p, q, m, n);
+      u.block(1, 1, m, n) += alpha * p.block(1, 1, m, n);
+      r.block(1, 1, m, n) -= alpha * q.block(1, 1, m, n);
+    } else {
+      // The coarse correction overshoots by design, so each cycle's
+      // correction is scaled to the step that minimizes the error's energy
+      apply(fine, s, z, q);
+      const double alpha = dot(r, z, m, n) / dot(z, q, m, n);
+      u.block(1, 1, m, n) += alpha * z.block(1, 1, m, n);
+      r.block(1, 1, m, n) -= alpha * q.block(1, 1, m, n);
+    }
+    stats.residual = std::sqrt(dot(r, r, m, n)) / scale;
+    if (stats.residual <= options.tolerance) {
+      return;
+    }
+  }
+  stats.iterations = options.max_iterations;
+  throw std::runtime_error("MultigridSolver: residual " + std::to_string(stats.residual) + " after " +
+                           std::to_string(options.max_iterations) + " iterations");
+}
@@ -0,0 +1,144 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "gpu_compute.hpp"
+#include <Eigen/Dense>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Diffusion with variable conductivity, s c u - div(k grad u) = f, on the
+// points of a grid whose outer ring is held at fixed values. Point p's row
+// is s c_p u_p plus, over its four faces, k_face (u_p - u_neighbour), with
+// k_face the harmonic mean of the two points' conductivities; f carries
+// the spacing squared. The capacity c is fixed with the operator and the
+// scale s is given per solve, so one operator serves implicit time steps
+// of every length (s = 1/dt for backward Euler) and, with s = 0, the
+// steady problem. Nothing is assembled: each level keeps its face
+// conductances and capacities as arrays and the stencil is applied in
+// place.
+//
+// Coarse levels aggregate 2x2 blocks of points (a lone row or column at an
+// odd edge stays single) and take half the Galerkin product of
+// piecewise-constant interpolation as their operator, which on even blocks
+// is the stencil rediscretized at twice the spacing with face conductances
+// averaged along the face. Smoothing is red-black Gauss-Seidel, parallel
+// over columns under OpenMP, and the coarsest level is factorized densely.
+// The V-cycle is symmetric, so it serves both as a solver and as a
+// preconditioner for conjugate gradients, the default. Either way the work
+// and memory grow linearly with the number of points.
+//
+// With a GPU active (Gpu::active()), a double-precision solve smooths the
+// finest level on the device, its coefficients uploaded once per solve;
+// the coarser levels, which are small, stay on the CPU.
+//
+// In mixed precision the V-cycles run on a single-precision copy of the
+// hierarchy, made by the first such solve, while residuals, step lengths
+// and the solution stay double: each cycle is an inexact correction that
+// the double-precision outer iteration refines, so the tolerance is met
+// as in double while the cycles move half the bytes.
+class MultigridSolver {
+public:
+  struct Options {
+    double tolerance = 1e-10; // On the residual's norm, relative to that of a zero interior
+    int max_iterations = 100;
+    int smoothing_steps = 2;        // Red-black sweeps before and after each coarse correction
+    bool conjugate_gradient = true; // V-cycles preconditioning CG rather than iterated on their own
+    double capacity_scale = 0.0;    // s, multiplying the capacity on the diagonal
+    bool mixed_precision = false;   // V-cycles in single precision
+  };
+
+  struct Statistics {
+    int iterations = 0;
+    int levels = 0;
+    double residual = 0.0; // Final residual norm relative to that of a zero interior
+  };
+
+  // Operator on a conductivity.rows() x conductivity.cols() grid, with no
+  // capacity or with one of the same shape. Throws std::invalid_argument
+  // for a conductivity that is not positive and finite everywhere, or a
+  // capacity of another shape or not finite and non-negative.
+  explicit MultigridSolver(const Eigen::ArrayXXd& conductivity);
+  MultigridSolver(const Eigen::ArrayXXd& conductivity, const Eigen::ArrayXXd& capacity);
+
+  // Solves for the interior points. u holds the ring's fixed values and
+  // the initial guess for the rest; source is read only inside the ring.
+  // A guess already within tolerance, such as the last solution of a
+  // nearby problem, returns after no iterations.
+  // Throws std::invalid_argument for arrays of the wrong shape or a
+  // negative capacity_scale, and std::runtime_error when the tolerance is
+  // not met in max_iterations.
+  void solve(Eigen::ArrayXXd& u, const Eigen::ArrayXXd& source, const Options& options,
+             Statistics* statistics = nullptr) const;
+  void solve(Eigen::ArrayXXd& u, const Eigen::ArrayXXd& source) const { solve(u, source, Options()); }
+
+  // One V-cycle from zero: correction approximates A^-1 residual with the
+  // ring held at zero, for preconditioning a Krylov method
+  void precondition(const Eigen::ArrayXXd& residual, Eigen::ArrayXXd& correction,
+                    int smoothing_steps = 2, double capacity_scale = 0.0) const;
+
+  // Replaces the finest level's conductivity and keeps the coarse levels
+  // built from the old one. The V-cycle stays a symmetric preconditioner
+  // of the new operator, and a good one while the change is moderate, so
+  // nonlinear iterations that shift the conductivity a little per step
+  // skip rebuilding the hierarchy. Solves still meet the tolerance on the
+  // new operator. Throws std::invalid_argument for a conductivity of
+  // another shape or not positive and finite.
+  void updateConductivity(const Eigen::ArrayXXd& conductivity);
+
+  Eigen::Index rows() const { return rows_; }
+  Eigen::Index cols() const { return cols_; }
+  int levels() const { return static_cast<int>(levels_.size()); }
+  bool hasCapacity() const { return has_capacity_; }
+  // Memory held by the hierarchy, and its single-precision copy once made
+  std::size_t bytes() const;
+
+private:
+  template <typename T>
+  using Grid = Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>;
+
+  // Arrays span the level's interior and a ring of zeros around it, so the
+  // stencil needs no bounds tests
+  template <typename T>
+  struct Level {
+    Eigen::Index rows = 0; // Interior points
+    Eigen::Index cols = 0;
+    Grid<T> west;     // (i, j) to (i, j - 1)
+    Grid<T> north;    // (i, j) to (i - 1, j)
+    Grid<T> faces;    // Sum of the four face conductances
+    Grid<T> capacity; // Empty without one
+  };
+  // What depends on the capacity scale, and the corrections, right-hand
+  // sides and residuals of the coarse levels
+  template <typename T>
+  struct Workspace {
+    double capacity_scale = 0.0;
+    std::vector<Grid<T>> inverse_diagonal;
+    Eigen::LLT<Eigen::MatrixXd> coarsest;
+    std::vector<Grid<T>> u, f, r;
+    std::shared_ptr<GpuCompute::Smoother> smoother; // The finest level's, on the device
+  };
+
+  void build(const Eigen::ArrayXXd& conductivity, const Eigen::ArrayXXd* capacity);
+  void setFaces(Level<double>& fine, const Eigen::ArrayXXd& conductivity) const;
+  static void sumFaces(Level<double>& level);
+  Level<double> coarsen(const Level<double>& fine) const;
+  static Level<float> toSingle(const Level<double>& level);
+  const std::vector<Level<float>>& singleLevels() const;
+  template <typename T>
+  Workspace<T> workspace(const std::vector<Level<T>>& levels, double capacity_scale) const;
+  template <typename T>
+  static void apply(const Level<T>& level, double capacity_scale, const Grid<T>& x, Grid<T>& y);
+  template <typename T>
+  void cycle(const std::vector<Level<T>>& levels, std::size_t l, Grid<T>& u, const Grid<T>& f, Workspace<T>& work,
+             int smoothing_steps) const;
+  template <typename T>
+  static void coarsestSolve(const Level<T>& level, Grid<T>& u, const Grid<T>& f, const Workspace<T>& work);
+
+  Eigen::Index rows_;
+  Eigen::Index cols_;
+  bool has_capacity_ = false;
+  std::vector<Level<double>> levels_;
+  mutable std::mutex single_mutex_; // Guards making single_levels_
+  mutable std::vector<Level<float>> single_levels_;
+};
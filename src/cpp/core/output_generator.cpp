@@ -0,0 +1,140 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "output_generator.hpp"
+#include "advanced_logger.hpp"
+#include "wafer.hpp"
+#include <filesystem>
+
+namespace SemiPRO {
+
+OutputGenerator::OutputGenerator(const std::string& base_directory)
+    : base_directory_(base_directory), default_format_(OutputFormat::YAML) {}
+
+void OutputGenerator::setBaseDirectory(const std::string& directory) {
+    base_directory_ = directory;
+}
+
+std::string OutputGenerator::getBaseDirectory() const {
+    return base_directory_;
+}
+
+void OutputGenerator::setDefaultFormat(OutputFormat format) {
+    default_format_ = format;
+}
+
+OutputGenerator::OutputFormat OutputGenerator::getDefaultFormat() const {
+    return default_format_;
+}
+
+std::unique_ptr<FieldStreamWriter> OutputGenerator::openFieldStream(const std::string& filename,
+                                                                    const std::vector<std::string>& channels,
+                                                                    const FieldStreamWriter::Options& options) {
+    const std::string path = getFullPath(filename);
+    if (!createDirectoryIfNeeded(path)) {
+        return nullptr;
+    }
+    try {
+        auto writer = std::make_unique<FieldStreamWriter>(path, channels, options);
+        logInfo("Streaming fields to " + path);
+        return writer;
+    } catch (const std::exception& e) {
+        logError("Cannot open field stream " + path + ": " + e.what());
+        return nullptr;
+    }
+}
+
+bool OutputGenerator::exportToHDF5(const std::string& filename, const std::shared_ptr<Wafer>& wafer) {
+    return exportFieldFrame(filename, wafer, FieldStreamWriter::Format::HDF5);
+}
+
+bool OutputGenerator::exportToZarr(const std::string& filename, const std::shared_ptr<Wafer>& wafer) {
+    return exportFieldFrame(filename, wafer, FieldStreamWriter::Format::ZARR);
+}
+
+bool OutputGenerator::exportFieldFrame(const std::string& filename, const std::shared_ptr<Wafer>& wafer,
+                                       FieldStreamWriter::Format format) {
+    if (!wafer) {
+        logError("No wafer to export to " + filename);
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const FieldStore& fields = wafer->getFieldStore();
+    std::vector<std::string> channels;
+    for (int c = 0; c < fields.channelCount(); ++c) {
+        channels.push_back(fields.channelName(c));
+    }
+
+    FieldStreamWriter::Options options;
+    options.format = format;
+    auto writer = openFieldStream(filename, channels, options);
+    if (!writer) {
+        return false;
+    }
+    try {
+        writer->append(*wafer, 0.0);
+        writer->close();
+    } catch (const std::exception& e) {
+        logError("Export to " + writer->path() + " failed: " + e.what());
+        return false;
+    }
+
+    stats_.files_exported++;
+    stats_.total_data_size += writer->bytesWritten();
+    stats_.total_export_time += std::chrono::steady_clock::now() - start;
+    stats_.format_counts[format == FieldStreamWriter::Format::HDF5 ? "HDF5" : "ZARR"]++;
+    return true;
+}
+
+std::string OutputGenerator::getLastError() const {
+    return last_error_;
+}
+
+std::vector<std::string> OutputGenerator::getAllErrors() const {
+    return errors_;
+}
+
+void OutputGenerator::clearErrors() {
+    last_error_.clear();
+    errors_.clear();
+}
+
+OutputGenerator::ExportStatistics OutputGenerator::getExportStatistics() const {
+    return stats_;
+}
+
+void OutputGenerator::resetStatistics() {
+    stats_ = ExportStatistics();
+}
+
+std::string OutputGenerator::getFullPath(const std::string& filename) const {
+    std::filesystem::path path(filename);
+    if (path.is_absolute() || base_directory_.empty()) {
+        return filename;
+    }
+    return (std::filesystem::path(base_directory_) / path).string();
+}
+
+void OutputGenerator::logError(const std::string& error) const {
+    last_error_ = error;
+    errors_.push_back(error);
+    SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::SYSTEM, error, "OutputGenerator");
+}
+
+void OutputGenerator::logInfo(const std::string& info) const {
+    SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::GENERAL, info, "OutputGenerator");
+}
+
+bool OutputGenerator::createDirectoryIfNeeded(const std::string& filepath) const {
+    const std::filesystem::path parent = std::filesystem::path(filepath).parent_path();
+    if (parent.empty()) {
+        return true;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(parent, error);
+    if (error) {
+        logError("Cannot create directory " + parent.string() + ": " + error.message());
+        return false;
+    }
+    return true;
+}
+
+} // namespace SemiPRO
@@ -2,6 +2,8 @@
 #ifndef OUTPUT_GENERATOR_HPP
 #define OUTPUT_GENERATOR_HPP
 
+#include "field_stream_writer.hpp"
+#include <chrono>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -10,11 +12,11 @@
 #include <yaml-cpp/yaml.h>
 #include <Eigen/Dense>
 
-namespace SemiPRO {
-
 // Forward declarations
 class Wafer;
 
+namespace SemiPRO {
+
 /**
  * @brief Comprehensive output file generator for simulation results
  */
@@ -27,6 +29,7 @@ public:
         CSV,            // CSV data files
         VTK,            // VTK visualization files
         HDF5,           // HDF5 scientific data format
+        ZARR,           // Zarr v2 chunked array store (a directory)
         MATLAB,         // MATLAB .mat files
         TECPLOT,        // Tecplot data files
         GDSII,          // GDSII layout files
@@ -146,6 +149,14 @@ public:
                                    const std::unordered_map<std::string, double>& stats,
                                    const ExportOptions& options = ExportOptions());
     
+    // Streaming field export for time series. Each append() on the
+    // returned writer queues one frame, which a background thread writes
+    // as compressed chunks while the simulation carries on. Returns null
+    // and records the error if the store cannot be created.
+    std::unique_ptr<FieldStreamWriter> openFieldStream(const std::string& filename,
+                                                       const std::vector<std::string>& channels,
+                                                       const FieldStreamWriter::Options& options);
+    
     // Visualization export
     bool exportVisualization(const std::string& filename, 
                            const std::shared_ptr<Wafer>& wafer,
@@ -203,7 +214,9 @@ public:
     bool exportToCSV(const std::string& filename, const Eigen::MatrixXd& data, 
                     const std::vector<std::string>& headers = {});
     bool exportToVTK(const std::string& filename, const std::shared_ptr<Wafer>& wafer);
+    // One frame of every wafer field, through the streaming writer
     bool exportToHDF5(const std::string& filename, const std::shared_ptr<Wafer>& wafer);
+    bool exportToZarr(const std::string& filename, const std::shared_ptr<Wafer>& wafer);
     bool exportToMATLAB(const std::string& filename, const std::shared_ptr<Wafer>& wafer);
     bool exportToTecplot(const std::string& filename, const std::shared_ptr<Wafer>& wafer);
     bool exportToGDSII(const std::string& filename, const std::shared_ptr<Wafer>& wafer);
@@ -252,6 +265,8 @@ private:
     void logError(const std::string& error) const;
     void logInfo(const std::string& info) const;
     bool createDirectoryIfNeeded(const std::string& filepath) const;
+    bool exportFieldFrame(const std::string& filename, const std::shared_ptr<Wafer>& wafer,
+                          FieldStreamWriter::Format format);
     
     // Data conversion helpers
     YAML::Node waferToYAML(const std::shared_ptr<Wafer>& wafer) const;
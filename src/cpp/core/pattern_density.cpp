@@ -0,0 +1,188 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "pattern_density.hpp"
+#include "performance_utils.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+struct Cache {
+  struct Slot {
+    PatternDensity::Maps maps;
+    std::size_t bytes;
+    std::list<SemiPRO::CacheKey>::iterator lru;
+  };
+
+  void trim() {
+    while (bytes > budget && !lru.empty()) {
+      auto it = slots.find(lru.back());
+      bytes -= it->second.bytes;
+      slots.erase(it);
+      lru.pop_back();
+    }
+  }
+
+  std::mutex mutex;
+  std::size_t budget = 128u << 20;
+  std::size_t bytes = 0;
+  std::list<SemiPRO::CacheKey> lru; // Most recently used first
+  std::unordered_map<SemiPRO::CacheKey, Slot, SemiPRO::CacheKeyHash> slots;
+};
+
+Cache& cache() {
+  // Never destroyed, so steps running during static destruction stay valid
+  static Cache* instance = new Cache();
+  return *instance;
+}
+
+SemiPRO::CacheKey maskKey(const BitMask& mask, const std::vector<PatternDensity::Scale>& scales) {
+  SemiPRO::ContentHasher hasher;
+  hasher.update_value(mask.rows()).update_value(mask.cols());
+  hasher.update(mask.words().data(), mask.words().size() * sizeof(std::uint64_t));
+  hasher.update_value(scales.size());
+  for (const auto& scale : scales) {
+    hasher.update_value(scale.length).update_value(static_cast<int>(scale.window));
+  }
+  return hasher.finish();
+}
+
+// Radii of the three boxes whose variances sum closest to sigma^2 (each
+// box of odd width w adds (w^2 - 1) / 12), the narrower ones first
+std::vector<int> gaussianRadii(double sigma) {
+  const double variance = 12.0 * sigma * sigma;
+  int lower = static_cast<int>(std::floor(std::sqrt(variance / 3.0 + 1.0)));
+  if (lower % 2 == 0) {
+    --lower;
+  }
+  const int narrow = std::clamp(static_cast<int>(std::lround((variance - 3.0 * lower * lower - 12.0 * lower - 9.0) /
+                                                             (-4.0 * lower - 4.0))),
+                                0, 3);
+  std::vector<int> radii;
+  for (int pass = 0; pass < 3; ++pass) {
+    const int width = pass < narrow ? lower : lower + 2;
+    radii.push_back((width - 1) / 2);
+  }
+  return radii;
+}
+
+} // namespace
+
+Eigen::ArrayXXd PatternDensity::boxMean(const Eigen::Ref<const Eigen::ArrayXXd>& field, int radius) {
+  if (radius < 0) {
+    throw std::invalid_argument("PatternDensity: box radius must not be negative");
+  }
+  const int rows = static_cast<int>(field.rows());
+  const int cols = static_cast<int>(field.cols());
+  radius = std::min(radius, std::max(rows, cols)); // Any wider covers the whole grid anyway
+
+  // table(i, j) sums field over rows [0, i) and columns [0, j)
+  Eigen::ArrayXXd table = Eigen::ArrayXXd::Zero(rows + 1, cols + 1);
+#pragma omp parallel for
+  for (int j = 0; j < cols; ++j) {
+    double running = 0.0;
+    for (int i = 0; i < rows; ++i) {
+      running += field(i, j);
+      table(i + 1, j + 1) = running;
+    }
+  }
+  for (int j = 1; j <= cols; ++j) {
+    table.col(j) += table.col(j - 1);
+  }
+
+  Eigen::ArrayXXd mean(rows, cols);
+#pragma omp parallel for
+  for (int j = 0; j < cols; ++j) {
+    const int j0 = std::max(0, j - radius);
+    const int j1 = std::min(cols, j + radius + 1);
+    for (int i = 0; i < rows; ++i) {
+      const int i0 = std::max(0, i - radius);
+      const int i1 = std::min(rows, i + radius + 1);
+      const double sum = table(i1, j1) - table(i0, j1) - table(i1, j0) + table(i0, j0);
+      mean(i, j) = sum / (static_cast<double>(i1 - i0) * (j1 - j0));
+    }
+  }
+  return mean;
+}
+
+Eigen::ArrayXXd PatternDensity::density(const BitMask& mask, const Scale& scale) {
+  if (mask.empty()) {
+    throw std::invalid_argument("PatternDensity: mask is empty");
+  }
+  if (!(scale.length >= 0.0)) {
+    throw std::invalid_argument("PatternDensity: length must not be negative");
+  }
+  // Lengths past the grid's size all mean the whole grid
+  const double length = std::min(scale.length, static_cast<double>(std::max(mask.rows(), mask.cols())));
+  Eigen::ArrayXXd field = mask.toField();
+  if (scale.window == Window::kBox) {
+    return boxMean(field, static_cast<int>(std::lround(length)));
+  }
+  for (int radius : gaussianRadii(length)) {
+    if (radius > 0) {
+      field = boxMean(field, radius);
+    }
+  }
+  return field;
+}
+
+PatternDensity::Maps PatternDensity::maps(const BitMask& mask, const std::vector<Scale>& scales) {
+  const SemiPRO::CacheKey key = maskKey(mask, scales);
+  Cache& shared = cache();
+  Maps found;
+  {
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    auto it = shared.slots.find(key);
+    if (it != shared.slots.end()) {
+      shared.lru.splice(shared.lru.begin(), shared.lru, it->second.lru);
+      found = it->second.maps;
+    }
+  }
+  Profiler::getInstance().recordCacheAccess("PatternDensity", found != nullptr);
+  if (found) {
+    return found;
+  }
+
+  std::vector<Eigen::ArrayXXd> computed;
+  computed.reserve(scales.size());
+  for (const auto& scale : scales) {
+    computed.push_back(density(mask, scale));
+  }
+  auto maps = std::make_shared<const std::vector<Eigen::ArrayXXd>>(std::move(computed));
+  const std::size_t bytes =
+      scales.size() * static_cast<std::size_t>(mask.rows()) * static_cast<std::size_t>(mask.cols()) * sizeof(double);
+
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  auto it = shared.slots.find(key);
+  if (it != shared.slots.end()) {
+    return it->second.maps;
+  }
+  if (bytes > shared.budget) {
+    return maps;
+  }
+  shared.lru.push_front(key);
+  shared.slots.emplace(key, Cache::Slot{maps, bytes, shared.lru.begin()});
+  shared.bytes += bytes;
+  shared.trim();
+  return maps;
+}
+
+void PatternDensity::setMemoryBudget(std::size_t bytes) {
+  Cache& shared = cache();
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  shared.budget = bytes;
+  shared.trim();
+}
+
+void PatternDensity::clearCache() {
+  Cache& shared = cache();
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  shared.slots.clear();
+  shared.lru.clear();
+  shared.bytes = 0;
+}
@@ -0,0 +1,41 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "bit_mask.hpp"
+#include <Eigen/Dense>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Local pattern density of a mask: the fraction of set cells in a window
+// about each cell, for etch loading and CMP.
+//
+// A box is read off a summed-area table of the mask, so it costs the same
+// whatever its size; a Gaussian is three boxes in a row whose widths add up
+// to its variance. Windows are cut off at the grid's edge and average only
+// the cells inside it. The same reticle is read at the same few length
+// scales by every etch and polish step of a lot, so maps() keeps what it
+// computed in a process-wide cache keyed by the mask's content and the
+// scales, evicting least recently used maps past a memory budget. Hits and
+// misses go to the profiler as PatternDensity.
+class PatternDensity {
+public:
+  enum class Window { kBox, kGaussian };
+  struct Scale {
+    double length;                     // Cells: the box's half width, or the Gaussian's sigma
+    Window window = Window::kGaussian;
+  };
+  using Maps = std::shared_ptr<const std::vector<Eigen::ArrayXXd>>;
+
+  // Mean of field over the (2 radius + 1)^2 box about each cell; throws
+  // std::invalid_argument for a negative radius
+  static Eigen::ArrayXXd boxMean(const Eigen::Ref<const Eigen::ArrayXXd>& field, int radius);
+  // Density of mask at one scale; throws std::invalid_argument for an
+  // empty mask or a negative length
+  static Eigen::ArrayXXd density(const BitMask& mask, const Scale& scale);
+  // density() at each scale in turn, shared with every other caller
+  // asking for the same mask and scales
+  static Maps maps(const BitMask& mask, const std::vector<Scale>& scales);
+
+  static void setMemoryBudget(std::size_t bytes);
+  static void clearCache();
+};
@@ -1,11 +1,17 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "performance_utils.hpp"
+#include "autotuner.hpp"
 #include "utils.hpp"
+#include "stencil.hpp"
+#include "stencil_kernel.hpp"
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
 #include <omp.h>
 
 namespace SemiPRO {
@@ -42,7 +48,37 @@ void OptimizedSolver::reserve_matrix_memory(int expected_nonzeros_per_row) {
     system_matrix_.reserve(Eigen::VectorXi::Constant(n_rows_, expected_nonzeros_per_row));
 }
 
+void OptimizedSolver::use_grid_operator(const Eigen::ArrayXXd& conductivity) {
+    grid_solver_ = std::make_unique<MultigridSolver>(conductivity);
+}
+
 void OptimizedSolver::solve_system(const Eigen::VectorXd& rhs) {
+    if (grid_solver_) {
+        if (rhs.size() != grid_solver_->rows() * grid_solver_->cols()) {
+            throw std::invalid_argument("Right-hand side does not match the grid");
+        }
+        const Eigen::Map<const Eigen::ArrayXXd> grid(rhs.data(), grid_solver_->rows(), grid_solver_->cols());
+        Eigen::ArrayXXd u = grid;
+        MultigridSolver::Options options;
+        options.mixed_precision = mixed_precision_;
+        if (tuned_precision_) {
+            auto variant = [&](bool mixed) {
+                return [&, mixed] {
+                    Eigen::ArrayXXd trial = grid;
+                    MultigridSolver::Options trial_options;
+                    trial_options.mixed_precision = mixed;
+                    grid_solver_->solve(trial, grid, trial_options);
+                };
+            };
+            options.mixed_precision = Autotuner::getInstance().select(
+                "multigrid_precision", static_cast<size_t>(grid.size()),
+                {{"double", variant(false)}, {"mixed", variant(true)}}) == "mixed";
+        }
+        grid_solver_->solve(u, grid, options);
+        solution_vector_ = Eigen::Map<const Eigen::VectorXd>(u.data(), u.size());
+        return;
+    }
+    
     Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
     solver.compute(system_matrix_);
     
@@ -57,79 +93,326 @@ void OptimizedSolver::solve_system(const Eigen::VectorXd& rhs) {
     }
 }
 
-// SimulationCache Implementation
-SimulationCache::SimulationCache(const std::string& cache_dir, size_t max_size)
-    : cache_dir_(cache_dir), max_cache_size_(max_size) {
-    std::filesystem::create_directories(cache_dir_);
+// ContentHasher Implementation
+namespace {
+
+constexpr std::uint64_t kMurmurC1 = 0x87c37b91114253d5ULL;
+constexpr std::uint64_t kMurmurC2 = 0x4cf5ad432745937fULL;
+
+inline std::uint64_t rotl64(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline std::uint64_t fmix64(std::uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
 }
 
-std::string SimulationCache::get_cache_key(const std::unordered_map<std::string, double>& params) {
-    std::string param_str;
-    for (const auto& [key, value] : params) {
-        param_str += key + ":" + std::to_string(value) + ";";
+} // namespace
+
+std::string CacheKey::to_hex() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(32, '0');
+    for (int i = 0; i < 16; ++i) {
+        hex[15 - i] = digits[(high >> (4 * i)) & 0xf];
+        hex[31 - i] = digits[(low >> (4 * i)) & 0xf];
     }
-    
-    // Simple hash function (in production, use proper hash like MD5)
-    std::hash<std::string> hasher;
-    return std::to_string(hasher(param_str));
+    return hex;
 }
 
-bool SimulationCache::has_cached_result(const std::string& cache_key) {
-    std::string cache_file = cache_dir_ + "/" + cache_key + ".dat";
-    return std::filesystem::exists(cache_file);
+void ContentHasher::mix_block(const unsigned char* block) {
+    std::uint64_t k1;
+    std::uint64_t k2;
+    std::memcpy(&k1, block, 8);
+    std::memcpy(&k2, block + 8, 8);
+
+    k1 *= kMurmurC1; k1 = rotl64(k1, 31); k1 *= kMurmurC2; h1_ ^= k1;
+    h1_ = rotl64(h1_, 27); h1_ += h2_; h1_ = h1_ * 5 + 0x52dce729;
+    k2 *= kMurmurC2; k2 = rotl64(k2, 33); k2 *= kMurmurC1; h2_ ^= k2;
+    h2_ = rotl64(h2_, 31); h2_ += h1_; h2_ = h2_ * 5 + 0x38495ab5;
 }
 
-bool SimulationCache::load_cached_result(const std::string& cache_key, std::vector<double>& result) {
-    std::string cache_file = cache_dir_ + "/" + cache_key + ".dat";
-    
-    if (!std::filesystem::exists(cache_file)) {
-        return false;
+ContentHasher& ContentHasher::update(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    length_ += size;
+    if (tail_size_ > 0) {
+        size_t n = std::min(size, sizeof(tail_) - tail_size_);
+        std::memcpy(tail_ + tail_size_, bytes, n);
+        tail_size_ += n;
+        bytes += n;
+        size -= n;
+        if (tail_size_ < sizeof(tail_)) {
+            return *this;
+        }
+        mix_block(tail_);
+        tail_size_ = 0;
     }
-    
-    std::ifstream file(cache_file, std::ios::binary);
-    if (!file.is_open()) {
+    for (; size >= 16; bytes += 16, size -= 16) {
+        mix_block(bytes);
+    }
+    std::memcpy(tail_, bytes, size);
+    tail_size_ = size;
+    return *this;
+}
+
+ContentHasher& ContentHasher::update_string(const std::string& value) {
+    update_value(static_cast<std::uint64_t>(value.size()));
+    return update(value.data(), value.size());
+}
+
+CacheKey ContentHasher::finish() const {
+    std::uint64_t h1 = h1_;
+    std::uint64_t h2 = h2_;
+    std::uint64_t k1 = 0;
+    std::uint64_t k2 = 0;
+    for (size_t i = tail_size_; i > 8; --i) {
+        k2 = (k2 << 8) | tail_[i - 1];
+    }
+    for (size_t i = std::min<size_t>(tail_size_, 8); i > 0; --i) {
+        k1 = (k1 << 8) | tail_[i - 1];
+    }
+    if (tail_size_ > 8) {
+        k2 *= kMurmurC2; k2 = rotl64(k2, 33); k2 *= kMurmurC1; h2 ^= k2;
+    }
+    if (tail_size_ > 0) {
+        k1 *= kMurmurC1; k1 = rotl64(k1, 31); k1 *= kMurmurC2; h1 ^= k1;
+    }
+
+    h1 ^= length_;
+    h2 ^= length_;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+    return CacheKey{h1, h2};
+}
+
+// SimulationCache Implementation
+namespace {
+
+// File layout: magic, u64 payload bytes, key (high, low), payload,
+// u64 checksum of the payload
+constexpr char kStepMagic[8] = {'S', 'P', 'R', 'O', 'S', 'T', 'E', 'P'};
+
+bool parse_key(const std::string& hex, CacheKey& key) {
+    if (hex.size() != 32) {
         return false;
     }
-    
-    size_t size;
-    file.read(reinterpret_cast<char*>(&size), sizeof(size));
-    
-    result.resize(size);
-    file.read(reinterpret_cast<char*>(result.data()), size * sizeof(double));
-    
+    std::uint64_t parts[2] = {0, 0};
+    for (size_t i = 0; i < 32; ++i) {
+        char c = hex[i];
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (digit < 0) {
+            return false;
+        }
+        parts[i / 16] = (parts[i / 16] << 4) | static_cast<std::uint64_t>(digit);
+    }
+    key.high = parts[0];
+    key.low = parts[1];
     return true;
 }
 
-void SimulationCache::save_result(const std::string& cache_key, const std::vector<double>& result) {
-    std::string cache_file = cache_dir_ + "/" + cache_key + ".dat";
-    
-    std::ofstream file(cache_file, std::ios::binary);
-    if (!file.is_open()) {
+} // namespace
+
+SimulationCache::SimulationCache(const std::string& cache_dir, size_t max_size, size_t memory_budget)
+    : cache_dir_(cache_dir), max_cache_size_(max_size), memory_budget_(memory_budget) {
+    if (cache_dir_.empty()) {
         return;
     }
-    
-    size_t size = result.size();
-    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
-    file.write(reinterpret_cast<const char*>(result.data()), size * sizeof(double));
-    
-    cache_index_[cache_key] = cache_file;
+    std::filesystem::create_directories(cache_dir_);
+
+    // Index what earlier runs left, oldest first
+    std::vector<std::pair<std::filesystem::file_time_type, std::pair<CacheKey, size_t>>> found;
+    for (const auto& entry : std::filesystem::directory_iterator(cache_dir_)) {
+        CacheKey key;
+        if (entry.is_regular_file() && entry.path().extension() == ".step" &&
+            parse_key(entry.path().stem().string(), key)) {
+            found.push_back({entry.last_write_time(), {key, static_cast<size_t>(entry.file_size())}});
+        }
+    }
+    std::sort(found.begin(), found.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (const auto& item : found) {
+        disk_[item.second.first] = DiskEntry{item.second.second, ++use_clock_};
+        disk_bytes_ += item.second.second;
+    }
+    trim_disk();
 }
 
-void SimulationCache::clear_cache() {
-    for (const auto& [key, file] : cache_index_) {
-        std::filesystem::remove(file);
+std::string SimulationCache::file_for(const CacheKey& key) const {
+    return cache_dir_ + "/" + key.to_hex() + ".step";
+}
+
+SimulationCache::Value SimulationCache::read_file(const CacheKey& key) const {
+    std::ifstream file(file_for(key), std::ios::binary);
+    char magic[sizeof(kStepMagic)];
+    std::uint64_t size = 0;
+    CacheKey stored;
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kStepMagic, sizeof(magic)) != 0 ||
+        !file.read(reinterpret_cast<char*>(&size), sizeof(size)) ||
+        !file.read(reinterpret_cast<char*>(&stored.high), sizeof(stored.high)) ||
+        !file.read(reinterpret_cast<char*>(&stored.low), sizeof(stored.low)) || stored != key ||
+        size > std::numeric_limits<size_t>::max()) {
+        return nullptr;
+    }
+    auto value = std::make_shared<std::vector<unsigned char>>(static_cast<size_t>(size));
+    std::uint64_t checksum = 0;
+    if (!file.read(reinterpret_cast<char*>(value->data()), static_cast<std::streamsize>(size)) ||
+        !file.read(reinterpret_cast<char*>(&checksum), sizeof(checksum)) ||
+        ContentHasher().update(value->data(), value->size()).finish().low != checksum) {
+        return nullptr;
     }
-    cache_index_.clear();
+    return value;
 }
 
-size_t SimulationCache::get_cache_size() {
-    size_t total_size = 0;
-    for (const auto& [key, file] : cache_index_) {
-        if (std::filesystem::exists(file)) {
-            total_size += std::filesystem::file_size(file);
+void SimulationCache::write_file(const CacheKey& key, const std::vector<unsigned char>& value) const {
+    // Written aside and renamed, so readers never see a partial file
+    const std::string path = file_for(key);
+    const std::string temp = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        std::uint64_t size = value.size();
+        std::uint64_t checksum = ContentHasher().update(value.data(), value.size()).finish().low;
+        file.write(kStepMagic, sizeof(kStepMagic));
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char*>(&key.high), sizeof(key.high));
+        file.write(reinterpret_cast<const char*>(&key.low), sizeof(key.low));
+        file.write(reinterpret_cast<const char*>(value.data()), static_cast<std::streamsize>(value.size()));
+        file.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        if (!file) {
+            throw std::runtime_error("Cannot write cache entry: " + temp);
+        }
+    }
+    std::filesystem::rename(temp, path);
+}
+
+SimulationCache::Value SimulationCache::lookup(const CacheKey& key) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = memory_.find(key);
+        if (it != memory_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            auto disk = disk_.find(key);
+            if (disk != disk_.end()) {
+                disk->second.last_used = ++use_clock_;
+            }
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return it->second.value;
+        }
+        auto disk = disk_.find(key);
+        if (disk == disk_.end()) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
         }
+        disk->second.last_used = ++use_clock_;
+    }
+
+    Value value = read_file(key);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!value) {
+        // Unreadable or removed behind our back
+        auto disk = disk_.find(key);
+        if (disk != disk_.end()) {
+            disk_bytes_ -= disk->second.size;
+            disk_.erase(disk);
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    remember(key, value);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return value;
+}
+
+void SimulationCache::store(const CacheKey& key, std::vector<unsigned char> value) {
+    Value shared = std::make_shared<const std::vector<unsigned char>>(std::move(value));
+    size_t file_size = 0;
+    if (!cache_dir_.empty()) {
+        write_file(key, *shared);
+        file_size = static_cast<size_t>(std::filesystem::file_size(file_for(key)));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    remember(key, shared);
+    if (!cache_dir_.empty()) {
+        DiskEntry& entry = disk_[key];
+        disk_bytes_ += file_size - entry.size;
+        entry.size = file_size;
+        entry.last_used = ++use_clock_;
+        trim_disk();
     }
-    return total_size;
+}
+
+void SimulationCache::remember(const CacheKey& key, Value value) {
+    auto it = memory_.find(key);
+    if (it != memory_.end()) {
+        memory_bytes_ -= it->second.value->size();
+        lru_.erase(it->second.lru);
+        memory_.erase(it);
+    }
+    if (value->size() > memory_budget_) {
+        return;
+    }
+    lru_.push_front(key);
+    memory_bytes_ += value->size();
+    memory_.emplace(key, MemoryEntry{std::move(value), lru_.begin()});
+    trim_memory();
+}
+
+void SimulationCache::trim_memory() {
+    while (memory_bytes_ > memory_budget_ && !lru_.empty()) {
+        auto it = memory_.find(lru_.back());
+        memory_bytes_ -= it->second.value->size();
+        memory_.erase(it);
+        lru_.pop_back();
+    }
+}
+
+void SimulationCache::trim_disk() {
+    while (disk_bytes_ > max_cache_size_ && !disk_.empty()) {
+        auto oldest = std::min_element(disk_.begin(), disk_.end(), [](const auto& a, const auto& b) {
+            return a.second.last_used < b.second.last_used;
+        });
+        std::error_code ignored;
+        std::filesystem::remove(file_for(oldest->first), ignored);
+        disk_bytes_ -= oldest->second.size;
+        disk_.erase(oldest);
+    }
+}
+
+void SimulationCache::set_memory_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memory_budget_ = bytes;
+    trim_memory();
+}
+
+void SimulationCache::clear_cache() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : disk_) {
+        std::error_code ignored;
+        std::filesystem::remove(file_for(entry.first), ignored);
+    }
+    disk_.clear();
+    disk_bytes_ = 0;
+    memory_.clear();
+    lru_.clear();
+    memory_bytes_ = 0;
+}
+
+size_t SimulationCache::get_cache_size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return disk_bytes_;
+}
+
+size_t SimulationCache::get_memory_usage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memory_bytes_;
 }
 
 // PerformanceProfiler Implementation
@@ -177,25 +460,156 @@ void PerformanceProfiler::reset_profile() {
     call_counts_.clear();
 }
 
-// VectorizedOps Implementation
-void VectorizedOps::diffusion_step_2d(Eigen::MatrixXd& concentration, 
-                                     double diffusivity, double dt, double dx) {
-    int rows = concentration.rows();
-    int cols = concentration.cols();
-    Eigen::MatrixXd new_concentration = concentration;
-    
-    #pragma omp parallel for collapse(2)
-    for (int i = 1; i < rows - 1; ++i) {
-        for (int j = 1; j < cols - 1; ++j) {
-            double laplacian = (concentration(i+1, j) + concentration(i-1, j) +
-                               concentration(i, j+1) + concentration(i, j-1) -
-                               4.0 * concentration(i, j)) / (dx * dx);
-            
-            new_concentration(i, j) = concentration(i, j) + dt * diffusivity * laplacian;
+// SmallObjectPool Implementation
+namespace {
+
+constexpr size_t kSlabBytes = 64 * 1024;
+
+} // namespace
+
+SmallObjectPool& SmallObjectPool::instance() {
+    // Never destroyed: threads that exit during static destruction still
+    // return their caches here
+    static SmallObjectPool* pool = new SmallObjectPool();
+    return *pool;
+}
+
+SmallObjectPool::ThreadCache* SmallObjectPool::thread_cache() {
+    // Only a pointer and a flag, which need no destruction, so thread_local
+    // destructors that run after the owner below can still read them
+    thread_local ThreadCache* cache = nullptr;
+    thread_local bool torn_down = false;
+    if (cache || torn_down) {
+        return cache;
+    }
+    struct Owner {
+        ~Owner() {
+            ThreadCache* owned = cache;
+            cache = nullptr;
+            torn_down = true;
+            instance().release(*owned);
+            delete owned;
+        }
+    };
+    thread_local Owner owner;
+    cache = new ThreadCache();
+    return cache;
+}
+
+void SmallObjectPool::release(ThreadCache& cache) {
+    for (size_t c = 0; c < CLASS_COUNT; ++c) {
+        if (cache.counts[c] > 0) {
+            give_back(c, {cache.heads[c], cache.counts[c]});
+            cache.heads[c] = nullptr;
+            cache.counts[c] = 0;
         }
     }
-    
-    concentration = new_concentration;
+}
+
+void* SmallObjectPool::allocate(size_t size, size_t alignment) {
+    if (!is_pooled(size, alignment)) {
+        return ::operator new(size, std::align_val_t(std::max(alignment, alignof(std::max_align_t))));
+    }
+    const size_t c = (size - 1) / GRANULARITY;
+    ThreadCache* cache = thread_cache();
+    if (!cache) {
+        // Called after this thread's cache was torn down
+        Batch batch = refill(c);
+        if (batch.count > 1) {
+            give_back(c, {batch.head->next, batch.count - 1});
+        }
+        return batch.head;
+    }
+    if (!cache->heads[c]) {
+        Batch batch = refill(c);
+        cache->heads[c] = batch.head;
+        cache->counts[c] = batch.count;
+    }
+    FreeBlock* block = cache->heads[c];
+    cache->heads[c] = block->next;
+    cache->counts[c]--;
+    return block;
+}
+
+void SmallObjectPool::deallocate(void* ptr, size_t size, size_t alignment) noexcept {
+    if (!ptr) {
+        return;
+    }
+    if (!is_pooled(size, alignment)) {
+        ::operator delete(ptr, std::align_val_t(std::max(alignment, alignof(std::max_align_t))));
+        return;
+    }
+    const size_t c = (size - 1) / GRANULARITY;
+    ThreadCache* cache = thread_cache();
+    auto* block = static_cast<FreeBlock*>(ptr);
+    if (!cache) {
+        // Called after this thread's cache was torn down
+        block->next = nullptr;
+        give_back(c, {block, 1});
+        return;
+    }
+    block->next = cache->heads[c];
+    cache->heads[c] = block;
+    if (++cache->counts[c] < 2 * BATCH_SIZE) {
+        return;
+    }
+
+    // Keep one batch locally and hand the other to the depot
+    FreeBlock* tail = cache->heads[c];
+    for (size_t i = 1; i < BATCH_SIZE; ++i) {
+        tail = tail->next;
+    }
+    Batch batch{cache->heads[c], BATCH_SIZE};
+    cache->heads[c] = tail->next;
+    cache->counts[c] -= BATCH_SIZE;
+    tail->next = nullptr;
+    give_back(c, batch);
+}
+
+void SmallObjectPool::flush_thread_cache() {
+    if (ThreadCache* cache = thread_cache()) {
+        release(*cache);
+    }
+}
+
+SmallObjectPool::Batch SmallObjectPool::refill(size_t size_class) {
+    SizeClass& sc = classes_[size_class];
+    std::lock_guard<std::mutex> lock(sc.mutex);
+    if (!sc.batches.empty()) {
+        Batch batch = sc.batches.back();
+        sc.batches.pop_back();
+        return batch;
+    }
+
+    // Carve a fresh batch; the unused tail of a slab is abandoned
+    const size_t block_size = (size_class + 1) * GRANULARITY;
+    if (static_cast<size_t>(sc.end - sc.cursor) < block_size * BATCH_SIZE) {
+        sc.cursor = static_cast<char*>(::operator new(kSlabBytes, std::align_val_t(64)));
+        sc.end = sc.cursor + kSlabBytes;
+        reserved_bytes_.fetch_add(kSlabBytes, std::memory_order_relaxed);
+    }
+    FreeBlock* head = nullptr;
+    for (size_t i = BATCH_SIZE; i-- > 0;) {
+        auto* block = reinterpret_cast<FreeBlock*>(sc.cursor + i * block_size);
+        block->next = head;
+        head = block;
+    }
+    sc.cursor += block_size * BATCH_SIZE;
+    return {head, BATCH_SIZE};
+}
+
+void SmallObjectPool::give_back(size_t size_class, Batch batch) {
+    SizeClass& sc = classes_[size_class];
+    std::lock_guard<std::mutex> lock(sc.mutex);
+    sc.batches.push_back(batch);
+}
+
+// VectorizedOps Implementation
+void VectorizedOps::diffusion_step_2d(Eigen::MatrixXd& concentration,
+                                     double diffusivity, double dt, double dx, int steps) {
+    ExplicitStencil stencil(ExplicitStencil::diffusion(diffusivity * dt / (dx * dx)), ExplicitStencil::Edges::Fixed);
+    stencil.apply(concentration.data(), static_cast<int>(concentration.rows()),
+                  static_cast<int>(concentration.cols()), steps);
 }
 
 void VectorizedOps::apply_boundary_conditions(Eigen::MatrixXd& grid, 
@@ -225,8 +639,8 @@ double VectorizedOps::compute_laplacian_at_point(const Eigen::MatrixXd& grid,
         return 0.0; // Boundary point
     }
     
-    return (grid(i+1, j) + grid(i-1, j) + grid(i, j+1) + grid(i, j-1) - 
-            4.0 * grid(i, j)) / (dx * dx);
+    return Stencil::at<Stencil::Clamp>(Stencil::Laplacian(), grid.data(), grid.rows(), grid.rows(), grid.cols(), i, j) /
+           (dx * dx);
 }
 
 void VectorizedOps::parallel_matrix_operation(Eigen::MatrixXd& matrix,
@@ -3,12 +3,23 @@
 
 #include <string>
 #include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <vector>
 #include <chrono>
 #include <unordered_map>
 #include <functional>
 #include <fstream>
+#include <list>
+#include <type_traits>
 #include <Eigen/Sparse>
 #include <Eigen/Dense>
+#include "multigrid.hpp"
+#include "adaptive_mesh.hpp"
 
 namespace SemiPRO {
 
@@ -21,6 +32,9 @@ private:
     Eigen::VectorXd solution_vector_;
     int n_rows_;
     bool memory_mapped_;
+    std::unique_ptr<MultigridSolver> grid_solver_;
+    bool mixed_precision_ = false;
+    bool tuned_precision_ = false;
     
 public:
     OptimizedSolver(int rows, int cols);
@@ -31,28 +45,129 @@ public:
     void reserve_matrix_memory(int expected_nonzeros_per_row = 7);
     void solve_system(const Eigen::VectorXd& rhs);
     
+    // Solves the diffusion stencil of a conductivity grid instead of the
+    // system matrix: solve_system then takes the grid column-major, with
+    // the outer ring's fixed values and the interior's sources, and leaves
+    // the solution in the same layout. The matrix is not used until
+    // use_system_matrix.
+    void use_grid_operator(const Eigen::ArrayXXd& conductivity);
+    void use_system_matrix() { grid_solver_.reset(); }
+    // Runs the grid operator's multigrid cycles in single precision, with
+    // the residual and solution kept in double
+    void use_mixed_precision(bool enable) { mixed_precision_ = enable; }
+    // Leaves that choice to the Autotuner, which times both on the first
+    // solve of the grid's size class on this machine
+    void use_tuned_precision(bool enable) { tuned_precision_ = enable; }
+    
     Eigen::SparseMatrix<double>& get_system_matrix() { return system_matrix_; }
     const Eigen::VectorXd& get_solution() const { return solution_vector_; }
 };
 
 /**
- * @brief Simulation result caching system
+ * @brief 128-bit content hash
+ *
+ * Streaming MurmurHash3 (x64, 128-bit): fast enough to run over a whole
+ * wafer state on every process step, with accidental collisions out of
+ * reach for any realistic number of cache entries. It is not meant to
+ * resist deliberately crafted inputs.
+ */
+struct CacheKey {
+    std::uint64_t high = 0;
+    std::uint64_t low = 0;
+
+    bool operator==(const CacheKey& other) const { return high == other.high && low == other.low; }
+    bool operator!=(const CacheKey& other) const { return !(*this == other); }
+    std::string to_hex() const;
+};
+
+struct CacheKeyHash {
+    size_t operator()(const CacheKey& key) const { return static_cast<size_t>(key.low); }
+};
+
+class ContentHasher {
+public:
+    explicit ContentHasher(std::uint64_t seed = 0) : h1_(seed), h2_(seed) {}
+
+    ContentHasher& update(const void* data, size_t size);
+    template <typename T>
+    ContentHasher& update_value(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Hashed values must be trivially copyable");
+        return update(&value, sizeof(T));
+    }
+    // Length-prefixed, so consecutive strings cannot run into each other
+    ContentHasher& update_string(const std::string& value);
+    CacheKey finish() const;
+
+private:
+    void mix_block(const unsigned char* block);
+
+    std::uint64_t h1_;
+    std::uint64_t h2_;
+    unsigned char tail_[16] = {};
+    size_t tail_size_ = 0;
+    std::uint64_t length_ = 0;
+};
+
+/**
+ * @brief Content-addressed result cache
+ *
+ * Values are opaque byte strings filed under the hash of whatever
+ * produced them. Recently used values stay in memory within a byte
+ * budget; with a cache directory every value is also written to
+ * `<dir>/<key>.step`, so a value evicted from memory, or stored by an
+ * earlier run, is read back from disk. The disk store is trimmed to
+ * max_size bytes, least recently used first. Thread-safe.
  */
 class SimulationCache {
+public:
+    using Value = std::shared_ptr<const std::vector<unsigned char>>;
+
+    // An empty cache_dir keeps the cache in memory only
+    SimulationCache(const std::string& cache_dir = "cache", size_t max_size = 1024*1024*1024, // 1GB default
+                    size_t memory_budget = 256*1024*1024);
+
+    // Null on a miss
+    Value lookup(const CacheKey& key);
+    void store(const CacheKey& key, std::vector<unsigned char> value);
+
+    void set_memory_budget(size_t bytes);
+    void clear_cache();
+    size_t get_cache_size();                    // Bytes on disk
+    size_t get_memory_usage() const;
+    size_t get_hit_count() const { return hits_.load(std::memory_order_relaxed); }
+    size_t get_miss_count() const { return misses_.load(std::memory_order_relaxed); }
+
 private:
+    struct MemoryEntry {
+        Value value;
+        std::list<CacheKey>::iterator lru;
+    };
+    struct DiskEntry {
+        size_t size;
+        std::uint64_t last_used;
+    };
+
+    std::string file_for(const CacheKey& key) const;
+    Value read_file(const CacheKey& key) const;
+    void write_file(const CacheKey& key, const std::vector<unsigned char>& value) const;
+    void remember(const CacheKey& key, Value value);   // Caller holds mutex_
+    void trim_memory();                                 // Caller holds mutex_
+    void trim_disk();                                   // Caller holds mutex_
+
     std::string cache_dir_;
-    std::unordered_map<std::string, std::string> cache_index_;
     size_t max_cache_size_;
-    
-public:
-    SimulationCache(const std::string& cache_dir = "cache", size_t max_size = 1024*1024*1024); // 1GB default
-    
-    std::string get_cache_key(const std::unordered_map<std::string, double>& params);
-    bool has_cached_result(const std::string& cache_key);
-    bool load_cached_result(const std::string& cache_key, std::vector<double>& result);
-    void save_result(const std::string& cache_key, const std::vector<double>& result);
-    void clear_cache();
-    size_t get_cache_size();
+    size_t memory_budget_;
+
+    mutable std::mutex mutex_;
+    std::list<CacheKey> lru_;                  // Most recently used first
+    std::unordered_map<CacheKey, MemoryEntry, CacheKeyHash> memory_;
+    size_t memory_bytes_ = 0;
+    std::unordered_map<CacheKey, DiskEntry, CacheKeyHash> disk_;
+    size_t disk_bytes_ = 0;
+    std::uint64_t use_clock_ = 0;
+
+    std::atomic<size_t> hits_{0};
+    std::atomic<size_t> misses_{0};
 };
 
 /**
@@ -74,24 +189,147 @@ public:
 };
 
 /**
- * @brief Memory pool for efficient allocation/deallocation
+ * @brief Size-class allocator for small objects
+ *
+ * Requests of up to MAX_SIZE bytes are rounded up to a multiple of
+ * GRANULARITY and served from per-thread free lists, without locking.
+ * An empty list is refilled with a batch of BATCH_SIZE blocks from a
+ * central depot, and a list that grows past two batches hands one back,
+ * so the depot lock is taken at most once per BATCH_SIZE operations.
+ * Larger or over-aligned requests go to operator new. Pooled memory is
+ * kept for reuse and never returned to the system. Blocks freed or taken
+ * by thread_local destructors that run after the thread's cache is gone
+ * go to the depot directly.
+ */
+class SmallObjectPool {
+public:
+    static constexpr size_t GRANULARITY = 16;
+    static constexpr size_t MAX_SIZE = 512;
+    static constexpr size_t CLASS_COUNT = MAX_SIZE / GRANULARITY;
+    static constexpr size_t BATCH_SIZE = 64;
+
+    static SmallObjectPool& instance();
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    void deallocate(void* ptr, size_t size, size_t alignment = alignof(std::max_align_t)) noexcept;
+
+    // Returns the calling thread's cached blocks to the depot; threads do
+    // this automatically when they exit
+    void flush_thread_cache();
+    size_t get_reserved_bytes() const { return reserved_bytes_.load(std::memory_order_relaxed); }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct Batch {
+        FreeBlock* head;
+        size_t count;
+    };
+
+    struct SizeClass {
+        std::mutex mutex;
+        std::vector<Batch> batches;
+        char* cursor = nullptr;
+        char* end = nullptr;
+    };
+
+    struct ThreadCache {
+        FreeBlock* heads[CLASS_COUNT] = {};
+        size_t counts[CLASS_COUNT] = {};
+    };
+
+    SmallObjectPool() = default;
+    // Null once the calling thread's cache has been torn down at exit
+    static ThreadCache* thread_cache();
+    void release(ThreadCache& cache);
+    static bool is_pooled(size_t size, size_t alignment) {
+        return size > 0 && size <= MAX_SIZE && alignment <= GRANULARITY;
+    }
+
+    Batch refill(size_t size_class);
+    void give_back(size_t size_class, Batch batch);
+
+    SizeClass classes_[CLASS_COUNT];
+    std::atomic<size_t> reserved_bytes_{0};
+};
+
+/**
+ * @brief Typed front end of the small-object pool for one object type
  */
 template<typename T>
 class MemoryPool {
+public:
+    // Uninitialized storage for one T
+    T* allocate() {
+        T* ptr = static_cast<T*>(SmallObjectPool::instance().allocate(sizeof(T), alignof(T)));
+        allocated_.fetch_add(1, std::memory_order_relaxed);
+        return ptr;
+    }
+
+    void deallocate(T* ptr) {
+        if (!ptr) return;
+        SmallObjectPool::instance().deallocate(ptr, sizeof(T), alignof(T));
+        allocated_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    template<typename... Args>
+    T* create(Args&&... args) {
+        T* ptr = allocate();
+        try {
+            return new(ptr) T(std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate(ptr);
+            throw;
+        }
+    }
+
+    void destroy(T* ptr) {
+        if (!ptr) return;
+        ptr->~T();
+        deallocate(ptr);
+    }
+
+    // Hands the calling thread's cached blocks back for other threads
+    void clear() { SmallObjectPool::instance().flush_thread_cache(); }
+    size_t get_allocated_count() const { return allocated_.load(std::memory_order_relaxed); }
+
 private:
-    std::vector<T*> free_blocks_;
-    std::vector<std::unique_ptr<T[]>> allocated_chunks_;
-    size_t block_size_;
-    size_t chunk_size_;
-    
+    std::atomic<size_t> allocated_{0};
+};
+
+/**
+ * @brief Stateless STL allocator backed by the small-object pool
+ *
+ * Suited to node-based containers (maps, lists, sets) and allocate_shared,
+ * whose nodes fall into the pooled size classes. Over-aligned element
+ * types such as vectorizable Eigen fixed-size matrices are handled too.
+ */
+template<typename T>
+class PoolAllocator {
 public:
-    MemoryPool(size_t chunk_size = 1024);
-    ~MemoryPool();
-    
-    T* allocate();
-    void deallocate(T* ptr);
-    void clear();
-    size_t get_allocated_count() const;
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(SmallObjectPool::instance().allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        SmallObjectPool::instance().deallocate(ptr, n * sizeof(T), alignof(T));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept { return false; }
 };
 
 /**
@@ -99,8 +337,11 @@ public:
  */
 class VectorizedOps {
 public:
-    static void diffusion_step_2d(Eigen::MatrixXd& concentration, 
-                                 double diffusivity, double dt, double dx);
+    // `steps` FTCS steps of the interior, the edges held fixed; the steps
+    // are temporally blocked (ExplicitStencil), so prefer one call with
+    // many steps to many calls with one
+    static void diffusion_step_2d(Eigen::MatrixXd& concentration,
+                                 double diffusivity, double dt, double dx, int steps = 1);
     
     static void apply_boundary_conditions(Eigen::MatrixXd& grid, 
                                         const std::string& bc_type,
@@ -113,30 +354,4 @@ public:
                                         std::function<double(double)> operation);
 };
 
-/**
- * @brief Adaptive mesh refinement for efficient computation
- */
-class AdaptiveMesh {
-private:
-    struct MeshNode {
-        double x, y;
-        double value;
-        int level;
-        std::vector<std::shared_ptr<MeshNode>> children;
-    };
-    
-    std::shared_ptr<MeshNode> root_;
-    int max_levels_;
-    double refinement_threshold_;
-    
-public:
-    AdaptiveMesh(double x_min, double x_max, double y_min, double y_max, 
-                int max_levels = 5, double threshold = 0.1);
-    
-    void refine_mesh(std::function<double(double, double)> value_function);
-    void coarsen_mesh();
-    std::vector<std::pair<double, double>> get_mesh_points();
-    void interpolate_to_regular_grid(Eigen::MatrixXd& grid);
-};
-
 } // namespace SemiPRO
@@ -0,0 +1,199 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "phase_correlation.hpp"
+#include "task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+// Targets per task of a batch
+constexpr int kTargetsPerTask = 8;
+
+// Offset of the peak from the middle of three samples along an axis: the
+// vertex of the parabola through their logarithms, exact for a sampled
+// Gaussian, or through the values themselves where one is not positive
+double peakOffset(double before, double middle, double after) {
+  if (before > 0.0 && middle > 0.0 && after > 0.0) {
+    const double lb = std::log(before), lm = std::log(middle), la = std::log(after);
+    const double curvature = lb - 2.0 * lm + la;
+    return curvature < 0.0 ? std::clamp(0.5 * (lb - la) / curvature, -1.0, 1.0) : 0.0;
+  }
+  const double curvature = before - 2.0 * middle + after;
+  return curvature < 0.0 ? std::clamp(0.5 * (before - after) / curvature, -1.0, 1.0) : 0.0;
+}
+
+} // namespace
+
+PhaseCorrelator::PhaseCorrelator(int size, std::shared_ptr<FftBackend> backend, double smoothing)
+    : size_(size), backend_(backend ? std::move(backend) : Fft::defaultBackend()) {
+  if (size < 4 || backend_->goodSize(size) != size) {
+    throw std::invalid_argument("Phase correlation window of " + std::to_string(size) +
+                                " pixels is not a length the " + backend_->name() + " FFT transforms");
+  }
+  if (!(smoothing > 0.0)) {
+    throw std::invalid_argument("Phase correlation smoothing must be positive");
+  }
+
+  std::vector<double> hann(size);
+  for (int i = 0; i < size; ++i) {
+    hann[i] = 0.5 - 0.5 * std::cos(2.0 * kPi * i / size);
+  }
+  taper_.resize(static_cast<std::size_t>(size) * size);
+  for (int r = 0; r < size; ++r) {
+    for (int c = 0; c < size; ++c) {
+      taper_[r * size + c] = hann[r] * hann[c];
+    }
+  }
+
+  // exp(-2 pi^2 s^2 |f|^2) transforms back to a Gaussian of s pixels; the
+  // surface of identical windows peaks at the mean weight of the full
+  // spectrum
+  auto weight = [&](int r, int c) {
+    const double fr = static_cast<double>(r <= size / 2 ? r : r - size) / size;
+    const double fc = static_cast<double>(c <= size / 2 ? c : c - size) / size;
+    return std::exp(-2.0 * kPi * kPi * smoothing * smoothing * (fr * fr + fc * fc));
+  };
+  const int half = size / 2 + 1;
+  lowpass_.resize(static_cast<std::size_t>(size) * half);
+  double total = 0.0;
+  for (int r = 0; r < size; ++r) {
+    for (int c = 0; c < size; ++c) {
+      total += weight(r, c);
+    }
+    for (int c = 0; c < half; ++c) {
+      lowpass_[r * half + c] = weight(r, c);
+    }
+  }
+  peak_scale_ = total / (static_cast<double>(size) * size);
+}
+
+PhaseCorrelator::Workspace PhaseCorrelator::makeWorkspace() const {
+  const std::size_t pixels = static_cast<std::size_t>(size_) * size_;
+  Workspace work;
+  work.reference.resize(pixels);
+  work.moving.resize(pixels);
+  work.surface.resize(pixels);
+  work.reference_spectrum.resize(lowpass_.size());
+  work.moving_spectrum.resize(lowpass_.size());
+  work.power.resize(lowpass_.size());
+  return work;
+}
+
+PhaseCorrelator::Shift PhaseCorrelator::correlate(Workspace& work) const {
+  const int n = size_;
+  const std::size_t pixels = taper_.size();
+  for (std::vector<double>* image : {&work.reference, &work.moving}) {
+    double mean = 0.0;
+    for (double value : *image) {
+      mean += value;
+    }
+    mean /= static_cast<double>(pixels);
+    for (std::size_t i = 0; i < pixels; ++i) {
+      (*image)[i] = ((*image)[i] - mean) * taper_[i];
+    }
+  }
+  backend_->forward(work.reference.data(), work.reference_spectrum.data(), n, n);
+  backend_->forward(work.moving.data(), work.moving_spectrum.data(), n, n);
+
+  // Normalized cross-power spectrum, moving against reference; entries
+  // with next to no power in either image carry no phase and are dropped
+  Complex* cross = work.moving_spectrum.data();
+  double largest = 0.0;
+  for (std::size_t k = 0; k < lowpass_.size(); ++k) {
+    cross[k] *= std::conj(work.reference_spectrum[k]);
+    largest = std::max(largest, std::abs(cross[k]));
+  }
+  const double floor = 1e-12 * largest;
+  for (std::size_t k = 0; k < lowpass_.size(); ++k) {
+    const double magnitude = std::abs(cross[k]);
+    work.power[k] = magnitude;
+    cross[k] = magnitude > floor ? cross[k] * (lowpass_[k] / magnitude) : Complex(0.0, 0.0);
+  }
+  backend_->inverse(cross, work.surface.data(), n, n);
+
+  const double* surface = work.surface.data();
+  const std::size_t top = std::max_element(work.surface.begin(), work.surface.end()) - work.surface.begin();
+  const int r0 = static_cast<int>(top / n);
+  const int c0 = static_cast<int>(top % n);
+  auto at = [&](int r, int c) { return surface[((r + n) % n) * n + (c + n) % n]; };
+  const double middle = at(r0, c0);
+
+  Shift shift;
+  shift.rows = r0 + peakOffset(at(r0 - 1, c0), middle, at(r0 + 1, c0));
+  shift.cols = c0 + peakOffset(at(r0, c0 - 1), middle, at(r0, c0 + 1));
+  // The surface is periodic; shifts past half a window are negative
+  if (shift.rows > 0.5 * n) {
+    shift.rows -= n;
+  }
+  if (shift.cols > 0.5 * n) {
+    shift.cols -= n;
+  }
+  shift.peak = middle / peak_scale_;
+
+  // The peak fit is exact for broadband images, but the taper leaks the
+  // few lines of a periodic target into every bin. Fit the plane of the
+  // cross-power phase left after the peak's shift instead, each bin
+  // weighed by its power, which the leakage barely has.
+  const int half = n / 2 + 1;
+  double frr = 0.0, frc = 0.0, fcc = 0.0, pr = 0.0, pc = 0.0;
+  for (int r = 0; r < n; ++r) {
+    const double fr = static_cast<double>(r <= n / 2 ? r : r - n) / n;
+    for (int c = 0; c < half; ++c) {
+      const std::size_t k = static_cast<std::size_t>(r) * half + c;
+      const double fc = static_cast<double>(c) / n;
+      const double weight = work.power[k] * lowpass_[k];
+      if (weight <= 0.0) {
+        continue;
+      }
+      const double phase = std::arg(cross[k] * std::polar(1.0, 2.0 * kPi * (fr * shift.rows + fc * shift.cols)));
+      frr += weight * fr * fr;
+      frc += weight * fr * fc;
+      fcc += weight * fc * fc;
+      pr += weight * fr * phase;
+      pc += weight * fc * phase;
+    }
+  }
+  const double determinant = frr * fcc - frc * frc;
+  if (determinant > 1e-12 * (frr * fcc) && determinant > 0.0) {
+    // phase = -2 pi (fr dr + fc dc) for a further shift (dr, dc)
+    const double dr = -(fcc * pr - frc * pc) / (2.0 * kPi * determinant);
+    const double dc = -(frr * pc - frc * pr) / (2.0 * kPi * determinant);
+    if (std::abs(dr) < 1.0 && std::abs(dc) < 1.0) {
+      shift.rows += dr;
+      shift.cols += dc;
+    }
+  }
+  return shift;
+}
+
+PhaseCorrelator::Shift PhaseCorrelator::registerImages(const double* reference, const double* moving) const {
+  Workspace work = makeWorkspace();
+  std::copy(reference, reference + taper_.size(), work.reference.begin());
+  std::copy(moving, moving + taper_.size(), work.moving.begin());
+  return correlate(work);
+}
+
+std::vector<PhaseCorrelator::Shift> PhaseCorrelator::registerBatch(std::size_t count, const WindowFill& fill) const {
+  std::vector<Shift> shifts(count);
+  TaskScheduler::getInstance().parallelFor(0, static_cast<int>(count), [&](int begin, int end) {
+    Workspace work = makeWorkspace();
+    for (int k = begin; k < end; ++k) {
+      fill(static_cast<std::size_t>(k), 0, 0, work.reference.data(), work.moving.data());
+      Shift shift = correlate(work);
+      // Again with the moving window following the whole pixels found
+      const int rows = static_cast<int>(std::lround(shift.rows));
+      const int cols = static_cast<int>(std::lround(shift.cols));
+      if (rows != 0 || cols != 0) {
+        fill(static_cast<std::size_t>(k), rows, cols, work.reference.data(), work.moving.data());
+        shift = correlate(work);
+        shift.rows += rows;
+        shift.cols += cols;
+      }
+      shifts[k] = shift;
+    }
+  }, kTargetsPerTask);
+  return shifts;
+}
@@ -0,0 +1,77 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef PHASE_CORRELATION_HPP
+#define PHASE_CORRELATION_HPP
+#include "fft.hpp"
+#include <complex>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Sub-pixel translation between two square images by phase correlation.
+// Both are made zero-mean and tapered by a Hann window, and the inverse
+// transform of their normalized cross-power spectrum peaks at the shift.
+// Before the inverse transform the spectrum is weighed by a Gaussian
+// low-pass, so the peak is a sampled Gaussian of smoothing pixels and a
+// three-point Gaussian fit through it along each axis places it to a
+// fraction of a pixel. A power-weighted fit of the plane of the remaining
+// cross-power phase then refines the shift, which keeps periodic targets,
+// whose few spectral lines the taper smears, as accurate as broadband
+// ones.
+//
+// The transforms go through an FftBackend, by default the one the
+// lithography engine uses, and the taper and low-pass weights are worked
+// out once per correlator. A batch of targets runs in parallel on the
+// TaskScheduler, each task reusing its image buffers and spectra from
+// target to target.
+class PhaseCorrelator {
+public:
+  using Complex = std::complex<double>;
+
+  struct Shift {
+    double rows = 0.0; // moving(r, c) ~ reference(r - rows, c - cols)
+    double cols = 0.0;
+    double peak = 0.0; // Correlation peak height, 1 for identical windows, near 0 for unrelated ones
+  };
+
+  // Fills the reference and moving windows of pair k, size x size each,
+  // row-major, the moving one taken (row_offset, col_offset) pixels
+  // further along its image
+  using WindowFill = std::function<void(std::size_t k, int row_offset, int col_offset, double* reference,
+                                        double* moving)>;
+
+  // Windows of size x size pixels; throws std::invalid_argument unless
+  // size is at least 4 and a length the backend transforms (goodSize), or
+  // smoothing is not positive
+  explicit PhaseCorrelator(int size, std::shared_ptr<FftBackend> backend = nullptr, double smoothing = 1.0);
+
+  int size() const { return size_; }
+  const FftBackend& backend() const { return *backend_; }
+
+  // Shift of moving against reference, both size x size, row-major
+  Shift registerImages(const double* reference, const double* moving) const;
+  // Shift of every pair the fill gives, in order. A pair found more than
+  // half a pixel apart is registered again with the moving window moved
+  // by the whole pixels, so the taper sees nearly the same content in
+  // both windows and the fraction comes out unbiased.
+  std::vector<Shift> registerBatch(std::size_t count, const WindowFill& fill) const;
+
+private:
+  struct Workspace {
+    std::vector<double> reference, moving, surface;
+    std::vector<Complex> reference_spectrum, moving_spectrum;
+    std::vector<double> power; // Cross-power magnitude of each half-spectrum entry
+  };
+
+  Workspace makeWorkspace() const;
+  // Registers the windows already in the workspace's image buffers
+  Shift correlate(Workspace& work) const;
+
+  int size_;
+  std::shared_ptr<FftBackend> backend_;
+  std::vector<double> taper_;   // Hann window, size x size
+  std::vector<double> lowpass_; // Gaussian weight of each half-spectrum entry
+  double peak_scale_;           // Surface height of identical windows
+};
+
+#endif // PHASE_CORRELATION_HPP
@@ -0,0 +1,62 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef PHILOX_HPP
+#define PHILOX_HPP
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Philox4x32-10 counter-based random numbers (Salmon et al., SC'11).
+//
+// Each 128-bit counter maps to four independent 32-bit words under a
+// 64-bit key, with no state carried between draws, so a kernel can give
+// sample n the counter n and get the same numbers whichever thread draws
+// it, in whatever order. Use the key for the seed and the counter's high
+// words to separate streams (one per run, say).
+class Philox4x32 {
+public:
+    using Counter = std::array<std::uint32_t, 4>;
+
+    explicit Philox4x32(std::uint64_t key)
+        : key0_(static_cast<std::uint32_t>(key)), key1_(static_cast<std::uint32_t>(key >> 32)) {}
+
+    Counter operator()(std::uint64_t low, std::uint64_t high = 0) const {
+        Counter c = {static_cast<std::uint32_t>(low), static_cast<std::uint32_t>(low >> 32),
+                     static_cast<std::uint32_t>(high), static_cast<std::uint32_t>(high >> 32)};
+        std::uint32_t k0 = key0_;
+        std::uint32_t k1 = key1_;
+        for (int round = 0; round < 10; ++round) {
+            const std::uint64_t p0 = static_cast<std::uint64_t>(kMultiplier0) * c[0];
+            const std::uint64_t p1 = static_cast<std::uint64_t>(kMultiplier1) * c[2];
+            c = {static_cast<std::uint32_t>(p1 >> 32) ^ c[1] ^ k0, static_cast<std::uint32_t>(p1),
+                 static_cast<std::uint32_t>(p0 >> 32) ^ c[3] ^ k1, static_cast<std::uint32_t>(p0)};
+            k0 += kWeyl0;
+            k1 += kWeyl1;
+        }
+        return c;
+    }
+
+    // 53-bit uniform in (0, 1) from two words, safe to take the log of
+    static double uniform(std::uint32_t high, std::uint32_t low) {
+        const std::uint64_t bits = (static_cast<std::uint64_t>(high) << 32 | low) >> 11;
+        return (static_cast<double>(bits) + 0.5) * 0x1.0p-53;
+    }
+
+    // Two independent standard normals from one block (Box-Muller)
+    static std::array<double, 2> normals(const Counter& block) {
+        const double radius = std::sqrt(-2.0 * std::log(uniform(block[0], block[1])));
+        const double angle = 2.0 * M_PI * uniform(block[2], block[3]);
+        return {radius * std::cos(angle), radius * std::sin(angle)};
+    }
+
+private:
+    static constexpr std::uint32_t kMultiplier0 = 0xD2511F53;
+    static constexpr std::uint32_t kMultiplier1 = 0xCD9E8D57;
+    static constexpr std::uint32_t kWeyl0 = 0x9E3779B9;
+    static constexpr std::uint32_t kWeyl1 = 0xBB67AE85;
+
+    std::uint32_t key0_;
+    std::uint32_t key1_;
+};
+
+#endif // PHILOX_HPP
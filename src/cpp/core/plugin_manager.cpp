@@ -1,12 +1,271 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "plugin_manager.hpp"
 #include "utils.hpp"
+#include "wafer.hpp"
+#include "performance_utils.hpp"
+#include "task_scheduler.hpp"
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <sstream>
 
 namespace SemiPRO {
 
+// PluginResults Implementation
+void PluginResults::reset(const std::vector<std::string>& names, size_t rows) {
+    names_ = names;
+    rows_ = rows;
+    values_.assign(names_.size() * rows_, std::numeric_limits<double>::quiet_NaN());
+}
+
+int PluginResults::column(const std::string& name) const {
+    for (size_t c = 0; c < names_.size(); ++c) {
+        if (names_[c] == name) {
+            return static_cast<int>(c);
+        }
+    }
+    return -1;
+}
+
+int PluginResults::addColumn(const std::string& name) {
+    int c = column(name);
+    if (c < 0) {
+        names_.push_back(name);
+        values_.resize(names_.size() * rows_, std::numeric_limits<double>::quiet_NaN());
+        c = static_cast<int>(names_.size()) - 1;
+    }
+    return c;
+}
+
+double PluginResults::get(size_t row, const std::string& name) const {
+    const int c = column(name);
+    return c < 0 ? std::numeric_limits<double>::quiet_NaN() : values(c)[row];
+}
+
+std::unordered_map<std::string, double> PluginResults::row(size_t row) const {
+    std::unordered_map<std::string, double> values_of_row;
+    for (size_t c = 0; c < names_.size(); ++c) {
+        values_of_row[names_[c]] = values(static_cast<int>(c))[row];
+    }
+    return values_of_row;
+}
+
+void ProcessModulePlugin::executeEach(::Wafer* const* wafers, size_t count, PluginResults& results) {
+    for (size_t i = 0; i < count; ++i) {
+        execute(*wafers[i]);
+        for (const auto& [name, value] : getResults()) {
+            results.set(i, name, value);
+        }
+    }
+}
+
+void AnalysisPlugin::analyzeEach(const ::Wafer* const* wafers, size_t count, PluginResults& results) {
+    for (size_t i = 0; i < count; ++i) {
+        for (const auto& [name, value] : analyze(*wafers[i])) {
+            results.set(i, name, value);
+        }
+    }
+}
+
+namespace {
+
+// Fills in the access and result columns a plugin declares; revision 1
+// plugins lack the functions and are taken to touch everything
+void describePlugin(PluginInfo& info) {
+    if (info.abi_version < 2) {
+        info.reads = {"*"};
+        info.writes = {"*"};
+        info.result_names.clear();
+    } else if (auto module = std::dynamic_pointer_cast<ProcessModulePlugin>(info.instance)) {
+        info.reads = module->reads();
+        info.writes = module->writes();
+        info.result_names = module->resultNames();
+    } else if (auto analysis = std::dynamic_pointer_cast<AnalysisPlugin>(info.instance)) {
+        info.reads = analysis->reads();
+        info.writes.clear();
+        info.result_names = analysis->resultNames();
+    }
+}
+
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+std::string joinList(const std::vector<std::string>& items) {
+    std::string list;
+    for (const auto& item : items) {
+        list += (list.empty() ? "" : ",") + item;
+    }
+    return list;
+}
+
+// Metadata from a library's manifest; false without a usable one
+bool readManifest(const std::string& path, PluginInfo& info) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::unordered_map<std::string, std::string> values;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        size_t eq_pos = line.find('=');
+        if (eq_pos != std::string::npos) {
+            values[line.substr(0, eq_pos)] = line.substr(eq_pos + 1);
+        }
+    }
+    if (values["name"].empty()) {
+        return false;
+    }
+    info.name = values["name"];
+    info.version = values["version"];
+    info.description = values["description"];
+    try {
+        info.abi_version = values["abi"].empty() ? 1 : std::stoi(values["abi"]);
+    } catch (const std::exception&) {
+        return false;
+    }
+    info.reads = info.abi_version < 2 || !values.count("reads") ? std::vector<std::string>{"*"} : splitList(values["reads"]);
+    info.writes = info.abi_version < 2 || !values.count("writes") ? std::vector<std::string>{"*"} : splitList(values["writes"]);
+    info.result_names = splitList(values["results"]);
+    return true;
+}
+
+std::string hashFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return "";
+    }
+    ContentHasher hasher;
+    std::vector<char> block(1 << 20);
+    while (file) {
+        file.read(block.data(), static_cast<std::streamsize>(block.size()));
+        hasher.update(block.data(), static_cast<size_t>(file.gcount()));
+    }
+    return hasher.finish().to_hex();
+}
+
+// Opens a library to validate it and read its metadata. The plugin is
+// created to ask for its declarations, but not initialized.
+bool probeLibrary(const std::string& path, PluginInfo& info, std::string& error) {
+    void* handle = dlopen(path.c_str(), RTLD_LAZY | RTLD_LOCAL);
+    if (!handle) {
+        const char* message = dlerror();
+        error = message ? message : "Failed to load library: " + path;
+        return false;
+    }
+    auto create_func = reinterpret_cast<semipro_create_plugin_t>(dlsym(handle, "semipro_create_plugin"));
+    auto destroy_func = reinterpret_cast<semipro_destroy_plugin_t>(dlsym(handle, "semipro_destroy_plugin"));
+    auto get_name_func = reinterpret_cast<semipro_get_plugin_name_t>(dlsym(handle, "semipro_get_plugin_name"));
+    auto get_version_func = reinterpret_cast<semipro_get_plugin_version_t>(dlsym(handle, "semipro_get_plugin_version"));
+    auto get_description_func = reinterpret_cast<semipro_get_plugin_description_t>(
+        dlsym(handle, "semipro_get_plugin_description"));
+    auto abi_func = reinterpret_cast<semipro_plugin_abi_version_t>(dlsym(handle, "semipro_plugin_abi_version"));
+    bool valid = create_func && destroy_func && get_name_func && get_version_func && get_description_func;
+    if (!valid) {
+        error = "Plugin missing required entry points: " + path;
+    } else {
+        info.name = get_name_func();
+        info.version = get_version_func();
+        info.description = get_description_func();
+        info.abi_version = abi_func ? abi_func() : 1;
+        if (info.abi_version >= 2 && info.abi_version <= kPluginAbiVersion) {
+            PluginBase* created = create_func();
+            if (created) {
+                info.instance = std::shared_ptr<PluginBase>(created, [destroy_func](PluginBase* p) { destroy_func(p); });
+                describePlugin(info);
+                info.instance.reset();
+            }
+        } else {
+            describePlugin(info);
+        }
+    }
+    dlclose(handle);
+    return valid;
+}
+
+// A library as the metadata cache knows it
+struct CachedMetadata {
+    std::uint64_t size = 0;
+    std::int64_t modified = 0;
+    std::string hash;
+    PluginInfo info;
+};
+
+// One tab-separated line per library:
+// path size modified hash abi name version description reads writes results
+std::unordered_map<std::string, CachedMetadata> readMetadataCache(const std::string& path) {
+    std::unordered_map<std::string, CachedMetadata> cache;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, '\t')) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 10) continue;
+        CachedMetadata entry;
+        try {
+            entry.size = std::stoull(fields[1]);
+            entry.modified = std::stoll(fields[2]);
+            entry.info.abi_version = std::stoi(fields[4]);
+        } catch (const std::exception&) {
+            continue;
+        }
+        entry.hash = fields[3];
+        entry.info.name = fields[5];
+        entry.info.version = fields[6];
+        entry.info.description = fields[7];
+        entry.info.reads = splitList(fields[8]);
+        entry.info.writes = splitList(fields[9]);
+        entry.info.result_names = fields.size() > 10 ? splitList(fields[10]) : std::vector<std::string>{};
+        cache[fields[0]] = entry;
+    }
+    return cache;
+}
+
+void writeMetadataCache(const std::string& path, const std::unordered_map<std::string, CachedMetadata>& cache) {
+    const auto clean = [](std::string text) {
+        for (char& c : text) {
+            if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+        }
+        return text;
+    };
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary);
+        if (!file.is_open()) {
+            Logger::getInstance().log("Warning: Could not write plugin metadata cache: " + path);
+            return;
+        }
+        file << "# SemiPRO plugin metadata\n";
+        for (const auto& [library, entry] : cache) {
+            const PluginInfo& info = entry.info;
+            file << library << '\t' << entry.size << '\t' << entry.modified << '\t' << entry.hash << '\t'
+                 << info.abi_version << '\t' << clean(info.name) << '\t' << clean(info.version) << '\t'
+                 << clean(info.description) << '\t' << joinList(info.reads) << '\t' << joinList(info.writes)
+                 << '\t' << joinList(info.result_names) << '\n';
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+}
+
+} // namespace
+
 // Static member initialization
 std::unordered_map<std::string, std::function<std::shared_ptr<PluginBase>()>> PluginRegistry::registry_;
 
@@ -20,6 +279,7 @@ PluginManager::~PluginManager() {
 }
 
 void PluginManager::addPluginDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
     if (std::filesystem::exists(directory) && std::filesystem::is_directory(directory)) {
         plugin_directories_.push_back(directory);
         Logger::getInstance().log("Added plugin directory: " + directory);
@@ -29,30 +289,129 @@ void PluginManager::addPluginDirectory(const std::string& directory) {
     }
 }
 
+void PluginManager::setMetadataCache(const std::string& cache_file) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    metadata_cache_ = cache_file;
+}
+
 void PluginManager::scanPluginDirectories() {
-    for (const auto& directory : plugin_directories_) {
+    std::vector<std::string> directories;
+    std::string cache_file;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        directories = plugin_directories_;
+        cache_file = metadata_cache_;
+    }
+    
+    std::vector<std::string> libraries;
+    for (const auto& directory : directories) {
         try {
             for (const auto& entry : std::filesystem::directory_iterator(directory)) {
                 if (entry.is_regular_file()) {
-                    std::string file_path = entry.path().string();
                     std::string extension = entry.path().extension().string();
                     
                     // Look for shared libraries (.so on Linux, .dll on Windows, .dylib on macOS)
                     if (extension == ".so" || extension == ".dll" || extension == ".dylib") {
-                        if (validatePlugin(file_path)) {
-                            loadPlugin(file_path);
-                        }
+                        libraries.push_back(entry.path().string());
                     }
                 }
             }
         } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(mutex_);
             last_error_ = "Error scanning directory " + directory + ": " + e.what();
             Logger::getInstance().log("Error: " + last_error_);
         }
     }
+    
+    // Libraries are independent: read their metadata in parallel. The
+    // cache is only read here; entries to add come back per library.
+    const auto cache = cache_file.empty() ? std::unordered_map<std::string, CachedMetadata>()
+                                          : readMetadataCache(cache_file);
+    std::unordered_map<std::string, const CachedMetadata*> by_hash;
+    for (const auto& [library, entry] : cache) {
+        by_hash.emplace(entry.hash, &entry);
+    }
+    const size_t n = libraries.size();
+    std::vector<PluginInfo> found(n);
+    std::vector<std::string> errors(n);
+    std::vector<CachedMetadata> fresh(n);
+    std::vector<char> discovered(n, 0), refreshed(n, 0);
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(n), [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            const std::string& library = libraries[i];
+            if (readManifest(library + ".plugin", found[i])) {
+                discovered[i] = 1;
+                continue;
+            }
+            std::error_code error;
+            CachedMetadata& entry = fresh[i];
+            entry.size = std::filesystem::file_size(library, error);
+            entry.modified = std::filesystem::last_write_time(library, error).time_since_epoch().count();
+            auto cached = cache.find(library);
+            if (cached != cache.end() && cached->second.size == entry.size &&
+                cached->second.modified == entry.modified) {
+                found[i] = cached->second.info;
+                discovered[i] = 1;
+                continue;
+            }
+            entry.hash = hashFile(library);
+            auto same = by_hash.find(entry.hash);
+            if (!entry.hash.empty() && same != by_hash.end() && same->second->size == entry.size) {
+                entry.info = same->second->info;
+            } else if (!probeLibrary(library, entry.info, errors[i])) {
+                continue;
+            }
+            found[i] = entry.info;
+            discovered[i] = refreshed[i] = 1;
+        }
+    }, 1);
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!errors[i].empty()) {
+            last_error_ = errors[i];
+            Logger::getInstance().log("Error: " + last_error_);
+        }
+        if (!discovered[i]) continue;
+        PluginInfo& info = found[i];
+        if (info.abi_version < 1 || info.abi_version > kPluginAbiVersion) {
+            last_error_ = "Plugin ABI revision " + std::to_string(info.abi_version) + " is not supported (host " +
+                          std::to_string(kPluginAbiVersion) + "): " + libraries[i];
+            Logger::getInstance().log("Error: " + last_error_);
+            continue;
+        }
+        if (loaded_plugins_.count(info.name) || available_plugins_.count(info.name)) {
+            continue; // The first library of a name wins
+        }
+        info.file_path = libraries[i];
+        info.handle = nullptr;
+        available_plugins_[info.name] = info;
+        ++count;
+    }
+    Logger::getInstance().log("Discovered " + std::to_string(count) + " plugins in " +
+                              std::to_string(directories.size()) + " directories");
+    
+    if (!cache_file.empty() && std::find(refreshed.begin(), refreshed.end(), 1) != refreshed.end()) {
+        auto updated = cache;
+        for (auto it = updated.begin(); it != updated.end();) {
+            it = std::filesystem::exists(it->first) ? std::next(it) : updated.erase(it);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (refreshed[i]) {
+                updated[libraries[i]] = fresh[i];
+            }
+        }
+        writeMetadataCache(cache_file, updated);
+    }
 }
 
 bool PluginManager::loadPlugin(const std::string& plugin_path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return loadPluginFromFile(plugin_path);
+}
+
+bool PluginManager::loadPluginFromFile(const std::string& plugin_path) {
     try {
         void* handle = loadLibrary(plugin_path);
         if (!handle) {
@@ -76,17 +435,40 @@ bool PluginManager::loadPlugin(const std::string& plugin_path) {
             return false;
         }
         
-        // Create plugin instance
-        std::shared_ptr<PluginBase> plugin(create_func());
-        if (!plugin) {
+        // Plugins from before revisions export no revision
+        int abi_version = 1;
+        if (auto abi_func = reinterpret_cast<semipro_plugin_abi_version_t>(
+                dlsym(handle, "semipro_plugin_abi_version"))) {
+            abi_version = abi_func();
+        }
+        if (abi_version < 1 || abi_version > kPluginAbiVersion) {
             unloadLibrary(handle);
+            last_error_ = "Plugin ABI revision " + std::to_string(abi_version) + " is not supported (host " +
+                          std::to_string(kPluginAbiVersion) + "): " + plugin_path;
+            return false;
+        }
+        
+        // Create plugin instance. The library stays loaded as long as the
+        // instance does, handles included, and the library's own
+        // destroy function frees it.
+        auto destroy_func = reinterpret_cast<semipro_destroy_plugin_t>(
+            dlsym(handle, "semipro_destroy_plugin"));
+        std::shared_ptr<void> library(handle, [](void* h) { dlclose(h); });
+        PluginBase* created = create_func();
+        if (!created) {
             last_error_ = "Failed to create plugin instance: " + plugin_path;
             return false;
         }
+        std::shared_ptr<PluginBase> plugin(created, [destroy_func, library](PluginBase* p) {
+            if (destroy_func) {
+                destroy_func(p);
+            } else {
+                delete p;
+            }
+        });
         
         // Initialize plugin
         if (!plugin->initialize()) {
-            unloadLibrary(handle);
             last_error_ = "Plugin initialization failed: " + plugin_path;
             return false;
         }
@@ -99,10 +481,13 @@ bool PluginManager::loadPlugin(const std::string& plugin_path) {
         info.file_path = plugin_path;
         info.handle = handle;
         info.instance = plugin;
+        info.abi_version = abi_version;
+        describePlugin(info);
         
         loaded_plugins_[info.name] = info;
         
-        Logger::getInstance().log("Loaded plugin: " + info.name + " v" + info.version);
+        Logger::getInstance().log("Loaded plugin: " + info.name + " v" + info.version +
+                                  " (ABI " + std::to_string(abi_version) + ")");
         return true;
         
     } catch (const std::exception& e) {
@@ -113,6 +498,7 @@ bool PluginManager::loadPlugin(const std::string& plugin_path) {
 }
 
 bool PluginManager::unloadPlugin(const std::string& plugin_name) {
+    std::lock_guard<std::mutex> lock(mutex_);
     auto it = loaded_plugins_.find(plugin_name);
     if (it == loaded_plugins_.end()) {
         last_error_ = "Plugin not found: " + plugin_name;
@@ -120,13 +506,8 @@ bool PluginManager::unloadPlugin(const std::string& plugin_name) {
     }
     
     try {
-        // Cleanup plugin
+        // Cleanup plugin; its library unloads with the last reference
         it->second.instance->cleanup();
-        it->second.instance.reset();
-        
-        // Unload library
-        unloadLibrary(it->second.handle);
-        
         loaded_plugins_.erase(it);
         
         Logger::getInstance().log("Unloaded plugin: " + plugin_name);
@@ -141,8 +522,11 @@ bool PluginManager::unloadPlugin(const std::string& plugin_name) {
 
 void PluginManager::unloadAllPlugins() {
     std::vector<std::string> plugin_names;
-    for (const auto& [name, info] : loaded_plugins_) {
-        plugin_names.push_back(name);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [name, info] : loaded_plugins_) {
+            plugin_names.push_back(name);
+        }
     }
     
     for (const auto& name : plugin_names) {
@@ -150,9 +534,36 @@ void PluginManager::unloadAllPlugins() {
     }
 }
 
-std::shared_ptr<PluginBase> PluginManager::getPlugin(const std::string& name) {
+PluginInfo* PluginManager::findPlugin(const std::string& name) {
     auto it = loaded_plugins_.find(name);
-    return (it != loaded_plugins_.end()) ? it->second.instance : nullptr;
+    if (it != loaded_plugins_.end()) {
+        return &it->second;
+    }
+    
+    // Load a discovered plugin on first use; one that fails is forgotten
+    // rather than retried on every call
+    auto available = available_plugins_.find(name);
+    if (available == available_plugins_.end()) {
+        return nullptr;
+    }
+    const std::string path = available->second.file_path;
+    available_plugins_.erase(available);
+    if (!loadPluginFromFile(path)) {
+        return nullptr;
+    }
+    it = loaded_plugins_.find(name);
+    if (it == loaded_plugins_.end()) {
+        last_error_ = "Plugin " + path + " does not have the name its metadata gives: " + name;
+        Logger::getInstance().log("Error: " + last_error_);
+        return nullptr;
+    }
+    return &it->second;
+}
+
+std::shared_ptr<PluginBase> PluginManager::getPlugin(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PluginInfo* info = findPlugin(name);
+    return info ? info->instance : nullptr;
 }
 
 std::shared_ptr<ProcessModulePlugin> PluginManager::getProcessModule(const std::string& name) {
@@ -165,7 +576,51 @@ std::shared_ptr<AnalysisPlugin> PluginManager::getAnalysisPlugin(const std::stri
     return std::dynamic_pointer_cast<AnalysisPlugin>(plugin);
 }
 
+bool PluginManager::addPlugin(std::shared_ptr<PluginBase> plugin) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!plugin || !plugin->initialize()) {
+        last_error_ = "Plugin initialization failed: " + (plugin ? plugin->getName() : std::string("null"));
+        return false;
+    }
+    PluginInfo info;
+    info.name = plugin->getName();
+    info.version = plugin->getVersion();
+    info.description = plugin->getDescription();
+    info.handle = nullptr;
+    info.instance = plugin;
+    info.abi_version = kPluginAbiVersion;
+    describePlugin(info);
+    loaded_plugins_[info.name] = info;
+    Logger::getInstance().log("Added plugin: " + info.name + " v" + info.version);
+    return true;
+}
+
+ProcessModuleHandle PluginManager::processModule(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ProcessModuleHandle handle;
+    if (PluginInfo* info = findPlugin(name)) {
+        handle.plugin_ = std::dynamic_pointer_cast<ProcessModulePlugin>(info->instance);
+        if (handle.plugin_) {
+            handle.info_ = std::make_shared<const PluginInfo>(*info);
+        }
+    }
+    return handle;
+}
+
+AnalysisHandle PluginManager::analysisPlugin(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AnalysisHandle handle;
+    if (PluginInfo* info = findPlugin(name)) {
+        handle.plugin_ = std::dynamic_pointer_cast<AnalysisPlugin>(info->instance);
+        if (handle.plugin_) {
+            handle.info_ = std::make_shared<const PluginInfo>(*info);
+        }
+    }
+    return handle;
+}
+
 std::vector<std::string> PluginManager::getLoadedPluginNames() const {
+    std::lock_guard<std::mutex> lock(mutex_);
     std::vector<std::string> names;
     for (const auto& [name, info] : loaded_plugins_) {
         names.push_back(name);
@@ -174,6 +629,7 @@ std::vector<std::string> PluginManager::getLoadedPluginNames() const {
 }
 
 std::vector<PluginInfo> PluginManager::getLoadedPlugins() const {
+    std::lock_guard<std::mutex> lock(mutex_);
     std::vector<PluginInfo> plugins;
     for (const auto& [name, info] : loaded_plugins_) {
         plugins.push_back(info);
@@ -182,10 +638,28 @@ std::vector<PluginInfo> PluginManager::getLoadedPlugins() const {
 }
 
 bool PluginManager::isPluginLoaded(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
     return loaded_plugins_.find(name) != loaded_plugins_.end();
 }
 
+std::vector<PluginInfo> PluginManager::getAvailablePlugins() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<PluginInfo> plugins;
+    for (const auto* map : {&loaded_plugins_, &available_plugins_}) {
+        for (const auto& [name, info] : *map) {
+            plugins.push_back(info);
+        }
+    }
+    return plugins;
+}
+
+bool PluginManager::isPluginAvailable(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return loaded_plugins_.count(name) > 0 || available_plugins_.count(name) > 0;
+}
+
 bool PluginManager::validatePlugin(const std::string& plugin_path) {
+    std::lock_guard<std::mutex> lock(mutex_);
     void* handle = loadLibrary(plugin_path);
     if (!handle) {
         return false;
@@ -203,6 +677,7 @@ bool PluginManager::validatePlugin(const std::string& plugin_path) {
 }
 
 std::string PluginManager::getPluginError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
     return last_error_;
 }
 
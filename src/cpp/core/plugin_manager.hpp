@@ -6,10 +6,58 @@
 #include <unordered_map>
 #include <vector>
 #include <functional>
+#include <mutex>
+#include <cstdint>
 #include <dlfcn.h>
 
+class Wafer;
+
 namespace SemiPRO {
 
+/**
+ * @brief Revision of the plugin binary interface
+ *
+ * Plugins export it through SEMIPRO_PLUGIN_ENTRY_POINTS. A plugin built
+ * before revisions existed exports none and is taken as revision 1, the
+ * single-wafer interface: its batches run through execute() or analyze()
+ * per wafer, and it is assumed to read and write everything. Plugins of
+ * a newer revision than the host are refused.
+ */
+constexpr int kPluginAbiVersion = 2;
+
+/**
+ * @brief Typed results of a plugin batch: named columns of doubles, one
+ * row per wafer
+ *
+ * Columns are contiguous, so a plugin looks each one up once per batch
+ * and then writes values(column)[row]. Values never written are NaN.
+ */
+class PluginResults {
+public:
+    // Clears to the given columns and rows
+    void reset(const std::vector<std::string>& names, size_t rows);
+
+    size_t rows() const { return rows_; }
+    const std::vector<std::string>& names() const { return names_; }
+    // -1 for a name without a column
+    int column(const std::string& name) const;
+    // The name's column, appended when it has none
+    int addColumn(const std::string& name);
+    double* values(int column) { return values_.data() + static_cast<size_t>(column) * rows_; }
+    const double* values(int column) const { return values_.data() + static_cast<size_t>(column) * rows_; }
+
+    // NaN when the name has no column
+    double get(size_t row, const std::string& name) const;
+    void set(size_t row, const std::string& name, double value) { values(addColumn(name))[row] = value; }
+    // Row of a wafer as a map, for callers of the single-wafer interface
+    std::unordered_map<std::string, double> row(size_t row) const;
+
+private:
+    std::vector<std::string> names_;
+    size_t rows_ = 0;
+    std::vector<double> values_; // Column-major
+};
+
 /**
  * @brief Base class for all plugins
  */
@@ -28,9 +76,28 @@ public:
  */
 class ProcessModulePlugin : public PluginBase {
 public:
-    virtual void execute(class Wafer& wafer) = 0;
+    virtual void execute(::Wafer& wafer) = 0;
     virtual void setParameters(const std::unordered_map<std::string, double>& params) = 0;
     virtual std::unordered_map<std::string, double> getResults() const = 0;
+
+    // Revision 2; new virtual functions go after these, so the slots above
+    // keep their places for revision 1 plugins.
+
+    // Wafer state the plugin reads and modifies, named as orchestrator step
+    // fields ("grid", "dopant", ..., "*" for everything). Steps whose
+    // plugins do not conflict may run concurrently.
+    virtual std::vector<std::string> reads() const { return {"*"}; }
+    virtual std::vector<std::string> writes() const { return {"*"}; }
+    // Result columns every batch fills; results carries them on entry
+    virtual std::vector<std::string> resultNames() const { return {}; }
+    // Processes count wafers, writing row i of results for wafers[i]. The
+    // default calls executeEach().
+    virtual void executeBatch(::Wafer* const* wafers, size_t count, PluginResults& results) {
+        executeEach(wafers, count, results);
+    }
+
+    // execute() and getResults() per wafer
+    void executeEach(::Wafer* const* wafers, size_t count, PluginResults& results);
 };
 
 /**
@@ -38,8 +105,18 @@ public:
  */
 class AnalysisPlugin : public PluginBase {
 public:
-    virtual std::unordered_map<std::string, double> analyze(const class Wafer& wafer) = 0;
+    virtual std::unordered_map<std::string, double> analyze(const ::Wafer& wafer) = 0;
     virtual void generateReport(const std::string& output_file) = 0;
+
+    // Revision 2, as for ProcessModulePlugin
+    virtual std::vector<std::string> reads() const { return {"*"}; }
+    virtual std::vector<std::string> resultNames() const { return {}; }
+    virtual void analyzeBatch(const ::Wafer* const* wafers, size_t count, PluginResults& results) {
+        analyzeEach(wafers, count, results);
+    }
+
+    // analyze() per wafer
+    void analyzeEach(const ::Wafer* const* wafers, size_t count, PluginResults& results);
 };
 
 /**
@@ -52,15 +129,97 @@ struct PluginInfo {
     std::string file_path;
     void* handle;
     std::shared_ptr<PluginBase> instance;
+    int abi_version = 1;
+    // Declared once at load; "*" for revision 1 plugins
+    std::vector<std::string> reads;
+    std::vector<std::string> writes;
+    std::vector<std::string> result_names;
+};
+
+/**
+ * @brief A loaded plugin resolved once, for calls without lookups
+ *
+ * Keeps the plugin and its library loaded while held, even past
+ * unloadPlugin().
+ */
+template <typename Plugin>
+class PluginHandle {
+public:
+    PluginHandle() = default;
+
+    explicit operator bool() const { return plugin_ != nullptr; }
+    Plugin* operator->() const { return plugin_.get(); }
+    Plugin& operator*() const { return *plugin_; }
+    const std::string& name() const { return info_->name; }
+    int abiVersion() const { return info_->abi_version; }
+    const std::vector<std::string>& reads() const { return info_->reads; }
+    const std::vector<std::string>& writes() const { return info_->writes; }
+    const std::vector<std::string>& resultNames() const { return info_->result_names; }
+
+protected:
+    friend class PluginManager;
+
+    std::shared_ptr<Plugin> plugin_;
+    std::shared_ptr<const PluginInfo> info_;
+};
+
+class ProcessModuleHandle : public PluginHandle<ProcessModulePlugin> {
+public:
+    // Runs the plugin over a span of wafers; results is reset to its columns
+    void execute(::Wafer* const* wafers, size_t count, PluginResults& results) const {
+        results.reset(info_->result_names, count);
+        if (info_->abi_version >= 2) {
+            plugin_->executeBatch(wafers, count, results);
+        } else {
+            plugin_->executeEach(wafers, count, results);
+        }
+    }
+};
+
+class AnalysisHandle : public PluginHandle<AnalysisPlugin> {
+public:
+    void analyze(const ::Wafer* const* wafers, size_t count, PluginResults& results) const {
+        results.reset(info_->result_names, count);
+        if (info_->abi_version >= 2) {
+            plugin_->analyzeBatch(wafers, count, results);
+        } else {
+            plugin_->analyzeEach(wafers, count, results);
+        }
+    }
 };
 
 /**
  * @brief Plugin manager for dynamic loading and management
+ *
+ * scanPluginDirectories() discovers plugins without loading them, in
+ * parallel. A library's metadata comes from its manifest,
+ * `<library>.plugin`, in PluginConfig's key=value format:
+ *
+ *     name=thinning
+ *     version=2.0
+ *     description=Removes a fixed depth from the grid
+ *     abi=2
+ *     reads=grid
+ *     writes=grid
+ *     results=mean_height
+ *
+ * A library without one is opened once to validate it and read its
+ * metadata, which is then kept in the metadata cache, if one is set,
+ * under the library's size, modification time and content hash; later
+ * scans take it from there without opening the library (a library
+ * whose time changed but whose content did not is not reopened either).
+ *
+ * A discovered plugin is loaded on first use through getPlugin(),
+ * processModule() and the like. Thread-safe.
  */
 class PluginManager {
 private:
     std::unordered_map<std::string, PluginInfo> loaded_plugins_;
+    // Discovered and not loaded yet; instance and handle are null
+    std::unordered_map<std::string, PluginInfo> available_plugins_;
     std::vector<std::string> plugin_directories_;
+    std::string metadata_cache_;
+    mutable std::mutex mutex_;
     
     // Function pointer types for plugin entry points
     typedef PluginBase* (*CreatePluginFunc)();
@@ -74,22 +233,33 @@ public:
     
     // Plugin directory management
     void addPluginDirectory(const std::string& directory);
+    // Discovers the plugins in the directories for loading on first use
     void scanPluginDirectories();
+    // File keeping validated metadata across runs; "" for none
+    void setMetadataCache(const std::string& cache_file);
     
     // Plugin loading/unloading
     bool loadPlugin(const std::string& plugin_path);
     bool unloadPlugin(const std::string& plugin_name);
     void unloadAllPlugins();
+    // A plugin built in this process, e.g. by PluginRegistry, at this revision
+    bool addPlugin(std::shared_ptr<PluginBase> plugin);
     
     // Plugin access
     std::shared_ptr<PluginBase> getPlugin(const std::string& name);
     std::shared_ptr<ProcessModulePlugin> getProcessModule(const std::string& name);
     std::shared_ptr<AnalysisPlugin> getAnalysisPlugin(const std::string& name);
+    // Empty handles for a name not found or a plugin of another kind
+    ProcessModuleHandle processModule(const std::string& name);
+    AnalysisHandle analysisPlugin(const std::string& name);
     
     // Plugin information
     std::vector<std::string> getLoadedPluginNames() const;
     std::vector<PluginInfo> getLoadedPlugins() const;
     bool isPluginLoaded(const std::string& name) const;
+    // Loaded plugins and discovered ones not loaded yet
+    std::vector<PluginInfo> getAvailablePlugins() const;
+    bool isPluginAvailable(const std::string& name) const;
     
     // Plugin validation
     bool validatePlugin(const std::string& plugin_path);
@@ -98,7 +268,9 @@ public:
 private:
     std::string last_error_;
     
+    // Callers hold mutex_
     bool loadPluginFromFile(const std::string& file_path);
+    PluginInfo* findPlugin(const std::string& name);
     void* loadLibrary(const std::string& path);
     void unloadLibrary(void* handle);
     void* getSymbol(void* handle, const std::string& symbol_name);
@@ -167,6 +339,7 @@ extern "C" {
     typedef const char* (*semipro_get_plugin_name_t)();
     typedef const char* (*semipro_get_plugin_version_t)();
     typedef const char* (*semipro_get_plugin_description_t)();
+    typedef int (*semipro_plugin_abi_version_t)();
 }
 
 // Macros for plugin developers
@@ -180,14 +353,17 @@ extern "C" {
         delete plugin; \
     } \
     SEMIPRO_PLUGIN_EXPORT const char* semipro_get_plugin_name() { \
-        static PluginClass instance; \
-        return instance.getName().c_str(); \
+        static const std::string value = PluginClass().getName(); \
+        return value.c_str(); \
     } \
     SEMIPRO_PLUGIN_EXPORT const char* semipro_get_plugin_version() { \
-        static PluginClass instance; \
-        return instance.getVersion().c_str(); \
+        static const std::string value = PluginClass().getVersion(); \
+        return value.c_str(); \
     } \
     SEMIPRO_PLUGIN_EXPORT const char* semipro_get_plugin_description() { \
-        static PluginClass instance; \
-        return instance.getDescription().c_str(); \
+        static const std::string value = PluginClass().getDescription(); \
+        return value.c_str(); \
+    } \
+    SEMIPRO_PLUGIN_EXPORT int semipro_plugin_abi_version() { \
+        return SemiPRO::kPluginAbiVersion; \
     }
@@ -0,0 +1,67 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "png_writer.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace {
+
+void putU32(std::vector<uint8_t>& out, uint32_t value) {
+  out.push_back(static_cast<uint8_t>(value >> 24));
+  out.push_back(static_cast<uint8_t>(value >> 16));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+// Length, type, data and the CRC of type and data
+void putChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, uint32_t bytes) {
+  putU32(out, bytes);
+  const std::size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data, data + bytes);
+  putU32(out, static_cast<uint32_t>(crc32(0L, out.data() + start, static_cast<uInt>(bytes + 4))));
+}
+
+} // namespace
+
+std::vector<uint8_t> PngWriter::encode(const uint8_t* rgba, uint32_t width, uint32_t height, int level) {
+  if (width == 0 || height == 0) {
+    throw std::invalid_argument("PngWriter: empty image");
+  }
+  // Each row: filter type 1 (Sub), then every byte less the one a pixel
+  // to its left
+  const std::size_t stride = static_cast<std::size_t>(width) * 4;
+  std::vector<uint8_t> filtered((stride + 1) * height);
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint8_t* row = rgba + y * stride;
+    uint8_t* out = filtered.data() + y * (stride + 1);
+    out[0] = 1;
+    for (std::size_t i = 0; i < stride; ++i) {
+      out[i + 1] = static_cast<uint8_t>(row[i] - (i >= 4 ? row[i - 4] : 0));
+    }
+  }
+  uLongf packed_bytes = compressBound(static_cast<uLong>(filtered.size()));
+  std::vector<uint8_t> packed(packed_bytes);
+  if (compress2(packed.data(), &packed_bytes, filtered.data(), static_cast<uLong>(filtered.size()), level) != Z_OK) {
+    throw std::runtime_error("PngWriter: zlib failed to compress");
+  }
+
+  std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  std::vector<uint8_t> header;
+  putU32(header, width);
+  putU32(header, height);
+  header.insert(header.end(), {8, 6, 0, 0, 0}); // 8-bit RGBA, deflate, adaptive filters, no interlace
+  putChunk(png, "IHDR", header.data(), static_cast<uint32_t>(header.size()));
+  putChunk(png, "IDAT", packed.data(), static_cast<uint32_t>(packed_bytes));
+  putChunk(png, "IEND", nullptr, 0);
+  return png;
+}
+
+void PngWriter::write(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height, int level) {
+  const std::vector<uint8_t> png = encode(rgba, width, height, level);
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+  if (!file) {
+    throw std::runtime_error("PngWriter: cannot write " + path);
+  }
+}
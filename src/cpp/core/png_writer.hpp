@@ -0,0 +1,20 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// PNG encoding of 8-bit RGBA images, rows top to bottom, for rendered
+// wafer maps. The pixels go into a single IDAT chunk deflated by zlib;
+// every row takes the Sub filter, which leaves runs of one colour, the
+// bulk of a wafer map, as zeros. Encoding is reentrant, so many images
+// can be encoded on worker threads at once.
+class PngWriter {
+public:
+  // Throws std::invalid_argument for an empty image and
+  // std::runtime_error if zlib fails
+  static std::vector<uint8_t> encode(const uint8_t* rgba, uint32_t width, uint32_t height, int level = 6);
+  // As encode(), then throws std::runtime_error if the file cannot be written
+  static void write(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height,
+                    int level = 6);
+};
@@ -0,0 +1,104 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "point_grid.hpp"
+#include "task_scheduler.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+PointGrid::PointGrid(const std::vector<Point>& points, double cell_size) : cell_size_(cell_size) {
+  if (!(cell_size > 0.0)) {
+    throw std::invalid_argument("PointGrid: cell size must be positive");
+  }
+  if (points.empty()) {
+    return;
+  }
+  double x1 = points[0].x, y1 = points[0].y;
+  x0_ = x1;
+  y0_ = y1;
+  for (const Point& p : points) {
+    x0_ = std::min(x0_, p.x);
+    y0_ = std::min(y0_, p.y);
+    x1 = std::max(x1, p.x);
+    y1 = std::max(y1, p.y);
+  }
+  // At most about four cells per point
+  const double budget = 4.0 * static_cast<double>(points.size()) + 16.0;
+  while (((x1 - x0_) / cell_size_ + 1.0) * ((y1 - y0_) / cell_size_ + 1.0) > budget) {
+    cell_size_ *= 2.0;
+  }
+  cols_ = static_cast<int>((x1 - x0_) / cell_size_) + 1;
+  rows_ = static_cast<int>((y1 - y0_) / cell_size_) + 1;
+
+  std::vector<int> cell(points.size());
+  start_.assign(static_cast<std::size_t>(rows_) * cols_ + 1, 0);
+  for (std::size_t k = 0; k < points.size(); ++k) {
+    cell[k] = cellOf(points[k].y, y0_, rows_) * cols_ + cellOf(points[k].x, x0_, cols_);
+    ++start_[cell[k] + 1];
+  }
+  std::partial_sum(start_.begin(), start_.end(), start_.begin());
+  points_.resize(points.size());
+  index_.resize(points.size());
+  std::vector<int> next(start_.begin(), start_.end() - 1);
+  for (std::size_t k = 0; k < points.size(); ++k) {
+    const int slot = next[cell[k]]++;
+    points_[slot] = points[k];
+    index_[slot] = static_cast<int>(k);
+  }
+}
+
+std::vector<int> PointGrid::cluster(double eps, int min_points) const {
+  const int n = static_cast<int>(points_.size());
+  std::vector<Point> at(n);
+  for (int p = 0; p < n; ++p) {
+    at[index_[p]] = points_[p];
+  }
+
+  std::vector<char> core(n, 0);
+  TaskScheduler::getInstance().parallelFor(0, n, [&](int begin, int end) {
+    for (int k = begin; k < end; ++k) {
+      int count = 0;
+      forEachWithin(at[k].x, at[k].y, eps, [&count](int) { ++count; });
+      core[k] = count >= min_points;
+    }
+  });
+
+  // Core points join their core neighbours; the rest take the lowest one
+  std::vector<int> parent(n);
+  std::iota(parent.begin(), parent.end(), 0);
+  const auto find = [&parent](int k) {
+    while (parent[k] != k) {
+      k = parent[k] = parent[parent[k]];
+    }
+    return k;
+  };
+  std::vector<int> owner(n, -1);
+  for (int k = 0; k < n; ++k) {
+    if (core[k]) {
+      forEachWithin(at[k].x, at[k].y, eps, [&](int q) {
+        if (q < k && core[q]) {
+          parent[find(k)] = find(q);
+        }
+      });
+      owner[k] = k;
+    } else {
+      forEachWithin(at[k].x, at[k].y, eps, [&](int q) {
+        if (core[q] && (owner[k] < 0 || q < owner[k])) {
+          owner[k] = q;
+        }
+      });
+    }
+  }
+
+  std::vector<int> labels(n, -1), number(n, -1);
+  int clusters = 0;
+  for (int k = 0; k < n; ++k) {
+    if (owner[k] >= 0) {
+      int& label = number[find(owner[k])];
+      if (label < 0) {
+        label = clusters++;
+      }
+      labels[k] = label;
+    }
+  }
+  return labels;
+}
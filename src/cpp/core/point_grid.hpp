@@ -0,0 +1,73 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <cmath>
+#include <vector>
+
+// Spatial hash of 2D points on a uniform grid of square cells, built in
+// O(n) by a counting sort: the points of cell c are points()[start[c]]
+// up to points()[start[c + 1]], in their original order. Radius queries
+// visit only the cells the query square covers. Cells are made larger
+// when the points' bounding box would need more than a few per point, so
+// memory stays linear however sparse the points are.
+class PointGrid {
+public:
+  struct Point {
+    double x, y;
+  };
+
+  PointGrid() = default;
+  // Throws std::invalid_argument for cell_size <= 0
+  PointGrid(const std::vector<Point>& points, double cell_size);
+
+  std::size_t size() const { return points_.size(); }
+  // The points in cell order, and each one's index in the input
+  const std::vector<Point>& points() const { return points_; }
+  const std::vector<int>& index() const { return index_; }
+  double cellSize() const { return cell_size_; }
+
+  // fn(k) for every point k (input index) within radius of (x, y)
+  template <typename Fn>
+  void forEachWithin(double x, double y, double radius, Fn&& fn) const;
+
+  // DBSCAN: a point with at least min_points points (itself included)
+  // within eps is a core point; core points within eps of each other
+  // share a cluster, and other points join the cluster of their first
+  // core neighbour. Labels by input index, -1 for noise, clusters
+  // numbered in the order of their lowest point, so the result does not
+  // depend on threading. Neighbours are counted in parallel.
+  std::vector<int> cluster(double eps, int min_points) const;
+
+private:
+  int cellOf(double v, double origin, int cells) const {
+    const int c = static_cast<int>(std::floor((v - origin) / cell_size_));
+    return c < 0 ? 0 : (c >= cells ? cells - 1 : c);
+  }
+
+  std::vector<Point> points_;
+  std::vector<int> index_;
+  std::vector<int> start_;
+  double cell_size_ = 1.0;
+  double x0_ = 0.0;
+  double y0_ = 0.0;
+  int cols_ = 0; // Cells along x
+  int rows_ = 0; // Cells along y
+};
+
+template <typename Fn>
+void PointGrid::forEachWithin(double x, double y, double radius, Fn&& fn) const {
+  if (points_.empty() || !(radius >= 0.0)) {
+    return;
+  }
+  const double r2 = radius * radius;
+  const int i0 = cellOf(x - radius, x0_, cols_), i1 = cellOf(x + radius, x0_, cols_);
+  const int j0 = cellOf(y - radius, y0_, rows_), j1 = cellOf(y + radius, y0_, rows_);
+  for (int j = j0; j <= j1; ++j) {
+    // A row's cells are contiguous, so one range covers them
+    for (int k = start_[j * cols_ + i0]; k < start_[j * cols_ + i1 + 1]; ++k) {
+      const double dx = points_[k].x - x, dy = points_[k].y - y;
+      if (dx * dx + dy * dy <= r2) {
+        fn(index_[k]);
+      }
+    }
+  }
+}
@@ -0,0 +1,146 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef PROCESS_SCHEMA_HPP
+#define PROCESS_SCHEMA_HPP
+
+#include "config_manager.hpp"
+#include "json_value.hpp"
+#include <cstddef>
+#include <initializer_list>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+// Declared binding of loosely typed process parameters onto a model's
+// conditions struct.
+//
+// Each field names its key once, together with the setter it feeds and
+// its default; a numeric default may instead come from a configuration
+// path, resolved when the schema is built and read from the current
+// configuration snapshot only when the key is absent. bind() resolves every field in
+// one pass, so model code works on plain members and never looks keys up
+// itself. Keys the schema does not declare are ignored. Text fields are
+// applied after numeric ones and win when both set the same member.
+template <typename Conditions>
+class ProcessSchema {
+public:
+    struct Number {
+        const char* key;
+        void (*set)(Conditions&, double);
+        double fallback;
+        const char* config_path = nullptr;
+    };
+    struct Text {
+        const char* key;
+        void (*set)(Conditions&, const std::string&);
+        const char* fallback = nullptr; // Left to Conditions' default when null
+    };
+
+    ProcessSchema(std::initializer_list<Number> numbers, std::initializer_list<Text> texts = {})
+        : numbers_(numbers), texts_(texts) {
+        config_keys_.reserve(numbers_.size());
+        for (const auto& field : numbers_) {
+            config_keys_.push_back(field.config_path ? std::make_optional<SemiPRO::ConfigKey<double>>(
+                                                           field.config_path, field.fallback)
+                                                     : std::nullopt);
+        }
+    }
+
+    Conditions bind(const std::unordered_map<std::string, double>& numbers,
+                    const std::unordered_map<std::string, std::string>& texts = {}) const {
+        Conditions conditions;
+        for (std::size_t i = 0; i < numbers_.size(); ++i) {
+            auto it = numbers.find(numbers_[i].key);
+            numbers_[i].set(conditions, it != numbers.end() ? it->second : fallback(i));
+        }
+        for (const auto& field : texts_) {
+            auto it = texts.find(field.key);
+            if (it != texts.end()) {
+                field.set(conditions, it->second);
+            } else if (field.fallback) {
+                field.set(conditions, field.fallback);
+            }
+        }
+        return conditions;
+    }
+
+    // From a YAML or JSON mapping of scalars; throws YAML::Exception when
+    // a numeric field holds something else
+    Conditions bind(const YAML::Node& node) const {
+        Conditions conditions;
+        for (std::size_t i = 0; i < numbers_.size(); ++i) {
+            const YAML::Node value = node[numbers_[i].key];
+            numbers_[i].set(conditions, value ? value.as<double>() : fallback(i));
+        }
+        for (const auto& field : texts_) {
+            const YAML::Node value = node[field.key];
+            if (value && value.IsScalar()) {
+                field.set(conditions, value.Scalar());
+            } else if (field.fallback) {
+                field.set(conditions, field.fallback);
+            }
+        }
+        return conditions;
+    }
+
+    // From a parsed JSON object. Stricter than the YAML overload: a
+    // declared key holding the wrong JSON type throws
+    // std::invalid_argument naming the key. A key declared as both number
+    // and text (e.g. an implant species) takes either.
+    Conditions bind(const SemiPRO::JsonValue& object) const {
+        Conditions conditions;
+        for (std::size_t i = 0; i < numbers_.size(); ++i) {
+            const Number& field = numbers_[i];
+            const SemiPRO::JsonValue* value = object.find(field.key);
+            if (value && !value->isNumber()) {
+                if (!declares(texts_, field.key)) {
+                    throw std::invalid_argument(std::string("Parameter '") + field.key + "' must be a number");
+                }
+                value = nullptr;
+            }
+            field.set(conditions, value ? value->asNumber() : fallback(i));
+        }
+        for (const auto& field : texts_) {
+            const SemiPRO::JsonValue* value = object.find(field.key);
+            if (value && value->isString()) {
+                field.set(conditions, value->asString());
+            } else if (value) {
+                if (!value->isNumber() || !declares(numbers_, field.key)) {
+                    throw std::invalid_argument(std::string("Parameter '") + field.key + "' must be a string");
+                }
+            } else if (field.fallback) {
+                field.set(conditions, field.fallback);
+            }
+        }
+        return conditions;
+    }
+
+    // Conditions with every field at its default
+    Conditions defaults() const { return bind(std::unordered_map<std::string, double>()); }
+
+    const std::vector<Number>& numbers() const { return numbers_; }
+    const std::vector<Text>& texts() const { return texts_; }
+
+private:
+    template <typename Field>
+    static bool declares(const std::vector<Field>& fields, const char* key) {
+        for (const auto& field : fields) {
+            if (std::string(field.key) == key) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    double fallback(std::size_t field) const {
+        return config_keys_[field] ? config_keys_[field]->get() : numbers_[field].fallback;
+    }
+
+    std::vector<Number> numbers_;
+    std::vector<Text> texts_;
+    std::vector<std::optional<SemiPRO::ConfigKey<double>>> config_keys_; // Per numbers_ entry
+};
+
+#endif // PROCESS_SCHEMA_HPP
@@ -0,0 +1,487 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char code[8];
+                    std::snprintf(code, sizeof(code), "\\u%04x", c);
+                    escaped += code;
+                } else {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped;
+}
+
+constexpr double kNsPerMs = 1e6;
+
+void add(std::atomic<std::uint64_t>& counter, std::uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+} // namespace
+
+Profiler::ThreadState::~ThreadState() {
+    for (auto& block : stats_blocks) {
+        delete[] block.load(std::memory_order_relaxed);
+    }
+}
+
+Profiler::ZoneStats& Profiler::ThreadState::stats(ProfileZoneId zone) {
+    auto& slot = stats_blocks[zone / kStatsBlock];
+    ZoneStats* block = slot.load(std::memory_order_relaxed);
+    if (!block) {
+        // Only the owning thread installs blocks; release publishes them
+        // to readers
+        block = new ZoneStats[kStatsBlock];
+        slot.store(block, std::memory_order_release);
+    }
+    return block[zone % kStatsBlock];
+}
+
+Profiler::Profiler() : epoch_(std::chrono::steady_clock::now()) {}
+
+Profiler& Profiler::getInstance() {
+    // Never destroyed, so zones closed during static destruction stay valid
+    static Profiler* instance = new Profiler();
+    return *instance;
+}
+
+std::int64_t Profiler::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch_).count();
+}
+
+Profiler::ThreadState& Profiler::threadState() {
+    thread_local ThreadState* state = nullptr;
+    if (!state) {
+        auto created = std::make_shared<ThreadState>();
+        created->open.reserve(64);
+        std::lock_guard<std::mutex> lock(mutex_);
+        created->tid = static_cast<std::uint32_t>(threads_.size());
+        threads_.push_back(created);
+        state = created.get();
+    }
+    return *state;
+}
+
+ProfileZoneId Profiler::registerZone(const std::string& name) {
+    // Each thread caches the names it has seen, so only the first use of a
+    // name on a thread takes the registry lock
+    thread_local std::unordered_map<std::string, ProfileZoneId> cache;
+    auto cached = cache.find(name);
+    if (cached != cache.end()) {
+        return cached->second;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = zone_ids_.find(name);
+    if (it == zone_ids_.end()) {
+        if (zone_names_.size() >= kMaxZones) {
+            throw std::length_error("Too many profiling zones");
+        }
+        auto id = static_cast<ProfileZoneId>(zone_names_.size());
+        zone_names_.push_back(name);
+        it = zone_ids_.emplace(name, id).first;
+    }
+    cache.emplace(name, it->second);
+    return it->second;
+}
+
+std::string Profiler::zoneName(ProfileZoneId zone) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return zone < zone_names_.size() ? zone_names_[zone] : std::string();
+}
+
+bool Profiler::findZone(const std::string& name, ProfileZoneId& zone) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = zone_ids_.find(name);
+    if (it == zone_ids_.end()) {
+        return false;
+    }
+    zone = it->second;
+    return true;
+}
+
+bool Profiler::enableHardwareCounters(bool enable) {
+    if (!enable) {
+        HardwareCounters::disable();
+        return false;
+    }
+    return HardwareCounters::enable();
+}
+
+void Profiler::addCells(std::uint64_t cells) {
+    ThreadState& state = threadState();
+    if (!state.open.empty()) {
+        state.open.back().cells += cells;
+    }
+}
+
+void Profiler::beginZone(ProfileZoneId zone) {
+    // Counters are read before the clock at the start and after it at the
+    // end, so neither read is charged to the zone's time
+    const HardwareCounters::Sample counters = HardwareCounters::read();
+    threadState().open.push_back({zone, now(), 0, counters, 0});
+}
+
+void Profiler::endZone() {
+    ThreadState& state = threadState();
+    if (state.open.empty()) {
+        return;
+    }
+    const std::int64_t end = now();
+    const HardwareCounters::Sample counters = HardwareCounters::read();
+    const OpenZone zone = state.open.back();
+    state.open.pop_back();
+    if (!state.open.empty()) {
+        state.open.back().child_ns += std::max<std::int64_t>(end - zone.start_ns, 0);
+    }
+    record(state, zone.zone, static_cast<std::uint32_t>(state.open.size()), zone.start_ns, end,
+           static_cast<std::uint64_t>(zone.child_ns), counters - zone.counters, zone.cells);
+}
+
+ProfileTrackId Profiler::registerTrack(const std::string& name) {
+    auto created = std::make_shared<ThreadState>();
+    created->name = name;
+    std::lock_guard<std::mutex> lock(mutex_);
+    created->tid = static_cast<std::uint32_t>(threads_.size());
+    threads_.push_back(created);
+    tracks_.push_back(created.get());
+    return static_cast<ProfileTrackId>(tracks_.size() - 1);
+}
+
+void Profiler::recordSpan(ProfileTrackId track, ProfileZoneId zone, std::int64_t start_ns, std::int64_t end_ns,
+                          std::uint32_t depth) {
+    if (!isEnabled()) {
+        return;
+    }
+    ThreadState* state;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (track >= tracks_.size()) {
+            throw std::out_of_range("Unknown profiler track");
+        }
+        state = tracks_[track];
+    }
+    record(*state, zone, depth, start_ns, end_ns, 0);
+}
+
+void Profiler::record(ThreadState& state, ProfileZoneId zone, std::uint32_t depth, std::int64_t start_ns,
+                      std::int64_t end_ns, std::uint64_t child_ns, const HardwareCounters::Sample& counters,
+                      std::uint64_t cells) {
+    const auto duration = static_cast<std::uint64_t>(std::max<std::int64_t>(end_ns - start_ns, 0));
+    const auto self = duration - std::min(duration, child_ns);
+
+    // Single writer: plain load/store pairs suffice
+    ZoneStats& stats = state.stats(zone);
+    add(stats.calls, 1);
+    add(stats.total_ns, duration);
+    add(stats.self_ns, self);
+    if (duration < stats.min_ns.load(std::memory_order_relaxed)) {
+        stats.min_ns.store(duration, std::memory_order_relaxed);
+    }
+    if (duration > stats.max_ns.load(std::memory_order_relaxed)) {
+        stats.max_ns.store(duration, std::memory_order_relaxed);
+    }
+    if (counters.cycles | counters.instructions | counters.cache_misses | counters.branch_misses) {
+        add(stats.cycles, counters.cycles);
+        add(stats.instructions, counters.instructions);
+        add(stats.cache_misses, counters.cache_misses);
+        add(stats.branch_misses, counters.branch_misses);
+    }
+    if (cells > 0) {
+        add(stats.cells, cells);
+    }
+
+    const std::uint64_t index = state.written.load(std::memory_order_relaxed);
+    state.ring[index % kRingCapacity] = {zone, depth, start_ns, end_ns};
+    state.written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::startTimer(const std::string& name) {
+    if (isEnabled()) {
+        beginZone(registerZone(name));
+    }
+}
+
+void Profiler::endTimer(const std::string& name) {
+    ProfileZoneId zone;
+    if (!isEnabled() || !findZone(name, zone)) {
+        return;
+    }
+    // Zones left open inside the named one are closed with it
+    ThreadState& state = threadState();
+    auto it = std::find_if(state.open.rbegin(), state.open.rend(),
+                           [zone](const OpenZone& open) { return open.zone == zone; });
+    if (it == state.open.rend()) {
+        return;
+    }
+    for (auto depth = std::distance(state.open.rbegin(), it); depth >= 0; --depth) {
+        endZone();
+    }
+}
+
+void Profiler::recordMemoryUsage(const std::string& operation, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MemoryData& data = memory_data_[operation];
+    data.allocations.push_back(bytes);
+    data.total_allocated += bytes;
+    data.peak_usage = std::max(data.peak_usage, bytes);
+}
+
+void Profiler::recordCacheAccess(const std::string& cache, bool hit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CacheStats& stats = cache_stats_[cache];
+    ++(hit ? stats.hits : stats.misses);
+}
+
+Profiler::CacheStats Profiler::getCacheStats(const std::string& cache) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_stats_.find(cache);
+    return it != cache_stats_.end() ? it->second : CacheStats();
+}
+
+std::vector<std::shared_ptr<Profiler::ThreadState>> Profiler::threadStates() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_;
+}
+
+Profiler::ZoneTotals Profiler::totals(ProfileZoneId zone) const {
+    ZoneTotals result;
+    for (const auto& state : threadStates()) {
+        const ZoneStats* block = state->stats_blocks[zone / kStatsBlock].load(std::memory_order_acquire);
+        if (!block) {
+            continue;
+        }
+        const ZoneStats& stats = block[zone % kStatsBlock];
+        result.calls += stats.calls.load(std::memory_order_relaxed);
+        result.total_ns += stats.total_ns.load(std::memory_order_relaxed);
+        result.self_ns += stats.self_ns.load(std::memory_order_relaxed);
+        result.min_ns = std::min(result.min_ns, stats.min_ns.load(std::memory_order_relaxed));
+        result.max_ns = std::max(result.max_ns, stats.max_ns.load(std::memory_order_relaxed));
+        result.counters.cycles += stats.cycles.load(std::memory_order_relaxed);
+        result.counters.instructions += stats.instructions.load(std::memory_order_relaxed);
+        result.counters.cache_misses += stats.cache_misses.load(std::memory_order_relaxed);
+        result.counters.branch_misses += stats.branch_misses.load(std::memory_order_relaxed);
+        result.cells += stats.cells.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+double Profiler::getAverageTime(const std::string& name) const {
+    ProfileZoneId zone;
+    if (!findZone(name, zone)) {
+        return 0.0;
+    }
+    ZoneTotals t = totals(zone);
+    return t.calls > 0 ? t.total_ns / kNsPerMs / t.calls : 0.0;
+}
+
+double Profiler::getTotalTime(const std::string& name) const {
+    ProfileZoneId zone;
+    return findZone(name, zone) ? totals(zone).total_ns / kNsPerMs : 0.0;
+}
+
+double Profiler::getSelfTime(const std::string& name) const {
+    ProfileZoneId zone;
+    return findZone(name, zone) ? totals(zone).self_ns / kNsPerMs : 0.0;
+}
+
+size_t Profiler::getCallCount(const std::string& name) const {
+    ProfileZoneId zone;
+    return findZone(name, zone) ? static_cast<size_t>(totals(zone).calls) : 0;
+}
+
+HardwareCounters::Sample Profiler::getCounters(const std::string& name) const {
+    ProfileZoneId zone;
+    return findZone(name, zone) ? totals(zone).counters : HardwareCounters::Sample();
+}
+
+std::uint64_t Profiler::getCells(const std::string& name) const {
+    ProfileZoneId zone;
+    return findZone(name, zone) ? totals(zone).cells : 0;
+}
+
+void Profiler::writeReport(std::ostream& out) const {
+    std::vector<std::string> names;
+    std::unordered_map<std::string, MemoryData> memory;
+    std::unordered_map<std::string, CacheStats> caches;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        names = zone_names_;
+        memory = memory_data_;
+        caches = cache_stats_;
+    }
+
+    std::vector<std::pair<std::string, ZoneTotals>> rows;
+    for (size_t id = 0; id < names.size(); ++id) {
+        ZoneTotals t = totals(static_cast<ProfileZoneId>(id));
+        if (t.calls > 0) {
+            rows.emplace_back(names[id], t);
+        }
+    }
+    std::sort(rows.begin(), rows.end(),
+              [](const auto& a, const auto& b) { return a.second.total_ns > b.second.total_ns; });
+    const bool counted = std::any_of(rows.begin(), rows.end(), [](const auto& row) {
+        return row.second.counters.cycles > 0 || row.second.counters.instructions > 0;
+    });
+
+    out << "=== Profile Report ===\n";
+    out << std::left << std::setw(40) << "Zone" << std::right
+        << std::setw(12) << "Calls" << std::setw(14) << "Total (ms)" << std::setw(14) << "Self (ms)"
+        << std::setw(12) << "Avg (ms)" << std::setw(12) << "Min (ms)" << std::setw(12) << "Max (ms)";
+    if (counted) {
+        out << std::setw(8) << "IPC" << std::setw(14) << "LLC misses" << std::setw(14) << "Br misses"
+            << std::setw(10) << "GB/s" << std::setw(10) << "B/cell";
+    }
+    out << "\n";
+    out << std::fixed << std::setprecision(3);
+    for (const auto& [name, t] : rows) {
+        out << std::left << std::setw(40) << name << std::right
+            << std::setw(12) << t.calls
+            << std::setw(14) << t.total_ns / kNsPerMs
+            << std::setw(14) << t.self_ns / kNsPerMs
+            << std::setw(12) << t.total_ns / kNsPerMs / t.calls
+            << std::setw(12) << t.min_ns / kNsPerMs
+            << std::setw(12) << t.max_ns / kNsPerMs;
+        if (counted) {
+            // Bandwidth is LLC-miss traffic over the zone's inclusive time
+            const double bytes = static_cast<double>(t.counters.memoryBytes());
+            out << std::setw(8) << std::setprecision(2) << t.counters.ipc()
+                << std::setw(14) << t.counters.cache_misses << std::setw(14) << t.counters.branch_misses
+                << std::setw(10) << (t.total_ns > 0 ? bytes / t.total_ns : 0.0);
+            if (t.cells > 0) {
+                out << std::setw(10) << bytes / t.cells;
+            } else {
+                out << std::setw(10) << "-";
+            }
+            out << std::setprecision(3);
+        }
+        out << "\n";
+    }
+
+    if (!memory.empty()) {
+        out << "\n=== Memory Usage ===\n";
+        for (const auto& [operation, data] : memory) {
+            out << std::left << std::setw(40) << operation << std::right
+                << " total " << data.total_allocated << " bytes, peak " << data.peak_usage
+                << " bytes, " << data.allocations.size() << " records\n";
+        }
+    }
+
+    if (!caches.empty()) {
+        out << "\n=== Cache Hit Rates ===\n";
+        for (const auto& [cache, stats] : caches) {
+            out << std::left << std::setw(40) << cache << std::right
+                << " " << stats.hits << " hits, " << stats.misses << " misses, "
+                << std::setprecision(1) << 100.0 * stats.hitRate() << "% hit rate\n" << std::setprecision(3);
+        }
+    }
+}
+
+void Profiler::generateReport() const {
+    writeReport(std::cout);
+}
+
+void Profiler::exportToFile(const std::string& filename) const {
+    std::ofstream out(filename);
+    if (!out) {
+        throw std::runtime_error("Cannot open profile report: " + filename);
+    }
+    writeReport(out);
+}
+
+void Profiler::exportChromeTrace(const std::string& filename) const {
+    std::ofstream out(filename);
+    if (!out) {
+        throw std::runtime_error("Cannot open trace file: " + filename);
+    }
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        names.reserve(zone_names_.size());
+        for (const auto& name : zone_names_) {
+            names.push_back(escapeJson(name));
+        }
+    }
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    out << std::fixed << std::setprecision(3);
+    for (const auto& state : threadStates()) {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << state->tid
+            << ",\"args\":{\"name\":\""
+            << (state->name.empty() ? "thread " + std::to_string(state->tid) : escapeJson(state->name)) << "\"}}";
+        first = false;
+
+        // Copy the retained window, then drop whatever the owner overwrote
+        // while it was being copied
+        const std::uint64_t written = state->written.load(std::memory_order_acquire);
+        std::uint64_t begin = std::max(state->cleared.load(std::memory_order_relaxed),
+                                       written > kRingCapacity ? written - kRingCapacity : 0);
+        std::vector<Event> events;
+        events.reserve(static_cast<size_t>(written - begin));
+        for (std::uint64_t i = begin; i < written; ++i) {
+            events.push_back(state->ring[i % kRingCapacity]);
+        }
+        const std::uint64_t after = state->written.load(std::memory_order_acquire);
+        if (after > kRingCapacity && after - kRingCapacity > begin) {
+            const std::uint64_t lost = std::min<std::uint64_t>(after - kRingCapacity - begin, events.size());
+            events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(lost));
+        }
+
+        for (const Event& event : events) {
+            const std::string& name = event.zone < names.size() ? names[event.zone] : std::string();
+            out << ",\n{\"name\":\"" << name << "\",\"cat\":\"semipro\",\"ph\":\"X\",\"pid\":1,\"tid\":" << state->tid
+                << ",\"ts\":" << event.start_ns / 1e3 << ",\"dur\":" << (event.end_ns - event.start_ns) / 1e3
+                << ",\"args\":{\"depth\":" << event.depth << "}}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+void Profiler::reset() {
+    for (const auto& state : threadStates()) {
+        for (auto& slot : state->stats_blocks) {
+            ZoneStats* block = slot.load(std::memory_order_acquire);
+            if (!block) {
+                continue;
+            }
+            for (size_t i = 0; i < kStatsBlock; ++i) {
+                block[i].calls.store(0, std::memory_order_relaxed);
+                block[i].total_ns.store(0, std::memory_order_relaxed);
+                block[i].self_ns.store(0, std::memory_order_relaxed);
+                block[i].min_ns.store(UINT64_MAX, std::memory_order_relaxed);
+                block[i].max_ns.store(0, std::memory_order_relaxed);
+                block[i].cycles.store(0, std::memory_order_relaxed);
+                block[i].instructions.store(0, std::memory_order_relaxed);
+                block[i].cache_misses.store(0, std::memory_order_relaxed);
+                block[i].branch_misses.store(0, std::memory_order_relaxed);
+                block[i].cells.store(0, std::memory_order_relaxed);
+            }
+        }
+        state->cleared.store(state->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    memory_data_.clear();
+    cache_stats_.clear();
+}
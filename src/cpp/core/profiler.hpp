@@ -1,75 +1,236 @@
 #ifndef PROFILER_HPP
 #define PROFILER_HPP
 
+#include "hardware_counters.hpp"
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <mutex>
 
+// Interned name of a profiling zone
+using ProfileZoneId = std::uint32_t;
+// A named timeline that is not a thread, such as a GPU queue
+using ProfileTrackId = std::uint32_t;
+
+// Hierarchical profiler with per-thread event buffers.
+//
+// Closing a zone appends one event to the calling thread's ring buffer and
+// updates that thread's per-zone totals; no lock is taken and nothing is
+// allocated. Zones nest: each zone's self time excludes the zones opened
+// inside it. Reports and trace exports merge the thread buffers. A ring
+// keeps the most recent kRingCapacity events of its thread for tracing,
+// while the per-zone totals cover every call. Times are in milliseconds.
+//
+// With hardware counters enabled, each zone also accumulates the cycles,
+// instructions, cache and branch misses of its calls (including nested
+// zones) and the grid cells its kernel reported through addCells(), and
+// the report adds IPC, estimated memory bandwidth and bytes per cell.
 class Profiler {
 public:
+    static constexpr std::size_t kMaxZones = 4096;
+    static constexpr std::size_t kRingCapacity = std::size_t(1) << 16;
+
     static Profiler& getInstance();
-    
+
+    // Zones
+    ProfileZoneId registerZone(const std::string& name);
+    std::string zoneName(ProfileZoneId zone) const;
+    void beginZone(ProfileZoneId zone);
+    void endZone(); // Closes the innermost open zone of the calling thread
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+    // Starts or stops collecting CPU counters per zone; returns whether
+    // they are being collected (see HardwareCounters::lastError())
+    bool enableHardwareCounters(bool enable);
+    // Credits grid cells to the innermost open zone of the calling thread
+    void addCells(std::uint64_t cells);
+
+    // Tracks hold spans timed elsewhere, e.g. read back from GPU timestamp
+    // queries, and appear in reports and traces beside the threads. Each
+    // track takes spans from one thread at a time; recordSpan takes the
+    // registry lock, so it suits a few spans per frame, not inner loops.
+    ProfileTrackId registerTrack(const std::string& name);
+    void recordSpan(ProfileTrackId track, ProfileZoneId zone, std::int64_t start_ns, std::int64_t end_ns,
+                    std::uint32_t depth = 0);
+    // The clock of every zone and span: nanoseconds since the profiler started
+    std::int64_t clockNs() const { return now(); }
+
     // Timing functions
     void startTimer(const std::string& name);
     void endTimer(const std::string& name);
-    
+
     // Memory tracking
     void recordMemoryUsage(const std::string& operation, size_t bytes);
-    
+
+    // Cache hit rates
+    struct CacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+        double hitRate() const { return hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0; }
+    };
+    void recordCacheAccess(const std::string& cache, bool hit);
+    CacheStats getCacheStats(const std::string& cache) const;
+
     // Performance metrics
     double getAverageTime(const std::string& name) const;
     double getTotalTime(const std::string& name) const;
+    double getSelfTime(const std::string& name) const;
     size_t getCallCount(const std::string& name) const;
-    
+    // Summed over every call of the zone, zero without counters
+    HardwareCounters::Sample getCounters(const std::string& name) const;
+    std::uint64_t getCells(const std::string& name) const;
+
     // Reporting
     void generateReport() const;
     void exportToFile(const std::string& filename) const;
+    // Chrome trace event JSON, loadable in chrome://tracing and Perfetto
+    void exportChromeTrace(const std::string& filename) const;
+    // Must not race with open zones
     void reset();
-    
+
 private:
-    Profiler() = default;
-    
-    struct TimingData {
-        std::vector<double> times;
-        std::chrono::high_resolution_clock::time_point start_time;
-        bool is_running = false;
-        
-        double getTotal() const;
-        double getAverage() const;
-        double getMin() const;
-        double getMax() const;
+    Profiler();
+
+    struct ZoneStats {
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> total_ns{0};
+        std::atomic<std::uint64_t> self_ns{0};
+        std::atomic<std::uint64_t> min_ns{UINT64_MAX};
+        std::atomic<std::uint64_t> max_ns{0};
+        std::atomic<std::uint64_t> cycles{0};
+        std::atomic<std::uint64_t> instructions{0};
+        std::atomic<std::uint64_t> cache_misses{0};
+        std::atomic<std::uint64_t> branch_misses{0};
+        std::atomic<std::uint64_t> cells{0};
+    };
+
+    struct Event {
+        ProfileZoneId zone;
+        std::uint32_t depth;
+        std::int64_t start_ns;
+        std::int64_t end_ns;
+    };
+
+    struct OpenZone {
+        ProfileZoneId zone;
+        std::int64_t start_ns;
+        std::int64_t child_ns;
+        HardwareCounters::Sample counters; // At the start
+        std::uint64_t cells;
+    };
+
+    static constexpr std::size_t kStatsBlock = 256;
+
+    // Written only by its own thread; other threads read it through
+    // relaxed atomics and the published event count.
+    struct ThreadState {
+        std::uint32_t tid = 0;
+        std::string name; // Tracks only
+        std::unique_ptr<Event[]> ring{new Event[kRingCapacity]};
+        std::atomic<std::uint64_t> written{0};
+        std::atomic<std::uint64_t> cleared{0};
+        std::atomic<ZoneStats*> stats_blocks[kMaxZones / kStatsBlock] = {};
+        std::vector<OpenZone> open;
+
+        ~ThreadState();
+        ZoneStats& stats(ProfileZoneId zone);
     };
-    
+
+    struct ZoneTotals {
+        std::uint64_t calls = 0;
+        std::uint64_t total_ns = 0;
+        std::uint64_t self_ns = 0;
+        std::uint64_t min_ns = UINT64_MAX;
+        std::uint64_t max_ns = 0;
+        HardwareCounters::Sample counters;
+        std::uint64_t cells = 0;
+    };
+
     struct MemoryData {
         std::vector<size_t> allocations;
         size_t total_allocated = 0;
         size_t peak_usage = 0;
     };
-    
+
+    ThreadState& threadState();
+    // Appends the event to the state's ring and adds it to its totals
+    void record(ThreadState& state, ProfileZoneId zone, std::uint32_t depth, std::int64_t start_ns,
+                std::int64_t end_ns, std::uint64_t child_ns, const HardwareCounters::Sample& counters = {},
+                std::uint64_t cells = 0);
+    std::int64_t now() const;
+    bool findZone(const std::string& name, ProfileZoneId& zone) const;
+    ZoneTotals totals(ProfileZoneId zone) const;
+    std::vector<std::shared_ptr<ThreadState>> threadStates() const;
+    void writeReport(std::ostream& out) const;
+
+    const std::chrono::steady_clock::time_point epoch_;
+    std::atomic<bool> enabled_{true};
+
     mutable std::mutex mutex_;
-    std::unordered_map<std::string, TimingData> timing_data_;
+    std::vector<std::string> zone_names_;
+    std::unordered_map<std::string, ProfileZoneId> zone_ids_;
+    std::vector<std::shared_ptr<ThreadState>> threads_;
+    std::vector<ThreadState*> tracks_;
     std::unordered_map<std::string, MemoryData> memory_data_;
+    std::unordered_map<std::string, CacheStats> cache_stats_;
 };
 
-// RAII timer class
-class ScopedTimer {
+// RAII zone for an interned id
+class ProfileZone {
 public:
-    explicit ScopedTimer(const std::string& name) : name_(name) {
-        Profiler::getInstance().startTimer(name_);
+    explicit ProfileZone(ProfileZoneId zone) : active_(Profiler::getInstance().isEnabled()) {
+        if (active_) {
+            Profiler::getInstance().beginZone(zone);
+        }
     }
-    
-    ~ScopedTimer() {
-        Profiler::getInstance().endTimer(name_);
+
+    ~ProfileZone() {
+        if (active_) {
+            Profiler::getInstance().endZone();
+        }
     }
-    
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    bool active_;
+};
+
+// RAII timer class for names computed at run time
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const std::string& name)
+        : zone_(Profiler::getInstance().registerZone(name)) {}
+
 private:
-    std::string name_;
+    ProfileZone zone_;
 };
 
-// Convenience macro
-#define PROFILE_SCOPE(name) ScopedTimer _timer(name)
-#define PROFILE_FUNCTION() ScopedTimer _timer(__FUNCTION__)
+// Convenience macros. The zone id is interned once per call site, so the
+// name must not change between executions of the same line; use
+// ScopedTimer for computed names. Defining SEMIPRO_DISABLE_PROFILING
+// compiles the zones out.
+#define SEMIPRO_PROFILE_CONCAT_INNER(a, b) a##b
+#define SEMIPRO_PROFILE_CONCAT(a, b) SEMIPRO_PROFILE_CONCAT_INNER(a, b)
+#ifdef SEMIPRO_DISABLE_PROFILING
+#define PROFILE_SCOPE(name) ((void)0)
+#else
+#define PROFILE_SCOPE(name) \
+    static const ProfileZoneId SEMIPRO_PROFILE_CONCAT(_profile_zone_id_, __LINE__) = \
+        Profiler::getInstance().registerZone(name); \
+    ProfileZone SEMIPRO_PROFILE_CONCAT(_profile_zone_, __LINE__)(SEMIPRO_PROFILE_CONCAT(_profile_zone_id_, __LINE__))
+#endif
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+// Grid cells processed by the enclosing zone, for its bytes per cell
+#ifdef SEMIPRO_DISABLE_PROFILING
+#define PROFILE_CELLS(cells) ((void)0)
+#else
+#define PROFILE_CELLS(cells) Profiler::getInstance().addCells(static_cast<std::uint64_t>(cells))
+#endif
 
 #endif // PROFILER_HPP
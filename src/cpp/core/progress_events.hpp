@@ -0,0 +1,168 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef PROGRESS_EVENTS_HPP
+#define PROGRESS_EVENTS_HPP
+
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Structured progress and telemetry from long-running solvers.
+//
+// Solvers publish events instead of printing; the orchestrator, the REST
+// WebSocket stream or a console printer subscribe. Events carry string
+// literals and numbers only, so publishing allocates nothing, and with no
+// subscriber it costs one relaxed atomic load. Listeners run on the
+// publishing thread and must be thread-safe, since solvers run
+// concurrently.
+struct ProgressEvent {
+    enum class Kind { Begin, Progress, Metric, Warning, End };
+
+    Kind kind = Kind::Progress;
+    const char* source = ""; // The solver, e.g. "monte_carlo"
+    const char* name = "";   // Units counted, metric or warning text
+    double value = 0.0;      // Units done, or the metric's value
+    double total = 0.0;      // Units in all; 0 when not a count
+    std::thread::id thread = std::this_thread::get_id();
+
+    double fraction() const { return total > 0.0 ? value / total : 0.0; }
+};
+
+class ProgressEvents {
+public:
+    using Listener = std::function<void(const ProgressEvent&)>;
+
+    static ProgressEvents& getInstance() {
+        static ProgressEvents instance;
+        return instance;
+    }
+
+    bool observed() const { return count_.load(std::memory_order_relaxed) > 0; }
+
+    void publish(const ProgressEvent& event) const {
+        if (!observed()) {
+            return;
+        }
+        for (const auto& entry : *std::atomic_load(&listeners_)) {
+            entry.second(event);
+        }
+    }
+
+    // Returns an id for unsubscribe(); listeners may be added and removed
+    // while events are being published
+    int subscribe(Listener listener) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto next = std::make_shared<List>(*std::atomic_load(&listeners_));
+        next->emplace_back(next_id_, std::move(listener));
+        std::atomic_store(&listeners_, std::shared_ptr<const List>(std::move(next)));
+        count_.fetch_add(1, std::memory_order_relaxed);
+        return next_id_++;
+    }
+
+    void unsubscribe(int id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto next = std::make_shared<List>();
+        for (const auto& entry : *std::atomic_load(&listeners_)) {
+            if (entry.first != id) {
+                next->push_back(entry);
+            }
+        }
+        if (next->size() != std::atomic_load(&listeners_)->size()) {
+            count_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        std::atomic_store(&listeners_, std::shared_ptr<const List>(std::move(next)));
+    }
+
+    // One line per event on stdout; off by default, as it serializes the
+    // threads that publish
+    void setConsoleOutput(bool enabled) {
+        std::lock_guard<std::mutex> lock(console_mutex_);
+        if (enabled && console_id_ < 0) {
+            console_id_ = subscribe([](const ProgressEvent& event) {
+                static std::mutex output_mutex;
+                std::lock_guard<std::mutex> output_lock(output_mutex);
+                std::cout << "[" << event.source << "] ";
+                switch (event.kind) {
+                case ProgressEvent::Kind::Begin: std::cout << "begin " << event.total << " " << event.name; break;
+                case ProgressEvent::Kind::Progress:
+                    std::cout << static_cast<int>(100.0 * event.fraction()) << "% (" << event.value << "/"
+                              << event.total << " " << event.name << ")";
+                    break;
+                case ProgressEvent::Kind::Metric: std::cout << event.name << " = " << event.value; break;
+                case ProgressEvent::Kind::Warning: std::cout << "WARNING: " << event.name << " (" << event.value << ")"; break;
+                case ProgressEvent::Kind::End: std::cout << "end after " << event.value << " " << event.name; break;
+                }
+                std::cout << "\n";
+            });
+        } else if (!enabled && console_id_ >= 0) {
+            unsubscribe(console_id_);
+            console_id_ = -1;
+        }
+    }
+
+private:
+    using List = std::vector<std::pair<int, Listener>>;
+
+    ProgressEvents() : listeners_(std::make_shared<const List>()) {}
+
+    std::shared_ptr<const List> listeners_;
+    std::atomic<int> count_{0};
+    std::mutex mutex_;
+    int next_id_ = 0;
+    std::mutex console_mutex_;
+    int console_id_ = -1;
+};
+
+// One solver run as a stream of events. update() may be called on every
+// iteration: it only publishes when another `step` of the total (1% by
+// default) is done, and is a compare and a branch otherwise.
+class ProgressReporter {
+public:
+    ProgressReporter(const char* source, const char* units, double total, double step = 0.01)
+        : source_(source), units_(units), total_(total), stride_(total * step), next_(stride_) {
+        emit(ProgressEvent::Kind::Begin, units_, 0.0);
+    }
+    ~ProgressReporter() { emit(ProgressEvent::Kind::End, units_, done_); }
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    void update(double done) {
+        done_ = done;
+        if (done >= next_) {
+            next_ = done + stride_;
+            emit(ProgressEvent::Kind::Progress, units_, done);
+        }
+    }
+    void metric(const char* name, double value) const { emit(ProgressEvent::Kind::Metric, name, value); }
+    void warning(const char* message, double value = 0.0) const {
+        emit(ProgressEvent::Kind::Warning, message, value);
+    }
+
+private:
+    void emit(ProgressEvent::Kind kind, const char* name, double value) const {
+        const ProgressEvents& events = ProgressEvents::getInstance();
+        if (!events.observed()) {
+            return;
+        }
+        ProgressEvent event;
+        event.kind = kind;
+        event.source = source_;
+        event.name = name;
+        event.value = value;
+        event.total = kind == ProgressEvent::Kind::Metric || kind == ProgressEvent::Kind::Warning ? 0.0 : total_;
+        events.publish(event);
+    }
+
+    const char* source_;
+    const char* units_;
+    double total_;
+    double stride_;
+    double next_;
+    double done_ = 0.0;
+};
+
+#endif // PROGRESS_EVENTS_HPP
@@ -0,0 +1,119 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "reproducibility.hpp"
+#include <atomic>
+#include <random>
+#include <utility>
+
+namespace {
+
+std::atomic<bool> g_enabled{false};
+std::atomic<std::uint64_t> g_seed{0};
+
+// The calling thread's step, set by Reproducibility::Step
+struct StepSlot {
+    std::string wafer;
+    std::uint64_t step = 0;
+    bool open = false;
+};
+
+StepSlot& stepSlot() {
+    thread_local StepSlot slot;
+    return slot;
+}
+
+// splitmix64 finaliser: every input bit reaches every output bit
+std::uint64_t mix(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// FNV-1a
+std::uint64_t hashName(const std::string& name) {
+    std::uint64_t hash = 0xCBF29CE484222325ull;
+    for (unsigned char c : name) {
+        hash = (hash ^ c) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// Tiles of a named module's stream start past any cell index
+constexpr std::uint64_t kNamedTile = 1ull << 63;
+
+} // namespace
+
+void Reproducibility::enable(std::uint64_t seed) {
+    g_seed.store(seed, std::memory_order_relaxed);
+    g_enabled.store(true, std::memory_order_release);
+}
+
+void Reproducibility::disable() {
+    g_enabled.store(false, std::memory_order_release);
+}
+
+bool Reproducibility::isEnabled() {
+    return g_enabled.load(std::memory_order_acquire);
+}
+
+std::uint64_t Reproducibility::seed() {
+    return g_seed.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Reproducibility::streamKey(std::uint64_t seed, const std::string& wafer, std::uint64_t step) {
+    return mix(mix(mix(seed) ^ hashName(wafer)) ^ step);
+}
+
+std::uint64_t Reproducibility::key(std::uint64_t tile) {
+    if (!isEnabled()) {
+        std::random_device device;
+        return static_cast<std::uint64_t>(device()) << 32 | device();
+    }
+    const StepSlot& slot = stepSlot();
+    const std::uint64_t stream = slot.open ? streamKey(seed(), slot.wafer, slot.step) : streamKey(seed(), "", 0);
+    return mix(stream ^ mix(tile));
+}
+
+std::uint64_t Reproducibility::key(const std::string& name) {
+    return key(kNamedTile | hashName(name));
+}
+
+Reproducibility::Step::Step(const std::string& wafer, std::uint64_t step) {
+    StepSlot& slot = stepSlot();
+    saved_wafer_ = std::move(slot.wafer);
+    saved_step_ = slot.step;
+    saved_open_ = slot.open;
+    slot.wafer = wafer;
+    slot.step = step;
+    slot.open = true;
+}
+
+Reproducibility::Step::~Step() {
+    StepSlot& slot = stepSlot();
+    slot.wafer = std::move(saved_wafer_);
+    slot.step = saved_step_;
+    slot.open = saved_open_;
+}
+
+double reproducibleSum(const double* values, std::size_t n, bool parallel) {
+    struct Kahan {
+        double sum = 0.0;
+        double carry = 0.0;
+    };
+    const Kahan total = orderedReduce(
+        n, Kahan{},
+        [values](Kahan& k, std::size_t i) {
+            const double y = values[i] - k.carry;
+            const double t = k.sum + y;
+            k.carry = (t - k.sum) - y;
+            k.sum = t;
+        },
+        [](Kahan& into, const Kahan& from) {
+            const double y = from.sum - (into.carry + from.carry);
+            const double t = into.sum + y;
+            into.carry = (t - into.sum) - y;
+            into.sum = t;
+        },
+        parallel);
+    return total.sum;
+}
@@ -0,0 +1,93 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef REPRODUCIBILITY_HPP
+#define REPRODUCIBILITY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bit-reproducible results from parallel kernels.
+//
+// A parallel kernel gives the same bits on any number of threads when its
+// random numbers come from a counter-based generator (Philox4x32) keyed by
+// what is being simulated rather than by the thread that draws them, and
+// when its floating-point sums are added in an order fixed by the data
+// size alone (orderedReduce, reproducibleSum below). Kernels do both
+// whether or not the mode is on; the mode decides where keys come from.
+// While it is on, key() derives them from the global seed and the
+// (wafer, step) the calling thread is simulating, so two runs with the
+// same seed agree to the last bit, as regression baselines need. While it
+// is off, key() draws fresh ones from std::random_device, as the kernels
+// always did.
+class Reproducibility {
+public:
+    static void enable(std::uint64_t seed);
+    static void disable();
+    static bool isEnabled();
+    static std::uint64_t seed();
+
+    // Key of the random stream of one step on a wafer
+    static std::uint64_t streamKey(std::uint64_t seed, const std::string& wafer, std::uint64_t step);
+
+    // Key for one tile (cell block, wafer in a batch, sample) of the calling
+    // thread's step, or for the named module when no step is open; random
+    // when the mode is off
+    static std::uint64_t key(std::uint64_t tile = 0);
+    static std::uint64_t key(const std::string& name);
+
+    // Makes step number `step` on the wafer the calling thread's step for
+    // its lifetime; the engine opens one around each process
+    class Step {
+    public:
+        Step(const std::string& wafer, std::uint64_t step);
+        ~Step();
+        Step(const Step&) = delete;
+        Step& operator=(const Step&) = delete;
+
+    private:
+        std::string saved_wafer_;
+        std::uint64_t saved_step_;
+        bool saved_open_;
+    };
+};
+
+// Indices per chunk of orderedReduce: enough work per task, few partials
+constexpr std::size_t kReduceChunk = 1024;
+
+// Folds indices [0, n) into a T whose bits do not depend on the thread
+// count. Chunks of `chunk` indices are accumulated left to right into
+// copies of identity, in parallel, and the chunk partials combined
+// pairwise in a fixed tree. accumulate(T&, i) adds index i;
+// combine(T& into, const T& from) adds a later partial to an earlier one.
+template <typename T, typename Accumulate, typename Combine>
+T orderedReduce(std::size_t n, const T& identity, Accumulate accumulate, Combine combine, bool parallel = true,
+                std::size_t chunk = kReduceChunk) {
+    if (n == 0) {
+        return identity;
+    }
+    chunk = chunk > 0 ? chunk : 1;
+    const long chunks = static_cast<long>((n + chunk - 1) / chunk);
+    std::vector<T> partials(static_cast<std::size_t>(chunks), identity);
+#pragma omp parallel for schedule(dynamic) if (parallel && chunks > 1)
+    for (long c = 0; c < chunks; ++c) {
+        const std::size_t end = std::min(n, (static_cast<std::size_t>(c) + 1) * chunk);
+        for (std::size_t i = static_cast<std::size_t>(c) * chunk; i < end; ++i) {
+            accumulate(partials[static_cast<std::size_t>(c)], i);
+        }
+    }
+    for (long stride = 1; stride < chunks; stride *= 2) {
+        for (long c = 0; c + stride < chunks; c += 2 * stride) {
+            combine(partials[static_cast<std::size_t>(c)], partials[static_cast<std::size_t>(c + stride)]);
+        }
+    }
+    return partials.front();
+}
+
+// Sum of values[0, n), Kahan-compensated within fixed blocks and the
+// blocks added pairwise: the same bits on any number of threads, and
+// error that grows with log n rather than n
+double reproducibleSum(const double* values, std::size_t n, bool parallel = true);
+
+#endif // REPRODUCIBILITY_HPP
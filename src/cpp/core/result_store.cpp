@@ -0,0 +1,256 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "result_store.hpp"
+#include "json_value.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr int kStoreFormat = 1;
+// Every column's .npy header is padded to this size, so it can be
+// rewritten in place as rows are appended
+constexpr std::size_t kHeaderBytes = 128;
+
+struct Column {
+    const char* table;
+    const char* name;
+    const char* dtype;
+    const char* dictionary; // Null for a plain column
+};
+
+// In the order ResultStore::writeBatch() writes them
+const Column kColumns[] = {
+    {"records", "id", "<i8", nullptr},          {"records", "source", "<i4", "source"},
+    {"records", "label", "<i4", "label"},       {"records", "ok", "|u1", nullptr},
+    {"records", "seconds", "<f8", nullptr},     {"values", "record", "<i8", nullptr},
+    {"values", "group", "<i4", "group"},        {"values", "name", "<i4", "name"},
+    {"values", "value", "<f8", nullptr},
+};
+const char* const kDictionaryNames[] = {"source", "label", "group", "name"};
+
+fs::path columnPath(const fs::path& root, const Column& column) {
+    return root / column.table / (std::string(column.name) + ".npy");
+}
+
+std::string npyHeader(const char* dtype, std::size_t rows) {
+    std::string header = "\x93NUMPY";
+    header += '\x01';
+    header += '\x00';
+    const std::size_t length = kHeaderBytes - 10;
+    header += static_cast<char>(length & 0xff);
+    header += static_cast<char>(length >> 8);
+    header += "{'descr': '" + std::string(dtype) + "', 'fortran_order': False, 'shape': (" +
+              std::to_string(rows) + ",), }";
+    header.resize(kHeaderBytes - 1, ' ');
+    header += '\n';
+    return header;
+}
+
+// Appends rows to a column file and updates its header to the new total
+template <typename T>
+void appendColumn(const fs::path& file, const Column& column, const std::vector<T>& rows, std::size_t total) {
+    std::fstream out(file, std::ios::in | std::ios::out | std::ios::binary);
+    out.seekp(0, std::ios::end);
+    out.write(reinterpret_cast<const char*>(rows.data()), static_cast<std::streamsize>(rows.size() * sizeof(T)));
+    out.seekp(0);
+    out << npyHeader(column.dtype, total);
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Failed writing result column: " + file.string());
+    }
+}
+
+} // namespace
+
+std::int32_t ResultStore::Dictionary::encode(const std::string& text) {
+    const auto found = codes.emplace(text, static_cast<std::int32_t>(strings.size()));
+    if (found.second) {
+        strings.push_back(text);
+    }
+    return found.first->second;
+}
+
+ResultStore::ResultStore(const std::string& path) : ResultStore(path, Options()) {}
+
+ResultStore::ResultStore(const std::string& path, const Options& options) : path_(path), options_(options) {
+    options_.batch_records = std::max<std::size_t>(1, options_.batch_records);
+    const fs::path root(path);
+    if (fs::exists(root)) {
+        if (!fs::exists(root / "schema.json")) {
+            throw std::runtime_error("Refusing to replace " + path + ": not a result store");
+        }
+        fs::remove_all(root);
+    }
+    fs::create_directories(root / "records");
+    fs::create_directories(root / "values");
+    for (const auto& column : kColumns) {
+        std::ofstream out(columnPath(root, column), std::ios::binary | std::ios::trunc);
+        out << npyHeader(column.dtype, 0);
+        if (!out) {
+            throw std::runtime_error("Cannot create result column: " + columnPath(root, column).string());
+        }
+    }
+    std::lock_guard<std::mutex> io(io_mutex_);
+    writeSchema(std::vector<std::vector<std::string>>(kDictionaries));
+}
+
+ResultStore::~ResultStore() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+std::int64_t ResultStore::append(const ResultRecord& record) {
+    if (record.keys.size() != record.values.size()) {
+        throw std::invalid_argument("Result record has " + std::to_string(record.keys.size()) + " keys for " +
+                                    std::to_string(record.values.size()) + " values");
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_) {
+        throw std::runtime_error("Result store is closed: " + path_);
+    }
+    {
+        std::lock_guard<std::mutex> io(io_mutex_);
+        if (!error_.empty()) {
+            throw std::runtime_error(error_);
+        }
+    }
+    const std::int64_t id = next_id_++;
+    batch_.id.push_back(id);
+    batch_.source.push_back(dictionaries_[kSource].encode(record.source));
+    batch_.label.push_back(dictionaries_[kLabel].encode(record.label));
+    batch_.ok.push_back(record.ok ? 1 : 0);
+    batch_.seconds.push_back(record.seconds);
+    for (std::size_t v = 0; v < record.values.size(); ++v) {
+        batch_.value_record.push_back(id);
+        batch_.value_group.push_back(dictionaries_[kGroup].encode(record.keys[v].first));
+        batch_.value_name.push_back(dictionaries_[kName].encode(record.keys[v].second));
+        batch_.value.push_back(record.values[v]);
+    }
+    if (batch_.size() >= options_.batch_records) {
+        writeBatch(lock);
+    }
+    return id;
+}
+
+void ResultStore::writeBatch(std::unique_lock<std::mutex>& lock) {
+    Batch batch;
+    std::swap(batch, batch_);
+    std::vector<std::vector<std::string>> dictionaries(kDictionaries);
+    for (int d = 0; d < kDictionaries; ++d) {
+        dictionaries[d] = dictionaries_[d].strings;
+    }
+    // Taken before letting go of the gathering lock, so batches are
+    // written in the order they filled
+    std::lock_guard<std::mutex> io(io_mutex_);
+    lock.unlock();
+    if (!error_.empty() || batch.size() == 0) {
+        return;
+    }
+    try {
+        const fs::path root(path_);
+        const std::size_t records = records_written_ + batch.size();
+        const std::size_t values = values_written_ + batch.value.size();
+        appendColumn(columnPath(root, kColumns[0]), kColumns[0], batch.id, records);
+        appendColumn(columnPath(root, kColumns[1]), kColumns[1], batch.source, records);
+        appendColumn(columnPath(root, kColumns[2]), kColumns[2], batch.label, records);
+        appendColumn(columnPath(root, kColumns[3]), kColumns[3], batch.ok, records);
+        appendColumn(columnPath(root, kColumns[4]), kColumns[4], batch.seconds, records);
+        appendColumn(columnPath(root, kColumns[5]), kColumns[5], batch.value_record, values);
+        appendColumn(columnPath(root, kColumns[6]), kColumns[6], batch.value_group, values);
+        appendColumn(columnPath(root, kColumns[7]), kColumns[7], batch.value_name, values);
+        appendColumn(columnPath(root, kColumns[8]), kColumns[8], batch.value, values);
+        records_written_ = records;
+        values_written_ = values;
+        writeSchema(dictionaries);
+    } catch (const std::exception& e) {
+        error_ = e.what();
+    }
+}
+
+void ResultStore::writeSchema(const std::vector<std::vector<std::string>>& dictionaries) const {
+    std::string text;
+    {
+        SemiPRO::JsonWriter out(text, 2);
+        out.beginObject().key("format").integer(kStoreFormat).key("tables").beginObject();
+        for (const char* table : {"records", "values"}) {
+            const bool records = std::string(table) == "records";
+            out.key(table).beginObject();
+            out.key("rows").integer(static_cast<long long>(records ? records_written_ : values_written_));
+            out.key("columns").beginArray();
+            for (const auto& column : kColumns) {
+                if (std::string(column.table) != table) {
+                    continue;
+                }
+                out.beginObject().key("name").string(column.name).key("dtype").string(column.dtype);
+                if (column.dictionary) {
+                    out.key("dictionary").string(column.dictionary);
+                }
+                out.endObject();
+            }
+            out.endArray().endObject();
+        }
+        out.endObject().key("dictionaries").beginObject();
+        for (int d = 0; d < kDictionaries; ++d) {
+            out.key(kDictionaryNames[d]).beginArray();
+            for (const auto& entry : dictionaries[d]) {
+                out.string(entry);
+            }
+            out.endArray();
+        }
+        out.endObject().endObject();
+    }
+    // Written aside and renamed, so readers never see half a schema
+    const fs::path schema = fs::path(path_) / "schema.json";
+    const fs::path temporary = fs::path(path_) / "schema.json.tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file << text << '\n';
+        if (!file) {
+            throw std::runtime_error("Failed writing result store schema: " + schema.string());
+        }
+    }
+    fs::rename(temporary, schema);
+}
+
+void ResultStore::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    writeBatch(lock);
+    std::lock_guard<std::mutex> io(io_mutex_);
+    if (!error_.empty()) {
+        throw std::runtime_error(error_);
+    }
+}
+
+void ResultStore::close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    writeBatch(lock);
+    std::lock_guard<std::mutex> io(io_mutex_);
+    if (!error_.empty()) {
+        throw std::runtime_error(error_);
+    }
+}
+
+std::size_t ResultStore::recordCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<std::size_t>(next_id_);
+}
+
+std::size_t ResultStore::recordsWritten() const {
+    std::lock_guard<std::mutex> io(io_mutex_);
+    return records_written_;
+}
+
+std::size_t ResultStore::valuesWritten() const {
+    std::lock_guard<std::mutex> io(io_mutex_);
+    return values_written_;
+}
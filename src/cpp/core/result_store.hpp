@@ -0,0 +1,132 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef RESULT_STORE_HPP
+#define RESULT_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// One result of a batch job, sweep point, optimizer evaluation,
+// measurement or inspection: what produced it, whether it succeeded, how
+// long it took and any number of named values, each in a group such as
+// "parameter", "objective" or "statistic".
+struct ResultRecord {
+    std::string source; // E.g. a process operation, "optimizer", "metrology"
+    std::string label;  // Wafer, evaluation id, measurement type, ...
+    bool ok = true;
+    double seconds = 0.0;
+    std::vector<std::pair<std::string, std::string>> keys; // (group, name) of each value
+    std::vector<double> values;
+
+    ResultRecord() = default;
+    ResultRecord(std::string source_name, std::string label_name, bool succeeded = true, double elapsed = 0.0)
+        : source(std::move(source_name)), label(std::move(label_name)), ok(succeeded), seconds(elapsed) {}
+
+    void add(const std::string& group, const std::string& name, double value) {
+        keys.emplace_back(group, name);
+        values.push_back(value);
+    }
+    template <typename Map>
+    void addAll(const std::string& group, const Map& named_values) {
+        for (const auto& entry : named_values) {
+            add(group, entry.first, entry.second);
+        }
+    }
+};
+
+// Columnar store of ResultRecords that analysis reads as whole columns
+// instead of parsing a file per job.
+//
+// The store is a directory of two tables. "records" has one row per
+// record: id (int64), source and label (int32 dictionary codes), ok
+// (uint8) and seconds (float64). "values" has one row per value: record
+// (int64, the record's id), group and name (int32 dictionary codes) and
+// value (float64). Each column is a little-endian .npy file, and
+// schema.json lists the tables, their row counts and columns and the
+// strings of each dictionary, so a run of 10^5 jobs with a handful of
+// parameter names stores each name once. NumPy memory-maps the columns,
+// and pyarrow wraps them as Arrow arrays (the codes as dictionary arrays)
+// without copying; see src/python/result_store.py.
+//
+// append() may be called from many threads at once. Records gather into
+// record batches of batch_records, and a full batch is appended to the
+// column files by the thread that filled it while the others carry on
+// with the next one; batches land in the order they filled. schema.json
+// is replaced after each batch, and its row counts only cover complete
+// batches, so a reader never sees part of one.
+class ResultStore {
+public:
+    struct Options {
+        std::size_t batch_records = 4096; // Records per record batch
+    };
+
+    // Creates the store, replacing one already at path; throws
+    // std::runtime_error if path holds something else or cannot be written
+    explicit ResultStore(const std::string& path);
+    ResultStore(const std::string& path, const Options& options);
+    // Writes the last batch; errors are dropped, call close() to see them
+    ~ResultStore();
+    ResultStore(const ResultStore&) = delete;
+    ResultStore& operator=(const ResultStore&) = delete;
+
+    // Returns the record's id, numbered from 0 in order of append();
+    // throws std::runtime_error once a batch failed to write or the store
+    // is closed
+    std::int64_t append(const ResultRecord& record);
+    // Writes the records gathered so far as a (short) batch
+    void flush();
+    // Flushes and closes the store; later calls are no-ops
+    void close();
+
+    const std::string& path() const { return path_; }
+    std::size_t recordCount() const;  // Appended so far
+    std::size_t recordsWritten() const;
+    std::size_t valuesWritten() const;
+
+private:
+    // A record batch, column by column
+    struct Batch {
+        std::vector<std::int64_t> id;
+        std::vector<std::int32_t> source, label;
+        std::vector<std::uint8_t> ok;
+        std::vector<double> seconds;
+        std::vector<std::int64_t> value_record;
+        std::vector<std::int32_t> value_group, value_name;
+        std::vector<double> value;
+        std::size_t size() const { return id.size(); }
+    };
+
+    // Strings of a dictionary-encoded column, by code
+    struct Dictionary {
+        std::vector<std::string> strings;
+        std::unordered_map<std::string, std::int32_t> codes;
+        std::int32_t encode(const std::string& text);
+    };
+    enum { kSource, kLabel, kGroup, kName, kDictionaries };
+
+    // Takes the gathered batch and writes it; expects lock held on mutex_,
+    // which is released once the batch is in order to be written
+    void writeBatch(std::unique_lock<std::mutex>& lock);
+    void writeSchema(const std::vector<std::vector<std::string>>& dictionaries) const; // Expects io_mutex_ held
+
+    std::string path_;
+    Options options_;
+
+    mutable std::mutex mutex_; // Gathering
+    Batch batch_;
+    Dictionary dictionaries_[kDictionaries];
+    std::int64_t next_id_ = 0;
+    bool closed_ = false;
+
+    // Column files and schema.json; taken after mutex_ when both are held
+    mutable std::mutex io_mutex_;
+    std::string error_;
+    std::size_t records_written_ = 0;
+    std::size_t values_written_ = 0;
+};
+
+#endif // RESULT_STORE_HPP
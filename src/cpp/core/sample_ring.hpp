@@ -0,0 +1,78 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace SemiPRO {
+
+// Fixed-capacity history of one channel of samples, written by a single
+// thread and read by any number of others. push() is wait-free and never
+// allocates; once the ring is full each sample overwrites the oldest.
+// Readers never block the writer: they copy what they want and keep only
+// the samples the writer did not overwrite meanwhile, seqlock fashion.
+// Samples are numbered from 0 in the order written.
+class SampleRing {
+public:
+    // Throws std::invalid_argument for a zero capacity
+    explicit SampleRing(std::size_t capacity)
+        : slots_(capacity ? new std::atomic<double>[capacity] : nullptr), capacity_(capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("SampleRing capacity must be positive");
+        }
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            slots_[i].store(0.0, std::memory_order_relaxed);
+        }
+    }
+    SampleRing(const SampleRing&) = delete;
+    SampleRing& operator=(const SampleRing&) = delete;
+
+    std::size_t capacity() const { return capacity_; }
+
+    // Writer only
+    void push(double value) {
+        const std::uint64_t n = written_.load(std::memory_order_relaxed);
+        begun_.store(n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slots_[n % capacity_].store(value, std::memory_order_relaxed);
+        written_.store(n + 1, std::memory_order_release);
+    }
+
+    // Number of samples pushed so far
+    std::uint64_t written() const { return written_.load(std::memory_order_acquire); }
+
+    // Replaces out with the samples numbered from `from` up to written()
+    // that are still held, oldest first, and returns the number of the
+    // first; samples overwritten before they could be copied are skipped.
+    std::uint64_t read(std::uint64_t from, std::vector<double>& out) const {
+        const std::uint64_t end = written_.load(std::memory_order_acquire);
+        std::uint64_t first = std::max(from, end > capacity_ ? end - capacity_ : 0);
+        out.clear();
+        for (std::uint64_t n = first; n < end; ++n) {
+            out.push_back(slots_[n % capacity_].load(std::memory_order_relaxed));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // The writer may be overwriting sample begun - capacity right now
+        const std::uint64_t begun = begun_.load(std::memory_order_relaxed);
+        const std::uint64_t lost_before = begun > capacity_ ? begun - capacity_ : 0;
+        if (lost_before > first) {
+            const std::uint64_t lost = std::min<std::uint64_t>(lost_before - first, out.size());
+            out.erase(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(lost));
+            first += lost;
+        }
+        return first;
+    }
+
+private:
+    std::unique_ptr<std::atomic<double>[]> slots_;
+    std::size_t capacity_;
+    alignas(64) std::atomic<std::uint64_t> begun_{0};
+    std::atomic<std::uint64_t> written_{0};
+};
+
+} // namespace SemiPRO
@@ -0,0 +1,111 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef SHARDED_REGISTRY_HPP
+#define SHARDED_REGISTRY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Name -> shared_ptr<T> map for read-mostly registries on hot paths.
+//
+// Names hash to one of kShards shards, each with its own reader-writer
+// lock, so lookups only contend with writers of the same shard and never
+// with each other. find() hands out the stored shared_ptr: a stable handle
+// that stays valid however the registry changes after it returns, so
+// callers keep it for the length of their work instead of holding any
+// lock. Whole-registry operations (clear, assign) lock every shard in
+// order and are seen all at once; snapshot() is consistent per shard only.
+template <typename T>
+class ShardedRegistry {
+public:
+    static constexpr std::size_t kShards = 16;
+    using Handle = std::shared_ptr<T>;
+
+    // Null if the name is not registered
+    Handle find(const std::string& name) const {
+        const Shard& shard = shardOf(name);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.entries.find(name);
+        return it != shard.entries.end() ? it->second : nullptr;
+    }
+
+    // Registers or replaces; true if an entry was replaced
+    bool insert(const std::string& name, Handle value) {
+        Shard& shard = shardOf(name);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto result = shard.entries.insert_or_assign(name, std::move(value));
+        if (result.second) {
+            size_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return !result.second;
+    }
+
+    bool erase(const std::string& name) {
+        Shard& shard = shardOf(name);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if (shard.entries.erase(name) == 0) {
+            return false;
+        }
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void clear() { assign({}); }
+
+    // Replaces the whole contents at once
+    void assign(std::vector<std::pair<std::string, Handle>> entries) {
+        std::vector<std::unique_lock<std::shared_mutex>> locks;
+        locks.reserve(kShards);
+        for (Shard& shard : shards_) {
+            locks.emplace_back(shard.mutex);
+        }
+        for (Shard& shard : shards_) {
+            shard.entries.clear();
+        }
+        std::size_t size = 0;
+        for (auto& entry : entries) {
+            if (shardOf(entry.first).entries.insert_or_assign(entry.first, std::move(entry.second)).second) {
+                ++size;
+            }
+        }
+        size_.store(size, std::memory_order_relaxed);
+    }
+
+    std::size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    // Every entry, shard by shard, for work too long to do under a lock
+    std::vector<std::pair<std::string, Handle>> snapshot() const {
+        std::vector<std::pair<std::string, Handle>> entries;
+        entries.reserve(size());
+        for (const Shard& shard : shards_) {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            entries.insert(entries.end(), shard.entries.begin(), shard.entries.end());
+        }
+        return entries;
+    }
+
+private:
+    // A cache line each, so shards locked by different threads do not
+    // share one
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, Handle> entries;
+    };
+
+    Shard& shardOf(const std::string& name) { return shards_[std::hash<std::string>{}(name) % kShards]; }
+    const Shard& shardOf(const std::string& name) const {
+        return shards_[std::hash<std::string>{}(name) % kShards];
+    }
+
+    Shard shards_[kShards];
+    std::atomic<std::size_t> size_{0};
+};
+
+#endif // SHARDED_REGISTRY_HPP
@@ -2,20 +2,65 @@
 #include "simulation_engine.hpp"
 #include "utils.hpp"
 #include "enhanced_error_handling.hpp"
+#include "fft.hpp"
+#include "gpu_compute.hpp"
 #include "advanced_logger.hpp"
 #include "memory_manager.hpp"
 #include "config_manager.hpp"
+#include "checkpoint_io.hpp"
+#include "kernel_status.hpp"
+#include "task_scheduler.hpp"
+#include "performance_utils.hpp"
+#include "process_schema.hpp"
+#include "reproducibility.hpp"
+#include "telemetry.hpp"
 #include "../physics/enhanced_oxidation.hpp"
 #include "../physics/enhanced_doping.hpp"
 #include "../physics/enhanced_deposition.hpp"
 #include "../physics/enhanced_etching.hpp"
+#ifdef SEMIPRO_HAVE_VULKAN
+#include "../renderer/vulkan_compute.hpp"
+#endif
 #include <iostream>
 #include <fstream>
 #include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
 #include <thread>
+#include <unordered_set>
 #include <future>
 
+namespace {
+
+// Finished processes by operation and outcome (success, cached, failure)
+void countProcesses(const std::string& operation, const char* result, size_t n = 1) {
+    SemiPRO::MetricsRegistry::getInstance()
+        .counter("semipro_engine_processes_total", "Processes finished by the simulation engine",
+                 {{"process", operation}, {"result", result}})
+        .add(n);
+}
+
+// Processes executing, for the lifetime of the guard
+class RunningProcess {
+public:
+    RunningProcess() : gauge_(running()) { gauge_.add(1.0); }
+    ~RunningProcess() { gauge_.add(-1.0); }
+
+private:
+    static SemiPRO::MetricGauge& running() {
+        static SemiPRO::MetricGauge& gauge = SemiPRO::MetricsRegistry::getInstance().gauge(
+            "semipro_engine_processes_running", "Processes the simulation engine is executing");
+        return gauge;
+    }
+
+    SemiPRO::MetricGauge& gauge_;
+};
+
+} // namespace
+
 SimulationEngine& SimulationEngine::getInstance() {
     static SimulationEngine instance;
 
@@ -38,6 +83,31 @@ SimulationEngine& SimulationEngine::getInstance() {
             memory_mgr.setMemoryLimit(static_cast<size_t>(memory_limit));
         }
 
+        // Spans of timed operations, for an OpenTelemetry collector
+        const auto trace_file = CONFIG_GET("telemetry.otlp_trace_file", std::string, std::string());
+        if (!trace_file.empty()) {
+            try {
+                logger.getPerformanceMonitor().setTraceWriter(
+                    std::make_shared<SemiPRO::OtlpTraceWriter>(trace_file));
+            } catch (const std::runtime_error& e) {
+                SEMIPRO_WARNING(std::string("Trace export disabled: ") + e.what());
+            }
+        }
+
+        // Same seed, same bits, on any number of threads
+        if (CONFIG_GET("reproducibility.enabled", bool, false)) {
+            Reproducibility::enable(static_cast<std::uint64_t>(CONFIG_GET("reproducibility.seed", int, 0)));
+        }
+
+        auto& metrics = SemiPRO::MetricsRegistry::getInstance();
+        metrics.gaugeCallback("semipro_engine_wafers", "Wafers registered with the simulation engine", [] {
+            return static_cast<double>(instance.wafers_.size());
+        });
+        metrics.gaugeCallback("semipro_engine_batch_queue_length", "Processes queued for the next executeBatch", [] {
+            std::lock_guard<std::mutex> lock(instance.state_mutex_);
+            return static_cast<double>(instance.batch_queue_.size());
+        });
+
         SEMIPRO_INFO("Advanced systems initialized (logging, config, memory)");
         systems_initialized = true;
     }
@@ -46,24 +116,26 @@ SimulationEngine& SimulationEngine::getInstance() {
 }
 
 void SimulationEngine::initialize(const std::string& config_file) {
-    std::lock_guard<std::mutex> lock(state_mutex_);
-    
-    if (is_initialized_) {
-        Logger::getInstance().log("SimulationEngine already initialized");
-        return;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        
+        if (is_initialized_) {
+            Logger::getInstance().log("SimulationEngine already initialized");
+            return;
+        }
+        
+        config_file_ = config_file;
+        thread_count_ = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        
+        // Reset statistics
+        stats_ = Statistics{};
+        simulation_start_time_ = std::chrono::system_clock::now();
+        
+        is_initialized_ = true;
     }
     
-    config_file_ = config_file;
-    
-    // Initialize worker threads
-    thread_count_ = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
-    worker_threads_.reserve(thread_count_);
-    
-    // Reset statistics
-    stats_ = Statistics{};
-    simulation_start_time_ = std::chrono::system_clock::now();
-    
-    is_initialized_ = true;
+    // Outside the state lock: resizing waits for running tasks, which take it
+    TaskScheduler::getInstance().resize(thread_count_);
     Logger::getInstance().log("SimulationEngine initialized with " + std::to_string(thread_count_) + " threads");
 }
 
@@ -77,16 +149,13 @@ void SimulationEngine::shutdown() {
     // Stop all operations
     is_running_ = false;
     
-    // Wait for worker threads to finish
-    for (auto& thread : worker_threads_) {
-        if (thread.joinable()) {
-            thread.join();
-        }
-    }
-    worker_threads_.clear();
-    
     // Clear all data
     wafers_.clear();
+    if (residency_) {
+        residency_->clear();
+    }
+    wafer_templates_.clear();
+    shape_templates_.clear();
     while (!batch_queue_.empty()) {
         batch_queue_.pop();
     }
@@ -112,40 +181,181 @@ std::shared_ptr<WaferEnhanced> SimulationEngine::createWafer(double diameter, do
     return wafer;
 }
 
-void SimulationEngine::registerWafer(std::shared_ptr<WaferEnhanced> wafer, const std::string& name) {
+std::shared_ptr<WaferEnhanced> SimulationEngine::createWafer(double diameter, double thickness,
+                                                           const std::string& material, int rows, int cols) {
+    if (!is_initialized_) {
+        throw std::runtime_error("SimulationEngine not initialized");
+    }
+
+    const auto key = std::make_tuple(diameter, thickness, material, rows, cols);
+    std::shared_ptr<const WaferEnhanced> prototype;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        auto it = shape_templates_.find(key);
+        if (it != shape_templates_.end()) {
+            prototype = it->second;
+        }
+    }
+    if (!prototype) {
+        // Initialized outside the lock; a concurrent first call may build
+        // one too, and the first to insert wins
+        auto wafer = std::make_shared<WaferEnhanced>(diameter, thickness, material);
+        wafer->initializeGridParallel(rows, cols);
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        prototype = shape_templates_.emplace(key, std::move(wafer)).first->second;
+    }
+    return prototype->clone();
+}
+
+void SimulationEngine::registerWaferTemplate(const std::string& name, std::shared_ptr<WaferEnhanced> wafer) {
+    if (!wafer) {
+        throw std::invalid_argument("Wafer template " + name + " is null");
+    }
+    std::shared_ptr<const WaferEnhanced> prototype = wafer->clone();
     std::lock_guard<std::mutex> lock(state_mutex_);
-    
-    if (wafers_.find(name) != wafers_.end()) {
+    wafer_templates_[name] = std::move(prototype);
+    Logger::getInstance().log("Registered wafer template: " + name);
+}
+
+bool SimulationEngine::unregisterWaferTemplate(const std::string& name) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return wafer_templates_.erase(name) > 0;
+}
+
+std::shared_ptr<WaferEnhanced> SimulationEngine::createWaferFromTemplate(const std::string& template_name) {
+    std::shared_ptr<const WaferEnhanced> prototype;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        auto it = wafer_templates_.find(template_name);
+        if (it == wafer_templates_.end()) {
+            throw std::runtime_error("Wafer template not found: " + template_name);
+        }
+        prototype = it->second;
+    }
+    return prototype->clone();
+}
+
+void SimulationEngine::spawnWafers(const std::string& template_name, const std::vector<std::string>& names) {
+    std::shared_ptr<const WaferEnhanced> prototype;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        auto it = wafer_templates_.find(template_name);
+        if (it == wafer_templates_.end()) {
+            throw std::runtime_error("Wafer template not found: " + template_name);
+        }
+        prototype = it->second;
+    }
+    for (const auto& name : names) {
+        wafers_.insert(name, registration(name, prototype->clone()));
+    }
+    Logger::getInstance().log("Spawned " + std::to_string(names.size()) + " wafers from template: " +
+                              template_name);
+}
+
+void SimulationEngine::registerWafer(std::shared_ptr<WaferEnhanced> wafer, const std::string& name) {
+    // A new entry, so the wafer's steps count from zero again
+    if (wafers_.insert(name, registration(name, std::move(wafer)))) {
         Logger::getInstance().log("Warning: Overwriting existing wafer: " + name);
     }
-    
-    wafers_[name] = wafer;
     Logger::getInstance().log("Registered wafer: " + name);
 }
 
 std::shared_ptr<WaferEnhanced> SimulationEngine::getWafer(const std::string& name) {
-    std::lock_guard<std::mutex> lock(state_mutex_);
-    
-    auto it = wafers_.find(name);
-    if (it == wafers_.end()) {
+    auto entry = wafers_.find(name);
+    if (!entry) {
         throw std::runtime_error("Wafer not found: " + name);
     }
-    
-    return it->second;
+    auto wafer = waferOf(name, *entry);
+    if (!wafer) {
+        throw std::runtime_error("Wafer not found: " + name);
+    }
+    return wafer;
+}
+
+bool SimulationEngine::unregisterWafer(const std::string& name) {
+    if (auto residency = std::atomic_load(&residency_)) {
+        residency->evict(name);
+    }
+    return wafers_.erase(name);
+}
+
+std::shared_ptr<SimulationEngine::RegisteredWafer> SimulationEngine::registration(const std::string& name,
+                                                                                  std::shared_ptr<WaferEnhanced> wafer) {
+    if (auto residency = std::atomic_load(&residency_)) {
+        residency->admit(name, std::move(wafer));
+        return std::make_shared<RegisteredWafer>(nullptr);
+    }
+    return std::make_shared<RegisteredWafer>(std::move(wafer));
+}
+
+std::shared_ptr<WaferEnhanced> SimulationEngine::waferOf(const std::string& name, const RegisteredWafer& entry) const {
+    if (entry.wafer) {
+        return entry.wafer;
+    }
+    auto residency = std::atomic_load(&residency_);
+    return residency ? residency->acquire(name) : nullptr;
+}
+
+void SimulationEngine::enableWaferResidency(const SemiPRO::WaferResidency::Limits& limits) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (residency_) {
+        return;
+    }
+    auto residency = std::make_shared<SemiPRO::WaferResidency>(limits);
+    for (const auto& entry : wafers_.snapshot()) {
+        if (!entry.second->wafer) {
+            continue;
+        }
+        residency->admit(entry.first, entry.second->wafer);
+        auto moved = std::make_shared<RegisteredWafer>(nullptr);
+        moved->steps.store(entry.second->steps.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        wafers_.insert(entry.first, std::move(moved));
+    }
+    std::atomic_store(&residency_, std::move(residency));
+    Logger::getInstance().log("Wafer residency enabled for " + std::to_string(wafers_.size()) + " wafers");
+}
+
+std::shared_ptr<SemiPRO::WaferResidency> SimulationEngine::getWaferResidency() const {
+    return std::atomic_load(&residency_);
+}
+
+void SimulationEngine::setResultStore(std::shared_ptr<ResultStore> store) {
+    std::atomic_store(&result_store_, std::move(store));
+}
+
+std::shared_ptr<ResultStore> SimulationEngine::getResultStore() const {
+    return std::atomic_load(&result_store_);
+}
+
+void SimulationEngine::recordResult(const ResultRecord& record) {
+    if (auto store = std::atomic_load(&result_store_)) {
+        try {
+            store->append(record);
+        } catch (const std::exception& e) {
+            Logger::getInstance().log("Warning: Result of " + record.source + " on " + record.label +
+                                      " not recorded: " + e.what());
+        }
+    }
 }
 
 std::future<bool> SimulationEngine::simulateProcessAsync(const std::string& wafer_name,
                                                         const ProcessParameters& params) {
-    std::cout << "DEBUG: simulateProcessAsync called for wafer: " << wafer_name << ", operation: " << params.operation << std::endl;
+    SEMIPRO_LOGF(DEBUG, SIMULATION, "simulateProcessAsync: wafer {}, operation {}", wafer_name, params.operation);
 
-    return std::async(std::launch::async, [this, wafer_name, params]() {
-        std::cout << "DEBUG: Inside async lambda, about to call executeProcess" << std::endl;
+    ProcessParameters task_params = params;
+    if (!task_params.cancellation.stopPossible()) {
+        task_params.cancellation = CancellationToken::current();
+    }
+    // The process's span continues the caller's trace on the pool thread
+    const SemiPRO::TraceContext::Ids caller_span = SemiPRO::TraceContext::current();
+    return TaskScheduler::getInstance().submit([this, wafer_name, task_params, caller_span]() {
+        SemiPRO::TraceContext::Scope trace(caller_span);
         try {
-            bool result = executeProcess(wafer_name, params);
-            std::cout << "DEBUG: executeProcess returned: " << (result ? "true" : "false") << std::endl;
+            bool result = executeProcess(wafer_name, task_params);
+            SEMIPRO_LOGF(DEBUG, SIMULATION, "executeProcess returned {}", result);
             return result;
         } catch (const std::exception& e) {
-            std::cout << "DEBUG: Exception in executeProcess: " << e.what() << std::endl;
+            SEMIPRO_LOGF(ERROR, SIMULATION, "Exception in executeProcess: {}", e.what());
             return false;
         }
     });
@@ -158,23 +368,109 @@ void SimulationEngine::addProcessToBatch(const std::string& wafer_name, const Pr
 }
 
 std::future<std::vector<bool>> SimulationEngine::executeBatch() {
-    return std::async(std::launch::async, [this]() {
-        std::vector<bool> results;
-        
+    // Take the whole queue up front; executeProcess needs the state lock
+    std::vector<std::pair<std::string, ProcessParameters>> entries;
+    {
         std::lock_guard<std::mutex> lock(state_mutex_);
-        
+        entries.reserve(batch_queue_.size());
         while (!batch_queue_.empty()) {
-            auto [wafer_name, params] = batch_queue_.front();
+            entries.push_back(std::move(batch_queue_.front()));
             batch_queue_.pop();
-            
-            bool success = executeProcess(wafer_name, params);
-            results.push_back(success);
         }
-        
-        return results;
+    }
+    return runProcesses(std::move(entries));
+}
+
+std::future<std::vector<bool>> SimulationEngine::runProcesses(
+    std::vector<std::pair<std::string, ProcessParameters>> entries) {
+    // Processes on one wafer run in queue order within a single task, while
+    // different wafers proceed in parallel
+    std::unordered_map<std::string, std::vector<size_t>> by_wafer;
+    std::vector<std::string> wafer_order;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto& indices = by_wafer[entries[i].first];
+        if (indices.empty()) {
+            wafer_order.push_back(entries[i].first);
+        }
+        indices.push_back(i);
+    }
+    
+    auto& scheduler = TaskScheduler::getInstance();
+    const SemiPRO::TraceContext::Ids caller_span = SemiPRO::TraceContext::current();
+    auto shared_entries = std::make_shared<decltype(entries)>(std::move(entries));
+    auto results = std::make_shared<std::vector<char>>(shared_entries->size(), 0);
+    std::vector<std::future<void>> wafer_tasks;
+    wafer_tasks.reserve(wafer_order.size());
+    for (const auto& wafer_name : wafer_order) {
+        wafer_tasks.push_back(scheduler.submit(
+            [this, shared_entries, results, caller_span, indices = std::move(by_wafer[wafer_name])]() {
+                SemiPRO::TraceContext::Scope trace(caller_span);
+                for (size_t i : indices) {
+                    const auto& [wafer_name, params] = (*shared_entries)[i];
+                    const auto start = std::chrono::steady_clock::now();
+                    (*results)[i] = executeProcess(wafer_name, params);
+                    if (std::atomic_load(&result_store_)) {
+                        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                        ResultRecord record(params.operation, wafer_name, (*results)[i], elapsed.count());
+                        record.addAll("parameter", params.parameters);
+                        record.add("parameter", "duration", params.duration);
+                        recordResult(record);
+                    }
+                }
+            }));
+    }
+    
+    return scheduler.submit([results, tasks = std::move(wafer_tasks)]() mutable {
+        for (auto& task : tasks) {
+            TaskScheduler::getInstance().wait(task);
+        }
+        return std::vector<bool>(results->begin(), results->end());
     });
 }
 
+std::future<std::vector<bool>> SimulationEngine::simulateProcessBatch(const BatchParameters& batch) {
+    for (const auto& column : batch.columns) {
+        if (column.second.size() != batch.size()) {
+            throw std::invalid_argument("Batch column '" + column.first + "' has " +
+                                        std::to_string(column.second.size()) + " values for " +
+                                        std::to_string(batch.size()) + " wafers");
+        }
+    }
+
+    bool batched = batch.operation == "oxidation";
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        batched = batched && !result_cache_;
+    }
+    // The batched model sees every wafer's initial state at once
+    std::unordered_set<std::string> distinct(batch.wafer_names.begin(), batch.wafer_names.end());
+    batched = batched && distinct.size() == batch.size();
+
+    BatchParameters task_batch = batch;
+    if (!task_batch.cancellation.stopPossible()) {
+        task_batch.cancellation = CancellationToken::current();
+    }
+    if (batched) {
+        const SemiPRO::TraceContext::Ids caller_span = SemiPRO::TraceContext::current();
+        return TaskScheduler::getInstance().submit([this, task_batch, caller_span]() {
+            SemiPRO::TraceContext::Scope trace(caller_span);
+            return executeOxidationBatch(task_batch);
+        });
+    }
+
+    std::vector<std::pair<std::string, ProcessParameters>> entries;
+    entries.reserve(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        ProcessParameters params(batch.operation, 0.0);
+        for (const auto& column : batch.columns) {
+            params.parameters[column.first] = column.second[i];
+        }
+        params.cancellation = task_batch.cancellation;
+        entries.emplace_back(batch.wafer_names[i], std::move(params));
+    }
+    return runProcesses(std::move(entries));
+}
+
 void SimulationEngine::clearBatch() {
     std::lock_guard<std::mutex> lock(state_mutex_);
     while (!batch_queue_.empty()) {
@@ -199,6 +495,11 @@ SimulationEngine::Statistics SimulationEngine::getStatistics() const {
     return stats_;
 }
 
+void SimulationEngine::reportError(const SimulationError& error) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    errors_.push_back(error);
+}
+
 std::vector<SimulationEngine::SimulationError> SimulationEngine::getErrors(ErrorLevel min_level) const {
     std::lock_guard<std::mutex> lock(state_mutex_);
     std::vector<SimulationError> filtered_errors;
@@ -215,6 +516,194 @@ void SimulationEngine::clearErrors() {
     errors_.clear();
 }
 
+namespace {
+
+// Result cache entries: the key hashes the wafer record plus everything in
+// ProcessParameters that affects the outcome (not the priority), and for
+// stochastic operations in reproducibility mode the random stream of the
+// (wafer, step); the value is the byte runs in which the record after the
+// process differs from the record before it. Bump the format when either
+// layout changes.
+constexpr std::uint32_t kResultCacheFormat = 1;
+constexpr std::uint32_t kWaferStateChunk = checkpointTag('W', 'S', 'T', 'A');
+
+std::vector<unsigned char> writeWaferImage(const WaferEnhanced& wafer) {
+    std::vector<unsigned char> image;
+    CheckpointWriter out(image);
+    out.beginChunk(kWaferStateChunk);
+    wafer.writeCheckpoint(out);
+    out.finish();
+    return image;
+}
+
+void readWaferImage(WaferEnhanced& wafer, std::vector<unsigned char> image) {
+    CheckpointReader in(std::make_shared<const std::vector<unsigned char>>(std::move(image)));
+    for (const auto& chunk : in.chunks()) {
+        if (chunk.tag == kWaferStateChunk) {
+            auto cursor = in.cursor(chunk);
+            wafer.readCheckpoint(cursor);
+            return;
+        }
+    }
+    throw std::runtime_error("Cached wafer state has no wafer record");
+}
+
+template <typename Map>
+std::vector<std::pair<std::string, typename Map::mapped_type>> sortedEntries(const Map& values) {
+    std::vector<std::pair<std::string, typename Map::mapped_type>> entries(values.begin(), values.end());
+    std::sort(entries.begin(), entries.end());
+    return entries;
+}
+
+// Operations whose kernels draw from Reproducibility::key()
+bool drawsRandomNumbers(const std::string& operation) {
+    return operation == "etching" || operation == "deposition";
+}
+
+// random_stream is 0 unless the outcome depends on the step's stream
+SemiPRO::CacheKey resultCacheKey(const std::vector<unsigned char>& state,
+                                 const SimulationEngine::ProcessParameters& params, bool gpu,
+                                 std::uint64_t random_stream) {
+    SemiPRO::ContentHasher hasher;
+    hasher.update_value(kResultCacheFormat);
+    hasher.update_value(static_cast<std::uint64_t>(state.size()));
+    hasher.update(state.data(), state.size());
+    hasher.update_string(params.operation);
+    hasher.update_value(params.duration);
+    hasher.update_value(static_cast<std::uint8_t>(gpu));
+    if (random_stream != 0) {
+        hasher.update_value(random_stream);
+    }
+    const auto parameters = sortedEntries(params.parameters);
+    hasher.update_value(static_cast<std::uint64_t>(parameters.size()));
+    for (const auto& entry : parameters) {
+        hasher.update_string(entry.first);
+        hasher.update_value(entry.second);
+    }
+    const auto strings = sortedEntries(params.string_parameters);
+    hasher.update_value(static_cast<std::uint64_t>(strings.size()));
+    for (const auto& entry : strings) {
+        hasher.update_string(entry.first);
+        hasher.update_string(entry.second);
+    }
+    return hasher.finish();
+}
+
+// Shared by single and batched oxidation
+SemiPRO::EnhancedOxidationPhysics& oxidationPhysics() {
+    static SemiPRO::EnhancedOxidationPhysics physics;
+    return physics;
+}
+
+// Parameter schemas of the simulate* methods
+const ProcessSchema<SemiPRO::OxidationConditions>& oxidationSchema() {
+    using namespace SemiPRO;
+    static const ProcessSchema<OxidationConditions> schema({
+        {"temperature", [](OxidationConditions& c, double v) { c.temperature = v; }, 1000.0,
+         "physics.temperature.default"},
+        {"time", [](OxidationConditions& c, double v) { c.time = v; }, 1.0},  // h
+        {"ambient", [](OxidationConditions& c, double v) {
+             c.atmosphere = v > 0.5 ? OxidationAtmosphere::WET_H2O : OxidationAtmosphere::DRY_O2;
+         }, 0.0},
+        {"pressure", [](OxidationConditions& c, double v) { c.pressure = v; }, 1.0,
+         "physics.pressure.default"},
+    });
+    return schema;
+}
+
+const ProcessSchema<SemiPRO::ImplantationConditions>& implantationSchema() {
+    using namespace SemiPRO;
+    static const ProcessSchema<ImplantationConditions> schema(
+        {
+            {"energy", [](ImplantationConditions& c, double v) { c.energy = v; }, 50.0},  // keV
+            {"dose", [](ImplantationConditions& c, double v) { c.dose = v; }, 1e15},      // cm⁻²
+            // Atomic number
+            {"species", [](ImplantationConditions& c, double v) {
+                 switch (static_cast<int>(v)) {
+                     case 15: c.species = IonSpecies::PHOSPHORUS_31; break;
+                     case 33: c.species = IonSpecies::ARSENIC_75; break;
+                     default: c.species = IonSpecies::BORON_11; break;
+                 }
+             }, 5.0},
+            {"tilt", [](ImplantationConditions& c, double v) { c.tilt_angle = v; }, 7.0},
+            {"temperature", [](ImplantationConditions& c, double v) { c.temperature = v; }, 25.0},
+        },
+        {
+            {"species", [](ImplantationConditions& c, const std::string& name) {
+                 if (name == "phosphorus" || name == "P") {
+                     c.species = IonSpecies::PHOSPHORUS_31;
+                 } else if (name == "arsenic" || name == "As") {
+                     c.species = IonSpecies::ARSENIC_75;
+                 } else {
+                     c.species = IonSpecies::BORON_11;
+                 }
+             }},
+        });
+    return schema;
+}
+
+const ProcessSchema<SemiPRO::DepositionConditions>& depositionSchema() {
+    using namespace SemiPRO;
+    // Technique stays CVD
+    static const ProcessSchema<DepositionConditions> schema(
+        {
+            {"thickness", [](DepositionConditions& c, double v) { c.target_thickness = v; }, 0.1},  // μm
+            {"temperature", [](DepositionConditions& c, double v) { c.temperature = v; }, 400.0},
+            {"pressure", [](DepositionConditions& c, double v) { c.pressure = v; }, 1.0},           // Torr
+        },
+        {
+            {"material", [](DepositionConditions& c, const std::string& name) {
+                 if (name == "copper" || name == "Cu") {
+                     c.material = MaterialType::COPPER;
+                 } else if (name == "tungsten" || name == "W") {
+                     c.material = MaterialType::TUNGSTEN;
+                 } else if (name == "silicon_dioxide" || name == "SiO2") {
+                     c.material = MaterialType::SILICON_DIOXIDE;
+                 } else if (name == "silicon_nitride" || name == "Si3N4") {
+                     c.material = MaterialType::SILICON_NITRIDE;
+                 } else if (name == "polysilicon" || name == "poly-Si" || name == "poly") {
+                     c.material = MaterialType::POLYSILICON;
+                 } else {
+                     c.material = MaterialType::ALUMINUM;
+                 }
+             }, "aluminum"},
+        });
+    return schema;
+}
+
+const ProcessSchema<SemiPRO::EtchingConditions>& etchingSchema() {
+    using namespace SemiPRO;
+    // Silicon under photoresist with fluorine chemistry, as constructed
+    static const ProcessSchema<EtchingConditions> schema({
+        {"depth", [](EtchingConditions& c, double v) { c.target_depth = v; }, 0.5},  // μm
+        // Anisotropic (> 0.5) or isotropic
+        {"type", [](EtchingConditions& c, double v) {
+             c.technique = v > 0.5 ? EtchingTechnique::RIE : EtchingTechnique::WET_CHEMICAL;
+         }, 1.0},
+        {"selectivity", [](EtchingConditions& c, double v) { c.selectivity_target = v; }, 10.0},
+        {"pressure", [](EtchingConditions& c, double v) { c.pressure = v; }, 10.0},  // mTorr
+        {"power", [](EtchingConditions& c, double v) { c.power = v; }, 100.0},       // W
+        {"bias", [](EtchingConditions& c, double v) { c.bias_voltage = v; }, 100.0}, // V
+    });
+    return schema;
+}
+
+double columnValue(const SimulationEngine::BatchParameters& batch, const std::string& key,
+                   size_t index, double fallback) {
+    auto it = batch.columns.find(key);
+    return it != batch.columns.end() ? it->second[index] : fallback;
+}
+
+} // namespace
+
+std::vector<unsigned char> SimulationEngine::captureWaferState(const std::string& name) {
+    return writeWaferImage(*getWafer(name));
+}
+
+void SimulationEngine::restoreWaferState(const std::string& name, std::vector<unsigned char> state) {
+    readWaferImage(*getWafer(name), std::move(state));
+}
+
 bool SimulationEngine::executeProcess(const std::string& wafer_name, const ProcessParameters& params) {
     using namespace SemiPRO;
 
@@ -225,6 +714,7 @@ bool SimulationEngine::executeProcess(const std::string& wafer_name, const Proce
     auto process_timer = AdvancedLogger::getInstance().createTimer(
         "process_" + params.operation, "SimulationEngine"
     );
+    RunningProcess running;
 
     try {
         // Log process start with memory info
@@ -234,43 +724,97 @@ bool SimulationEngine::executeProcess(const std::string& wafer_name, const Proce
                           " (Memory usage: " + std::to_string(memory_mgr.getCurrentUsage()) + " bytes)",
                           "SimulationEngine");
 
-        auto wafer = getWafer(wafer_name);
+        auto entry = wafers_.find(wafer_name);
+        auto wafer = entry ? waferOf(wafer_name, *entry) : nullptr;
         if (!wafer) {
             throw SystemException("Failed to retrieve wafer: " + wafer_name, SEMIPRO_ERROR_CONTEXT());
         }
+        const std::uint64_t step = entry->steps.fetch_add(1, std::memory_order_relaxed);
 
         // Update statistics
+        std::shared_ptr<SimulationCache> cache;
+        bool gpu_enabled = false;
         {
             std::lock_guard<std::mutex> lock(state_mutex_);
             stats_.total_processes++;
             stats_.processes_by_type[params.operation]++;
+            cache = result_cache_;
+            gpu_enabled = gpu_acceleration_enabled_;
         }
         
         // Execute the process based on type
         bool success = false;
+        bool cached = false;
+
+        std::vector<unsigned char> state_before;
+        CacheKey cache_key;
+        if (cache) {
+            state_before = writeWaferImage(*wafer);
+            // In reproducibility mode a stochastic step's noise is fixed by
+            // its (wafer, step) stream, so a hit must have drawn from it too
+            const std::uint64_t random_stream =
+                Reproducibility::isEnabled() && drawsRandomNumbers(params.operation)
+                    ? Reproducibility::streamKey(Reproducibility::seed(), wafer_name, step)
+                    : 0;
+            cache_key = resultCacheKey(state_before, params, gpu_enabled, random_stream);
+            if (auto delta = cache->lookup(cache_key)) {
+                try {
+                    readWaferImage(*wafer, applyCheckpointDelta(state_before, *delta));
+                    success = cached = true;
+                } catch (const std::exception& e) {
+                    // The wafer is untouched; simulate as on a miss
+                    SEMIPRO_LOG_MODULE(LogLevel::WARNING, LogCategory::SIMULATION,
+                                      "Discarding cached result " + cache_key.to_hex() + ": " + e.what(),
+                                      "SimulationEngine");
+                }
+            }
+        }
 
-        SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::SIMULATION,
-                          "Dispatching process type: " + params.operation,
-                          "SimulationEngine");
-
-        if (params.operation == "oxidation") {
-            success = simulateOxidation(wafer, params);
-        } else if (params.operation == "doping") {
-            success = simulateIonImplantation(wafer, params);
-        } else if (params.operation == "deposition") {
-            success = simulateDeposition(wafer, params);
-        } else if (params.operation == "etching") {
-            success = simulateEtching(wafer, params);
+        if (cached) {
+            SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::SIMULATION,
+                              "Replayed cached result for process type: " + params.operation,
+                              "SimulationEngine");
         } else {
-            throw ConfigurationException(
-                "Unknown process type: " + params.operation,
-                SEMIPRO_ERROR_CONTEXT()
-            );
+            SEMIPRO_LOG_MODULE(LogLevel::DEBUG, LogCategory::SIMULATION,
+                              "Dispatching process type: " + params.operation,
+                              "SimulationEngine");
+
+            CancellationScope cancellation_scope(params.cancellation);
+            Reproducibility::Step random_step(wafer_name, step);
+            if (params.operation == "oxidation") {
+                success = simulateOxidation(wafer, params);
+            } else if (params.operation == "doping") {
+                success = simulateIonImplantation(wafer, params);
+            } else if (params.operation == "deposition") {
+                success = simulateDeposition(wafer, params);
+            } else if (params.operation == "etching") {
+                success = simulateEtching(wafer, params);
+            } else {
+                throw ConfigurationException(
+                    "Unknown process type: " + params.operation,
+                    SEMIPRO_ERROR_CONTEXT()
+                );
+            }
+
+            if (success && params.cancellation.stopRequested()) {
+                // Partial results stay on the wafer but must not be replayed
+                SEMIPRO_LOG_MODULE(LogLevel::WARNING, LogCategory::SIMULATION,
+                                  "Process interrupted: " + params.operation,
+                                  "SimulationEngine");
+                success = false;
+            }
+            if (success && cache) {
+                cache->store(cache_key, checkpointDelta(state_before, writeWaferImage(*wafer)));
+            }
         }
         
         if (success) {
             std::lock_guard<std::mutex> lock(state_mutex_);
             stats_.successful_processes++;
+            if (cached) {
+                stats_.cached_processes++;
+            }
+            countProcesses(params.operation, cached ? "cached" : "success");
             ErrorManager::getInstance().reportError(
                 ErrorSeverity::INFO, ErrorCategory::SIMULATION,
                 "Process completed successfully: " + params.operation,
@@ -279,6 +823,7 @@ bool SimulationEngine::executeProcess(const std::string& wafer_name, const Proce
         } else {
             std::lock_guard<std::mutex> lock(state_mutex_);
             stats_.failed_processes++;
+            countProcesses(params.operation, "failure");
             ErrorManager::getInstance().reportError(
                 ErrorSeverity::ERROR, ErrorCategory::SIMULATION,
                 "Process failed: " + params.operation,
@@ -293,6 +838,7 @@ bool SimulationEngine::executeProcess(const std::string& wafer_name, const Proce
             std::lock_guard<std::mutex> lock(state_mutex_);
             stats_.failed_processes++;
         }
+        countProcesses(params.operation, "failure");
         ErrorManager::getInstance().reportError(e.getError());
         return false;
     } catch (const std::exception& e) {
@@ -300,6 +846,7 @@ bool SimulationEngine::executeProcess(const std::string& wafer_name, const Proce
             std::lock_guard<std::mutex> lock(state_mutex_);
             stats_.failed_processes++;
         }
+        countProcesses(params.operation, "failure");
         ErrorManager::getInstance().reportError(
             ErrorSeverity::ERROR, ErrorCategory::SYSTEM,
             "Unexpected exception in process execution: " + std::string(e.what()),
@@ -339,10 +886,73 @@ bool SimulationEngine::isPaused() const {
     return is_paused_;
 }
 
-void SimulationEngine::enableGPUAcceleration(bool enable) {
+void SimulationEngine::setThreadCount(int count) {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        thread_count_ = std::max(1, count);
+    }
+    TaskScheduler::getInstance().resize(thread_count_);
+    Logger::getInstance().log("Thread count set to " + std::to_string(thread_count_));
+}
+
+int SimulationEngine::getThreadCount() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return thread_count_;
+}
+
+void SimulationEngine::enableResultCache(bool enable, const std::string& cache_dir, size_t memory_budget) {
+    // Built outside the lock: opening a disk cache scans its directory.
+    // On disk the cache keeps SimulationCache's default 1 GB budget.
+    std::shared_ptr<SemiPRO::SimulationCache> cache;
+    if (enable) {
+        cache = std::make_shared<SemiPRO::SimulationCache>(cache_dir, size_t(1) << 30, memory_budget);
+    }
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    result_cache_ = cache;
+    Logger::getInstance().log("Result cache " + std::string(enable ? "enabled" : "disabled") +
+                             (enable && !cache_dir.empty() ? " (directory: " + cache_dir + ")" : ""));
+}
+
+bool SimulationEngine::isResultCacheEnabled() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return result_cache_ != nullptr;
+}
+
+std::shared_ptr<SemiPRO::SimulationCache> SimulationEngine::getResultCache() const {
     std::lock_guard<std::mutex> lock(state_mutex_);
-    gpu_acceleration_enabled_ = enable;
-    Logger::getInstance().log("GPU acceleration " + std::string(enable ? "enabled" : "disabled"));
+    return result_cache_;
+}
+
+void SimulationEngine::enableGPUAcceleration(bool enable) {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        gpu_acceleration_enabled_ = enable;
+    }
+    activateGPU(enable);
+}
+
+void SimulationEngine::activateGPU(bool enable) {
+    std::shared_ptr<GpuCompute> compute;
+#ifdef SEMIPRO_HAVE_VULKAN
+    if (enable) {
+        compute = VulkanCompute::shared();
+    }
+#endif
+    Gpu::setActive(compute);
+    // Transforms follow, unless another backend was chosen
+    const std::string fft = Fft::defaultBackend()->name();
+    if (compute && fft == "radix2") {
+        Fft::setDefaultBackend("gpu");
+    } else if (!compute && fft == "gpu") {
+        Fft::setDefaultBackend("radix2");
+    }
+    if (!enable) {
+        Logger::getInstance().log("GPU acceleration disabled");
+    } else if (compute) {
+        Logger::getInstance().log("GPU acceleration enabled on " + compute->deviceName());
+    } else {
+        Logger::getInstance().log("GPU acceleration enabled, but no GPU is available; kernels run on the CPU");
+    }
 }
 
 void SimulationEngine::enableAutoCheckpoint(bool enable, int interval) {
@@ -353,17 +963,123 @@ void SimulationEngine::enableAutoCheckpoint(bool enable, int interval) {
                              " (interval: " + std::to_string(interval) + "s)");
 }
 
+namespace {
+
+// Chunk tags of the engine checkpoint (see checkpoint_io.hpp for the container)
+constexpr std::uint32_t kEngineChunk = checkpointTag('E', 'N', 'G', 'N');
+constexpr std::uint32_t kStatisticsChunk = checkpointTag('S', 'T', 'A', 'T');
+constexpr std::uint32_t kBatchChunk = checkpointTag('B', 'T', 'C', 'H');
+constexpr std::uint32_t kWaferChunk = checkpointTag('W', 'A', 'F', 'R');
+
+template <typename Map>
+void writeParameterMap(CheckpointWriter& out, const Map& values) {
+    out.write(static_cast<std::uint64_t>(values.size()));
+    for (const auto& entry : values) {
+        out.writeString(entry.first);
+        out.write(entry.second);
+    }
+}
+
+template <typename Map>
+Map readParameterMap(CheckpointReader::Cursor& in) {
+    Map values;
+    auto count = in.read<std::uint64_t>();
+    for (std::uint64_t i = 0; i < count; ++i) {
+        std::string key = in.readString();
+        values[key] = in.read<typename Map::mapped_type>();
+    }
+    return values;
+}
+
+void writeStringMap(CheckpointWriter& out, const std::unordered_map<std::string, std::string>& values) {
+    out.write(static_cast<std::uint64_t>(values.size()));
+    for (const auto& entry : values) {
+        out.writeString(entry.first);
+        out.writeString(entry.second);
+    }
+}
+
+std::unordered_map<std::string, std::string> readStringMap(CheckpointReader::Cursor& in) {
+    std::unordered_map<std::string, std::string> values;
+    auto count = in.read<std::uint64_t>();
+    for (std::uint64_t i = 0; i < count; ++i) {
+        std::string key = in.readString();
+        values[key] = in.readString();
+    }
+    return values;
+}
+
+} // namespace
+
 bool SimulationEngine::saveCheckpoint(const std::string& filename) {
     try {
-        std::lock_guard<std::mutex> lock(state_mutex_);
+        // Engine state is copied under the lock and written without it;
+        // wafers come from the registry, which lookups keep using meanwhile
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        const std::string config_file = config_file_;
+        const int thread_count = thread_count_;
+        const bool gpu_enabled = gpu_acceleration_enabled_;
+        const bool auto_checkpoint = auto_checkpoint_enabled_;
+        const int checkpoint_interval = checkpoint_interval_;
+        const Statistics stats = stats_;
+        auto pending = batch_queue_;
+        lock.unlock();
         
-        std::ofstream file(filename, std::ios::binary);
-        if (!file) {
-            return false;
+        CheckpointWriter out(filename, CheckpointWriter::pageAlignment());
+
+        out.beginChunk(kEngineChunk);
+        out.writeString(config_file);
+        out.write(static_cast<std::int32_t>(thread_count));
+        out.write(static_cast<std::uint8_t>(gpu_enabled));
+        out.write(static_cast<std::uint8_t>(auto_checkpoint));
+        out.write(static_cast<std::int32_t>(checkpoint_interval));
+        out.endChunk();
+
+        out.beginChunk(kStatisticsChunk);
+        out.write(static_cast<std::uint64_t>(stats.total_operations));
+        out.write(static_cast<std::uint64_t>(stats.total_processes));
+        out.write(static_cast<std::uint64_t>(stats.successful_processes));
+        out.write(static_cast<std::uint64_t>(stats.failed_processes));
+        out.write(stats.total_simulation_time);
+        out.write(stats.average_operation_time);
+        out.write(stats.average_process_time);
+        out.write(stats.success_rate);
+        out.write(static_cast<std::uint64_t>(stats.memory_usage));
+        out.write(static_cast<std::uint64_t>(stats.peak_memory_usage));
+        out.write(static_cast<std::uint64_t>(stats.processes_by_type.size()));
+        for (const auto& entry : stats.processes_by_type) {
+            out.writeString(entry.first);
+            out.write(static_cast<std::uint64_t>(entry.second));
         }
-        
-        // Save simulation state
-        // TODO: Implement binary serialization
+        out.endChunk();
+
+        // Pending batch entries, front of the queue first
+        out.beginChunk(kBatchChunk);
+        out.write(static_cast<std::uint64_t>(pending.size()));
+        while (!pending.empty()) {
+            const auto& entry = pending.front();
+            out.writeString(entry.first);
+            out.writeString(entry.second.operation);
+            out.write(entry.second.duration);
+            out.write(static_cast<std::int32_t>(entry.second.priority));
+            writeParameterMap(out, entry.second.parameters);
+            writeStringMap(out, entry.second.string_parameters);
+            pending.pop();
+        }
+        out.endChunk();
+
+        for (const auto& entry : wafers_.snapshot()) {
+            auto wafer = waferOf(entry.first, *entry.second);
+            if (!wafer) {
+                continue; // Unregistered meanwhile
+            }
+            out.beginChunk(kWaferChunk);
+            out.writeString(entry.first);
+            wafer->writeCheckpoint(out);
+            out.endChunk();
+        }
+
+        out.finish();
         
         Logger::getInstance().log("Checkpoint saved: " + filename);
         return true;
@@ -376,17 +1092,100 @@ bool SimulationEngine::saveCheckpoint(const std::string& filename) {
 
 bool SimulationEngine::loadCheckpoint(const std::string& filename) {
     try {
+        // Decode everything before touching the engine so a damaged file
+        // leaves the current state intact. Wafer fields keep running on the
+        // private mapping, so only the pages a resumed flow touches are read.
+        CheckpointReader in(filename, true);
+
+        bool has_engine = false;
+        std::string config_file;
+        int thread_count = 0;
+        bool gpu_enabled = false;
+        bool auto_checkpoint = false;
+        int checkpoint_interval = 0;
+        Statistics stats;
+        std::queue<std::pair<std::string, ProcessParameters>> batch;
+        std::vector<std::pair<std::string, std::shared_ptr<WaferEnhanced>>> wafers;
+
+        for (const auto& chunk : in.chunks()) {
+            auto cursor = in.cursor(chunk);
+            switch (chunk.tag) {
+            case kEngineChunk:
+                config_file = cursor.readString();
+                thread_count = cursor.read<std::int32_t>();
+                gpu_enabled = cursor.read<std::uint8_t>() != 0;
+                auto_checkpoint = cursor.read<std::uint8_t>() != 0;
+                checkpoint_interval = cursor.read<std::int32_t>();
+                has_engine = true;
+                break;
+            case kStatisticsChunk:
+                stats.total_operations = cursor.read<std::uint64_t>();
+                stats.total_processes = cursor.read<std::uint64_t>();
+                stats.successful_processes = cursor.read<std::uint64_t>();
+                stats.failed_processes = cursor.read<std::uint64_t>();
+                stats.total_simulation_time = cursor.read<double>();
+                stats.average_operation_time = cursor.read<double>();
+                stats.average_process_time = cursor.read<double>();
+                stats.success_rate = cursor.read<double>();
+                stats.memory_usage = cursor.read<std::uint64_t>();
+                stats.peak_memory_usage = cursor.read<std::uint64_t>();
+                stats.processes_by_type = readParameterMap<std::unordered_map<std::string, size_t>>(cursor);
+                break;
+            case kBatchChunk: {
+                auto count = cursor.read<std::uint64_t>();
+                for (std::uint64_t i = 0; i < count; ++i) {
+                    std::string wafer_name = cursor.readString();
+                    std::string operation = cursor.readString();
+                    ProcessParameters params(operation, cursor.read<double>());
+                    params.priority = cursor.read<std::int32_t>();
+                    params.parameters = readParameterMap<std::unordered_map<std::string, double>>(cursor);
+                    params.string_parameters = readStringMap(cursor);
+                    batch.emplace(wafer_name, params);
+                }
+                break;
+            }
+            case kWaferChunk: {
+                std::string name = cursor.readString();
+                auto wafer = std::make_shared<WaferEnhanced>(0.0, 0.0, "");
+                wafer->readCheckpoint(cursor);
+                wafers.emplace_back(std::move(name), std::move(wafer));
+                break;
+            }
+            default:
+                break; // Chunks from newer writers are skipped
+            }
+        }
+        if (!has_engine) {
+            throw std::runtime_error("Checkpoint has no engine state");
+        }
+
+        // Resized before taking the state lock, which running tasks need
+        TaskScheduler::getInstance().resize(std::max(1, thread_count));
         std::lock_guard<std::mutex> lock(state_mutex_);
-        
-        std::ifstream file(filename, std::ios::binary);
-        if (!file) {
-            return false;
+        config_file_ = config_file;
+        thread_count_ = std::max(1, thread_count);
+        gpu_acceleration_enabled_ = gpu_enabled;
+        activateGPU(gpu_enabled);
+        auto_checkpoint_enabled_ = auto_checkpoint;
+        checkpoint_interval_ = checkpoint_interval;
+        stats_ = stats;
+        // Keep updateStatistics() counting from the checkpointed elapsed time
+        simulation_start_time_ = std::chrono::system_clock::now() -
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::duration<double>(stats.total_simulation_time));
+        batch_queue_ = std::move(batch);
+        std::vector<std::pair<std::string, std::shared_ptr<RegisteredWafer>>> entries;
+        if (auto residency = std::atomic_load(&residency_)) {
+            residency->clear();
         }
+        for (auto& wafer : wafers) {
+            entries.emplace_back(wafer.first, registration(wafer.first, std::move(wafer.second)));
+        }
+        wafers_.assign(std::move(entries));
         
-        // Load simulation state
-        // TODO: Implement binary deserialization
-        
-        Logger::getInstance().log("Checkpoint loaded: " + filename);
+        Logger::getInstance().log("Checkpoint loaded: " + filename + " (" +
+                                 std::to_string(wafers_.size()) + " wafers, " +
+                                 std::to_string(batch_queue_.size()) + " pending batch entries)");
         return true;
         
     } catch (const std::exception& e) {
@@ -403,47 +1202,10 @@ bool SimulationEngine::simulateOxidation(std::shared_ptr<WaferEnhanced> wafer, c
     MEMORY_SCOPE("oxidation_simulation");
 
     try {
-        // Initialize enhanced oxidation physics
-        static EnhancedOxidationPhysics oxidation_engine;
-
-        // Extract and validate parameters
-        OxidationConditions conditions;
+        auto& oxidation_engine = oxidationPhysics();
 
-        // Temperature
-        auto temp_it = params.parameters.find("temperature");
-        if (temp_it != params.parameters.end()) {
-            conditions.temperature = temp_it->second;
-        } else {
-            conditions.temperature = CONFIG_GET("physics.temperature.default", double, 1000.0);
-        }
-
-        // Time
-        auto time_it = params.parameters.find("time");
-        if (time_it != params.parameters.end()) {
-            conditions.time = time_it->second;
-        } else {
-            conditions.time = 1.0; // Default 1 hour
-        }
-
-        // Atmosphere
-        auto ambient_it = params.parameters.find("ambient");
-        if (ambient_it != params.parameters.end()) {
-            conditions.atmosphere = (ambient_it->second > 0.5) ?
-                OxidationAtmosphere::WET_H2O : OxidationAtmosphere::DRY_O2;
-        } else {
-            conditions.atmosphere = OxidationAtmosphere::DRY_O2;
-        }
-
-        // Pressure
-        auto pressure_it = params.parameters.find("pressure");
-        if (pressure_it != params.parameters.end()) {
-            conditions.pressure = pressure_it->second;
-        } else {
-            conditions.pressure = CONFIG_GET("physics.pressure.default", double, 1.0);
-        }
-
-        // Crystal orientation (default to <100>)
-        conditions.orientation = CrystalOrientation::SILICON_100;
+        const OxidationConditions conditions =
+            oxidationSchema().bind(params.parameters, params.string_parameters);
 
         // Run enhanced oxidation simulation
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::PHYSICS,
@@ -489,6 +1251,137 @@ bool SimulationEngine::simulateOxidation(std::shared_ptr<WaferEnhanced> wafer, c
     }
 }
 
+std::vector<bool> SimulationEngine::executeOxidationBatch(const BatchParameters& batch) {
+    using namespace SemiPRO;
+
+    MEMORY_SCOPE("batch_oxidation");
+
+    const size_t n = batch.size();
+    std::vector<bool> success(n, false);
+    // An unregistered wafer fails its own entry, not the batch
+    std::vector<std::shared_ptr<WaferEnhanced>> wafers(n);
+    std::vector<std::uint64_t> steps(n);
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        stats_.total_processes += n;
+        stats_.processes_by_type["oxidation"] += n;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (auto entry = wafers_.find(batch.wafer_names[i])) {
+            wafers[i] = waferOf(batch.wafer_names[i], *entry);
+            steps[i] = entry->steps.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Keys without a column take the schema's defaults
+    const OxidationConditions defaults = oxidationSchema().defaults();
+    OxidationBatch conditions(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Eigen::Index k = static_cast<Eigen::Index>(i);
+        conditions.temperature[k] = columnValue(batch, "temperature", i, defaults.temperature);
+        conditions.time[k] = columnValue(batch, "time", i, defaults.time);
+        conditions.pressure[k] = columnValue(batch, "pressure", i, defaults.pressure);
+        conditions.atmosphere[i] = columnValue(batch, "ambient", i, 0.0) > 0.5 ?
+            OxidationAtmosphere::WET_H2O : OxidationAtmosphere::DRY_O2;
+
+        Reproducibility::Step random_step(batch.wafer_names[i], steps[i]);
+        conditions.noise_keys.push_back(Reproducibility::key());
+    }
+
+    size_t succeeded = 0;
+    const auto start = std::chrono::steady_clock::now();
+    Eigen::ArrayXd thickness =
+        Eigen::ArrayXd::Constant(static_cast<Eigen::Index>(n), std::numeric_limits<double>::quiet_NaN());
+    try {
+        if (batch.cancellation.stopRequested()) {
+            SEMIPRO_LOG_MODULE(LogLevel::WARNING, LogCategory::SIMULATION,
+                              "Batch oxidation of " + std::to_string(n) + " wafers cancelled before start",
+                              "SimulationEngine");
+        } else {
+            auto results = oxidationPhysics().simulateOxidationBatch(wafers, conditions);
+            thickness = results.final_thickness;
+            for (size_t i = 0; i < n; ++i) {
+                const double thickness = results.final_thickness[static_cast<Eigen::Index>(i)];
+                KernelStatus status = wafers[i] ? results.status[i] : KernelStatus::MissingWafer;
+                if (status == KernelStatus::Ok && !(thickness >= 0.0 && thickness <= 10.0)) {
+                    status = KernelStatus::ResultOutOfRange;
+                }
+                if (status == KernelStatus::Ok) {
+                    success[i] = true;
+                    ++succeeded;
+                } else {
+                    KernelFaults::record(status, static_cast<std::uint32_t>(i));
+                }
+            }
+            SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::PHYSICS,
+                              "Batch oxidation completed: " + std::to_string(succeeded) + "/" +
+                              std::to_string(n) + " wafers, mean oxide " +
+                              std::to_string(n ? results.final_thickness.mean() : 0.0) + " μm",
+                              "EnhancedOxidation");
+        }
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::PHYSICS,
+                          "Batch oxidation failed: " + std::string(e.what()),
+                          "EnhancedOxidation");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        stats_.successful_processes += succeeded;
+        stats_.failed_processes += n - succeeded;
+    }
+    countProcesses("oxidation", "success", succeeded);
+    countProcesses("oxidation", "failure", n - succeeded);
+    reportKernelFaults("oxidation", batch.wafer_names);
+    if (std::atomic_load(&result_store_)) {
+        // One pass for the lot, so each wafer is charged its share of it
+        const double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / std::max<size_t>(n, 1);
+        for (size_t i = 0; i < n; ++i) {
+            const Eigen::Index k = static_cast<Eigen::Index>(i);
+            ResultRecord record("oxidation", batch.wafer_names[i], success[i], seconds);
+            record.add("parameter", "temperature", conditions.temperature[k]);
+            record.add("parameter", "time", conditions.time[k]);
+            record.add("parameter", "pressure", conditions.pressure[k]);
+            record.add("parameter", "ambient",
+                       conditions.atmosphere[i] == OxidationAtmosphere::WET_H2O ? 1.0 : 0.0);
+            record.add("result", "oxide_thickness", thickness[k]);
+            recordResult(record);
+        }
+    }
+    return success;
+}
+
+void SimulationEngine::reportKernelFaults(const std::string& operation, const std::vector<std::string>& wafer_names) {
+    using namespace SemiPRO;
+
+    std::vector<KernelFaults::Fault> faults;
+    const size_t dropped = KernelFaults::take(faults);
+    if (faults.empty() && dropped == 0) {
+        return;
+    }
+    std::vector<SimulationError> errors;
+    errors.reserve(faults.size() + 1);
+    for (const auto& fault : faults) {
+        const std::string wafer = fault.entry < wafer_names.size() ? wafer_names[fault.entry] :
+                                                                    "#" + std::to_string(fault.entry);
+        errors.emplace_back(ERROR, operation + " on wafer " + wafer + ": " + kernelStatusMessage(fault.status),
+                            "batch entry " + std::to_string(fault.entry));
+    }
+    if (dropped > 0) {
+        errors.emplace_back(WARNING, std::to_string(dropped) + " more " + operation + " faults not kept", "batch");
+    }
+
+    ErrorManager::getInstance().reportError(
+        ErrorSeverity::ERROR, ErrorCategory::SIMULATION,
+        "Batch " + operation + ": " + std::to_string(faults.size() + dropped) + " entries failed, first " +
+            errors.front().message,
+        SEMIPRO_ERROR_CONTEXT()
+    );
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    errors_.insert(errors_.end(), std::make_move_iterator(errors.begin()), std::make_move_iterator(errors.end()));
+}
+
 bool SimulationEngine::simulateIonImplantation(std::shared_ptr<WaferEnhanced> wafer, const ProcessParameters& params) {
     using namespace SemiPRO;
 
@@ -503,69 +1396,8 @@ bool SimulationEngine::simulateIonImplantation(std::shared_ptr<WaferEnhanced> wa
         }
         auto& doping_engine = *doping_engine_ptr;
 
-        // Extract and validate parameters
-        ImplantationConditions conditions;
-
-        // Energy
-        auto energy_it = params.parameters.find("energy");
-        if (energy_it != params.parameters.end()) {
-            conditions.energy = energy_it->second;
-        } else {
-            conditions.energy = 50.0; // Default 50 keV
-        }
-
-        // Dose
-        auto dose_it = params.parameters.find("dose");
-        if (dose_it != params.parameters.end()) {
-            conditions.dose = dose_it->second;
-        } else {
-            conditions.dose = 1e15; // Default 1e15 cm⁻²
-        }
-
-        // Ion species (default to boron)
-        auto species_it = params.parameters.find("species");
-        auto species_str_it = params.string_parameters.find("species");
-
-        if (species_str_it != params.string_parameters.end()) {
-            // Handle string species names
-            std::string species_name = species_str_it->second;
-            if (species_name == "boron" || species_name == "B") {
-                conditions.species = IonSpecies::BORON_11;
-            } else if (species_name == "phosphorus" || species_name == "P") {
-                conditions.species = IonSpecies::PHOSPHORUS_31;
-            } else if (species_name == "arsenic" || species_name == "As") {
-                conditions.species = IonSpecies::ARSENIC_75;
-            } else {
-                conditions.species = IonSpecies::BORON_11; // Default
-            }
-        } else if (species_it != params.parameters.end()) {
-            // Handle numeric species IDs
-            int species_id = static_cast<int>(species_it->second);
-            switch (species_id) {
-                case 5: conditions.species = IonSpecies::BORON_11; break;
-                case 15: conditions.species = IonSpecies::PHOSPHORUS_31; break;
-                case 33: conditions.species = IonSpecies::ARSENIC_75; break;
-                default: conditions.species = IonSpecies::BORON_11; break;
-            }
-        } else {
-            conditions.species = IonSpecies::BORON_11;
-        }
-
-        // Tilt angle
-        auto tilt_it = params.parameters.find("tilt");
-        if (tilt_it != params.parameters.end()) {
-            conditions.tilt_angle = tilt_it->second;
-        } else {
-            conditions.tilt_angle = 7.0; // Default 7° tilt
-        }
-
-        // Temperature
-        auto temp_it = params.parameters.find("temperature");
-        if (temp_it != params.parameters.end()) {
-            conditions.temperature = temp_it->second;
-        } else {
-            conditions.temperature = 25.0; // Room temperature
-        }
+        const ImplantationConditions conditions =
+            implantationSchema().bind(params.parameters, params.string_parameters);
 
         // Run enhanced ion implantation simulation
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::PHYSICS,
@@ -628,58 +1460,8 @@ bool SimulationEngine::simulateDeposition(std::shared_ptr<WaferEnhanced> wafer,
         }
         auto& deposition_engine = *deposition_engine_ptr;
 
-        // Extract and validate parameters
-        DepositionConditions conditions;
-
-        // Thickness
-        auto thick_it = params.parameters.find("thickness");
-        if (thick_it != params.parameters.end()) {
-            conditions.target_thickness = thick_it->second;
-        } else {
-            conditions.target_thickness = 0.1; // Default 0.1 μm
-        }
-
-        // Temperature
-        auto temp_it = params.parameters.find("temperature");
-        if (temp_it != params.parameters.end()) {
-            conditions.temperature = temp_it->second;
-        } else {
-            conditions.temperature = 400.0; // Default 400°C
-        }
-
-        // Material (default to aluminum)
-        auto mat_it = params.string_parameters.find("material");
-        if (mat_it != params.string_parameters.end()) {
-            std::string material_name = mat_it->second;
-            if (material_name == "aluminum" || material_name == "Al") {
-                conditions.material = MaterialType::ALUMINUM;
-            } else if (material_name == "copper" || material_name == "Cu") {
-                conditions.material = MaterialType::COPPER;
-            } else if (material_name == "tungsten" || material_name == "W") {
-                conditions.material = MaterialType::TUNGSTEN;
-            } else if (material_name == "silicon_dioxide" || material_name == "SiO2") {
-                conditions.material = MaterialType::SILICON_DIOXIDE;
-            } else if (material_name == "silicon_nitride" || material_name == "Si3N4") {
-                conditions.material = MaterialType::SILICON_NITRIDE;
-            } else if (material_name == "polysilicon" || material_name == "poly-Si" || material_name == "poly") {
-                conditions.material = MaterialType::POLYSILICON;
-            } else {
-                conditions.material = MaterialType::ALUMINUM; // Default
-            }
-        } else {
-            conditions.material = MaterialType::ALUMINUM;
-        }
-
-        // Technique (default to CVD)
-        conditions.technique = DepositionTechnique::CVD;
-
-        // Pressure
-        auto pressure_it = params.parameters.find("pressure");
-        if (pressure_it != params.parameters.end()) {
-            conditions.pressure = pressure_it->second;
-        } else {
-            conditions.pressure = 1.0; // Default 1 Torr
-        }
+        const DepositionConditions conditions =
+            depositionSchema().bind(params.parameters, params.string_parameters);
 
         // Run enhanced deposition simulation
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::PHYSICS,
@@ -742,62 +1524,8 @@ bool SimulationEngine::simulateEtching(std::shared_ptr<WaferEnhanced> wafer, con
         }
         auto& etching_engine = *etching_engine_ptr;
 
-        // Extract and validate parameters
-        EtchingConditions conditions;
-
-        // Target depth
-        auto depth_it = params.parameters.find("depth");
-        if (depth_it != params.parameters.end()) {
-            conditions.target_depth = depth_it->second;
-        } else {
-            conditions.target_depth = 0.5; // Default 0.5 μm
-        }
-
-        // Etch type (anisotropic vs isotropic)
-        auto type_it = params.parameters.find("type");
-        if (type_it != params.parameters.end()) {
-            bool is_anisotropic = (type_it->second > 0.5);
-            conditions.technique = is_anisotropic ? EtchingTechnique::RIE : EtchingTechnique::WET_CHEMICAL;
-        } else {
-            conditions.technique = EtchingTechnique::RIE; // Default to RIE
-        }
-
-        // Selectivity target
-        auto sel_it = params.parameters.find("selectivity");
-        if (sel_it != params.parameters.end()) {
-            conditions.selectivity_target = sel_it->second;
-        } else {
-            conditions.selectivity_target = 10.0; // Default selectivity
-        }
-
-        // Material types (default to silicon)
-        conditions.target_material = EtchMaterial::SILICON;
-        conditions.mask_material = EtchMaterial::PHOTORESIST;
-
-        // Chemistry (default to fluorine-based)
-        conditions.chemistry = EtchChemistry::FLUORINE_BASED;
-
-        // Process parameters
-        auto pressure_it = params.parameters.find("pressure");
-        if (pressure_it != params.parameters.end()) {
-            conditions.pressure = pressure_it->second;
-        } else {
-            conditions.pressure = 10.0; // Default 10 mTorr
-        }
-
-        auto power_it = params.parameters.find("power");
-        if (power_it != params.parameters.end()) {
-            conditions.power = power_it->second;
-        } else {
-            conditions.power = 100.0; // Default 100 W
-        }
-
-        auto bias_it = params.parameters.find("bias");
-        if (bias_it != params.parameters.end()) {
-            conditions.bias_voltage = bias_it->second;
-        } else {
-            conditions.bias_voltage = 100.0; // Default 100 V
-        }
+        const EtchingConditions conditions =
+            etchingSchema().bind(params.parameters, params.string_parameters);
 
         // Run enhanced etching simulation
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::PHYSICS,
@@ -4,15 +4,25 @@
 
 #include "wafer_enhanced.hpp"
 #include "profiler.hpp"
+#include "cancellation.hpp"
+#include "sharded_registry.hpp"
+#include "wafer_residency.hpp"
 #include "simulation_orchestrator.hpp"
 #include "input_parser.hpp"
 #include "output_generator.hpp"
+#include "result_store.hpp"
 #include <future>
 #include <queue>
 #include <functional>
+#include <map>
 #include <memory>
+#include <tuple>
 #include <yaml-cpp/yaml.h>
 
+namespace SemiPRO {
+class SimulationCache;
+}
+
 class SimulationEngine {
 public:
     static SimulationEngine& getInstance();
@@ -24,8 +34,44 @@ public:
     // Wafer management
     std::shared_ptr<WaferEnhanced> createWafer(double diameter, double thickness, 
                                               const std::string& material);
+    // A wafer with its grid initialized to rows x cols. The first call for
+    // each (diameter, thickness, material, shape) initializes a template;
+    // later ones clone it, sharing its fields until the clone writes.
+    std::shared_ptr<WaferEnhanced> createWafer(double diameter, double thickness,
+                                              const std::string& material, int rows, int cols);
     void registerWafer(std::shared_ptr<WaferEnhanced> wafer, const std::string& name);
     std::shared_ptr<WaferEnhanced> getWafer(const std::string& name);
+    // Drops the engine's reference; false if no such wafer
+    bool unregisterWafer(const std::string& name);
+    // Wafer templates: a prepared wafer (grid, layers, history) kept apart
+    // from the registered wafers, from which lots and optimizer candidates
+    // are spawned as copy-on-write clones (see WaferEnhanced::clone).
+    // Registering keeps a clone, so later changes to `wafer` do not reach
+    // the template.
+    void registerWaferTemplate(const std::string& name, std::shared_ptr<WaferEnhanced> wafer);
+    bool unregisterWaferTemplate(const std::string& name);
+    // Throws std::runtime_error for an unknown template
+    std::shared_ptr<WaferEnhanced> createWaferFromTemplate(const std::string& template_name);
+    // Registers one clone of the template under each name, replacing
+    // wafers already registered under them
+    void spawnWafers(const std::string& template_name, const std::vector<std::string>& names);
+    // A wafer's complete state as an in-memory checkpoint record, and the
+    // reverse; restoring leaves the wafer untouched if the record is bad.
+    std::vector<unsigned char> captureWaferState(const std::string& name);
+    void restoreWaferState(const std::string& name, std::vector<unsigned char> state);
+    // Tiered residency (see WaferResidency): once enabled, registered
+    // wafers no step is using are compressed, then spilled, under memory
+    // pressure, and getWafer and the process steps bring them back.
+    // Enabling takes in the wafers registered so far; a second call keeps
+    // the first's limits.
+    void enableWaferResidency(const SemiPRO::WaferResidency::Limits& limits = {});
+    std::shared_ptr<SemiPRO::WaferResidency> getWaferResidency() const;
+    // Every process of executeBatch and simulateProcessBatch is then
+    // appended to the store as it finishes: source the operation, label
+    // the wafer, its parameters in group "parameter" and, from the batched
+    // oxidation model, its outputs in group "result". Null stops recording.
+    void setResultStore(std::shared_ptr<ResultStore> store);
+    std::shared_ptr<ResultStore> getResultStore() const;
     
     // Process simulation
     struct ProcessParameters {
@@ -34,6 +80,11 @@ public:
         std::unordered_map<std::string, std::string> string_parameters;
         double duration;
         int priority = 0;
+        // Polled by the process models; a process stopped through it leaves
+        // its partial result on the wafer and reports failure. Processes
+        // submitted without one inherit the submitting thread's
+        // CancellationToken::current().
+        CancellationToken cancellation;
 
         ProcessParameters(const std::string& op, double dur)
             : operation(op), duration(dur) {}
@@ -47,6 +98,26 @@ public:
     void addProcessToBatch(const std::string& wafer_name, const ProcessParameters& params);
     std::future<std::vector<bool>> executeBatch();
     void clearBatch();
+
+    // One operation on many wafers, parameters as columns:
+    // columns.at(key)[i] applies to wafer_names[i], and keys without a
+    // column take the same defaults as ProcessParameters. Operations with
+    // a batched model (oxidation) evaluate all wafers in one pass;
+    // the others, and batches that name a wafer twice or run with the
+    // result cache enabled, run as one process per wafer.
+    struct BatchParameters {
+        std::string operation;
+        std::vector<std::string> wafer_names;
+        std::unordered_map<std::string, std::vector<double>> columns;
+        CancellationToken cancellation;
+
+        explicit BatchParameters(const std::string& op = "") : operation(op) {}
+        size_t size() const { return wafer_names.size(); }
+    };
+
+    // Throws std::invalid_argument when a column's length differs from the
+    // wafer count; the results follow wafer_names
+    std::future<std::vector<bool>> simulateProcessBatch(const BatchParameters& batch);
     
     // Real-time monitoring
     struct SimulationStatus {
@@ -83,8 +154,28 @@ public:
     // Performance optimization
     void setThreadCount(int count);
     int getThreadCount() const;
+    // Offloads the grid kernels that gain most from a GPU (FFTs, explicit
+    // diffusion, finest-level multigrid smoothing, Gaussian implant
+    // sampling) to a Vulkan compute device, through Gpu::setActive. A
+    // kernel the device cannot run, and every kernel when there is no
+    // device, stays on the CPU.
     void enableGPUAcceleration(bool enable);
     bool isGPUAccelerationEnabled() const;
+    // Memoizes executeProcess: a process whose operation and parameters
+    // were already applied to an identical wafer state replays the stored
+    // result instead of simulating. Entries live in memory up to
+    // memory_budget bytes and, when cache_dir is set, on disk across runs.
+    // Stochastic steps replay the sample taken when the entry was stored;
+    // in reproducibility mode only for the same seed, wafer and step, so
+    // cached and simulated runs agree to the bit.
+    // The wafer's process history is part of its state, so only wafers
+    // restored from the cache or a checkpoint share a warm chain of steps.
+    void enableResultCache(bool enable, const std::string& cache_dir = "",
+                           size_t memory_budget = 256 * 1024 * 1024);
+    bool isResultCacheEnabled() const;
+    // The cache itself, null when disabled, for clients that file their
+    // own results beside the steps' under distinct keys
+    std::shared_ptr<SemiPRO::SimulationCache> getResultCache() const;
 
     // Simulation control
     void pause();
@@ -102,6 +193,7 @@ public:
         size_t total_processes;
         size_t successful_processes;
         size_t failed_processes;
+        size_t cached_processes;
         double total_simulation_time;
         double average_operation_time;
         double average_process_time;
@@ -111,7 +203,7 @@ public:
         std::unordered_map<std::string, size_t> processes_by_type;
 
         Statistics() : total_operations(0), total_processes(0), successful_processes(0),
-                      failed_processes(0), total_simulation_time(0.0),
+                      failed_processes(0), cached_processes(0), total_simulation_time(0.0),
                       average_operation_time(0.0), average_process_time(0.0),
                       success_rate(0.0), memory_usage(0), peak_memory_usage(0) {}
     };
@@ -125,7 +217,26 @@ private:
     ~SimulationEngine() = default;
     
     // Internal state
-    std::unordered_map<std::string, std::shared_ptr<WaferEnhanced>> wafers_;
+    struct RegisteredWafer {
+        explicit RegisteredWafer(std::shared_ptr<WaferEnhanced> w) : wafer(std::move(w)) {}
+        // Null while residency_ holds the wafer
+        std::shared_ptr<WaferEnhanced> wafer;
+        // Processes started on the wafer: the step that keys their random
+        // streams (see Reproducibility)
+        std::atomic<std::uint64_t> steps{0};
+    };
+    // Looked up by every process step, so kept off state_mutex_
+    ShardedRegistry<RegisteredWafer> wafers_;
+    // Set once; read with std::atomic_load off state_mutex_
+    std::shared_ptr<SemiPRO::WaferResidency> residency_;
+    // An entry for the registry, handing the wafer to residency_ if set
+    std::shared_ptr<RegisteredWafer> registration(const std::string& name, std::shared_ptr<WaferEnhanced> wafer);
+    // The entry's wafer, from residency_ if it holds it; null if gone
+    std::shared_ptr<WaferEnhanced> waferOf(const std::string& name, const RegisteredWafer& entry) const;
+    std::unordered_map<std::string, std::shared_ptr<const WaferEnhanced>> wafer_templates_;
+    // createWafer's templates by (diameter, thickness, material, rows, cols)
+    std::map<std::tuple<double, double, std::string, int, int>, std::shared_ptr<const WaferEnhanced>>
+        shape_templates_;
     std::queue<std::pair<std::string, ProcessParameters>> batch_queue_;
     std::vector<SimulationError> errors_;
     
@@ -134,13 +245,15 @@ private:
     std::atomic<bool> is_running_{false};
     std::atomic<bool> is_paused_{false};
     
-    // Threading
-    std::vector<std::thread> worker_threads_;
+    // Threading; the work itself runs on TaskScheduler's shared pool
     int thread_count_ = std::thread::hardware_concurrency();
     
     // Configuration
     std::string config_file_;
     bool gpu_acceleration_enabled_ = false;
+    std::shared_ptr<SemiPRO::SimulationCache> result_cache_;
+    // Read with std::atomic_load off state_mutex_
+    std::shared_ptr<ResultStore> result_store_;
     bool auto_checkpoint_enabled_ = false;
     int checkpoint_interval_ = 10;
     
@@ -150,9 +263,17 @@ private:
     
     // Internal methods
     bool executeProcess(const std::string& wafer_name, const ProcessParameters& params);
-    void workerThread();
+    std::future<std::vector<bool>> runProcesses(std::vector<std::pair<std::string, ProcessParameters>> entries);
+    std::vector<bool> executeOxidationBatch(const BatchParameters& batch);
+    // Appends to result_store_ if set; a failing store is logged, not thrown
+    void recordResult(const ResultRecord& record);
+    // Turns the KernelFaults a batch left on this thread into SimulationErrors,
+    // under one lock and with one ErrorManager report for the batch
+    void reportKernelFaults(const std::string& operation, const std::vector<std::string>& wafer_names);
     void checkpointThread();
     void updateStatistics();
+    // Opens the GPU for the kernels, or stops using it
+    void activateGPU(bool enable);
 
     // Physics simulation methods
     bool simulateOxidation(std::shared_ptr<WaferEnhanced> wafer, const ProcessParameters& params);
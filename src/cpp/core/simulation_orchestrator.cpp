@@ -1,13 +1,21 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "simulation_orchestrator.hpp"
 #include "simulation_engine.hpp"
+#include "advanced_logger.hpp"
 #include "input_parser.hpp"
 #include "output_generator.hpp"
+#include "task_scheduler.hpp"
+#include "checkpoint_io.hpp"
+#include "progress_events.hpp"
+#include "telemetry.hpp"
 #include <iostream>
 #include <fstream>
 #include <algorithm>
 #include <thread>
 #include <chrono>
+#include <deque>
+#include <set>
+#include <stdexcept>
 
 namespace SemiPRO {
 
@@ -62,6 +70,13 @@ void SimulationOrchestrator::saveConfiguration(const std::string& config_file) c
 }
 
 void SimulationOrchestrator::setParameter(const std::string& key, const std::string& value) {
+    // "step.<step>.<parameter>" edits a step of the current flow
+    const size_t last_dot = key.rfind('.');
+    if (key.compare(0, 5, "step.") == 0 && last_dot != std::string::npos && last_dot > 5) {
+        setStepParameter(key.substr(5, last_dot - 5), key.substr(last_dot + 1), std::stod(value));
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(state_mutex_);
     
     if (!config_) {
@@ -171,6 +186,19 @@ void SimulationOrchestrator::loadSimulationFlow(const std::string& flow_file) {
                 step.estimated_duration = step_node["estimated_duration"].as<double>(0.0);
                 step.priority = step_node["priority"].as<int>(0);
                 step.parallel_compatible = step_node["parallel_compatible"].as<bool>(false);
+                step.timeout = step_node["timeout"].as<double>(0.0);
+                
+                if (step_node["reads"]) {
+                    for (const auto& field : step_node["reads"]) {
+                        step.reads.push_back(field.as<std::string>());
+                    }
+                }
+                if (step_node["writes"]) {
+                    for (const auto& field : step_node["writes"]) {
+                        step.writes.push_back(field.as<std::string>());
+                    }
+                }
+                step.plugin = step_node["plugin"].as<std::string>("");
                 
                 flow.steps.push_back(step);
             }
@@ -245,6 +273,18 @@ void SimulationOrchestrator::saveSimulationFlow(const std::string& flow_file) co
             step_node["estimated_duration"] = step.estimated_duration;
             step_node["priority"] = step.priority;
             step_node["parallel_compatible"] = step.parallel_compatible;
+            if (step.timeout > 0.0) {
+                step_node["timeout"] = step.timeout;
+            }
+            for (const auto& field : step.reads) {
+                step_node["reads"].push_back(field);
+            }
+            for (const auto& field : step.writes) {
+                step_node["writes"].push_back(field);
+            }
+            if (!step.plugin.empty()) {
+                step_node["plugin"] = step.plugin;
+            }
             
             flow_config["steps"].push_back(step_node);
         }
@@ -253,8 +293,8 @@ void SimulationOrchestrator::saveSimulationFlow(const std::string& flow_file) co
         file << flow_config;
         
     } catch (const std::exception& e) {
-        notifyError("Flow Saving", "Failed to save simulation flow: " + std::string(e.what()));
-        throw;
+        // Const, so the failure goes to the caller rather than progress_.errors
+        throw std::runtime_error("Failed to save simulation flow: " + std::string(e.what()));
     }
 }
 
@@ -293,6 +333,36 @@ void SimulationOrchestrator::reorderSteps(const std::vector<std::string>& step_o
     current_flow_.steps = reordered_steps;
 }
 
+void SimulationOrchestrator::setStepParameter(const std::string& step_name, const std::string& key, double value) {
+    // The edit supersedes a progressive run in flight; stop it before
+    // waiting for the lock it holds
+    if (progressive_active_) {
+        should_cancel_ = true;
+        std::lock_guard<std::mutex> cancel_lock(cancel_mutex_);
+        cancel_source_.requestStop();
+    }
+    std::lock_guard<std::mutex> lock(state_mutex_);
+
+    auto edit = [&](SimulationFlow& flow) {
+        bool found = false;
+        for (auto& step : flow.steps) {
+            if (step.name == step_name) {
+                step.parameters[key] = value;
+                found = true;
+            }
+        }
+        return found;
+    };
+    if (!edit(current_flow_)) {
+        throw std::invalid_argument("Unknown step: " + step_name);
+    }
+    // executeSimulationFlow reloads the flow from flows_
+    auto it = flows_.find(current_flow_.name);
+    if (it != flows_.end()) {
+        edit(it->second);
+    }
+}
+
 std::future<bool> SimulationOrchestrator::executeSimulation(const std::string& wafer_name) {
     return std::async(std::launch::async, [this, wafer_name]() {
         std::lock_guard<std::mutex> lock(state_mutex_);
@@ -315,6 +385,7 @@ std::future<bool> SimulationOrchestrator::executeSimulation(const std::string& w
             progress_.state = SimulationState::RUNNING;
 
             bool success = true;
+            beginIncrementalRun(wafer_name);
 
             switch (execution_mode_) {
                 case ExecutionMode::SEQUENTIAL:
@@ -330,6 +401,7 @@ std::future<bool> SimulationOrchestrator::executeSimulation(const std::string& w
                     success = executeBatchFlow(wafer_name);
                     break;
             }
+            finishIncrementalRun(wafer_name);
 
             if (success && !should_cancel_) {
                 current_state_ = SimulationState::COMPLETED;
@@ -360,15 +432,18 @@ std::future<bool> SimulationOrchestrator::executeSimulation(const std::string& w
 std::future<bool> SimulationOrchestrator::executeSimulationFlow(const std::string& flow_name,
                                                                const std::string& wafer_name) {
     return std::async(std::launch::async, [this, flow_name, wafer_name]() {
-        std::lock_guard<std::mutex> lock(state_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
 
-        auto it = flows_.find(flow_name);
-        if (it == flows_.end()) {
-            notifyError("Flow Execution", "Flow not found: " + flow_name);
-            return false;
-        }
+            auto it = flows_.find(flow_name);
+            if (it == flows_.end()) {
+                notifyError("Flow Execution", "Flow not found: " + flow_name);
+                return false;
+            }
 
-        current_flow_ = it->second;
+            current_flow_ = it->second;
+        }
+        // Released first: the run takes the state lock on its own thread
         return executeSimulation(wafer_name).get();
     });
 }
@@ -401,6 +476,10 @@ void SimulationOrchestrator::cancelSimulation() {
 
     should_cancel_ = true;
     should_pause_ = false;
+    {
+        std::lock_guard<std::mutex> cancel_lock(cancel_mutex_);
+        cancel_source_.requestStop();
+    }
     state_cv_.notify_all();
 }
 
@@ -410,6 +489,10 @@ void SimulationOrchestrator::resetSimulation() {
     current_state_ = SimulationState::IDLE;
     should_pause_ = false;
     should_cancel_ = false;
+    {
+        std::lock_guard<std::mutex> cancel_lock(cancel_mutex_);
+        cancel_source_ = CancellationSource();
+    }
 
     progress_ = SimulationProgress();
     stats_ = ExecutionStatistics();
@@ -421,10 +504,29 @@ void SimulationOrchestrator::addWaferToBatch(const std::string& wafer_name, cons
 }
 
 std::future<std::vector<bool>> SimulationOrchestrator::executeBatch() {
-    return std::async(std::launch::async, [this]() {
+    std::vector<std::pair<std::string, std::string>> batch;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        batch = batch_queue_;
+    }
+    return executeBatch(std::move(batch));
+}
+
+std::future<std::vector<bool>> SimulationOrchestrator::executeBatch(
+    std::vector<std::pair<std::string, std::string>> batch) {
+    return std::async(std::launch::async, [this, batch = std::move(batch)]() {
+        std::shared_ptr<DistributedBatchExecutor> distributed;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            distributed = distributed_executor_;
+        }
+        if (distributed || getExecutionMode() == ExecutionMode::BATCH) {
+            return distributed ? executeBatchDistributed(*distributed, batch) : executeBatchPipelined(batch);
+        }
+
         std::vector<bool> results;
 
-        for (const auto& batch_item : batch_queue_) {
+        for (const auto& batch_item : batch) {
             const std::string& wafer_name = batch_item.first;
             const std::string& flow_name = batch_item.second;
 
@@ -443,6 +545,292 @@ void SimulationOrchestrator::clearBatch() {
     batch_queue_.clear();
 }
 
+void SimulationOrchestrator::setStageWorkers(StepType type, int workers) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    stage_workers_[type] = std::max(1, workers);
+}
+
+int SimulationOrchestrator::getStageWorkers(StepType type) const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto it = stage_workers_.find(type);
+    return it != stage_workers_.end() ? it->second : 1;
+}
+
+void SimulationOrchestrator::setStageQueueCapacity(StepType type, int capacity) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    stage_queue_capacity_[type] = std::max(1, capacity);
+}
+
+int SimulationOrchestrator::getStageQueueCapacity(StepType type) const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto it = stage_queue_capacity_.find(type);
+    return it != stage_queue_capacity_.end() ? it->second : 4;
+}
+
+void SimulationOrchestrator::setDistributedExecutor(std::shared_ptr<DistributedBatchExecutor> executor) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    distributed_executor_ = std::move(executor);
+}
+
+void SimulationOrchestrator::setPluginManager(std::shared_ptr<PluginManager> plugins) {
+    std::lock_guard<std::mutex> lock(plugin_mutex_);
+    plugin_manager_ = std::move(plugins);
+}
+
+std::shared_ptr<ExecutionNode> SimulationOrchestrator::createLocalNode(const std::string& name, int slots) {
+    auto runner = [this, name](const std::string& flow, std::vector<unsigned char>& state, const CancellationToken&) {
+        static std::atomic<unsigned long> serial{0};
+        auto& engine = SimulationEngine::getInstance();
+        const std::string scratch = name + "#" + std::to_string(serial++);
+        engine.registerWafer(engine.createWafer(300.0, 775.0, "silicon"), scratch);
+        bool success = false;
+        try {
+            engine.restoreWaferState(scratch, std::move(state));
+            success = executeSimulationFlow(flow, scratch).get();
+            state = engine.captureWaferState(scratch);
+        } catch (...) {
+            engine.unregisterWafer(scratch);
+            throw;
+        }
+        engine.unregisterWafer(scratch);
+        return success;
+    };
+    return std::make_shared<LocalExecutionNode>(name, slots, runner);
+}
+
+double SimulationOrchestrator::estimateBatchCost(const std::string& wafer_name, const std::string& flow_name) const {
+    double seconds = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        auto flow = flows_.find(flow_name);
+        if (flow == flows_.end()) {
+            return 0.0;
+        }
+        for (const auto& step : flow->second.steps) {
+            seconds += step.estimated_duration > 0.0 ? step.estimated_duration : 1.0;
+        }
+    }
+    double cells = 1.0;
+    try {
+        auto wafer = SimulationEngine::getInstance().getWafer(wafer_name);
+        cells = std::max<double>(1.0, static_cast<const Wafer&>(*wafer).getGrid().size());
+    } catch (const std::runtime_error&) {
+    }
+    return seconds * cells;
+}
+
+std::vector<bool> SimulationOrchestrator::executeBatchDistributed(
+    DistributedBatchExecutor& executor, const std::vector<std::pair<std::string, std::string>>& batch) {
+    auto& engine = SimulationEngine::getInstance();
+    std::vector<DistributedBatchExecutor::Item> items;
+    items.reserve(batch.size());
+    for (const auto& [wafer, flow] : batch) {
+        items.push_back({wafer, flow, estimateBatchCost(wafer, flow)});
+    }
+    DistributedBatchExecutor::WaferStates states;
+    states.capture = [&engine](const std::string& wafer) { return engine.captureWaferState(wafer); };
+    states.restore = [&engine](const std::string& wafer, std::vector<unsigned char> state) {
+        engine.restoreWaferState(wafer, std::move(state));
+    };
+
+    std::vector<bool> results(batch.size(), false);
+    try {
+        const auto delivered = executor.run(
+            items, states,
+            [&](const DistributedBatchExecutor::ItemResult& result) {
+                const std::string name = batch[result.index].first + "/" + batch[result.index].second;
+                if (!result.success) {
+                    notifyError(name, "Distributed batch item failed on " +
+                                          (result.node.empty() ? std::string("no node") : result.node) + ": " +
+                                          result.error);
+                }
+                notifyStepCompleted(name, result.success);
+            },
+            runCancellationToken());
+        for (const auto& result : delivered) {
+            results[result.index] = result.success;
+        }
+    } catch (const std::exception& e) {
+        notifyError("Batch", "Distributed batch failed: " + std::string(e.what()));
+    }
+    return results;
+}
+
+std::vector<bool> SimulationOrchestrator::executeBatchPipelined(
+    const std::vector<std::pair<std::string, std::string>>& batch) {
+
+    struct WaferRun {
+        std::string name;
+        std::vector<ProcessStepDefinition> steps;
+        size_t next_step = 0;
+        bool done = false;
+    };
+    struct Stage {
+        size_t workers = 1;
+        size_t capacity = 4;
+        size_t busy = 0;              // Running plus blocked wafers
+        std::deque<size_t> queue;
+    };
+
+    std::vector<WaferRun> wafers(batch.size());
+    std::vector<bool> results(batch.size(), false);
+    std::unordered_map<StepType, Stage> stages;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        for (size_t w = 0; w < batch.size(); ++w) {
+            wafers[w].name = batch[w].first;
+            auto flow = flows_.find(batch[w].second);
+            if (flow == flows_.end()) {
+                wafers[w].done = true;
+                continue;
+            }
+            wafers[w].steps = flow->second.steps;
+            for (const auto& step : wafers[w].steps) {
+                Stage& stage = stages[step.type];
+                auto workers = stage_workers_.find(step.type);
+                auto capacity = stage_queue_capacity_.find(step.type);
+                stage.workers = workers != stage_workers_.end() ? workers->second : 1;
+                stage.capacity = capacity != stage_queue_capacity_.end() ? capacity->second : 4;
+            }
+        }
+    }
+    for (size_t w = 0; w < batch.size(); ++w) {
+        if (wafers[w].done) {
+            notifyError("Batch", "Flow not found: " + batch[w].second);
+        } else if (wafers[w].steps.empty()) {
+            wafers[w].done = true;
+            results[w] = true;
+        }
+    }
+
+    struct Completions {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::pair<size_t, bool>> done;
+    };
+    auto completions = std::make_shared<Completions>();
+    auto& scheduler = TaskScheduler::getInstance();
+
+    // Wafers that finished a step but found the next stage's queue full,
+    // in the order they finished; each still occupies its previous stage
+    std::deque<size_t> blocked;
+    size_t admitted = 0;
+    size_t running = 0;
+
+    auto stageOf = [&](size_t w) -> Stage& {
+        return stages[wafers[w].steps[wafers[w].next_step].type];
+    };
+    auto previousStage = [&](size_t w) -> Stage& {
+        return stages[wafers[w].steps[wafers[w].next_step - 1].type];
+    };
+    auto stopping = [&] { return should_cancel_ || should_pause_; };
+
+    while (true) {
+        // Move blocked wafers downstream, admit new wafers where their first
+        // stage has room and start queued wafers on free workers, until
+        // nothing changes
+        bool moved = true;
+        while (moved) {
+            moved = false;
+            for (auto it = blocked.begin(); it != blocked.end(); ) {
+                Stage& stage = stageOf(*it);
+                if (stage.queue.size() < stage.capacity) {
+                    previousStage(*it).busy--;
+                    stage.queue.push_back(*it);
+                    it = blocked.erase(it);
+                    moved = true;
+                } else {
+                    ++it;
+                }
+            }
+            while (!stopping() && admitted < wafers.size()) {
+                if (wafers[admitted].done) {
+                    ++admitted;
+                    continue;
+                }
+                Stage& stage = stageOf(admitted);
+                if (stage.queue.size() >= stage.capacity) {
+                    break;
+                }
+                stage.queue.push_back(admitted++);
+                moved = true;
+            }
+            for (auto& entry : stages) {
+                Stage& stage = entry.second;
+                while (!stopping() && stage.busy < stage.workers && !stage.queue.empty()) {
+                    size_t w = stage.queue.front();
+                    stage.queue.pop_front();
+                    stage.busy++;
+                    running++;
+                    moved = true;
+                    scheduler.submit([this, step = wafers[w].steps[wafers[w].next_step],
+                                      wafer_name = wafers[w].name, completions, w]() {
+                        bool success = false;
+                        try {
+                            success = executeStep(step, wafer_name);
+                        } catch (...) {
+                            // Counted as a failed step below
+                        }
+                        {
+                            std::lock_guard<std::mutex> lock(completions->mutex);
+                            completions->done.emplace_back(w, success);
+                        }
+                        completions->cv.notify_one();
+                    });
+                }
+            }
+        }
+
+        if (running == 0) {
+            if (!blocked.empty() && !stopping()) {
+                // Flows that revisit a stage can fill queues in a circle;
+                // let the longest-blocked wafer through over capacity
+                size_t w = blocked.front();
+                blocked.pop_front();
+                previousStage(w).busy--;
+                stageOf(w).queue.push_back(w);
+                continue;
+            }
+            if (should_cancel_ || (blocked.empty() && admitted == wafers.size() &&
+                std::all_of(stages.begin(), stages.end(),
+                            [](const auto& entry) { return entry.second.queue.empty(); }))) {
+                break;
+            }
+            if (should_pause_) {
+                std::unique_lock<std::mutex> lock(state_mutex_);
+                state_cv_.wait(lock, [this] { return !should_pause_ || should_cancel_; });
+                continue;
+            }
+        }
+
+        std::deque<std::pair<size_t, bool>> done;
+        {
+            std::unique_lock<std::mutex> lock(completions->mutex);
+            completions->cv.wait(lock, [&] { return !completions->done.empty(); });
+            done.swap(completions->done);
+        }
+        for (const auto& [w, success] : done) {
+            running--;
+            WaferRun& wafer = wafers[w];
+            const std::string& step_name = wafer.steps[wafer.next_step].name;
+            wafer.next_step++;
+            if (!success || wafer.next_step == wafer.steps.size()) {
+                previousStage(w).busy--;
+                wafer.done = true;
+                results[w] = success;
+                if (!success) {
+                    notifyError(wafer.name + "/" + step_name, "Batch step execution failed");
+                    continue;
+                }
+            } else {
+                blocked.push_back(w);
+            }
+            notifyStepCompleted(wafer.name + "/" + step_name, true);
+        }
+    }
+    return results;
+}
+
 SimulationOrchestrator::SimulationProgress SimulationOrchestrator::getProgress() const {
     std::lock_guard<std::mutex> lock(state_mutex_);
     return progress_;
@@ -473,9 +861,18 @@ bool SimulationOrchestrator::isPaused() const {
 
 // Missing execution flow methods implementation
 bool SimulationOrchestrator::executeSequentialFlow(const std::string& wafer_name) {
+    std::vector<size_t> completed;
     for (size_t i = 0; i < current_flow_.steps.size(); ++i) {
         if (should_cancel_) return false;
 
+        if (i < restored_steps_.size() && restored_steps_[i]) {
+            completed.push_back(i);
+            progress_.current_step = i + 1;
+            progress_.progress_percentage = (double)(i + 1) / current_flow_.steps.size() * 100.0;
+            progress_.completed_steps.push_back(current_flow_.steps[i].name);
+            continue;
+        }
+
         // Handle pause
         if (should_pause_) {
             std::unique_lock<std::mutex> lock(state_mutex_);
@@ -490,6 +887,8 @@ bool SimulationOrchestrator::executeSequentialFlow(const std::string& wafer_name
             notifyError(step.name, "Step execution failed");
             return false;
         }
+        completed.push_back(i);
+        recordStepSnapshot(wafer_name, completed);
 
         progress_.current_step = i + 1;
         progress_.progress_percentage = (double)(i + 1) / current_flow_.steps.size() * 100.0;
@@ -502,124 +901,13 @@ bool SimulationOrchestrator::executeSequentialFlow(const std::string& wafer_name
 }
 
 bool SimulationOrchestrator::executeParallelFlow(const std::string& wafer_name) {
-    // Group steps that can be executed in parallel
-    auto parallel_groups = groupParallelSteps(current_flow_.steps);
-
-    size_t completed_steps = 0;
-    for (const auto& group : parallel_groups) {
-        if (should_cancel_) return false;
-
-        // Handle pause
-        if (should_pause_) {
-            std::unique_lock<std::mutex> lock(state_mutex_);
-            state_cv_.wait(lock, [this] { return !should_pause_ || should_cancel_; });
-            if (should_cancel_) return false;
-        }
-
-        // Execute steps in parallel
-        auto futures = executeStepsParallel(group, wafer_name);
-
-        // Wait for all steps in group to complete
-        bool group_success = true;
-        for (size_t i = 0; i < futures.size(); ++i) {
-            bool step_success = futures[i].get();
-            if (!step_success) {
-                notifyError(group[i].name, "Parallel step execution failed");
-                group_success = false;
-            } else {
-                progress_.completed_steps.push_back(group[i].name);
-                notifyStepCompleted(group[i].name, true);
-            }
-        }
-
-        if (!group_success) return false;
-
-        completed_steps += group.size();
-        progress_.current_step = completed_steps;
-        progress_.progress_percentage = (double)completed_steps / current_flow_.steps.size() * 100.0;
-        updateProgress();
-        notifyProgress();
-    }
-    return true;
+    return executeStepGraph(wafer_name);
 }
 
 bool SimulationOrchestrator::executePipelineFlow(const std::string& wafer_name) {
-    // Simplified pipeline implementation - execute with overlap
-    std::vector<std::future<bool>> active_futures;
-    std::vector<ProcessStepDefinition> active_steps;
-
-    size_t step_index = 0;
-    size_t completed_steps = 0;
-
-    while (step_index < current_flow_.steps.size() || !active_futures.empty()) {
-        if (should_cancel_) return false;
-
-        // Handle pause
-        if (should_pause_) {
-            std::unique_lock<std::mutex> lock(state_mutex_);
-            state_cv_.wait(lock, [this] { return !should_pause_ || should_cancel_; });
-            if (should_cancel_) return false;
-        }
-
-        // Start new steps if we have capacity and steps remaining
-        while (active_futures.size() < max_parallel_steps_ && step_index < current_flow_.steps.size()) {
-            const auto& step = current_flow_.steps[step_index];
-
-            // Check dependencies
-            bool dependencies_met = true;
-            for (const auto& dep : step.dependencies) {
-                if (std::find(progress_.completed_steps.begin(), progress_.completed_steps.end(), dep)
-                    == progress_.completed_steps.end()) {
-                    dependencies_met = false;
-                    break;
-                }
-            }
-
-            if (dependencies_met) {
-                auto future = std::async(std::launch::async, [this, step, wafer_name]() {
-                    return executeStep(step, wafer_name);
-                });
-                active_futures.push_back(std::move(future));
-                active_steps.push_back(step);
-                step_index++;
-            } else {
-                break; // Wait for dependencies
-            }
-        }
-
-        // Check for completed steps
-        for (size_t i = 0; i < active_futures.size(); ) {
-            if (active_futures[i].wait_for(std::chrono::milliseconds(10)) == std::future_status::ready) {
-                bool success = active_futures[i].get();
-                const auto& step = active_steps[i];
-
-                if (!success) {
-                    notifyError(step.name, "Pipeline step execution failed");
-                    return false;
-                }
-
-                progress_.completed_steps.push_back(step.name);
-                notifyStepCompleted(step.name, true);
-                completed_steps++;
-
-                // Remove completed future and step
-                active_futures.erase(active_futures.begin() + i);
-                active_steps.erase(active_steps.begin() + i);
-
-                progress_.current_step = completed_steps;
-                progress_.progress_percentage = (double)completed_steps / current_flow_.steps.size() * 100.0;
-                updateProgress();
-                notifyProgress();
-            } else {
-                i++;
-            }
-        }
-
-        // Small delay to prevent busy waiting
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    }
-
-    return true;
+    // Steps start as soon as their predecessors finish, which already
+    // overlaps independent work; pipelining adds nothing on one wafer
+    return executeStepGraph(wafer_name);
 }
 
 bool SimulationOrchestrator::executeBatchFlow(const std::string& wafer_name) {
@@ -627,7 +915,38 @@ bool SimulationOrchestrator::executeBatchFlow(const std::string& wafer_name) {
     return executeSequentialFlow(wafer_name);
 }
 
+CancellationToken SimulationOrchestrator::runCancellationToken() {
+    std::lock_guard<std::mutex> lock(cancel_mutex_);
+    return cancel_source_.token();
+}
+
 bool SimulationOrchestrator::executeStep(const ProcessStepDefinition& step, const std::string& wafer_name) {
+    // The engine hands the token on to the process models, so cancelling
+    // the run or exceeding the step's budget also stops a step in flight
+    const CancellationToken token =
+        runCancellationToken().withBudget(std::chrono::duration<double>(step.timeout));
+    // Step latency, as the engine times its processes
+    auto step_timer = AdvancedLogger::getInstance().createTimer("step_" + step.name, "SimulationOrchestrator");
+    bool success;
+    {
+        CancellationScope scope(token);
+        success = dispatchStep(step, wafer_name);
+    }
+    const char* result = success ? "success" : "failure";
+    if (!success && !token.cancelled() && token.stopRequested()) {
+        notifyError(step.name, "Step exceeded its time budget of " + std::to_string(step.timeout) + " s");
+        result = "timeout";
+    } else if (!success && token.cancelled()) {
+        result = "cancelled";
+    }
+    MetricsRegistry::getInstance()
+        .counter("semipro_orchestrator_steps_total", "Flow steps finished by the orchestrator",
+                 {{"step", step.name}, {"result", result}})
+        .add();
+    return success;
+}
+
+bool SimulationOrchestrator::dispatchStep(const ProcessStepDefinition& step, const std::string& wafer_name) {
     try {
         switch (step.type) {
             case StepType::OXIDATION:
@@ -664,9 +983,7 @@ bool SimulationOrchestrator::executeStep(const ProcessStepDefinition& step, cons
 bool SimulationOrchestrator::executeOxidationStep(const ProcessStepDefinition& step, const std::string& wafer_name) {
     auto& engine = SimulationEngine::getInstance();
 
-    ProcessParameters params;
-    params.operation = "oxidation";
-    params.duration = step.estimated_duration;
+    SimulationEngine::ProcessParameters params("oxidation", step.estimated_duration);
     params.priority = step.priority;
 
     // Extract parameters
@@ -685,15 +1002,13 @@ bool SimulationOrchestrator::executeOxidationStep(const ProcessStepDefinition& s
     }
 
     auto future = engine.simulateProcessAsync(wafer_name, params);
-    return future.get();
+    return TaskScheduler::getInstance().wait(future);
 }
 
 bool SimulationOrchestrator::executeDopingStep(const ProcessStepDefinition& step, const std::string& wafer_name) {
     auto& engine = SimulationEngine::getInstance();
 
-    ProcessParameters params;
-    params.operation = "doping";
-    params.duration = step.estimated_duration;
+    SimulationEngine::ProcessParameters params("doping", step.estimated_duration);
     params.priority = step.priority;
 
     // Extract parameters
@@ -712,7 +1027,7 @@ bool SimulationOrchestrator::executeDopingStep(const ProcessStepDefinition& step
     }
 
     auto future = engine.simulateProcessAsync(wafer_name, params);
-    return future.get();
+    return TaskScheduler::getInstance().wait(future);
 }
 
 bool SimulationOrchestrator::executeLithographyStep(const ProcessStepDefinition& step, const std::string& wafer_name) {
@@ -737,9 +1052,7 @@ bool SimulationOrchestrator::executeLithographyStep(const ProcessStepDefinition&
 bool SimulationOrchestrator::executeDepositionStep(const ProcessStepDefinition& step, const std::string& wafer_name) {
     auto& engine = SimulationEngine::getInstance();
 
-    ProcessParameters params;
-    params.operation = "deposition";
-    params.duration = step.estimated_duration;
+    SimulationEngine::ProcessParameters params("deposition", step.estimated_duration);
     params.priority = step.priority;
 
     // Extract parameters
@@ -758,15 +1071,13 @@ bool SimulationOrchestrator::executeDepositionStep(const ProcessStepDefinition&
     }
 
     auto future = engine.simulateProcessAsync(wafer_name, params);
-    return future.get();
+    return TaskScheduler::getInstance().wait(future);
 }
 
 bool SimulationOrchestrator::executeEtchingStep(const ProcessStepDefinition& step, const std::string& wafer_name) {
     auto& engine = SimulationEngine::getInstance();
 
-    ProcessParameters params;
-    params.operation = "etching";
-    params.duration = step.estimated_duration;
+    SimulationEngine::ProcessParameters params("etching", step.estimated_duration);
     params.priority = step.priority;
 
     // Extract parameters
@@ -785,7 +1096,7 @@ bool SimulationOrchestrator::executeEtchingStep(const ProcessStepDefinition& ste
     }
 
     auto future = engine.simulateProcessAsync(wafer_name, params);
-    return future.get();
+    return TaskScheduler::getInstance().wait(future);
 }
 
 bool SimulationOrchestrator::executeMetallizationStep(const ProcessStepDefinition& step, const std::string& wafer_name) {
@@ -854,26 +1165,31 @@ bool SimulationOrchestrator::executeInspectionStep(const ProcessStepDefinition&
 }
 
 bool SimulationOrchestrator::executeCustomStep(const ProcessStepDefinition& step, const std::string& wafer_name) {
-    // Custom step - basic implementation
-    std::string message = "Custom step executed: " + step.name;
-
-    // In a real implementation, this would call custom user-defined modules
-    return true;
-}
-
-std::vector<std::future<bool>> SimulationOrchestrator::executeStepsParallel(
-    const std::vector<ProcessStepDefinition>& steps, const std::string& wafer_name) {
-
-    std::vector<std::future<bool>> futures;
-
-    for (const auto& step : steps) {
-        auto future = std::async(std::launch::async, [this, step, wafer_name]() {
-            return executeStep(step, wafer_name);
-        });
-        futures.push_back(std::move(future));
+    if (step.plugin.empty()) {
+        return true; // Nothing to run
     }
-
-    return futures;
+    std::shared_ptr<PluginManager> plugins;
+    {
+        std::lock_guard<std::mutex> lock(plugin_mutex_);
+        plugins = plugin_manager_;
+    }
+    ProcessModuleHandle module = plugins ? plugins->processModule(step.plugin) : ProcessModuleHandle();
+    if (!module) {
+        notifyError(step.name, "Process module plugin not loaded: " + step.plugin);
+        return false;
+    }
+    auto wafer = SimulationEngine::getInstance().getWafer(wafer_name);
+    if (!wafer) {
+        notifyError(step.name, "Wafer not found: " + wafer_name);
+        return false;
+    }
+    if (!step.parameters.empty()) {
+        module->setParameters(step.parameters);
+    }
+    ::Wafer* wafers[] = {wafer.get()};
+    PluginResults results;
+    module.execute(wafers, 1, results);
+    return true;
 }
 
 bool SimulationOrchestrator::resolveDependencies(const std::vector<ProcessStepDefinition>& steps) const {
@@ -895,70 +1211,647 @@ bool SimulationOrchestrator::resolveDependencies(const std::vector<ProcessStepDe
     return true;
 }
 
-std::vector<std::vector<SimulationOrchestrator::ProcessStepDefinition>>
-SimulationOrchestrator::groupParallelSteps(const std::vector<ProcessStepDefinition>& steps) const {
+bool SimulationOrchestrator::orderByDependencies(const std::vector<ProcessStepDefinition>& steps,
+                                                 std::vector<size_t>& order) const {
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        index.emplace(steps[i].name, i);
+    }
 
-    std::vector<std::vector<ProcessStepDefinition>> groups;
-    std::set<std::string> completed_steps;
-    std::vector<ProcessStepDefinition> remaining_steps = steps;
+    // Kahn's algorithm, always taking the earliest ready step in flow order
+    std::vector<std::vector<size_t>> dependents(steps.size());
+    std::vector<size_t> missing(steps.size(), 0);
+    for (size_t i = 0; i < steps.size(); ++i) {
+        for (const auto& dep : steps[i].dependencies) {
+            auto it = index.find(dep);
+            if (it != index.end()) {
+                dependents[it->second].push_back(i);
+                ++missing[i];
+            }
+        }
+    }
+    std::set<size_t> ready;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        if (missing[i] == 0) {
+            ready.insert(i);
+        }
+    }
+    order.clear();
+    while (!ready.empty()) {
+        size_t next = *ready.begin();
+        ready.erase(ready.begin());
+        order.push_back(next);
+        for (size_t dependent : dependents[next]) {
+            if (--missing[dependent] == 0) {
+                ready.insert(dependent);
+            }
+        }
+    }
+    return order.size() == steps.size();
+}
 
-    while (!remaining_steps.empty()) {
-        std::vector<ProcessStepDefinition> current_group;
+namespace {
 
-        // Find steps that can be executed in parallel (no dependencies or dependencies met)
-        auto it = remaining_steps.begin();
-        while (it != remaining_steps.end()) {
-            bool dependencies_met = true;
+using AccessSet = std::vector<std::string>;
 
-            for (const auto& dep : it->dependencies) {
-                if (completed_steps.find(dep) == completed_steps.end()) {
-                    dependencies_met = false;
-                    break;
+void stepAccess(const SimulationOrchestrator::ProcessStepDefinition& step, AccessSet& reads, AccessSet& writes) {
+    using StepType = SimulationOrchestrator::StepType;
+    if (!step.reads.empty() || !step.writes.empty()) {
+        reads = step.reads;
+        writes = step.writes;
+        return;
+    }
+    if (!step.parallel_compatible) {
+        reads.clear();
+        writes = {"*"};
+        return;
+    }
+    switch (step.type) {
+        case StepType::OXIDATION:     reads = {"grid", "temperature"};  writes = {"grid", "films"}; break;
+        case StepType::DOPING:        reads = {"grid", "photoresist"};  writes = {"dopant"}; break;
+        case StepType::LITHOGRAPHY:   reads = {"grid"};                 writes = {"photoresist"}; break;
+        case StepType::DEPOSITION:    reads = {"grid"};                 writes = {"grid", "films"}; break;
+        case StepType::ETCHING:       reads = {"photoresist"};          writes = {"grid", "films"}; break;
+        case StepType::METALLIZATION: reads = {"grid", "photoresist"};  writes = {"grid", "metal"}; break;
+        case StepType::ANNEALING:     reads = {"dopant"};               writes = {"dopant", "temperature"}; break;
+        case StepType::CMP:           reads = {};                       writes = {"grid", "films"}; break;
+        case StepType::INSPECTION:    reads = {"grid", "films"};        writes = {"defects"}; break;
+        default:                      reads = {};                       writes = {"*"}; break;
+    }
+}
+
+bool overlaps(const AccessSet& a, const AccessSet& b) {
+    for (const auto& x : a) {
+        for (const auto& y : b) {
+            if (x == y || x == "*" || y == "*") {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+std::vector<std::vector<size_t>> SimulationOrchestrator::buildStepGraph(
+    const std::vector<ProcessStepDefinition>& steps) const {
+
+    std::vector<size_t> order;
+    if (!orderByDependencies(steps, order)) {
+        throw std::runtime_error("Flow has a dependency cycle");
+    }
+
+    const size_t n = steps.size();
+    std::vector<AccessSet> reads(n), writes(n);
+    std::shared_ptr<PluginManager> plugins;
+    {
+        std::lock_guard<std::mutex> lock(plugin_mutex_);
+        plugins = plugin_manager_;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        const auto& step = steps[i];
+        ProcessModuleHandle module;
+        if (plugins && step.type == StepType::CUSTOM && !step.plugin.empty() && step.reads.empty() &&
+            step.writes.empty()) {
+            module = plugins->processModule(step.plugin);
+        }
+        if (module) {
+            reads[i] = module.reads();
+            writes[i] = module.writes();
+        } else {
+            stepAccess(step, reads[i], writes[i]);
+        }
+    }
+
+    std::vector<std::vector<size_t>> successors(n);
+    std::vector<char> linked(n * n, 0);
+    auto link = [&](size_t from, size_t to) {
+        if (!linked[from * n + to]) {
+            linked[from * n + to] = 1;
+            successors[from].push_back(to);
+        }
+    };
+
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < n; ++i) {
+        index.emplace(steps[i].name, i);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        for (const auto& dep : steps[i].dependencies) {
+            link(index.at(dep), i);
+        }
+    }
+    // Conflicting pairs follow the dependency-respecting flow order, so
+    // these edges never close a cycle
+    for (size_t a = 0; a < n; ++a) {
+        for (size_t b = a + 1; b < n; ++b) {
+            size_t first = order[a];
+            size_t second = order[b];
+            if (overlaps(writes[first], reads[second]) || overlaps(writes[first], writes[second]) ||
+                overlaps(reads[first], writes[second])) {
+                link(first, second);
+            }
+        }
+    }
+    return successors;
+}
+
+bool SimulationOrchestrator::executeStepGraph(const std::string& wafer_name) {
+    const auto& steps = current_flow_.steps;
+    auto problems = checkDependencies(current_flow_);
+    if (!problems.empty()) {
+        for (const auto& problem : problems) {
+            notifyError("Flow Validation", problem);
+        }
+        return false;
+    }
+
+    auto successors = buildStepGraph(steps);
+    std::vector<size_t> waiting_on(steps.size(), 0);
+    for (const auto& next : successors) {
+        for (size_t to : next) {
+            ++waiting_on[to];
+        }
+    }
+
+    // Steps restored from a snapshot are done before the run starts
+    std::vector<size_t> done_order;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        if (i < restored_steps_.size() && restored_steps_[i]) {
+            done_order.push_back(i);
+            progress_.completed_steps.push_back(steps[i].name);
+            for (size_t next : successors[i]) {
+                --waiting_on[next];
+            }
+        }
+    }
+
+    // Ready steps by descending priority, then flow order
+    std::set<std::pair<int, size_t>> ready;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        if (waiting_on[i] == 0 && !(i < restored_steps_.size() && restored_steps_[i])) {
+            ready.emplace(-steps[i].priority, i);
+        }
+    }
+
+    // Steps report back through this queue; the coordinating thread alone
+    // touches the graph state and progress_
+    struct Completions {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::pair<size_t, bool>> done;
+    };
+    auto completions = std::make_shared<Completions>();
+    auto& scheduler = TaskScheduler::getInstance();
+    const size_t limit = static_cast<size_t>(std::max(1, max_parallel_steps_));
+
+    size_t in_flight = 0;
+    size_t completed = done_order.size();
+    size_t snapshot_size = completed;
+    progress_.current_step = completed;
+    progress_.progress_percentage = steps.empty() ? 0.0 : (double)completed / steps.size() * 100.0;
+    bool failed = false;
+    while (completed < steps.size()) {
+        if (in_flight == 0) {
+            if (failed || should_cancel_) break;
+
+            // Handle pause
+            if (should_pause_) {
+                std::unique_lock<std::mutex> lock(state_mutex_);
+                state_cv_.wait(lock, [this] { return !should_pause_ || should_cancel_; });
+                if (should_cancel_) break;
+            }
+        }
+
+        // Running steps are waited for even when paused, cancelled (their
+        // models stop at the next poll) or after a failure
+        while (!failed && !should_cancel_ && !should_pause_ && in_flight < limit && !ready.empty()) {
+            size_t index = ready.begin()->second;
+            ready.erase(ready.begin());
+            ++in_flight;
+            scheduler.submit([this, step = steps[index], wafer_name, completions, index]() {
+                bool success = false;
+                try {
+                    success = executeStep(step, wafer_name);
+                } catch (...) {
+                    // Counted as a failed step by the coordinator
                 }
+                {
+                    std::lock_guard<std::mutex> lock(completions->mutex);
+                    completions->done.emplace_back(index, success);
+                }
+                completions->cv.notify_one();
+            });
+        }
+        if (in_flight == 0) {
+            continue;
+        }
+
+        std::deque<std::pair<size_t, bool>> done;
+        {
+            std::unique_lock<std::mutex> lock(completions->mutex);
+            completions->cv.wait(lock, [&] { return !completions->done.empty(); });
+            done.swap(completions->done);
+        }
+        for (const auto& [index, success] : done) {
+            --in_flight;
+            const auto& step = steps[index];
+            if (!success) {
+                notifyError(step.name, "Step execution failed");
+                failed = true;
+                continue;
             }
+            ++completed;
+            done_order.push_back(index);
+            for (size_t next : successors[index]) {
+                if (--waiting_on[next] == 0) {
+                    ready.emplace(-steps[next].priority, next);
+                }
+            }
+            progress_.completed_steps.push_back(step.name);
+            progress_.current_step = completed;
+            progress_.progress_percentage = (double)completed / steps.size() * 100.0;
+            notifyStepCompleted(step.name, true);
+            updateProgress();
+            notifyProgress();
+        }
+        // Only a state with no step in flight is a consistent snapshot
+        if (in_flight == 0 && done_order.size() > snapshot_size) {
+            recordStepSnapshot(wafer_name, done_order);
+            snapshot_size = done_order.size();
+        }
+    }
+    return !failed && completed == steps.size();
+}
 
-            if (dependencies_met && it->parallel_compatible &&
-                current_group.size() < max_parallel_steps_) {
-                current_group.push_back(*it);
-                completed_steps.insert(it->name);
-                it = remaining_steps.erase(it);
-            } else if (dependencies_met && current_group.empty()) {
-                // If no parallel group started, add this step anyway
-                current_group.push_back(*it);
-                completed_steps.insert(it->name);
-                it = remaining_steps.erase(it);
-                break; // Only one non-parallel step per group
-            } else {
-                ++it;
+bool SimulationOrchestrator::validateFlow(const SimulationFlow& flow) const {
+    return checkDependencies(flow).empty();
+}
+
+std::vector<std::string> SimulationOrchestrator::checkDependencies(const SimulationFlow& flow) const {
+    std::vector<std::string> problems;
+    std::set<std::string> names;
+    for (const auto& step : flow.steps) {
+        if (!names.insert(step.name).second) {
+            problems.push_back("Duplicate step name: " + step.name);
+        }
+    }
+    for (const auto& step : flow.steps) {
+        for (const auto& dep : step.dependencies) {
+            if (dep == step.name) {
+                problems.push_back("Step depends on itself: " + step.name);
+            } else if (names.find(dep) == names.end()) {
+                problems.push_back("Step " + step.name + " depends on unknown step: " + dep);
             }
         }
+    }
+    std::vector<size_t> order;
+    if (problems.empty() && !orderByDependencies(flow.steps, order)) {
+        std::vector<char> placed(flow.steps.size(), 0);
+        for (size_t i : order) {
+            placed[i] = 1;
+        }
+        for (size_t i = 0; i < flow.steps.size(); ++i) {
+            if (!placed[i]) {
+                problems.push_back("Dependency cycle through step: " + flow.steps[i].name);
+            }
+        }
+    }
+    return problems;
+}
 
-        if (!current_group.empty()) {
-            groups.push_back(current_group);
-        } else {
-            // Deadlock - circular dependencies or other issue
-            break;
+void SimulationOrchestrator::setExecutionMode(ExecutionMode mode) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    execution_mode_ = mode;
+}
+
+SimulationOrchestrator::ExecutionMode SimulationOrchestrator::getExecutionMode() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return execution_mode_;
+}
+
+void SimulationOrchestrator::setMaxParallelSteps(int max_steps) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    max_parallel_steps_ = std::max(1, max_steps);
+}
+
+int SimulationOrchestrator::getMaxParallelSteps() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return max_parallel_steps_;
+}
+
+namespace {
+
+// Everything about a step that can change what it does to a wafer
+CacheKey stepSignature(const SimulationOrchestrator::ProcessStepDefinition& step) {
+    ContentHasher hasher;
+    hasher.update_value(static_cast<std::int32_t>(step.type));
+    hasher.update_string(step.name);
+    std::vector<std::pair<std::string, double>> parameters(step.parameters.begin(), step.parameters.end());
+    std::sort(parameters.begin(), parameters.end());
+    hasher.update_value(static_cast<std::uint64_t>(parameters.size()));
+    for (const auto& parameter : parameters) {
+        hasher.update_string(parameter.first);
+        hasher.update_value(parameter.second);
+    }
+    for (const auto* list : {&step.input_files, &step.output_files, &step.dependencies, &step.reads, &step.writes}) {
+        hasher.update_value(static_cast<std::uint64_t>(list->size()));
+        for (const auto& value : *list) {
+            hasher.update_string(value);
+        }
+    }
+    hasher.update_string(step.plugin);
+    hasher.update_value(step.estimated_duration);
+    hasher.update_value(static_cast<std::uint8_t>(step.parallel_compatible));
+    return hasher.finish();
+}
+
+CacheKey stateHash(const std::vector<unsigned char>& state) {
+    return ContentHasher().update(state.data(), state.size()).finish();
+}
+
+} // namespace
+
+void SimulationOrchestrator::enableIncrementalResimulation(bool enable) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    incremental_enabled_ = enable;
+    if (!enable) {
+        wafer_traces_.clear();
+    }
+}
+
+bool SimulationOrchestrator::isIncrementalResimulationEnabled() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return incremental_enabled_;
+}
+
+void SimulationOrchestrator::clearStepSnapshots(const std::string& wafer_name) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (wafer_name.empty()) {
+        wafer_traces_.clear();
+    } else {
+        wafer_traces_.erase(wafer_name);
+    }
+}
+
+void SimulationOrchestrator::beginIncrementalRun(const std::string& wafer_name) {
+    const auto& steps = current_flow_.steps;
+    restored_steps_.assign(steps.size(), false);
+    if (!incremental_enabled_) {
+        return;
+    }
+
+    auto& engine = SimulationEngine::getInstance();
+    std::vector<unsigned char> state = engine.captureWaferState(wafer_name);
+    std::unordered_map<std::string, CacheKey> signatures;
+    std::unordered_map<std::string, size_t> index_of;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        signatures[steps[i].name] = stepSignature(steps[i]);
+        index_of[steps[i].name] = i;
+    }
+
+    // Anything but the same flow on the wafer as its last run left it is
+    // a fresh run on the wafer's current state
+    auto it = wafer_traces_.find(wafer_name);
+    if (it == wafer_traces_.end() || it->second.flow_name != current_flow_.name ||
+        it->second.final_state != stateHash(state)) {
+        WaferTrace& trace = wafer_traces_[wafer_name];
+        trace = WaferTrace();
+        trace.flow_name = current_flow_.name;
+        trace.signatures = std::move(signatures);
+        trace.initial_state = state;
+        trace.last_state = std::move(state);
+        return;
+    }
+    WaferTrace& trace = it->second;
+
+    // What each step must come after: its ancestors in the step graph when
+    // steps run as a graph, otherwise every earlier step
+    const bool graph = execution_mode_ == ExecutionMode::PARALLEL || execution_mode_ == ExecutionMode::PIPELINE;
+    std::vector<std::vector<size_t>> predecessors(steps.size());
+    bool graph_valid = true;
+    if (graph) {
+        graph_valid = checkDependencies(current_flow_).empty();
+        if (graph_valid) {
+            auto successors = buildStepGraph(steps);
+            for (size_t from = 0; from < successors.size(); ++from) {
+                for (size_t to : successors[from]) {
+                    predecessors[to].push_back(from);
+                }
+            }
+        }
+    }
+
+    // A snapshot is reusable when every step it holds is unchanged and
+    // holds everything those steps come after. Snapshots only grow, so the
+    // reusable ones are a prefix.
+    auto reusable = [&](const StepSnapshot& snapshot) {
+        std::vector<bool> held(steps.size(), false);
+        for (const auto& name : snapshot.completed) {
+            auto index = index_of.find(name);
+            auto before = trace.signatures.find(name);
+            if (index == index_of.end() || before == trace.signatures.end() ||
+                before->second != signatures[name]) {
+                return false;
+            }
+            held[index->second] = true;
+        }
+        for (size_t i = 0; i < steps.size(); ++i) {
+            if (!held[i]) continue;
+            if (graph) {
+                for (size_t p : predecessors[i]) {
+                    if (!held[p]) return false;
+                }
+            } else if (std::find(held.begin(), held.begin() + i, false) != held.begin() + i) {
+                return false;
+            }
+        }
+        return true;
+    };
+    size_t kept = 0;
+    while (graph_valid && kept < trace.snapshots.size() && reusable(trace.snapshots[kept])) {
+        ++kept;
+    }
+
+    std::vector<unsigned char> restored = trace.initial_state;
+    for (size_t k = 0; k < kept; ++k) {
+        restored = applyCheckpointDelta(std::move(restored), trace.snapshots[k].delta);
+    }
+    engine.restoreWaferState(wafer_name, restored);
+    trace.snapshots.resize(kept);
+    trace.last_state = std::move(restored);
+    trace.signatures = std::move(signatures);
+    if (kept > 0) {
+        for (const auto& name : trace.snapshots.back().completed) {
+            restored_steps_[index_of[name]] = true;
         }
     }
+}
+
+void SimulationOrchestrator::recordStepSnapshot(const std::string& wafer_name, const std::vector<size_t>& completed) {
+    auto it = wafer_traces_.find(wafer_name);
+    if (!incremental_enabled_ || it == wafer_traces_.end()) {
+        return;
+    }
+    WaferTrace& trace = it->second;
+    std::vector<unsigned char> state = SimulationEngine::getInstance().captureWaferState(wafer_name);
+    StepSnapshot snapshot;
+    for (size_t index : completed) {
+        snapshot.completed.push_back(current_flow_.steps[index].name);
+    }
+    snapshot.delta = checkpointDelta(trace.last_state, state);
+    trace.snapshots.push_back(std::move(snapshot));
+    trace.last_state = std::move(state);
+}
+
+void SimulationOrchestrator::finishIncrementalRun(const std::string& wafer_name) {
+    auto it = wafer_traces_.find(wafer_name);
+    if (!incremental_enabled_ || it == wafer_traces_.end()) {
+        return;
+    }
+    // A failed step may have left partial changes past the last snapshot
+    it->second.final_state = stateHash(SimulationEngine::getInstance().captureWaferState(wafer_name));
+}
+
+std::future<bool> SimulationOrchestrator::executeProgressive(const std::string& wafer_name) {
+    const auto requested = std::chrono::steady_clock::now();
+    return std::async(std::launch::async, [this, wafer_name, requested]() {
+        std::lock_guard<std::mutex> turn(progressive_mutex_);
+        progressive_active_ = true;
+        auto& engine = SimulationEngine::getInstance();
+        const std::string scratch = wafer_name + "#preview";
+        int resolution;
+        {
+            std::lock_guard<std::mutex> lock(preview_mutex_);
+            resolution = preview_resolution_;
+        }
 
-    return groups;
+        bool success = false;
+        try {
+            {
+                std::lock_guard<std::mutex> lock(state_mutex_);
+                // Whatever an edit cancelled has unwound by now
+                should_cancel_ = false;
+                should_pause_ = false;
+                {
+                    std::lock_guard<std::mutex> cancel_lock(cancel_mutex_);
+                    cancel_source_ = CancellationSource();
+                }
+                incremental_enabled_ = true;
+
+                // The coarse copy starts where the run on the wafer will:
+                // from the state its last run started from, unless
+                // something else has changed the wafer since
+                std::shared_ptr<WaferEnhanced> start = engine.getWafer(wafer_name);
+                std::vector<unsigned char> initial = engine.captureWaferState(wafer_name);
+                auto trace = wafer_traces_.find(wafer_name);
+                const bool rerun = trace != wafer_traces_.end() && trace->second.flow_name == current_flow_.name &&
+                                   trace->second.final_state == stateHash(initial);
+                if (rerun) {
+                    initial = trace->second.initial_state;
+                }
+                // Rebuilt only when that state changes, so the copy's own
+                // snapshots carry over from edit to edit
+                const CacheKey base = ContentHasher()
+                                          .update(initial.data(), initial.size())
+                                          .update_value(static_cast<std::int32_t>(resolution))
+                                          .finish();
+                auto known = preview_bases_.find(wafer_name);
+                if (known == preview_bases_.end() || known->second != base) {
+                    if (rerun) {
+                        engine.registerWafer(start->clone(), scratch);
+                        engine.restoreWaferState(scratch, std::move(initial));
+                        start = engine.getWafer(scratch);
+                    }
+                    engine.registerWafer(start->coarsened(resolution), scratch);
+                    preview_bases_[wafer_name] = base;
+                }
+            }
+
+            if (executeSimulation(scratch).get() && !should_cancel_) {
+                publishPreview(wafer_name, 0, engine.getWafer(scratch)->clone());
+                MetricsRegistry::getInstance()
+                    .histogram("semipro_orchestrator_preview_seconds",
+                               "Time from a progressive run's request to each result it published",
+                               {{"level", "0"}})
+                    .observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - requested).count());
+
+                success = executeSimulation(wafer_name).get() && !should_cancel_;
+                if (success) {
+                    publishPreview(wafer_name, 1, engine.getWafer(wafer_name)->clone());
+                    MetricsRegistry::getInstance()
+                        .histogram("semipro_orchestrator_preview_seconds",
+                                   "Time from a progressive run's request to each result it published",
+                                   {{"level", "1"}})
+                        .observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - requested)
+                                     .count());
+                }
+            }
+        } catch (const std::exception& e) {
+            notifyError("Progressive", "Execution failed: " + std::string(e.what()));
+            success = false;
+        }
+        progressive_active_ = false;
+        return success;
+    });
+}
+
+void SimulationOrchestrator::setPreviewCallback(PreviewCallback callback) {
+    std::lock_guard<std::mutex> lock(notify_mutex_);
+    preview_callbacks_.push_back(std::move(callback));
+}
+
+void SimulationOrchestrator::setPreviewResolution(int max_cells) {
+    if (max_cells < 1) {
+        throw std::invalid_argument("Preview resolution must be at least one cell");
+    }
+    std::lock_guard<std::mutex> lock(preview_mutex_);
+    preview_resolution_ = max_cells;
+}
+
+int SimulationOrchestrator::getPreviewResolution() const {
+    std::lock_guard<std::mutex> lock(preview_mutex_);
+    return preview_resolution_;
+}
+
+std::shared_ptr<const WaferEnhanced> SimulationOrchestrator::getPreview(const std::string& wafer_name,
+                                                                        int* level) const {
+    std::lock_guard<std::mutex> lock(preview_mutex_);
+    auto it = previews_.find(wafer_name);
+    if (level) {
+        *level = it == previews_.end() ? -1 : it->second.level;
+    }
+    return it == previews_.end() ? nullptr : it->second.result;
+}
+
+void SimulationOrchestrator::publishPreview(const std::string& wafer_name, int level,
+                                            std::shared_ptr<const WaferEnhanced> result) {
+    {
+        std::lock_guard<std::mutex> lock(preview_mutex_);
+        previews_[wafer_name] = Preview{level, result};
+    }
+    std::lock_guard<std::mutex> lock(notify_mutex_);
+    for (auto& callback : preview_callbacks_) {
+        if (callback) {
+            callback(wafer_name, level, result);
+        }
+    }
 }
 
 void SimulationOrchestrator::updateProgress() {
     auto current_time = std::chrono::system_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-        current_time - progress_.start_time).count();
-
-    progress_.elapsed_time = elapsed;
+    std::chrono::duration<double> elapsed = current_time - progress_.start_time;
 
     if (progress_.current_step > 0 && progress_.total_steps > 0) {
-        double steps_per_second = (double)progress_.current_step / elapsed;
-        double remaining_steps = progress_.total_steps - progress_.current_step;
-        progress_.estimated_remaining_time = remaining_steps / steps_per_second;
+        double seconds_per_step = elapsed.count() / progress_.current_step;
+        double remaining_steps = static_cast<double>(progress_.total_steps - progress_.current_step);
+        progress_.estimated_completion = current_time + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::duration<double>(remaining_steps * seconds_per_step));
     }
 }
 
 void SimulationOrchestrator::notifyProgress() {
+    std::lock_guard<std::mutex> lock(notify_mutex_);
     // Notify progress callbacks if any are registered
     for (auto& callback : progress_callbacks_) {
         if (callback) {
@@ -967,7 +1860,46 @@ void SimulationOrchestrator::notifyProgress() {
     }
 }
 
+void SimulationOrchestrator::setProgressCallback(ProgressCallback callback) {
+    std::lock_guard<std::mutex> lock(notify_mutex_);
+    progress_callbacks_.push_back(std::move(callback));
+    if (solver_events_ >= 0) {
+        return;
+    }
+    // Solver progress within the running step, as a snapshot with the step
+    // interpolated by the solver's fraction done
+    solver_events_ = ProgressEvents::getInstance().subscribe([this](const ProgressEvent& event) {
+        if (event.kind != ProgressEvent::Kind::Progress && event.kind != ProgressEvent::Kind::End) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(notify_mutex_);
+        SimulationProgress snapshot = progress_;
+        snapshot.current_operation = std::string(event.source) + ": " + event.name;
+        if (snapshot.total_steps > 0) {
+            snapshot.progress_percentage =
+                100.0 * (std::min(snapshot.current_step, snapshot.total_steps - 1) + event.fraction()) /
+                snapshot.total_steps;
+        }
+        for (auto& progress_callback : progress_callbacks_) {
+            if (progress_callback) {
+                progress_callback(snapshot);
+            }
+        }
+    });
+}
+
+void SimulationOrchestrator::setStepCompletedCallback(StepCompletedCallback callback) {
+    std::lock_guard<std::mutex> lock(notify_mutex_);
+    step_completion_callbacks_.push_back(std::move(callback));
+}
+
+void SimulationOrchestrator::setErrorCallback(ErrorCallback callback) {
+    std::lock_guard<std::mutex> lock(notify_mutex_);
+    error_callbacks_.push_back(std::move(callback));
+}
+
 void SimulationOrchestrator::notifyStepCompleted(const std::string& step_name, bool success) {
+    std::lock_guard<std::mutex> lock(notify_mutex_);
     // Notify step completion callbacks if any are registered
     for (auto& callback : step_completion_callbacks_) {
         if (callback) {
@@ -977,6 +1909,7 @@ void SimulationOrchestrator::notifyStepCompleted(const std::string& step_name, b
 }
 
 void SimulationOrchestrator::notifyError(const std::string& step_name, const std::string& error_message) {
+    std::lock_guard<std::mutex> lock(notify_mutex_);
     progress_.errors.push_back(step_name + ": " + error_message);
 
     // Notify error callbacks if any are registered
@@ -989,8 +1922,7 @@ void SimulationOrchestrator::notifyError(const std::string& step_name, const std
 
 void SimulationOrchestrator::updateStatistics() {
     auto current_time = std::chrono::system_clock::now();
-    auto total_elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-        current_time - execution_start_time_).count();
+    std::chrono::duration<double> total_elapsed = current_time - execution_start_time_;
 
     stats_.total_execution_time = total_elapsed;
     stats_.total_steps_executed = progress_.current_step;
@@ -998,8 +1930,109 @@ void SimulationOrchestrator::updateStatistics() {
     stats_.failed_steps = progress_.errors.size();
 
     if (stats_.total_steps_executed > 0) {
-        stats_.average_step_time = (double)total_elapsed / stats_.total_steps_executed;
+        stats_.average_step_time = total_elapsed / static_cast<double>(stats_.total_steps_executed);
     }
 }
 
+// SimulationConfig: sections of key/value parameters in one YAML map
+
+SimulationConfig::SimulationConfig(const std::string& config_file) {
+    loadFromFile(config_file);
+}
+
+void SimulationConfig::loadFromFile(const std::string& config_file) {
+    YAML::Node loaded = YAML::LoadFile(config_file);
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    config_ = loaded.IsMap() ? loaded : YAML::Node(YAML::NodeType::Map);
+}
+
+void SimulationConfig::saveToFile(const std::string& config_file) const {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    std::ofstream file(config_file);
+    if (!file) {
+        throw std::runtime_error("Cannot write configuration file: " + config_file);
+    }
+    file << config_ << "\n";
+}
+
+void SimulationConfig::setParameter(const std::string& section, const std::string& key, const YAML::Node& value) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    config_[section][key] = value;
+}
+
+YAML::Node SimulationConfig::getParameter(const std::string& section, const std::string& key) const {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    const YAML::Node& config = config_;
+    if (!config.IsMap() || !config[section] || !config[section].IsMap() || !config[section][key]) {
+        return YAML::Node();
+    }
+    return YAML::Clone(config[section][key]);
+}
+
+bool SimulationConfig::hasSection(const std::string& section) const {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    const YAML::Node& config = config_;
+    return config.IsMap() && config[section].IsDefined();
+}
+
+bool SimulationConfig::hasParameter(const std::string& section, const std::string& key) const {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    const YAML::Node& config = config_;
+    return config.IsMap() && config[section] && config[section].IsMap() && config[section][key].IsDefined();
+}
+
+std::vector<std::string> SimulationConfig::getSections() const {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    std::vector<std::string> sections;
+    if (config_.IsMap()) {
+        for (const auto& entry : config_) {
+            sections.push_back(entry.first.as<std::string>());
+        }
+    }
+    return sections;
+}
+
+std::vector<std::string> SimulationConfig::getKeys(const std::string& section) const {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    std::vector<std::string> keys;
+    const YAML::Node& config = config_;
+    if (config.IsMap() && config[section] && config[section].IsMap()) {
+        for (const auto& entry : config[section]) {
+            keys.push_back(entry.first.as<std::string>());
+        }
+    }
+    return keys;
+}
+
+void SimulationConfig::merge(const SimulationConfig& other) {
+    if (&other == this) {
+        return;
+    }
+    // Copied out first, so the two locks are never held together
+    YAML::Node incoming;
+    {
+        std::lock_guard<std::mutex> lock(other.config_mutex_);
+        incoming = YAML::Clone(other.config_);
+    }
+    if (!incoming.IsMap()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    for (const auto& section : incoming) {
+        const std::string name = section.first.as<std::string>();
+        if (!section.second.IsMap()) {
+            config_[name] = section.second;
+            continue;
+        }
+        for (const auto& entry : section.second) {
+            config_[name][entry.first.as<std::string>()] = entry.second;
+        }
+    }
+}
+
+void SimulationConfig::clear() {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    config_ = YAML::Node(YAML::NodeType::Map);
+}
+
 } // namespace SemiPRO
@@ -16,6 +16,12 @@
 #include <yaml-cpp/yaml.h>
 #include "wafer.hpp"
 #include "simulation_engine.hpp"
+#include "performance_utils.hpp"
+#include "cancellation.hpp"
+#include "distributed_batch.hpp"
+#include "plugin_manager.hpp"
+
+class WaferEnhanced;
 
 namespace SemiPRO {
 
@@ -73,9 +79,23 @@ public:
         double estimated_duration;
         int priority;
         bool parallel_compatible;
+        // Wall-clock budget in seconds, 0 for none. Process models poll it
+        // and stop with a partial result; the step then fails.
+        double timeout;
+        // Wafer state the step reads and modifies ("grid", "photoresist",
+        // "dopant", "films", "metal", "temperature", "defects", or "*" for
+        // everything). Steps whose sets conflict keep their flow order;
+        // the others may run concurrently. When both are empty, a
+        // parallel-compatible step uses its type's defaults and any other
+        // step is treated as writing "*".
+        std::vector<std::string> reads;
+        std::vector<std::string> writes;
+        // Process module plugin a CUSTOM step runs; its declared reads and
+        // writes stand in for empty ones
+        std::string plugin;
         
         ProcessStepDefinition(StepType t, const std::string& n) 
-            : type(t), name(n), estimated_duration(0.0), priority(0), parallel_compatible(false) {}
+            : type(t), name(n), estimated_duration(0.0), priority(0), parallel_compatible(false), timeout(0.0) {}
     };
 
     struct SimulationFlow {
@@ -85,7 +105,7 @@ public:
         std::unordered_map<std::string, std::string> global_parameters;
         ExecutionMode execution_mode;
         
-        SimulationFlow(const std::string& n) : name(n), execution_mode(ExecutionMode::SEQUENTIAL) {}
+        SimulationFlow(const std::string& n = "") : name(n), execution_mode(ExecutionMode::SEQUENTIAL) {}
     };
 
     struct SimulationProgress {
@@ -118,6 +138,9 @@ public:
     void addProcessStep(const ProcessStepDefinition& step);
     void removeProcessStep(const std::string& step_name);
     void reorderSteps(const std::vector<std::string>& step_order);
+    // Also reachable through setParameter("step.<step>.<parameter>", value).
+    // Throws std::invalid_argument if the current flow has no such step.
+    void setStepParameter(const std::string& step_name, const std::string& key, double value);
     
     // Execution control
     std::future<bool> executeSimulation(const std::string& wafer_name);
@@ -128,10 +151,38 @@ public:
     void cancelSimulation();
     void resetSimulation();
     
-    // Batch processing
+    // Batch processing. In BATCH mode the wafers are pipelined like a fab
+    // line: every step type is a stage with its own queue and worker
+    // quota, and a wafer moves to the stage of its next step as soon as
+    // it leaves the current one, so lot throughput is set by the slowest
+    // stage. Other modes run each wafer's whole flow in turn.
     void addWaferToBatch(const std::string& wafer_name, const std::string& flow_name);
     std::future<std::vector<bool>> executeBatch();
+    // The given (wafer, flow) pairs instead of the queued ones, which stay
+    // queued, in one call
+    std::future<std::vector<bool>> executeBatch(std::vector<std::pair<std::string, std::string>> batch);
     void clearBatch();
+    // Wafers processed by a stage at once (default 1)
+    void setStageWorkers(StepType type, int workers);
+    int getStageWorkers(StepType type) const;
+    // Wafers waiting for a stage (default 4). A wafer that finds the next
+    // queue full stays blocked on its current stage, holding its worker.
+    void setStageQueueCapacity(StepType type, int capacity);
+    int getStageQueueCapacity(StepType type) const;
+    // With an executor set, executeBatch runs on its execution nodes in
+    // every mode, each wafer's items on one node against a copy of the
+    // wafer, whose final state is restored here (see
+    // DistributedBatchExecutor); nullptr runs batches locally again.
+    void setDistributedExecutor(std::shared_ptr<DistributedBatchExecutor> executor);
+    // Where CUSTOM steps find the plugins they name
+    void setPluginManager(std::shared_ptr<PluginManager> plugins);
+    // An in-process node that runs each flow on a scratch wafer. Flows run
+    // one at a time through this orchestrator, so a superseded attempt
+    // still runs its flow to the end.
+    std::shared_ptr<ExecutionNode> createLocalNode(const std::string& name, int slots = 1);
+    // Cost of a batch item for sharding: the flow's estimated step
+    // durations (1 s for a step without one) times the wafer's grid cells
+    double estimateBatchCost(const std::string& wafer_name, const std::string& flow_name) const;
     
     // Monitoring and status
     SimulationProgress getProgress() const;
@@ -165,6 +216,45 @@ public:
     void setMaxParallelSteps(int max_steps);
     int getMaxParallelSteps() const;
     
+    // Incremental re-simulation. While enabled, a run keeps the wafer state
+    // at every point where no step is in flight. Running the same flow on
+    // the same wafer again, with the wafer untouched since, re-simulates it
+    // from the wafer's initial state: the latest snapshot that holds no
+    // changed step and nothing downstream of one is restored, and only the
+    // remaining steps run. Snapshots are deltas against the previous one,
+    // so each costs about the state its steps modified. Restored steps
+    // count towards progress but raise no step-completed callbacks. Not
+    // used by executeBatch.
+    void enableIncrementalResimulation(bool enable);
+    bool isIncrementalResimulationEnabled() const;
+    // Drops the snapshots of one wafer, or of all wafers for ""
+    void clearStepSnapshots(const std::string& wafer_name = "");
+    
+    // Progressive refinement for interactive use. executeProgressive runs
+    // the current flow first on a coarse copy of the wafer (level 0, at
+    // most the preview resolution along a side, see
+    // WaferEnhanced::coarsened) and publishes the result, then runs it on
+    // the wafer itself and publishes that as level 1. Both passes go
+    // through incremental re-simulation, which a progressive run turns
+    // on: each starts from the wafer's initial state and re-runs only the
+    // steps an edit changed. The coarse copy is registered with the engine
+    // as "<wafer>#preview" and keeps its own snapshots. A setStepParameter
+    // call while a progressive run is in flight cancels it at once, before
+    // waiting for the run to let go of the flow, so an editor can start
+    // the next run straight away; the cancelled run's future yields false.
+    // Progressive runs of one orchestrator take turns.
+    using PreviewCallback = std::function<void(const std::string& wafer_name, int level,
+                                               std::shared_ptr<const WaferEnhanced> result)>;
+    std::future<bool> executeProgressive(const std::string& wafer_name);
+    void setPreviewCallback(PreviewCallback callback);
+    // Longest side of the level 0 grid, in cells (default 64); throws
+    // std::invalid_argument below 1
+    void setPreviewResolution(int max_cells);
+    int getPreviewResolution() const;
+    // Latest result published for the wafer and its level, e.g. as the
+    // initial guess of a solver refining it; nullptr and -1 if none
+    std::shared_ptr<const WaferEnhanced> getPreview(const std::string& wafer_name, int* level = nullptr) const;
+    
     // Checkpointing
     void enableCheckpointing(bool enable, int interval_minutes = 10);
     void saveCheckpoint(const std::string& filename);
@@ -208,18 +298,60 @@ private:
     // Execution control
     std::atomic<bool> should_pause_{false};
     std::atomic<bool> should_cancel_{false};
+    // Raised with should_cancel_ so running process models stop as well;
+    // cancel_mutex_ only guards swapping it, as callers may hold state_mutex_
+    std::mutex cancel_mutex_;
+    CancellationSource cancel_source_;
     ExecutionMode execution_mode_{ExecutionMode::SEQUENTIAL};
     int max_parallel_steps_{4};
+    std::unordered_map<StepType, int> stage_workers_;
+    std::unordered_map<StepType, int> stage_queue_capacity_;
+    std::shared_ptr<DistributedBatchExecutor> distributed_executor_;
+    // Own lock: steps look the plugins up while a run holds state_mutex_
+    mutable std::mutex plugin_mutex_;
+    std::shared_ptr<PluginManager> plugin_manager_;
     
-    // Callbacks
+    // Callbacks; notifications may come from steps running concurrently
+    std::mutex notify_mutex_;
     std::vector<ProgressCallback> progress_callbacks_;
+    int solver_events_{-1}; // ProgressEvents subscription, once there are callbacks
     std::vector<StepCompletedCallback> step_completion_callbacks_;
     std::vector<ErrorCallback> error_callbacks_;
+    std::vector<PreviewCallback> preview_callbacks_;
     
     // Directories
     std::string input_directory_;
     std::string output_directory_;
     
+    // Incremental re-simulation state of each wafer's last run
+    struct StepSnapshot {
+        std::vector<std::string> completed; // Steps whose effects it holds
+        std::vector<unsigned char> delta;   // From the previous snapshot
+    };
+    struct WaferTrace {
+        std::string flow_name;
+        std::unordered_map<std::string, CacheKey> signatures;
+        std::vector<unsigned char> initial_state;
+        std::vector<StepSnapshot> snapshots;
+        std::vector<unsigned char> last_state; // Initial plus all deltas
+        CacheKey final_state;                  // Hash of the wafer after the run
+    };
+    bool incremental_enabled_{false};
+    std::unordered_map<std::string, WaferTrace> wafer_traces_;
+    std::vector<bool> restored_steps_; // Steps of the current run taken from a snapshot
+    
+    // Progressive refinement
+    struct Preview {
+        int level = -1;
+        std::shared_ptr<const WaferEnhanced> result;
+    };
+    std::mutex progressive_mutex_;              // Held for a whole progressive run
+    std::atomic<bool> progressive_active_{false};
+    int preview_resolution_{64};
+    std::unordered_map<std::string, CacheKey> preview_bases_; // Initial state each coarse copy was made from
+    mutable std::mutex preview_mutex_;          // Guards previews_ and preview_resolution_
+    std::unordered_map<std::string, Preview> previews_;
+    
     // Checkpointing
     bool checkpointing_enabled_{false};
     int checkpoint_interval_{10};
@@ -231,18 +363,30 @@ private:
     
     // Internal methods
     bool executeStep(const ProcessStepDefinition& step, const std::string& wafer_name);
+    bool dispatchStep(const ProcessStepDefinition& step, const std::string& wafer_name);
+    CancellationToken runCancellationToken();
     bool executeStepSequential(const ProcessStepDefinition& step, const std::string& wafer_name);
-    std::vector<std::future<bool>> executeStepsParallel(
-        const std::vector<ProcessStepDefinition>& steps, const std::string& wafer_name);
+    
+    // Dependency graph: explicit dependencies plus an edge between every
+    // pair of steps whose read/write sets conflict, oriented by flow order
+    bool orderByDependencies(const std::vector<ProcessStepDefinition>& steps,
+                             std::vector<size_t>& order) const;
+    std::vector<std::vector<size_t>> buildStepGraph(const std::vector<ProcessStepDefinition>& steps) const;
+    bool executeStepGraph(const std::string& wafer_name);
+    
+    // Restores the wafer for a re-run and marks the steps it already holds
+    // in restored_steps_
+    void beginIncrementalRun(const std::string& wafer_name);
+    void recordStepSnapshot(const std::string& wafer_name, const std::vector<size_t>& completed);
+    void finishIncrementalRun(const std::string& wafer_name);
     
     void updateProgress();
     void notifyProgress();
     void notifyStepCompleted(const std::string& step_name, bool success);
     void notifyError(const std::string& step_name, const std::string& error_message);
+    void publishPreview(const std::string& wafer_name, int level, std::shared_ptr<const WaferEnhanced> result);
     
     bool resolveDependencies(const std::vector<ProcessStepDefinition>& steps) const;
-    std::vector<std::vector<ProcessStepDefinition>> groupParallelSteps(
-        const std::vector<ProcessStepDefinition>& steps) const;
     
     void checkpointWorker();
     void updateStatistics();
@@ -252,6 +396,9 @@ private:
     bool executeParallelFlow(const std::string& wafer_name);
     bool executePipelineFlow(const std::string& wafer_name);
     bool executeBatchFlow(const std::string& wafer_name);
+    std::vector<bool> executeBatchPipelined(const std::vector<std::pair<std::string, std::string>>& batch);
+    std::vector<bool> executeBatchDistributed(DistributedBatchExecutor& executor,
+                                              const std::vector<std::pair<std::string, std::string>>& batch);
     
     // Process step execution
     bool executeOxidationStep(const ProcessStepDefinition& step, const std::string& wafer_name);
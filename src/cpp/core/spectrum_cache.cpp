@@ -0,0 +1,99 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "spectrum_cache.hpp"
+#include "profiler.hpp"
+#include <utility>
+
+namespace {
+
+std::size_t entryBytes(const std::vector<SpectrumCache::Spectrum>& spectra) {
+  std::size_t bytes = 0;
+  for (const auto& spectrum : spectra) {
+    bytes += spectrum.size() * sizeof(FftBackend::Complex);
+  }
+  return bytes;
+}
+
+} // namespace
+
+SpectrumCache& SpectrumCache::instance() {
+  // Never destroyed, so exposures running during static destruction stay valid
+  static SpectrumCache* cache = new SpectrumCache();
+  return *cache;
+}
+
+SpectrumCache::SpectrumCache(std::size_t memory_budget) : memory_budget_(memory_budget) {}
+
+SpectrumCache::Entry SpectrumCache::get(const SemiPRO::CacheKey& key, const std::string& kind,
+                                        const std::function<std::vector<Spectrum>()>& compute) {
+  Entry found;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = slots_.find(key);
+    if (it != slots_.end()) {
+      ++hits_;
+      lru_.splice(lru_.begin(), lru_, it->second.lru);
+      found = it->second.entry;
+    } else {
+      ++misses_;
+    }
+  }
+  Profiler::getInstance().recordCacheAccess("SpectrumCache/" + kind, found != nullptr);
+  if (found) {
+    return found;
+  }
+
+  auto entry = std::make_shared<const std::vector<Spectrum>>(compute());
+  const std::size_t bytes = entryBytes(*entry);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = slots_.find(key);
+  if (it != slots_.end()) {
+    return it->second.entry;
+  }
+  if (bytes > memory_budget_) {
+    return entry;
+  }
+  lru_.push_front(key);
+  slots_.emplace(key, Slot{entry, bytes, lru_.begin()});
+  bytes_ += bytes;
+  trim();
+  return entry;
+}
+
+void SpectrumCache::setMemoryBudget(std::size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  memory_budget_ = bytes;
+  trim();
+}
+
+std::size_t SpectrumCache::memoryBudget() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return memory_budget_;
+}
+
+SpectrumCache::Statistics SpectrumCache::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Statistics statistics;
+  statistics.hits = hits_;
+  statistics.misses = misses_;
+  statistics.entries = slots_.size();
+  statistics.bytes = bytes_;
+  return statistics;
+}
+
+void SpectrumCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  slots_.clear();
+  lru_.clear();
+  bytes_ = 0;
+  hits_ = 0;
+  misses_ = 0;
+}
+
+void SpectrumCache::trim() {
+  while (bytes_ > memory_budget_ && !lru_.empty()) {
+    auto it = slots_.find(lru_.back());
+    bytes_ -= it->second.bytes;
+    slots_.erase(it);
+    lru_.pop_back();
+  }
+}
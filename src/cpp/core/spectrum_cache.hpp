@@ -0,0 +1,69 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef SPECTRUM_CACHE_HPP
+#define SPECTRUM_CACHE_HPP
+
+#include "fft.hpp"
+#include "performance_utils.hpp"
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide cache of transformed masks and optical kernels.
+//
+// The same reticles image on every wafer of a lot, so their spectra and
+// the kernels they are multiplied with are kept across exposures, models
+// and engines. Entries are keyed by a content hash of what was
+// transformed together with the padded grid and FFT backend, and are
+// evicted least recently used first once they exceed the memory budget.
+// Hits and misses go to the profiler as SpectrumCache/<kind>.
+class SpectrumCache {
+public:
+  using Spectrum = std::vector<FftBackend::Complex>;
+  using Entry = std::shared_ptr<const std::vector<Spectrum>>;
+
+  struct Statistics {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+    double hitRate() const { return hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0; }
+  };
+
+  static SpectrumCache& instance();
+  explicit SpectrumCache(std::size_t memory_budget = 512u << 20);
+
+  // The spectra stored under key, computed on a miss. An entry larger
+  // than the budget is returned without being kept. Threads missing the
+  // same key at once each compute it; the first stored wins.
+  Entry get(const SemiPRO::CacheKey& key, const std::string& kind,
+            const std::function<std::vector<Spectrum>()>& compute);
+
+  void setMemoryBudget(std::size_t bytes);
+  std::size_t memoryBudget() const;
+  Statistics statistics() const;
+  void clear();
+
+private:
+  struct Slot {
+    Entry entry;
+    std::size_t bytes;
+    std::list<SemiPRO::CacheKey>::iterator lru;
+  };
+
+  void trim(); // Caller holds mutex_
+
+  mutable std::mutex mutex_;
+  std::size_t memory_budget_;
+  std::size_t bytes_ = 0;
+  std::size_t hits_ = 0;
+  std::size_t misses_ = 0;
+  std::list<SemiPRO::CacheKey> lru_; // Most recently used first
+  std::unordered_map<SemiPRO::CacheKey, Slot, SemiPRO::CacheKeyHash> slots_;
+};
+
+#endif // SPECTRUM_CACHE_HPP
@@ -0,0 +1,146 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "state_history.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+
+namespace {
+
+constexpr std::size_t kWord = sizeof(double);
+
+std::vector<unsigned char> shuffle(const std::vector<unsigned char>& in) {
+    std::vector<unsigned char> out(in.size());
+    const std::size_t words = in.size() / kWord;
+    for (std::size_t w = 0; w < words; ++w) {
+        for (std::size_t k = 0; k < kWord; ++k) {
+            out[k * words + w] = in[w * kWord + k];
+        }
+    }
+    std::copy(in.begin() + words * kWord, in.end(), out.begin() + words * kWord);
+    return out;
+}
+
+std::vector<unsigned char> unshuffle(const std::vector<unsigned char>& in) {
+    std::vector<unsigned char> out(in.size());
+    const std::size_t words = in.size() / kWord;
+    for (std::size_t w = 0; w < words; ++w) {
+        for (std::size_t k = 0; k < kWord; ++k) {
+            out[w * kWord + k] = in[k * words + w];
+        }
+    }
+    std::copy(in.begin() + words * kWord, in.end(), out.begin() + words * kWord);
+    return out;
+}
+
+// data ^= base, base being zero past its end
+void xorInto(std::vector<unsigned char>& data, const std::vector<unsigned char>& base) {
+    const std::size_t shared = std::min(data.size(), base.size());
+    for (std::size_t i = 0; i < shared; ++i) {
+        data[i] ^= base[i];
+    }
+}
+
+} // namespace
+
+StateHistory::StateHistory(std::size_t keyframe_interval, int compression_level)
+    : keyframe_interval_(std::max<std::size_t>(keyframe_interval, 1)),
+      compression_level_(std::min(std::max(compression_level, 1), 9)) {}
+
+void StateHistory::append(const std::vector<unsigned char>& image) {
+    Entry entry;
+    entry.keyframe = entries_.size() % keyframe_interval_ == 0;
+    entry.size = image.size();
+
+    std::vector<unsigned char> payload = image;
+    if (!entry.keyframe) {
+        xorInto(payload, last_);
+    }
+    const std::vector<unsigned char> shuffled = shuffle(payload);
+    uLongf packed_bytes = compressBound(static_cast<uLong>(shuffled.size()));
+    entry.packed.resize(packed_bytes);
+    if (compress2(entry.packed.data(), &packed_bytes, shuffled.data(), static_cast<uLong>(shuffled.size()),
+                  compression_level_) != Z_OK) {
+        throw std::runtime_error("zlib failed to compress a state history entry");
+    }
+    entry.packed.resize(packed_bytes);
+    entry.packed.shrink_to_fit();
+
+    raw_bytes_ += entry.size;
+    stored_bytes_ += entry.packed.size();
+    entries_.push_back(std::move(entry));
+    last_ = image;
+}
+
+std::vector<unsigned char> StateHistory::decode(const Entry& entry) const {
+    std::vector<unsigned char> shuffled(static_cast<std::size_t>(entry.size));
+    uLongf unpacked_bytes = static_cast<uLongf>(shuffled.size());
+    if (uncompress(shuffled.data(), &unpacked_bytes, entry.packed.data(), static_cast<uLong>(entry.packed.size())) !=
+            Z_OK ||
+        unpacked_bytes != shuffled.size()) {
+        throw std::runtime_error("State history entry is corrupt");
+    }
+    return unshuffle(shuffled);
+}
+
+std::vector<unsigned char> StateHistory::at(std::size_t index) const {
+    if (index >= entries_.size()) {
+        throw std::out_of_range("State history has no entry " + std::to_string(index));
+    }
+    return index + 1 == entries_.size() ? last_ : reconstruct(index);
+}
+
+std::vector<unsigned char> StateHistory::reconstruct(std::size_t index) const {
+    std::size_t keyframe = index - index % keyframe_interval_;
+    std::vector<unsigned char> image = decode(entries_[keyframe]);
+    for (std::size_t i = keyframe + 1; i <= index; ++i) {
+        std::vector<unsigned char> next = decode(entries_[i]);
+        xorInto(next, image);
+        image = std::move(next);
+    }
+    return image;
+}
+
+void StateHistory::clear() {
+    entries_.clear();
+    last_.clear();
+    raw_bytes_ = 0;
+    stored_bytes_ = 0;
+}
+
+void StateHistory::write(CheckpointWriter& out) const {
+    out.write(static_cast<std::uint64_t>(keyframe_interval_));
+    out.write(static_cast<std::uint64_t>(entries_.size()));
+    for (const auto& entry : entries_) {
+        out.write(static_cast<std::uint8_t>(entry.keyframe));
+        out.write(entry.size);
+        out.write(static_cast<std::uint64_t>(entry.packed.size()));
+        out.writeBytes(entry.packed.data(), entry.packed.size());
+    }
+}
+
+void StateHistory::read(CheckpointReader::Cursor& in) {
+    StateHistory history(static_cast<std::size_t>(in.read<std::uint64_t>()), compression_level_);
+    const auto count = in.read<std::uint64_t>();
+    for (std::uint64_t i = 0; i < count; ++i) {
+        Entry entry;
+        entry.keyframe = in.read<std::uint8_t>() != 0;
+        entry.size = in.read<std::uint64_t>();
+        const auto packed_bytes = in.read<std::uint64_t>();
+        if (packed_bytes > entry.size + entry.size / 8 + 1024) {
+            throw std::runtime_error("State history entry is corrupt");
+        }
+        entry.packed.resize(static_cast<std::size_t>(packed_bytes));
+        in.readBytes(entry.packed.data(), entry.packed.size());
+        if (entry.keyframe != (i % history.keyframe_interval_ == 0)) {
+            throw std::runtime_error("State history keyframes are out of place");
+        }
+        history.raw_bytes_ += entry.size;
+        history.stored_bytes_ += entry.packed.size();
+        history.entries_.push_back(std::move(entry));
+    }
+    if (!history.entries_.empty()) {
+        history.last_ = history.reconstruct(history.entries_.size() - 1);
+    }
+    *this = std::move(history);
+}
@@ -0,0 +1,59 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef STATE_HISTORY_HPP
+#define STATE_HISTORY_HPP
+
+#include "checkpoint_io.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compressed sequence of state images, e.g. a wafer's checkpoint image
+// after each process step, with random access to any of them.
+//
+// Every keyframe_interval-th image is stored whole; the others as the XOR
+// against the image before. Simulation steps leave most of the state
+// alone and move the rest by small amounts, so the XOR is mostly zero
+// bytes and shares exponent bytes; it is stored byte-plane shuffled (the
+// k-th bytes of all 8-byte words together) and zlib-compressed. Reading
+// image i decodes at most keyframe_interval entries.
+class StateHistory {
+public:
+    explicit StateHistory(std::size_t keyframe_interval = 16, int compression_level = 1);
+
+    void append(const std::vector<unsigned char>& image);
+    // Throws std::out_of_range past the end
+    std::vector<unsigned char> at(std::size_t index) const;
+
+    std::size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    std::size_t keyframeInterval() const { return keyframe_interval_; }
+    // Sum of the image sizes, and what storing them costs
+    std::uint64_t rawBytes() const { return raw_bytes_; }
+    std::uint64_t storedBytes() const { return stored_bytes_; }
+    void clear();
+
+    // Into / from the currently open checkpoint chunk. read() replaces
+    // the history only once the whole record has been decoded.
+    void write(CheckpointWriter& out) const;
+    void read(CheckpointReader::Cursor& in);
+
+private:
+    struct Entry {
+        bool keyframe;
+        std::uint64_t size;                // Of the image
+        std::vector<unsigned char> packed; // Shuffled, then compressed
+    };
+
+    std::vector<unsigned char> decode(const Entry& entry) const;
+    // From the nearest keyframe, ignoring last_
+    std::vector<unsigned char> reconstruct(std::size_t index) const;
+
+    std::size_t keyframe_interval_;
+    int compression_level_;
+    std::vector<Entry> entries_;
+    std::vector<unsigned char> last_; // The newest image, to XOR the next against
+    std::uint64_t raw_bytes_ = 0;
+    std::uint64_t stored_bytes_ = 0;
+};
+
+#endif // STATE_HISTORY_HPP
@@ -0,0 +1,213 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "stencil.hpp"
+#include "autotuner.hpp"
+#include "memory_manager.hpp"
+#include "task_scheduler.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Rewinds the thread's arena on every way out of a scope
+struct ArenaRewind {
+    SemiPRO::ScratchArena& arena;
+    SemiPRO::ScratchArena::Marker mark;
+    ~ArenaRewind() { arena.release(mark); }
+};
+
+// One cell from its column and the columns either side, rows up and down
+// already clamped
+template <bool Corners>
+inline double stepCell(const ExplicitStencil::Weights& w, const double* centre, const double* west,
+                       const double* east, int i, int up, int down) {
+    const double c = centre[i];
+    double sum = w.north * (centre[up] - c) + w.south * (centre[down] - c) + w.west * (west[i] - c) +
+                 w.east * (east[i] - c);
+    if (Corners) {
+        sum += w.north_west * (west[up] - c) + w.north_east * (east[up] - c) + w.south_west * (west[down] - c) +
+               w.south_east * (east[down] - c);
+    }
+    return c + sum + w.centre * c;
+}
+
+// Blockings the Autotuner chooses among: depth by tile shape, each tile's
+// buffers about the default's size
+struct Blocking {
+    const char* name;
+    int depth;
+    int tile_rows;
+    int tile_cols;
+};
+
+constexpr Blocking kBlockings[] = {
+    {"d2_t128x64", 2, 128, 64},  {"d4_t128x64", 4, 128, 64},  {"d8_t128x64", 8, 128, 64},
+    {"d4_t256x32", 4, 256, 32},  {"d8_t256x32", 8, 256, 32},  {"d4_t64x128", 4, 64, 128},
+    {"d4_t512x64", 4, 512, 64},  {"d8_t512x64", 8, 512, 64},
+};
+
+// Steps a variant is timed on; every depth divides it
+constexpr int kTuningSteps = 8;
+
+} // namespace
+
+ExplicitStencil::Weights ExplicitStencil::diffusion(double ratio) {
+    Weights weights;
+    weights.north = weights.south = weights.west = weights.east = ratio;
+    return weights;
+}
+
+ExplicitStencil::ExplicitStencil(const Weights& weights, Edges edges)
+    : weights_(weights), edges_(edges),
+      corners_(weights.north_west != 0.0 || weights.north_east != 0.0 || weights.south_west != 0.0 ||
+               weights.south_east != 0.0) {}
+
+void ExplicitStencil::setBlocking(int depth, int tile_rows, int tile_cols) {
+    if (depth <= 0 || tile_rows <= 0 || tile_cols <= 0) {
+        throw std::invalid_argument("Stencil blocking depth and tile shape must be positive");
+    }
+    depth_ = depth;
+    tile_rows_ = tile_rows;
+    tile_cols_ = tile_cols;
+    blocking_set_ = true;
+}
+
+ExplicitStencil ExplicitStencil::tuned(double* data, int rows, int cols) const {
+    const std::size_t cells = static_cast<std::size_t>(rows) * cols;
+    const std::string kernel = corners_ ? "stencil9" : "stencil5";
+    auto& tuner = SemiPRO::Autotuner::getInstance();
+    std::string name = tuner.lookup(kernel, cells);
+    if (name.empty() && tuner.isEnabled()) {
+        // Timed on a copy, so the field is untouched
+        std::vector<double> scratch(data, data + cells);
+        std::vector<SemiPRO::Autotuner::Variant> variants;
+        for (const auto& blocking : kBlockings) {
+            variants.push_back({blocking.name, [&, blocking] {
+                ExplicitStencil candidate(*this);
+                candidate.setBlocking(blocking.depth, blocking.tile_rows, blocking.tile_cols);
+                candidate.apply(scratch.data(), rows, cols, kTuningSteps);
+            }});
+        }
+        name = tuner.select(kernel, cells, variants);
+    }
+    ExplicitStencil stencil(*this);
+    for (const auto& blocking : kBlockings) {
+        if (name == blocking.name) {
+            stencil.setBlocking(blocking.depth, blocking.tile_rows, blocking.tile_cols);
+            return stencil;
+        }
+    }
+    // Untuned, or a choice from a build with other blockings
+    stencil.blocking_set_ = true;
+    return stencil;
+}
+
+void ExplicitStencil::apply(double* data, int rows, int cols, int steps) const {
+    if (steps <= 0 || rows <= 0 || cols <= 0) {
+        return;
+    }
+    if (!blocking_set_ && steps > 1 && static_cast<std::size_t>(rows) * cols >= static_cast<std::size_t>(kTunedCells)) {
+        tuned(data, rows, cols).apply(data, rows, cols, steps);
+        return;
+    }
+    const int tiles = ((rows + tile_rows_ - 1) / tile_rows_) * ((cols + tile_cols_ - 1) / tile_cols_);
+    SemiPRO::ScratchArena& arena = SemiPRO::ScratchArena::forThread();
+    ArenaRewind rewind{arena, arena.mark()};
+    // One tile reads the whole field before it writes, so it steps in
+    // place; otherwise passes alternate between the field and a copy
+    const std::size_t cells = static_cast<std::size_t>(rows) * cols;
+    double* buffers[2] = {data, tiles == 1 ? data : arena.allocateArray<double>(cells)};
+    const int depth = tiles == 1 ? steps : depth_;
+    int current = 0;
+    for (int done = 0; done < steps; done += depth) {
+        const int pass = std::min(depth, steps - done);
+        const double* in = buffers[current];
+        double* out = buffers[1 - current];
+        TaskScheduler::getInstance().parallelFor(0, tiles, [&](int first, int last) {
+            for (int t = first; t < last; ++t) {
+                if (corners_) {
+                    stepTile<true>(in, out, rows, cols, t, pass);
+                } else {
+                    stepTile<false>(in, out, rows, cols, t, pass);
+                }
+            }
+        }, 1);
+        current = 1 - current;
+    }
+    if (buffers[current] != data) {
+        std::copy(buffers[current], buffers[current] + cells, data);
+    }
+}
+
+template <bool Corners>
+void ExplicitStencil::stepTile(const double* in, double* out, int rows, int cols, int tile, int steps) const {
+    const int tiles_down = (rows + tile_rows_ - 1) / tile_rows_;
+    const int r0 = (tile % tiles_down) * tile_rows_;
+    const int r1 = std::min(rows, r0 + tile_rows_);
+    const int c0 = (tile / tiles_down) * tile_cols_;
+    const int c1 = std::min(cols, c0 + tile_cols_);
+    // The tile and its ghost cells, clipped to the field
+    const int g0 = std::max(0, r0 - steps);
+    const int g1 = std::min(rows, r1 + steps);
+    const int h0 = std::max(0, c0 - steps);
+    const int h1 = std::min(cols, c1 + steps);
+    const int ld = g1 - g0;
+    const int width = h1 - h0;
+
+    SemiPRO::ScratchArena& arena = SemiPRO::ScratchArena::forThread();
+    ArenaRewind rewind{arena, arena.mark()};
+    const std::size_t cells = static_cast<std::size_t>(ld) * width;
+    double* src = arena.allocateArray<double>(cells);
+    double* dst = arena.allocateArray<double>(cells);
+    for (int j = 0; j < width; ++j) {
+        std::copy(in + static_cast<std::size_t>(h0 + j) * rows + g0,
+                  in + static_cast<std::size_t>(h0 + j) * rows + g1, src + static_cast<std::size_t>(j) * ld);
+    }
+    if (edges_ == Edges::Fixed) {
+        // Edge cells are read from both buffers but never written
+        std::copy(src, src + cells, dst);
+    }
+
+    for (int k = 1; k <= steps; ++k) {
+        // Cells still exact after k steps, in tile coordinates
+        const int reach = steps - k;
+        int i0 = std::max(g0, r0 - reach) - g0;
+        int i1 = std::min(g1, r1 + reach) - g0;
+        int j0 = std::max(h0, c0 - reach) - h0;
+        int j1 = std::min(h1, c1 + reach) - h0;
+        if (edges_ == Edges::Fixed) {
+            i0 = std::max(i0, 1 - g0);
+            i1 = std::min(i1, rows - 1 - g0);
+            j0 = std::max(j0, 1 - h0);
+            j1 = std::min(j1, cols - 1 - h0);
+        }
+        // Neighbours past the tile's buffers only exist on the field's
+        // edge, where clamping makes the cell its own neighbour
+        for (int j = j0; j < j1; ++j) {
+            const double* centre = src + static_cast<std::size_t>(j) * ld;
+            const double* west = src + static_cast<std::size_t>(std::max(j - 1, 0)) * ld;
+            const double* east = src + static_cast<std::size_t>(std::min(j + 1, width - 1)) * ld;
+            double* next = dst + static_cast<std::size_t>(j) * ld;
+            int first = i0;
+            int last = i1;
+            if (first == 0 && first < last) {
+                next[0] = stepCell<Corners>(weights_, centre, west, east, 0, 0, std::min(1, ld - 1));
+                ++first;
+            }
+            if (last == ld && first < last) {
+                next[ld - 1] = stepCell<Corners>(weights_, centre, west, east, ld - 1, ld - 2, ld - 1);
+                --last;
+            }
+            #pragma omp simd
+            for (int i = first; i < last; ++i) {
+                next[i] = stepCell<Corners>(weights_, centre, west, east, i, i - 1, i + 1);
+            }
+        }
+        std::swap(src, dst);
+    }
+
+    for (int j = c0; j < c1; ++j) {
+        const double* column = src + static_cast<std::size_t>(j - h0) * ld;
+        std::copy(column + (r0 - g0), column + (r1 - g0), out + static_cast<std::size_t>(j) * rows + r0);
+    }
+}
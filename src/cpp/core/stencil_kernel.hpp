@@ -0,0 +1,281 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef STENCIL_KERNEL_HPP
+#define STENCIL_KERNEL_HPP
+
+#include "field_precision.hpp"
+#include "task_scheduler.hpp"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Sweeps of linear stencils over column-major fields, put together from
+// compile-time parts:
+//
+//   Stencil::sweep<Stencil::Clamp>(Stencil::Laplacian(), in, out,
+//       [r](double laplacian, double c, int, int) { return c + r * laplacian; });
+//
+// A kernel is a shape, whose taps' offsets are fixed at compile time, and
+// a weight per tap. The kernels below have constexpr weights, so the taps
+// unroll and the weights fold into the loop (a unit weight costs no
+// multiply); Weighted takes weights known only at run time. A boundary
+// policy says where reads past the field's edge land. The epilogue maps each cell's weighted sum (with the
+// cell's own value and position) to what is written, fused into the same
+// loop, so an FTCS update or a scaled Laplacian takes one pass. Sweeps run
+// down columns in row bands, blocks of columns in parallel; away from the
+// edge the loop tests nothing and vectorizes, and only the cells within
+// the stencil's reach of the edge go through the policy.
+//
+// The input may be stored narrower than double (float, a byte mask, see
+// FieldPrecision): taps load the narrow type and the sums are in double,
+// so a float32 field streams half the bytes for the same arithmetic.
+//
+// Multi-step explicit updates belong to ExplicitStencil, which blocks
+// steps in time on the same column-major conventions.
+namespace Stencil {
+
+// A tap, rows down and columns right of the cell
+struct Offset {
+    int di;
+    int dj;
+};
+
+struct FivePoint {
+    static constexpr std::size_t kTaps = 5;
+    static constexpr int kRadius = 1;
+    // Centre, north, south, west, east
+    static constexpr std::array<Offset, kTaps> kOffsets{{{0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}}};
+};
+
+struct NinePoint {
+    static constexpr std::size_t kTaps = 9;
+    static constexpr int kRadius = 1;
+    // FivePoint's taps, then north-west, north-east, south-west, south-east
+    static constexpr std::array<Offset, kTaps> kOffsets{
+        {{0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1}}};
+};
+
+namespace detail {
+
+template <int R>
+constexpr std::array<Offset, (2 * R + 1) * (2 * R + 1)> boxOffsets() {
+    std::array<Offset, (2 * R + 1) * (2 * R + 1)> taps{};
+    std::size_t k = 0;
+    for (int dj = -R; dj <= R; ++dj) {
+        for (int di = -R; di <= R; ++di) {
+            taps[k++] = {di, dj};
+        }
+    }
+    return taps;
+}
+
+} // namespace detail
+
+// Every cell within R rows and columns, column by column
+template <int R>
+struct Box {
+    static constexpr std::size_t kTaps = (2 * R + 1) * (2 * R + 1);
+    static constexpr int kRadius = R;
+    static constexpr std::array<Offset, kTaps> kOffsets = detail::boxOffsets<R>();
+};
+
+template <typename Shape>
+using Weights = std::array<double, Shape::kTaps>;
+
+// Kernels with constexpr weights, in their shape's tap order. The
+// Laplacians are for unit spacing; scale in the epilogue.
+struct Laplacian {
+    using Shape = FivePoint;
+    static constexpr Weights<Shape> kWeights{{-4.0, 1.0, 1.0, 1.0, 1.0}};
+    static constexpr double weight(std::size_t k) { return kWeights[k]; }
+};
+
+// Nine-point, with isotropic leading error
+struct IsotropicLaplacian {
+    using Shape = NinePoint;
+    static constexpr Weights<Shape> kWeights{
+        {-10.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 1.0 / 6.0, 1.0 / 6.0, 1.0 / 6.0, 1.0 / 6.0}};
+    static constexpr double weight(std::size_t k) { return kWeights[k]; }
+};
+
+template <int R>
+struct BoxMean {
+    using Shape = Box<R>;
+    static constexpr double weight(std::size_t) { return 1.0 / static_cast<double>(Shape::kTaps); }
+};
+
+// Any weights, read at run time
+template <typename S>
+struct Weighted {
+    using Shape = S;
+    Weights<S> weights;
+    double weight(std::size_t k) const { return weights[k]; }
+};
+
+// Boundary policies: where a read past the edge of a length-n axis lands.
+// kWritesEdge is false for policies that leave the cells within the
+// stencil's reach of the edge unwritten; kZeroOutside reads zeros there.
+struct Clamp { // Zero flux: the nearest edge cell
+    static constexpr bool kWritesEdge = true;
+    static constexpr bool kZeroOutside = false;
+    static constexpr int resolve(int i, int n) { return i < 0 ? 0 : i >= n ? n - 1 : i; }
+};
+
+struct Periodic {
+    static constexpr bool kWritesEdge = true;
+    static constexpr bool kZeroOutside = false;
+    static constexpr int resolve(int i, int n) { return ((i % n) + n) % n; }
+};
+
+struct Zero { // Dirichlet zero outside the field
+    static constexpr bool kWritesEdge = true;
+    static constexpr bool kZeroOutside = true;
+    static constexpr int resolve(int i, int) { return i; }
+};
+
+struct Hold { // Edge cells keep whatever the output holds
+    static constexpr bool kWritesEdge = false;
+    static constexpr bool kZeroOutside = false;
+    static constexpr int resolve(int i, int) { return i; }
+};
+
+// Writes the weighted sum unchanged
+struct Identity {
+    double operator()(double value, double, int, int) const { return value; }
+};
+
+namespace detail {
+
+constexpr int kBandRows = 512;
+constexpr int kBlockCols = 32;
+
+template <typename Kernel, typename T, std::size_t... K>
+inline double interiorSum(const Kernel& kernel, const std::array<const T*, Kernel::Shape::kTaps>& column, int i,
+                          std::index_sequence<K...>) {
+    using Shape = typename Kernel::Shape;
+    return (... + (kernel.weight(K) * static_cast<double>(column[K][i + Shape::kOffsets[K].di])));
+}
+
+} // namespace detail
+
+// The weighted sum at (i, j) of the rows x cols field at data, leading
+// dimension ld, through the policy; for single cells and the edge
+template <typename Boundary, typename Kernel, typename T>
+double at(const Kernel& kernel, const T* data, Eigen::Index ld, int rows, int cols, int i, int j) {
+    using Shape = typename Kernel::Shape;
+    double sum = 0.0;
+    for (std::size_t k = 0; k < Shape::kTaps; ++k) {
+        int ii = i + Shape::kOffsets[k].di;
+        int jj = j + Shape::kOffsets[k].dj;
+        if (ii < 0 || ii >= rows || jj < 0 || jj >= cols) {
+            if (Boundary::kZeroOutside) {
+                continue;
+            }
+            ii = Boundary::resolve(ii, rows);
+            jj = Boundary::resolve(jj, cols);
+        }
+        sum += kernel.weight(k) * static_cast<double>(data[static_cast<std::size_t>(jj) * ld + ii]);
+    }
+    return sum;
+}
+
+// out(i, j) = epilogue(sum of weight * in(tap), in(i, j), i, j) for every
+// cell the policy writes. in and out are rows x cols with leading
+// dimensions in_ld and out_ld, and must not overlap.
+template <typename Boundary, typename Kernel, typename In, typename Epilogue>
+void sweep(const Kernel& kernel, const In* in, Eigen::Index in_ld, double* out, Eigen::Index out_ld, int rows,
+           int cols, Epilogue&& epilogue) {
+    using Shape = typename Kernel::Shape;
+    constexpr int r = Shape::kRadius;
+    const int row_begin = Boundary::kWritesEdge ? 0 : r;
+    const int row_end = Boundary::kWritesEdge ? rows : rows - r;
+    const int col_begin = Boundary::kWritesEdge ? 0 : r;
+    const int col_end = Boundary::kWritesEdge ? cols : cols - r;
+    if (row_end <= row_begin || col_end <= col_begin) {
+        return;
+    }
+    // Rows where every tap is inside the field
+    const int inner_begin = std::max(row_begin, r);
+    const int inner_end = std::min(row_end, rows - r);
+    const int blocks = (col_end - col_begin + detail::kBlockCols - 1) / detail::kBlockCols;
+    TaskScheduler::getInstance().parallelFor(0, blocks, [&](int first, int last) {
+        const std::vector<In> zeros(Boundary::kZeroOutside ? rows : 0, In(0));
+        const int j_begin = col_begin + first * detail::kBlockCols;
+        const int j_end = std::min(col_end, col_begin + last * detail::kBlockCols);
+        for (int band = row_begin; band < row_end; band += detail::kBandRows) {
+            const int band_end = std::min(row_end, band + detail::kBandRows);
+            for (int j = j_begin; j < j_end; ++j) {
+                // Columns past the edge resolve here, once, so the rows
+                // inside take no tests
+                std::array<const In*, Shape::kTaps> column;
+                for (std::size_t k = 0; k < Shape::kTaps; ++k) {
+                    const int jj = j + Shape::kOffsets[k].dj;
+                    column[k] = jj >= 0 && jj < cols ? in + static_cast<std::size_t>(jj) * in_ld
+                                : Boundary::kZeroOutside ? zeros.data()
+                                                         : in + static_cast<std::size_t>(Boundary::resolve(jj, cols)) *
+                                                                    in_ld;
+                }
+                const In* centre = in + static_cast<std::size_t>(j) * in_ld;
+                double* target = out + static_cast<std::size_t>(j) * out_ld;
+                const auto edge = [&](int i) {
+                    target[i] = epilogue(at<Boundary>(kernel, in, in_ld, rows, cols, i, j),
+                                         static_cast<double>(centre[i]), i, j);
+                };
+                const int fast_begin = std::max(band, inner_begin);
+                const int fast_end = std::min(band_end, inner_end);
+                if (fast_end <= fast_begin) {
+                    for (int i = band; i < band_end; ++i) {
+                        edge(i);
+                    }
+                    continue;
+                }
+                for (int i = band; i < fast_begin; ++i) {
+                    edge(i);
+                }
+                #pragma omp simd
+                for (int i = fast_begin; i < fast_end; ++i) {
+                    target[i] = epilogue(
+                        detail::interiorSum(kernel, column, i, std::make_index_sequence<Shape::kTaps>{}),
+                        static_cast<double>(centre[i]), i, j);
+                }
+                for (int i = fast_end; i < band_end; ++i) {
+                    edge(i);
+                }
+            }
+        }
+    }, 1);
+}
+
+template <typename Boundary, typename Kernel, typename Epilogue = Identity>
+void sweep(const Kernel& kernel, const Eigen::Ref<const Eigen::ArrayXXd>& in, Eigen::Ref<Eigen::ArrayXXd> out,
+           Epilogue&& epilogue = Epilogue()) {
+    if (in.rows() != out.rows() || in.cols() != out.cols()) {
+        throw std::invalid_argument("Stencil input and output shapes differ");
+    }
+    sweep<Boundary>(kernel, in.data(), in.outerStride(), out.data(), out.outerStride(), static_cast<int>(in.rows()),
+                    static_cast<int>(in.cols()), std::forward<Epilogue>(epilogue));
+}
+
+// A field held at reduced precision; a log-encoded one is linear only
+// once decoded, so it is decoded first
+template <typename Boundary, typename Kernel, typename Epilogue = Identity>
+void sweep(const Kernel& kernel, const CompactField& in, Eigen::Ref<Eigen::ArrayXXd> out,
+           Epilogue&& epilogue = Epilogue()) {
+    if (in.rows() != out.rows() || in.cols() != out.cols()) {
+        throw std::invalid_argument("Stencil input and output shapes differ");
+    }
+    if (in.precision() == FieldPrecision::LOG_FLOAT32) {
+        sweep<Boundary>(kernel, in.decode(), out, std::forward<Epilogue>(epilogue));
+        return;
+    }
+    in.visit([&](auto, const auto* cells) {
+        sweep<Boundary>(kernel, cells, in.rows(), out.data(), out.outerStride(), in.rows(), in.cols(), epilogue);
+    });
+}
+
+} // namespace Stencil
+
+#endif // STENCIL_KERNEL_HPP
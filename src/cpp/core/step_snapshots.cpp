@@ -0,0 +1,207 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "step_snapshots.hpp"
+#include "wafer_enhanced.hpp"
+#include <atomic>
+#include <cstdio>
+#include <unistd.h>
+#include <vector>
+
+namespace SemiPRO {
+
+namespace {
+
+// What a snapshot holds once it no longer shares with the live wafer
+size_t stateBytes(const WaferEnhanced& wafer) {
+    size_t bytes = wafer.getFieldStore().arenaBytes();
+    for (const auto& layer : wafer.getLayers()) {
+        bytes += static_cast<size_t>(layer.composition.size()) * sizeof(double);
+    }
+    return bytes;
+}
+
+// Unique across the stores of a process and the processes sharing a
+// spill directory
+std::string spillPath(const std::string& directory) {
+    static std::atomic<std::uint64_t> counter{0};
+    return directory + "/snapshot-" + std::to_string(::getpid()) + "-" + std::to_string(counter++) + ".wafer";
+}
+
+std::shared_ptr<const std::string> spillFile(const std::string& path) {
+    return std::shared_ptr<const std::string>(new std::string(path), [](const std::string* file) {
+        std::remove(file->c_str());
+        delete file;
+    });
+}
+
+} // namespace
+
+StepSnapshotStore::StepSnapshotStore() : StepSnapshotStore(Limits()) {}
+
+StepSnapshotStore::StepSnapshotStore(const Limits& limits) : limits_(limits) {}
+
+void StepSnapshotStore::record(const std::string& execution, size_t step, const WaferEnhanced& wafer) {
+    Entry entry;
+    entry.execution = execution;
+    entry.step = step;
+    entry.wafer = wafer.clone();
+    entry.bytes = stateBytes(*entry.wafer);
+    entry.diameter = wafer.getDiameter();
+    entry.thickness = wafer.getThickness();
+    entry.material = wafer.getMaterialId();
+
+    std::uint64_t serial;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = index_.lower_bound({execution, step});
+             it != index_.end() && it->first.first == execution;) {
+            const std::uint64_t stale = it->second;
+            ++it;
+            erase(stale);
+        }
+        serial = next_serial_++;
+        lru_.push_front(serial);
+        entry.lru = lru_.begin();
+        resident_bytes_ += entry.bytes;
+        entries_.emplace(serial, std::move(entry));
+        index_[{execution, step}] = serial;
+    }
+    enforceBudget(serial);
+}
+
+void StepSnapshotStore::enforceBudget(std::uint64_t keep) {
+    // Victims leave the LRU list and the resident count under the lock but
+    // keep their wafer until the file is written, so restores meanwhile
+    // still find them
+    std::vector<std::pair<std::uint64_t, std::shared_ptr<WaferEnhanced>>> victims;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (resident_bytes_ > limits_.memory_budget && !lru_.empty() && lru_.back() != keep) {
+            const std::uint64_t serial = lru_.back();
+            Entry& entry = entries_.at(serial);
+            lru_.pop_back();
+            entry.lru = lru_.end();
+            resident_bytes_ -= entry.bytes;
+            victims.emplace_back(serial, entry.wafer);
+        }
+    }
+    for (auto& victim : victims) {
+        std::shared_ptr<const std::string> spill;
+        if (!limits_.spill_directory.empty()) {
+            const std::string path = spillPath(limits_.spill_directory);
+            try {
+                victim.second->saveToFile(path);
+                spill = spillFile(path);
+            } catch (const std::exception&) {
+                std::remove(path.c_str()); // Dropped, as without a directory
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(victim.first);
+        if (it == entries_.end() || it->second.wafer != victim.second) {
+            continue; // Forgotten or replaced meanwhile; spill goes with it
+        }
+        if (spill) {
+            it->second.wafer.reset();
+            it->second.spill = std::move(spill);
+            ++spilled_;
+        } else {
+            index_.erase({it->second.execution, it->second.step});
+            entries_.erase(it);
+        }
+    }
+}
+
+std::shared_ptr<WaferEnhanced> StepSnapshotStore::restore(const std::string& execution, size_t step) {
+    std::shared_ptr<const std::string> spill;
+    double diameter;
+    double thickness;
+    std::string material;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = index_.find({execution, step});
+        if (found == index_.end()) {
+            return nullptr;
+        }
+        Entry& entry = entries_.at(found->second);
+        if (entry.wafer) {
+            if (entry.lru != lru_.end()) {
+                lru_.splice(lru_.begin(), lru_, entry.lru);
+            }
+            return entry.wafer->clone();
+        }
+        spill = entry.spill;
+        diameter = entry.diameter;
+        thickness = entry.thickness;
+        material = entry.material;
+    }
+    // Holding spill keeps the file until the load is done
+    auto wafer = std::make_shared<WaferEnhanced>(diameter, thickness, material);
+    wafer->loadFromFile(*spill);
+    return wafer;
+}
+
+long StepSnapshotStore::latest(const std::string& execution, size_t step) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.upper_bound({execution, step});
+    if (it == index_.begin()) {
+        return -1;
+    }
+    --it;
+    return it->first.first == execution ? static_cast<long>(it->first.second) : -1;
+}
+
+void StepSnapshotStore::erase(std::uint64_t serial) {
+    auto it = entries_.find(serial);
+    if (it == entries_.end()) {
+        return;
+    }
+    Entry& entry = it->second;
+    if (entry.wafer && entry.lru != lru_.end()) {
+        lru_.erase(entry.lru);
+        resident_bytes_ -= entry.bytes;
+    }
+    if (entry.spill) {
+        --spilled_;
+    }
+    index_.erase({entry.execution, entry.step});
+    entries_.erase(it);
+}
+
+void StepSnapshotStore::forget(const std::string& execution) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = index_.lower_bound({execution, 0}); it != index_.end() && it->first.first == execution;) {
+        const std::uint64_t serial = it->second;
+        ++it;
+        erase(serial);
+    }
+}
+
+void StepSnapshotStore::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    lru_.clear();
+    resident_bytes_ = 0;
+    spilled_ = 0;
+}
+
+size_t StepSnapshotStore::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+size_t StepSnapshotStore::spilledCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spilled_;
+}
+
+size_t StepSnapshotStore::residentBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return resident_bytes_;
+}
+
+StepSnapshotStore::Limits StepSnapshotStore::getLimits() const {
+    return limits_;
+}
+
+} // namespace SemiPRO
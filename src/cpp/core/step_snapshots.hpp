@@ -0,0 +1,92 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef STEP_SNAPSHOTS_HPP
+#define STEP_SNAPSHOTS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+class WaferEnhanced;
+
+namespace SemiPRO {
+
+// Wafer states at the step boundaries of workflow executions, so a retry
+// or a what-if run from step K starts from the state after step K - 1
+// instead of running the steps before it again.
+//
+// record() keeps a WaferEnhanced::clone(), which shares its fields and
+// containers with the live wafer until either writes, so a boundary costs
+// O(1) and only what later steps change is ever copied. Each snapshot is
+// charged its full state size against the memory budget, since that is
+// what it holds once the live wafer has moved on. Past the budget, the
+// least recently used snapshots are written to page-aligned checkpoint
+// files in the spill directory and leave memory; restoring one maps its
+// file copy-on-write, so only the fields the resumed steps touch are read.
+// Without a spill directory they are dropped instead. Spill files are
+// removed once their snapshot is forgotten and no restore still reads it.
+class StepSnapshotStore {
+public:
+    struct Limits {
+        size_t memory_budget = size_t(512) << 20; // Bytes of resident snapshots
+        std::string spill_directory;              // "" drops rather than spills
+    };
+
+    StepSnapshotStore();
+    explicit StepSnapshotStore(const Limits& limits);
+    StepSnapshotStore(const StepSnapshotStore&) = delete;
+    StepSnapshotStore& operator=(const StepSnapshotStore&) = delete;
+
+    // The wafer after step `step` (its 0-based position in the workflow)
+    // of an execution. Replaces any snapshot of that step and forgets
+    // those of later steps, which followed from another past.
+    void record(const std::string& execution, size_t step, const WaferEnhanced& wafer);
+    // A wafer of its own in the state recorded after the step, or null if
+    // none is kept
+    std::shared_ptr<WaferEnhanced> restore(const std::string& execution, size_t step);
+    // The last step at or before `step` with a snapshot, -1 if none
+    long latest(const std::string& execution, size_t step) const;
+    void forget(const std::string& execution);
+    void clear();
+
+    size_t size() const;
+    size_t spilledCount() const;
+    size_t residentBytes() const;
+    Limits getLimits() const;
+
+private:
+    struct Entry {
+        std::string execution;
+        size_t step;
+        std::shared_ptr<WaferEnhanced> wafer; // Null once spilled
+        std::shared_ptr<const std::string> spill; // Removes the file when the last holder lets go
+        size_t bytes;
+        double diameter;
+        double thickness;
+        std::string material;
+        std::list<std::uint64_t>::iterator lru;
+    };
+
+    void erase(std::uint64_t serial);
+    // Spills or drops the least recently used snapshots past the budget,
+    // except `keep`; the files are written without holding the lock
+    void enforceBudget(std::uint64_t keep);
+
+    Limits limits_;
+    mutable std::mutex mutex_;
+    std::uint64_t next_serial_ = 0;
+    std::unordered_map<std::uint64_t, Entry> entries_;
+    std::map<std::pair<std::string, size_t>, std::uint64_t> index_;
+    std::list<std::uint64_t> lru_; // Resident snapshots, most recently used first
+    size_t resident_bytes_ = 0;
+    size_t spilled_ = 0;
+};
+
+} // namespace SemiPRO
+
+#endif // STEP_SNAPSHOTS_HPP
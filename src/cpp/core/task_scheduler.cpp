@@ -0,0 +1,241 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "task_scheduler.hpp"
+#include "telemetry.hpp"
+#include <algorithm>
+#include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+// Pool and deque index of the calling worker thread
+thread_local const TaskScheduler* tls_scheduler = nullptr;
+thread_local size_t tls_worker = 0;
+
+} // namespace
+
+TaskScheduler& TaskScheduler::getInstance() {
+    // Leaked so tasks still running during static destruction stay valid
+    static TaskScheduler* instance = [] {
+        auto* scheduler = new TaskScheduler();
+        auto& metrics = SemiPRO::MetricsRegistry::getInstance();
+        metrics.gaugeCallback("semipro_scheduler_queued_tasks", "Tasks waiting for a worker of the shared pool",
+                              [scheduler] { return static_cast<double>(scheduler->queuedTasks()); });
+        metrics.gaugeCallback("semipro_scheduler_threads", "Workers of the shared pool",
+                              [scheduler] { return static_cast<double>(scheduler->threadCount()); });
+        return scheduler;
+    }();
+    return *instance;
+}
+
+TaskScheduler::TaskScheduler(int thread_count) {
+    startWorkers(thread_count);
+}
+
+TaskScheduler::~TaskScheduler() {
+    stopWorkers();
+}
+
+bool TaskScheduler::isWorkerThread() const {
+    return tls_scheduler == this;
+}
+
+void TaskScheduler::resize(int thread_count) {
+    if (isWorkerThread()) {
+        throw std::logic_error("TaskScheduler cannot be resized from one of its workers");
+    }
+    std::lock_guard<std::mutex> lock(resize_mutex_);
+    stopWorkers();
+    startWorkers(thread_count);
+}
+
+void TaskScheduler::startWorkers(int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    thread_count = std::max(1, thread_count);
+
+    stopping_ = false;
+    workers_.clear();
+    for (int i = 0; i < thread_count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    // Threads start only once every deque exists, since they steal from all
+    for (int i = 0; i < thread_count; ++i) {
+        workers_[i]->thread = std::thread(&TaskScheduler::workerLoop, this, static_cast<size_t>(i));
+    }
+    thread_count_ = thread_count;
+}
+
+void TaskScheduler::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    // Tasks nobody got to are handed to the next set of workers
+    std::lock_guard<std::mutex> lock(injection_mutex_);
+    for (auto& worker : workers_) {
+        for (auto& task : worker->tasks) {
+            injection_.push_back(std::move(task));
+        }
+        worker->tasks.clear();
+    }
+}
+
+void TaskScheduler::enqueue(Task task) {
+    if (isWorkerThread()) {
+        Worker& self = *workers_[tls_worker];
+        std::lock_guard<std::mutex> lock(self.mutex);
+        self.tasks.push_back(std::move(task));
+    } else {
+        std::lock_guard<std::mutex> lock(injection_mutex_);
+        injection_.push_back(std::move(task));
+    }
+    // Pairs with the sleeper's increment of sleeping_ before it re-reads
+    // pending_: one of the two always sees the other's update.
+    pending_.fetch_add(1);
+    if (sleeping_.load() > 0) {
+        { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+        wake_.notify_one();
+    }
+}
+
+bool TaskScheduler::popTask(size_t self, Task& task) {
+    if (self < workers_.size()) {
+        Worker& worker = *workers_[self];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            pending_.fetch_sub(1);
+            return true;
+        }
+    }
+    std::lock_guard<std::mutex> lock(injection_mutex_);
+    if (injection_.empty()) {
+        return false;
+    }
+    task = std::move(injection_.front());
+    injection_.pop_front();
+    pending_.fetch_sub(1);
+    return true;
+}
+
+bool TaskScheduler::stealTask(size_t self, Task& task) {
+    const size_t count = workers_.size();
+    for (size_t offset = 1; offset <= count; ++offset) {
+        Worker& victim = *workers_[(self + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending_.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskScheduler::runPendingTask() {
+    Task task;
+    if (isWorkerThread()) {
+        if (!popTask(tls_worker, task) && !stealTask(tls_worker, task)) {
+            return false;
+        }
+    } else {
+        // Outside threads help from the injection queue, then steal; the
+        // resize lock keeps the worker set stable meanwhile
+        std::unique_lock<std::mutex> lock(resize_mutex_, std::try_to_lock);
+        if (!lock.owns_lock() || (!popTask(workers_.size(), task) && !stealTask(0, task))) {
+            return false;
+        }
+    }
+    task();
+    return true;
+}
+
+void TaskScheduler::workerLoop(size_t index) {
+    tls_scheduler = this;
+    tls_worker = index;
+#ifdef _OPENMP
+    omp_set_num_threads(1);
+#endif
+
+    // Stops between tasks; whatever is still queued is migrated by stopWorkers
+    while (!stopping_) {
+        Task task;
+        if (popTask(index, task) || stealTask(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleeping_.fetch_add(1);
+        wake_.wait(lock, [this] { return stopping_ || pending_.load() > 0; });
+        sleeping_.fetch_sub(1);
+    }
+    tls_scheduler = nullptr;
+}
+
+void TaskScheduler::parallelFor(int begin, int end, const std::function<void(int, int)>& body, int grain) {
+    const int n = end - begin;
+    if (n <= 0) {
+        return;
+    }
+    if (grain <= 0) {
+        grain = std::max(1, n / (4 * threadCount()));
+    }
+    const int chunks = (n + grain - 1) / grain;
+    if (chunks == 1) {
+        body(begin, end);
+        return;
+    }
+
+    // Helpers claim chunks from a shared counter. One that starts after
+    // every chunk is claimed returns without touching `body`, so the loop
+    // may return while such helpers are still queued.
+    struct Loop {
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+    };
+    auto loop = std::make_shared<Loop>();
+    const std::function<void(int, int)>* fn = &body;
+    auto work = [loop, fn, begin, end, grain, chunks]() {
+        for (int c = loop->next.fetch_add(1); c < chunks; c = loop->next.fetch_add(1)) {
+            const int lo = begin + c * grain;
+            try {
+                (*fn)(lo, std::min(end, lo + grain));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(loop->error_mutex);
+                if (!loop->error) {
+                    loop->error = std::current_exception();
+                }
+            }
+            loop->done.fetch_add(1);
+        }
+    };
+
+    const int helpers = std::min(chunks - 1, threadCount());
+    for (int i = 0; i < helpers; ++i) {
+        enqueue(work);
+    }
+    // Once the caller runs out of chunks, the rest are already running on
+    // other threads. It waits for them without picking up unrelated tasks,
+    // which could need a lock the caller holds around the loop.
+    work();
+    while (loop->done.load() < chunks) {
+        std::this_thread::yield();
+    }
+    if (loop->error) {
+        std::rethrow_exception(loop->error);
+    }
+}
@@ -0,0 +1,109 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef TASK_SCHEDULER_HPP
+#define TASK_SCHEDULER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Persistent work-stealing thread pool shared by batch processing,
+// orchestrator steps and parallel loops inside a step.
+//
+// Every worker owns a deque: tasks it spawns go to the back and it pops
+// from the back, so nested work stays on the spawning thread's cache,
+// while idle workers steal from the front of other deques. Tasks from
+// threads outside the pool enter through a shared injection queue.
+// Waiting on a future through wait() or parallelFor() runs queued tasks
+// instead of blocking, so tasks may spawn and wait on subtasks even on a
+// single-thread pool. Workers limit OpenMP to one thread, so OpenMP
+// regions inside tasks run inline rather than oversubscribing the cores.
+class TaskScheduler {
+public:
+    static TaskScheduler& getInstance();
+
+    // thread_count <= 0 uses the hardware concurrency
+    explicit TaskScheduler(int thread_count = 0);
+    ~TaskScheduler();
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Restarts the workers; tasks still queued are kept. Throws
+    // std::logic_error when called from one of this pool's workers.
+    void resize(int thread_count);
+    int threadCount() const { return thread_count_.load(std::memory_order_relaxed); }
+    // Tasks submitted and not yet started
+    long long queuedTasks() const { return std::max(pending_.load(std::memory_order_relaxed), 0LL); }
+    bool isWorkerThread() const;
+
+    template <typename F>
+    auto submit(F&& fn) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(fn));
+        std::future<Result> result = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return result;
+    }
+
+    // Runs queued tasks until the future is ready, then returns its value
+    template <typename T>
+    T wait(std::future<T>& future) {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!runPendingTask()) {
+                future.wait_for(std::chrono::microseconds(100));
+            }
+        }
+        return future.get();
+    }
+
+    // Calls body(chunk_begin, chunk_end) over [begin, end) split into
+    // chunks of `grain` indices (0 picks about four chunks per thread).
+    // The caller works on chunks too and never runs unrelated tasks, so it
+    // may hold locks around the loop. The first exception thrown by a chunk
+    // is rethrown once all chunks have finished.
+    void parallelFor(int begin, int end, const std::function<void(int, int)>& body, int grain = 0);
+
+    // Runs one queued task on the calling thread; false if none was found
+    bool runPendingTask();
+
+private:
+    using Task = std::function<void()>;
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void enqueue(Task task);
+    bool popTask(size_t self, Task& task);
+    bool stealTask(size_t self, Task& task);
+    void workerLoop(size_t index);
+    void startWorkers(int thread_count);
+    void stopWorkers();
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex injection_mutex_;
+    std::deque<Task> injection_;
+
+    // Queued task count; sleepers wait on it under sleep_mutex_. A pop may
+    // briefly run ahead of the matching push's increment, hence signed.
+    std::atomic<long long> pending_{0};
+    std::atomic<int> sleeping_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> stopping_{false};
+
+    std::atomic<int> thread_count_{0};
+    std::mutex resize_mutex_;
+};
+
+#endif // TASK_SCHEDULER_HPP
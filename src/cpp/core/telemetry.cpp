@@ -0,0 +1,385 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "telemetry.hpp"
+#include "json_value.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace SemiPRO {
+
+namespace {
+
+std::string escapeLabelValue(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '"': escaped += "\\\""; break;
+            case '\n': escaped += "\\n"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// {a="1",b="2"} with an optional extra label last; "" for no labels
+std::string labelText(const MetricLabels& labels, const std::string& extra_name = "",
+                      const std::string& extra_value = "") {
+    if (labels.empty() && extra_name.empty()) {
+        return "";
+    }
+    std::string text = "{";
+    for (const auto& [name, value] : labels) {
+        text += name + "=\"" + escapeLabelValue(value) + "\",";
+    }
+    if (!extra_name.empty()) {
+        text += extra_name + "=\"" + extra_value + "\",";
+    }
+    text.back() = '}';
+    return text;
+}
+
+std::string formatValue(double value) {
+    if (std::isnan(value)) {
+        return "NaN";
+    }
+    if (std::isinf(value)) {
+        return value > 0 ? "+Inf" : "-Inf";
+    }
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return std::string(buffer, result.ptr);
+}
+
+// Prometheus bucket bounds in seconds: 1, 2.5 and 5 per decade, 1 us to 1000 s
+const std::vector<double>& bucketBounds() {
+    static const std::vector<double> bounds = [] {
+        std::vector<double> b;
+        for (int exponent = -6; exponent <= 2; ++exponent) {
+            // Powers of ten are exact, so dividing by one rounds once and
+            // the bounds print as 2.5e-06 rather than 2.4999999999999998e-06
+            const double power = std::pow(10.0, std::abs(exponent));
+            for (double mantissa : {1.0, 2.5, 5.0}) {
+                b.push_back(exponent < 0 ? mantissa / power : mantissa * power);
+            }
+        }
+        b.push_back(1000.0);
+        return b;
+    }();
+    return bounds;
+}
+
+std::uint64_t nextId() {
+    // splitmix64 from a per-thread random start; zero means "no span"
+    thread_local std::uint64_t state = std::random_device{}() ^
+        (static_cast<std::uint64_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) << 32);
+    std::uint64_t id;
+    do {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        id = z ^ (z >> 31);
+    } while (id == 0);
+    return id;
+}
+
+thread_local TraceContext::Ids current_span;
+
+std::string hexId(std::uint64_t id, int digits) {
+    char buffer[40];
+    std::snprintf(buffer, sizeof(buffer), "%0*llx", digits, static_cast<unsigned long long>(id));
+    return buffer;
+}
+
+} // namespace
+
+void MetricGauge::add(double delta) {
+    double current = value_.load(std::memory_order_relaxed);
+    while (!value_.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+    }
+}
+
+std::size_t LatencyHistogram::bucketOf(std::uint64_t ns) {
+    if (ns < kSubBuckets) {
+        return static_cast<std::size_t>(ns);
+    }
+    const int exponent = 63 - __builtin_clzll(ns);
+    return static_cast<std::size_t>(exponent - kSubBucketBits + 1) * kSubBuckets +
+           static_cast<std::size_t>((ns >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+}
+
+std::uint64_t LatencyHistogram::bucketUpperNs(std::size_t bucket) {
+    if (bucket + 1 >= kBuckets) {
+        return UINT64_MAX;
+    }
+    const std::size_t next = bucket + 1;
+    if (next < kSubBuckets) {
+        return next - 1;
+    }
+    const std::size_t group = next / kSubBuckets;
+    const std::uint64_t lower = static_cast<std::uint64_t>(kSubBuckets + next % kSubBuckets) << (group - 1);
+    return lower - 1;
+}
+
+void LatencyHistogram::observe(double seconds) {
+    const double ns = seconds * 1e9;
+    observeNs(ns <= 0.0 ? 0 : ns >= 1.8e19 ? UINT64_MAX : static_cast<std::uint64_t>(ns));
+}
+
+void LatencyHistogram::observeNs(std::uint64_t ns) {
+    buckets_[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::quantile(double q) const {
+    std::uint64_t total = 0;
+    for (const auto& bucket : buckets_) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0.0;
+    }
+    const auto rank = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(total))));
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+        seen += buckets_[b].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return bucketUpperNs(b) * 1e-9;
+        }
+    }
+    return bucketUpperNs(kBuckets - 1) * 1e-9;
+}
+
+std::uint64_t LatencyHistogram::countAtOrBelow(double seconds) const {
+    const double limit = seconds * 1e9;
+    std::uint64_t count = 0;
+    for (std::size_t b = 0; b < kBuckets && static_cast<double>(bucketUpperNs(b)) <= limit; ++b) {
+        count += buckets_[b].load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+MetricsRegistry& MetricsRegistry::getInstance() {
+    // Never destroyed, so series held by other singletons stay valid
+    static MetricsRegistry* instance = new MetricsRegistry();
+    return *instance;
+}
+
+MetricsRegistry::Series& MetricsRegistry::series(const std::string& name, const std::string& help, Type type,
+                                                 const MetricLabels& labels) {
+    auto family = families_.find(name);
+    if (family == families_.end()) {
+        family = families_.emplace(name, Family{type, help, {}}).first;
+    } else if (family->second.type != type) {
+        throw std::invalid_argument("Metric " + name + " is registered with another type");
+    }
+    auto [it, inserted] = family->second.series.try_emplace(labelText(labels));
+    if (inserted) {
+        it->second.labels = labels;
+    }
+    return it->second;
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string& name, const std::string& help,
+                                        const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& s = series(name, help, Type::Counter, labels);
+    if (!s.counter) {
+        s.counter = std::make_unique<MetricCounter>();
+    }
+    return *s.counter;
+}
+
+MetricGauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& s = series(name, help, Type::Gauge, labels);
+    if (!s.gauge) {
+        s.gauge = std::make_unique<MetricGauge>();
+    }
+    return *s.gauge;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                             const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& s = series(name, help, Type::Histogram, labels);
+    if (!s.histogram) {
+        s.histogram = std::make_unique<LatencyHistogram>();
+    }
+    return *s.histogram;
+}
+
+void MetricsRegistry::gaugeCallback(const std::string& name, const std::string& help, std::function<double()> read,
+                                    const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    series(name, help, Type::Gauge, labels).read = std::move(read);
+}
+
+void MetricsRegistry::removeGaugeCallback(const std::string& name, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto family = families_.find(name);
+    if (family == families_.end()) {
+        return;
+    }
+    auto it = family->second.series.find(labelText(labels));
+    if (it != family->second.series.end() && it->second.read) {
+        family->second.series.erase(it);
+    }
+}
+
+std::string MetricsRegistry::prometheusText() const {
+    // Callbacks run without the registry lock, since their owners may
+    // hold locks of their own while registering series
+    std::vector<std::pair<std::string, std::function<double()>>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [name, family] : families_) {
+            for (const auto& [labels, s] : family.series) {
+                if (s.read) {
+                    callbacks.emplace_back(name + labels, s.read);
+                }
+            }
+        }
+    }
+    std::map<std::string, double> read_values;
+    for (const auto& [key, read] : callbacks) {
+        read_values[key] = read();
+    }
+
+    std::string text;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [name, family] : families_) {
+        if (family.series.empty()) {
+            continue;
+        }
+        static const char* const type_names[] = {"counter", "gauge", "histogram"};
+        text += "# HELP " + name + " " + family.help + "\n";
+        text += "# TYPE " + name + " " + type_names[static_cast<int>(family.type)] + "\n";
+        for (const auto& [labels, s] : family.series) {
+            if (s.read) {
+                auto value = read_values.find(name + labels);
+                if (value != read_values.end()) {
+                    text += name + labels + " " + formatValue(value->second) + "\n";
+                }
+            } else if (s.counter) {
+                text += name + labels + " " + std::to_string(s.counter->value()) + "\n";
+            } else if (s.gauge) {
+                text += name + labels + " " + formatValue(s.gauge->value()) + "\n";
+            } else if (s.histogram) {
+                const LatencyHistogram& h = *s.histogram;
+                const std::uint64_t count = h.count();
+                for (double bound : bucketBounds()) {
+                    text += name + "_bucket" + labelText(s.labels, "le", formatValue(bound)) + " " +
+                            std::to_string(std::min(h.countAtOrBelow(bound), count)) + "\n";
+                }
+                text += name + "_bucket" + labelText(s.labels, "le", "+Inf") + " " + std::to_string(count) + "\n";
+                text += name + "_sum" + labels + " " + formatValue(h.sumSeconds()) + "\n";
+                text += name + "_count" + labels + " " + std::to_string(count) + "\n";
+            }
+        }
+    }
+    return text;
+}
+
+TraceContext::Ids TraceContext::open() {
+    Ids span;
+    span.parent_span_id = current_span.span_id;
+    span.trace_id = current_span.trace_id ? current_span.trace_id : nextId();
+    span.span_id = nextId();
+    current_span = {span.trace_id, span.span_id, 0};
+    return span;
+}
+
+void TraceContext::close(const Ids& span) {
+    current_span = {span.parent_span_id ? span.trace_id : 0, span.parent_span_id, 0};
+}
+
+TraceContext::Ids TraceContext::current() {
+    return current_span;
+}
+
+TraceContext::Scope::Scope(const Ids& span) : saved_(current_span) {
+    current_span = {span.trace_id, span.span_id, 0};
+}
+
+TraceContext::Scope::~Scope() {
+    current_span = saved_;
+}
+
+OtlpTraceWriter::OtlpTraceWriter(const std::string& path, const std::string& service_name, std::size_t batch_spans)
+    : out_(path, std::ios::app), service_name_(service_name), batch_spans_(std::max<std::size_t>(batch_spans, 1)) {
+    if (!out_) {
+        throw std::runtime_error("Cannot open trace file: " + path);
+    }
+}
+
+OtlpTraceWriter::~OtlpTraceWriter() {
+    flush();
+}
+
+void OtlpTraceWriter::addSpan(TraceSpan span) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(std::move(span));
+    if (pending_.size() >= batch_spans_) {
+        writeBatch();
+    }
+}
+
+void OtlpTraceWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writeBatch();
+    out_.flush();
+}
+
+void OtlpTraceWriter::writeBatch() {
+    if (pending_.empty()) {
+        return;
+    }
+    std::string line;
+    {
+        JsonWriter json(line);
+        json.beginObject().key("resourceSpans").beginArray().beginObject();
+        json.key("resource").beginObject().key("attributes").beginArray();
+        json.beginObject().key("key").string("service.name");
+        json.key("value").beginObject().key("stringValue").string(service_name_).endObject().endObject();
+        json.endArray().endObject();
+        json.key("scopeSpans").beginArray().beginObject();
+        json.key("scope").beginObject().key("name").string("semipro").endObject();
+        json.key("spans").beginArray();
+        for (const TraceSpan& span : pending_) {
+            json.beginObject();
+            // OTLP/JSON spells ids as hex and 64-bit integers as strings
+            json.key("traceId").string(hexId(span.ids.trace_id, 32));
+            json.key("spanId").string(hexId(span.ids.span_id, 16));
+            if (span.ids.parent_span_id) {
+                json.key("parentSpanId").string(hexId(span.ids.parent_span_id, 16));
+            }
+            json.key("name").string(span.name);
+            json.key("kind").integer(1); // SPAN_KIND_INTERNAL
+            json.key("startTimeUnixNano").string(std::to_string(span.start_unix_ns));
+            json.key("endTimeUnixNano").string(std::to_string(span.end_unix_ns));
+            json.key("attributes").beginArray();
+            for (const auto& [key, value] : span.string_attributes) {
+                json.beginObject().key("key").string(key);
+                json.key("value").beginObject().key("stringValue").string(value).endObject().endObject();
+            }
+            for (const auto& [key, value] : span.number_attributes) {
+                json.beginObject().key("key").string(key);
+                json.key("value").beginObject().key("doubleValue").number(value).endObject().endObject();
+            }
+            json.endArray().endObject();
+        }
+        json.endArray().endObject().endArray().endObject().endArray().endObject();
+    }
+    out_ << line << '\n';
+    pending_.clear();
+}
+
+} // namespace SemiPRO
@@ -0,0 +1,204 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace SemiPRO {
+
+// Label names and values of one series, e.g. {{"process", "oxidation"}}
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+// Monotonic count; add() is one relaxed atomic increment
+class MetricCounter {
+public:
+    void add(std::uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    std::uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> value_{0};
+};
+
+// Value that goes up and down
+class MetricGauge {
+public:
+    void set(double value) { value_.store(value, std::memory_order_relaxed); }
+    void add(double delta);
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+// Lock-free latency histogram in the manner of HdrHistogram.
+//
+// Durations are counted in nanosecond buckets laid out log-linearly: each
+// power of two is split into kSubBuckets equal buckets, so any duration
+// from 1 ns to centuries lands in a bucket within 1/kSubBuckets (about 6%)
+// of its value. Recording is an index computation and two relaxed atomic
+// adds; quantiles and Prometheus buckets are read from the counts.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr std::size_t kSubBuckets = std::size_t(1) << kSubBucketBits;
+    static constexpr std::size_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    void observe(double seconds);
+    void observeNs(std::uint64_t ns);
+
+    std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    double sumSeconds() const { return sum_ns_.load(std::memory_order_relaxed) * 1e-9; }
+    // Upper edge, in seconds, of the bucket holding quantile q in [0, 1];
+    // 0 when empty
+    double quantile(double q) const;
+    // Durations recorded in buckets that end at or below seconds
+    std::uint64_t countAtOrBelow(double seconds) const;
+
+    static std::size_t bucketOf(std::uint64_t ns);
+    // Largest duration counted in the bucket
+    static std::uint64_t bucketUpperNs(std::size_t bucket);
+
+private:
+    std::atomic<std::uint64_t> buckets_[kBuckets] = {};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_ns_{0};
+};
+
+// Process-wide registry of counters, gauges and latency histograms,
+// exposed in the Prometheus text format.
+//
+// A series is looked up by metric name and labels under the registry
+// lock and lives as long as the process, so a hot path keeps the
+// reference it got rather than looking it up per event. Gauges may also be
+// read through a callback at each scrape, for values another component
+// already tracks (queue lengths, memory usage); the owner removes the
+// callback before it goes away. Metric names should follow the Prometheus
+// conventions: semipro_ prefix, base units, _total for counters.
+class MetricsRegistry {
+public:
+    static MetricsRegistry& getInstance();
+
+    // Throw std::invalid_argument if the name is registered with another type
+    MetricCounter& counter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    MetricGauge& gauge(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    LatencyHistogram& histogram(const std::string& name, const std::string& help,
+                                const MetricLabels& labels = {});
+    // Replaces an earlier callback for the same series
+    void gaugeCallback(const std::string& name, const std::string& help, std::function<double()> read,
+                       const MetricLabels& labels = {});
+    void removeGaugeCallback(const std::string& name, const MetricLabels& labels = {});
+
+    // Text exposition format 0.0.4. Histograms are written with
+    // cumulative buckets at 1, 2.5 and 5 times each power of ten from 1 us
+    // to 1000 s.
+    std::string prometheusText() const;
+    static constexpr const char* kPrometheusContentType = "text/plain; version=0.0.4; charset=utf-8";
+
+private:
+    MetricsRegistry() = default;
+
+    enum class Type { Counter, Gauge, Histogram };
+
+    struct Series {
+        MetricLabels labels;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::unique_ptr<LatencyHistogram> histogram;
+        std::function<double()> read;
+    };
+
+    struct Family {
+        Type type;
+        std::string help;
+        std::map<std::string, Series> series; // By label text
+    };
+
+    Series& series(const std::string& name, const std::string& help, Type type, const MetricLabels& labels);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+};
+
+// Span ids of the timed operations open on the calling thread.
+//
+// Each PerformanceTimer opens a span under the innermost one open on its
+// thread, or starts a new trace when none is. Work handed to another
+// thread carries its parent along by capturing current() and adopting it
+// there with a Scope.
+class TraceContext {
+public:
+    struct Ids {
+        std::uint64_t trace_id = 0;
+        std::uint64_t span_id = 0;
+        std::uint64_t parent_span_id = 0;
+    };
+
+    // A new span under the current one, which it then becomes
+    static Ids open();
+    // Makes the span's parent current again; spans close innermost first
+    static void close(const Ids& span);
+    // The innermost open span, zero ids when none is
+    static Ids current();
+
+    // Makes a span captured on another thread current for its lifetime
+    class Scope {
+    public:
+        explicit Scope(const Ids& span);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Ids saved_;
+    };
+};
+
+// One finished span, as sent to an OpenTelemetry collector
+struct TraceSpan {
+    TraceContext::Ids ids;
+    std::string name;
+    std::int64_t start_unix_ns = 0;
+    std::int64_t end_unix_ns = 0;
+    std::vector<std::pair<std::string, std::string>> string_attributes;
+    std::vector<std::pair<std::string, double>> number_attributes;
+};
+
+// Writes spans as OTLP/JSON: each batch is appended to the file as one
+// ExportTraceServiceRequest on its own line, the format the collector's
+// otlpjsonfile receiver reads. Batches of batch_spans are written as they
+// fill; flush() and the destructor write the rest. Thread-safe.
+class OtlpTraceWriter {
+public:
+    // Throws std::runtime_error if the file cannot be opened
+    explicit OtlpTraceWriter(const std::string& path, const std::string& service_name = "semipro",
+                             std::size_t batch_spans = 256);
+    ~OtlpTraceWriter();
+    OtlpTraceWriter(const OtlpTraceWriter&) = delete;
+    OtlpTraceWriter& operator=(const OtlpTraceWriter&) = delete;
+
+    void addSpan(TraceSpan span);
+    void flush();
+
+private:
+    void writeBatch(); // Under mutex_
+
+    std::mutex mutex_;
+    std::ofstream out_;
+    std::string service_name_;
+    std::size_t batch_spans_;
+    std::vector<TraceSpan> pending_;
+};
+
+} // namespace SemiPRO
+
+#endif // TELEMETRY_HPP
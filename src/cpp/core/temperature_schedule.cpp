@@ -0,0 +1,77 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "temperature_schedule.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+TemperatureSchedule TemperatureSchedule::constant(double temperature, double duration) {
+  if (!(duration >= 0.0)) {
+    throw std::invalid_argument("TemperatureSchedule: duration must not be negative");
+  }
+  TemperatureSchedule schedule;
+  schedule.add(0.0, temperature);
+  schedule.add(duration, temperature);
+  return schedule;
+}
+
+void TemperatureSchedule::add(double time, double temperature) {
+  if (!std::isfinite(time) || (!times_.empty() && time < times_.back())) {
+    throw std::invalid_argument("TemperatureSchedule: knot times must not decrease");
+  }
+  if (!(temperature > -273.15) || !std::isfinite(temperature)) {
+    throw std::invalid_argument("TemperatureSchedule: temperature below absolute zero");
+  }
+  times_.push_back(time);
+  temperatures_.push_back(temperature);
+}
+
+void TemperatureSchedule::ramp(double target, double rate, double hold) {
+  if (empty()) {
+    throw std::invalid_argument("TemperatureSchedule: a ramp needs a starting knot");
+  }
+  if (!(hold >= 0.0)) {
+    throw std::invalid_argument("TemperatureSchedule: hold must not be negative");
+  }
+  const double rise = target - temperatures_.back();
+  if (rise != 0.0) {
+    if (!(rise * rate > 0.0)) {
+      throw std::invalid_argument("TemperatureSchedule: ramp rate does not reach the target");
+    }
+    add(times_.back() + rise / rate, target);
+  }
+  if (hold > 0.0) {
+    add(times_.back() + hold, target);
+  }
+}
+
+double TemperatureSchedule::temperature(double time) const {
+  if (empty()) {
+    throw std::logic_error("TemperatureSchedule: schedule is empty");
+  }
+  if (time <= times_.front()) {
+    return temperatures_.front();
+  }
+  if (time >= times_.back()) {
+    return temperatures_.back();
+  }
+  // First knot after time; the one before it starts the segment
+  const auto after = std::upper_bound(times_.begin(), times_.end(), time);
+  const std::size_t n = static_cast<std::size_t>(after - times_.begin());
+  const double fraction = (time - times_[n - 1]) / (times_[n] - times_[n - 1]);
+  return temperatures_[n - 1] + fraction * (temperatures_[n] - temperatures_[n - 1]);
+}
+
+double TemperatureSchedule::start() const {
+  return empty() ? 0.0 : times_.front();
+}
+
+double TemperatureSchedule::end() const {
+  return empty() ? 0.0 : times_.back();
+}
+
+double TemperatureSchedule::peak() const {
+  if (empty()) {
+    throw std::logic_error("TemperatureSchedule: schedule is empty");
+  }
+  return *std::max_element(temperatures_.begin(), temperatures_.end());
+}
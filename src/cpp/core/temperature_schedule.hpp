@@ -0,0 +1,39 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <vector>
+
+// Temperature against time as a furnace or RTP recipe is written: straight
+// ramps between knots, held flat before the first knot and after the last.
+// Times are in minutes, temperatures in Celsius.
+class TemperatureSchedule {
+public:
+  TemperatureSchedule() = default;
+
+  // A single plateau of the given length
+  static TemperatureSchedule constant(double temperature, double duration);
+
+  // Appends a knot. Throws std::invalid_argument for a time before the last
+  // knot's or a temperature below absolute zero; a knot at the last knot's
+  // time makes a step.
+  void add(double time, double temperature);
+  // Appends a linear ramp from the last knot's temperature at rate (C/min,
+  // either sign) to target, then a hold of hold minutes. Throws
+  // std::invalid_argument on an empty schedule or a rate that cannot reach
+  // target.
+  void ramp(double target, double rate, double hold = 0.0);
+
+  double temperature(double time) const;
+  double start() const;
+  double end() const;
+  double duration() const { return end() - start(); }
+  double peak() const;
+  bool empty() const { return times_.empty(); }
+
+  // Knot times, where the temperature's slope may jump
+  const std::vector<double>& times() const { return times_; }
+  const std::vector<double>& temperatures() const { return temperatures_; }
+
+private:
+  std::vector<double> times_;
+  std::vector<double> temperatures_;
+};
@@ -0,0 +1,175 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "thermal_fatigue.hpp"
+#include "task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Cells advanced per task
+constexpr int kCellsPerTask = 4096;
+
+} // namespace
+
+ThermalFatigueCounter::ThermalFatigueCounter(int rows, int cols, const ThermalFatigueOptions& options)
+    : rows_(rows), cols_(cols), options_(options) {
+  if (rows <= 0 || cols <= 0) {
+    throw std::invalid_argument("Thermal fatigue grid must not be empty");
+  }
+  if (!(options.reference_range > 0.0) || !(options.cycles_to_failure > 0.0) || !(options.exponent > 0.0) ||
+      !(options.hysteresis >= 0.0) || options.max_reversals < 3) {
+    throw std::invalid_argument("Invalid thermal fatigue options");
+  }
+  reset();
+}
+
+void ThermalFatigueCounter::reset() {
+  const std::size_t cells = static_cast<std::size_t>(rows_) * cols_;
+  samples_ = 0;
+  damage_.setZero(rows_, cols_);
+  cycles_.setZero(rows_, cols_);
+  extreme_.assign(cells, 0.0);
+  direction_.assign(cells, 0);
+  depth_.assign(cells, 0);
+  stack_.assign(cells * options_.max_reversals, 0.0);
+}
+
+void ThermalFatigueCounter::count(Eigen::Index cell, double range, double weight) {
+  damage_(cell) += weight * std::pow(range / options_.reference_range, options_.exponent) /
+                   options_.cycles_to_failure;
+  cycles_(cell) += weight;
+}
+
+void ThermalFatigueCounter::push(Eigen::Index cell, double reversal) {
+  double* s = &stack_[cell * options_.max_reversals];
+  int& n = depth_[cell];
+  if (n == options_.max_reversals) {
+    count(cell, std::abs(s[1] - s[0]), 0.5);
+    std::copy(s + 1, s + n, s);
+    --n;
+  }
+  s[n++] = reversal;
+  // Three-point rule: the latest range X closes the one before it, Y,
+  // unless X is smaller; Y is a half cycle if it starts the history
+  while (n >= 3) {
+    const double x = std::abs(s[n - 1] - s[n - 2]);
+    const double y = std::abs(s[n - 2] - s[n - 3]);
+    if (x < y) {
+      break;
+    }
+    if (n == 3) {
+      count(cell, y, 0.5);
+      s[0] = s[1];
+      s[1] = s[2];
+      n = 2;
+    } else {
+      count(cell, y, 1.0);
+      s[n - 3] = s[n - 1];
+      n -= 2;
+    }
+  }
+}
+
+template <typename Sample>
+void ThermalFatigueCounter::advance(const Sample& sample) {
+  const int cells = rows_ * cols_;
+  const double h = options_.hysteresis;
+  const bool first = samples_ == 0;
+  TaskScheduler::getInstance().parallelFor(0, cells, [&](int begin, int end) {
+    for (int k = begin; k < end; ++k) {
+      const double t = sample(k);
+      if (first) {
+        // The history's first point is its first reversal
+        push(k, t);
+        extreme_[k] = t;
+        continue;
+      }
+      double& e = extreme_[k];
+      std::int8_t& d = direction_[k];
+      if (d == 0) {
+        const double start = stack_[static_cast<std::size_t>(k) * options_.max_reversals];
+        if (std::abs(t - start) > h) {
+          d = t > start ? 1 : -1;
+          e = t;
+        }
+      } else if (d > 0) {
+        if (t > e) {
+          e = t;
+        } else if (e - t > h) {
+          push(k, e);
+          d = -1;
+          e = t;
+        }
+      } else {
+        if (t < e) {
+          e = t;
+        } else if (t - e > h) {
+          push(k, e);
+          d = 1;
+          e = t;
+        }
+      }
+    }
+  }, kCellsPerTask);
+  ++samples_;
+}
+
+void ThermalFatigueCounter::addSample(const Eigen::Ref<const Eigen::ArrayXXd>& temperature) {
+  if (temperature.rows() != rows_ || temperature.cols() != cols_) {
+    throw std::invalid_argument("Temperature map of " + std::to_string(temperature.rows()) + "x" +
+                                std::to_string(temperature.cols()) + " for a fatigue grid of " +
+                                std::to_string(rows_) + "x" + std::to_string(cols_));
+  }
+  const double* data = temperature.data();
+  const Eigen::Index stride = temperature.outerStride();
+  if (stride == rows_) {
+    advance([data](int k) { return data[k]; });
+  } else {
+    const int rows = rows_;
+    advance([data, stride, rows](int k) { return data[(k / rows) * stride + k % rows]; });
+  }
+}
+
+void ThermalFatigueCounter::addSample(double temperature) {
+  advance([temperature](int) { return temperature; });
+}
+
+void ThermalFatigueCounter::addSample(double base, const Eigen::Ref<const Eigen::ArrayXXd>& offset) {
+  if (offset.rows() != rows_ || offset.cols() != cols_) {
+    throw std::invalid_argument("Temperature offset of " + std::to_string(offset.rows()) + "x" +
+                                std::to_string(offset.cols()) + " for a fatigue grid of " +
+                                std::to_string(rows_) + "x" + std::to_string(cols_));
+  }
+  const double* data = offset.data();
+  const Eigen::Index stride = offset.outerStride();
+  const int rows = rows_;
+  advance([=](int k) { return base + data[(k / rows) * stride + k % rows]; });
+}
+
+Eigen::ArrayXXd ThermalFatigueCounter::damageWithResidue() const {
+  Eigen::ArrayXXd total = damage_;
+  const Eigen::Index cells = total.size();
+  for (Eigen::Index k = 0; k < cells; ++k) {
+    const double* s = &stack_[k * options_.max_reversals];
+    const int n = depth_[k];
+    auto half = [&](double range) {
+      total(k) += 0.5 * std::pow(range / options_.reference_range, options_.exponent) / options_.cycles_to_failure;
+    };
+    for (int i = 1; i < n; ++i) {
+      half(std::abs(s[i] - s[i - 1]));
+    }
+    // The extreme reached since the last reversal ends the residue
+    if (n > 0 && direction_[k] != 0) {
+      half(std::abs(extreme_[k] - s[n - 1]));
+    }
+  }
+  return total;
+}
+
+Eigen::ArrayXXd ThermalFatigueCounter::lifetime(double elapsed) const {
+  const Eigen::ArrayXXd damage = damageWithResidue();
+  return (damage > 0.0).select(elapsed / damage, std::numeric_limits<double>::infinity());
+}
@@ -0,0 +1,78 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include <Eigen/Dense>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Coffin-Manson life of a cell under temperature cycling: a full cycle of
+// range dT uses up (dT / reference_range)^exponent / cycles_to_failure of
+// it, a half cycle half that, and the fractions add up by Miner's rule to
+// failure at 1.
+struct ThermalFatigueOptions {
+  double reference_range = 100.0;    // K, of the qualification cycle
+  double cycles_to_failure = 1000.0; // At reference_range
+  double exponent = 2.0;             // About 1.9 for SnPb solder, 2.7 for SAC
+  double hysteresis = 0.5;           // K; swings no larger than this are noise, not reversals
+  int max_reversals = 32;            // Open reversals kept per cell, at least 3
+};
+
+// Rainflow counting (ASTM E1049) of every cell of a grid, fed one
+// temperature map at a time so a service profile of any length is never
+// stored. Each cell keeps its running extreme, trend and the stack of
+// reversals not yet closed into a cycle, at most max_reversals of them in
+// one flat array for all cells: memory is fixed per cell however long the
+// history. A cycle closing on the stack is counted and its damage added at
+// once; should the stack fill, its oldest range is counted as a half
+// cycle, as the standard counts the residue. Cells advance in parallel
+// blocks on the TaskScheduler.
+class ThermalFatigueCounter {
+public:
+  // Throws std::invalid_argument for an empty grid or bad options
+  ThermalFatigueCounter(int rows, int cols, const ThermalFatigueOptions& options = ThermalFatigueOptions());
+
+  // The next temperature of every cell; throws std::invalid_argument for
+  // a map of another shape
+  void addSample(const Eigen::Ref<const Eigen::ArrayXXd>& temperature);
+  // The same temperature everywhere
+  void addSample(double temperature);
+  // base + offset, e.g. a recipe temperature plus a spatial pattern
+  void addSample(double base, const Eigen::Ref<const Eigen::ArrayXXd>& offset);
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  std::size_t samples() const { return samples_; }
+  const ThermalFatigueOptions& options() const { return options_; }
+
+  // Miner's sum of the cycles closed so far
+  const Eigen::ArrayXXd& damage() const { return damage_; }
+  // Full cycles closed so far, half cycles counting one half
+  const Eigen::ArrayXXd& cycles() const { return cycles_; }
+  // damage() plus the still open reversals counted as half cycles, the
+  // damage were the history to end here
+  Eigen::ArrayXXd damageWithResidue() const;
+  // Time to failure at the damage rate so far, in the units of elapsed;
+  // infinite where nothing has been damaged
+  Eigen::ArrayXXd lifetime(double elapsed) const;
+
+  void reset();
+
+private:
+  // Advances every cell by sample(cell), cells indexed as the flat
+  // column-major storage of the grid
+  template <typename Sample>
+  void advance(const Sample& sample);
+  void push(Eigen::Index cell, double reversal);
+  void count(Eigen::Index cell, double range, double weight);
+
+  int rows_;
+  int cols_;
+  ThermalFatigueOptions options_;
+  std::size_t samples_ = 0;
+  Eigen::ArrayXXd damage_;
+  Eigen::ArrayXXd cycles_;
+  std::vector<double> extreme_;        // Farthest temperature since the last reversal
+  std::vector<std::int8_t> direction_; // +1 rising, -1 falling, 0 not yet moved past the hysteresis
+  std::vector<int> depth_;             // Reversals on each cell's stack
+  std::vector<double> stack_;          // max_reversals per cell, oldest first
+};
@@ -0,0 +1,231 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "thermal_profile.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr double kTwoPi = 6.283185307179586;
+
+double segmentTemperature(const ThermalProfile::Segment& s, double t) {
+  switch (s.shape) {
+    case ThermalProfile::Shape::Linear:
+      return s.duration > 0.0 ? s.start_temperature + (s.end_temperature - s.start_temperature) * t / s.duration
+                              : s.end_temperature;
+    case ThermalProfile::Shape::Exponential:
+      return s.end_temperature + (s.start_temperature - s.end_temperature) * std::exp(-t / s.time_constant);
+    case ThermalProfile::Shape::Sinusoidal:
+      return s.start_temperature + s.amplitude * std::sin(kTwoPi * t / s.period);
+  }
+  return s.start_temperature;
+}
+
+double segmentSlope(const ThermalProfile::Segment& s, double t) {
+  switch (s.shape) {
+    case ThermalProfile::Shape::Linear:
+      return s.duration > 0.0 ? (s.end_temperature - s.start_temperature) / s.duration : 0.0;
+    case ThermalProfile::Shape::Exponential:
+      return -(s.start_temperature - s.end_temperature) / s.time_constant * std::exp(-t / s.time_constant);
+    case ThermalProfile::Shape::Sinusoidal:
+      return s.amplitude * kTwoPi / s.period * std::cos(kTwoPi * t / s.period);
+  }
+  return 0.0;
+}
+
+// Integral over [0, t] of the segment's temperature
+double segmentIntegral(const ThermalProfile::Segment& s, double t) {
+  switch (s.shape) {
+    case ThermalProfile::Shape::Linear: {
+      const double temperature = segmentTemperature(s, t);
+      return 0.5 * (s.start_temperature + temperature) * t;
+    }
+    case ThermalProfile::Shape::Exponential:
+      return s.end_temperature * t +
+             (s.start_temperature - s.end_temperature) * s.time_constant * -std::expm1(-t / s.time_constant);
+    case ThermalProfile::Shape::Sinusoidal: {
+      // 1 - cos x = 2 sin^2(x / 2), without the cancellation for small x
+      const double half = std::sin(0.5 * kTwoPi * t / s.period);
+      return s.start_temperature * t + s.amplitude * s.period / kTwoPi * 2.0 * half * half;
+    }
+  }
+  return 0.0;
+}
+
+void checkDuration(double duration) {
+  if (!(duration >= 0.0) || !std::isfinite(duration)) {
+    throw std::invalid_argument("ThermalProfile: duration must be finite and not negative");
+  }
+}
+
+void checkTemperature(double temperature) {
+  if (!(temperature > -273.15) || !std::isfinite(temperature)) {
+    throw std::invalid_argument("ThermalProfile: temperature below absolute zero");
+  }
+}
+
+} // namespace
+
+ThermalProfile::ThermalProfile(double start_temperature) : end_temperature_(start_temperature) {
+  checkTemperature(start_temperature);
+}
+
+ThermalProfile ThermalProfile::fromSchedule(const TemperatureSchedule& schedule) {
+  if (schedule.empty()) {
+    return ThermalProfile();
+  }
+  const auto& times = schedule.times();
+  const auto& temperatures = schedule.temperatures();
+  ThermalProfile profile(temperatures.front());
+  if (times.front() > 0.0) {
+    profile.hold(times.front());
+  }
+  for (std::size_t i = 1; i < times.size(); ++i) {
+    if (times[i] == times[i - 1]) {
+      profile.step(temperatures[i]);
+    } else {
+      profile.linear(times[i] - times[i - 1], temperatures[i]);
+    }
+  }
+  return profile;
+}
+
+void ThermalProfile::append(Segment segment) {
+  checkDuration(segment.duration);
+  segment.start_time = end_time_;
+  segment.start_temperature = end_temperature_;
+  if (segment.duration > 0.0) {
+    segments_.push_back(segment);
+    end_time_ += segment.duration;
+    end_temperature_ = segmentTemperature(segment, segment.duration);
+  }
+}
+
+void ThermalProfile::hold(double duration) {
+  linear(duration, end_temperature_);
+}
+
+void ThermalProfile::linear(double duration, double end_temperature) {
+  checkTemperature(end_temperature);
+  Segment segment;
+  segment.duration = duration;
+  segment.end_temperature = end_temperature;
+  append(segment);
+  if (duration == 0.0) {
+    step(end_temperature);
+  }
+}
+
+void ThermalProfile::ramp(double target, double rate, double hold_time) {
+  checkTemperature(target);
+  checkDuration(hold_time);
+  const double rise = target - end_temperature_;
+  if (rise != 0.0) {
+    if (!(std::abs(rate) > 0.0)) {
+      throw std::invalid_argument("ThermalProfile: ramp rate must not be zero");
+    }
+    linear(std::abs(rise / rate), target);
+  }
+  hold(hold_time);
+}
+
+void ThermalProfile::exponential(double duration, double target, double time_constant) {
+  checkTemperature(target);
+  if (!(time_constant > 0.0)) {
+    throw std::invalid_argument("ThermalProfile: time constant must be positive");
+  }
+  Segment segment;
+  segment.shape = Shape::Exponential;
+  segment.duration = duration;
+  segment.end_temperature = target;
+  segment.time_constant = time_constant;
+  append(segment);
+}
+
+void ThermalProfile::sinusoid(double duration, double amplitude, double period) {
+  if (!(period > 0.0)) {
+    throw std::invalid_argument("ThermalProfile: period must be positive");
+  }
+  checkTemperature(end_temperature_ - std::abs(amplitude));
+  Segment segment;
+  segment.shape = Shape::Sinusoidal;
+  segment.duration = duration;
+  segment.amplitude = amplitude;
+  segment.period = period;
+  append(segment);
+}
+
+void ThermalProfile::step(double temperature) {
+  checkTemperature(temperature);
+  end_temperature_ = temperature;
+}
+
+const ThermalProfile::Segment* ThermalProfile::segmentAt(double time) const {
+  const auto after = std::upper_bound(segments_.begin(), segments_.end(), time,
+                                      [](double t, const Segment& s) { return t < s.start_time; });
+  return after == segments_.begin() ? nullptr : &*(after - 1);
+}
+
+double ThermalProfile::temperature(double time) const {
+  if (segments_.empty() || time < 0.0) {
+    return segments_.empty() ? end_temperature_ : segments_.front().start_temperature;
+  }
+  if (time >= end_time_) {
+    return end_temperature_;
+  }
+  const Segment* s = segmentAt(time);
+  return segmentTemperature(*s, time - s->start_time);
+}
+
+double ThermalProfile::slope(double time) const {
+  if (segments_.empty() || time < 0.0 || time >= end_time_) {
+    return 0.0;
+  }
+  const Segment* s = segmentAt(time);
+  return segmentSlope(*s, time - s->start_time);
+}
+
+double ThermalProfile::integral(double t0, double t1) const {
+  if (t1 < t0) {
+    return -integral(t1, t0);
+  }
+  double total = 0.0;
+  // Flat before the first segment and after the last
+  if (t0 < 0.0) {
+    total += temperature(t0) * (std::min(t1, 0.0) - t0);
+    t0 = 0.0;
+  }
+  if (t1 > end_time_) {
+    total += end_temperature_ * (t1 - std::max(t0, end_time_));
+    t1 = end_time_;
+  }
+  if (t0 >= t1) {
+    return total;
+  }
+  const auto first = segmentAt(t0) - segments_.data();
+  for (auto i = static_cast<std::size_t>(first); i < segments_.size() && segments_[i].start_time < t1; ++i) {
+    const Segment& s = segments_[i];
+    const double a = std::max(t0, s.start_time) - s.start_time;
+    const double b = std::min(t1, s.start_time + s.duration) - s.start_time;
+    total += segmentIntegral(s, b) - segmentIntegral(s, a);
+  }
+  return total;
+}
+
+std::vector<double> ThermalProfile::breakpoints() const {
+  std::vector<double> times;
+  times.reserve(segments_.size() + 1);
+  for (const auto& s : segments_) {
+    times.push_back(s.start_time);
+  }
+  times.push_back(end_time_);
+  return times;
+}
+
+std::vector<double> ThermalProfile::sample(int count) const {
+  std::vector<double> values(std::max(count, 0));
+  for (int i = 0; i < count; ++i) {
+    values[i] = temperature(count > 1 ? end_time_ * i / (count - 1) : 0.0);
+  }
+  return values;
+}
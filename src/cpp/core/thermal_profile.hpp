@@ -0,0 +1,74 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "temperature_schedule.hpp"
+#include <vector>
+
+// Temperature against time as a sequence of analytic segments (linear
+// ramps and holds, exponential approaches, sinusoids), evaluated where
+// asked rather than sampled up front: a recipe of many hours costs a few
+// segments, and its integral is exact per segment. Held flat before the
+// first segment and after the last. Times are in minutes, temperatures in
+// Celsius.
+class ThermalProfile {
+public:
+  enum class Shape {
+    Linear,      // From the start temperature to the end temperature
+    Exponential, // target + (start - target) exp(-t / time_constant)
+    Sinusoidal   // start + amplitude sin(2 pi t / period)
+  };
+
+  struct Segment {
+    Shape shape = Shape::Linear;
+    double start_time = 0.0;
+    double duration = 0.0;
+    double start_temperature = 0.0;
+    double end_temperature = 0.0; // Linear: the end; Exponential: the target
+    double time_constant = 0.0;   // Exponential
+    double amplitude = 0.0;       // Sinusoidal
+    double period = 0.0;          // Sinusoidal
+  };
+
+  // Starts at time zero from the given temperature
+  explicit ThermalProfile(double start_temperature = 25.0);
+  // The schedule's ramps as linear segments
+  static ThermalProfile fromSchedule(const TemperatureSchedule& schedule);
+
+  // Each appends a segment of the given duration that starts from the
+  // current end temperature. Throw std::invalid_argument for a negative or
+  // non-finite duration, a time constant or period that is not positive,
+  // or a temperature below absolute zero.
+  void hold(double duration);
+  void linear(double duration, double end_temperature);
+  // Linear to target at rate (C/min, its sign ignored)
+  void ramp(double target, double rate, double hold_time = 0.0);
+  void exponential(double duration, double target, double time_constant);
+  void sinusoid(double duration, double amplitude, double period);
+  // Jumps to a temperature without taking time
+  void step(double temperature);
+
+  double temperature(double time) const;
+  // dT/dt (C/min); zero outside the segments
+  double slope(double time) const;
+  // Integral of the temperature from t0 to t1 (C min), exact per segment
+  double integral(double t0, double t1) const;
+  double start() const { return 0.0; }
+  double end() const { return end_time_; }
+  double duration() const { return end_time_; }
+  double endTemperature() const { return end_temperature_; }
+  bool empty() const { return segments_.empty(); }
+
+  const std::vector<Segment>& segments() const { return segments_; }
+  // Segment boundaries, where the temperature or its slope may jump
+  std::vector<double> breakpoints() const;
+  // Temperatures at count points spread evenly over the profile
+  std::vector<double> sample(int count) const;
+
+private:
+  void append(Segment segment);
+  // Segment containing time, the last one starting at or before it
+  const Segment* segmentAt(double time) const;
+
+  std::vector<Segment> segments_;
+  double end_time_ = 0.0;
+  double end_temperature_;
+};
@@ -0,0 +1,134 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "tiled_grid.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Doubles per 64-byte cache line; tile columns are padded to this.
+constexpr int kLineDoubles = static_cast<int>(FieldStore::kAlignment / sizeof(double));
+
+} // namespace
+
+TiledGrid::TiledGrid(int rows, int cols, int tile_size, int halo)
+    : rows_(rows), cols_(cols), tile_size_(tile_size), halo_(halo) {
+    if (rows < 0 || cols < 0) {
+        throw std::invalid_argument("Tiled grid dimensions must be non-negative");
+    }
+    if (tile_size <= 0 || halo < 0 || halo > tile_size) {
+        throw std::invalid_argument("Tile size must be positive and halo must not exceed it");
+    }
+    tiles_down_ = (rows + tile_size - 1) / tile_size;
+    tiles_across_ = (cols + tile_size - 1) / tile_size;
+    buffer_ = allocateAlignedField(blockSize() * tileCount());
+    std::fill(buffer_.get(), buffer_.get() + blockSize() * tileCount(), 0.0);
+}
+
+std::size_t TiledGrid::blockSize() const {
+    int stride = (tile_size_ + 2 * halo_ + kLineDoubles - 1) / kLineDoubles * kLineDoubles;
+    return static_cast<std::size_t>(stride) * (tile_size_ + 2 * halo_);
+}
+
+TiledGrid::Tile TiledGrid::makeTile(int index, double* base) const {
+    Tile t;
+    t.index = index;
+    int tile_row = index % tiles_down_;
+    int tile_col = index / tiles_down_;
+    t.origin_row = tile_row * tile_size_;
+    t.origin_col = tile_col * tile_size_;
+    t.rows = std::min(tile_size_, rows_ - t.origin_row);
+    t.cols = std::min(tile_size_, cols_ - t.origin_col);
+    t.halo = halo_;
+    t.stride = (tile_size_ + 2 * halo_ + kLineDoubles - 1) / kLineDoubles * kLineDoubles;
+    t.data = base + index * blockSize() + static_cast<std::size_t>(halo_) * t.stride + halo_;
+    return t;
+}
+
+void TiledGrid::load(const Eigen::Ref<const Eigen::ArrayXXd>& field) {
+    if (field.rows() != rows_ || field.cols() != cols_) {
+        throw std::invalid_argument("Field shape does not match tiled grid");
+    }
+    forEachTile([&](Tile& t) {
+        for (int j = 0; j < t.cols; ++j) {
+            const double* src = field.data() + (t.origin_col + j) * field.outerStride() + t.origin_row;
+            std::copy(src, src + t.rows, &t(0, j));
+        }
+    });
+    exchangeHalos();
+}
+
+void TiledGrid::store(Eigen::Ref<Eigen::ArrayXXd> field) const {
+    if (field.rows() != rows_ || field.cols() != cols_) {
+        throw std::invalid_argument("Field shape does not match tiled grid");
+    }
+    const int count = tileCount();
+    #pragma omp parallel for schedule(dynamic)
+    for (int index = 0; index < count; ++index) {
+        const Tile t = makeTile(index, buffer_.get());
+        for (int j = 0; j < t.cols; ++j) {
+            const double* src = &t(0, j);
+            std::copy(src, src + t.rows, &field(t.origin_row, t.origin_col + j));
+        }
+    }
+}
+
+void TiledGrid::exchangeHalos() {
+    if (halo_ == 0 || tileCount() == 0) {
+        return;
+    }
+    // Each tile only writes its own ghost cells and only reads neighbour
+    // interiors, so tiles can be refreshed concurrently.
+    forEachTile([&](Tile& t) {
+        for (int j = -halo_; j < t.cols + halo_; ++j) {
+            const bool interior_col = j >= 0 && j < t.cols;
+            int gj = std::clamp(t.origin_col + j, 0, cols_ - 1);
+            int owner_col = gj / tile_size_;
+            for (int i = -halo_; i < t.rows + halo_; ++i) {
+                if (interior_col && i == 0) {
+                    i = t.rows - 1; // Skip the interior run of this column
+                    continue;
+                }
+                int gi = std::clamp(t.origin_row + i, 0, rows_ - 1);
+                int owner = owner_col * tiles_down_ + gi / tile_size_;
+                const Tile src = makeTile(owner, buffer_.get());
+                t(i, j) = src(gi - src.origin_row, gj - src.origin_col);
+            }
+        }
+    });
+}
+
+void TiledGrid::copyInteriorRows(int first, int count, double* out) const {
+    if (first < 0 || count < 0 || first + count > rows_) {
+        throw std::invalid_argument("Rows outside the tiled grid");
+    }
+    for (int i = first; i < first + count; ++i) {
+        double* row = out + static_cast<std::size_t>(i - first) * cols_;
+        for (int tile_col = 0; tile_col < tiles_across_; ++tile_col) {
+            const Tile t = makeTile(tile_col * tiles_down_ + i / tile_size_, buffer_.get());
+            for (int j = 0; j < t.cols; ++j) {
+                row[t.origin_col + j] = t(i - t.origin_row, j);
+            }
+        }
+    }
+}
+
+void TiledGrid::fillGhostRows(bool top, const double* rows) {
+    if (halo_ == 0 || tileCount() == 0) {
+        return;
+    }
+    // Ghost rows past the edge reach into the tiles next to it, and on
+    // into the row of tiles before when the edge tile is thinner than the halo
+    forEachTile([&](Tile& t) {
+        for (int g = 0; g < halo_; ++g) {
+            const int i = top ? g - halo_ : t.rows + g;
+            const int source = top ? t.origin_row + i + halo_ : t.origin_row + i - rows_;
+            if (source < 0 || source >= halo_) {
+                continue;
+            }
+            const double* row = rows + static_cast<std::size_t>(source) * cols_;
+            for (int j = -halo_; j < t.cols + halo_; ++j) {
+                t(i, j) = row[std::clamp(t.origin_col + j, 0, cols_ - 1)];
+            }
+        }
+    });
+}
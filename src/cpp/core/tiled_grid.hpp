@@ -0,0 +1,111 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef TILED_GRID_HPP
+#define TILED_GRID_HPP
+
+#include "field_store.hpp"
+#include <Eigen/Dense>
+#include <utility>
+
+// Blocked copy of a 2D field. The field is cut into tile_size x tile_size
+// tiles; each tile is stored contiguously (column-major, 64-byte aligned)
+// together with `halo` ghost cells on every side, so a worker handed one
+// tile touches a single compact block that stays resident in L2.
+class TiledGrid {
+public:
+    struct Tile {
+        int index;       // Linear tile index (tile rows fastest)
+        int origin_row;  // Global row of interior cell (0,0)
+        int origin_col;  // Global column of interior cell (0,0)
+        int rows;        // Interior rows (smaller on the bottom edge)
+        int cols;        // Interior columns (smaller on the right edge)
+        int halo;
+        int stride;      // Column stride of the tile block
+        double* data;    // Interior cell (0,0)
+
+        // Local coordinates; ghost cells are reachable with i, j in [-halo, 0)
+        // and [rows, rows + halo).
+        double& operator()(int i, int j) { return data[j * stride + i]; }
+        const double& operator()(int i, int j) const { return data[j * stride + i]; }
+    };
+
+    TiledGrid() = default;
+    TiledGrid(int rows, int cols, int tile_size = 64, int halo = 1);
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int tileSize() const { return tile_size_; }
+    int halo() const { return halo_; }
+    int tilesDown() const { return tiles_down_; }
+    int tilesAcross() const { return tiles_across_; }
+    int tileCount() const { return tiles_down_ * tiles_across_; }
+
+    Tile tile(int index) { return makeTile(index, buffer_.get()); }
+
+    void load(const Eigen::Ref<const Eigen::ArrayXXd>& field);
+    void store(Eigen::Ref<Eigen::ArrayXXd> field) const;
+
+    // Refreshes every ghost cell from the owning neighbour tile. Cells past
+    // the field edge replicate the nearest boundary cell (zero-flux).
+    void exchangeHalos();
+
+    // Calls fn(Tile&) once per tile, tiles distributed across OpenMP threads.
+    template <typename Fn>
+    void forEachTile(Fn&& fn) {
+        const int count = tileCount();
+        #pragma omp parallel for schedule(dynamic)
+        for (int t = 0; t < count; ++t) {
+            Tile current = makeTile(t, buffer_.get());
+            fn(current);
+        }
+    }
+
+    // Copies `count` interior rows from `first` into out, row-major
+    void copyInteriorRows(int first, int count, double* out) const;
+    // Overwrites the ghost rows above (top) or below the field with halo
+    // rows of cols values each, row-major and top to bottom; the ghost
+    // corners take the nearest column. For a field that is one slab of a
+    // larger one, after exchangeHalos() has replicated its edges.
+    void fillGhostRows(bool top, const double* rows);
+
+    // Runs `steps` Jacobi sweeps of a stencil. kernel(const Tile& in, Tile& out)
+    // must write every interior cell of `out`; it may read `in` up to `halo`
+    // cells outside the interior. Halos are exchanged before each sweep.
+    template <typename Kernel>
+    void applyStencil(int steps, Kernel&& kernel) {
+        applyStencil(steps, std::forward<Kernel>(kernel), [this] { exchangeHalos(); });
+    }
+
+    // As above with exchange() refreshing the halos, e.g. across ranks
+    template <typename Kernel, typename Exchange>
+    void applyStencil(int steps, Kernel&& kernel, Exchange&& exchange) {
+        if (!scratch_) {
+            scratch_ = allocateAlignedField(blockSize() * tileCount());
+        }
+        const int count = tileCount();
+        for (int step = 0; step < steps; ++step) {
+            exchange();
+            #pragma omp parallel for schedule(dynamic)
+            for (int t = 0; t < count; ++t) {
+                const Tile in = makeTile(t, buffer_.get());
+                Tile out = makeTile(t, scratch_.get());
+                kernel(in, out);
+            }
+            std::swap(buffer_, scratch_);
+        }
+    }
+
+private:
+    std::size_t blockSize() const;
+    Tile makeTile(int index, double* base) const;
+
+    int rows_ = 0;
+    int cols_ = 0;
+    int tile_size_ = 64;
+    int halo_ = 1;
+    int tiles_down_ = 0;
+    int tiles_across_ = 0;
+    AlignedFieldBuffer buffer_;
+    AlignedFieldBuffer scratch_;
+};
+
+#endif // TILED_GRID_HPP
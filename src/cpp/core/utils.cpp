@@ -1,5 +1,6 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "utils.hpp"
+#include <fstream>
 #include <yaml-cpp/yaml.h>
 
 Logger& Logger::getInstance() {
@@ -10,12 +11,25 @@ Logger& Logger::getInstance() {
 void Logger::initialize(const std::string& config_file) {
   YAML::Node config = YAML::LoadFile(config_file);
   std::string log_path = config["logging"]["path"].as<std::string>();
-  log_file_.open(log_path, std::ios::app);
+  // The sink owns the stream, so it outlives this singleton if need be
+  auto file = std::make_shared<std::ofstream>(log_path, std::ios::app);
+
+  auto& dispatcher = SemiPRO::LogDispatcher::getInstance();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_sink_ >= 0) {
+    dispatcher.removeSink(file_sink_);
+  }
+  file_sink_ = dispatcher.addSink([file](const SemiPRO::LogRecord& record, const std::string& message) {
+    if (record.level >= SemiPRO::LogLevel::WARNING) {
+      *file << SemiPRO::logLevelName(record.level) << ": ";
+    }
+    *file << message << "\n";
+  }, [file]() { file->flush(); });
 }
 
 void Logger::log(const std::string& message) {
-  if (log_file_.is_open()) {
-    log_file_ << message << "\n";
-    log_file_.flush();
+  if (SemiPRO::logEnabled(SemiPRO::LogLevel::INFO)) {
+    SemiPRO::logDeferred(SemiPRO::LogLevel::INFO, SemiPRO::LogCategory::GENERAL, nullptr, nullptr, 0, "{}",
+                         message);
   }
-}
\ No newline at end of file
+}
@@ -1,18 +1,25 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
+#include "log_ring.hpp"
+#include <mutex>
 #include <string>
-#include <fstream>
 
+// Plain-text log file named by a config's logging.path. Lines from every
+// front end reach it through the LogDispatcher; warnings and worse are
+// prefixed with their level. New code should prefer SEMIPRO_LOGF, which
+// skips formatting entirely for filtered levels.
 class Logger {
 public:
   static Logger& getInstance();
   void initialize(const std::string& config_file);
+  // Queued at INFO level; written by the dispatcher thread
   void log(const std::string& message);
 
 private:
   Logger() = default;
-  std::ofstream log_file_;
+  std::mutex mutex_;
+  int file_sink_ = -1;
 };
 
-#endif // UTILS_HPP
\ No newline at end of file
+#endif // UTILS_HPP
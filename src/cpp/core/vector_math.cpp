@@ -0,0 +1,243 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "vector_math.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Every kernel rounds each operation as written: the paths agree bit for
+// bit only if none of them fuses a multiply and add
+#define SEMIPRO_EXACT __attribute__((optimize("fp-contract=off")))
+#define SEMIPRO_EXACT_AVX2 __attribute__((target("avx2"), optimize("fp-contract=off")))
+#define SEMIPRO_EXACT_AVX512 __attribute__((target("avx512f"), optimize("fp-contract=off")))
+
+constexpr double kLog2e = 1.4426950408889634;
+constexpr double kLn2Hi = 6.93147180369123816490e-01; // Upper bits of ln 2, exact in k * kLn2Hi
+constexpr double kLn2Lo = 1.90821492927058770002e-10;
+constexpr double kShifter = 6755399441055744.0; // 1.5 * 2^52: adding it rounds to an integer
+// Past these 2^k alone overflows or underflows, so clamping keeps inf and 0
+constexpr double kMaxArg = 710.0;
+constexpr double kMinArg = -746.0;
+
+// 2^k for integral k in [-1022, 1023]
+SEMIPRO_EXACT inline double powerOfTwo(double k) {
+  const double shifted = k + kShifter;
+  std::uint64_t bits;
+  std::memcpy(&bits, &shifted, sizeof bits);
+  bits = (bits + 1023) << 52; // The low bits of the mantissa hold k
+  double result;
+  std::memcpy(&result, &bits, sizeof result);
+  return result;
+}
+
+// exp(r) to r^13 by Horner, highest power first
+constexpr int kTaylorTerms = 14;
+constexpr double kTaylor[kTaylorTerms] = {
+    1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0,
+    1.0 / 40320.0,      1.0 / 5040.0,      1.0 / 720.0,      1.0 / 120.0,     1.0 / 24.0,
+    1.0 / 6.0,          0.5,               1.0,              1.0};
+
+// exp(x) = 2^k exp(r), |r| <= ln 2 / 2. The 2^k is applied in two
+// halves, so the result rounds once whether it is normal, subnormal, zero
+// or infinite.
+SEMIPRO_EXACT inline double expLane(double x) {
+  const double clamped = std::min(std::max(x, kMinArg), kMaxArg);
+  const double k = (clamped * kLog2e + kShifter) - kShifter;
+  const double r = (clamped - k * kLn2Hi) - k * kLn2Lo;
+  double p = kTaylor[0];
+  for (int j = 1; j < kTaylorTerms; ++j) {
+    p = p * r + kTaylor[j];
+  }
+  const double half = (0.5 * k + kShifter) - kShifter;
+  return p * powerOfTwo(half) * powerOfTwo(k - half);
+}
+
+SEMIPRO_EXACT void expGeneric(const double* x, double* y, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    y[i] = expLane(x[i]);
+  }
+}
+
+SEMIPRO_EXACT void gaussianGeneric(const double* x, double* y, std::size_t n, double centre, double inverse,
+                                   double scale) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const double offset = x[i] - centre;
+    y[i] = scale * expLane(-(offset * offset * inverse));
+  }
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SEMIPRO_VECTOR_X86 1
+
+// The vector lanes repeat expLane operation for operation; max(lo, x)
+// returns x when x is NaN, as std::max(x, lo) does. The tails run through
+// the generic kernels.
+
+SEMIPRO_EXACT_AVX2 inline __m256d powerOfTwoAvx2(__m256d k) {
+  const __m256i bits = _mm256_castpd_si256(_mm256_add_pd(k, _mm256_set1_pd(kShifter)));
+  return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52));
+}
+
+SEMIPRO_EXACT_AVX2 inline __m256d expAvx2Lanes(__m256d x) {
+  const __m256d shifter = _mm256_set1_pd(kShifter);
+  const __m256d clamped = _mm256_min_pd(_mm256_set1_pd(kMaxArg), _mm256_max_pd(_mm256_set1_pd(kMinArg), x));
+  const __m256d k = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(clamped, _mm256_set1_pd(kLog2e)), shifter), shifter);
+  const __m256d r = _mm256_sub_pd(_mm256_sub_pd(clamped, _mm256_mul_pd(k, _mm256_set1_pd(kLn2Hi))),
+                                  _mm256_mul_pd(k, _mm256_set1_pd(kLn2Lo)));
+  __m256d p = _mm256_set1_pd(kTaylor[0]);
+  for (int j = 1; j < kTaylorTerms; ++j) {
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(kTaylor[j]));
+  }
+  const __m256d half = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), k), shifter), shifter);
+  return _mm256_mul_pd(_mm256_mul_pd(p, powerOfTwoAvx2(half)), powerOfTwoAvx2(_mm256_sub_pd(k, half)));
+}
+
+SEMIPRO_EXACT_AVX2 void expAvx2(const double* x, double* y, std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(y + i, expAvx2Lanes(_mm256_loadu_pd(x + i)));
+  }
+  expGeneric(x + i, y + i, n - i);
+}
+
+SEMIPRO_EXACT_AVX2 void gaussianAvx2(const double* x, double* y, std::size_t n, double centre,
+                                                  double inverse, double scale) {
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256d offset = _mm256_sub_pd(_mm256_loadu_pd(x + i), _mm256_set1_pd(centre));
+    const __m256d argument =
+        _mm256_xor_pd(_mm256_mul_pd(_mm256_mul_pd(offset, offset), _mm256_set1_pd(inverse)), sign);
+    _mm256_storeu_pd(y + i, _mm256_mul_pd(_mm256_set1_pd(scale), expAvx2Lanes(argument)));
+  }
+  gaussianGeneric(x + i, y + i, n - i, centre, inverse, scale);
+}
+
+SEMIPRO_EXACT_AVX512 inline __m512d powerOfTwoAvx512(__m512d k) {
+  const __m512i bits = _mm512_castpd_si512(_mm512_add_pd(k, _mm512_set1_pd(kShifter)));
+  return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_add_epi64(bits, _mm512_set1_epi64(1023)), 52));
+}
+
+SEMIPRO_EXACT_AVX512 inline __m512d expAvx512Lanes(__m512d x) {
+  const __m512d shifter = _mm512_set1_pd(kShifter);
+  const __m512d clamped = _mm512_min_pd(_mm512_set1_pd(kMaxArg), _mm512_max_pd(_mm512_set1_pd(kMinArg), x));
+  const __m512d k = _mm512_sub_pd(_mm512_add_pd(_mm512_mul_pd(clamped, _mm512_set1_pd(kLog2e)), shifter), shifter);
+  const __m512d r = _mm512_sub_pd(_mm512_sub_pd(clamped, _mm512_mul_pd(k, _mm512_set1_pd(kLn2Hi))),
+                                  _mm512_mul_pd(k, _mm512_set1_pd(kLn2Lo)));
+  __m512d p = _mm512_set1_pd(kTaylor[0]);
+  for (int j = 1; j < kTaylorTerms; ++j) {
+    p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(kTaylor[j]));
+  }
+  const __m512d half = _mm512_sub_pd(_mm512_add_pd(_mm512_mul_pd(_mm512_set1_pd(0.5), k), shifter), shifter);
+  return _mm512_mul_pd(_mm512_mul_pd(p, powerOfTwoAvx512(half)), powerOfTwoAvx512(_mm512_sub_pd(k, half)));
+}
+
+SEMIPRO_EXACT_AVX512 void expAvx512(const double* x, double* y, std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(y + i, expAvx512Lanes(_mm512_loadu_pd(x + i)));
+  }
+  expGeneric(x + i, y + i, n - i);
+}
+
+SEMIPRO_EXACT_AVX512 void gaussianAvx512(const double* x, double* y, std::size_t n, double centre,
+                                                      double inverse, double scale) {
+  const __m512i sign = _mm512_set1_epi64(static_cast<long long>(0x8000000000000000ULL));
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m512d offset = _mm512_sub_pd(_mm512_loadu_pd(x + i), _mm512_set1_pd(centre));
+    const __m512d product = _mm512_mul_pd(_mm512_mul_pd(offset, offset), _mm512_set1_pd(inverse));
+    const __m512d argument = _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(product), sign));
+    _mm512_storeu_pd(y + i, _mm512_mul_pd(_mm512_set1_pd(scale), expAvx512Lanes(argument)));
+  }
+  gaussianGeneric(x + i, y + i, n - i, centre, inverse, scale);
+}
+#endif
+
+VectorMath::Path widestPath() {
+#ifdef SEMIPRO_VECTOR_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return VectorMath::Path::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return VectorMath::Path::AVX2;
+  }
+#endif
+  return VectorMath::Path::Generic;
+}
+
+std::atomic<VectorMath::Path>& selected() {
+  static std::atomic<VectorMath::Path> path{widestPath()};
+  return path;
+}
+
+#undef SEMIPRO_EXACT
+#undef SEMIPRO_EXACT_AVX2
+#undef SEMIPRO_EXACT_AVX512
+
+} // namespace
+
+namespace VectorMath {
+
+Path activePath() { return selected().load(std::memory_order_relaxed); }
+
+bool isSupported(Path path) {
+  return path == Path::Generic || (path == Path::AVX2 && widestPath() != Path::Generic) ||
+         (path == Path::AVX512 && widestPath() == Path::AVX512);
+}
+
+void setPath(Path path) {
+  if (!isSupported(path)) {
+    throw std::invalid_argument(std::string("CPU does not support the ") + pathName(path) + " path");
+  }
+  selected().store(path, std::memory_order_relaxed);
+}
+
+const char* pathName(Path path) {
+  switch (path) {
+  case Path::AVX512:
+    return "AVX-512";
+  case Path::AVX2:
+    return "AVX2";
+  default:
+    return "generic";
+  }
+}
+
+void exp(const double* x, double* y, std::size_t n) {
+  switch (activePath()) {
+#ifdef SEMIPRO_VECTOR_X86
+  case Path::AVX512:
+    return expAvx512(x, y, n);
+  case Path::AVX2:
+    return expAvx2(x, y, n);
+#endif
+  default:
+    return expGeneric(x, y, n);
+  }
+}
+
+void gaussian(const double* x, double* y, std::size_t n, double centre, double width, double scale) {
+  const double inverse = 1.0 / (2.0 * width * width);
+  switch (activePath()) {
+#ifdef SEMIPRO_VECTOR_X86
+  case Path::AVX512:
+    return gaussianAvx512(x, y, n, centre, inverse, scale);
+  case Path::AVX2:
+    return gaussianAvx2(x, y, n, centre, inverse, scale);
+#endif
+  default:
+    return gaussianGeneric(x, y, n, centre, inverse, scale);
+  }
+}
+
+} // namespace VectorMath
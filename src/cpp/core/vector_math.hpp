@@ -0,0 +1,34 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef VECTOR_MATH_HPP
+#define VECTOR_MATH_HPP
+
+#include <cstddef>
+
+// Elementwise math over contiguous arrays, for the analytic profile
+// kernels. Each function has AVX-512, AVX2 and generic builds of one
+// branch-free algorithm, and the widest the CPU supports is picked on
+// first use.
+//
+// exp is within 1 ulp of the correctly rounded result, subnormal results
+// included, and gives exactly 0 and inf past the double range. The
+// vector paths do the generic path's operations in the same order, none
+// fused, so every path gives the same bits on any run, thread count or
+// machine.
+namespace VectorMath {
+
+enum class Path { Generic, AVX2, AVX512 };
+
+Path activePath();
+bool isSupported(Path path);
+// Throws std::invalid_argument if the CPU lacks the instructions
+void setPath(Path path);
+const char* pathName(Path path);
+
+// y[i] = exp(x[i]); x and y may be the same array
+void exp(const double* x, double* y, std::size_t n);
+// y[i] = scale * exp(-(x[i] - centre)^2 / (2 width^2))
+void gaussian(const double* x, double* y, std::size_t n, double centre, double width, double scale);
+
+} // namespace VectorMath
+
+#endif // VECTOR_MATH_HPP
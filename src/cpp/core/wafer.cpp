@@ -1,32 +1,113 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "wafer.hpp"
+#include <stdexcept>
+#include <utility>
 
 Wafer::Wafer(double diameter, double thickness, const std::string& material_id)
-    : diameter_(diameter), thickness_(thickness), material_id_(material_id), packaging_substrate_{0.0, ""} {}
+    : diameter_(diameter), thickness_(thickness), material_id_(material_id), packaging_substrate_{0.0, ""} {
+  // Registration order must match FieldChannel. Heights keep double;
+  // the physical fields need float32 at most and the pattern is 0/1.
+  fields_.registerChannel("grid", thickness_);
+  fields_.registerChannel("photoresist_pattern", 0.0, false, FieldPrecision::MASK8);
+  fields_.registerChannel("temperature_profile", 300.0, false, FieldPrecision::FLOAT32); // Default 300 K
+  fields_.registerChannel("thermal_conductivity", 150.0, false, FieldPrecision::FLOAT32); // Default Si conductivity
+  fields_.registerChannel("electromigration_mttf", 0.0, true, FieldPrecision::FLOAT32);
+  fields_.registerChannel("thermal_stress", 0.0, true, FieldPrecision::FLOAT32);
+  fields_.registerChannel("dielectric_field", 0.0, true, FieldPrecision::FLOAT32);
+}
 
 void Wafer::initializeGrid(int x_dim, int y_dim) {
-  grid_ = Eigen::ArrayXXd::Ones(x_dim, y_dim) * thickness_;
+  if (!fields_.reshape(x_dim, y_dim)) {
+    for (int c = 0; c < fields_.channelCount(); ++c) {
+      fields_.resetChannel(c);
+    }
+  }
+  resetPhotoresistMask();
   dopant_profile_.resize(x_dim);
   dopant_profile_.setZero();
-  photoresist_pattern_ = Eigen::ArrayXXd::Zero(x_dim, y_dim);
-  temperature_profile_ = Eigen::ArrayXXd::Constant(x_dim, y_dim, 300.0); // Default 300 K
-  thermal_conductivity_ = Eigen::ArrayXXd::Constant(x_dim, y_dim, 150.0); // Default Si conductivity
-  electromigration_mttf_ = Eigen::ArrayXXd::Zero(x_dim, y_dim); // NEW
-  thermal_stress_ = Eigen::ArrayXXd::Zero(x_dim, y_dim); // NEW
-  dielectric_field_ = Eigen::ArrayXXd::Zero(x_dim, y_dim); // NEW
+  dopant_mesh_valid_ = false;
 }
 
 void Wafer::applyLayer(double thickness, const std::string& material_id) {
-  grid_ += thickness;
+  fields_.shift(kGridField, thickness);
   film_layers_.emplace_back(thickness, material_id);
 }
 
 void Wafer::setDopantProfile(const Eigen::ArrayXd& profile) {
   dopant_profile_ = profile;
+  dopant_mesh_valid_ = false;
+}
+
+void Wafer::setDopantProfile(const DepthMesh& mesh, const Eigen::ArrayXd& profile) {
+  if (profile.size() != mesh.size()) {
+    throw std::invalid_argument("Dopant profile and depth mesh sizes differ");
+  }
+  dopant_mesh_ = mesh;
+  dopant_mesh_profile_ = profile;
+  dopant_mesh_valid_ = true;
+  if (dopant_profile_.size() > 0 && mesh.size() > 0) {
+    dopant_profile_ = mesh.remap(profile, DepthMesh::cells(thickness_, dopant_profile_.size()));
+  }
+}
+
+const DepthMesh& Wafer::getDopantMesh() const {
+  if (!dopant_mesh_valid_) {
+    dopant_mesh_ = DepthMesh::cells(thickness_, dopant_profile_.size());
+    dopant_mesh_profile_ = dopant_mesh_.empty() ? Eigen::ArrayXd() : dopant_profile_;
+    dopant_mesh_valid_ = true;
+  }
+  return dopant_mesh_;
+}
+
+const Eigen::ArrayXd& Wafer::getDopantMeshProfile() const {
+  getDopantMesh();
+  return dopant_mesh_profile_;
+}
+
+double Wafer::getDopantConcentration(double depth) const {
+  const DepthMesh& mesh = getDopantMesh();
+  return mesh.empty() ? 0.0 : mesh.sample(dopant_mesh_profile_, depth);
+}
+
+void Wafer::setPhotoresistPattern(const Eigen::Ref<const Eigen::ArrayXXd>& pattern) {
+  fields_.assign(kPhotoresistField, pattern);
+  photoresist_mask_valid_ = false;
+  photoresist_dense_stale_ = false;
+}
+
+void Wafer::setPhotoresistMask(BitMask mask) {
+  if (fields_.cellCount() == 0) {
+    fields_.reshape(mask.rows(), mask.cols());
+  } else if (mask.rows() != fields_.rows() || mask.cols() != fields_.cols()) {
+    throw std::invalid_argument("Photoresist mask shape does not match wafer grid");
+  }
+  photoresist_mask_ = std::move(mask);
+  photoresist_mask_valid_ = true;
+  photoresist_dense_stale_ = true;
+}
+
+const BitMask& Wafer::getPhotoresistMask() const {
+  if (!photoresist_mask_valid_) {
+    photoresist_mask_ = BitMask::fromField(fields_.view(kPhotoresistField));
+    photoresist_mask_valid_ = true;
+  }
+  return photoresist_mask_;
 }
 
-void Wafer::setPhotoresistPattern(const Eigen::ArrayXXd& pattern) {
-  photoresist_pattern_ = pattern;
+void Wafer::syncPhotoresistPattern() const {
+  if (photoresist_dense_stale_) {
+    // Only const access is needed to fill the channel; the store's storage
+    // is not part of the wafer's logical state.
+    FieldStore& fields = const_cast<FieldStore&>(fields_);
+    fields.assign(kPhotoresistField, photoresist_mask_.toField());
+    photoresist_dense_stale_ = false;
+  }
+}
+
+void Wafer::resetPhotoresistMask() {
+  photoresist_mask_ = BitMask(fields_.rows(), fields_.cols());
+  photoresist_mask_valid_ = true;
+  photoresist_dense_stale_ = false;
 }
 
 void Wafer::addFilmLayer(double thickness, const std::string& material) {
@@ -47,40 +128,70 @@ void Wafer::setElectricalProperties(const std::vector<std::pair<std::string, dou
   electrical_properties_ = properties;
 }
 
-void Wafer::setTemperatureProfile(const Eigen::ArrayXXd& temperature) {
-  temperature_profile_ = temperature;
+void Wafer::setTemperatureProfile(const Eigen::Ref<const Eigen::ArrayXXd>& temperature) {
+  fields_.assign(kTemperatureField, temperature);
+}
+
+void Wafer::setThermalConductivity(const Eigen::Ref<const Eigen::ArrayXXd>& conductivity) {
+  fields_.assign(kThermalConductivityField, conductivity);
+}
+
+void Wafer::setElectromigrationMTTF(const Eigen::Ref<const Eigen::ArrayXXd>& mttf) { // NEW
+  fields_.assign(kElectromigrationMTTFField, mttf);
 }
 
-void Wafer::setThermalConductivity(const Eigen::ArrayXXd& conductivity) {
-  thermal_conductivity_ = conductivity;
+void Wafer::setThermalStress(const Eigen::Ref<const Eigen::ArrayXXd>& stress) { // NEW
+  fields_.assign(kThermalStressField, stress);
 }
 
-void Wafer::setElectromigrationMTTF(const Eigen::ArrayXXd& mttf) { // NEW
-  electromigration_mttf_ = mttf;
+void Wafer::setDielectricField(const Eigen::Ref<const Eigen::ArrayXXd>& field) { // NEW
+  fields_.assign(kDielectricFieldField, field);
 }
 
-void Wafer::setThermalStress(const Eigen::ArrayXXd& stress) { // NEW
-  thermal_stress_ = stress;
+void Wafer::updateGrid(const Eigen::Ref<const Eigen::ArrayXXd>& new_grid) {
+  setGrid(new_grid);
 }
 
-void Wafer::setDielectricField(const Eigen::ArrayXXd& field) { // NEW
-  dielectric_field_ = field;
+void Wafer::updateGrid(Eigen::ArrayXXd&& new_grid) {
+  Eigen::ArrayXXd released = std::move(new_grid);
+  setGrid(released);
 }
 
-void Wafer::updateGrid(const Eigen::ArrayXXd& new_grid) {
-  grid_ = new_grid;
+void Wafer::setGrid(const Eigen::Ref<const Eigen::ArrayXXd>& new_grid) {
+  if (new_grid.rows() != fields_.rows() || new_grid.cols() != fields_.cols()) {
+    fields_.reshape(static_cast<int>(new_grid.rows()), static_cast<int>(new_grid.cols()));
+    resetPhotoresistMask();
+  }
+  // Writing a view of the grid back onto itself is a no-op.
+  const FieldStore& fields = fields_;
+  if (new_grid.data() != fields.data(kGridField)) {
+    fields_.assign(kGridField, new_grid);
+  }
 }
 
-void Wafer::setGrid(const Eigen::ArrayXXd& new_grid) {
-  grid_ = new_grid;
+FieldSnapshot Wafer::snapshotField(FieldChannel channel) const {
+  if (channel == kPhotoresistField) {
+    syncPhotoresistPattern();
+  }
+  return fields_.snapshot(channel);
 }
 
-Eigen::ArrayXXd& Wafer::getGrid() { return grid_; }
-const Eigen::ArrayXXd& Wafer::getGrid() const { return grid_; }
-Eigen::ArrayXd& Wafer::getDopantProfile() { return dopant_profile_; }
+FieldView Wafer::getGrid() { return fields_.view(kGridField); }
+ConstFieldView Wafer::getGrid() const { return fields_.view(kGridField); }
+Eigen::ArrayXd& Wafer::getDopantProfile() {
+  dopant_mesh_valid_ = false; // The caller may edit the uniform profile
+  return dopant_profile_;
+}
 const Eigen::ArrayXd& Wafer::getDopantProfile() const { return dopant_profile_; }
-Eigen::ArrayXXd& Wafer::getPhotoresistPattern() { return photoresist_pattern_; }
-const Eigen::ArrayXXd& Wafer::getPhotoresistPattern() const { return photoresist_pattern_; }
+FieldView Wafer::getPhotoresistPattern() {
+  syncPhotoresistPattern();
+  photoresist_mask_valid_ = false; // The caller may edit the dense pattern
+  return fields_.view(kPhotoresistField);
+}
+ConstFieldView Wafer::getPhotoresistPattern() const {
+  syncPhotoresistPattern();
+  return fields_.view(kPhotoresistField);
+}
 std::vector<std::pair<double, std::string>>& Wafer::getFilmLayers() { return film_layers_; }
 const std::vector<std::pair<double, std::string>>& Wafer::getFilmLayers() const { return film_layers_; }
 std::vector<std::pair<double, std::string>>& Wafer::getMetalLayers() { return metal_layers_; }
@@ -88,11 +199,11 @@ const std::vector<std::pair<double, std::string>>& Wafer::getMetalLayers() const
 std::pair<double, std::string> Wafer::getPackagingSubstrate() const { return packaging_substrate_; }
 const std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>>& Wafer::getWireBonds() const { return wire_bonds_; }
 const std::vector<std::pair<std::string, double>>& Wafer::getElectricalProperties() const { return electrical_properties_; }
-const Eigen::ArrayXXd& Wafer::getTemperatureProfile() const { return temperature_profile_; }
-const Eigen::ArrayXXd& Wafer::getThermalConductivity() const { return thermal_conductivity_; }
-const Eigen::ArrayXXd& Wafer::getElectromigrationMTTF() const { return electromigration_mttf_; } // NEW
-const Eigen::ArrayXXd& Wafer::getThermalStress() const { return thermal_stress_; } // NEW
-const Eigen::ArrayXXd& Wafer::getDielectricField() const { return dielectric_field_; } // NEW
+ConstFieldView Wafer::getTemperatureProfile() const { return fields_.view(kTemperatureField); }
+ConstFieldView Wafer::getThermalConductivity() const { return fields_.view(kThermalConductivityField); }
+ConstFieldView Wafer::getElectromigrationMTTF() const { return fields_.view(kElectromigrationMTTFField); } // NEW
+ConstFieldView Wafer::getThermalStress() const { return fields_.view(kThermalStressField); } // NEW
+ConstFieldView Wafer::getDielectricField() const { return fields_.view(kDielectricFieldField); } // NEW
 std::string Wafer::getMaterialId() const { return material_id_; }
 double Wafer::getDiameter() const { return diameter_; }
 double Wafer::getThickness() const { return thickness_; }
\ No newline at end of file
@@ -1,5 +1,8 @@
 // Author: Dr. Mazharuddin Mohammed
 #pragma once
+#include "field_store.hpp"
+#include "bit_mask.hpp"
+#include "depth_mesh.hpp"
 #include <Eigen/Dense>
 #include <vector>
 #include <string>
@@ -7,29 +10,61 @@
 
 class Wafer {
 public:
+  // Fixed channels of the wafer field store, registered in this order.
+  enum FieldChannel {
+    kGridField = 0,
+    kPhotoresistField,
+    kTemperatureField,
+    kThermalConductivityField,
+    kElectromigrationMTTFField,
+    kThermalStressField,
+    kDielectricFieldField,
+    kNumFieldChannels
+  };
+
   Wafer(double diameter, double thickness, const std::string& material_id);
+  // Both fill the fields in parallel, in the column partition the field
+  // kernels use (see FieldStore), so each thread first touches its memory
   void initializeGrid(int x_dim, int y_dim);
   void applyLayer(double thickness, const std::string& material_id);
   void setDopantProfile(const Eigen::ArrayXd& profile);
-  void setPhotoresistPattern(const Eigen::ArrayXXd& pattern);
+  // Dopant profile on a depth mesh (um from the surface). The uniform
+  // profile, one value per grid row over the thickness, is then remapped
+  // from it; setting or editing the uniform profile makes it the mesh's.
+  void setDopantProfile(const DepthMesh& mesh, const Eigen::ArrayXd& profile);
+  const DepthMesh& getDopantMesh() const;
+  const Eigen::ArrayXd& getDopantMeshProfile() const;
+  double getDopantConcentration(double depth) const;
+  void setPhotoresistPattern(const Eigen::Ref<const Eigen::ArrayXXd>& pattern);
+  // Bit-packed photoresist (set = resist present). Setting the mask defers
+  // the dense 0/1 pattern until getPhotoresistPattern() is first called.
+  void setPhotoresistMask(BitMask mask);
+  const BitMask& getPhotoresistMask() const;
   void addFilmLayer(double thickness, const std::string& material);
   void addMetalLayer(double thickness, const std::string& metal);
   void addPackaging(double substrate_thickness, const std::string& substrate_material,
                     const std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>>& wire_bonds);
   void setElectricalProperties(const std::vector<std::pair<std::string, double>>& properties);
-  void setTemperatureProfile(const Eigen::ArrayXXd& temperature);
-  void setThermalConductivity(const Eigen::ArrayXXd& conductivity);
-  void setElectromigrationMTTF(const Eigen::ArrayXXd& mttf); // NEW
-  void setThermalStress(const Eigen::ArrayXXd& stress); // NEW
-  void setDielectricField(const Eigen::ArrayXXd& field); // NEW
-  void updateGrid(const Eigen::ArrayXXd& new_grid);
-  void setGrid(const Eigen::ArrayXXd& new_grid);
-  Eigen::ArrayXXd& getGrid();
-  const Eigen::ArrayXXd& getGrid() const;
+  void setTemperatureProfile(const Eigen::Ref<const Eigen::ArrayXXd>& temperature);
+  void setThermalConductivity(const Eigen::Ref<const Eigen::ArrayXXd>& conductivity);
+  void setElectromigrationMTTF(const Eigen::Ref<const Eigen::ArrayXXd>& mttf); // NEW
+  void setThermalStress(const Eigen::Ref<const Eigen::ArrayXXd>& stress); // NEW
+  void setDielectricField(const Eigen::Ref<const Eigen::ArrayXXd>& field); // NEW
+  // Replacing the grid with one of a different shape reshapes the field
+  // store and resets every other field to its default. Models that only
+  // adjust heights should mutate getGrid() in place instead.
+  void updateGrid(const Eigen::Ref<const Eigen::ArrayXXd>& new_grid);
+  void updateGrid(Eigen::ArrayXXd&& new_grid); // Releases new_grid's buffer
+  void setGrid(const Eigen::Ref<const Eigen::ArrayXXd>& new_grid);
+  // Copy-on-write snapshot for history/undo: free until the field changes.
+  FieldSnapshot snapshotField(FieldChannel channel) const;
+  FieldSnapshot snapshotGrid() const { return snapshotField(kGridField); }
+  FieldView getGrid();
+  ConstFieldView getGrid() const;
   Eigen::ArrayXd& getDopantProfile();
   const Eigen::ArrayXd& getDopantProfile() const;
-  Eigen::ArrayXXd& getPhotoresistPattern();
-  const Eigen::ArrayXXd& getPhotoresistPattern() const;
+  FieldView getPhotoresistPattern();
+  ConstFieldView getPhotoresistPattern() const;
   std::vector<std::pair<double, std::string>>& getFilmLayers();
   const std::vector<std::pair<double, std::string>>& getFilmLayers() const;
   std::vector<std::pair<double, std::string>>& getMetalLayers();
@@ -37,30 +72,38 @@ public:
   std::pair<double, std::string> getPackagingSubstrate() const;
   const std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>>& getWireBonds() const;
   const std::vector<std::pair<std::string, double>>& getElectricalProperties() const;
-  const Eigen::ArrayXXd& getTemperatureProfile() const;
-  const Eigen::ArrayXXd& getThermalConductivity() const;
-  const Eigen::ArrayXXd& getElectromigrationMTTF() const; // NEW
-  const Eigen::ArrayXXd& getThermalStress() const; // NEW
-  const Eigen::ArrayXXd& getDielectricField() const; // NEW
+  ConstFieldView getTemperatureProfile() const;
+  ConstFieldView getThermalConductivity() const;
+  ConstFieldView getElectromigrationMTTF() const; // NEW
+  ConstFieldView getThermalStress() const; // NEW
+  ConstFieldView getDielectricField() const; // NEW
   std::string getMaterialId() const;
   double getDiameter() const;
   double getThickness() const;
+  FieldStore& getFieldStore() { return fields_; }
+  const FieldStore& getFieldStore() const { return fields_; }
 
 protected:
   double diameter_;
   double thickness_;
   std::string material_id_;
-  Eigen::ArrayXXd grid_;
+  FieldStore fields_;
+  void syncPhotoresistPattern() const;
+  void resetPhotoresistMask();
+
+  // The photoresist exists as a bit mask, a dense field, or both; whichever
+  // is stale is rebuilt from the other on access.
+  mutable BitMask photoresist_mask_;
+  mutable bool photoresist_mask_valid_ = false;
+  mutable bool photoresist_dense_stale_ = false;
   Eigen::ArrayXd dopant_profile_;
-  Eigen::ArrayXXd photoresist_pattern_;
+  // Rebuilt from dopant_profile_ on access when not valid
+  mutable DepthMesh dopant_mesh_;
+  mutable Eigen::ArrayXd dopant_mesh_profile_;
+  mutable bool dopant_mesh_valid_ = false;
   std::vector<std::pair<double, std::string>> film_layers_;
   std::vector<std::pair<double, std::string>> metal_layers_;
   std::pair<double, std::string> packaging_substrate_;
   std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>> wire_bonds_;
   std::vector<std::pair<std::string, double>> electrical_properties_;
-  Eigen::ArrayXXd temperature_profile_;
-  Eigen::ArrayXXd thermal_conductivity_;
-  Eigen::ArrayXXd electromigration_mttf_; // NEW
-  Eigen::ArrayXXd thermal_stress_; // NEW
-  Eigen::ArrayXXd dielectric_field_; // NEW
 };
\ No newline at end of file
@@ -1,14 +1,22 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "wafer_enhanced.hpp"
 #include "utils.hpp"
+#include "task_scheduler.hpp"
+#include "stencil.hpp"
 #include <algorithm>
 #include <fstream>
 #include <thread>
 #include <future>
 #include <execution>
+#include <stdexcept>
 
 WaferEnhanced::WaferEnhanced(double diameter, double thickness, const std::string& material)
-    : Wafer(diameter, thickness, material) {
+    : Wafer(diameter, thickness, material),
+      stress_channel_(fields_.registerChannel("stress", 0.0, false, FieldPrecision::FLOAT32)),
+      strain_channel_(fields_.registerChannel("strain", 0.0, false, FieldPrecision::FLOAT32)),
+      temperature_channel_(fields_.registerChannel("lattice_temperature", 300.0, false,
+                                                   FieldPrecision::FLOAT32)),  // Room temperature
+      temperature_pattern_channel_(fields_.registerChannel("lattice_temperature_pattern", 0.0, true)) {
     
     // Initialize enhanced features
     crystal_structure_ = DIAMOND;  // Default for silicon
@@ -20,34 +28,31 @@ WaferEnhanced::WaferEnhanced(double diameter, double thickness, const std::strin
 void WaferEnhanced::initializeGridParallel(int rows, int cols) {
     std::lock_guard<std::mutex> lock(data_mutex_);
     
-    // Call base class initialization
+    // Resets the enhanced fields too, which live in the same store
     Wafer::initializeGrid(rows, cols);
     
-    // Initialize enhanced fields
-    stress_field_ = Eigen::ArrayXXd::Zero(rows, cols);
-    strain_field_ = Eigen::ArrayXXd::Zero(rows, cols);
-    temperature_field_ = Eigen::ArrayXXd::Constant(rows, cols, 300.0);  // Room temperature
-    
     Logger::getInstance().log("Enhanced grid initialized: " + std::to_string(rows) + 
                              "x" + std::to_string(cols));
 }
 
 void WaferEnhanced::updateGridParallel(const Eigen::ArrayXXd& new_grid) {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    
-    if (new_grid.rows() != grid_.rows() || new_grid.cols() != grid_.cols()) {
-        throw std::invalid_argument("Grid dimensions mismatch");
-    }
-    
-    // Parallel update using OpenMP if available
-    #pragma omp parallel for
-    for (int i = 0; i < new_grid.rows(); ++i) {
-        for (int j = 0; j < new_grid.cols(); ++j) {
-            grid_(i, j) = new_grid(i, j);
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        
+        if (new_grid.rows() != fields_.rows() || new_grid.cols() != fields_.cols()) {
+            throw std::invalid_argument("Grid dimensions mismatch");
         }
+        
+        // Parallel update, one column range per chunk
+        FieldView grid = getGrid();
+        TaskScheduler::getInstance().parallelFor(0, static_cast<int>(new_grid.cols()), [&](int j0, int j1) {
+            for (int j = j0; j < j1; ++j) {
+                grid.col(j) = new_grid.col(j);
+            }
+        });
     }
     
-    // Update dependent fields
+    // Update dependent fields, which take the lock themselves
     calculateStress();
     calculateStrain();
 }
@@ -55,10 +60,10 @@ void WaferEnhanced::updateGridParallel(const Eigen::ArrayXXd& new_grid) {
 void WaferEnhanced::addLayer(const std::string& material, double thickness) {
     std::lock_guard<std::mutex> lock(data_mutex_);
     
-    int rows = grid_.rows();
-    int cols = grid_.cols();
+    int rows = fields_.rows();
+    int cols = fields_.cols();
     
-    layers_.emplace_back(material, thickness, rows, cols);
+    layers_.write().emplace_back(material, thickness, rows, cols);
     
     // Update stress field
     updateStressFromLayers();
@@ -70,12 +75,13 @@ void WaferEnhanced::addLayer(const std::string& material, double thickness) {
 void WaferEnhanced::removeLayer(size_t index) {
     std::lock_guard<std::mutex> lock(data_mutex_);
     
-    if (index >= layers_.size()) {
+    if (index >= layers_->size()) {
         throw std::out_of_range("Layer index out of range");
     }
     
-    std::string material = layers_[index].material;
-    layers_.erase(layers_.begin() + index);
+    std::string material = (*layers_)[index].material;
+    std::vector<Layer>& layers = layers_.write();
+    layers.erase(layers.begin() + index);
     
     // Update stress field
     updateStressFromLayers();
@@ -86,15 +92,18 @@ void WaferEnhanced::removeLayer(size_t index) {
 void WaferEnhanced::setDopantProfileMultiLayer(const std::vector<Eigen::ArrayXXd>& profiles) {
     std::lock_guard<std::mutex> lock(data_mutex_);
     
-    if (profiles.size() != layers_.size()) {
+    if (profiles.size() != layers_->size()) {
         throw std::invalid_argument("Number of profiles must match number of layers");
     }
     
-    for (size_t i = 0; i < profiles.size(); ++i) {
-        if (profiles[i].rows() != grid_.rows() || profiles[i].cols() != grid_.cols()) {
+    for (const auto& profile : profiles) {
+        if (profile.rows() != fields_.rows() || profile.cols() != fields_.cols()) {
             throw std::invalid_argument("Profile dimensions must match grid dimensions");
         }
-        layers_[i].composition = profiles[i];
+    }
+    std::vector<Layer>& layers = layers_.write();
+    for (size_t i = 0; i < profiles.size(); ++i) {
+        layers[i].composition = profiles[i];
     }
     
     Logger::getInstance().log("Updated multi-layer dopant profiles");
@@ -105,7 +114,7 @@ Eigen::ArrayXXd WaferEnhanced::getDopantProfileAtDepth(double depth) const {
     
     // Find the layer at the specified depth
     double current_depth = 0.0;
-    for (const auto& layer : layers_) {
+    for (const auto& layer : *layers_) {
         if (depth <= current_depth + layer.thickness) {
             return layer.composition;
         }
@@ -113,25 +122,22 @@ Eigen::ArrayXXd WaferEnhanced::getDopantProfileAtDepth(double depth) const {
     }
     
     // Return zero profile if depth exceeds all layers
-    return Eigen::ArrayXXd::Zero(grid_.rows(), grid_.cols());
+    return Eigen::ArrayXXd::Zero(fields_.rows(), fields_.cols());
 }
 
 void WaferEnhanced::calculateStress() {
     std::lock_guard<std::mutex> lock(data_mutex_);
     
-    stress_field_.setZero();
-    
     // Calculate stress from thermal expansion
     const double reference_temp = 300.0;  // Room temperature
     const double thermal_expansion_coeff = 2.6e-6;  // Silicon
     
-    #pragma omp parallel for
-    for (int i = 0; i < stress_field_.rows(); ++i) {
-        for (int j = 0; j < stress_field_.cols(); ++j) {
-            double temp_diff = temperature_field_(i, j) - reference_temp;
-            stress_field_(i, j) = thermal_expansion_coeff * temp_diff * 1e9;  // Convert to Pa
-        }
-    }
+    FieldView stress = fields_.view(stress_channel_);
+    const ConstFieldView temperature = static_cast<const FieldStore&>(fields_).view(temperature_channel_);
+    processGridBlocks([&](int r0, int c0, int h, int w) {
+        stress.block(r0, c0, h, w) =
+            thermal_expansion_coeff * (temperature.block(r0, c0, h, w) - reference_temp) * 1e9;  // Convert to Pa
+    });
     
     // Add stress from layers
     updateStressFromLayers();
@@ -143,77 +149,240 @@ void WaferEnhanced::calculateStrain() {
     // Calculate strain from stress using elastic modulus
     const double elastic_modulus = 130e9;  // Silicon elastic modulus in Pa
     
-    strain_field_ = stress_field_ / elastic_modulus;
+    fields_.view(strain_channel_) = getStressField() / elastic_modulus;
 }
 
 void WaferEnhanced::addDefect(const Defect& defect) {
     std::lock_guard<std::mutex> lock(data_mutex_);
     
-    defects_.push_back(defect);
+    defects_.write().push_back(defect);
     
     Logger::getInstance().log("Added defect at (" + std::to_string(defect.x) + 
                              ", " + std::to_string(defect.y) + ", " + std::to_string(defect.z) + ")");
 }
 
+PointGrid WaferEnhanced::getDefectGrid(double cell_size) const {
+    std::vector<PointGrid::Point> positions;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        positions.reserve(defects_->size());
+        for (const auto& defect : *defects_) {
+            positions.push_back({defect.x, defect.y});
+        }
+    }
+    return PointGrid(positions, cell_size);
+}
+
 void WaferEnhanced::removeDefect(size_t index) {
     std::lock_guard<std::mutex> lock(data_mutex_);
     
-    if (index >= defects_.size()) {
+    if (index >= defects_->size()) {
         throw std::out_of_range("Defect index out of range");
     }
     
-    defects_.erase(defects_.begin() + index);
+    std::vector<Defect>& defects = defects_.write();
+    defects.erase(defects.begin() + index);
     Logger::getInstance().log("Removed defect at index " + std::to_string(index));
 }
 
 void WaferEnhanced::setTemperatureField(const Eigen::ArrayXXd& temperature) {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    
-    if (temperature.rows() != grid_.rows() || temperature.cols() != grid_.cols()) {
-        throw std::invalid_argument("Temperature field dimensions must match grid dimensions");
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        
+        if (temperature.rows() != fields_.rows() || temperature.cols() != fields_.cols()) {
+            throw std::invalid_argument("Temperature field dimensions must match grid dimensions");
+        }
+        
+        fields_.assign(temperature_channel_, temperature);
     }
     
-    temperature_field_ = temperature;
-    
-    // Recalculate stress due to temperature change
+    // Recalculate stress due to temperature change; both take the lock
     calculateStress();
     calculateStrain();
     
     Logger::getInstance().log("Updated temperature field");
 }
 
+void WaferEnhanced::setTemperaturePattern(double base, double amplitude,
+                                          const std::function<void(int, int, int, int, FieldView&)>& kernel) {
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        FieldView pattern = fields_.view(temperature_pattern_channel_);
+        FieldView temperature = fields_.view(temperature_channel_);
+        processGridBlocks([&](int r0, int c0, int h, int w) {
+            kernel(r0, c0, h, w, pattern);
+            temperature.block(r0, c0, h, w) = base + amplitude * pattern.block(r0, c0, h, w);
+        });
+    }
+    calculateStress();
+    calculateStrain();
+}
+
+void WaferEnhanced::scaleTemperaturePattern(double base, double amplitude) {
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        const ConstFieldView pattern = static_cast<const FieldStore&>(fields_).view(temperature_pattern_channel_);
+        FieldView temperature = fields_.view(temperature_channel_);
+        processGridBlocks([&](int r0, int c0, int h, int w) {
+            temperature.block(r0, c0, h, w) = base + amplitude * pattern.block(r0, c0, h, w);
+        });
+    }
+    calculateStress();
+    calculateStrain();
+}
+
 void WaferEnhanced::recordProcessStep(const ProcessStep& step) {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    
-    process_history_.push_back(step);
+    std::lock_guard<std::mutex> history_lock(history_mutex_);
+    std::size_t index;
+    bool keep_state;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        process_history_.write().push_back(step);
+        index = process_history_->size() - 1;
+        keep_state = state_history_ != nullptr;
+    }
+    if (keep_state) {
+        // The image includes the step just recorded
+        std::vector<unsigned char> image = stateImage();
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        if (state_history_) {
+            state_history_->append(image);
+            state_steps_.push_back(index);
+        }
+    }
     
     Logger::getInstance().log("Recorded process step: " + step.operation);
 }
 
-bool WaferEnhanced::validateIntegrity() const {
+void WaferEnhanced::enableStateHistory(bool enable, std::size_t keyframe_interval) {
+    std::lock_guard<std::mutex> history_lock(history_mutex_);
     std::lock_guard<std::mutex> lock(data_mutex_);
-    
-    // Check grid consistency
-    if (grid_.rows() <= 0 || grid_.cols() <= 0) {
-        return false;
+    state_history_ = enable ? std::make_unique<StateHistory>(keyframe_interval) : nullptr;
+    state_steps_.clear();
+}
+
+std::size_t WaferEnhanced::getStateHistorySize() const {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    return state_steps_.size();
+}
+
+std::size_t WaferEnhanced::getStateHistoryStep(std::size_t index) const {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    return state_steps_.at(index);
+}
+
+std::shared_ptr<WaferEnhanced> WaferEnhanced::getStateAfterStep(std::size_t step) const {
+    std::vector<unsigned char> image;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        auto it = std::lower_bound(state_steps_.begin(), state_steps_.end(), step);
+        if (!state_history_ || it == state_steps_.end() || *it != step) {
+            throw std::out_of_range("No wafer state kept for process step " + std::to_string(step));
+        }
+        image = state_history_->at(static_cast<std::size_t>(it - state_steps_.begin()));
     }
-    
-    // Check field dimensions
-    if (stress_field_.rows() != grid_.rows() || stress_field_.cols() != grid_.cols()) {
-        return false;
+    auto wafer = std::make_shared<WaferEnhanced>(getDiameter(), getThickness(), getMaterialId());
+    wafer->readStateImage(std::move(image));
+    return wafer;
+}
+
+WaferEnhanced::WaferEnhanced(const WaferEnhanced& other, const std::lock_guard<std::mutex>&)
+    : Wafer(other),
+      layers_(other.layers_),
+      defects_(other.defects_),
+      process_history_(other.process_history_),
+      stress_channel_(other.stress_channel_),
+      strain_channel_(other.strain_channel_),
+      temperature_channel_(other.temperature_channel_),
+      temperature_pattern_channel_(other.temperature_pattern_channel_),
+      crystal_structure_(other.crystal_structure_),
+      tiled_mode_(other.tiled_mode_),
+      tile_size_(other.tile_size_),
+      tile_halo_(other.tile_halo_),
+      profiling_enabled_(other.profiling_enabled_.load()) {}
+
+std::shared_ptr<WaferEnhanced> WaferEnhanced::clone() const {
+    // Member-wise: the field store and the containers share their storage
+    // with this wafer, where a state image round trip copied every cell
+    return std::shared_ptr<WaferEnhanced>(new WaferEnhanced(*this, std::lock_guard<std::mutex>(data_mutex_)));
+}
+
+namespace {
+
+// Means of factor x factor blocks, those at the far edges cut short
+Eigen::ArrayXXd blockMean(const Eigen::Ref<const Eigen::ArrayXXd>& fine, int factor) {
+    const Eigen::Index rows = (fine.rows() + factor - 1) / factor;
+    const Eigen::Index cols = (fine.cols() + factor - 1) / factor;
+    Eigen::ArrayXXd coarse(rows, cols);
+    for (Eigen::Index c = 0; c < cols; ++c) {
+        const Eigen::Index c0 = c * factor, nc = std::min<Eigen::Index>(factor, fine.cols() - c0);
+        for (Eigen::Index r = 0; r < rows; ++r) {
+            const Eigen::Index r0 = r * factor, nr = std::min<Eigen::Index>(factor, fine.rows() - r0);
+            coarse(r, c) = fine.block(r0, c0, nr, nc).mean();
+        }
     }
-    
-    if (strain_field_.rows() != grid_.rows() || strain_field_.cols() != grid_.cols()) {
-        return false;
+    return coarse;
+}
+
+} // namespace
+
+std::shared_ptr<WaferEnhanced> WaferEnhanced::coarsened(int max_cells) const {
+    if (max_cells < 1) {
+        throw std::invalid_argument("Coarse grid needs at least one cell along each side");
+    }
+    std::shared_ptr<WaferEnhanced> coarse = clone();
+    WaferEnhanced& wafer = *coarse;
+    const int rows = wafer.fields_.rows();
+    const int cols = wafer.fields_.cols();
+    const int factor = (std::max(rows, cols) + max_cells - 1) / max_cells;
+    if (factor <= 1) {
+        return coarse;
     }
+
+    // Averaged before the reshape, which resets every channel
+    wafer.syncPhotoresistPattern();
+    std::vector<std::pair<int, Eigen::ArrayXXd>> channels;
+    for (int c = 0; c < wafer.fields_.channelCount(); ++c) {
+        if (wafer.fields_.isMaterialized(c)) {
+            channels.emplace_back(c, blockMean(wafer.fields_.view(c), factor));
+        }
+    }
+    // The uniform dopant profile has one value per grid row
+    Eigen::ArrayXd dopant = wafer.dopant_profile_;
+    if (dopant.size() == rows) {
+        dopant = blockMean(wafer.dopant_profile_, factor).col(0);
+    }
+    std::vector<Layer> layers = *wafer.layers_;
+    for (auto& layer : layers) {
+        if (layer.composition.rows() == rows && layer.composition.cols() == cols) {
+            layer.composition = blockMean(layer.composition, factor);
+        }
+    }
+
+    wafer.Wafer::initializeGrid((rows + factor - 1) / factor, (cols + factor - 1) / factor);
+    for (const auto& channel : channels) {
+        if (channel.first == kPhotoresistField) {
+            wafer.setPhotoresistPattern((channel.second >= 0.5).cast<double>());
+        } else {
+            wafer.fields_.assign(channel.first, channel.second);
+        }
+    }
+    wafer.dopant_profile_ = std::move(dopant);
+    wafer.layers_ = CopyOnWrite<std::vector<Layer>>(std::move(layers));
+    return coarse;
+}
+
+bool WaferEnhanced::validateIntegrity() const {
+    std::lock_guard<std::mutex> lock(data_mutex_);
     
-    if (temperature_field_.rows() != grid_.rows() || temperature_field_.cols() != grid_.cols()) {
+    // Check grid consistency
+    if (fields_.rows() <= 0 || fields_.cols() <= 0) {
         return false;
     }
     
     // Check layer consistency
-    for (const auto& layer : layers_) {
-        if (layer.composition.rows() != grid_.rows() || layer.composition.cols() != grid_.cols()) {
+    for (const auto& layer : *layers_) {
+        if (layer.composition.rows() != fields_.rows() || layer.composition.cols() != fields_.cols()) {
             return false;
         }
         if (layer.thickness <= 0.0) {
@@ -222,7 +391,7 @@ bool WaferEnhanced::validateIntegrity() const {
     }
     
     // Check defect positions
-    for (const auto& defect : defects_) {
+    for (const auto& defect : *defects_) {
         if (defect.x < 0 || defect.x >= getDiameter() ||
             defect.y < 0 || defect.y >= getDiameter() ||
             defect.z < 0 || defect.z >= getThickness()) {
@@ -239,27 +408,14 @@ std::vector<std::string> WaferEnhanced::getValidationErrors() const {
     std::lock_guard<std::mutex> lock(data_mutex_);
     
     // Check grid
-    if (grid_.rows() <= 0 || grid_.cols() <= 0) {
+    if (fields_.rows() <= 0 || fields_.cols() <= 0) {
         errors.push_back("Invalid grid dimensions");
     }
     
-    // Check fields
-    if (stress_field_.rows() != grid_.rows() || stress_field_.cols() != grid_.cols()) {
-        errors.push_back("Stress field dimension mismatch");
-    }
-    
-    if (strain_field_.rows() != grid_.rows() || strain_field_.cols() != grid_.cols()) {
-        errors.push_back("Strain field dimension mismatch");
-    }
-    
-    if (temperature_field_.rows() != grid_.rows() || temperature_field_.cols() != grid_.cols()) {
-        errors.push_back("Temperature field dimension mismatch");
-    }
-    
     // Check layers
-    for (size_t i = 0; i < layers_.size(); ++i) {
-        const auto& layer = layers_[i];
-        if (layer.composition.rows() != grid_.rows() || layer.composition.cols() != grid_.cols()) {
+    for (size_t i = 0; i < layers_->size(); ++i) {
+        const auto& layer = (*layers_)[i];
+        if (layer.composition.rows() != fields_.rows() || layer.composition.cols() != fields_.cols()) {
             errors.push_back("Layer " + std::to_string(i) + " composition dimension mismatch");
         }
         if (layer.thickness <= 0.0) {
@@ -268,8 +424,8 @@ std::vector<std::string> WaferEnhanced::getValidationErrors() const {
     }
     
     // Check defects
-    for (size_t i = 0; i < defects_.size(); ++i) {
-        const auto& defect = defects_[i];
+    for (size_t i = 0; i < defects_->size(); ++i) {
+        const auto& defect = (*defects_)[i];
         if (defect.x < 0 || defect.x >= getDiameter() ||
             defect.y < 0 || defect.y >= getDiameter() ||
             defect.z < 0 || defect.z >= getThickness()) {
@@ -280,162 +436,354 @@ std::vector<std::string> WaferEnhanced::getValidationErrors() const {
     return errors;
 }
 
+namespace {
+
+// Tag of the wafer chunk in a file written by WaferEnhanced::saveToFile,
+// and of the one chunk of an in-memory state image.
+constexpr std::uint32_t kWaferFileChunk = checkpointTag('W', 'F', 'E', 'R');
+// The state history, when one is kept
+constexpr std::uint32_t kStateHistoryChunk = checkpointTag('W', 'H', 'S', 'T');
+
+} // namespace
+
 void WaferEnhanced::saveToFile(const std::string& filename) const {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    
-    std::ofstream file(filename, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error("Cannot open file for writing: " + filename);
-    }
-    
-    // Save basic wafer properties
-    file.write(reinterpret_cast<const char*>(&diameter_), sizeof(diameter_));
-    file.write(reinterpret_cast<const char*>(&thickness_), sizeof(thickness_));
-    
-    // Save material name
-    size_t material_size = material_id_.size();
-    file.write(reinterpret_cast<const char*>(&material_size), sizeof(material_size));
-    file.write(material_id_.c_str(), material_size);
-    
-    // Save grid dimensions
-    int rows = grid_.rows();
-    int cols = grid_.cols();
-    file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
-    file.write(reinterpret_cast<const char*>(&cols), sizeof(cols));
-    
-    // Save grid data
-    file.write(reinterpret_cast<const char*>(grid_.data()), rows * cols * sizeof(double));
-    
-    // Save enhanced fields
-    file.write(reinterpret_cast<const char*>(stress_field_.data()), rows * cols * sizeof(double));
-    file.write(reinterpret_cast<const char*>(strain_field_.data()), rows * cols * sizeof(double));
-    file.write(reinterpret_cast<const char*>(temperature_field_.data()), rows * cols * sizeof(double));
-    
-    // Save crystal structure
-    file.write(reinterpret_cast<const char*>(&crystal_structure_), sizeof(crystal_structure_));
-    
-    // Save layers
-    size_t layer_count = layers_.size();
-    file.write(reinterpret_cast<const char*>(&layer_count), sizeof(layer_count));
-    
-    for (const auto& layer : layers_) {
-        // Save layer material
-        size_t mat_size = layer.material.size();
-        file.write(reinterpret_cast<const char*>(&mat_size), sizeof(mat_size));
-        file.write(layer.material.c_str(), mat_size);
-        
-        // Save layer thickness
-        file.write(reinterpret_cast<const char*>(&layer.thickness), sizeof(layer.thickness));
-        
-        // Save layer composition
-        file.write(reinterpret_cast<const char*>(layer.composition.data()), rows * cols * sizeof(double));
-    }
-    
-    // Save defects
-    size_t defect_count = defects_.size();
-    file.write(reinterpret_cast<const char*>(&defect_count), sizeof(defect_count));
-    
-    for (const auto& defect : defects_) {
-        file.write(reinterpret_cast<const char*>(&defect), sizeof(defect));
+    // Page-aligned blocks: a later loadFromFile maps the field store
+    // straight from disk and only pages in what the simulation touches.
+    CheckpointWriter out(filename, CheckpointWriter::pageAlignment());
+    out.beginChunk(kWaferFileChunk);
+    writeCheckpoint(out);
+    out.endChunk();
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        if (state_history_) {
+            out.beginChunk(kStateHistoryChunk);
+            out.write(static_cast<std::uint64_t>(state_steps_.size()));
+            for (std::size_t step : state_steps_) {
+                out.write(static_cast<std::uint64_t>(step));
+            }
+            state_history_->write(out);
+            out.endChunk();
+        }
     }
+    out.finish();
     
     Logger::getInstance().log("Wafer saved to file: " + filename);
 }
 
 void WaferEnhanced::loadFromFile(const std::string& filename) {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error("Cannot open file for reading: " + filename);
+    CheckpointReader in(filename, true);
+    const CheckpointReader::Chunk* wafer_chunk = nullptr;
+    std::unique_ptr<StateHistory> states;
+    std::vector<std::size_t> state_steps;
+    for (const auto& chunk : in.chunks()) {
+        if (chunk.tag == kWaferFileChunk && !wafer_chunk) {
+            wafer_chunk = &chunk;
+        } else if (chunk.tag == kStateHistoryChunk) {
+            auto cursor = in.cursor(chunk);
+            state_steps.resize(static_cast<std::size_t>(cursor.read<std::uint64_t>()));
+            for (auto& step : state_steps) {
+                step = static_cast<std::size_t>(cursor.read<std::uint64_t>());
+            }
+            states = std::make_unique<StateHistory>();
+            states->read(cursor);
+            if (states->size() != state_steps.size()) {
+                throw std::runtime_error("State history does not match its step index in file: " + filename);
+            }
+        }
     }
-    
-    // Load basic wafer properties
-    file.read(reinterpret_cast<char*>(&diameter_), sizeof(diameter_));
-    file.read(reinterpret_cast<char*>(&thickness_), sizeof(thickness_));
-    
-    // Load material name
-    size_t material_size;
-    file.read(reinterpret_cast<char*>(&material_size), sizeof(material_size));
-    material_id_.resize(material_size);
-    file.read(&material_id_[0], material_size);
-    
-    // Load grid dimensions
-    int rows, cols;
-    file.read(reinterpret_cast<char*>(&rows), sizeof(rows));
-    file.read(reinterpret_cast<char*>(&cols), sizeof(cols));
-    
-    // Resize arrays
-    grid_.resize(rows, cols);
-    stress_field_.resize(rows, cols);
-    strain_field_.resize(rows, cols);
-    temperature_field_.resize(rows, cols);
-    
-    // Load grid data
-    file.read(reinterpret_cast<char*>(grid_.data()), rows * cols * sizeof(double));
-    
-    // Load enhanced fields
-    file.read(reinterpret_cast<char*>(stress_field_.data()), rows * cols * sizeof(double));
-    file.read(reinterpret_cast<char*>(strain_field_.data()), rows * cols * sizeof(double));
-    file.read(reinterpret_cast<char*>(temperature_field_.data()), rows * cols * sizeof(double));
-    
-    // Load crystal structure
-    file.read(reinterpret_cast<char*>(&crystal_structure_), sizeof(crystal_structure_));
-    
-    // Load layers
-    size_t layer_count;
-    file.read(reinterpret_cast<char*>(&layer_count), sizeof(layer_count));
-    
-    layers_.clear();
-    layers_.reserve(layer_count);
-    
-    for (size_t i = 0; i < layer_count; ++i) {
-        // Load layer material
-        size_t mat_size;
-        file.read(reinterpret_cast<char*>(&mat_size), sizeof(mat_size));
-        std::string material(mat_size, '\0');
-        file.read(&material[0], mat_size);
-        
-        // Load layer thickness
-        double thickness;
-        file.read(reinterpret_cast<char*>(&thickness), sizeof(thickness));
-        
-        // Create layer
-        layers_.emplace_back(material, thickness, rows, cols);
-        
-        // Load layer composition
-        file.read(reinterpret_cast<char*>(layers_.back().composition.data()), rows * cols * sizeof(double));
+    if (!wafer_chunk) {
+        throw std::runtime_error("No wafer record in file: " + filename);
     }
-    
-    // Load defects
-    size_t defect_count;
-    file.read(reinterpret_cast<char*>(&defect_count), sizeof(defect_count));
-    
-    defects_.clear();
-    defects_.reserve(defect_count);
-    
-    for (size_t i = 0; i < defect_count; ++i) {
-        Defect defect(Defect::VACANCY, 0, 0, 0, 0);
-        file.read(reinterpret_cast<char*>(&defect), sizeof(defect));
-        defects_.push_back(defect);
+    auto cursor = in.cursor(*wafer_chunk);
+    readCheckpoint(cursor);
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        state_history_ = std::move(states);
+        state_steps_ = std::move(state_steps);
     }
-    
     Logger::getInstance().log("Wafer loaded from file: " + filename);
 }
 
-void WaferEnhanced::updateStressFromLayers() {
-    // Calculate stress contribution from each layer
-    for (const auto& layer : layers_) {
-        double layer_stress = calculateLayerStress(layer);
-        
-        // Add to stress field (simplified model)
-        #pragma omp parallel for
-        for (int i = 0; i < stress_field_.rows(); ++i) {
-            for (int j = 0; j < stress_field_.cols(); ++j) {
-                stress_field_(i, j) += layer_stress;
+std::vector<unsigned char> WaferEnhanced::stateImage() const {
+    std::vector<unsigned char> image;
+    CheckpointWriter out(image);
+    out.beginChunk(kWaferFileChunk);
+    writeCheckpoint(out);
+    out.finish();
+    return image;
+}
+
+void WaferEnhanced::readStateImage(std::vector<unsigned char> image) {
+    CheckpointReader in(std::make_shared<const std::vector<unsigned char>>(std::move(image)));
+    for (const auto& chunk : in.chunks()) {
+        if (chunk.tag == kWaferFileChunk) {
+            auto cursor = in.cursor(chunk);
+            readCheckpoint(cursor);
+            return;
+        }
+    }
+    throw std::runtime_error("Wafer state image has no wafer record");
+}
+
+void WaferEnhanced::writeCheckpoint(CheckpointWriter& out) const {
+    // Serialize a copy taken under the lock, so simulation threads wait
+    // for an in-memory copy rather than for the disk.
+    std::unique_lock<std::mutex> lock(data_mutex_);
+    syncPhotoresistPattern();
+    const Wafer base = *this;
+    const CopyOnWrite<std::vector<Layer>> layers = layers_;
+    const CopyOnWrite<std::vector<Defect>> defects = defects_;
+    const CopyOnWrite<std::vector<ProcessStep>> history = process_history_;
+    const CrystalStructure crystal_structure = crystal_structure_;
+    const bool tiled_mode = tiled_mode_;
+    const int tile_size = tile_size_;
+    const int tile_halo = tile_halo_;
+    lock.unlock();
+
+    out.write(base.getDiameter());
+    out.write(base.getThickness());
+    out.writeString(base.getMaterialId());
+
+    // The field store goes out as one block laid out like its arena, so a
+    // writable reader can hand the mapped block to FieldStore::adoptArena.
+    // Lazy channels that were never touched are written as zeros and come
+    // back unmaterialized.
+    const FieldStore& fields = base.getFieldStore();
+    const std::size_t cells = fields.cellCount();
+    constexpr std::size_t per_line = FieldStore::kAlignment / sizeof(double);
+    const std::size_t stride = (cells + per_line - 1) / per_line * per_line;
+    out.write(static_cast<std::int32_t>(fields.rows()));
+    out.write(static_cast<std::int32_t>(fields.cols()));
+    out.write(static_cast<std::uint32_t>(fields.channelCount()));
+    for (int c = 0; c < fields.channelCount(); ++c) {
+        out.writeString(fields.channelName(c));
+        out.write(static_cast<std::uint8_t>(fields.isMaterialized(c)));
+    }
+    out.beginBlock(static_cast<int>(stride), fields.channelCount());
+    for (int c = 0; c < fields.channelCount(); ++c) {
+        if (fields.isMaterialized(c)) {
+            out.writeBytes(fields.data(c), cells * sizeof(double));
+        } else {
+            out.writeFill(0.0, cells);
+        }
+        out.writeFill(0.0, stride - cells);
+    }
+
+    const Eigen::ArrayXd& dopant_profile = base.getDopantProfile();
+    out.writeBlock(Eigen::Map<const Eigen::ArrayXXd>(dopant_profile.data(), dopant_profile.size(), 1));
+    for (const auto* stack : {&base.getFilmLayers(), &base.getMetalLayers()}) {
+        out.write(static_cast<std::uint64_t>(stack->size()));
+        for (const auto& layer : *stack) {
+            out.write(layer.first);
+            out.writeString(layer.second);
+        }
+    }
+    out.write(base.getPackagingSubstrate().first);
+    out.writeString(base.getPackagingSubstrate().second);
+    out.write(static_cast<std::uint64_t>(base.getWireBonds().size()));
+    for (const auto& bond : base.getWireBonds()) {
+        out.write(static_cast<std::int32_t>(bond.first.first));
+        out.write(static_cast<std::int32_t>(bond.first.second));
+        out.write(static_cast<std::int32_t>(bond.second.first));
+        out.write(static_cast<std::int32_t>(bond.second.second));
+    }
+    out.write(static_cast<std::uint64_t>(base.getElectricalProperties().size()));
+    for (const auto& property : base.getElectricalProperties()) {
+        out.writeString(property.first);
+        out.write(property.second);
+    }
+
+    out.write(static_cast<std::int32_t>(crystal_structure));
+    out.write(static_cast<std::uint8_t>(tiled_mode));
+    out.write(static_cast<std::int32_t>(tile_size));
+    out.write(static_cast<std::int32_t>(tile_halo));
+
+    out.write(static_cast<std::uint64_t>(layers->size()));
+    for (const auto& layer : *layers) {
+        out.writeString(layer.material);
+        out.write(layer.thickness);
+        out.writeBlock(layer.composition);
+        out.write(static_cast<std::uint64_t>(layer.properties.size()));
+        for (const auto& property : layer.properties) {
+            out.writeString(property.first);
+            out.write(property.second);
+        }
+    }
+
+    out.write(static_cast<std::uint64_t>(defects->size()));
+    for (const auto& defect : *defects) {
+        out.write(static_cast<std::int32_t>(defect.type));
+        out.write(defect.x);
+        out.write(defect.y);
+        out.write(defect.z);
+        out.write(defect.energy);
+    }
+
+    out.write(static_cast<std::uint64_t>(history->size()));
+    for (const auto& step : *history) {
+        out.writeString(step.operation);
+        out.write(static_cast<std::int64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(step.timestamp.time_since_epoch()).count()));
+        out.write(static_cast<std::uint64_t>(step.parameters.size()));
+        for (const auto& parameter : step.parameters) {
+            out.writeString(parameter.first);
+            out.write(parameter.second);
+        }
+    }
+}
+
+void WaferEnhanced::readCheckpoint(CheckpointReader::Cursor& in) {
+    auto diameter = in.read<double>();
+    auto thickness = in.read<double>();
+    std::string material = in.readString();
+
+    int rows = in.read<std::int32_t>();
+    int cols = in.read<std::int32_t>();
+    std::vector<std::string> names(in.read<std::uint32_t>());
+    std::vector<bool> saved(names.size());
+    bool same_layout = names.size() == static_cast<std::size_t>(fields_.channelCount());
+    for (std::size_t c = 0; c < names.size(); ++c) {
+        names[c] = in.readString();
+        saved[c] = in.read<std::uint8_t>() != 0;
+        same_layout = same_layout && fields_.channelName(static_cast<int>(c)) == names[c];
+    }
+    const bool adopt = same_layout && in.reader().isWritable();
+    const ConstFieldView arena = [&]() {
+        if (!adopt) {
+            return in.readBlock();
+        }
+        FieldView block = in.readMutableBlock();
+        return ConstFieldView(block.data(), block.rows(), block.cols());
+    }();
+    const std::size_t cells = static_cast<std::size_t>(rows) * cols;
+    if (rows < 0 || cols < 0 || static_cast<std::size_t>(arena.rows()) < cells ||
+        static_cast<std::size_t>(arena.cols()) != names.size()) {
+        throw std::runtime_error("Checkpoint field store block does not match its header");
+    }
+
+    Eigen::ArrayXd dopant_profile = in.readBlock().col(0);
+    std::vector<std::pair<double, std::string>> stacks[2];
+    for (auto& stack : stacks) {
+        auto count = in.read<std::uint64_t>();
+        for (std::uint64_t i = 0; i < count; ++i) {
+            double layer_thickness = in.read<double>();
+            stack.emplace_back(layer_thickness, in.readString());
+        }
+    }
+    std::pair<double, std::string> packaging_substrate;
+    packaging_substrate.first = in.read<double>();
+    packaging_substrate.second = in.readString();
+    std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>> wire_bonds(in.read<std::uint64_t>());
+    for (auto& bond : wire_bonds) {
+        bond.first.first = in.read<std::int32_t>();
+        bond.first.second = in.read<std::int32_t>();
+        bond.second.first = in.read<std::int32_t>();
+        bond.second.second = in.read<std::int32_t>();
+    }
+    std::vector<std::pair<std::string, double>> electrical_properties;
+    auto property_count = in.read<std::uint64_t>();
+    for (std::uint64_t i = 0; i < property_count; ++i) {
+        std::string name = in.readString();
+        electrical_properties.emplace_back(name, in.read<double>());
+    }
+
+    auto crystal_structure = static_cast<CrystalStructure>(in.read<std::int32_t>());
+    bool tiled_mode = in.read<std::uint8_t>() != 0;
+    int tile_size = in.read<std::int32_t>();
+    int tile_halo = in.read<std::int32_t>();
+
+    std::vector<Layer> layers;
+    auto layer_count = in.read<std::uint64_t>();
+    for (std::uint64_t i = 0; i < layer_count; ++i) {
+        std::string layer_material = in.readString();
+        double layer_thickness = in.read<double>();
+        layers.emplace_back(layer_material, layer_thickness, 0, 0);
+        layers.back().composition = in.readBlock();
+        auto count = in.read<std::uint64_t>();
+        for (std::uint64_t p = 0; p < count; ++p) {
+            std::string name = in.readString();
+            layers.back().properties[name] = in.read<double>();
+        }
+    }
+
+    std::vector<Defect> defects;
+    auto defect_count = in.read<std::uint64_t>();
+    for (std::uint64_t i = 0; i < defect_count; ++i) {
+        auto type = static_cast<Defect::Type>(in.read<std::int32_t>());
+        double x = in.read<double>();
+        double y = in.read<double>();
+        double z = in.read<double>();
+        defects.emplace_back(type, x, y, z, in.read<double>());
+    }
+
+    std::vector<ProcessStep> history;
+    auto step_count = in.read<std::uint64_t>();
+    for (std::uint64_t i = 0; i < step_count; ++i) {
+        history.emplace_back(in.readString());
+        history.back().timestamp = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(in.read<std::int64_t>())));
+        auto count = in.read<std::uint64_t>();
+        for (std::uint64_t p = 0; p < count; ++p) {
+            std::string name = in.readString();
+            history.back().parameters[name] = in.read<double>();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    diameter_ = diameter;
+    thickness_ = thickness;
+    material_id_ = std::move(material);
+    if (adopt) {
+        // Runs on the private mapping: pages load on first touch and are
+        // copied on first write.
+        AlignedFieldBuffer mapped(const_cast<double*>(arena.data()), AlignedFieldFree{in.reader().mapping()});
+        fields_.adoptArena(rows, cols, static_cast<std::size_t>(arena.rows()), std::move(mapped), saved);
+    } else {
+        fields_.reshape(rows, cols);
+        for (int c = 0; c < fields_.channelCount(); ++c) {
+            fields_.resetChannel(c);
+        }
+        for (std::size_t c = 0; c < names.size(); ++c) {
+            // Channels this build no longer registers are dropped
+            int index = fields_.channelIndex(names[c]);
+            if (saved[c] && index >= 0) {
+                fields_.assign(index, ConstFieldView(arena.col(c).data(), rows, cols));
             }
         }
     }
+    photoresist_mask_valid_ = false;
+    photoresist_dense_stale_ = false;
+    dopant_profile_ = std::move(dopant_profile);
+    dopant_mesh_valid_ = false;
+    film_layers_ = std::move(stacks[0]);
+    metal_layers_ = std::move(stacks[1]);
+    packaging_substrate_ = std::move(packaging_substrate);
+    wire_bonds_ = std::move(wire_bonds);
+    electrical_properties_ = std::move(electrical_properties);
+    crystal_structure_ = crystal_structure;
+    tiled_mode_ = tiled_mode;
+    tile_size_ = tile_size;
+    tile_halo_ = tile_halo;
+    layers_ = CopyOnWrite<std::vector<Layer>>(std::move(layers));
+    defects_ = CopyOnWrite<std::vector<Defect>>(std::move(defects));
+    process_history_ = CopyOnWrite<std::vector<ProcessStep>>(std::move(history));
+}
+
+void WaferEnhanced::updateStressFromLayers() {
+    // Layer stresses are uniform (simplified model), so sum them and sweep
+    // the stress field once instead of once per layer
+    double layer_stress = 0.0;
+    for (const auto& layer : *layers_) {
+        layer_stress += calculateLayerStress(layer);
+    }
+    if (layer_stress == 0.0) {
+        return;
+    }
+    FieldView stress = fields_.view(stress_channel_);
+    processGridBlocks([&](int r0, int c0, int h, int w) {
+        stress.block(r0, c0, h, w) += layer_stress;
+    });
 }
 
 void WaferEnhanced::updateStrainFromStress() {
@@ -457,6 +805,76 @@ double WaferEnhanced::calculateLayerStress(const Layer& layer) const {
     return 0.0;  // Default no stress
 }
 
+void WaferEnhanced::setTiledMode(bool enabled, int tile_size, int halo) {
+    if (enabled && (tile_size <= 0 || halo < 0 || halo > tile_size)) {
+        throw std::invalid_argument("Tile size must be positive and halo must not exceed it");
+    }
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    tiled_mode_ = enabled;
+    if (enabled) {
+        tile_size_ = tile_size;
+        tile_halo_ = halo;
+    }
+}
+
+void WaferEnhanced::diffuseTemperatureField(double alpha, int steps) {
+    if (alpha < 0.0 || alpha > 0.25) {
+        throw std::invalid_argument("Diffusion number must be in [0, 0.25]");
+    }
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    int rows = fields_.rows();
+    int cols = fields_.cols();
+    if (steps <= 0 || rows == 0 || cols == 0) {
+        return;
+    }
+
+    if (tiled_mode_) {
+        TiledGrid tiles(rows, cols, tile_size_, std::max(tile_halo_, 1));
+        FieldView temperature = fields_.view(temperature_channel_);
+        tiles.load(temperature);
+        tiles.applyStencil(steps, [alpha](const TiledGrid::Tile& in, TiledGrid::Tile& out) {
+            for (int j = 0; j < in.cols; ++j) {
+                for (int i = 0; i < in.rows; ++i) {
+                    double c = in(i, j);
+                    out(i, j) = c + alpha * (in(i - 1, j) + in(i + 1, j) + in(i, j - 1) + in(i, j + 1) - 4.0 * c);
+                }
+            }
+        });
+        tiles.store(temperature);
+        return;
+    }
+
+    // Temporally blocked steps, in place on the channel
+    ExplicitStencil(ExplicitStencil::diffusion(alpha)).apply(fields_.data(temperature_channel_), rows, cols, steps);
+}
+
+void WaferEnhanced::processGridBlocks(const std::function<void(int, int, int, int)>& block) {
+    int rows = fields_.rows();
+    int cols = fields_.cols();
+    if (rows == 0 || cols == 0) {
+        return;
+    }
+    if (tiled_mode_) {
+        int tiles_down = (rows + tile_size_ - 1) / tile_size_;
+        int tiles_across = (cols + tile_size_ - 1) / tile_size_;
+        // One tile per chunk, claimed dynamically
+        TaskScheduler::getInstance().parallelFor(0, tiles_down * tiles_across, [&](int t0, int t1) {
+            for (int t = t0; t < t1; ++t) {
+                int r0 = (t % tiles_down) * tile_size_;
+                int c0 = (t / tiles_down) * tile_size_;
+                block(r0, c0, std::min(tile_size_, rows - r0), std::min(tile_size_, cols - c0));
+            }
+        }, 1);
+        return;
+    }
+    // Column-major storage: whole columns are the contiguous unit
+    TaskScheduler::getInstance().parallelFor(0, cols, [&](int j0, int j1) {
+        for (int j = j0; j < j1; ++j) {
+            block(0, j, rows, 1);
+        }
+    });
+}
+
 void WaferEnhanced::processGridChunk(int start_row, int end_row, int start_col, int end_col,
                                     std::function<void(int, int)> operation) {
     for (int i = start_row; i < end_row; ++i) {
@@ -2,8 +2,13 @@
 #define WAFER_ENHANCED_HPP
 
 #include "wafer.hpp"
+#include "tiled_grid.hpp"
+#include "checkpoint_io.hpp"
+#include "state_history.hpp"
 #include "memory_manager.hpp"
 #include "profiler.hpp"
+#include "point_grid.hpp"
+#include "copy_on_write.hpp"
 #include <unordered_set>
 #include <atomic>
 #include <thread>
@@ -15,6 +20,7 @@ public:
     virtual ~WaferEnhanced() = default;
 
     // Enhanced grid operations with parallel processing
+    // Wafer::initializeGrid under the wafer's lock
     void initializeGridParallel(int rows, int cols);
     void updateGridParallel(const Eigen::ArrayXXd& new_grid);
     
@@ -31,7 +37,7 @@ public:
     
     void addLayer(const std::string& material, double thickness);
     void removeLayer(size_t index);
-    const std::vector<Layer>& getLayers() const { return layers_; }
+    const std::vector<Layer>& getLayers() const { return *layers_; }
     
     // Advanced doping profiles
     void setDopantProfileMultiLayer(const std::vector<Eigen::ArrayXXd>& profiles);
@@ -40,8 +46,8 @@ public:
     // Stress and strain analysis
     void calculateStress();
     void calculateStrain();
-    const Eigen::ArrayXXd& getStressField() const { return stress_field_; }
-    const Eigen::ArrayXXd& getStrainField() const { return strain_field_; }
+    ConstFieldView getStressField() const { return fields_.view(stress_channel_); }
+    ConstFieldView getStrainField() const { return fields_.view(strain_channel_); }
     
     // Defect tracking
     struct Defect {
@@ -56,7 +62,10 @@ public:
     
     void addDefect(const Defect& defect);
     void removeDefect(size_t index);
-    const std::vector<Defect>& getDefects() const { return defects_; }
+    const std::vector<Defect>& getDefects() const { return *defects_; }
+    // Spatial hash of the defects' (x, y), indexed as getDefects(), for
+    // clustering and wafer-map signatures (DefectInspectionModel)
+    PointGrid getDefectGrid(double cell_size) const;
     
     // Crystal structure information
     enum CrystalStructure { DIAMOND, FCC, BCC, HCP };
@@ -65,7 +74,18 @@ public:
     
     // Temperature distribution
     void setTemperatureField(const Eigen::ArrayXXd& temperature);
-    const Eigen::ArrayXXd& getTemperatureField() const { return temperature_field_; }
+    ConstFieldView getTemperatureField() const { return fields_.view(temperature_channel_); }
+    // Temperature as base + amplitude * pattern, the pattern kept in the
+    // field store beside it. setTemperaturePattern has kernel(row, col,
+    // rows, cols, pattern) fill the pattern a block at a time, blocks in
+    // parallel as processGridBlocks deals them, and writes each block's
+    // temperature while it is still in cache; scaleTemperaturePattern only
+    // reweighs the stored pattern, one fused pass with nothing recomputed.
+    // Stress and strain follow both.
+    void setTemperaturePattern(double base, double amplitude,
+                               const std::function<void(int, int, int, int, FieldView&)>& kernel);
+    void scaleTemperaturePattern(double base, double amplitude);
+    ConstFieldView getTemperaturePattern() const { return fields_.view(temperature_pattern_channel_); }
     
     // Process history tracking
     struct ProcessStep {
@@ -78,7 +98,41 @@ public:
     };
     
     void recordProcessStep(const ProcessStep& step);
-    const std::vector<ProcessStep>& getProcessHistory() const { return process_history_; }
+    const std::vector<ProcessStep>& getProcessHistory() const { return *process_history_; }
+
+    // Optional state history: while enabled, recordProcessStep also keeps
+    // the wafer's full state after the step (see StateHistory), and
+    // saveToFile / loadFromFile carry it along. Enabling clears any
+    // states kept before.
+    void enableStateHistory(bool enable, std::size_t keyframe_interval = 16);
+    bool isStateHistoryEnabled() const { return state_history_ != nullptr; }
+    // Recorded states, oldest first, and the process history index each
+    // belongs to
+    std::size_t getStateHistorySize() const;
+    std::size_t getStateHistoryStep(std::size_t index) const;
+    // The wafer as it was after process step `step`; throws
+    // std::out_of_range if no state was kept for that step
+    std::shared_ptr<WaferEnhanced> getStateAfterStep(std::size_t step) const;
+    const StateHistory* getStateHistory() const { return state_history_.get(); }
+    // Independent copy of the wafer, for work that must not touch this one
+    // (parallel what-if evaluations, lots spawned from a template); the
+    // state history is not carried over. The copy shares the field arena,
+    // layers, defects and process history with this wafer until either
+    // writes to them, so a clone costs O(1) in the grid size.
+    std::shared_ptr<WaferEnhanced> clone() const;
+    // Copy of the wafer on a grid of at most max_cells along either side,
+    // for quick previews: each coarse cell is the mean of the block of
+    // cells it covers, the photoresist thresholded back to 0/1 and the
+    // dopant profile and layer compositions averaged alike. A wafer that
+    // is small enough already comes back as a clone(). Throws
+    // std::invalid_argument for max_cells < 1.
+    std::shared_ptr<WaferEnhanced> coarsened(int max_cells) const;
+    // The in-memory checkpoint image a state history keeps and clone()
+    // copies, also the wafer's identity for caches keyed by its state
+    std::vector<unsigned char> stateImage() const;
+    // Restores an image from stateImage(); the wafer is left untouched if
+    // the image is bad
+    void readStateImage(std::vector<unsigned char> image);
     
     // Validation and integrity checks
     bool validateIntegrity() const;
@@ -87,26 +141,61 @@ public:
     // Serialization
     void saveToFile(const std::string& filename) const;
     void loadFromFile(const std::string& filename);
-    
+
+    // Full wafer state (base wafer, field store channels, layers, defects,
+    // history) written into / read from the currently open checkpoint
+    // chunk. readCheckpoint only modifies the wafer once the whole record
+    // has been decoded.
+    void writeCheckpoint(CheckpointWriter& out) const;
+    void readCheckpoint(CheckpointReader::Cursor& in);
+    
+    // Tiled execution mode: field kernels hand each worker whole
+    // tile_size x tile_size tiles (plus halo cells for stencils) instead of
+    // raw row ranges, keeping each worker's working set in L2.
+    void setTiledMode(bool enabled, int tile_size = 64, int halo = 1);
+    bool isTiledMode() const { return tiled_mode_; }
+    int getTileSize() const { return tile_size_; }
+
+    // Explicit 5-point diffusion of the temperature field with zero-flux
+    // edges; alpha = D*dt/dx^2 and must not exceed 0.25 for stability.
+    // Does not recompute stress; call calculateStress() afterwards.
+    void diffuseTemperatureField(double alpha, int steps);
+
     // Performance monitoring
     void enableProfiling(bool enable) { profiling_enabled_ = enable; }
     bool isProfilingEnabled() const { return profiling_enabled_; }
     
 private:
-    std::vector<Layer> layers_;
-    std::vector<Defect> defects_;
-    std::vector<ProcessStep> process_history_;
-    
-    Eigen::ArrayXXd stress_field_;
-    Eigen::ArrayXXd strain_field_;
-    Eigen::ArrayXXd temperature_field_;
+    // Shared with clones until written
+    CopyOnWrite<std::vector<Layer>> layers_;
+    CopyOnWrite<std::vector<Defect>> defects_;
+    CopyOnWrite<std::vector<ProcessStep>> process_history_;
+    std::unique_ptr<StateHistory> state_history_;
+    std::vector<std::size_t> state_steps_; // Process history index per state
+    // Serializes recorders, so a step and its state are kept in order
+    std::mutex history_mutex_;
+    
+    // Enhanced fields live in the wafer's field store next to the base
+    // channels, so they share its shape, alignment and persistence.
+    int stress_channel_;
+    int strain_channel_;
+    int temperature_channel_;
+    int temperature_pattern_channel_;  // Lazy
     
     CrystalStructure crystal_structure_ = DIAMOND;
+
+    bool tiled_mode_ = false;
+    int tile_size_ = 64;
+    int tile_halo_ = 1;
     
     // Thread safety
     mutable std::mutex data_mutex_;
     std::atomic<bool> profiling_enabled_{false};
     
+
+    // clone(): copies other's state, holding its data lock
+    WaferEnhanced(const WaferEnhanced& other, const std::lock_guard<std::mutex>& other_lock);
+    
     // Helper functions
     void updateStressFromLayers();
     void updateStrainFromStress();
@@ -115,6 +204,9 @@ private:
     // Parallel processing helpers
     void processGridChunk(int start_row, int end_row, int start_col, int end_col,
                          std::function<void(int, int)> operation);
+    // Calls block(row, col, rows, cols) in parallel over the grid: one call
+    // per tile in tiled mode, otherwise one per contiguous column range.
+    void processGridBlocks(const std::function<void(int, int, int, int)>& block);
 };
 
 #endif // WAFER_ENHANCED_HPP
@@ -0,0 +1,255 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "wafer_residency.hpp"
+#include "memory_manager.hpp"
+#include "state_history.hpp"
+#include "wafer_enhanced.hpp"
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace SemiPRO {
+
+namespace {
+
+MemoryContextId residencyContext() {
+    static const MemoryContextId id = MemoryManager::getInstance().internContext("wafer_residency");
+    return id;
+}
+
+// What a hot wafer holds: its field arena and layer compositions
+size_t hotSize(const WaferEnhanced& wafer) {
+    size_t bytes = wafer.getFieldStore().arenaBytes();
+    for (const auto& layer : wafer.getLayers()) {
+        bytes += static_cast<size_t>(layer.composition.size()) * sizeof(double);
+    }
+    return bytes;
+}
+
+std::string spillPath(const std::string& directory) {
+    static std::atomic<std::uint64_t> counter{0};
+    return directory + "/resident-" + std::to_string(::getpid()) + "-" + std::to_string(counter++) + ".wafer";
+}
+
+} // namespace
+
+WaferResidency::WaferResidency() : WaferResidency(Limits()) {}
+
+WaferResidency::WaferResidency(const Limits& limits) : limits_(limits) {
+    pressure_handler_ = MemoryManager::getInstance().addPressureHandler([this](size_t bytes) { return demote(bytes); });
+}
+
+WaferResidency::~WaferResidency() {
+    MemoryManager::getInstance().removePressureHandler(pressure_handler_);
+    clear();
+}
+
+WaferResidency::Tier WaferResidency::tierOf(const Slot& slot) const {
+    return slot.hot ? Tier::HOT : slot.warm ? Tier::WARM : Tier::COLD;
+}
+
+void WaferResidency::charge(Slot& slot, size_t bytes) {
+    auto& memory = MemoryManager::getInstance();
+    size_t& tier_bytes = slot.hot ? hot_bytes_ : warm_bytes_;
+    if (slot.hot || slot.warm) {
+        memory.trackAllocation(bytes, residencyContext());
+        tier_bytes += bytes;
+    }
+    slot.bytes = slot.hot || slot.warm ? bytes : 0;
+}
+
+void WaferResidency::release(Slot& slot) {
+    if (slot.bytes > 0) {
+        MemoryManager::getInstance().trackDeallocation(slot.bytes, residencyContext());
+        (slot.hot ? hot_bytes_ : warm_bytes_) -= slot.bytes;
+        slot.bytes = 0;
+    }
+}
+
+void WaferResidency::admit(const std::string& name, std::shared_ptr<WaferEnhanced> wafer) {
+    if (!wafer) {
+        throw std::invalid_argument("Cannot admit a null wafer: " + name);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = slots_.find(name);
+        if (it != slots_.end()) {
+            release(it->second);
+            lru_.erase(it->second.lru);
+            slots_.erase(it);
+        }
+        Slot& slot = slots_[name];
+        slot.diameter = wafer->getDiameter();
+        slot.thickness = wafer->getThickness();
+        slot.material = wafer->getMaterialId();
+        const size_t bytes = hotSize(*wafer);
+        slot.hot = std::move(wafer);
+        charge(slot, bytes);
+        lru_.push_front(name);
+        slot.lru = lru_.begin();
+    }
+    MemoryManager::getInstance().relieveMemoryPressure();
+}
+
+void WaferResidency::promote(Slot& slot) {
+    auto wafer = std::make_shared<WaferEnhanced>(slot.diameter, slot.thickness, slot.material);
+    if (slot.warm) {
+        wafer->readStateImage(slot.warm->at(0));
+    } else {
+        wafer->loadFromFile(*slot.cold);
+    }
+    release(slot);
+    slot.warm.reset();
+    slot.cold.reset();
+    slot.hot = std::move(wafer);
+    charge(slot, hotSize(*slot.hot));
+}
+
+std::shared_ptr<WaferEnhanced> WaferResidency::acquire(const std::string& name) {
+    std::shared_ptr<WaferEnhanced> wafer;
+    bool promoted = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = slots_.find(name);
+        if (it == slots_.end()) {
+            return nullptr;
+        }
+        Slot& slot = it->second;
+        lru_.splice(lru_.begin(), lru_, slot.lru);
+        if (!slot.hot) {
+            promote(slot);
+            promoted = true;
+        }
+        wafer = slot.hot;
+    }
+    // Room for the promoted wafer comes from the others; it is held here
+    // and so stays hot
+    if (promoted) {
+        MemoryManager::getInstance().relieveMemoryPressure();
+    }
+    return wafer;
+}
+
+bool WaferResidency::compress(Slot& slot) {
+    // The state image leaves out a state history; saveToFile keeps it
+    if (slot.hot->isStateHistoryEnabled()) {
+        return false;
+    }
+    auto warm = std::make_unique<StateHistory>(1, limits_.compression_level);
+    warm->append(slot.hot->stateImage());
+    release(slot);
+    slot.hot.reset();
+    slot.warm = std::move(warm);
+    charge(slot, static_cast<size_t>(slot.warm->storedBytes()));
+    return true;
+}
+
+bool WaferResidency::spill(Slot& slot) {
+    if (limits_.spill_directory.empty()) {
+        return false;
+    }
+    std::shared_ptr<WaferEnhanced> wafer = slot.hot;
+    if (!wafer) {
+        wafer = std::make_shared<WaferEnhanced>(slot.diameter, slot.thickness, slot.material);
+        wafer->readStateImage(slot.warm->at(0));
+    }
+    const std::string path = spillPath(limits_.spill_directory);
+    try {
+        wafer->saveToFile(path);
+    } catch (const std::exception&) {
+        std::remove(path.c_str());
+        return false;
+    }
+    release(slot);
+    slot.hot.reset();
+    slot.warm.reset();
+    slot.cold = std::shared_ptr<const std::string>(new std::string(path), [](const std::string* file) {
+        std::remove(file->c_str());
+        delete file;
+    });
+    return true;
+}
+
+size_t WaferResidency::demote(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t freed = 0;
+    // Compress first, spill only what compression could not make room for
+    for (int pass = 0; pass < 2 && freed < bytes; ++pass) {
+        for (auto it = lru_.rbegin(); it != lru_.rend() && freed < bytes; ++it) {
+            Slot& slot = slots_.at(*it);
+            if (slot.hot && slot.hot.use_count() > 1) {
+                continue; // In use by a step
+            }
+            const size_t before = slot.bytes;
+            if (slot.hot && pass == 0) {
+                // Idle, so nothing changes it while it is measured
+                release(slot);
+                charge(slot, hotSize(*slot.hot));
+                const size_t measured = slot.bytes;
+                if (compress(slot)) {
+                    freed += measured > slot.bytes ? measured - slot.bytes : 0;
+                }
+            } else if (pass == 1 && (slot.hot || slot.warm) && spill(slot)) {
+                freed += before;
+            }
+        }
+    }
+    return freed;
+}
+
+bool WaferResidency::evict(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = slots_.find(name);
+    if (it == slots_.end()) {
+        return false;
+    }
+    release(it->second);
+    lru_.erase(it->second.lru);
+    slots_.erase(it);
+    return true;
+}
+
+bool WaferResidency::contains(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_.count(name) > 0;
+}
+
+WaferResidency::Tier WaferResidency::tier(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tierOf(slots_.at(name));
+}
+
+void WaferResidency::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& slot : slots_) {
+        release(slot.second);
+    }
+    slots_.clear();
+    lru_.clear();
+}
+
+size_t WaferResidency::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_.size();
+}
+
+size_t WaferResidency::count(Tier tier) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = 0;
+    for (const auto& slot : slots_) {
+        n += tierOf(slot.second) == tier ? 1 : 0;
+    }
+    return n;
+}
+
+size_t WaferResidency::hotBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hot_bytes_;
+}
+
+size_t WaferResidency::warmBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return warm_bytes_;
+}
+
+} // namespace SemiPRO
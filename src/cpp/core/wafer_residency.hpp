@@ -0,0 +1,101 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef WAFER_RESIDENCY_HPP
+#define WAFER_RESIDENCY_HPP
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class WaferEnhanced;
+class StateHistory;
+
+namespace SemiPRO {
+
+// Tiered residency for named wafers, so lots far larger than RAM can stay
+// registered. A wafer is
+//
+//   HOT   the live WaferEnhanced,
+//   WARM  its state image, byte-plane shuffled and zlib-compressed (a
+//         one-entry StateHistory), in memory, or
+//   COLD  spilled to a page-aligned checkpoint file that is mapped back
+//         copy-on-write.
+//
+// The bytes each wafer holds in its tier are charged to the MemoryManager
+// (context "wafer_residency"), and the store registers as its pressure
+// handler: past the warning threshold, idle hot wafers are compressed,
+// least recently used first, and if that is not enough the warm ones are
+// spilled. A wafer is idle when nothing but the store holds it, i.e. no
+// step has it from acquire(); wafers in use are never moved. acquire()
+// brings a wafer back to hot. Without a spill directory wafers go no
+// colder than warm.
+class WaferResidency {
+public:
+    enum class Tier { HOT, WARM, COLD };
+
+    struct Limits {
+        std::string spill_directory; // "" keeps every wafer in memory
+        int compression_level = 1;   // zlib, 1-9
+    };
+
+    WaferResidency();
+    explicit WaferResidency(const Limits& limits);
+    ~WaferResidency();
+    WaferResidency(const WaferResidency&) = delete;
+    WaferResidency& operator=(const WaferResidency&) = delete;
+
+    // Adds or replaces a wafer, hot
+    void admit(const std::string& name, std::shared_ptr<WaferEnhanced> wafer);
+    // The wafer, hot; null if none is held under the name
+    std::shared_ptr<WaferEnhanced> acquire(const std::string& name);
+    bool evict(const std::string& name);
+    bool contains(const std::string& name) const;
+    // Throws std::out_of_range for an unknown name
+    Tier tier(const std::string& name) const;
+    void clear();
+
+    // Moves idle wafers to colder tiers until `bytes` are freed or none is
+    // left to move; returns the bytes freed. Called by the MemoryManager
+    // under pressure.
+    size_t demote(size_t bytes);
+
+    size_t size() const;
+    size_t count(Tier tier) const;
+    // Charged to the MemoryManager, by the hot and by the warm wafers
+    size_t hotBytes() const;
+    size_t warmBytes() const;
+    Limits getLimits() const { return limits_; }
+
+private:
+    struct Slot {
+        std::shared_ptr<WaferEnhanced> hot;
+        std::unique_ptr<StateHistory> warm;
+        std::shared_ptr<const std::string> cold; // Removes the file when released
+        double diameter = 0.0;
+        double thickness = 0.0;
+        std::string material;
+        size_t bytes = 0; // Charged for the slot's tier
+        std::list<std::string>::iterator lru;
+    };
+
+    Tier tierOf(const Slot& slot) const;
+    void charge(Slot& slot, size_t bytes);
+    void release(Slot& slot);
+    void promote(Slot& slot);
+    bool compress(Slot& slot);
+    bool spill(Slot& slot);
+
+    Limits limits_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Slot> slots_;
+    std::list<std::string> lru_; // Most recently acquired first
+    size_t hot_bytes_ = 0;
+    size_t warm_bytes_ = 0;
+    size_t pressure_handler_;
+};
+
+} // namespace SemiPRO
+
+#endif // WAFER_RESIDENCY_HPP
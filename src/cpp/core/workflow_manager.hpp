@@ -12,6 +12,8 @@
 #include <condition_variable>
 #include <atomic>
 #include <chrono>
+#include "job_queue.hpp"
+#include "step_snapshots.hpp"
 
 namespace SemiPRO {
 
@@ -109,6 +111,22 @@ using ProgressCallback = std::function<void(const std::string& workflow_id, doub
  */
 using StepExecutor = std::function<std::unordered_map<std::string, std::string>(const WorkflowStep&, const std::unordered_map<std::string, std::string>&)>;
 
+/**
+ * @brief Expected cost of one step, worked out when a workflow is compiled
+ */
+struct ResourceEstimate {
+    double seconds = 1.0;
+    size_t memory_bytes = 0;
+};
+
+/**
+ * @brief Cost model of a module's steps
+ */
+using StepCostModel = std::function<ResourceEstimate(const WorkflowStep&)>;
+
+class WorkflowPlan;
+class WorkflowPlanCache;
+
 /**
  * @brief Workflow manager for orchestrating complex simulation workflows
  */
@@ -116,15 +134,28 @@ class WorkflowManager {
 private:
     std::unordered_map<std::string, Workflow> workflows_;
     std::unordered_map<std::string, StepExecutor> step_executors_;
+    std::unordered_map<std::string, StepCostModel> cost_models_;
     std::unordered_map<std::string, std::future<WorkflowResult>> running_workflows_;
     
-    // Threading
+    // Compiled plans by workflow id and version (workflow_plan.hpp), for
+    // the manager's implementation to fill through compileWorkflow and to
+    // invalidate or clear as workflows, executors and cost models change
+    std::shared_ptr<WorkflowPlanCache> plan_cache_;
+    
+    // Threading. Workers take executions from job_queue_, which admits at
+    // most max_concurrent at a time; pending_executions_ holds what each
+    // queued execution id will run.
     std::vector<std::thread> worker_threads_;
-    std::queue<std::string> workflow_queue_;
+    JobQueue job_queue_;
+    std::unordered_map<std::string, std::pair<std::string, std::unordered_map<std::string, std::string>>> pending_executions_;
     std::mutex queue_mutex_;
-    std::condition_variable queue_cv_;
     std::atomic<bool> shutdown_requested_{false};
     
+    // Recovery: the wafer each execution's steps run on, and its state
+    // after each completed step
+    std::shared_ptr<StepSnapshotStore> step_snapshots_;
+    std::unordered_map<std::string, std::shared_ptr<WaferEnhanced>> execution_wafers_;
+    
     // Progress tracking
     std::vector<ProgressCallback> progress_callbacks_;
     std::mutex callback_mutex_;
@@ -147,18 +178,57 @@ public:
     // Step executor registration
     void registerStepExecutor(const std::string& module_name, StepExecutor executor);
     void unregisterStepExecutor(const std::string& module_name);
+    void registerCostModel(const std::string& module_name, StepCostModel model);
+    
+    // Execution plans. compileWorkflow returns the registered workflow's
+    // plan from the plan cache, compiled with the registered executors and
+    // cost models, and throws std::invalid_argument with every problem the
+    // workflow has. Its peakMemoryBytes can stand in for the memory
+    // estimate of a JobTicket submitted without one.
+    std::shared_ptr<const WorkflowPlan> compileWorkflow(const std::string& workflow_id);
+    std::shared_ptr<WorkflowPlanCache> getPlanCache() const { return plan_cache_; }
     
     // Workflow execution
     std::string executeWorkflow(const std::string& workflow_id, 
                                const std::unordered_map<std::string, std::string>& parameters = {});
     std::string executeWorkflowAsync(const std::string& workflow_id,
                                     const std::unordered_map<std::string, std::string>& parameters = {});
+    // Queues an execution under admission control; job.id is replaced by
+    // the execution id. Returns "" when the queue turns the job away, with
+    // the reason in `admission`, so callers such as RestServer can answer
+    // "busy" instead of overcommitting memory. executeWorkflowAsync submits
+    // with a default ticket.
+    std::string submitWorkflow(const std::string& workflow_id,
+                               const std::unordered_map<std::string, std::string>& parameters,
+                               JobTicket job, JobAdmission* admission = nullptr);
+    void setQueueLimits(const JobQueue::Limits& limits);
+    JobQueue::Limits getQueueLimits() const;
+    size_t getQueuedWorkflowCount() const;
     
     // Workflow control
     bool pauseWorkflow(const std::string& execution_id);
     bool resumeWorkflow(const std::string& execution_id);
     bool cancelWorkflow(const std::string& execution_id);
+    // Reruns an execution from from_step ("" for the first step that did
+    // not complete). With step snapshots set, it resumes from the wafer as
+    // it was after the step before, without running the earlier steps
+    // again; without one, or once that snapshot is gone, from the start.
     bool retryWorkflow(const std::string& execution_id, const std::string& from_step = "");
+    // A new execution of the same workflow that starts at from_step on
+    // the state the given one had before it, with its parameters
+    // overridden by `parameters`: what-if runs from step K. Returns "" if
+    // no snapshot of that state is kept.
+    std::string branchWorkflow(const std::string& execution_id, const std::string& from_step,
+                               const std::unordered_map<std::string, std::string>& parameters = {});
+    
+    // Step snapshots. Once set, the wafer attached to an execution is
+    // recorded after every completed step; finished executions keep theirs
+    // until retried or branched from no more (forgetExecution).
+    void setStepSnapshots(std::shared_ptr<StepSnapshotStore> snapshots);
+    std::shared_ptr<StepSnapshotStore> getStepSnapshots() const { return step_snapshots_; }
+    void setExecutionWafer(const std::string& execution_id, std::shared_ptr<WaferEnhanced> wafer);
+    std::shared_ptr<WaferEnhanced> getExecutionWafer(const std::string& execution_id) const;
+    void forgetExecution(const std::string& execution_id);
     
     // Status and monitoring
     StepStatus getWorkflowStatus(const std::string& execution_id);
@@ -194,6 +264,10 @@ private:
     void workerLoop();
     WorkflowResult executeWorkflowInternal(const Workflow& workflow,
                                           const std::unordered_map<std::string, std::string>& parameters);
+    // Steps in plan order, a level's steps up to max_parallel_steps at a
+    // time; launch parameters override the plan's bound ones
+    WorkflowResult executePlan(const WorkflowPlan& plan,
+                               const std::unordered_map<std::string, std::string>& parameters);
     
     bool canExecuteStep(const WorkflowStep& step, const std::vector<WorkflowStep>& all_steps);
     std::unordered_map<std::string, std::string> executeStep(const WorkflowStep& step,
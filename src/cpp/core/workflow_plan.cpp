@@ -0,0 +1,243 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "workflow_plan.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+
+namespace SemiPRO {
+
+BoundParameter BoundParameter::parse(const std::string& text) {
+    BoundParameter parameter;
+    parameter.text = text;
+    if (text == "true" || text == "false") {
+        parameter.type = Type::BOOLEAN;
+        parameter.number = text == "true" ? 1.0 : 0.0;
+        return parameter;
+    }
+    if (!text.empty()) {
+        char* end = nullptr;
+        errno = 0;
+        const double value = std::strtod(text.c_str(), &end);
+        if (end == text.c_str() + text.size() && errno != ERANGE) {
+            parameter.type = Type::NUMBER;
+            parameter.number = value;
+        }
+    }
+    return parameter;
+}
+
+std::shared_ptr<const WorkflowPlan> WorkflowPlan::compile(
+    const Workflow& workflow, const std::unordered_map<std::string, StepExecutor>& executors,
+    const std::unordered_map<std::string, StepCostModel>& cost_models) {
+    std::vector<std::string> errors;
+    if (workflow.id.empty()) {
+        errors.push_back("workflow has no id");
+    }
+    const auto& steps = workflow.steps;
+    const size_t n = steps.size();
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < n; ++i) {
+        if (steps[i].id.empty()) {
+            errors.push_back("step " + std::to_string(i) + " has no id");
+        } else if (!index.emplace(steps[i].id, i).second) {
+            errors.push_back("duplicate step id '" + steps[i].id + "'");
+        }
+        if (executors.find(steps[i].module_name) == executors.end()) {
+            errors.push_back("step '" + steps[i].id + "': no executor for module '" + steps[i].module_name + "'");
+        }
+    }
+
+    // Kahn's algorithm, the earliest defined ready step first
+    std::vector<std::vector<size_t>> successors(n);
+    std::vector<size_t> pending(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (const auto& dependency : steps[i].dependencies) {
+            auto it = index.find(dependency);
+            if (it == index.end()) {
+                errors.push_back("step '" + steps[i].id + "' depends on unknown step '" + dependency + "'");
+            } else if (it->second == i) {
+                errors.push_back("step '" + steps[i].id + "' depends on itself");
+            } else {
+                successors[it->second].push_back(i);
+                ++pending[i];
+            }
+        }
+    }
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+    for (size_t i = 0; i < n; ++i) {
+        if (pending[i] == 0) {
+            ready.push(i);
+        }
+    }
+    std::vector<size_t> order;
+    order.reserve(n);
+    while (!ready.empty()) {
+        const size_t i = ready.top();
+        ready.pop();
+        order.push_back(i);
+        for (size_t next : successors[i]) {
+            if (--pending[next] == 0) {
+                ready.push(next);
+            }
+        }
+    }
+    if (order.size() < n) {
+        std::string cycle;
+        for (size_t i = 0; i < n; ++i) {
+            if (pending[i] > 0) {
+                cycle += (cycle.empty() ? "'" : ", '") + steps[i].id + "'";
+            }
+        }
+        errors.push_back("dependency cycle through " + cycle);
+    }
+
+    if (!errors.empty()) {
+        std::string message = "Cannot compile workflow '" + workflow.id + "': ";
+        for (size_t e = 0; e < errors.size(); ++e) {
+            message += (e ? "; " : "") + errors[e];
+        }
+        throw std::invalid_argument(message);
+    }
+
+    // The plan keeps its own copy, runtime state cleared, for the steps to
+    // point into
+    auto definition = std::make_shared<Workflow>(workflow);
+    for (auto& step : definition->steps) {
+        step.status = StepStatus::PENDING;
+        step.error_message.clear();
+        step.retry_count = 0;
+        step.results.clear();
+    }
+    definition->status = StepStatus::PENDING;
+    definition->current_step_id.clear();
+    definition->progress = 0.0;
+    definition->execution_context.clear();
+
+    std::shared_ptr<WorkflowPlan> plan(new WorkflowPlan());
+    plan->workflow_ = definition;
+    plan->steps_.resize(n);
+    std::vector<size_t> position(n);
+    for (size_t p = 0; p < n; ++p) {
+        position[order[p]] = p;
+    }
+
+    BoundParameters globals;
+    for (const auto& parameter : workflow.global_parameters) {
+        globals[parameter.first] = BoundParameter::parse(parameter.second);
+    }
+    std::vector<double> finish(n, 0.0); // Critical path seconds up to the end of each step
+    for (size_t p = 0; p < n; ++p) {
+        const WorkflowStep& step = definition->steps[order[p]];
+        PlannedStep& planned = plan->steps_[p];
+        planned.definition = &step;
+        planned.executor = executors.at(step.module_name);
+        planned.parameters = globals;
+        for (const auto& parameter : step.parameters) {
+            planned.parameters[parameter.first] = BoundParameter::parse(parameter.second);
+        }
+        auto model = cost_models.find(step.module_name);
+        if (model != cost_models.end() && model->second) {
+            planned.estimate = model->second(step);
+        } else {
+            planned.estimate = ResourceEstimate{1.0, 0};
+        }
+
+        double start = 0.0;
+        for (const auto& dependency : step.dependencies) {
+            const size_t d = position[index.at(dependency)];
+            if (std::find(planned.dependencies.begin(), planned.dependencies.end(), d) == planned.dependencies.end()) {
+                planned.dependencies.push_back(d);
+                plan->steps_[d].dependents.push_back(p);
+            }
+            planned.level = std::max(planned.level, plan->steps_[d].level + 1);
+            start = std::max(start, finish[d]);
+        }
+        std::sort(planned.dependencies.begin(), planned.dependencies.end());
+        finish[p] = start + planned.estimate.seconds;
+        plan->total_seconds_ += planned.estimate.seconds;
+        plan->critical_path_seconds_ = std::max(plan->critical_path_seconds_, finish[p]);
+        plan->level_count_ = std::max(plan->level_count_, planned.level + 1);
+        plan->positions_[step.id] = p;
+    }
+
+    // Peak memory: the largest steps of a level that may run at once
+    std::vector<std::vector<size_t>> level_memory(plan->level_count_);
+    for (const auto& planned : plan->steps_) {
+        level_memory[planned.level].push_back(planned.estimate.memory_bytes);
+    }
+    const size_t parallel = static_cast<size_t>(std::max(1, workflow.max_parallel_steps));
+    for (auto& memory : level_memory) {
+        std::sort(memory.begin(), memory.end(), std::greater<size_t>());
+        size_t bytes = 0;
+        for (size_t k = 0; k < std::min(parallel, memory.size()); ++k) {
+            bytes += memory[k];
+        }
+        plan->peak_memory_bytes_ = std::max(plan->peak_memory_bytes_, bytes);
+    }
+    return plan;
+}
+
+size_t WorkflowPlan::find(const std::string& step_id) const {
+    auto it = positions_.find(step_id);
+    return it == positions_.end() ? npos : it->second;
+}
+
+std::shared_ptr<const WorkflowPlan> WorkflowPlanCache::get(
+    const Workflow& workflow, const std::unordered_map<std::string, StepExecutor>& executors,
+    const std::unordered_map<std::string, StepCostModel>& cost_models) {
+    const auto key = std::make_pair(workflow.id, workflow.version);
+    std::uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = plans_.find(key);
+        if (it != plans_.end()) {
+            ++hits_;
+            return it->second;
+        }
+        ++misses_;
+        generation = generation_;
+    }
+    std::shared_ptr<const WorkflowPlan> plan = WorkflowPlan::compile(workflow, executors, cost_models);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (generation == generation_) {
+        // A concurrent miss may have got there first; keep the one cached
+        auto inserted = plans_.emplace(key, plan);
+        return inserted.first->second;
+    }
+    return plan;
+}
+
+void WorkflowPlanCache::invalidate(const std::string& workflow_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    for (auto it = plans_.lower_bound(std::make_pair(workflow_id, std::string()));
+         it != plans_.end() && it->first.first == workflow_id;) {
+        it = plans_.erase(it);
+    }
+}
+
+void WorkflowPlanCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    plans_.clear();
+}
+
+size_t WorkflowPlanCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return plans_.size();
+}
+
+std::uint64_t WorkflowPlanCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+std::uint64_t WorkflowPlanCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+} // namespace SemiPRO
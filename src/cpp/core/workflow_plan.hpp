@@ -0,0 +1,131 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef WORKFLOW_PLAN_HPP
+#define WORKFLOW_PLAN_HPP
+
+#include "workflow_manager.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace SemiPRO {
+
+// A parameter as written, and as the number or boolean it spells when it
+// is one in full, so executors need not parse it per launch
+struct BoundParameter {
+    enum class Type {
+        TEXT,
+        NUMBER,
+        BOOLEAN
+    };
+
+    Type type = Type::TEXT;
+    std::string text;
+    double number = 0.0; // NUMBER, or 1 / 0 for BOOLEAN
+
+    bool isNumber() const { return type == Type::NUMBER; }
+    bool asBool() const { return type == Type::BOOLEAN ? number != 0.0 : !text.empty(); }
+
+    // "true" / "false" are BOOLEAN, text strtod takes to its end NUMBER
+    static BoundParameter parse(const std::string& text);
+};
+
+using BoundParameters = std::unordered_map<std::string, BoundParameter>;
+
+// One step of a compiled workflow
+struct PlannedStep {
+    const WorkflowStep* definition = nullptr; // In the plan's own copy of the workflow
+    StepExecutor executor;                    // Resolved from definition->module_name
+    std::vector<size_t> dependencies;         // Plan positions, all earlier than this one
+    std::vector<size_t> dependents;
+    BoundParameters parameters;               // Workflow globals, overridden by the step's own
+    int level = 0;                            // 0 without dependencies, else 1 + the deepest one's
+    ResourceEstimate estimate;
+};
+
+// Immutable execution plan of a workflow: its steps in dependency order
+// (definition order among independent ones) with their executors,
+// parameters and resource estimates worked out once. Executions walk the
+// plan instead of validating the workflow, looking executors up by name
+// and parsing parameters every time, and since nothing in it changes,
+// any number of executions share one plan.
+class WorkflowPlan {
+public:
+    // Checks what validateWorkflow and validateStepDependencies check (an
+    // id, unique step ids, known dependencies, no cycles) and that every
+    // step's module has an executor; throws std::invalid_argument listing
+    // every problem found. Modules without a cost model are estimated at
+    // 1 s and no memory.
+    static std::shared_ptr<const WorkflowPlan> compile(
+        const Workflow& workflow, const std::unordered_map<std::string, StepExecutor>& executors,
+        const std::unordered_map<std::string, StepCostModel>& cost_models = {});
+
+    const Workflow& workflow() const { return *workflow_; }
+    const std::string& id() const { return workflow_->id; }
+    const std::string& version() const { return workflow_->version; }
+    const std::vector<PlannedStep>& steps() const { return steps_; }
+    // Plan position of a step, or npos
+    size_t find(const std::string& step_id) const;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    int levelCount() const { return level_count_; }
+    // Estimated seconds of all steps run one after another, and of the
+    // longest dependency chain, the least any schedule can take
+    double totalSeconds() const { return total_seconds_; }
+    double criticalPathSeconds() const { return critical_path_seconds_; }
+    // Largest memory of steps of one level running together, at most
+    // max_parallel_steps of them; the JobTicket estimate of an execution
+    size_t peakMemoryBytes() const { return peak_memory_bytes_; }
+
+private:
+    WorkflowPlan() = default;
+
+    std::shared_ptr<const Workflow> workflow_;
+    std::vector<PlannedStep> steps_;
+    std::unordered_map<std::string, size_t> positions_;
+    int level_count_ = 0;
+    double total_seconds_ = 0.0;
+    double critical_path_seconds_ = 0.0;
+    size_t peak_memory_bytes_ = 0;
+};
+
+// Compiled plans by workflow id and version. A template launched many
+// times is compiled on its first launch only; the others share that plan.
+// Plans are compiled outside the lock, and one compiled across an
+// invalidation is handed out but not kept.
+class WorkflowPlanCache {
+public:
+    WorkflowPlanCache() = default;
+    WorkflowPlanCache(const WorkflowPlanCache&) = delete;
+    WorkflowPlanCache& operator=(const WorkflowPlanCache&) = delete;
+
+    // The plan of workflow.id at workflow.version, compiled with the given
+    // executors and cost models if not cached; throws as compile does
+    std::shared_ptr<const WorkflowPlan> get(const Workflow& workflow,
+                                            const std::unordered_map<std::string, StepExecutor>& executors,
+                                            const std::unordered_map<std::string, StepCostModel>& cost_models = {});
+    // Drops every version of one workflow, e.g. when it is registered anew
+    void invalidate(const std::string& workflow_id);
+    // Drops everything, e.g. when executors or cost models change
+    void clear();
+
+    size_t size() const;
+    std::uint64_t hits() const;
+    std::uint64_t misses() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::pair<std::string, std::string>, std::shared_ptr<const WorkflowPlan>> plans_;
+    std::uint64_t generation_ = 0; // Bumped by every invalidation
+    std::uint64_t hits_ = 0;
+    std::uint64_t misses_ = 0;
+};
+
+} // namespace SemiPRO
+
+#endif // WORKFLOW_PLAN_HPP
@@ -0,0 +1,344 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "artifact_store.hpp"
+#include "../core/task_scheduler.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace SemiPRO {
+
+namespace {
+
+constexpr std::uint64_t kManifestMagic = 0x5350414d31ULL; // "SPAM1"
+constexpr unsigned char kRaw = 0;
+constexpr unsigned char kDeflated = 1;
+constexpr size_t kChunkHeader = 1 + sizeof(std::uint64_t); // Method, then the uncompressed size
+
+// Gear hash table: the rolling hash shifts one bit per byte, so a byte
+// leaves it 64 bytes later
+const std::array<std::uint64_t, 256>& gearTable() {
+    static const std::array<std::uint64_t, 256> table = [] {
+        std::array<std::uint64_t, 256> values{};
+        std::uint64_t state = 0x9e3779b97f4a7c15ULL;
+        for (auto& value : values) {
+            // splitmix64
+            std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            value = z ^ (z >> 31);
+        }
+        return values;
+    }();
+    return table;
+}
+
+CacheKey hashBytes(const unsigned char* data, size_t size) {
+    return ContentHasher().update(data, size).finish();
+}
+
+void appendWord(std::vector<unsigned char>& out, std::uint64_t value) {
+    unsigned char bytes[sizeof(value)];
+    std::memcpy(bytes, &value, sizeof(value));
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+std::uint64_t readWord(const std::vector<unsigned char>& in, size_t& offset) {
+    if (offset + sizeof(std::uint64_t) > in.size()) {
+        throw std::runtime_error("Artifact manifest is truncated");
+    }
+    std::uint64_t value;
+    std::memcpy(&value, in.data() + offset, sizeof(value));
+    offset += sizeof(value);
+    return value;
+}
+
+std::vector<unsigned char> readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Cannot read " + path);
+    }
+    std::vector<unsigned char> data(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        throw std::runtime_error("Cannot read " + path);
+    }
+    return data;
+}
+
+void writeFile(const std::string& path, const std::vector<unsigned char>& data) {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+} // namespace
+
+ArtifactStore::ArtifactStore(std::shared_ptr<ObjectStore> store) : ArtifactStore(std::move(store), Options()) {}
+
+ArtifactStore::ArtifactStore(std::shared_ptr<ObjectStore> store, const Options& options)
+    : store_(std::move(store)), options_(options) {
+    if (!store_) {
+        throw std::invalid_argument("An artifact store needs an object store");
+    }
+    options_.min_chunk = std::max<size_t>(options_.min_chunk, 64);
+    options_.max_chunk = std::max(options_.max_chunk, options_.min_chunk);
+    options_.compression_level = std::clamp(options_.compression_level, 0, 9);
+    if (!options_.cache_directory.empty()) {
+        cache_ = std::make_unique<DirectoryObjectStore>(options_.cache_directory);
+    }
+}
+
+std::vector<size_t> ArtifactStore::chunkEnds(const unsigned char* data, size_t size, const Options& options) {
+    const auto& gear = gearTable();
+    const size_t min_chunk = std::max<size_t>(options.min_chunk, 1);
+    const size_t max_chunk = std::max(options.max_chunk, min_chunk);
+    // A boundary where the top bits of the hash are all zero comes once per
+    // average_chunk bytes past the minimum
+    int bits = 0;
+    while ((size_t(2) << bits) <= std::max<size_t>(options.average_chunk, 2)) {
+        ++bits;
+    }
+    const std::uint64_t mask = bits >= 64 ? ~0ULL : ((1ULL << bits) - 1) << (64 - bits);
+
+    std::vector<size_t> ends;
+    size_t start = 0;
+    while (start < size) {
+        const size_t limit = std::min(size, start + max_chunk);
+        size_t end = limit;
+        std::uint64_t hash = 0;
+        for (size_t i = start; i < limit; ++i) {
+            hash = (hash << 1) + gear[data[i]];
+            if (i + 1 - start >= min_chunk && (hash & mask) == 0) {
+                end = i + 1;
+                break;
+            }
+        }
+        ends.push_back(end);
+        start = end;
+    }
+    return ends;
+}
+
+std::string ArtifactStore::chunkKey(const CacheKey& hash) const {
+    return options_.prefix + "/chunks/" + hash.to_hex();
+}
+
+std::string ArtifactStore::manifestKey(const std::string& id) const {
+    return options_.prefix + "/manifests/" + id;
+}
+
+void ArtifactStore::sendChunk(const unsigned char* data, const Chunk& chunk) {
+    const std::string key = chunkKey(chunk.hash);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stored_.count(key)) {
+            chunks_skipped_ += 1;
+            bytes_skipped_ += chunk.size;
+            return;
+        }
+    }
+    if (store_->contains(key)) {
+        chunks_skipped_ += 1;
+        bytes_skipped_ += chunk.size;
+    } else {
+        std::vector<unsigned char> object(kChunkHeader);
+        object[0] = kRaw;
+        std::memcpy(object.data() + 1, &chunk.size, sizeof(chunk.size));
+        if (options_.compression_level > 0) {
+            uLongf packed = compressBound(static_cast<uLong>(chunk.size));
+            object.resize(kChunkHeader + packed);
+            if (compress2(object.data() + kChunkHeader, &packed, data, static_cast<uLong>(chunk.size),
+                          options_.compression_level) != Z_OK) {
+                throw std::runtime_error("zlib failed to compress an artifact chunk");
+            }
+            object[0] = kDeflated;
+            object.resize(kChunkHeader + packed);
+        }
+        // Incompressible chunks go as they are
+        if (object[0] == kRaw || object.size() >= kChunkHeader + chunk.size) {
+            object.resize(kChunkHeader);
+            object[0] = kRaw;
+            object.insert(object.end(), data, data + chunk.size);
+        }
+        store_->put(key, object);
+        if (cache_) {
+            cache_->put(key, object);
+        }
+        chunks_sent_ += 1;
+        bytes_sent_ += object.size();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stored_.insert(key);
+}
+
+void ArtifactStore::fetchChunk(const Chunk& chunk, unsigned char* out) {
+    const std::string key = chunkKey(chunk.hash);
+    std::vector<unsigned char> object;
+    bool cached = cache_ && cache_->get(key, object);
+    if (cached) {
+        chunks_from_cache_ += 1;
+    } else {
+        if (!store_->get(key, object)) {
+            throw std::runtime_error("Artifact chunk " + chunk.hash.to_hex() + " is missing from the store");
+        }
+        chunks_fetched_ += 1;
+        bytes_fetched_ += object.size();
+    }
+    std::uint64_t size = 0;
+    if (object.size() >= kChunkHeader) {
+        std::memcpy(&size, object.data() + 1, sizeof(size));
+    }
+    bool intact = size == chunk.size;
+    if (intact && object[0] == kRaw) {
+        intact = object.size() == kChunkHeader + size;
+        if (intact) {
+            std::copy(object.begin() + kChunkHeader, object.end(), out);
+        }
+    } else if (intact && object[0] == kDeflated) {
+        uLongf unpacked = static_cast<uLongf>(size);
+        intact = uncompress(out, &unpacked, object.data() + kChunkHeader,
+                            static_cast<uLong>(object.size() - kChunkHeader)) == Z_OK && unpacked == size;
+    } else {
+        intact = false;
+    }
+    if (!intact || hashBytes(out, chunk.size) != chunk.hash) {
+        if (cached) {
+            // A damaged cache copy is dropped and the chunk fetched again
+            cache_->erase(key);
+            fetchChunk(chunk, out);
+            return;
+        }
+        throw std::runtime_error("Artifact chunk " + chunk.hash.to_hex() + " does not match its hash");
+    }
+    if (!cached && cache_) {
+        cache_->put(key, object);
+    }
+}
+
+std::string ArtifactStore::put(const std::vector<unsigned char>& data) {
+    const std::string id = hashBytes(data.data(), data.size()).to_hex();
+    if (store_->contains(manifestKey(id))) {
+        bytes_skipped_ += data.size();
+        return id;
+    }
+    const std::vector<size_t> ends = chunkEnds(data.data(), data.size(), options_);
+    std::vector<Chunk> chunks(ends.size());
+    std::vector<size_t> starts(ends.size());
+    for (size_t c = 0; c < ends.size(); ++c) {
+        starts[c] = c == 0 ? 0 : ends[c - 1];
+        chunks[c].size = ends[c] - starts[c];
+    }
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(chunks.size()), [&](int begin, int end) {
+        for (int c = begin; c < end; ++c) {
+            chunks[c].hash = hashBytes(data.data() + starts[c], chunks[c].size);
+            sendChunk(data.data() + starts[c], chunks[c]);
+        }
+    }, 1);
+
+    // The manifest goes last, so one that exists has all its chunks
+    std::vector<unsigned char> manifest;
+    appendWord(manifest, kManifestMagic);
+    appendWord(manifest, data.size());
+    appendWord(manifest, chunks.size());
+    for (const Chunk& chunk : chunks) {
+        appendWord(manifest, chunk.hash.high);
+        appendWord(manifest, chunk.hash.low);
+        appendWord(manifest, chunk.size);
+    }
+    store_->put(manifestKey(id), manifest);
+    return id;
+}
+
+std::string ArtifactStore::putFile(const std::string& path) {
+    return put(readFile(path));
+}
+
+bool ArtifactStore::get(const std::string& id, std::vector<unsigned char>& data) {
+    std::vector<unsigned char> manifest;
+    if (!store_->get(manifestKey(id), manifest)) {
+        return false;
+    }
+    size_t offset = 0;
+    if (readWord(manifest, offset) != kManifestMagic) {
+        throw std::runtime_error("Artifact " + id + " has no valid manifest");
+    }
+    const std::uint64_t total = readWord(manifest, offset);
+    const std::uint64_t count = readWord(manifest, offset);
+    std::vector<Chunk> chunks(count);
+    std::vector<size_t> starts(count);
+    std::uint64_t covered = 0;
+    for (std::uint64_t c = 0; c < count; ++c) {
+        chunks[c].hash.high = readWord(manifest, offset);
+        chunks[c].hash.low = readWord(manifest, offset);
+        chunks[c].size = readWord(manifest, offset);
+        starts[c] = covered;
+        covered += chunks[c].size;
+    }
+    if (covered != total) {
+        throw std::runtime_error("Artifact " + id + " has no valid manifest");
+    }
+    data.resize(total);
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(count), [&](int begin, int end) {
+        for (int c = begin; c < end; ++c) {
+            fetchChunk(chunks[c], data.data() + starts[c]);
+        }
+    }, 1);
+    return true;
+}
+
+bool ArtifactStore::getFile(const std::string& id, const std::string& path) {
+    std::vector<unsigned char> data;
+    if (!get(id, data)) {
+        return false;
+    }
+    writeFile(path, data);
+    return true;
+}
+
+bool ArtifactStore::contains(const std::string& id) {
+    return store_->contains(manifestKey(id));
+}
+
+ArtifactStore::Statistics ArtifactStore::statistics() const {
+    Statistics stats;
+    stats.chunks_sent = chunks_sent_.load();
+    stats.chunks_skipped = chunks_skipped_.load();
+    stats.bytes_sent = bytes_sent_.load();
+    stats.bytes_skipped = bytes_skipped_.load();
+    stats.chunks_fetched = chunks_fetched_.load();
+    stats.chunks_from_cache = chunks_from_cache_.load();
+    stats.bytes_fetched = bytes_fetched_.load();
+    return stats;
+}
+
+void stageJobInputs(CloudJob& job, ArtifactStore& store) {
+    for (const auto& [name, path] : job.input_files) {
+        job.metadata["artifact:" + name] = store.putFile(path);
+    }
+}
+
+void fetchJobInputs(const CloudJob& job, ArtifactStore& store, const std::string& directory) {
+    for (const auto& [name, path] : job.input_files) {
+        auto it = job.metadata.find("artifact:" + name);
+        if (it == job.metadata.end() || !store.getFile(it->second, directory + "/" + name)) {
+            throw std::runtime_error("Job input " + name + " was not staged");
+        }
+    }
+}
+
+void publishJobOutputs(const CloudJob& job, ArtifactStore& store, const std::string& directory, JobResult& result) {
+    for (const std::string& name : job.output_files) {
+        result.output_data[name] = store.putFile(directory + "/" + name);
+    }
+}
+
+} // namespace SemiPRO
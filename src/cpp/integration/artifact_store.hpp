@@ -0,0 +1,119 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+
+#include "cloud_integration.hpp"
+#include "../core/distributed_batch.hpp"
+#include "../core/performance_utils.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace SemiPRO {
+
+/**
+ * @brief Content-addressed, chunked artifacts on an object store
+ *
+ * An artifact is cut into chunks where a rolling (gear) hash of the last
+ * bytes hits a mask, so an edit only changes the chunks around it and
+ * the rest keep their boundaries. Each chunk is filed under the hash of
+ * its bytes, zlib-compressed, and the artifact is a manifest of chunk
+ * hashes filed under the hash of the whole. Storing an artifact sends
+ * only the chunks the store lacks, and nothing when the manifest exists
+ * already, so re-running a sweep on the same base checkpoint moves almost
+ * no data. Chunk transfers run in parallel on the TaskScheduler.
+ *
+ * With a cache directory, chunks fetched or stored are kept there too,
+ * so a node fetching another artifact that shares them reads them
+ * locally. Every chunk fetched is checked against its hash. Thread-safe.
+ */
+class ArtifactStore {
+public:
+    struct Options {
+        size_t min_chunk = 16 * 1024;
+        size_t average_chunk = 64 * 1024; // Rounded down to a power of two
+        size_t max_chunk = 256 * 1024;
+        int compression_level = 3;        // zlib 1-9; 0 stores chunks as they are
+        std::string cache_directory;      // Node-local chunk cache; "" for none
+        std::string prefix = "artifacts"; // Object key prefix
+    };
+
+    struct Statistics {
+        std::uint64_t chunks_sent = 0;
+        std::uint64_t chunks_skipped = 0;     // Already in the store
+        std::uint64_t bytes_sent = 0;         // Compressed
+        std::uint64_t bytes_skipped = 0;      // Uncompressed bytes not sent
+        std::uint64_t chunks_fetched = 0;
+        std::uint64_t chunks_from_cache = 0;
+        std::uint64_t bytes_fetched = 0;      // Compressed
+    };
+
+    explicit ArtifactStore(std::shared_ptr<ObjectStore> store);
+    ArtifactStore(std::shared_ptr<ObjectStore> store, const Options& options);
+
+    /**
+     * @brief Stores an artifact and returns its id, the hex hash of its bytes
+     * @throws std::runtime_error if a chunk cannot be compressed or written
+     */
+    std::string put(const std::vector<unsigned char>& data);
+    /// @throws std::runtime_error also if the file cannot be read
+    std::string putFile(const std::string& path);
+
+    /**
+     * @brief Fetches an artifact; false if there is none under the id
+     * @throws std::runtime_error for a chunk missing or not matching its hash
+     */
+    bool get(const std::string& id, std::vector<unsigned char>& data);
+    /// @throws std::runtime_error also if the file cannot be written
+    bool getFile(const std::string& id, const std::string& path);
+    bool contains(const std::string& id);
+
+    /// Content-defined chunk ends (exclusive offsets) of data
+    static std::vector<size_t> chunkEnds(const unsigned char* data, size_t size, const Options& options);
+
+    Statistics statistics() const;
+
+private:
+    struct Chunk {
+        CacheKey hash;
+        std::uint64_t size = 0;
+    };
+
+    std::string chunkKey(const CacheKey& hash) const;
+    std::string manifestKey(const std::string& id) const;
+    void sendChunk(const unsigned char* data, const Chunk& chunk);
+    void fetchChunk(const Chunk& chunk, unsigned char* out);
+
+    std::shared_ptr<ObjectStore> store_;
+    std::unique_ptr<ObjectStore> cache_;
+    Options options_;
+    std::mutex mutex_; // Guards stored_
+    std::unordered_set<std::string> stored_; // Chunk keys known to be in the store
+    std::atomic<std::uint64_t> chunks_sent_{0}, chunks_skipped_{0}, bytes_sent_{0}, bytes_skipped_{0};
+    std::atomic<std::uint64_t> chunks_fetched_{0}, chunks_from_cache_{0}, bytes_fetched_{0};
+};
+
+/**
+ * @brief Stores each of a job's input files, named by input_files, and
+ * records its artifact id in the job's metadata as "artifact:<name>"
+ */
+void stageJobInputs(CloudJob& job, ArtifactStore& store);
+
+/**
+ * @brief On a node: fetches the inputs stageJobInputs() recorded into
+ * directory/<name>
+ * @throws std::runtime_error for an input missing from the store
+ */
+void fetchJobInputs(const CloudJob& job, ArtifactStore& store, const std::string& directory);
+
+/**
+ * @brief On a node: stores the job's output_files from directory and
+ * records their artifact ids in the result's output_data
+ */
+void publishJobOutputs(const CloudJob& job, ArtifactStore& store, const std::string& directory, JobResult& result);
+
+} // namespace SemiPRO
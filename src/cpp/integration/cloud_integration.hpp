@@ -295,7 +295,7 @@ public:
     // Kubernetes utilities
     static std::string deployToKubernetes(const std::string& yaml_file);
     static bool deleteKubernetesDeployment(const std::string& deployment_name);
-    static std::vector<std::string> getKubernetesPods(const std::string& namespace = "default");
+    static std::vector<std::string> getKubernetesPods(const std::string& kube_namespace = "default");
     static std::string getKubernetesPodLogs(const std::string& pod_name);
     
 private:
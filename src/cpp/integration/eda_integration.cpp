@@ -5,9 +5,30 @@
 #include <sstream>
 #include <algorithm>
 #include <cmath>
+#include <set>
+#include <stdexcept>
 
 namespace SemiPRO {
 
+namespace {
+
+// Capacitance to substrate per area (fF/um^2) and per perimeter (fF/um),
+// typical of a 180 nm process; gate capacitance belongs to the devices
+struct LayerCapacitance {
+    const char* layer;
+    double area;
+    double fringe;
+};
+
+constexpr LayerCapacitance kLayerCapacitance[] = {
+    {"diffusion", 0.9, 0.25}, {"poly", 0.1, 0.05}, {"metal1", 0.04, 0.04}, {"metal2", 0.03, 0.035}};
+
+std::string netName(int net) {
+    return "n" + std::to_string(net);
+}
+
+} // namespace
+
 // EDAIntegration Implementation
 EDAIntegration::EDAIntegration(const std::string& technology_file) 
     : technology_file_(technology_file) {
@@ -29,18 +50,17 @@ EDAIntegration::EDAIntegration(const std::string& technology_file)
 void EDAIntegration::exportToSpice(const std::unordered_map<std::string, double>& simulation_results,
                                   const std::string& output_file,
                                   const std::string& model_type) {
-    std::ofstream file(output_file);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open SPICE output file: " + output_file);
-    }
+    ChunkedTextWriter file(output_file);
+    TextBuffer text;
     
-    writeSpiceHeader(file, "SemiPRO Generated SPICE Model");
+    writeSpiceHeader(text, "SemiPRO Generated SPICE Model");
     
     // Extract model parameters from simulation results
     SpiceModelParams model = extractModelParameters(simulation_results, model_type);
-    writeSpiceModel(file, model);
+    writeSpiceModel(text, model);
     
-    file << ".end\n";
+    text << ".end\n";
+    file.write(text);
     file.close();
     
     Logger::getInstance().log("SPICE model exported to: " + output_file);
@@ -48,18 +68,15 @@ void EDAIntegration::exportToSpice(const std::unordered_map<std::string, double>
 
 void EDAIntegration::exportDeviceModels(const std::vector<ExtractedDevice>& devices,
                                        const std::string& output_file) {
-    std::ofstream file(output_file);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open device models file: " + output_file);
-    }
+    ChunkedTextWriter file(output_file);
+    TextBuffer text;
     
-    writeSpiceHeader(file, "SemiPRO Extracted Device Models");
+    writeSpiceHeader(text, "SemiPRO Extracted Device Models");
+    file.write(text);
     
-    for (const auto& device : devices) {
-        writeSpiceDevice(file, device);
-    }
+    file.writeRecords(devices.size(), [&](std::size_t i, TextBuffer& out) { writeSpiceDevice(out, devices[i]); });
     
-    file << ".end\n";
+    file.write(".end\n");
     file.close();
     
     Logger::getInstance().log("Device models exported to: " + output_file);
@@ -67,56 +84,67 @@ void EDAIntegration::exportDeviceModels(const std::vector<ExtractedDevice>& devi
 
 void EDAIntegration::exportParasitics(const std::vector<ParasiticElement>& parasitics,
                                      const std::string& output_file) {
-    std::ofstream file(output_file);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open parasitics file: " + output_file);
-    }
+    ChunkedTextWriter file(output_file);
+    TextBuffer text;
     
-    writeSpiceHeader(file, "SemiPRO Extracted Parasitics");
+    writeSpiceHeader(text, "SemiPRO Extracted Parasitics");
+    file.write(text);
     
-    for (const auto& parasitic : parasitics) {
-        writeSpiceParasitic(file, parasitic);
-    }
+    file.writeRecords(parasitics.size(),
+                      [&](std::size_t i, TextBuffer& out) { writeSpiceParasitic(out, parasitics[i]); });
     
-    file << ".end\n";
+    file.write(".end\n");
     file.close();
     
     Logger::getInstance().log("Parasitics exported to: " + output_file);
 }
 
 std::vector<GDSCell> EDAIntegration::importGDSLayout(const std::string& gds_file) {
+    const GDSLibrary library = GDSLibrary::read(gds_file);
+
     std::vector<GDSCell> cells;
-    
-    // Simplified GDS import - in production would use proper GDS library
-    std::ifstream file(gds_file, std::ios::binary);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open GDS file: " + gds_file);
+    cells.reserve(library.structures().size());
+    for (const auto& structure : library.structures()) {
+        GDSCell cell;
+        cell.name = structure.name;
+        cell.scale_factor = library.userUnitsPerDatabaseUnit();
+        cell.polygons = structure.polygons;
+        for (auto& polygon : cell.polygons) {
+            polygon.layer_name = getProcessLayer(polygon.layer);
+        }
+        for (const auto& reference : structure.references) {
+            for (int row = 0; row < reference.rows; ++row) {
+                for (int column = 0; column < reference.columns; ++column) {
+                    cell.references.push_back(
+                        {reference.cell,
+                         {reference.x + column * reference.column_step[0] + row * reference.row_step[0],
+                          reference.y + column * reference.column_step[1] + row * reference.row_step[1]}});
+                }
+            }
+        }
+        cells.push_back(std::move(cell));
     }
-    
-    // For now, create a dummy cell structure
-    GDSCell dummy_cell;
-    dummy_cell.name = "TOP_CELL";
-    
-    // Add some example polygons
-    GDSPolygon poly1;
-    poly1.layer = 1;
-    poly1.datatype = 0;
-    poly1.layer_name = "active";
-    poly1.points = {{0, 0}, {100, 0}, {100, 50}, {0, 50}};
-    
-    GDSPolygon poly2;
-    poly2.layer = 2;
-    poly2.datatype = 0;
-    poly2.layer_name = "poly";
-    poly2.points = {{25, -10}, {75, -10}, {75, 60}, {25, 60}};
-    
-    dummy_cell.polygons = {poly1, poly2};
-    cells.push_back(dummy_cell);
-    
-    Logger::getInstance().log("GDS layout imported from: " + gds_file);
+
+    Logger::getInstance().log("GDS layout imported from: " + gds_file + " (" + std::to_string(cells.size()) +
+                              " cells)");
     return cells;
 }
 
+BitMask EDAIntegration::importLayerMask(const std::string& gds_file, int layer, const LayoutWindow& window,
+                                        int rows, int cols, int datatype) {
+    return importLayerMask(GDSLibrary::read(gds_file), layer, window, rows, cols, datatype);
+}
+
+BitMask EDAIntegration::importLayerMask(const GDSLibrary& library, int layer, const LayoutWindow& window, int rows,
+                                        int cols, int datatype) {
+    const std::vector<GDSPolygon> polygons = library.flatten(layer, window, datatype);
+    BitMask mask = rasterizeLayout(polygons, window, rows, cols);
+    Logger::getInstance().log("Layer " + std::to_string(layer) + " rasterized from " +
+                              std::to_string(polygons.size()) + " polygons to " + std::to_string(rows) + "x" +
+                              std::to_string(cols) + " mask");
+    return mask;
+}
+
 std::vector<GDSPolygon> EDAIntegration::extractLayerPolygons(const std::vector<GDSCell>& cells, int layer) {
     std::vector<GDSPolygon> layer_polygons;
     
@@ -143,29 +171,190 @@ std::vector<std::vector<std::pair<double, double>>> EDAIntegration::convertToSim
     return geometry;
 }
 
+NetDatabase EDAIntegration::extractNets(const std::vector<GDSCell>& cells, const LayoutWindow& window, int rows,
+                                        int cols) {
+    const auto raster = [&](const std::string& layer) {
+        return rasterizeLayout(processLayerPolygons(cells, layer), window, rows, cols);
+    };
+    const BitMask active = raster("active");
+    const BitMask poly = raster("poly");
+    BitMask gate = active;
+    gate &= poly;
+    BitMask diffusion = poly;
+    diffusion.invert();
+    diffusion &= active;
+    
+    LayerConnectivity connectivity(rows, cols);
+    connectivity.addLayer("poly", poly);
+    connectivity.addLayer("gate", gate);
+    connectivity.addLayer("diffusion", diffusion);
+    connectivity.addLayer("contact", raster("contact"));
+    connectivity.addLayer("metal1", raster("metal1"));
+    connectivity.addLayer("via1", raster("via1"));
+    connectivity.addLayer("metal2", raster("metal2"));
+    connectivity.connect("gate", "poly");
+    connectivity.connect("contact", "poly");
+    connectivity.connect("contact", "diffusion");
+    connectivity.connect("contact", "metal1");
+    connectivity.connect("via1", "metal1");
+    connectivity.connect("via1", "metal2");
+    NetDatabase nets = connectivity.extract();
+    
+    Logger::getInstance().log("Extracted " + std::to_string(nets.netCount()) + " nets on a " + std::to_string(rows) +
+                              "x" + std::to_string(cols) + " grid");
+    return nets;
+}
+
 std::vector<ExtractedDevice> EDAIntegration::extractDevices(const std::vector<GDSCell>& cells) {
     std::vector<ExtractedDevice> devices;
-    
-    for (const auto& cell : cells) {
-        // Look for transistor patterns
-        auto active_polygons = extractLayerPolygons({cell}, 1);
-        auto poly_polygons = extractLayerPolygons({cell}, 2);
-        
-        // Simple transistor detection: poly crossing active
-        for (const auto& poly : poly_polygons) {
-            for (const auto& active : active_polygons) {
-                if (isTransistor(poly, {active})) {
-                    ExtractedDevice device = extractTransistor({poly, active});
-                    devices.push_back(device);
-                }
+    LayoutWindow window;
+    int rows = 0, cols = 0;
+    if (!extractionGrid(cells, window, rows, cols)) {
+        Logger::getInstance().log("Extracted 0 devices");
+        return devices;
+    }
+    const NetDatabase nets = extractNets(cells, window, rows, cols);
+    const int gate = nets.layerIndex("gate");
+    const int diffusion = nets.layerIndex("diffusion");
+    const BitMask nwell = rasterizeLayout(processLayerPolygons(cells, "nwell"), window, rows, cols);
+    
+    // Poly joins gates into one net, so the gate regions are labelled alone
+    LayerConnectivity gate_layer(rows, cols);
+    gate_layer.addLayer("gate", BitMask::fromRuns(rows, cols, nets.runs(gate)));
+    const NetDatabase regions = gate_layer.extract();
+    
+    struct Channel {
+        std::set<int> diffusions;
+        int across_rows = 0; // Diffusion cells touching the gate from the rows either side
+        int across_cols = 0;
+        const MaskRun* first = nullptr;
+    };
+    std::vector<Channel> channels(regions.netCount());
+    const std::vector<MaskRun>& runs = regions.runs(0);
+    for (std::size_t r = 0; r < runs.size(); ++r) {
+        const MaskRun& run = runs[r];
+        Channel& channel = channels[regions.runNets(0)[r]];
+        if (!channel.first) {
+            channel.first = &run;
+        }
+        const auto touch = [&](int i, int j, int& count) {
+            const int net = nets.netAt(diffusion, i, j);
+            if (net >= 0) {
+                channel.diffusions.insert(net);
+                ++count;
             }
+        };
+        touch(run.row, run.col_begin - 1, channel.across_cols);
+        touch(run.row, run.col_end, channel.across_cols);
+        for (int j = run.col_begin; j < run.col_end; ++j) {
+            touch(run.row - 1, j, channel.across_rows);
+            touch(run.row + 1, j, channel.across_rows);
         }
     }
     
+    const double dx = (window.x_max - window.x_min) / rows;
+    const double dy = (window.y_max - window.y_min) / cols;
+    for (int k = 0; k < regions.netCount(); ++k) {
+        const Channel& channel = channels[k];
+        if (channel.diffusions.empty()) continue; // Poly over active with no source or drain
+        
+        const NetDatabase::Bounds& box = regions.bounds(k);
+        const double x_extent = (box.row_end - box.row_begin) * dx;
+        const double y_extent = (box.col_end - box.col_begin) * dy;
+        // Current crosses the gate between the diffusions on either side
+        const bool along_x = channel.across_rows >= channel.across_cols;
+        const bool pmos = nwell.test(channel.first->row, channel.first->col_begin);
+        
+        ExtractedDevice device;
+        device.device_type = pmos ? "pmos" : "nmos";
+        device.instance_name = std::to_string(devices.size() + 1);
+        device.terminals = {netName(*channel.diffusions.begin()),
+                            netName(nets.netAt(gate, channel.first->row, channel.first->col_begin)),
+                            netName(*channel.diffusions.rbegin()), pmos ? "vdd" : "0"};
+        device.position = {window.x_min + 0.5 * (box.row_begin + box.row_end) * dx,
+                           window.y_min + 0.5 * (box.col_begin + box.col_end) * dy};
+        // User units taken as um
+        device.length = (along_x ? x_extent : y_extent) * 1e3; // nm
+        device.width = (along_x ? y_extent : x_extent) * 1e3;
+        device.parameters["w"] = device.width * 1e-9;
+        device.parameters["l"] = device.length * 1e-9;
+        devices.push_back(std::move(device));
+    }
+    
     Logger::getInstance().log("Extracted " + std::to_string(devices.size()) + " devices");
     return devices;
 }
 
+std::vector<ParasiticElement> EDAIntegration::extractParasitics(const std::vector<GDSCell>& cells) {
+    std::vector<ParasiticElement> parasitics;
+    LayoutWindow window;
+    int rows = 0, cols = 0;
+    if (!extractionGrid(cells, window, rows, cols)) {
+        return parasitics;
+    }
+    const NetDatabase nets = extractNets(cells, window, rows, cols);
+    const double dx = (window.x_max - window.x_min) / rows;
+    const double dy = (window.y_max - window.y_min) / cols;
+    
+    for (int net = 0; net < nets.netCount(); ++net) {
+        double capacitance = 0.0; // fF
+        for (const auto& layer : kLayerCapacitance) {
+            const int l = nets.layerIndex(layer.layer);
+            if (l < 0) continue;
+            capacitance += layer.area * nets.area(net, l) * dx * dy +
+                           layer.fringe * nets.perimeter(net, l) * 0.5 * (dx + dy);
+        }
+        if (capacitance <= 0.0) continue;
+        
+        ParasiticElement element;
+        element.type = ParasiticElement::CAPACITOR;
+        element.name = std::to_string(parasitics.size() + 1);
+        element.nodes = {netName(net), "0"};
+        element.value = capacitance;
+        element.units = "f";
+        parasitics.push_back(std::move(element));
+    }
+    
+    Logger::getInstance().log("Extracted " + std::to_string(parasitics.size()) + " parasitic elements");
+    return parasitics;
+}
+
+void EDAIntegration::setExtractionCellSize(double cell_size) {
+    if (!(cell_size > 0.0)) {
+        throw std::invalid_argument("Extraction cell size must be positive");
+    }
+    extraction_cell_size_ = cell_size;
+}
+
+void EDAIntegration::generateNetlist(const std::vector<ExtractedDevice>& devices,
+                                     const std::vector<ParasiticElement>& parasitics,
+                                     const std::string& output_file) {
+    ChunkedTextWriter file(output_file);
+    TextBuffer text;
+    
+    writeSpiceHeader(text, "SemiPRO Extracted Netlist");
+    
+    std::set<std::string> types;
+    for (const auto& device : devices) {
+        types.insert(device.device_type);
+    }
+    for (const auto& type : types) {
+        auto model = device_models_.find(type);
+        if (model != device_models_.end()) {
+            writeSpiceModel(text, model->second);
+        }
+    }
+    file.write(text);
+    file.writeRecords(devices.size(), [&](std::size_t i, TextBuffer& out) { writeSpiceDevice(out, devices[i]); });
+    file.writeRecords(parasitics.size(),
+                      [&](std::size_t i, TextBuffer& out) { writeSpiceParasitic(out, parasitics[i]); });
+    
+    file.write(".end\n");
+    file.close();
+    
+    Logger::getInstance().log("Netlist generated: " + output_file);
+}
+
 SpiceModelParams EDAIntegration::extractModelParameters(
     const std::unordered_map<std::string, double>& sim_results,
     const std::string& device_type) {
@@ -228,14 +417,14 @@ std::string EDAIntegration::getProcessLayer(int gds_layer) const {
     return (it != layer_map_.end()) ? it->second : "unknown";
 }
 
-void EDAIntegration::writeSpiceHeader(std::ofstream& file, const std::string& title) {
+void EDAIntegration::writeSpiceHeader(TextBuffer& file, const std::string& title) {
     file << "* " << title << "\n";
     file << "* Generated by SemiPRO\n";
     file << "* Author: Dr. Mazharuddin Mohammed\n";
     file << "*\n\n";
 }
 
-void EDAIntegration::writeSpiceModel(std::ofstream& file, const SpiceModelParams& model) {
+void EDAIntegration::writeSpiceModel(TextBuffer& file, const SpiceModelParams& model) {
     file << ".model " << model.model_name << " " << model.model_type;
     
     for (const auto& [param, value] : model.parameters) {
@@ -245,7 +434,7 @@ void EDAIntegration::writeSpiceModel(std::ofstream& file, const SpiceModelParams
     file << "\n";
 }
 
-void EDAIntegration::writeSpiceDevice(std::ofstream& file, const ExtractedDevice& device) {
+void EDAIntegration::writeSpiceDevice(TextBuffer& file, const ExtractedDevice& device) {
     file << "M" << device.instance_name << " ";
     
     // Write terminals
@@ -263,7 +452,7 @@ void EDAIntegration::writeSpiceDevice(std::ofstream& file, const ExtractedDevice
     file << "\n";
 }
 
-void EDAIntegration::writeSpiceParasitic(std::ofstream& file, const ParasiticElement& parasitic) {
+void EDAIntegration::writeSpiceParasitic(TextBuffer& file, const ParasiticElement& parasitic) {
     switch (parasitic.type) {
         case ParasiticElement::RESISTOR:
             file << "R";
@@ -285,32 +474,47 @@ void EDAIntegration::writeSpiceParasitic(std::ofstream& file, const ParasiticEle
     file << parasitic.value << parasitic.units << "\n";
 }
 
-bool EDAIntegration::isTransistor(const GDSPolygon& poly, const std::vector<GDSPolygon>& all_polygons) {
-    // Simplified transistor detection
-    // In reality, would check for poly crossing active region
-    return poly.layer == 2; // Poly layer
+std::vector<GDSPolygon> EDAIntegration::processLayerPolygons(const std::vector<GDSCell>& cells,
+                                                             const std::string& process_layer) const {
+    std::vector<GDSPolygon> polygons;
+    for (const auto& cell : cells) {
+        for (const auto& polygon : cell.polygons) {
+            if (getProcessLayer(polygon.layer) == process_layer) {
+                polygons.push_back(polygon);
+            }
+        }
+    }
+    return polygons;
 }
 
-ExtractedDevice EDAIntegration::extractTransistor(const std::vector<GDSPolygon>& transistor_polygons) {
-    ExtractedDevice device;
-    device.device_type = "nmos"; // Default
-    device.instance_name = "M1";
-    device.terminals = {"drain", "gate", "source", "bulk"};
-    
-    // Calculate device dimensions
-    if (transistor_polygons.size() >= 2) {
-        const auto& poly = transistor_polygons[0];
-        const auto& active = transistor_polygons[1];
-        
-        // Simple width/length calculation
-        device.width = 50.0; // Default width in nm
-        device.length = 25.0; // Default length in nm
-        
-        device.parameters["w"] = device.width * 1e-9;
-        device.parameters["l"] = device.length * 1e-9;
+bool EDAIntegration::extractionGrid(const std::vector<GDSCell>& cells, LayoutWindow& window, int& rows,
+                                    int& cols) const {
+    bool any = false;
+    for (const auto& cell : cells) {
+        for (const auto& polygon : cell.polygons) {
+            for (const auto& point : polygon.points) {
+                if (!any) {
+                    window = {point.first, point.second, point.first, point.second};
+                    any = true;
+                }
+                window.x_min = std::min(window.x_min, point.first);
+                window.y_min = std::min(window.y_min, point.second);
+                window.x_max = std::max(window.x_max, point.first);
+                window.y_max = std::max(window.y_max, point.second);
+            }
+        }
     }
-    
-    return device;
+    if (!any) {
+        return false;
+    }
+    // A clear cell all round, so no net touches the border
+    rows = static_cast<int>(std::ceil((window.x_max - window.x_min) / extraction_cell_size_)) + 2;
+    cols = static_cast<int>(std::ceil((window.y_max - window.y_min) / extraction_cell_size_)) + 2;
+    window.x_min -= extraction_cell_size_;
+    window.y_min -= extraction_cell_size_;
+    window.x_max = window.x_min + rows * extraction_cell_size_;
+    window.y_max = window.y_min + cols * extraction_cell_size_;
+    return true;
 }
 
 // VirtuosoIntegration Implementation
@@ -353,4 +557,92 @@ void VirtuosoIntegration::executeSkillScript(const std::string& script_file) {
     Logger::getInstance().log("SKILL script executed: " + script_file);
 }
 
+// SynopsysIntegration Implementation
+void SynopsysIntegration::exportToDesignCompiler(const std::vector<ExtractedDevice>& devices,
+                                                 const std::string& liberty_file) {
+    ChunkedTextWriter file(liberty_file);
+    TextBuffer text;
+    
+    writeLibertyHeader(text);
+    file.write(text);
+    
+    file.writeRecords(devices.size(), [&](std::size_t i, TextBuffer& out) { writeLibertyCell(out, devices[i]); });
+    
+    file.write("}\n");
+    file.close();
+    
+    Logger::getInstance().log("Liberty library exported to: " + liberty_file);
+}
+
+void SynopsysIntegration::exportToICCompiler(const std::vector<GDSCell>& cells, const std::string& def_file) {
+    ChunkedTextWriter file(def_file);
+    TextBuffer text;
+    
+    std::size_t components = 0;
+    for (const auto& cell : cells) {
+        components += cell.references.size();
+    }
+    writeDEFHeader(text, cells.empty() ? "semipro" : cells.front().name);
+    text << "COMPONENTS " << components << " ;\n";
+    file.write(text);
+    
+    file.writeRecords(cells.size(), [&](std::size_t i, TextBuffer& out) { writeDEFComponent(out, cells[i]); });
+    
+    file.write("END COMPONENTS\n\nEND DESIGN\n");
+    file.close();
+    
+    Logger::getInstance().log("DEF exported to: " + def_file);
+}
+
+void SynopsysIntegration::writeLibertyHeader(TextBuffer& file) {
+    file << "/* Generated by SemiPRO */\n";
+    file << "library (semipro_extracted) {\n";
+    file << "  delay_model : table_lookup ;\n";
+    file << "  time_unit : \"1ns\" ;\n";
+    file << "  voltage_unit : \"1V\" ;\n";
+    file << "  current_unit : \"1uA\" ;\n";
+    file << "  capacitive_load_unit (1, ff) ;\n";
+    file << "  pulling_resistance_unit : \"1kohm\" ;\n";
+    file << "  nom_voltage : 1.8 ;\n";
+    file << "  nom_temperature : 25 ;\n\n";
+}
+
+void SynopsysIntegration::writeLibertyCell(TextBuffer& file, const ExtractedDevice& device) {
+    // Gate capacitance of the 5 nm oxide the device models assume
+    constexpr double kOxideCapacitance = 6.9; // fF/um^2
+    const double area = device.width * device.length * 1e-6; // um^2 from nm
+    
+    file << "  cell (" << device.device_type << "_" << device.instance_name << ") {\n";
+    file << "    area : " << area << " ;\n";
+    static const char* const kPins[] = {"d", "g", "s", "b"};
+    for (const char* pin : kPins) {
+        file << "    pin (" << pin << ") {\n";
+        if (pin[0] == 'g') {
+            file << "      direction : input ;\n";
+            file << "      capacitance : " << kOxideCapacitance * area << " ;\n";
+        } else {
+            file << "      direction : inout ;\n";
+        }
+        file << "    }\n";
+    }
+    file << "  }\n";
+}
+
+void SynopsysIntegration::writeDEFHeader(TextBuffer& file, const std::string& design) {
+    file << "VERSION 5.8 ;\n";
+    file << "DIVIDERCHAR \"/\" ;\n";
+    file << "BUSBITCHARS \"[]\" ;\n";
+    file << "DESIGN " << design << " ;\n";
+    file << "UNITS DISTANCE MICRONS 1000 ;\n\n";
+}
+
+void SynopsysIntegration::writeDEFComponent(TextBuffer& file, const GDSCell& cell) {
+    for (std::size_t k = 0; k < cell.references.size(); ++k) {
+        const auto& reference = cell.references[k];
+        file << "- " << cell.name << "/" << reference.first << "_" << k << " " << reference.first << " + PLACED ( "
+             << static_cast<long long>(std::llround(reference.second.first * 1000.0)) << " "
+             << static_cast<long long>(std::llround(reference.second.second * 1000.0)) << " ) N ;\n";
+    }
+}
+
 } // namespace SemiPRO
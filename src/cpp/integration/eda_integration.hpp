@@ -1,6 +1,9 @@
 // Author: Dr. Mazharuddin Mohammed
 #pragma once
 
+#include "gds_library.hpp"
+#include "../core/chunked_text_writer.hpp"
+#include "../core/layer_connectivity.hpp"
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -20,16 +23,6 @@ struct SpiceModelParams {
     std::string process_corner; // typical, fast, slow, etc.
 };
 
-/**
- * @brief GDS polygon structure
- */
-struct GDSPolygon {
-    int layer;
-    int datatype;
-    std::vector<std::pair<double, double>> points;
-    std::string layer_name;
-};
-
 /**
  * @brief GDS cell structure
  */
@@ -72,11 +65,14 @@ private:
     std::string technology_file_;
     std::unordered_map<std::string, SpiceModelParams> device_models_;
     std::unordered_map<int, std::string> layer_map_;
+    double extraction_cell_size_ = 0.01;
     
 public:
     EDAIntegration(const std::string& technology_file = "");
     
-    // SPICE export functionality
+    // SPICE export functionality. Exports format their elements in parallel
+    // and stream them out in order (see ChunkedTextWriter); output files
+    // named "*.gz" are gzipped.
     void exportToSpice(const std::unordered_map<std::string, double>& simulation_results,
                       const std::string& output_file,
                       const std::string& model_type = "nmos");
@@ -90,14 +86,37 @@ public:
     // GDS import functionality
     std::vector<GDSCell> importGDSLayout(const std::string& gds_file);
     std::vector<GDSPolygon> extractLayerPolygons(const std::vector<GDSCell>& cells, int layer);
+
+    // Mask for one layer over window at grid resolution (see GDSLibrary and
+    // rasterizeLayout), ready for LithographyModel::simulateExposure. Reading
+    // the library once and rasterizing it per layer avoids re-parsing.
+    BitMask importLayerMask(const std::string& gds_file, int layer, const LayoutWindow& window, int rows,
+                            int cols, int datatype = -1);
+    BitMask importLayerMask(const GDSLibrary& library, int layer, const LayoutWindow& window, int rows, int cols,
+                            int datatype = -1);
     
     // Geometry conversion
     std::vector<std::vector<std::pair<double, double>>> convertToSimulationGeometry(
         const std::vector<GDSPolygon>& polygons);
     
-    // Device extraction
+    // Nets of the cells' conducting layers rasterized over window (see
+    // rasterizeLayout and LayerConnectivity), layers found through the
+    // layer mapping: "poly", "gate" (active under poly, part of its poly
+    // net), "diffusion" (active outside poly), "contact", "metal1", "via1"
+    // and "metal2". Contacts join metal1 to poly and diffusion, vias join
+    // the metals.
+    NetDatabase extractNets(const std::vector<GDSCell>& cells, const LayoutWindow& window, int rows, int cols);
+    
+    // Device extraction, on the nets of the cells' polygons rasterized over
+    // their bounding box at the extraction cell size. Each connected gate
+    // region is a transistor between the diffusion nets beside it, pmos
+    // inside nwell; terminals are named by net ("n<id>", bulk "0" or
+    // "vdd"). Parasitics are each net's capacitance to substrate from its
+    // area and perimeter per layer.
     std::vector<ExtractedDevice> extractDevices(const std::vector<GDSCell>& cells);
     std::vector<ParasiticElement> extractParasitics(const std::vector<GDSCell>& cells);
+    // Grid pitch of extraction in user units (usually um)
+    void setExtractionCellSize(double cell_size);
     
     // Technology file management
     void loadTechnologyFile(const std::string& tech_file);
@@ -122,16 +141,20 @@ public:
                                         const std::string& drc_rules_file);
     
 private:
-    void writeSpiceHeader(std::ofstream& file, const std::string& title);
-    void writeSpiceModel(std::ofstream& file, const SpiceModelParams& model);
-    void writeSpiceDevice(std::ofstream& file, const ExtractedDevice& device);
-    void writeSpiceParasitic(std::ofstream& file, const ParasiticElement& parasitic);
+    void writeSpiceHeader(TextBuffer& file, const std::string& title);
+    void writeSpiceModel(TextBuffer& file, const SpiceModelParams& model);
+    void writeSpiceDevice(TextBuffer& file, const ExtractedDevice& device);
+    void writeSpiceParasitic(TextBuffer& file, const ParasiticElement& parasitic);
     
     GDSCell parseGDSCell(const std::string& cell_data);
     GDSPolygon parseGDSPolygon(const std::string& polygon_data);
     
-    bool isTransistor(const GDSPolygon& poly, const std::vector<GDSPolygon>& all_polygons);
-    ExtractedDevice extractTransistor(const std::vector<GDSPolygon>& transistor_polygons);
+    // Polygons of every GDS layer mapped to process_layer
+    std::vector<GDSPolygon> processLayerPolygons(const std::vector<GDSCell>& cells,
+                                                 const std::string& process_layer) const;
+    // The cells' bounding box, a cell wider on each side, at the extraction
+    // cell size; false when there are no polygons
+    bool extractionGrid(const std::vector<GDSCell>& cells, LayoutWindow& window, int& rows, int& cols) const;
     
     double calculateCapacitance(const GDSPolygon& poly1, const GDSPolygon& poly2);
     double calculateResistance(const GDSPolygon& poly);
@@ -182,19 +205,21 @@ public:
     void importFromSentaurus(const std::string& input_file,
                             std::unordered_map<std::string, double>& results);
     
-    // Design Compiler integration
+    // Design Compiler integration: a Liberty cell per device, named by
+    // its type and instance, with drain, gate, source and bulk pins
     void exportToDesignCompiler(const std::vector<ExtractedDevice>& devices,
                                const std::string& liberty_file);
     
-    // IC Compiler integration
+    // IC Compiler integration: a DEF component per placed reference, in
+    // database units of 1 nm; the first cell names the design
     void exportToICCompiler(const std::vector<GDSCell>& cells,
                            const std::string& def_file);
     
 private:
-    void writeLibertyHeader(std::ofstream& file);
-    void writeLibertyCell(std::ofstream& file, const ExtractedDevice& device);
-    void writeDEFHeader(std::ofstream& file);
-    void writeDEFComponent(std::ofstream& file, const GDSCell& cell);
+    void writeLibertyHeader(TextBuffer& file);
+    void writeLibertyCell(TextBuffer& file, const ExtractedDevice& device);
+    void writeDEFHeader(TextBuffer& file, const std::string& design);
+    void writeDEFComponent(TextBuffer& file, const GDSCell& cell);
 };
 
 /**
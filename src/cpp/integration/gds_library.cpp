@@ -0,0 +1,670 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "gds_library.hpp"
+#include "../core/task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace SemiPRO {
+
+namespace {
+
+// GDSII record types used here
+enum GdsRecord : std::uint8_t {
+    kLibName = 0x02,
+    kUnits = 0x03,
+    kEndLib = 0x04,
+    kBgnStr = 0x05,
+    kStrName = 0x06,
+    kEndStr = 0x07,
+    kBoundary = 0x08,
+    kPath = 0x09,
+    kSref = 0x0A,
+    kAref = 0x0B,
+    kText = 0x0C,
+    kLayer = 0x0D,
+    kDatatype = 0x0E,
+    kWidth = 0x0F,
+    kXY = 0x10,
+    kEndEl = 0x11,
+    kSname = 0x12,
+    kColRow = 0x13,
+    kNode = 0x15,
+    kTextType = 0x16,
+    kStrans = 0x1A,
+    kMag = 0x1B,
+    kAngle = 0x1C,
+    kPathType = 0x21,
+    kBox = 0x2D,
+    kBoxType = 0x2E,
+    kBgnExtn = 0x30,
+    kEndExtn = 0x31
+};
+
+struct Record {
+    std::uint8_t type;
+    const unsigned char* data;
+    std::size_t size;
+};
+
+using Point = std::pair<double, double>;
+
+std::int16_t readInt16(const unsigned char* p) {
+    return static_cast<std::int16_t>(static_cast<std::uint16_t>(p[0] << 8 | p[1]));
+}
+
+std::int32_t readInt32(const unsigned char* p) {
+    return static_cast<std::int32_t>(static_cast<std::uint32_t>(p[0]) << 24 | static_cast<std::uint32_t>(p[1]) << 16 |
+                                     static_cast<std::uint32_t>(p[2]) << 8 | p[3]);
+}
+
+// Excess-64 base-16 exponent, 56-bit mantissa
+double readReal8(const unsigned char* p) {
+    std::uint64_t mantissa = 0;
+    for (int i = 1; i < 8; ++i) {
+        mantissa = mantissa << 8 | p[i];
+    }
+    const double value = std::ldexp(static_cast<double>(mantissa), 4 * ((p[0] & 0x7F) - 64) - 56);
+    return (p[0] & 0x80) ? -value : value;
+}
+
+std::string readString(const Record& record) {
+    std::size_t size = record.size;
+    while (size > 0 && record.data[size - 1] == '\0') {
+        --size;
+    }
+    return std::string(reinterpret_cast<const char*>(record.data), size);
+}
+
+Record recordAt(const std::vector<unsigned char>& stream, std::size_t& pos) {
+    if (pos + 4 > stream.size()) {
+        throw std::runtime_error("GDS stream ends inside a record header");
+    }
+    const std::size_t length = static_cast<std::size_t>(stream[pos]) << 8 | stream[pos + 1];
+    if (length < 4 || pos + length > stream.size()) {
+        throw std::runtime_error("GDS record at byte " + std::to_string(pos) + " has a bad length");
+    }
+    Record record{stream[pos + 2], stream.data() + pos + 4, length - 4};
+    pos += length;
+    return record;
+}
+
+void requireSize(const Record& record, std::size_t size) {
+    if (record.size < size) {
+        throw std::runtime_error("GDS record of type " + std::to_string(record.type) + " is too short");
+    }
+}
+
+// One rectangle per segment; see GDSLibrary
+void appendPath(std::vector<GDSPolygon>& out, int layer, int datatype, const std::vector<Point>& points,
+                double width, int path_type, double begin_extension, double end_extension) {
+    const double half = 0.5 * std::abs(width);
+    if (half == 0.0 || points.size() < 2) {
+        return;
+    }
+    const double begin = path_type == 0 ? 0.0 : path_type == 4 ? begin_extension : half;
+    const double end = path_type == 0 ? 0.0 : path_type == 4 ? end_extension : half;
+    const std::size_t last = points.size() - 2;
+    for (std::size_t k = 0; k + 1 < points.size(); ++k) {
+        const Point& p = points[k];
+        const Point& q = points[k + 1];
+        const double length = std::hypot(q.first - p.first, q.second - p.second);
+        if (length == 0.0) {
+            continue;
+        }
+        const double ux = (q.first - p.first) / length;
+        const double uy = (q.second - p.second) / length;
+        const double e0 = k == 0 ? begin : half;
+        const double e1 = k == last ? end : half;
+        const double ax = p.first - ux * e0, ay = p.second - uy * e0;
+        const double bx = q.first + ux * e1, by = q.second + uy * e1;
+        const double nx = -uy * half, ny = ux * half;
+
+        GDSPolygon polygon;
+        polygon.layer = layer;
+        polygon.datatype = datatype;
+        polygon.points = {{ax + nx, ay + ny}, {bx + nx, by + ny}, {bx - nx, by - ny}, {ax - nx, ay - ny}};
+        out.push_back(std::move(polygon));
+    }
+}
+
+GDSLibrary::Structure parseStructure(const std::vector<unsigned char>& stream, std::size_t pos, std::size_t end,
+                                     double scale) {
+    GDSLibrary::Structure structure;
+    std::uint8_t element = 0;
+    int layer = 0, datatype = 0, path_type = 0;
+    double width = 0.0, begin_extension = 0.0, end_extension = 0.0;
+    std::vector<Point> points;
+    GDSLibrary::Reference reference;
+
+    while (pos < end) {
+        const Record record = recordAt(stream, pos);
+        switch (record.type) {
+        case kStrName: structure.name = readString(record); break;
+        case kBoundary:
+        case kPath:
+        case kBox:
+        case kSref:
+        case kAref:
+        case kText:
+        case kNode:
+            element = record.type;
+            layer = datatype = path_type = 0;
+            width = begin_extension = end_extension = 0.0;
+            points.clear();
+            reference = GDSLibrary::Reference();
+            break;
+        case kLayer: requireSize(record, 2); layer = readInt16(record.data); break;
+        case kDatatype:
+        case kBoxType:
+        case kTextType: requireSize(record, 2); datatype = readInt16(record.data); break;
+        case kWidth: requireSize(record, 4); width = readInt32(record.data) * scale; break;
+        case kPathType: requireSize(record, 2); path_type = readInt16(record.data); break;
+        case kBgnExtn: requireSize(record, 4); begin_extension = readInt32(record.data) * scale; break;
+        case kEndExtn: requireSize(record, 4); end_extension = readInt32(record.data) * scale; break;
+        case kXY:
+            for (std::size_t k = 0; k + 8 <= record.size; k += 8) {
+                points.emplace_back(readInt32(record.data + k) * scale, readInt32(record.data + k + 4) * scale);
+            }
+            break;
+        case kSname: reference.cell = readString(record); break;
+        case kColRow:
+            requireSize(record, 4);
+            reference.columns = std::max<int>(readInt16(record.data), 1);
+            reference.rows = std::max<int>(readInt16(record.data + 2), 1);
+            break;
+        case kStrans: requireSize(record, 2); reference.reflect = (readInt16(record.data) & 0x8000) != 0; break;
+        case kMag: requireSize(record, 8); reference.magnification = readReal8(record.data); break;
+        case kAngle: requireSize(record, 8); reference.angle = readReal8(record.data); break;
+        case kEndEl:
+            if (element == kBoundary || element == kBox) {
+                if (points.size() > 1 && points.front() == points.back()) {
+                    points.pop_back();
+                }
+                if (points.size() >= 3) {
+                    structure.polygons.push_back(GDSPolygon{layer, datatype, points, ""});
+                }
+            } else if (element == kPath) {
+                appendPath(structure.polygons, layer, datatype, points, width, path_type, begin_extension,
+                           end_extension);
+            } else if ((element == kSref || element == kAref) && !points.empty()) {
+                reference.x = points[0].first;
+                reference.y = points[0].second;
+                if (element == kAref) {
+                    if (points.size() < 3) {
+                        throw std::runtime_error("GDS AREF to " + reference.cell + " lacks its lattice points");
+                    }
+                    reference.column_step[0] = (points[1].first - points[0].first) / reference.columns;
+                    reference.column_step[1] = (points[1].second - points[0].second) / reference.columns;
+                    reference.row_step[0] = (points[2].first - points[0].first) / reference.rows;
+                    reference.row_step[1] = (points[2].second - points[0].second) / reference.rows;
+                } else {
+                    reference.columns = reference.rows = 1;
+                }
+                structure.references.push_back(reference);
+            }
+            element = 0;
+            break;
+        default: break;
+        }
+    }
+    return structure;
+}
+
+// x' = a x + b y + tx, y' = c x + d y + ty
+struct Affine {
+    double a = 1.0, b = 0.0, c = 0.0, d = 1.0, tx = 0.0, ty = 0.0;
+
+    Point apply(const Point& p) const {
+        return {a * p.first + b * p.second + tx, c * p.first + d * p.second + ty};
+    }
+    // This after inner
+    Affine compose(const Affine& inner) const {
+        Affine out;
+        out.a = a * inner.a + b * inner.c;
+        out.b = a * inner.b + b * inner.d;
+        out.c = c * inner.a + d * inner.c;
+        out.d = c * inner.b + d * inner.d;
+        out.tx = a * inner.tx + b * inner.ty + tx;
+        out.ty = c * inner.tx + d * inner.ty + ty;
+        return out;
+    }
+};
+
+// Reflection, then magnification, then rotation; right angles are exact
+Affine placement(const GDSLibrary::Reference& reference, double x, double y) {
+    double cosine, sine;
+    const double turns = reference.angle / 90.0;
+    if (turns == std::floor(turns)) {
+        static const double kCos[4] = {1.0, 0.0, -1.0, 0.0};
+        static const double kSin[4] = {0.0, 1.0, 0.0, -1.0};
+        const int quarter = static_cast<int>(((static_cast<long long>(turns) % 4) + 4) % 4);
+        cosine = kCos[quarter];
+        sine = kSin[quarter];
+    } else {
+        const double radians = reference.angle * M_PI / 180.0;
+        cosine = std::cos(radians);
+        sine = std::sin(radians);
+    }
+    const double m = reference.magnification;
+    const double flip = reference.reflect ? -1.0 : 1.0;
+    Affine t;
+    t.a = m * cosine;
+    t.b = -m * sine * flip;
+    t.c = m * sine;
+    t.d = m * cosine * flip;
+    t.tx = x;
+    t.ty = y;
+    return t;
+}
+
+struct Box {
+    double x0 = std::numeric_limits<double>::infinity();
+    double y0 = std::numeric_limits<double>::infinity();
+    double x1 = -std::numeric_limits<double>::infinity();
+    double y1 = -std::numeric_limits<double>::infinity();
+
+    bool empty() const { return x0 > x1; }
+    void add(const Point& p) {
+        x0 = std::min(x0, p.first);
+        y0 = std::min(y0, p.second);
+        x1 = std::max(x1, p.first);
+        y1 = std::max(y1, p.second);
+    }
+    void add(const Box& other) {
+        if (!other.empty()) {
+            add(Point(other.x0, other.y0));
+            add(Point(other.x1, other.y1));
+        }
+    }
+    Box transformed(const Affine& t) const {
+        Box out;
+        if (!empty()) {
+            out.add(t.apply({x0, y0}));
+            out.add(t.apply({x0, y1}));
+            out.add(t.apply({x1, y0}));
+            out.add(t.apply({x1, y1}));
+        }
+        return out;
+    }
+};
+
+bool onLayer(const GDSPolygon& polygon, int layer, int datatype) {
+    return polygon.layer == layer && (datatype < 0 || polygon.datatype == datatype);
+}
+
+// Where instance (column, row) of a reference is placed
+Point instanceOrigin(const GDSLibrary::Reference& reference, int column, int row) {
+    return {reference.x + column * reference.column_step[0] + row * reference.row_step[0],
+            reference.y + column * reference.column_step[1] + row * reference.row_step[1]};
+}
+
+} // namespace
+
+GDSLibrary GDSLibrary::read(const std::string& path) {
+    gzFile file = gzopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Cannot open GDS file: " + path);
+    }
+    gzbuffer(file, 1 << 20);
+    std::vector<unsigned char> stream;
+    std::vector<unsigned char> chunk(1 << 20);
+    int bytes;
+    while ((bytes = gzread(file, chunk.data(), static_cast<unsigned>(chunk.size()))) > 0) {
+        stream.insert(stream.end(), chunk.begin(), chunk.begin() + bytes);
+    }
+    const bool failed = bytes < 0;
+    gzclose(file);
+    if (failed) {
+        throw std::runtime_error("Cannot read GDS file: " + path);
+    }
+    return parse(stream);
+}
+
+GDSLibrary GDSLibrary::parse(const std::vector<unsigned char>& stream) {
+    GDSLibrary library;
+
+    // Index: hop over the records once, keeping where each structure lies
+    std::vector<std::pair<std::size_t, std::size_t>> spans;
+    std::size_t pos = 0;
+    std::size_t structure_begin = 0;
+    bool in_structure = false;
+    bool ended = false;
+    while (pos < stream.size() && !ended) {
+        const std::size_t at = pos;
+        const Record record = recordAt(stream, pos);
+        switch (record.type) {
+        case kLibName: library.name_ = readString(record); break;
+        case kUnits:
+            requireSize(record, 16);
+            library.user_units_per_db_ = readReal8(record.data);
+            library.meters_per_db_ = readReal8(record.data + 8);
+            break;
+        case kBgnStr:
+            if (in_structure) {
+                throw std::runtime_error("GDS structure begins inside another one");
+            }
+            in_structure = true;
+            structure_begin = at;
+            break;
+        case kEndStr:
+            if (!in_structure) {
+                throw std::runtime_error("GDS structure ends without beginning");
+            }
+            in_structure = false;
+            spans.emplace_back(structure_begin, at);
+            break;
+        case kEndLib: ended = true; break;
+        default: break;
+        }
+    }
+    if (in_structure || !ended) {
+        throw std::runtime_error("GDS stream is truncated");
+    }
+
+    const double scale = library.user_units_per_db_;
+    library.structures_.resize(spans.size());
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(spans.size()), [&](int begin, int end) {
+        for (int s = begin; s < end; ++s) {
+            library.structures_[s] = parseStructure(stream, spans[s].first, spans[s].second, scale);
+        }
+    });
+
+    for (std::size_t s = 0; s < library.structures_.size(); ++s) {
+        library.index_.emplace(library.structures_[s].name, static_cast<int>(s));
+    }
+    for (auto& structure : library.structures_) {
+        for (auto& reference : structure.references) {
+            reference.target = library.findStructure(reference.cell);
+        }
+    }
+    return library;
+}
+
+int GDSLibrary::findStructure(const std::string& name) const {
+    auto it = index_.find(name);
+    return it == index_.end() ? -1 : it->second;
+}
+
+int GDSLibrary::topStructure() const {
+    std::vector<char> referenced(structures_.size(), 0);
+    for (const auto& structure : structures_) {
+        for (const auto& reference : structure.references) {
+            if (reference.target >= 0) {
+                referenced[reference.target] = 1;
+            }
+        }
+    }
+    auto it = std::find(referenced.begin(), referenced.end(), 0);
+    return it == referenced.end() ? -1 : static_cast<int>(it - referenced.begin());
+}
+
+GDSLibrary::Bounds GDSLibrary::layerBounds(int structure, int layer, int datatype, std::vector<Bounds>& memo,
+                                           std::vector<char>& state) const {
+    if (state[structure] == 2) {
+        return memo[structure];
+    }
+    if (state[structure] == 1) {
+        throw std::runtime_error("GDS structure " + structures_[structure].name + " references itself");
+    }
+    state[structure] = 1;
+
+    Box box;
+    for (const auto& polygon : structures_[structure].polygons) {
+        if (onLayer(polygon, layer, datatype)) {
+            for (const auto& p : polygon.points) {
+                box.add(p);
+            }
+        }
+    }
+    for (const auto& reference : structures_[structure].references) {
+        if (reference.target < 0) {
+            continue;
+        }
+        const Bounds child = layerBounds(reference.target, layer, datatype, memo, state);
+        if (child.empty) {
+            continue;
+        }
+        Box child_box;
+        child_box.add(Point(child.x0, child.y0));
+        child_box.add(Point(child.x1, child.y1));
+        // Instances only translate, so the corner instances bound the array
+        for (int column : {0, reference.columns - 1}) {
+            for (int row : {0, reference.rows - 1}) {
+                const Point origin = instanceOrigin(reference, column, row);
+                box.add(child_box.transformed(placement(reference, origin.first, origin.second)));
+            }
+        }
+    }
+
+    memo[structure] = Bounds{box.x0, box.y0, box.x1, box.y1, box.empty()};
+    state[structure] = 2;
+    return memo[structure];
+}
+
+std::vector<GDSPolygon> GDSLibrary::flatten(int layer, const LayoutWindow& window, int datatype,
+                                            const std::string& top) const {
+    const int root = top.empty() ? topStructure() : findStructure(top);
+    if (root < 0) {
+        throw std::runtime_error(top.empty() ? "GDS library has no top structure"
+                                             : "GDS library has no structure " + top);
+    }
+
+    std::vector<Bounds> memo(structures_.size());
+    std::vector<char> state(structures_.size(), 0);
+    for (std::size_t s = 0; s < structures_.size(); ++s) {
+        layerBounds(static_cast<int>(s), layer, datatype, memo, state);
+    }
+
+    auto reaches = [&](const Box& box) { return !box.empty() && window.intersects(box.x0, box.y0, box.x1, box.y1); };
+    auto boundsOf = [&](int s) {
+        Box box;
+        if (!memo[s].empty) {
+            box.add(Point(memo[s].x0, memo[s].y0));
+            box.add(Point(memo[s].x1, memo[s].y1));
+        }
+        return box;
+    };
+
+    // Depth-first below one placement; memo and state are only read here
+    std::function<void(int, const Affine&, std::vector<GDSPolygon>&)> expand;
+    expand = [&](int s, const Affine& t, std::vector<GDSPolygon>& out) {
+        const Structure& structure = structures_[s];
+        for (const auto& polygon : structure.polygons) {
+            if (!onLayer(polygon, layer, datatype)) {
+                continue;
+            }
+            GDSPolygon placed{polygon.layer, polygon.datatype, {}, polygon.layer_name};
+            placed.points.reserve(polygon.points.size());
+            Box box;
+            for (const auto& p : polygon.points) {
+                placed.points.push_back(t.apply(p));
+                box.add(placed.points.back());
+            }
+            if (reaches(box)) {
+                out.push_back(std::move(placed));
+            }
+        }
+        for (const auto& reference : structure.references) {
+            if (reference.target < 0 || memo[reference.target].empty) {
+                continue;
+            }
+            const Box child = boundsOf(reference.target);
+            for (int row = 0; row < reference.rows; ++row) {
+                for (int column = 0; column < reference.columns; ++column) {
+                    const Point origin = instanceOrigin(reference, column, row);
+                    const Affine placed = t.compose(placement(reference, origin.first, origin.second));
+                    if (reaches(child.transformed(placed))) {
+                        expand(reference.target, placed, out);
+                    }
+                }
+            }
+        }
+    };
+
+    // The top structure's own polygons, then one task per instance it
+    // places in the window, gathered in order so the result is the same
+    // for any thread count
+    struct Instance {
+        int target;
+        Affine placed;
+    };
+    std::vector<Instance> instances;
+    for (const auto& reference : structures_[root].references) {
+        if (reference.target < 0 || memo[reference.target].empty) {
+            continue;
+        }
+        const Box child = boundsOf(reference.target);
+        for (int row = 0; row < reference.rows; ++row) {
+            for (int column = 0; column < reference.columns; ++column) {
+                const Point origin = instanceOrigin(reference, column, row);
+                const Affine placed = placement(reference, origin.first, origin.second);
+                if (reaches(child.transformed(placed))) {
+                    instances.push_back({reference.target, placed});
+                }
+            }
+        }
+    }
+
+    std::vector<GDSPolygon> result;
+    for (const auto& polygon : structures_[root].polygons) {
+        if (!onLayer(polygon, layer, datatype)) {
+            continue;
+        }
+        Box box;
+        for (const auto& p : polygon.points) {
+            box.add(p);
+        }
+        if (reaches(box)) {
+            result.push_back(polygon);
+        }
+    }
+
+    std::vector<std::vector<GDSPolygon>> parts(instances.size());
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(instances.size()), [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            expand(instances[k].target, instances[k].placed, parts[k]);
+        }
+    });
+    for (auto& part : parts) {
+        result.insert(result.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+    }
+    return result;
+}
+
+BitMask rasterizeLayout(const std::vector<GDSPolygon>& polygons, const LayoutWindow& window, int rows, int cols) {
+    return rasterizeLayout(polygons, window, rows, cols, 0, 0, rows, cols);
+}
+
+BitMask rasterizeLayout(const std::vector<GDSPolygon>& polygons, const LayoutWindow& window, int rows, int cols,
+                        int row, int col, int block_rows, int block_cols) {
+    if (rows <= 0 || cols <= 0 || !(window.x_max > window.x_min) || !(window.y_max > window.y_min)) {
+        throw std::invalid_argument("Layout rasterization needs a non-empty grid and window");
+    }
+    if (block_rows < 0 || block_cols < 0) {
+        throw std::invalid_argument("Layout rasterization needs a block of non-negative size");
+    }
+    constexpr int kBand = 64;
+    const double dx = (window.x_max - window.x_min) / rows;
+    const double dy = (window.y_max - window.y_min) / cols;
+    // The grid rows and columns the block covers; cell centres are taken
+    // on the whole grid, so a block matches the full raster exactly
+    const int row_begin = std::max(row, 0);
+    const int row_end = static_cast<int>(std::min<long>(static_cast<long>(row) + block_rows, rows));
+    const int col_begin = std::max(col, 0);
+    const int col_end = static_cast<int>(std::min<long>(static_cast<long>(col) + block_cols, cols));
+    BitMask mask(block_rows, block_cols);
+    if (row_begin >= row_end || col_begin >= col_end) {
+        return mask;
+    }
+    const int bands = (row_end - row_begin + kBand - 1) / kBand;
+
+    // Rows whose centre x lies within each polygon's x extent
+    std::vector<std::pair<int, int>> row_range(polygons.size(), {0, -1});
+    std::vector<std::vector<int>> banded(bands);
+    for (std::size_t k = 0; k < polygons.size(); ++k) {
+        const auto& points = polygons[k].points;
+        if (points.size() < 3) {
+            continue;
+        }
+        double x0 = points[0].first, x1 = points[0].first;
+        for (const auto& p : points) {
+            x0 = std::min(x0, p.first);
+            x1 = std::max(x1, p.first);
+        }
+        const int first = static_cast<int>(std::max<double>(std::ceil((x0 - window.x_min) / dx - 0.5), row_begin));
+        const int last = static_cast<int>(std::min<double>(std::floor((x1 - window.x_min) / dx - 0.5), row_end - 1));
+        if (first > last) {
+            continue;
+        }
+        row_range[k] = {first, last};
+        for (int b = (first - row_begin) / kBand; b <= (last - row_begin) / kBand; ++b) {
+            banded[b].push_back(static_cast<int>(k));
+        }
+    }
+
+    TaskScheduler::getInstance().parallelFor(0, bands, [&](int band_begin, int band_end) {
+        std::vector<double> crossings;
+        for (int b = band_begin; b < band_end; ++b) {
+            const int band_end_row = std::min(row_end, row_begin + (b + 1) * kBand);
+            for (int i = row_begin + b * kBand; i < band_end_row; ++i) {
+                const double xc = window.x_min + (i + 0.5) * dx;
+                for (int k : banded[b]) {
+                    if (i < row_range[k].first || i > row_range[k].second) {
+                        continue;
+                    }
+                    const auto& points = polygons[k].points;
+                    crossings.clear();
+                    for (std::size_t e = 0; e < points.size(); ++e) {
+                        const Point& p = points[e];
+                        const Point& q = points[(e + 1) % points.size()];
+                        if ((p.first > xc) != (q.first > xc)) {
+                            crossings.push_back(p.second + (xc - p.first) * (q.second - p.second) / (q.first - p.first));
+                        }
+                    }
+                    std::sort(crossings.begin(), crossings.end());
+                    // Cells whose centre y lies in [ya, yb)
+                    for (std::size_t c = 0; c + 1 < crossings.size(); c += 2) {
+                        const double ja = std::ceil((crossings[c] - window.y_min) / dy - 0.5);
+                        const double jb = std::ceil((crossings[c + 1] - window.y_min) / dy - 0.5);
+                        const int begin = static_cast<int>(std::min<double>(std::max<double>(ja, col_begin), col_end));
+                        const int end = static_cast<int>(std::min<double>(std::max<double>(jb, col_begin), col_end));
+                        if (begin < end) {
+                            mask.setSpan(i - row, begin - col, end - col);
+                        }
+                    }
+                }
+            }
+        }
+    });
+    return mask;
+}
+
+std::function<BitMask(int, int, int, int)> layoutBlockSource(const GDSLibrary& library, int layer,
+                                                              const LayoutWindow& window, int rows, int cols,
+                                                              int datatype) {
+    if (rows <= 0 || cols <= 0 || !(window.x_max > window.x_min) || !(window.y_max > window.y_min)) {
+        throw std::invalid_argument("Layout rasterization needs a non-empty grid and window");
+    }
+    return [&library, layer, window, rows, cols, datatype](int row, int col, int block_rows, int block_cols) {
+        const double dx = (window.x_max - window.x_min) / rows;
+        const double dy = (window.y_max - window.y_min) / cols;
+        // The block's share of the window, clipped to it; polygons reaching
+        // it are all that can cover a cell centre of the block
+        LayoutWindow block;
+        block.x_min = window.x_min + std::max(row, 0) * dx;
+        block.x_max = window.x_min + std::min<long>(static_cast<long>(row) + block_rows, rows) * dx;
+        block.y_min = window.y_min + std::max(col, 0) * dy;
+        block.y_max = window.y_min + std::min<long>(static_cast<long>(col) + block_cols, cols) * dy;
+        if (!(block.x_max > block.x_min) || !(block.y_max > block.y_min)) {
+            return BitMask(block_rows, block_cols);
+        }
+        return rasterizeLayout(library.flatten(layer, block, datatype), window, rows, cols, row, col, block_rows,
+                               block_cols);
+    };
+}
+
+} // namespace SemiPRO
@@ -0,0 +1,129 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+
+#include "../core/bit_mask.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace SemiPRO {
+
+/**
+ * @brief GDS polygon structure
+ */
+struct GDSPolygon {
+    int layer;
+    int datatype;
+    std::vector<std::pair<double, double>> points;
+    std::string layer_name;
+};
+
+/**
+ * @brief Axis-aligned layout region in user units (usually um)
+ */
+struct LayoutWindow {
+    double x_min = 0.0;
+    double y_min = 0.0;
+    double x_max = 0.0;
+    double y_max = 0.0;
+
+    bool intersects(double x0, double y0, double x1, double y1) const {
+        return x0 <= x_max && x1 >= x_min && y0 <= y_max && y1 >= y_min;
+    }
+};
+
+/**
+ * @brief A GDSII stream file, parsed into its structures
+ *
+ * Boundaries, boxes and paths are kept as closed polygons in user units;
+ * paths become one rectangle per segment, extended by half their width
+ * at joints (and at the ends, as their path type says), which is exact
+ * for Manhattan paths. Text and node elements are skipped. Structure
+ * references stay references until flatten(), which only expands the
+ * instances whose bounding box reaches the requested window, so a small
+ * window of a full-chip layout costs little more than its own polygons.
+ */
+class GDSLibrary {
+public:
+    struct Reference {
+        std::string cell;
+        int target = -1; // Index into structures(), -1 when undefined
+        double x = 0.0;
+        double y = 0.0;
+        bool reflect = false; // About the x axis, before rotation
+        double magnification = 1.0;
+        double angle = 0.0; // Degrees, counterclockwise
+        // Arrays (AREF): columns x rows instances, stepped by these vectors
+        int columns = 1;
+        int rows = 1;
+        double column_step[2] = {0.0, 0.0};
+        double row_step[2] = {0.0, 0.0};
+    };
+
+    struct Structure {
+        std::string name;
+        std::vector<GDSPolygon> polygons;
+        std::vector<Reference> references;
+    };
+
+    // Reads a GDSII stream, gzip-compressed or not. The record stream is
+    // indexed in one pass and the structures are then decoded in parallel
+    // on the TaskScheduler. Throws std::runtime_error on malformed input.
+    static GDSLibrary read(const std::string& path);
+    static GDSLibrary parse(const std::vector<unsigned char>& stream);
+
+    const std::string& name() const { return name_; }
+    const std::vector<Structure>& structures() const { return structures_; }
+    // -1 when there is no such structure
+    int findStructure(const std::string& name) const;
+    // The first structure no other one references
+    int topStructure() const;
+    double userUnitsPerDatabaseUnit() const { return user_units_per_db_; }
+    double metersPerDatabaseUnit() const { return meters_per_db_; }
+
+    // Polygons on `layer` (any datatype when datatype < 0) below `top`
+    // (topStructure() when empty), in the top structure's user-unit
+    // coordinates, keeping only those whose bounding box reaches window
+    std::vector<GDSPolygon> flatten(int layer, const LayoutWindow& window, int datatype = -1,
+                                    const std::string& top = "") const;
+
+private:
+    struct Bounds {
+        double x0, y0, x1, y1;
+        bool empty;
+    };
+    // Of everything on layer below structure; memo and state are indexed
+    // like structures_ (state: 0 unseen, 1 in progress, 2 done)
+    Bounds layerBounds(int structure, int layer, int datatype, std::vector<Bounds>& memo,
+                       std::vector<char>& state) const;
+
+    std::string name_;
+    std::vector<Structure> structures_;
+    std::unordered_map<std::string, int> index_;
+    double user_units_per_db_ = 1e-3;
+    double meters_per_db_ = 1e-9;
+};
+
+// Marks the cells of a rows x cols grid laid over window whose centre lies
+// inside any of the polygons (each filled even-odd, overlaps unioned). Rows
+// run along x and columns along y, as the wafer grid's x and y
+// dimensions. Polygons are binned into bands of rows, which are filled in
+// parallel and only test the polygons that reach them.
+BitMask rasterizeLayout(const std::vector<GDSPolygon>& polygons, const LayoutWindow& window, int rows, int cols);
+// Cells [row, row + block_rows) x [col, col + block_cols) of that raster,
+// bit for bit; cells past it are clear
+BitMask rasterizeLayout(const std::vector<GDSPolygon>& polygons, const LayoutWindow& window, int rows, int cols,
+                        int row, int col, int block_rows, int block_cols);
+
+// Blocks of the raster of `layer` over window, each flattened from the
+// library as it is asked for, so a tiled exposure only ever holds one
+// tile's polygons. Safe to call from several threads; library must
+// outlive the source.
+std::function<BitMask(int, int, int, int)> layoutBlockSource(const GDSLibrary& library, int layer,
+                                                              const LayoutWindow& window, int rows, int cols,
+                                                              int datatype = -1);
+
+} // namespace SemiPRO
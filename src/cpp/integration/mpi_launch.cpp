@@ -0,0 +1,58 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "mpi_launch.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace SemiPRO {
+
+namespace {
+
+int ranksPerNode(const ContainerConfig& container, const MpiLaunchConfig& launch) {
+    return launch.ranks_per_node > 0 ? launch.ranks_per_node : std::max(container.cpu_cores, 1);
+}
+
+int nodeCount(const ClusterConfig& cluster) {
+    return std::clamp(cluster.desired_nodes, cluster.min_nodes, std::max(cluster.min_nodes, cluster.max_nodes));
+}
+
+} // namespace
+
+int mpiRankCount(const ClusterConfig& cluster, const ContainerConfig& container, const MpiLaunchConfig& launch) {
+    return std::max(nodeCount(cluster), 0) * ranksPerNode(container, launch);
+}
+
+CloudJob makeMpiJob(const std::string& job_name, const ClusterConfig& cluster, const ContainerConfig& container,
+                    const MpiLaunchConfig& launch) {
+    if (container.command_args.empty()) {
+        throw std::invalid_argument("An MPI job needs a command to launch");
+    }
+    const int nodes = nodeCount(cluster);
+    const int per_node = ranksPerNode(container, launch);
+    const int ranks = mpiRankCount(cluster, container, launch);
+    if (ranks <= 0) {
+        throw std::invalid_argument("An MPI job needs at least one rank");
+    }
+    const int threads =
+        launch.threads_per_rank > 0 ? launch.threads_per_rank : std::max(container.cpu_cores / per_node, 1);
+
+    CloudJob job;
+    job.job_id = cluster.cluster_name + "-" + job_name;
+    job.job_name = job_name;
+    job.queue_name = cluster.cluster_name;
+    job.container = container;
+    job.container.environment_vars["OMP_NUM_THREADS"] = std::to_string(threads);
+    job.container.command_args = {launch.launcher, "-np", std::to_string(ranks),
+                                  "--map-by", "ppr:" + std::to_string(per_node) + ":node",
+                                  "--hostfile", launch.hostfile,
+                                  "-x", "OMP_NUM_THREADS"};
+    job.container.command_args.insert(job.container.command_args.end(), container.command_args.begin(),
+                                      container.command_args.end());
+    job.metadata["mpi.nodes"] = std::to_string(nodes);
+    job.metadata["mpi.ranks"] = std::to_string(ranks);
+    job.metadata["mpi.ranks_per_node"] = std::to_string(per_node);
+    job.metadata["cluster.region"] = cluster.region;
+    job.metadata["cluster.instance_type"] = cluster.instance_type;
+    return job;
+}
+
+} // namespace SemiPRO
@@ -0,0 +1,38 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+
+#include "cloud_integration.hpp"
+#include <string>
+
+namespace SemiPRO {
+
+/**
+ * @brief How a domain-decomposed solve spreads over a cluster's nodes
+ */
+struct MpiLaunchConfig {
+    int ranks_per_node = 1;                      // 0 for one per container CPU core
+    int threads_per_rank = 0;                    // OMP_NUM_THREADS; 0 to split the container's cores
+    std::string launcher = "mpirun";
+    std::string hostfile = "/etc/mpi/hostfile";  // Written by the cluster's MPI operator
+};
+
+/**
+ * @brief Ranks a launch starts: desired nodes, kept within the cluster's
+ * bounds, times ranks per node
+ */
+int mpiRankCount(const ClusterConfig& cluster, const ContainerConfig& container, const MpiLaunchConfig& launch = {});
+
+/**
+ * @brief A cloud job running the container's command under the MPI
+ * launcher on the cluster's nodes
+ *
+ * The command must be a program built with MPI support that takes its
+ * communicator from GridComm::mpiWorldCommunicator(). The job is queued
+ * on the cluster and records the rank layout in its metadata.
+ * @throws std::invalid_argument for a container without a command or a
+ * layout with no ranks
+ */
+CloudJob makeMpiJob(const std::string& job_name, const ClusterConfig& cluster, const ContainerConfig& container,
+                    const MpiLaunchConfig& launch = {});
+
+} // namespace SemiPRO
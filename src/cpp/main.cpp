@@ -1,43 +1,14 @@
 #include "core/utils.hpp"
 #include "core/simulation_engine.hpp"
 #include "core/wafer_enhanced.hpp"
+#include "core/job_manifest.hpp"
+#include "core/progress_events.hpp"
+#include "api/simulation_server.hpp"
+#include "api/sweep_runner.hpp"
 #include <memory>
 #include <iostream>
-#include <fstream>
 #include <string>
-#include <unordered_map>
-
-// JSON parsing (simple implementation)
-#include <sstream>
-
-std::unordered_map<std::string, std::string> parseSimpleJSON(const std::string& json_content) {
-    std::unordered_map<std::string, std::string> result;
-
-    // Very simple JSON parser for our specific format
-    std::istringstream iss(json_content);
-    std::string line;
-
-    while (std::getline(iss, line)) {
-        size_t colon_pos = line.find(':');
-        if (colon_pos != std::string::npos) {
-            std::string key = line.substr(0, colon_pos);
-            std::string value = line.substr(colon_pos + 1);
-
-            // Remove quotes, spaces, commas
-            key.erase(std::remove_if(key.begin(), key.end(), [](char c) {
-                return c == '"' || c == ' ' || c == '\t';
-            }), key.end());
-
-            value.erase(std::remove_if(value.begin(), value.end(), [](char c) {
-                return c == '"' || c == ' ' || c == '\t' || c == ',';
-            }), value.end());
-
-            result[key] = value;
-        }
-    }
-
-    return result;
-}
+#include <unordered_set>
 
 int main(int argc, char* argv[]) {
     try {
@@ -50,6 +21,7 @@ int main(int argc, char* argv[]) {
         // Parse command line arguments
         std::string config_file;
         std::string process_type;
+        std::string socket_path;
 
         for (int i = 1; i < argc; i++) {
             std::string arg = argv[i];
@@ -59,9 +31,21 @@ int main(int argc, char* argv[]) {
             } else if (arg == "--process" && i + 1 < argc) {
                 process_type = argv[i + 1];
                 i++;
+            } else if (arg == "--serve" && i + 1 < argc) {
+                socket_path = argv[i + 1];
+                i++;
+            } else if (arg == "--progress") {
+                ProgressEvents::getInstance().setConsoleOutput(true);
             }
         }
 
+        if (!socket_path.empty()) {
+            // Long-lived server for the Python bridge; --config only configures the engine
+            SimulationEngine::getInstance().initialize(config_file);
+            SemiPRO::SimulationServer(socket_path).run();
+            return 0;
+        }
+
         if (config_file.empty()) {
             std::cout << "No config file specified, running default simulation" << std::endl;
             Logger::getInstance().log("No config file specified, running default simulation");
@@ -86,103 +70,57 @@ int main(int argc, char* argv[]) {
             return success ? 0 : 1;
         }
 
-        // Read configuration file
-        std::ifstream file(config_file);
-        if (!file.is_open()) {
-            Logger::getInstance().log("Failed to open config file: " + config_file);
-            return 1;
+        // One file may hold a whole batch of jobs; it is parsed and checked once
+        const auto document = SemiPRO::JsonValue::parseFile(config_file);
+        if (document.find("sweep")) {
+            const auto sweep = SemiPRO::readConfigSweep(document);
+            SimulationEngine::getInstance().initialize(config_file);
+            const auto table = SemiPRO::runSweep(sweep, process_type);
+            SemiPRO::writeSweepTable(table, sweep.output);
+            Logger::getInstance().log("Sweep results written to " + sweep.output);
+            return table.failures == 0 ? 0 : 1;
         }
+        const auto jobs = SemiPRO::readConfigJobs(document);
 
-        std::string json_content((std::istreambuf_iterator<char>(file)),
-                                std::istreambuf_iterator<char>());
-        file.close();
-
-        auto config = parseSimpleJSON(json_content);
-
-        // Create wafer and simulation engine
         auto& engine = SimulationEngine::getInstance();
         engine.initialize(config_file); // Initialize with config file
-        auto wafer = engine.createWafer(300.0, 775.0, "silicon");
-        wafer->initializeGrid(50, 50);
-        engine.registerWafer(wafer, "main_wafer");
-
-        // Handle different operation types
-        bool success = false;
-
-        if (process_type == "geometry_init") {
-            // Geometry initialization - already done above
-            success = true;
-            Logger::getInstance().log("Geometry initialization completed");
-
-        } else if (process_type == "grid_init") {
-            // Grid initialization - already done above
-            success = true;
-            Logger::getInstance().log("Grid initialization completed");
-
-        } else if (process_type == "oxidation") {
-            SimulationEngine::ProcessParameters params(process_type, 1.0);
-            params.parameters["temperature"] = std::stod(config.count("temperature") ? config["temperature"] : "1000");
-            params.parameters["time"] = std::stod(config.count("time") ? config["time"] : "1.0");
-            params.parameters["ambient"] = config.count("atmosphere") && config["atmosphere"] == "wet" ? 1.0 : 0.0;
-
-            auto future = engine.simulateProcessAsync("main_wafer", params);
-            success = future.get();
-
-        } else if (process_type == "doping") {
-            SimulationEngine::ProcessParameters params(process_type, 1.0);
-            params.parameters["energy"] = std::stod(config.count("energy") ? config["energy"] : "50");
-            params.parameters["dose"] = std::stod(config.count("dose") ? config["dose"] : "1e15");
-            params.parameters["mass"] = std::stod(config.count("mass") ? config["mass"] : "11.0");
-            params.parameters["atomic_number"] = std::stod(config.count("atomic_number") ? config["atomic_number"] : "5.0");
-
-            // Use direct execution to avoid batch processing deadlock
-            std::cout << "Starting ion implantation simulation..." << std::endl;
-            std::cout << "DEBUG: About to call simulateProcessAsync for doping" << std::endl;
-            auto future = engine.simulateProcessAsync("main_wafer", params);
-            std::cout << "DEBUG: simulateProcessAsync returned, getting result..." << std::endl;
-            success = future.get();
-            std::cout << "DEBUG: Result obtained: " << (success ? "true" : "false") << std::endl;
-            std::cout << "Ion implantation completed: " << (success ? "SUCCESS" : "FAILED") << std::endl;
-
-        } else if (process_type == "deposition") {
-            SimulationEngine::ProcessParameters params(process_type, 1.0);
-            params.parameters["thickness"] = std::stod(config.count("thickness") ? config["thickness"] : "0.5");
-            params.parameters["temperature"] = std::stod(config.count("temperature") ? config["temperature"] : "400");
-
-            // Add material parameter with proper default
-            std::string material = config.count("material") ? config["material"] : "aluminum";
-            params.string_parameters["material"] = material;
-
-            std::cout << "Starting deposition simulation..." << std::endl;
-            std::cout << "  Material: " << material << std::endl;
-            std::cout << "  Thickness: " << params.parameters["thickness"] << " μm" << std::endl;
-            std::cout << "  Temperature: " << params.parameters["temperature"] << "°C" << std::endl;
-            std::cout << "DEBUG: About to call simulateProcessAsync for deposition" << std::endl;
-
-            auto future = engine.simulateProcessAsync("main_wafer", params);
-            std::cout << "DEBUG: simulateProcessAsync returned, getting result..." << std::endl;
-            success = future.get();
-            std::cout << "DEBUG: Result obtained: " << (success ? "true" : "false") << std::endl;
-            std::cout << "Deposition completed: " << (success ? "SUCCESS" : "FAILED") << std::endl;
-
-        } else if (process_type == "etching") {
-            SimulationEngine::ProcessParameters params(process_type, 1.0);
-            params.parameters["depth"] = std::stod(config.count("rate") ? config["rate"] : "0.5");
-            params.parameters["type"] = config.count("etch_type") && config["etch_type"] == "isotropic" ? 0.0 : 1.0;
-            params.parameters["selectivity"] = std::stod(config.count("selectivity") ? config["selectivity"] : "10");
-
-            auto future = engine.simulateProcessAsync("main_wafer", params);
-            success = future.get();
-
-        } else {
-            Logger::getInstance().log("Unknown process type: " + process_type);
-            success = false;
-        }
 
-        Logger::getInstance().log("Simulation completed: " + process_type + " - " +
-                                 std::string(success ? "SUCCESS" : "FAILED"));
+        // Jobs naming the same wafer run on it in order; others get their own
+        std::unordered_set<std::string> wafers;
+        int failures = 0;
+        for (const auto& job : jobs) {
+            std::string wafer = job.wafer;
+            if (wafer.empty()) {
+                wafer = jobs.size() == 1 ? "main_wafer" : job.name;
+            }
+            const std::string process = job.process.empty() ? process_type : job.process;
+
+            bool success = true;
+            try {
+                if (!job.geometry.isNull() || wafers.insert(wafer).second) {
+                    success = SemiPRO::runBridgeProcess(wafer, "geometry_init", job.geometry);
+                }
+                if (success && !job.grid.isNull()) {
+                    success = SemiPRO::runBridgeProcess(wafer, "grid_init", job.grid);
+                }
+                if (success) {
+                    success = SemiPRO::runBridgeProcess(wafer, process, job.parameters);
+                }
+            } catch (const std::exception& e) {
+                Logger::getInstance().log("Job " + job.name + " failed: " + std::string(e.what()));
+                success = false;
+            }
+            failures += success ? 0 : 1;
 
-        return success ? 0 : 1;
+            Logger::getInstance().log("Simulation completed: " + job.name + " (" + process + ") - " +
+                                     std::string(success ? "SUCCESS" : "FAILED"));
+        }
+
+        if (jobs.size() > 1) {
+            Logger::getInstance().log("Batch completed: " + std::to_string(jobs.size() - failures) + " of " +
+                                     std::to_string(jobs.size()) + " jobs succeeded");
+        }
+        return failures == 0 ? 0 : 1;
 
     } catch (const std::exception& e) {
         std::cerr << "Simulation failed with exception: " << e.what() << std::endl;
@@ -1,8 +1,68 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "advanced_interconnects.hpp"
-#include "../core/utils.hpp"
+#include "../../core/utils.hpp"
+#include "../../core/pattern_density.hpp"
+#include "../../core/task_scheduler.hpp"
+#include "../interconnect/cmp_model.hpp"
 #include <cmath>
 #include <algorithm>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+
+// Sigma in grid cells of the area the polishing pad averages pattern
+// density over
+constexpr double kPlanarizationLength = 25.0;
+// Half width in cells of the box the raised fraction of each cell is read
+// over for the CMP engine
+constexpr int kDensityRadius = 2;
+// Step the pad reaches down over, a step left when polishing stops, and
+// the longest polish, in units of the profile's full step
+constexpr double kContactFraction = 0.1;
+constexpr double kLevelTolerance = 0.01;
+constexpr double kMaxPolishTime = 20.0;
+
+constexpr double kEpsilon0 = 8.854e-12; // F/m
+constexpr double kMu0 = 4e-7 * M_PI;    // H/m
+constexpr double kSpeedOfLight = 2.998e14; // μm/s
+
+// Per-μm line models (dimensions in nm) shared by the single-layer and
+// batched extraction
+double lineResistance(double width, double thickness, double resistivity) {
+    double cross_sectional_area = width * thickness * 1e-18; // m²
+    double length = 1e-6; // 1 μm length
+    
+    return resistivity * 1e-8 * length / cross_sectional_area; // Ω/μm
+}
+
+double closedFormCapacitance(double width, double spacing, double dielectric_constant) {
+    double area = width * 1e-9; // m
+    double gap = spacing * 1e-9; // m
+    double length = 1e-6; // 1 μm length
+    
+    return kEpsilon0 * dielectric_constant * area / gap * length; // F/μm
+}
+
+// Two parallel lines a pitch apart, each a round wire of the rectangle's
+// equivalent radius 0.2235 (w + t)
+double loopInductance(double width, double spacing, double thickness) {
+    const double diameter = 0.447 * (width + thickness);
+    return kMu0 / M_PI * std::acosh(std::max(1.0, (width + spacing) / diameter)) * 1e-6; // H/μm
+}
+
+// Sidewall coupling to the neighbours against the bottom plate to a level
+// a line thickness below
+double couplingShare(double width, double spacing, double thickness) {
+    const double coupling = thickness / spacing;
+    return coupling / (coupling + width / thickness);
+}
+
+double lineDelay(double resistance, double capacitance, double dielectric_constant, double length) {
+    return 0.38 * resistance * capacitance * length * length + length * std::sqrt(dielectric_constant) / kSpeedOfLight;
+}
+
+} // namespace
 
 AdvancedInterconnects::AdvancedInterconnects()
     : air_gap_enabled_(false)
@@ -10,28 +70,25 @@ AdvancedInterconnects::AdvancedInterconnects()
     , advanced_barriers_enabled_(true)
     , process_temperature_(400.0)
 {
-    initializeMetalDatabase();
-    initializeDielectricDatabase();
-    
     // Initialize metrics
     metrics_ = InterconnectMetrics{};
     reliability_ = ReliabilityMetrics{};
     
-    Logger::getInstance().log("Advanced Interconnects system initialized");
+    SEMIPRO_LOGF(INFO, PHYSICS, "Advanced Interconnects system initialized");
 }
 
 bool AdvancedInterconnects::simulateDualDamascene(std::shared_ptr<Wafer> wafer,
                                                  const InterconnectLayer& layer,
                                                  const DamasceneParameters& params) {
     try {
-        Logger::getInstance().log("Starting dual damascene simulation for " + layer.name);
-        Logger::getInstance().log("Line width: " + std::to_string(layer.line_width) + "nm");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Starting dual damascene simulation for {}", layer.name);
+        SEMIPRO_LOGF(INFO, PHYSICS, "Line width: {}nm", layer.line_width);
         
         // Simulate barrier deposition
         bool barrier_success = simulateBarrierDeposition(wafer, params.barrier_material, 
                                                         params.barrier_thickness);
         if (!barrier_success) {
-            Logger::getInstance().log("Barrier deposition failed");
+            SEMIPRO_LOGF(INFO, PHYSICS, "Barrier deposition failed");
             return false;
         }
         
@@ -39,7 +96,7 @@ bool AdvancedInterconnects::simulateDualDamascene(std::shared_ptr<Wafer> wafer,
         bool seed_success = simulateSeedDeposition(wafer, params.seed_material, 
                                                   params.seed_thickness);
         if (!seed_success) {
-            Logger::getInstance().log("Seed deposition failed");
+            SEMIPRO_LOGF(INFO, PHYSICS, "Seed deposition failed");
             return false;
         }
         
@@ -47,7 +104,7 @@ bool AdvancedInterconnects::simulateDualDamascene(std::shared_ptr<Wafer> wafer,
         double fill_thickness = layer.thickness * params.overplating_factor;
         bool plating_success = simulateElectroplating(wafer, layer.metal_material, fill_thickness);
         if (!plating_success) {
-            Logger::getInstance().log("Electroplating failed");
+            SEMIPRO_LOGF(INFO, PHYSICS, "Electroplating failed");
             return false;
         }
         
@@ -55,7 +112,7 @@ bool AdvancedInterconnects::simulateDualDamascene(std::shared_ptr<Wafer> wafer,
         if (params.cmp_enabled) {
             bool cmp_success = simulateCMP(wafer, layer.thickness);
             if (!cmp_success) {
-                Logger::getInstance().log("CMP failed");
+                SEMIPRO_LOGF(INFO, PHYSICS, "CMP failed");
                 return false;
             }
         }
@@ -63,11 +120,11 @@ bool AdvancedInterconnects::simulateDualDamascene(std::shared_ptr<Wafer> wafer,
         // Update metrics
         updateMetrics(layer);
         
-        Logger::getInstance().log("Dual damascene completed successfully");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Dual damascene completed successfully");
         return true;
         
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Dual damascene failed: " + std::string(e.what()));
+        SEMIPRO_LOGF(INFO, PHYSICS, "Dual damascene failed: {}", e.what());
         return false;
     }
 }
@@ -76,11 +133,10 @@ bool AdvancedInterconnects::simulateBarrierDeposition(std::shared_ptr<Wafer> waf
                                                      const std::string& material, 
                                                      double thickness) {
     try {
-        Logger::getInstance().log("Depositing " + material + " barrier (" + 
-                                 std::to_string(thickness) + "nm)");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Depositing {} barrier ({}nm)", material, thickness);
         
         // Simulate barrier coverage (simplified)
-        auto grid = wafer->getGrid();
+        FieldView grid = wafer->getGrid();
         int rows = grid.rows();
         int cols = grid.cols();
         
@@ -90,12 +146,10 @@ bool AdvancedInterconnects::simulateBarrierDeposition(std::shared_ptr<Wafer> waf
                 grid(i, j) += thickness / 1000.0; // Convert nm to μm
             }
         }
-        
-        wafer->setGrid(grid);
         return true;
         
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Barrier deposition failed: " + std::string(e.what()));
+        SEMIPRO_LOGF(INFO, PHYSICS, "Barrier deposition failed: {}", e.what());
         return false;
     }
 }
@@ -104,11 +158,10 @@ bool AdvancedInterconnects::simulateSeedDeposition(std::shared_ptr<Wafer> wafer,
                                                   const std::string& material,
                                                   double thickness) {
     try {
-        Logger::getInstance().log("Depositing " + material + " seed (" + 
-                                 std::to_string(thickness) + "nm)");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Depositing {} seed ({}nm)", material, thickness);
         
         // Simulate seed layer (simplified)
-        auto grid = wafer->getGrid();
+        FieldView grid = wafer->getGrid();
         int rows = grid.rows();
         int cols = grid.cols();
         
@@ -118,12 +171,10 @@ bool AdvancedInterconnects::simulateSeedDeposition(std::shared_ptr<Wafer> wafer,
                 grid(i, j) += thickness / 1000.0; // Convert nm to μm
             }
         }
-        
-        wafer->setGrid(grid);
         return true;
         
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Seed deposition failed: " + std::string(e.what()));
+        SEMIPRO_LOGF(INFO, PHYSICS, "Seed deposition failed: {}", e.what());
         return false;
     }
 }
@@ -132,11 +183,10 @@ bool AdvancedInterconnects::simulateElectroplating(std::shared_ptr<Wafer> wafer,
                                                    const std::string& material,
                                                    double thickness) {
     try {
-        Logger::getInstance().log("Electroplating " + material + " (" + 
-                                 std::to_string(thickness) + "nm)");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Electroplating {} ({}nm)", material, thickness);
         
         // Simulate electroplating fill (simplified)
-        auto grid = wafer->getGrid();
+        FieldView grid = wafer->getGrid();
         int rows = grid.rows();
         int cols = grid.cols();
         
@@ -146,22 +196,20 @@ bool AdvancedInterconnects::simulateElectroplating(std::shared_ptr<Wafer> wafer,
                 grid(i, j) += thickness / 1000.0; // Convert nm to μm
             }
         }
-        
-        wafer->setGrid(grid);
         return true;
         
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Electroplating failed: " + std::string(e.what()));
+        SEMIPRO_LOGF(INFO, PHYSICS, "Electroplating failed: {}", e.what());
         return false;
     }
 }
 
 bool AdvancedInterconnects::simulateCMP(std::shared_ptr<Wafer> wafer, double target_thickness) {
     try {
-        Logger::getInstance().log("CMP planarization to " + std::to_string(target_thickness) + "nm");
+        SEMIPRO_LOGF(INFO, PHYSICS, "CMP planarization to {}nm", target_thickness);
         
         // Simulate CMP planarization (simplified)
-        auto grid = wafer->getGrid();
+        FieldView grid = wafer->getGrid();
         int rows = grid.rows();
         int cols = grid.cols();
         
@@ -177,59 +225,101 @@ bool AdvancedInterconnects::simulateCMP(std::shared_ptr<Wafer> wafer, double tar
                 }
             }
         }
-        
-        wafer->setGrid(grid);
         return true;
         
     } catch (const std::exception& e) {
-        Logger::getInstance().log("CMP failed: " + std::string(e.what()));
+        SEMIPRO_LOGF(INFO, PHYSICS, "CMP failed: {}", e.what());
         return false;
     }
 }
 
-void AdvancedInterconnects::initializeMetalDatabase() {
-    // Copper
-    metal_database_["Cu"] = MetalProperties("Cu", 1.7); // μΩ·cm
-    metal_database_["Cu"].thermal_conductivity = 400.0;
-    metal_database_["Cu"].electromigration_activation = 0.7;
-    
-    // Aluminum
-    metal_database_["Al"] = MetalProperties("Al", 2.8);
-    metal_database_["Al"].thermal_conductivity = 237.0;
-    metal_database_["Al"].electromigration_activation = 0.5;
+Eigen::ArrayXXd AdvancedInterconnects::simulateCMPPlanarization(const Eigen::ArrayXXd& surface_profile) const {
+    // Step-height model on the CMP engine: the raised and recessed areas
+    // about each cell, at their mean heights there, polish under the pad
+    // until no step is left, and each cell loses what its own area did.
+    if (surface_profile.size() == 0) {
+        return surface_profile;
+    }
+    const double top = surface_profile.maxCoeff();
+    const double bottom = surface_profile.minCoeff();
+    const double level = 0.5 * (top + bottom);
+    const BitMask raised = BitMask::fromField(surface_profile, level);
+    if (raised.count() == 0 || top - bottom <= 0.0) {
+        return surface_profile;
+    }
     
-    // Cobalt
-    metal_database_["Co"] = MetalProperties("Co", 6.2);
-    metal_database_["Co"].thermal_conductivity = 100.0;
-    metal_database_["Co"].electromigration_activation = 1.2;
+    const Eigen::ArrayXXd is_raised = raised.toField();
+    const Eigen::ArrayXXd rho = PatternDensity::boxMean(is_raised, kDensityRadius);
+    const Eigen::ArrayXXd raised_sum = PatternDensity::boxMean(surface_profile * is_raised, kDensityRadius);
+    const Eigen::ArrayXXd recessed_sum = PatternDensity::boxMean(surface_profile * (1.0 - is_raised), kDensityRadius);
+    const Eigen::ArrayXXd up = (rho > 0.0).select(raised_sum / rho, surface_profile);
+    const Eigen::ArrayXXd down = (rho < 1.0).select(recessed_sum / (1.0 - rho), surface_profile);
     
-    // Ruthenium
-    metal_database_["Ru"] = MetalProperties("Ru", 7.1);
-    metal_database_["Ru"].thermal_conductivity = 117.0;
-    metal_database_["Ru"].electromigration_activation = 1.5;
+    // Time in units of the whole step at the blanket rate
+    const double step = top - bottom;
+    CmpOptions options;
+    options.planarization_length = kPlanarizationLength;
+    options.removal_rate = step;
+    options.contact_height = kContactFraction * step;
+    options.max_time = kMaxPolishTime;
+    const CmpModel model(static_cast<int>(surface_profile.rows()), static_cast<int>(surface_profile.cols()), options);
+    const CmpModel::Result polished = model.planarize(rho, up, down, kLevelTolerance * step);
+    return surface_profile - (is_raised > 0.5).select(up - polished.up, down - polished.down);
 }
 
-void AdvancedInterconnects::initializeDielectricDatabase() {
-    // Silicon dioxide
-    dielectric_database_["SiO2"] = DielectricProperties("SiO2", 3.9);
-    
-    // Low-k dielectrics
-    dielectric_database_["low-k"] = DielectricProperties("low-k", 2.7);
-    dielectric_database_["ultra-low-k"] = DielectricProperties("ultra-low-k", 2.2);
-    dielectric_database_["ultra-low-k"].porous = true;
-    dielectric_database_["ultra-low-k"].porosity = 30.0;
-    
-    // Air gaps
-    dielectric_database_["air"] = DielectricProperties("air", 1.0);
+const AdvancedInterconnects::MetalDatabase& AdvancedInterconnects::metalDatabase() {
+    static const MetalDatabase database = [] {
+        // The properties have no default, so entries go in whole; copper,
+        // the default, takes ID 0
+        MetalDatabase table;
+        const auto add = [&table](const std::string& symbol, double resistivity, double conductivity,
+                                  double activation) {
+            MetalProperties metal(symbol, resistivity); // μΩ·cm
+            metal.thermal_conductivity = conductivity;
+            metal.electromigration_activation = activation;
+            table.by_name.insert_or_assign(symbol, metal);
+            table.ids[symbol] = static_cast<int>(table.by_id.size());
+            table.by_id.push_back(metal);
+        };
+        add("Cu", 1.7, 400.0, 0.7);
+        add("Al", 2.8, 237.0, 0.5);
+        add("Co", 6.2, 100.0, 1.2);
+        add("Ru", 7.1, 117.0, 1.5);
+        return table;
+    }();
+    return database;
+}
+
+const AdvancedInterconnects::DielectricDatabase& AdvancedInterconnects::dielectricDatabase() {
+    static const DielectricDatabase database = [] {
+        // Oxide, the default, takes ID 0
+        DielectricDatabase table;
+        const auto add = [&table](const DielectricProperties& dielectric) {
+            table.by_name.insert_or_assign(dielectric.material, dielectric);
+            table.ids[dielectric.material] = static_cast<int>(table.by_id.size());
+            table.by_id.push_back(dielectric);
+        };
+
+        // Silicon dioxide
+        add(DielectricProperties("SiO2", 3.9));
+
+        // Low-k dielectrics
+        add(DielectricProperties("low-k", 2.7));
+        DielectricProperties ultra_low_k("ultra-low-k", 2.2);
+        ultra_low_k.porous = true;
+        ultra_low_k.porosity = 30.0;
+        add(ultra_low_k);
+
+        // Air gaps
+        add(DielectricProperties("air", 1.0));
+        return table;
+    }();
+    return database;
 }
 
 double AdvancedInterconnects::calculateLineResistance(const InterconnectLayer& layer,
                                                      const MetalProperties& metal) const {
-    // Line resistance calculation
-    double cross_sectional_area = layer.line_width * layer.thickness * 1e-18; // m²
-    double length = 1e-6; // 1 μm length
-    
-    return metal.resistivity * 1e-8 * length / cross_sectional_area; // Ω/μm
+    return lineResistance(layer.line_width, layer.thickness, metal.resistivity); // Ω/μm
 }
 
 void AdvancedInterconnects::updateMetrics(const InterconnectLayer& layer) const {
@@ -250,30 +340,147 @@ void AdvancedInterconnects::updateMetrics(const InterconnectLayer& layer) const
 
 AdvancedInterconnects::MetalProperties 
 AdvancedInterconnects::getMetalProperties(const std::string& material) const {
-    auto it = metal_database_.find(material);
-    if (it != metal_database_.end()) {
+    const auto& metals = metalDatabase().by_name;
+    auto it = metals.find(material);
+    if (it != metals.end()) {
         return it->second;
     }
-    return metal_database_.at("Cu"); // Default to copper
+    return metals.at("Cu"); // Default to copper
 }
 
 AdvancedInterconnects::DielectricProperties 
 AdvancedInterconnects::getDielectricProperties(const std::string& material) const {
-    auto it = dielectric_database_.find(material);
-    if (it != dielectric_database_.end()) {
+    const auto& dielectrics = dielectricDatabase().by_name;
+    auto it = dielectrics.find(material);
+    if (it != dielectrics.end()) {
         return it->second;
     }
-    return dielectric_database_.at("SiO2"); // Default to oxide
+    return dielectrics.at("SiO2"); // Default to oxide
 }
 
 double AdvancedInterconnects::calculateCapacitance(const InterconnectLayer& layer,
                                                   const DielectricProperties& dielectric) const {
     // Simplified capacitance calculation
-    double epsilon_0 = 8.854e-12; // F/m
-    double area = layer.line_width * 1e-9; // m
-    double spacing = layer.line_spacing * 1e-9; // m
+    return lineCapacitance(layer.line_width, layer.line_spacing, layer.thickness,
+                           dielectric.dielectric_constant).first; // F/μm
+}
+
+double AdvancedInterconnects::extractResistance(const InterconnectLayer& layer) const {
+    return calculateLineResistance(layer, getMetalProperties(layer.metal_material));
+}
+
+double AdvancedInterconnects::extractCapacitance(const InterconnectLayer& layer) const {
+    return calculateCapacitance(layer, getDielectricProperties(layer.dielectric));
+}
+
+double AdvancedInterconnects::extractInductance(const InterconnectLayer& layer) const {
+    return loopInductance(layer.line_width, layer.line_spacing, layer.thickness);
+}
+
+double AdvancedInterconnects::calculateCrosstalk(const InterconnectLayer& layer) const {
+    const double k = getDielectricProperties(layer.dielectric).dielectric_constant;
+    return lineCapacitance(layer.line_width, layer.line_spacing, layer.thickness, k).second;
+}
+
+std::pair<double, double> AdvancedInterconnects::lineCapacitance(double width, double spacing, double thickness,
+                                                                 double dielectric_constant) const {
+    if (capacitance_library_) {
+        const LineCapacitance c = capacitance_library_->lookup({width, spacing, thickness, thickness});
+        return {CapacitanceLibrary::toFaradsPerMicron(c.total, dielectric_constant), 2.0 * c.coupling / c.total};
+    }
+    return {closedFormCapacitance(width, spacing, dielectric_constant), couplingShare(width, spacing, thickness)};
+}
+
+double AdvancedInterconnects::calculateSignalDelay(const InterconnectLayer& layer, double length) const {
+    const double k = getDielectricProperties(layer.dielectric).dielectric_constant;
+    return lineDelay(extractResistance(layer), extractCapacitance(layer), k, length);
+}
+
+int AdvancedInterconnects::metalId(const std::string& material) const {
+    const auto& ids = metalDatabase().ids;
+    auto it = ids.find(material);
+    return it != ids.end() ? it->second : 0;
+}
+
+int AdvancedInterconnects::dielectricId(const std::string& material) const {
+    const auto& ids = dielectricDatabase().ids;
+    auto it = ids.find(material);
+    return it != ids.end() ? it->second : 0;
+}
+
+AdvancedInterconnects::LayerColumns
+AdvancedInterconnects::layerColumns(const std::vector<InterconnectLayer>& stack) const {
+    const Eigen::Index n = static_cast<Eigen::Index>(stack.size());
+    LayerColumns columns;
+    columns.line_width.resize(n);
+    columns.line_spacing.resize(n);
+    columns.thickness.resize(n);
+    columns.metal.resize(n);
+    columns.dielectric.resize(n);
+    for (Eigen::Index i = 0; i < n; ++i) {
+        columns.line_width(i) = stack[i].line_width;
+        columns.line_spacing(i) = stack[i].line_spacing;
+        columns.thickness(i) = stack[i].thickness;
+        columns.metal[i] = metalId(stack[i].metal_material);
+        columns.dielectric[i] = dielectricId(stack[i].dielectric);
+    }
+    return columns;
+}
+
+AdvancedInterconnects::ParasiticColumns
+AdvancedInterconnects::extractParasitics(const LayerColumns& layers, const WireColumns& wires) const {
+    const Eigen::Index n = layers.line_width.size();
+    if (layers.line_spacing.size() != n || layers.thickness.size() != n ||
+        static_cast<Eigen::Index>(layers.metal.size()) != n || static_cast<Eigen::Index>(layers.dielectric.size()) != n) {
+        throw std::invalid_argument("Layer columns differ in length");
+    }
+    const Eigen::Index m = wires.length.size();
+    if (static_cast<Eigen::Index>(wires.layer.size()) != m) {
+        throw std::invalid_argument("Wire columns differ in length");
+    }
+    
+    auto& scheduler = TaskScheduler::getInstance();
+    constexpr int kGrain = 4096;
+    
+    // Per-μm values of every layer, then a gather and scale per segment
+    const std::vector<MetalProperties>& metal_table = metalDatabase().by_id;
+    const std::vector<DielectricProperties>& dielectric_table = dielectricDatabase().by_id;
+    Eigen::ArrayXd r(n), c(n), l(n), x(n), k(n);
+    scheduler.parallelFor(0, static_cast<int>(n), [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            const int metal = layers.metal[i], dielectric = layers.dielectric[i];
+            if (metal < 0 || metal >= static_cast<int>(metal_table.size()) ||
+                dielectric < 0 || dielectric >= static_cast<int>(dielectric_table.size())) {
+                throw std::out_of_range("Unknown material ID on layer " + std::to_string(i));
+            }
+            k(i) = dielectric_table[dielectric].dielectric_constant;
+            r(i) = lineResistance(layers.line_width(i), layers.thickness(i), metal_table[metal].resistivity);
+            std::tie(c(i), x(i)) = lineCapacitance(layers.line_width(i), layers.line_spacing(i), layers.thickness(i), k(i));
+            l(i) = loopInductance(layers.line_width(i), layers.line_spacing(i), layers.thickness(i));
+        }
+    }, kGrain);
     
-    return epsilon_0 * dielectric.dielectric_constant * area / spacing; // F/μm
+    ParasiticColumns result;
+    result.resistance.resize(m);
+    result.capacitance.resize(m);
+    result.inductance.resize(m);
+    result.crosstalk.resize(m);
+    result.delay.resize(m);
+    scheduler.parallelFor(0, static_cast<int>(m), [&](int begin, int end) {
+        for (int j = begin; j < end; ++j) {
+            const int i = wires.layer[j];
+            if (i < 0 || i >= n) {
+                throw std::out_of_range("Wire " + std::to_string(j) + " on unknown layer " + std::to_string(i));
+            }
+            const double length = wires.length(j);
+            result.resistance(j) = r(i) * length;
+            result.capacitance(j) = c(i) * length;
+            result.inductance(j) = l(i) * length;
+            result.crosstalk(j) = x(i);
+            result.delay(j) = lineDelay(r(i), c(i), k(i), length);
+        }
+    }, kGrain);
+    return result;
 }
 
 // Factory functions
@@ -2,7 +2,8 @@
 #ifndef ADVANCED_INTERCONNECTS_HPP
 #define ADVANCED_INTERCONNECTS_HPP
 
-#include "../core/wafer.hpp"
+#include "../../core/wafer.hpp"
+#include "../interconnect/line_capacitance.hpp"
 #include <memory>
 #include <vector>
 #include <string>
@@ -118,6 +119,13 @@ public:
     void enableCobraHead(bool enable) { cobra_head_enabled_ = enable; }
     void setProcessTemperature(double temp) { process_temperature_ = temp; }
     void enableAdvancedBarriers(bool enable) { advanced_barriers_enabled_ = enable; }
+    // Line capacitance from the field solver's pattern library instead of
+    // the closed form, for every extraction; the library can be shared
+    // across instances so a sweep solves each shape once. Null restores
+    // the closed form.
+    void setCapacitanceLibrary(std::shared_ptr<const CapacitanceLibrary> library) {
+        capacitance_library_ = std::move(library);
+    }
     
     // Performance metrics
     struct InterconnectMetrics {
@@ -130,6 +138,51 @@ public:
     };
     
     InterconnectMetrics getMetrics() const { return metrics_; }
+    
+    // Parasitics per μm of a line on the layer: Ω; F, to its neighbours in
+    // the closed form or to everything around it, the levels above and
+    // below a line thickness away included, from a capacitance library;
+    // and H of the loop it makes with the next line over
+    double extractResistance(const InterconnectLayer& layer) const;
+    double extractCapacitance(const InterconnectLayer& layer) const;
+    double extractInductance(const InterconnectLayer& layer) const;
+    // Share of a line's capacitance that couples to its neighbours rather
+    // than to the levels around it, 0 to 1
+    double calculateCrosstalk(const InterconnectLayer& layer) const;
+    // Delay (s) of a line length μm long: the Elmore delay of the
+    // distributed RC line, 0.38 RC, plus its time of flight
+    double calculateSignalDelay(const InterconnectLayer& layer, double length) const;
+    
+    // Batched extraction. Layers of any number of stacks as columns, their
+    // materials as IDs into the property tables so a sweep resolves each
+    // name once; unknown names get the IDs of Cu and SiO2.
+    int metalId(const std::string& material) const;
+    int dielectricId(const std::string& material) const;
+    struct LayerColumns {
+        Eigen::ArrayXd line_width;   // nm
+        Eigen::ArrayXd line_spacing; // nm
+        Eigen::ArrayXd thickness;    // nm
+        std::vector<int> metal;
+        std::vector<int> dielectric;
+    };
+    LayerColumns layerColumns(const std::vector<InterconnectLayer>& stack) const;
+    // Wire segments, each on a layer (index into the columns)
+    struct WireColumns {
+        std::vector<int> layer;
+        Eigen::ArrayXd length; // μm
+    };
+    // Per segment, by the same models as the single-layer calls
+    struct ParasiticColumns {
+        Eigen::ArrayXd resistance;  // Ω
+        Eigen::ArrayXd capacitance; // F
+        Eigen::ArrayXd inductance;  // H
+        Eigen::ArrayXd crosstalk;   // Coupling share
+        Eigen::ArrayXd delay;       // s
+    };
+    // Every layer's per-μm parasitics, then every segment's, in parallel.
+    // Throws std::invalid_argument for columns of differing lengths,
+    // std::out_of_range for an unknown material ID or layer index.
+    ParasiticColumns extractParasitics(const LayerColumns& layers, const WireColumns& wires) const;
 
 private:
     // Configuration flags
@@ -137,6 +190,7 @@ private:
     bool cobra_head_enabled_;
     bool advanced_barriers_enabled_;
     double process_temperature_;
+    std::shared_ptr<const CapacitanceLibrary> capacitance_library_;
     
     // Performance tracking
     mutable InterconnectMetrics metrics_;
@@ -158,8 +212,20 @@ private:
               young_modulus(100.0), poisson_ratio(0.35) {}
     };
     
-    std::unordered_map<std::string, MetalProperties> metal_database_;
-    std::unordered_map<std::string, DielectricProperties> dielectric_database_;
+    struct MetalDatabase {
+        std::unordered_map<std::string, MetalProperties> by_name;
+        std::vector<MetalProperties> by_id;
+        std::unordered_map<std::string, int> ids;
+    };
+    struct DielectricDatabase {
+        std::unordered_map<std::string, DielectricProperties> by_name;
+        std::vector<DielectricProperties> by_id;
+        std::unordered_map<std::string, int> ids;
+    };
+    // Process-wide and immutable, each built on first use rather than per
+    // instance
+    static const MetalDatabase& metalDatabase();
+    static const DielectricDatabase& dielectricDatabase();
     
     // Advanced simulation methods
     Eigen::ArrayXXd simulateBarrierCoverage(const InterconnectLayer& layer,
@@ -177,6 +243,10 @@ private:
                                  const MetalProperties& metal) const;
     double calculateCapacitance(const InterconnectLayer& layer,
                                const DielectricProperties& dielectric) const;
+    // F/μm of a line (dimensions in nm) and the share of it coupling to
+    // its neighbours, by the library when set
+    std::pair<double, double> lineCapacitance(double width, double spacing, double thickness,
+                                              double dielectric_constant) const;
     double calculateElectromigrationLifetime(const InterconnectLayer& layer,
                                            double current_density, double temperature) const;
     
@@ -197,20 +267,11 @@ private:
                                      const DamasceneParameters& params) const;
     
     // Utility methods
-    void initializeMetalDatabase();
-    void initializeDielectricDatabase();
     MetalProperties getMetalProperties(const std::string& material) const;
     DielectricProperties getDielectricProperties(const std::string& material) const;
     void updateMetrics(const InterconnectLayer& layer) const;
     
-    // Parasitic extraction
-    double extractResistance(const InterconnectLayer& layer) const;
-    double extractCapacitance(const InterconnectLayer& layer) const;
-    double extractInductance(const InterconnectLayer& layer) const;
-    
     // Signal integrity analysis
-    double calculateCrosstalk(const InterconnectLayer& layer) const;
-    double calculateSignalDelay(const InterconnectLayer& layer) const;
     double calculatePowerNoise(const InterconnectLayer& layer) const;
 };
 
@@ -1,9 +1,63 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "advanced_ion_implantation.hpp"
 #include "../core/utils.hpp"
+#include "../core/stencil_kernel.hpp"
 #include <cmath>
 #include <random>
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Depth profile shape moments, typical for implants into silicon
+constexpr double kSkewness = 0.5;
+constexpr double kKurtosis = 3.2;
+
+// Young-van Vliet recursive Gaussian: a causal and an anti-causal
+// third-order pass, O(1) per sample whatever the width
+struct RecursiveGaussian {
+    double gain;
+    double feedback[3];
+
+    explicit RecursiveGaussian(double sigma) {
+        const double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330
+                                      : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+        const double q2 = q * q;
+        const double q3 = q2 * q;
+        const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+        feedback[0] = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+        feedback[1] = -(1.4281 * q2 + 1.26661 * q3) / b0;
+        feedback[2] = 0.422205 * q3 / b0;
+        gain = 1.0 - feedback[0] - feedback[1] - feedback[2];
+    }
+
+    // n samples `stride` apart, the ends continued by their edge values
+    void apply(double* data, int n, int stride) const {
+        double w1 = data[0], w2 = data[0], w3 = data[0];
+        for (int k = 0; k < n; ++k) {
+            double& v = data[k * stride];
+            const double w = gain * v + feedback[0] * w1 + feedback[1] * w2 + feedback[2] * w3;
+            w3 = w2;
+            w2 = w1;
+            w1 = v = w;
+        }
+        w1 = w2 = w3 = data[(n - 1) * stride];
+        for (int k = n - 1; k >= 0; --k) {
+            double& v = data[k * stride];
+            const double w = gain * v + feedback[0] * w1 + feedback[1] * w2 + feedback[2] * w3;
+            w3 = w2;
+            w2 = w1;
+            w1 = v = w;
+        }
+    }
+};
+
+// Below half a cell the filter's fit breaks down and the blur is lost in
+// the cells anyway
+constexpr double kMinBlurCells = 0.5;
+
+} // namespace
 
 AdvancedIonImplantation::AdvancedIonImplantation()
     : channeling_enabled_(true)
@@ -11,34 +65,35 @@ AdvancedIonImplantation::AdvancedIonImplantation()
     , temperature_effects_enabled_(true)
     , substrate_orientation_("100")
 {
-    initializeIonDatabase();
-    initializeMaterialDatabase();
-    
     // Initialize metrics
     metrics_ = ImplantMetrics{};
     damage_profile_ = DamageProfile{};
     
-    Logger::getInstance().log("Advanced Ion Implantation system initialized");
+    SEMIPRO_LOGF(INFO, PHYSICS, "Advanced Ion Implantation system initialized");
 }
 
 bool AdvancedIonImplantation::simulateImplantation(std::shared_ptr<Wafer> wafer, 
                                                   const ImplantParameters& params) {
     try {
-        auto grid = wafer->getGrid();
+        const auto& grid = wafer->getGrid();
         int rows = grid.rows();
         int cols = grid.cols();
         
-        Logger::getInstance().log("Starting advanced ion implantation simulation");
-        Logger::getInstance().log("Ion: " + params.ion.symbol + ", Energy: " + 
-                                 std::to_string(params.energy) + "keV, Dose: " + 
-                                 std::to_string(params.dose) + "cm⁻²");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Starting advanced ion implantation simulation");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Ion: {}, Energy: {}keV, Dose: {}cm⁻²",
+                     params.ion.symbol, params.energy, params.dose);
         
-        // Calculate full LSS distribution
-        Eigen::ArrayXXd ion_distribution = calculateFullLSSDistribution(params, rows, cols);
-        
-        // Apply channeling effects if enabled
-        if (channeling_enabled_ && params.channeling_enabled) {
-            ion_distribution = applyChannelingEffects(ion_distribution, params);
+        Eigen::ArrayXXd ion_distribution;
+        if (bca_enabled_) {
+            ion_distribution = calculateBCADistribution(params, wafer->getThickness(), rows, cols);
+        } else {
+            // Calculate full LSS distribution
+            ion_distribution = calculateFullLSSDistribution(params, rows, cols);
+
+            // Apply channeling effects if enabled
+            if (channeling_enabled_ && params.channeling_enabled) {
+                ion_distribution = applyChannelingEffects(ion_distribution, params);
+            }
         }
         
         // Apply temperature effects
@@ -47,89 +102,169 @@ bool AdvancedIonImplantation::simulateImplantation(std::shared_ptr<Wafer> wafer,
         }
         
         // Calculate damage profile
-        if (damage_accumulation_enabled_) {
+        if (damage_accumulation_enabled_ && !bca_enabled_) {
             damage_profile_ = calculateDamageProfile(params, ion_distribution);
         }
         
         // Update wafer with final distribution
-        auto current_grid = wafer->getGrid();
-        wafer->setGrid(current_grid + ion_distribution);
+        wafer->getGrid() += ion_distribution;
         
         // Update performance metrics
         updateMetrics(params, ion_distribution);
         
-        Logger::getInstance().log("Advanced ion implantation completed successfully");
-        Logger::getInstance().log("Range uniformity: " + std::to_string(metrics_.range_uniformity) + "%");
-        Logger::getInstance().log("Channeling fraction: " + std::to_string(metrics_.channeling_fraction) + "%");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Advanced ion implantation completed successfully");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Range uniformity: {}%", metrics_.range_uniformity);
+        SEMIPRO_LOGF(INFO, PHYSICS, "Channeling fraction: {}%", metrics_.channeling_fraction);
         
         return true;
         
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Advanced ion implantation failed: " + std::string(e.what()));
+        SEMIPRO_LOGF(INFO, PHYSICS, "Advanced ion implantation failed: {}", e.what());
         return false;
     }
 }
 
 bool AdvancedIonImplantation::simulateMultipleImplants(std::shared_ptr<Wafer> wafer,
                                                       const std::vector<ImplantParameters>& implant_sequence) {
-    bool overall_success = true;
-    
-    Logger::getInstance().log("Starting multiple implant sequence (" + 
-                             std::to_string(implant_sequence.size()) + " implants)");
-    
-    for (size_t i = 0; i < implant_sequence.size(); ++i) {
-        Logger::getInstance().log("Executing implant " + std::to_string(i + 1) + "/" + 
-                                 std::to_string(implant_sequence.size()));
-        
-        bool success = simulateImplantation(wafer, implant_sequence[i]);
-        if (!success) {
-            overall_success = false;
-            Logger::getInstance().log("Implant " + std::to_string(i + 1) + " failed");
+    if (implant_sequence.empty()) {
+        return true;
+    }
+    try {
+        const auto& grid = wafer->getGrid();
+        const int rows = grid.rows();
+        const int cols = grid.cols();
+        const int count = static_cast<int>(implant_sequence.size());
+
+        SEMIPRO_LOGF(INFO, PHYSICS, "Starting fused implant sequence ({} implants)", count);
+
+        Eigen::ArrayXXd opening = Eigen::ArrayXXd::Ones(1, cols);
+        if (lateral_mask_.size() > 0) {
+            if (lateral_mask_.size() != cols) {
+                throw std::invalid_argument("Lateral mask has " + std::to_string(lateral_mask_.size()) +
+                                            " columns, the grid " + std::to_string(cols));
+            }
+            opening.row(0) = lateral_mask_.transpose();
+        }
+
+        // Analytic implants share one depth window, twice the deepest range
+        double depth = 0.0;
+        for (const auto& params : implant_sequence) {
+            depth = std::max(depth, 2.0 * calculateLSSRange(params.ion, params.energy, "Si"));
+        }
+
+        // Every implant is a depth profile times a lateral one, so the
+        // sequence is a sum of rank-one terms: one column of `ions` (and of
+        // `displaced`) per implant against one row of `lateral`
+        const auto si = getMaterialProperties("Si");
+        Eigen::MatrixXd ions(rows, count);
+        Eigen::MatrixXd displaced(rows, count);
+        Eigen::MatrixXd interstitial(rows, count);
+        Eigen::MatrixXd lateral(count, cols);
+        double displacements = 0.0;
+        double weighted_temperature = 0.0;
+        double dose = 0.0;
+        double implant_time = 0.0;
+        for (int k = 0; k < count; ++k) {
+            const auto& params = implant_sequence[k];
+            lateral.row(k) = opening.row(0).matrix();
+            if (bca_enabled_) {
+                // Traced profiles are laterally uniform on the thickness window
+                Eigen::ArrayXXd traced = calculateBCADistribution(params, wafer->getThickness(), rows, 1);
+                ions.col(k) = traced.col(0).matrix();
+                displaced.col(k).setZero();
+                interstitial.col(k).setZero();
+                if (damage_accumulation_enabled_) {
+                    displaced.col(k) = damage_profile_.vacancy_concentration.col(0).matrix();
+                    interstitial.col(k) = damage_profile_.interstitial_concentration.col(0).matrix();
+                }
+            } else {
+                SeparableProfile profile = calculateSeparableProfile(params, rows, depth, opening, mask_cell_width_);
+                if (channeling_enabled_ && params.channeling_enabled) {
+                    profile.vertical *= calculateChannelingTail(params, rows, depth);
+                }
+                lateral.row(k) = profile.lateral.row(0).matrix();
+                ions.col(k) = profile.vertical.matrix();
+                double dpa = calculateDisplacementsPerIon(params.ion, params.energy, si);
+                displaced.col(k) = (profile.vertical * dpa).matrix();
+                interstitial.col(k) = (profile.vertical * (0.4 * dpa)).matrix();
+            }
+            displacements += calculateDisplacementsPerIon(params.ion, params.energy, si) * params.dose;
+            weighted_temperature += params.temperature * params.dose;
+            dose += params.dose;
+            implant_time += params.dose / (params.beam_current * 6.24e15);
+        }
+        const double temperature = weighted_temperature / dose;
+
+        // Implants at raised temperature broaden their own ions only
+        Eigen::ArrayXXd total = Eigen::ArrayXXd::Zero(rows, cols);
+        std::map<double, std::vector<int>> by_temperature;
+        for (int k = 0; k < count; ++k) {
+            double implant_temperature = temperature_effects_enabled_ ? implant_sequence[k].temperature : 25.0;
+            by_temperature[std::max(implant_temperature, 25.0)].push_back(k);
+        }
+        for (const auto& [implant_temperature, members] : by_temperature) {
+            Eigen::MatrixXd group = ions(Eigen::all, members) * lateral(members, Eigen::all);
+            total += calculateTemperatureEffects(group.array(), implant_temperature);
         }
+
+        // Damage from all implants together, amorphizing where the summed
+        // displacements pass the threshold at the dose-weighted temperature
+        if (damage_accumulation_enabled_) {
+            DamageProfile damage;
+            Eigen::ArrayXXd displacement_density = (displaced * lateral).array();
+            if (bca_enabled_) {
+                damage.vacancy_concentration = displacement_density;
+            } else {
+                damage.vacancy_concentration = 0.6 * displacement_density;
+            }
+            damage.interstitial_concentration = (interstitial * lateral).array();
+            double threshold = calculateAmorphizationThreshold("Si", temperature);
+            damage.amorphous_fraction =
+                ((displacement_density - threshold) / threshold).max(0.0).min(1.0);
+            damage_profile_ = std::move(damage);
+        }
+
+        wafer->getGrid() += total;
+
+        updateMetrics(implant_sequence.back(), total);
+        metrics_.damage_density = displacements;
+        double threshold = calculateAmorphizationThreshold("Si", temperature);
+        metrics_.amorphous_fraction = (metrics_.damage_density > threshold) ?
+                                      (metrics_.damage_density / threshold - 1.0) * 100.0 : 0.0;
+        metrics_.implant_time = implant_time;
+        metrics_.throughput = 3600.0 / (implant_time + 60.0 * count);
+
+        SEMIPRO_LOGF(INFO, PHYSICS, "Fused implant sequence completed: total dose {}cm⁻², depth window {}um",
+                     dose, depth);
+        return true;
+
+    } catch (const std::exception& e) {
+        SEMIPRO_LOGF(INFO, PHYSICS, "Fused implant sequence failed: {}", e.what());
+        return false;
     }
-    
-    return overall_success;
 }
 
 double AdvancedIonImplantation::calculateLSSRange(const IonSpecies& ion, double energy, 
                                                  const std::string& target) const {
-    auto target_props = getMaterialProperties(target);
-    
-    // LSS theory implementation
-    double reduced_energy = calculateReducedEnergy(ion, energy, target_props);
-    
-    // LSS range formula
-    double range_factor = 0.325; // Empirical constant
-    double mass_ratio = ion.atomic_mass / target_props.atomic_mass;
-    double z_factor = std::pow(ion.atomic_number + target_props.atomic_number, 0.23);
-    
-    double range = range_factor * mass_ratio * 
-                   std::pow(reduced_energy / z_factor, 1.8);
-    
-    return range * 1e-4; // Convert to μm
+    return momentTable(ion, target).at(energy).projected_range; // μm
 }
 
 double AdvancedIonImplantation::calculateRangeStraggling(const IonSpecies& ion, double energy,
                                                         const std::string& target) const {
-    double range = calculateLSSRange(ion, energy, target);
-    
-    // Bohr straggling theory
-    double straggling_factor = 0.3; // Typical value
-    
-    // Energy dependence
-    double energy_factor = std::sqrt(energy / 100.0); // Normalized to 100 keV
-    
-    return range * straggling_factor * energy_factor;
+    return momentTable(ion, target).at(energy).range_straggling;
 }
 
 double AdvancedIonImplantation::calculateLateralStraggling(const IonSpecies& ion, double energy,
                                                           const std::string& target) const {
-    double range = calculateLSSRange(ion, energy, target);
-    
-    // Lateral straggling is typically 0.6-0.8 times the range straggling
-    double range_straggling = calculateRangeStraggling(ion, energy, target);
-    
-    return range_straggling * 0.7;
+    return momentTable(ion, target).at(energy).lateral_straggling;
+}
+
+const ImplantMoments& AdvancedIonImplantation::momentTable(const IonSpecies& ion, const std::string& target) const {
+    auto target_props = getMaterialProperties(target);
+    const BCATransport::Target medium{static_cast<double>(target_props.atomic_number), target_props.atomic_mass,
+                                      target_props.density * 6.02214076e23 / target_props.atomic_mass,
+                                      target_props.displacement_threshold};
+    return ImplantMoments::table({static_cast<double>(ion.atomic_number), ion.atomic_mass}, medium);
 }
 
 double AdvancedIonImplantation::calculateChannelingRange(const IonSpecies& ion, double energy,
@@ -150,54 +285,167 @@ double AdvancedIonImplantation::calculateChannelingRange(const IonSpecies& ion,
 
 Eigen::ArrayXXd AdvancedIonImplantation::calculateFullLSSDistribution(const ImplantParameters& params,
                                                                      int rows, int cols) const {
-    Eigen::ArrayXXd distribution(rows, cols);
-    distribution.setZero();
-    
-    // Calculate LSS parameters
+    Eigen::ArrayXXd opening = Eigen::ArrayXXd::Ones(1, cols);
+    if (lateral_mask_.size() > 0) {
+        if (lateral_mask_.size() != cols) {
+            throw std::invalid_argument("Lateral mask has " + std::to_string(lateral_mask_.size()) +
+                                        " columns, the grid " + std::to_string(cols));
+        }
+        opening.row(0) = lateral_mask_.transpose();
+    }
+
+    // Depth spans twice the projected range, leaving room for the tail
     double range = calculateLSSRange(params.ion, params.energy, "Si");
-    double range_straggling = calculateRangeStraggling(params.ion, params.energy, "Si");
-    double lateral_straggling = calculateLateralStraggling(params.ion, params.energy, "Si");
-    
-    // Pearson IV distribution parameters (more accurate than Gaussian)
-    double skewness = 0.5; // Typical for ion implantation
-    double kurtosis = 3.2; // Slightly peaked
-    
-    // Generate 2D distribution
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            // Depth coordinate (vertical)
-            double depth = (static_cast<double>(i) / rows) * 2.0 * range; // 2x range for tail
-            
-            // Lateral coordinate (horizontal)
-            double lateral = (static_cast<double>(j - cols/2) / cols) * 4.0 * lateral_straggling;
-            
-            // Pearson IV distribution in depth
-            double depth_factor = std::exp(-0.5 * std::pow((depth - range) / range_straggling, 2));
-            
-            // Gaussian distribution in lateral direction
-            double lateral_factor = std::exp(-0.5 * std::pow(lateral / lateral_straggling, 2));
-            
-            // Combined distribution
-            double concentration = depth_factor * lateral_factor;
-            
-            // Normalize by dose
-            concentration *= params.dose / (range_straggling * lateral_straggling * std::sqrt(2 * M_PI));
-            
-            distribution(i, j) = concentration;
+    SeparableProfile profile = calculateSeparableProfile(params, rows, 2.0 * range, opening, mask_cell_width_);
+    return (profile.vertical.matrix() * profile.lateral.matrix()).array();
+}
+
+AdvancedIonImplantation::SeparableProfile
+AdvancedIonImplantation::calculateSeparableProfile(const ImplantParameters& params, int depth_cells, double depth,
+                                                   const Eigen::ArrayXXd& opening, double cell_width) const {
+    auto key = std::make_tuple(params.ion.symbol, params.energy, depth_cells, depth);
+    auto cached = depth_profiles_.find(key);
+    if (cached == depth_profiles_.end()) {
+        double range = calculateLSSRange(params.ion, params.energy, "Si");
+        double range_straggling = calculateRangeStraggling(params.ion, params.energy, "Si");
+        Eigen::ArrayXd depths = Eigen::ArrayXd::LinSpaced(depth_cells, 0.0, depth * (depth_cells - 1) / depth_cells);
+        cached = depth_profiles_.emplace(key, generatePearsonIVDistribution(range, range_straggling, kSkewness,
+                                                                            kKurtosis, depths)).first;
+    }
+
+    SeparableProfile profile;
+    profile.vertical = cached->second * (params.dose * 1e4); // um⁻¹ to cm⁻¹
+    profile.lateral = opening;
+
+    double sigma = cell_width > 0.0 ? calculateLateralStraggling(params.ion, params.energy, "Si") / cell_width : 0.0;
+    if (sigma >= kMinBlurCells) {
+        RecursiveGaussian blur(sigma);
+        const int rows = profile.lateral.rows();
+        const int cols = profile.lateral.cols();
+        double* data = profile.lateral.data(); // Column-major
+        if (cols > 1) {
+            for (int i = 0; i < rows; ++i) {
+                blur.apply(data + i, cols, rows);
+            }
+        }
+        if (rows > 1) {
+            for (int j = 0; j < cols; ++j) {
+                blur.apply(data + j * rows, rows, 1);
+            }
         }
     }
-    
+    return profile;
+}
+
+Eigen::ArrayXd AdvancedIonImplantation::generatePearsonIVDistribution(double range, double straggling,
+                                                                     double skewness, double kurtosis,
+                                                                     const Eigen::ArrayXd& depths) const {
+    // Pearson's equation in standard units, f'/f = (t - a) / (b0 + b1 t + b2 t^2)
+    const double beta1 = skewness * skewness;
+    const double denominator = 10.0 * kurtosis - 12.0 * beta1 - 18.0;
+    if (straggling <= 0.0 || kurtosis <= beta1 + 1.0 || denominator <= 0.0) {
+        throw std::invalid_argument("No Pearson distribution with these moments");
+    }
+    const double a = -skewness * (kurtosis + 3.0) / denominator;
+    const double b0 = -(4.0 * kurtosis - 3.0 * beta1) / denominator;
+    const double b1 = a;
+    const double b2 = -(2.0 * kurtosis - 3.0 * beta1 - 6.0) / denominator;
+    const double discriminant = b1 * b1 - 4.0 * b0 * b2;
+
+    // log f(t) up to a constant, -inf off the support (which holds t = 0)
+    auto log_density = [&](double t) {
+        const double off = -std::numeric_limits<double>::infinity();
+        if (std::abs(b2) < 1e-12) {
+            if (std::abs(b1) < 1e-12) {
+                return (0.5 * t * t - a * t) / b0; // Gaussian
+            }
+            const double linear = b1 * t + b0;
+            return linear * b0 > 0.0 ? t / b1 - (b0 / b1 + a) / b1 * std::log(std::abs(linear)) : off;
+        }
+        if (discriminant < 0.0) { // Type IV
+            const double root = std::sqrt(-discriminant);
+            return std::log(std::abs(b0 + b1 * t + b2 * t * t)) / (2.0 * b2) -
+                   (a + b1 / (2.0 * b2)) * 2.0 / root * std::atan((2.0 * b2 * t + b1) / root);
+        }
+        const double root = std::sqrt(std::max(discriminant, 1e-24));
+        const double r1 = std::min((-b1 - root) / (2.0 * b2), (-b1 + root) / (2.0 * b2));
+        const double r2 = std::max((-b1 - root) / (2.0 * b2), (-b1 + root) / (2.0 * b2));
+        const bool inside = r1 < 0.0 && 0.0 < r2 ? r1 < t && t < r2 : 0.0 <= r1 ? t < r1 : t > r2;
+        return inside ? ((r1 - a) / (r1 - r2) * std::log(std::abs(t - r1)) +
+                         (r2 - a) / (r2 - r1) * std::log(std::abs(t - r2))) / b2
+                      : off;
+    };
+
+    // Normalize over +-12 standard deviations, whatever the depth window
+    const int samples = 4801;
+    const double step = 24.0 / (samples - 1);
+    Eigen::ArrayXd logs(samples);
+    for (int k = 0; k < samples; ++k) {
+        logs[k] = log_density(-12.0 + k * step);
+    }
+    const double peak = logs.maxCoeff();
+    const double area = (logs - peak).exp().sum() * step * straggling;
+
+    Eigen::ArrayXd density(depths.size());
+    for (int i = 0; i < depths.size(); ++i) {
+        density[i] = std::exp(log_density((depths[i] - range) / straggling) - peak) / area;
+    }
+    return density;
+}
+
+Eigen::ArrayXXd AdvancedIonImplantation::calculateBCADistribution(const ImplantParameters& params, double depth,
+                                                                 int rows, int cols) {
+    const MaterialProperties si = getMaterialProperties("Si");
+    const BCATransport::Target target{static_cast<double>(si.atomic_number), si.atomic_mass,
+                                      si.density * 6.02214076e23 / si.atomic_mass, si.displacement_threshold};
+    BCATransport::Beam beam{{static_cast<double>(params.ion.atomic_number), params.ion.atomic_mass}, params.energy};
+    beam.tilt = params.tilt_angle;
+    beam.twist = params.twist_angle;
+
+    const double dz = depth / rows; // um
+    const BCATransport::Result result =
+        BCATransport(target, seed_).run(beam, bca_ions_, rows, dz, bca_implants_++);
+    // Per traced ion and cell to cm^-3 at this dose
+    const double scale = result.traced > 0 ? params.dose / (result.traced * dz * 1e-4) : 0.0;
+
+    Eigen::ArrayXXd distribution(rows, cols);
+    DamageProfile damage;
+    damage.vacancy_concentration.resize(rows, cols);
+    damage.interstitial_concentration.resize(rows, cols);
+    damage.amorphous_fraction.resize(rows, cols);
+    const double amorphization_threshold = calculateAmorphizationThreshold("Si", params.temperature);
+    for (int i = 0; i < rows; ++i) {
+        const double ions = result.ions[i] * scale;
+        const double vacancies = result.vacancies[i] * scale;
+        distribution.row(i).setConstant(ions);
+        damage.vacancy_concentration.row(i).setConstant(vacancies);
+        // Recoils are not followed, so each vacancy's interstitial stays
+        // in its cell; implanted ions sit interstitially too
+        damage.interstitial_concentration.row(i).setConstant(vacancies + ions);
+        damage.amorphous_fraction.row(i).setConstant(
+            vacancies > amorphization_threshold
+                ? std::min(1.0, (vacancies - amorphization_threshold) / amorphization_threshold)
+                : 0.0);
+    }
+    if (damage_accumulation_enabled_) {
+        damage_profile_ = std::move(damage);
+    }
+
+    SEMIPRO_LOGF(INFO, PHYSICS, "BCA transport: {} ions, mean depth {}um, {} backscattered, {} eV nuclear per ion",
+                 result.traced, result.mean_depth, result.backscattered, result.nuclear_energy);
     return distribution;
 }
 
 Eigen::ArrayXXd AdvancedIonImplantation::applyChannelingEffects(const Eigen::ArrayXXd& distribution,
                                                                const ImplantParameters& params) const {
-    int rows = distribution.rows();
-    int cols = distribution.cols();
-    Eigen::ArrayXXd channeled_distribution = distribution;
+    double normal_range = calculateLSSRange(params.ion, params.energy, "Si");
+    Eigen::ArrayXd tail = calculateChannelingTail(params, distribution.rows(), 2.0 * normal_range);
+    return distribution.colwise() * tail;
+}
+
+Eigen::ArrayXd AdvancedIonImplantation::calculateChannelingTail(const ImplantParameters& params, int rows,
+                                                               double depth) const {
+    Eigen::ArrayXd tail = Eigen::ArrayXd::Ones(rows);
     
     // Calculate channeling probability
     double channeling_prob = calculateChannelingProbability(params.tilt_angle, params.twist_angle, 
@@ -209,21 +457,14 @@ Eigen::ArrayXXd AdvancedIonImplantation::applyChannelingEffects(const Eigen::Arr
         
         // Create channeling tail
         for (int i = 0; i < rows; ++i) {
-            for (int j = 0; j < cols; ++j) {
-                double depth = (static_cast<double>(i) / rows) * 2.0 * normal_range;
-                
-                if (depth > normal_range) {
-                    // Add channeling tail
-                    double channeling_factor = channeling_prob * 
-                                              std::exp(-(depth - normal_range) / (channeling_range - normal_range));
-                    
-                    channeled_distribution(i, j) += distribution(i, j) * channeling_factor;
-                }
+            double z = (static_cast<double>(i) / rows) * depth;
+            if (z > normal_range) {
+                tail[i] += channeling_prob * std::exp(-(z - normal_range) / (channeling_range - normal_range));
             }
         }
     }
     
-    return channeled_distribution;
+    return tail;
 }
 
 Eigen::ArrayXXd AdvancedIonImplantation::calculateTemperatureEffects(const Eigen::ArrayXXd& distribution,
@@ -235,24 +476,15 @@ Eigen::ArrayXXd AdvancedIonImplantation::calculateTemperatureEffects(const Eigen
         return distribution; // No temperature effects at room temperature
     }
     
-    int rows = distribution.rows();
-    int cols = distribution.cols();
     Eigen::ArrayXXd temp_distribution = distribution;
     
     // Enhanced diffusion at elevated temperature
     double diffusion_enhancement = 1.0 + (temperature - 25.0) / 1000.0; // Linear approximation
     
-    // Apply simple diffusion broadening
-    for (int i = 1; i < rows - 1; ++i) {
-        for (int j = 1; j < cols - 1; ++j) {
-            double diffusion_term = 0.1 * diffusion_enhancement * 
-                                   (distribution(i+1, j) + distribution(i-1, j) + 
-                                    distribution(i, j+1) + distribution(i, j-1) - 
-                                    4 * distribution(i, j));
-            
-            temp_distribution(i, j) += diffusion_term;
-        }
-    }
+    // Apply simple diffusion broadening; edge cells keep their dose
+    const double rate = 0.1 * diffusion_enhancement;
+    Stencil::sweep<Stencil::Hold>(Stencil::Laplacian(), distribution, temp_distribution,
+                                  [rate](double laplacian, double c, int, int) { return c + rate * laplacian; });
     
     return temp_distribution;
 }
@@ -299,6 +531,13 @@ AdvancedIonImplantation::calculateDamageProfile(const ImplantParameters& params,
     return damage;
 }
 
+double AdvancedIonImplantation::calculateCascadeDamage(double nuclear_energy, const MaterialProperties& target) const {
+    const BCATransport::Target bca_target{static_cast<double>(target.atomic_number), target.atomic_mass,
+                                          target.density * 6.02214076e23 / target.atomic_mass,
+                                          target.displacement_threshold};
+    return BCATransport::displacements(nuclear_energy, bca_target);
+}
+
 double AdvancedIonImplantation::calculateDisplacementThreshold(const std::string& material) const {
     auto props = getMaterialProperties(material);
     return props.displacement_threshold; // eV
@@ -315,60 +554,69 @@ double AdvancedIonImplantation::calculateAmorphizationThreshold(const std::strin
     return base_threshold * temp_factor;
 }
 
-void AdvancedIonImplantation::initializeIonDatabase() {
-    // Common dopant ions
-    ion_database_["B"] = IonSpecies("B", 10.81, 5);
-    ion_database_["P"] = IonSpecies("P", 30.97, 15);
-    ion_database_["As"] = IonSpecies("As", 74.92, 33);
-    ion_database_["Sb"] = IonSpecies("Sb", 121.76, 51);
-    ion_database_["In"] = IonSpecies("In", 114.82, 49);
-    ion_database_["Ga"] = IonSpecies("Ga", 69.72, 31);
-    
-    // Other ions
-    ion_database_["Si"] = IonSpecies("Si", 28.09, 14);
-    ion_database_["Ge"] = IonSpecies("Ge", 72.63, 32);
-    ion_database_["C"] = IonSpecies("C", 12.01, 6);
-    ion_database_["N"] = IonSpecies("N", 14.01, 7);
-    ion_database_["O"] = IonSpecies("O", 16.00, 8);
-    ion_database_["F"] = IonSpecies("F", 19.00, 9);
-}
-
-void AdvancedIonImplantation::initializeMaterialDatabase() {
-    // Silicon
-    material_database_["Si"] = MaterialProperties{
-        2.33,    // density g/cm³
-        28.09,   // atomic mass
-        14,      // atomic number
-        15.0,    // displacement threshold eV
-        5.43,    // lattice constant Å
-        "diamond"
-    };
-    
-    // Silicon dioxide
-    material_database_["SiO2"] = MaterialProperties{
-        2.20,    // density g/cm³
-        20.03,   // average atomic mass
-        10,      // average atomic number
-        18.0,    // displacement threshold eV
-        4.68,    // lattice constant Å
-        "amorphous"
-    };
-    
-    // Silicon nitride
-    material_database_["Si3N4"] = MaterialProperties{
-        3.17,    // density g/cm³
-        20.02,   // average atomic mass
-        10,      // average atomic number
-        20.0,    // displacement threshold eV
-        7.75,    // lattice constant Å
-        "amorphous"
+const std::unordered_map<std::string, AdvancedIonImplantation::IonSpecies>& AdvancedIonImplantation::ionDatabase() {
+    static const std::unordered_map<std::string, IonSpecies> database = [] {
+        std::unordered_map<std::string, IonSpecies> table;
+
+        // Common dopant ions
+        table.emplace("B", IonSpecies("B", 10.81, 5));
+        table.emplace("P", IonSpecies("P", 30.97, 15));
+        table.emplace("As", IonSpecies("As", 74.92, 33));
+        table.emplace("Sb", IonSpecies("Sb", 121.76, 51));
+        table.emplace("In", IonSpecies("In", 114.82, 49));
+        table.emplace("Ga", IonSpecies("Ga", 69.72, 31));
+
+        // Other ions
+        table.emplace("Si", IonSpecies("Si", 28.09, 14));
+        table.emplace("Ge", IonSpecies("Ge", 72.63, 32));
+        table.emplace("C", IonSpecies("C", 12.01, 6));
+        table.emplace("N", IonSpecies("N", 14.01, 7));
+        table.emplace("O", IonSpecies("O", 16.00, 8));
+        table.emplace("F", IonSpecies("F", 19.00, 9));
+        return table;
+    }();
+    return database;
+}
+
+const std::unordered_map<std::string, AdvancedIonImplantation::MaterialProperties>&
+AdvancedIonImplantation::materialDatabase() {
+    static const std::unordered_map<std::string, MaterialProperties> database = {
+        // Silicon
+        {"Si", MaterialProperties{
+            2.33,    // density g/cm³
+            28.09,   // atomic mass
+            14,      // atomic number
+            15.0,    // displacement threshold eV
+            5.43,    // lattice constant Å
+            "diamond"
+        }},
+        // Silicon dioxide
+        {"SiO2", MaterialProperties{
+            2.20,    // density g/cm³
+            20.03,   // average atomic mass
+            10,      // average atomic number
+            18.0,    // displacement threshold eV
+            4.68,    // lattice constant Å
+            "amorphous"
+        }},
+        // Silicon nitride
+        {"Si3N4", MaterialProperties{
+            3.17,    // density g/cm³
+            20.02,   // average atomic mass
+            10,      // average atomic number
+            20.0,    // displacement threshold eV
+            7.75,    // lattice constant Å
+            "amorphous"
+        }},
     };
+    return database;
 }
 
 AdvancedIonImplantation::IonSpecies 
 AdvancedIonImplantation::getIonSpecies(const std::string& symbol) const {
-    auto it = ion_database_.find(symbol);
-    if (it != ion_database_.end()) {
+    const auto& database = ionDatabase();
+    auto it = database.find(symbol);
+    if (it != database.end()) {
         return it->second;
     }
     
@@ -378,13 +626,14 @@ AdvancedIonImplantation::getIonSpecies(const std::string& symbol) const {
 
 AdvancedIonImplantation::MaterialProperties 
 AdvancedIonImplantation::getMaterialProperties(const std::string& material) const {
-    auto it = material_database_.find(material);
-    if (it != material_database_.end()) {
+    const auto& database = materialDatabase();
+    auto it = database.find(material);
+    if (it != database.end()) {
         return it->second;
     }
     
     // Default to silicon if not found
-    return material_database_.at("Si");
+    return database.at("Si");
 }
 
 double AdvancedIonImplantation::calculateReducedEnergy(const IonSpecies& ion, double energy,
@@ -503,6 +752,23 @@ createMOSFETImplantSequence(const std::string& device_type) {
     return sequence;
 }
 
+std::vector<AdvancedIonImplantation::ImplantParameters> createBipolarImplantSequence() {
+    std::vector<AdvancedIonImplantation::ImplantParameters> sequence;
+    
+    AdvancedIonImplantation::IonSpecies boron("B", 10.81, 5);
+    AdvancedIonImplantation::IonSpecies phosphorus("P", 30.97, 15);
+    AdvancedIonImplantation::IonSpecies arsenic("As", 74.92, 33);
+    AdvancedIonImplantation::IonSpecies antimony("Sb", 121.76, 51);
+    
+    sequence.emplace_back(antimony, 60, 2e15);    // Buried layer
+    sequence.emplace_back(phosphorus, 180, 1e16); // Collector reach-through
+    sequence.emplace_back(boron, 20, 2e13);       // Intrinsic base
+    sequence.emplace_back(boron, 40, 3e15);       // Extrinsic base
+    sequence.emplace_back(arsenic, 50, 1e16);     // Emitter
+    
+    return sequence;
+}
+
 bool validateImplantParameters(const AdvancedIonImplantation::ImplantParameters& params) {
     // Basic validation
     if (params.energy <= 0 || params.energy > 10000) { // 0-10 MeV range
@@ -3,7 +3,12 @@
 #define ADVANCED_ION_IMPLANTATION_HPP
 
 #include "../core/wafer.hpp"
+#include "../doping/bca_transport.hpp"
+#include "../doping/implant_moments.hpp"
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <tuple>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -62,6 +67,11 @@ public:
     
     // Main simulation methods
     bool simulateImplantation(std::shared_ptr<Wafer> wafer, const ImplantParameters& params);
+    // The whole sequence in one pass: analytic implants share a depth
+    // window twice the deepest range, and damage and amorphization are
+    // evaluated once on the summed displacements. Nothing is written to
+    // the wafer unless every implant succeeds. Metrics other than damage,
+    // amorphization, time and throughput describe the last implant.
     bool simulateMultipleImplants(std::shared_ptr<Wafer> wafer, 
                                  const std::vector<ImplantParameters>& implant_sequence);
     
@@ -70,6 +80,39 @@ public:
     void enableDamageAccumulation(bool enable) { damage_accumulation_enabled_ = enable; }
     void enableTemperatureEffects(bool enable) { temperature_effects_enabled_ = enable; }
     void setSubstrateOrientation(const std::string& orientation) { substrate_orientation_ = orientation; }
+    // Traces `ions` ions per implant through the wafer (BCATransport)
+    // instead of shaping the analytic LSS distribution. Ion and damage
+    // profiles then come from the traced ions, over the wafer thickness;
+    // the target is amorphous Si, so no channeling tail is added.
+    void enableBCATransport(bool enable, long ions = 10000) {
+        bca_enabled_ = enable;
+        bca_ions_ = ions;
+    }
+    void setRandomSeed(std::uint64_t seed) {
+        seed_ = seed;
+        bca_implants_ = 0;
+    }
+    // Open fraction of each lateral column (1 bare, 0 under resist), each
+    // cell_width um wide. Without a mask the analytic implant is blanket.
+    void setLateralMask(const Eigen::ArrayXd& opening, double cell_width) {
+        lateral_mask_ = opening;
+        mask_cell_width_ = cell_width;
+    }
+    void clearLateralMask() { lateral_mask_.resize(0); }
+
+    // The analytic implant as a product of a Pearson depth profile and the
+    // mask blurred by a Gaussian of the lateral straggling:
+    // concentration = vertical(depth) * lateral(y, x)
+    struct SeparableProfile {
+        Eigen::ArrayXd vertical; // cm⁻³ under open mask, at depth i * depth / depth_cells
+        Eigen::ArrayXXd lateral; // Open fraction reaching each mask cell
+    };
+    // `opening` is a plan-view (or single-row cross-section) mask on
+    // cells of cell_width um. Depth profiles are kept per species, energy
+    // and grid, so repeated implants only redo the O(N) lateral blur.
+    SeparableProfile calculateSeparableProfile(const ImplantParameters& params, int depth_cells,
+                                               double depth, const Eigen::ArrayXXd& opening,
+                                               double cell_width) const;
     
     // Physics calculations
     double calculateLSSRange(const IonSpecies& ion, double energy, const std::string& target) const;
@@ -103,14 +146,20 @@ private:
     bool damage_accumulation_enabled_;
     bool temperature_effects_enabled_;
     std::string substrate_orientation_;
+    bool bca_enabled_ = false;
+    long bca_ions_ = 10000;
+    std::uint64_t seed_ = 0;
+    std::uint64_t bca_implants_ = 0; // BCATransport stream of the next implant
+    Eigen::ArrayXd lateral_mask_;
+    double mask_cell_width_ = 0.0;
+
+    // Unit-dose depth profiles (um⁻¹) by ion, energy, depth cells and depth
+    mutable std::map<std::tuple<std::string, double, int, double>, Eigen::ArrayXd> depth_profiles_;
     
     // Performance tracking
     mutable ImplantMetrics metrics_;
     mutable DamageProfile damage_profile_;
     
-    // Ion species database
-    std::unordered_map<std::string, IonSpecies> ion_database_;
-    
     // Material properties database
     struct MaterialProperties {
         double density;              // g/cm³
@@ -120,15 +169,21 @@ private:
         double lattice_constant;    // Å
         std::string crystal_structure;
     };
-    std::unordered_map<std::string, MaterialProperties> material_database_;
     
     // Advanced physics methods
     Eigen::ArrayXXd calculateFullLSSDistribution(const ImplantParameters& params, 
                                                 int rows, int cols) const;
     Eigen::ArrayXXd applyChannelingEffects(const Eigen::ArrayXXd& distribution,
                                          const ImplantParameters& params) const;
+    // Per-row factor (>= 1) the channeling tail multiplies a profile by,
+    // for rows depth cells spanning `depth` (um)
+    Eigen::ArrayXd calculateChannelingTail(const ImplantParameters& params, int rows, double depth) const;
     Eigen::ArrayXXd calculateTemperatureEffects(const Eigen::ArrayXXd& distribution,
                                                double temperature) const;
+    // Ion distribution over rows depth cells spanning `depth` (um), uniform
+    // across the columns; also fills damage_profile_
+    Eigen::ArrayXXd calculateBCADistribution(const ImplantParameters& params, double depth,
+                                             int rows, int cols);
     
     // LSS theory implementation
     double calculateReducedEnergy(const IonSpecies& ion, double energy, 
@@ -137,6 +192,7 @@ private:
                                         const MaterialProperties& target) const;
     double calculateElectronicStoppingPower(const IonSpecies& ion, double energy,
                                            const MaterialProperties& target) const;
+    const ImplantMoments& momentTable(const IonSpecies& ion, const std::string& target) const;
     
     // Channeling physics
     double calculateChannelingProbability(double tilt_angle, double twist_angle,
@@ -149,17 +205,19 @@ private:
     double calculateCascadeDamage(double nuclear_energy, const MaterialProperties& target) const;
     
     // Utility methods
-    void initializeIonDatabase();
-    void initializeMaterialDatabase();
+    // Ion species and target databases: process-wide and immutable, built
+    // on first use rather than per instance
+    static const std::unordered_map<std::string, IonSpecies>& ionDatabase();
+    static const std::unordered_map<std::string, MaterialProperties>& materialDatabase();
     IonSpecies getIonSpecies(const std::string& symbol) const;
     MaterialProperties getMaterialProperties(const std::string& material) const;
     void updateMetrics(const ImplantParameters& params, const Eigen::ArrayXXd& final_distribution) const;
     
     // Statistical methods
-    double calculatePearsonIVMoments(double range, double straggling, double skewness, double kurtosis) const;
-    Eigen::ArrayXXd generatePearsonIVDistribution(double range, double straggling, 
-                                                 double skewness, double kurtosis, 
-                                                 int rows, int cols) const;
+    // Pearson density with these moments (um) at each depth, normalized
+    // over its whole support; type IV for the usual implant moments
+    Eigen::ArrayXd generatePearsonIVDistribution(double range, double straggling, double skewness,
+                                                 double kurtosis, const Eigen::ArrayXd& depths) const;
 };
 
 // Factory functions for common implant configurations
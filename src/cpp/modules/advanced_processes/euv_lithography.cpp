@@ -1,22 +1,167 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "euv_lithography.hpp"
 #include "../core/utils.hpp"
+#include "../../core/reproducibility.hpp"
+#include "../../core/vector_math.hpp"
 #include <cmath>
-#include <random>
 #include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr double kPixelArea = 1e-14;         // m² (approximate pixel area)
+constexpr double kPixelPitch = 100.0;        // nm, the side of kPixelArea
+constexpr double kThresholdFraction = 0.8;   // Resist threshold dose over its sensitivity
+constexpr Eigen::Index kNoiseBlock = 256;    // Pixels given noise per pass
+constexpr Eigen::Index kParallelPixels = 1 << 14;
+constexpr double kResistContrast = 5.0;      // High contrast for EUV resists
+constexpr double kCoherenceFactor = 0.3;     // Partial coherence
+constexpr double kMaskAbsorption = 0.95;     // High absorption for EUV masks
+
+// Shot noise on the n pixels from pixel `first` of an image, in storage
+// order: pixel k takes normal k % 2 of Philox block k / 2 in the
+// realization's stream, whichever thread or span handles it. normals is
+// scratch for n values and may be noisy itself.
+void addShotNoise(const Philox4x32& philox, std::uint64_t realization, double photons, const double* intensity,
+                  double* noisy, Eigen::Index first, Eigen::Index n, double* normals) {
+    for (Eigen::Index k = first; k < first + n;) {
+        const auto z = Philox4x32::normals(philox(static_cast<std::uint64_t>(k / 2), realization));
+        for (Eigen::Index lane = k & 1; lane < 2 && k < first + n; ++lane, ++k) {
+            normals[k - first] = z[lane];
+        }
+    }
+    // A pixel receiving N photons varies by 1 / sqrt(N)
+    const Eigen::Map<const Eigen::ArrayXd> in(intensity, n);
+    Eigen::Map<Eigen::ArrayXd>(noisy, n) =
+        (in + Eigen::Map<const Eigen::ArrayXd>(normals, n) / (in * photons).max(1.0).sqrt()).max(0.0);
+}
+
+// Lines running down the columns, cut by every row as the stochastic
+// statistics cut them. Rows crossing the most common number of lines
+// give line k its k-th run, so edges stay matched to their line.
+struct LineCuts {
+    std::vector<std::vector<double>> left, right, width; // Per line, per row, in cells
+};
+
+LineCuts cutLines(const EdgeMap& edges) {
+    std::vector<std::vector<EdgeRun>> rows(edges.rows());
+    for (const EdgeRun& run : edges.rowRuns()) {
+        rows[run.cut].push_back(run);
+    }
+    std::vector<int> frequency;
+    for (const auto& runs : rows) {
+        if (!runs.empty()) {
+            frequency.resize(std::max(frequency.size(), runs.size() + 1), 0);
+            ++frequency[runs.size()];
+        }
+    }
+    LineCuts lines;
+    if (frequency.empty()) {
+        return lines;
+    }
+    const std::size_t count = std::max_element(frequency.begin(), frequency.end()) - frequency.begin();
+    lines.left.resize(count);
+    lines.right.resize(count);
+    lines.width.resize(count);
+    for (const auto& runs : rows) {
+        if (runs.size() != count) {
+            continue;
+        }
+        for (std::size_t k = 0; k < count; ++k) {
+            lines.left[k].push_back(runs[k].begin);
+            lines.right[k].push_back(runs[k].end);
+            lines.width[k].push_back(runs[k].width());
+        }
+    }
+    return lines;
+}
+
+double mean(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double value : values) {
+        sum += value;
+    }
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+double threeSigma(const std::vector<double>& values) {
+    if (values.size() < 2) {
+        return 0.0;
+    }
+    const double average = mean(values);
+    double variance = 0.0;
+    for (double value : values) {
+        variance += (value - average) * (value - average);
+    }
+    return 3.0 * std::sqrt(variance / values.size());
+}
+
+// Mean width of the runs of row `row` above threshold that start and end
+// inside the image, each edge placed where the profile crosses threshold
+// between the cells either side of it; 0 where none does
+double printedWidth(const Eigen::ArrayXXd& image, int row, double threshold) {
+    const int cols = image.cols();
+    auto crossing = [&](int j) { // Between the centers of cells j - 1 and j
+        const double before = image(row, j - 1), after = image(row, j);
+        return j - 1 + (threshold - before) / (after - before);
+    };
+    double total = 0.0;
+    int lines = 0;
+    double start = 0.0;
+    bool open = false;
+    for (int j = 1; j < cols; ++j) {
+        const bool before = image(row, j - 1) > threshold, after = image(row, j) > threshold;
+        if (!before && after) {
+            start = crossing(j);
+            open = true;
+        } else if (before && !after && open) {
+            total += crossing(j) - start;
+            ++lines;
+            open = false;
+        }
+    }
+    return lines > 0 ? total / lines : 0.0;
+}
+
+// Widest run of consecutive set flags, as the span of the values they sit at
+double widestRun(const std::vector<bool>& flags, const std::vector<double>& values, double& low, double& high) {
+    double widest = -1.0;
+    for (std::size_t begin = 0; begin < flags.size();) {
+        if (!flags[begin]) {
+            ++begin;
+            continue;
+        }
+        std::size_t end = begin;
+        while (end + 1 < flags.size() && flags[end + 1]) {
+            ++end;
+        }
+        if (values[end] - values[begin] > widest) {
+            widest = values[end] - values[begin];
+            low = values[begin];
+            high = values[end];
+        }
+        begin = end + 1;
+    }
+    return std::max(widest, 0.0);
+}
+
+} // namespace
 
 EUVLithography::EUVLithography() 
     : multiple_exposure_enabled_(false)
     , exposure_count_(1)
     , stochastic_effects_enabled_(true)
     , opc_correction_enabled_(true)
+    , resist_development_enabled_(false)
     , resist_thickness_(30e-9)  // 30 nm
     , resist_sensitivity_(20.0)  // mJ/cm²
     , resist_type_("CAR")  // Chemically Amplified Resist
+    , imaging_(std::make_shared<HopkinsImaging>())
+    , stochastic_seed_(0x5EED)
 {
     // Initialize metrics
     metrics_ = EUVMetrics{};
-    Logger::getInstance().log("EUV Lithography system initialized (λ=13.5nm)");
+    SEMIPRO_LOGF(INFO, PHYSICS, "EUV Lithography system initialized (λ=13.5nm)");
 }
 
 bool EUVLithography::simulateEUVExposure(std::shared_ptr<Wafer> wafer,
@@ -25,51 +170,63 @@ bool EUVLithography::simulateEUVExposure(std::shared_ptr<Wafer> wafer,
                                         double dose,
                                         double defocus) {
     try {
-        auto grid = wafer->getGrid();
+        const auto& grid = wafer->getGrid();
         int rows = grid.rows();
         int cols = grid.cols();
         
-        Logger::getInstance().log("Starting EUV exposure simulation");
-        Logger::getInstance().log("Parameters: NA=" + std::to_string(numerical_aperture) + 
-                                 ", dose=" + std::to_string(dose) + "mJ/cm², defocus=" + 
-                                 std::to_string(defocus) + "nm");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Starting EUV exposure simulation");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Parameters: NA={}, dose={}mJ/cm², defocus={}nm",
+                     numerical_aperture, dose, defocus);
         
         // Calculate aerial image
         Eigen::ArrayXXd aerial_image;
         
+        const std::vector<std::vector<int>> mask =
+            model_opc_ ? applyModelBasedOPC(mask_pattern, numerical_aperture, defocus) : mask_pattern;
         if (multiple_exposure_enabled_) {
-            aerial_image = simulateMultipleExposure(mask_pattern, numerical_aperture, dose, rows, cols);
+            aerial_image = simulateMultipleExposure(mask, numerical_aperture, dose, rows, cols);
         } else {
-            aerial_image = calculateEUVAerialImage(mask_pattern, numerical_aperture, defocus, rows, cols);
-        }
-        
-        // Apply stochastic effects
-        if (stochastic_effects_enabled_) {
-            aerial_image = simulateStochasticEffects(aerial_image);
+            aerial_image = calculateEUVAerialImage(mask, numerical_aperture, defocus, rows, cols);
         }
         
-        // Simulate resist response
-        Eigen::ArrayXXd resist_pattern = simulateResistResponse(aerial_image, dose);
-        
-        // Apply OPC correction
-        if (opc_correction_enabled_) {
-            resist_pattern = applyOPCCorrection(resist_pattern);
+        // Shot noise and the resist response in one pass
+        const std::uint64_t realization = next_realization_.fetch_add(1);
+        if (resist_development_enabled_ && !opc_correction_enabled_) {
+            // Nothing needs the continuous response, so develop straight
+            // into the mask
+            BitMask developed = developResist(aerial_image, dose, realization);
+            updateMetrics(developed);
+            wafer->setPhotoresistMask(std::move(developed));
+        } else {
+            Eigen::ArrayXXd resist_pattern = simulateResistResponse(aerial_image, dose, realization);
+            
+            // Apply OPC correction
+            if (opc_correction_enabled_) {
+                resist_pattern = applyOPCCorrection(resist_pattern);
+            }
+            
+            // Update wafer with final pattern
+            if (resist_development_enabled_) {
+                const double half = 0.5 * resistSaturation();
+                BitMask developed = BitMask::fromPredicate(rows, cols, [&](int i, int j) {
+                    return resist_pattern(i, j) > half;
+                });
+                updateMetrics(developed);
+                wafer->setPhotoresistMask(std::move(developed));
+            } else {
+                wafer->setPhotoresistPattern(resist_pattern);
+                updateMetrics(resist_pattern);
+            }
         }
         
-        // Update wafer with final pattern
-        wafer->setPhotoresistPattern(resist_pattern);
-        
-        // Update performance metrics
-        updateMetrics(resist_pattern);
-        
-        Logger::getInstance().log("EUV exposure completed successfully");
-        Logger::getInstance().log("Resolution: " + std::to_string(metrics_.resolution * 1e9) + "nm");
-        Logger::getInstance().log("LER: " + std::to_string(metrics_.line_edge_roughness) + "nm");
+        SEMIPRO_LOGF(INFO, PHYSICS, "EUV exposure completed successfully");
+        SEMIPRO_LOGF(INFO, PHYSICS, "Resolution: {}nm", metrics_.resolution * 1e9);
+        SEMIPRO_LOGF(INFO, PHYSICS, "LER: {}nm", metrics_.line_edge_roughness);
         
         return true;
         
     } catch (const std::exception& e) {
-        Logger::getInstance().log("EUV exposure failed: " + std::string(e.what()));
+        SEMIPRO_LOGF(INFO, PHYSICS, "EUV exposure failed: {}", e.what());
         return false;
     }
 }
@@ -77,26 +234,46 @@ bool EUVLithography::simulateEUVExposure(std::shared_ptr<Wafer> wafer,
 void EUVLithography::setMultipleExposure(bool enable, int exposures) {
     multiple_exposure_enabled_ = enable;
     exposure_count_ = exposures;
-    Logger::getInstance().log("Multiple exposure " + std::string(enable ? "enabled" : "disabled") + 
-                             " (" + std::to_string(exposures) + " exposures)");
+    SEMIPRO_LOGF(INFO, PHYSICS, "Multiple exposure {} ({} exposures)", enable ? "enabled" : "disabled", exposures);
 }
 
 void EUVLithography::enableStochasticEffects(bool enable) {
     stochastic_effects_enabled_ = enable;
-    Logger::getInstance().log("Stochastic effects " + std::string(enable ? "enabled" : "disabled"));
+    SEMIPRO_LOGF(INFO, PHYSICS, "Stochastic effects {}", enable ? "enabled" : "disabled");
 }
 
 void EUVLithography::setResistParameters(double thickness, double sensitivity, const std::string& type) {
     resist_thickness_ = thickness;
     resist_sensitivity_ = sensitivity;
     resist_type_ = type;
-    Logger::getInstance().log("Resist parameters: " + type + ", " + std::to_string(thickness*1e9) + 
-                             "nm, " + std::to_string(sensitivity) + "mJ/cm²");
+    SEMIPRO_LOGF(INFO, PHYSICS, "Resist parameters: {}, {}nm, {}mJ/cm²", type, thickness*1e9, sensitivity);
 }
 
 void EUVLithography::enableOPCCorrection(bool enable) {
     opc_correction_enabled_ = enable;
-    Logger::getInstance().log("OPC correction " + std::string(enable ? "enabled" : "disabled"));
+    SEMIPRO_LOGF(INFO, PHYSICS, "OPC correction {}", enable ? "enabled" : "disabled");
+}
+
+void EUVLithography::enableResistDevelopment(bool enable) {
+    resist_development_enabled_ = enable;
+    SEMIPRO_LOGF(INFO, PHYSICS, "Resist development {}", enable ? "enabled" : "disabled");
+}
+
+void EUVLithography::setStochasticSeed(std::uint64_t seed) {
+    stochastic_seed_ = seed;
+    next_realization_.store(0);
+}
+
+void EUVLithography::setHopkinsImaging(std::shared_ptr<HopkinsImaging> imaging) {
+    if (!imaging) {
+        throw std::invalid_argument("EUV lithography needs a Hopkins imaging engine");
+    }
+    imaging_ = std::move(imaging);
+}
+
+void EUVLithography::setModelBasedOPC(std::shared_ptr<ModelBasedOpc> opc) {
+    model_opc_ = std::move(opc);
+    SEMIPRO_LOGF(INFO, PHYSICS, "Model-based OPC {}", model_opc_ ? "enabled" : "disabled");
 }
 
 double EUVLithography::calculateResolution(double numerical_aperture) const {
@@ -111,64 +288,45 @@ double EUVLithography::calculateDepthOfFocus(double numerical_aperture) const {
     return k2 * EUV_WAVELENGTH / (numerical_aperture * numerical_aperture);
 }
 
+HopkinsImaging::Optics EUVLithography::euvOptics(double na, double defocus) const {
+    // Hopkins imaging in um: grid cells are 1 um, defocus comes in nm
+    HopkinsImaging::Optics optics(EUV_WAVELENGTH * 1e6, na, kCoherenceFactor, 1.0, 1.0);
+    optics.defocus = defocus * 1e-3;
+    return optics;
+}
+
+std::vector<std::vector<int>> EUVLithography::applyModelBasedOPC(const std::vector<std::vector<int>>& mask,
+                                                                 double na, double defocus) const {
+    const int rows = static_cast<int>(mask.size());
+    const int cols = mask.empty() ? 0 : static_cast<int>(mask[0].size());
+    const BitMask target = BitMask::fromPredicate(rows, cols, [&](int i, int j) { return mask[i][j] != 0; });
+    const ModelBasedOpc::Result result = model_opc_->correct(target, euvOptics(na, defocus));
+    SEMIPRO_LOGF(INFO, PHYSICS, "Model-based OPC: {} fragments, {} iterations, max edge error {} px{}",
+                 result.fragments, result.iterations, result.max_edge_error,
+                 result.converged ? "" : " (not converged)");
+    std::vector<std::vector<int>> corrected(rows, std::vector<int>(cols, 0));
+    result.mask.forEachSet([&](int i, int j) { corrected[i][j] = 1; });
+    return corrected;
+}
+
 Eigen::ArrayXXd EUVLithography::calculateEUVAerialImage(const std::vector<std::vector<int>>& mask,
                                                        double na, double defocus, 
                                                        int rows, int cols) const {
-    Eigen::ArrayXXd aerial_image(rows, cols);
-    aerial_image.setZero();
-    
-    // EUV-specific parameters
-    double coherence_factor = 0.3; // Partial coherence
-    double mask_absorption = 0.95; // High absorption for EUV masks
-    
-    // Calculate point spread function for EUV
-    double psf_width = EUV_WAVELENGTH / na * 1e6; // Convert to grid units
-    
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            double intensity = 0.0;
-            
-            // Convolution with EUV PSF
-            int psf_size = static_cast<int>(psf_width * 3);
-            
-            for (int di = -psf_size; di <= psf_size; ++di) {
-                for (int dj = -psf_size; dj <= psf_size; ++dj) {
-                    int mask_i = i + di;
-                    int mask_j = j + dj;
-                    
-                    if (mask_i >= 0 && mask_i < static_cast<int>(mask.size()) && 
-                        mask_j >= 0 && mask_j < static_cast<int>(mask[0].size())) {
-                        
-                        double mask_value = mask[mask_i][mask_j];
-                        
-                        // Apply mask absorption
-                        if (mask_value == 0) {
-                            mask_value = 1.0 - mask_absorption;
-                        }
-                        
-                        // EUV PSF (more complex due to short wavelength)
-                        double r_squared = di * di + dj * dj;
-                        double psf_value = std::exp(-r_squared / (2.0 * psf_width * psf_width));
-                        
-                        // Add defocus effects
-                        if (defocus != 0.0) {
-                            double defocus_factor = std::cos(2.0 * M_PI * defocus * r_squared / 
-                                                           (EUV_WAVELENGTH * 1e9));
-                            psf_value *= defocus_factor;
-                        }
-                        
-                        intensity += mask_value * psf_value;
-                    }
-                }
-            }
-            
-            // Apply coherence effects
-            aerial_image(i, j) = intensity * (1.0 + coherence_factor);
+    // Absorbers pass the amplitude of the intensity they let through
+    const int mask_rows = static_cast<int>(mask.size());
+    const int mask_cols = mask.empty() ? 0 : static_cast<int>(mask[0].size());
+    Eigen::ArrayXXd transmission(mask_rows, mask_cols);
+    const double absorber = std::sqrt(1.0 - kMaskAbsorption);
+    for (int i = 0; i < mask_rows; ++i) {
+        for (int j = 0; j < mask_cols; ++j) {
+            transmission(i, j) = mask[i][j] == 0 ? absorber : 1.0;
         }
     }
     
+    Eigen::ArrayXXd aerial_image = imaging_->aerialImage(transmission, euvOptics(na, defocus), rows, cols);
+    
     // Normalize
-    double max_intensity = aerial_image.maxCoeff();
+    double max_intensity = aerial_image.size() > 0 ? aerial_image.maxCoeff() : 0.0;
     if (max_intensity > 0) {
         aerial_image /= max_intensity;
     }
@@ -177,60 +335,246 @@ Eigen::ArrayXXd EUVLithography::calculateEUVAerialImage(const std::vector<std::v
 }
 
 Eigen::ArrayXXd EUVLithography::simulateStochasticEffects(const Eigen::ArrayXXd& aerial_image) const {
-    int rows = aerial_image.rows();
-    int cols = aerial_image.cols();
-    Eigen::ArrayXXd stochastic_image = aerial_image;
-    
-    // Random number generator for stochastic effects
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            double intensity = aerial_image(i, j);
-            
-            // Photon shot noise (Poisson statistics)
-            double pixel_area = 1e-14; // m² (approximate pixel area)
-            double photon_noise = calculatePhotonShotNoise(intensity * resist_sensitivity_, pixel_area);
-            
-            // Add noise
-            std::normal_distribution<double> noise_dist(0.0, photon_noise);
-            double noise = noise_dist(gen);
-            
-            stochastic_image(i, j) = std::max(0.0, intensity + noise);
-        }
+    return simulateStochasticEffects(aerial_image, next_realization_.fetch_add(1));
+}
+
+Eigen::ArrayXXd EUVLithography::simulateStochasticEffects(const Eigen::ArrayXXd& aerial_image,
+                                                          std::uint64_t realization) const {
+    // Photons are proportional to the intensity, so the scale is found once
+    const double photons = photonsPerIntensity();
+    const Philox4x32 philox(stochastic_seed_);
+    const Eigen::Index size = aerial_image.size();
+    const Eigen::Index blocks = (size + kNoiseBlock - 1) / kNoiseBlock;
+    Eigen::ArrayXXd stochastic_image(aerial_image.rows(), aerial_image.cols());
+
+#pragma omp parallel for schedule(static) if (size >= kParallelPixels)
+    for (Eigen::Index block = 0; block < blocks; ++block) {
+        const Eigen::Index begin = block * kNoiseBlock;
+        double normals[kNoiseBlock];
+        addShotNoise(philox, realization, photons, aerial_image.data() + begin, stochastic_image.data() + begin,
+                     begin, std::min(kNoiseBlock, size - begin), normals);
     }
-    
+
     return stochastic_image;
 }
 
-Eigen::ArrayXXd EUVLithography::simulateResistResponse(const Eigen::ArrayXXd& aerial_image, double dose) const {
-    int rows = aerial_image.rows();
-    int cols = aerial_image.cols();
-    Eigen::ArrayXXd resist_response(rows, cols);
-    
-    // CAR (Chemically Amplified Resist) model
-    double threshold_dose = resist_sensitivity_ * 0.8; // 80% of sensitivity
-    double contrast = 5.0; // High contrast for EUV resists
-    
+EUVLithography::StochasticStatistics EUVLithography::simulateStochasticRealizations(
+    const Eigen::ArrayXXd& aerial_image, double dose, int realizations) const {
+    if (realizations <= 0) {
+        throw std::invalid_argument("Stochastic statistics need at least one realization");
+    }
+    const int rows = aerial_image.rows();
+    const int cols = aerial_image.cols();
+    const double threshold_dose = resist_sensitivity_ * kThresholdFraction;
+
+    // The noise-free print sets the lines each row holds: a realization's
+    // row width is its printed cells over that row's lines
+    std::vector<int> lines(rows, 0);
+    Eigen::Array<bool, Eigen::Dynamic, Eigen::Dynamic> reference = aerial_image * dose > threshold_dose;
     for (int i = 0; i < rows; ++i) {
         for (int j = 0; j < cols; ++j) {
-            double local_dose = aerial_image(i, j) * dose;
-            
-            // Sigmoid response function for CAR
-            double response = 1.0 / (1.0 + std::exp(-contrast * (local_dose - threshold_dose) / threshold_dose));
-            
-            // Apply resist thickness effects
-            double absorption = calculateAbsorption(resist_type_, resist_thickness_);
-            response *= (1.0 - std::exp(-absorption));
-            
-            resist_response(i, j) = response;
+            lines[i] += reference(i, j) && (j == 0 || !reference(i, j - 1)) ? 1 : 0;
         }
     }
-    
+
+    const std::uint64_t first = next_realization_.fetch_add(static_cast<std::uint64_t>(realizations));
+    struct Sums {
+        double width = 0.0, width_square = 0.0, roughness = 0.0, flipped = 0.0;
+        int defective = 0;
+    };
+    // Realization sums added in a fixed tree: the same bits on any number
+    // of threads
+    auto realize = [&](Sums& sums, std::size_t r) {
+        const Eigen::ArrayXXd noisy = simulateStochasticEffects(aerial_image, first + r);
+        double row_sum = 0.0, row_square_sum = 0.0;
+        int measured = 0;
+        long flipped = 0;
+        for (int i = 0; i < rows; ++i) {
+            int printed = 0;
+            for (int j = 0; j < cols; ++j) {
+                const bool cell = noisy(i, j) * dose > threshold_dose;
+                printed += cell ? 1 : 0;
+                flipped += cell != reference(i, j) ? 1 : 0;
+            }
+            if (lines[i] > 0) {
+                const double width = static_cast<double>(printed) / lines[i];
+                row_sum += width;
+                row_square_sum += width * width;
+                ++measured;
+            }
+        }
+        const double mean = measured > 0 ? row_sum / measured : 0.0;
+        const double variance = measured > 0 ? std::max(0.0, row_square_sum / measured - mean * mean) : 0.0;
+        sums.width += mean;
+        sums.width_square += mean * mean;
+        sums.roughness += 3.0 * std::sqrt(variance);
+        sums.flipped += aerial_image.size() > 0 ? static_cast<double>(flipped) / aerial_image.size() : 0.0;
+        sums.defective += flipped > 0 ? 1 : 0;
+    };
+    const Sums sums = orderedReduce(
+        static_cast<std::size_t>(realizations), Sums{}, realize,
+        [](Sums& into, const Sums& from) {
+            into.width += from.width;
+            into.width_square += from.width_square;
+            into.roughness += from.roughness;
+            into.flipped += from.flipped;
+            into.defective += from.defective;
+        },
+        true, 1);
+
+    StochasticStatistics statistics;
+    statistics.realizations = realizations;
+    statistics.mean_width = sums.width / realizations;
+    statistics.line_width_roughness = sums.roughness / realizations;
+    statistics.local_cd_uniformity =
+        3.0 * std::sqrt(std::max(0.0, sums.width_square / realizations - statistics.mean_width * statistics.mean_width));
+    statistics.defect_probability = static_cast<double>(sums.defective) / realizations;
+    statistics.flipped_cell_fraction = sums.flipped / realizations;
+    return statistics;
+}
+
+EUVLithography::ProcessWindow EUVLithography::simulateProcessWindow(
+    const std::vector<std::vector<int>>& mask_pattern, const std::vector<double>& focus,
+    const std::vector<double>& dose, double target_cd, double cd_tolerance, double numerical_aperture) const {
+    if (!validateEUVMask(mask_pattern) || focus.empty() || dose.empty() || !(target_cd > 0.0) ||
+        !(cd_tolerance >= 0.0) || !std::all_of(dose.begin(), dose.end(), [](double d) { return d > 0.0; })) {
+        throw std::invalid_argument("A process window needs a rectangular mask, focus values, positive doses, "
+                                    "a positive target CD and a non-negative tolerance");
+    }
+    if (!std::is_sorted(focus.begin(), focus.end()) || !std::is_sorted(dose.begin(), dose.end())) {
+        throw std::invalid_argument("Process window focus and dose values must be ascending");
+    }
+    const int rows = static_cast<int>(mask_pattern.size());
+    const int cols = static_cast<int>(mask_pattern[0].size());
+    const std::vector<std::vector<int>> mask =
+        model_opc_ ? applyModelBasedOPC(mask_pattern, numerical_aperture, 0.0) : mask_pattern;
+    const double threshold_dose = resist_sensitivity_ * kThresholdFraction;
+    const std::size_t doses = dose.size();
+
+    ProcessWindow window;
+    window.points.resize(focus.size() * doses);
+    for (std::size_t f = 0; f < focus.size(); ++f) {
+        // The kernels of each defocus are decomposed once and cached
+        const Eigen::ArrayXXd aerial_image = calculateEUVAerialImage(mask, numerical_aperture, focus[f], rows, cols);
+        ++window.aerial_images;
+#pragma omp parallel for schedule(static)
+        for (std::size_t d = 0; d < doses; ++d) {
+            ProcessWindowPoint& point = window.points[f * doses + d];
+            point.focus = focus[f];
+            point.dose = dose[d];
+            point.critical_dimension = printedWidth(aerial_image, rows / 2, threshold_dose / dose[d]);
+            point.in_spec = std::abs(point.critical_dimension - target_cd) <= cd_tolerance * target_cd;
+        }
+    }
+
+    double widest_latitude = -1.0, deepest_focus = -1.0;
+    std::vector<bool> in_spec(doses);
+    for (std::size_t f = 0; f < focus.size(); ++f) {
+        for (std::size_t d = 0; d < doses; ++d) {
+            in_spec[d] = window.points[f * doses + d].in_spec;
+        }
+        double low = 0.0, high = 0.0;
+        const double span = widestRun(in_spec, dose, low, high);
+        const double latitude = span > 0.0 ? 200.0 * span / (low + high) : 0.0;
+        window.exposure_latitude.push_back(latitude);
+        if (latitude > widest_latitude) {
+            widest_latitude = latitude;
+            window.best_focus = focus[f];
+        }
+    }
+    in_spec.assign(focus.size(), false);
+    for (std::size_t d = 0; d < doses; ++d) {
+        for (std::size_t f = 0; f < focus.size(); ++f) {
+            in_spec[f] = window.points[f * doses + d].in_spec;
+        }
+        double low = 0.0, high = 0.0;
+        const double depth = widestRun(in_spec, focus, low, high);
+        window.depth_of_focus.push_back(depth);
+        if (depth > deepest_focus) {
+            deepest_focus = depth;
+            window.best_dose = dose[d];
+        }
+    }
+
+    SEMIPRO_LOGF(INFO, PHYSICS, "Process window: {}x{} points from {} aerial images, best focus {}nm, best dose {}mJ/cm²",
+                 focus.size(), doses, window.aerial_images, window.best_focus, window.best_dose);
+    return window;
+}
+
+Eigen::ArrayXXd EUVLithography::simulateResistResponse(const Eigen::ArrayXXd& aerial_image, double dose,
+                                                       std::uint64_t realization) const {
+    // CAR (Chemically Amplified Resist) model: a sigmoid in the local dose
+    // about the threshold, scaled by the resist's absorption. Its exponent
+    // is linear in the intensity, so each pixel costs one exp.
+    const double threshold_dose = resist_sensitivity_ * kThresholdFraction;
+    const double slope = -kResistContrast * dose / threshold_dose;
+    const double saturation = resistSaturation();
+    const double photons = photonsPerIntensity();
+    const Philox4x32 philox(stochastic_seed_);
+    const Eigen::Index size = aerial_image.size();
+    const Eigen::Index blocks = (size + kNoiseBlock - 1) / kNoiseBlock;
+    Eigen::ArrayXXd resist_response(aerial_image.rows(), aerial_image.cols());
+
+#pragma omp parallel for schedule(static) if (size >= kParallelPixels)
+    for (Eigen::Index block = 0; block < blocks; ++block) {
+        const Eigen::Index begin = block * kNoiseBlock;
+        const Eigen::Index n = std::min(kNoiseBlock, size - begin);
+        double noisy[kNoiseBlock];
+        const double* intensity = aerial_image.data() + begin;
+        if (stochastic_effects_enabled_) {
+            addShotNoise(philox, realization, photons, intensity, noisy, begin, n, noisy);
+            intensity = noisy;
+        }
+        Eigen::Map<Eigen::ArrayXd> response(resist_response.data() + begin, n);
+        response = Eigen::Map<const Eigen::ArrayXd>(intensity, n) * slope + kResistContrast;
+        VectorMath::exp(response.data(), response.data(), static_cast<std::size_t>(n));
+        response = saturation / (1.0 + response);
+    }
+
     return resist_response;
 }
 
+BitMask EUVLithography::developResist(const Eigen::ArrayXXd& aerial_image, double dose,
+                                      std::uint64_t realization) const {
+    const int rows = aerial_image.rows();
+    const int cols = aerial_image.cols();
+    BitMask developed(rows, cols);
+    if (!(dose > 0.0)) {
+        return developed;
+    }
+    // The sigmoid passes half where the dose passes the threshold, so
+    // developing needs no exp at all
+    const double threshold = resist_sensitivity_ * kThresholdFraction / dose;
+    const double photons = photonsPerIntensity();
+    const Philox4x32 philox(stochastic_seed_);
+
+    // Bands of 64 columns own whole words of every row, so they develop in
+    // parallel; a column is contiguous in the image and takes its noise in
+    // one span
+    const int bands = (cols + 63) / 64;
+#pragma omp parallel if (aerial_image.size() >= kParallelPixels)
+    {
+        std::vector<double> noisy(rows);
+#pragma omp for schedule(static)
+        for (int band = 0; band < bands; ++band) {
+            for (int j = band * 64; j < std::min(cols, band * 64 + 64); ++j) {
+                const Eigen::Index first = static_cast<Eigen::Index>(j) * rows;
+                const double* column = aerial_image.data() + first;
+                if (stochastic_effects_enabled_) {
+                    addShotNoise(philox, realization, photons, column, noisy.data(), first, rows, noisy.data());
+                    column = noisy.data();
+                }
+                for (int i = 0; i < rows; ++i) {
+                    if (column[i] > threshold) {
+                        developed.set(i, j);
+                    }
+                }
+            }
+        }
+    }
+    return developed;
+}
+
 Eigen::ArrayXXd EUVLithography::applyOPCCorrection(const Eigen::ArrayXXd& pattern) const {
     int rows = pattern.rows();
     int cols = pattern.cols();
@@ -238,22 +582,26 @@ Eigen::ArrayXXd EUVLithography::applyOPCCorrection(const Eigen::ArrayXXd& patter
     
     // Simple OPC: bias correction based on local environment
     int correction_radius = 2;
+    if (rows <= 2 * correction_radius || cols <= 2 * correction_radius) {
+        return corrected_pattern;
+    }
     
-    for (int i = correction_radius; i < rows - correction_radius; ++i) {
-        for (int j = correction_radius; j < cols - correction_radius; ++j) {
-            
-            // Calculate local pattern density
-            double local_density = 0.0;
-            int count = 0;
-            
-            for (int di = -correction_radius; di <= correction_radius; ++di) {
-                for (int dj = -correction_radius; dj <= correction_radius; ++dj) {
-                    local_density += pattern(i + di, j + dj);
-                    count++;
-                }
-            }
-            
-            local_density /= count;
+    // Summed-area table: sums(i, j) holds the pattern over [0, i) x [0, j),
+    // so every window sum takes four lookups
+    Eigen::ArrayXXd sums = Eigen::ArrayXXd::Zero(rows + 1, cols + 1);
+    for (int j = 0; j < cols; ++j) {
+        for (int i = 0; i < rows; ++i) {
+            sums(i + 1, j + 1) = pattern(i, j) + sums(i, j + 1) + sums(i + 1, j) - sums(i, j);
+        }
+    }
+    const int width = 2 * correction_radius + 1;
+    const double count = static_cast<double>(width) * width;
+    
+    for (int j = correction_radius; j < cols - correction_radius; ++j) {
+        for (int i = correction_radius; i < rows - correction_radius; ++i) {
+            const int top = i - correction_radius, left = j - correction_radius;
+            const double local_density = (sums(top + width, left + width) - sums(top, left + width) -
+                                          sums(top + width, left) + sums(top, left)) / count;
             
             // Apply bias correction
             double bias_factor = 1.0 + 0.2 * (0.5 - local_density); // ±20% bias
@@ -311,44 +659,40 @@ double EUVLithography::calculatePhotonShotNoise(double dose, double area) const
     return 1.0 / std::sqrt(std::max(1.0, photons));
 }
 
+double EUVLithography::resistSaturation() const {
+    return 1.0 - std::exp(-calculateAbsorption(resist_type_, resist_thickness_));
+}
+
+double EUVLithography::photonsPerIntensity() const {
+    // Photon energy at 13.5 nm; dose in mJ/cm²
+    const double photon_energy = 6.626e-34 * 3e8 / EUV_WAVELENGTH; // J
+    return (resist_sensitivity_ * 1e-3) * kPixelArea / photon_energy;
+}
+
 void EUVLithography::updateMetrics(const Eigen::ArrayXXd& final_pattern) const {
-    metrics_.resolution = calculateResolution(0.33); // Typical EUV NA
-    metrics_.depth_of_focus = calculateDepthOfFocus(0.33);
-    metrics_.line_edge_roughness = calculateLineEdgeRoughness(final_pattern);
-    metrics_.critical_dimension_uniformity = calculateCriticalDimensionUniformity(final_pattern);
-    metrics_.stochastic_defect_density = 0.1; // defects/cm² (typical)
-    metrics_.throughput = 150.0; // wafers/hour (typical EUV)
+    updateMetrics(EdgeMap::extract(final_pattern, 0.5 * resistSaturation()));
 }
 
-double EUVLithography::calculateLineEdgeRoughness(const Eigen::ArrayXXd& pattern) const {
-    // Simplified LER calculation
-    int rows = pattern.rows();
-    int cols = pattern.cols();
-    
-    double total_roughness = 0.0;
-    int edge_count = 0;
-    
-    for (int i = 1; i < rows - 1; ++i) {
-        for (int j = 1; j < cols - 1; ++j) {
-            // Find edges
-            double gradient = std::abs(pattern(i+1, j) - pattern(i-1, j)) + 
-                             std::abs(pattern(i, j+1) - pattern(i, j-1));
-            
-            if (gradient > 0.5) { // Edge detected
-                // Calculate local roughness
-                double local_roughness = gradient * 0.5; // Simplified
-                total_roughness += local_roughness;
-                edge_count++;
-            }
-        }
-    }
-    
-    return edge_count > 0 ? (total_roughness / edge_count) * 1e9 : 0.0; // Convert to nm
+void EUVLithography::updateMetrics(const BitMask& developed) const {
+    updateMetrics(EdgeMap::extract(developed));
 }
 
-double EUVLithography::calculateCriticalDimensionUniformity(const Eigen::ArrayXXd& pattern) const {
-    // Simplified CDU calculation
-    return 2.0; // nm (typical for EUV)
+void EUVLithography::updateMetrics(const EdgeMap& edges) const {
+    // LER is the 3 sigma of each edge's position down its line, averaged
+    // over edges; CDU the 3 sigma of the lines' mean widths
+    const LineCuts lines = cutLines(edges);
+    double roughness = 0.0;
+    std::vector<double> widths;
+    for (std::size_t k = 0; k < lines.width.size(); ++k) {
+        roughness += 0.5 * (threeSigma(lines.left[k]) + threeSigma(lines.right[k]));
+        widths.push_back(mean(lines.width[k]));
+    }
+    metrics_.resolution = calculateResolution(0.33); // Typical EUV NA
+    metrics_.depth_of_focus = calculateDepthOfFocus(0.33);
+    metrics_.line_edge_roughness = widths.empty() ? 0.0 : roughness / widths.size() * kPixelPitch;
+    metrics_.critical_dimension_uniformity = threeSigma(widths) * kPixelPitch;
+    metrics_.stochastic_defect_density = 0.1; // defects/cm² (typical)
+    metrics_.throughput = 150.0; // wafers/hour (typical EUV)
 }
 
 // Factory functions
@@ -3,6 +3,12 @@
 #define EUV_LITHOGRAPHY_HPP
 
 #include "../core/wafer.hpp"
+#include "../photolithography/hopkins_imaging.hpp"
+#include "../photolithography/model_opc.hpp"
+#include "../../core/edge_map.hpp"
+#include "../../core/philox.hpp"
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <complex>
@@ -29,11 +35,70 @@ public:
     void enableStochasticEffects(bool enable);
     void setResistParameters(double thickness, double sensitivity, const std::string& type);
     void enableOPCCorrection(bool enable);
+    // Develop the resist: the wafer gets the bit-packed mask of where the
+    // response passes half its saturation rather than the response itself
+    void enableResistDevelopment(bool enable);
+    // Aerial images go through this engine; share one to share its kernel cache
+    void setHopkinsImaging(std::shared_ptr<HopkinsImaging> imaging);
+    // Correct the mask against the imaging model before exposing it; null
+    // turns it off. Give it the absorber exposure uses, sqrt(0.05); its
+    // threshold is on the raw image, where exposure normalizes to the peak.
+    void setModelBasedOPC(std::shared_ptr<ModelBasedOpc> opc);
     
     // EUV-specific calculations
     double calculateResolution(double numerical_aperture) const;
     double calculateDepthOfFocus(double numerical_aperture) const;
+    // Photon shot noise on an aerial image. Each call draws the next
+    // realization; realization r of a seed is the same on any thread count.
     Eigen::ArrayXXd simulateStochasticEffects(const Eigen::ArrayXXd& aerial_image) const;
+    Eigen::ArrayXXd simulateStochasticEffects(const Eigen::ArrayXXd& aerial_image, std::uint64_t realization) const;
+    void setStochasticSeed(std::uint64_t seed);
+
+    // Spread of the printed pattern over many noise realizations, widths in
+    // grid cells. Lines are measured along each row: LWR is the 3 sigma of
+    // a realization's row widths, LCDU the 3 sigma of its mean width.
+    struct StochasticStatistics {
+        int realizations = 0;
+        double mean_width = 0.0;
+        double line_width_roughness = 0.0;     // Mean over realizations
+        double local_cd_uniformity = 0.0;
+        double defect_probability = 0.0;       // Realizations printing any cell unlike the noise-free print
+        double flipped_cell_fraction = 0.0;    // Cells unlike the noise-free print, mean over realizations
+    };
+    // Realizations run in parallel and keep only their measurements, so
+    // thousands of them take no more memory than a few images
+    StochasticStatistics simulateStochasticRealizations(const Eigen::ArrayXXd& aerial_image, double dose,
+                                                        int realizations) const;
+
+    // Focus-exposure matrix of the noise-free print. CD is the mean width,
+    // in grid cells, of the lines crossing the mask's middle row, their
+    // edges interpolated where the image crosses the dose's threshold; a
+    // point is in spec within cd_tolerance (a fraction) of target_cd.
+    struct ProcessWindowPoint {
+        double focus = 0.0;                // nm
+        double dose = 0.0;                 // mJ/cm²
+        double critical_dimension = 0.0;   // 0 where no line prints
+        bool in_spec = false;
+    };
+    struct ProcessWindow {
+        std::vector<ProcessWindowPoint> points;    // Focus-major: point f * doses + d
+        // Widest run of sampled doses in spec at each focus, as a percentage
+        // of its middle dose, and widest run of sampled focus values in spec
+        // at each dose, in nm
+        std::vector<double> exposure_latitude;
+        std::vector<double> depth_of_focus;
+        double best_focus = 0.0;             // Of the widest latitude
+        double best_dose = 0.0;              // Of the deepest focus
+        int aerial_images = 0;               // Computed; one per focus value
+    };
+    // Imaging is the only focus-dependent step and the threshold the only
+    // dose-dependent one, so each focus value costs one image, read at
+    // every dose. The mask is corrected once, at best focus, when
+    // model-based OPC is on.
+    ProcessWindow simulateProcessWindow(const std::vector<std::vector<int>>& mask_pattern,
+                                        const std::vector<double>& focus, const std::vector<double>& dose,
+                                        double target_cd, double cd_tolerance = 0.1,
+                                        double numerical_aperture = 0.33) const;
     
     // Performance metrics
     struct EUVMetrics {
@@ -56,6 +121,7 @@ private:
     int exposure_count_;
     bool stochastic_effects_enabled_;
     bool opc_correction_enabled_;
+    bool resist_development_enabled_;
     
     // Resist parameters
     double resist_thickness_;
@@ -65,10 +131,24 @@ private:
     // Performance tracking
     mutable EUVMetrics metrics_;
     
+    std::shared_ptr<HopkinsImaging> imaging_;
+    std::shared_ptr<ModelBasedOpc> model_opc_;
+
+    std::uint64_t stochastic_seed_;
+    mutable std::atomic<std::uint64_t> next_realization_{0};
+    
     // Advanced simulation methods
+    HopkinsImaging::Optics euvOptics(double na, double defocus) const;
+    std::vector<std::vector<int>> applyModelBasedOPC(const std::vector<std::vector<int>>& mask, double na,
+                                                     double defocus) const;
     Eigen::ArrayXXd calculateEUVAerialImage(const std::vector<std::vector<int>>& mask,
                                            double na, double defocus, int rows, int cols) const;
-    Eigen::ArrayXXd simulateResistResponse(const Eigen::ArrayXXd& aerial_image, double dose) const;
+    // Shot noise, when enabled, and the resist response in one pass
+    Eigen::ArrayXXd simulateResistResponse(const Eigen::ArrayXXd& aerial_image, double dose,
+                                           std::uint64_t realization) const;
+    // The same through to the developed threshold, written straight into
+    // the mask with no full-grid intermediate
+    BitMask developResist(const Eigen::ArrayXXd& aerial_image, double dose, std::uint64_t realization) const;
     Eigen::ArrayXXd applyOPCCorrection(const Eigen::ArrayXXd& pattern) const;
     Eigen::ArrayXXd simulateMultipleExposure(const std::vector<std::vector<int>>& mask,
                                            double na, double dose, int rows, int cols) const;
@@ -80,11 +160,17 @@ private:
     
     // Stochastic modeling
     double calculatePhotonShotNoise(double dose, double area) const;
-    double calculateLineEdgeRoughness(const Eigen::ArrayXXd& pattern) const;
-    double calculateCriticalDimensionUniformity(const Eigen::ArrayXXd& pattern) const;
+    // Photons a pixel receives per unit of aerial intensity
+    double photonsPerIntensity() const;
+    // The response of a fully exposed resist, set by its absorption
+    double resistSaturation() const;
     
-    // Performance optimization
+    // Performance optimization. LER and CDU come from one edge extraction
+    // of the print: its contour at half the resist's saturation, or the
+    // developed mask's outline.
     void updateMetrics(const Eigen::ArrayXXd& final_pattern) const;
+    void updateMetrics(const BitMask& developed) const;
+    void updateMetrics(const EdgeMap& edges) const;
 };
 
 // Factory functions for different EUV systems
@@ -1,5 +1,6 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "advanced_visualization_model.hpp"
+#include "../../core/iso_mesh.hpp"
 #include "../../core/utils.hpp"
 #include <algorithm>
 #include <cmath>
@@ -7,6 +8,13 @@
 #include <stdexcept>
 #include <chrono>
 
+namespace {
+
+// Keyframes read ahead of the animation time
+constexpr size_t kPrefetchKeyframes = 8;
+
+} // namespace
+
 AdvancedVisualizationModel::AdvancedVisualizationModel() 
     : frame_rate_(60.0f), triangle_count_(0), render_time_(0.0f), memory_usage_(0),
       volumetric_enabled_(false), particle_system_enabled_(false),
@@ -28,7 +36,7 @@ AdvancedVisualizationModel::AdvancedVisualizationModel()
     }
     
     initializeResources();
-    Logger::getInstance().log("Advanced visualization model initialized");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Advanced visualization model initialized");
 }
 
 void AdvancedVisualizationModel::setRenderingMode(RenderingMode mode) {
@@ -63,19 +71,17 @@ void AdvancedVisualizationModel::setRenderingMode(RenderingMode mode) {
             break;
     }
     
-    Logger::getInstance().log("Rendering mode set to " + std::to_string(static_cast<int>(mode)));
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Rendering mode set to {}", static_cast<int>(mode));
 }
 
 void AdvancedVisualizationModel::setCameraPosition(float x, float y, float z) {
     camera_params_.position = {x, y, z};
-    Logger::getInstance().log("Camera position set to (" + std::to_string(x) + 
-                             ", " + std::to_string(y) + ", " + std::to_string(z) + ")");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Camera position set to ({}, {}, {})", x, y, z);
 }
 
 void AdvancedVisualizationModel::setCameraTarget(float x, float y, float z) {
     camera_params_.target = {x, y, z};
-    Logger::getInstance().log("Camera target set to (" + std::to_string(x) + 
-                             ", " + std::to_string(y) + ", " + std::to_string(z) + ")");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Camera target set to ({}, {}, {})", x, y, z);
 }
 
 void AdvancedVisualizationModel::orbitCamera(float theta, float phi, float radius) {
@@ -92,32 +98,90 @@ void AdvancedVisualizationModel::addLight(const std::array<float, 3>& position,
     lighting_params_.light_colors.push_back(color);
     lighting_params_.light_intensities.push_back(intensity);
     
-    Logger::getInstance().log("Light added at (" + std::to_string(position[0]) + 
-                             ", " + std::to_string(position[1]) + 
-                             ", " + std::to_string(position[2]) + ")");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Light added at ({}, {}, {})", position[0], position[1], position[2]);
 }
 
 void AdvancedVisualizationModel::enableLayer(VisualizationLayer layer, bool enabled) {
     layer_visibility_[layer] = enabled;
-    Logger::getInstance().log("Layer " + std::to_string(static_cast<int>(layer)) + 
-                             (enabled ? " enabled" : " disabled"));
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Layer {}{}", static_cast<int>(layer), (enabled ? " enabled" : " disabled"));
 }
 
 void AdvancedVisualizationModel::setLayerTransparency(VisualizationLayer layer, float transparency) {
     layer_transparency_[layer] = std::clamp(transparency, 0.0f, 1.0f);
-    Logger::getInstance().log("Layer " + std::to_string(static_cast<int>(layer)) + 
-                             " transparency set to " + std::to_string(transparency));
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Layer {} transparency set to {}", static_cast<int>(layer), transparency);
 }
 
 void AdvancedVisualizationModel::startAnimation() {
     animation_params_.current_time = 0.0f;
-    Logger::getInstance().log("Animation started");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Animation started");
 }
 
 void AdvancedVisualizationModel::setAnimationTime(float time) {
     animation_params_.current_time = std::clamp(time, 0.0f, animation_params_.duration);
 }
 
+void AdvancedVisualizationModel::addKeyframe(float time) {
+    auto& keyframes = animation_params_.keyframes;
+    keyframes.insert(std::upper_bound(keyframes.begin(), keyframes.end(), time), time);
+}
+
+void AdvancedVisualizationModel::beginKeyframes(const std::string& path) {
+    keyframe_writer_ = std::make_unique<KeyframeWriter>(path);
+    animation_params_.keyframes.clear();
+}
+
+void AdvancedVisualizationModel::addKeyframe(const Wafer& wafer, float time, const std::string& description) {
+    if (!keyframe_writer_) {
+        throw std::logic_error("No keyframe file begun");
+    }
+    keyframe_writer_->append(wafer, time, description);
+    addKeyframe(time);
+}
+
+void AdvancedVisualizationModel::finishKeyframes() {
+    if (!keyframe_writer_) {
+        throw std::logic_error("No keyframe file begun");
+    }
+    keyframe_writer_->finish();
+    keyframe_writer_.reset();
+}
+
+void AdvancedVisualizationModel::openKeyframes(const std::string& path) {
+    keyframes_ = std::make_unique<KeyframeReader>(path);
+    animation_params_.keyframes.clear();
+    for (size_t i = 0; i < keyframes_->size(); ++i) {
+        animation_params_.keyframes.push_back(static_cast<float>(keyframes_->time(i)));
+    }
+    if (!animation_params_.keyframes.empty() && animation_params_.keyframes.back() > 0.0f) {
+        animation_params_.duration = animation_params_.keyframes.back();
+    }
+    keyframe_cursor_ = 0;
+    prefetched_to_ = 0;
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Opened {} keyframes from {}", keyframes_->size(), path);
+}
+
+void AdvancedVisualizationModel::sampleKeyframes(const std::string& channel, Eigen::ArrayXXd& out) const {
+    if (!keyframes_ || keyframes_->size() == 0) {
+        throw std::logic_error("No keyframes open");
+    }
+    keyframes_->sample(animation_params_.current_time, channel, out);
+}
+
+void AdvancedVisualizationModel::enableVolumetricRendering(bool enabled) {
+    volumetric_enabled_ = enabled;
+}
+
+void AdvancedVisualizationModel::setVolumetricDensity(float density) {
+    if (!(density >= 0.0f)) {
+        throw std::invalid_argument("Volumetric density must not be negative");
+    }
+    volumetric_density_ = density;
+}
+
+void AdvancedVisualizationModel::setVolumetricScattering(float scattering) {
+    volumetric_scattering_ = std::clamp(scattering, 0.0f, 1.0f);
+}
+
 void AdvancedVisualizationModel::renderTemperatureField(std::shared_ptr<Wafer> wafer) {
     if (!wafer) {
         throw std::invalid_argument("Wafer pointer is null");
@@ -132,9 +196,7 @@ void AdvancedVisualizationModel::renderTemperatureField(std::shared_ptr<Wafer> w
     float min_temp = temperature.minCoeff();
     float max_temp = temperature.maxCoeff();
     
-    Logger::getInstance().log("Rendering temperature field: " + 
-                             std::to_string(min_temp) + "K to " + 
-                             std::to_string(max_temp) + "K");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Rendering temperature field: {}K to {}K", min_temp, max_temp);
 }
 
 void AdvancedVisualizationModel::renderDopantDistribution(std::shared_ptr<Wafer> wafer) {
@@ -147,7 +209,7 @@ void AdvancedVisualizationModel::renderDopantDistribution(std::shared_ptr<Wafer>
     // Enable volumetric rendering for dopant visualization
     volumetric_enabled_ = true;
     
-    Logger::getInstance().log("Rendering dopant distribution");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Rendering dopant distribution");
 }
 
 void AdvancedVisualizationModel::measureDistance(const std::array<float, 3>& point1,
@@ -157,14 +219,13 @@ void AdvancedVisualizationModel::measureDistance(const std::array<float, 3>& poi
     float dz = point2[2] - point1[2];
     float distance = std::sqrt(dx*dx + dy*dy + dz*dz);
     
-    Logger::getInstance().log("Distance measured: " + std::to_string(distance) + " units");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Distance measured: {} units", distance);
 }
 
 // Removed duplicate methods - using interface versions below
 
 void AdvancedVisualizationModel::initializeRenderer(int window_width, int window_height, const std::string& title) {
-    Logger::getInstance().log("Initializing renderer: " + title + " (" +
-                             std::to_string(window_width) + "x" + std::to_string(window_height) + ")");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Initializing renderer: {} ({}x{})", title, window_width, window_height);
     initializeResources();
 }
 
@@ -212,7 +273,7 @@ void AdvancedVisualizationModel::renderWafer(std::shared_ptr<Wafer> wafer, const
     
     frame_rate_ = 1000.0f / render_time_; // FPS
     
-    Logger::getInstance().log("Rendered frame in " + std::to_string(render_time_) + " ms");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Rendered frame in {} ms", render_time_);
 }
 
 void AdvancedVisualizationModel::renderLayer(std::shared_ptr<Wafer> wafer, VisualizationLayer layer) {
@@ -236,6 +297,21 @@ void AdvancedVisualizationModel::updateAnimation(float delta_time) {
             animation_params_.current_time = animation_params_.duration;
         }
     }
+    
+    // Keep the next few keyframes paged in ahead of the cursor
+    if (keyframes_ && keyframes_->size() > 0) {
+        const size_t frame = keyframes_->frameAt(animation_params_.current_time);
+        if (frame < keyframe_cursor_) {
+            prefetched_to_ = 0; // Looped
+        }
+        keyframe_cursor_ = frame;
+        const size_t begin = std::max(prefetched_to_, frame);
+        const size_t end = std::min(keyframes_->size(), frame + 1 + kPrefetchKeyframes);
+        if (begin < end) {
+            keyframes_->prefetch(begin, end - begin);
+            prefetched_to_ = end;
+        }
+    }
 }
 
 void AdvancedVisualizationModel::generateMesh(std::shared_ptr<Wafer> wafer, VisualizationLayer layer) {
@@ -283,7 +359,7 @@ void AdvancedVisualizationModel::applyMaterialProperties(VisualizationLayer laye
 
 void AdvancedVisualizationModel::initializeResources() {
     // Initialize Vulkan resources, shaders, etc.
-    Logger::getInstance().log("Initializing visualization resources");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Initializing visualization resources");
 }
 
 void AdvancedVisualizationModel::renderParticles() {
@@ -304,28 +380,53 @@ void AdvancedVisualizationModel::updateLOD(const CameraParameters& camera) {
 
 // Implement remaining interface methods
 void AdvancedVisualizationModel::renderCrossSection(std::shared_ptr<Wafer> wafer, double x, double y, const std::string& direction, const VisualizationParams& params) {
-    Logger::getInstance().log("Rendering cross section at (" + std::to_string(x) + ", " + std::to_string(y) + ")");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Rendering cross section at ({}, {})", x, y);
 }
 
 void AdvancedVisualizationModel::renderLayerStack(std::shared_ptr<Wafer> wafer, const VisualizationParams& params) {
-    Logger::getInstance().log("Rendering layer stack");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Rendering layer stack");
 }
 
 void AdvancedVisualizationModel::renderVolumetric(std::shared_ptr<Wafer> wafer, const std::string& property_name, const VisualizationParams& params) {
-    Logger::getInstance().log("Rendering volumetric: " + property_name);
+    if (!wafer) {
+        throw std::invalid_argument("Wafer pointer is null");
+    }
+    if (property_name == "dopant") {
+        // The depth profile under every opening in the photoresist, down
+        // as many slices as the grid's longer side
+        const Wafer& source = *wafer;
+        ConstFieldView resist = source.getPhotoresistPattern();
+        const Eigen::ArrayXXd open = (resist < 0.5).cast<double>();
+        const int slices = static_cast<int>(std::min<Eigen::Index>(512, std::max(resist.rows(), resist.cols())));
+        volume_ = FieldVolume::fromProfile(open, source.getDopantMesh(), source.getDopantMeshProfile(), slices);
+    } else if (property_name == "temperature") {
+        // A single plane; stacks from LayeredHeatSolver go through
+        // FieldVolume::fromPlanes
+        volume_ = FieldVolume::fromPlanes({Eigen::ArrayXXd(wafer->getTemperatureProfile())});
+    } else {
+        throw std::invalid_argument("No volume for property " + property_name);
+    }
+    const std::pair<float, float> range = volume_.range();
+    transfer_function_ = TransferFunction::heat(range.first, range.second > range.first ? range.second : range.first + 1.0f);
+    volumetric_enabled_ = true;
+
+    const std::vector<uint8_t> occupied = BrickMap(volume_).occupancy(transfer_function_);
+    const size_t drawn = static_cast<size_t>(std::count(occupied.begin(), occupied.end(), 1));
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Rendering volumetric: {} ({}x{}x{}, {} of {} bricks drawn)", property_name,
+                 volume_.rows(), volume_.cols(), volume_.slices(), drawn, occupied.size());
 }
 
 void AdvancedVisualizationModel::renderParticleSystem(const std::vector<std::vector<double>>& particles, const VisualizationParams& params) {
-    Logger::getInstance().log("Rendering particle system with " + std::to_string(particles.size()) + " particles");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Rendering particle system with {} particles", particles.size());
 }
 
 void AdvancedVisualizationModel::renderFieldVisualization(std::shared_ptr<Wafer> wafer, const std::string& field_type, const VisualizationParams& params) {
-    Logger::getInstance().log("Rendering field visualization: " + field_type);
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Rendering field visualization: {}", field_type);
 }
 
 // Interactive features
 void AdvancedVisualizationModel::enableInteractiveMode(bool enable) {
-    Logger::getInstance().log("Interactive mode " + std::string(enable ? "enabled" : "disabled"));
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Interactive mode {}", enable ? "enabled" : "disabled");
 }
 
 void AdvancedVisualizationModel::setCamera(const std::vector<double>& position, const std::vector<double>& target) {
@@ -338,35 +439,49 @@ void AdvancedVisualizationModel::setCamera(const std::vector<double>& position,
 }
 
 void AdvancedVisualizationModel::zoomToFit(std::shared_ptr<Wafer> wafer) {
-    Logger::getInstance().log("Zooming to fit wafer");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Zooming to fit wafer");
 }
 
 void AdvancedVisualizationModel::highlightRegion(double x1, double y1, double x2, double y2) {
-    Logger::getInstance().log("Highlighting region (" + std::to_string(x1) + "," + std::to_string(y1) +
-                             ") to (" + std::to_string(x2) + "," + std::to_string(y2) + ")");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Highlighting region ({},{}) to ({},{})", x1, y1, x2, y2);
 }
 
 // Stub implementations for remaining interface methods
-void AdvancedVisualizationModel::createAnimation(const std::vector<AnimationFrame>& frames, const std::string& output_file) {}
+void AdvancedVisualizationModel::createAnimation(const std::vector<AnimationFrame>& frames, const std::string& output_file) {
+    beginKeyframes(output_file);
+    for (const auto& frame : frames) {
+        if (frame.wafer_state) {
+            addKeyframe(*frame.wafer_state, static_cast<float>(frame.timestamp), frame.description);
+        }
+    }
+    finishKeyframes();
+    openKeyframes(output_file);
+}
 void AdvancedVisualizationModel::playAnimation(const std::vector<AnimationFrame>& frames, double frame_rate) {}
 void AdvancedVisualizationModel::renderProcessFlow(const std::vector<std::shared_ptr<Wafer>>& process_steps, const std::vector<std::string>& step_names) {}
 void AdvancedVisualizationModel::addDataOverlay(const std::string& overlay_name, const std::vector<std::vector<double>>& data, const VisualizationParams& params) {}
 void AdvancedVisualizationModel::removeDataOverlay(const std::string& overlay_name) {}
 void AdvancedVisualizationModel::updateDataOverlay(const std::string& overlay_name, const std::vector<std::vector<double>>& new_data) {}
 void AdvancedVisualizationModel::exportImage(const std::string& filename, int width, int height, const std::string& format) {
-    Logger::getInstance().log("Exporting image: " + filename + " (" +
-                             std::to_string(width) + "x" + std::to_string(height) + ", " + format + ")");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Exporting image: {} ({}x{}, {})", filename, width, height, format);
 }
 
 void AdvancedVisualizationModel::exportVideo(const std::vector<AnimationFrame>& frames, const std::string& filename, int width, int height, double frame_rate) {
-    Logger::getInstance().log("Exporting video: " + filename + " with " + std::to_string(frames.size()) + " frames");
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Exporting video: {} with {} frames", filename, frames.size());
 }
 
 void AdvancedVisualizationModel::exportSTL(std::shared_ptr<Wafer> wafer, const std::string& filename) {
     if (!wafer) {
         throw std::invalid_argument("Wafer pointer is null");
     }
-    Logger::getInstance().log("Exporting STL: " + filename);
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Exporting STL: {}", filename);
+    const Wafer& source = *wafer;
+    const ConstFieldView grid = source.getGrid();
+    const std::unique_ptr<MeshSink> sink = openMeshWriter(filename);
+    const IsoMesher::Stats stats =
+        meshHeightField(grid, static_cast<float>(source.getDiameter() / grid.rows()),
+                        static_cast<float>(source.getDiameter() / grid.cols()), *sink);
+    SEMIPRO_LOGF(INFO, USER_INTERFACE, "Wrote {} triangles over {} vertices", stats.triangles, stats.vertices);
 }
 double AdvancedVisualizationModel::measureDistance(const std::vector<double>& point1, const std::vector<double>& point2) { return 0.0; }
 double AdvancedVisualizationModel::measureArea(const std::vector<std::vector<double>>& polygon) { return 0.0; }
@@ -4,6 +4,8 @@
 
 #include "advanced_visualization_interface.hpp"
 #include "../../core/wafer.hpp"
+#include "../../core/field_volume.hpp"
+#include "../../core/keyframe_store.hpp"
 #include <memory>
 #include <vector>
 #include <string>
@@ -119,12 +121,31 @@ public:
     void stopAnimation();
     void pauseAnimation();
     void setAnimationTime(float time);
+    // Marks a keyframe time on the timeline
     void addKeyframe(float time);
+    // Wafer keyframes stream to the file begun by beginKeyframes as they
+    // are added and play back from it mapped (see KeyframeWriter), so only
+    // the frames around the animation time are in memory.
+    // finishKeyframes completes the file; openKeyframes maps one for
+    // playback.
+    void beginKeyframes(const std::string& path);
+    void addKeyframe(const Wafer& wafer, float time, const std::string& description = "");
+    void finishKeyframes();
+    void openKeyframes(const std::string& path);
+    const KeyframeReader* getKeyframes() const { return keyframes_.get(); }
+    // `channel` at the animation time, blended between the keyframes
+    // around it; throws std::logic_error with no keyframes open
+    void sampleKeyframes(const std::string& channel, Eigen::ArrayXXd& out) const;
     
     // Volumetric rendering
     void enableVolumetricRendering(bool enabled);
     void setVolumetricDensity(float density);
     void setVolumetricScattering(float scattering);
+    // Volume built by the last renderVolumetric() call, with its transfer
+    // function, for VulkanRenderer::setVolume
+    const FieldVolume& getVolume() const { return volume_; }
+    const TransferFunction& getTransferFunction() const { return transfer_function_; }
+    float getVolumetricDensity() const { return volumetric_density_; }
     void renderTemperatureField(std::shared_ptr<Wafer> wafer);
     void renderDopantDistribution(std::shared_ptr<Wafer> wafer);
     void renderStressField(std::shared_ptr<Wafer> wafer);
@@ -240,6 +261,10 @@ private:
     CameraParameters camera_params_;
     LightingParameters lighting_params_;
     AnimationParameters animation_params_;
+    std::unique_ptr<KeyframeWriter> keyframe_writer_;
+    std::unique_ptr<KeyframeReader> keyframes_;
+    size_t keyframe_cursor_ = 0;
+    size_t prefetched_to_ = 0;                 // Keyframes before this were prefetched
     
     std::unordered_map<VisualizationLayer, bool> layer_visibility_;
     std::unordered_map<VisualizationLayer, float> layer_transparency_;
@@ -252,6 +277,10 @@ private:
     
     // Rendering state
     bool volumetric_enabled_;
+    float volumetric_density_ = 1.0f;
+    float volumetric_scattering_ = 0.0f;
+    FieldVolume volume_;
+    TransferFunction transfer_function_ = TransferFunction::heat(0.0f, 1.0f);
     bool particle_system_enabled_;
     bool measurement_tools_enabled_;
     bool adaptive_lod_enabled_;
@@ -2,6 +2,7 @@
 #define DEFECT_INSPECTION_INTERFACE_HPP
 
 #include "../../core/wafer.hpp"
+#include "../../core/performance_utils.hpp"
 #include <memory>
 #include <vector>
 #include <string>
@@ -51,7 +52,9 @@ public:
         double size;     // Characteristic size (μm)
         double confidence; // Detection confidence (0-1)
         std::string description;
-        std::unordered_map<std::string, double> properties;
+        // Per-defect map nodes come from the small-object pool
+        std::unordered_map<std::string, double, std::hash<std::string>, std::equal_to<std::string>,
+                           SemiPRO::PoolAllocator<std::pair<const std::string, double>>> properties;
         
         Defect(DefectType t, DefectSeverity s, double px, double py, double pz, double sz)
             : type(t), severity(s), x(px), y(py), z(pz), size(sz), confidence(1.0) {}
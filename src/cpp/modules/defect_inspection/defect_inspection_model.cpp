@@ -1,10 +1,23 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "defect_inspection_model.hpp"
+#include "../../core/reproducibility.hpp"
+#include "../../core/task_scheduler.hpp"
 #include <algorithm>
 #include <cmath>
 #include <chrono>
+#include <stdexcept>
 
-DefectInspectionModel::DefectInspectionModel() : rng_(std::random_device{}()) {
+namespace {
+
+// By InspectionMethod
+const char* const kInspectionMethodNames[] = {
+    "optical_brightfield", "optical_darkfield", "laser_scattering", "electron_beam",
+    "atomic_force_microscopy", "scanning_tunneling_microscopy", "x_ray_topography",
+};
+
+} // namespace
+
+DefectInspectionModel::DefectInspectionModel() : rng_(Reproducibility::key("defect_inspection")) {
     // Initialize default inspection parameters
     InspectionParameters default_params;
     default_params.pixel_size = 0.1;  // μm
@@ -33,7 +46,7 @@ DefectInspectionModel::DefectInspectionModel() : rng_(std::random_device{}()) {
     defect_distribution_.size_std_dev = 0.2;
     defect_distribution_.distribution_type = "lognormal";
     
-    Logger::getInstance().log("DefectInspectionModel initialized");
+    SEMIPRO_LOGF(INFO, VALIDATION, "DefectInspectionModel initialized");
 }
 
 DefectInspectionModel::InspectionResult DefectInspectionModel::performInspection(
@@ -44,6 +57,23 @@ DefectInspectionModel::InspectionResult DefectInspectionModel::performInspection
     InspectionResult result(method);
     auto start_time = std::chrono::high_resolution_clock::now();
     
+    if (die_inspector_) {
+        result.defects = performImageInspection(wafer, method);
+        const DieLayout& layout = image_settings_.layout;
+        const double pixel_size = inspection_params_[method].pixel_size;
+        result.coverage_area = static_cast<double>(layout.dies()) * layout.die_rows * layout.die_cols *
+                               pixel_size * pixel_size;
+        result.inspection_time =
+            std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+        for (const auto& stat : generateDefectStatistics(result.defects)) {
+            result.statistics[stat.first] = static_cast<double>(stat.second);
+        }
+        SEMIPRO_LOGF(INFO, VALIDATION, "Image inspection of {} dies: {} defects found in {}s", layout.dies(),
+                     result.defects.size(), result.inspection_time);
+        recordInspection(result);
+        return result;
+    }
+    
     // Calculate total inspection area
     double total_area = 0.0;
     for (const auto& area : inspection_areas) {
@@ -58,12 +88,13 @@ DefectInspectionModel::InspectionResult DefectInspectionModel::performInspection
         total_area, expected_density, allowed_types);
     
     // Apply detection probability based on method
-    for (const auto& defect : candidate_defects) {
+    result.defects.reserve(candidate_defects.size());
+    for (auto& defect : candidate_defects) {
         double detection_prob = calculateDetectionProbability(method, defect);
         std::uniform_real_distribution<double> prob_dist(0.0, 1.0);
         
         if (prob_dist(rng_) < detection_prob) {
-            result.defects.push_back(defect);
+            result.defects.push_back(std::move(defect));
         }
     }
     
@@ -77,12 +108,70 @@ DefectInspectionModel::InspectionResult DefectInspectionModel::performInspection
         result.statistics[stat.first] = static_cast<double>(stat.second);
     }
     
-    Logger::getInstance().log("Inspection completed: " + std::to_string(result.defects.size()) + 
-                            " defects found in " + std::to_string(result.inspection_time) + "s");
+    SEMIPRO_LOGF(INFO, VALIDATION, "Inspection completed: {} defects found in {}s",
+                 result.defects.size(), result.inspection_time);
     
+    recordInspection(result);
     return result;
 }
 
+void DefectInspectionModel::recordInspection(const InspectionResult& result) const {
+    if (!result_store_) {
+        return;
+    }
+    ResultRecord record("inspection", kInspectionMethodNames[result.method], true, result.inspection_time);
+    record.add("inspection", "defects", static_cast<double>(result.defects.size()));
+    record.add("inspection", "coverage_area", result.coverage_area);
+    record.addAll("statistic", result.statistics);
+    result_store_->append(record);
+}
+
+void DefectInspectionModel::setImageInspection(const ImageInspectionSettings& settings) {
+    die_inspector_ = std::make_unique<DieInspector>(settings);
+    image_settings_ = settings;
+}
+
+void DefectInspectionModel::setReferenceDie(const Eigen::ArrayXXd& reference) {
+    reference_die_ = reference;
+}
+
+void DefectInspectionModel::clearImageInspection() {
+    die_inspector_.reset();
+    reference_die_.resize(0, 0);
+}
+
+std::vector<DefectInspectionModel::Defect> DefectInspectionModel::performImageInspection(
+    std::shared_ptr<Wafer> wafer,
+    InspectionMethod method) {
+    
+    if (!die_inspector_) {
+        throw std::logic_error("No image inspection set");
+    }
+    const Eigen::ArrayXXd image = die_inspector_->render(*wafer);
+    const bool to_database = reference_die_.size() > 0;
+    const std::vector<ImageDefect> found =
+        to_database ? die_inspector_->dieToDatabase(image, reference_die_) : die_inspector_->dieToDie(image);
+    
+    // A difference twice the threshold is taken as certain
+    const double pixel_size = inspection_params_[method].pixel_size;
+    std::vector<Defect> defects;
+    defects.reserve(found.size());
+    for (const ImageDefect& spot : found) {
+        const auto position = gridToPhysicalCoordinates(wafer, static_cast<int>(std::lround(spot.row)),
+                                                        static_cast<int>(std::lround(spot.col)));
+        Defect defect(PATTERN_DEFECT, MINOR, position.first, position.second, 0.0,
+                      std::sqrt(static_cast<double>(spot.pixels)) * pixel_size);
+        defect.severity = classifyDefect(defect);
+        defect.confidence = std::min(1.0, std::abs(spot.peak) / (2.0 * image_settings_.threshold));
+        defect.description = to_database ? "Die-to-database difference" : "Die-to-die difference";
+        defect.properties["die"] = spot.die;
+        defect.properties["pixels"] = spot.pixels;
+        defect.properties["peak_difference"] = spot.peak;
+        defects.push_back(std::move(defect));
+    }
+    return defects;
+}
+
 std::vector<DefectInspectionModel::Defect> DefectInspectionModel::detectParticles(
     std::shared_ptr<Wafer> wafer,
     double min_size,
@@ -95,6 +184,7 @@ std::vector<DefectInspectionModel::Defect> DefectInspectionModel::detectParticle
     double particle_density = 0.05;  // particles per mm²
     
     int num_particles = static_cast<int>(wafer_area * particle_density);
+    particles.reserve(num_particles);
     
     for (int i = 0; i < num_particles; ++i) {
         auto position = generateDefectPosition(wafer->getDiameter());
@@ -104,7 +194,7 @@ std::vector<DefectInspectionModel::Defect> DefectInspectionModel::detectParticle
             Defect particle(PARTICLE, MINOR, position.first, position.second, 0.0, size);
             particle.confidence = 0.9;
             particle.description = "Particle detected";
-            particles.push_back(particle);
+            particles.push_back(std::move(particle));
         }
     }
     
@@ -133,7 +223,7 @@ std::vector<DefectInspectionModel::Defect> DefectInspectionModel::detectPatternD
                                 physical_coords.first, physical_coords.second, 0.0, 0.1);
                     defect.confidence = 0.8;
                     defect.description = "Pattern irregularity";
-                    pattern_defects.push_back(defect);
+                    pattern_defects.push_back(std::move(defect));
                 }
             }
         }
@@ -161,7 +251,7 @@ std::vector<DefectInspectionModel::Defect> DefectInspectionModel::detectDimensio
                         std::abs(thickness - expected_thickness));
             defect.confidence = 0.95;
             defect.description = "Thickness out of tolerance";
-            dimensional_defects.push_back(defect);
+            dimensional_defects.push_back(std::move(defect));
         }
     }
     
@@ -187,28 +277,51 @@ DefectInspectionModel::DefectSeverity DefectInspectionModel::classifyDefect(cons
 std::unordered_map<std::string, int> DefectInspectionModel::generateDefectStatistics(
     const std::vector<Defect>& defects) {
     
+    return generateDefectStatistics(summarizeDefects(defects));
+}
+
+std::unordered_map<std::string, int> DefectInspectionModel::generateDefectStatistics(
+    const DefectSummary& summary) {
+    
     std::unordered_map<std::string, int> stats;
     
     // Count by type
-    for (const auto& defect : defects) {
-        std::string type_name = defectTypeToString(defect.type);
-        stats[type_name]++;
-        
-        std::string severity_name;
-        switch (defect.severity) {
-            case CRITICAL: severity_name = "critical"; break;
-            case MAJOR: severity_name = "major"; break;
-            case MINOR: severity_name = "minor"; break;
-            case COSMETIC: severity_name = "cosmetic"; break;
-        }
-        stats[severity_name]++;
+    for (int type = PARTICLE; type <= DIMENSIONAL_DEFECT; ++type) {
+        const std::int64_t count = summary.count(static_cast<DefectType>(type));
+        if (count > 0) stats[defectTypeToString(static_cast<DefectType>(type))] = static_cast<int>(count);
+    }
+    const std::pair<DefectSeverity, const char*> severities[] = {
+        {CRITICAL, "critical"}, {MAJOR, "major"}, {MINOR, "minor"}, {COSMETIC, "cosmetic"}};
+    for (const auto& severity : severities) {
+        const std::int64_t count = summary.count(severity.first);
+        if (count > 0) stats[severity.second] = static_cast<int>(count);
     }
     
-    stats["total"] = static_cast<int>(defects.size());
+    stats["total"] = static_cast<int>(summary.total());
     
     return stats;
 }
 
+DefectSummary DefectInspectionModel::summarizeDefects(
+    const std::vector<Defect>& defects,
+    const DefectBinning& binning) const {
+    
+    constexpr int kDefectsPerChunk = 1 << 14;
+    const int chunks = static_cast<int>((defects.size() + kDefectsPerChunk - 1) / kDefectsPerChunk);
+    std::vector<DefectSummary> partial(chunks, DefectSummary(binning));
+    TaskScheduler::getInstance().parallelFor(0, chunks, [&](int begin, int end) {
+        for (int c = begin; c < end; ++c) {
+            const std::size_t last = std::min(defects.size(), static_cast<std::size_t>(c + 1) * kDefectsPerChunk);
+            for (std::size_t d = static_cast<std::size_t>(c) * kDefectsPerChunk; d < last; ++d) {
+                partial[c].add(defects[d]);
+            }
+        }
+    }, 1);
+    DefectSummary summary(binning);
+    for (const auto& part : partial) summary.merge(part);
+    return summary;
+}
+
 double DefectInspectionModel::calculateDefectDensity(
     const std::vector<Defect>& defects,
     double area) {
@@ -221,19 +334,117 @@ double DefectInspectionModel::estimateYieldImpact(
     const std::vector<Defect>& defects,
     double die_area) {
     
-    // Simple Poisson yield model
-    double critical_defect_density = 0.0;
+    // Simple Poisson yield model: the critical defects spread over one die
+    return summarizeDefects(defects).poissonYield(die_area, die_area);
+}
+
+double DefectInspectionModel::calculatePoissonYield(double defect_density, double die_area) {
+    return std::exp(-defect_density * die_area);
+}
+
+double DefectInspectionModel::calculateNegativeBinomialYield(double defect_density, double die_area,
+                                                             double clustering_factor) {
+    if (!(clustering_factor > 0.0) || std::isinf(clustering_factor)) {
+        return calculatePoissonYield(defect_density, die_area);
+    }
+    return std::pow(1.0 + defect_density * die_area / clustering_factor, -clustering_factor);
+}
+
+std::vector<DefectInspectionModel::DefectCluster> DefectInspectionModel::classifySignatures(
+    const std::vector<Defect>& defects,
+    double eps,
+    int min_points,
+    double wafer_radius) {
     
+    std::vector<PointGrid::Point> positions;
+    positions.reserve(defects.size());
     for (const auto& defect : defects) {
-        if (defect.severity == CRITICAL) {
-            critical_defect_density += 1.0;
-        }
+        positions.push_back({defect.x, defect.y});
+    }
+    return classifySignatures(PointGrid(positions, eps), eps, min_points, 0.0, 0.0, wafer_radius);
+}
+
+std::vector<DefectInspectionModel::DefectCluster> DefectInspectionModel::classifySignatures(
+    const PointGrid& grid,
+    double eps,
+    int min_points,
+    double center_x,
+    double center_y,
+    double wafer_radius) {
+    
+    const std::vector<int> labels = grid.cluster(eps, min_points);
+    std::vector<PointGrid::Point> at(grid.size());
+    for (std::size_t p = 0; p < grid.size(); ++p) {
+        at[grid.index()[p]] = grid.points()[p];
+    }
+    std::vector<DefectCluster> clusters;
+    for (std::size_t k = 0; k < labels.size(); ++k) {
+        if (labels[k] < 0) continue;
+        if (static_cast<std::size_t>(labels[k]) >= clusters.size()) clusters.resize(labels[k] + 1);
+        clusters[labels[k]].members.push_back(static_cast<int>(k));
     }
     
-    critical_defect_density /= die_area;
+    for (auto& cluster : clusters) {
+        const double n = static_cast<double>(cluster.members.size());
+        double x = 0.0, y = 0.0;
+        for (int k : cluster.members) {
+            x += at[k].x;
+            y += at[k].y;
+        }
+        x /= n;
+        y /= n;
+        
+        // Principal axes of the spread, and the spread in radius and angle
+        // about the wafer centre
+        double sxx = 0.0, syy = 0.0, sxy = 0.0, r_sum = 0.0, r_sum2 = 0.0;
+        std::vector<double> angles;
+        angles.reserve(cluster.members.size());
+        for (int k : cluster.members) {
+            const double dx = at[k].x - x, dy = at[k].y - y;
+            sxx += dx * dx;
+            syy += dy * dy;
+            sxy += dx * dy;
+            const double r = std::hypot(at[k].x - center_x, at[k].y - center_y);
+            r_sum += r;
+            r_sum2 += r * r;
+            angles.push_back(std::atan2(at[k].y - center_y, at[k].x - center_x));
+        }
+        sxx /= n;
+        syy /= n;
+        sxy /= n;
+        const double half_gap = std::sqrt(0.25 * (sxx - syy) * (sxx - syy) + sxy * sxy);
+        // A uniform stretch of length L has variance L^2 / 12
+        cluster.length = std::sqrt(12.0 * (0.5 * (sxx + syy) + half_gap));
+        cluster.width = std::sqrt(12.0 * std::max(0.5 * (sxx + syy) - half_gap, 0.0));
+        cluster.x = x;
+        cluster.y = y;
+        cluster.radius = std::hypot(x - center_x, y - center_y);
+        const double r_mean = r_sum / n;
+        const double r_spread = std::sqrt(std::max(r_sum2 / n - r_mean * r_mean, 0.0));
+        std::sort(angles.begin(), angles.end());
+        double widest_gap = 2.0 * M_PI - (angles.back() - angles.front());
+        for (std::size_t a = 1; a < angles.size(); ++a) {
+            widest_gap = std::max(widest_gap, angles[a] - angles[a - 1]);
+        }
+        const double turn = 2.0 * M_PI - widest_gap;
+        // Thickness about the wafer centre, as width is across the axis: an
+        // arc hugs its circle closer than any line, a straight scratch not
+        const double thickness = std::sqrt(12.0) * r_spread;
+        
+        if (thickness < cluster.width && turn * r_mean >= 5.0 * std::max(thickness, eps)) {
+            cluster.signature = WaferSignature::RING;
+        } else if (cluster.length >= 5.0 * std::max(cluster.width, eps)) {
+            cluster.signature = WaferSignature::SCRATCH;
+        } else if (r_mean >= 0.85 * wafer_radius) {
+            cluster.signature = WaferSignature::EDGE;
+        } else if (cluster.radius <= 0.15 * wafer_radius) {
+            cluster.signature = WaferSignature::CENTER;
+        } else {
+            cluster.signature = WaferSignature::CLUSTER;
+        }
+    }
     
-    // Poisson yield = exp(-defect_density * die_area)
-    return std::exp(-critical_defect_density * die_area);
+    return clusters;
 }
 
 std::vector<std::pair<double, double>> DefectInspectionModel::identifyKillDefects(
@@ -267,8 +478,7 @@ void DefectInspectionModel::optimizeInspectionParameters(
         params.scan_speed = target_throughput * 10.0;  // Simplified relationship
     }
     
-    Logger::getInstance().log("Optimized inspection parameters for method " + 
-                            std::to_string(static_cast<int>(method)));
+    SEMIPRO_LOGF(INFO, VALIDATION, "Optimized inspection parameters for method {}", static_cast<int>(method));
 }
 
 double DefectInspectionModel::calculateInspectionSensitivity(
@@ -311,6 +521,7 @@ std::vector<DefectInspectionModel::Defect> DefectInspectionModel::generateRandom
     std::vector<Defect> defects;
     
     int num_defects = static_cast<int>(area * defect_density);
+    defects.reserve(std::max(num_defects, 0));
     std::uniform_int_distribution<int> type_dist(0, allowed_types.size() - 1);
     
     for (int i = 0; i < num_defects; ++i) {
@@ -321,7 +532,7 @@ std::vector<DefectInspectionModel::Defect> DefectInspectionModel::generateRandom
         
         Defect defect(type, severity, position.first, position.second, 0.0, size);
         defect.confidence = 0.8 + 0.2 * std::uniform_real_distribution<double>(0.0, 1.0)(rng_);
-        defects.push_back(defect);
+        defects.push_back(std::move(defect));
     }
     
     return defects;
@@ -2,6 +2,10 @@
 #define DEFECT_INSPECTION_MODEL_HPP
 
 #include "defect_inspection_interface.hpp"
+#include "defect_summary.hpp"
+#include "die_inspection.hpp"
+#include "../../core/point_grid.hpp"
+#include "../../core/result_store.hpp"
 #include "../../core/utils.hpp"
 #include <random>
 #include <cmath>
@@ -13,6 +17,9 @@ public:
     ~DefectInspectionModel() override = default;
     
     // Implement interface methods
+    // With an image inspection set, inspects the wafer's dies (see
+    // DieInspector) and inspection_areas is unused; without one, samples
+    // defects over the areas from the expected density
     InspectionResult performInspection(
         std::shared_ptr<Wafer> wafer,
         InspectionMethod method,
@@ -77,6 +84,20 @@ public:
         const std::vector<InspectionMethod>& methods
     );
     
+    // Image-based inspection of the wafer's dies, die to die; die to
+    // database once a reference die image (die_rows x die_cols) is set
+    void setImageInspection(const ImageInspectionSettings& settings);
+    void setReferenceDie(const Eigen::ArrayXXd& reference);
+    void clearImageInspection();
+    std::vector<Defect> performImageInspection(std::shared_ptr<Wafer> wafer, InspectionMethod method);
+    
+    // Each performInspection() then appends a record to the store: source
+    // "inspection", label the method ("optical_brightfield", ...), seconds
+    // the inspection time, with group "inspection" holding the defect
+    // count and coverage area and group "statistic" the statistics. Null
+    // stops recording.
+    void setResultStore(std::shared_ptr<ResultStore> store) { result_store_ = std::move(store); }
+    
     // Real-time inspection simulation
     struct InspectionParameters {
         double pixel_size;        // μm
@@ -114,6 +135,38 @@ public:
     void setDefectDistribution(const DefectDistribution& distribution);
     DefectDistribution getDefectDistribution() const { return defect_distribution_; }
     
+    // One pass over defects, in parallel chunks for long lists; the
+    // statistics and yields below read it
+    DefectSummary summarizeDefects(const std::vector<Defect>& defects,
+                                   const DefectBinning& binning = DefectBinning()) const;
+    std::unordered_map<std::string, int> generateDefectStatistics(const DefectSummary& summary);
+    
+    // Wafer-map signatures: defects clustered by DBSCAN (see PointGrid)
+    // and each cluster classified by its shape and place on the wafer.
+    // Defects in no cluster are the random background.
+    enum class WaferSignature {
+        CLUSTER,  // Compact spot away from the centre and edge
+        SCRATCH,  // Long and thin
+        RING,     // Long arc about the wafer centre
+        EDGE,     // Spot near the wafer edge
+        CENTER    // Spot at the wafer centre
+    };
+    struct DefectCluster {
+        WaferSignature signature;
+        std::vector<int> members; // Indices of the clustered defects
+        double x, y;              // Centroid
+        double length, width;     // Extent along and across the principal axis
+        double radius;            // Centroid's distance from the wafer centre
+    };
+    // Clusters of grid's points, eps apart at most between neighbours and
+    // min_points to a core point, on a wafer of wafer_radius centred at
+    // (center_x, center_y); for WaferEnhanced::getDefectGrid() too
+    std::vector<DefectCluster> classifySignatures(const PointGrid& grid, double eps, int min_points,
+                                                  double center_x, double center_y, double wafer_radius);
+    // Defects positioned about the wafer centre, as generated ones are
+    std::vector<DefectCluster> classifySignatures(const std::vector<Defect>& defects, double eps, int min_points,
+                                                  double wafer_radius);
+    
     // Yield modeling
     double calculatePoissonYield(double defect_density, double die_area);
     double calculateNegativeBinomialYield(double defect_density, double die_area, double clustering_factor);
@@ -146,6 +199,12 @@ private:
     DefectDistribution defect_distribution_;
     ProcessWindow process_window_;
     mutable std::mt19937 rng_;
+    std::unique_ptr<DieInspector> die_inspector_; // Null without an image inspection
+    ImageInspectionSettings image_settings_;
+    Eigen::ArrayXXd reference_die_;               // Empty for die to die
+    std::shared_ptr<ResultStore> result_store_;
+    
+    void recordInspection(const InspectionResult& result) const;
     
     // Detection probability models
     double calculateDetectionProbability(
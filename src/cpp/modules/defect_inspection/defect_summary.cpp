@@ -0,0 +1,90 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "defect_summary.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+DefectSummary::DefectSummary(const DefectBinning& binning) : binning_(binning) {
+    if (!(binning.size_step > 0.0) || !(binning.radius > 0.0) || binning.size_bins < 1 || binning.spatial_bins < 1) {
+        throw std::invalid_argument("Defect summary bins must be positive");
+    }
+    size_histogram_.assign(binning.size_bins, 0);
+    spatial_.assign(static_cast<std::size_t>(binning.spatial_bins) * binning.spatial_bins, 0);
+}
+
+void DefectSummary::add(const Defect& defect) {
+    ++total_;
+    ++by_type_[defect.type];
+    ++by_severity_[defect.severity];
+    size_sum_ += defect.size;
+    size_sum2_ += defect.size * defect.size;
+
+    // Out-of-range values land in the edge bins
+    const auto bin = [](double v, int bins) {
+        return static_cast<int>(std::clamp(std::floor(v), 0.0, static_cast<double>(bins - 1)));
+    };
+    ++size_histogram_[bin(defect.size / binning_.size_step, binning_.size_bins)];
+    const double scale = binning_.spatial_bins / (2.0 * binning_.radius);
+    const int bx = bin((defect.x + binning_.radius) * scale, binning_.spatial_bins);
+    const int by = bin((defect.y + binning_.radius) * scale, binning_.spatial_bins);
+    ++spatial_[static_cast<std::size_t>(bx) * binning_.spatial_bins + by];
+}
+
+void DefectSummary::merge(const DefectSummary& other) {
+    if (other.binning_.size_step != binning_.size_step || other.binning_.size_bins != binning_.size_bins ||
+        other.binning_.radius != binning_.radius || other.binning_.spatial_bins != binning_.spatial_bins) {
+        throw std::invalid_argument("Defect summaries with different binnings cannot merge");
+    }
+    total_ += other.total_;
+    for (int t = 0; t < kTypes; ++t) by_type_[t] += other.by_type_[t];
+    for (int s = 0; s < kSeverities; ++s) by_severity_[s] += other.by_severity_[s];
+    size_sum_ += other.size_sum_;
+    size_sum2_ += other.size_sum2_;
+    for (std::size_t b = 0; b < size_histogram_.size(); ++b) size_histogram_[b] += other.size_histogram_[b];
+    for (std::size_t b = 0; b < spatial_.size(); ++b) spatial_[b] += other.spatial_[b];
+}
+
+double DefectSummary::meanSize() const {
+    return total_ > 0 ? size_sum_ / total_ : 0.0;
+}
+
+double DefectSummary::sizeStdDev() const {
+    if (total_ < 2) return 0.0;
+    const double mean = meanSize();
+    return std::sqrt(std::max(0.0, (size_sum2_ - total_ * mean * mean) / (total_ - 1)));
+}
+
+double DefectSummary::clusteringFactor() const {
+    const int bins = binning_.spatial_bins;
+    const double step = 2.0 * binning_.radius / bins;
+    double n = 0.0, sum = 0.0, sum2 = 0.0;
+    for (int i = 0; i < bins; ++i) {
+        for (int j = 0; j < bins; ++j) {
+            const double x = -binning_.radius + (i + 0.5) * step, y = -binning_.radius + (j + 0.5) * step;
+            if (x * x + y * y > binning_.radius * binning_.radius) continue;
+            const double c = static_cast<double>(spatial_[static_cast<std::size_t>(i) * bins + j]);
+            n += 1.0;
+            sum += c;
+            sum2 += c * c;
+        }
+    }
+    if (n < 2.0 || sum <= 0.0) return std::numeric_limits<double>::infinity();
+    const double mean = sum / n;
+    const double variance = (sum2 - n * mean * mean) / (n - 1.0);
+    return variance > mean ? mean * mean / (variance - mean) : std::numeric_limits<double>::infinity();
+}
+
+double DefectSummary::poissonYield(double die_area, double area) const {
+    if (!(area > 0.0)) return 1.0;
+    const double density = static_cast<double>(by_severity_[DefectInspectionInterface::CRITICAL]) / area;
+    return std::exp(-density * die_area);
+}
+
+double DefectSummary::negativeBinomialYield(double die_area, double area, double alpha) const {
+    if (!(area > 0.0)) return 1.0;
+    if (!(alpha > 0.0)) alpha = clusteringFactor();
+    if (std::isinf(alpha)) return poissonYield(die_area, area);
+    const double density = static_cast<double>(by_severity_[DefectInspectionInterface::CRITICAL]) / area;
+    return std::pow(1.0 + density * die_area / alpha, -alpha);
+}
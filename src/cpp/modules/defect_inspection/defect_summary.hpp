@@ -0,0 +1,69 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef DEFECT_SUMMARY_HPP
+#define DEFECT_SUMMARY_HPP
+
+#include "defect_inspection_interface.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Bins of a DefectSummary; summaries merge only with equal binnings
+struct DefectBinning {
+    double size_step = 0.1; // Width of each size bin (um); the last bin also holds larger
+    int size_bins = 32;
+    double radius = 150.0;  // Spatial bins cover [-radius, radius)^2 in the defects' x, y units
+    int spatial_bins = 16;  // Per side
+};
+
+// Everything the defect statistics and yield models read off a list of
+// defects, gathered in one pass: counts by type and severity, a size
+// histogram, counts on a square grid of spatial bins and the moments
+// those need. Summaries of the same binning merge by adding, so threads
+// and wafers can each summarize their own defects and a lot rollup keeps
+// only the summaries.
+class DefectSummary {
+public:
+    using Defect = DefectInspectionInterface::Defect;
+
+    explicit DefectSummary(const DefectBinning& binning = DefectBinning());
+
+    void add(const Defect& defect);
+    // Throws if other's binning differs
+    void merge(const DefectSummary& other);
+
+    const DefectBinning& binning() const { return binning_; }
+    std::int64_t total() const { return total_; }
+    std::int64_t count(DefectInspectionInterface::DefectType type) const { return by_type_[type]; }
+    std::int64_t count(DefectInspectionInterface::DefectSeverity severity) const { return by_severity_[severity]; }
+    double meanSize() const;
+    double sizeStdDev() const;
+    const std::vector<std::int64_t>& sizeHistogram() const { return size_histogram_; }
+    // Row-major, spatial_bins x spatial_bins, rows along x
+    const std::vector<std::int64_t>& spatialCounts() const { return spatial_; }
+
+    // Negative binomial clustering parameter alpha by the method of
+    // moments over the spatial bins whose centres lie within the radius:
+    // mean^2 / (variance - mean). Infinite (no clustering, Poisson) when
+    // the counts vary no more than Poisson counts would.
+    double clusteringFactor() const;
+    // Yield of a die_area die at density D of critical defects over area:
+    // exp(-D A) and (1 + D A / alpha)^-alpha, alpha the clustering factor
+    // unless given
+    double poissonYield(double die_area, double area) const;
+    double negativeBinomialYield(double die_area, double area, double alpha = 0.0) const;
+
+private:
+    static constexpr int kTypes = DefectInspectionInterface::DIMENSIONAL_DEFECT + 1;
+    static constexpr int kSeverities = DefectInspectionInterface::COSMETIC + 1;
+
+    DefectBinning binning_;
+    std::int64_t total_ = 0;
+    std::array<std::int64_t, kTypes> by_type_{};
+    std::array<std::int64_t, kSeverities> by_severity_{};
+    double size_sum_ = 0.0;
+    double size_sum2_ = 0.0;
+    std::vector<std::int64_t> size_histogram_;
+    std::vector<std::int64_t> spatial_;
+};
+
+#endif // DEFECT_SUMMARY_HPP
@@ -0,0 +1,202 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "die_inspection.hpp"
+#include "../../core/task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+
+DieInspector::DieInspector(const ImageInspectionSettings& settings) : settings_(settings) {
+    if (!(settings.threshold > 0.0)) {
+        throw std::invalid_argument("Inspection threshold must be positive");
+    }
+    if (settings.tile_size < 1 || settings.min_pixels < 1) {
+        throw std::invalid_argument("Inspection tile size and minimum pixels must be positive");
+    }
+}
+
+Eigen::ArrayXXd DieInspector::render(const Wafer& wafer) const {
+    Eigen::ArrayXXd image = settings_.height_gain * wafer.getGrid();
+    const BitMask& resist = wafer.getPhotoresistMask();
+    if (resist.rows() == image.rows() && resist.cols() == image.cols()) {
+        for (const MaskRun& run : resist.runs()) {
+            image.row(run.row).segment(run.col_begin, run.col_end - run.col_begin) += settings_.resist_gain;
+        }
+    }
+    return image;
+}
+
+void DieInspector::checkLayout(const Eigen::ArrayXXd& image) const {
+    const DieLayout& layout = settings_.layout;
+    if (layout.die_rows < 1 || layout.die_cols < 1 || layout.count_rows < 1 || layout.count_cols < 1) {
+        throw std::invalid_argument("Die layout is empty");
+    }
+    if ((layout.count_rows > 1 && layout.pitch_rows < layout.die_rows) ||
+        (layout.count_cols > 1 && layout.pitch_cols < layout.die_cols)) {
+        throw std::invalid_argument("Dies overlap: pitch is smaller than the die");
+    }
+    const int last = layout.dies() - 1;
+    if (layout.origin_row < 0 || layout.origin_col < 0 || layout.firstRow(last) + layout.die_rows > image.rows() ||
+        layout.firstCol(last) + layout.die_cols > image.cols()) {
+        throw std::invalid_argument("Die layout extends past the inspection image");
+    }
+}
+
+std::vector<ImageDefect> DieInspector::dieToDie(const Eigen::ArrayXXd& image) const {
+    checkLayout(image);
+    const DieLayout& layout = settings_.layout;
+    if (layout.dies() < 2) {
+        throw std::invalid_argument("Die-to-die inspection needs at least two dies");
+    }
+    const int tile = settings_.tile_size;
+    // Dies are compared along their row of dies, or down the column when
+    // a row holds one; either way with dies numbered next to them
+    const int line = layout.count_cols > 1 ? layout.count_cols : layout.count_rows;
+
+    std::vector<std::vector<ImageDefect>> found(layout.dies());
+    TaskScheduler::getInstance().parallelFor(0, layout.dies(), [&](int begin, int end) {
+        Eigen::ArrayXXd difference(layout.die_rows, layout.die_cols), to_near, to_far;
+        for (int die = begin; die < end; ++die) {
+            // The two nearest other dies in the line, or the one other
+            const int place = layout.count_cols > 1 ? die % layout.count_cols : die;
+            int near = die + 1, far = -1;
+            if (line == 2) {
+                near = place == 0 ? die + 1 : die - 1;
+            } else if (place == 0) {
+                far = die + 2;
+            } else if (place == line - 1) {
+                near = die - 1;
+                far = die - 2;
+            } else {
+                near = die - 1;
+                far = die + 1;
+            }
+            const auto block = [&](int d, int r, int c, int h, int w) {
+                return image.block(layout.firstRow(d) + r, layout.firstCol(d) + c, h, w);
+            };
+            for (int c = 0; c < layout.die_cols; c += tile) {
+                const int w = std::min(tile, layout.die_cols - c);
+                for (int r = 0; r < layout.die_rows; r += tile) {
+                    const int h = std::min(tile, layout.die_rows - r);
+                    if (far >= 0) {
+                        // Of the two differences the smaller, so only a pixel
+                        // unlike both other dies passes the threshold
+                        to_near = block(die, r, c, h, w) - block(near, r, c, h, w);
+                        to_far = block(die, r, c, h, w) - block(far, r, c, h, w);
+                        difference.block(r, c, h, w) = (to_near.abs() < to_far.abs()).select(to_near, to_far);
+                    } else {
+                        difference.block(r, c, h, w) = block(die, r, c, h, w) - block(near, r, c, h, w);
+                    }
+                }
+            }
+            label(die, difference, found[die]);
+        }
+    }, 1);
+
+    std::vector<ImageDefect> defects;
+    for (auto& die : found) {
+        defects.insert(defects.end(), std::make_move_iterator(die.begin()), std::make_move_iterator(die.end()));
+    }
+    return defects;
+}
+
+std::vector<ImageDefect> DieInspector::dieToDatabase(const Eigen::ArrayXXd& image,
+                                                     const Eigen::ArrayXXd& reference) const {
+    checkLayout(image);
+    const DieLayout& layout = settings_.layout;
+    if (reference.rows() != layout.die_rows || reference.cols() != layout.die_cols) {
+        throw std::invalid_argument("Reference image does not match the die size");
+    }
+    const int tile = settings_.tile_size;
+
+    std::vector<std::vector<ImageDefect>> found(layout.dies());
+    TaskScheduler::getInstance().parallelFor(0, layout.dies(), [&](int begin, int end) {
+        Eigen::ArrayXXd difference(layout.die_rows, layout.die_cols);
+        for (int die = begin; die < end; ++die) {
+            for (int c = 0; c < layout.die_cols; c += tile) {
+                const int w = std::min(tile, layout.die_cols - c);
+                for (int r = 0; r < layout.die_rows; r += tile) {
+                    const int h = std::min(tile, layout.die_rows - r);
+                    difference.block(r, c, h, w) =
+                        image.block(layout.firstRow(die) + r, layout.firstCol(die) + c, h, w) -
+                        reference.block(r, c, h, w);
+                }
+            }
+            label(die, difference, found[die]);
+        }
+    }, 1);
+
+    std::vector<ImageDefect> defects;
+    for (auto& die : found) {
+        defects.insert(defects.end(), std::make_move_iterator(die.begin()), std::make_move_iterator(die.end()));
+    }
+    return defects;
+}
+
+void DieInspector::label(int die, const Eigen::ArrayXXd& difference, std::vector<ImageDefect>& out) const {
+    const std::vector<MaskRun> runs = BitMask::fromField(difference.abs(), settings_.threshold).runs();
+    if (runs.empty()) return;
+
+    // Runs join the runs they touch, diagonally included, in the row above
+    std::vector<int> parent(runs.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    const auto find = [&parent](int r) {
+        while (parent[r] != r) {
+            r = parent[r] = parent[parent[r]];
+        }
+        return r;
+    };
+    for (std::size_t r = 0, above = 0, row_start = 0; r < runs.size(); ++r) {
+        if (r > 0 && runs[r].row != runs[r - 1].row) {
+            above = row_start;
+            row_start = r;
+            while (above < row_start && runs[above].row != runs[r].row - 1) ++above;
+        }
+        while (above < row_start && runs[above].col_end < runs[r].col_begin) ++above;
+        for (std::size_t q = above; q < row_start && runs[q].col_begin <= runs[r].col_end; ++q) {
+            if (runs[q].row == runs[r].row - 1) {
+                parent[find(static_cast<int>(r))] = find(static_cast<int>(q));
+            }
+        }
+    }
+
+    // Components in the order of their first pixel
+    const DieLayout& layout = settings_.layout;
+    const int row0 = layout.firstRow(die), col0 = layout.firstCol(die);
+    std::vector<int> component(runs.size(), -1);
+    std::vector<ImageDefect> defects;
+    std::vector<std::pair<double, double>> sums;
+    for (std::size_t r = 0; r < runs.size(); ++r) {
+        const MaskRun& run = runs[r];
+        int& index = component[find(static_cast<int>(r))];
+        if (index < 0) {
+            index = static_cast<int>(defects.size());
+            defects.push_back({die, run.row, run.row + 1, run.col_begin, run.col_end, 0.0, 0.0, 0, 0.0});
+            sums.emplace_back(0.0, 0.0);
+        }
+        ImageDefect& defect = defects[index];
+        const int length = run.col_end - run.col_begin;
+        defect.row_end = run.row + 1;
+        defect.col_begin = std::min(defect.col_begin, run.col_begin);
+        defect.col_end = std::max(defect.col_end, run.col_end);
+        defect.pixels += length;
+        sums[index].first += static_cast<double>(run.row) * length;
+        sums[index].second += 0.5 * (run.col_begin + run.col_end - 1) * length;
+        for (int j = run.col_begin; j < run.col_end; ++j) {
+            if (std::abs(difference(run.row, j)) > std::abs(defect.peak)) defect.peak = difference(run.row, j);
+        }
+    }
+
+    for (std::size_t k = 0; k < defects.size(); ++k) {
+        ImageDefect& defect = defects[k];
+        if (defect.pixels < settings_.min_pixels) continue;
+        defect.row = row0 + sums[k].first / defect.pixels;
+        defect.col = col0 + sums[k].second / defect.pixels;
+        defect.row_begin += row0;
+        defect.row_end += row0;
+        defect.col_begin += col0;
+        defect.col_end += col0;
+        out.push_back(defect);
+    }
+}
@@ -0,0 +1,80 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef DIE_INSPECTION_HPP
+#define DIE_INSPECTION_HPP
+
+#include "../../core/wafer.hpp"
+#include <Eigen/Dense>
+#include <vector>
+
+// Identical dies stepped across the wafer grid: die (a, b) covers rows
+// origin_row + a * pitch_rows up to die_rows further, and likewise for
+// columns, for a < count_rows and b < count_cols
+struct DieLayout {
+    int origin_row = 0;
+    int origin_col = 0;
+    int die_rows = 0;
+    int die_cols = 0;
+    int pitch_rows = 0;
+    int pitch_cols = 0;
+    int count_rows = 0;
+    int count_cols = 0;
+
+    int dies() const { return count_rows * count_cols; }
+    int firstRow(int die) const { return origin_row + (die / count_cols) * pitch_rows; }
+    int firstCol(int die) const { return origin_col + (die % count_cols) * pitch_cols; }
+};
+
+// How the inspection image is formed from the wafer's fields and which
+// differences count as defects
+struct ImageInspectionSettings {
+    DieLayout layout;
+    double height_gain = 1.0; // Gray level per unit of grid height
+    double resist_gain = 1.0; // Gray level added where resist remains
+    double threshold = 0.5;   // Smallest gray-level difference flagged
+    int min_pixels = 1;       // Smaller components are dropped as noise
+    int tile_size = 64;       // Pixels on a side of each differencing tile
+};
+
+// A connected (8-neighbour) set of pixels that differ from the reference,
+// in wafer grid cells
+struct ImageDefect {
+    int die;
+    int row_begin, row_end; // Bounding box
+    int col_begin, col_end;
+    double row, col;        // Centroid
+    int pixels;
+    double peak;            // Signed difference of largest magnitude
+};
+
+// Image-based inspection of a wafer's dies. The image is rendered from the
+// grid heights and the photoresist mask. Each die is differenced against
+// its neighbours (die to die) or against a reference die image (die to
+// database) tile by tile, the differences thresholded and the pixels
+// over threshold labelled into connected components. Dies are inspected
+// in parallel and their defects returned in die order.
+class DieInspector {
+public:
+    explicit DieInspector(const ImageInspectionSettings& settings);
+
+    // Gray levels of the whole wafer grid
+    Eigen::ArrayXXd render(const Wafer& wafer) const;
+
+    // A die's pixel is defective when it differs from both of the two
+    // nearest dies along its row of dies (its column when a row holds one
+    // die): the dies either side, or the next two in from an end. In a
+    // line of two dies, each is compared with the other alone, so a
+    // difference shows in both. Needs at least two dies.
+    std::vector<ImageDefect> dieToDie(const Eigen::ArrayXXd& image) const;
+    // Every die against reference, die_rows by die_cols
+    std::vector<ImageDefect> dieToDatabase(const Eigen::ArrayXXd& image, const Eigen::ArrayXXd& reference) const;
+
+private:
+    // Checks that the layout is non-empty and its dies lie in image
+    void checkLayout(const Eigen::ArrayXXd& image) const;
+    // Components of die's signed difference image
+    void label(int die, const Eigen::ArrayXXd& difference, std::vector<ImageDefect>& out) const;
+
+    ImageInspectionSettings settings_;
+};
+
+#endif // DIE_INSPECTION_HPP
@@ -1,8 +1,9 @@
 #include "deposition_model.hpp"
+#include "../../core/distance_transform.hpp"
 #include "../../core/utils.hpp"
-#include <cmath>
+#include <stdexcept>
 
-DepositionModel::DepositionModel() {}
+DepositionModel::DepositionModel() : cell_size_(0.01) {}
 
 void DepositionModel::simulateDeposition(std::shared_ptr<Wafer> wafer, double thickness, const std::string& material, const std::string& type) {
     if (type == "uniform") {
@@ -10,37 +11,38 @@ void DepositionModel::simulateDeposition(std::shared_ptr<Wafer> wafer, double th
     } else if (type == "conformal") {
         simulate_conformal(wafer, thickness, material);
     } else {
-        Logger::getInstance().log("ERROR: Unknown deposition type: " + type);
+        SEMIPRO_LOGF(ERROR, PHYSICS, "Unknown deposition type: {}", type);
         return;
     }
     wafer->addFilmLayer(thickness, material);
-    Logger::getInstance().log("Deposition simulated: type=" + type + ", thickness=" + std::to_string(thickness) + "um, material=" + material);
+    SEMIPRO_LOGF(INFO, PHYSICS, "Deposition simulated: type={}, thickness={}um, material={}",
+                 type, thickness, material);
 }
 
-void DepositionModel::simulate_uniform(std::shared_ptr<Wafer> wafer, double thickness, const std::string& material) {
-    Eigen::ArrayXXd grid = wafer->getGrid();
-    const Eigen::ArrayXXd& pattern = wafer->getPhotoresistPattern();
-    for (int i = 0; i < grid.rows(); ++i) {
-        for (int j = 0; j < grid.cols(); ++j) {
-            if (i < pattern.rows() && j < pattern.cols() && pattern(i, j) < 0.5) { // No photoresist
-                grid(i, j) += thickness;
-            }
-        }
+void DepositionModel::simulateProfile(std::shared_ptr<Wafer> wafer, double time, double reach,
+                                      const LevelSet::Velocity& velocity) {
+    FieldView grid = wafer->getGrid();
+    LevelSet::evolveHeights(grid, cell_size_, time, reach, velocity, &wafer->getPhotoresistMask());
+}
+
+void DepositionModel::setCellSize(double cell_size) {
+    if (!(cell_size > 0.0)) {
+        throw std::invalid_argument("Deposition cell size must be positive");
     }
-    wafer->updateGrid(grid);
+    cell_size_ = cell_size;
+}
+
+void DepositionModel::simulate_uniform(std::shared_ptr<Wafer> wafer, double thickness, const std::string& material) {
+    // Arriving straight down, the film builds on the faces looking up and
+    // leaves the walls bare
+    simulateProfile(wafer, thickness, thickness, LevelSet::directional(1.0, 1.0));
 }
 
 void DepositionModel::simulate_conformal(std::shared_ptr<Wafer> wafer, double thickness, const std::string& material) {
-    Eigen::ArrayXXd grid = wafer->getGrid();
-    const Eigen::ArrayXXd& pattern = wafer->getPhotoresistPattern();
-    Eigen::ArrayXXd new_grid = grid;
-    for (int i = 1; i < grid.rows() - 1; ++i) {
-        for (int j = 1; j < grid.cols() - 1; ++j) {
-            if (i < pattern.rows() && j < pattern.cols() && pattern(i, j) < 0.5) {
-                double laplacian = (grid(i+1,j) + grid(i-1,j) + grid(i,j+1) + grid(i,j-1) - 4 * grid(i,j)) / 4.0;
-                new_grid(i,j) += thickness * (1.0 + 0.5 * std::abs(laplacian));
-            }
-        }
-    }
-    wafer->updateGrid(new_grid);
-}
\ No newline at end of file
+    // Every face grows by the same thickness, so the film lines walls and
+    // floors alike and closes in on narrow gaps: the surface moves to the
+    // thickness contour of its distance transform, in one pass whatever the
+    // thickness
+    FieldView grid = wafer->getGrid();
+    DistanceTransform::offsetHeights(grid, cell_size_, thickness, &wafer->getPhotoresistMask());
+}
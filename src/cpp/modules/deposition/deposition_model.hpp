@@ -2,17 +2,31 @@
 #define DEPOSITION_HMODEL_HPP
 
 #include "deposition_interface.hpp"
+#include "../../core/level_set.hpp"
 #include "../../core/wafer.hpp"
 #include <Eigen/Dense>
 
+// Grows films on the wafer's surface as a level set, moving it out along
+// its normals, or for conformal films as the contour of its exact distance
+// transform; the photoresist's top faces take no film.
 class DepositionModel : public DepositionInterface {
 public:
     DepositionModel();
     void simulateDeposition(std::shared_ptr<Wafer> wafer, double thickness, const std::string& material, const std::string& type) override;
+    // Moves the surface under velocity for time, with the photoresist
+    // protecting the cells it covers; reach bounds how far it moves in um
+    void simulateProfile(std::shared_ptr<Wafer> wafer, double time, double reach,
+                         const LevelSet::Velocity& velocity);
+
+    // Side of one grid cell in um, which is also the level set's voxel
+    // height; throws std::invalid_argument unless positive
+    void setCellSize(double cell_size);
 
 private:
     void simulate_uniform(std::shared_ptr<Wafer> wafer, double thickness, const std::string& material);
     void simulate_conformal(std::shared_ptr<Wafer> wafer, double thickness, const std::string& material);
+
+    double cell_size_;
 };
 
-#endif // DEPOSITION_HMODEL_HPP
\ No newline at end of file
+#endif // DEPOSITION_HMODEL_HPP
@@ -1,14 +1,79 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "drc_model.hpp"
+#include "polygon_drc.hpp"
+#include "../../core/layer_connectivity.hpp"
+#include "../../core/task_scheduler.hpp"
 #include "../../core/utils.hpp"
 #include <algorithm>
+#include <cstdint>
 #include <fstream>
+#include <iterator>
+#include <limits>
+#include <numeric>
 #include <sstream>
 #include <cmath>
 #include <stdexcept>
 
+namespace {
+
+// Runs or gaps of one rule checked per task
+constexpr int kRunsPerCheck = 1 << 14;
+
+// Set cells of mask, counted over blocks of rows in parallel
+std::size_t countCells(const BitMask& mask) {
+    constexpr int kRowsPerBlock = 256;
+    const int blocks = (mask.rows() + kRowsPerBlock - 1) / kRowsPerBlock;
+    const std::size_t words = static_cast<std::size_t>(mask.words_per_row());
+    std::vector<std::size_t> counts(blocks, 0);
+    TaskScheduler::getInstance().parallelFor(0, blocks, [&](int begin, int end) {
+        for (int b = begin; b < end; ++b) {
+            const std::uint64_t* word = mask.words().data() + b * kRowsPerBlock * words;
+            const std::uint64_t* last = mask.words().data() + std::min((b + 1) * kRowsPerBlock, mask.rows()) * words;
+            for (; word != last; ++word) {
+                counts[b] += static_cast<std::size_t>(__builtin_popcountll(*word));
+            }
+        }
+    });
+    return std::accumulate(counts.begin(), counts.end(), std::size_t{0});
+}
+
+// The metal layers: cells whose photoresist is strictly above 0.5. The
+// wafer's mask also holds cells at exactly 0.5, so the set ones are checked
+// against the dense pattern (all 0 or 1 when it was expanded from the mask).
+BitMask metalMask(const Wafer& wafer) {
+    BitMask mask = wafer.getPhotoresistMask();
+    const ConstFieldView photoresist = wafer.getPhotoresistPattern();
+    std::vector<std::pair<int, int>> threshold;
+    mask.forEachSet([&](int i, int j) {
+        if (!(photoresist(i, j) > 0.5)) threshold.emplace_back(i, j);
+    });
+    for (const auto& cell : threshold) {
+        mask.set(cell.first, cell.second, false);
+    }
+    return mask;
+}
+
+} // namespace
+
+std::string DRCViolation::text() const {
+    if (!description.empty()) {
+        return description;
+    }
+    if (type == ViolationType::ANTENNA_RATIO) {
+        return "Antenna ratio violation: measured " + std::to_string(measured_value) + " > allowed " +
+               std::to_string(required_value);
+    }
+    const char* what = type == ViolationType::WIDTH       ? "Width"
+                       : type == ViolationType::SPACING   ? "Spacing"
+                       : type == ViolationType::AREA      ? "Area"
+                       : type == ViolationType::ENCLOSURE ? "Enclosure"
+                                                          : "Rule";
+    return std::string(what) + " violation: measured " + std::to_string(measured_value) +
+           " < required " + std::to_string(required_value);
+}
+
 DRCModel::DRCModel() : technology_node_("generic"), feature_size_(0.1), 
-                       metal_pitch_(0.2), via_size_(0.05) {
+                       metal_pitch_(0.2), via_size_(0.05), cell_size_(0.01) {
     initializeDefaultRules();
 }
 
@@ -21,7 +86,8 @@ void DRCModel::addRule(const DRCRule& rule) {
     }
     
     rules_.push_back(rule);
-    Logger::getInstance().log("Added DRC rule: " + rule.name);
+    checked_mask_ = BitMask();
+    SEMIPRO_LOGF(INFO, VALIDATION, "Added DRC rule: {}", rule.name);
 }
 
 void DRCModel::removeRule(const std::string& rule_name) {
@@ -32,7 +98,8 @@ void DRCModel::removeRule(const std::string& rule_name) {
     }
     
     rules_.erase(it);
-    Logger::getInstance().log("Removed DRC rule: " + rule_name);
+    checked_mask_ = BitMask();
+    SEMIPRO_LOGF(INFO, VALIDATION, "Removed DRC rule: {}", rule_name);
 }
 
 void DRCModel::enableRule(const std::string& rule_name, bool enabled) {
@@ -43,7 +110,8 @@ void DRCModel::enableRule(const std::string& rule_name, bool enabled) {
     }
     
     it->enabled = enabled;
-    Logger::getInstance().log("Rule " + rule_name + (enabled ? " enabled" : " disabled"));
+    checked_mask_ = BitMask();
+    SEMIPRO_LOGF(INFO, VALIDATION, "Rule {}{}", rule_name, (enabled ? " enabled" : " disabled"));
 }
 
 void DRCModel::loadTechnologyRules(const std::string& technology_node) {
@@ -94,7 +162,7 @@ void DRCModel::loadTechnologyRules(const std::string& technology_node) {
         initializeDefaultRules();
     }
     
-    Logger::getInstance().log("Loaded technology rules for " + technology_node);
+    SEMIPRO_LOGF(INFO, VALIDATION, "Loaded technology rules for {}", technology_node);
 }
 
 void DRCModel::runFullDRC(std::shared_ptr<Wafer> wafer) {
@@ -104,85 +172,406 @@ void DRCModel::runFullDRC(std::shared_ptr<Wafer> wafer) {
     
     clearViolations();
     
-    Logger::getInstance().log("Starting full DRC check");
+    SEMIPRO_LOGF(INFO, VALIDATION, "Starting full DRC check");
     
-    // Run all enabled rule checks
-    checkWidthRules(wafer);
-    checkSpacingRules(wafer);
-    checkAreaRules(wafer);
+    // Run all enabled rule checks, the width and spacing ones in parallel
+    // rule by rule and tile by tile
+    LayerMap layers;
+    prepareLayers(wafer, layers);
+    std::vector<Check> checks;
+    addWidthChecks(wafer, layers, checks);
+    addSpacingChecks(wafer, layers, checks);
+    runChecks(checks, violations_);
+    checkAreaRules(wafer, layers);
     checkEnclosureRules(wafer);
-    checkDensityRules(wafer);
+    checkDensityRules(wafer, layers);
     checkAntennaRules(wafer);
     checkAspectRatioRules(wafer);
     checkCornerRoundingRules(wafer);
+    checked_mask_ = metalMask(*wafer);
     
-    Logger::getInstance().log("Full DRC check completed. Found " + 
-                             std::to_string(violations_.size()) + " violations");
+    SEMIPRO_LOGF(INFO, VALIDATION, "Full DRC check completed. Found {} violations", violations_.size());
 }
 
-void DRCModel::checkWidthRules(std::shared_ptr<Wafer> wafer) {
-    const auto& grid = wafer->getGrid();
-    const auto& photoresist = wafer->getPhotoresistPattern();
+void DRCModel::runIncrementalDRC(std::shared_ptr<Wafer> wafer) {
+    if (!wafer) {
+        throw std::invalid_argument("Wafer pointer is null");
+    }
+    const BitMask mask = metalMask(*wafer);
+    if (checked_mask_.rows() != mask.rows() || checked_mask_.cols() != mask.cols() || checked_mask_.empty()) {
+        runFullDRC(wafer);
+        return;
+    }
     
-    // Check width rules for each enabled width rule
+    // Blocks of 64 rows by one word whose words differ from the mask last
+    // checked; neighbouring ones along a block row make one region
+    constexpr int kBlockRows = 64;
+    const int words = mask.words_per_row();
+    const int block_rows = (mask.rows() + kBlockRows - 1) / kBlockRows;
+    std::vector<char> dirty(static_cast<std::size_t>(block_rows) * words, 0);
+    const std::uint64_t* now = mask.words().data();
+    const std::uint64_t* before = checked_mask_.words().data();
+    for (int i = 0; i < mask.rows(); ++i) {
+        for (int w = 0; w < words; ++w) {
+            const std::size_t k = static_cast<std::size_t>(i) * words + w;
+            if (now[k] != before[k]) dirty[(i / kBlockRows) * words + w] = 1;
+        }
+    }
+    std::vector<Window> regions;
+    for (int b = 0; b < block_rows; ++b) {
+        for (int w = 0; w < words;) {
+            if (!dirty[b * words + w]) {
+                ++w;
+                continue;
+            }
+            const int first = w;
+            while (w < words && dirty[b * words + w]) ++w;
+            regions.push_back({b * kBlockRows, std::min((b + 1) * kBlockRows, mask.rows()), first * 64,
+                               std::min(w * 64, mask.cols())});
+        }
+    }
+    recheckRegions(wafer, regions);
+}
+
+void DRCModel::runIncrementalDRC(std::shared_ptr<Wafer> wafer, const std::pair<double, double>& region_start,
+                                 const std::pair<double, double>& region_end) {
+    if (!wafer) {
+        throw std::invalid_argument("Wafer pointer is null");
+    }
+    const BitMask mask = metalMask(*wafer);
+    if (checked_mask_.rows() != mask.rows() || checked_mask_.cols() != mask.cols() || checked_mask_.empty()) {
+        runFullDRC(wafer);
+        return;
+    }
+    const auto clampTo = [](double v, int size) {
+        return static_cast<int>(std::clamp(v, 0.0, static_cast<double>(size)));
+    };
+    const Window region{clampTo(std::floor(std::min(region_start.first, region_end.first)), mask.rows()),
+                        clampTo(std::ceil(std::max(region_start.first, region_end.first)), mask.rows()),
+                        clampTo(std::floor(std::min(region_start.second, region_end.second)), mask.cols()),
+                        clampTo(std::ceil(std::max(region_start.second, region_end.second)), mask.cols())};
+    std::vector<Window> regions;
+    if (region.row_begin < region.row_end && region.col_begin < region.col_end) {
+        regions.push_back(region);
+    }
+    recheckRegions(wafer, regions);
+}
+
+void DRCModel::recheckRegions(std::shared_ptr<Wafer> wafer, const std::vector<Window>& regions) {
+    const BitMask mask = metalMask(*wafer);
+    const int rows = mask.rows(), cols = mask.cols();
+    std::size_t changed = 0;
+    for (const auto& region : regions) {
+        changed += static_cast<std::size_t>(region.row_end - region.row_begin) * (region.col_end - region.col_begin);
+    }
+    // Past a quarter of the mask the windows' overlap costs more than a full run
+    if (changed * 4 > static_cast<std::size_t>(rows) * cols) {
+        runFullDRC(wafer);
+        return;
+    }
+    
+    SEMIPRO_LOGF(INFO, VALIDATION, "Starting incremental DRC check of {} regions", regions.size());
+    
+    // A width or spacing violation lies at the middle of a run or gap
+    // shorter than its rule, so only those within that reach of a changed
+    // cell can come or go: the zones. Each zone is rechecked on a window a
+    // reach wider, which holds every such run whole.
+    int reach = 1;
     for (const auto& rule : rules_) {
-        if (!rule.enabled || rule.type != ViolationType::WIDTH) continue;
-        
-        // Extract features for the layer
-        auto features = extractFeatures(wafer, rule.layer);
-        
-        for (const auto& feature : features) {
-            double measured_width = measureWidth({feature});
-            
-            if (!checkRuleCondition(rule, measured_width)) {
-                DRCViolation violation(rule.name, ViolationType::WIDTH, feature,
-                                     measured_width, rule.min_value);
-                violation.severity = determineViolationSeverity(rule, measured_width);
-                violation.description = "Width violation: measured " + 
-                                      std::to_string(measured_width) + 
-                                      " < required " + std::to_string(rule.min_value);
-                addViolation(violation);
+        if (rule.enabled && (rule.type == ViolationType::WIDTH || rule.type == ViolationType::SPACING)) {
+            reach = std::max(reach, static_cast<int>(std::ceil(rule.min_value / cell_size_)) + 1);
+        }
+    }
+    const auto grow = [rows, cols](const Window& w, int by) {
+        return Window{std::max(w.row_begin - by, 0), std::min(w.row_end + by, rows), std::max(w.col_begin - by, 0),
+                      std::min(w.col_end + by, cols)};
+    };
+    std::vector<Window> zones;
+    for (const auto& region : regions) zones.push_back(grow(region, reach));
+    // Cell (i, j) covers locations [i - 0.5, i + 0.5) x [j - 0.5, j + 0.5)
+    const auto inZone = [](const std::pair<double, double>& at, const Window& zone) {
+        return at.first >= zone.row_begin - 0.5 && at.first < zone.row_end - 0.5 && at.second >= zone.col_begin - 0.5 &&
+               at.second < zone.col_end - 0.5;
+    };
+    const auto local = [](ViolationType type) {
+        return type == ViolationType::WIDTH || type == ViolationType::SPACING;
+    };
+    
+    // Out go the zones' width and spacing violations and the mask-wide
+    // area and density ones; waivers are kept for those found again
+    std::vector<DRCViolation> waived;
+    violations_.erase(std::remove_if(violations_.begin(), violations_.end(),
+                                     [&](const DRCViolation& v) {
+                                         const bool stale = (local(v.type) &&
+                                                             std::any_of(zones.begin(), zones.end(),
+                                                                         [&](const Window& zone) {
+                                                                             return inZone(v.location, zone);
+                                                                         })) ||
+                                                            v.type == ViolationType::AREA ||
+                                                            v.type == ViolationType::DENSITY;
+                                         if (stale && v.waived) waived.push_back(v);
+                                         return stale;
+                                     }),
+                      violations_.end());
+    const std::size_t kept = violations_.size();
+    
+    // Zones are rechecked in parallel and merged in order
+    const MaskFeatures features = labelFeatures(mask);
+    std::vector<Violations> found(zones.size());
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(zones.size()), [&](int begin, int end) {
+        for (int z = begin; z < end; ++z) {
+            LayerMap layers;
+            for (const auto& rule : rules_) {
+                if (rule.enabled && local(rule.type) && (rule.layer == "metal" || rule.layer == "metal1") &&
+                    !layers.count(rule.layer)) {
+                    buildLayerGeometry(mask, features, rule.layer, grow(zones[z], reach), layers[rule.layer]);
+                }
+            }
+            std::vector<Check> checks;
+            addWidthChecks(wafer, layers, checks);
+            addSpacingChecks(wafer, layers, checks);
+            Violations zone;
+            runChecks(checks, zone);
+            // Each zone keeps what lies in it and in no zone before it
+            for (auto& v : zone) {
+                if (inZone(v.location, zones[z]) &&
+                    std::none_of(zones.begin(), zones.begin() + z,
+                                 [&](const Window& earlier) { return inZone(v.location, earlier); })) {
+                    found[z].push_back(std::move(v));
+                }
             }
         }
+    }, 1);
+    for (auto& zone : found) {
+        violations_.insert(violations_.end(), std::make_move_iterator(zone.begin()), std::make_move_iterator(zone.end()));
+    }
+    
+    // Area and density need only the count of set cells
+    LayerMap counts;
+    const std::size_t area = countCells(mask);
+    for (const char* layer : {"metal", "metal1"}) {
+        counts[layer].area = area;
+        counts[layer].cells = static_cast<std::size_t>(rows) * cols;
+    }
+    checkAreaRules(wafer, counts);
+    checkDensityRules(wafer, counts);
+    
+    for (auto it = violations_.begin() + kept; it != violations_.end(); ++it) {
+        it->waived = std::any_of(waived.begin(), waived.end(), [&it](const DRCViolation& w) {
+            return w.rule_name == it->rule_name && w.location == it->location && w.measured_value == it->measured_value;
+        });
+    }
+    checked_mask_ = mask;
+    
+    SEMIPRO_LOGF(INFO, VALIDATION, "Incremental DRC check completed. Found {} violations", violations_.size());
+}
+
+void DRCModel::runPolygonDRC(const std::unordered_map<std::string, PolygonLayer>& layers, double tile_size) {
+    clearViolations();
+    
+    SEMIPRO_LOGF(INFO, VALIDATION, "Starting polygon DRC check on {} layers", layers.size());
+    
+    for (auto& violation : PolygonDRC::check(rules_, layers, tile_size)) {
+        const auto rule = std::find_if(rules_.begin(), rules_.end(),
+                                       [&violation](const DRCRule& r) { return r.name == violation.rule_name; });
+        violation.severity = determineViolationSeverity(*rule, violation.measured_value);
+        addViolation(violation);
+    }
+    
+    SEMIPRO_LOGF(INFO, VALIDATION, "Polygon DRC check completed. Found {} violations", violations_.size());
+}
+
+void DRCModel::setCellSize(double cell_size) {
+    if (!(cell_size > 0.0)) {
+        throw std::invalid_argument("DRC cell size must be positive");
+    }
+    cell_size_ = cell_size;
+    checked_mask_ = BitMask();
+}
+
+void DRCModel::checkWidthRules(std::shared_ptr<Wafer> wafer) {
+    LayerMap layers;
+    checkWidthRules(wafer, layers);
+}
+
+void DRCModel::checkWidthRules(std::shared_ptr<Wafer> wafer, LayerMap& layers) {
+    std::vector<Check> checks;
+    addWidthChecks(wafer, layers, checks);
+    runChecks(checks, violations_);
+}
+
+void DRCModel::addWidthChecks(std::shared_ptr<Wafer> wafer, LayerMap& layers, std::vector<Check>& checks) const {
+    // A feature's width is its run across each row and column cut; a line
+    // is as wide as its shorter runs, and its long ones pass
+    for (const auto& rule : rules_) {
+        if (!rule.enabled || rule.type != ViolationType::WIDTH) continue;
+        
+        const LayerGeometry& layer = layerGeometry(wafer, rule.layer, layers);
+        addRunChecks(rule, layer, layer.edges.rowRuns(), true, checks);
+        addRunChecks(rule, layer, layer.edges.colRuns(), false, checks);
     }
 }
 
 void DRCModel::checkSpacingRules(std::shared_ptr<Wafer> wafer) {
-    // Check spacing rules for each enabled spacing rule
+    LayerMap layers;
+    checkSpacingRules(wafer, layers);
+}
+
+void DRCModel::checkSpacingRules(std::shared_ptr<Wafer> wafer, LayerMap& layers) {
+    std::vector<Check> checks;
+    addSpacingChecks(wafer, layers, checks);
+    runChecks(checks, violations_);
+}
+
+void DRCModel::addSpacingChecks(std::shared_ptr<Wafer> wafer, LayerMap& layers, std::vector<Check>& checks) const {
+    // Spacings are the gaps between neighboring features along the cuts,
+    // and the distance across corners where features do not face each other
     for (const auto& rule : rules_) {
         if (!rule.enabled || rule.type != ViolationType::SPACING) continue;
         
-        auto features = extractFeatures(wafer, rule.layer);
+        const LayerGeometry& layer = layerGeometry(wafer, rule.layer, layers);
+        addRunChecks(rule, layer, layer.edges.rowGaps(), true, checks);
+        addRunChecks(rule, layer, layer.edges.colGaps(), false, checks);
+        checks.push_back([this, &rule, &layer](Violations& out) { checkCornerSpacing(rule, layer, out); });
+    }
+}
+
+void DRCModel::addRunChecks(const DRCRule& rule, const LayerGeometry& layer, std::vector<EdgeRun> runs,
+                            bool along_rows, std::vector<Check>& checks) const {
+    const auto shared = std::make_shared<const std::vector<EdgeRun>>(std::move(runs));
+    for (std::size_t first = 0; first < shared->size(); first += kRunsPerCheck) {
+        const std::size_t last = std::min(first + kRunsPerCheck, shared->size());
+        checks.push_back([this, &rule, &layer, shared, first, last, along_rows](Violations& out) {
+            checkRuns(rule, layer, shared->data() + first, shared->data() + last, along_rows, out);
+        });
+    }
+}
+
+void DRCModel::runChecks(const std::vector<Check>& checks, Violations& out) {
+    std::vector<Violations> found(checks.size());
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(checks.size()), [&](int begin, int end) {
+        for (int c = begin; c < end; ++c) {
+            checks[c](found[c]);
+        }
+    }, 1);
+    std::size_t total = out.size();
+    for (const auto& part : found) total += part.size();
+    out.reserve(total);
+    for (auto& part : found) {
+        out.insert(out.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+    }
+}
+
+void DRCModel::checkRuns(const DRCRule& rule, const LayerGeometry& layer, const EdgeRun* begin, const EdgeRun* end,
+                         bool along_rows, Violations& out) const {
+    for (const EdgeRun* run = begin; run != end; ++run) {
+        const double measured = run->width() * cell_size_;
+        if (checkRuleCondition(rule, measured)) continue;
         
-        // Check spacing between all pairs of features
-        for (size_t i = 0; i < features.size(); ++i) {
-            for (size_t j = i + 1; j < features.size(); ++j) {
-                double dx = features[i].first - features[j].first;
-                double dy = features[i].second - features[j].second;
-                double spacing = std::sqrt(dx*dx + dy*dy);
-                
-                if (!checkRuleCondition(rule, spacing)) {
-                    DRCViolation violation(rule.name, ViolationType::SPACING,
-                                         {(features[i].first + features[j].first) / 2,
-                                          (features[i].second + features[j].second) / 2},
-                                         spacing, rule.min_value);
-                    violation.severity = determineViolationSeverity(rule, spacing);
-                    violation.description = "Spacing violation: measured " + 
-                                          std::to_string(spacing) + 
-                                          " < required " + std::to_string(rule.min_value);
-                    addViolation(violation);
+        // The edges are the window's; locations are the mask's
+        const double middle = 0.5 * (run->begin + run->end);
+        const std::pair<double, double> location =
+            along_rows ? std::make_pair(static_cast<double>(run->cut + layer.row_begin), middle + layer.col_begin)
+                       : std::make_pair(middle + layer.row_begin, static_cast<double>(run->cut + layer.col_begin));
+        DRCViolation violation(rule.name, rule.type, location, measured, rule.min_value);
+        violation.severity = determineViolationSeverity(rule, measured);
+        out.push_back(std::move(violation));
+    }
+}
+
+void DRCModel::checkCornerSpacing(const DRCRule& rule, const LayerGeometry& layer, Violations& out) const {
+    const double limit = rule.min_value / cell_size_; // Cells
+    if (layer.boundary.empty() || !(limit > 0.0)) return;
+    
+    // Two cells di rows and dj columns apart leave a gap of di - 1 and
+    // dj - 1 clear cells between them, so only bins within reach can hold
+    // a cell closer than the limit
+    const double limit2 = limit * limit;
+    const int reach = static_cast<int>(std::ceil(limit)) + 1;
+    const int bin_reach = (reach + layer.bin_size - 1) / layer.bin_size;
+    // Nearest cells of each pair of features, apart diagonally or facing
+    // each other along a cut (the gaps already checked)
+    struct Nearest {
+        double corner = std::numeric_limits<double>::infinity();
+        double straight = std::numeric_limits<double>::infinity();
+        std::size_t a = 0, b = 0;
+    };
+    using PairMap = std::unordered_map<std::uint64_t, Nearest>;
+    // Each chunk of bin rows finds its cells' pairs, kept under its first row
+    std::vector<PairMap> chunks(layer.bin_rows);
+    TaskScheduler::getInstance().parallelFor(0, layer.bin_rows, [&](int first_row, int last_row) {
+        PairMap& pairs = chunks[first_row];
+        const int first = layer.bin_start[first_row * layer.bin_cols];
+        const int last = layer.bin_start[last_row * layer.bin_cols];
+        for (int n = first; n < last; ++n) {
+            const LayerGeometry::Cell& p = layer.boundary[n];
+            const int bi = (p.row - layer.row_begin) / layer.bin_size, bj = (p.col - layer.col_begin) / layer.bin_size;
+            for (int ci = std::max(bi - bin_reach, 0); ci <= std::min(bi + bin_reach, layer.bin_rows - 1); ++ci) {
+                for (int cj = std::max(bj - bin_reach, 0); cj <= std::min(bj + bin_reach, layer.bin_cols - 1); ++cj) {
+                    const int bin = ci * layer.bin_cols + cj;
+                    for (int m = layer.bin_start[bin]; m < layer.bin_start[bin + 1]; ++m) {
+                        const LayerGeometry::Cell& q = layer.boundary[m];
+                        if (q.feature <= p.feature) continue; // Each pair once, and never a feature with itself
+                        const int di = std::abs(q.row - p.row), dj = std::abs(q.col - p.col);
+                        const double gap_rows = std::max(di - 1, 0), gap_cols = std::max(dj - 1, 0);
+                        const double distance2 = gap_rows * gap_rows + gap_cols * gap_cols;
+                        if (distance2 >= limit2) continue;
+                        
+                        Nearest& nearest =
+                            pairs[static_cast<std::uint64_t>(p.feature) << 32 | static_cast<std::uint32_t>(q.feature)];
+                        if (di == 0 || dj == 0) {
+                            nearest.straight = std::min(nearest.straight, distance2);
+                        } else if (distance2 < nearest.corner) {
+                            nearest.corner = distance2;
+                            nearest.a = static_cast<std::size_t>(n);
+                            nearest.b = static_cast<std::size_t>(m);
+                        }
+                    }
                 }
             }
         }
+    });
+    // Merged in cell order, ties going to the first cell as in one pass
+    PairMap pairs;
+    for (const auto& chunk : chunks) {
+        for (const auto& entry : chunk) {
+            Nearest& nearest = pairs[entry.first];
+            nearest.straight = std::min(nearest.straight, entry.second.straight);
+            if (entry.second.corner < nearest.corner) {
+                nearest.corner = entry.second.corner;
+                nearest.a = entry.second.a;
+                nearest.b = entry.second.b;
+            }
+        }
+    }
+    
+    // Pairs in feature order, so the report does not depend on hashing
+    std::vector<std::pair<std::uint64_t, Nearest>> found;
+    for (const auto& entry : pairs) {
+        if (entry.second.corner < entry.second.straight) found.push_back(entry);
+    }
+    std::sort(found.begin(), found.end(), [](const auto& x, const auto& y) { return x.first < y.first; });
+    for (const auto& entry : found) {
+        const LayerGeometry::Cell& a = layer.boundary[entry.second.a];
+        const LayerGeometry::Cell& b = layer.boundary[entry.second.b];
+        const double measured = std::sqrt(entry.second.corner) * cell_size_;
+        DRCViolation violation(rule.name, rule.type, {0.5 * (a.row + b.row), 0.5 * (a.col + b.col)}, measured,
+                               rule.min_value);
+        violation.severity = determineViolationSeverity(rule, measured);
+        out.push_back(std::move(violation));
     }
 }
 
 void DRCModel::checkAreaRules(std::shared_ptr<Wafer> wafer) {
+    LayerMap layers;
+    checkAreaRules(wafer, layers);
+}
+
+void DRCModel::checkAreaRules(std::shared_ptr<Wafer> wafer, LayerMap& layers) {
     for (const auto& rule : rules_) {
         if (!rule.enabled || rule.type != ViolationType::AREA) continue;
         
-        auto features = extractFeatures(wafer, rule.layer);
-        double total_area = measureArea(features);
+        const double total_area = layerGeometry(wafer, rule.layer, layers).area * cell_size_ * cell_size_;
         
         if (!checkRuleCondition(rule, total_area)) {
             DRCViolation violation(rule.name, ViolationType::AREA,
@@ -197,15 +586,16 @@ void DRCModel::checkAreaRules(std::shared_ptr<Wafer> wafer) {
 }
 
 void DRCModel::checkDensityRules(std::shared_ptr<Wafer> wafer) {
-    const auto& grid = wafer->getGrid();
-    double total_area = grid.rows() * grid.cols();
-    
+    LayerMap layers;
+    checkDensityRules(wafer, layers);
+}
+
+void DRCModel::checkDensityRules(std::shared_ptr<Wafer> wafer, LayerMap& layers) {
     for (const auto& rule : rules_) {
         if (!rule.enabled || rule.type != ViolationType::DENSITY) continue;
         
-        auto features = extractFeatures(wafer, rule.layer);
-        double layer_area = measureArea(features);
-        double density = layer_area / total_area;
+        const LayerGeometry& layer = layerGeometry(wafer, rule.layer, layers);
+        const double density = layer.cells > 0 ? static_cast<double>(layer.area) / layer.cells : 0.0;
         
         if (!checkRuleCondition(rule, density)) {
             DRCViolation violation(rule.name, ViolationType::DENSITY,
@@ -220,6 +610,11 @@ void DRCModel::checkDensityRules(std::shared_ptr<Wafer> wafer) {
     }
 }
 
+void DRCModel::checkEnclosureRules(std::shared_ptr<Wafer>) {
+    // An enclosure is between two layers and the mask holds only metal;
+    // these rules are checked on layout polygons (runPolygonDRC)
+}
+
 void DRCModel::checkAntennaRules(std::shared_ptr<Wafer> wafer) {
     // Simplified antenna rule checking
     const auto& metal_layers = wafer->getMetalLayers();
@@ -249,6 +644,39 @@ void DRCModel::checkAntennaRules(std::shared_ptr<Wafer> wafer) {
     }
 }
 
+void DRCModel::checkAntennaRules(const NetDatabase& nets, const std::string& gate_layer) {
+    const int gate = nets.layerIndex(gate_layer);
+    if (gate < 0) return;
+    
+    for (const auto& rule : rules_) {
+        if (!rule.enabled || rule.type != ViolationType::ANTENNA_RATIO) continue;
+        const int layer = nets.layerIndex(rule.layer);
+        if (layer < 0) continue;
+        
+        for (int net = 0; net < nets.netCount(); ++net) {
+            const std::size_t gate_area = nets.area(net, gate);
+            if (gate_area == 0) continue;
+            const double antenna_ratio = static_cast<double>(nets.area(net, layer)) / gate_area;
+            if (checkRuleCondition(rule, antenna_ratio)) continue;
+            
+            const NetDatabase::Bounds& box = nets.bounds(net);
+            DRCViolation violation(rule.name, ViolationType::ANTENNA_RATIO,
+                                   {0.5 * (box.row_begin + box.row_end), 0.5 * (box.col_begin + box.col_end)},
+                                   antenna_ratio, rule.max_value);
+            violation.severity = determineViolationSeverity(rule, antenna_ratio);
+            addViolation(violation);
+        }
+    }
+}
+
+void DRCModel::checkAspectRatioRules(std::shared_ptr<Wafer>) {
+    // The mask carries no heights to measure an aspect ratio against
+}
+
+void DRCModel::checkCornerRoundingRules(std::shared_ptr<Wafer>) {
+    // Mask cells have square corners, so there is no rounding to measure
+}
+
 void DRCModel::generateDRCReport(const std::string& filename) const {
     std::ofstream file(filename);
     if (!file.is_open()) {
@@ -278,7 +706,7 @@ void DRCModel::generateDRCReport(const std::string& filename) const {
         const auto& v = violations_[i];
         file << i + 1 << ". " << v.rule_name << " at (" 
              << v.location.first << ", " << v.location.second << ")\n";
-        file << "   " << v.description << "\n";
+        file << "   " << v.text() << "\n";
         if (v.waived) {
             file << "   [WAIVED]\n";
         }
@@ -286,7 +714,7 @@ void DRCModel::generateDRCReport(const std::string& filename) const {
     }
     
     file.close();
-    Logger::getInstance().log("DRC report generated: " + filename);
+    SEMIPRO_LOGF(INFO, VALIDATION, "DRC report generated: {}", filename);
 }
 
 void DRCModel::initializeDefaultRules() {
@@ -302,24 +730,143 @@ std::vector<std::pair<double, double>> DRCModel::extractFeatures(
     std::shared_ptr<Wafer> wafer, const std::string& layer) const {
     
     std::vector<std::pair<double, double>> features;
-    const auto& grid = wafer->getGrid();
-    const auto& photoresist = wafer->getPhotoresistPattern();
     
     // Extract features based on layer type
     if (layer == "metal" || layer == "metal1") {
-        // Extract metal features from photoresist pattern
-        for (int i = 0; i < photoresist.rows(); ++i) {
-            for (int j = 0; j < photoresist.cols(); ++j) {
-                if (photoresist(i, j) > 0.5) {
-                    features.emplace_back(i, j);
-                }
+        // Extract metal features from the bit-packed metal mask; empty
+        // words are skipped without touching individual cells
+        const BitMask mask = metalMask(*wafer);
+        features.reserve(mask.count());
+        mask.forEachSet([&](int i, int j) { features.emplace_back(i, j); });
+    }
+    
+    return features;
+}
+
+const DRCModel::LayerGeometry& DRCModel::layerGeometry(std::shared_ptr<Wafer> wafer, const std::string& layer,
+                                                       LayerMap& layers) const {
+    auto it = layers.find(layer);
+    if (it != layers.end()) {
+        return it->second;
+    }
+    LayerGeometry& geometry = layers[layer];
+    // The layers extractFeatures reads off the photoresist mask
+    if (layer == "metal" || layer == "metal1") {
+        const BitMask mask = metalMask(*wafer);
+        buildLayerGeometry(mask, labelFeatures(mask), layer, {0, mask.rows(), 0, mask.cols()}, geometry);
+        geometry.area = countCells(mask);
+        geometry.cells = static_cast<std::size_t>(mask.rows()) * mask.cols();
+    }
+    return geometry;
+}
+
+void DRCModel::prepareLayers(std::shared_ptr<Wafer> wafer, LayerMap& layers) const {
+    // Entries are made up front so the builds never touch the map
+    std::vector<std::pair<std::string, LayerGeometry*>> masked;
+    for (const auto& rule : rules_) {
+        if (!rule.enabled || layers.count(rule.layer)) continue;
+        LayerGeometry& geometry = layers[rule.layer];
+        if (rule.layer == "metal" || rule.layer == "metal1") masked.emplace_back(rule.layer, &geometry);
+    }
+    if (masked.empty()) return;
+    
+    const BitMask mask = metalMask(*wafer);
+    const MaskFeatures features = labelFeatures(mask);
+    const std::size_t area = countCells(mask);
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(masked.size()), [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            LayerGeometry& geometry = *masked[k].second;
+            buildLayerGeometry(mask, features, masked[k].first, {0, mask.rows(), 0, mask.cols()}, geometry);
+            geometry.area = area;
+            geometry.cells = static_cast<std::size_t>(mask.rows()) * mask.cols();
+        }
+    }, 1);
+}
+
+DRCModel::MaskFeatures DRCModel::labelFeatures(const BitMask& mask) {
+    // Features join each run to the runs it overlaps in the row above
+    MaskFeatures features;
+    const std::vector<MaskRun>& runs = features.runs = mask.runs();
+    std::vector<int>& parent = features.feature;
+    parent.resize(runs.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    const auto find = [&parent](int r) {
+        while (parent[r] != r) {
+            r = parent[r] = parent[parent[r]];
+        }
+        return r;
+    };
+    for (std::size_t r = 0, above = 0, row_start = 0; r < runs.size(); ++r) {
+        if (r > 0 && runs[r].row != runs[r - 1].row) {
+            above = row_start;
+            row_start = r;
+            while (above < row_start && runs[above].row != runs[r].row - 1) ++above;
+        }
+        while (above < row_start && runs[above].col_end <= runs[r].col_begin) ++above;
+        for (std::size_t q = above; q < row_start && runs[q].col_begin < runs[r].col_end; ++q) {
+            if (runs[q].row == runs[r].row - 1 && runs[q].col_end > runs[r].col_begin) {
+                parent[find(static_cast<int>(r))] = find(static_cast<int>(q));
             }
         }
     }
-    
+    for (std::size_t r = 0; r < runs.size(); ++r) {
+        parent[r] = find(static_cast<int>(r));
+    }
     return features;
 }
 
+void DRCModel::buildLayerGeometry(const BitMask& mask, const MaskFeatures& features, const std::string& layer,
+                                  const Window& window, LayerGeometry& geometry) const {
+    const int rows = mask.rows(), cols = mask.cols();
+    const int window_rows = window.row_end - window.row_begin, window_cols = window.col_end - window.col_begin;
+    geometry.row_begin = window.row_begin;
+    geometry.col_begin = window.col_begin;
+    if (window_rows == rows && window_cols == cols) {
+        geometry.edges = EdgeMap::extract(mask);
+    } else {
+        geometry.edges = EdgeMap::extract(BitMask::fromPredicate(window_rows, window_cols, [&](int i, int j) {
+            return mask.test(window.row_begin + i, window.col_begin + j);
+        }));
+    }
+    
+    // Boundary cells face a clear cell; the nearest cells of two features
+    // are always among them
+    int bin_size = 1;
+    for (const auto& rule : rules_) {
+        if (rule.enabled && rule.type == ViolationType::SPACING && rule.layer == layer) {
+            bin_size = std::max(bin_size, static_cast<int>(std::ceil(rule.min_value / cell_size_)));
+        }
+    }
+    std::vector<LayerGeometry::Cell> boundary;
+    const std::vector<MaskRun>& runs = features.runs;
+    auto first = std::lower_bound(runs.begin(), runs.end(), window.row_begin,
+                                  [](const MaskRun& run, int row) { return run.row < row; });
+    for (auto it = first; it != runs.end() && it->row < window.row_end; ++it) {
+        const MaskRun& run = *it;
+        const int feature = features.feature[it - runs.begin()];
+        for (int j = std::max(run.col_begin, window.col_begin); j < std::min(run.col_end, window.col_end); ++j) {
+            const bool edge = (j == run.col_begin && j > 0) || (j + 1 == run.col_end && j + 1 < cols) ||
+                              (run.row > 0 && !mask.test(run.row - 1, j)) ||
+                              (run.row + 1 < rows && !mask.test(run.row + 1, j));
+            if (edge) boundary.push_back({run.row, j, feature});
+        }
+    }
+    
+    // Counting sort into square bins over the window
+    geometry.bin_size = bin_size;
+    geometry.bin_rows = (window_rows + bin_size - 1) / bin_size;
+    geometry.bin_cols = (window_cols + bin_size - 1) / bin_size;
+    geometry.bin_start.assign(static_cast<std::size_t>(geometry.bin_rows) * geometry.bin_cols + 1, 0);
+    const auto bin = [&](const LayerGeometry::Cell& cell) {
+        return ((cell.row - window.row_begin) / bin_size) * geometry.bin_cols + (cell.col - window.col_begin) / bin_size;
+    };
+    for (const auto& cell : boundary) ++geometry.bin_start[bin(cell) + 1];
+    std::partial_sum(geometry.bin_start.begin(), geometry.bin_start.end(), geometry.bin_start.begin());
+    geometry.boundary.resize(boundary.size());
+    std::vector<int> next(geometry.bin_start.begin(), geometry.bin_start.end() - 1);
+    for (const auto& cell : boundary) geometry.boundary[next[bin(cell)]++] = cell;
+}
+
 bool DRCModel::checkRuleCondition(const DRCRule& rule, double measured_value) const {
     switch (rule.type) {
         case ViolationType::WIDTH:
@@ -336,10 +883,21 @@ bool DRCModel::checkRuleCondition(const DRCRule& rule, double measured_value) co
     }
 }
 
+DRCInterface::ViolationSeverity DRCModel::determineViolationSeverity(const DRCRule& rule, double) const {
+    return rule.severity;
+}
+
 void DRCModel::addViolation(const DRCViolation& violation) {
     violations_.push_back(violation);
 }
 
+std::vector<DRCViolation> DRCModel::getViolationsByType(ViolationType type) const {
+    std::vector<DRCViolation> matching;
+    std::copy_if(violations_.begin(), violations_.end(), std::back_inserter(matching),
+                 [type](const DRCViolation& v) { return v.type == type; });
+    return matching;
+}
+
 size_t DRCModel::getCriticalViolationCount() const {
     return std::count_if(violations_.begin(), violations_.end(),
                         [](const DRCViolation& v) {
@@ -349,4 +907,5 @@ size_t DRCModel::getCriticalViolationCount() const {
 
 void DRCModel::clearViolations() {
     violations_.clear();
+    checked_mask_ = BitMask();
 }
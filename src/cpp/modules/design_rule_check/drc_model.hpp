@@ -3,7 +3,9 @@
 #define DRC_MODEL_HPP
 
 #include "drc_interface.hpp"
+#include "../../core/edge_map.hpp"
 #include "../../core/wafer.hpp"
+#include <functional>
 #include <memory>
 #include <vector>
 #include <string>
@@ -34,6 +36,7 @@ struct DRCRule {
     ViolationSeverity severity;
     bool enabled;
     std::string description;
+    std::string enclosing_layer; // Outer layer of ENCLOSURE rules
     
     DRCRule(const std::string& rule_name, ViolationType rule_type,
             const std::string& target_layer, double min_val, double max_val = -1.0)
@@ -49,15 +52,22 @@ struct DRCViolation {
     std::pair<double, double> location;
     double measured_value;
     double required_value;
-    std::string description;
+    std::string description; // Empty when text() is to format it from the measurement
     bool waived;
     
     DRCViolation(const std::string& rule, ViolationType vtype, 
                  const std::pair<double, double>& loc, double measured, double required)
         : rule_name(rule), type(vtype), location(loc), measured_value(measured),
           required_value(required), waived(false) {}
+    
+    // The description, formatted only when read: checks that can report
+    // millions of violations leave it empty
+    std::string text() const;
 };
 
+class PolygonLayer;
+class NetDatabase;
+
 class DRCModel : public DRCInterface {
 public:
     DRCModel();
@@ -71,21 +81,46 @@ public:
     // Technology node configuration
     void loadTechnologyRules(const std::string& technology_node);
     void configureTechnology(double feature_size, double metal_pitch, double via_size);
+    // Side of one photoresist mask cell in um; widths and spacings are
+    // measured in cells and scaled by it
+    void setCellSize(double cell_size);
     
     // DRC checking
     void runFullDRC(std::shared_ptr<Wafer> wafer);
+    // Incremental DRC keeps the violations of the last run and rechecks
+    // width and spacing only around the cells that changed since, and area
+    // and density from the mask's count; with no earlier run on a mask of
+    // the same size, or after a rule or the cell size changed, it runs the
+    // full DRC. A corner spacing rechecked near a change only sees the
+    // straight gaps between the two features near it too, so it may be
+    // reported where a full run finds them closer straight across far
+    // away. This one finds the changed cells by comparing the photoresist
+    // mask with the one last checked, a word at a time.
+    void runIncrementalDRC(std::shared_ptr<Wafer> wafer);
+    // Rechecks around the cells from region_start to region_end, as (row,
+    // column), which the caller vouches hold every change since the last run
     void runIncrementalDRC(std::shared_ptr<Wafer> wafer, 
                           const std::pair<double, double>& region_start,
                           const std::pair<double, double>& region_end);
     void runLayerDRC(std::shared_ptr<Wafer> wafer, const std::string& layer);
+    // Width, spacing, area and enclosure rules checked on layout polygons
+    // by name instead of the wafer's mask cells (see PolygonDRC)
+    void runPolygonDRC(const std::unordered_map<std::string, PolygonLayer>& layers, double tile_size = 0.0);
     
     // Specific rule checks
     void checkWidthRules(std::shared_ptr<Wafer> wafer);
+    // Gaps along the row and column cuts, and the corner-to-corner
+    // distance between features facing each other along neither
     void checkSpacingRules(std::shared_ptr<Wafer> wafer);
     void checkAreaRules(std::shared_ptr<Wafer> wafer);
     void checkEnclosureRules(std::shared_ptr<Wafer> wafer);
     void checkDensityRules(std::shared_ptr<Wafer> wafer);
     void checkAntennaRules(std::shared_ptr<Wafer> wafer);
+    // Antenna ratio net by net: a net's cells on the rule's layer over its
+    // cells on gate_layer, for the nets reaching a gate. Nets come from
+    // LayerConnectivity with the metals, vias and gates of a layout;
+    // rules on layers the nets lack have nothing to check.
+    void checkAntennaRules(const NetDatabase& nets, const std::string& gate_layer);
     void checkAspectRatioRules(std::shared_ptr<Wafer> wafer);
     void checkCornerRoundingRules(std::shared_ptr<Wafer> wafer);
     
@@ -125,6 +160,80 @@ private:
     double feature_size_;
     double metal_pitch_;
     double via_size_;
+    double cell_size_;
+    BitMask checked_mask_; // Metal mask the violations are of, empty when they are not current
+    
+    // Cells [row_begin, row_end) x [col_begin, col_end) of the mask
+    struct Window {
+        int row_begin, row_end;
+        int col_begin, col_end;
+    };
+    // Set-cell runs of a mask and the feature (4-connected) of each
+    struct MaskFeatures {
+        std::vector<MaskRun> runs;
+        std::vector<int> feature;
+    };
+    static MaskFeatures labelFeatures(const BitMask& mask);
+    
+    // Geometry of each layer's mask, extracted once per check run and
+    // shared by every rule on the layer; of a window of the mask when
+    // rechecking around changes
+    struct LayerGeometry {
+        EdgeMap edges;         // Of the window, from its first cell
+        int row_begin = 0;     // Window origin on the mask
+        int col_begin = 0;
+        std::size_t area = 0;  // Set cells
+        std::size_t cells = 0; // Cells of the mask
+        // Boundary cells of the layer's features (4-connected set cells) in
+        // the window, binned from its origin on a square grid wide enough
+        // for the widest spacing rule on the layer: bin b holds
+        // boundary[bin_start[b]] up to boundary[bin_start[b + 1]]
+        struct Cell {
+            int row;
+            int col;
+            int feature;
+        };
+        std::vector<Cell> boundary;
+        std::vector<int> bin_start;
+        int bin_size = 1; // Cells
+        int bin_rows = 0;
+        int bin_cols = 0;
+    };
+    using LayerMap = std::unordered_map<std::string, LayerGeometry>;
+    const LayerGeometry& layerGeometry(std::shared_ptr<Wafer> wafer, const std::string& layer, LayerMap& layers) const;
+    // Geometry of every layer an enabled rule checks, the layers built in
+    // parallel from one labelling and one count of the mask
+    void prepareLayers(std::shared_ptr<Wafer> wafer, LayerMap& layers) const;
+    // Features are labelled over the whole mask, the rest over window
+    void buildLayerGeometry(const BitMask& mask, const MaskFeatures& features, const std::string& layer,
+                            const Window& window, LayerGeometry& geometry) const;
+    void recheckRegions(std::shared_ptr<Wafer> wafer, const std::vector<Window>& regions);
+    
+    // Width and spacing rules run as checks: one rule over one tile of a
+    // layer's runs or gaps, or its corner spacing, each writing its own
+    // violations so that checks run in parallel and merge in list order
+    using Violations = std::vector<DRCViolation>;
+    using Check = std::function<void(Violations&)>;
+    void addWidthChecks(std::shared_ptr<Wafer> wafer, LayerMap& layers, std::vector<Check>& checks) const;
+    void addSpacingChecks(std::shared_ptr<Wafer> wafer, LayerMap& layers, std::vector<Check>& checks) const;
+    // Checks of rule on the runs along rows or columns, a tile of them each
+    void addRunChecks(const DRCRule& rule, const LayerGeometry& layer, std::vector<EdgeRun> runs, bool along_rows,
+                      std::vector<Check>& checks) const;
+    // Runs checks on the task scheduler and appends their violations to
+    // out in the order of checks, whatever order they finish in
+    static void runChecks(const std::vector<Check>& checks, Violations& out);
+    void checkWidthRules(std::shared_ptr<Wafer> wafer, LayerMap& layers);
+    void checkSpacingRules(std::shared_ptr<Wafer> wafer, LayerMap& layers);
+    void checkAreaRules(std::shared_ptr<Wafer> wafer, LayerMap& layers);
+    void checkDensityRules(std::shared_ptr<Wafer> wafer, LayerMap& layers);
+    // Violations of rule by runs [begin, end) along rows or columns of
+    // layer's edges
+    void checkRuns(const DRCRule& rule, const LayerGeometry& layer, const EdgeRun* begin, const EdgeRun* end,
+                   bool along_rows, Violations& out) const;
+    // Pairs of features closer than rule allows only across a corner, the
+    // nearest cells of each pair found through the layer's bins, bin rows
+    // searched in parallel
+    void checkCornerSpacing(const DRCRule& rule, const LayerGeometry& layer, Violations& out) const;
     
     // Helper methods
     void initializeDefaultRules();
@@ -136,9 +245,6 @@ private:
     // Geometric analysis
     std::vector<std::pair<double, double>> extractFeatures(std::shared_ptr<Wafer> wafer,
                                                           const std::string& layer) const;
-    double measureWidth(const std::vector<std::pair<double, double>>& features) const;
-    double measureSpacing(const std::vector<std::pair<double, double>>& features) const;
-    double measureArea(const std::vector<std::pair<double, double>>& features) const;
     
     // Violation detection
     void addViolation(const DRCViolation& violation);
@@ -0,0 +1,605 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "polygon_drc.hpp"
+#include "../../core/task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+struct Vec {
+    double x, y;
+};
+
+Vec operator-(Vec a, Vec b) { return {a.x - b.x, a.y - b.y}; }
+Vec operator+(Vec a, Vec b) { return {a.x + b.x, a.y + b.y}; }
+Vec operator*(double s, Vec a) { return {s * a.x, s * a.y}; }
+double dot(Vec a, Vec b) { return a.x * b.x + a.y * b.y; }
+double cross(Vec a, Vec b) { return a.x * b.y - a.y * b.x; }
+double length(Vec a) { return std::hypot(a.x, a.y); }
+
+Vec origin(const LayoutEdge& e) { return {e.x0, e.y0}; }
+Vec target(const LayoutEdge& e) { return {e.x1, e.y1}; }
+// Unit normal toward the edge's inside
+Vec inward(const LayoutEdge& e) {
+    const Vec d = target(e) - origin(e);
+    const double n = length(d);
+    return {-d.y / n, d.x / n};
+}
+
+struct Box {
+    double x0, y0, x1, y1;
+};
+
+Box bounds(const LayoutEdge& e) {
+    return {std::min(e.x0, e.x1), std::min(e.y0, e.y1), std::max(e.x0, e.x1), std::max(e.y0, e.y1)};
+}
+
+// Largest coordinate magnitude, for tolerances relative to the layout
+double layoutScale(const std::vector<LayoutEdge>& edges) {
+    double scale = 1.0;
+    for (const auto& e : edges) {
+        scale = std::max({scale, std::abs(e.x0), std::abs(e.y0), std::abs(e.x1), std::abs(e.y1)});
+    }
+    return scale;
+}
+
+// Point of segment [a, b] nearest to p
+Vec nearestOn(Vec p, Vec a, Vec b) {
+    const Vec d = b - a;
+    const double dd = dot(d, d);
+    const double t = dd > 0.0 ? std::clamp(dot(p - a, d) / dd, 0.0, 1.0) : 0.0;
+    return a + t * d;
+}
+
+struct Nearest {
+    Vec p; // On the first segment
+    Vec q; // On the second
+    double distance;
+};
+
+// Nearest points of two segments. Parallel segments whose projections
+// overlap are measured at the middle of the overlap, where a check
+// reports them; crossing or touching segments are 0 apart.
+Nearest nearest(Vec a0, Vec a1, Vec b0, Vec b1, double tolerance) {
+    const Vec da = a1 - a0, db = b1 - b0;
+    const double la = length(da), lb = length(db);
+    const double denom = cross(da, db);
+    if (std::abs(denom) <= 1e-12 * la * lb) {
+        const double t0 = dot(b0 - a0, da) / (la * la), t1 = dot(b1 - a0, da) / (la * la);
+        const double lo = std::max(0.0, std::min(t0, t1)), hi = std::min(1.0, std::max(t0, t1));
+        if (hi - lo > tolerance / la) {
+            const Vec p = a0 + (0.5 * (lo + hi)) * da;
+            const Vec q = nearestOn(p, b0, b1);
+            return {p, q, length(q - p)};
+        }
+    } else {
+        const double t = cross(b0 - a0, db) / denom, u = cross(b0 - a0, da) / denom;
+        if (t >= 0.0 && t <= 1.0 && u >= 0.0 && u <= 1.0) {
+            const Vec p = a0 + t * da;
+            return {p, p, 0.0};
+        }
+    }
+    Nearest best{a0, nearestOn(a0, b0, b1), 0.0};
+    best.distance = length(best.q - best.p);
+    const auto consider = [&best](Vec p, Vec q) {
+        const double distance = length(q - p);
+        if (distance < best.distance) {
+            best = {p, q, distance};
+        }
+    };
+    consider(a1, nearestOn(a1, b0, b1));
+    consider(nearestOn(b0, a0, a1), b0);
+    consider(nearestOn(b1, a0, a1), b1);
+    return best;
+}
+
+// Closed polygon with its points counterclockwise
+struct Ring {
+    std::vector<Vec> points;
+    Box box;
+};
+
+bool insideEvenOdd(const Ring& ring, Vec p) {
+    bool inside = false;
+    const std::size_t n = ring.points.size();
+    for (std::size_t k = 0, prev = n - 1; k < n; prev = k++) {
+        const Vec a = ring.points[prev], b = ring.points[k];
+        if ((a.y > p.y) != (b.y > p.y) && p.x < a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y)) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+// Whether ring `other` hides point p of an edge of ring `own` running
+// along direction d: p is inside it, on an edge of it running the other
+// way (the shapes abut), or on one running the same way in a ring listed
+// first (duplicate outlines keep one copy)
+bool covers(const Ring& other, int other_index, int own_index, Vec p, Vec d, double tolerance) {
+    const std::size_t n = other.points.size();
+    for (std::size_t k = 0, prev = n - 1; k < n; prev = k++) {
+        const Vec a = other.points[prev], b = other.points[k];
+        if (length(nearestOn(p, a, b) - p) > tolerance) {
+            continue;
+        }
+        const Vec h = b - a;
+        if (std::abs(cross(d, h)) <= 1e-9 * length(d) * length(h)) {
+            return dot(d, h) < 0.0 || other_index < own_index;
+        }
+    }
+    return insideEvenOdd(other, p);
+}
+
+// Point at parameter t along a -> b, snapped onto the axis-aligned lines
+// it lies on so that Manhattan outlines meet exactly
+Vec pointAt(Vec a, Vec b, double t) {
+    Vec p = a + t * (b - a);
+    if (a.x == b.x) p.x = a.x;
+    if (a.y == b.y) p.y = a.y;
+    return p;
+}
+
+// Where the other rings' edges cross or join the edge a -> b of a ring,
+// as (parameter, point) pairs strictly inside it
+void splitPoints(Vec a, Vec b, const Ring& other, double tolerance, std::vector<std::pair<double, Vec>>& splits) {
+    const Vec d = b - a;
+    const double ld = length(d);
+    const std::size_t n = other.points.size();
+    for (std::size_t k = 0, prev = n - 1; k < n; prev = k++) {
+        const Vec g0 = other.points[prev], g1 = other.points[k];
+        const Vec h = g1 - g0;
+        const double denom = cross(d, h);
+        if (std::abs(denom) > 1e-12 * ld * length(h)) {
+            const double t = cross(g0 - a, h) / denom, u = cross(g0 - a, d) / denom;
+            const double margin = tolerance / length(h);
+            if (t * ld <= tolerance || (1.0 - t) * ld <= tolerance || u < -margin || u > 1.0 + margin) {
+                continue;
+            }
+            Vec p = u <= margin ? g0 : u >= 1.0 - margin ? g1 : pointAt(a, b, t);
+            if (g0.x == g1.x) p.x = g0.x;
+            if (g0.y == g1.y) p.y = g0.y;
+            splits.push_back({t, p});
+        } else if (std::abs(cross(g0 - a, d)) <= tolerance * ld) {
+            // Collinear: the other edge's ends split this one
+            for (const Vec& g : {g0, g1}) {
+                const double t = dot(g - a, d) / (ld * ld);
+                if (t * ld > tolerance && (1.0 - t) * ld > tolerance) {
+                    splits.push_back({t, g});
+                }
+            }
+        }
+    }
+}
+
+bool overlaps(const Box& a, const Box& b, double margin) {
+    return a.x0 <= b.x1 + margin && b.x0 <= a.x1 + margin && a.y0 <= b.y1 + margin && b.y0 <= a.y1 + margin;
+}
+
+// Pairs of boxes that overlap, by sweeping their left sides in x
+std::vector<std::vector<int>> overlappingBoxes(const std::vector<Box>& boxes, double margin) {
+    std::vector<int> order(boxes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&boxes](int a, int b) { return boxes[a].x0 < boxes[b].x0; });
+    std::vector<std::vector<int>> neighbours(boxes.size());
+    std::vector<int> active;
+    for (int k : order) {
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [&](int a) { return boxes[a].x1 + margin < boxes[k].x0; }),
+                     active.end());
+        for (int a : active) {
+            if (overlaps(boxes[a], boxes[k], margin)) {
+                neighbours[a].push_back(k);
+                neighbours[k].push_back(a);
+            }
+        }
+        active.push_back(k);
+    }
+    return neighbours;
+}
+
+} // namespace
+
+PolygonLayer PolygonLayer::fromPolygons(const std::vector<SemiPRO::GDSPolygon>& polygons) {
+    std::vector<Ring> rings;
+    rings.reserve(polygons.size());
+    double scale = 1.0;
+    for (const auto& polygon : polygons) {
+        Ring ring;
+        for (const auto& [x, y] : polygon.points) {
+            const Vec p{x, y};
+            if (ring.points.empty() || p.x != ring.points.back().x || p.y != ring.points.back().y) {
+                ring.points.push_back(p);
+            }
+        }
+        while (ring.points.size() > 1 && ring.points.front().x == ring.points.back().x &&
+               ring.points.front().y == ring.points.back().y) {
+            ring.points.pop_back();
+        }
+        if (ring.points.size() < 3) continue;
+
+        double area = 0.0;
+        ring.box = {ring.points[0].x, ring.points[0].y, ring.points[0].x, ring.points[0].y};
+        for (std::size_t k = 0, prev = ring.points.size() - 1; k < ring.points.size(); prev = k++) {
+            const Vec p = ring.points[k];
+            area += cross(ring.points[prev], p);
+            ring.box = {std::min(ring.box.x0, p.x), std::min(ring.box.y0, p.y), std::max(ring.box.x1, p.x),
+                        std::max(ring.box.y1, p.y)};
+            scale = std::max({scale, std::abs(p.x), std::abs(p.y)});
+        }
+        if (area == 0.0) continue;
+        if (area < 0.0) {
+            std::reverse(ring.points.begin(), ring.points.end());
+        }
+        rings.push_back(std::move(ring));
+    }
+
+    // Each edge is split where other rings' edges cross or join it, and
+    // the pieces no other ring covers are the merged outline
+    const double tolerance = 1e-9 * scale;
+    std::vector<Box> boxes(rings.size());
+    std::transform(rings.begin(), rings.end(), boxes.begin(), [](const Ring& ring) { return ring.box; });
+    const std::vector<std::vector<int>> neighbours = overlappingBoxes(boxes, tolerance);
+    std::vector<std::vector<LayoutEdge>> pieces(rings.size());
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(rings.size()), [&](int begin, int end) {
+        std::vector<std::pair<double, Vec>> splits;
+        for (int r = begin; r < end; ++r) {
+            const Ring& ring = rings[r];
+            for (std::size_t k = 0, prev = ring.points.size() - 1; k < ring.points.size(); prev = k++) {
+                const Vec a = ring.points[prev], b = ring.points[k];
+                const Box box{std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x), std::max(a.y, b.y)};
+                splits.assign({{0.0, a}, {1.0, b}});
+                std::vector<int> near;
+                for (int other : neighbours[r]) {
+                    if (overlaps(box, rings[other].box, tolerance)) {
+                        near.push_back(other);
+                        splitPoints(a, b, rings[other], tolerance, splits);
+                    }
+                }
+                std::sort(splits.begin(), splits.end(),
+                          [](const auto& s, const auto& t) { return s.first < t.first; });
+
+                // Runs of uncovered pieces become single edges
+                bool open = false;
+                Vec from{};
+                for (std::size_t s = 1; s < splits.size(); ++s) {
+                    if ((splits[s].first - splits[s - 1].first) * length(b - a) <= tolerance) continue;
+                    const Vec middle = pointAt(a, b, 0.5 * (splits[s - 1].first + splits[s].first));
+                    const bool hidden = std::any_of(near.begin(), near.end(), [&](int other) {
+                        return covers(rings[other], other, r, middle, b - a, tolerance);
+                    });
+                    if (!hidden && !open) {
+                        from = splits[s - 1].second;
+                        open = true;
+                    } else if (hidden && open) {
+                        pieces[r].push_back({from.x, from.y, splits[s - 1].second.x, splits[s - 1].second.y, -1});
+                        open = false;
+                    }
+                }
+                if (open) {
+                    pieces[r].push_back({from.x, from.y, b.x, b.y, -1});
+                }
+            }
+        }
+    }, 1);
+
+    PolygonLayer layer;
+    for (const auto& ring_pieces : pieces) {
+        layer.edges_.insert(layer.edges_.end(), ring_pieces.begin(), ring_pieces.end());
+    }
+    layer.close();
+    return layer;
+}
+
+PolygonLayer PolygonLayer::fromEdgeMap(const EdgeMap& edges, double cell_size) {
+    if (!(cell_size > 0.0)) {
+        throw std::invalid_argument("PolygonLayer: cell size must be positive");
+    }
+    PolygonLayer layer;
+    layer.edges_.reserve(edges.segments().size());
+    for (const auto& segment : edges.segments()) {
+        layer.edges_.push_back({segment.from.row * cell_size, segment.from.col * cell_size, segment.to.row * cell_size,
+                                segment.to.col * cell_size, -1});
+    }
+    layer.close();
+    return layer;
+}
+
+void PolygonLayer::close() {
+    // Edge starts by position, snapped to a grid far finer than any rule
+    const double snap = 1e-9 * layoutScale(edges_);
+    using Key = std::pair<std::int64_t, std::int64_t>;
+    const auto key = [snap](double x, double y) { return Key{std::llround(x / snap), std::llround(y / snap)}; };
+    std::vector<std::pair<Key, int>> starts(edges_.size());
+    for (std::size_t e = 0; e < edges_.size(); ++e) {
+        starts[e] = {key(edges_[e].x0, edges_[e].y0), static_cast<int>(e)};
+    }
+    std::sort(starts.begin(), starts.end());
+
+    next_.assign(edges_.size(), -1);
+    std::vector<char> taken(edges_.size(), 0);
+    for (std::size_t e = 0; e < edges_.size(); ++e) {
+        const Key at = key(edges_[e].x1, edges_[e].y1);
+        for (auto it = std::lower_bound(starts.begin(), starts.end(), std::make_pair(at, -1));
+             it != starts.end() && it->first == at; ++it) {
+            if (!taken[it->second]) {
+                taken[it->second] = 1;
+                next_[e] = it->second;
+                break;
+            }
+        }
+    }
+
+    // Straight runs of edges become one edge: merged polygons and marching
+    // squares both leave outlines cut where they do not turn
+    std::vector<int> previous(edges_.size(), -1);
+    for (std::size_t e = 0; e < edges_.size(); ++e) {
+        if (next_[e] >= 0) previous[next_[e]] = static_cast<int>(e);
+    }
+    const auto straight = [this](int a, int b) {
+        const Vec da = target(edges_[a]) - origin(edges_[a]), db = target(edges_[b]) - origin(edges_[b]);
+        return dot(da, db) > 0.0 && std::abs(cross(da, db)) <= 1e-12 * length(da) * length(db);
+    };
+    std::vector<int> merged_index(edges_.size(), -1);
+    std::vector<int> run_last;
+    std::vector<LayoutEdge> merged;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (std::size_t first = 0; first < edges_.size(); ++first) {
+            const int e = static_cast<int>(first);
+            // Runs start after a turn; a second pass takes what is left
+            if (merged_index[e] >= 0 || (pass == 0 && previous[e] >= 0 && straight(previous[e], e))) continue;
+            int last = e;
+            merged_index[e] = static_cast<int>(merged.size());
+            while (next_[last] >= 0 && merged_index[next_[last]] < 0 && straight(last, next_[last])) {
+                last = next_[last];
+                merged_index[last] = static_cast<int>(merged.size());
+            }
+            merged.push_back({edges_[e].x0, edges_[e].y0, edges_[last].x1, edges_[last].y1, -1});
+            run_last.push_back(last);
+        }
+    }
+    std::vector<int> merged_next(merged.size());
+    for (std::size_t m = 0; m < merged.size(); ++m) {
+        const int after = next_[run_last[m]];
+        merged_next[m] = after >= 0 ? merged_index[after] : -1;
+    }
+    edges_ = std::move(merged);
+    next_ = std::move(merged_next);
+
+    // Outlines are the chains that come back to where they began
+    areas_.clear();
+    std::vector<char> seen(edges_.size(), 0);
+    std::vector<int> chain;
+    for (std::size_t first = 0; first < edges_.size(); ++first) {
+        if (seen[first]) continue;
+        chain.clear();
+        int e = static_cast<int>(first);
+        while (e >= 0 && !seen[e]) {
+            seen[e] = 1;
+            chain.push_back(e);
+            e = next_[e];
+        }
+        if (e != static_cast<int>(first)) continue; // Open: outline stays -1
+        double area = 0.0;
+        for (int c : chain) {
+            edges_[c].outline = static_cast<int>(areas_.size());
+            area += 0.5 * cross(origin(edges_[c]), target(edges_[c]));
+        }
+        areas_.push_back(area);
+    }
+}
+
+std::vector<DRCViolation> PolygonDRC::check(const std::vector<DRCRule>& rules, const PolygonLayers& layers,
+                                            double tile_size) {
+    // Layers the rules name, and the rules applying to each pair of them
+    std::vector<const PolygonLayer*> used;
+    std::unordered_map<std::string, int> ids;
+    const auto id = [&](const std::string& name) {
+        auto found = layers.find(name);
+        if (found == layers.end()) return -1;
+        auto it = ids.emplace(name, static_cast<int>(used.size()));
+        if (it.second) used.push_back(&found->second);
+        return it.first->second;
+    };
+    struct Applied {
+        int rule;
+        int inner; // Layer of the inner (or only) edge
+        int outer;
+    };
+    std::vector<Applied> applied;
+    std::vector<DRCViolation> violations;
+    for (std::size_t r = 0; r < rules.size(); ++r) {
+        const DRCRule& rule = rules[r];
+        if (!rule.enabled) continue;
+        if (rule.type == ViolationType::WIDTH || rule.type == ViolationType::SPACING) {
+            const int layer = id(rule.layer);
+            if (layer >= 0) applied.push_back({static_cast<int>(r), layer, layer});
+        } else if (rule.type == ViolationType::ENCLOSURE) {
+            const int inner = id(rule.layer), outer = id(rule.enclosing_layer);
+            if (inner >= 0 && outer >= 0 && inner != outer) applied.push_back({static_cast<int>(r), inner, outer});
+        }
+    }
+    const int count = static_cast<int>(used.size());
+    std::vector<double> reach(static_cast<std::size_t>(count) * count, 0.0);
+    double widest = 0.0;
+    for (const auto& a : applied) {
+        const double distance = rules[a.rule].min_value;
+        for (int k : {a.inner * count + a.outer, a.outer * count + a.inner}) reach[k] = std::max(reach[k], distance);
+        widest = std::max(widest, distance);
+    }
+
+    // Tiles over all the edges, each gathering those within reach of it
+    struct Ref {
+        int layer;
+        int edge;
+        Box box;
+    };
+    std::vector<Ref> refs;
+    double scale = 1.0;
+    for (int l = 0; l < count; ++l) {
+        const auto& edges = used[l]->edges();
+        scale = std::max(scale, layoutScale(edges));
+        for (std::size_t e = 0; e < edges.size(); ++e) refs.push_back({l, static_cast<int>(e), bounds(edges[e])});
+    }
+    const double tolerance = 1e-9 * scale;
+    if (!applied.empty() && !refs.empty()) {
+        Box all = refs[0].box;
+        for (const auto& ref : refs) {
+            all = {std::min(all.x0, ref.box.x0), std::min(all.y0, ref.box.y0), std::max(all.x1, ref.box.x1),
+                   std::max(all.y1, ref.box.y1)};
+        }
+        if (!(tile_size > 0.0)) {
+            const int wanted = 4 * TaskScheduler::getInstance().threadCount();
+            tile_size = std::max(all.x1 - all.x0, all.y1 - all.y0) / std::ceil(std::sqrt(std::max(wanted, 1)));
+        }
+        tile_size = std::max({tile_size, 4.0 * widest, tolerance});
+        const int tiles_x = static_cast<int>(std::floor((all.x1 - all.x0) / tile_size)) + 1;
+        const int tiles_y = static_cast<int>(std::floor((all.y1 - all.y0) / tile_size)) + 1;
+        const auto tileOf = [&](double v, double low, int tiles) {
+            return std::clamp(static_cast<int>(std::floor((v - low) / tile_size)), 0, tiles - 1);
+        };
+        std::vector<std::vector<int>> tiled(static_cast<std::size_t>(tiles_x) * tiles_y);
+        for (std::size_t k = 0; k < refs.size(); ++k) {
+            const Box& b = refs[k].box;
+            for (int tx = tileOf(b.x0 - widest, all.x0, tiles_x); tx <= tileOf(b.x1 + widest, all.x0, tiles_x); ++tx) {
+                for (int ty = tileOf(b.y0 - widest, all.y0, tiles_y); ty <= tileOf(b.y1 + widest, all.y0, tiles_y);
+                     ++ty) {
+                    tiled[tx * tiles_y + ty].push_back(static_cast<int>(k));
+                }
+            }
+        }
+
+        struct Found {
+            int rule;
+            Vec p, q;
+            double distance;
+            std::pair<std::int64_t, std::int64_t> outlines; // Layer and outline of each side, for clustering
+        };
+        std::vector<std::vector<Found>> found(tiled.size());
+        TaskScheduler::getInstance().parallelFor(0, static_cast<int>(tiled.size()), [&](int begin, int end) {
+            for (int t = begin; t < end; ++t) {
+                std::vector<int>& members = tiled[t];
+                std::sort(members.begin(), members.end(),
+                          [&refs](int a, int b) { return refs[a].box.x0 < refs[b].box.x0; });
+                std::vector<int> active;
+                for (int k : members) {
+                    active.erase(std::remove_if(active.begin(), active.end(),
+                                                [&](int a) { return refs[a].box.x1 + widest < refs[k].box.x0; }),
+                                 active.end());
+                    for (int other : active) {
+                        // Each pair measured the same way round whatever the tiling
+                        const Ref& ea = refs[std::min(other, k)];
+                        const Ref& ek = refs[std::max(other, k)];
+                        const double r = reach[ea.layer * count + ek.layer];
+                        if (!(r > 0.0) || !overlaps(ea.box, ek.box, r)) continue;
+                        const PolygonLayer& la = *used[ea.layer];
+                        if (ea.layer == ek.layer && (la.next_[ea.edge] == ek.edge || la.next_[ek.edge] == ea.edge)) {
+                            continue; // Neighbours along an outline
+                        }
+                        const LayoutEdge& e = la.edges_[ea.edge];
+                        const LayoutEdge& f = used[ek.layer]->edges_[ek.edge];
+                        const Nearest n = nearest(origin(e), target(e), origin(f), target(f), tolerance);
+                        if (n.distance <= tolerance || n.distance >= r) continue;
+                        // Only the tile holding the midpoint keeps it
+                        const Vec middle = 0.5 * (n.p + n.q);
+                        if (tileOf(middle.x, all.x0, tiles_x) * tiles_y + tileOf(middle.y, all.y0, tiles_y) != t) {
+                            continue;
+                        }
+                        const Vec v = n.q - n.p, ne = inward(e), nf = inward(f);
+                        const double facing = dot(ne, nf);
+                        for (const auto& ap : applied) {
+                            const DRCRule& rule = rules[ap.rule];
+                            if (n.distance >= rule.min_value) continue;
+                            bool hit = false;
+                            if (ap.inner == ap.outer) {
+                                if (ap.inner != ea.layer || ek.layer != ea.layer || !(facing < 0.0)) continue;
+                                // Insides face each other across a width, outsides across a space
+                                hit = rule.type == ViolationType::WIDTH ? dot(v, ne) > 0.0 && dot(v, nf) < 0.0
+                                                                        : dot(v, ne) < 0.0 && dot(v, nf) > 0.0;
+                            } else if (ap.inner == ea.layer && ap.outer == ek.layer) {
+                                // The outer edge beyond the inner one, both facing out
+                                hit = facing > 0.0 && dot(v, ne) < 0.0 && dot(v, nf) < 0.0;
+                            } else if (ap.inner == ek.layer && ap.outer == ea.layer) {
+                                hit = facing > 0.0 && dot(v, nf) > 0.0 && dot(v, ne) > 0.0;
+                            }
+                            if (!hit) continue;
+                            const std::int64_t side_a = (std::int64_t{ea.layer} << 32) + e.outline + 1;
+                            const std::int64_t side_b = (std::int64_t{ek.layer} << 32) + f.outline + 1;
+                            found[t].push_back({ap.rule, n.p, n.q, n.distance, std::minmax(side_a, side_b)});
+                        }
+                    }
+                    active.push_back(k);
+                }
+                std::sort(found[t].begin(), found[t].end(), [](const Found& a, const Found& b) {
+                    const Vec ma = 0.5 * (a.p + a.q), mb = 0.5 * (b.p + b.q);
+                    return std::tie(ma.x, ma.y, a.rule, a.distance) < std::tie(mb.x, mb.y, b.rule, b.distance);
+                });
+            }
+        }, 1);
+
+        // Edge pairs of the same two outlines within a rule's distance of
+        // each other (the facets of one chamfered or rounded corner, or
+        // pairs meeting at the same corners) report one spot, at the
+        // closest of them; clusters may straddle tiles
+        std::vector<Found> all_found;
+        for (const auto& list : found) all_found.insert(all_found.end(), list.begin(), list.end());
+        std::vector<int> closest(all_found.size());
+        std::iota(closest.begin(), closest.end(), 0);
+        std::sort(closest.begin(), closest.end(), [&all_found](int a, int b) {
+            // Ties go by position, so the tiling does not change the choice
+            const Found &fa = all_found[a], &fb = all_found[b];
+            const Vec ma = fa.p + fa.q, mb = fb.p + fb.q;
+            return std::tie(fa.rule, fa.outlines, fa.distance, ma.x, ma.y) <
+                   std::tie(fb.rule, fb.outlines, fb.distance, mb.x, mb.y);
+        });
+        std::vector<int> kept;
+        std::size_t group = 0;
+        for (std::size_t k = 0; k < closest.size(); ++k) {
+            const Found& f = all_found[closest[k]];
+            if (k > 0 && (f.rule != all_found[closest[k - 1]].rule || f.outlines != all_found[closest[k - 1]].outlines)) {
+                group = kept.size();
+            }
+            const Vec middle = 0.5 * (f.p + f.q);
+            const bool near = std::any_of(kept.begin() + group, kept.end(), [&](int other) {
+                return length(0.5 * (all_found[other].p + all_found[other].q) - middle) < rules[f.rule].min_value;
+            });
+            if (!near) kept.push_back(closest[k]);
+        }
+        std::sort(kept.begin(), kept.end());
+        for (int k : kept) {
+            const Found& f = all_found[k];
+            const DRCRule& rule = rules[f.rule];
+            const Vec middle = 0.5 * (f.p + f.q);
+            violations.emplace_back(rule.name, rule.type, std::make_pair(middle.x, middle.y), f.distance,
+                                    rule.min_value);
+        }
+    }
+
+    // Area rules, outline by outline at each outline's centroid
+    for (const auto& rule : rules) {
+        if (!rule.enabled || rule.type != ViolationType::AREA) continue;
+        auto it = layers.find(rule.layer);
+        if (it == layers.end()) continue;
+        const PolygonLayer& layer = it->second;
+        std::vector<Vec> moment(layer.areas().size(), Vec{0.0, 0.0});
+        for (const auto& e : layer.edges()) {
+            if (e.outline < 0) continue;
+            const double c = cross(origin(e), target(e));
+            moment[e.outline] = moment[e.outline] + (c / 6.0) * (origin(e) + target(e));
+        }
+        for (std::size_t o = 0; o < layer.areas().size(); ++o) {
+            const double area = layer.areas()[o];
+            if (area > 0.0 && area < rule.min_value) {
+                violations.emplace_back(rule.name, rule.type,
+                                        std::make_pair(moment[o].x / area, moment[o].y / area), area,
+                                        rule.min_value);
+            }
+        }
+    }
+    return violations;
+}
@@ -0,0 +1,73 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef POLYGON_DRC_HPP
+#define POLYGON_DRC_HPP
+
+#include "drc_model.hpp"
+#include "../../core/edge_map.hpp"
+#include "../../integration/gds_library.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Straight piece of a layer's outline in layout units, running with the
+// layer's inside on its left
+struct LayoutEdge {
+    double x0, y0, x1, y1;
+    int outline; // Index into PolygonLayer::areas(), -1 when the outline does not close
+};
+
+// A layer as the directed edges of its outlines, the input of the
+// polygon DRC engine instead of grid cells
+class PolygonLayer {
+public:
+    PolygonLayer() = default;
+
+    // Polygons from the GDS importer, merged: only the parts of each edge
+    // outside every other polygon are kept, so overlapping and abutting
+    // shapes (path segments, boxes over boundaries) check as one
+    static PolygonLayer fromPolygons(const std::vector<SemiPRO::GDSPolygon>& polygons);
+    // Marching-squares contour, rows along x and columns along y as the
+    // wafer grid's, cell centres cell_size apart
+    static PolygonLayer fromEdgeMap(const EdgeMap& edges, double cell_size);
+
+    const std::vector<LayoutEdge>& edges() const { return edges_; }
+    // Area enclosed by each closed outline, negative for holes
+    const std::vector<double>& areas() const { return areas_; }
+
+private:
+    // Chains edges end to start into outlines and measures them
+    void close();
+
+    std::vector<LayoutEdge> edges_;
+    std::vector<int> next_; // Edge following each one along its outline, -1 if none
+    std::vector<double> areas_;
+
+    friend class PolygonDRC;
+};
+
+using PolygonLayers = std::unordered_map<std::string, PolygonLayer>;
+
+// Scanline DRC over layout edges. Width and spacing rules on a layer and
+// the enclosure rules around it are checked in one sweep of the edges in
+// x: an edge is compared only with the edges still within the largest
+// rule distance, each pair's nearest points measured once and classified
+// by which sides of the two edges face each other. Area rules read the
+// outlines' areas. The layout is split into tiles swept in parallel, each
+// also seeing the edges within that distance of it, and a violation is
+// kept only by the tile holding the midpoint of its nearest points, so
+// violations across tile boundaries are reported exactly once.
+class PolygonDRC {
+public:
+    // Violations of the enabled WIDTH, SPACING, AREA and ENCLOSURE rules:
+    // those of the sweep tile by tile and by position within a tile, then
+    // the AREA ones outline by outline (an outline's area being all it
+    // encloses, holes included). An ENCLOSURE rule's layer is the inner
+    // one and enclosing_layer the outer; it catches outer edges too close
+    // outside inner ones, not inner shapes crossing the outer outline.
+    // tile_size <= 0 picks about four tiles per thread. Layers the rules
+    // name but layers lacks have nothing to check.
+    static std::vector<DRCViolation> check(const std::vector<DRCRule>& rules, const PolygonLayers& layers,
+                                           double tile_size = 0.0);
+};
+
+#endif // POLYGON_DRC_HPP
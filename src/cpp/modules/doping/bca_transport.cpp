@@ -0,0 +1,274 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "bca_transport.hpp"
+#include "../../core/philox.hpp"
+#include "../../core/progress_events.hpp"
+#include "../../core/task_scheduler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+
+namespace {
+
+constexpr double kBohrRadius = 0.52918; // Angstrom
+constexpr double kCoulomb = 14.3996;    // e^2 in eV Angstrom
+constexpr double kRestEnergy = 5.0;     // eV; slower ions are at rest
+constexpr std::uint32_t kMaxCollisions = 1u << 24;
+// Ions per scheduler task: a fixed split, so the fold order is fixed too
+constexpr int kBatchesPerTask = 16;
+
+// ZBL universal screening function and its derivative
+inline void screening(double x, double& phi, double& dphi) {
+  static constexpr double kC[4] = {0.18175, 0.50986, 0.28022, 0.028171};
+  static constexpr double kD[4] = {3.1998, 0.94229, 0.4029, 0.20162};
+  phi = 0.0;
+  dphi = 0.0;
+  for (int k = 0; k < 4; ++k) {
+    const double term = kC[k] * std::exp(-kD[k] * x);
+    phi += term;
+    dphi -= kD[k] * term;
+  }
+}
+
+// Centre-of-mass cos(theta/2) for reduced energy eps and reduced impact
+// parameter b, by the magic formula with ZBL constants
+double magicCosHalfAngle(double eps, double b) {
+  // Closest approach: Newton from the bare-Coulomb root, which lies
+  // beyond the screened one
+  double r = 0.5 / eps + std::sqrt(0.25 / (eps * eps) + b * b);
+  double phi, dphi;
+  for (int iteration = 0; iteration < 50; ++iteration) {
+    screening(r, phi, dphi);
+    const double f = 1.0 - phi / (r * eps) - b * b / (r * r);
+    const double df = phi / (r * r * eps) - dphi / (r * eps) + 2.0 * b * b / (r * r * r);
+    const double step = f / df;
+    r = step < r ? r - step : 0.5 * r;
+    if (std::abs(step) < 1e-6 * r) {
+      break;
+    }
+  }
+  screening(r, phi, dphi);
+  const double v = phi / r;
+  const double dv = dphi / r - phi / (r * r);
+  const double rho = -2.0 * (eps - v) / dv;
+
+  const double root_eps = std::sqrt(eps);
+  const double alpha = 1.0 + 0.99229 / root_eps;
+  const double beta = (0.011615 + root_eps) / (0.0071222 + root_eps);
+  const double gamma = (9.3066 + eps) / (14.813 + eps);
+  const double a = 2.0 * alpha * eps * std::pow(b, beta);
+  const double g = gamma * (std::sqrt(1.0 + a * a) - a);
+  const double delta = a * (r - b) * g / (1.0 + g);
+  return std::clamp((b + rho + delta) / (r + rho), 0.0, 1.0);
+}
+
+// A batch of ions, one array per coordinate
+struct Batch {
+  double x[BCATransport::kBatch];
+  double y[BCATransport::kBatch];
+  double z[BCATransport::kBatch];
+  double ux[BCATransport::kBatch];
+  double uy[BCATransport::kBatch];
+  double uz[BCATransport::kBatch];
+  double energy[BCATransport::kBatch];
+  std::uint32_t collisions[BCATransport::kBatch];
+  int live[BCATransport::kBatch];
+  int live_count;
+};
+
+} // namespace
+
+BCATransport::BCATransport(const Target& target, std::uint64_t seed) : target_(target), seed_(seed) {}
+
+double BCATransport::displacements(double recoil_energy, const Target& target) {
+  if (recoil_energy < target.displacement_energy) {
+    return 0.0;
+  }
+  // Lindhard partition of the recoil energy into nuclear motion
+  const double z = target.atomic_number;
+  const double reduced = 0.01014 * std::pow(z, -7.0 / 3.0) * recoil_energy;
+  const double k = 0.1337 * std::pow(z, 1.0 / 6.0) * std::sqrt(z / target.atomic_mass);
+  const double g = 3.4008 * std::pow(reduced, 1.0 / 6.0) + 0.40244 * std::pow(reduced, 0.75) + reduced;
+  const double damage_energy = recoil_energy / (1.0 + k * g);
+
+  const double threshold = target.displacement_energy;
+  if (damage_energy < threshold) {
+    return 0.0;
+  }
+  if (damage_energy < 2.5 * threshold) {
+    return 1.0;
+  }
+  return 0.8 * damage_energy / (2.0 * threshold);
+}
+
+BCATransport::Result BCATransport::run(const Beam& beam, long ions, int bins, double bin_depth, std::uint64_t stream,
+                                       const CancellationToken& cancel) const {
+  Result result;
+  result.ions.assign(std::max(bins, 0), 0.0);
+  result.vacancies.assign(std::max(bins, 0), 0.0);
+  if (ions <= 0 || bins <= 0 || bin_depth <= 0.0) {
+    return result;
+  }
+
+  const double z1 = beam.ion.atomic_number, m1 = beam.ion.atomic_mass;
+  const double z2 = target_.atomic_number, m2 = target_.atomic_mass;
+  const double screening_length = 0.8854 * kBohrRadius / (std::pow(z1, 0.23) + std::pow(z2, 0.23));
+  const double eps_per_ev = screening_length * m2 / (z1 * z2 * kCoulomb * (m1 + m2));
+  const double density = target_.atomic_density * 1e-24;           // Angstrom^-3
+  const double flight = std::cbrt(1.0 / density);                  // Angstrom
+  const double max_impact = 1.0 / std::sqrt(M_PI * density * flight); // One atom per flight
+  const double transfer = 4.0 * m1 * m2 / ((m1 + m2) * (m1 + m2));
+  const double mass_ratio = m1 / m2;
+  const double electronic = density * flight * 1.212 * std::pow(z1, 7.0 / 6.0) * z2 /
+                            (std::pow(std::pow(z1, 2.0 / 3.0) + std::pow(z2, 2.0 / 3.0), 1.5) * std::sqrt(m1));
+  const double bin_angstrom = bin_depth * 1e4;
+  const double depth_limit = bins * bin_angstrom;
+  const double tilt = beam.tilt * M_PI / 180.0, twist = beam.twist * M_PI / 180.0;
+  const double start_ux = std::sin(tilt) * std::cos(twist);
+  const double start_uy = std::sin(tilt) * std::sin(twist);
+  const double start_uz = std::cos(tilt);
+
+  const Philox4x32 philox(seed_);
+  const std::uint64_t stream_word = stream << 32;
+  const long task_ions = static_cast<long>(kBatch) * kBatchesPerTask;
+  const int tasks = static_cast<int>((ions + task_ions - 1) / task_ions);
+
+  ProgressReporter progress("bca", "ions", static_cast<double>(ions), 0.05);
+  std::vector<Result> partial(tasks);
+  std::vector<double> depth_sums(tasks, 0.0); // Angstrom, of ions at rest
+  std::mutex progress_mutex;
+  long done = 0;
+  std::atomic<bool> stopped{false};
+
+  TaskScheduler::getInstance().parallelFor(0, tasks, [&](int first, int last) {
+    Batch batch;
+    for (int task = first; task < last; ++task) {
+      if (stopped.load(std::memory_order_relaxed) || cancel.stopRequested()) {
+        stopped.store(true, std::memory_order_relaxed);
+        return;
+      }
+      Result& tally = partial[task];
+      tally.ions.assign(bins, 0.0);
+      tally.vacancies.assign(bins, 0.0);
+      double& depth_sum = depth_sums[task];
+      const long task_end = std::min(ions, (task + 1) * task_ions);
+
+      for (long batch_begin = task * task_ions; batch_begin < task_end; batch_begin += kBatch) {
+        const int size = static_cast<int>(std::min<long>(kBatch, task_end - batch_begin));
+        for (int k = 0; k < size; ++k) {
+          batch.x[k] = batch.y[k] = batch.z[k] = 0.0;
+          batch.ux[k] = start_ux;
+          batch.uy[k] = start_uy;
+          batch.uz[k] = start_uz;
+          batch.energy[k] = beam.energy * 1e3;
+          batch.collisions[k] = 0;
+          batch.live[k] = k;
+        }
+        batch.live_count = size;
+
+        // One flight and collision per live ion and pass; ions that
+        // stop or leave are dropped from the live list in place
+        while (batch.live_count > 0) {
+          int kept = 0;
+          for (int l = 0; l < batch.live_count; ++l) {
+            const int k = batch.live[l];
+            double energy = batch.energy[k];
+
+            const double loss = std::min(energy, electronic * std::sqrt(energy));
+            energy -= loss;
+            tally.electronic_energy += loss;
+            batch.x[k] += flight * batch.ux[k];
+            batch.y[k] += flight * batch.uy[k];
+            batch.z[k] += flight * batch.uz[k];
+            if (batch.z[k] < 0.0) {
+              ++tally.backscattered;
+              continue;
+            }
+            if (batch.z[k] >= depth_limit) {
+              ++tally.transmitted;
+              continue;
+            }
+            const int bin = static_cast<int>(batch.z[k] / bin_angstrom);
+
+            const auto draw = philox(static_cast<std::uint64_t>(batch_begin + k), stream_word | batch.collisions[k]++);
+            const double impact = max_impact * std::sqrt(Philox4x32::uniform(draw[0], draw[1]));
+            const double azimuth = 2.0 * M_PI * Philox4x32::uniform(draw[2], draw[3]);
+            const double cos_half = energy > 0.0 ? magicCosHalfAngle(energy * eps_per_ev, impact / screening_length)
+                                                 : 1.0;
+            const double sin2_half = 1.0 - cos_half * cos_half;
+            const double recoil = transfer * energy * sin2_half;
+            energy -= recoil;
+            tally.nuclear_energy += recoil;
+            tally.vacancies[bin] += displacements(recoil, target_);
+
+            if (energy < kRestEnergy || batch.collisions[k] >= kMaxCollisions) {
+              tally.ions[bin] += 1.0;
+              depth_sum += batch.z[k];
+              continue;
+            }
+
+            // Deflect by the lab-frame angle about a random azimuth
+            const double cos_theta = 1.0 - 2.0 * sin2_half;
+            const double sin_theta = 2.0 * std::sqrt(sin2_half) * cos_half;
+            const double psi = std::atan2(sin_theta, cos_theta + mass_ratio);
+            const double cos_psi = std::cos(psi), sin_psi = std::sin(psi);
+            const double cos_phi = std::cos(azimuth), sin_phi = std::sin(azimuth);
+            const double ux = batch.ux[k], uy = batch.uy[k], uz = batch.uz[k];
+            const double radial = std::sqrt(std::max(0.0, 1.0 - uz * uz));
+            if (radial < 1e-6) {
+              batch.ux[k] = sin_psi * cos_phi;
+              batch.uy[k] = sin_psi * sin_phi;
+              batch.uz[k] = std::copysign(cos_psi, uz);
+            } else {
+              batch.ux[k] = sin_psi * (ux * uz * cos_phi - uy * sin_phi) / radial + ux * cos_psi;
+              batch.uy[k] = sin_psi * (uy * uz * cos_phi + ux * sin_phi) / radial + uy * cos_psi;
+              batch.uz[k] = -sin_psi * cos_phi * radial + uz * cos_psi;
+            }
+            batch.energy[k] = energy;
+            batch.live[kept++] = k;
+          }
+          batch.live_count = kept;
+        }
+      }
+      tally.traced = task_end - task * task_ions;
+
+      std::lock_guard<std::mutex> lock(progress_mutex);
+      done += tally.traced;
+      progress.update(static_cast<double>(done));
+    }
+  }, 1);
+
+  double depth_sum = 0.0;
+  for (int task = 0; task < tasks; ++task) {
+    const Result& tally = partial[task];
+    if (tally.traced == 0) {
+      continue;
+    }
+    for (int i = 0; i < bins; ++i) {
+      result.ions[i] += tally.ions[i];
+      result.vacancies[i] += tally.vacancies[i];
+    }
+    result.traced += tally.traced;
+    result.backscattered += tally.backscattered;
+    result.transmitted += tally.transmitted;
+    depth_sum += depth_sums[task];
+    result.nuclear_energy += tally.nuclear_energy;
+    result.electronic_energy += tally.electronic_energy;
+  }
+  if (stopped.load()) {
+    progress.warning("interrupted", static_cast<double>(result.traced));
+  }
+
+  double at_rest = 0.0;
+  for (double count : result.ions) {
+    at_rest += count;
+  }
+  result.mean_depth = at_rest > 0.0 ? depth_sum / at_rest * 1e-4 : 0.0;
+  if (result.traced > 0) {
+    result.nuclear_energy /= result.traced;
+    result.electronic_energy /= result.traced;
+  }
+  progress.metric("mean_depth_um", result.mean_depth);
+  progress.metric("backscattered", static_cast<double>(result.backscattered));
+  return result;
+}
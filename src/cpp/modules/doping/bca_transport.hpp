@@ -0,0 +1,74 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef BCA_TRANSPORT_HPP
+#define BCA_TRANSPORT_HPP
+
+#include "../../core/cancellation.hpp"
+#include <cstdint>
+#include <vector>
+
+// Binary-collision-approximation ion transport through an amorphous,
+// single-element target, as TRIM does it: ions fly one mean atomic
+// spacing between collisions, losing Lindhard-Scharff electronic energy
+// on the way, and scatter off one target atom per collision through the
+// ZBL universal potential (angles from the Biersack-Haggmark magic
+// formula). Recoils are not followed; each collision's displacements
+// come from the NRT (Kinchin-Pease) count of its damage energy.
+//
+// Ions advance in batches held as struct-of-arrays state, one collision
+// per pass over the batch's live ions; batches run in parallel on the
+// TaskScheduler. Every random number is a Philox draw keyed by the seed
+// and indexed by (ion, collision, stream), and tallies are folded in
+// batch order, so results do not depend on the thread count.
+class BCATransport {
+public:
+  struct Species {
+    double atomic_number;
+    double atomic_mass; // amu
+  };
+
+  struct Target {
+    double atomic_number;
+    double atomic_mass;         // amu
+    double atomic_density;      // cm^-3
+    double displacement_energy; // eV
+  };
+  static Target silicon() { return {14.0, 28.0855, 4.994e22, 15.0}; }
+
+  struct Beam {
+    Species ion;
+    double energy;      // keV
+    double tilt = 0.0;  // Degrees from the surface normal
+    double twist = 0.0; // Degrees, azimuth of the tilt
+  };
+
+  // Tallies over depth bins of bin_depth (um) from the surface
+  struct Result {
+    std::vector<double> ions;      // Ions come to rest
+    std::vector<double> vacancies; // Displacements
+    long traced = 0;               // Ions the tallies cover
+    long backscattered = 0;
+    long transmitted = 0;          // Past the last bin
+    double mean_depth = 0.0;       // Of the ions at rest, um
+    double nuclear_energy = 0.0;   // eV per ion, given to target atoms
+    double electronic_energy = 0.0;
+  };
+
+  explicit BCATransport(const Target& target = silicon(), std::uint64_t seed = 0);
+
+  // Different streams give independent runs under one seed. Stops before
+  // the next batch once `cancel` fires; `traced` says how far it got.
+  Result run(const Beam& beam, long ions, int bins, double bin_depth, std::uint64_t stream = 0,
+             const CancellationToken& cancel = CancellationToken::current()) const;
+
+  // NRT displacements for a primary recoil of this energy (eV)
+  static double displacements(double recoil_energy, const Target& target);
+
+  // Ions per batch
+  static constexpr int kBatch = 256;
+
+private:
+  Target target_;
+  std::uint64_t seed_;
+};
+
+#endif // BCA_TRANSPORT_HPP
@@ -0,0 +1,372 @@
+#include "coupled_diffusion_solver.hpp"
+#include "../../core/utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr double kBoltzmann = 8.617e-5; // eV/K
+constexpr int kMaxNewtonIterations = 10;
+// Refactor once an iteration shrinks the update by less than this
+constexpr double kSlowContraction = 0.3;
+constexpr double kMinDamping = 1.0 / 64;
+// Largest change of any scaled concentration a step aims for; the step
+// doubles below half of it and halves above twice it
+constexpr double kTargetChange = 0.1;
+
+// The discretized anneal at one temperature. Unknowns are the species'
+// concentrations divided by `scale`, one column per species (dopants,
+// then all interstitials if modelled), one row per cell.
+struct System {
+  int cells = 0;
+  int dopants = 0;
+  bool ted = false;
+  double dx = 0.0;
+  double ni = 0.0;
+  std::vector<double> charge, d0, d1, d2, fraction;
+  double interstitial_diffusivity = 0.0;
+  double interstitial_equilibrium = 0.0;
+  double inverse_lifetime = 0.0;
+  double cluster_equilibrium = 0.0; // Free C_I that clusters hold
+  Eigen::ArrayXd scale;
+
+  int species() const { return dopants + (ted ? 1 : 0); }
+
+  // Free interstitials out of total ones: all of them while few, saturating
+  // at cluster_equilibrium as clusters take up the rest. Odd and smooth
+  // enough for Newton through 0.
+  Eigen::ArrayXd freeInterstitials(const Eigen::ArrayXd& total) const {
+    return total * cluster_equilibrium / (total.abs() + cluster_equilibrium);
+  }
+
+  // u - previous + h div J (+ h recombination), scaled like u
+  Eigen::ArrayXXd residual(const Eigen::ArrayXXd& u, const Eigen::ArrayXXd& previous, double h) const {
+    const int n = cells;
+    const Eigen::ArrayXXd c = u.rowwise() * scale.transpose();
+
+    Eigen::ArrayXd net = Eigen::ArrayXd::Zero(n);
+    for (int k = 0; k < dopants; ++k) {
+      net += charge[k] * c.col(k);
+    }
+    // Electrons from neutrality, in whichever form does not cancel
+    const Eigen::ArrayXd root = (net.square() + 4.0 * ni * ni).sqrt();
+    const Eigen::ArrayXd electrons = (net >= 0.0).select(0.5 * (net + root), 2.0 * ni * ni / (root - net));
+    const Eigen::ArrayXd log_ratio = (electrons / ni).log();
+    const Eigen::ArrayXd ci = ted ? freeInterstitials(c.col(dopants)) : Eigen::ArrayXd();
+    const Eigen::ArrayXd supersaturation =
+        ted ? Eigen::ArrayXd(ci.max(0.0) / interstitial_equilibrium) : Eigen::ArrayXd::Ones(n);
+
+    Eigen::ArrayXXd r = u - previous;
+    // Face f lies between cells f - 1 and f; faces 0 and n are the ends
+    Eigen::ArrayXd flux(n + 1);
+    auto addDivergence = [&](int k) { r.col(k) += h / (scale[k] * dx) * (flux.tail(n) - flux.head(n)); };
+
+    for (int k = 0; k < dopants; ++k) {
+      const Eigen::ArrayXd eta = (charge[k] * log_ratio).exp();
+      const Eigen::ArrayXd diffusivity =
+          (d0[k] + eta * (d1[k] + d2[k] * eta)) * ((1.0 - fraction[k]) + fraction[k] * supersaturation);
+      const auto ck = c.col(k);
+      flux[0] = 0.0;
+      flux[n] = 0.0;
+      flux.segment(1, n - 1) =
+          -0.5 * (diffusivity.head(n - 1) + diffusivity.tail(n - 1)) *
+          ((ck.tail(n - 1) - ck.head(n - 1)) +
+           charge[k] * 0.5 * (ck.head(n - 1) + ck.tail(n - 1)) * (log_ratio.tail(n - 1) - log_ratio.head(n - 1))) /
+          dx;
+      addDivergence(k);
+    }
+
+    if (ted) {
+      flux[0] = -interstitial_diffusivity * (ci[0] - interstitial_equilibrium) / (0.5 * dx); // Surface sink
+      flux[n] = 0.0;
+      flux.segment(1, n - 1) = -interstitial_diffusivity * (ci.tail(n - 1) - ci.head(n - 1)) / dx;
+      addDivergence(dopants);
+      r.col(dopants) += h * inverse_lifetime / scale[dopants] * (ci - interstitial_equilibrium);
+    }
+    return r;
+  }
+};
+
+// The Newton Jacobian of System::residual, held factored by block Thomas
+// elimination: pivots[i] factors the eliminated diagonal block of cell i,
+// coupling[i] = pivots[i]^-1 (block coupling cell i to i + 1).
+class BlockTridiagonal {
+public:
+  // Finite-difference Jacobian at u. Perturbing every third cell at once
+  // leaves each cell's residual touched by one perturbed neighbour, so the
+  // blocks take 3 residual evaluations per species.
+  void factor(const System& system, const Eigen::ArrayXXd& u, const Eigen::ArrayXXd& previous, double h) {
+    const int n = system.cells;
+    const int s = system.species();
+    lower_.assign(n, Eigen::MatrixXd::Zero(s, s));
+    std::vector<Eigen::MatrixXd> diagonal(n, Eigen::MatrixXd::Zero(s, s));
+    std::vector<Eigen::MatrixXd> upper(n, Eigen::MatrixXd::Zero(s, s));
+
+    const Eigen::ArrayXXd base = system.residual(u, previous, h);
+    Eigen::ArrayXd delta(n);
+    for (int color = 0; color < 3; ++color) {
+      for (int j = 0; j < s; ++j) {
+        Eigen::ArrayXXd perturbed = u;
+        for (int i = color; i < n; i += 3) {
+          delta[i] = 1e-7 * (std::abs(u(i, j)) + 1.0);
+          perturbed(i, j) += delta[i];
+        }
+        const Eigen::ArrayXXd shifted = system.residual(perturbed, previous, h);
+        for (int row = 0; row < n; ++row) {
+          int column = row - 1; // The one perturbed cell among row - 1, row, row + 1
+          while ((column - color + 3) % 3 != 0) {
+            ++column;
+          }
+          if (column < 0 || column >= n) {
+            continue;
+          }
+          Eigen::MatrixXd& block = column < row ? lower_[row] : column == row ? diagonal[row] : upper[row];
+          block.col(j) = ((shifted.row(row) - base.row(row)) / delta[column]).matrix().transpose();
+        }
+      }
+    }
+
+    pivots_.resize(n);
+    coupling_.assign(n, Eigen::MatrixXd());
+    for (int i = 0; i < n; ++i) {
+      if (i > 0) {
+        diagonal[i] -= lower_[i] * coupling_[i - 1];
+      }
+      pivots_[i].compute(diagonal[i]);
+      if (i + 1 < n) {
+        coupling_[i] = pivots_[i].solve(upper[i]);
+      }
+    }
+  }
+
+  Eigen::ArrayXXd solve(const Eigen::ArrayXXd& r) const {
+    const int n = static_cast<int>(pivots_.size());
+    Eigen::MatrixXd x(n, r.cols());
+    for (int i = 0; i < n; ++i) {
+      Eigen::VectorXd rhs = r.row(i).matrix().transpose();
+      if (i > 0) {
+        rhs -= lower_[i] * x.row(i - 1).transpose();
+      }
+      x.row(i) = pivots_[i].solve(rhs).transpose();
+    }
+    for (int i = n - 2; i >= 0; --i) {
+      x.row(i) -= (coupling_[i] * x.row(i + 1).transpose()).transpose();
+    }
+    return x.array();
+  }
+
+private:
+  std::vector<Eigen::MatrixXd> lower_;
+  std::vector<Eigen::MatrixXd> coupling_;
+  std::vector<Eigen::PartialPivLU<Eigen::MatrixXd>> pivots_;
+};
+
+} // namespace
+
+CoupledDiffusionSolver::Dopant CoupledDiffusionSolver::Dopant::boron() {
+  return {-1.0, {0.037, 0.72, 0.0}, {3.46, 3.46, 0.0}, 1.0};
+}
+
+CoupledDiffusionSolver::Dopant CoupledDiffusionSolver::Dopant::phosphorus() {
+  return {1.0, {3.85, 4.44, 44.2}, {3.66, 4.00, 4.37}, 1.0};
+}
+
+CoupledDiffusionSolver::Dopant CoupledDiffusionSolver::Dopant::arsenic() {
+  return {1.0, {0.066, 12.0, 0.0}, {3.44, 4.05, 0.0}, 0.4};
+}
+
+CoupledDiffusionSolver::Dopant CoupledDiffusionSolver::Dopant::antimony() {
+  return {1.0, {0.214, 15.0, 0.0}, {3.65, 4.08, 0.0}, 0.02};
+}
+
+CoupledDiffusionSolver::Dopant CoupledDiffusionSolver::Dopant::constant(double diffusivity) {
+  return {0.0, {diffusivity, 0.0, 0.0}, {0.0, 0.0, 0.0}, 0.0};
+}
+
+double CoupledDiffusionSolver::Dopant::diffusivity(double temperature, double eta) const {
+  const double kt = kBoltzmann * temperature;
+  return prefactor[0] * std::exp(-activation[0] / kt) + eta * prefactor[1] * std::exp(-activation[1] / kt) +
+         eta * eta * prefactor[2] * std::exp(-activation[2] / kt);
+}
+
+double CoupledDiffusionSolver::Interstitials::diffusivity(double temperature) const {
+  return diffusivity_prefactor * std::exp(-diffusivity_activation / (kBoltzmann * temperature));
+}
+
+double CoupledDiffusionSolver::Interstitials::equilibrium(double temperature) const {
+  return equilibrium_prefactor * std::exp(-equilibrium_activation / (kBoltzmann * temperature));
+}
+
+double CoupledDiffusionSolver::Interstitials::lifetime(double temperature) const {
+  return lifetime_prefactor * std::exp(lifetime_activation / (kBoltzmann * temperature));
+}
+
+double CoupledDiffusionSolver::Interstitials::clusterSupersaturation(double temperature) const {
+  return cluster_prefactor * std::exp(cluster_binding / (kBoltzmann * temperature));
+}
+
+CoupledDiffusionSolver::CoupledDiffusionSolver() {}
+
+double CoupledDiffusionSolver::intrinsicConcentration(double temperature) {
+  return 3.87e16 * std::pow(temperature, 1.5) * std::exp(-7.02e3 / temperature);
+}
+
+CoupledDiffusionSolver::Result CoupledDiffusionSolver::anneal(const std::vector<Dopant>& dopants,
+                                                              const std::vector<Eigen::ArrayXd>& profiles,
+                                                              const Eigen::ArrayXd& interstitials, double temperature,
+                                                              double time, double dx,
+                                                              const CancellationToken& cancel) const {
+  if (dopants.empty() || dopants.size() != profiles.size()) {
+    throw std::invalid_argument("CoupledDiffusionSolver: need one profile per dopant");
+  }
+  const int n = static_cast<int>(profiles.front().size());
+  for (const auto& profile : profiles) {
+    if (profile.size() != n) {
+      throw std::invalid_argument("CoupledDiffusionSolver: profiles differ in length");
+    }
+  }
+  if (interstitials.size() != 0 && interstitials.size() != n) {
+    throw std::invalid_argument("CoupledDiffusionSolver: interstitial profile differs in length");
+  }
+  if (temperature <= 0.0 || dx <= 0.0 || time < 0.0) {
+    throw std::invalid_argument("CoupledDiffusionSolver: temperature and dx must be positive");
+  }
+
+  Result result;
+  result.dopants = profiles;
+  result.interstitials = interstitials;
+  if (interstitials.size() != 0) {
+    result.clusters = Eigen::ArrayXd::Zero(n);
+  }
+  if (n < 2 || time == 0.0) {
+    return result;
+  }
+
+  System system;
+  system.cells = n;
+  system.dopants = static_cast<int>(dopants.size());
+  system.ted = interstitials.size() != 0;
+  system.dx = dx;
+  system.ni = intrinsicConcentration(temperature);
+  const double kt = kBoltzmann * temperature;
+  for (const auto& dopant : dopants) {
+    system.charge.push_back(dopant.charge);
+    system.d0.push_back(dopant.prefactor[0] * std::exp(-dopant.activation[0] / kt));
+    system.d1.push_back(dopant.prefactor[1] * std::exp(-dopant.activation[1] / kt));
+    system.d2.push_back(dopant.prefactor[2] * std::exp(-dopant.activation[2] / kt));
+    system.fraction.push_back(dopant.interstitial_fraction);
+  }
+  if (system.ted) {
+    system.interstitial_diffusivity = interstitials_.diffusivity(temperature);
+    system.interstitial_equilibrium = interstitials_.equilibrium(temperature);
+    system.inverse_lifetime = 1.0 / interstitials_.lifetime(temperature);
+    system.cluster_equilibrium = system.interstitial_equilibrium * interstitials_.clusterSupersaturation(temperature);
+  }
+
+  std::vector<Eigen::ArrayXd> columns = profiles;
+  if (system.ted) {
+    columns.push_back(interstitials);
+  }
+  const int s = system.species();
+  system.scale.resize(s);
+  Eigen::ArrayXXd u(n, s);
+  for (int k = 0; k < s; ++k) {
+    double peak = columns[k].abs().maxCoeff();
+    if (k == system.dopants) {
+      peak = std::max(peak, system.interstitial_equilibrium);
+    }
+    system.scale[k] = peak > 0.0 ? peak : 1.0;
+    u.col(k) = columns[k] / system.scale[k];
+  }
+
+  BlockTridiagonal jacobian;
+  double factored_step = -1.0;
+  const double max_step = max_fraction_ * time;
+  const double min_step = 1e-12 * time;
+  double step = std::min(max_step, std::max(initial_fraction_ * time, min_step));
+  Eigen::ArrayXXd previous = u;
+
+  while (result.time < time) {
+    if (cancel.stopRequested()) {
+      SEMIPRO_LOGF(INFO, PHYSICS, "Coupled diffusion interrupted after {} of {}s", result.time, time);
+      break;
+    }
+    const double h = std::min(step, time - result.time);
+    bool refactor = h != factored_step;
+    bool converged = false;
+    int iterations = 0;
+    double last_update = 0.0;
+    u = previous;
+    Eigen::ArrayXXd r = system.residual(u, previous, h);
+    double r_norm = r.matrix().norm();
+    while (iterations < kMaxNewtonIterations) {
+      if (refactor) {
+        jacobian.factor(system, u, previous, h);
+        factored_step = h;
+        ++result.factorizations;
+        refactor = false;
+      }
+      const Eigen::ArrayXXd update = jacobian.solve(r);
+      ++iterations;
+      if (!update.allFinite()) {
+        break;
+      }
+      const double size = update.abs().maxCoeff();
+      if (size < tolerance_) {
+        u -= update;
+        converged = true;
+        break;
+      }
+      // Backtrack while the update makes the residual worse (or not finite)
+      double damping = 1.0;
+      Eigen::ArrayXXd trial = u - update;
+      Eigen::ArrayXXd trial_r = system.residual(trial, previous, h);
+      while (!(trial_r.matrix().norm() <= r_norm) && damping > kMinDamping) {
+        damping *= 0.5;
+        trial = u - damping * update;
+        trial_r = system.residual(trial, previous, h);
+      }
+      u = std::move(trial);
+      r = std::move(trial_r);
+      r_norm = r.matrix().norm();
+      if (damping < 1.0 || (iterations > 1 && size > kSlowContraction * last_update)) {
+        refactor = true;
+      }
+      last_update = size;
+    }
+    result.newton_iterations += iterations;
+
+    if (!converged) {
+      ++result.rejected_steps;
+      factored_step = -1.0; // The factorization may be the culprit
+      step = 0.5 * h;
+      if (step < min_step) {
+        throw std::runtime_error("CoupledDiffusionSolver: Newton failed at the smallest step");
+      }
+      continue;
+    }
+
+    const double change = (u - previous).abs().maxCoeff();
+    previous = u;
+    result.time += h;
+    ++result.steps;
+    if (change < 0.5 * kTargetChange) {
+      step = std::min(max_step, 2.0 * h);
+    } else if (change > 2.0 * kTargetChange) {
+      step = 0.5 * h;
+    }
+  }
+
+  for (int k = 0; k < system.dopants; ++k) {
+    result.dopants[k] = previous.col(k) * system.scale[k];
+  }
+  if (system.ted) {
+    const Eigen::ArrayXd total = previous.col(system.dopants) * system.scale[system.dopants];
+    result.interstitials = system.freeInterstitials(total);
+    result.clusters = total - result.interstitials;
+  }
+  SEMIPRO_LOGF(INFO, PHYSICS, "Coupled diffusion: temp={}K, time={}s, {} steps, {} Newton iterations, {} factorizations",
+               temperature, result.time, result.steps, result.newton_iterations, result.factorizations);
+  return result;
+}
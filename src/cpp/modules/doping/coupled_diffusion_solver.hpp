@@ -0,0 +1,108 @@
+#ifndef COUPLED_DIFFUSION_SOLVER_HPP
+#define COUPLED_DIFFUSION_SOLVER_HPP
+
+#include "../../core/cancellation.hpp"
+#include <Eigen/Dense>
+#include <vector>
+
+// 1D anneal of several dopants at once, coupled through the electron
+// concentration and, optionally, through a silicon self-interstitial
+// field for transient enhanced diffusion (TED).
+//
+// Each dopant diffuses with Fair's charged-vacancy diffusivity
+// D = d0 + d1 eta + d2 eta^2 (eta = n/ni for donors, p/ni for acceptors)
+// and drifts in the built-in field, J = -D (dC/dx + z C dln(n/ni)/dx),
+// with n from local charge neutrality. With interstitials, the
+// interstitial-assisted part of D (fraction f_I) scales with the
+// supersaturation C_I / C_I*, and C_I diffuses to a perfect surface sink
+// while recombining in the bulk with a lifetime tau. Interstitials are
+// taken to be in equilibrium with {311} clusters, which hold the free
+// C_I near S_c C_I* for as long as they last: the reservoir that keeps
+// TED going, and the cap on its enhancement.
+//
+// Steps are backward Euler on a cell-centred grid; dopant fluxes vanish
+// at both ends, so doses are conserved. Each step is a Newton solve whose
+// Jacobian is block tridiagonal (one block per cell, species wide) and
+// factored by block Thomas elimination. The factorization is reused over
+// Newton iterations and time steps for as long as iterations keep
+// contracting and the step size is unchanged; the step size follows the
+// largest relative change per step and halves when Newton fails.
+class CoupledDiffusionSolver {
+public:
+  // Prefactors (cm^2/s) and activation energies (eV) of the neutral,
+  // singly and doubly charged terms
+  struct Dopant {
+    double charge = 0.0; // +1 donor, -1 acceptor, 0 no field coupling
+    double prefactor[3] = {0.0, 0.0, 0.0};
+    double activation[3] = {0.0, 0.0, 0.0};
+    double interstitial_fraction = 0.0;
+
+    static Dopant boron();
+    static Dopant phosphorus();
+    static Dopant arsenic();
+    static Dopant antimony();
+    // Uncharged, with a fixed diffusivity
+    static Dopant constant(double diffusivity);
+
+    double diffusivity(double temperature, double eta = 1.0) const;
+  };
+
+  struct Interstitials {
+    double diffusivity_prefactor = 0.138; // cm^2/s
+    double diffusivity_activation = 1.37; // eV
+    double equilibrium_prefactor = 1e27;  // cm^-3
+    double equilibrium_activation = 3.7;
+    double lifetime_prefactor = 1e-12; // s
+    double lifetime_activation = 3.0;
+    double cluster_prefactor = 1e-5; // S_c
+    double cluster_binding = 1.9;    // eV
+
+    double diffusivity(double temperature) const;
+    double equilibrium(double temperature) const;
+    double lifetime(double temperature) const;
+    double clusterSupersaturation(double temperature) const;
+  };
+
+  struct Result {
+    std::vector<Eigen::ArrayXd> dopants;
+    Eigen::ArrayXd interstitials; // Free, empty when they were not modelled
+    Eigen::ArrayXd clusters;      // Clustered
+    double time = 0.0;            // Annealed, short of the request if cancelled
+    int steps = 0;
+    int rejected_steps = 0;
+    int newton_iterations = 0;
+    int factorizations = 0;
+  };
+
+  CoupledDiffusionSolver();
+
+  void setInterstitials(const Interstitials& interstitials) { interstitials_ = interstitials; }
+  const Interstitials& getInterstitials() const { return interstitials_; }
+  // Largest step as a fraction of the anneal time, and the first one
+  void setStepLimits(double max_fraction, double initial_fraction) {
+    max_fraction_ = max_fraction;
+    initial_fraction_ = initial_fraction;
+  }
+  void setNewtonTolerance(double tolerance) { tolerance_ = tolerance; }
+
+  // Anneals the profiles (cm^-3, one per dopant, all on cells of width dx
+  // cm from the surface) at temperature (K) for time (s). A non-empty
+  // interstitials profile is the initial C_I, free and clustered together,
+  // and switches TED on. Throws std::invalid_argument on mismatched
+  // profiles and std::runtime_error when Newton fails at the smallest
+  // step. Stops after the current step once `cancel` fires.
+  Result anneal(const std::vector<Dopant>& dopants, const std::vector<Eigen::ArrayXd>& profiles,
+                const Eigen::ArrayXd& interstitials, double temperature, double time, double dx,
+                const CancellationToken& cancel = CancellationToken::current()) const;
+
+  // Intrinsic carrier concentration of silicon (cm^-3)
+  static double intrinsicConcentration(double temperature);
+
+private:
+  Interstitials interstitials_;
+  double max_fraction_ = 0.02;
+  double initial_fraction_ = 1e-6;
+  double tolerance_ = 1e-8;
+};
+
+#endif // COUPLED_DIFFUSION_SOLVER_HPP
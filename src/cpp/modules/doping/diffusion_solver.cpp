@@ -1,27 +1,299 @@
 #include "diffusion_solver.hpp"
+#include "../../core/gpu_compute.hpp"
 #include "../../core/utils.hpp"
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// One theta-scheme step of c_t = lower_i (c_{i-1} - c_i) + upper_i
+// (c_{i+1} - c_i), times `scale`, with the boundary values held: theta = 1
+// is backward Euler, 0.5 Crank-Nicolson. The right-hand side is built
+// during the forward sweep; `scratch` keeps the sweep's modified
+// super-diagonal for back substitution. `from` and `to` must differ.
+void implicitStep(const Eigen::ArrayXd& from, Eigen::ArrayXd& to, const Eigen::ArrayXd& lower,
+                  const Eigen::ArrayXd& upper, double scale, double theta, Eigen::ArrayXd& scratch) {
+  const int n = from.size();
+  const double explicit_part = (1.0 - theta) * scale;
+  to[0] = from[0];
+  to[n - 1] = from[n - 1];
+
+  double c = 0.0, d = 0.0;
+  for (int i = 1; i < n - 1; ++i) {
+    const double below = -theta * scale * lower[i];
+    const double above = -theta * scale * upper[i];
+    const double diag = 1.0 - below - above;
+    double rhs = from[i] + explicit_part * (lower[i] * (from[i - 1] - from[i]) + upper[i] * (from[i + 1] - from[i]));
+    if (i == 1) {
+      rhs -= below * from[0];
+    }
+    if (i == n - 2) {
+      rhs -= above * from[n - 1];
+    }
+    const double denominator = diag - below * c;
+    c = above / denominator;
+    d = (rhs - below * d) / denominator;
+    scratch[i] = c;
+    to[i] = d;
+  }
+  for (int i = n - 3; i >= 1; --i) {
+    to[i] -= scratch[i] * to[i + 1];
+  }
+}
+
+// Solves the transpose of implicitStep's matrix, I + theta scale L on
+// the interior rows and identity on the end rows, for `rhs`:
+// (L c)_i = -lower_i (c_{i-1} - c_i) - upper_i (c_{i+1} - c_i)
+void transposedStep(const Eigen::ArrayXd& rhs, Eigen::ArrayXd& to, const Eigen::ArrayXd& lower,
+                    const Eigen::ArrayXd& upper, double scale, double theta, Eigen::ArrayXd& scratch) {
+  const int n = rhs.size();
+  // Row i of the transpose holds column i: the diagonal, -theta scale
+  // upper_{i-1} below it and -theta scale lower_{i+1} above it, where
+  // those rows are interior
+  auto diagonal = [&](int i) {
+    return i == 0 || i == n - 1 ? 1.0 : 1.0 + theta * scale * (lower[i] + upper[i]);
+  };
+  auto below = [&](int i) { return i - 1 >= 1 && i - 1 <= n - 2 ? -theta * scale * upper[i - 1] : 0.0; };
+  auto above = [&](int i) { return i + 1 >= 1 && i + 1 <= n - 2 ? -theta * scale * lower[i + 1] : 0.0; };
+  double c = 0.0, d = 0.0;
+  for (int i = 0; i < n; ++i) {
+    const double denominator = diagonal(i) - below(i) * c;
+    c = above(i) / denominator;
+    d = (rhs[i] - below(i) * d) / denominator;
+    scratch[i] = c;
+    to[i] = d;
+  }
+  for (int i = n - 2; i >= 0; --i) {
+    to[i] -= scratch[i] * to[i + 1];
+  }
+}
+
+// L c as in transposedStep, zero on the end rows
+Eigen::ArrayXd applyOperator(const Eigen::ArrayXd& c, const Eigen::ArrayXd& lower, const Eigen::ArrayXd& upper) {
+  const int n = c.size();
+  Eigen::ArrayXd result = Eigen::ArrayXd::Zero(n);
+  for (int i = 1; i < n - 1; ++i) {
+    result[i] = -lower[i] * (c[i - 1] - c[i]) - upper[i] * (c[i + 1] - c[i]);
+  }
+  return result;
+}
+
+// L^T c
+Eigen::ArrayXd applyTransposedOperator(const Eigen::ArrayXd& c, const Eigen::ArrayXd& lower,
+                                       const Eigen::ArrayXd& upper) {
+  const int n = c.size();
+  Eigen::ArrayXd result = Eigen::ArrayXd::Zero(n);
+  for (int i = 1; i < n - 1; ++i) {
+    result[i - 1] -= lower[i] * c[i];
+    result[i] += (lower[i] + upper[i]) * c[i];
+    result[i + 1] -= upper[i] * c[i];
+  }
+  return result;
+}
+
+} // namespace
 
 DiffusionSolver::DiffusionSolver() {}
 
+double DiffusionSolver::diffusivity(double temperature) {
+  return 1e-14 * std::exp(-3.0 / (8.617e-5 * temperature));
+}
+
 Eigen::ArrayXd DiffusionSolver::simulateDiffusion(const Eigen::ArrayXd& initial_profile, double temperature, double time,
-                                                 double dx, double dt) const {
+                                                 double dx, double dt, const CancellationToken& cancel) const {
+  const Eigen::ArrayXd coupling = Eigen::ArrayXd::Constant(initial_profile.size(), 1.0 / (dx * dx));
+  return diffuse(initial_profile, coupling, coupling, temperature, time, dt, cancel);
+}
+
+void DiffusionSolver::simulateLateralDiffusion(DistributedField& concentration, double temperature, double time,
+                                               double dx) const {
+  if (concentration.grid().halo() < 1) {
+    throw std::invalid_argument("Lateral diffusion needs a halo of at least one cell");
+  }
+  if (!(time > 0.0)) {
+    return;
+  }
+  const double D = diffusivity(temperature);
+  const int steps = std::max(1, static_cast<int>(std::ceil(4.0 * D * time / (dx * dx))));
+  const double ratio = D * (time / steps) / (dx * dx);
+  // On one rank the whole field fits on the device, which takes every step
+  if (auto gpu = Gpu::active(); gpu && concentration.communicator().size() == 1) {
+    Eigen::ArrayXXd field(concentration.localRows(), concentration.globalCols());
+    concentration.storeLocal(field);
+    if (gpu->diffuseExplicit(field, ratio, steps)) {
+      concentration.loadLocal(field);
+      return;
+    }
+  }
+  concentration.applyStencil(steps, [ratio](const TiledGrid::Tile& in, TiledGrid::Tile& out) {
+    for (int j = 0; j < in.cols; ++j) {
+      for (int i = 0; i < in.rows; ++i) {
+        const double centre = in(i, j);
+        out(i, j) = centre + ratio * (in(i - 1, j) + in(i + 1, j) + in(i, j - 1) + in(i, j + 1) - 4.0 * centre);
+      }
+    }
+  });
+}
+
+DiffusionSolver::Sensitivity DiffusionSolver::adjointSensitivity(const Eigen::ArrayXd& initial_profile,
+                                                                 const Eigen::ArrayXd& weights, double temperature,
+                                                                 double time, double dx, double dt) const {
+  const int n = initial_profile.size();
+  if (weights.size() != n) {
+    throw std::invalid_argument("Adjoint weights and profile sizes differ");
+  }
+  const Eigen::ArrayXd coupling = Eigen::ArrayXd::Constant(n, 1.0 / (dx * dx));
+  const double D = diffusivity(temperature);
+  // d ln D / dT for D = D0 exp(-Ea / kT)
+  const double log_slope = 3.0 / (8.617e-5 * temperature * temperature);
+
+  // The forward steps, as diffuse takes them: explicit steps drop the
+  // remainder of time / dt, the implicit ones end on a shorter step.
+  // Each step is M c_{k+1} = N c_k with M = I + theta a L and
+  // N = I - (1 - theta) a L, a = D h.
+  const double theta = scheme_ == Scheme::Explicit || n < 3 ? 0.0 : scheme_ == Scheme::Implicit ? 1.0 : 0.5;
+  std::vector<double> steps;
+  if (theta == 0.0) {
+    steps.assign(static_cast<size_t>(time / dt), dt);
+  } else {
+    const double step = dt > 0.0 ? dt : time;
+    for (double elapsed = 0.0; elapsed < time; elapsed += steps.back()) {
+      steps.push_back(std::min(step, time - elapsed));
+    }
+  }
+  std::vector<Eigen::ArrayXd> states{initial_profile};
+  states.reserve(steps.size() + 1);
+  Eigen::ArrayXd next(n), scratch(n);
+  for (double h : steps) {
+    const Eigen::ArrayXd& from = states.back();
+    if (theta == 0.0) {
+      next = from - D * h * applyOperator(from, coupling, coupling);
+    } else {
+      implicitStep(from, next, coupling, coupling, D * h, theta, scratch);
+    }
+    states.push_back(next);
+  }
+
+  // Backward: mu_k = M^-T lambda_{k+1}, lambda_k = N^T mu_k, and
+  // dJ/da_k = -mu_k . L((1 - theta) c_k + theta c_{k+1})
+  Sensitivity sensitivity;
+  sensitivity.value = (weights * states.back()).sum();
+  Eigen::ArrayXd lambda = weights, mu(n);
+  for (int k = static_cast<int>(steps.size()) - 1; k >= 0; --k) {
+    const double a = D * steps[k];
+    if (theta == 0.0) {
+      mu = lambda;
+    } else {
+      transposedStep(lambda, mu, coupling, coupling, a, theta, scratch);
+    }
+    const Eigen::ArrayXd blend = (1.0 - theta) * states[k] + theta * states[k + 1];
+    const double d_a = -(mu * applyOperator(blend, coupling, coupling)).sum();
+    sensitivity.d_temperature += d_a * a * log_slope;
+    if (theta != 0.0 && k == static_cast<int>(steps.size()) - 1) {
+      sensitivity.d_time = d_a * D;
+    }
+    lambda = mu - (1.0 - theta) * a * applyTransposedOperator(mu, coupling, coupling);
+  }
+  sensitivity.d_initial = lambda;
+  return sensitivity;
+}
+
+Eigen::ArrayXd DiffusionSolver::simulateDiffusion(const DepthMesh& mesh, const Eigen::ArrayXd& initial_profile,
+                                                 double temperature, double time, double dt,
+                                                 const CancellationToken& cancel) const {
+  const int n = mesh.size();
+  if (initial_profile.size() != n) {
+    throw std::invalid_argument("Profile and depth mesh sizes differ");
+  }
+  // Flux D (c_j - c_i) / |x_j - x_i| across each face, over the node's
+  // control volume; depths from um to cm
+  const Eigen::ArrayXd& x = mesh.nodes();
+  const Eigen::ArrayXd volume = mesh.volumes() * 1e-4;
+  Eigen::ArrayXd lower = Eigen::ArrayXd::Zero(n), upper = Eigen::ArrayXd::Zero(n);
+  for (int i = 1; i < n - 1; ++i) {
+    lower[i] = 1.0 / (volume[i] * (x[i] - x[i - 1]) * 1e-4);
+    upper[i] = 1.0 / (volume[i] * (x[i + 1] - x[i]) * 1e-4);
+  }
+  if (scheme_ == Scheme::Explicit && n >= 3) {
+    const double limit = 0.5 / (diffusivity(temperature) * (lower + upper).maxCoeff());
+    dt = std::min(dt, limit);
+  }
+  return diffuse(initial_profile, lower, upper, temperature, time, dt, cancel);
+}
+
+Eigen::ArrayXd DiffusionSolver::diffuse(const Eigen::ArrayXd& initial_profile, const Eigen::ArrayXd& lower,
+                                        const Eigen::ArrayXd& upper, double temperature, double time, double dt,
+                                        const CancellationToken& cancel) const {
   int n = initial_profile.size();
   Eigen::ArrayXd profile = initial_profile;
   Eigen::ArrayXd new_profile = profile;
 
   // Diffusion coefficient (cm^2/s), temperature in K
-  double D = 1e-14 * std::exp(-3.0 / (8.617e-5 * temperature));
-  double alpha = D * dt / (dx * dx); // Stability requires alpha < 0.5
+  double D = diffusivity(temperature);
+
+  if (scheme_ == Scheme::Explicit || n < 3) {
+    double alpha = D * dt; // Stability requires alpha (lower + upper) <= 1
+
+    int steps = static_cast<int>(time / dt);
+    int t = 0;
+    for (; t < steps; ++t) {
+      if (t % 64 == 0 && cancel.stopRequested()) {
+        break;
+      }
+      for (int i = 1; i < n - 1; ++i) {
+        new_profile[i] = profile[i] + alpha * (lower[i] * (profile[i - 1] - profile[i]) +
+                                               upper[i] * (profile[i + 1] - profile[i]));
+      }
+      profile.swap(new_profile); // Both keep the boundary values
+    }
+    if (t < steps) {
+      SEMIPRO_LOGF(INFO, PHYSICS, "Diffusion interrupted after {} of {}s", t * dt, time);
+    }
+    SEMIPRO_LOGF(INFO, PHYSICS, "Diffusion: temp={}K, time={}s", temperature, time);
+    return profile;
+  }
+
+  const double theta = scheme_ == Scheme::Implicit ? 1.0 : 0.5;
+  const double order = scheme_ == Scheme::Implicit ? 1.0 : 2.0;
+  Eigen::ArrayXd half(n), doubled(n), scratch(n);
+  double elapsed = 0.0;
+  double step = dt > 0.0 ? dt : time;
+  int accepted = 0, rejected = 0;
+  while (elapsed < time) {
+    if (cancel.stopRequested()) {
+      SEMIPRO_LOGF(INFO, PHYSICS, "Diffusion interrupted after {} of {}s", elapsed, time);
+      break;
+    }
+    const double h = std::min(step, time - elapsed);
+    const double alpha = D * h;
+    if (!adaptive_) {
+      implicitStep(profile, new_profile, lower, upper, alpha, theta, scratch);
+      profile.swap(new_profile);
+      elapsed += h;
+      ++accepted;
+      continue;
+    }
 
-  int steps = static_cast<int>(time / dt);
-  for (int t = 0; t < steps; ++t) {
-    for (int i = 1; i < n - 1; ++i) {
-      new_profile[i] = profile[i] + alpha * (profile[i + 1] - 2 * profile[i] + profile[i - 1]);
+    // Step doubling: one step of h against two of h / 2
+    implicitStep(profile, new_profile, lower, upper, alpha, theta, scratch);
+    implicitStep(profile, half, lower, upper, 0.5 * alpha, theta, scratch);
+    implicitStep(half, doubled, lower, upper, 0.5 * alpha, theta, scratch);
+    const double error = (doubled - new_profile).abs().maxCoeff();
+    const double allowed = tolerance_ * std::max(profile.abs().maxCoeff(), std::numeric_limits<double>::min());
+    const double factor = error > 0.0 ? 0.9 * std::pow(allowed / error, 1.0 / (order + 1.0)) : 2.0;
+    if (error <= allowed || h <= 1e-12 * time) {
+      profile.swap(doubled);
+      elapsed += h;
+      ++accepted;
+    } else {
+      ++rejected;
     }
-    profile = new_profile;
+    step = h * std::min(2.0, std::max(0.2, factor));
   }
 
-  Logger::getInstance().log("Diffusion: temp=" + std::to_string(temperature) + "K, time=" + std::to_string(time) + "s");
+  SEMIPRO_LOGF(INFO, PHYSICS, "Diffusion: temp={}K, time={}s, {} steps ({} rejected)", temperature, time, accepted,
+               rejected);
   return profile;
-}
\ No newline at end of file
+}
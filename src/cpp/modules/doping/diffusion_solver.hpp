@@ -2,11 +2,78 @@
 #define DIFFUSION_SOLVER_HPP
 
 #include "../../core/wafer.hpp"
+#include "../../core/cancellation.hpp"
+#include "../../core/depth_mesh.hpp"
+#include "../../core/distributed_field.hpp"
 
+// 1D dopant diffusion with fixed boundary values. Explicit is FTCS and
+// needs D dt / dx^2 <= 0.5; Implicit (backward Euler) and CrankNicolson
+// are unconditionally stable, each step being one tridiagonal (Thomas)
+// solve, so a long anneal takes a few large steps. On a DepthMesh the
+// same schemes run as finite volumes over the mesh's control volumes, and
+// Explicit shortens its step to the finest spacing's stability limit.
 class DiffusionSolver {
 public:
+  enum class Scheme { Explicit, Implicit, CrankNicolson };
+
   DiffusionSolver();
-  Eigen::ArrayXd simulateDiffusion(const Eigen::ArrayXd& initial_profile, double temperature, double time, double dx, double dt) const;
+
+  void setScheme(Scheme scheme) { scheme_ = scheme; }
+  Scheme getScheme() const { return scheme_; }
+  // Implicit schemes only: adapt the step by step doubling, keeping each
+  // step's estimated error under tolerance times the profile's peak. The
+  // dt given to simulateDiffusion is then the first step tried.
+  void setAdaptiveStepping(bool enable, double tolerance = 1e-4) {
+    adaptive_ = enable;
+    tolerance_ = tolerance;
+  }
+  bool isAdaptiveStepping() const { return adaptive_; }
+
+  // Stops after the current time step once `cancel` fires and returns the
+  // profile diffused up to that point
+  Eigen::ArrayXd simulateDiffusion(const Eigen::ArrayXd& initial_profile, double temperature, double time, double dx, double dt,
+                                   const CancellationToken& cancel = CancellationToken::current()) const;
+  Eigen::ArrayXd simulateDiffusion(const DepthMesh& mesh, const Eigen::ArrayXd& initial_profile, double temperature,
+                                   double time, double dt,
+                                   const CancellationToken& cancel = CancellationToken::current()) const;
+
+  // Lateral diffusion of a 2D concentration split across the ranks of a
+  // DistributedField, e.g. one depth of a wafer-scale doping map: FTCS on
+  // the field's tiles with the halos exchanged across ranks each step,
+  // zero flux at the field's edge, and the fewest equal steps keeping
+  // D dt / dx^2 <= 0.25. Needs a halo of at least one. Collective. On a
+  // single rank with a GPU active, the steps run on the device.
+  void simulateLateralDiffusion(DistributedField& concentration, double temperature, double time, double dx) const;
+
+  // Derivatives of J = sum_i weights_i c_i(time), c the profile the
+  // fixed-step simulateDiffusion gives, by the discrete adjoint: the
+  // forward steps are kept and one backward sweep of transposed
+  // tridiagonal solves gives every derivative at once, for about the cost
+  // of a second simulation however many inputs there are. Adaptive
+  // stepping and cancellation are not applied. Throws
+  // std::invalid_argument when the weights and profile differ in size.
+  struct Sensitivity {
+    double value = 0.0;            // J
+    double d_temperature = 0.0;    // dJ/dT, per K
+    double d_time = 0.0;           // dJ/dtime, per s; zero for Explicit, whose steps drop the remainder
+    Eigen::ArrayXd d_initial;      // dJ/dc_i(0)
+  };
+  Sensitivity adjointSensitivity(const Eigen::ArrayXd& initial_profile, const Eigen::ArrayXd& weights,
+                                 double temperature, double time, double dx, double dt) const;
+
+  // Diffusion coefficient (cm^2/s) at temperature (K)
+  static double diffusivity(double temperature);
+
+private:
+  // Steps c_t = D (lower_i (c_{i-1} - c_i) + upper_i (c_{i+1} - c_i)) over
+  // the interior nodes, the end values held
+  Eigen::ArrayXd diffuse(const Eigen::ArrayXd& initial_profile, const Eigen::ArrayXd& lower,
+                         const Eigen::ArrayXd& upper, double temperature, double time, double dt,
+                         const CancellationToken& cancel) const;
+
+  Scheme scheme_ = Scheme::Explicit;
+  bool adaptive_ = false;
+  double tolerance_ = 1e-4;
 };
 
-#endif // DIFFUSION_SOLVER_HPP
\ No newline at end of file
+#endif // DIFFUSION_SOLVER_HPP
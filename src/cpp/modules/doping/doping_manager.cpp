@@ -1,14 +1,44 @@
 #include "doping_manager.hpp"
+#include <algorithm>
+#include <cmath>
 
 DopingManager::DopingManager() {}
 
 void DopingManager::simulateIonImplantation(std::shared_ptr<Wafer> wafer, double energy, double dose) {
+  if (adaptive_mesh_) {
+    const DepthMesh mesh = monte_carlo_.implantMesh(wafer->getThickness(), energy);
+    wafer->setDopantProfile(mesh, monte_carlo_.simulateImplantation(wafer, mesh, energy, dose));
+    return;
+  }
   auto profile = monte_carlo_.simulateImplantation(wafer, energy, dose);
   wafer->setDopantProfile(profile);
 }
 
 void DopingManager::simulateDiffusion(std::shared_ptr<Wafer> wafer, double temperature, double time) {
+  if (adaptive_mesh_) {
+    const DepthMesh& mesh = wafer->getDopantMesh();
+    const Eigen::ArrayXd& initial = wafer->getDopantMeshProfile();
+    if (mesh.size() < 3) {
+      return;
+    }
+    // Work at the finest current spacing out to where the profile may
+    // spread, six diffusion lengths past its last significant value
+    const Eigen::ArrayXd& x = mesh.nodes();
+    const int n = mesh.size();
+    const double finest = std::max((x.tail(n - 1) - x.head(n - 1)).minCoeff(), refinement_.min_spacing);
+    const double significant = refinement_.floor * initial.abs().maxCoeff();
+    int last = n - 1;
+    while (last > 0 && std::abs(initial[last]) <= significant) {
+      --last;
+    }
+    const double length = std::sqrt(DiffusionSolver::diffusivity(temperature) * time) * 1e4; // um
+    const DepthMesh work = DepthMesh::graded(mesh.upper(), finest, x[last] + 6.0 * length, refinement_.growth);
+    const Eigen::ArrayXd diffused = diffusion_.simulateDiffusion(work, mesh.remap(initial, work), temperature, time, dt_);
+    const DepthMesh adapted = DepthMesh::adapted(work, diffused, refinement_);
+    wafer->setDopantProfile(adapted, work.remap(diffused, adapted));
+    return;
+  }
   auto initial_profile = wafer->getDopantProfile();
   auto profile = diffusion_.simulateDiffusion(initial_profile, temperature, time, dx_, dt_);
   wafer->setDopantProfile(profile);
-}
\ No newline at end of file
+}
@@ -11,11 +11,22 @@ public:
   void simulateIonImplantation(std::shared_ptr<Wafer> wafer, double energy, double dose) override;
   void simulateDiffusion(std::shared_ptr<Wafer> wafer, double temperature, double time) override;
 
+  // Keep the wafer's profile on an adaptive depth mesh rather than its
+  // uniform grid: implants run on a mesh graded about the range, and each
+  // anneal re-adapts the mesh to the diffused profile
+  void setAdaptiveMesh(bool enable, const DepthMesh::Refinement& refinement = DepthMesh::Refinement()) {
+    adaptive_mesh_ = enable;
+    refinement_ = refinement;
+  }
+  bool isAdaptiveMesh() const { return adaptive_mesh_; }
+
 private:
   MonteCarloSolver monte_carlo_;
   DiffusionSolver diffusion_;
   double dx_ = 1e-6; // um
   double dt_ = 1.0;  // s
+  bool adaptive_mesh_ = false;
+  DepthMesh::Refinement refinement_;
 };
 
 #endif // DOPING_MANAGER_HPP
\ No newline at end of file
@@ -0,0 +1,87 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "implant_moments.hpp"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+namespace {
+
+constexpr double kBohrRadius = 0.52918e-8; // cm
+constexpr double kCoulomb = 14.3996e-8;    // e^2 in eV cm
+constexpr double kMinEnergy = 1e-2;        // keV
+constexpr int kSubsteps = 8;               // Integration steps per table interval
+
+} // namespace
+
+const ImplantMoments& ImplantMoments::table(const BCATransport::Species& ion, const BCATransport::Target& target) {
+  using Key = std::array<double, 5>;
+  static std::shared_mutex mutex;
+  static std::map<Key, std::unique_ptr<ImplantMoments>> tables;
+
+  const Key key = {ion.atomic_number, ion.atomic_mass, target.atomic_number, target.atomic_mass,
+                   target.atomic_density};
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto found = tables.find(key);
+    if (found != tables.end()) {
+      return *found->second;
+    }
+  }
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  auto& entry = tables[key];
+  if (!entry) {
+    entry = std::make_unique<ImplantMoments>(ion, target);
+  }
+  return *entry;
+}
+
+ImplantMoments::ImplantMoments(const BCATransport::Species& ion, const BCATransport::Target& target)
+    : log_min_energy_(std::log(kMinEnergy)), inverse_step_(kPointsPerDecade / std::log(10.0)),
+      log_moments_(kPoints) {
+  const double z1 = ion.atomic_number, m1 = ion.atomic_mass;
+  const double z2 = target.atomic_number, m2 = target.atomic_mass;
+  const double density = target.atomic_density;
+  const double screening_length = 0.8854 * kBohrRadius / (std::pow(z1, 0.23) + std::pow(z2, 0.23));
+  const double eps_per_ev = screening_length * m2 / (z1 * z2 * kCoulomb * (m1 + m2));
+  const double nuclear_scale = M_PI * screening_length * screening_length * 4.0 * m1 * m2 /
+                               ((m1 + m2) * (m1 + m2) * eps_per_ev);
+  const double electronic = 1.212e-16 * std::pow(z1, 7.0 / 6.0) * z2 /
+                            (std::pow(std::pow(z1, 2.0 / 3.0) + std::pow(z2, 2.0 / 3.0), 1.5) * std::sqrt(m1));
+  const double deflection = m2 / (2.0 * m1);
+  const double straggling = 2.0 * std::sqrt(m1 * m2) / (3.0 * (m1 + m2));
+  const double lateral = straggling * std::pow(m2 / m1, 0.25);
+
+  // Stopping cross sections (eV cm^2) at energy (eV)
+  auto nuclear = [&](double energy) {
+    const double eps = eps_per_ev * energy;
+    const double reduced = eps <= 30.0 ? std::log(1.0 + 1.1383 * eps) /
+                                             (2.0 * (eps + 0.01321 * std::pow(eps, 0.21226) + 0.19593 * std::sqrt(eps)))
+                                       : std::log(eps) / (2.0 * eps);
+    return nuclear_scale * reduced;
+  };
+
+  // Projected range R_p(E) = exp(-G(E)) H(E), with G the accumulated log
+  // decay of the direction cosine and H the path integral of exp(G) ds,
+  // so one pass up the energies fills the table
+  double energy = kMinEnergy * 1e3;
+  double log_decay = 0.0;
+  double path = energy / (density * (nuclear(energy) + electronic * std::sqrt(energy)));
+  const double ratio = std::pow(10.0, 1.0 / (kPointsPerDecade * kSubsteps));
+  for (int k = 0; k < kPoints; ++k) {
+    if (k > 0) {
+      for (int s = 0; s < kSubsteps; ++s) {
+        const double next = energy * ratio;
+        const double mid = std::sqrt(energy * next);
+        const double sn = nuclear(mid);
+        const double total = sn + electronic * std::sqrt(mid);
+        const double step_decay = deflection * sn / total * (next - energy) / mid;
+        path += std::exp(log_decay + 0.5 * step_decay) * (next - energy) / (density * total);
+        log_decay += step_decay;
+        energy = next;
+      }
+    }
+    const double range = std::exp(-log_decay) * path * 1e4; // um
+    log_moments_[k] = {std::log(range), std::log(straggling * range), std::log(lateral * range)};
+  }
+}
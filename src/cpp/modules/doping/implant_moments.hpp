@@ -0,0 +1,81 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef IMPLANT_MOMENTS_HPP
+#define IMPLANT_MOMENTS_HPP
+
+#include "bca_transport.hpp"
+#include "../../core/autodiff.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+// Range moments of an ion in a target, tabulated against energy.
+//
+// The mean projected range is first-order LSS transport theory: the path
+// length follows from ZBL universal nuclear and Lindhard-Scharff
+// electronic stopping (as in BCATransport), and the mean direction cosine
+// decays as nuclear collisions deflect the ion, by M2 / 2M1 per unit of
+// fractional energy given to the target. Straggling is Lindhard's
+// 2 sqrt(M1 M2) / 3 (M1 + M2) of the range, and the lateral straggling
+// (M2 / M1)^(1/4) of that, a fit to tabulated ranges in silicon.
+//
+// Tables are built once per ion and target, on first request, over
+// 10 eV to 100 MeV; lookups interpolate linearly in log-log space with no
+// branches, clamping energies outside the table to its ends.
+class ImplantMoments {
+public:
+  struct Moments {
+    double projected_range;     // um
+    double range_straggling;    // um
+    double lateral_straggling;  // um
+  };
+
+  // Shared table for this pair; the reference stays valid for the life
+  // of the program. Safe to call from any thread.
+  static const ImplantMoments& table(const BCATransport::Species& ion,
+                                     const BCATransport::Target& target = BCATransport::silicon());
+
+  ImplantMoments(const BCATransport::Species& ion, const BCATransport::Target& target);
+
+  Moments at(double energy) const { // keV
+    double x = (std::log(energy) - log_min_energy_) * inverse_step_;
+    x = std::min(std::max(x, 0.0), static_cast<double>(kPoints - 1) * (1.0 - 1e-12));
+    const int i = static_cast<int>(x);
+    const double f = x - i;
+    const std::array<double, 3>& lo = log_moments_[i];
+    const std::array<double, 3>& hi = log_moments_[i + 1];
+    return {std::exp(lo[0] + f * (hi[0] - lo[0])), std::exp(lo[1] + f * (hi[1] - lo[1])),
+            std::exp(lo[2] + f * (hi[2] - lo[2]))};
+  }
+
+  // at() for any scalar type, as projected range, range straggling and
+  // lateral straggling: with an ADScalar energy the moments carry their
+  // derivatives with respect to it, exact for the interpolant, whose slope
+  // steps at the table's points and is zero past its ends
+  template <typename Scalar>
+  std::array<Scalar, 3> momentsAt(const Scalar& energy) const {
+    using std::exp;
+    using std::log;
+    Scalar x = (log(energy) - log_min_energy_) * inverse_step_;
+    const double end = static_cast<double>(kPoints - 1) * (1.0 - 1e-12);
+    if (!(scalarValue(x) >= 0.0 && scalarValue(x) <= end)) {
+      x = x * 0.0 + std::min(std::max(scalarValue(x), 0.0), end);
+    }
+    const int i = static_cast<int>(scalarValue(x));
+    const Scalar f = x - static_cast<double>(i);
+    const std::array<double, 3>& lo = log_moments_[i];
+    const std::array<double, 3>& hi = log_moments_[i + 1];
+    return {Scalar(exp(lo[0] + f * (hi[0] - lo[0]))), Scalar(exp(lo[1] + f * (hi[1] - lo[1]))),
+            Scalar(exp(lo[2] + f * (hi[2] - lo[2])))};
+  }
+
+  static constexpr int kPointsPerDecade = 48;
+  static constexpr int kPoints = 7 * kPointsPerDecade + 1;
+
+private:
+  double log_min_energy_;
+  double inverse_step_;
+  std::vector<std::array<double, 3>> log_moments_;
+};
+
+#endif // IMPLANT_MOMENTS_HPP
@@ -1,142 +1,274 @@
 #include "monte_carlo_solver.hpp"
+#include "bca_transport.hpp"
+#include "../../core/gpu_compute.hpp"
+#include "../../core/philox.hpp"
+#include "../../core/progress_events.hpp"
+#include "../../core/reproducibility.hpp"
+#include "../../core/task_scheduler.hpp"
 #include "../../core/utils.hpp"
+#include <atomic>
 #include <cmath>
-#include <iostream>
-#include <chrono>
+#include <mutex>
+
+namespace {
+
+// Ions per scheduler task; fixed, so the work split (though not its
+// scheduling) is the same on any machine
+constexpr long kChunkIons = 1 << 16;
+// Ions drawn before they are binned, keeping both loops tight
+constexpr int kBatchIons = 256;
+// Gaussian samples per traced ion, for the adaptive BCA ion count
+constexpr long kBinaryCollisionCost = 100;
+
+// Draws `num_ions` Gaussian depths and counts them into `bins` by
+// `bin(depth)`, dropping indices past the end
+template <class Bin>
+std::vector<std::uint64_t> countIons(const Philox4x32& philox, std::uint64_t stream, long num_ions, double range_mean,
+                                     double range_stdev, int bins, const Bin& bin, ProgressReporter& progress,
+                                     const CancellationToken& cancel, long& ions_simulated) {
+  const int chunks = static_cast<int>((num_ions + kChunkIons - 1) / kChunkIons);
+
+  std::vector<std::uint64_t> counts(bins, 0);
+  ions_simulated = 0;
+  std::mutex merge_mutex;
+  std::atomic<bool> stopped{false};
+
+  TaskScheduler::getInstance().parallelFor(0, chunks, [&](int first, int last) {
+    std::vector<std::uint64_t> local(bins, 0);
+    long traced = 0;
+    double depth[kBatchIons];
+    for (int chunk = first; chunk < last; ++chunk) {
+      if (stopped.load(std::memory_order_relaxed) || cancel.stopRequested()) {
+        stopped.store(true, std::memory_order_relaxed);
+        break;
+      }
+      const long begin = chunk * kChunkIons;
+      const long end = std::min(num_ions, begin + kChunkIons);
+      for (long ion = begin; ion < end; ion += kBatchIons) {
+        // Ions 2p and 2p + 1 share the Box-Muller pair of block p
+        const long batch = std::min<long>(kBatchIons, end - ion);
+        for (long k = 0; k < batch; k += 2) {
+          const auto z = Philox4x32::normals(philox(static_cast<std::uint64_t>((ion + k) / 2), stream));
+          depth[k] = range_mean + range_stdev * z[0];
+          depth[k + 1] = range_mean + range_stdev * z[1];
+        }
+        for (long k = 0; k < batch; ++k) {
+          const int index = bin(depth[k]);
+          if (index < bins) {
+            ++local[index];
+          }
+        }
+      }
+      traced += end - begin;
+    }
+
+    std::lock_guard<std::mutex> lock(merge_mutex);
+    for (int i = 0; i < bins; ++i) {
+      counts[i] += local[i];
+    }
+    ions_simulated += traced;
+    progress.update(static_cast<double>(ions_simulated));
+  }, 1);
+
+  if (stopped.load()) {
+    progress.warning("interrupted", static_cast<double>(ions_simulated));
+  }
+  return counts;
+}
+
+} // namespace
+
+MonteCarloSolver::MonteCarloSolver()
+    : MonteCarloSolver(Reproducibility::key("monte_carlo")) {}
+
+MonteCarloSolver::MonteCarloSolver(std::uint64_t seed) : seed_(seed) {}
 
-MonteCarloSolver::MonteCarloSolver() : rng_(std::random_device{}()) {}
+void MonteCarloSolver::setSeed(std::uint64_t seed) {
+  seed_ = seed;
+  implants_ = 0;
+}
 
-Eigen::ArrayXd MonteCarloSolver::simulateImplantation(std::shared_ptr<Wafer> wafer, double energy, double dose) {
+Eigen::ArrayXd MonteCarloSolver::simulateImplantation(std::shared_ptr<Wafer> wafer, double energy, double dose,
+                                                      const CancellationToken& cancel) {
   int x_dim = wafer->getGrid().rows();
   Eigen::ArrayXd profile = Eigen::ArrayXd::Zero(x_dim);
 
-  // Debug output
-  std::cout << "DEBUG: Monte Carlo simulation starting\n";
-  std::cout << "  Grid dimensions: " << x_dim << " points\n";
-  std::cout << "  Wafer thickness: " << wafer->getThickness() << " μm\n";
-  std::cout << "  Energy: " << energy << " keV\n";
-  std::cout << "  Dose: " << dose << " cm⁻²\n";
-
   // Enhanced physics model for ion implantation
   // Use Lindhard-Scharff-Schiott (LSS) theory for range calculation
   double range_mean = calculateLSSRange(energy, "B", "Si"); // LSS range in μm
   double range_stdev = calculateRangeStraggle(energy, "B", "Si"); // Range straggle
 
-  // Use Pearson IV distribution for more accurate range profiles
-  std::normal_distribution<double> dist(range_mean, range_stdev);
-
   // Adaptive number of Monte Carlo particles based on dose and accuracy requirements
-  long num_ions = calculateOptimalParticleCount(dose, energy, wafer->getGrid().rows());
+  long num_ions =
+      particle_count_ > 0 ? particle_count_ : calculateOptimalParticleCount(dose, energy, wafer->getGrid().rows());
   double dz = wafer->getThickness() / x_dim; // Grid spacing (um)
 
-  // Hard limit to prevent timeouts
-  if (num_ions > 5000) {
-    std::cout << "  WARNING: Reducing particle count from " << num_ions << " to 5000 to prevent timeout\n";
-    num_ions = 5000;
-  }
-
-  std::cout << "  Number of ions: " << num_ions << "\n";
-  std::cout << "  Grid spacing: " << dz << " μm\n";
-  std::cout << "  Range mean: " << range_mean << " μm\n";
-  std::cout << "  Range stdev: " << range_stdev << " μm\n";
-
-  long ions_deposited = 0;
-  long progress_interval = num_ions / 10; // Report progress every 10%
-  if (progress_interval == 0) progress_interval = 1;
-
-  // Safety check to prevent infinite loops
-  auto start_time = std::chrono::steady_clock::now();
-  const auto max_duration = std::chrono::seconds(15); // 15 second hard limit
-
-  for (long i = 0; i < num_ions; ++i) {
-    // Progress tracking to prevent timeout appearance
-    if (i % progress_interval == 0) {
-      std::cout << "  Progress: " << (100 * i / num_ions) << "% (" << i << "/" << num_ions << " ions)\n";
-
-      // Check for timeout
-      auto current_time = std::chrono::steady_clock::now();
-      if (current_time - start_time > max_duration) {
-        std::cout << "  WARNING: Simulation timeout, stopping at " << i << " ions\n";
-        break;
-      }
-    }
-
-    double depth = std::max(0.0, dist(rng_)); // Depth in um
-    int index = static_cast<int>(depth / dz);
-    if (index < x_dim) {
-      profile[index] += 1.0;
-      ions_deposited++;
+  if (transport_ == Transport::BinaryCollision) {
+    if (particle_count_ <= 0) {
+      num_ions = std::max(1000L, num_ions / kBinaryCollisionCost);
     }
+    return traceImplantation(energy, dose, num_ions, x_dim, dz, implants_++, cancel);
   }
 
-  std::cout << "  Ions deposited in wafer: " << ions_deposited << "\n";
+  ProgressReporter progress("monte_carlo", "ions", static_cast<double>(num_ions), 0.1);
+  progress.metric("energy_keV", energy);
+  progress.metric("dose_cm2", dose);
+  progress.metric("grid_spacing_um", dz);
+  progress.metric("range_mean_um", range_mean);
+  progress.metric("range_stdev_um", range_stdev);
+
+  long ions_simulated = 0;
+  const std::uint64_t stream = implants_++;
+  std::vector<std::uint64_t> counts(x_dim, 0);
+  auto gpu = cancel.stopRequested() ? nullptr : Gpu::active();
+  if (gpu && gpu->countGaussianDepths(seed_, stream, num_ions, range_mean, range_stdev, dz, counts)) {
+    ions_simulated = num_ions;
+    progress.update(static_cast<double>(num_ions));
+  } else {
+    counts = countIons(Philox4x32(seed_), stream, num_ions, range_mean, range_stdev, x_dim,
+                       [dz](double depth) { return static_cast<int>(std::max(0.0, depth) / dz); }, // Depth in um
+                       progress, cancel, ions_simulated);
+  }
+  std::uint64_t ions_deposited = 0;
+  for (int i = 0; i < x_dim; ++i) {
+    profile[i] = static_cast<double>(counts[i]);
+    ions_deposited += counts[i];
+  }
+  progress.metric("ions_deposited", static_cast<double>(ions_deposited));
 
   // Convert to concentration (cm^-3): scale by actual dose
   if (ions_deposited > 0) {
-    double scaling_factor = dose / (num_ions * dz * 1e-4); // Proper scaling to get dose in cm^-2
+    double scaling_factor = dose / (ions_simulated * dz * 1e-4); // Proper scaling to get dose in cm^-2
     profile *= scaling_factor;
   }
 
-  double max_conc = profile.maxCoeff();
-  std::cout << "  Max concentration: " << max_conc << " cm⁻³\n";
+  progress.metric("max_concentration_cm3", profile.maxCoeff());
 
-  Logger::getInstance().log("Enhanced ion implantation: energy=" + std::to_string(energy) + "keV, dose=" + std::to_string(dose) + "cm^-2, particles=" + std::to_string(num_ions));
+  SEMIPRO_LOGF(INFO, PHYSICS, "Enhanced ion implantation: energy={}keV, dose={}cm^-2, particles={}",
+               energy, dose, ions_simulated);
   return profile;
 }
 
-double MonteCarloSolver::calculateLSSRange(double energy, const std::string& ion, const std::string& target) {
-  // Lindhard-Scharff-Schiott theory implementation
-  // Simplified model for demonstration - in practice would use full LSS tables
+Eigen::ArrayXd MonteCarloSolver::simulateImplantation(std::shared_ptr<Wafer> wafer, const DepthMesh& mesh, double energy,
+                                                      double dose, const CancellationToken& cancel) {
+  const int n = mesh.size();
+  if (n == 0) {
+    return Eigen::ArrayXd();
+  }
+  const double range_mean = calculateLSSRange(energy, "B", "Si");
+  const double range_stdev = calculateRangeStraggle(energy, "B", "Si");
+  long num_ions =
+      particle_count_ > 0 ? particle_count_ : calculateOptimalParticleCount(dose, energy, wafer->getGrid().rows());
+
+  if (transport_ == Transport::BinaryCollision) {
+    // Traced on uniform bins as fine as the mesh's finest spacing
+    if (particle_count_ <= 0) {
+      num_ions = std::max(1000L, num_ions / kBinaryCollisionCost);
+    }
+    const Eigen::ArrayXd& x = mesh.nodes();
+    const double finest = n > 1 ? (x.tail(n - 1) - x.head(n - 1)).minCoeff() : mesh.upper() - mesh.lower();
+    const double reach = std::min(mesh.upper(), range_mean + 10.0 * range_stdev);
+    const int bins = std::max(1, static_cast<int>(std::ceil(reach / finest)));
+    const double dz = reach / bins;
+    const Eigen::ArrayXd traced = traceImplantation(energy, dose, num_ions, bins, dz, implants_++, cancel);
+    Eigen::ArrayXd padded = Eigen::ArrayXd::Zero(bins + 1);
+    padded.head(bins) = traced;
+    Eigen::ArrayXd centres(bins + 1);
+    centres.head(bins) = Eigen::ArrayXd::LinSpaced(bins, 0.5 * dz, reach - 0.5 * dz);
+    centres[bins] = std::max(mesh.upper(), reach + 0.5 * dz);
+    return DepthMesh(centres, 0.0, centres[bins]).remap(padded, mesh);
+  }
 
-  double mass_ion = getAtomicMass(ion);      // amu
-  double mass_target = getAtomicMass(target); // amu
-  double z_ion = getAtomicNumber(ion);
-  double z_target = getAtomicNumber(target);
+  ProgressReporter progress("monte_carlo", "ions", static_cast<double>(num_ions), 0.1);
+  progress.metric("energy_keV", energy);
+  progress.metric("dose_cm2", dose);
+  progress.metric("mesh_points", n);
+  progress.metric("range_mean_um", range_mean);
+  progress.metric("range_stdev_um", range_stdev);
+
+  long ions_simulated = 0;
+  const double end = mesh.upper();
+  const std::vector<std::uint64_t> counts =
+      countIons(Philox4x32(seed_), implants_++, num_ions, range_mean, range_stdev, n,
+                [&mesh, n, end](double depth) { return depth < end ? mesh.cellAt(depth) : n; }, progress, cancel,
+                ions_simulated);
+
+  Eigen::ArrayXd profile(n);
+  for (int i = 0; i < n; ++i) {
+    profile[i] = static_cast<double>(counts[i]);
+  }
+  if (ions_simulated > 0) {
+    profile *= dose / (ions_simulated * 1e-4) / mesh.volumes(); // Per control volume, in cm^-3
+  }
+  progress.metric("max_concentration_cm3", profile.maxCoeff());
 
-  // Reduced mass
-  double mu = (mass_ion * mass_target) / (mass_ion + mass_target);
+  SEMIPRO_LOGF(INFO, PHYSICS, "Ion implantation on a {}-point mesh: energy={}keV, dose={}cm^-2, particles={}", n,
+               energy, dose, ions_simulated);
+  return profile;
+}
 
-  // LSS range formula (simplified)
-  double range_factor = 0.325; // Empirical constant
-  double range = range_factor * (mass_ion / mass_target) *
-                 std::pow(energy / (z_ion * z_target * std::pow(z_ion + z_target, 0.23)), 1.8);
+DepthMesh MonteCarloSolver::implantMesh(double thickness, double energy) {
+  const ImplantMoments::Moments moments = momentTable("B", "Si").at(energy);
+  return DepthMesh::graded(thickness, 0.1 * moments.range_straggling,
+                           moments.projected_range + 6.0 * moments.range_straggling);
+}
 
-  return range; // μm
+Eigen::ArrayXd MonteCarloSolver::traceImplantation(double energy, double dose, long ions, int bins, double dz,
+                                                  std::uint64_t stream, const CancellationToken& cancel) {
+  const BCATransport transport(BCATransport::silicon(), seed_);
+  BCATransport::Beam beam{{getAtomicNumber("B"), getAtomicMass("B")}, energy};
+  const BCATransport::Result result = transport.run(beam, ions, bins, dz, stream, cancel);
+
+  Eigen::ArrayXd profile = Eigen::Map<const Eigen::ArrayXd>(result.ions.data(), bins);
+  if (result.traced > 0) {
+    profile *= dose / (result.traced * dz * 1e-4); // Ions per traced ion and cm to cm^-3
+  }
+  SEMIPRO_LOGF(INFO, PHYSICS,
+               "BCA ion implantation: energy={}keV, dose={}cm^-2, ions={}, mean depth={}um, backscattered={}",
+               energy, dose, result.traced, result.mean_depth, result.backscattered);
+  return profile;
 }
 
-double MonteCarloSolver::calculateRangeStraggle(double energy, const std::string& ion, const std::string& target) {
-  // Range straggling calculation based on Bohr straggling theory
-  double range_mean = calculateLSSRange(energy, ion, target);
+double MonteCarloSolver::calculateLSSRange(double energy, const std::string& ion, const std::string& target) {
+  return momentTable(ion, target).at(energy).projected_range; // μm
+}
 
-  // Bohr straggling parameter
-  double straggle_factor = 0.3; // Typical value for most ion-target combinations
+double MonteCarloSolver::calculateRangeStraggle(double energy, const std::string& ion, const std::string& target) {
+  return momentTable(ion, target).at(energy).range_straggling;
+}
 
-  return range_mean * straggle_factor;
+const ImplantMoments& MonteCarloSolver::momentTable(const std::string& ion, const std::string& target) {
+  BCATransport::Target medium = BCATransport::silicon();
+  if (target != "Si") {
+    medium.atomic_number = getAtomicNumber(target);
+    medium.atomic_mass = getAtomicMass(target);
+    if (target == "Ge") {
+      medium.atomic_density = 4.42e22;
+    }
+  }
+  return ImplantMoments::table({getAtomicNumber(ion), getAtomicMass(ion)}, medium);
 }
 
 long MonteCarloSolver::calculateOptimalParticleCount(double dose, double energy, int grid_size) {
   // Adaptive particle count based on simulation requirements
-  // Reduced for faster execution and timeout prevention
-
-  // Base particle count - reduced from 1000 to 500
-  long base_count = 500;
+  long base_count = 100000;
 
   // Scale with dose (higher dose needs more particles for accuracy)
   double dose_factor = std::log10(dose / 1e15) + 1.0; // Normalized to 1e15 cm^-2
-  dose_factor = std::max(0.1, std::min(5.0, dose_factor)); // Reduced max from 10 to 5
+  dose_factor = std::max(0.1, std::min(5.0, dose_factor));
 
   // Scale with energy (lower energy needs more particles for surface accuracy)
   double energy_factor = 100.0 / energy; // Inverse relationship
-  energy_factor = std::max(0.5, std::min(3.0, energy_factor)); // Reduced max from 5 to 3
+  energy_factor = std::max(0.5, std::min(3.0, energy_factor));
 
   // Scale with grid resolution
   double grid_factor = static_cast<double>(grid_size) / 100.0;
-  grid_factor = std::max(0.5, std::min(2.0, grid_factor)); // Reduced max from 3 to 2
+  grid_factor = std::max(0.5, std::min(2.0, grid_factor));
 
   long optimal_count = static_cast<long>(base_count * dose_factor * energy_factor * grid_factor);
 
-  // Limit to reasonable range - reduced max from 100000 to 10000 for timeout prevention
-  return std::max(100L, std::min(10000L, optimal_count));
+  // Past 10^7 ions the profile is smooth at any grid resolution
+  return std::max(10000L, std::min(10000000L, optimal_count));
 }
 
 double MonteCarloSolver::getAtomicMass(const std::string& element) {
@@ -2,19 +2,65 @@
 #define MONTE_CARLO_SOLVER_HPP
 
 #include "../../core/wafer.hpp"
-#include <random>
+#include "../../core/cancellation.hpp"
+#include "../../core/depth_mesh.hpp"
+#include "implant_moments.hpp"
+#include <cstdint>
 
+// Ion depths are drawn from Philox streams keyed by the seed: ion n of the
+// k-th implant always gets counter (n, k), so a seed reproduces every
+// profile bit for bit whatever the thread count. Ions are traced in fixed
+// chunks on the TaskScheduler, each worker counting into its own
+// histogram; the counts are integers, so merging them is exact in any
+// order. With a GPU active, Gaussian implants on the wafer's uniform bins
+// draw on the device from the same streams; its single-precision
+// logarithm and sines can move an ion near a bin edge to the next bin.
 class MonteCarloSolver {
 public:
+  // Gaussian samples depths around the LSS range; BinaryCollision traces
+  // every ion through the target (see BCATransport), at far higher cost
+  // per ion, so its adaptive ion count is a hundredth of the Gaussian one
+  enum class Transport { Gaussian, BinaryCollision };
+
+  // Seeded from Reproducibility::key: fixed in reproducible runs, random otherwise
   MonteCarloSolver();
-  Eigen::ArrayXd simulateImplantation(std::shared_ptr<Wafer> wafer, double energy, double dose);
+  explicit MonteCarloSolver(std::uint64_t seed);
+
+  // Restarts the implant sequence, as a new solver with this seed would
+  void setSeed(std::uint64_t seed);
+  std::uint64_t getSeed() const { return seed_; }
+  // Ions per implant; 0 (the default) adapts the count to dose, energy
+  // and grid size
+  void setParticleCount(long count) { particle_count_ = count; }
+  void setTransport(Transport transport) { transport_ = transport; }
+  Transport getTransport() const { return transport_; }
+
+  // Stops early once `cancel` fires; the ions traced so far are then
+  // scaled to the full dose, giving a noisier but complete profile
+  Eigen::ArrayXd simulateImplantation(std::shared_ptr<Wafer> wafer, double energy, double dose,
+                                      const CancellationToken& cancel = CancellationToken::current());
+  // The same on `mesh`, each ion counted into the control volume holding
+  // it; BinaryCollision traces on uniform bins of the finest spacing and
+  // remaps
+  Eigen::ArrayXd simulateImplantation(std::shared_ptr<Wafer> wafer, const DepthMesh& mesh, double energy, double dose,
+                                      const CancellationToken& cancel = CancellationToken::current());
+  // Graded over `thickness` (um): a tenth of the straggle down to six
+  // straggles past the range, then growing
+  DepthMesh implantMesh(double thickness, double energy);
 
 private:
-  mutable std::mt19937 rng_;
+  std::uint64_t seed_;
+  std::uint64_t implants_ = 0; // Implants so far, the second counter word
+  long particle_count_ = 0;
+  Transport transport_ = Transport::Gaussian;
+
+  Eigen::ArrayXd traceImplantation(double energy, double dose, long ions, int bins, double dz, std::uint64_t stream,
+                                   const CancellationToken& cancel);
 
   // Enhanced physics calculation methods
   double calculateLSSRange(double energy, const std::string& ion, const std::string& target);
   double calculateRangeStraggle(double energy, const std::string& ion, const std::string& target);
+  const ImplantMoments& momentTable(const std::string& ion, const std::string& target);
   long calculateOptimalParticleCount(double dose, double energy, int grid_size);
   double getAtomicMass(const std::string& element);
   double getAtomicNumber(const std::string& element);
@@ -1,7 +1,8 @@
 #include "etching_model.hpp"
 #include "../../core/utils.hpp"
+#include <stdexcept>
 
-EtchingModel::EtchingModel() {}
+EtchingModel::EtchingModel() : cell_size_(0.01) {}
 
 void EtchingModel::simulateEtching(std::shared_ptr<Wafer> wafer, double depth, const std::string& type) {
     if (type == "isotropic") {
@@ -9,40 +10,32 @@ void EtchingModel::simulateEtching(std::shared_ptr<Wafer> wafer, double depth, c
     } else if (type == "anisotropic") {
         simulate_anisotropic(wafer, depth);
     } else {
-        Logger::getInstance().log("ERROR: Unknown etching type: " + type);
+        SEMIPRO_LOGF(ERROR, PHYSICS, "Unknown etching type: {}", type);
         return;
     }
-    Logger::getInstance().log("Etching simulated: type=" + type + ", depth=" + std::to_string(depth) + "um");
+    SEMIPRO_LOGF(INFO, PHYSICS, "Etching simulated: type={}, depth={}um", type, depth);
 }
 
-void EtchingModel::simulate_isotropic(std::shared_ptr<Wafer> wafer, double depth) {
-    Eigen::ArrayXXd grid = wafer->getGrid();
-    const Eigen::ArrayXXd& pattern = wafer->getPhotoresistPattern();
-    Eigen::ArrayXXd new_grid = grid;
-    for (int i = 1; i < grid.rows() - 1; ++i) {
-        for (int j = 1; j < grid.cols() - 1; ++j) {
-            if (i < pattern.rows() && j < pattern.cols() && pattern(i, j) < 0.5) {
-                new_grid(i, j) -= depth;
-                // Lateral undercutting
-                new_grid(i + 1, j) -= 0.5 * depth;
-                new_grid(i - 1, j) -= 0.5 * depth;
-                new_grid(i, j + 1) -= 0.5 * depth;
-                new_grid(i, j - 1) -= 0.5 * depth;
-            }
-        }
+void EtchingModel::simulateProfile(std::shared_ptr<Wafer> wafer, double time, double reach,
+                                   const LevelSet::Velocity& velocity) {
+    FieldView grid = wafer->getGrid();
+    LevelSet::evolveHeights(grid, cell_size_, time, reach, velocity, &wafer->getPhotoresistMask());
+}
+
+void EtchingModel::setCellSize(double cell_size) {
+    if (!(cell_size > 0.0)) {
+        throw std::invalid_argument("Etching cell size must be positive");
     }
-    wafer->updateGrid(new_grid);
+    cell_size_ = cell_size;
+}
+
+void EtchingModel::simulate_isotropic(std::shared_ptr<Wafer> wafer, double depth) {
+    // Every face recedes at unit speed, so the open area is cut down depth
+    // and the resist edge undercut by as much
+    simulateProfile(wafer, depth, depth, LevelSet::directional(-1.0, 0.0));
 }
 
 void EtchingModel::simulate_anisotropic(std::shared_ptr<Wafer> wafer, double depth) {
-    Eigen::ArrayXXd grid = wafer->getGrid();
-    const Eigen::ArrayXXd& pattern = wafer->getPhotoresistPattern();
-    for (int i = 0; i < grid.rows(); ++i) {
-        for (int j = 0; j < grid.cols(); ++j) {
-            if (i < pattern.rows() && j < pattern.cols() && pattern(i, j) < 0.5) {
-                grid(i, j) -= depth;
-            }
-        }
-    }
-    wafer->updateGrid(grid);
-}
\ No newline at end of file
+    // Straight down only: the faces looking up recede and the walls stay
+    simulateProfile(wafer, depth, depth, LevelSet::directional(-1.0, 1.0));
+}
@@ -2,17 +2,31 @@
 #define ETCHING_HMODEL_HPP
 
 #include "etching_interface.hpp"
+#include "../../core/level_set.hpp"
 #include "../../core/wafer.hpp"
 #include <Eigen/Dense>
 
+// Etches the wafer's surface as a level set: the open area recedes along
+// its normals, the photoresist holds its top faces, and the profile below
+// the resist edge is free to undercut it.
 class EtchingModel : public EtchingInterface {
 public:
     EtchingModel();
     void simulateEtching(std::shared_ptr<Wafer> wafer, double depth, const std::string& type) override;
+    // Moves the surface under velocity for time, with the photoresist
+    // protecting the cells it covers; reach bounds how far it moves in um
+    void simulateProfile(std::shared_ptr<Wafer> wafer, double time, double reach,
+                         const LevelSet::Velocity& velocity);
+
+    // Side of one grid cell in um, which is also the level set's voxel
+    // height; throws std::invalid_argument unless positive
+    void setCellSize(double cell_size);
 
 private:
     void simulate_isotropic(std::shared_ptr<Wafer> wafer, double depth);
     void simulate_anisotropic(std::shared_ptr<Wafer> wafer, double depth);
+
+    double cell_size_;
 };
 
-#endif // ETCHING_HMODEL_HPP
\ No newline at end of file
+#endif // ETCHING_HMODEL_HPP
@@ -5,10 +5,10 @@ GeometryManager::GeometryManager() {}
 
 void GeometryManager::initializeGrid(std::shared_ptr<Wafer> wafer, int x_dim, int y_dim) {
   wafer->initializeGrid(x_dim, y_dim);
-  Logger::getInstance().log("Grid initialized: " + std::to_string(x_dim) + "x" + std::to_string(y_dim));
+  SEMIPRO_LOGF(INFO, SIMULATION, "Grid initialized: {}x{}", x_dim, y_dim);
 }
 
 void GeometryManager::applyLayer(std::shared_ptr<Wafer> wafer, double thickness, const std::string& material_id) {
   wafer->applyLayer(thickness, material_id);
-  Logger::getInstance().log("Layer applied: thickness=" + std::to_string(thickness) + ", material=" + material_id);
+  SEMIPRO_LOGF(INFO, SIMULATION, "Layer applied: thickness={}, material={}", thickness, material_id);
 }
\ No newline at end of file
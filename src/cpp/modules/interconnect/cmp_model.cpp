@@ -0,0 +1,290 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "cmp_model.hpp"
+#include "../../core/spectrum_cache.hpp"
+#include "../../core/tiled_grid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Least share of its load a cell is taken to bear, so a cell all low area
+// with the pad held off it cannot draw an unbounded pressure
+constexpr double kMinContact = 0.02;
+// Densities this close to 0 or 1 are one area only
+constexpr double kSingleArea = 1e-9;
+// Largest step-height change per step as a fraction of the contact height
+constexpr double kStepFraction = 0.5;
+
+// Share of the pad's pressure an area `below` under the pad's level feels:
+// all of it at the level or above, none past the contact height. A low
+// area is measured from the raised one beside it where that stands above
+// the level, as the pad rides on it there.
+double padContact(double below, double contact_height) {
+    return below <= 0.0 ? 1.0 : std::max(0.0, 1.0 - below / contact_height);
+}
+
+} // namespace
+
+CmpModel::CmpModel(int rows, int cols, const CmpOptions& options, std::shared_ptr<FftBackend> fft)
+    : rows_(rows), cols_(cols), options_(options), fft_(fft ? std::move(fft) : Fft::defaultBackend()) {
+    if (rows < 1 || cols < 1) {
+        throw std::invalid_argument("CMP grid must have at least one cell");
+    }
+    if (!(options.planarization_length > 0.0 && options.removal_rate > 0.0 && options.contact_height > 0.0)) {
+        throw std::invalid_argument("CMP planarization length, removal rate and contact height must be positive");
+    }
+    if (!(options.selectivity > 0.0)) {
+        throw std::invalid_argument("CMP selectivity must be positive");
+    }
+
+    // The Gaussian is cut at four sigma, or where no two cells of the grid
+    // are further apart; padding by that much keeps the circular
+    // convolution from wrapping
+    const double sigma = options.planarization_length;
+    const int reach_rows = std::min(static_cast<int>(std::ceil(4.0 * sigma)), rows - 1);
+    const int reach_cols = std::min(static_cast<int>(std::ceil(4.0 * sigma)), cols - 1);
+    padded_rows_ = fft_->goodSize(rows + reach_rows);
+    padded_cols_ = fft_->goodSize(cols + reach_cols);
+
+    SemiPRO::ContentHasher hasher;
+    hasher.update_string("cmp-kernel").update_string(fft_->name());
+    hasher.update_value(sigma).update_value(reach_rows).update_value(reach_cols);
+    hasher.update_value(padded_rows_).update_value(padded_cols_);
+    const int pr = padded_rows_, pc = padded_cols_;
+    const SpectrumCache::Entry entry = SpectrumCache::instance().get(hasher.finish(), "cmp-kernel", [&]() {
+        // Offset d sits at index d mod the padded size
+        auto axis = [sigma](int size, int reach) {
+            std::vector<double> weights(size, 0.0);
+            for (int d = -reach; d <= reach; ++d) {
+                weights[(d + size) % size] = std::exp(-0.5 * d * d / (sigma * sigma));
+            }
+            return weights;
+        };
+        const std::vector<double> gr = axis(pr, reach_rows);
+        const std::vector<double> gc = axis(pc, reach_cols);
+        std::vector<double> kernel(static_cast<std::size_t>(pr) * pc);
+        for (int p = 0; p < pr; ++p) {
+            for (int q = 0; q < pc; ++q) {
+                kernel[static_cast<std::size_t>(p) * pc + q] = gr[p] * gc[q];
+            }
+        }
+        SpectrumCache::Spectrum spectrum(static_cast<std::size_t>(pr) * (pc / 2 + 1));
+        fft_->forward(kernel.data(), spectrum.data(), pr, pc);
+        return std::vector<SpectrumCache::Spectrum>{std::move(spectrum)};
+    });
+    kernel_ = std::shared_ptr<const SpectrumCache::Spectrum>(entry, &entry->front());
+
+    std::vector<double> image(static_cast<std::size_t>(pr) * pc, 0.0);
+    for (int i = 0; i < rows; ++i) {
+        std::fill_n(image.begin() + static_cast<std::size_t>(i) * pc, cols, 1.0);
+    }
+    convolve(image);
+    coverage_.resize(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            coverage_(i, j) = image[static_cast<std::size_t>(i) * pc + j];
+        }
+    }
+}
+
+void CmpModel::convolve(std::vector<double>& image) const {
+    const int half = padded_cols_ / 2 + 1;
+    const int count = padded_rows_ * half;
+    std::vector<FftBackend::Complex> spectrum(static_cast<std::size_t>(count));
+    fft_->forward(image.data(), spectrum.data(), padded_rows_, padded_cols_);
+    const FftBackend::Complex* kernel = kernel_->data();
+#pragma omp parallel for
+    for (int k = 0; k < count; ++k) {
+        spectrum[k] *= kernel[k];
+    }
+    fft_->inverse(spectrum.data(), image.data(), padded_rows_, padded_cols_);
+}
+
+void CmpModel::checkShape(const Eigen::ArrayXXd& field) const {
+    if (field.rows() != rows_ || field.cols() != cols_) {
+        throw std::invalid_argument("Field shape does not match the CMP grid");
+    }
+}
+
+Eigen::ArrayXXd CmpModel::effectiveDensity(const Eigen::ArrayXXd& density) const {
+    checkShape(density);
+    const int pc = padded_cols_;
+    std::vector<double> image(static_cast<std::size_t>(padded_rows_) * pc, 0.0);
+    for (int i = 0; i < rows_; ++i) {
+        for (int j = 0; j < cols_; ++j) {
+            image[static_cast<std::size_t>(i) * pc + j] = density(i, j);
+        }
+    }
+    convolve(image);
+    Eigen::ArrayXXd effective(rows_, cols_);
+    for (int i = 0; i < rows_; ++i) {
+        for (int j = 0; j < cols_; ++j) {
+            effective(i, j) = image[static_cast<std::size_t>(i) * pc + j] / coverage_(i, j);
+        }
+    }
+    return effective;
+}
+
+CmpModel::Result CmpModel::polish(const Eigen::ArrayXXd& metal_density, double overburden, double step) const {
+    checkShape(metal_density);
+    overburden = std::max(0.0, overburden);
+    const Eigen::ArrayXXd up_density = (1.0 - metal_density).max(0.0).min(1.0);
+    const Eigen::ArrayXXd up = Eigen::ArrayXXd::Constant(rows_, cols_, overburden);
+    const Eigen::ArrayXXd down = Eigen::ArrayXXd::Constant(rows_, cols_, overburden - std::clamp(step, 0.0, overburden));
+    return run(up_density, up, down, true, 0.0);
+}
+
+CmpModel::Result CmpModel::planarize(const Eigen::ArrayXXd& up_density, const Eigen::ArrayXXd& up,
+                                     const Eigen::ArrayXXd& down, double tolerance) const {
+    checkShape(up_density);
+    checkShape(up);
+    checkShape(down);
+    return run(up_density.max(0.0).min(1.0), up, down, false, std::max(0.0, tolerance));
+}
+
+CmpModel::Result CmpModel::run(const Eigen::ArrayXXd& up_density, const Eigen::ArrayXXd& up,
+                               const Eigen::ArrayXXd& down, bool damascene, double tolerance) const {
+    const double rate = options_.removal_rate;
+    const double contact = options_.contact_height;
+    const double selectivity = options_.selectivity;
+    const int pc = padded_cols_;
+    const auto at = [pc](const TiledGrid::Tile& t, int i, int j) {
+        return static_cast<std::size_t>(t.origin_row + i) * pc + t.origin_col + j;
+    };
+
+    // A cell with one area only has no step: the missing one rides along
+    TiledGrid density(rows_, cols_, options_.tile_size, 0);
+    TiledGrid high(rows_, cols_, options_.tile_size, 0);
+    TiledGrid low(rows_, cols_, options_.tile_size, 0);
+    density.load(up_density);
+    high.load((up_density <= kSingleArea).select(down, up));
+    low.load((up_density >= 1.0 - kSingleArea).select(up, down));
+
+    const int tiles = density.tileCount();
+    std::vector<double> tile_contact(tiles), tile_metal(tiles), tile_step(tiles);
+    const std::size_t padded = static_cast<std::size_t>(padded_rows_) * pc;
+    std::vector<double> level(padded), load(padded);
+    const double lowest = -std::numeric_limits<double>::infinity();
+
+    Result result;
+    double end = options_.max_time;
+    for (;;) {
+        // The pad's level over each cell: the top of the cells about it,
+        // averaged under the kernel. A cell with a raised area tops out
+        // there; in one all low area the low area is the top.
+        std::fill(level.begin(), level.end(), 0.0);
+        high.forEachTile([&](TiledGrid::Tile& u) {
+            for (int j = 0; j < u.cols; ++j) {
+                for (int i = 0; i < u.rows; ++i) {
+                    level[at(u, i, j)] = u(i, j);
+                }
+            }
+        });
+        convolve(level);
+
+        // Then the load each cell's areas would take, and where the polish
+        // stands
+        std::fill(load.begin(), load.end(), 0.0);
+        high.forEachTile([&](TiledGrid::Tile& u) {
+            const TiledGrid::Tile rho = density.tile(u.index);
+            const TiledGrid::Tile d = low.tile(u.index);
+            double metal = lowest, step = lowest;
+            for (int j = 0; j < u.cols; ++j) {
+                for (int i = 0; i < u.rows; ++i) {
+                    const std::size_t k = at(u, i, j);
+                    const double pad = level[k] / coverage_(u.origin_row + i, u.origin_col + j);
+                    level[k] = pad;
+                    load[k] = rho(i, j) * padContact(pad - u(i, j), contact) +
+                              (1.0 - rho(i, j)) * padContact(std::max(pad, u(i, j)) - d(i, j), contact);
+                    // The step of a cell's own areas, or of a cell all low
+                    // area below the pad; what the pad leaves between
+                    // regions further apart is not planarized away
+                    if (rho(i, j) > kSingleArea) {
+                        metal = std::max(metal, u(i, j));
+                        step = std::max(step, u(i, j) - d(i, j));
+                    } else {
+                        step = std::max(step, pad - d(i, j));
+                    }
+                }
+            }
+            tile_metal[u.index] = metal;
+            tile_step[u.index] = step;
+        });
+        if (damascene) {
+            if (result.clear_time == 0.0 && *std::max_element(tile_metal.begin(), tile_metal.end()) <= 0.0) {
+                result.clear_time = result.time;
+                end = std::min(end, result.time * (1.0 + std::max(0.0, options_.overpolish)));
+            }
+        } else if (*std::max_element(tile_step.begin(), tile_step.end()) <= tolerance) {
+            break;
+        }
+        if (result.time >= end) {
+            break;
+        }
+
+        // The pressure on an area in contact is the blanket pressure over
+        // the contact density under the kernel
+        convolve(load);
+        high.forEachTile([&](TiledGrid::Tile& u) {
+            double least = std::numeric_limits<double>::infinity();
+            for (int j = 0; j < u.cols; ++j) {
+                for (int i = 0; i < u.rows; ++i) {
+                    double& effective = load[at(u, i, j)];
+                    effective = std::max(kMinContact, effective / coverage_(u.origin_row + i, u.origin_col + j));
+                    least = std::min(least, effective);
+                }
+            }
+            tile_contact[u.index] = least;
+        });
+
+        // No area comes down more than a fraction of the contact height in
+        // a step, so the contact it makes cannot overshoot
+        const double least = *std::min_element(tile_contact.begin(), tile_contact.end());
+        const double dt = std::min({options_.time_step, kStepFraction * contact * least / rate, end - result.time});
+        high.forEachTile([&](TiledGrid::Tile& u) {
+            const TiledGrid::Tile rho = density.tile(u.index);
+            TiledGrid::Tile d = low.tile(u.index);
+            for (int j = 0; j < u.cols; ++j) {
+                for (int i = 0; i < u.rows; ++i) {
+                    const std::size_t k = at(u, i, j);
+                    double& top = u(i, j);
+                    double& bottom = d(i, j);
+                    const double removal = rate * dt / load[k];
+                    const double top_removal = removal * padContact(level[k] - top, contact);
+                    const double bottom_removal = removal * padContact(std::max(level[k], top) - bottom, contact);
+                    if (!damascene) {
+                        top -= top_removal;
+                    } else if (top <= 0.0) {
+                        top -= top_removal / selectivity;
+                    } else if (top_removal <= top) {
+                        top -= top_removal;
+                    } else {
+                        // Through the metal into the dielectric part way
+                        top = -(top_removal - top) / selectivity;
+                    }
+                    bottom -= bottom_removal;
+                    if (rho(i, j) <= kSingleArea) {
+                        top = bottom;
+                    } else if (rho(i, j) >= 1.0 - kSingleArea) {
+                        bottom = top;
+                    }
+                }
+            }
+        });
+        result.time += dt;
+        ++result.steps;
+    }
+
+    result.up.resize(rows_, cols_);
+    result.down.resize(rows_, cols_);
+    high.store(result.up);
+    low.store(result.down);
+    if (damascene) {
+        result.erosion = (-result.up).max(0.0);
+        result.dishing = (result.up.min(0.0) - result.down).max(0.0);
+        result.dishing = (up_density >= 1.0 - kSingleArea).select(0.0, result.dishing);
+    }
+    return result;
+}
@@ -0,0 +1,87 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef CMP_MODEL_HPP
+#define CMP_MODEL_HPP
+
+#include "../../core/fft.hpp"
+#include <Eigen/Dense>
+#include <memory>
+#include <vector>
+
+// Heights in any one unit (nm for damascene), time in minutes
+struct CmpOptions {
+    double planarization_length = 25.0; // Sigma in cells of the pad's Gaussian response
+    double removal_rate = 200.0;        // Blanket rate of the metal, per minute
+    double selectivity = 20.0;          // Metal rate over the dielectric's
+    double contact_height = 50.0;       // Step below which the pad reaches the low areas
+    double time_step = 0.05;            // Longest step; shortened to keep removal per step in hand
+    double overpolish = 0.2;            // Fraction of the clearing time polished on after it
+    double max_time = 30.0;
+    int tile_size = 64;
+};
+
+// Full-chip step-height CMP model. Each cell of a density map holds a
+// raised area, the given fraction of it, and a low area, each at its own
+// height. The pad rests on the raised areas and reaches the low ones
+// as the step between them closes below the contact height; the load a
+// cell bears is spread by the pad's planarization kernel, so a raised area
+// is pressed by the blanket pressure over the effective contact density
+// around it. That density is a convolution by FFT, redone every step as
+// the steps close; the kernel's spectrum comes from the SpectrumCache and
+// so is shared by every step, wafer and model on the same grid. Heights
+// update tile by tile on a TiledGrid.
+class CmpModel {
+public:
+    struct Result {
+        Eigen::ArrayXXd up;      // Raised areas, from the top of the dielectric for polish()
+        Eigen::ArrayXXd down;    // Low areas
+        Eigen::ArrayXXd dishing; // Metal below the dielectric beside it; polish() only
+        Eigen::ArrayXXd erosion; // Dielectric lost below its top; polish() only
+        double clear_time = 0.0; // When the last raised metal cleared; polish() only
+        double time = 0.0;
+        int steps = 0;
+    };
+
+    // Throws std::invalid_argument for an empty grid or a planarization
+    // length, rate or contact height that is not positive
+    CmpModel(int rows, int cols, const CmpOptions& options = CmpOptions(),
+             std::shared_ptr<FftBackend> fft = nullptr);
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    const CmpOptions& options() const { return options_; }
+
+    // density averaged over the planarization kernel, cut off at the grid's
+    // edge like PatternDensity's windows
+    Eigen::ArrayXXd effectiveDensity(const Eigen::ArrayXXd& density) const;
+
+    // Damascene polish of metal plated overburden thick over the
+    // dielectric and step lower over the trenches, which fill
+    // metal_density of each cell: the dielectric between them is the
+    // raised area. The step is at most the overburden, as the trenches
+    // plate full. Runs until the metal over the dielectric is gone
+    // everywhere, and the overpolish after.
+    Result polish(const Eigen::ArrayXXd& metal_density, double overburden, double step) const;
+
+    // One material, from the given heights, until no step is left above
+    // tolerance or the time runs out
+    Result planarize(const Eigen::ArrayXXd& up_density, const Eigen::ArrayXXd& up, const Eigen::ArrayXXd& down,
+                     double tolerance) const;
+
+private:
+    Result run(const Eigen::ArrayXXd& up_density, const Eigen::ArrayXXd& up, const Eigen::ArrayXXd& down,
+               bool damascene, double tolerance) const;
+    // Convolves the padded image by the kernel in place
+    void convolve(std::vector<double>& image) const;
+    void checkShape(const Eigen::ArrayXXd& field) const;
+
+    int rows_;
+    int cols_;
+    int padded_rows_;
+    int padded_cols_;
+    CmpOptions options_;
+    std::shared_ptr<FftBackend> fft_;
+    std::shared_ptr<const std::vector<FftBackend::Complex>> kernel_;
+    Eigen::ArrayXXd coverage_; // Kernel weight falling inside the grid
+};
+
+#endif // CMP_MODEL_HPP
@@ -1,8 +1,42 @@
 #include "damascene_model.hpp"
+#include "../../core/pattern_density.hpp"
+#include "../../core/reproducibility.hpp"
 #include <algorithm>
 #include <cmath>
 
-DamasceneModel::DamasceneModel() : rng_(std::random_device{}()) {
+namespace {
+
+// Sigma in grid cells of the area the polishing pad spreads its load over
+constexpr double kPlanarizationLength = 25.0;
+
+// Dielectric between adjacent metal levels, μm
+constexpr double kLevelSpacing = 0.2;
+
+// Half width in grid cells of the box each cell's metal fraction is read
+// over for the CMP engine
+constexpr double kFeatureWindow = 2.0;
+
+// Metal plated over the field, and the step superfill leaves over the
+// trenches, as fractions of the trench depth
+constexpr double kOverburdenFraction = 0.5;
+constexpr double kPlatedStepFraction = 0.25;
+
+// Fraction of the area within window that holds metal: trenches are cut
+// where the resist is open, so metal fills what it left clear. Empty when
+// the wafer has no pattern.
+Eigen::ArrayXXd metalDensity(const Wafer& wafer, double half_width) {
+    const BitMask& resist = wafer.getPhotoresistMask();
+    if (resist.empty() || resist.count() == 0) {
+        return Eigen::ArrayXXd();
+    }
+    const PatternDensity::Maps maps =
+        PatternDensity::maps(resist, {{half_width, PatternDensity::Window::kBox}});
+    return 1.0 - maps->front();
+}
+
+} // namespace
+
+DamasceneModel::DamasceneModel() : rng_(Reproducibility::key("damascene")) {
     // Initialize default process parameters
     process_params_.etch_rate = 100.0;  // nm/min
     process_params_.selectivity = 50.0;
@@ -23,7 +57,7 @@ DamasceneModel::DamasceneModel() : rng_(std::random_device{}()) {
     material_thermal_expansion_["SiO2"] = 0.5;
     material_thermal_expansion_["Si"] = 2.6;
     
-    Logger::getInstance().log("DamasceneModel initialized with default parameters");
+    SEMIPRO_LOGF(INFO, PHYSICS, "DamasceneModel initialized with default parameters");
 }
 
 void DamasceneModel::createInterconnectStack(
@@ -37,8 +71,7 @@ void DamasceneModel::createInterconnectStack(
         // Simulate damascene process for this level
         simulateDamasceneProcess(wafer, level, SINGLE_DAMASCENE);
         
-        Logger::getInstance().log("Created metal level " + std::to_string(level.level) + 
-                                " with " + level.metal_type);
+        SEMIPRO_LOGF(INFO, PHYSICS, "Created metal level {} with {}", level.level, level.metal_type);
     }
 }
 
@@ -78,8 +111,7 @@ void DamasceneModel::simulateDamasceneProcess(
     // Step 6: CMP
     simulateCMP(wafer, level.metal_type, level.thickness);
     
-    Logger::getInstance().log("Completed damascene process for level " + 
-                            std::to_string(level.level));
+    SEMIPRO_LOGF(INFO, PHYSICS, "Completed damascene process for level {}", level.level);
 }
 
 void DamasceneModel::createVias(
@@ -97,9 +129,7 @@ void DamasceneModel::createVias(
     simulateElectroplating(wafer, "W", via_depth, 1.0);
     simulateCMP(wafer, "W", 0.0);  // Planarize
     
-    Logger::getInstance().log("Created " + std::to_string(via_positions.size()) + 
-                            " vias from level " + std::to_string(from_level) + 
-                            " to " + std::to_string(to_level));
+    SEMIPRO_LOGF(INFO, PHYSICS, "Created {} vias from level {} to {}", via_positions.size(), from_level, to_level);
 }
 
 void DamasceneModel::simulateCMP(
@@ -107,15 +137,24 @@ void DamasceneModel::simulateCMP(
     const std::string& target_material,
     double target_thickness) {
     
-    // Simulate chemical mechanical polishing
-    double removal_rate = process_params_.cmp_removal_rate;
-    double pattern_density = 0.5;  // Simplified
-    
-    // Pattern density affects removal rate
-    double effective_removal_rate = removal_rate * (0.8 + 0.4 * pattern_density);
-    
-    // Calculate dishing and erosion effects
-    double dishing = calculateCMPUniformity(target_material, pattern_density);
+    // Simulate chemical mechanical polishing: the metal fraction of each
+    // cell drives the full-chip step-height model, the plating over
+    // trenches as deep as the target
+    double dishing = 0.0;
+    const Eigen::ArrayXXd metal = metalDensity(*wafer, kFeatureWindow);
+    if (metal.size() > 0 && target_thickness > 0.0) {
+        const CmpModel& cmp = cmpModel(static_cast<int>(metal.rows()), static_cast<int>(metal.cols()));
+        const CmpModel::Result polished =
+            cmp.polish(metal, kOverburdenFraction * target_thickness, kPlatedStepFraction * target_thickness);
+        dishing_map_ = polished.dishing;
+        erosion_map_ = polished.erosion;
+        dishing = dishing_map_.maxCoeff();
+        SEMIPRO_LOGF(INFO, PHYSICS, "CMP cleared {} after {} min, polished {} min, peak erosion: {} nm",
+                     target_material, polished.clear_time, polished.time, erosion_map_.maxCoeff());
+    } else {
+        // Unpatterned wafers
+        dishing = calculateCMPUniformity(target_material, 0.5);
+    }
     
     // Update wafer surface (simplified)
     if (!wafer->getFilmLayers().empty()) {
@@ -130,8 +169,21 @@ void DamasceneModel::simulateCMP(
         }
     }
     
-    Logger::getInstance().log("CMP process completed for " + target_material + 
-                            ", dishing: " + std::to_string(dishing) + " nm");
+    SEMIPRO_LOGF(INFO, PHYSICS, "CMP process completed for {}, dishing: {} nm", target_material, dishing);
+}
+
+Eigen::ArrayXXd DamasceneModel::mapPlatingVoidRisk(
+    const std::vector<PlatingFeature>& features,
+    double die_width, double die_height,
+    int rows, int cols,
+    const SuperfillOptions& options) const {
+    
+    const SuperfillModel superfill(options);
+    const std::vector<SuperfillModel::Result> results = superfill.fillAll(features);
+    const auto voided = std::count_if(results.begin(), results.end(),
+                                      [](const SuperfillModel::Result& r) { return r.voided; });
+    SEMIPRO_LOGF(INFO, PHYSICS, "Superfill voided {} of {} features", voided, features.size());
+    return SuperfillModel::voidRiskMap(features, results, die_width, die_height, rows, cols);
 }
 
 std::unordered_map<std::string, double> DamasceneModel::calculateElectricalProperties(
@@ -152,7 +204,11 @@ std::unordered_map<std::string, double> DamasceneModel::calculateElectricalPrope
         total_resistance += resistance;
         
         // Calculate capacitance to adjacent levels
-        if (i > 0) {
+        if (capacitance_library_) {
+            const LineCapacitance c = capacitance_library_->lookup(
+                {level.line_width, level.line_spacing, level.thickness, kLevelSpacing});
+            total_capacitance += CapacitanceLibrary::toFaradsPerMicron(c.total, 3.9) * line_length * 1e12; // pF
+        } else if (i > 0) {
             double overlap_area = level.line_width * line_length;
             double capacitance = calculateCapacitance(structure.metal_levels[i-1], level, overlap_area);
             total_capacitance += capacitance;
@@ -186,7 +242,7 @@ double DamasceneModel::calculateCapacitance(
     
     double epsilon_0 = 8.854e-12;  // F/m
     double epsilon_r = 3.9;        // SiO2 relative permittivity
-    double distance = std::abs(level2.level - level1.level) * 200e-9;  // m
+    double distance = std::abs(level2.level - level1.level) * kLevelSpacing * 1e-6;  // m
     
     // Parallel plate capacitor model
     double capacitance = epsilon_0 * epsilon_r * (overlap_area * 1e-12) / distance;
@@ -242,15 +298,14 @@ void DamasceneModel::simulateTrenchEtching(
     double aspect_ratio = calculateAspectRatio(level.line_width, level.thickness);
     
     if (aspect_ratio > process_params_.aspect_ratio_limit) {
-        Logger::getInstance().log("WARNING: Aspect ratio " + std::to_string(aspect_ratio) + 
-                                " exceeds limit of " + std::to_string(process_params_.aspect_ratio_limit));
+        SEMIPRO_LOGF(WARNING, PHYSICS, "Aspect ratio {} exceeds limit of {}",
+                     aspect_ratio, process_params_.aspect_ratio_limit);
     }
     
     // Simulate etch profile and sidewall angle
     double etch_time = level.thickness / process_params_.etch_rate;
     
-    Logger::getInstance().log("Etched " + std::to_string(trench_positions.size()) + 
-                            " trenches, aspect ratio: " + std::to_string(aspect_ratio));
+    SEMIPRO_LOGF(INFO, PHYSICS, "Etched {} trenches, aspect ratio: {}", trench_positions.size(), aspect_ratio);
 }
 
 // Helper function implementations
@@ -267,6 +322,33 @@ double DamasceneModel::calculateCMPUniformity(const std::string& material, doubl
     return base_dishing;
 }
 
+const CmpModel& DamasceneModel::cmpModel(int rows, int cols) {
+    if (!cmp_model_ || cmp_model_->rows() != rows || cmp_model_->cols() != cols ||
+        cmp_model_->options().removal_rate != process_params_.cmp_removal_rate) {
+        CmpOptions options;
+        options.planarization_length = kPlanarizationLength;
+        options.removal_rate = process_params_.cmp_removal_rate;
+        cmp_model_ = std::make_unique<CmpModel>(rows, cols, options);
+    }
+    return *cmp_model_;
+}
+
+double DamasceneModel::calculatePatternDensity(
+    std::shared_ptr<Wafer> wafer,
+    double x, double y,
+    double window_size) {
+    
+    // x and y are the row and column in grid cells, window_size the side
+    // of the square averaged over
+    const Eigen::ArrayXXd density = metalDensity(*wafer, std::max(0.0, window_size) / 2.0);
+    if (density.size() == 0) {
+        return 0.5;
+    }
+    const int i = std::clamp(static_cast<int>(std::lround(x)), 0, static_cast<int>(density.rows()) - 1);
+    const int j = std::clamp(static_cast<int>(std::lround(y)), 0, static_cast<int>(density.cols()) - 1);
+    return density(i, j);
+}
+
 double DamasceneModel::calculateStressMagnitude(
     const std::string& material1,
     const std::string& material2,
@@ -2,6 +2,9 @@
 #define DAMASCENE_MODEL_HPP
 
 #include "interconnect_interface.hpp"
+#include "cmp_model.hpp"
+#include "line_capacitance.hpp"
+#include "superfill_model.hpp"
 #include "../../core/utils.hpp"
 #include <cmath>
 #include <random>
@@ -110,6 +113,27 @@ public:
     void setProcessParameters(const ProcessParameters& params);
     ProcessParameters getProcessParameters() const { return process_params_; }
     
+    // With a library set, calculateElectricalProperties takes each level's
+    // line capacitance from the field solver, the levels above and below
+    // as its ground, in place of the plate to the level below
+    void setCapacitanceLibrary(std::shared_ptr<const CapacitanceLibrary> library) {
+        capacitance_library_ = std::move(library);
+    }
+    
+    // Dishing and erosion (nm) over the wafer grid left by the last CMP of
+    // a patterned wafer; empty before one
+    const Eigen::ArrayXXd& getDishingMap() const { return dishing_map_; }
+    const Eigen::ArrayXXd& getErosionMap() const { return erosion_map_; }
+    
+    // Share of the features in each cell of a rows x cols map over the die
+    // (μm) that superfill leaves voided
+    Eigen::ArrayXXd mapPlatingVoidRisk(
+        const std::vector<PlatingFeature>& features,
+        double die_width, double die_height,
+        int rows, int cols,
+        const SuperfillOptions& options = SuperfillOptions()
+    ) const;
+    
     // Defect analysis
     enum DefectType {
         VOID,
@@ -159,6 +183,11 @@ public:
     
 private:
     ProcessParameters process_params_;
+    std::shared_ptr<const CapacitanceLibrary> capacitance_library_;
+    // Kept while the grid and removal rate stay the same
+    std::unique_ptr<CmpModel> cmp_model_;
+    Eigen::ArrayXXd dishing_map_;
+    Eigen::ArrayXXd erosion_map_;
     std::unordered_map<std::string, double> material_resistivities_;
     std::unordered_map<std::string, double> material_thermal_expansion_;
     mutable std::mt19937 rng_;
@@ -167,6 +196,7 @@ private:
     double calculateAspectRatio(double width, double depth);
     double calculatePlatingUniformity(double current_density, double aspect_ratio);
     double calculateCMPUniformity(const std::string& material, double pattern_density);
+    const CmpModel& cmpModel(int rows, int cols);
     
     // Physical models
     double calculateVoidProbability(double aspect_ratio, double plating_rate);
@@ -0,0 +1,242 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "line_capacitance.hpp"
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Grids past this many nodes are coarsened to fit
+constexpr double kMaxNodes = 250000.0;
+constexpr int kLines = 5;
+constexpr int kVictim = 2;
+
+// Coordinates of a tensor axis through the breakpoints, each interval cut
+// into cells no wider than step; where[k] is the node on breakpoint k
+std::vector<double> axis(const std::vector<double>& breakpoints, double step, std::vector<int>& where) {
+    std::vector<double> nodes{breakpoints.front()};
+    where.assign(1, 0);
+    for (std::size_t k = 1; k < breakpoints.size(); ++k) {
+        const double length = breakpoints[k] - breakpoints[k - 1];
+        const int cells = std::max(1, static_cast<int>(std::ceil(length / step - 1e-9)));
+        for (int c = 1; c <= cells; ++c) {
+            nodes.push_back(breakpoints[k - 1] + length * c / cells);
+        }
+        where.push_back(static_cast<int>(nodes.size()) - 1);
+    }
+    return nodes;
+}
+
+// Length of node i's dual cell along an axis
+double dual(const std::vector<double>& nodes, int i) {
+    const double below = i > 0 ? nodes[i] - nodes[i - 1] : 0.0;
+    const double above = i + 1 < static_cast<int>(nodes.size()) ? nodes[i + 1] - nodes[i] : 0.0;
+    return 0.5 * (below + above);
+}
+
+} // namespace
+
+LineCapacitance solveLineCapacitance(const LineCrossSection& section, int resolution) {
+    const double w = section.width, s = section.spacing, t = section.thickness, h = section.height;
+    if (!(w > 0.0 && s > 0.0 && t > 0.0 && h > 0.0)) {
+        throw std::invalid_argument("Line cross-section dimensions must be positive");
+    }
+    const double pitch = w + s;
+
+    // Line edges across, the planes and line faces up
+    std::vector<double> xs{-2.5 * pitch};
+    for (int k = 0; k < kLines; ++k) {
+        const double center = (k - kVictim) * pitch;
+        xs.push_back(center - 0.5 * w);
+        xs.push_back(center + 0.5 * w);
+    }
+    xs.push_back(2.5 * pitch);
+    const std::vector<double> ys{0.0, h, h + t, 2.0 * h + t};
+
+    double step = std::min({w, s, t, h}) / std::max(1, resolution);
+    std::vector<int> x_at, y_at;
+    std::vector<double> x, y;
+    for (;;) {
+        x = axis(xs, step, x_at);
+        y = axis(ys, step, y_at);
+        const double nodes = static_cast<double>(x.size()) * y.size();
+        if (nodes <= kMaxNodes) {
+            break;
+        }
+        step *= std::sqrt(nodes / kMaxNodes) * 1.01;
+    }
+    const int nx = static_cast<int>(x.size()), ny = static_cast<int>(y.size());
+
+    // Conductor of each node: -1 free, 0 the planes, 1 + k line k
+    std::vector<int> conductor(static_cast<std::size_t>(nx) * ny, -1);
+    for (int i = 0; i < nx; ++i) {
+        conductor[i] = 0;
+        conductor[static_cast<std::size_t>(ny - 1) * nx + i] = 0;
+    }
+    for (int k = 0; k < kLines; ++k) {
+        for (int j = y_at[1]; j <= y_at[2]; ++j) {
+            for (int i = x_at[1 + 2 * k]; i <= x_at[2 + 2 * k]; ++i) {
+                conductor[static_cast<std::size_t>(j) * nx + i] = 1 + k;
+            }
+        }
+    }
+    const auto potential = [](int c) { return c == 1 + kVictim ? 1.0 : 0.0; };
+
+    std::vector<int> unknown(conductor.size(), -1);
+    int count = 0;
+    for (std::size_t n = 0; n < conductor.size(); ++n) {
+        if (conductor[n] < 0) {
+            unknown[n] = count++;
+        }
+    }
+
+    // Finite-volume edges: conductance of the dual face over the spacing
+    struct Edge {
+        int a, b;
+        double weight;
+    };
+    std::vector<Edge> edges;
+    edges.reserve(2 * conductor.size());
+    for (int j = 0; j < ny; ++j) {
+        for (int i = 0; i < nx; ++i) {
+            const int n = j * nx + i;
+            if (i + 1 < nx) {
+                edges.push_back({n, n + 1, dual(y, j) / (x[i + 1] - x[i])});
+            }
+            if (j + 1 < ny) {
+                edges.push_back({n, n + nx, dual(x, i) / (y[j + 1] - y[j])});
+            }
+        }
+    }
+
+    std::vector<Eigen::Triplet<double>> entries;
+    entries.reserve(5 * static_cast<std::size_t>(count));
+    Eigen::VectorXd rhs = Eigen::VectorXd::Zero(count);
+    for (const Edge& e : edges) {
+        const int ua = unknown[e.a], ub = unknown[e.b];
+        if (ua >= 0) {
+            entries.emplace_back(ua, ua, e.weight);
+        }
+        if (ub >= 0) {
+            entries.emplace_back(ub, ub, e.weight);
+        }
+        if (ua >= 0 && ub >= 0) {
+            entries.emplace_back(ua, ub, -e.weight);
+            entries.emplace_back(ub, ua, -e.weight);
+        } else if (ua >= 0) {
+            rhs(ua) += e.weight * potential(conductor[e.b]);
+        } else if (ub >= 0) {
+            rhs(ub) += e.weight * potential(conductor[e.a]);
+        }
+    }
+    Eigen::SparseMatrix<double> laplacian(count, count);
+    laplacian.setFromTriplets(entries.begin(), entries.end());
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver(laplacian);
+    if (solver.info() != Eigen::Success) {
+        throw std::runtime_error("Line capacitance field solve failed");
+    }
+    const Eigen::VectorXd phi = solver.solve(rhs);
+    const auto value = [&](int n) { return unknown[n] >= 0 ? phi(unknown[n]) : potential(conductor[n]); };
+
+    // Charge on each conductor: the flux out through its boundary edges
+    double charge[1 + kLines] = {};
+    for (const Edge& e : edges) {
+        const int ca = conductor[e.a], cb = conductor[e.b];
+        if (ca == cb) {
+            continue;
+        }
+        const double flux = e.weight * (value(e.a) - value(e.b));
+        if (ca >= 0) {
+            charge[ca] += flux;
+        }
+        if (cb >= 0) {
+            charge[cb] -= flux;
+        }
+    }
+
+    LineCapacitance result;
+    result.total = charge[1 + kVictim];
+    result.coupling = -0.5 * (charge[kVictim] + charge[2 + kVictim]);
+    result.ground = result.total - 2.0 * result.coupling;
+    return result;
+}
+
+CapacitanceLibrary::CapacitanceLibrary(int points_per_decade, int resolution, double min_ratio, double max_ratio)
+    : points_per_decade_(std::max(1, points_per_decade)), resolution_(resolution) {
+    if (!(min_ratio > 0.0 && max_ratio > min_ratio)) {
+        throw std::invalid_argument("Capacitance library needs 0 < min_ratio < max_ratio");
+    }
+    min_index_ = static_cast<int>(std::floor(std::log10(min_ratio) * points_per_decade_));
+    max_index_ = static_cast<int>(std::ceil(std::log10(max_ratio) * points_per_decade_));
+}
+
+double CapacitanceLibrary::toFaradsPerMicron(double normalized, double relative_permittivity) {
+    const double epsilon_0 = 8.854e-12; // F/m
+    return normalized * epsilon_0 * relative_permittivity * 1e-6;
+}
+
+std::size_t CapacitanceLibrary::entries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+LineCapacitance CapacitanceLibrary::entry(int spacing, int thickness, int height) const {
+    const std::int64_t span = max_index_ - min_index_ + 1;
+    const std::int64_t key = ((spacing - min_index_) * span + (thickness - min_index_)) * span + (height - min_index_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            return it->second;
+        }
+    }
+    // Solved outside the lock; a racing thread may solve it too, to the
+    // same result
+    const auto ratio = [this](int index) { return std::pow(10.0, static_cast<double>(index) / points_per_decade_); };
+    const LineCapacitance solved =
+        solveLineCapacitance({1.0, ratio(spacing), ratio(thickness), ratio(height)}, resolution_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.emplace(key, solved).first->second;
+}
+
+LineCapacitance CapacitanceLibrary::lookup(const LineCrossSection& section) const {
+    if (!(section.width > 0.0 && section.spacing > 0.0 && section.thickness > 0.0 && section.height > 0.0)) {
+        throw std::invalid_argument("Line cross-section dimensions must be positive");
+    }
+    const double coordinates[3] = {std::log10(section.spacing / section.width) * points_per_decade_,
+                                   std::log10(section.thickness / section.width) * points_per_decade_,
+                                   std::log10(section.height / section.width) * points_per_decade_};
+    int base[3];
+    double fraction[3];
+    for (int d = 0; d < 3; ++d) {
+        if (coordinates[d] < min_index_ || coordinates[d] > max_index_) {
+            return solveLineCapacitance(section, resolution_);
+        }
+        base[d] = std::min(static_cast<int>(std::floor(coordinates[d])), max_index_ - 1);
+        fraction[d] = coordinates[d] - base[d];
+    }
+
+    double log_coupling = 0.0, log_ground = 0.0;
+    for (int corner = 0; corner < 8; ++corner) {
+        double weight = 1.0;
+        int index[3];
+        for (int d = 0; d < 3; ++d) {
+            const int bit = (corner >> d) & 1;
+            index[d] = base[d] + bit;
+            weight *= bit ? fraction[d] : 1.0 - fraction[d];
+        }
+        if (weight == 0.0) {
+            continue;
+        }
+        const LineCapacitance c = entry(index[0], index[1], index[2]);
+        log_coupling += weight * std::log(c.coupling);
+        log_ground += weight * std::log(c.ground);
+    }
+    LineCapacitance result;
+    result.coupling = std::exp(log_coupling);
+    result.ground = std::exp(log_ground);
+    result.total = result.ground + 2.0 * result.coupling;
+    return result;
+}
@@ -0,0 +1,69 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef LINE_CAPACITANCE_HPP
+#define LINE_CAPACITANCE_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// Capacitance per unit length of a line in an array of parallel lines,
+// in units of the dielectric's permittivity (multiply by eps0 epsr for
+// F/m). As a 2D capacitance it depends on the cross-section's shape alone,
+// not its size.
+struct LineCapacitance {
+    double total;    // To everything else
+    double coupling; // To each nearest neighbour
+    double ground;   // To the planes above and below and the lines beyond
+};
+
+// Cross-section of the array: lines width wide and thickness tall,
+// spacing apart, height of dielectric from the levels above and below,
+// which are taken as ground planes; any one length unit
+struct LineCrossSection {
+    double width;
+    double spacing;
+    double thickness;
+    double height;
+};
+
+// Field solution of the cross-section: five lines, the middle one at 1 V
+// and the rest grounded, between the planes, with the fields mirrored
+// half a spacing beyond the outer lines. Laplace's equation is discretized
+// by finite volumes on a tensor grid aligned to the line edges, with
+// `resolution` cells across the smallest dimension, and solved directly;
+// the charges are the discrete fluxes out of each line. Throws
+// std::invalid_argument for a dimension that is not positive.
+LineCapacitance solveLineCapacitance(const LineCrossSection& section, int resolution = 8);
+
+// Pattern library of solutions over the cross-section's shape: the
+// ratios of spacing, thickness and height to the width, on a grid
+// regular in their logarithms. Entries are solved the first time a lookup
+// needs them and kept, so repeated wire configurations cost an
+// interpolation; between entries each component is interpolated
+// multilinearly in log-log. Shapes beyond the grid are solved directly.
+// Lookups are safe from any number of threads.
+class CapacitanceLibrary {
+public:
+    // Ratios from min_ratio to max_ratio, points_per_decade per decade
+    explicit CapacitanceLibrary(int points_per_decade = 8, int resolution = 8,
+                                double min_ratio = 0.1, double max_ratio = 10.0);
+
+    LineCapacitance lookup(const LineCrossSection& section) const;
+    // F/μm of a component in a dielectric of the relative permittivity
+    static double toFaradsPerMicron(double normalized, double relative_permittivity);
+
+    // Entries solved so far
+    std::size_t entries() const;
+
+private:
+    LineCapacitance entry(int spacing, int thickness, int height) const;
+
+    int points_per_decade_;
+    int resolution_;
+    int min_index_;
+    int max_index_;
+    mutable std::mutex mutex_;
+    mutable std::unordered_map<std::int64_t, LineCapacitance> entries_;
+};
+
+#endif // LINE_CAPACITANCE_HPP
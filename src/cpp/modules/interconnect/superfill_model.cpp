@@ -0,0 +1,315 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "superfill_model.hpp"
+#include "../../core/level_set.hpp"
+#include "../../core/task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+
+// Empty cells a pocket needs to count as a void rather than a seam the
+// grid failed to close
+constexpr int kMinVoidCells = 2;
+// Largest move of the surface per coverage update, in cells
+constexpr double kMoveFraction = 0.5;
+
+// Accelerator coverage on the surface, carried from one update to the
+// next: each update writes the surface voxels and their empty neighbours,
+// and reads last update's values at or beside a voxel
+class Coverage {
+public:
+    Coverage(int rows, int cols, int layers, double initial)
+        : rows_(rows), cols_(cols), layers_(layers), initial_(initial) {
+        for (int b = 0; b < 2; ++b) {
+            theta_[b].assign(static_cast<std::size_t>(rows) * cols * layers, initial);
+            stamp_[b].assign(theta_[b].size(), 0);
+        }
+    }
+
+    // Starts update `epoch`, writing the buffer the previous one read
+    void begin(int epoch) {
+        epoch_ = epoch;
+        write_ = epoch & 1;
+    }
+    void set(int i, int j, int k, double theta) {
+        const std::size_t n = index(i, j, k);
+        theta_[write_][n] = theta;
+        stamp_[write_][n] = epoch_;
+    }
+    // This update's value about a voxel
+    double current(int i, int j, int k) const { return around(write_, epoch_, i, j, k); }
+    // The previous update's
+    double previous(int i, int j, int k) const { return around(write_ ^ 1, epoch_ - 1, i, j, k); }
+
+private:
+    std::size_t index(int i, int j, int k) const {
+        return (static_cast<std::size_t>(i) * cols_ + j) * layers_ + k;
+    }
+    double around(int buffer, int epoch, int i, int j, int k) const {
+        if (epoch <= 0) {
+            return initial_;
+        }
+        const std::size_t n = index(i, j, k);
+        if (stamp_[buffer][n] == epoch) {
+            return theta_[buffer][n];
+        }
+        double sum = 0.0;
+        int count = 0;
+        for (int di = -1; di <= 1; ++di) {
+            for (int dj = -1; dj <= 1; ++dj) {
+                for (int dk = -1; dk <= 1; ++dk) {
+                    const int ni = i + di, nj = j + dj, nk = k + dk;
+                    if (ni < 0 || ni >= rows_ || nj < 0 || nj >= cols_ || nk < 0 || nk >= layers_) {
+                        continue;
+                    }
+                    const std::size_t m = index(ni, nj, nk);
+                    if (stamp_[buffer][m] == epoch) {
+                        sum += theta_[buffer][m];
+                        ++count;
+                    }
+                }
+            }
+        }
+        return count > 0 ? sum / count : initial_;
+    }
+
+    int rows_, cols_, layers_;
+    double initial_;
+    int epoch_ = 0;
+    int write_ = 0;
+    std::vector<double> theta_[2];
+    std::vector<int> stamp_[2];
+};
+
+// Mean curvature div(grad phi / |grad phi|) at a voxel, positive where the
+// solid is convex; the grid edges mirror
+double curvature(const LevelSet& surface, int i, int j, int k) {
+    const auto phi = [&surface](int a, int b, int c) {
+        return surface.value(std::clamp(a, 0, surface.rows() - 1), std::clamp(b, 0, surface.cols() - 1),
+                             std::clamp(c, 0, surface.layers() - 1));
+    };
+    const double h = surface.spacing();
+    const double center = phi(i, j, k);
+    const double x = (phi(i + 1, j, k) - phi(i - 1, j, k)) / (2.0 * h);
+    const double y = (phi(i, j + 1, k) - phi(i, j - 1, k)) / (2.0 * h);
+    const double z = (phi(i, j, k + 1) - phi(i, j, k - 1)) / (2.0 * h);
+    const double xx = (phi(i + 1, j, k) - 2.0 * center + phi(i - 1, j, k)) / (h * h);
+    const double yy = (phi(i, j + 1, k) - 2.0 * center + phi(i, j - 1, k)) / (h * h);
+    const double zz = (phi(i, j, k + 1) - 2.0 * center + phi(i, j, k - 1)) / (h * h);
+    const double xy = (phi(i + 1, j + 1, k) - phi(i + 1, j - 1, k) - phi(i - 1, j + 1, k) + phi(i - 1, j - 1, k)) /
+                      (4.0 * h * h);
+    const double xz = (phi(i + 1, j, k + 1) - phi(i + 1, j, k - 1) - phi(i - 1, j, k + 1) + phi(i - 1, j, k - 1)) /
+                      (4.0 * h * h);
+    const double yz = (phi(i, j + 1, k + 1) - phi(i, j + 1, k - 1) - phi(i, j - 1, k + 1) + phi(i, j - 1, k - 1)) /
+                      (4.0 * h * h);
+    const double norm2 = x * x + y * y + z * z;
+    if (norm2 <= 0.0) {
+        return 0.0;
+    }
+    const double kappa = (xx * (y * y + z * z) + yy * (x * x + z * z) + zz * (x * x + y * y) -
+                          2.0 * (x * y * xy + x * z * xz + y * z * yz)) /
+                         (norm2 * std::sqrt(norm2));
+    // No sharper than the grid can show
+    return std::clamp(kappa, -1.0 / h, 1.0 / h);
+}
+
+} // namespace
+
+SuperfillModel::SuperfillModel(const SuperfillOptions& options) : options_(options) {}
+
+SuperfillModel::Result SuperfillModel::fill(const PlatingFeature& feature) const {
+    if (!(feature.width > 0.0 && feature.depth > 0.0)) {
+        throw std::invalid_argument("Plated feature width and depth must be positive");
+    }
+    const bool via = feature.shape == PlatingFeature::Shape::kVia;
+    const double depth = feature.depth;
+    const double opening = 0.5 * feature.width;
+
+    // Half the opening across, with as much field beside it; a via's
+    // quarter is the same both ways
+    const int half = std::max(2, options_.cells_across / 2);
+    const double h = opening / half;
+    const int span = 2 * half;
+    const int rows = via ? span : 1;
+    const int cols = span;
+    const double floor = std::max(h, opening - depth * std::tan(feature.taper * M_PI / 180.0));
+    Eigen::ArrayXXd heights(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            const double r = via ? std::hypot((i + 0.5) * h, (j + 0.5) * h) : (j + 0.5) * h;
+            heights(i, j) = r <= floor ? -depth : r >= opening ? 0.0 : -depth * (opening - r) / (opening - floor);
+        }
+    }
+    // Room above the field for it to plate up as far as the feature is deep
+    const double z_min = -depth - 3.0 * h;
+    const double z_max = depth + 4.0 * h;
+    LevelSet surface(heights, h, z_min, z_max);
+    const int layers = surface.layers();
+    const int below = std::min(layers, static_cast<int>(std::ceil(-z_min / h - 1e-9))); // Layers with z < 0
+
+    const auto index = [cols, layers](int i, int j, int k) {
+        return (static_cast<std::size_t>(i) * cols + j) * layers + k;
+    };
+    // Empty voxels under the field reachable from the top, and those cut off
+    std::vector<char> reached(static_cast<std::size_t>(rows) * cols * layers);
+    std::vector<int> queue;
+    const auto openings = [&](int& open, int& pocket) {
+        std::fill(reached.begin(), reached.end(), 0);
+        queue.clear();
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+                if (surface.value(i, j, layers - 1) >= 0.0) {
+                    reached[index(i, j, layers - 1)] = 1;
+                    queue.push_back(static_cast<int>(index(i, j, layers - 1)));
+                }
+            }
+        }
+        while (!queue.empty()) {
+            const int n = queue.back();
+            queue.pop_back();
+            const int k = n % layers, j = (n / layers) % cols, i = n / layers / cols;
+            const int next[6][3] = {{i - 1, j, k}, {i + 1, j, k}, {i, j - 1, k},
+                                    {i, j + 1, k}, {i, j, k - 1}, {i, j, k + 1}};
+            for (const auto& v : next) {
+                if (v[0] < 0 || v[0] >= rows || v[1] < 0 || v[1] >= cols || v[2] < 0 || v[2] >= layers) {
+                    continue;
+                }
+                const std::size_t m = index(v[0], v[1], v[2]);
+                if (!reached[m] && surface.value(v[0], v[1], v[2]) >= 0.0) {
+                    reached[m] = 1;
+                    queue.push_back(static_cast<int>(m));
+                }
+            }
+        }
+        open = pocket = 0;
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+                for (int k = 0; k < below; ++k) {
+                    if (surface.value(i, j, k) >= 0.0) {
+                        ++(reached[index(i, j, k)] ? open : pocket);
+                    }
+                }
+            }
+        }
+    };
+    int initial = 0, open = 0, pocket = 0;
+    openings(initial, pocket);
+
+    const double v0 = options_.suppressed_rate;
+    const double gain = options_.acceleration - 1.0;
+    const double top = z_max - 3.0 * h; // The field plating this high ends the run
+    const double limit = options_.max_time_factor * depth / v0;
+    Coverage coverage(rows, cols, layers, std::clamp(options_.initial_coverage, 0.0, 1.0));
+    const double depletion = std::max(0.0, options_.depletion) / feature.width;
+    const auto supply = [depletion](double z) { return std::exp(-depletion * std::max(0.0, -z)); };
+    const auto voxel = [&](const Eigen::Vector3d& point, int& i, int& j, int& k) {
+        i = std::clamp(static_cast<int>(std::lround(point.x())), 0, rows - 1);
+        j = std::clamp(static_cast<int>(std::lround(point.y())), 0, cols - 1);
+        k = std::clamp(static_cast<int>(std::lround((point.z() - z_min) / h)), 0, layers - 1);
+    };
+    const LevelSet::Velocity velocity = [&](const LevelSet::Site& site) {
+        int i, j, k;
+        voxel(site.surface, i, j, k);
+        return LevelSet::Speed{v0 * (1.0 + gain * coverage.current(i, j, k)) * supply(site.surface.z()), 0.0};
+    };
+
+    Result result;
+    double dt = 0.0; // Of the last move
+    for (int epoch = 1; result.time < limit; ++epoch) {
+        // Carry the coverage to where the surface now is and let it
+        // concentrate or thin with the surface's curvature over the move
+        coverage.begin(epoch);
+        double highest = -depth, fastest = 0.0;
+        for (const LevelSet::Site& site : surface.surface()) {
+            const double theta = coverage.previous(site.i, site.j, site.k);
+            const double speed = v0 * (1.0 + gain * theta) * supply(site.surface.z());
+            const double kappa = curvature(surface, site.i, site.j, site.k);
+            const double grown = std::clamp(
+                theta + dt * (-theta * speed * kappa + options_.adsorption_rate * (1.0 - theta)), 0.0, 1.0);
+            coverage.set(site.i, site.j, site.k, grown);
+            int i, j, k;
+            voxel(site.surface, i, j, k);
+            coverage.set(i, j, k, grown);
+            highest = std::max(highest, site.surface.z());
+            fastest = std::max(fastest, v0 * (1.0 + gain * grown));
+        }
+        if (highest >= top) {
+            break;
+        }
+
+        dt = std::min(kMoveFraction * h / std::max(fastest, v0), limit - result.time);
+        surface.advance(dt, velocity);
+        result.time += dt;
+
+        openings(open, pocket);
+        if (pocket >= kMinVoidCells) {
+            result.voided = true;
+            break;
+        }
+        if (open == 0) {
+            break;
+        }
+    }
+
+    if (initial > 0) {
+        result.void_fraction = result.voided ? static_cast<double>(pocket) / initial : 0.0;
+        result.fill_fraction = 1.0 - static_cast<double>(open + pocket) / initial;
+    }
+    return result;
+}
+
+std::vector<SuperfillModel::Result> SuperfillModel::fillAll(const std::vector<PlatingFeature>& features) const {
+    // Dies repeat a few feature shapes many times over
+    std::map<std::tuple<int, double, double, double>, int> shapes;
+    std::vector<int> shape_of(features.size());
+    std::vector<const PlatingFeature*> unique;
+    for (std::size_t f = 0; f < features.size(); ++f) {
+        const PlatingFeature& feature = features[f];
+        const auto key = std::make_tuple(static_cast<int>(feature.shape), feature.width, feature.depth, feature.taper);
+        const auto inserted = shapes.emplace(key, static_cast<int>(unique.size()));
+        if (inserted.second) {
+            unique.push_back(&feature);
+        }
+        shape_of[f] = inserted.first->second;
+    }
+
+    std::vector<Result> solved(unique.size());
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(unique.size()), [&](int begin, int end) {
+        for (int s = begin; s < end; ++s) {
+            solved[s] = fill(*unique[s]);
+        }
+    }, 1);
+
+    std::vector<Result> results(features.size());
+    for (std::size_t f = 0; f < features.size(); ++f) {
+        results[f] = solved[shape_of[f]];
+    }
+    return results;
+}
+
+Eigen::ArrayXXd SuperfillModel::voidRiskMap(const std::vector<PlatingFeature>& features,
+                                            const std::vector<Result>& results, double die_width,
+                                            double die_height, int rows, int cols) {
+    if (features.size() != results.size()) {
+        throw std::invalid_argument("Void risk map needs one fill result per feature");
+    }
+    if (rows < 1 || cols < 1 || !(die_width > 0.0 && die_height > 0.0)) {
+        throw std::invalid_argument("Void risk map needs a non-empty map over a die of positive size");
+    }
+    Eigen::ArrayXXd voided = Eigen::ArrayXXd::Zero(rows, cols);
+    Eigen::ArrayXXd count = Eigen::ArrayXXd::Zero(rows, cols);
+    for (std::size_t f = 0; f < features.size(); ++f) {
+        const double x = features[f].x / die_width, y = features[f].y / die_height;
+        if (!(x >= 0.0 && x <= 1.0 && y >= 0.0 && y <= 1.0)) {
+            continue;
+        }
+        const int i = std::min(rows - 1, static_cast<int>(y * rows));
+        const int j = std::min(cols - 1, static_cast<int>(x * cols));
+        count(i, j) += 1.0;
+        voided(i, j) += results[f].voided ? 1.0 : 0.0;
+    }
+    return (count > 0.0).select(voided / count.max(1.0), 0.0);
+}
@@ -0,0 +1,74 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef SUPERFILL_MODEL_HPP
+#define SUPERFILL_MODEL_HPP
+
+#include <Eigen/Dense>
+#include <vector>
+
+// A trench or via to plate, in μm
+struct PlatingFeature {
+    enum class Shape { kTrench, kVia };
+    Shape shape = Shape::kTrench;
+    double width = 0.1;      // Opening; a via's diameter
+    double depth = 0.2;
+    double taper = 0.0;      // Sidewall angle off vertical in degrees, narrowing downward
+    double x = 0.0, y = 0.0; // Position on the die
+};
+
+struct SuperfillOptions {
+    double suppressed_rate = 0.1;   // μm/min on a surface bare of accelerator
+    double acceleration = 10.0;     // Rate at full coverage over the suppressed rate
+    double initial_coverage = 0.05; // Accelerator on the seed at the start
+    double adsorption_rate = 0.1;   // Per minute, toward full coverage from the bath
+    // Cupric ions deplete on the way down a feature: the rate falls by
+    // exp(-depletion) for each width below the field
+    double depletion = 0.1;
+    int cells_across = 16;          // Level-set cells across the opening
+    // Longest plating, in units of the time to plate the depth at the
+    // suppressed rate
+    double max_time_factor = 3.0;
+};
+
+// Feature-scale superfill by the curvature-enhanced accelerator coverage
+// (CEAC) model. Copper grows along the surface normal at the suppressed
+// rate raised by the accelerator coverage theta, which the surface
+// carries with it: where the surface shrinks as it grows, in the concave
+// bottom corners, theta concentrates (d theta / dt = -theta v kappa plus
+// adsorption from the bath), so the bottom speeds up and the feature fills
+// from the bottom before the sidewalls meet. Without enough of it, the
+// cupric ions depleting down the feature let the mouth close first. The
+// profile evolves on the LevelSet engine over a half trench or quarter
+// via, the symmetry planes being the grid's mirrored edges; an empty
+// region cut off from the electrolyte above is a void, and plating stops
+// there.
+class SuperfillModel {
+public:
+    struct Result {
+        bool voided = false;
+        double void_fraction = 0.0; // Of the feature's volume enclosed as a void
+        double fill_fraction = 0.0; // Of the feature's volume plated at the end
+        double time = 0.0;          // Minutes until filled, pinched off or stopped
+    };
+
+    explicit SuperfillModel(const SuperfillOptions& options = SuperfillOptions());
+
+    const SuperfillOptions& options() const { return options_; }
+
+    // Throws std::invalid_argument for a width or depth that is not positive
+    Result fill(const PlatingFeature& feature) const;
+    // fill() of every feature as independent tasks on the TaskScheduler;
+    // features alike in shape, width, depth and taper are filled once
+    std::vector<Result> fillAll(const std::vector<PlatingFeature>& features) const;
+
+    // Share of the features in each cell of a rows x cols map over the die
+    // that voided, 0 where there are none; features off the die are left
+    // out
+    static Eigen::ArrayXXd voidRiskMap(const std::vector<PlatingFeature>& features,
+                                       const std::vector<Result>& results, double die_width, double die_height,
+                                       int rows, int cols);
+
+private:
+    SuperfillOptions options_;
+};
+
+#endif // SUPERFILL_MODEL_HPP
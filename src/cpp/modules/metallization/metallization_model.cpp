@@ -12,8 +12,8 @@ void MetallizationModel::simulateMetallization(std::shared_ptr<Wafer> wafer, dou
     throw std::invalid_argument("Metal type cannot be empty");
   }
 
-  Logger::getInstance().log("Simulating metallization: thickness=" + std::to_string(thickness) + " um, metal=" + metal +
-                  ", method=" + method);
+  SEMIPRO_LOGF(INFO, PHYSICS, "Simulating metallization: thickness={} um, metal={}, method={}",
+               thickness, metal, method);
 
   if (method == "pvd") {
     applyPVD(wafer, thickness, metal);
@@ -27,33 +27,29 @@ void MetallizationModel::simulateMetallization(std::shared_ptr<Wafer> wafer, dou
 }
 
 void MetallizationModel::applyPVD(std::shared_ptr<Wafer> wafer, double thickness, const std::string& metal) {
-  Eigen::ArrayXXd grid = wafer->getGrid();
-  const Eigen::ArrayXXd& photoresist = wafer->getPhotoresistPattern();
+  FieldView grid = wafer->getGrid();
+  const auto& photoresist = wafer->getPhotoresistPattern();
 
   // PVD deposits uniformly in exposed areas (where photoresist is absent or patterned)
   for (int i = 0; i < grid.rows(); ++i) {
     for (int j = 0; j < grid.cols(); ++j) {
-      if (i < photoresist.rows() && j < photoresist.cols() && photoresist(i, j) < 0.5) {
+      if (photoresist(i, j) < 0.5) {
         grid(i, j) += thickness; // Deposit metal in exposed regions
       }
     }
   }
-
-  wafer->updateGrid(grid);
 }
 
 void MetallizationModel::applyElectroplating(std::shared_ptr<Wafer> wafer, double thickness, const std::string& metal) {
-  Eigen::ArrayXXd grid = wafer->getGrid();
-  const Eigen::ArrayXXd& photoresist = wafer->getPhotoresistPattern();
+  FieldView grid = wafer->getGrid();
+  const auto& photoresist = wafer->getPhotoresistPattern();
 
   // Electroplating deposits selectively in patterned trenches (simplified model)
   for (int i = 0; i < grid.rows(); ++i) {
     for (int j = 0; j < grid.cols(); ++j) {
-      if (i < photoresist.rows() && j < photoresist.cols() && photoresist(i, j) < 0.5) {
+      if (photoresist(i, j) < 0.5) {
         grid(i, j) += thickness * 1.2; // Slightly thicker due to selective growth
       }
     }
   }
-
-  wafer->updateGrid(grid);
 }
\ No newline at end of file
@@ -1,21 +1,40 @@
 #include "metrology_model.hpp"
+#include "../../core/reproducibility.hpp"
+#include "../../core/task_scheduler.hpp"
 #include <algorithm>
 #include <numeric>
 #include <cmath>
+#include <limits>
+#include <stdexcept>
 
-MetrologyModel::MetrologyModel() : rng_(std::random_device{}()) {
+namespace {
+
+// By MeasurementType
+const char* const kMeasurementNames[] = {
+    "thickness", "critical_dimension", "overlay", "roughness", "stress", "resistivity", "reflectance", "ellipsometry",
+};
+
+} // namespace
+
+MetrologyModel::MetrologyModel() : spc_(ELLIPSOMETRY + 1), rng_(Reproducibility::key("metrology")) {
     // Set default measurement parameters
     measurement_parameters_["noise_level"] = 0.01;  // 1% noise
     measurement_parameters_["wavelength"] = 632.8;  // nm
     measurement_parameters_["numerical_aperture"] = 0.9;
     measurement_parameters_["spot_size"] = 1.0;     // μm
+    measurement_parameters_["cd_threshold"] = 0.5;  // Resist level the printed edge sits at
+    measurement_parameters_["resist_thickness"] = 100.0;   // nm, of scatterometry gratings
+    measurement_parameters_["ellipsometry_angle"] = 70.0;  // Degrees from the normal
+    measurement_parameters_["angle_noise"] = 0.01;         // Degrees, on psi and delta
+    measurement_parameters_["overlay_window"] = 32.0;      // Pixels a side registered about an overlay site
+    measurement_parameters_["overlay_noise"] = 0.5;        // nm, per axis of image-based overlay
     
     // Set default calibration factors
     calibration_factors_["thickness"] = 1.0;
     calibration_factors_["cd"] = 1.0;
     calibration_factors_["overlay"] = 1.0;
     
-    Logger::getInstance().log("MetrologyModel initialized with default parameters");
+    SEMIPRO_LOGF(INFO, VALIDATION, "MetrologyModel initialized with default parameters");
 }
 
 std::vector<MetrologyModel::MeasurementResult> MetrologyModel::performMeasurement(
@@ -26,13 +45,19 @@ std::vector<MetrologyModel::MeasurementResult> MetrologyModel::performMeasuremen
     std::vector<MeasurementResult> results;
     results.reserve(measurement_points.size());
     
+    // Every CD site reads the same edges
+    EdgeMap edges;
+    if (type == CRITICAL_DIMENSION) {
+        edges = extractResistEdges(wafer);
+    }
+    
     for (const auto& point : measurement_points) {
         switch (type) {
             case THICKNESS:
                 results.push_back(measureThickness(wafer, point.first, point.second));
                 break;
             case CRITICAL_DIMENSION:
-                results.push_back(measureCriticalDimension(wafer, point.first, point.second, "line"));
+                results.push_back(measureCriticalDimension(edges, wafer, point.first, point.second, "line"));
                 break;
             case OVERLAY:
                 results.push_back(measureOverlay(wafer, point.first, point.second, "layer1", "layer2"));
@@ -59,7 +84,7 @@ std::vector<MetrologyModel::MeasurementResult> MetrologyModel::performMeasuremen
         }
     }
     
-    Logger::getInstance().log("Performed " + std::to_string(results.size()) + " measurements");
+    SEMIPRO_LOGF(INFO, VALIDATION, "Performed {} measurements", results.size());
     return results;
 }
 
@@ -68,25 +93,9 @@ MetrologyModel::MeasurementResult MetrologyModel::measureThickness(
     double x, double y,
     const std::string& layer_material) {
     
-    double thickness = 0.0;
+    double thickness = stackThickness(*wafer, layer_material);
     double uncertainty = 0.1; // nm
     
-    if (layer_material.empty()) {
-        // Measure total thickness
-        thickness = wafer->getThickness();
-        for (const auto& layer : wafer->getFilmLayers()) {
-            thickness += layer.first;
-        }
-    } else {
-        // Measure specific layer thickness
-        for (const auto& layer : wafer->getFilmLayers()) {
-            if (layer.second == layer_material) {
-                thickness = layer.first;
-                break;
-            }
-        }
-    }
-    
     // Add measurement noise and systematic errors
     double noise_level = measurement_parameters_["noise_level"];
     double measured_thickness = addMeasurementNoise(thickness, thickness * noise_level);
@@ -107,27 +116,36 @@ MetrologyModel::MeasurementResult MetrologyModel::measureCriticalDimension(
     double x, double y,
     const std::string& feature_type) {
     
-    // Simulate CD measurement based on photoresist pattern
-    auto grid_coords = convertToGridCoordinates(wafer, x, y);
-    double pattern_value = 0.0;
+    return measureCriticalDimension(extractResistEdges(wafer), wafer, x, y, feature_type);
+}
+
+MetrologyModel::MeasurementResult MetrologyModel::measureCriticalDimension(
+    const EdgeMap& edges,
+    std::shared_ptr<Wafer> wafer,
+    double x, double y,
+    const std::string& feature_type) {
     
-    if (wafer->getGrid().rows() > 0 && wafer->getGrid().cols() > 0) {
-        pattern_value = interpolateGridValue(wafer->getPhotoresistPattern(), 
-                                           grid_coords.first, grid_coords.second);
+    // The row under the site, and the site along it with cell centers at
+    // whole numbers as the edges place them
+    auto grid_coords = convertToGridCoordinates(wafer, x, y);
+    double cd = 0.0;
+    bool found = false;
+    if (edges.rows() > 0 && edges.cols() > 0) {
+        const int row = static_cast<int>(std::clamp(grid_coords.first, 0.0, edges.rows() - 1.0));
+        found = featureWidth(edges, row, grid_coords.second - 0.5, feature_type != "space", cd);
+        // Cells span the wafer diameter across the grid's columns
+        cd *= wafer->getDiameter() * 1e6 / edges.cols(); // nm
     }
     
-    // Convert pattern value to CD (simplified model)
-    double nominal_cd = 100.0; // nm
-    double cd = nominal_cd * (0.8 + 0.4 * pattern_value);
-    
     // Add measurement noise
     double noise_level = measurement_parameters_["noise_level"];
-    double measured_cd = addMeasurementNoise(cd, cd * noise_level);
+    double measured_cd = found ? addMeasurementNoise(cd, cd * noise_level) : 0.0;
     measured_cd *= calibration_factors_["cd"];
     
     MeasurementResult result(CRITICAL_DIMENSION, measured_cd, 2.0, "nm");
     result.metadata["x_position"] = x;
     result.metadata["y_position"] = y;
+    result.metadata["feature_found"] = found ? 1.0 : 0.0;
     result.string_metadata["feature_type"] = feature_type;
     
     return result;
@@ -139,24 +157,289 @@ MetrologyModel::MeasurementResult MetrologyModel::measureOverlay(
     const std::string& layer1,
     const std::string& layer2) {
     
-    // Simulate overlay measurement (misalignment between layers)
-    double overlay_x = addMeasurementNoise(0.0, 5.0); // nm
-    double overlay_y = addMeasurementNoise(0.0, 5.0); // nm
+    SiteBatch site;
+    site.x = Eigen::ArrayXd::Constant(1, x);
+    site.y = Eigen::ArrayXd::Constant(1, y);
+    Eigen::ArrayXd registered_x, registered_y, peak;
+    const bool imaged = registerOverlay(wafer, site, layer1, layer2, registered_x, registered_y, peak);
+    
+    double overlay_x, overlay_y, uncertainty;
+    if (imaged) {
+        uncertainty = measurement_parameters_["overlay_noise"];
+        overlay_x = addMeasurementNoise(registered_x(0), uncertainty);
+        overlay_y = addMeasurementNoise(registered_y(0), uncertainty);
+    } else {
+        // Simulate overlay measurement (misalignment between layers)
+        uncertainty = 1.0;
+        overlay_x = addMeasurementNoise(0.0, 5.0); // nm
+        overlay_y = addMeasurementNoise(0.0, 5.0); // nm
+    }
     double total_overlay = std::sqrt(overlay_x * overlay_x + overlay_y * overlay_y);
     
     total_overlay *= calibration_factors_["overlay"];
     
-    MeasurementResult result(OVERLAY, total_overlay, 1.0, "nm");
+    MeasurementResult result(OVERLAY, total_overlay, uncertainty, "nm");
     result.metadata["x_position"] = x;
     result.metadata["y_position"] = y;
     result.string_metadata["layer1"] = layer1;
     result.string_metadata["layer2"] = layer2;
     result.metadata["overlay_x"] = overlay_x;
     result.metadata["overlay_y"] = overlay_y;
+    if (imaged) {
+        result.metadata["correlation_peak"] = peak(0);
+    }
+    
+    return result;
+}
+
+MetrologyModel::MeasurementResult MetrologyModel::performEllipsometry(
+    std::shared_ptr<Wafer> wafer,
+    double x, double y,
+    double wavelength) {
+    
+    const std::vector<OpticalLayer> layers = opticalStack(*wafer);
+    const OpticalIndex substrate = materialIndex(wafer->getMaterialId());
+    const double angle = measurement_parameters_["ellipsometry_angle"] * M_PI / 180.0;
+    const double angle_noise = measurement_parameters_["angle_noise"];
+    
+    const Eigen::ArrayXd ncs = ellipsometrySpectrum(layers, substrate, Eigen::ArrayXd::Constant(1, wavelength), angle);
+    const Eigen::ArrayXd noise = angle_noise * drawStandardNormals(2);
+    const double psi = 0.5 * std::acos(std::clamp(ncs(0), -1.0, 1.0)) * 180.0 / M_PI + noise(0);
+    const double delta = std::atan2(ncs(2), ncs(1)) * 180.0 / M_PI + noise(1);
+    MeasurementResult result(ELLIPSOMETRY, psi, angle_noise, "deg");
+    result.metadata["x_position"] = x;
+    result.metadata["y_position"] = y;
+    result.metadata["wavelength"] = wavelength;
+    result.metadata["delta"] = delta;
+    
+    if (ellipsometry_library_) {
+        // An angle error of e radians moves N, C and S by about 2e
+        const OpticalLibrary& library = *ellipsometry_library_;
+        const std::size_t thickness = libraryAxis(library, "thickness");
+        Eigen::ArrayXd spectrum = ellipsometrySpectrum(layers, substrate, library.wavelengths(), angle);
+        spectrum += 2.0 * angle_noise * M_PI / 180.0 * drawStandardNormals(spectrum.size());
+        const OpticalLibrary::Match match = library.match(spectrum);
+        result.metadata["fitted_thickness"] = match.params[thickness];
+        result.metadata["residual"] = match.residual;
+    }
+    return result;
+}
+
+MetrologyModel::MeasurementResult MetrologyModel::performScatterometry(
+    std::shared_ptr<Wafer> wafer,
+    double x, double y,
+    const std::string& grating_type) {
+    
+    if (!scatterometry_library_) {
+        throw std::logic_error("Scatterometry needs a library; see setScatterometryLibrary");
+    }
+    const OpticalLibrary& library = *scatterometry_library_;
+    const std::size_t fill_axis = libraryAxis(library, "fill");
+    const std::size_t height_axis = libraryAxis(library, "height");
+    
+    // The line under the site and the space beside it set the grating
+    const EdgeMap edges = extractResistEdges(wafer);
+    auto grid_coords = convertToGridCoordinates(wafer, x, y);
+    double line = 0.0, space = 0.0;
+    bool found = false;
+    if (edges.rows() > 0 && edges.cols() > 0) {
+        const int row = static_cast<int>(std::clamp(grid_coords.first, 0.0, edges.rows() - 1.0));
+        const double position = grid_coords.second - 0.5;
+        found = featureWidth(edges, row, position, true, line) && featureWidth(edges, row, position, false, space);
+    }
     
+    MeasurementResult result(CRITICAL_DIMENSION, 0.0, 2.0, "nm");
+    result.metadata["x_position"] = x;
+    result.metadata["y_position"] = y;
+    result.metadata["feature_found"] = found ? 1.0 : 0.0;
+    result.string_metadata["feature_type"] = grating_type;
+    result.string_metadata["technique"] = "scatterometry";
+    if (!found) {
+        return result;
+    }
+    
+    const double pitch = (line + space) * wafer->getDiameter() * 1e6 / edges.cols(); // nm
+    GratingProfile profile{line / (line + space), measurement_parameters_["resist_thickness"], 1.0,
+                           materialIndex("photoresist"), materialIndex("air")};
+    Eigen::ArrayXd spectrum = gratingSpectrum(profile, materialIndex(wafer->getMaterialId()), library.wavelengths());
+    spectrum *= 1.0 + measurement_parameters_["noise_level"] * drawStandardNormals(spectrum.size());
+    
+    const OpticalLibrary::Match match = library.match(spectrum);
+    const double fill = match.params[fill_axis];
+    result.value = (grating_type == "space" ? 1.0 - fill : fill) * pitch * calibration_factors_["cd"];
+    result.metadata["pitch"] = pitch;
+    result.metadata["height"] = match.params[height_axis];
+    result.metadata["residual"] = match.residual;
     return result;
 }
 
+void MetrologyModel::setScatterometryLibrary(std::shared_ptr<const OpticalLibrary> library) {
+    scatterometry_library_ = std::move(library);
+}
+
+void MetrologyModel::setEllipsometryLibrary(std::shared_ptr<const OpticalLibrary> library) {
+    ellipsometry_library_ = std::move(library);
+}
+
+OpticalLibrary::Model MetrologyModel::scatterometryModel(const std::string& substrate, const Eigen::ArrayXd& wavelengths) {
+    const OpticalIndex substrate_index = materialIndex(substrate);
+    return [substrate_index, wavelengths](const std::vector<double>& params) {
+        // The spectrum depends on CD and pitch only through the fill
+        const GratingProfile profile{params[0], params[1], 1.0, materialIndex("photoresist"), materialIndex("air")};
+        return gratingSpectrum(profile, substrate_index, wavelengths);
+    };
+}
+
+OpticalLibrary::Model MetrologyModel::ellipsometryModel(const Wafer& wafer, const Eigen::ArrayXd& wavelengths, double angle) {
+    std::vector<OpticalLayer> layers = opticalStack(wafer);
+    if (layers.empty()) {
+        throw std::invalid_argument("Ellipsometry model needs a wafer with films");
+    }
+    const OpticalIndex substrate = materialIndex(wafer.getMaterialId());
+    const double radians = angle * M_PI / 180.0;
+    return [layers, substrate, wavelengths, radians](const std::vector<double>& params) {
+        std::vector<OpticalLayer> stack = layers;
+        stack.front().thickness = params[0];
+        return ellipsometrySpectrum(stack, substrate, wavelengths, radians);
+    };
+}
+
+MetrologyModel::BatchResult MetrologyModel::measureBatch(
+    std::shared_ptr<Wafer> wafer,
+    MeasurementType type,
+    const SiteBatch& sites,
+    const std::string& option) {
+    
+    if (sites.x.size() != sites.y.size()) {
+        throw std::invalid_argument("Batch site columns must have equal lengths");
+    }
+    const Eigen::Index n = sites.x.size();
+    const double noise_level = measurement_parameters_["noise_level"];
+    
+    BatchResult batch;
+    batch.type = type;
+    switch (type) {
+        case THICKNESS: {
+            const double thickness = stackThickness(*wafer, option);
+            batch.uncertainty = 0.1;
+            batch.units = "μm";
+            batch.value = (thickness + thickness * noise_level * drawStandardNormals(n)) *
+                          calibration_factors_["thickness"];
+            break;
+        }
+        case CRITICAL_DIMENSION: {
+            batch.uncertainty = 2.0;
+            batch.units = "nm";
+            batch.value = Eigen::ArrayXd::Zero(n);
+            batch.feature_found = Eigen::ArrayXd::Zero(n);
+            const EdgeMap edges = extractResistEdges(wafer);
+            if (edges.rows() > 0 && edges.cols() > 0) {
+                // Rows and positions along them as measureCriticalDimension
+                // takes them, then each site's search on its own row
+                const double diameter = wafer->getDiameter() * 1000.0;
+                const Eigen::ArrayXd rows = ((sites.x + diameter / 2.0) / diameter * wafer->getGrid().rows())
+                                                .max(0.0).min(edges.rows() - 1.0);
+                const Eigen::ArrayXd positions = (sites.y + diameter / 2.0) / diameter * wafer->getGrid().cols() - 0.5;
+                const bool line = option != "space";
+                TaskScheduler::getInstance().parallelFor(0, static_cast<int>(n), [&](int begin, int end) {
+                    for (int k = begin; k < end; ++k) {
+                        double cd = 0.0;
+                        if (featureWidth(edges, static_cast<int>(rows(k)), positions(k), line, cd)) {
+                            batch.value(k) = cd;
+                            batch.feature_found(k) = 1.0;
+                        }
+                    }
+                });
+                batch.value *= wafer->getDiameter() * 1e6 / edges.cols(); // nm
+            }
+            batch.value = batch.value * (1.0 + noise_level * drawStandardNormals(n)) * calibration_factors_["cd"];
+            break;
+        }
+        case OVERLAY: {
+            batch.units = "nm";
+            const std::size_t slash = option.find('/');
+            Eigen::ArrayXd peak;
+            if (slash != std::string::npos &&
+                registerOverlay(wafer, sites, option.substr(0, slash), option.substr(slash + 1),
+                                batch.overlay_x, batch.overlay_y, peak)) {
+                batch.uncertainty = measurement_parameters_["overlay_noise"];
+                batch.overlay_x += batch.uncertainty * drawStandardNormals(n);
+                batch.overlay_y += batch.uncertainty * drawStandardNormals(n);
+            } else {
+                batch.uncertainty = 1.0;
+                batch.overlay_x = 5.0 * drawStandardNormals(n);
+                batch.overlay_y = 5.0 * drawStandardNormals(n);
+            }
+            batch.value = (batch.overlay_x.square() + batch.overlay_y.square()).sqrt() * calibration_factors_["overlay"];
+            break;
+        }
+        case ROUGHNESS:
+            batch.uncertainty = 0.05;
+            batch.units = "nm";
+            batch.value = 0.5 + 0.1 * drawStandardNormals(n);
+            break;
+        case STRESS:
+            batch.uncertainty = 5.0;
+            batch.units = "MPa";
+            batch.value = 100.0 + 10.0 * drawStandardNormals(n);
+            break;
+        case RESISTIVITY:
+            batch.uncertainty = 5e-8;
+            batch.units = "Ω·cm";
+            batch.value = 1e-6 + 1e-7 * drawStandardNormals(n);
+            break;
+        case REFLECTANCE:
+            batch.uncertainty = 0.005;
+            batch.units = "";
+            batch.value = 0.3 + 0.01 * drawStandardNormals(n);
+            break;
+        case ELLIPSOMETRY:
+            throw std::invalid_argument("Ellipsometry has no batch measurement");
+    }
+    
+    SEMIPRO_LOGF(INFO, VALIDATION, "Performed {} batch measurements", n);
+    return batch;
+}
+
+Eigen::ArrayXd MetrologyModel::sampleField(
+    const Eigen::Ref<const Eigen::ArrayXXd>& field,
+    std::shared_ptr<Wafer> wafer,
+    const SiteBatch& sites) const {
+    
+    if (sites.x.size() != sites.y.size()) {
+        throw std::invalid_argument("Batch site columns must have equal lengths");
+    }
+    const Eigen::Index n = sites.x.size();
+    if (field.rows() == 0 || field.cols() == 0) {
+        return Eigen::ArrayXd::Zero(n);
+    }
+    
+    // Continuous cell coordinates with centers at whole numbers, clamped
+    // so the outer cells hold their value out to the wafer edge
+    const double diameter = wafer->getDiameter() * 1000.0;
+    const Eigen::ArrayXd gx = ((sites.x + diameter / 2.0) / diameter * field.rows() - 0.5)
+                                  .max(0.0).min(field.rows() - 1.0);
+    const Eigen::ArrayXd gy = ((sites.y + diameter / 2.0) / diameter * field.cols() - 0.5)
+                                  .max(0.0).min(field.cols() - 1.0);
+    // Lower corners, kept one short of the last cell so the upper one exists
+    const Eigen::ArrayXi i0 = gx.floor().cast<int>().min(std::max<int>(field.rows() - 2, 0));
+    const Eigen::ArrayXi j0 = gy.floor().cast<int>().min(std::max<int>(field.cols() - 2, 0));
+    const Eigen::ArrayXd tx = gx - i0.cast<double>();
+    const Eigen::ArrayXd ty = gy - j0.cast<double>();
+    const int di = field.rows() > 1 ? 1 : 0;
+    const int dj = field.cols() > 1 ? 1 : 0;
+    
+    Eigen::ArrayXd values(n);
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(n), [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            const double top = field(i0(k), j0(k)) + ty(k) * (field(i0(k), j0(k) + dj) - field(i0(k), j0(k)));
+            const double bottom = field(i0(k) + di, j0(k)) + ty(k) * (field(i0(k) + di, j0(k) + dj) - field(i0(k) + di, j0(k)));
+            values(k) = top + tx(k) * (bottom - top);
+        }
+    }, 4096);
+    return values;
+}
+
 std::unordered_map<std::string, double> MetrologyModel::calculateStatistics(
     const std::vector<MeasurementResult>& results) {
     
@@ -207,7 +490,7 @@ void MetrologyModel::calibrateInstrument(const std::string& calibration_type) {
         calibration_factors_["overlay"] = 1.0 + addMeasurementNoise(0.0, 0.001);
     }
     
-    Logger::getInstance().log("Calibrated " + calibration_type + " measurement");
+    SEMIPRO_LOGF(INFO, VALIDATION, "Calibrated {} measurement", calibration_type);
 }
 
 void MetrologyModel::setMeasurementParameters(
@@ -217,7 +500,92 @@ void MetrologyModel::setMeasurementParameters(
         measurement_parameters_[param.first] = param.second;
     }
     
-    Logger::getInstance().log("Updated measurement parameters");
+    SEMIPRO_LOGF(INFO, VALIDATION, "Updated measurement parameters");
+}
+
+void MetrologyModel::setControlLimits(MeasurementType type, const ControlLimits& limits) {
+    if (!(limits.upper_control_limit > limits.lower_control_limit)) {
+        throw std::invalid_argument("Upper control limit must exceed the lower");
+    }
+    SpcSettings settings;
+    settings.center = limits.target_value;
+    settings.sigma = (limits.upper_control_limit - limits.lower_control_limit) / 6.0;
+    settings.lower_spec = limits.lower_spec_limit;
+    settings.upper_spec = limits.upper_spec_limit;
+    spc_.configure(type, settings);
+    control_limits_[type] = limits;
+}
+
+bool MetrologyModel::isWithinControlLimits(const MeasurementResult& result) {
+    auto it = control_limits_.find(result.type);
+    if (it == control_limits_.end()) {
+        return true;
+    }
+    return result.value >= it->second.lower_control_limit && result.value <= it->second.upper_control_limit;
+}
+
+double MetrologyModel::calculateCpk(const std::vector<MeasurementResult>& results, MeasurementType type) {
+    auto it = control_limits_.find(type);
+    RunningMoments moments;
+    for (const auto& result : results) {
+        if (result.type == type) {
+            moments.add(result.value);
+        }
+    }
+    const double sigma = moments.stddev();
+    if (it == control_limits_.end() || moments.count < 2 || !(sigma > 0.0)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return std::min(it->second.upper_spec_limit - moments.mean, moments.mean - it->second.lower_spec_limit) /
+           (3.0 * sigma);
+}
+
+unsigned MetrologyModel::recordMeasurements(const std::vector<MeasurementResult>& results) {
+    // One batch per type, each in arrival order
+    std::vector<std::vector<double>> values(ELLIPSOMETRY + 1);
+    for (const auto& result : results) {
+        values[result.type].push_back(result.value);
+    }
+    unsigned signals = SPC_IN_CONTROL;
+    for (int type = 0; type <= ELLIPSOMETRY; ++type) {
+        if (!values[type].empty()) {
+            signals |= spc_.add(type, values[type].data(), values[type].size());
+        }
+    }
+    if (auto store = std::atomic_load(&result_store_)) {
+        for (const auto& result : results) {
+            ResultRecord record("metrology", kMeasurementNames[result.type]);
+            record.add("measurement", "value", result.value);
+            record.add("measurement", "uncertainty", result.uncertainty);
+            record.addAll("metadata", result.metadata);
+            store->append(record);
+        }
+    }
+    return signals;
+}
+
+unsigned MetrologyModel::recordMeasurements(const BatchResult& batch) {
+    const unsigned signals = spc_.add(batch.type, batch.value.data(), static_cast<std::size_t>(batch.value.size()));
+    if (auto store = std::atomic_load(&result_store_)) {
+        for (Eigen::Index k = 0; k < batch.value.size(); ++k) {
+            ResultRecord record("metrology", kMeasurementNames[batch.type]);
+            record.add("measurement", "value", batch.value[k]);
+            record.add("measurement", "uncertainty", batch.uncertainty);
+            if (batch.overlay_x.size() == batch.value.size()) {
+                record.add("measurement", "overlay_x", batch.overlay_x[k]);
+                record.add("measurement", "overlay_y", batch.overlay_y[k]);
+            }
+            if (batch.feature_found.size() == batch.value.size()) {
+                record.add("measurement", "feature_found", batch.feature_found[k]);
+            }
+            store->append(record);
+        }
+    }
+    return signals;
+}
+
+EdgeMap MetrologyModel::extractResistEdges(std::shared_ptr<Wafer> wafer) {
+    return EdgeMap::extract(wafer->getPhotoresistPattern(), measurement_parameters_["cd_threshold"]);
 }
 
 double MetrologyModel::addMeasurementNoise(double true_value, double noise_level) {
@@ -225,13 +593,90 @@ double MetrologyModel::addMeasurementNoise(double true_value, double noise_level
     return true_value + noise_dist(rng_);
 }
 
-double MetrologyModel::interpolateGridValue(const Eigen::ArrayXXd& grid, double x, double y) {
+double MetrologyModel::interpolateGridValue(const Eigen::Ref<const Eigen::ArrayXXd>& grid, double x, double y) {
     if (grid.rows() == 0 || grid.cols() == 0) return 0.0;
     
-    int i = static_cast<int>(std::clamp(x, 0.0, static_cast<double>(grid.rows() - 1)));
-    int j = static_cast<int>(std::clamp(y, 0.0, static_cast<double>(grid.cols() - 1)));
+    const double gx = std::clamp(x - 0.5, 0.0, grid.rows() - 1.0);
+    const double gy = std::clamp(y - 0.5, 0.0, grid.cols() - 1.0);
+    const int i = std::min(static_cast<int>(gx), std::max<int>(grid.rows() - 2, 0));
+    const int j = std::min(static_cast<int>(gy), std::max<int>(grid.cols() - 2, 0));
+    const int i1 = std::min<int>(i + 1, grid.rows() - 1), j1 = std::min<int>(j + 1, grid.cols() - 1);
+    const double tx = gx - i, ty = gy - j;
     
-    return grid(i, j);
+    const double top = grid(i, j) + ty * (grid(i, j1) - grid(i, j));
+    const double bottom = grid(i1, j) + ty * (grid(i1, j1) - grid(i1, j));
+    return top + tx * (bottom - top);
+}
+
+void MetrologyModel::setLayerImage(const std::string& layer, const Eigen::ArrayXXd& image) {
+    if (image.size() == 0) {
+        layer_images_.erase(layer);
+    } else {
+        layer_images_[layer] = std::make_shared<const Eigen::ArrayXXd>(image);
+    }
+}
+
+bool MetrologyModel::registerOverlay(std::shared_ptr<Wafer> wafer, const SiteBatch& sites, const std::string& layer1,
+                                     const std::string& layer2, Eigen::ArrayXd& overlay_x, Eigen::ArrayXd& overlay_y,
+                                     Eigen::ArrayXd& peak) {
+    const auto first = layer_images_.find(layer1);
+    const auto second = layer_images_.find(layer2);
+    if (first == layer_images_.end() || second == layer_images_.end()) {
+        return false;
+    }
+    const Eigen::ArrayXXd& reference = *first->second;
+    const Eigen::ArrayXXd& moving = *second->second;
+    if (reference.rows() != moving.rows() || reference.cols() != moving.cols()) {
+        throw std::invalid_argument("Overlay images of " + layer1 + " and " + layer2 + " differ in shape");
+    }
+    
+    // One correlator, its taper and low-pass worked out once, serves
+    // every site until the window changes
+    const std::shared_ptr<FftBackend> backend = Fft::defaultBackend();
+    const int window = backend->goodSize(std::max(4, static_cast<int>(measurement_parameters_["overlay_window"])));
+    if (!overlay_correlator_ || overlay_correlator_->size() != window ||
+        &overlay_correlator_->backend() != backend.get()) {
+        overlay_correlator_ = std::make_shared<const PhaseCorrelator>(window, backend);
+    }
+    
+    // Windows centered on the cell under each site, edge pixels repeated
+    // past the image
+    const double diameter = wafer->getDiameter() * 1000.0; // μm
+    const Eigen::Index rows = reference.rows(), cols = reference.cols();
+    const Eigen::ArrayXi row0 = ((sites.x + diameter / 2.0) / diameter * rows - 0.5).round().cast<int>() - window / 2;
+    const Eigen::ArrayXi col0 = ((sites.y + diameter / 2.0) / diameter * cols - 0.5).round().cast<int>() - window / 2;
+    const auto shifts = overlay_correlator_->registerBatch(
+        static_cast<std::size_t>(sites.x.size()), [&](std::size_t k, int dr, int dc, double* a, double* b) {
+            for (int r = 0; r < window; ++r) {
+                const Eigen::Index i = std::clamp<Eigen::Index>(row0(k) + r, 0, rows - 1);
+                const Eigen::Index im = std::clamp<Eigen::Index>(row0(k) + dr + r, 0, rows - 1);
+                for (int c = 0; c < window; ++c) {
+                    a[r * window + c] = reference(i, std::clamp<Eigen::Index>(col0(k) + c, 0, cols - 1));
+                    b[r * window + c] = moving(im, std::clamp<Eigen::Index>(col0(k) + dc + c, 0, cols - 1));
+                }
+            }
+        });
+    
+    const double pixel_x = diameter / rows * 1000.0; // nm
+    const double pixel_y = diameter / cols * 1000.0;
+    overlay_x.resize(sites.x.size());
+    overlay_y.resize(sites.x.size());
+    peak.resize(sites.x.size());
+    for (std::size_t k = 0; k < shifts.size(); ++k) {
+        overlay_x(k) = shifts[k].rows * pixel_x;
+        overlay_y(k) = shifts[k].cols * pixel_y;
+        peak(k) = shifts[k].peak;
+    }
+    return true;
+}
+
+Eigen::ArrayXd MetrologyModel::drawStandardNormals(Eigen::Index n) {
+    std::normal_distribution<double> normal(0.0, 1.0);
+    Eigen::ArrayXd draws(n);
+    for (Eigen::Index k = 0; k < n; ++k) {
+        draws(k) = normal(rng_);
+    }
+    return draws;
 }
 
 std::pair<double, double> MetrologyModel::convertToGridCoordinates(
@@ -244,3 +689,62 @@ std::pair<double, double> MetrologyModel::convertToGridCoordinates(
     
     return {grid_x, grid_y};
 }
+
+bool MetrologyModel::featureWidth(const EdgeMap& edges, int row, double position, bool line, double& width) {
+    // Lines run from a rising crossing to the next falling one, spaces the
+    // other way; take the one holding the position, else the nearest
+    const auto& crossings = edges.rowCrossings(row);
+    double nearest = std::numeric_limits<double>::infinity();
+    bool found = false;
+    for (size_t k = 1; k < crossings.size(); ++k) {
+        if (crossings[k - 1].rising != line || crossings[k].rising == line) {
+            continue;
+        }
+        const double begin = crossings[k - 1].position, end = crossings[k].position;
+        const double distance = std::max({begin - position, position - end, 0.0});
+        if (distance < nearest) {
+            nearest = distance;
+            width = end - begin;
+            found = true;
+        }
+    }
+    return found;
+}
+
+double MetrologyModel::stackThickness(const Wafer& wafer, const std::string& layer_material) {
+    if (layer_material.empty()) {
+        // Total thickness
+        double thickness = wafer.getThickness();
+        for (const auto& layer : wafer.getFilmLayers()) {
+            thickness += layer.first;
+        }
+        return thickness;
+    }
+    // The named layer's thickness
+    for (const auto& layer : wafer.getFilmLayers()) {
+        if (layer.second == layer_material) {
+            return layer.first;
+        }
+    }
+    return 0.0;
+}
+
+std::vector<OpticalLayer> MetrologyModel::opticalStack(const Wafer& wafer) {
+    const auto& films = wafer.getFilmLayers();
+    std::vector<OpticalLayer> layers;
+    layers.reserve(films.size());
+    for (auto film = films.rbegin(); film != films.rend(); ++film) {
+        layers.push_back({materialIndex(film->second), film->first * 1000.0});
+    }
+    return layers;
+}
+
+std::size_t MetrologyModel::libraryAxis(const OpticalLibrary& library, const std::string& name) {
+    const auto& axes = library.axes();
+    for (std::size_t a = 0; a < axes.size(); ++a) {
+        if (axes[a].name == name) {
+            return a;
+        }
+    }
+    throw std::invalid_argument("Optical library has no " + name + " axis");
+}
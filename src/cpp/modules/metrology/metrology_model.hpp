@@ -2,6 +2,11 @@
 #define METROLOGY_MODEL_HPP
 
 #include "metrology_interface.hpp"
+#include "optical_library.hpp"
+#include "spc_engine.hpp"
+#include "../../core/edge_map.hpp"
+#include "../../core/phase_correlation.hpp"
+#include "../../core/result_store.hpp"
 #include "../../core/utils.hpp"
 #include <random>
 #include <cmath>
@@ -30,6 +35,21 @@ public:
         const std::string& feature_type
     ) override;
     
+    // CD of the line (or, for "space", the gap) under (x, y) along its
+    // grid row, from edges already extracted off the wafer's photoresist
+    // pattern; a batch of sites shares one extraction this way
+    MeasurementResult measureCriticalDimension(
+        const EdgeMap& edges,
+        std::shared_ptr<Wafer> wafer,
+        double x, double y,
+        const std::string& feature_type
+    );
+    
+    // Displacement of layer2 against layer1 at the site. With images of
+    // both layers set, the overlay_window pixels about the site are
+    // registered by phase correlation to a fraction of a pixel, plus the
+    // overlay_noise parameter (nm) of the tool; otherwise it is drawn as
+    // a 5 nm spread about zero.
     MeasurementResult measureOverlay(
         std::shared_ptr<Wafer> wafer,
         double x, double y,
@@ -37,6 +57,54 @@ public:
         const std::string& layer2
     ) override;
     
+    // Image of a layer's overlay targets spanning the wafer's diameter,
+    // rows along x as on the grid, for measureOverlay to register; an
+    // empty image removes the layer's
+    void setLayerImage(const std::string& layer, const Eigen::ArrayXXd& image);
+    
+    // Sites of a batch as columns, in μm about the wafer center
+    struct SiteBatch {
+        Eigen::ArrayXd x;
+        Eigen::ArrayXd y;
+    };
+
+    // Results of a batch as columns, entry k for site k; the per-site
+    // metadata that varies is a column of its own, the rest is shared
+    struct BatchResult {
+        MeasurementType type;
+        double uncertainty;
+        std::string units;
+        Eigen::ArrayXd value;
+        Eigen::ArrayXd overlay_x;      // OVERLAY only
+        Eigen::ArrayXd overlay_y;      // OVERLAY only
+        Eigen::ArrayXd feature_found;  // CRITICAL_DIMENSION only, 1 or 0
+    };
+
+    // Every site of a map in one call, with the same models as the
+    // per-site measurements: shared work (the CD edge extraction, the film
+    // stack) is done once, the noise drawn in bulk and the rest computed
+    // over whole columns. option is the layer material for THICKNESS, the
+    // feature type for CRITICAL_DIMENSION ("line" when empty) and the two
+    // layers as "layer1/layer2" for OVERLAY, whose sites are registered
+    // in parallel by one correlator when both have images.
+    // Throws std::invalid_argument if x and y differ in length or for
+    // ELLIPSOMETRY, which has no batch form.
+    BatchResult measureBatch(
+        std::shared_ptr<Wafer> wafer,
+        MeasurementType type,
+        const SiteBatch& sites,
+        const std::string& option = ""
+    );
+
+    // Bilinear samples of a wafer-sized field (the grid or any field
+    // sharing its shape) at the sites, cell values at cell centers and
+    // held constant beyond the outer ones
+    Eigen::ArrayXd sampleField(
+        const Eigen::Ref<const Eigen::ArrayXXd>& field,
+        std::shared_ptr<Wafer> wafer,
+        const SiteBatch& sites
+    ) const;
+
     std::unordered_map<std::string, double> calculateStatistics(
         const std::vector<MeasurementResult>& results
     ) override;
@@ -45,6 +113,10 @@ public:
     void setMeasurementParameters(const std::unordered_map<std::string, double>& params) override;
     
     // Advanced measurement techniques
+    // Psi (the value) and delta, in degrees, of the film stack at
+    // wavelength and the ellipsometry_angle parameter. With a library set,
+    // the stack is also measured at the library's wavelengths and matched,
+    // the top film's thickness reported as fitted_thickness (nm).
     MeasurementResult performEllipsometry(
         std::shared_ptr<Wafer> wafer,
         double x, double y,
@@ -57,12 +129,29 @@ public:
         const std::vector<double>& wavelengths
     );
     
+    // CD (nm) of the resist grating under the site by matching its
+    // reflectance spectrum against the scatterometry library: the fitted
+    // fill times the pitch the resist edges give, of the space instead of
+    // the line when grating_type is "space", with the fitted height and the
+    // match residual as metadata. Throws std::logic_error without a library.
     MeasurementResult performScatterometry(
         std::shared_ptr<Wafer> wafer,
         double x, double y,
         const std::string& grating_type
     );
     
+    // Libraries the two techniques above match against, built offline with
+    // OpticalLibrary::generate from the models below and shared between
+    // instruments; null clears
+    void setScatterometryLibrary(std::shared_ptr<const OpticalLibrary> library);
+    void setEllipsometryLibrary(std::shared_ptr<const OpticalLibrary> library);
+    // Resist gratings on the substrate material over axes "fill" (CD /
+    // pitch) then "height" (nm)
+    static OpticalLibrary::Model scatterometryModel(const std::string& substrate, const Eigen::ArrayXd& wavelengths);
+    // wafer's top film over axis "thickness" (nm) on the rest of its stack,
+    // at angle degrees; throws std::invalid_argument if it has no films
+    static OpticalLibrary::Model ellipsometryModel(const Wafer& wafer, const Eigen::ArrayXd& wavelengths, double angle);
+    
     // Process control and SPC
     struct ControlLimits {
         double lower_control_limit;
@@ -72,10 +161,31 @@ public:
         double target_value;
     };
     
+    // Also sets the type's SPC chart: centered on the target with sigma a
+    // sixth of the control band, the spec limits for Cpk. Throws
+    // std::invalid_argument unless the upper control limit is the higher.
     void setControlLimits(MeasurementType type, const ControlLimits& limits);
+    // True when the result's type has no limits set
     bool isWithinControlLimits(const MeasurementResult& result);
+    // Over the results of type alone, against its spec limits; NaN without
+    // limits, below two results or without variation
     double calculateCpk(const std::vector<MeasurementResult>& results, MeasurementType type);
     
+    // Streaming SPC: measurements are fed to the engine as they arrive and
+    // its moments, charts and Cpk read at any time without revisiting the
+    // history. Safe to call from several threads at once. Returns the
+    // signals any of the values raised on its type's chart.
+    unsigned recordMeasurements(const std::vector<MeasurementResult>& results);
+    unsigned recordMeasurements(const BatchResult& batch);
+    // Recorded measurements then also go to the store, one record per
+    // site: source "metrology", label the type ("thickness", "overlay",
+    // ...), with group "measurement" holding the value, its uncertainty
+    // and the batch columns, and group "metadata" the numeric metadata.
+    // Null stops recording.
+    void setResultStore(std::shared_ptr<ResultStore> store) { std::atomic_store(&result_store_, std::move(store)); }
+    const SpcEngine& spc() const { return spc_; }
+    SpcEngine& spc() { return spc_; }
+    
     // Measurement uncertainty analysis
     struct UncertaintyBudget {
         double repeatability;
@@ -92,14 +202,41 @@ private:
     std::unordered_map<MeasurementType, ControlLimits> control_limits_;
     std::unordered_map<std::string, double> calibration_factors_;
     
+    std::shared_ptr<const OpticalLibrary> scatterometry_library_;
+    std::shared_ptr<const OpticalLibrary> ellipsometry_library_;
+    SpcEngine spc_; // A stream per MeasurementType
+    std::shared_ptr<ResultStore> result_store_; // Read with std::atomic_load
+    std::unordered_map<std::string, std::shared_ptr<const Eigen::ArrayXXd>> layer_images_;
+    std::shared_ptr<const PhaseCorrelator> overlay_correlator_; // Kept while overlay_window stays
+    
     mutable std::mt19937 rng_;
     
     // Helper functions
+    // Sub-pixel contour of the photoresist pattern at the cd_threshold parameter
+    EdgeMap extractResistEdges(std::shared_ptr<Wafer> wafer);
+    // Overlay (nm) of layer2 against layer1 at each site from their
+    // images, with the correlation peak of each; false unless both layers
+    // have images
+    bool registerOverlay(std::shared_ptr<Wafer> wafer, const SiteBatch& sites, const std::string& layer1,
+                         const std::string& layer2, Eigen::ArrayXd& overlay_x, Eigen::ArrayXd& overlay_y,
+                         Eigen::ArrayXd& peak);
     double addMeasurementNoise(double true_value, double noise_level);
-    double interpolateGridValue(const Eigen::ArrayXXd& grid, double x, double y);
+    // n standard normal draws from rng_
+    Eigen::ArrayXd drawStandardNormals(Eigen::Index n);
+    // Bilinear at grid coordinates, cell centers at whole numbers plus a half
+    double interpolateGridValue(const Eigen::Ref<const Eigen::ArrayXXd>& grid, double x, double y);
     std::pair<double, double> convertToGridCoordinates(
         std::shared_ptr<Wafer> wafer, double x, double y
     );
+    // Width of the line (or space) along row nearest position; false when
+    // the row holds none
+    static bool featureWidth(const EdgeMap& edges, int row, double position, bool line, double& width);
+    // Total film stack, or the named layer's thickness
+    static double stackThickness(const Wafer& wafer, const std::string& layer_material);
+    // Film layers top first, in nm
+    static std::vector<OpticalLayer> opticalStack(const Wafer& wafer);
+    // Index of axis name in library; throws std::invalid_argument if absent
+    static std::size_t libraryAxis(const OpticalLibrary& library, const std::string& name);
     
     // Instrument-specific measurement functions
     double simulateOpticalThickness(
@@ -0,0 +1,337 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "optical_library.hpp"
+#include "../../core/checkpoint_io.hpp"
+#include "../../core/task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+constexpr std::uint32_t kOpticalLibraryTag = checkpointTag('O', 'L', 'I', 'B');
+constexpr Eigen::Index kGenerateBatch = 4096; // Spectra computed per write
+constexpr Eigen::Index kScanChunk = 1024;     // Entries per nearest() task
+
+using Complex = std::complex<double>;
+
+} // namespace
+
+OpticalIndex materialIndex(const std::string& material) {
+    // Near 633 nm
+    static const std::unordered_map<std::string, OpticalIndex> indices = {
+        {"air", {1.0, 0.0}},
+        {"Si", {3.88, 0.02}},
+        {"silicon", {3.88, 0.02}},
+        {"poly", {3.88, 0.02}},
+        {"SiO2", {1.46, 0.0}},
+        {"oxide", {1.46, 0.0}},
+        {"Si3N4", {2.02, 0.0}},
+        {"nitride", {2.02, 0.0}},
+        {"photoresist", {1.6, 0.0}},
+        {"resist", {1.6, 0.0}},
+        {"Al", {1.2, 7.26}},
+        {"Cu", {0.27, 3.41}},
+        {"W", {3.65, 2.9}},
+    };
+    auto it = indices.find(material);
+    return it != indices.end() ? it->second : OpticalIndex(1.5, 0.0);
+}
+
+std::pair<std::complex<double>, std::complex<double>> stackReflection(
+    const std::vector<OpticalLayer>& layers, OpticalIndex substrate, double wavelength, double angle) {
+    // Thin-film optics writes indices n - ik; the phase thickness of a
+    // layer and its tilted admittance follow from Snell's law in each
+    const double s0 = std::sin(angle);
+    const auto cosine = [s0](Complex n) { return std::sqrt(1.0 - (s0 / n) * (s0 / n)); };
+    const auto reflect = [&](bool p_polarized) {
+        const auto admittance = [&](Complex n) { return p_polarized ? n / cosine(n) : n * cosine(n); };
+        // [B, C] = M_1 ... M_L [1, eta_substrate], applied from the bottom up
+        Complex b = 1.0, c = admittance(std::conj(substrate));
+        for (auto layer = layers.rbegin(); layer != layers.rend(); ++layer) {
+            const Complex n = std::conj(layer->index);
+            const Complex eta = admittance(n);
+            const Complex delta = 2.0 * M_PI * n * layer->thickness * cosine(n) / wavelength;
+            const Complex cos_d = std::cos(delta), sin_d = std::sin(delta);
+            const Complex i(0.0, 1.0);
+            const Complex next_b = cos_d * b + i * sin_d / eta * c;
+            c = i * eta * sin_d * b + cos_d * c;
+            b = next_b;
+        }
+        const Complex eta0 = admittance(1.0);
+        return (eta0 * b - c) / (eta0 * b + c);
+    };
+    return {reflect(false), reflect(true)};
+}
+
+Eigen::ArrayXd gratingSpectrum(const GratingProfile& profile, OpticalIndex substrate,
+                               const Eigen::ArrayXd& wavelengths) {
+    const double fill = profile.pitch > 0.0 ? std::clamp(profile.cd / profile.pitch, 0.0, 1.0) : 1.0;
+    const Complex line = profile.line * profile.line, space = profile.space * profile.space;
+    const Complex te = std::sqrt(fill * line + (1.0 - fill) * space);
+    const Complex tm = std::sqrt(1.0 / (fill / line + (1.0 - fill) / space));
+
+    const Eigen::Index n = wavelengths.size();
+    Eigen::ArrayXd spectrum(2 * n);
+    for (Eigen::Index k = 0; k < n; ++k) {
+        spectrum(k) = std::norm(stackReflection({{te, profile.height}}, substrate, wavelengths(k), 0.0).first);
+        spectrum(n + k) = std::norm(stackReflection({{tm, profile.height}}, substrate, wavelengths(k), 0.0).first);
+    }
+    return spectrum;
+}
+
+Eigen::ArrayXd ellipsometrySpectrum(const std::vector<OpticalLayer>& layers, OpticalIndex substrate,
+                                    const Eigen::ArrayXd& wavelengths, double angle) {
+    const Eigen::Index n = wavelengths.size();
+    Eigen::ArrayXd spectrum(3 * n);
+    for (Eigen::Index k = 0; k < n; ++k) {
+        const auto r = stackReflection(layers, substrate, wavelengths(k), angle);
+        const Complex rho = r.second / r.first;
+        const double psi = std::atan(std::abs(rho)), delta = std::arg(rho);
+        spectrum(k) = std::cos(2.0 * psi);
+        spectrum(n + k) = std::sin(2.0 * psi) * std::cos(delta);
+        spectrum(2 * n + k) = std::sin(2.0 * psi) * std::sin(delta);
+    }
+    return spectrum;
+}
+
+void OpticalLibrary::generate(const std::string& path, const std::vector<Axis>& axes,
+                              const Eigen::ArrayXd& wavelengths, const Model& model) {
+    if (axes.empty()) {
+        throw std::invalid_argument("Optical library needs at least one axis");
+    }
+    Eigen::Index entries = 1;
+    for (const Axis& axis : axes) {
+        if (axis.points < 1) {
+            throw std::invalid_argument("Optical library axis " + axis.name + " has no points");
+        }
+        entries *= axis.points;
+    }
+    if (entries > std::numeric_limits<int>::max()) {
+        throw std::invalid_argument("Optical library grid is too large");
+    }
+    const auto parametersOf = [&axes](Eigen::Index entry) {
+        std::vector<double> params(axes.size());
+        for (std::size_t a = 0; a < axes.size(); ++a) {
+            params[a] = axes[a].value(static_cast<int>(entry % axes[a].points));
+            entry /= axes[a].points;
+        }
+        return params;
+    };
+
+    const Eigen::ArrayXd first = model(parametersOf(0));
+    const Eigen::Index length = first.size();
+    if (length == 0) {
+        throw std::invalid_argument("Optical library spectra are empty");
+    }
+
+    // Page-aligned blocks, so a reader maps the spectra in lazily
+    CheckpointWriter writer(path, CheckpointWriter::pageAlignment());
+    writer.beginChunk(kOpticalLibraryTag);
+    writer.write(static_cast<std::uint32_t>(axes.size()));
+    for (const Axis& axis : axes) {
+        writer.writeString(axis.name);
+        writer.write(axis.min);
+        writer.write(axis.max);
+        writer.write(static_cast<std::uint32_t>(axis.points));
+    }
+    writer.writeBlock(Eigen::Map<const Eigen::ArrayXXd>(wavelengths.data(), wavelengths.size(), 1));
+
+    writer.beginBlock(static_cast<int>(length), static_cast<int>(entries));
+    Eigen::ArrayXXd batch(length, std::min(entries, kGenerateBatch));
+    for (Eigen::Index start = 0; start < entries; start += kGenerateBatch) {
+        const Eigen::Index count = std::min(kGenerateBatch, entries - start);
+        TaskScheduler::getInstance().parallelFor(0, static_cast<int>(count), [&](int begin, int end) {
+            for (int k = begin; k < end; ++k) {
+                const Eigen::ArrayXd spectrum = start + k == 0 ? first : model(parametersOf(start + k));
+                if (spectrum.size() != length) {
+                    throw std::invalid_argument("Optical library spectra differ in length");
+                }
+                batch.col(k) = spectrum;
+            }
+        }, 16);
+        writer.writeBytes(batch.data(), static_cast<std::size_t>(count * length) * sizeof(double));
+    }
+    writer.endChunk();
+    writer.finish();
+}
+
+OpticalLibrary::OpticalLibrary(const std::string& path) {
+    CheckpointReader reader(path);
+    for (const auto& chunk : reader.chunks()) {
+        if (chunk.tag != kOpticalLibraryTag) {
+            continue;
+        }
+        auto cursor = reader.cursor(chunk);
+        const std::uint32_t count = cursor.read<std::uint32_t>();
+        Eigen::Index entries = 1;
+        for (std::uint32_t a = 0; a < count; ++a) {
+            Axis axis;
+            axis.name = cursor.readString();
+            axis.min = cursor.read<double>();
+            axis.max = cursor.read<double>();
+            axis.points = static_cast<int>(cursor.read<std::uint32_t>());
+            entries *= axis.points;
+            axes_.push_back(axis);
+        }
+        wavelengths_ = cursor.readBlock().col(0);
+        const ConstFieldView spectra = cursor.readBlock();
+        if (axes_.empty() || spectra.cols() != entries || spectra.rows() == 0) {
+            throw std::runtime_error("Corrupt optical library: " + path);
+        }
+        spectra_ = spectra.data();
+        length_ = spectra.rows();
+        entries_ = spectra.cols();
+        mapping_ = reader.mapping();
+        return;
+    }
+    throw std::runtime_error("No optical library in " + path);
+}
+
+std::vector<double> OpticalLibrary::parameters(Eigen::Index entry) const {
+    std::vector<double> params(axes_.size());
+    for (std::size_t a = 0; a < axes_.size(); ++a) {
+        params[a] = axes_[a].value(static_cast<int>(entry % axes_[a].points));
+        entry /= axes_[a].points;
+    }
+    return params;
+}
+
+void OpticalLibrary::checkLength(const Eigen::Ref<const Eigen::ArrayXd>& measured) const {
+    if (measured.size() != length_) {
+        throw std::invalid_argument("Measured spectrum does not match the library's length");
+    }
+    if (!measured.allFinite()) {
+        throw std::invalid_argument("Measured spectrum is not finite");
+    }
+}
+
+OpticalLibrary::Match OpticalLibrary::nearest(const Eigen::Ref<const Eigen::ArrayXd>& measured) const {
+    checkLength(measured);
+    const Eigen::Index chunks = (entries_ + kScanChunk - 1) / kScanChunk;
+    std::vector<std::pair<double, Eigen::Index>> best(chunks, {std::numeric_limits<double>::infinity(), 0});
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(chunks), [&](int begin, int end) {
+        for (int c = begin; c < end; ++c) {
+            const Eigen::Index last = std::min(entries_, (c + 1) * kScanChunk);
+            for (Eigen::Index entry = c * kScanChunk; entry < last; ++entry) {
+                const double distance = (spectrum(entry) - measured).square().sum();
+                if (distance < best[c].first) {
+                    best[c] = {distance, entry};
+                }
+            }
+        }
+    }, 1);
+
+    // Chunks in entry order, so the first of equals wins
+    std::pair<double, Eigen::Index> winner = best[0];
+    for (const auto& candidate : best) {
+        if (candidate.first < winner.first) {
+            winner = candidate;
+        }
+    }
+    return {parameters(winner.second), std::sqrt(winner.first / length_), static_cast<int>(winner.second)};
+}
+
+Eigen::ArrayXd OpticalLibrary::interpolate(const std::vector<double>& params) const {
+    if (params.size() != axes_.size()) {
+        throw std::invalid_argument("Optical library takes one parameter per axis");
+    }
+    // Lower corner and fraction along each axis; single-point axes stay put
+    const std::size_t dims = axes_.size();
+    std::vector<Eigen::Index> lower(dims), stride(dims);
+    std::vector<double> fraction(dims, 0.0);
+    Eigen::Index step = 1;
+    for (std::size_t a = 0; a < dims; ++a) {
+        const Axis& axis = axes_[a];
+        stride[a] = step;
+        step *= axis.points;
+        lower[a] = 0;
+        if (axis.points > 1) {
+            const double u = std::clamp((params[a] - axis.min) / (axis.max - axis.min) * (axis.points - 1), 0.0,
+                                        static_cast<double>(axis.points - 1));
+            lower[a] = std::min(static_cast<Eigen::Index>(u), static_cast<Eigen::Index>(axis.points - 2));
+            fraction[a] = u - lower[a];
+        }
+    }
+
+    Eigen::ArrayXd result = Eigen::ArrayXd::Zero(length_);
+    for (std::size_t corner = 0; corner < (std::size_t{1} << dims); ++corner) {
+        double weight = 1.0;
+        Eigen::Index entry = 0;
+        for (std::size_t a = 0; a < dims && weight > 0.0; ++a) {
+            const bool upper = (corner >> a) & 1;
+            weight *= upper ? fraction[a] : 1.0 - fraction[a];
+            entry += (lower[a] + (upper ? 1 : 0)) * stride[a];
+        }
+        if (weight > 0.0) {
+            result += weight * spectrum(entry);
+        }
+    }
+    return result;
+}
+
+OpticalLibrary::Match OpticalLibrary::refine(const Eigen::Ref<const Eigen::ArrayXd>& measured, const Match& start,
+                                             int iterations) const {
+    checkLength(measured);
+    if (start.params.size() != axes_.size()) {
+        throw std::invalid_argument("Optical library takes one parameter per axis");
+    }
+    std::vector<std::size_t> free;
+    for (std::size_t a = 0; a < axes_.size(); ++a) {
+        if (axes_[a].points > 1) {
+            free.push_back(a);
+        }
+    }
+    const auto clampToGrid = [this](std::size_t a, double v) {
+        return std::clamp(v, std::min(axes_[a].min, axes_[a].max), std::max(axes_[a].min, axes_[a].max));
+    };
+
+    Match best = start;
+    Eigen::ArrayXd fitted = interpolate(best.params);
+    double cost = (fitted - measured).square().sum();
+    for (int iteration = 0; iteration < iterations && !free.empty(); ++iteration) {
+        // Central differences a quarter grid step wide
+        Eigen::MatrixXd jacobian(length_, free.size());
+        for (std::size_t f = 0; f < free.size(); ++f) {
+            const std::size_t a = free[f];
+            const double h = 0.25 * (axes_[a].max - axes_[a].min) / (axes_[a].points - 1);
+            std::vector<double> up = best.params, down = best.params;
+            up[a] = clampToGrid(a, up[a] + h);
+            down[a] = clampToGrid(a, down[a] - h);
+            jacobian.col(f).setZero();
+            if (up[a] != down[a]) {
+                jacobian.col(f) = ((interpolate(up) - interpolate(down)) / (up[a] - down[a])).matrix();
+            }
+        }
+        const Eigen::VectorXd step = jacobian.completeOrthogonalDecomposition().solve((measured - fitted).matrix());
+
+        // Halve the step until it helps
+        bool improved = false;
+        for (double scale = 1.0; scale >= 1.0 / 16.0 && !improved; scale /= 2.0) {
+            std::vector<double> trial = best.params;
+            for (std::size_t f = 0; f < free.size(); ++f) {
+                trial[free[f]] = clampToGrid(free[f], trial[free[f]] + scale * step(f));
+            }
+            Eigen::ArrayXd trial_fit = interpolate(trial);
+            const double trial_cost = (trial_fit - measured).square().sum();
+            if (trial_cost < cost) {
+                improved = true;
+                best.params = trial;
+                fitted = std::move(trial_fit);
+                cost = trial_cost;
+            }
+        }
+        if (!improved) {
+            break;
+        }
+    }
+    best.residual = std::sqrt(cost / length_);
+    return best;
+}
+
+OpticalLibrary::Match OpticalLibrary::match(const Eigen::Ref<const Eigen::ArrayXd>& measured, bool refined) const {
+    const Match start = nearest(measured);
+    return refined ? refine(measured, start) : start;
+}
@@ -0,0 +1,119 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef OPTICAL_LIBRARY_HPP
+#define OPTICAL_LIBRARY_HPP
+
+#include <Eigen/Dense>
+#include <complex>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Complex refractive index n + ik, taken as constant over the visible
+using OpticalIndex = std::complex<double>;
+
+// Index of a named material ("Si", "SiO2", "Si3N4", "photoresist", ...);
+// unknown materials get a generic dielectric's 1.5
+OpticalIndex materialIndex(const std::string& material);
+
+struct OpticalLayer {
+    OpticalIndex index;
+    double thickness; // nm
+};
+
+// Amplitude reflection coefficients (rs, rp) of layers (top first) on a
+// substrate, lit from air at angle (rad) from the normal, by the
+// characteristic matrix of each layer
+std::pair<std::complex<double>, std::complex<double>> stackReflection(
+    const std::vector<OpticalLayer>& layers, OpticalIndex substrate, double wavelength, double angle);
+
+// Lines of one material at pitch, spaces of another, height tall on a
+// substrate
+struct GratingProfile {
+    double cd;     // nm
+    double height; // nm
+    double pitch;  // nm
+    OpticalIndex line = OpticalIndex(1.6, 0.0);
+    OpticalIndex space = OpticalIndex(1.0, 0.0);
+};
+
+// Normal-incidence reflectance of the grating with the field along the
+// lines (TE) at every wavelength, then across them (TM). Pitches well
+// under the wavelength diffract nothing but the zeroth order, so the
+// grating acts as a uniaxial film of the zeroth-order effective medium
+// indices; the TE/TM split carries the CD, the fringes the height.
+Eigen::ArrayXd gratingSpectrum(const GratingProfile& profile, OpticalIndex substrate,
+                               const Eigen::ArrayXd& wavelengths);
+
+// What a rotating-compensator ellipsometer reads off the stack, with
+// rp / rs = tan(psi) exp(i delta): N = cos 2psi at every wavelength, then
+// C = sin 2psi cos delta, then S = sin 2psi sin delta. Unlike delta these
+// do not wrap, so they interpolate smoothly between library entries.
+Eigen::ArrayXd ellipsometrySpectrum(const std::vector<OpticalLayer>& layers, OpticalIndex substrate,
+                                    const Eigen::ArrayXd& wavelengths, double angle);
+
+// Spectra precomputed over a regular grid of model parameters and kept in
+// a memory-mapped checkpoint file, so a measurement is matched by a scan
+// of the library instead of by solving the optics. generate() evaluates
+// the grid in parallel and streams it to disk a batch at a time; a
+// library opened on the file pages in only the spectra a match reads.
+class OpticalLibrary {
+public:
+    struct Axis {
+        std::string name;
+        double min;
+        double max;
+        int points; // 1 fixes the parameter at min
+
+        double value(int i) const { return points > 1 ? min + (max - min) * i / (points - 1) : min; }
+    };
+
+    // Spectrum at one parameter value per axis
+    using Model = std::function<Eigen::ArrayXd(const std::vector<double>& params)>;
+
+    struct Match {
+        std::vector<double> params;
+        double residual; // RMS difference from the measured spectrum
+        int entry;       // Nearest library entry
+    };
+
+    // Entries enumerate the axes with the first varying fastest. Throws
+    // std::invalid_argument for an axis without points or spectra of
+    // differing lengths, std::runtime_error if the file cannot be written.
+    static void generate(const std::string& path, const std::vector<Axis>& axes,
+                         const Eigen::ArrayXd& wavelengths, const Model& model);
+
+    // Throws std::runtime_error if path holds no library
+    explicit OpticalLibrary(const std::string& path);
+
+    const std::vector<Axis>& axes() const { return axes_; }
+    const Eigen::ArrayXd& wavelengths() const { return wavelengths_; }
+    Eigen::Index entries() const { return entries_; }
+    Eigen::Index spectrumLength() const { return length_; }
+    std::vector<double> parameters(Eigen::Index entry) const;
+    Eigen::Map<const Eigen::ArrayXd> spectrum(Eigen::Index entry) const {
+        return Eigen::Map<const Eigen::ArrayXd>(spectra_ + entry * length_, length_);
+    }
+
+    // Entry closest in RMS, scanned in parallel; ties go to the lowest entry
+    Match nearest(const Eigen::Ref<const Eigen::ArrayXd>& measured) const;
+    // Multilinear interpolation between entries, parameters clamped to the grid
+    Eigen::ArrayXd interpolate(const std::vector<double>& params) const;
+    // Gauss-Newton on the interpolated spectra from start, within the grid
+    Match refine(const Eigen::Ref<const Eigen::ArrayXd>& measured, const Match& start, int iterations = 10) const;
+    // nearest(), then refine() unless told otherwise
+    Match match(const Eigen::Ref<const Eigen::ArrayXd>& measured, bool refined = true) const;
+
+private:
+    void checkLength(const Eigen::Ref<const Eigen::ArrayXd>& measured) const;
+
+    std::shared_ptr<const void> mapping_;
+    std::vector<Axis> axes_;
+    Eigen::ArrayXd wavelengths_;
+    const double* spectra_ = nullptr;
+    Eigen::Index length_ = 0;
+    Eigen::Index entries_ = 0;
+};
+
+#endif // OPTICAL_LIBRARY_HPP
@@ -0,0 +1,180 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "spc_engine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+void RunningMoments::add(double x) {
+    ++count;
+    const double delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+}
+
+void RunningMoments::merge(const RunningMoments& other) {
+    if (other.count == 0) {
+        return;
+    }
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    const double total = static_cast<double>(count + other.count);
+    const double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * static_cast<double>(count) * other.count / total;
+    count += other.count;
+}
+
+double RunningMoments::stddev() const {
+    return std::sqrt(variance());
+}
+
+SpcChart::SpcChart(const SpcSettings& settings) : settings_(settings), ewma_(settings.center) {}
+
+unsigned SpcChart::add(double x) {
+    const double z = (x - settings_.center) / settings_.sigma;
+    recent_[points_ % recent_.size()] = z;
+    ++points_;
+
+    // Zone rules: of the last window values, at least needed beyond limit
+    // on the side of this one, which must be among them
+    const double side = z >= 0.0 ? 1.0 : -1.0;
+    const auto zone = [&](std::int64_t window, double limit, std::int64_t needed) {
+        if (z * side <= limit) {
+            return false;
+        }
+        std::int64_t beyond = 0;
+        for (std::int64_t k = 0; k < std::min(window, points_); ++k) {
+            beyond += recent_[(points_ - 1 - k) % recent_.size()] * side > limit;
+        }
+        return beyond >= needed;
+    };
+    unsigned signals = SPC_IN_CONTROL;
+    if (std::abs(z) > 3.0) signals |= SPC_BEYOND_3_SIGMA;
+    if (zone(3, 2.0, 2)) signals |= SPC_2_OF_3_BEYOND_2_SIGMA;
+    if (zone(5, 1.0, 4)) signals |= SPC_4_OF_5_BEYOND_1_SIGMA;
+    if (zone(8, 0.0, 8)) signals |= SPC_8_ON_ONE_SIDE;
+
+    // EWMA against its exact (not asymptotic) limits
+    const double lambda = settings_.ewma_lambda;
+    ewma_ = lambda * x + (1.0 - lambda) * ewma_;
+    ewma_decay_ *= (1.0 - lambda) * (1.0 - lambda);
+    const double ewma_limit =
+        settings_.ewma_width * settings_.sigma * std::sqrt(lambda / (2.0 - lambda) * (1.0 - ewma_decay_));
+    if (std::abs(ewma_ - settings_.center) > ewma_limit) signals |= SPC_EWMA;
+
+    cusum_high_ = std::max(0.0, cusum_high_ + z - settings_.cusum_k);
+    cusum_low_ = std::max(0.0, cusum_low_ - z - settings_.cusum_k);
+    if (cusum_high_ > settings_.cusum_h) {
+        signals |= SPC_CUSUM;
+        cusum_high_ = 0.0;
+    }
+    if (cusum_low_ > settings_.cusum_h) {
+        signals |= SPC_CUSUM;
+        cusum_low_ = 0.0;
+    }
+
+    for (std::size_t bit = 0; bit < signal_counts_.size(); ++bit) {
+        signal_counts_[bit] += (signals >> bit) & 1u;
+    }
+    return signals;
+}
+
+SpcEngine::SpcEngine(int streams) {
+    if (streams < 1) {
+        throw std::invalid_argument("SPC engine needs at least one stream");
+    }
+    streams_.reserve(streams);
+    for (int s = 0; s < streams; ++s) {
+        streams_.push_back(std::make_unique<Stream>());
+    }
+}
+
+SpcEngine::Stream& SpcEngine::stream(int index) const {
+    if (index < 0 || index >= static_cast<int>(streams_.size())) {
+        throw std::out_of_range("Unknown SPC stream " + std::to_string(index));
+    }
+    return *streams_[index];
+}
+
+void SpcEngine::configure(int index, const SpcSettings& settings) {
+    if (!(settings.sigma > 0.0) || !(settings.ewma_lambda > 0.0 && settings.ewma_lambda <= 1.0)) {
+        throw std::invalid_argument("SPC charts need a positive sigma and an EWMA lambda in (0, 1]");
+    }
+    Stream& s = stream(index);
+    std::lock_guard<std::mutex> lock(s.chart_mutex);
+    s.chart = SpcChart(settings);
+    s.configured = true;
+}
+
+bool SpcEngine::configured(int index) const {
+    Stream& s = stream(index);
+    std::lock_guard<std::mutex> lock(s.chart_mutex);
+    return s.configured;
+}
+
+unsigned SpcEngine::add(int index, double value) {
+    return add(index, &value, 1);
+}
+
+unsigned SpcEngine::add(int index, const double* values, std::size_t count) {
+    Stream& s = stream(index);
+    RunningMoments batch;
+    for (std::size_t k = 0; k < count; ++k) {
+        batch.add(values[k]);
+    }
+    {
+        Shard& shard = s.shards[std::hash<std::thread::id>()(std::this_thread::get_id()) % kShards];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.moments.merge(batch);
+    }
+
+    std::lock_guard<std::mutex> lock(s.chart_mutex);
+    unsigned signals = SPC_IN_CONTROL;
+    if (s.configured) {
+        for (std::size_t k = 0; k < count; ++k) {
+            signals |= s.chart.add(values[k]);
+        }
+    }
+    return signals;
+}
+
+RunningMoments SpcEngine::moments(int index) const {
+    const Stream& s = stream(index);
+    RunningMoments total;
+    for (const Shard& shard : s.shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total.merge(shard.moments);
+    }
+    return total;
+}
+
+SpcChart SpcEngine::chart(int index) const {
+    const Stream& s = stream(index);
+    std::lock_guard<std::mutex> lock(s.chart_mutex);
+    return s.chart;
+}
+
+double SpcEngine::cpk(int index) const {
+    const SpcSettings settings = chart(index).settings();
+    const RunningMoments total = moments(index);
+    const double sigma = total.stddev();
+    if (total.count < 2 || !(sigma > 0.0)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return std::min(settings.upper_spec - total.mean, total.mean - settings.lower_spec) / (3.0 * sigma);
+}
+
+void SpcEngine::reset(int index) {
+    Stream& s = stream(index);
+    for (Shard& shard : s.shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.moments = RunningMoments();
+    }
+    std::lock_guard<std::mutex> lock(s.chart_mutex);
+    s.chart = SpcChart(s.chart.settings());
+}
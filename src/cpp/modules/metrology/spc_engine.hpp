@@ -0,0 +1,128 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef SPC_ENGINE_HPP
+#define SPC_ENGINE_HPP
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Count, mean and sum of squared deviations by Welford's update; two sets
+// merge exactly (Chan et al.), so partial moments can be kept apart and
+// combined on demand
+struct RunningMoments {
+    std::int64_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double x);
+    void merge(const RunningMoments& other);
+    // Sample variance, 0 below two values
+    double variance() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+    double stddev() const;
+};
+
+// Signals a chart raises on a value, as bits
+enum SpcSignal : unsigned {
+    SPC_IN_CONTROL = 0,
+    SPC_BEYOND_3_SIGMA = 1u << 0,        // Western Electric rule 1
+    SPC_2_OF_3_BEYOND_2_SIGMA = 1u << 1, // Rule 2, on one side
+    SPC_4_OF_5_BEYOND_1_SIGMA = 1u << 2, // Rule 3, on one side
+    SPC_8_ON_ONE_SIDE = 1u << 3,         // Rule 4
+    SPC_EWMA = 1u << 4,
+    SPC_CUSUM = 1u << 5
+};
+
+struct SpcSettings {
+    double center = 0.0;     // Center line (target)
+    double sigma = 1.0;      // Process sigma the zones and charts scale by
+    double ewma_lambda = 0.2;
+    double ewma_width = 3.0; // Limits at width sigmas of the EWMA statistic
+    double cusum_k = 0.5;    // Allowance, sigmas
+    double cusum_h = 5.0;    // Decision interval, sigmas
+    double lower_spec = -std::numeric_limits<double>::infinity();
+    double upper_spec = std::numeric_limits<double>::infinity();
+};
+
+// Shewhart zone rules, an EWMA and a two-sided tabular CUSUM over one
+// stream of values, updated a value at a time. A CUSUM side restarts from
+// zero once it signals. Not thread-safe; SpcEngine serializes it.
+class SpcChart {
+public:
+    explicit SpcChart(const SpcSettings& settings = SpcSettings());
+
+    // The signals x raises
+    unsigned add(double x);
+
+    const SpcSettings& settings() const { return settings_; }
+    std::int64_t points() const { return points_; }
+    double ewma() const { return ewma_; }
+    double cusumHigh() const { return cusum_high_; }
+    double cusumLow() const { return cusum_low_; }
+    // Values that raised each signal bit, by bit position
+    const std::array<std::int64_t, 6>& signalCounts() const { return signal_counts_; }
+
+private:
+    SpcSettings settings_;
+    std::int64_t points_ = 0;
+    double ewma_;
+    double ewma_decay_ = 1.0; // (1 - lambda)^(2 points)
+    double cusum_high_ = 0.0;
+    double cusum_low_ = 0.0;
+    std::array<double, 8> recent_{}; // Last z scores, ring indexed by points
+    std::array<std::int64_t, 6> signal_counts_{};
+};
+
+// Streaming SPC over a fixed set of streams (one per measurement type,
+// say), fed from any number of threads. Each stream's moments accumulate
+// in shards picked by thread, each under its own lock, so concurrent
+// batches rarely contend; readers merge the shards, so a dashboard
+// refresh costs the shard count, not the history. A stream's chart sees
+// its values in arrival order under the stream's lock, a batch at a time.
+class SpcEngine {
+public:
+    // Throws std::invalid_argument for streams < 1
+    explicit SpcEngine(int streams);
+
+    // Sets the stream's chart and restarts it; the moments are kept.
+    // Throws std::out_of_range for an unknown stream, std::invalid_argument
+    // for sigma <= 0 or lambda outside (0, 1].
+    void configure(int stream, const SpcSettings& settings);
+    bool configured(int stream) const;
+
+    // The signals raised by value, or by any of the batch's values
+    unsigned add(int stream, double value);
+    unsigned add(int stream, const double* values, std::size_t count);
+
+    RunningMoments moments(int stream) const;
+    // Copy of the stream's chart; default settings if never configured
+    SpcChart chart(int stream) const;
+    // min(USL - mean, mean - LSL) / 3 sigma over everything added, from the
+    // configured spec limits; NaN below two values or without variation,
+    // infinite without spec limits
+    double cpk(int stream) const;
+    // Forgets the stream's values; its settings stay
+    void reset(int stream);
+
+private:
+    static constexpr int kShards = 16;
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        RunningMoments moments;
+    };
+    struct Stream {
+        std::array<Shard, kShards> shards;
+        mutable std::mutex chart_mutex;
+        SpcChart chart;
+        bool configured = false;
+    };
+
+    Stream& stream(int index) const;
+
+    std::vector<std::unique_ptr<Stream>> streams_;
+};
+
+#endif // SPC_ENGINE_HPP
@@ -0,0 +1,121 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "coupling_tree.hpp"
+#include "../../core/task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Deep enough for any spread of doubles; coincident sources share a leaf
+constexpr int kMaxDepth = 48;
+
+} // namespace
+
+CouplingTree::CouplingTree(const std::vector<Source>& sources, int leaf_size)
+    : sources_(sources), leaf_size_(std::max(1, leaf_size)) {
+    if (sources_.empty()) {
+        return;
+    }
+    double x0 = sources_[0].x, x1 = x0, y0 = sources_[0].y, y1 = y0;
+    for (const Source& s : sources_) {
+        x0 = std::min(x0, s.x);
+        x1 = std::max(x1, s.x);
+        y0 = std::min(y0, s.y);
+        y1 = std::max(y1, s.y);
+    }
+    const double half = 0.5 * std::max({x1 - x0, y1 - y0, 1e-300});
+    nodes_.reserve(2 * sources_.size() / leaf_size_ + 1);
+    build(0.5 * (x0 + x1), 0.5 * (y0 + y1), half, 0, static_cast<int>(sources_.size()), 0);
+}
+
+int CouplingTree::build(double cx, double cy, double half, int begin, int end, int depth) {
+    const int index = static_cast<int>(nodes_.size());
+    nodes_.emplace_back();
+
+    Node node{};
+    node.cx = cx;
+    node.cy = cy;
+    node.half = half;
+    node.begin = begin;
+    node.end = end;
+    std::fill(std::begin(node.child), std::end(node.child), -1);
+    for (int k = begin; k < end; ++k) {
+        const Source& s = sources_[k];
+        const double ddx = s.x - cx, ddy = s.y - cy, d2 = ddx * ddx + ddy * ddy;
+        node.charge += s.strength;
+        node.softening += s.strength * s.radius * s.radius;
+        node.dx += s.strength * ddx;
+        node.dy += s.strength * ddy;
+        node.qxx += s.strength * (3.0 * ddx * ddx - d2);
+        node.qyy += s.strength * (3.0 * ddy * ddy - d2);
+        node.qxy += s.strength * 3.0 * ddx * ddy;
+        node.reach = std::max(node.reach, std::sqrt(d2) + s.radius);
+    }
+
+    if (end - begin > leaf_size_ && depth < kMaxDepth) {
+        // Quadrants in place: below cy then above, each left of cx then right
+        const auto first = sources_.begin() + begin, last = sources_.begin() + end;
+        const auto above = std::partition(first, last, [cy](const Source& s) { return s.y < cy; });
+        const auto lower_right = std::partition(first, above, [cx](const Source& s) { return s.x < cx; });
+        const auto upper_right = std::partition(above, last, [cx](const Source& s) { return s.x < cx; });
+        const int bounds[5] = {begin, static_cast<int>(lower_right - sources_.begin()),
+                               static_cast<int>(above - sources_.begin()),
+                               static_cast<int>(upper_right - sources_.begin()), end};
+        const double quarter = 0.5 * half;
+        for (int q = 0; q < 4; ++q) {
+            if (bounds[q] < bounds[q + 1]) {
+                node.child[q] = build(cx + (q & 1 ? quarter : -quarter), cy + (q & 2 ? quarter : -quarter), quarter,
+                                      bounds[q], bounds[q + 1], depth + 1);
+            }
+        }
+    }
+    nodes_[index] = node;
+    return index;
+}
+
+double CouplingTree::potential(double x, double y, double theta) const {
+    if (nodes_.empty()) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    int stack[3 * kMaxDepth + 4];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes_[stack[--top]];
+        const double rx = x - node.cx, ry = y - node.cy, r2 = rx * rx + ry * ry;
+        if (node.reach < theta * std::sqrt(r2)) {
+            const double inv = 1.0 / std::sqrt(r2), inv3 = inv * inv * inv, inv5 = inv3 * inv * inv;
+            sum += node.charge * inv + (node.dx * rx + node.dy * ry) * inv3 +
+                   0.5 * (node.qxx * rx * rx + node.qyy * ry * ry + 2.0 * node.qxy * rx * ry) * inv5 -
+                   0.5 * node.softening * inv3;
+            continue;
+        }
+        bool leaf = true;
+        for (int child : node.child) {
+            if (child >= 0) {
+                stack[top++] = child;
+                leaf = false;
+            }
+        }
+        if (leaf) {
+            for (int k = node.begin; k < node.end; ++k) {
+                const Source& s = sources_[k];
+                const double sx = x - s.x, sy = y - s.y;
+                sum += s.strength / std::sqrt(sx * sx + sy * sy + s.radius * s.radius);
+            }
+        }
+    }
+    return sum;
+}
+
+Eigen::VectorXd CouplingTree::potentials(const Eigen::Ref<const Eigen::VectorXd>& x,
+                                         const Eigen::Ref<const Eigen::VectorXd>& y, double theta) const {
+    Eigen::VectorXd result(x.size());
+    TaskScheduler::getInstance().parallelFor(0, static_cast<int>(x.size()), [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            result(k) = potential(x(k), y(k), theta);
+        }
+    }, 256);
+    return result;
+}
@@ -0,0 +1,54 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef COUPLING_TREE_HPP
+#define COUPLING_TREE_HPP
+
+#include <Eigen/Dense>
+#include <vector>
+
+// Barnes-Hut quadtree over point sources in a plane for fields falling off
+// as 1/r: heat spreading into a substrate (dT = P / (2 pi k r)) and the
+// potential of charges alike. Each node keeps its sources' monopole,
+// dipole and quadrupole about its center; a target takes a node's
+// expansion when the node spans less than theta of the distance, and sums
+// the sources directly otherwise, so n targets over n sources cost
+// O(n log n). Sources are softened over their radius so the field stays
+// finite on top of them.
+class CouplingTree {
+public:
+    struct Source {
+        double x, y;
+        double strength;
+        double radius = 0.0; // Softening: strength / sqrt(r^2 + radius^2)
+    };
+
+    explicit CouplingTree(const std::vector<Source>& sources, int leaf_size = 16);
+
+    std::size_t size() const { return sources_.size(); }
+
+    // Sum of the sources' strength / sqrt(r^2 + radius^2) at (x, y)
+    double potential(double x, double y, double theta = 0.5) const;
+    // The same at every target, in parallel
+    Eigen::VectorXd potentials(const Eigen::Ref<const Eigen::VectorXd>& x, const Eigen::Ref<const Eigen::VectorXd>& y,
+                               double theta = 0.5) const;
+
+private:
+    struct Node {
+        double cx, cy;        // Center of the cell
+        double half;          // Half its side
+        double reach;         // Farthest a source's softened extent lies from the center
+        double charge;        // Monopole
+        double softening;     // Sum of strength * radius^2
+        double dx, dy;        // Dipole
+        double qxx, qyy, qxy; // Quadrupole, traceless
+        int begin, end;       // Sources
+        int child[4];         // -1 for none
+    };
+
+    int build(double cx, double cy, double half, int begin, int end, int depth);
+
+    std::vector<Source> sources_;
+    std::vector<Node> nodes_;
+    int leaf_size_;
+};
+
+#endif // COUPLING_TREE_HPP
@@ -0,0 +1,237 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "interconnect_router.hpp"
+#include "../../core/task_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Side in cells of the bins windows are checked for overlap in
+constexpr int kWaveBin = 16;
+
+struct HeapEntry {
+    double f; // Cost so far plus the Manhattan distance left
+    double g; // Cost so far
+    int cell;
+};
+
+// Min-heap on f; of equal f, the entry further along first, so A* runs
+// down one of the many equal-cost grid paths instead of widening over all
+bool later(const HeapEntry& a, const HeapEntry& b) {
+    return a.f > b.f || (a.f == b.f && a.g < b.g);
+}
+
+} // namespace
+
+struct InterconnectRouter::Workspace {
+    std::vector<double> cost;
+    std::vector<int> parent;
+    std::vector<unsigned> stamp; // cost and parent hold for cells stamped this search
+    unsigned epoch = 0;
+    std::vector<HeapEntry> heap;
+};
+
+InterconnectRouter::InterconnectRouter(int cols, int rows, int capacity)
+    : cols_(cols), rows_(rows), capacity_(capacity) {
+    if (cols < 1 || rows < 1) {
+        throw std::invalid_argument("Routing grid must have at least one cell");
+    }
+    if (capacity < 1) {
+        throw std::invalid_argument("Routing cells must hold at least one track");
+    }
+}
+
+InterconnectRouter::Window InterconnectRouter::window(const Net& net, const NegotiationOptions& options) const {
+    const int sx = net.source % cols_, sy = net.source / cols_;
+    const int tx = net.target % cols_, ty = net.target / cols_;
+    const int margin = std::max(0, options.window_margin) + std::max(std::abs(tx - sx), std::abs(ty - sy)) / 4;
+    return {std::max(0, std::min(sx, tx) - margin), std::max(0, std::min(sy, ty) - margin),
+            std::min(cols_ - 1, std::max(sx, tx) + margin), std::min(rows_ - 1, std::max(sy, ty) + margin)};
+}
+
+void InterconnectRouter::search(const Net& net, const Window& window, const std::vector<int>& occupancy,
+                                const std::vector<double>& history, double present, Workspace& workspace,
+                                std::vector<int>& path) const {
+    const int cells = cols_ * rows_;
+    if (workspace.stamp.empty()) {
+        workspace.cost.resize(cells);
+        workspace.parent.resize(cells);
+        workspace.stamp.assign(cells, 0);
+    }
+    if (++workspace.epoch == 0) {
+        std::fill(workspace.stamp.begin(), workspace.stamp.end(), 0);
+        workspace.epoch = 1;
+    }
+    const unsigned epoch = workspace.epoch;
+    const int tx = net.target % cols_, ty = net.target / cols_;
+    const auto remaining = [&](int cell) {
+        return static_cast<double>(std::abs(cell % cols_ - tx) + std::abs(cell / cols_ - ty));
+    };
+
+    auto& heap = workspace.heap;
+    heap.clear();
+    workspace.cost[net.source] = 0.0;
+    workspace.parent[net.source] = -1;
+    workspace.stamp[net.source] = epoch;
+    heap.push_back({remaining(net.source), 0.0, net.source});
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        const HeapEntry top = heap.back();
+        heap.pop_back();
+        if (top.cell == net.target) {
+            break;
+        }
+        if (top.g > workspace.cost[top.cell]) {
+            continue; // Superseded
+        }
+        const int x = top.cell % cols_, y = top.cell / cols_;
+        const int neighbours[4] = {x > window.col0 ? top.cell - 1 : -1, x < window.col1 ? top.cell + 1 : -1,
+                                   y > window.row0 ? top.cell - cols_ : -1, y < window.row1 ? top.cell + cols_ : -1};
+        for (int next : neighbours) {
+            if (next < 0) {
+                continue;
+            }
+            double step = 1.0;
+            if (next != net.target) {
+                const int overuse = occupancy[next] + 1 - capacity_;
+                step = (1.0 + history[next]) * (1.0 + present * std::max(0, overuse));
+            }
+            const double g = top.g + step;
+            if (workspace.stamp[next] == epoch && workspace.cost[next] <= g) {
+                continue;
+            }
+            workspace.stamp[next] = epoch;
+            workspace.cost[next] = g;
+            workspace.parent[next] = top.cell;
+            heap.push_back({g + remaining(next), g, next});
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+    }
+
+    path.clear();
+    for (int cell = net.target; cell >= 0; cell = workspace.parent[cell]) {
+        path.push_back(cell);
+    }
+    std::reverse(path.begin(), path.end());
+}
+
+InterconnectRouter::Result InterconnectRouter::route(const std::vector<Net>& nets, const NegotiationOptions& options) const {
+    const int cells = cols_ * rows_;
+    for (const Net& net : nets) {
+        if (net.source < 0 || net.source >= cells || net.target < 0 || net.target >= cells) {
+            throw std::out_of_range("Net end outside the " + std::to_string(cols_) + " x " +
+                                    std::to_string(rows_) + " routing grid");
+        }
+    }
+
+    Result result;
+    result.paths.resize(nets.size());
+    std::vector<Window> windows(nets.size());
+    for (std::size_t i = 0; i < nets.size(); ++i) {
+        windows[i] = window(nets[i], options);
+    }
+    std::vector<int> occupancy(cells, 0);
+    std::vector<double> history(cells, 0.0);
+    // Tracks a path takes: every cell but its pins
+    const auto claim = [&occupancy](const std::vector<int>& path, int delta) {
+        for (std::size_t k = 1; k + 1 < path.size(); ++k) {
+            occupancy[path[k]] += delta;
+        }
+    };
+
+    auto& scheduler = TaskScheduler::getInstance();
+    const int chunks = std::max(1, std::min(static_cast<int>(nets.size()), 4 * scheduler.threadCount()));
+    std::vector<Workspace> workspaces(chunks);
+
+    const int bin_cols = (cols_ + kWaveBin - 1) / kWaveBin, bin_rows = (rows_ + kWaveBin - 1) / kWaveBin;
+    std::vector<int> last_wave(static_cast<std::size_t>(bin_cols) * bin_rows);
+    std::vector<std::vector<int>> waves;
+    std::vector<int> pending(nets.size());
+    for (std::size_t i = 0; i < nets.size(); ++i) {
+        pending[i] = static_cast<int>(i);
+    }
+    std::vector<char> overused(cells, 0);
+    double present = options.present_factor;
+    while (!pending.empty() && result.iterations < std::max(1, options.max_iterations)) {
+        ++result.iterations;
+
+        // Each net goes in the wave after the last one holding an earlier
+        // net whose window shares a bin with its own
+        std::fill(last_wave.begin(), last_wave.end(), -1);
+        for (auto& wave : waves) {
+            wave.clear();
+        }
+        for (int net : pending) {
+            const Window& w = windows[net];
+            int wave = 0;
+            for (int by = w.row0 / kWaveBin; by <= w.row1 / kWaveBin; ++by) {
+                for (int bx = w.col0 / kWaveBin; bx <= w.col1 / kWaveBin; ++bx) {
+                    wave = std::max(wave, last_wave[by * bin_cols + bx] + 1);
+                }
+            }
+            for (int by = w.row0 / kWaveBin; by <= w.row1 / kWaveBin; ++by) {
+                for (int bx = w.col0 / kWaveBin; bx <= w.col1 / kWaveBin; ++bx) {
+                    last_wave[by * bin_cols + bx] = wave;
+                }
+            }
+            if (wave >= static_cast<int>(waves.size())) {
+                waves.resize(wave + 1);
+            }
+            waves[wave].push_back(net);
+        }
+
+        for (const auto& wave : waves) {
+            const int count = static_cast<int>(wave.size());
+            const int used = std::min(chunks, count);
+            if (used == 0) {
+                break;
+            }
+            scheduler.parallelFor(0, used, [&](int begin, int end) {
+                for (int chunk = begin; chunk < end; ++chunk) {
+                    const int first = static_cast<int>(static_cast<long long>(count) * chunk / used);
+                    const int last = static_cast<int>(static_cast<long long>(count) * (chunk + 1) / used);
+                    for (int k = first; k < last; ++k) {
+                        std::vector<int>& path = result.paths[wave[k]];
+                        claim(path, -1);
+                        search(nets[wave[k]], windows[wave[k]], occupancy, history, present, workspaces[chunk], path);
+                        claim(path, +1);
+                    }
+                }
+            }, 1);
+        }
+
+        // Negotiate: overused cells grow dearer for good, and the nets
+        // through them go round again
+        bool any = false;
+        for (int cell = 0; cell < cells; ++cell) {
+            const int overuse = occupancy[cell] - capacity_;
+            overused[cell] = overuse > 0;
+            if (overuse > 0) {
+                history[cell] += options.history_factor * overuse;
+                any = true;
+            }
+        }
+        pending.clear();
+        if (!any) {
+            break;
+        }
+        for (std::size_t i = 0; i < nets.size(); ++i) {
+            const std::vector<int>& path = result.paths[i];
+            for (std::size_t k = 1; k + 1 < path.size(); ++k) {
+                if (overused[path[k]]) {
+                    pending.push_back(static_cast<int>(i));
+                    break;
+                }
+            }
+        }
+        present *= options.present_growth;
+    }
+
+    for (int cell = 0; cell < cells; ++cell) {
+        result.overflow += std::max(0, occupancy[cell] - capacity_);
+    }
+    return result;
+}
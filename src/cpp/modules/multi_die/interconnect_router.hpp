@@ -0,0 +1,70 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef INTERCONNECT_ROUTER_HPP
+#define INTERCONNECT_ROUTER_HPP
+
+#include <vector>
+
+// How InterconnectRouter prices congestion from one rip-up to the next
+struct NegotiationOptions {
+    int max_iterations = 50;
+    double present_factor = 0.5; // Cost per track of overuse in the first rip-up
+    double present_growth = 1.5; // Its factor per iteration after
+    double history_factor = 0.2; // Cost added per track of overuse per iteration
+    // A net searches the box around its pins grown by this many cells plus
+    // a quarter of the box's span
+    int window_margin = 8;
+};
+
+// Negotiated-congestion (PathFinder) router over a grid of routing cells,
+// each holding a number of tracks. Every net is routed by A* at a cost that
+// grows with the cell's present overuse and its overuse history, then the
+// nets over overused cells are ripped up and rerouted until none are left
+// or the iterations run out. Each net searches a window about its pins;
+// the nets are dealt, in order, into waves of disjoint windows, and a
+// wave's nets route in parallel on the shared occupancy map without locks,
+// as no two touch the same cell. Nets later in the order see the tracks
+// the earlier ones claimed, as in serial PathFinder, so the routing is the
+// same on any number of threads.
+class InterconnectRouter {
+public:
+    // Cells are indexed row * cols + col
+    struct Net {
+        int source;
+        int target;
+    };
+
+    struct Result {
+        std::vector<std::vector<int>> paths; // Cells source to target, per net
+        int iterations = 0;
+        long long overflow = 0; // Tracks used past capacity, summed over cells
+    };
+
+    // Throws std::invalid_argument for an empty grid or capacity < 1
+    InterconnectRouter(int cols, int rows, int capacity);
+
+    int cols() const { return cols_; }
+    int rows() const { return rows_; }
+
+    // Pins (net ends) take no track: they are vias down to the bumps. Throws
+    // std::out_of_range for a net end off the grid.
+    Result route(const std::vector<Net>& nets, const NegotiationOptions& options = NegotiationOptions()) const;
+
+private:
+    struct Workspace;
+    struct Window {
+        int col0, row0, col1, row1; // Inclusive
+    };
+
+    Window window(const Net& net, const NegotiationOptions& options) const;
+
+    // Cheapest path of net under the current costs into path
+    void search(const Net& net, const Window& window, const std::vector<int>& occupancy,
+                const std::vector<double>& history, double present, Workspace& workspace,
+                std::vector<int>& path) const;
+
+    int cols_;
+    int rows_;
+    int capacity_;
+};
+
+#endif // INTERCONNECT_ROUTER_HPP
@@ -15,52 +15,80 @@ MultiDieModel::MultiDieModel() {
 
 void MultiDieModel::addDie(const Die& die) {
     // Check for duplicate IDs
-    auto it = std::find_if(dies_.begin(), dies_.end(),
-                          [&die](const Die& d) { return d.id == die.id; });
-    if (it != dies_.end()) {
+    if (!die_index_.emplace(die.id, static_cast<int>(dies_.size())).second) {
         throw std::invalid_argument("Die with ID " + die.id + " already exists");
     }
     
     dies_.push_back(die);
+    die_columns_.x.push_back(die.position.first);
+    die_columns_.y.push_back(die.position.second);
+    die_columns_.width.push_back(die.width);
+    die_columns_.height.push_back(die.height);
+    die_columns_.power.push_back(die.power_consumption);
+    heat_sources_.emplace_back();
+    charge_sources_.emplace_back();
+    via_blocks_.emplace_back();
+    invalidateCoupling();
     system_metrics_["total_power"] += die.power_consumption;
     system_metrics_["total_area"] += die.width * die.height;
     
-    Logger::getInstance().log("Added die: " + die.id + " (type: " + 
-                             std::to_string(static_cast<int>(die.type)) + ")");
+    SEMIPRO_LOGF(INFO, SIMULATION, "Added die: {} (type: {})", die.id, static_cast<int>(die.type));
 }
 
 void MultiDieModel::removeDie(const std::string& die_id) {
-    auto it = std::find_if(dies_.begin(), dies_.end(),
-                          [&die_id](const Die& d) { return d.id == die_id; });
-    if (it == dies_.end()) {
-        throw std::invalid_argument("Die with ID " + die_id + " not found");
+    const int handle = requireDie(die_id);
+    const Die& die = dies_[handle];
+    system_metrics_["total_power"] -= die.power_consumption;
+    system_metrics_["total_area"] -= die.width * die.height;
+    
+    // Every column drops the die's entry, and the handles after it move down
+    const auto erase = [handle](auto& column) { column.erase(column.begin() + handle); };
+    erase(dies_);
+    erase(die_columns_.x);
+    erase(die_columns_.y);
+    erase(die_columns_.width);
+    erase(die_columns_.height);
+    erase(die_columns_.power);
+    erase(heat_sources_);
+    erase(charge_sources_);
+    erase(via_blocks_);
+    die_index_.erase(die_id);
+    for (size_t i = handle; i < dies_.size(); ++i) {
+        die_index_[dies_[i].id] = static_cast<int>(i);
     }
-    
-    system_metrics_["total_power"] -= it->power_consumption;
-    system_metrics_["total_area"] -= it->width * it->height;
-    dies_.erase(it);
+    invalidateCoupling();
     
     // Remove interconnects involving this die
-    interconnects_.erase(
-        std::remove_if(interconnects_.begin(), interconnects_.end(),
-                      [&die_id](const Interconnect& ic) {
-                          return ic.from_die == die_id || ic.to_die == die_id;
-                      }),
-        interconnects_.end());
-    
-    Logger::getInstance().log("Removed die: " + die_id);
+    size_t kept = 0;
+    for (size_t k = 0; k < interconnects_.size(); ++k) {
+        if (interconnect_from_[k] == handle || interconnect_to_[k] == handle) {
+            continue;
+        }
+        const auto shifted = [handle](int end) { return end > handle ? end - 1 : end; };
+        interconnect_from_[kept] = shifted(interconnect_from_[k]);
+        interconnect_to_[kept] = shifted(interconnect_to_[k]);
+        if (kept != k) {
+            interconnects_[kept] = std::move(interconnects_[k]);
+        }
+        ++kept;
+    }
+    interconnects_.erase(interconnects_.begin() + kept, interconnects_.end());
+    interconnect_from_.resize(kept);
+    interconnect_to_.resize(kept);
+    adjacency_valid_ = false;
+    routes_.clear();
+    
+    SEMIPRO_LOGF(INFO, SIMULATION, "Removed die: {}", die_id);
 }
 
 void MultiDieModel::positionDie(const std::string& die_id, double x, double y) {
-    auto it = std::find_if(dies_.begin(), dies_.end(),
-                          [&die_id](Die& d) { return d.id == die_id; });
-    if (it == dies_.end()) {
-        throw std::invalid_argument("Die with ID " + die_id + " not found");
-    }
-    
-    it->position = {x, y};
-    Logger::getInstance().log("Positioned die " + die_id + " at (" + 
-                             std::to_string(x) + ", " + std::to_string(y) + ")");
+    const int handle = requireDie(die_id);
+    dies_[handle].position = {x, y};
+    die_columns_.x[handle] = x;
+    die_columns_.y[handle] = y;
+    invalidateCoupling();
+    routes_.clear();
+    SEMIPRO_LOGF(INFO, SIMULATION, "Positioned die {} at ({}, {})", die_id, x, y);
 }
 
 void MultiDieModel::performWireBonding(std::shared_ptr<Wafer> wafer,
@@ -71,12 +99,8 @@ void MultiDieModel::performWireBonding(std::shared_ptr<Wafer> wafer,
     }
     
     // Find the dies
-    auto it1 = std::find_if(dies_.begin(), dies_.end(),
-                           [&die1](const Die& d) { return d.id == die1; });
-    auto it2 = std::find_if(dies_.begin(), dies_.end(),
-                           [&die2](const Die& d) { return d.id == die2; });
-    
-    if (it1 == dies_.end() || it2 == dies_.end()) {
+    const int handle1 = getDieHandle(die1), handle2 = getDieHandle(die2);
+    if (handle1 < 0 || handle2 < 0) {
         throw std::invalid_argument("One or both dies not found");
     }
     
@@ -107,8 +131,7 @@ void MultiDieModel::performWireBonding(std::shared_ptr<Wafer> wafer,
     interconnect.delay = total_delay;
     addInterconnect(interconnect);
     
-    Logger::getInstance().log("Wire bonding completed between " + die1 + " and " + die2 +
-                             " with " + std::to_string(bonds.size()) + " bonds");
+    SEMIPRO_LOGF(INFO, SIMULATION, "Wire bonding completed between {} and {} with {} bonds", die1, die2, bonds.size());
 }
 
 void MultiDieModel::performFlipChipBonding(std::shared_ptr<Wafer> wafer,
@@ -119,18 +142,17 @@ void MultiDieModel::performFlipChipBonding(std::shared_ptr<Wafer> wafer,
     }
     
     // Find the dies
-    auto it1 = std::find_if(dies_.begin(), dies_.end(),
-                           [&die1](const Die& d) { return d.id == die1; });
-    auto it2 = std::find_if(dies_.begin(), dies_.end(),
-                           [&die2](const Die& d) { return d.id == die2; });
-    
-    if (it1 == dies_.end() || it2 == dies_.end()) {
+    const int handle1 = getDieHandle(die1), handle2 = getDieHandle(die2);
+    if (handle1 < 0 || handle2 < 0) {
         throw std::invalid_argument("One or both dies not found");
     }
+    if (!(bump_diameter > 0.0 && bump_diameter < bump_pitch)) {
+        throw std::invalid_argument("Bump diameter must be positive and below the pitch");
+    }
     
     // Calculate number of bumps
-    int bumps_x = static_cast<int>(std::min(it1->width, it2->width) / bump_pitch);
-    int bumps_y = static_cast<int>(std::min(it1->height, it2->height) / bump_pitch);
+    int bumps_x = static_cast<int>(std::min(dies_[handle1].width, dies_[handle2].width) / bump_pitch);
+    int bumps_y = static_cast<int>(std::min(dies_[handle1].height, dies_[handle2].height) / bump_pitch);
     int total_bumps = bumps_x * bumps_y;
     
     // Calculate flip-chip interconnect parameters
@@ -147,8 +169,13 @@ void MultiDieModel::performFlipChipBonding(std::shared_ptr<Wafer> wafer,
     interconnect.delay = delay;
     addInterconnect(interconnect);
     
-    Logger::getInstance().log("Flip-chip bonding completed between " + die1 + " and " + die2 +
-                             " with " + std::to_string(total_bumps) + " bumps");
+    const UnitCellHomogenizer::Properties bumps = homogenizer_->solve(
+        bump_pitch, bump_diameter, UnitCellHomogenizer::kSolder, UnitCellHomogenizer::kUnderfill);
+    dies_[handle2].thermal_properties["bump_conductivity_axial"] = bumps.conductivity_axial;
+    dies_[handle2].thermal_properties["bump_conductivity_in_plane"] = bumps.conductivity_in_plane;
+    
+    SEMIPRO_LOGF(INFO, SIMULATION, "Flip-chip bonding completed between {} and {} with {} bumps",
+                 die1, die2, total_bumps);
 }
 
 void MultiDieModel::performTSVIntegration(std::shared_ptr<Wafer> wafer,
@@ -159,10 +186,9 @@ void MultiDieModel::performTSVIntegration(std::shared_ptr<Wafer> wafer,
         throw std::invalid_argument("Wafer pointer is null");
     }
     
-    auto it = std::find_if(dies_.begin(), dies_.end(),
-                          [&die_id](const Die& d) { return d.id == die_id; });
-    if (it == dies_.end()) {
-        throw std::invalid_argument("Die with ID " + die_id + " not found");
+    const int handle = requireDie(die_id);
+    if (!(tsv_diameter > 0.0 && tsv_depth > 0.0)) {
+        throw std::invalid_argument("TSV diameter and depth must be positive");
     }
     
     // Calculate TSV parameters
@@ -173,8 +199,35 @@ void MultiDieModel::performTSVIntegration(std::shared_ptr<Wafer> wafer,
     // Add TSV metal layer to wafer
     wafer->addMetalLayer(tsv_depth, "copper");
     
-    Logger::getInstance().log("TSV integration completed for die " + die_id +
-                             " with " + std::to_string(tsv_positions.size()) + " TSVs");
+    // The pitch p of a square array of n TSVs filling the bounding box
+    // w x h with half a pitch around: n p^2 = (w + p)(h + p)
+    const size_t n = tsv_positions.size();
+    if (n > 1) {
+        double x0 = tsv_positions[0].first, x1 = x0, y0 = tsv_positions[0].second, y1 = y0;
+        for (const auto& [x, y] : tsv_positions) {
+            x0 = std::min(x0, x);
+            x1 = std::max(x1, x);
+            y0 = std::min(y0, y);
+            y1 = std::max(y1, y);
+        }
+        const double w = x1 - x0, h = y1 - y0;
+        const double pitch = (w + h + std::sqrt((w + h) * (w + h) + 4.0 * (n - 1) * w * h)) / (2.0 * (n - 1));
+        if (pitch > tsv_diameter) {
+            ViaBlock block{x0 - 0.5 * pitch, y0 - 0.5 * pitch, x1 + 0.5 * pitch, y1 + 0.5 * pitch,
+                           std::min(tsv_depth, dies_[handle].thickness),
+                           homogenizer_->solve(pitch, tsv_diameter, UnitCellHomogenizer::kCopper,
+                                               UnitCellHomogenizer::kSilicon)};
+            auto& thermal = dies_[handle].thermal_properties;
+            thermal["tsv_conductivity_axial"] = block.properties.conductivity_axial;
+            thermal["tsv_conductivity_in_plane"] = block.properties.conductivity_in_plane;
+            via_blocks_[handle].push_back(block);
+            invalidateCoupling();
+            SEMIPRO_LOGF(INFO, PHYSICS, "TSV array on die {} homogenized at {} um pitch: {} W/(m K) along, {} across",
+                         die_id, pitch, block.properties.conductivity_axial, block.properties.conductivity_in_plane);
+        }
+    }
+    
+    SEMIPRO_LOGF(INFO, SIMULATION, "TSV integration completed for die {} with {} TSVs", die_id, tsv_positions.size());
 }
 
 void MultiDieModel::analyzeElectricalPerformance(std::shared_ptr<Wafer> wafer) {
@@ -183,6 +236,8 @@ void MultiDieModel::analyzeElectricalPerformance(std::shared_ptr<Wafer> wafer) {
     }
     
     calculateInterconnectParameters();
+    calculateElectricalCoupling();
+    updateSystemMetrics(wafer);
     
     double total_delay = 0.0;
     double max_resistance = 0.0;
@@ -195,8 +250,7 @@ void MultiDieModel::analyzeElectricalPerformance(std::shared_ptr<Wafer> wafer) {
     system_metrics_["interconnect_delay"] = total_delay;
     system_metrics_["max_resistance"] = max_resistance;
     
-    Logger::getInstance().log("Electrical performance analysis completed. Total delay: " +
-                             std::to_string(total_delay) + " s");
+    SEMIPRO_LOGF(INFO, SIMULATION, "Electrical performance analysis completed. Total delay: {} s", total_delay);
 }
 
 void MultiDieModel::analyzeThermalPerformance(std::shared_ptr<Wafer> wafer) {
@@ -205,26 +259,169 @@ void MultiDieModel::analyzeThermalPerformance(std::shared_ptr<Wafer> wafer) {
     }
     
     calculateThermalCoupling();
+    updateSystemMetrics(wafer);
     
-    // Simple thermal analysis - more sophisticated models would use FEM
     double total_power = system_metrics_["total_power"];
     double total_area = system_metrics_["total_area"];
     double power_density = total_power / total_area;
+    double max_temperature = system_metrics_["max_temperature"];
     
-    // Estimate temperature rise
-    double thermal_resistance = 10.0; // K/W (simplified)
-    double temperature_rise = total_power * thermal_resistance;
-    double max_temperature = 300.0 + temperature_rise; // Base temperature + rise
-    
-    system_metrics_["max_temperature"] = max_temperature;
     system_metrics_["power_density"] = power_density;
     
-    Logger::getInstance().log("Thermal performance analysis completed. Max temperature: " +
-                             std::to_string(max_temperature) + " K");
+    SEMIPRO_LOGF(INFO, SIMULATION, "Thermal performance analysis completed. Max temperature: {} K", max_temperature);
+}
+
+void MultiDieModel::analyzeMechanicalStress(std::shared_ptr<Wafer> wafer, const WarpageOptions& options) {
+    if (!wafer) {
+        throw std::invalid_argument("Wafer pointer is null");
+    }
+    if (dies_.empty()) {
+        throw std::invalid_argument("Mechanical analysis needs at least one die");
+    }
+    if (!(options.substrate_thickness > 0.0 && options.mold_cap > 0.0 && options.margin > 0.0 && options.cells > 0)) {
+        throw std::invalid_argument("Package thicknesses, margin and cell count must be positive");
+    }
+    if (options.temperatures.empty()) {
+        throw std::invalid_argument("Mechanical analysis needs at least one temperature");
+    }
+    
+    // Package outline: the dies and a margin around them
+    const DieColumns& dies = die_columns_;
+    double x0 = dies.x[0], x1 = x0, y0 = dies.y[0], y1 = y0;
+    double thickest = 0.0;
+    for (size_t i = 0; i < dies_.size(); ++i) {
+        x0 = std::min(x0, dies.x[i] - 0.5 * dies.width[i]);
+        x1 = std::max(x1, dies.x[i] + 0.5 * dies.width[i]);
+        y0 = std::min(y0, dies.y[i] - 0.5 * dies.height[i]);
+        y1 = std::max(y1, dies.y[i] + 0.5 * dies.height[i]);
+        thickest = std::max(thickest, dies_[i].thickness);
+    }
+    x0 -= options.margin;
+    x1 += options.margin;
+    y0 -= options.margin;
+    y1 += options.margin;
+    const double spacing = std::max(x1 - x0, y1 - y0) / options.cells;
+    const int cols = std::max(2, static_cast<int>(std::ceil((x1 - x0) / spacing)));
+    const int rows = std::max(2, static_cast<int>(std::ceil((y1 - y0) / spacing)));
+    
+    // Silicon dies, a BT substrate and a mold compound softening past its
+    // glass transition; stack 0 is mold over substrate, stack 1 + i die i
+    // under the mold left above it
+    enum { kSilicon, kSubstrate, kMold };
+    std::vector<LaminatePlateSolver::Material> materials = {
+        {130e9, 0.28, 2.6e-6},
+        {25e9, 0.3, 15e-6},
+        {22e9, 0.3, 9e-6, 423.15, 1.5e9, 35e-6}};
+    const double cap = thickest + options.mold_cap;
+    const double substrate = options.substrate_thickness;
+    std::vector<LaminatePlateSolver::Stack> stacks = {{{kMold, cap * 1e-6}, {kSubstrate, substrate * 1e-6}}};
+    for (const auto& die : dies_) {
+        stacks.push_back({{kMold, (cap - die.thickness) * 1e-6},
+                          {kSilicon, die.thickness * 1e-6},
+                          {kSubstrate, substrate * 1e-6}});
+    }
+    // A TSV block is its own material over its depth, the die's silicon
+    // below, in a stack after the dies'
+    std::vector<std::vector<int>> block_stacks(dies_.size());
+    for (size_t d = 0; d < dies_.size(); ++d) {
+        const double thickness = dies_[d].thickness;
+        for (const auto& block : via_blocks_[d]) {
+            const UnitCellHomogenizer::Properties& p = block.properties;
+            materials.push_back({p.modulus_in_plane, p.poisson_in_plane, p.expansion_in_plane});
+            LaminatePlateSolver::Stack stack = {{kMold, (cap - thickness) * 1e-6},
+                                                {static_cast<int>(materials.size()) - 1, block.depth * 1e-6}};
+            if (block.depth < thickness) {
+                stack.push_back({kSilicon, (thickness - block.depth) * 1e-6});
+            }
+            stack.push_back({kSubstrate, substrate * 1e-6});
+            block_stacks[d].push_back(static_cast<int>(stacks.size()));
+            stacks.push_back(std::move(stack));
+        }
+    }
+    Eigen::ArrayXXi stack_of_cell = Eigen::ArrayXXi::Zero(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            const double x = x0 + (j + 0.5) * spacing, y = y0 + (i + 0.5) * spacing;
+            for (size_t d = 0; d < dies_.size(); ++d) {
+                if (std::abs(x - dies.x[d]) <= 0.5 * dies.width[d] && std::abs(y - dies.y[d]) <= 0.5 * dies.height[d]) {
+                    stack_of_cell(i, j) = static_cast<int>(d) + 1;
+                    const auto& blocks = via_blocks_[d];
+                    for (size_t b = 0; b < blocks.size(); ++b) {
+                        if (x >= blocks[b].x0 && x <= blocks[b].x1 && y >= blocks[b].y0 && y <= blocks[b].y1) {
+                            stack_of_cell(i, j) = block_stacks[d][b];
+                            break;
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    
+    LaminatePlateSolver::Options solver_options;
+    solver_options.stress_free_temperature = options.stress_free_temperature;
+    const LaminatePlateSolver solver(stack_of_cell, spacing * 1e-6, materials, std::move(stacks), solver_options);
+    warpage_ = solver.solve(options.temperatures);
+    
+    double max_warpage = 0.0, max_stress = 0.0;
+    for (const auto& result : warpage_) {
+        max_warpage = std::max(max_warpage, result.warpage_range * 1e6);
+        max_stress = std::max(max_stress, result.peak_stress.maxCoeff() * 1e-6);
+    }
+    system_metrics_["max_warpage"] = max_warpage;
+    system_metrics_["warpage_room"] = warpage_.front().warpage_range * 1e6;
+    system_metrics_["warpage_reflow"] = warpage_.back().warpage_range * 1e6;
+    system_metrics_["max_mechanical_stress"] = max_stress;
+    
+    SEMIPRO_LOGF(INFO, SIMULATION, "Mechanical stress analysis completed on a {}x{} grid. Max warpage: {} um, max stress: {} MPa",
+                 rows, cols, max_warpage, max_stress);
 }
 
 void MultiDieModel::addInterconnect(const Interconnect& interconnect) {
     interconnects_.push_back(interconnect);
+    interconnect_from_.push_back(getDieHandle(interconnect.from_die));
+    interconnect_to_.push_back(getDieHandle(interconnect.to_die));
+    adjacency_valid_ = false;
+    routes_.clear();
+}
+
+int MultiDieModel::getDieHandle(const std::string& die_id) const {
+    auto it = die_index_.find(die_id);
+    return it != die_index_.end() ? it->second : -1;
+}
+
+int MultiDieModel::requireDie(const std::string& die_id) const {
+    const int handle = getDieHandle(die_id);
+    if (handle < 0) {
+        throw std::invalid_argument("Die with ID " + die_id + " not found");
+    }
+    return handle;
+}
+
+std::pair<const int*, const int*> MultiDieModel::getDieInterconnects(int handle) const {
+    if (handle < 0 || handle >= static_cast<int>(dies_.size())) {
+        throw std::out_of_range("Die handle " + std::to_string(handle) + " out of range");
+    }
+    if (!adjacency_valid_) {
+        // Counting sort of the interconnect ends by die; a loop counts once
+        adjacency_offsets_.assign(dies_.size() + 1, 0);
+        for (size_t k = 0; k < interconnects_.size(); ++k) {
+            if (interconnect_from_[k] >= 0) ++adjacency_offsets_[interconnect_from_[k] + 1];
+            if (interconnect_to_[k] >= 0 && interconnect_to_[k] != interconnect_from_[k]) ++adjacency_offsets_[interconnect_to_[k] + 1];
+        }
+        for (size_t i = 0; i < dies_.size(); ++i) {
+            adjacency_offsets_[i + 1] += adjacency_offsets_[i];
+        }
+        adjacency_.resize(adjacency_offsets_.back());
+        std::vector<int> next(adjacency_offsets_.begin(), adjacency_offsets_.end() - 1);
+        for (size_t k = 0; k < interconnects_.size(); ++k) {
+            if (interconnect_from_[k] >= 0) adjacency_[next[interconnect_from_[k]]++] = static_cast<int>(k);
+            if (interconnect_to_[k] >= 0 && interconnect_to_[k] != interconnect_from_[k]) adjacency_[next[interconnect_to_[k]]++] = static_cast<int>(k);
+        }
+        adjacency_valid_ = true;
+    }
+    const int* data = adjacency_.data();
+    return {data + adjacency_offsets_[handle], data + adjacency_offsets_[handle + 1]};
 }
 
 void MultiDieModel::calculateInterconnectParameters() {
@@ -234,43 +431,321 @@ void MultiDieModel::calculateInterconnectParameters() {
     }
 }
 
+void MultiDieModel::optimizeInterconnectRouting(const RoutingOptions& options) {
+    const AdvancedInterconnects::InterconnectLayer& layer = options.layer;
+    const double pitch = options.grid_pitch;
+    const double track = (layer.line_width + layer.line_spacing) * 1e-3; // μm
+    const int tracks = pitch > 0.0 && track > 0.0 ? static_cast<int>(pitch / track) * options.layers : 0;
+    if (tracks < 1) {
+        throw std::invalid_argument("Routing cells must hold at least one track");
+    }
+    for (size_t k = 0; k < interconnects_.size(); ++k) {
+        if (interconnect_from_[k] < 0 || interconnect_to_[k] < 0) {
+            throw std::invalid_argument("Interconnect between unknown dies " + interconnects_[k].from_die +
+                                        " and " + interconnects_[k].to_die);
+        }
+    }
+    routes_.clear();
+    system_metrics_["routed_wirelength"] = 0.0;
+    system_metrics_["max_interconnect_delay"] = 0.0;
+    system_metrics_["routing_overflow"] = 0.0;
+    system_metrics_["routing_iterations"] = 0.0;
+    if (interconnects_.empty()) {
+        return;
+    }
+    
+    // Grid over the dies and a cell of margin
+    const DieColumns& dies = die_columns_;
+    double x0 = dies.x[0], x1 = x0, y0 = dies.y[0], y1 = y0;
+    for (size_t i = 0; i < dies_.size(); ++i) {
+        x0 = std::min(x0, dies.x[i] - 0.5 * dies.width[i]);
+        x1 = std::max(x1, dies.x[i] + 0.5 * dies.width[i]);
+        y0 = std::min(y0, dies.y[i] - 0.5 * dies.height[i]);
+        y1 = std::max(y1, dies.y[i] + 0.5 * dies.height[i]);
+    }
+    x0 -= pitch;
+    y0 -= pitch;
+    const int cols = static_cast<int>(std::ceil((x1 - x0) / pitch)) + 1;
+    const int rows = static_cast<int>(std::ceil((y1 - y0) / pitch)) + 1;
+    const auto cell_of = [&](double x, double y) {
+        const int col = std::clamp(static_cast<int>((x - x0) / pitch), 0, cols - 1);
+        const int row = std::clamp(static_cast<int>((y - y0) / pitch), 0, rows - 1);
+        return row * cols + col;
+    };
+    
+    // Pins on the edge of die a facing die b's center, the nets between
+    // the pair spaced about the nearest point a pitch apart, or closer
+    // when they would not fit along the edge
+    const long long n = static_cast<long long>(dies_.size());
+    std::unordered_map<long long, int> pair_nets, pair_next;
+    for (size_t k = 0; k < interconnects_.size(); ++k) {
+        ++pair_nets[interconnect_from_[k] * n + interconnect_to_[k]];
+        ++pair_nets[interconnect_to_[k] * n + interconnect_from_[k]];
+    }
+    const auto pin = [&](int a, int b) {
+        const long long key = a * n + b;
+        const int count = pair_nets[key];
+        const double hw = 0.5 * dies.width[a], hh = 0.5 * dies.height[a];
+        const double dx = dies.x[b] - dies.x[a], dy = dies.y[b] - dies.y[a];
+        const bool side = std::abs(dx) * hh >= std::abs(dy) * hw;
+        const double edge = 2.0 * (side ? hh : hw);
+        const double spacing = std::min(pitch, edge / count);
+        const double offset = (pair_next[key]++ - 0.5 * (count - 1)) * spacing;
+        // The run of pins slides along the edge rather than past its end
+        const auto place = [&](double nearest, double center, double half) {
+            const double reach = 0.5 * (count - 1) * spacing;
+            return std::clamp(nearest, center - half + reach, center + half - reach) + offset;
+        };
+        if (side) {
+            return cell_of(dies.x[a] + std::copysign(hw, dx), place(dies.y[b], dies.y[a], hh));
+        }
+        return cell_of(place(dies.x[b], dies.x[a], hw), dies.y[a] + std::copysign(hh, dy));
+    };
+    std::vector<InterconnectRouter::Net> nets(interconnects_.size());
+    for (size_t k = 0; k < interconnects_.size(); ++k) {
+        nets[k].source = pin(interconnect_from_[k], interconnect_to_[k]);
+        nets[k].target = pin(interconnect_to_[k], interconnect_from_[k]);
+    }
+    
+    const InterconnectRouter router(cols, rows, tracks);
+    const InterconnectRouter::Result routing = router.route(nets, options.negotiation);
+    
+    AdvancedInterconnects::WireColumns wires;
+    wires.layer.assign(interconnects_.size(), 0);
+    wires.length.resize(static_cast<Eigen::Index>(interconnects_.size()));
+    routes_.resize(interconnects_.size());
+    for (size_t k = 0; k < interconnects_.size(); ++k) {
+        const std::vector<int>& path = routing.paths[k];
+        const auto center = [&](int cell) {
+            return std::make_pair(x0 + (cell % cols + 0.5) * pitch, y0 + (cell / cols + 0.5) * pitch);
+        };
+        auto& route = routes_[k];
+        route.push_back(center(path.front()));
+        for (size_t p = 1; p + 1 < path.size(); ++p) {
+            if (path[p + 1] - path[p] != path[p] - path[p - 1]) {
+                route.push_back(center(path[p]));
+            }
+        }
+        if (path.size() > 1) {
+            route.push_back(center(path.back()));
+        }
+        
+        wires.length(k) = (path.size() - 1) * pitch;
+    }
+    
+    const AdvancedInterconnects technology;
+    const AdvancedInterconnects::ParasiticColumns parasitics =
+        technology.extractParasitics(technology.layerColumns({layer}), wires);
+    for (size_t k = 0; k < interconnects_.size(); ++k) {
+        Interconnect& interconnect = interconnects_[k];
+        interconnect.resistance = parasitics.resistance(k);
+        interconnect.capacitance = parasitics.capacitance(k);
+        interconnect.inductance = parasitics.inductance(k);
+        interconnect.delay = parasitics.delay(k);
+    }
+    const double wirelength = wires.length.sum();
+    const double max_delay = parasitics.delay.maxCoeff();
+    
+    system_metrics_["routed_wirelength"] = wirelength;
+    system_metrics_["max_interconnect_delay"] = max_delay;
+    system_metrics_["routing_overflow"] = static_cast<double>(routing.overflow);
+    system_metrics_["routing_iterations"] = routing.iterations;
+    
+    SEMIPRO_LOGF(INFO, SIMULATION, "Routed {} interconnects on a {} x {} grid in {} iterations: {} μm, overflow {}",
+                 interconnects_.size(), cols, rows, routing.iterations, wirelength, routing.overflow);
+}
+
+void MultiDieModel::addHeatSource(const std::string& die_id, double x, double y, double power, double radius) {
+    heat_sources_[requireDie(die_id)].push_back({x, y, power, radius});
+    invalidateCoupling();
+}
+
+void MultiDieModel::addChargeSource(const std::string& die_id, double x, double y, double charge, double radius) {
+    charge_sources_[requireDie(die_id)].push_back({x, y, charge, radius});
+    invalidateCoupling();
+}
+
+void MultiDieModel::clearCouplingSources() {
+    for (auto& sources : heat_sources_) sources.clear();
+    for (auto& sources : charge_sources_) sources.clear();
+    invalidateCoupling();
+}
+
+void MultiDieModel::setCouplingMedium(double thermal_conductivity, double relative_permittivity, double theta) {
+    if (!(thermal_conductivity > 0.0) || !(relative_permittivity > 0.0) || !(theta > 0.0 && theta < 1.0)) {
+        throw std::invalid_argument("Coupling medium needs positive constants and theta in (0, 1)");
+    }
+    substrate_conductivity_ = thermal_conductivity;
+    relative_permittivity_ = relative_permittivity;
+    coupling_theta_ = theta;
+    invalidateCoupling();
+}
+
+double MultiDieModel::dieSourceRadius(double width, double height) {
+    // A disk of radius a heating a half-space rises by 8 P / (3 pi^2 k a)
+    // on average, which P / (2 pi k sqrt(r^2 + s^2)) gives at r = 0 for
+    // s = 3 pi a / 16
+    return 3.0 * M_PI / 16.0 * std::sqrt(width * height / M_PI);
+}
+
+Eigen::VectorXd MultiDieModel::dieFieldPeaks(const std::vector<std::vector<CouplingTree::Source>>& sources,
+                                             const std::vector<double>* fallback) const {
+    const DieColumns& dies = die_columns_;
+    std::vector<CouplingTree::Source> all;
+    std::vector<double> x, y;
+    std::vector<int> owner;
+    for (size_t i = 0; i < dies_.size(); ++i) {
+        if (!sources[i].empty()) {
+            for (const auto& source : sources[i]) {
+                all.push_back(source);
+                x.push_back(source.x);
+                y.push_back(source.y);
+                owner.push_back(static_cast<int>(i));
+            }
+        } else if (fallback && (*fallback)[i] != 0.0) {
+            all.push_back({dies.x[i], dies.y[i], (*fallback)[i], dieSourceRadius(dies.width[i], dies.height[i])});
+        }
+        x.push_back(dies.x[i]);
+        y.push_back(dies.y[i]);
+        owner.push_back(static_cast<int>(i));
+    }
+    
+    const CouplingTree tree(all);
+    const Eigen::VectorXd field = tree.potentials(Eigen::Map<const Eigen::VectorXd>(x.data(), x.size()),
+                                                  Eigen::Map<const Eigen::VectorXd>(y.data(), y.size()),
+                                                  coupling_theta_);
+    Eigen::VectorXd peaks = Eigen::VectorXd::Zero(dies_.size());
+    for (size_t k = 0; k < owner.size(); ++k) {
+        if (std::abs(field(k)) > std::abs(peaks(owner[k]))) {
+            peaks(owner[k]) = field(k);
+        }
+    }
+    return peaks;
+}
+
 void MultiDieModel::calculateThermalCoupling() {
-    // Simplified thermal coupling calculation
+    // dT = P / (2 pi k r) into the substrate, r taken from μm to m
+    const double scale = 1e6 / (2.0 * M_PI * substrate_conductivity_);
+    die_temperature_rise_ = scale * dieFieldPeaks(heat_sources_, &die_columns_.power);
+    
+    // Down through each die: its TSV blocks in parallel with the silicon
+    // beside them, each block its homogenized column over the TSV depth
+    // in series with silicon below; areas in μm^2, lengths in μm
+    const DieColumns& dies = die_columns_;
+    const double silicon = UnitCellHomogenizer::kSilicon.conductivity;
     for (size_t i = 0; i < dies_.size(); ++i) {
-        for (size_t j = i + 1; j < dies_.size(); ++j) {
-            double dx = dies_[i].position.first - dies_[j].position.first;
-            double dy = dies_[i].position.second - dies_[j].position.second;
-            double distance = std::sqrt(dx*dx + dy*dy);
-            
-            // Thermal coupling decreases with distance
-            double thermal_coupling = 1.0 / (1.0 + distance);
-            // Store coupling information if needed
+        const double thickness = dies_[i].thickness;
+        double plain = dies.width[i] * dies.height[i];
+        double conductance = 0.0;
+        for (const auto& block : via_blocks_[i]) {
+            const double bw = std::min(block.x1, dies.x[i] + 0.5 * dies.width[i]) - std::max(block.x0, dies.x[i] - 0.5 * dies.width[i]);
+            const double bh = std::min(block.y1, dies.y[i] + 0.5 * dies.height[i]) - std::max(block.y0, dies.y[i] - 0.5 * dies.height[i]);
+            if (bw <= 0.0 || bh <= 0.0) continue;
+            const double area = std::min(bw * bh, plain);
+            plain -= area;
+            conductance += area / (block.depth / block.properties.conductivity_axial + (thickness - block.depth) / silicon);
+        }
+        conductance += plain * silicon / thickness;
+        if (conductance > 0.0) {
+            die_temperature_rise_(i) += dies.power[i] / (conductance * 1e-6);
+        }
+    }
+    
+    const Eigen::Index n = static_cast<Eigen::Index>(dies_.size());
+    thermal_coupling_.resize(n, n);
+    for (Eigen::Index i = 0; i < n; ++i) {
+        for (Eigen::Index j = 0; j < n; ++j) {
+            const double dx = dies.x[i] - dies.x[j];
+            const double dy = dies.y[i] - dies.y[j];
+            const double radius = dieSourceRadius(dies.width[j], dies.height[j]);
+            thermal_coupling_(i, j) = scale / std::sqrt(dx * dx + dy * dy + radius * radius);
+        }
+    }
+}
+
+void MultiDieModel::calculateElectricalCoupling() {
+    // V = q / (4 pi eps r), r taken from μm to m
+    const double scale = 1e6 / (4.0 * M_PI * 8.854e-12 * relative_permittivity_);
+    die_potential_ = scale * dieFieldPeaks(charge_sources_, nullptr);
+    
+    // Softened over both dies, so P_ii = 1 / r_i
+    const DieColumns& dies = die_columns_;
+    const Eigen::Index n = static_cast<Eigen::Index>(dies_.size());
+    electrical_coupling_.resize(n, n);
+    for (Eigen::Index i = 0; i < n; ++i) {
+        for (Eigen::Index j = 0; j < n; ++j) {
+            const double dx = dies.x[i] - dies.x[j];
+            const double dy = dies.y[i] - dies.y[j];
+            const double radii = dieSourceRadius(dies.width[i], dies.height[i]) * dieSourceRadius(dies.width[j], dies.height[j]);
+            electrical_coupling_(i, j) = std::sqrt(radii / (dx * dx + dy * dy + radii));
         }
     }
 }
 
+void MultiDieModel::invalidateCoupling() {
+    die_temperature_rise_.resize(0);
+    thermal_coupling_.resize(0, 0);
+    die_potential_.resize(0);
+    electrical_coupling_.resize(0, 0);
+}
+
 void MultiDieModel::updateSystemMetrics(std::shared_ptr<Wafer> wafer) {
     // Update all system-level metrics
-    system_metrics_["total_power"] = 0.0;
-    system_metrics_["total_area"] = 0.0;
-    
-    for (const auto& die : dies_) {
-        system_metrics_["total_power"] += die.power_consumption;
-        system_metrics_["total_area"] += die.width * die.height;
+    double total_power = 0.0, total_area = 0.0;
+    for (size_t i = 0; i < dies_.size(); ++i) {
+        total_power += die_columns_.power[i];
+        total_area += die_columns_.width[i] * die_columns_.height[i];
+    }
+    system_metrics_["total_power"] = total_power;
+    system_metrics_["total_area"] = total_area;
+    
+    // The largest die-to-die entry of a coupling matrix
+    const auto off_diagonal = [](const Eigen::MatrixXd& m) {
+        double peak = 0.0;
+        for (Eigen::Index i = 0; i < m.rows(); ++i) {
+            for (Eigen::Index j = 0; j < m.cols(); ++j) {
+                if (i != j) peak = std::max(peak, m(i, j));
+            }
+        }
+        return peak;
+    };
+    const Eigen::Index n = static_cast<Eigen::Index>(dies_.size());
+    if (n > 0 && die_temperature_rise_.size() == n) {
+        system_metrics_["max_temperature"] = 300.0 + die_temperature_rise_.maxCoeff();
+        system_metrics_["max_thermal_coupling"] = off_diagonal(thermal_coupling_);
+    }
+    if (n > 0 && die_potential_.size() == n) {
+        system_metrics_["max_die_potential"] = die_potential_.cwiseAbs().maxCoeff();
+        system_metrics_["max_electrical_coupling"] = off_diagonal(electrical_coupling_);
     }
 }
 
+void MultiDieModel::calculateSystemMTTF(std::shared_ptr<Wafer> wafer, const FailureSamplingOptions& options) {
+    if (!wafer) {
+        throw std::invalid_argument("Wafer pointer is null");
+    }
+
+    FailureSamplingOptions system_options = options;
+    system_options.copies = std::max(1, static_cast<int>(dies_.size()));
+    const ChipFailureDistribution lifetimes = ReliabilityModel().sampleChipFailures(wafer, system_options);
+
+    system_metrics_["system_mttf"] = lifetimes.mean;
+    system_metrics_["system_median_life"] = lifetimes.median;
+    system_metrics_["system_t01"] = lifetimes.quantile(0.01);
+
+    SEMIPRO_LOGF(INFO, SIMULATION, "System MTTF over {} dies: {} s (median {} s, 1% failed by {} s)",
+                 system_options.copies, lifetimes.mean, lifetimes.median, system_metrics_["system_t01"]);
+}
+
 bool MultiDieModel::validateDiePositions() const {
     // Check for overlapping dies
+    const DieColumns& dies = die_columns_;
     for (size_t i = 0; i < dies_.size(); ++i) {
         for (size_t j = i + 1; j < dies_.size(); ++j) {
-            const auto& die1 = dies_[i];
-            const auto& die2 = dies_[j];
-            
-            double dx = std::abs(die1.position.first - die2.position.first);
-            double dy = std::abs(die1.position.second - die2.position.second);
+            double dx = std::abs(dies.x[i] - dies.x[j]);
+            double dy = std::abs(dies.y[i] - dies.y[j]);
             
-            if (dx < (die1.width + die2.width) / 2 && dy < (die1.height + die2.height) / 2) {
+            if (dx < (dies.width[i] + dies.width[j]) / 2 && dy < (dies.height[i] + dies.height[j]) / 2) {
                 return false; // Overlap detected
             }
         }
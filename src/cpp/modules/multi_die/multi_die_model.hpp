@@ -4,6 +4,13 @@
 
 #include "multi_die_interface.hpp"
 #include "../../core/wafer.hpp"
+#include "../../core/laminate_plate_solver.hpp"
+#include "../reliability/reliability_model.hpp"
+#include "../advanced_processes/advanced_interconnects.hpp"
+#include "coupling_tree.hpp"
+#include "interconnect_router.hpp"
+#include "unit_cell_homogenizer.hpp"
+#include <Eigen/Dense>
 #include <memory>
 #include <vector>
 #include <string>
@@ -58,6 +65,26 @@ struct Interconnect {
           resistance(0.0), capacitance(0.0), inductance(0.0), delay(0.0) {}
 };
 
+// Package routing of the interconnects: a grid of square cells over the
+// dies, each with the tracks of the routing layers that fit its width
+struct RoutingOptions {
+    double grid_pitch = 50.0; // μm
+    int layers = 2;
+    AdvancedInterconnects::InterconnectLayer layer{"RDL", 1, 2000.0, 2000.0, 3000.0};
+    NegotiationOptions negotiation;
+};
+
+// Package for warpage: the dies on a substrate, a mold compound around
+// and over them; lengths in μm, temperatures in K
+struct WarpageOptions {
+    double substrate_thickness = 400.0;
+    double mold_cap = 100.0;         // Mold over the thickest die
+    double margin = 1000.0;          // Package edge beyond the dies
+    int cells = 96;                  // Across the package's longer side
+    double stress_free_temperature = 448.15; // Mold cure
+    std::vector<double> temperatures{298.15, 423.15, 533.15}; // Room, mold glass transition, reflow peak
+};
+
 class MultiDieModel : public MultiDieInterface {
 public:
     MultiDieModel();
@@ -72,10 +99,25 @@ public:
                            const std::string& die1, const std::string& die2,
                            const std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>>& bonds);
     
+    // The bumps between the dies, solder in underfill, are homogenized into
+    // one layer whose effective conductivities are left in die2's
+    // thermal_properties as bump_conductivity_axial and
+    // bump_conductivity_in_plane (W/(m K)). Throws std::invalid_argument
+    // for a bump diameter not in (0, bump_pitch).
     void performFlipChipBonding(std::shared_ptr<Wafer> wafer,
                                const std::string& die1, const std::string& die2,
                                double bump_pitch, double bump_diameter);
     
+    // TSVs at absolute positions (μm) like the dies', taken as one square
+    // array over their bounding box at the pitch that fills it. The array
+    // becomes a homogenized copper-in-silicon block down to tsv_depth,
+    // from a unit cell solved once per pitch to diameter ratio, which the
+    // thermal and mechanical analyses use in place of the TSVs; its
+    // effective conductivities are left in the die's thermal_properties as
+    // tsv_conductivity_axial and tsv_conductivity_in_plane (W/(m K)). A
+    // single TSV, or an array too tight for its diameter, adds no block.
+    // Throws std::invalid_argument for a diameter or depth that is not
+    // positive.
     void performTSVIntegration(std::shared_ptr<Wafer> wafer,
                               const std::string& die_id,
                               const std::vector<std::pair<double, double>>& tsv_positions,
@@ -92,29 +134,140 @@ public:
     // Analysis methods
     void analyzeElectricalPerformance(std::shared_ptr<Wafer> wafer);
     void analyzeThermalPerformance(std::shared_ptr<Wafer> wafer);
-    void analyzeMechanicalStress(std::shared_ptr<Wafer> wafer);
+    // Warpage and layer stresses of the package at each temperature, by
+    // the laminate plate solver over a grid of the package, TSV arrays
+    // entering as their homogenized blocks. Sets
+    // max_warpage (μm, the largest over the temperatures), warpage_room and
+    // warpage_reflow (μm, at the first and last temperature) and
+    // max_mechanical_stress (MPa, von Mises). Throws std::invalid_argument
+    // without dies, for a thickness, margin or cell count that is not
+    // positive, or without temperatures.
+    void analyzeMechanicalStress(std::shared_ptr<Wafer> wafer, const WarpageOptions& options = WarpageOptions());
     void analyzeSystemReliability(std::shared_ptr<Wafer> wafer);
     
+    // Coupling sources, at absolute positions (μm) like the dies'. A die
+    // with heat sources (micro-bumps, hot spots) is represented by them
+    // alone; any other by its power_consumption spread over its area.
+    // Charges (C) drive the electrical coupling the same way.
+    void addHeatSource(const std::string& die_id, double x, double y, double power, double radius = 10.0);
+    void addChargeSource(const std::string& die_id, double x, double y, double charge, double radius = 10.0);
+    void clearCouplingSources();
+    // Substrate the dies spread heat into (W/(m K)) and the dielectric
+    // between them; theta is the coupling tree's opening angle
+    void setCouplingMedium(double thermal_conductivity, double relative_permittivity, double theta = 0.5);
+    
     // Interconnect modeling
     void addInterconnect(const Interconnect& interconnect);
     void calculateInterconnectParameters();
-    void optimizeInterconnectRouting();
+    // Routes every interconnect between its dies by negotiated congestion,
+    // pins spread along the facing die edges, and sets each one's
+    // resistance, capacitance, inductance and delay from its routed length
+    // on the layer. Sets routed_wirelength (μm), max_interconnect_delay
+    // (s), routing_overflow (tracks over capacity) and routing_iterations.
+    // Throws std::invalid_argument for a pitch or layer count below one
+    // track, or an interconnect to an unknown die.
+    void optimizeInterconnectRouting(const RoutingOptions& options = RoutingOptions());
     
     // System-level simulation
     void simulateSystemOperation(std::shared_ptr<Wafer> wafer, double simulation_time);
-    void calculateSystemMTTF(std::shared_ptr<Wafer> wafer);
+    // Samples system lifetimes with every die carrying the wafer's
+    // electromigration MTTF map and the system failing with its first
+    // die; options.copies is taken from the die count. Sets system_mttf,
+    // system_median_life and system_t01 (1% failed), all in s.
+    void calculateSystemMTTF(std::shared_ptr<Wafer> wafer,
+                             const FailureSamplingOptions& options = FailureSamplingOptions());
     
     // Getters
     const std::vector<Die>& getDies() const { return dies_; }
     const std::vector<Interconnect>& getInterconnects() const { return interconnects_; }
+    // Dense handle of a die: its index in getDies(), -1 if there is none.
+    // Removing a die shifts the handles after it down by one.
+    int getDieHandle(const std::string& die_id) const;
+    // Indices into getInterconnects() of the interconnects with either end
+    // on the die, from an adjacency in CSR form rebuilt on first use after
+    // the interconnects change
+    std::pair<const int*, const int*> getDieInterconnects(int handle) const;
     const std::unordered_map<std::string, double>& getSystemMetrics() const { return system_metrics_; }
+    // Results of the last coupling analysis, in die order: the temperature
+    // rise of each die (K, the hottest of its center and sources) and the
+    // rise at die i per watt in die j (K/W); each die's potential (V) and
+    // the electrical coupling coefficients P_ij / sqrt(P_ii P_jj) of the
+    // dies' potential coefficients, 1 on the diagonal
+    // The rise includes conduction down through the die, its TSV blocks
+    // in parallel with the silicon beside them
+    const Eigen::VectorXd& getDieTemperatureRise() const { return die_temperature_rise_; }
+    const Eigen::MatrixXd& getThermalCoupling() const { return thermal_coupling_; }
+    const Eigen::VectorXd& getDiePotential() const { return die_potential_; }
+    const Eigen::MatrixXd& getElectricalCoupling() const { return electrical_coupling_; }
+    // Corners (μm) of each interconnect's route from the last routing, pin
+    // to pin; empty until routed, cleared when dies move or interconnects
+    // change
+    const std::vector<std::vector<std::pair<double, double>>>& getInterconnectRoutes() const { return routes_; }
+    // Results of the last mechanical analysis, one per temperature, rows
+    // of the grid along y; empty before one
+    const std::vector<LaminatePlateSolver::Result>& getWarpage() const { return warpage_; }
+    // Unit cells of the TSV and bump arrays, solved once per pattern
+    const UnitCellHomogenizer& getHomogenizer() const { return *homogenizer_; }
 
 private:
     std::vector<Die> dies_;
     std::vector<Interconnect> interconnects_;
     std::unordered_map<std::string, double> system_metrics_;
     
+    // Handles by die ID
+    std::unordered_map<std::string, int> die_index_;
+    // What the system sweeps read of each die, as columns by handle
+    struct DieColumns {
+        std::vector<double> x, y;
+        std::vector<double> width, height;
+        std::vector<double> power;
+    };
+    DieColumns die_columns_;
+    // Each interconnect's ends as handles, -1 for a die not in the model
+    std::vector<int> interconnect_from_;
+    std::vector<int> interconnect_to_;
+    mutable std::vector<int> adjacency_offsets_;
+    mutable std::vector<int> adjacency_;
+    mutable bool adjacency_valid_ = false;
+    
+    std::vector<std::vector<std::pair<double, double>>> routes_;
+    
+    // Coupling sources by handle
+    std::vector<std::vector<CouplingTree::Source>> heat_sources_;
+    std::vector<std::vector<CouplingTree::Source>> charge_sources_;
+    double substrate_conductivity_ = 150.0; // Silicon interposer
+    double relative_permittivity_ = 3.9;
+    double coupling_theta_ = 0.5;
+    Eigen::VectorXd die_temperature_rise_;
+    Eigen::MatrixXd thermal_coupling_;
+    Eigen::VectorXd die_potential_;
+    Eigen::MatrixXd electrical_coupling_;
+    std::vector<LaminatePlateSolver::Result> warpage_;
+    
+    // Homogenized TSV arrays by handle: the array's extent (μm, absolute)
+    // and depth from the die's top
+    struct ViaBlock {
+        double x0, y0, x1, y1;
+        double depth;
+        UnitCellHomogenizer::Properties properties;
+    };
+    std::vector<std::vector<ViaBlock>> via_blocks_;
+    std::shared_ptr<UnitCellHomogenizer> homogenizer_ = std::make_shared<UnitCellHomogenizer>();
+    
     // Helper methods
+    // Handle of die_id; throws std::invalid_argument if there is none
+    int requireDie(const std::string& die_id) const;
+    // Strength / r (per μm) of the dies' sources at each die's center and
+    // sources, the value of largest magnitude per die, through one
+    // coupling tree; a die without sources of its own carries its
+    // fallback strength, if any, over its area
+    Eigen::VectorXd dieFieldPeaks(const std::vector<std::vector<CouplingTree::Source>>& sources,
+                                  const std::vector<double>* fallback) const;
+    // Softening of a die-wide source (μm) that makes the field on it the
+    // mean rise over a uniform disk of the die's area
+    static double dieSourceRadius(double width, double height);
+    // Drops coupling results once the dies or sources change
+    void invalidateCoupling();
     void calculateThermalCoupling();
     void calculateElectricalCoupling();
     void calculateMechanicalCoupling();
@@ -0,0 +1,266 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "unit_cell_homogenizer.hpp"
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+const UnitCellHomogenizer::Material UnitCellHomogenizer::kCopper{400.0, 120e9, 0.34, 17e-6};
+const UnitCellHomogenizer::Material UnitCellHomogenizer::kSilicon{150.0, 130e9, 0.28, 2.6e-6};
+const UnitCellHomogenizer::Material UnitCellHomogenizer::kSolder{58.0, 51e9, 0.36, 21.7e-6};
+const UnitCellHomogenizer::Material UnitCellHomogenizer::kUnderfill{0.5, 8e9, 0.3, 30e-6};
+
+namespace {
+
+bool validMaterial(const UnitCellHomogenizer::Material& m) {
+    return m.conductivity > 0.0 && m.modulus > 0.0 && m.poisson >= 0.0 && m.poisson < 0.5 && std::isfinite(m.expansion);
+}
+
+Eigen::Matrix3d planeStress(const UnitCellHomogenizer::Material& m) {
+    const double c = m.modulus / (1.0 - m.poisson * m.poisson);
+    Eigen::Matrix3d q;
+    q << c, c * m.poisson, 0.0,
+         c * m.poisson, c, 0.0,
+         0.0, 0.0, 0.5 * c * (1.0 - m.poisson);
+    return q;
+}
+
+// Solves the periodic system with the first node's unknowns held at zero,
+// which removes the constant (rigid translation) null space
+class PeriodicSystem {
+public:
+    PeriodicSystem(int dofs, int fixed) : dofs_(dofs), fixed_(fixed) {}
+
+    void add(int row, int col, double value) {
+        if (row >= fixed_ && col >= fixed_) {
+            triplets_.emplace_back(row - fixed_, col - fixed_, value);
+        }
+    }
+
+    void factorize() {
+        Eigen::SparseMatrix<double> k(dofs_ - fixed_, dofs_ - fixed_);
+        k.setFromTriplets(triplets_.begin(), triplets_.end());
+        triplets_.clear();
+        solver_.compute(k);
+        if (solver_.info() != Eigen::Success) {
+            throw std::runtime_error("Unit cell stiffness is singular");
+        }
+    }
+
+    Eigen::VectorXd solve(const Eigen::VectorXd& load) const {
+        Eigen::VectorXd u = Eigen::VectorXd::Zero(dofs_);
+        u.tail(dofs_ - fixed_) = solver_.solve(load.tail(dofs_ - fixed_));
+        return u;
+    }
+
+private:
+    int dofs_;
+    int fixed_;
+    std::vector<Eigen::Triplet<double>> triplets_;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver_;
+};
+
+} // namespace
+
+UnitCellHomogenizer::UnitCellHomogenizer(int resolution) : resolution_(resolution) {
+    if (resolution < 4) {
+        throw std::invalid_argument("Unit cell needs at least 4 elements across");
+    }
+}
+
+UnitCellHomogenizer::Properties UnitCellHomogenizer::solve(double pitch, double diameter, const Material& fill,
+                                                           const Material& matrix) const {
+    if (!(pitch > 0.0) || !(diameter > 0.0 && diameter < pitch)) {
+        throw std::invalid_argument("Unit cell needs a positive pitch and a diameter below it");
+    }
+    if (!validMaterial(fill) || !validMaterial(matrix)) {
+        throw std::invalid_argument("Unit cell materials need positive conductivity and modulus and a Poisson ratio in [0, 0.5)");
+    }
+    const double ratio = diameter / pitch;
+    const Key key = {ratio,
+                     fill.conductivity, fill.modulus, fill.poisson, fill.expansion,
+                     matrix.conductivity, matrix.modulus, matrix.poisson, matrix.expansion};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(key);
+        if (it != cache_.end()) {
+            return it->second;
+        }
+    }
+    // Solved outside the lock; a cell raced by another thread is solved
+    // twice to the same result
+    const Properties properties = compute(0.5 * ratio, fill, matrix);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_.emplace(key, properties).first->second;
+}
+
+std::size_t UnitCellHomogenizer::cached() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_.size();
+}
+
+UnitCellHomogenizer::Properties UnitCellHomogenizer::compute(double radius, const Material& fill,
+                                                             const Material& matrix) const {
+    const int n = resolution_;
+    const double h = 1.0 / n; // The cell is the unit square, the cylinder at its center
+    const auto node = [n](int i, int j) { return (i % n) * n + (j % n); };
+    // Corners counterclockwise from (x, y) = (0, 0); x along j, y along i
+    const int di[4] = {0, 0, 1, 1};
+    const int dj[4] = {0, 1, 1, 0};
+    const double xi[4] = {-1.0, 1.0, 1.0, -1.0};
+    const double eta[4] = {-1.0, -1.0, 1.0, 1.0};
+
+    // Share of each element inside the cylinder, sampled 4 x 4; a cut
+    // element mixes the phases by it
+    constexpr int kSamples = 4;
+    std::vector<double> fraction(static_cast<size_t>(n) * n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            int inside = 0;
+            for (int a = 0; a < kSamples; ++a) {
+                for (int b = 0; b < kSamples; ++b) {
+                    const double x = (j + (b + 0.5) / kSamples) * h - 0.5;
+                    const double y = (i + (a + 0.5) / kSamples) * h - 0.5;
+                    inside += x * x + y * y < radius * radius;
+                }
+            }
+            fraction[i * n + j] = static_cast<double>(inside) / (kSamples * kSamples);
+        }
+    }
+
+    Properties result;
+    const double f = M_PI * radius * radius;
+    result.volume_fraction = f;
+
+    // Conduction across: -div(k (grad phi + e_x)) = 0 for the periodic phi,
+    // k_eff = <k (d phi / dx + 1)>
+    {
+        static const double kLaplace[4][4] = {{4.0, -1.0, -2.0, -1.0},
+                                              {-1.0, 4.0, -1.0, -2.0},
+                                              {-2.0, -1.0, 4.0, -1.0},
+                                              {-1.0, -2.0, -1.0, 4.0}};
+        PeriodicSystem system(n * n, 1);
+        Eigen::VectorXd load = Eigen::VectorXd::Zero(n * n);
+        std::vector<double> k(static_cast<size_t>(n) * n);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                const double fe = fraction[i * n + j];
+                const double ke = fe * fill.conductivity + (1.0 - fe) * matrix.conductivity;
+                k[i * n + j] = ke;
+                for (int a = 0; a < 4; ++a) {
+                    const int row = node(i + di[a], j + dj[a]);
+                    // Integral of dN_a/dx over the element is xi_a h / 2
+                    load(row) -= ke * xi[a] * 0.5 * h;
+                    for (int b = 0; b < 4; ++b) {
+                        system.add(row, node(i + di[b], j + dj[b]), ke * kLaplace[a][b] / 6.0);
+                    }
+                }
+            }
+        }
+        system.factorize();
+        const Eigen::VectorXd phi = system.solve(load);
+        double flux = 0.0;
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                double gradient = h * h;
+                for (int a = 0; a < 4; ++a) {
+                    gradient += xi[a] * 0.5 * h * phi(node(i + di[a], j + dj[a]));
+                }
+                flux += k[i * n + j] * gradient;
+            }
+        }
+        result.conductivity_in_plane = flux;
+    }
+
+    // Plane stress across: the periodic displacement under a mean strain,
+    // or a unit temperature rise, and the mean stress it leaves
+    {
+        const Eigen::Matrix3d q_fill = planeStress(fill), q_matrix = planeStress(matrix);
+        const Eigen::Vector3d unit(1.0, 1.0, 0.0);
+        const Eigen::Vector3d beta_fill = q_fill * unit * fill.expansion;
+        const Eigen::Vector3d beta_matrix = q_matrix * unit * matrix.expansion;
+
+        // Strain-displacement matrices at the 2 x 2 Gauss points of a
+        // square element of side h, and their integral
+        const double g = 1.0 / std::sqrt(3.0);
+        std::vector<Eigen::Matrix<double, 3, 8>> strain;
+        Eigen::Matrix<double, 3, 8> strain_integral = Eigen::Matrix<double, 3, 8>::Zero();
+        const double weight = 0.25 * h * h; // Jacobian determinant, unit Gauss weights
+        for (int p = 0; p < 4; ++p) {
+            const double s = xi[p] * g, t = eta[p] * g;
+            Eigen::Matrix<double, 3, 8> b = Eigen::Matrix<double, 3, 8>::Zero();
+            for (int a = 0; a < 4; ++a) {
+                const double dx = 0.5 * xi[a] * (1.0 + eta[a] * t) / h;
+                const double dy = 0.5 * eta[a] * (1.0 + xi[a] * s) / h;
+                b(0, 2 * a) = dx;
+                b(1, 2 * a + 1) = dy;
+                b(2, 2 * a) = dy;
+                b(2, 2 * a + 1) = dx;
+            }
+            strain.push_back(b);
+            strain_integral += weight * b;
+        }
+
+        PeriodicSystem system(2 * n * n, 2);
+        Eigen::MatrixXd load = Eigen::MatrixXd::Zero(2 * n * n, 2); // Mean strain e_xx = 1; temperature
+        std::vector<Eigen::Matrix3d> q(static_cast<size_t>(n) * n);
+        std::vector<Eigen::Vector3d> beta(static_cast<size_t>(n) * n);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                const double fe = fraction[i * n + j];
+                const Eigen::Matrix3d& qe = q[i * n + j] = fe * q_fill + (1.0 - fe) * q_matrix;
+                const Eigen::Vector3d& be = beta[i * n + j] = fe * beta_fill + (1.0 - fe) * beta_matrix;
+                Eigen::Matrix<double, 8, 8> ke = Eigen::Matrix<double, 8, 8>::Zero();
+                for (const auto& b : strain) {
+                    ke += weight * b.transpose() * qe * b;
+                }
+                const Eigen::Matrix<double, 8, 1> strained = -strain_integral.transpose() * qe.col(0);
+                const Eigen::Matrix<double, 8, 1> heated = strain_integral.transpose() * be;
+                int dof[8];
+                for (int a = 0; a < 4; ++a) {
+                    dof[2 * a] = 2 * node(i + di[a], j + dj[a]);
+                    dof[2 * a + 1] = dof[2 * a] + 1;
+                }
+                for (int r = 0; r < 8; ++r) {
+                    load(dof[r], 0) += strained(r);
+                    load(dof[r], 1) += heated(r);
+                    for (int c = 0; c < 8; ++c) {
+                        system.add(dof[r], dof[c], ke(r, c));
+                    }
+                }
+            }
+        }
+        system.factorize();
+        Eigen::Vector3d stress[2] = {Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero()};
+        for (int c = 0; c < 2; ++c) {
+            const Eigen::VectorXd u = system.solve(load.col(c));
+            const Eigen::Vector3d mean_strain = c == 0 ? Eigen::Vector3d(1.0, 0.0, 0.0) : Eigen::Vector3d::Zero();
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) {
+                    Eigen::Matrix<double, 8, 1> ue;
+                    for (int a = 0; a < 4; ++a) {
+                        const int d = 2 * node(i + di[a], j + dj[a]);
+                        ue(2 * a) = u(d);
+                        ue(2 * a + 1) = u(d + 1);
+                    }
+                    Eigen::Vector3d s = q[i * n + j] * (h * h * mean_strain + strain_integral * ue);
+                    if (c == 1) s -= h * h * beta[i * n + j];
+                    stress[c] += s;
+                }
+            }
+        }
+        const double q11 = stress[0](0), q12 = stress[0](1);
+        result.poisson_in_plane = q12 / q11;
+        result.modulus_in_plane = q11 * (1.0 - result.poisson_in_plane * result.poisson_in_plane);
+        result.expansion_in_plane = -0.5 * (stress[1](0) + stress[1](1)) / (q11 + q12);
+    }
+
+    // Along the cylinders the phases strain together
+    result.conductivity_axial = f * fill.conductivity + (1.0 - f) * matrix.conductivity;
+    result.modulus_axial = f * fill.modulus + (1.0 - f) * matrix.modulus;
+    result.expansion_axial = (f * fill.modulus * fill.expansion + (1.0 - f) * matrix.modulus * matrix.expansion) /
+                             result.modulus_axial;
+    return result;
+}
@@ -0,0 +1,71 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef UNIT_CELL_HOMOGENIZER_HPP
+#define UNIT_CELL_HOMOGENIZER_HPP
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <mutex>
+
+// Effective properties of a square array of cylinders through a matrix,
+// such as TSVs through silicon or micro-bumps in underfill, so that an
+// array of any size enters a thermal or stress analysis as one
+// homogeneous block. Along the cylinders the phases act in parallel and
+// the rule of mixtures is exact. Across them the periodic unit cell is
+// solved on a grid of bilinear elements: conduction under a unit mean
+// gradient, and plane-stress elasticity under unit mean strains and a unit
+// temperature rise, each for a periodic fluctuation whose cell averages
+// give the effective conductivity, stiffness and thermal stress. The
+// result depends on the pitch and diameter only through their ratio, and
+// is cached per ratio and pair of materials.
+class UnitCellHomogenizer {
+public:
+    struct Material {
+        double conductivity; // W/(m K)
+        double modulus;      // Pa
+        double poisson;
+        double expansion;    // 1/K
+    };
+
+    struct Properties {
+        double volume_fraction = 0.0; // Of the cylinders
+        // Across the cylinders the square cell is isotropic in conduction
+        // and in expansion; its stiffness is taken isotropic from the
+        // normal terms, leaving out the shear's small anisotropy
+        double conductivity_in_plane = 0.0; // W/(m K)
+        double modulus_in_plane = 0.0;      // Pa
+        double poisson_in_plane = 0.0;
+        double expansion_in_plane = 0.0;    // 1/K
+        double conductivity_axial = 0.0;
+        double modulus_axial = 0.0;
+        double expansion_axial = 0.0;
+    };
+
+    static const Material kCopper;
+    static const Material kSilicon;
+    static const Material kSolder;    // SAC305
+    static const Material kUnderfill;
+
+    // Elements across the unit cell
+    explicit UnitCellHomogenizer(int resolution = 48);
+
+    int resolution() const { return resolution_; }
+
+    // Throws std::invalid_argument for a pitch that is not positive, a
+    // diameter not in (0, pitch), or a material without positive
+    // conductivity and modulus and a Poisson ratio in [0, 0.5)
+    Properties solve(double pitch, double diameter, const Material& fill, const Material& matrix) const;
+    // Unit cells solved so far
+    std::size_t cached() const;
+
+private:
+    using Key = std::array<double, 9>;
+
+    Properties compute(double radius, const Material& fill, const Material& matrix) const;
+
+    int resolution_;
+    mutable std::mutex mutex_; // Guards cache_
+    mutable std::map<Key, Properties> cache_;
+};
+
+#endif // UNIT_CELL_HOMOGENIZER_HPP
@@ -1,5 +1,6 @@
 #include "oxidation_model.hpp"
 #include "../../core/utils.hpp"
+#include "../../core/arrhenius_table.hpp"
 #include <cmath>
 
 OxidationModel::OxidationModel() {}
@@ -7,15 +8,21 @@ OxidationModel::OxidationModel() {}
 void OxidationModel::simulateOxidation(std::shared_ptr<Wafer> wafer, double temperature, double time) {
   // Enhanced oxidation with atmosphere support
   std::string atmosphere = "dry"; // Default atmosphere
-  double oxide_thickness = calculateEnhancedOxideThickness(temperature, time, atmosphere);
+  const Eigen::ArrayXXd thickness_map =
+      calculateOxideThicknessMap(wafer->getTemperatureProfile(), temperature, time, atmosphere);
+  double oxide_thickness = thickness_map.size() > 0 ? thickness_map.mean()
+                                                    : calculateEnhancedOxideThickness(temperature, time, atmosphere);
 
   // Calculate oxidation stress
   double stress = calculateOxidationStress(oxide_thickness, temperature);
 
+  // The layer records the mean; each cell grows by its own thickness
   wafer->applyLayer(oxide_thickness, "oxide");
-  Logger::getInstance().log("Enhanced oxidation: thickness=" + std::to_string(oxide_thickness) +
-                            "μm, temp=" + std::to_string(temperature) + "°C, time=" + std::to_string(time) +
-                            "h, stress=" + std::to_string(stress) + "MPa");
+  if (thickness_map.size() > 0) {
+    wafer->getGrid() += thickness_map - oxide_thickness;
+  }
+  SEMIPRO_LOGF(INFO, PHYSICS, "Enhanced oxidation: thickness={}μm, temp={}°C, time={}h, stress={}MPa",
+               oxide_thickness, temperature, time, stress);
 }
 
 double OxidationModel::calculateOxideThickness(double temperature, double time) const {
@@ -64,6 +71,29 @@ double OxidationModel::calculateEnhancedOxideThickness(double temperature, doubl
   return std::max(X0, thickness); // Ensure minimum native oxide
 }
 
+Eigen::ArrayXXd OxidationModel::calculateOxideThicknessMap(const Eigen::Ref<const Eigen::ArrayXXd>& temperature_field,
+                                                           double temperature, double time,
+                                                           const std::string& atmosphere) const {
+  if (temperature_field.size() == 0) {
+    return Eigen::ArrayXXd();
+  }
+  // Same constants as calculateEnhancedOxideThickness
+  const double A = atmosphere == "wet" ? 0.090 : 0.165;  // μm
+  const double B0 = atmosphere == "wet" ? 3.86e5 : 1.23e6; // μm²/s
+  const double Ea = atmosphere == "wet" ? 2.05 : 2.0;      // eV
+  const double X0 = 0.002;                                 // Native oxide, μm
+
+  const Eigen::ArrayXXd kelvin = temperature_field - temperature_field.mean() + (temperature + 273.15);
+  const ArrheniusTable arrhenius(Ea, std::max(1.0, kelvin.minCoeff()), std::max(1.0, kelvin.maxCoeff()));
+  const Eigen::ArrayXXd B = B0 * arrhenius(kelvin);
+  const Eigen::ArrayXXd tau = (X0 * X0 + A * X0) / B;
+
+  // X² + AX = B(t + τ) in every cell at once
+  const double time_seconds = time * 3600.0;
+  const Eigen::ArrayXXd thickness = (-A + (A * A + 4.0 * B * (time_seconds + tau)).sqrt()) / 2.0;
+  return thickness.max(X0);
+}
+
 double OxidationModel::calculateOxidationStress(double thickness, double temperature) const {
   // Calculate stress due to volume expansion during oxidation
 
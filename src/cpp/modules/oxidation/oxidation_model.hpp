@@ -13,6 +13,11 @@ public:
 private:
   double calculateOxideThickness(double temperature, double time) const;
   double calculateEnhancedOxideThickness(double temperature, double time, const std::string& atmosphere) const;
+  // calculateEnhancedOxideThickness at every cell, each running above or
+  // below the furnace temperature by as much as the temperature field does
+  // about its mean
+  Eigen::ArrayXXd calculateOxideThicknessMap(const Eigen::Ref<const Eigen::ArrayXXd>& temperature_field,
+                                             double temperature, double time, const std::string& atmosphere) const;
   double calculateOxidationStress(double thickness, double temperature) const;
 };
 
@@ -1,7 +1,54 @@
 #include "packaging_model.hpp"
+#include "../../core/reproducibility.hpp"
+#include "../../core/task_scheduler.hpp"
+#include <cmath>
 #include <stdexcept>
 #include <random>
 
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kEpsilon0 = 8.854e-12; // Vacuum permittivity (F/m)
+constexpr double kMu0Over2Pi = 2e-7; // H/m
+constexpr double kLineResistivity = 1.68e-8; // Cu resistivity (Ohm m)
+
+// Variants tested per task
+constexpr int kVariantGrain = 64;
+
+// Summed thickness of the metal layers, m
+double metalThickness(const Wafer& wafer) {
+  double thickness = 0.0;
+  for (const auto& layer : wafer.getMetalLayers()) {
+    thickness += layer.first * 1e-6; // um to m
+  }
+  return thickness;
+}
+
+} // namespace
+
+WireBondArray::WireBondArray(const std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>>& bonds) {
+  from_row.reserve(bonds.size());
+  from_col.reserve(bonds.size());
+  to_row.reserve(bonds.size());
+  to_col.reserve(bonds.size());
+  for (const auto& bond : bonds) {
+    from_row.push_back(bond.first.first);
+    from_col.push_back(bond.first.second);
+    to_row.push_back(bond.second.first);
+    to_col.push_back(bond.second.second);
+  }
+}
+
+Eigen::ArrayXd WireBondArray::spans() const {
+  const Eigen::Index n = static_cast<Eigen::Index>(size());
+  const auto column = [n](const std::vector<int>& v) {
+    return Eigen::Map<const Eigen::ArrayXi>(v.data(), n).cast<double>();
+  };
+  const Eigen::ArrayXd rows = column(to_row) - column(from_row);
+  const Eigen::ArrayXd cols = column(to_col) - column(from_col);
+  return (rows.square() + cols.square()).sqrt();
+}
+
 PackagingModel::PackagingModel() {}
 
 void PackagingModel::simulatePackaging(std::shared_ptr<Wafer> wafer, double substrate_thickness,
@@ -13,8 +60,8 @@ void PackagingModel::simulatePackaging(std::shared_ptr<Wafer> wafer, double subs
     throw std::invalid_argument("Number of wires cannot be negative");
   }
 
-  Logger::getInstance().log("Simulating packaging: substrate_thickness=" + std::to_string(substrate_thickness) +
-                  " um, material=" + substrate_material + ", wires=" + std::to_string(num_wires));
+  SEMIPRO_LOGF(INFO, PHYSICS, "Simulating packaging: substrate_thickness={} um, material={}, wires={}",
+               substrate_thickness, substrate_material, num_wires);
 
   applyDieBonding(wafer, substrate_thickness, substrate_material);
   applyWireBonding(wafer, num_wires);
@@ -27,7 +74,7 @@ void PackagingModel::applyDieBonding(std::shared_ptr<Wafer> wafer, double substr
 }
 
 void PackagingModel::applyWireBonding(std::shared_ptr<Wafer> wafer, int num_wires) {
-  const Eigen::ArrayXXd& photoresist = wafer->getPhotoresistPattern();
+  const auto& photoresist = wafer->getPhotoresistPattern();
   if (wafer->getMetalLayers().empty()) {
     throw std::runtime_error("No metal layers for wire bonding");
   }
@@ -46,8 +93,7 @@ void PackagingModel::applyWireBonding(std::shared_ptr<Wafer> wafer, int num_wire
     throw std::runtime_error("Insufficient pads for wire bonding");
   }
 
-  std::random_device rd;
-  std::mt19937 gen(rd());
+  std::mt19937 gen(Reproducibility::key("packaging"));
   std::uniform_int_distribution<> dis(0, pads.size() - 1);
   int wires_to_add = std::min(num_wires, static_cast<int>(pads.size() / 2));
 
@@ -70,41 +116,65 @@ void PackagingModel::performElectricalTest(std::shared_ptr<Wafer> wafer, const s
   }
   std::vector<std::pair<std::string, double>> properties;
   if (test_type == "resistance") {
-    double resistance = calculateResistance(wafer);
+    double resistance = evaluate(metalThickness(*wafer), Eigen::ArrayXd(), PackageVariant()).line_resistance;
     properties.emplace_back("Resistance", resistance);
-    Logger::getInstance().log("Electrical test: Resistance = " + std::to_string(resistance) + " Ohms");
+    SEMIPRO_LOGF(INFO, PHYSICS, "Electrical test: Resistance = {} Ohms", resistance);
   } else if (test_type == "capacitance") {
-    double capacitance = calculateCapacitance(wafer);
+    double capacitance = evaluate(metalThickness(*wafer), Eigen::ArrayXd(), PackageVariant()).line_capacitance;
     properties.emplace_back("Capacitance", capacitance);
-    Logger::getInstance().log("Electrical test: Capacitance = " + std::to_string(capacitance) + " pF");
+    SEMIPRO_LOGF(INFO, PHYSICS, "Electrical test: Capacitance = {} pF", capacitance);
   } else {
     throw std::invalid_argument("Unknown test type: " + test_type);
   }
   wafer->setElectricalProperties(properties);
 }
 
-double PackagingModel::calculateResistance(const std::shared_ptr<Wafer>& wafer) {
-  double resistivity = 1.68e-8; // Cu resistivity (Ω·m)
-  double length = 1e-3; // 1 mm
-  double thickness = 0.0;
-  for (const auto& layer : wafer->getMetalLayers()) {
-    thickness += layer.first * 1e-6; // um to m
+std::vector<PackageTestResult> PackagingModel::performElectricalTests(
+    const std::shared_ptr<Wafer>& wafer, const std::vector<PackageVariant>& variants) const {
+  if (wafer->getMetalLayers().empty()) {
+    throw std::runtime_error("No metal layers for electrical testing");
   }
-  double width = 1e-6; // 1 um
-  double area = thickness * width;
-  if (area == 0) return 0.0;
-  return resistivity * length / area; // Ohms
+  for (const PackageVariant& v : variants) {
+    if (!(v.pad_pitch > 0.0 && v.wire_diameter > 0.0 && v.wire_resistivity > 0.0 && v.line_length > 0.0 &&
+          v.line_width > 0.0 && v.line_spacing > 0.0)) {
+      throw std::invalid_argument("Package variant dimensions must be positive");
+    }
+    if (!(v.loop_height > 0.5 * v.wire_diameter)) {
+      throw std::invalid_argument("Wire loop height must exceed the wire radius");
+    }
+  }
+
+  const double thickness = metalThickness(*wafer);
+  const Eigen::ArrayXd spans = WireBondArray(wafer->getWireBonds()).spans();
+  std::vector<PackageTestResult> results(variants.size());
+  TaskScheduler::getInstance().parallelFor(0, static_cast<int>(variants.size()), [&](int begin, int end) {
+    for (int v = begin; v < end; ++v) {
+      results[v] = evaluate(thickness, spans, variants[v]);
+    }
+  }, kVariantGrain);
+  return results;
 }
 
-double PackagingModel::calculateCapacitance(const std::shared_ptr<Wafer>& wafer) {
-  double epsilon = 8.854e-12; // Vacuum permittivity (F/m)
-  double length = 1e-3; // 1 mm
-  double thickness = 0.0;
-  for (const auto& layer : wafer->getMetalLayers()) {
-    thickness += layer.first * 1e-6; // um to m
-  }
-  double area = length * thickness;
-  double distance = 1e-6; // 1 um between lines
-  if (distance == 0 || thickness == 0) return 0.0;
-  return (epsilon * area / distance) * 1e12; // pF
-}
\ No newline at end of file
+PackageTestResult PackagingModel::evaluate(double metal_thickness, const Eigen::ArrayXd& spans,
+                                           const PackageVariant& variant) {
+  PackageTestResult result;
+
+  // Test line over the stack: R = rho L / (t w), the plate capacitance to
+  // its neighbour eps0 L t / s
+  const double length = variant.line_length * 1e-6;
+  const double area = metal_thickness * variant.line_width * 1e-6;
+  result.line_resistance = area > 0.0 ? kLineResistivity * length / area : 0.0;
+  result.line_capacitance = kEpsilon0 * length * metal_thickness / (variant.line_spacing * 1e-6) * 1e12;
+
+  // Each bond is a round wire up the loop height, across its span and down
+  // again, at the loop height over the ground plane: the partial self
+  // inductance mu0 l / 2pi (ln(2l / r) - 3/4) and the wire-over-plane
+  // capacitance 2pi eps0 l / acosh(h / r)
+  const double radius = 0.5 * variant.wire_diameter * 1e-6;
+  const double height = variant.loop_height * 1e-6;
+  const Eigen::ArrayXd wire = spans * (variant.pad_pitch * 1e-6) + 2.0 * height;
+  result.bond_resistance = wire * (variant.wire_resistivity / (kPi * radius * radius));
+  result.bond_inductance = kMu0Over2Pi * 1e9 * wire * ((wire * (2.0 / radius)).log() - 0.75);
+  result.bond_capacitance = wire * (2.0 * kPi * kEpsilon0 * 1e12 / std::acosh(height / radius));
+  return result;
+}
@@ -2,6 +2,39 @@
 #include "packaging_interface.hpp"
 #include "../../core/utils.hpp"
 #include <Eigen/Dense>
+#include <vector>
+
+// Wire bonds as flat arrays of their end pads' grid cells, one entry per
+// bond, so per-bond quantities evaluate as array expressions
+struct WireBondArray {
+  std::vector<int> from_row, from_col, to_row, to_col;
+
+  WireBondArray() = default;
+  explicit WireBondArray(const std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>>& bonds);
+  std::size_t size() const { return from_row.size(); }
+  // Straight-line distance between each bond's pads, in grid cells
+  Eigen::ArrayXd spans() const;
+};
+
+// One package build to test; lengths in um
+struct PackageVariant {
+  double pad_pitch = 50.0;          // Grid cell spacing the bond pads sit on
+  double wire_diameter = 25.0;
+  double loop_height = 150.0;       // Above the ground plane, at each end of the bond
+  double wire_resistivity = 2.2e-8; // Ohm m, Au
+  double line_length = 1000.0;      // On-die test line over the metal stack
+  double line_width = 1.0;
+  double line_spacing = 1.0;
+};
+
+struct PackageTestResult {
+  double line_resistance = 0.0;  // Ohms
+  double line_capacitance = 0.0; // pF
+  // Per bond, in the order of the wafer's wire bonds
+  Eigen::ArrayXd bond_resistance;  // Ohms
+  Eigen::ArrayXd bond_inductance;  // nH
+  Eigen::ArrayXd bond_capacitance; // pF
+};
 
 class PackagingModel : public PackagingInterface {
 public:
@@ -10,9 +43,17 @@ public:
                         const std::string& substrate_material, int num_wires) override;
   void performElectricalTest(std::shared_ptr<Wafer> wafer, const std::string& test_type) override;
 
+  // Line and wire-bond parasitics of the wafer for every variant at once:
+  // the metal stack and the bond spans are read once, then each variant
+  // is an array expression over the bonds. Throws std::runtime_error
+  // without metal layers, std::invalid_argument for a variant with a
+  // dimension that is not positive.
+  std::vector<PackageTestResult> performElectricalTests(const std::shared_ptr<Wafer>& wafer,
+                                                        const std::vector<PackageVariant>& variants) const;
+
 private:
   void applyDieBonding(std::shared_ptr<Wafer> wafer, double substrate_thickness, const std::string& substrate_material);
   void applyWireBonding(std::shared_ptr<Wafer> wafer, int num_wires);
-  double calculateResistance(const std::shared_ptr<Wafer>& wafer);
-  double calculateCapacitance(const std::shared_ptr<Wafer>& wafer);
-};
\ No newline at end of file
+  static PackageTestResult evaluate(double metal_thickness, const Eigen::ArrayXd& spans,
+                                    const PackageVariant& variant);
+};
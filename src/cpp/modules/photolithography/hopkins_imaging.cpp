@@ -0,0 +1,443 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "hopkins_imaging.hpp"
+#include "../../core/distributed_fft.hpp"
+#include "../../core/profiler.hpp"
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+using Complex = HopkinsImaging::Complex;
+using Kernels = HopkinsImaging::Kernels;
+
+constexpr std::uint32_t kKernelFormat = 1;
+constexpr double kWindowResolutions = 6.0; // Kernel window width in lambda / NA
+constexpr int kSourceSteps = 8;            // Source samples per source radius
+
+int floorPowerOfTwo(int n) {
+  int size = 1;
+  while (size * 2 <= n) {
+    size *= 2;
+  }
+  return size;
+}
+
+// u32 size, u32 count, f64 captured, count weights, count size^2 kernels
+std::vector<unsigned char> serialize(const Kernels& kernels) {
+  const std::uint32_t size = static_cast<std::uint32_t>(kernels.size);
+  const std::uint32_t count = static_cast<std::uint32_t>(kernels.weights.size());
+  const std::size_t points = static_cast<std::size_t>(size) * size;
+  std::vector<unsigned char> bytes(2 * sizeof(std::uint32_t) + (1 + count) * sizeof(double) +
+                                   count * points * sizeof(Complex));
+  unsigned char* out = bytes.data();
+  auto put = [&](const void* data, std::size_t length) {
+    std::memcpy(out, data, length);
+    out += length;
+  };
+  put(&size, sizeof(size));
+  put(&count, sizeof(count));
+  put(&kernels.captured, sizeof(double));
+  put(kernels.weights.data(), count * sizeof(double));
+  for (const auto& kernel : kernels.kernels) {
+    put(kernel.data(), points * sizeof(Complex));
+  }
+  return bytes;
+}
+
+// Null if the bytes are not a kernel set
+std::shared_ptr<const Kernels> deserialize(const std::vector<unsigned char>& bytes) {
+  std::uint32_t size = 0, count = 0;
+  if (bytes.size() < 2 * sizeof(std::uint32_t) + sizeof(double)) {
+    return nullptr;
+  }
+  std::memcpy(&size, bytes.data(), sizeof(size));
+  std::memcpy(&count, bytes.data() + sizeof(size), sizeof(count));
+  const std::size_t points = static_cast<std::size_t>(size) * size;
+  if (bytes.size() != 2 * sizeof(std::uint32_t) + (1 + static_cast<std::size_t>(count)) * sizeof(double) +
+                          count * points * sizeof(Complex)) {
+    return nullptr;
+  }
+  auto kernels = std::make_shared<Kernels>();
+  kernels->size = static_cast<int>(size);
+  const unsigned char* in = bytes.data() + 2 * sizeof(std::uint32_t);
+  std::memcpy(&kernels->captured, in, sizeof(double));
+  in += sizeof(double);
+  kernels->weights.resize(count);
+  std::memcpy(kernels->weights.data(), in, count * sizeof(double));
+  in += count * sizeof(double);
+  kernels->kernels.assign(count, std::vector<Complex>(points));
+  for (auto& kernel : kernels->kernels) {
+    std::memcpy(kernel.data(), in, points * sizeof(Complex));
+    in += points * sizeof(Complex);
+  }
+  return kernels;
+}
+
+// A kernel's window wrapped onto the padded grid and transformed
+std::vector<Complex> kernelSpectrum(const std::vector<Complex>& kernel, int size, int rows, int cols,
+                                    const FftBackend& fft) {
+  std::vector<Complex> grid(static_cast<std::size_t>(rows) * cols);
+  for (int a = 0; a < size; ++a) {
+    const int row = a < (size + 1) / 2 ? a : rows - (size - a);
+    for (int b = 0; b < size; ++b) {
+      const int col = b < (size + 1) / 2 ? b : cols - (size - b);
+      grid[static_cast<std::size_t>(row) * cols + col] = kernel[static_cast<std::size_t>(a) * size + b];
+    }
+  }
+  fft.transform(grid.data(), rows, cols, false);
+  return grid;
+}
+
+std::size_t spectraBytes(std::size_t count, int rows, int cols) {
+  return count * static_cast<std::size_t>(rows) * cols * sizeof(Complex);
+}
+
+} // namespace
+
+HopkinsImaging::HopkinsImaging(const std::string& cache_directory, int max_kernels, double energy)
+    : max_kernels_(max_kernels), energy_(energy), kernel_cache_(cache_directory, 256u << 20, 64u << 20) {
+  if (max_kernels <= 0 || !(energy > 0.0 && energy <= 1.0)) {
+    throw std::invalid_argument("Hopkins imaging needs a positive kernel count and an energy in (0, 1]");
+  }
+}
+
+void HopkinsImaging::setFftBackend(std::shared_ptr<FftBackend> backend) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  fft_ = std::move(backend);
+}
+
+HopkinsImaging::Kernels HopkinsImaging::decompose(const Optics& optics, int size, int max_kernels, double energy) {
+  if (!(optics.wavelength > 0.0) || !(optics.na > 0.0 && optics.na <= 1.0) ||
+      !(optics.sigma >= 0.0 && optics.sigma <= 1.0) ||
+      !(optics.sigma_inner >= 0.0 && optics.sigma_inner <= optics.sigma) || !(optics.pitch_x > 0.0) ||
+      !(optics.pitch_y > 0.0) || !std::isfinite(optics.defocus)) {
+    throw std::invalid_argument("Hopkins imaging needs a positive wavelength and pitch, 0 < NA <= 1 and "
+                                "0 <= sigma_inner <= sigma <= 1");
+  }
+  if (size <= 0 || (size & (size - 1)) != 0) {
+    throw std::invalid_argument("Hopkins kernel window must be a power of two, got " + std::to_string(size));
+  }
+  PROFILE_SCOPE("HopkinsImaging::decompose");
+  const double cutoff = optics.na / optics.wavelength;
+
+  // Source points on a square lattice over the disk or annulus, equally
+  // weighted; a point source when none fall inside
+  std::vector<std::pair<double, double>> source;
+  const double radius = optics.sigma * cutoff;
+  const double inner = optics.sigma_inner * cutoff;
+  if (radius > 0.0) {
+    const double step = radius / kSourceSteps;
+    for (int a = -kSourceSteps; a <= kSourceSteps; ++a) {
+      for (int b = -kSourceSteps; b <= kSourceSteps; ++b) {
+        const double r = std::hypot(a * step, b * step);
+        if (r <= radius * (1.0 + 1e-12) && r >= inner * (1.0 - 1e-12)) {
+          source.emplace_back(a * step, b * step);
+        }
+      }
+    }
+  }
+  if (source.empty()) {
+    source.emplace_back(0.0, 0.0);
+  }
+
+  // Window frequencies some shifted pupil reaches
+  struct Frequency {
+    int u, v;
+    double fx, fy;
+  };
+  std::vector<Frequency> frequencies;
+  const double reach = cutoff + radius;
+  for (int u = -size / 2; u < std::max(size / 2, 1); ++u) {
+    for (int v = -size / 2; v < std::max(size / 2, 1); ++v) {
+      const double fx = u / (size * optics.pitch_x);
+      const double fy = v / (size * optics.pitch_y);
+      if (std::hypot(fx, fy) <= reach * (1.0 + 1e-12)) {
+        frequencies.push_back({u, v, fx, fy});
+      }
+    }
+  }
+
+  // A(f, s) = J(s)^(1/2) P(f + s), with defocus as the pupil phase
+  const int nf = static_cast<int>(frequencies.size());
+  const int ns = static_cast<int>(source.size());
+  Eigen::MatrixXcd shifted = Eigen::MatrixXcd::Zero(nf, ns);
+  const double amplitude = 1.0 / std::sqrt(static_cast<double>(ns));
+  for (int j = 0; j < ns; ++j) {
+    for (int i = 0; i < nf; ++i) {
+      const double gx = frequencies[i].fx + source[j].first;
+      const double gy = frequencies[i].fy + source[j].second;
+      const double rho2 = (gx * gx + gy * gy) * optics.wavelength * optics.wavelength;
+      if (rho2 <= optics.na * optics.na * (1.0 + 1e-12)) {
+        const double phase =
+            2.0 * M_PI / optics.wavelength * optics.defocus * (1.0 - std::sqrt(std::max(0.0, 1.0 - rho2)));
+        shifted(i, j) = std::polar(amplitude, phase);
+      }
+    }
+  }
+
+  Kernels result;
+  result.size = size;
+  if (nf == 0) {
+    return result;
+  }
+  const Eigen::MatrixXcd gram = shifted.adjoint() * shifted;
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXcd> solver(gram);
+  const Eigen::VectorXd& values = solver.eigenvalues(); // Ascending
+  const double trace = values.cwiseMax(0.0).sum();
+
+  const Radix2Fft fft;
+  double kept = 0.0;
+  for (int k = ns - 1; k >= 0 && static_cast<int>(result.weights.size()) < max_kernels; --k) {
+    const double weight = values[k];
+    if (!(weight > trace * 1e-12)) {
+      break;
+    }
+    // phi_k = A v_k / |A v_k|, real-space kernel its inverse transform
+    const Eigen::VectorXcd phi = shifted * solver.eigenvectors().col(k) / std::sqrt(weight);
+    std::vector<Complex> kernel(static_cast<std::size_t>(size) * size);
+    for (int i = 0; i < nf; ++i) {
+      const int row = (frequencies[i].u + size) % size;
+      const int col = (frequencies[i].v + size) % size;
+      kernel[static_cast<std::size_t>(row) * size + col] = phi[i];
+    }
+    fft.transform(kernel.data(), size, size, true);
+    result.weights.push_back(weight);
+    result.kernels.push_back(std::move(kernel));
+    kept += weight;
+    if (kept >= energy * trace) {
+      break;
+    }
+  }
+  result.captured = trace > 0.0 ? kept / trace : 0.0;
+  return result;
+}
+
+SemiPRO::CacheKey HopkinsImaging::keyFor(const Optics& optics, int size) const {
+  SemiPRO::ContentHasher hasher;
+  hasher.update_value(kKernelFormat);
+  hasher.update_value(optics.wavelength).update_value(optics.na).update_value(optics.sigma);
+  hasher.update_value(optics.sigma_inner).update_value(optics.defocus);
+  hasher.update_value(optics.pitch_x).update_value(optics.pitch_y);
+  hasher.update_value(size).update_value(max_kernels_).update_value(energy_);
+  return hasher.finish();
+}
+
+std::shared_ptr<const HopkinsImaging::Kernels> HopkinsImaging::kernels(const Optics& optics, int size) const {
+  const SemiPRO::CacheKey key = keyFor(optics, size);
+  if (auto stored = kernel_cache_.lookup(key)) {
+    if (auto kernels = deserialize(*stored)) {
+      return kernels;
+    }
+  }
+  auto kernels = std::make_shared<const Kernels>(decompose(optics, size, max_kernels_, energy_));
+  decompositions_.fetch_add(1, std::memory_order_relaxed);
+  kernel_cache_.store(key, serialize(*kernels));
+  return kernels;
+}
+
+int HopkinsImaging::kernelSize(const Optics& optics, int extent_x, int extent_y) {
+  const double window = kWindowResolutions * optics.wavelength / optics.na;
+  const double pixels = window / std::min(optics.pitch_x, optics.pitch_y);
+  int size = 1;
+  while (size < pixels && size < (1 << 20)) {
+    size <<= 1;
+  }
+  return std::min(size, floorPowerOfTwo(std::max(1, std::min(extent_x, extent_y))));
+}
+
+Eigen::ArrayXXd HopkinsImaging::aerialImage(const Eigen::ArrayXXd& transmission, const Optics& optics, int x_dim,
+                                            int y_dim) const {
+  PROFILE_SCOPE("HopkinsImaging::aerialImage");
+  Eigen::ArrayXXd image = Eigen::ArrayXXd::Zero(std::max(x_dim, 0), std::max(y_dim, 0));
+  PROFILE_CELLS(image.size());
+  convolve(transmission, optics, x_dim, y_dim,
+           [&](const Kernels& set, std::size_t k, const std::vector<Complex>& field, int cols) {
+    const double weight = set.weights[k];
+    for (int i = 0; i < x_dim; ++i) {
+      for (int j = 0; j < y_dim; ++j) {
+        image(i, j) += weight * std::norm(field[static_cast<std::size_t>(i) * cols + j]);
+      }
+    }
+  });
+  return image;
+}
+
+Eigen::ArrayXXd HopkinsImaging::aerialImage(const std::shared_ptr<GridCommunicator>& comm,
+                                            const Eigen::ArrayXXd& transmission, int mask_rows, int mask_cols,
+                                            const Optics& optics, int x_dim, int y_dim) const {
+  PROFILE_SCOPE("HopkinsImaging::aerialImage");
+  const int me = comm->rank(), ranks = comm->size();
+  const SlabDecomposition mask_slabs = SlabDecomposition::balanced(std::max(mask_rows, 0), ranks);
+  const SlabDecomposition image_slabs = SlabDecomposition::balanced(std::max(x_dim, 0), ranks);
+  if (transmission.rows() != mask_slabs.rowCount(me) || (transmission.rows() > 0 && transmission.cols() != mask_cols)) {
+    throw std::invalid_argument("HopkinsImaging: transmission is not this rank's rows of the mask");
+  }
+  Eigen::ArrayXXd image = Eigen::ArrayXXd::Zero(image_slabs.rowCount(me), std::max(y_dim, 0));
+  PROFILE_CELLS(image.size());
+  if (x_dim <= 0 || y_dim <= 0) {
+    return image;
+  }
+  std::shared_ptr<FftBackend> fft;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fft = fft_ ? fft_ : Fft::defaultBackend();
+  }
+
+  // The serial path's padded grid, in row slabs
+  const int extent_x = std::max(x_dim, mask_rows);
+  const int extent_y = std::max(y_dim, mask_cols);
+  const int size = kernelSize(optics, extent_x, extent_y);
+  const int rows = fft->goodSize(extent_x + size / 2);
+  const int cols = fft->goodSize(extent_y + size / 2);
+  const DistributedFft transform(comm, rows, cols, fft);
+  const SlabDecomposition& grid_slabs = transform.rowSlabs();
+  const int first = grid_slabs.firstRow(me), local_rows = grid_slabs.rowCount(me);
+
+  // Mask rows to the grid's slabs, zero past the mask
+  Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> mask_rows_major = transmission;
+  std::vector<double> padded(static_cast<std::size_t>(local_rows) * mask_cols);
+  GridComm::redistributeRows(*comm, mask_slabs, grid_slabs, mask_cols, mask_rows_major.data(), padded.data());
+  std::vector<Complex> mask(static_cast<std::size_t>(local_rows) * cols);
+  for (int i = 0; i < local_rows; ++i) {
+    std::copy_n(padded.begin() + static_cast<std::ptrdiff_t>(i) * mask_cols, mask_cols,
+                mask.begin() + static_cast<std::ptrdiff_t>(i) * cols);
+  }
+  transform.forward(mask);
+
+  // Each rank writes its rows of the wrapped kernel window, as
+  // kernelSpectrum() does on the whole grid
+  const std::shared_ptr<const Kernels> set = kernels(optics, size);
+  std::vector<double> intensity(static_cast<std::size_t>(local_rows) * y_dim, 0.0);
+  std::vector<Complex> field;
+  for (std::size_t k = 0; k < set->kernels.size(); ++k) {
+    field.assign(static_cast<std::size_t>(local_rows) * cols, Complex());
+    for (int a = 0; a < set->size; ++a) {
+      const int row = a < (set->size + 1) / 2 ? a : rows - (set->size - a);
+      if (row < first || row >= first + local_rows) {
+        continue;
+      }
+      for (int b = 0; b < set->size; ++b) {
+        const int col = b < (set->size + 1) / 2 ? b : cols - (set->size - b);
+        field[static_cast<std::size_t>(row - first) * cols + col] =
+            set->kernels[k][static_cast<std::size_t>(a) * set->size + b];
+      }
+    }
+    transform.forward(field);
+    for (std::size_t p = 0; p < field.size(); ++p) {
+      field[p] *= mask[p];
+    }
+    transform.inverse(field);
+    const double weight = set->weights[k];
+    for (int i = 0; i < local_rows; ++i) {
+      for (int j = 0; j < y_dim; ++j) {
+        intensity[static_cast<std::size_t>(i) * y_dim + j] +=
+            weight * std::norm(field[static_cast<std::size_t>(i) * cols + j]);
+      }
+    }
+  }
+
+  // Grid rows to the image's slabs; rows past x_dim are dropped
+  std::vector<double> local(static_cast<std::size_t>(image.rows()) * y_dim);
+  GridComm::redistributeRows(*comm, grid_slabs, image_slabs, y_dim, intensity.data(), local.data());
+  image = Eigen::Map<const Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(
+      local.data(), image.rows(), y_dim);
+  return image;
+}
+
+HopkinsImaging::Fields HopkinsImaging::coherentFields(const Eigen::ArrayXXd& transmission, const Optics& optics,
+                                                      int x_dim, int y_dim) const {
+  PROFILE_SCOPE("HopkinsImaging::coherentFields");
+  Fields result;
+  result.x_dim = std::max(x_dim, 0);
+  result.y_dim = std::max(y_dim, 0);
+  result.kernels = convolve(transmission, optics, x_dim, y_dim,
+                            [&](const Kernels& set, std::size_t k, const std::vector<Complex>& field, int cols) {
+    result.fields.resize(set.kernels.size());
+    std::vector<Complex>& out = result.fields[k];
+    out.resize(static_cast<std::size_t>(x_dim) * y_dim);
+    for (int i = 0; i < x_dim; ++i) {
+      std::copy_n(field.begin() + static_cast<std::ptrdiff_t>(i) * cols, y_dim,
+                  out.begin() + static_cast<std::ptrdiff_t>(i) * y_dim);
+    }
+  });
+  return result;
+}
+
+std::shared_ptr<const HopkinsImaging::Kernels> HopkinsImaging::convolve(const Eigen::ArrayXXd& transmission,
+                                                                       const Optics& optics, int x_dim, int y_dim,
+                                                                       const FieldSink& sink) const {
+  if (x_dim <= 0 || y_dim <= 0) {
+    return nullptr;
+  }
+  std::shared_ptr<FftBackend> fft;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fft = fft_ ? fft_ : Fft::defaultBackend();
+  }
+
+  // Padding the image and mask by half a window keeps the circular
+  // convolutions from wrapping onto the image
+  const int extent_x = std::max(x_dim, static_cast<int>(transmission.rows()));
+  const int extent_y = std::max(y_dim, static_cast<int>(transmission.cols()));
+  const int size = kernelSize(optics, extent_x, extent_y);
+  const int rows = fft->goodSize(extent_x + size / 2);
+  const int cols = fft->goodSize(extent_y + size / 2);
+
+  // A reticle exposed again on the same grid reuses its transform
+  SpectrumCache& cache = SpectrumCache::instance();
+  const std::string backend = fft->name();
+  SemiPRO::ContentHasher mask_hasher;
+  mask_hasher.update_string("hopkins-mask").update_string(backend).update_value(rows).update_value(cols);
+  const Eigen::Index mask_rows = transmission.rows(), mask_cols = transmission.cols();
+  mask_hasher.update_value(mask_rows).update_value(mask_cols);
+  mask_hasher.update(transmission.data(), static_cast<std::size_t>(transmission.size()) * sizeof(double));
+  const SpectrumCache::Entry mask_entry = cache.get(mask_hasher.finish(), "mask", [&]() {
+    std::vector<Complex> mask(static_cast<std::size_t>(rows) * cols);
+    for (int m = 0; m < mask_rows; ++m) {
+      for (int n = 0; n < mask_cols; ++n) {
+        mask[static_cast<std::size_t>(m) * cols + n] = transmission(m, n);
+      }
+    }
+    fft->transform(mask.data(), rows, cols, false);
+    return std::vector<SpectrumCache::Spectrum>{std::move(mask)};
+  });
+  const std::vector<Complex>& mask = mask_entry->front();
+
+  const SemiPRO::CacheKey key = keyFor(optics, size);
+  std::shared_ptr<const Kernels> set = kernels(optics, size);
+  // Spectra too large to keep are made one kernel at a time instead
+  SpectrumCache::Entry cached;
+  if (spectraBytes(set->kernels.size(), rows, cols) <= cache.memoryBudget()) {
+    SemiPRO::ContentHasher spectra_hasher;
+    spectra_hasher.update_string("hopkins-kernels").update_value(key.high).update_value(key.low);
+    spectra_hasher.update_string(backend);
+    spectra_hasher.update_value(rows).update_value(cols);
+    cached = cache.get(spectra_hasher.finish(), "kernel", [&]() {
+      std::vector<SpectrumCache::Spectrum> spectra;
+      for (const auto& kernel : set->kernels) {
+        spectra.push_back(kernelSpectrum(kernel, set->size, rows, cols, *fft));
+      }
+      return spectra;
+    });
+  }
+
+  std::vector<Complex> field(mask.size());
+  std::vector<Complex> scratch;
+  for (std::size_t k = 0; k < set->kernels.size(); ++k) {
+    if (!cached) {
+      scratch = kernelSpectrum(set->kernels[k], set->size, rows, cols, *fft);
+    }
+    const std::vector<Complex>& spectrum = cached ? (*cached)[k] : scratch;
+    for (std::size_t p = 0; p < field.size(); ++p) {
+      field[p] = mask[p] * spectrum[p];
+    }
+    fft->transform(field.data(), rows, cols, true);
+    sink(*set, k, field, cols);
+  }
+  return set;
+}
@@ -0,0 +1,121 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef HOPKINS_IMAGING_HPP
+#define HOPKINS_IMAGING_HPP
+
+#include "../../core/fft.hpp"
+#include "../../core/grid_comm.hpp"
+#include "../../core/performance_utils.hpp"
+#include "../../core/spectrum_cache.hpp"
+#include <Eigen/Dense>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Partially coherent imaging in Hopkins' formulation.
+//
+// The transmission cross coefficient of source J and pupil P,
+// TCC(f1, f2) = sum_s J(s) P(s + f1) P*(s + f2), is decomposed into a
+// sum of coherent systems (SOCS), TCC = sum_k w_k phi_k phi_k^H. The
+// image of a mask amplitude m is then sum_k w_k |h_k * m|^2 with h_k the
+// kernels in real space: one FFT convolution per kernel.
+//
+// The TCC factors as A A^H, A holding the pupil shifted to each source
+// point, so the eigenproblem solved is the source points' Gram matrix
+// A^H A rather than the TCC itself. Kernels live on a square window of
+// image pixels about 6 lambda / NA across, never wider than the image
+// or mask; frequencies past the pixels' Nyquist limit are left out.
+// Mask and kernel spectra on the padded grids go to the process-wide
+// SpectrumCache, so engines and models imaging one reticle share them.
+class HopkinsImaging {
+public:
+  using Complex = FftBackend::Complex;
+
+  struct Optics {
+    double wavelength;  // Same length unit as the pitches and defocus
+    double na;
+    double sigma;       // Source radius as a fraction of NA
+    double sigma_inner; // Annular source inner radius; 0 for a disk
+    double defocus;
+    double pitch_x;     // Image pixel size along rows
+    double pitch_y;     // Image pixel size along columns
+
+    Optics(double wavelength = 193.0, double na = 0.9, double sigma = 0.5, double pitch_x = 10.0,
+           double pitch_y = 10.0)
+        : wavelength(wavelength), na(na), sigma(sigma), sigma_inner(0.0), defocus(0.0), pitch_x(pitch_x),
+          pitch_y(pitch_y) {}
+  };
+
+  // Kernels on a size x size window of image pixels, row-major with
+  // offset 0 at index 0 and negative offsets wrapped; weights descend
+  struct Kernels {
+    int size = 0;
+    std::vector<double> weights;
+    std::vector<std::vector<Complex>> kernels;
+    double captured = 0.0; // Fraction of the TCC trace the kernels keep
+  };
+
+  // Kernel sets are cached by optics and window; with a directory they
+  // also go to disk, so later runs skip the decomposition. At most
+  // max_kernels are kept, fewer once they hold `energy` of the trace.
+  explicit HopkinsImaging(const std::string& cache_directory = "", int max_kernels = 12, double energy = 0.995);
+
+  // Fft::defaultBackend() until set
+  void setFftBackend(std::shared_ptr<FftBackend> backend);
+
+  // Throws std::invalid_argument for unphysical optics
+  static Kernels decompose(const Optics& optics, int size, int max_kernels, double energy);
+  std::shared_ptr<const Kernels> kernels(const Optics& optics, int size) const;
+  // Window for an image and mask of the given extents
+  static int kernelSize(const Optics& optics, int extent_x, int extent_y);
+
+  // Intensity on x_dim x y_dim pixels of a mask's amplitude transmission,
+  // zero past its rows and cols; an open frame images to about 1
+  Eigen::ArrayXXd aerialImage(const Eigen::ArrayXXd& transmission, const Optics& optics, int x_dim,
+                              int y_dim) const;
+
+  // aerialImage() of a mask and image split by rows across the ranks of a
+  // communicator (SlabDecomposition::balanced): transmission holds this
+  // rank's rows of a mask_rows x mask_cols mask and the result is this
+  // rank's rows of the x_dim x y_dim image. The padded grid and kernels
+  // are the serial ones; the transforms are a DistributedFft's, so no
+  // rank holds a whole spectrum, and neither goes to the SpectrumCache.
+  // Collective.
+  Eigen::ArrayXXd aerialImage(const std::shared_ptr<GridCommunicator>& comm, const Eigen::ArrayXXd& transmission,
+                              int mask_rows, int mask_cols, const Optics& optics, int x_dim, int y_dim) const;
+
+  // The coherent images h_k * m behind aerialImage(), x_dim x y_dim and
+  // row-major, one per kernel: the intensity is sum_k w_k |field_k|^2.
+  // They are linear in the mask, so a mask edit changes each by the
+  // kernel convolved with the edit alone.
+  struct Fields {
+    std::shared_ptr<const Kernels> kernels;
+    int x_dim = 0, y_dim = 0;
+    std::vector<std::vector<Complex>> fields;
+  };
+  Fields coherentFields(const Eigen::ArrayXXd& transmission, const Optics& optics, int x_dim, int y_dim) const;
+
+  // Kernel sets computed rather than found in a cache
+  std::size_t decompositions() const { return decompositions_.load(std::memory_order_relaxed); }
+
+private:
+  SemiPRO::CacheKey keyFor(const Optics& optics, int size) const;
+  // Kernel k's field on the padded grid, cols wide
+  using FieldSink = std::function<void(const Kernels& kernels, std::size_t k, const std::vector<Complex>& field,
+                                       int cols)>;
+  // Null when the image is empty
+  std::shared_ptr<const Kernels> convolve(const Eigen::ArrayXXd& transmission, const Optics& optics, int x_dim,
+                                          int y_dim, const FieldSink& sink) const;
+
+  int max_kernels_;
+  double energy_;
+  std::shared_ptr<FftBackend> fft_;
+  mutable SemiPRO::SimulationCache kernel_cache_;
+  mutable std::mutex mutex_;
+  mutable std::atomic<std::size_t> decompositions_{0};
+};
+
+#endif // HOPKINS_IMAGING_HPP
@@ -9,6 +9,8 @@ class LithographyInterface {
 public:
   virtual ~LithographyInterface() = default;
   virtual void simulateExposure(std::shared_ptr<Wafer> wafer, double wavelength, double na, const std::vector<std::vector<int>>& mask) = 0;
+  // Mask cells set where the reticle is clear, e.g. from rasterizeLayout
+  virtual void simulateExposure(std::shared_ptr<Wafer> wafer, double wavelength, double na, const BitMask& mask) = 0;
   virtual void simulateMultiPatterning(std::shared_ptr<Wafer> wafer, double wavelength, double na, const std::vector<std::vector<std::vector<int>>>& masks) = 0;
 };
 
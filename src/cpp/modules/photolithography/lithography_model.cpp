@@ -1,67 +1,464 @@
 #include "lithography_model.hpp"
 #include "../../core/utils.hpp"
+#include "../../core/profiler.hpp"
+#include "../../core/task_scheduler.hpp"
+#include "../../core/vector_math.hpp"
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <stdexcept>
 
 LithographyModel::LithographyModel() {}
 
+void LithographyModel::setFftBackend(std::shared_ptr<FftBackend> backend) { fft_ = std::move(backend); }
+
+void LithographyModel::setHopkinsImaging(std::shared_ptr<HopkinsImaging> imaging) { hopkins_ = std::move(imaging); }
+
+void LithographyModel::setResistDevelopment(std::shared_ptr<const ResistDevelopment> development,
+                                            double develop_time, const ResistDevelopment::Options& options) {
+  development_ = std::move(development);
+  develop_time_ = develop_time;
+  development_options_ = options;
+}
+
+ResistDevelopment::Profile LithographyModel::developExposure(const ResistDevelopment& development,
+                                                             const BitMask& mask, double wavelength, double na,
+                                                             int x_dim, int y_dim, double pitch_x, double pitch_y,
+                                                             const ResistDevelopment::Options& options) const {
+  if ((pitch_x > 0.0) != (pitch_y > 0.0)) {
+    throw std::invalid_argument("Development pitches must both be set or both be 0");
+  }
+  const double cell_area = pitch_x > 0.0 ? pitch_x * pitch_y : 1.0;
+  const Exposure exposure =
+      prepareExposure(wavelength, na, x_dim, y_dim, mask.rows(), mask.cols(), pitch_x, pitch_y, cell_area);
+  return development.develop(computeAerialImage(mask, exposure), exposure.pitch_x, exposure.pitch_y, options);
+}
+
 void LithographyModel::simulateExposure(std::shared_ptr<Wafer> wafer, double wavelength, double na,
                                        const std::vector<std::vector<int>>& mask) {
+  simulateExposure(wafer, wavelength, na, toBitMask(mask));
+}
+
+void LithographyModel::simulateExposure(std::shared_ptr<Wafer> wafer, double wavelength, double na,
+                                       const BitMask& mask) {
   int x_dim = wafer->getGrid().rows();
   int y_dim = wafer->getGrid().cols();
+  if (development_) {
+    const auto profile = developExposure(*development_, mask, wavelength, na, x_dim, y_dim, 0.0, 0.0,
+                                         development_options_);
+    wafer->setPhotoresistMask(profile.cleared(develop_time_));
+    SEMIPRO_LOGF(INFO, PHYSICS, "Exposure simulated and developed for {}s: wavelength={}nm, NA={}", develop_time_,
+                 wavelength, na);
+    return;
+  }
   auto aerial_image = computeAerialImage(mask, wavelength, na, x_dim, y_dim);
 
-  // Threshold aerial image with sigmoid for smoother transitions
-  Eigen::ArrayXXd pattern = 1.0 / (1.0 + (-10.0 * (aerial_image - 0.5)).exp());
-  pattern = (pattern > 0.5).cast<double>();
-  wafer->setPhotoresistPattern(pattern);
+  // The sigmoid resist response 1 / (1 + exp(-10 (I - 0.5))) exceeds 0.5
+  // exactly where I > 0.5, so threshold the image straight into a mask
+  wafer->setPhotoresistMask(BitMask::fromPredicate(x_dim, y_dim, [&](int i, int j) {
+    return aerial_image(i, j) > 0.5;
+  }));
 
-  Logger::getInstance().log("Exposure simulated: wavelength=" + std::to_string(wavelength) +
-                            "nm, NA=" + std::to_string(na));
+  SEMIPRO_LOGF(INFO, PHYSICS, "Exposure simulated: wavelength={}nm, NA={}", wavelength, na);
 }
 
 void LithographyModel::simulateMultiPatterning(std::shared_ptr<Wafer> wafer, double wavelength, double na,
                                               const std::vector<std::vector<std::vector<int>>>& masks) {
+  PROFILE_SCOPE("LithographyModel::simulateMultiPatterning");
   int x_dim = wafer->getGrid().rows();
   int y_dim = wafer->getGrid().cols();
-  Eigen::ArrayXXd combined_pattern = Eigen::ArrayXXd::Zero(x_dim, y_dim);
 
+  // Every mask is imaged with the same optics on one padded grid
+  std::vector<BitMask> bits;
+  bits.reserve(masks.size());
+  int mask_rows = 0, mask_cols = 0;
   for (const auto& mask : masks) {
-    auto aerial_image = computeAerialImage(mask, wavelength, na, x_dim, y_dim);
-    Eigen::ArrayXXd pattern = 1.0 / (1.0 + (-10.0 * (aerial_image - 0.5)).exp());
-    pattern = (pattern > 0.5).cast<double>();
-    combined_pattern = combined_pattern.max(pattern);
+    bits.push_back(toBitMask(mask));
+    mask_rows = std::max(mask_rows, bits.back().rows());
+    mask_cols = std::max(mask_cols, bits.back().cols());
   }
+  const Exposure exposure = prepareExposure(wavelength, na, x_dim, y_dim, mask_rows, mask_cols);
 
-  wafer->setPhotoresistPattern(combined_pattern);
-  Logger::getInstance().log("Multi-patterning simulated: " + std::to_string(masks.size()) +
-                            " masks, wavelength=" + std::to_string(wavelength) + "nm, NA=" + std::to_string(na));
+  // The masks convolve in parallel. A Hopkins engine builds its kernel
+  // spectra on first use, so the first mask goes alone.
+  std::vector<Eigen::ArrayXXd> images(bits.size());
+  const int count = static_cast<int>(bits.size());
+  const int first = hopkins_ && count > 0 ? 1 : 0;
+  if (first == 1) {
+    images[0] = computeAerialImage(bits[0], exposure);
+  }
+#pragma omp parallel for schedule(dynamic)
+  for (int k = first; k < count; ++k) {
+    images[k] = computeAerialImage(bits[k], exposure);
+  }
+
+  // Any mask's sigmoid response passing 0.5 sets the cell, so threshold
+  // the brightest exposure of each cell in one pass
+  wafer->setPhotoresistMask(BitMask::fromPredicate(x_dim, y_dim, [&](int i, int j) {
+    double peak = 0.0;
+    for (const auto& image : images) {
+      peak = std::max(peak, image(i, j));
+    }
+    return peak > 0.5;
+  }));
+  SEMIPRO_LOGF(INFO, PHYSICS, "Multi-patterning simulated: {} masks, wavelength={}nm, NA={}",
+               masks.size(), wavelength, na);
 }
 
-Eigen::ArrayXXd LithographyModel::computeAerialImage(const std::vector<std::vector<int>>& mask, double wavelength,
-                                                    double na, int x_dim, int y_dim) const {
-  Eigen::ArrayXXd aerial_image = Eigen::ArrayXXd::Zero(x_dim, y_dim);
-  double k1 = 0.25; // Process factor
-  double resolution = k1 * wavelength / na; // um
-  double sigma = 0.5; // Partial coherence factor
-  double sigma_psf = resolution * sigma; // Gaussian PSF width
+LithographyModel::MaskSource LithographyModel::maskSource(BitMask mask) {
+  auto held = std::make_shared<const BitMask>(std::move(mask));
+  return [held](int row, int col, int rows, int cols) {
+    return BitMask::fromPredicate(rows, cols, [&](int i, int j) {
+      const int m = row + i;
+      const int n = col + j;
+      return m >= 0 && n >= 0 && m < held->rows() && n < held->cols() && held->test(m, n);
+    });
+  };
+}
 
-  // Partially coherent imaging with Gaussian PSF
-  for (int i = 0; i < x_dim; ++i) {
-    for (int j = 0; j < y_dim; ++j) {
-      double intensity = 0.0;
-      for (size_t m = 0; m < mask.size(); ++m) {
-        for (size_t n = 0; n < mask[0].size(); ++n) {
-          if (mask[m][n] == 1) {
-            double dx = (i - m) * resolution / x_dim;
-            double dy = (j - n) * resolution / y_dim;
-            double r2 = dx * dx + dy * dy;
-            intensity += std::exp(-r2 / (2 * sigma_psf * sigma_psf)); // Gaussian PSF
+std::vector<LithographyModel::ExposureTile> LithographyModel::planExposureTiles(
+    int x_dim, int y_dim, double wavelength, double na, const TiledExposureOptions& options) const {
+  if (options.tile_size <= 0) {
+    throw std::invalid_argument("Exposure tiles need a positive size");
+  }
+  if ((options.pitch_x > 0.0) != (options.pitch_y > 0.0)) {
+    throw std::invalid_argument("Exposure tile pitches must both be set or both be 0");
+  }
+  std::vector<ExposureTile> tiles;
+  if (x_dim <= 0 || y_dim <= 0) {
+    return tiles;
+  }
+  const double resolution = 0.25 * wavelength / na;
+  const bool field = options.pitch_x <= 0.0;
+  const double pitch_x = field ? resolution / x_dim : options.pitch_x;
+  const double pitch_y = field ? resolution / y_dim : options.pitch_y;
+  const double cell_area = field ? 1.0 : pitch_x * pitch_y;
+
+  // The halo holds every mask cell a tile's kernel reaches: half Hopkins'
+  // window at its full width, or kPsfAmbit widths of the Gaussian PSF.
+  // Mask cells more than the field's extent past it are left out.
+  int halo_rows, halo_cols;
+  if (hopkins_) {
+    const HopkinsImaging::Optics optics(wavelength, na, kPartialCoherence, pitch_x, pitch_y);
+    const int unbounded = std::numeric_limits<int>::max();
+    const int half_window = HopkinsImaging::kernelSize(optics, unbounded, unbounded) / 2;
+    halo_rows = std::min(half_window, x_dim);
+    halo_cols = std::min(half_window, y_dim);
+  } else {
+    const double reach = kPsfAmbit * kPartialCoherence * resolution;
+    halo_rows = static_cast<int>(std::min<double>(std::ceil(reach / pitch_x), x_dim));
+    halo_cols = static_cast<int>(std::min<double>(std::ceil(reach / pitch_y), y_dim));
+  }
+
+  // Tiles start on word boundaries, so no two share a word of the resist
+  const int size = (std::min(options.tile_size, std::max(x_dim, y_dim)) + 63) / 64 * 64;
+  for (int row = 0; row < x_dim; row += size) {
+    for (int col = 0; col < y_dim; col += size) {
+      tiles.push_back({row, col, std::min(size, x_dim - row), std::min(size, y_dim - col), halo_rows, halo_cols,
+                       pitch_x, pitch_y, cell_area});
+    }
+  }
+  return tiles;
+}
+
+BitMask LithographyModel::exposeTile(const ExposureTile& tile, double wavelength, double na,
+                                     const MaskSource& source) const {
+  PROFILE_SCOPE("LithographyModel::exposeTile");
+  const int window_rows = tile.rows + 2 * tile.halo_rows;
+  const int window_cols = tile.cols + 2 * tile.halo_cols;
+  const BitMask mask = source(tile.row - tile.halo_rows, tile.col - tile.halo_cols, window_rows, window_cols);
+  if (mask.rows() != window_rows || mask.cols() != window_cols) {
+    throw std::invalid_argument("Mask source returned " + std::to_string(mask.rows()) + "x" +
+                                std::to_string(mask.cols()) + " cells for a " + std::to_string(window_rows) +
+                                "x" + std::to_string(window_cols) + " window");
+  }
+  const Exposure exposure = prepareExposure(wavelength, na, window_rows, window_cols, window_rows, window_cols,
+                                            tile.pitch_x, tile.pitch_y, tile.cell_area);
+  const Eigen::ArrayXXd image = computeAerialImage(mask, exposure);
+  return BitMask::fromPredicate(tile.rows, tile.cols, [&](int i, int j) {
+    return image(i + tile.halo_rows, j + tile.halo_cols) > 0.5;
+  });
+}
+
+void LithographyModel::simulateTiledExposure(std::shared_ptr<Wafer> wafer, double wavelength, double na,
+                                             const MaskSource& source, const TiledExposureOptions& options) {
+  PROFILE_SCOPE("LithographyModel::simulateTiledExposure");
+  const int x_dim = wafer->getGrid().rows();
+  const int y_dim = wafer->getGrid().cols();
+  const std::vector<ExposureTile> tiles = planExposureTiles(x_dim, y_dim, wavelength, na, options);
+
+  BitMask resist(x_dim, y_dim);
+  auto expose = [&](int k) {
+    const ExposureTile& tile = tiles[k];
+    exposeTile(tile, wavelength, na, source).forEachSet([&](int i, int j) {
+      resist.set(tile.row + i, tile.col + j);
+    });
+  };
+  // As in multi-patterning, a Hopkins engine's first tile builds the
+  // kernels the rest share
+  const int count = static_cast<int>(tiles.size());
+  const int first = hopkins_ && count > 0 ? 1 : 0;
+  if (first == 1) {
+    expose(0);
+  }
+  TaskScheduler::getInstance().parallelFor(first, count, [&](int begin, int end) {
+    for (int k = begin; k < end; ++k) {
+      expose(k);
+    }
+  }, 1);
+  wafer->setPhotoresistMask(std::move(resist));
+
+  SEMIPRO_LOGF(INFO, PHYSICS, "Tiled exposure simulated: {} tiles, wavelength={}nm, NA={}", tiles.size(),
+               wavelength, na);
+}
+
+std::vector<LithographyModel::ExposureField> LithographyModel::planShotMap(int x_dim, int y_dim, int field_rows,
+                                                                         int field_cols) {
+  if (field_rows <= 0 || field_cols <= 0) {
+    throw std::invalid_argument("Exposure fields need a positive size");
+  }
+  std::vector<ExposureField> fields;
+  if (x_dim <= 0 || y_dim <= 0) {
+    return fields;
+  }
+  const int across = (x_dim + field_rows - 1) / field_rows;
+  const int down = (y_dim + field_cols - 1) / field_cols;
+  const int row0 = -(across * field_rows - x_dim) / 2;
+  const int col0 = -(down * field_cols - y_dim) / 2;
+  fields.reserve(static_cast<size_t>(across) * down);
+  for (int a = 0; a < across; ++a) {
+    for (int d = 0; d < down; ++d) {
+      fields.emplace_back(row0 + a * field_rows, col0 + d * field_cols);
+    }
+  }
+  return fields;
+}
+
+void LithographyModel::simulateFieldExposure(std::shared_ptr<Wafer> wafer, double wavelength, double na,
+                                             const BitMask& reticle, const std::vector<ExposureField>& fields,
+                                             double pitch_x, double pitch_y) {
+  PROFILE_SCOPE("LithographyModel::simulateFieldExposure");
+  if ((pitch_x > 0.0) != (pitch_y > 0.0)) {
+    throw std::invalid_argument("Exposure field pitches must both be set or both be 0");
+  }
+  for (const auto& field : fields) {
+    if (!(field.dose > 0.0)) {
+      throw std::invalid_argument("Exposure field at (" + std::to_string(field.row) + ", " +
+                                  std::to_string(field.col) + ") needs a positive dose");
+    }
+  }
+  const int x_dim = wafer->getGrid().rows();
+  const int y_dim = wafer->getGrid().cols();
+  const int rows = reticle.rows();
+  const int cols = reticle.cols();
+  const double cell_area = pitch_x > 0.0 ? pitch_x * pitch_y : 1.0;
+
+  // One image per distinct focus. The reticle images onto its own extent:
+  // past it the mask is opaque, so no halo is needed.
+  std::vector<double> focuses;
+  std::vector<int> group(fields.size());
+  for (size_t f = 0; f < fields.size(); ++f) {
+    auto it = std::find(focuses.begin(), focuses.end(), fields[f].focus);
+    group[f] = static_cast<int>(it - focuses.begin());
+    if (it == focuses.end()) {
+      focuses.push_back(fields[f].focus);
+    }
+  }
+  std::vector<Eigen::ArrayXXd> images(focuses.size());
+  auto image = [&](int k) {
+    const Exposure exposure =
+        prepareExposure(wavelength, na, rows, cols, rows, cols, pitch_x, pitch_y, cell_area, focuses[k]);
+    images[k] = computeAerialImage(reticle, exposure);
+  };
+  // As with tiles, a Hopkins engine's first image builds the kernels of
+  // its focus alone
+  const int count = static_cast<int>(focuses.size());
+  const int first = hopkins_ && count > 0 ? 1 : 0;
+  if (first == 1) {
+    image(0);
+  }
+  TaskScheduler::getInstance().parallelFor(first, count, [&](int begin, int end) {
+    for (int k = begin; k < end; ++k) {
+      image(k);
+    }
+  }, 1);
+
+  // Each task owns whole rows of the resist, and so their words
+  BitMask resist(x_dim, y_dim);
+  TaskScheduler::getInstance().parallelFor(0, x_dim, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      for (size_t f = 0; f < fields.size(); ++f) {
+        const ExposureField& field = fields[f];
+        const int r = i - field.row;
+        if (r < 0 || r >= rows) {
+          continue;
+        }
+        const Eigen::ArrayXXd& intensity = images[group[f]];
+        const double threshold = 0.5 / field.dose;
+        const int j_end = std::min(y_dim, field.col + cols);
+        int run = -1;
+        for (int j = std::max(0, field.col); j < j_end; ++j) {
+          const bool clear = intensity(r, j - field.col) > threshold;
+          if (clear && run < 0) {
+            run = j;
+          } else if (!clear && run >= 0) {
+            resist.setSpan(i, run, j);
+            run = -1;
           }
         }
+        if (run >= 0) {
+          resist.setSpan(i, run, j_end);
+        }
       }
-      aerial_image(i, j) = std::clamp(intensity / (2 * M_PI * sigma_psf * sigma_psf), 0.0, 1.0);
+    }
+  });
+  wafer->setPhotoresistMask(std::move(resist));
+
+  SEMIPRO_LOGF(INFO, PHYSICS, "Field exposure simulated: {} fields, {} focus images, wavelength={}nm, NA={}",
+               fields.size(), focuses.size(), wavelength, na);
+}
+
+BitMask LithographyModel::toBitMask(const std::vector<std::vector<int>>& mask) {
+  const int cols = mask.empty() ? 0 : static_cast<int>(mask[0].size());
+  return BitMask::fromPredicate(static_cast<int>(mask.size()), cols, [&](int m, int n) { return mask[m][n] == 1; });
+}
+
+Eigen::ArrayXXd LithographyModel::computeAerialImage(const BitMask& mask, double wavelength, double na, int x_dim,
+                                                    int y_dim) const {
+  return computeAerialImage(mask, prepareExposure(wavelength, na, x_dim, y_dim, mask.rows(), mask.cols()));
+}
+
+LithographyModel::Exposure LithographyModel::prepareExposure(double wavelength, double na, int x_dim, int y_dim,
+                                                             int mask_rows, int mask_cols, double pitch_x,
+                                                             double pitch_y, double cell_area, double defocus) const {
+  Exposure exposure{wavelength, na, kPartialCoherence, defocus, pitch_x, pitch_y, cell_area, x_dim, y_dim,
+                    mask_rows, mask_cols, 0, 0, nullptr, nullptr};
+  if (x_dim <= 0 || y_dim <= 0) {
+    return exposure;
+  }
+  const double resolution = 0.25 * wavelength / na;
+  if (pitch_x <= 0.0) {
+    exposure.pitch_x = resolution / x_dim;
+    exposure.pitch_y = resolution / y_dim;
+  }
+  if (hopkins_) {
+    return exposure;
+  }
+  // The blur disk of radius |defocus| NA spreads 1/2 of that along an axis
+  const double blur = 0.5 * std::abs(defocus) * na / resolution;
+  exposure.sigma = std::sqrt(kPartialCoherence * kPartialCoherence + blur * blur);
+  // Padding past the image plus the mask keeps the circular convolution
+  // from wrapping onto the image
+  exposure.fft = fft_ ? fft_ : Fft::defaultBackend();
+  exposure.rows = exposure.fft->goodSize(x_dim + mask_rows - 1);
+  exposure.cols = exposure.fft->goodSize(y_dim + mask_cols - 1);
+  const PsfKey key{wavelength, na, exposure.sigma, exposure.pitch_x, exposure.pitch_y, x_dim, y_dim,
+                   exposure.rows, exposure.cols, exposure.fft->name()};
+  exposure.psf = psfSpectrum(*exposure.fft, key);
+  return exposure;
+}
+
+Eigen::ArrayXXd LithographyModel::computeAerialImage(const BitMask& mask, const Exposure& exposure) const {
+  PROFILE_SCOPE("LithographyModel::computeAerialImage");
+  const int x_dim = exposure.x_dim;
+  const int y_dim = exposure.y_dim;
+  Eigen::ArrayXXd aerial_image = Eigen::ArrayXXd::Zero(std::max(x_dim, 0), std::max(y_dim, 0));
+  PROFILE_CELLS(aerial_image.size());
+  if (x_dim <= 0 || y_dim <= 0 || mask.count() == 0) {
+    return aerial_image;
+  }
+  double k1 = 0.25; // Process factor
+  double resolution = k1 * exposure.wavelength / exposure.na; // um
+  double sigma_psf = resolution * exposure.sigma; // Gaussian PSF width
+
+  if (hopkins_) {
+    // The mask pads to the exposure's extent so every mask shares kernels
+    HopkinsImaging::Optics optics(exposure.wavelength, exposure.na, exposure.sigma, exposure.pitch_x,
+                                  exposure.pitch_y);
+    optics.defocus = exposure.defocus;
+    Eigen::ArrayXXd transmission = Eigen::ArrayXXd::Zero(exposure.mask_rows, exposure.mask_cols);
+    mask.forEachSet([&](int m, int n) { transmission(m, n) = 1.0; });
+    return hopkins_->aerialImage(transmission, optics, x_dim, y_dim).min(1.0).max(0.0);
+  }
+
+  // Partially coherent imaging with Gaussian PSF: the image is the clear
+  // cells convolved with the PSF, done as a product of spectra
+  const int rows = exposure.rows;
+  const int cols = exposure.cols;
+  std::vector<double> image(static_cast<size_t>(rows) * cols);
+  {
+    PROFILE_SCOPE("LithographyModel::computeAerialImage/fft");
+    Spectrum spectrum = *maskSpectrum(mask, exposure);
+    for (size_t k = 0; k < spectrum.size(); ++k) {
+      spectrum[k] *= (*exposure.psf)[k];
+    }
+    exposure.fft->inverse(spectrum.data(), image.data(), rows, cols);
+  }
+
+  const double normalization = exposure.cell_area / (2 * M_PI * sigma_psf * sigma_psf);
+  for (int i = 0; i < x_dim; ++i) {
+    for (int j = 0; j < y_dim; ++j) {
+      aerial_image(i, j) = std::clamp(image[static_cast<size_t>(i) * cols + j] * normalization, 0.0, 1.0);
     }
   }
 
   return aerial_image;
-}
\ No newline at end of file
+}
+
+std::shared_ptr<const LithographyModel::Spectrum> LithographyModel::psfSpectrum(const FftBackend& fft,
+                                                                               const PsfKey& key) const {
+  SemiPRO::ContentHasher hasher;
+  hasher.update_string("gaussian-psf").update_string(key.backend);
+  hasher.update_value(key.wavelength).update_value(key.na).update_value(key.sigma);
+  hasher.update_value(key.pitch_x).update_value(key.pitch_y);
+  hasher.update_value(key.x_dim).update_value(key.y_dim).update_value(key.rows).update_value(key.cols);
+  const SpectrumCache::Entry entry = SpectrumCache::instance().get(hasher.finish(), "psf", [&]() {
+    // The PSF at offset d sits at index d mod the padded size. It is
+    // separable, so one exp table per axis builds it, a cell one pitch
+    // step in each.
+    const double resolution = 0.25 * key.wavelength / key.na;
+    const double sigma_psf = resolution * key.sigma;
+    auto axis = [&](int size, int dim, double pitch) {
+      std::vector<double> offsets(size);
+      for (int p = 0; p < size; ++p) {
+        offsets[p] = (p < dim ? p : p - size) * pitch;
+      }
+      std::vector<double> weights(size);
+      VectorMath::gaussian(offsets.data(), weights.data(), size, 0.0, sigma_psf, 1.0);
+      return weights;
+    };
+    const std::vector<double> gx = axis(key.rows, key.x_dim, key.pitch_x);
+    const std::vector<double> gy = axis(key.cols, key.y_dim, key.pitch_y);
+    std::vector<double> kernel(static_cast<size_t>(key.rows) * key.cols);
+    for (int p = 0; p < key.rows; ++p) {
+      for (int q = 0; q < key.cols; ++q) {
+        kernel[static_cast<size_t>(p) * key.cols + q] = gx[p] * gy[q];
+      }
+    }
+    Spectrum spectrum(static_cast<size_t>(key.rows) * (key.cols / 2 + 1));
+    fft.forward(kernel.data(), spectrum.data(), key.rows, key.cols);
+    return std::vector<Spectrum>{std::move(spectrum)};
+  });
+  return std::shared_ptr<const Spectrum>(entry, &entry->front());
+}
+
+std::shared_ptr<const LithographyModel::Spectrum> LithographyModel::maskSpectrum(const BitMask& mask,
+                                                                                const Exposure& exposure) const {
+  // Keyed by the packed mask, so a reticle exposed again on the same grid
+  // skips its forward transform
+  SemiPRO::ContentHasher hasher;
+  hasher.update_string("gaussian-mask").update_string(exposure.fft->name());
+  hasher.update_value(exposure.rows).update_value(exposure.cols);
+  hasher.update_value(mask.rows()).update_value(mask.cols());
+  hasher.update(mask.words().data(), mask.words().size() * sizeof(std::uint64_t));
+  const SpectrumCache::Entry entry = SpectrumCache::instance().get(hasher.finish(), "mask", [&]() {
+    const int rows = exposure.rows;
+    const int cols = exposure.cols;
+    std::vector<double> image(static_cast<size_t>(rows) * cols, 0.0);
+    mask.forEachSet([&](int m, int n) { image[static_cast<size_t>(m) * cols + n] = 1.0; });
+    Spectrum spectrum(static_cast<size_t>(rows) * (cols / 2 + 1));
+    exposure.fft->forward(image.data(), spectrum.data(), rows, cols);
+    return std::vector<Spectrum>{std::move(spectrum)};
+  });
+  return std::shared_ptr<const Spectrum>(entry, &entry->front());
+}
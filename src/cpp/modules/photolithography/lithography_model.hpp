@@ -1,19 +1,154 @@
 #ifndef LITHOGRAPHY_MODEL_HPP
 #define LITHOGRAPHY_MODEL_HPP
 
+#include "hopkins_imaging.hpp"
 #include "lithography_interface.hpp"
+#include "resist_development.hpp"
+#include "../../core/fft.hpp"
+#include "../../core/spectrum_cache.hpp"
 #include "../../core/wafer.hpp"
 #include <Eigen/Dense>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
 class LithographyModel : public LithographyInterface {
 public:
   LithographyModel();
   void simulateExposure(std::shared_ptr<Wafer> wafer, double wavelength, double na, const std::vector<std::vector<int>>& mask) override;
+  void simulateExposure(std::shared_ptr<Wafer> wafer, double wavelength, double na, const BitMask& mask) override;
   void simulateMultiPatterning(std::shared_ptr<Wafer> wafer, double wavelength, double na, const std::vector<std::vector<std::vector<int>>>& masks) override;
 
+  // Transforms for the aerial image; Fft::defaultBackend() until set
+  void setFftBackend(std::shared_ptr<FftBackend> backend);
+  // Image through Hopkins partially coherent imaging instead of the
+  // Gaussian PSF; null goes back to the Gaussian. Models sharing one
+  // engine share its kernel cache.
+  void setHopkinsImaging(std::shared_ptr<HopkinsImaging> imaging);
+  // Develop the resist instead of thresholding the image at 0.5: with a
+  // model set, simulateExposure clears the cells whose film the developer
+  // has gone through within develop_time. Null goes back to the threshold.
+  void setResistDevelopment(std::shared_ptr<const ResistDevelopment> development, double develop_time,
+                            const ResistDevelopment::Options& options = ResistDevelopment::Options());
+  // The developer's arrival through the film under a mask's image on an
+  // x_dim x y_dim grid, one solve for any number of develop times.
+  // Pitches of 0 keep simulateExposure's resolution / dim cells.
+  ResistDevelopment::Profile developExposure(const ResistDevelopment& development, const BitMask& mask,
+                                             double wavelength, double na, int x_dim, int y_dim,
+                                             double pitch_x = 0.0, double pitch_y = 0.0,
+                                             const ResistDevelopment::Options& options =
+                                                 ResistDevelopment::Options()) const;
+
+  // Cells [row, row + rows) x [col, col + cols) of a mask, set where it is
+  // clear; windows reach past the mask, which is opaque there. Tiles call
+  // it from several threads at once.
+  using MaskSource = std::function<BitMask(int row, int col, int rows, int cols)>;
+  // Windows of a mask held in memory
+  static MaskSource maskSource(BitMask mask);
+
+  struct TiledExposureOptions {
+    int tile_size;  // Cells, rounded up to whole 64-cell words of the resist mask
+    double pitch_x; // Cell size; 0 keeps simulateExposure's resolution / dim
+    double pitch_y;
+
+    TiledExposureOptions(int tile_size = 512, double pitch_x = 0.0, double pitch_y = 0.0)
+        : tile_size(tile_size), pitch_x(pitch_x), pitch_y(pitch_y) {}
+  };
+
+  // A block of the field exposed on its own, from a mask window reaching
+  // the kernel's ambit past it on every side
+  struct ExposureTile {
+    int row, col, rows, cols;
+    int halo_rows, halo_cols;
+    double pitch_x, pitch_y;
+    double cell_area; // A clear cell's weight in the Gaussian image
+  };
+
+  // Tiles covering an x_dim x y_dim field, row-major
+  std::vector<ExposureTile> planExposureTiles(int x_dim, int y_dim, double wavelength, double na,
+                                              const TiledExposureOptions& options = TiledExposureOptions()) const;
+  // The resist over the tile's interior, tile.rows x tile.cols. Tiles
+  // depend on nothing but the source, so they can also run as separate
+  // jobs and be placed at their origins.
+  BitMask exposeTile(const ExposureTile& tile, double wavelength, double na, const MaskSource& source) const;
+  // The whole field tile by tile, the tiles in parallel and each written
+  // straight into the resist mask; only a tile's mask window is ever held
+  void simulateTiledExposure(std::shared_ptr<Wafer> wafer, double wavelength, double na, const MaskSource& source,
+                             const TiledExposureOptions& options = TiledExposureOptions());
+
+  // One shot of a step-and-scan exposure: the reticle imaged with its
+  // first cell at (row, col) of the wafer grid, possibly hanging off it,
+  // under the field's own dose and focus corrections
+  struct ExposureField {
+    int row, col;
+    double dose;  // Relative to nominal; the resist clears where dose x intensity passes 0.5
+    double focus; // Defocus, in the pitches' length unit
+
+    ExposureField(int row = 0, int col = 0, double dose = 1.0, double focus = 0.0)
+        : row(row), col(col), dose(dose), focus(focus) {}
+  };
+
+  // Fields of field_rows x field_cols stepped across an x_dim x y_dim
+  // grid, row-major and centred so the edge fields hang over evenly, all
+  // at nominal dose and focus for a correction recipe to adjust
+  static std::vector<ExposureField> planShotMap(int x_dim, int y_dim, int field_rows, int field_cols);
+  // Exposes the reticle once per field of the shot map. Fields at one
+  // focus share one aerial image and dose only moves their threshold, so
+  // a wafer costs an image per distinct focus, not per field, and the
+  // reticle's spectrum is transformed once for all of them. Focus groups
+  // image in parallel, then the wafer's rows are thresholded in parallel,
+  // every field written straight into the resist mask; where fields
+  // overlap, either one clearing a cell clears it. Pitches of 0 keep
+  // simulateExposure's resolution / dim cells for the reticle. Throws
+  // std::invalid_argument for a field without a positive dose.
+  void simulateFieldExposure(std::shared_ptr<Wafer> wafer, double wavelength, double na, const BitMask& reticle,
+                             const std::vector<ExposureField>& fields, double pitch_x = 0.0, double pitch_y = 0.0);
+
 private:
-  Eigen::ArrayXXd computeAerialImage(const std::vector<std::vector<int>>& mask, double wavelength, double na, int x_dim, int y_dim) const;
+  // A PSF spectrum depends on the optics, the image grid and its pitch,
+  // and the padded transform size
+  struct PsfKey {
+    double wavelength, na, sigma, pitch_x, pitch_y;
+    int x_dim, y_dim, rows, cols;
+    std::string backend;
+  };
+  using Spectrum = SpectrumCache::Spectrum;
+
+  static constexpr double kPartialCoherence = 0.5; // Gaussian PSF width in resolutions
+  static constexpr double kPsfAmbit = 6.0;          // Gaussian PSF widths a tile's halo spans
+
+  // One exposure's optics on one padded grid, shared by every mask of at
+  // most mask_rows x mask_cols imaged with it
+  struct Exposure {
+    double wavelength, na, sigma; // sigma includes the Gaussian path's defocus blur
+    double defocus;
+    double pitch_x, pitch_y, cell_area;
+    int x_dim, y_dim, mask_rows, mask_cols;
+    int rows, cols; // Padded transform size
+    std::shared_ptr<FftBackend> fft;
+    std::shared_ptr<const Spectrum> psf; // Null on the Hopkins path
+  };
+
+  static BitMask toBitMask(const std::vector<std::vector<int>>& mask);
+  Eigen::ArrayXXd computeAerialImage(const BitMask& mask, double wavelength, double na, int x_dim, int y_dim) const;
+  // The pitch and cell area of simulateExposure's cells, resolution / dim
+  // across and each weighing 1, come from the field when pitch_x is 0.
+  // Defocus goes to the Hopkins pupil, or widens the Gaussian PSF by the
+  // spread of its geometric blur disk, |defocus| NA / 2.
+  Exposure prepareExposure(double wavelength, double na, int x_dim, int y_dim, int mask_rows, int mask_cols,
+                           double pitch_x = 0.0, double pitch_y = 0.0, double cell_area = 1.0,
+                           double defocus = 0.0) const;
+  Eigen::ArrayXXd computeAerialImage(const BitMask& mask, const Exposure& exposure) const;
+  // PSF and Gaussian-path mask spectra live in the process-wide SpectrumCache
+  std::shared_ptr<const Spectrum> psfSpectrum(const FftBackend& fft, const PsfKey& key) const;
+  std::shared_ptr<const Spectrum> maskSpectrum(const BitMask& mask, const Exposure& exposure) const;
+
+  std::shared_ptr<FftBackend> fft_;
+  std::shared_ptr<HopkinsImaging> hopkins_;
+  std::shared_ptr<const ResistDevelopment> development_;
+  double develop_time_ = 0.0;
+  ResistDevelopment::Options development_options_;
 };
 
 #endif // LITHOGRAPHY_MODEL_HPP
\ No newline at end of file
@@ -0,0 +1,288 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "model_opc.hpp"
+#include "../../core/profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Complex = HopkinsImaging::Complex;
+
+constexpr double kMinSlope = 1e-3; // Intensity change per pixel below which an edge is taken as flat
+constexpr double kFftCost = 5.0;   // Operations per point and level of a transform, against one multiply-add
+
+// A piece of target edge: cells [begin, end) along it, between the clear
+// cell `inside` and the dark cell `inside + outward` across it. Vertical
+// pieces run down the rows with the columns across them.
+struct Fragment {
+  bool vertical;
+  int inside;
+  int outward; // +1 or -1
+  int begin, end;
+  int bias = 0;       // Pixels moved outward, negative inward
+  double error = 0.0; // Edge placement error in pixels, positive where the print is too large
+};
+
+// The cell at `along` and `across` of an edge's orientation
+struct Orientation {
+  bool vertical;
+  int row(int along, int across) const { return vertical ? along : across; }
+  int col(int along, int across) const { return vertical ? across : along; }
+};
+
+std::vector<Fragment> fragmentEdges(const BitMask& target, int length) {
+  std::vector<Fragment> fragments;
+  for (bool vertical : {true, false}) {
+    const Orientation o{vertical};
+    const int alongs = vertical ? target.rows() : target.cols();
+    const int acrosses = vertical ? target.cols() : target.rows();
+    // Boundary b lies between across positions b - 1 and b; runs of one
+    // direction along it are cut into pieces
+    for (int b = 1; b < acrosses; ++b) {
+      int run = 0, direction = 0;
+      for (int a = 0; a <= alongs; ++a) {
+        int outward = 0;
+        if (a < alongs) {
+          const bool before = target.test(o.row(a, b - 1), o.col(a, b - 1));
+          const bool after = target.test(o.row(a, b), o.col(a, b));
+          outward = before == after ? 0 : (before ? 1 : -1);
+        }
+        if (outward != direction) {
+          if (direction != 0) {
+            const int inside = direction > 0 ? b - 1 : b;
+            for (int s = run; s < a; s += length) {
+              fragments.push_back({vertical, inside, direction, s, std::min(a, s + length)});
+            }
+          }
+          run = a;
+          direction = outward;
+        }
+      }
+    }
+  }
+  return fragments;
+}
+
+// The target with every fragment's bias applied. Inward moves go first,
+// so where pieces meet at a corner the outward one wins.
+BitMask applyBiases(const BitMask& target, const std::vector<Fragment>& fragments) {
+  BitMask mask = target;
+  for (bool inward : {true, false}) {
+    for (const Fragment& f : fragments) {
+      if (f.bias == 0 || (f.bias < 0) != inward) {
+        continue;
+      }
+      const Orientation o{f.vertical};
+      const int acrosses = f.vertical ? target.cols() : target.rows();
+      for (int t = 0; t < std::abs(f.bias); ++t) {
+        const int across = inward ? f.inside - f.outward * t : f.inside + f.outward * (t + 1);
+        if (across < 0 || across >= acrosses) {
+          break;
+        }
+        for (int a = f.begin; a < f.end; ++a) {
+          mask.set(o.row(a, across), o.col(a, across), !inward);
+        }
+      }
+    }
+  }
+  return mask;
+}
+
+Eigen::ArrayXXd transmissionOf(const BitMask& mask, double absorber) {
+  Eigen::ArrayXXd transmission = Eigen::ArrayXXd::Constant(mask.rows(), mask.cols(), absorber);
+  mask.forEachSet([&](int i, int j) { transmission(i, j) = 1.0; });
+  return transmission;
+}
+
+// Image and fields of the current mask
+struct Model {
+  HopkinsImaging::Fields fields;
+  Eigen::ArrayXXd intensity;
+
+  void recompute(int i, int j) {
+    double value = 0.0;
+    const std::size_t p = static_cast<std::size_t>(i) * fields.y_dim + j;
+    for (std::size_t k = 0; k < fields.fields.size(); ++k) {
+      value += fields.kernels->weights[k] * std::norm(fields.fields[k][p]);
+    }
+    intensity(i, j) = value;
+  }
+
+  void recomputeAll() {
+    intensity.resize(fields.x_dim, fields.y_dim);
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < fields.x_dim; ++i) {
+      for (int j = 0; j < fields.y_dim; ++j) {
+        recompute(i, j);
+      }
+    }
+  }
+};
+
+} // namespace
+
+ModelBasedOpc::ModelBasedOpc(std::shared_ptr<HopkinsImaging> imaging, Options options)
+    : imaging_(std::move(imaging)), options_(options) {
+  if (!imaging_) {
+    throw std::invalid_argument("Model-based OPC needs a Hopkins imaging engine");
+  }
+  if (!(options_.threshold > 0.0) || !(options_.absorber >= 0.0 && options_.absorber < 1.0) ||
+      options_.fragment_length <= 0 || options_.max_bias < 0 || options_.max_iterations < 0 ||
+      !(options_.tolerance >= 0.0) || !(options_.damping > 0.0 && options_.damping <= 1.0)) {
+    throw std::invalid_argument("Model-based OPC needs a positive threshold and fragment length, an absorber in "
+                                "[0, 1), non-negative bias, iteration and tolerance limits and damping in (0, 1]");
+  }
+}
+
+Eigen::ArrayXXd ModelBasedOpc::aerialImage(const BitMask& mask, const HopkinsImaging::Optics& optics) const {
+  return imaging_->aerialImage(transmissionOf(mask, options_.absorber), optics, mask.rows(), mask.cols());
+}
+
+ModelBasedOpc::Result ModelBasedOpc::correct(const BitMask& target, const HopkinsImaging::Optics& optics) const {
+  PROFILE_SCOPE("ModelBasedOpc::correct");
+  const int rows = target.rows();
+  const int cols = target.cols();
+  Result result;
+  result.mask = target;
+  if (rows == 0 || cols == 0) {
+    result.image = Eigen::ArrayXXd::Zero(rows, cols);
+    result.converged = true;
+    return result;
+  }
+  std::vector<Fragment> fragments = fragmentEdges(target, options_.fragment_length);
+  result.fragments = static_cast<int>(fragments.size());
+
+  Model model;
+  model.fields = imaging_->coherentFields(transmissionOf(target, options_.absorber), optics, rows, cols);
+  model.recomputeAll();
+  const double transmission_step = 1.0 - options_.absorber;
+
+  // Fragments are measured on their target edge: the image there is the
+  // mean of the cells either side, and its drop across them the slope
+  auto measure = [&]() {
+    double worst = 0.0;
+#pragma omp parallel for schedule(dynamic, 16) reduction(max : worst)
+    for (std::size_t n = 0; n < fragments.size(); ++n) {
+      Fragment& f = fragments[n];
+      const Orientation o{f.vertical};
+      double level = 0.0, slope = 0.0;
+      for (int a = f.begin; a < f.end; ++a) {
+        const double in = model.intensity(o.row(a, f.inside), o.col(a, f.inside));
+        const double out = model.intensity(o.row(a, f.inside + f.outward), o.col(a, f.inside + f.outward));
+        level += 0.5 * (in + out);
+        slope += in - out;
+      }
+      const double span = f.end - f.begin;
+      const double limit = options_.max_bias + 1.0;
+      f.error = std::clamp((level / span - options_.threshold) / std::max(slope / span, kMinSlope), -limit, limit);
+      worst = std::max(worst, std::abs(f.error));
+    }
+    return worst;
+  };
+
+  for (;;) {
+    result.max_edge_error = measure();
+    if (result.max_edge_error <= options_.tolerance) {
+      result.converged = true;
+      break;
+    }
+    if (result.iterations == options_.max_iterations) {
+      break;
+    }
+    // A print too large pulls its fragment in, too small pushes it out
+    bool moved = false;
+    for (Fragment& f : fragments) {
+      if (std::abs(f.error) <= options_.tolerance) {
+        continue;
+      }
+      long step = -std::lround(options_.damping * f.error);
+      if (step == 0) {
+        step = f.error > 0.0 ? -1 : 1;
+      }
+      const int bias = static_cast<int>(std::clamp<long>(f.bias + step, -options_.max_bias, options_.max_bias));
+      moved |= bias != f.bias;
+      f.bias = bias;
+    }
+    if (!moved) {
+      break;
+    }
+    ++result.iterations;
+
+    BitMask next = applyBiases(target, fragments);
+    std::vector<std::pair<int, int>> changed;
+    for (int i = 0; i < rows; ++i) {
+      for (int j = 0; j < cols; ++j) {
+        if (next.test(i, j) != result.mask.test(i, j)) {
+          changed.emplace_back(i, j);
+        }
+      }
+    }
+    result.mask = std::move(next);
+    const auto& kernels = model.fields.kernels;
+    if (!kernels || kernels->kernels.empty() || changed.empty()) {
+      continue;
+    }
+
+    // Convolving the flipped cells directly against transforming the
+    // whole mask, padded as aerialImage pads it
+    const int size = kernels->size;
+    const double points = static_cast<double>(rows + size / 2) * (cols + size / 2);
+    const double direct = static_cast<double>(changed.size()) * size * size;
+    if (direct > kFftCost * points * std::log2(std::max(points, 2.0))) {
+      model.fields = imaging_->coherentFields(transmissionOf(result.mask, options_.absorber), optics, rows, cols);
+      model.recomputeAll();
+      ++result.full_updates;
+      continue;
+    }
+
+    // Each field takes h_k at every flipped cell, offset d at kernel index
+    // d mod size as the kernel window stores it
+    const int reach = size / 2;
+#pragma omp parallel for schedule(static)
+    for (std::size_t k = 0; k < kernels->kernels.size(); ++k) {
+      const std::vector<Complex>& kernel = kernels->kernels[k];
+      std::vector<Complex>& field = model.fields.fields[k];
+      for (const auto& [m, n] : changed) {
+        const Complex delta = result.mask.test(m, n) ? transmission_step : -transmission_step;
+        for (int di = -reach; di < size - reach; ++di) {
+          const int i = m + di;
+          if (i < 0 || i >= rows) {
+            continue;
+          }
+          const Complex* row = kernel.data() + static_cast<std::size_t>((di + size) % size) * size;
+          Complex* out = field.data() + static_cast<std::size_t>(i) * cols;
+          for (int dj = -reach; dj < size - reach; ++dj) {
+            const int j = n + dj;
+            if (j >= 0 && j < cols) {
+              out[j] += delta * row[(dj + size) % size];
+            }
+          }
+        }
+      }
+    }
+    result.cells_reconvolved += changed.size();
+
+    // Only pixels within a kernel's reach of a flipped cell change
+    BitMask dirty(rows, cols);
+    for (const auto& [m, n] : changed) {
+      const int col_begin = std::max(0, n - reach);
+      const int col_end = std::min(cols, n + size - reach);
+      for (int i = std::max(0, m - reach); i < std::min(rows, m + size - reach); ++i) {
+        dirty.setSpan(i, col_begin, col_end);
+      }
+    }
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < rows; ++i) {
+      for (int j = 0; j < cols; ++j) {
+        if (dirty.test(i, j)) {
+          model.recompute(i, j);
+        }
+      }
+    }
+  }
+  result.image = std::move(model.intensity);
+  return result;
+}
@@ -0,0 +1,63 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef MODEL_OPC_HPP
+#define MODEL_OPC_HPP
+
+#include "hopkins_imaging.hpp"
+#include "../../core/bit_mask.hpp"
+#include <Eigen/Dense>
+#include <cstddef>
+#include <memory>
+
+// Model-based optical proximity correction of a binary mask.
+//
+// The target's edges are cut into fragments, each moved out or in by whole
+// pixels until the Hopkins image crosses the print threshold on the
+// fragment's target edge. The image is kept as its SOCS fields h_k * m,
+// which are linear in the mask: moving fragments changes every field by
+// h_k convolved with the cells they flip, so only those cells are
+// convolved, directly over the kernel window, and only the intensity they
+// reach is recomputed. An edit large enough that this would cost more than
+// FFTs recomputes the fields outright.
+class ModelBasedOpc {
+public:
+  struct Options {
+    double threshold;    // Intensity the printed edge sits at; an open frame images to about 1
+    double absorber;     // Amplitude transmission of the mask's dark cells
+    int fragment_length; // Pixels of edge per fragment
+    int max_bias;        // Pixels a fragment may move either way
+    int max_iterations;
+    double tolerance;    // Edge placement error, in pixels, every fragment must reach; whole-pixel
+                         // moves resolve about half a pixel
+    double damping;      // Fraction of a fragment's error corrected per iteration
+
+    Options(double threshold = 0.3, double absorber = 0.0, int fragment_length = 8, int max_bias = 4,
+            int max_iterations = 20, double tolerance = 0.5, double damping = 0.7)
+        : threshold(threshold), absorber(absorber), fragment_length(fragment_length), max_bias(max_bias),
+          max_iterations(max_iterations), tolerance(tolerance), damping(damping) {}
+  };
+
+  struct Result {
+    BitMask mask;          // Clear where set
+    Eigen::ArrayXXd image; // Of mask, as the incremental updates left it
+    int fragments = 0;
+    int iterations = 0; // Mask updates made
+    bool converged = false;
+    double max_edge_error = 0.0;       // Pixels, over every fragment of the returned mask
+    std::size_t cells_reconvolved = 0; // Mask cells convolved incrementally
+    int full_updates = 0;              // Updates that recomputed the fields by FFT
+  };
+
+  // Throws std::invalid_argument for a null engine or options out of range
+  explicit ModelBasedOpc(std::shared_ptr<HopkinsImaging> imaging, Options options = Options());
+
+  // The mask whose image prints target, on target's pixels
+  Result correct(const BitMask& target, const HopkinsImaging::Optics& optics) const;
+  // The image correct() models for a mask
+  Eigen::ArrayXXd aerialImage(const BitMask& mask, const HopkinsImaging::Optics& optics) const;
+
+private:
+  std::shared_ptr<HopkinsImaging> imaging_;
+  Options options_;
+};
+
+#endif // MODEL_OPC_HPP
@@ -0,0 +1,266 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "resist_development.hpp"
+#include "../../core/profiler.hpp"
+#include "../../core/task_scheduler.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+
+// First-order upwind solution of |grad T| = s at a voxel from the least
+// known arrival along each axis and the spacing to it: the axes are taken
+// in order of arrival for as long as the solution stays past the next one
+double solveEikonal(std::array<std::pair<double, double>, 3> terms, double slowness) {
+  std::sort(terms.begin(), terms.end());
+  double sa = 0.0, sb = 0.0, sc = 0.0;
+  double time = kInf;
+  for (int m = 0; m < 3 && terms[m].first < kInf; ++m) {
+    const double weight = 1.0 / (terms[m].second * terms[m].second);
+    sa += weight;
+    sb += terms[m].first * weight;
+    sc += terms[m].first * terms[m].first * weight;
+    // sa T^2 - 2 sb T + sc = s^2
+    const double discriminant = sb * sb - sa * (sc - slowness * slowness);
+    if (discriminant < 0.0) {
+      break;
+    }
+    time = (sb + std::sqrt(discriminant)) / sa;
+    if (m == 2 || time <= terms[m + 1].first) {
+      break;
+    }
+  }
+  return time;
+}
+
+struct Film {
+  int rows, cols, layers;
+  double hx, hy, hz;
+  std::vector<double> slowness;
+  std::size_t index(int i, int j, int k) const { return (static_cast<std::size_t>(i) * cols + j) * layers + k; }
+};
+
+// Fast marching over rows [begin, end) of the film from its top surface
+// and from the fixed arrivals of the rows just outside them, `before` and
+// `after` (empty at the film's edges). Only voxels reached by max_time
+// keep an arrival; the others are left infinite.
+void marchSlab(const Film& film, std::vector<double>& time, int begin, int end, const std::vector<double>& before,
+               const std::vector<double>& after, double max_time) {
+  const std::size_t first = film.index(begin, 0, 0);
+  const std::size_t count = film.index(end, 0, 0) - first;
+  std::fill(time.begin() + first, time.begin() + first + count, kInf);
+  std::vector<char> accepted(count, 0);
+
+  auto known = [&](int i, int j, int k) {
+    if (i < begin) {
+      return before.empty() ? kInf : before[static_cast<std::size_t>(j) * film.layers + k];
+    }
+    if (i >= end) {
+      return after.empty() ? kInf : after[static_cast<std::size_t>(j) * film.layers + k];
+    }
+    const std::size_t id = film.index(i, j, k);
+    return accepted[id - first] ? time[id] : kInf;
+  };
+  auto update = [&](int i, int j, int k) {
+    std::array<std::pair<double, double>, 3> terms;
+    terms[0] = {std::min(i > 0 ? known(i - 1, j, k) : kInf, i + 1 < film.rows ? known(i + 1, j, k) : kInf), film.hx};
+    terms[1] = {std::min(j > 0 ? known(i, j - 1, k) : kInf, j + 1 < film.cols ? known(i, j + 1, k) : kInf), film.hy};
+    // The top layer is half a layer under the surface the developer starts on
+    terms[2] = k == 0 ? std::make_pair(0.0, 0.5 * film.hz)
+                      : std::make_pair(std::min(known(i, j, k - 1), k + 1 < film.layers ? known(i, j, k + 1) : kInf),
+                                       film.hz);
+    return solveEikonal(terms, film.slowness[film.index(i, j, k)]);
+  };
+
+  using Entry = std::pair<double, std::size_t>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+  auto offer = [&](int i, int j, int k) {
+    const std::size_t id = film.index(i, j, k);
+    const double t = update(i, j, k);
+    if (t < time[id]) {
+      time[id] = t;
+      heap.push({t, id});
+    }
+  };
+  for (int i = begin; i < end; ++i) {
+    const bool edge = (i == begin && !before.empty()) || (i == end - 1 && !after.empty());
+    for (int j = 0; j < film.cols; ++j) {
+      for (int k = 0; k < (edge ? film.layers : 1); ++k) {
+        offer(i, j, k);
+      }
+    }
+  }
+
+  while (!heap.empty()) {
+    const auto [t, id] = heap.top();
+    heap.pop();
+    if (accepted[id - first] || t > time[id]) {
+      continue;
+    }
+    if (t > max_time) {
+      break;
+    }
+    accepted[id - first] = 1;
+    const int k = static_cast<int>(id % film.layers);
+    const int j = static_cast<int>(id / film.layers % film.cols);
+    const int i = static_cast<int>(id / film.layers / film.cols);
+    const int neighbours[6][3] = {{i - 1, j, k}, {i + 1, j, k}, {i, j - 1, k}, {i, j + 1, k}, {i, j, k - 1}, {i, j, k + 1}};
+    for (const auto& n : neighbours) {
+      if (n[0] < begin || n[0] >= end || n[1] < 0 || n[1] >= film.cols || n[2] < 0 || n[2] >= film.layers) {
+        continue;
+      }
+      if (!accepted[film.index(n[0], n[1], n[2]) - first]) {
+        offer(n[0], n[1], n[2]);
+      }
+    }
+  }
+  for (std::size_t c = 0; c < count; ++c) {
+    if (!accepted[c]) {
+      time[first + c] = kInf;
+    }
+  }
+}
+
+} // namespace
+
+ResistDevelopment::ResistDevelopment() : ResistDevelopment(Parameters()) {}
+
+ResistDevelopment::ResistDevelopment(const Parameters& parameters) : parameters_(parameters) {
+  const Parameters& p = parameters_;
+  if (!(p.thickness > 0.0) || !(p.r_max > 0.0) || !(p.r_min > 0.0)) {
+    throw std::invalid_argument("Resist thickness and development rates must be positive");
+  }
+  if (p.absorption < 0.0 || p.exposure_rate < 0.0 || p.dose < 0.0) {
+    throw std::invalid_argument("Resist absorption, exposure rate and dose must not be negative");
+  }
+  if (!(p.m_threshold >= 0.0 && p.m_threshold < 1.0) || !(p.selectivity > 1.0)) {
+    throw std::invalid_argument("Mack threshold must be in [0, 1) and selectivity above 1");
+  }
+  mack_a_ = (p.selectivity + 1.0) / (p.selectivity - 1.0) * std::pow(1.0 - p.m_threshold, p.selectivity);
+}
+
+double ResistDevelopment::inhibitor(double intensity, double depth) const {
+  const Parameters& p = parameters_;
+  return std::exp(-p.exposure_rate * p.dose * std::max(intensity, 0.0) * std::exp(-p.absorption * depth));
+}
+
+double ResistDevelopment::rate(double inhibitor) const {
+  const Parameters& p = parameters_;
+  const double bleached = std::pow(std::clamp(1.0 - inhibitor, 0.0, 1.0), p.selectivity);
+  return p.r_max * (mack_a_ + 1.0) * bleached / (mack_a_ + bleached) + p.r_min;
+}
+
+ResistDevelopment::Profile ResistDevelopment::develop(const Eigen::ArrayXXd& intensity, double pitch_x,
+                                                      double pitch_y, const Options& options) const {
+  PROFILE_SCOPE("ResistDevelopment::develop");
+  if (!(pitch_x > 0.0) || !(pitch_y > 0.0) || options.layers <= 0) {
+    throw std::invalid_argument("Resist development needs positive pitches and layers");
+  }
+  Film film{static_cast<int>(intensity.rows()), static_cast<int>(intensity.cols()), options.layers,
+            pitch_x, pitch_y, parameters_.thickness / options.layers, {}};
+  Profile profile;
+  profile.rows_ = film.rows;
+  profile.cols_ = film.cols;
+  profile.layers_ = film.layers;
+  profile.thickness_ = parameters_.thickness;
+  const std::size_t voxels = static_cast<std::size_t>(film.rows) * film.cols * film.layers;
+  profile.arrival_.assign(voxels, kInf);
+  if (voxels == 0) {
+    return profile;
+  }
+  PROFILE_CELLS(voxels);
+
+  // Latent image and development rate of every voxel
+  TaskScheduler& scheduler = TaskScheduler::getInstance();
+  film.slowness.resize(voxels);
+  scheduler.parallelFor(0, film.rows, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      for (int j = 0; j < film.cols; ++j) {
+        for (int k = 0; k < film.layers; ++k) {
+          film.slowness[film.index(i, j, k)] = 1.0 / rate(inhibitor(intensity(i, j), (k + 0.5) * film.hz));
+        }
+      }
+    }
+  });
+
+  // Slabs of a few rows at least, so the exchanged edges stay a small
+  // part of each
+  int slabs = options.slabs > 0 ? options.slabs : scheduler.threadCount();
+  slabs = std::clamp(slabs, 1, std::max(1, film.rows / 4));
+  if (slabs == 1) {
+    marchSlab(film, profile.arrival_, 0, film.rows, {}, {}, options.max_time);
+    profile.passes_ = 1;
+    return profile;
+  }
+
+  // Each slab marches from the rows beside it as the last pass left them,
+  // and marches again while those change. Arrivals only fall from pass to
+  // pass, and a slab's march is exact for the rows it is given, so the
+  // slabs settle on the serial solution.
+  std::vector<int> bounds(slabs + 1);
+  for (int s = 0; s <= slabs; ++s) {
+    bounds[s] = static_cast<int>(static_cast<long long>(film.rows) * s / slabs);
+  }
+  const std::size_t plane = static_cast<std::size_t>(film.cols) * film.layers;
+  auto row = [&](int i) {
+    const auto start = profile.arrival_.begin() + film.index(i, 0, 0);
+    return std::vector<double>(start, start + plane);
+  };
+  std::vector<std::vector<double>> before(slabs), after(slabs);
+  std::vector<char> pending(slabs, 1);
+  while (std::find(pending.begin(), pending.end(), 1) != pending.end()) {
+    ++profile.passes_;
+    scheduler.parallelFor(0, slabs, [&](int begin, int end) {
+      for (int s = begin; s < end; ++s) {
+        if (pending[s]) {
+          marchSlab(film, profile.arrival_, bounds[s], bounds[s + 1], before[s], after[s], options.max_time);
+        }
+      }
+    }, 1);
+    for (int s = 0; s < slabs; ++s) {
+      std::vector<double> above = s > 0 ? row(bounds[s] - 1) : std::vector<double>();
+      std::vector<double> below = s + 1 < slabs ? row(bounds[s + 1]) : std::vector<double>();
+      pending[s] = above != before[s] || below != after[s];
+      before[s] = std::move(above);
+      after[s] = std::move(below);
+    }
+  }
+  return profile;
+}
+
+BitMask ResistDevelopment::Profile::cleared(double time) const {
+  return BitMask::fromPredicate(rows_, cols_, [&](int i, int j) { return arrival(i, j, layers_ - 1) <= time; });
+}
+
+Eigen::ArrayXXd ResistDevelopment::Profile::remaining(double time) const {
+  Eigen::ArrayXXd film(rows_, cols_);
+  const double hz = thickness_ / std::max(layers_, 1);
+  time = std::max(time, 0.0);
+  for (int i = 0; i < rows_; ++i) {
+    for (int j = 0; j < cols_; ++j) {
+      // From the surface at time 0 down the voxel centres the front has passed
+      double reached_time = 0.0, reached_depth = 0.0;
+      int k = 0;
+      for (; k < layers_ && arrival(i, j, k) <= time; ++k) {
+        reached_time = arrival(i, j, k);
+        reached_depth = (k + 0.5) * hz;
+      }
+      double depth = thickness_;
+      if (k < layers_) {
+        const double next = arrival(i, j, k);
+        depth = reached_depth;
+        if (next < kInf) {
+          depth += ((k + 0.5) * hz - reached_depth) * (time - reached_time) / (next - reached_time);
+        }
+      }
+      film(i, j) = thickness_ - depth;
+    }
+  }
+  return film;
+}
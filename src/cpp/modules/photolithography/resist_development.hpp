@@ -0,0 +1,102 @@
+// Author: Dr. Mazharuddin Mohammed
+#ifndef RESIST_DEVELOPMENT_HPP
+#define RESIST_DEVELOPMENT_HPP
+
+#include "../../core/bit_mask.hpp"
+#include <Eigen/Dense>
+#include <limits>
+#include <vector>
+
+// Development of an exposed positive resist film.
+//
+// The aerial image bleaches the film's inhibitor by Dill's model,
+// m = exp(-C dose I exp(-alpha z)) at depth z, and the developer
+// dissolves it at Mack's rate
+//   r(m) = r_max (a + 1) (1 - m)^n / (a + (1 - m)^n) + r_min,
+//   a = (n + 1) / (n - 1) (1 - m_th)^n.
+// The developer front starts at the top of the film and reaches every
+// voxel at the time T solving |grad T| = 1 / r, found by fast marching in
+// O(N log N) for N voxels. One solve serves every develop time: the resist
+// has cleared wherever the front reached the bottom of the film by then,
+// and the film left in a column is the depth the front has not reached,
+// so profiles and sidewalls of a develop-time sweep cost a threshold each.
+//
+// Lengths are in the pitches' unit, nm with the default parameters, and
+// times in seconds.
+class ResistDevelopment {
+public:
+  struct Parameters {
+    double thickness = 100.0;    // Film thickness
+    double absorption = 0.004;   // Intensity falls as exp(-absorption depth)
+    double exposure_rate = 0.02; // Dill C, cm^2/mJ
+    double dose = 50.0;          // mJ/cm^2 delivered at intensity 1
+    double r_max = 100.0;        // Rate of fully bleached resist, per second
+    double r_min = 0.1;          // Rate of unexposed resist
+    double m_threshold = 0.5;    // Inhibitor where the rate turns up
+    double selectivity = 5.0;    // Mack's n, above 1
+  };
+
+  struct Options {
+    int layers;      // Voxels through the film's thickness
+    // The front is followed only to this time, a narrow band when only
+    // short develop times are of interest; voxels past it never arrive
+    double max_time;
+    // Row slabs marched in parallel, exchanging their edge rows until no
+    // arrival changes; 0 for one per scheduler thread, 1 for a serial solve
+    int slabs;
+
+    Options(int layers = 32, double max_time = std::numeric_limits<double>::infinity(), int slabs = 0)
+        : layers(layers), max_time(max_time), slabs(slabs) {}
+  };
+
+  // Developer arrival time at each voxel of the film: row i and column j
+  // of the image, layer k counted down from the top with its centre at
+  // depth (k + 0.5) thickness / layers
+  class Profile {
+  public:
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int layers() const { return layers_; }
+    double thickness() const { return thickness_; }
+    // Infinite where the front never arrives, or not within max_time
+    double arrival(int i, int j, int k) const {
+      return arrival_[(static_cast<size_t>(i) * cols_ + j) * layers_ + k];
+    }
+    // Cells whose film is developed to the bottom by time: the clear resist
+    BitMask cleared(double time) const;
+    // Film left in each column at time, down to the depth the front has
+    // reached along it, interpolated between voxel centres
+    Eigen::ArrayXXd remaining(double time) const;
+    // Passes of the parallel march until its slabs agreed; 1 when serial
+    int passes() const { return passes_; }
+
+  private:
+    friend class ResistDevelopment;
+    int rows_ = 0, cols_ = 0, layers_ = 0;
+    double thickness_ = 0.0;
+    std::vector<double> arrival_;
+    int passes_ = 0;
+  };
+
+  ResistDevelopment();
+  // Throws std::invalid_argument for parameters out of range
+  explicit ResistDevelopment(const Parameters& parameters);
+  const Parameters& parameters() const { return parameters_; }
+
+  // Inhibitor left at depth under relative intensity
+  double inhibitor(double intensity, double depth) const;
+  // Development rate of resist with that much inhibitor
+  double rate(double inhibitor) const;
+
+  // Develops the film under an image of relative intensity, cells
+  // pitch_x x pitch_y. Throws std::invalid_argument unless the pitches and
+  // layers are positive.
+  Profile develop(const Eigen::ArrayXXd& intensity, double pitch_x, double pitch_y,
+                  const Options& options = Options()) const;
+
+private:
+  Parameters parameters_;
+  double mack_a_ = 0.0;
+};
+
+#endif // RESIST_DEVELOPMENT_HPP
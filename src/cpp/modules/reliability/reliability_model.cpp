@@ -1,6 +1,38 @@
 #include "reliability_model.hpp"
+#include "../../core/philox.hpp"
+#include "../../core/profiler.hpp"
+#include "../../core/reproducibility.hpp"
+#include <algorithm>
+#include <functional>
+#include <limits>
 #include <stdexcept>
 #include <cmath>
+#include <utility>
+
+namespace {
+
+// Grids below this many cells are traversed on the calling thread
+constexpr Eigen::Index kParallelCells = 1 << 14;
+
+// Lognormal survival reduces through bins of ln(median) this fine
+constexpr int kMedianBins = 4096;
+// and is tabulated at this many ln(t), from 12 sigma below the weakest
+// median, early enough for the first failures among 1e9 segments, to 9
+// above, by which the weakest segment alone has failed
+constexpr int kSurvivalPoints = 2048;
+constexpr double kBelowWeakest = 12.0;
+constexpr double kAboveWeakest = 9.0;
+
+// ln P(Z > z) for a standard normal, asymptotic where erfc underflows
+double logNormalSurvival(double z) {
+    const double tail = 0.5 * std::erfc(z / std::sqrt(2.0));
+    if (tail > 0.0) {
+        return std::log(tail);
+    }
+    return -0.5 * z * z - std::log(z * std::sqrt(2.0 * M_PI));
+}
+
+} // namespace
 
 ReliabilityModel::ReliabilityModel() {}
 
@@ -12,125 +44,294 @@ void ReliabilityModel::performReliabilityTest(std::shared_ptr<Wafer> wafer, doub
         throw std::invalid_argument("Voltage must be non-negative");
     }
 
-    Logger::getInstance().log("Performing reliability test: current=" + std::to_string(current) +
-                    " A, voltage=" + std::to_string(voltage) + " V");
+    SEMIPRO_LOGF(INFO, PHYSICS, "Performing reliability test: current={} A, voltage={} V", current, voltage);
 
-    computeElectromigration(wafer, current);
-    computeThermalStress(wafer);
-    computeDielectricBreakdown(wafer, voltage);
+    computeReliabilityFields(wafer, current, voltage);
 }
 
-void ReliabilityModel::computeElectromigration(std::shared_ptr<Wafer> wafer, double current) {
-    Eigen::ArrayXXd mttf = Eigen::ArrayXXd::Zero(wafer->getGrid().rows(), wafer->getGrid().cols());
-    if (wafer->getMetalLayers().empty()) {
-        wafer->setElectromigrationMTTF(mttf);
-        Logger::getInstance().log("WARNING: No metal layers; electromigration MTTF set to zero");
-        return;
+void ReliabilityModel::performReliabilityTest(std::shared_ptr<Wafer> wafer, const Eigen::ArrayXXd& current_density,
+                                              double voltage) {
+    if (current_density.rows() != wafer->getGrid().rows() || current_density.cols() != wafer->getGrid().cols()) {
+        throw std::invalid_argument("Current density does not match the wafer grid");
+    }
+    if (!(current_density >= 0.0).all()) {
+        throw std::invalid_argument("Current density must be non-negative");
     }
+    if (voltage < 0) {
+        throw std::invalid_argument("Voltage must be non-negative");
+    }
+
+    SEMIPRO_LOGF(INFO, PHYSICS, "Performing reliability test: peak current density={} A/m^2, voltage={} V",
+                 current_density.maxCoeff(), voltage);
+
+    computeReliabilityFields(wafer, 0.0, voltage, &current_density);
+}
+
+void ReliabilityModel::computeReliabilityFields(std::shared_ptr<Wafer> wafer, double current, double voltage,
+                                                const Eigen::ArrayXXd* current_density) {
+    PROFILE_SCOPE("ReliabilityModel::computeReliabilityFields");
+    const auto& film_layers = wafer->getFilmLayers();
+    const auto& metal_layers = wafer->getMetalLayers();
+    const auto& substrate = wafer->getPackagingSubstrate();
+    const ConstFieldView temperature = std::as_const(*wafer).getTemperatureProfile();
+    const ConstFieldView photoresist = std::as_const(*wafer).getPhotoresistPattern();
+    FieldStore& fields = wafer->getFieldStore();
+    FieldView mttf = fields.view(Wafer::kElectromigrationMTTFField);
+    FieldView stress = fields.view(Wafer::kThermalStressField);
+    FieldView field = fields.view(Wafer::kDielectricFieldField);
+    const Eigen::Index rows = temperature.rows();
+    const Eigen::Index cols = temperature.cols();
 
-    const auto& photoresist = wafer->getPhotoresistPattern();
-    const auto& temperature = wafer->getTemperatureProfile();
+    // Black's equation, MTTF = A J^-n exp(Ea / kB T) with n = 2, on the
+    // cells the metal fills
+    const bool has_metal = !metal_layers.empty();
     double thickness = 0.0;
-    for (const auto& layer : wafer->getMetalLayers()) {
+    for (const auto& layer : metal_layers) {
         thickness += layer.first * 1e-6; // um to m
     }
-    double dx = 1e-6; // Grid spacing: 1 um
-    double area = dx * thickness * 10000; // m² to cm²
-    double J = current / area; // Current density (A/cm²)
-
+    const double dx = 1e-6; // Grid spacing: 1 um
+    const double area = dx * thickness * 10000; // m² to cm²
+    const double J = current / area; // Current density (A/cm²)
     const double A = 1e12; // Scaling factor (s·A²/cm⁴) - increased for realistic MTTF values
-    const double n = 2.0; // Current exponent
     const double Ea = 0.9; // Activation energy (eV)
     const double kB = 8.617e-5; // Boltzmann constant (eV/K)
+    const double em_prefactor = A / (J * J);
+    const double activation = Ea / kB;
 
-    for (int i = 0; i < mttf.rows(); ++i) {
-        for (int j = 0; j < mttf.cols(); ++j) {
-            if (i < photoresist.rows() && j < photoresist.cols() && photoresist(i, j) < 0.5) {
-                double T = temperature(i, j);
-                if (T > 0) {
-                    mttf(i, j) = A * pow(J, -n) * exp(Ea / (kB * T)); // Black’s equation
-                }
-            }
+    // Thermal stress E alpha (T - T0) plus the gradient term E alpha |grad T| dx,
+    // with E alpha in MPa/K of Cu under metal and of the background elsewhere
+    const double ambient_temp = 300.0; // K
+    const double metal_stiffness = 110e3 * 17e-6; // Cu
+    double background_stiffness = 130e3 * 2.6e-6; // Si
+    if (!film_layers.empty()) {
+        background_stiffness = 70e3 * 0.5e-6; // SiO2
+    } else if (substrate.first > 0 && substrate.second == "Ceramic") {
+        background_stiffness = 300e3 * 7e-6; // Ceramic
+    }
+    const double cell_stiffness = has_metal ? metal_stiffness : background_stiffness;
+
+    // Uniform field across the SiO2 films
+    double oxide_thickness = 0.0;
+    for (const auto& layer : film_layers) {
+        if (layer.second == "SiO2") {
+            oxide_thickness += layer.first * 1e-4; // um to cm
         }
     }
+    const double E_field = oxide_thickness > 0.0 ? voltage / oxide_thickness : 0.0; // V/cm
 
-    wafer->setElectromigrationMTTF(mttf);
-    Logger::getInstance().log("Electromigration computed. Min MTTF: " + std::to_string(mttf.minCoeff()) + " s");
-}
+    double min_mttf = std::numeric_limits<double>::infinity();
+    double max_stress = -std::numeric_limits<double>::infinity();
+#pragma omp parallel for schedule(static) reduction(min : min_mttf) reduction(max : max_stress) \
+    if (rows * cols >= kParallelCells)
+    for (Eigen::Index j = 0; j < cols; ++j) {
+        const auto T = temperature.col(j);
+        const auto metal = photoresist.col(j) < 0.5;
+        if (has_metal && current_density) {
+            const auto J_cell = current_density->col(j) * 1e-4; // A/m² to A/cm²
+            mttf.col(j) = (metal && T > 0.0).select(A * (activation / T).exp() / J_cell.square(), 0.0);
+        } else if (has_metal) {
+            mttf.col(j) = (metal && T > 0.0).select(em_prefactor * (activation / T).exp(), 0.0);
+        } else {
+            mttf.col(j).setZero();
+        }
+        min_mttf = std::min(min_mttf, mttf.col(j).minCoeff());
 
-void ReliabilityModel::computeThermalStress(std::shared_ptr<Wafer> wafer) {
-    Eigen::ArrayXXd stress = Eigen::ArrayXXd::Zero(wafer->getGrid().rows(), wafer->getGrid().cols());
-    const auto& temperature = wafer->getTemperatureProfile();
-    const auto& film_layers = wafer->getFilmLayers();
-    const auto& metal_layers = wafer->getMetalLayers();
-    const auto& substrate = wafer->getPackagingSubstrate();
-    const auto& photoresist = wafer->getPhotoresistPattern();
-    double ambient_temp = 300.0; // K
-    double dx = 1e-6; // Grid spacing: 1 um
-
-    for (int i = 0; i < stress.rows(); ++i) {
-        for (int j = 0; j < stress.cols(); ++j) {
-            double E = 130e3; // Young’s modulus (MPa), Si
-            double alpha = 2.6e-6; // Thermal expansion coefficient (/K), Si
-            if (i < photoresist.rows() && j < photoresist.cols() && photoresist(i, j) < 0.5 && !metal_layers.empty()) {
-                E = 110e3; // Cu
-                alpha = 17e-6;
-            } else if (!film_layers.empty()) {
-                E = 70e3; // SiO2
-                alpha = 0.5e-6;
-            } else if (substrate.first > 0 && substrate.second == "Ceramic") {
-                E = 300e3; // Ceramic
-                alpha = 7e-6;
-            }
-            double delta_T = temperature(i, j) - ambient_temp;
-            double base_stress = E * alpha * delta_T; // MPa
-
-            // Add stress gradient contribution
-            double gradient_stress = 0.0;
-            if (i > 0 && i < stress.rows() - 1 && j > 0 && j < stress.cols() - 1) {
-                double dT_dx = (temperature(i+1, j) - temperature(i-1, j)) / (2 * dx);
-                double dT_dy = (temperature(i, j+1) - temperature(i, j-1)) / (2 * dx);
-                double gradient = sqrt(dT_dx * dT_dx + dT_dy * dT_dy);
-                gradient_stress = E * alpha * gradient * dx; // Simplified gradient effect
-            }
-            stress(i, j) = base_stress + gradient_stress;
+        const auto stiffness = metal.select(Eigen::ArrayXd::Constant(rows, cell_stiffness), background_stiffness);
+        stress.col(j) = stiffness * (T - ambient_temp);
+        if (j > 0 && j < cols - 1 && rows > 2) {
+            // Central differences over 2 dx, times dx
+            const auto dT_dx = T.segment(2, rows - 2) - T.segment(0, rows - 2);
+            const auto dT_dy = temperature.col(j + 1).segment(1, rows - 2) - temperature.col(j - 1).segment(1, rows - 2);
+            stress.col(j).segment(1, rows - 2) +=
+                stiffness.segment(1, rows - 2) * (0.5 * (dT_dx.square() + dT_dy.square()).sqrt());
         }
+        max_stress = std::max(max_stress, stress.col(j).maxCoeff());
+
+        field.col(j).setConstant(E_field);
     }
 
-    wafer->setThermalStress(stress);
-    Logger::getInstance().log("Thermal stress computed. Max stress: " + std::to_string(stress.maxCoeff()) + " MPa");
+    if (has_metal) {
+        SEMIPRO_LOGF(INFO, PHYSICS, "Electromigration computed. Min MTTF: {} s", min_mttf);
+    } else {
+        SEMIPRO_LOGF(WARNING, PHYSICS, "No metal layers; electromigration MTTF set to zero");
+    }
+    SEMIPRO_LOGF(INFO, PHYSICS, "Thermal stress computed. Max stress: {} MPa", max_stress);
+    if (film_layers.empty()) {
+        SEMIPRO_LOGF(WARNING, PHYSICS, "No dielectric layers; electric field set to zero");
+    } else if (oxide_thickness == 0.0) {
+        SEMIPRO_LOGF(WARNING, PHYSICS, "No SiO2 layers; electric field set to zero");
+    } else {
+        SEMIPRO_LOGF(INFO, PHYSICS, "Dielectric field computed. Field: {} V/cm", E_field);
+    }
 }
 
-void ReliabilityModel::computeDielectricBreakdown(std::shared_ptr<Wafer> wafer, double voltage) {
-    Eigen::ArrayXXd field = Eigen::ArrayXXd::Zero(wafer->getGrid().rows(), wafer->getGrid().cols());
-    const auto& film_layers = wafer->getFilmLayers();
-    if (film_layers.empty()) {
-        wafer->setDielectricField(field);
-        Logger::getInstance().log("WARNING: No dielectric layers; electric field set to zero");
-        return;
+double ChipFailureDistribution::cdf(double t) const {
+    if (failure_times.empty()) {
+        return 0.0;
     }
+    const auto failed = std::upper_bound(failure_times.begin(), failure_times.end(), t) - failure_times.begin();
+    return static_cast<double>(failed) / failure_times.size();
+}
 
-    double thickness = 0.0;
-    for (const auto& layer : film_layers) {
-        if (layer.second == "SiO2") {
-            thickness += layer.first * 1e-4; // um to cm
+double ChipFailureDistribution::quantile(double p) const {
+    if (failure_times.empty()) {
+        return 0.0;
+    }
+    const double rank = std::ceil(std::clamp(p, 0.0, 1.0) * failure_times.size());
+    return failure_times[static_cast<std::size_t>(std::max(rank, 1.0)) - 1];
+}
+
+ChipFailureDistribution ReliabilityModel::sampleChipFailures(std::shared_ptr<Wafer> wafer,
+                                                             const FailureSamplingOptions& options) const {
+    PROFILE_SCOPE("ReliabilityModel::sampleChipFailures");
+    using Distribution = FailureSamplingOptions::Distribution;
+    if (options.samples == 0 || options.copies < 1 || !(options.sigma > 0.0) || !(options.beta > 0.0) ||
+        !(options.chip_sigma >= 0.0)) {
+        throw std::invalid_argument("Failure sampling needs samples, copies, sigma and beta positive");
+    }
+    const ConstFieldView mttf = wafer->getElectromigrationMTTF();
+    const Eigen::Index rows = mttf.rows();
+    const Eigen::Index cols = mttf.cols();
+    const bool parallel = rows * cols >= kParallelCells;
+
+    // Segment count and the range of ln(median), reduced over columns
+    std::size_t segments = 0;
+    double weakest = std::numeric_limits<double>::infinity();
+    double strongest = -std::numeric_limits<double>::infinity();
+#pragma omp parallel for schedule(static) reduction(+ : segments) reduction(min : weakest) \
+    reduction(max : strongest) if (parallel)
+    for (Eigen::Index j = 0; j < cols; ++j) {
+        for (Eigen::Index i = 0; i < rows; ++i) {
+            if (mttf(i, j) > 0.0) {
+                ++segments;
+                weakest = std::min(weakest, mttf(i, j));
+                strongest = std::max(strongest, mttf(i, j));
+            }
         }
     }
-    if (thickness == 0.0) {
-        wafer->setDielectricField(field);
-        Logger::getInstance().log("WARNING: No SiO2 layers; electric field set to zero");
-        return;
+    if (segments == 0 || !std::isfinite(strongest)) {
+        throw std::invalid_argument("No finite electromigration MTTF on the wafer; run performReliabilityTest first");
     }
+    const double lowest = std::log(weakest);
+    const double copies = options.copies;
+    // Sums run over column chunks added in a fixed tree, for the same bits
+    // on any number of threads
+    const std::size_t column_chunk = std::max<std::size_t>(1, kReduceChunk / std::max<Eigen::Index>(rows, 1));
 
-    double E = voltage / thickness; // V/cm
-    for (int i = 0; i < field.rows(); ++i) {
-        for (int j = 0; j < field.cols(); ++j) {
-            if (!film_layers.empty()) {
-                field(i, j) = E;
+    // The chip's cumulative hazard H(t) = -ln S(t) = sum over segments of
+    // -ln S_i(t), so a failure time is H^-1(-ln(1 - U))
+    std::function<double(double)> inverse_hazard;
+    if (options.distribution == Distribution::WEIBULL) {
+        // S_i(t) = exp(-ln 2 (t / t50_i)^beta) sums to H(t) = Lambda t^beta,
+        // with ln Lambda taken relative to the weakest median to stay finite
+        const double beta = options.beta;
+        const double scaled = orderedReduce(
+            static_cast<std::size_t>(cols), 0.0,
+            [&](double& sum, std::size_t j) {
+                for (Eigen::Index i = 0; i < rows; ++i) {
+                    if (mttf(i, j) > 0.0) {
+                        sum += std::exp(-beta * (std::log(mttf(i, j)) - lowest));
+                    }
+                }
+            },
+            [](double& into, double from) { into += from; }, parallel, column_chunk);
+        const double log_lambda = std::log(copies * std::log(2.0) * scaled) - beta * lowest;
+        inverse_hazard = [=](double hazard) { return std::exp((std::log(hazard) - log_lambda) / beta); };
+    } else {
+        // Segments are binned by ln(median), each bin standing at the mean
+        // of its members, with per-thread histograms merged at the end
+        const double sigma = options.sigma;
+        const double span = std::log(strongest) - lowest;
+        const int bins = span > 0.0 ? kMedianBins : 1;
+        const double width = span > 0.0 ? span / bins : 1.0;
+        struct Bins {
+            std::vector<double> counts;
+            std::vector<double> sums;
+        };
+        const Bins binned = orderedReduce(
+            static_cast<std::size_t>(cols), Bins{std::vector<double>(bins, 0.0), std::vector<double>(bins, 0.0)},
+            [&](Bins& local, std::size_t j) {
+                for (Eigen::Index i = 0; i < rows; ++i) {
+                    if (mttf(i, j) > 0.0) {
+                        const double mu = std::log(mttf(i, j));
+                        const int bin = std::min(static_cast<int>((mu - lowest) / width), bins - 1);
+                        local.counts[bin] += 1.0;
+                        local.sums[bin] += mu;
+                    }
+                }
+            },
+            [bins](Bins& into, const Bins& from) {
+                for (int b = 0; b < bins; ++b) {
+                    into.counts[b] += from.counts[b];
+                    into.sums[b] += from.sums[b];
+                }
+            },
+            parallel, column_chunk);
+        const std::vector<double>& counts = binned.counts;
+        const std::vector<double>& sums = binned.sums;
+        std::vector<std::pair<double, double>> occupied; // (mean ln median, count)
+        for (int b = 0; b < bins; ++b) {
+            if (counts[b] > 0.0) {
+                occupied.emplace_back(sums[b] / counts[b], counts[b]);
+            }
+        }
+
+        // ln H at evenly spaced ln t, interpolated linearly between them
+        const double start = lowest - kBelowWeakest * sigma;
+        const double step = (kBelowWeakest + kAboveWeakest) * sigma / (kSurvivalPoints - 1);
+        std::vector<double> log_hazard(kSurvivalPoints);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < kSurvivalPoints; ++k) {
+            const double x = start + k * step;
+            double log_survival = 0.0;
+            for (const auto& bin : occupied) {
+                log_survival += bin.second * logNormalSurvival((x - bin.first) / sigma);
             }
+            log_hazard[k] = std::log(-copies * log_survival);
         }
+        inverse_hazard = [log_hazard = std::move(log_hazard), start, step](double hazard) {
+            const double target = std::log(hazard);
+            const auto above = std::lower_bound(log_hazard.begin(), log_hazard.end(), target);
+            if (above == log_hazard.begin()) {
+                return std::exp(start);
+            }
+            if (above == log_hazard.end()) {
+                return std::exp(start + (log_hazard.size() - 1) * step);
+            }
+            const auto k = above - log_hazard.begin() - 1;
+            if (!std::isfinite(log_hazard[k])) {
+                return std::exp(start + (k + 1) * step); // No hazard yet below
+            }
+            const double fraction = (target - log_hazard[k]) / (*above - log_hazard[k]);
+            return std::exp(start + (k + fraction) * step);
+        };
+    }
+
+    // Sample n takes counter n, and counter (n, 1) for its chip factor
+    ChipFailureDistribution result;
+    result.segments = segments;
+    result.failure_times.resize(options.samples);
+    const Philox4x32 philox(options.seed);
+    const long samples = static_cast<long>(options.samples);
+#pragma omp parallel for schedule(static) if (samples >= kParallelCells)
+    for (long n = 0; n < samples; ++n) {
+        const auto block = philox(static_cast<std::uint64_t>(n));
+        double t = inverse_hazard(-std::log1p(-Philox4x32::uniform(block[0], block[1])));
+        if (options.chip_sigma > 0.0) {
+            t *= std::exp(options.chip_sigma * Philox4x32::normals(philox(static_cast<std::uint64_t>(n), 1))[0]);
+        }
+        result.failure_times[n] = t;
     }
+    std::sort(result.failure_times.begin(), result.failure_times.end());
+    result.mean = reproducibleSum(result.failure_times.data(), result.failure_times.size(), samples >= kParallelCells) /
+                  samples;
+    result.median = result.quantile(0.5);
 
-    wafer->setDielectricField(field);
-    Logger::getInstance().log("Dielectric field computed. Field: " + std::to_string(E) + " V/cm");
-}
\ No newline at end of file
+    SEMIPRO_LOGF(INFO, PHYSICS, "Sampled {} chip failures over {} segments. Median: {} s, 0.1% failed by {} s",
+                 samples, segments, result.median, result.quantile(0.001));
+    return result;
+}
+
+void ReliabilityModel::accumulateThermalFatigue(std::shared_ptr<Wafer> wafer, ThermalFatigueCounter& counter) const {
+    counter.addSample(std::as_const(*wafer).getTemperatureProfile());
+}
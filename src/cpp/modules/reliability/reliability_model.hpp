@@ -1,15 +1,68 @@
 #pragma once
 #include "reliability_interface.hpp"
+#include "../../core/thermal_fatigue.hpp"
 #include "../../core/utils.hpp"
 #include <Eigen/Dense>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct FailureSamplingOptions {
+  enum class Distribution { LOGNORMAL, WEIBULL };
+  Distribution distribution = Distribution::LOGNORMAL;
+  double sigma = 0.5;          // Lognormal shape, the spread of ln t
+  double beta = 2.0;           // Weibull shape
+  double chip_sigma = 0.0;     // Lognormal spread of a factor shared by a chip's segments (process variation)
+  std::size_t samples = 100000; // Chips drawn
+  int copies = 1;              // Identical chips in series, failing with the first of them
+  std::uint64_t seed = 42;
+};
+
+struct ChipFailureDistribution {
+  std::vector<double> failure_times; // s, one per sampled chip, ascending
+  std::size_t segments = 0;          // Metal cells taken as independent segments
+  double mean = 0.0;                 // s
+  double median = 0.0;               // s
+
+  // Fraction of the sampled chips failed by time t
+  double cdf(double t) const;
+  // Time by which a fraction p of the sampled chips has failed
+  double quantile(double p) const;
+};
 
 class ReliabilityModel : public ReliabilityInterface {
 public:
   ReliabilityModel();
   void performReliabilityTest(std::shared_ptr<Wafer> wafer, double current, double voltage) override;
+  // Black's equation with each cell's current density (A/m^2), such as
+  // ThermalSimulationModel::simulateElectroThermal gives, in place of the
+  // current spread evenly over one line. Throws std::invalid_argument for
+  // a map of another shape or with negative entries.
+  void performReliabilityTest(std::shared_ptr<Wafer> wafer, const Eigen::ArrayXXd& current_density, double voltage);
+
+  // Chip lifetimes from the electromigration MTTF map that
+  // performReliabilityTest leaves on the wafer. Every metal cell is a
+  // segment whose failure time is lognormal or Weibull with its MTTF as
+  // the median, and a chip fails with its weakest segment. Segment
+  // medians are first reduced, column by column, to the chip's survival
+  // function (exactly for Weibull, on a fine log-time grid for
+  // lognormal); chips are then drawn from it by Philox counters, so the
+  // cost is linear in segments plus samples and a sample does not depend
+  // on the thread that drew it. Throws std::invalid_argument for bad
+  // options or a wafer without MTTF.
+  ChipFailureDistribution sampleChipFailures(std::shared_ptr<Wafer> wafer,
+                                             const FailureSamplingOptions& options = FailureSamplingOptions()) const;
+
+  // Feeds the wafer's temperature profile to a fatigue counter of its
+  // grid, so a service profile simulated step by step (a thermal solve,
+  // then this) is rainflow-counted as it goes with no history kept. Throws
+  // std::invalid_argument for a counter of another shape.
+  void accumulateThermalFatigue(std::shared_ptr<Wafer> wafer, ThermalFatigueCounter& counter) const;
 
 private:
-  void computeElectromigration(std::shared_ptr<Wafer> wafer, double current);
-  void computeThermalStress(std::shared_ptr<Wafer> wafer);
-  void computeDielectricBreakdown(std::shared_ptr<Wafer> wafer, double voltage);
-};
\ No newline at end of file
+  // Electromigration MTTF (Black's equation), thermal stress and the
+  // dielectric field in one pass over the grid, a column at a time. A
+  // current density map, when given, replaces the current.
+  void computeReliabilityFields(std::shared_ptr<Wafer> wafer, double current, double voltage,
+                                const Eigen::ArrayXXd* current_density = nullptr);
+};
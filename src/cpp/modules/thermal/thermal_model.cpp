@@ -1,6 +1,14 @@
 #include "thermal_model.hpp"
+#include "thermal_operator_cache.hpp"
+#include "../../core/layered_heat_solver.hpp"
+#include "../../core/field_stream_writer.hpp"
+#include "../../core/profiler.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <memory>
 #include <stdexcept>
-#include <Eigen/Sparse>
+#include <string>
 
 ThermalSimulationModel::ThermalSimulationModel() {}
 
@@ -12,8 +20,8 @@ void ThermalSimulationModel::simulateThermal(std::shared_ptr<Wafer> wafer, doubl
     throw std::invalid_argument("Current must be non-negative");
   }
 
-  Logger::getInstance().log("Simulating thermal: ambient_temperature=" + std::to_string(ambient_temperature) +
-                  " K, current=" + std::to_string(current) + " A");
+  SEMIPRO_LOGF(INFO, PHYSICS, "Simulating thermal: ambient_temperature={} K, current={} A",
+               ambient_temperature, current);
 
   initializeThermalProperties(wafer);
   Eigen::ArrayXXd heat_source(wafer->getGrid().rows(), wafer->getGrid().cols());
@@ -22,25 +30,36 @@ void ThermalSimulationModel::simulateThermal(std::shared_ptr<Wafer> wafer, doubl
 }
 
 void ThermalSimulationModel::initializeThermalProperties(std::shared_ptr<Wafer> wafer) {
-  Eigen::ArrayXXd conductivity = Eigen::ArrayXXd::Constant(wafer->getGrid().rows(), wafer->getGrid().cols(), 150.0); // Si
+  // Conductivity and the photoresist mask share the wafer grid's shape, so
+  // the material selection needs no per-cell bounds tests.
+  FieldView conductivity = wafer->getFieldStore().view(Wafer::kThermalConductivityField);
   const auto& film_layers = wafer->getFilmLayers();
   const auto& metal_layers = wafer->getMetalLayers();
   const auto& substrate = wafer->getPackagingSubstrate();
-  const auto& photoresist = wafer->getPhotoresistPattern();
-
-  for (int i = 0; i < conductivity.rows(); ++i) {
-    for (int j = 0; j < conductivity.cols(); ++j) {
-      if (i < photoresist.rows() && j < photoresist.cols() && photoresist(i, j) < 0.5 && !metal_layers.empty()) {
-        conductivity(i, j) = 400.0; // Cu
-      } else if (!film_layers.empty()) {
-        conductivity(i, j) = 1.4; // SiO2
-      }
-      if (substrate.first > 0 && substrate.second == "Ceramic") {
-        conductivity(i, j) = 20.0; // Ceramic
-      }
-    }
+
+  if (substrate.first > 0 && substrate.second == "Ceramic") {
+    conductivity.setConstant(20.0); // Ceramic
+    return;
+  }
+  const double background = film_layers.empty() ? 150.0 : 1.4; // Si or SiO2
+  if (metal_layers.empty()) {
+    conductivity.setConstant(background);
+    return;
+  }
+  conductivity.setConstant(background);
+  wafer->getPhotoresistMask().forEachClear([&](int i, int j) { conductivity(i, j) = 400.0; }); // Cu
+}
+
+void ThermalSimulationModel::computeHeatCapacity(std::shared_ptr<Wafer> wafer, Eigen::ArrayXXd& capacity) {
+  const auto& substrate = wafer->getPackagingSubstrate();
+  if (substrate.first > 0 && substrate.second == "Ceramic") {
+    capacity.setConstant(3.0e6); // Alumina
+    return;
+  }
+  capacity.setConstant(wafer->getFilmLayers().empty() ? 1.63e6 : 1.65e6); // Si or SiO2
+  if (!wafer->getMetalLayers().empty()) {
+    wafer->getPhotoresistMask().forEachClear([&](int i, int j) { capacity(i, j) = 3.45e6; }); // Cu
   }
-  wafer->setThermalConductivity(conductivity);
 }
 
 void ThermalSimulationModel::computeHeatSources(std::shared_ptr<Wafer> wafer, double current, Eigen::ArrayXXd& heat_source) {
@@ -57,7 +76,7 @@ void ThermalSimulationModel::computeHeatSources(std::shared_ptr<Wafer> wafer, do
     }
   }
   if (resistance == 0.0) {
-    Logger::getInstance().log("WARNING: No resistance data; assuming zero heat sources");
+    SEMIPRO_LOGF(WARNING, PHYSICS, "No resistance data; assuming zero heat sources");
     return;
   }
 
@@ -70,69 +89,495 @@ void ThermalSimulationModel::computeHeatSources(std::shared_ptr<Wafer> wafer, do
   double volume = area * thickness; // m^3
   double power_density = volume > 0 ? power / volume : 0.0; // W/m^3
 
-  const auto& photoresist = wafer->getPhotoresistPattern();
-  for (int i = 0; i < heat_source.rows(); ++i) {
-    for (int j = 0; j < heat_source.cols(); ++j) {
-      if (i < photoresist.rows() && j < photoresist.cols() && photoresist(i, j) < 0.5) {
-        heat_source(i, j) = power_density;
-      }
-    }
-  }
+  wafer->getPhotoresistMask().forEachClear([&](int i, int j) { heat_source(i, j) = power_density; });
 }
 
 void ThermalSimulationModel::solveHeatEquation(std::shared_ptr<Wafer> wafer, double ambient_temperature,
                                               const Eigen::ArrayXXd& heat_source) {
+  PROFILE_SCOPE("ThermalSimulationModel::solveHeatEquation");
   int rows = wafer->getGrid().rows();
   int cols = wafer->getGrid().cols();
-  const auto& k = wafer->getThermalConductivity();
-  int N = rows * cols;
-
-  // Sparse matrix for FDM
-  Eigen::SparseMatrix<double> A(N, N);
-  Eigen::VectorXd b(N);
-  std::vector<Eigen::Triplet<double>> triplets;
+  PROFILE_CELLS(static_cast<std::uint64_t>(rows) * cols);
+  const Eigen::ArrayXXd k = wafer->getThermalConductivity();
 
   double dx = 1e-6; // Grid spacing: 1 um
   double dx2 = dx * dx;
 
-  // Build system
-  for (int i = 0; i < rows; ++i) {
-    for (int j = 0; j < cols; ++j) {
-      int idx = i * cols + j;
-      if (i == 0 || i == rows - 1 || j == 0 || j == cols - 1) {
-        triplets.emplace_back(idx, idx, 1.0);
-        b(idx) = ambient_temperature;
-      } else {
-        double k_avg = k(i, j);
-        triplets.emplace_back(idx, idx, 4.0);
-        triplets.emplace_back(idx, (i-1)*cols + j, -1.0);
-        triplets.emplace_back(idx, (i+1)*cols + j, -1.0);
-        triplets.emplace_back(idx, i*cols + (j-1), -1.0);
-        triplets.emplace_back(idx, i*cols + (j+1), -1.0);
-        b(idx) = dx2 * heat_source(i, j) / k_avg;
+  // -div(k grad T) = q inside, with the edge held at ambient. The
+  // multigrid operator stencils on the conductivity directly, and one
+  // built for the same conductivity is reused from the cache.
+  const SemiPRO::CacheKey key = ThermalOperatorCache::key(k);
+  const ThermalOperatorCache::Entry solver = ThermalOperatorCache::instance().get(key, k);
+
+  // Solved for the rise above ambient, which is zero on the edge
+  Eigen::ArrayXXd rise = Eigen::ArrayXXd::Zero(rows, cols);
+  const double heat = heat_source.sum();
+  if (key == last_operator_ && last_heat_ != 0.0) {
+    rise = last_rise_ * (heat / last_heat_);
+  }
+  MultigridSolver::Options options;
+  options.mixed_precision = mixed_precision_;
+  MultigridSolver::Statistics stats;
+  {
+    PROFILE_SCOPE("ThermalSimulationModel::solveHeatEquation/solve");
+    solver->solve(rise, dx2 * heat_source, options, &stats);
+  }
+  last_operator_ = key;
+  last_rise_ = rise;
+  last_heat_ = heat;
+
+  const Eigen::ArrayXXd T = rise + ambient_temperature;
+  wafer->setTemperatureProfile(T);
+  SEMIPRO_LOGF(INFO, PHYSICS, "Thermal simulation completed in {} iterations on {} levels. Max temperature: {} K",
+               stats.iterations, stats.levels, T.maxCoeff());
+}
+
+TransientThermalResults ThermalSimulationModel::simulateTransient(
+    std::shared_ptr<Wafer> wafer, const std::function<double(double)>& ambient_temperature,
+    const std::function<double(double)>& current, const TransientThermalOptions& options,
+    FieldStreamWriter* writer) {
+  PROFILE_SCOPE("ThermalSimulationModel::simulateTransient");
+  if (!(options.end_time > 0.0) || !(options.initial_step > 0.0) || !(options.min_step > 0.0) ||
+      !(options.max_step > 0.0) || !(options.tolerance > 0.0) || options.snapshot_interval < 0.0) {
+    throw std::invalid_argument("Transient end time, steps and tolerance must be positive");
+  }
+  const int rows = wafer->getGrid().rows();
+  const int cols = wafer->getGrid().cols();
+  const double dx2 = 1e-6 * 1e-6; // Grid spacing: 1 um
+
+  initializeThermalProperties(wafer);
+  const Eigen::ArrayXXd k = wafer->getThermalConductivity();
+  Eigen::ArrayXXd capacity(rows, cols);
+  computeHeatCapacity(wafer, capacity);
+  capacity *= dx2;
+  // The heat goes as the square of the current, so one map at 1 A serves
+  // every step
+  Eigen::ArrayXXd unit_heat(rows, cols);
+  computeHeatSources(wafer, 1.0, unit_heat);
+  unit_heat *= dx2;
+  const ThermalOperatorCache::Entry solver =
+      ThermalOperatorCache::instance().get(ThermalOperatorCache::key(k, capacity), k, capacity);
+
+  std::vector<double> breakpoints;
+  for (double t : options.breakpoints) {
+    if (t > 0.0 && t < options.end_time) {
+      breakpoints.push_back(t);
+    }
+  }
+  std::sort(breakpoints.begin(), breakpoints.end());
+  breakpoints.erase(std::unique(breakpoints.begin(), breakpoints.end()), breakpoints.end());
+  breakpoints.push_back(options.end_time);
+
+  TransientThermalResults results;
+  double t = 0.0;
+  Eigen::ArrayXXd T = Eigen::ArrayXXd::Constant(rows, cols, ambient_temperature(0.0));
+  // Earlier accepted fields, most recent first, for BDF2 and the predictor
+  std::vector<Eigen::ArrayXXd> history;
+  std::vector<double> history_times;
+  auto record = [&](bool snapshot) {
+    results.times.push_back(t);
+    results.peak_temperature.push_back(T.maxCoeff());
+    if (writer && snapshot) {
+      wafer->setTemperatureProfile(T);
+      writer->append(*wafer, t);
+      ++results.frames;
+    }
+  };
+  record(true);
+  double next_snapshot = options.snapshot_interval;
+
+  MultigridSolver::Options solve_options;
+  solve_options.mixed_precision = options.mixed_precision;
+  double h = std::min(options.initial_step, options.max_step);
+  std::size_t next_break = 0;
+  while (t < options.end_time) {
+    if (results.steps + results.rejected_steps >= options.max_steps) {
+      throw std::runtime_error("Transient thermal: maximum number of steps reached");
+    }
+    // Land exactly on the next breakpoint or snapshot rather than leave a
+    // sliver before it
+    double landing = breakpoints[next_break];
+    if (writer && options.snapshot_interval > 0.0) {
+      landing = std::min(landing, next_snapshot);
+    }
+    const bool last = h >= (landing - t) * (1.0 - 1e-12);
+    const double step = last ? landing - t : h;
+    const double t1 = last ? landing : t + step;
+    if (step < options.min_step && !last) {
+      throw std::runtime_error("Transient thermal: step size underflow");
+    }
+
+    // BDF2 with step ratio w: (1+2w)/(1+w) T1 - (1+w) T + w^2/(1+w) T_prev = step (dT/dt)1
+    const bool bdf2 = !history.empty();
+    const double w = bdf2 ? step / (t - history_times[0]) : 0.0;
+    Eigen::ArrayXXd source;
+    if (bdf2) {
+      solve_options.capacity_scale = (1.0 + 2.0 * w) / ((1.0 + w) * step);
+      source = capacity * ((1.0 + w) / step * T - w * w / ((1.0 + w) * step) * history[0]);
+    } else {
+      solve_options.capacity_scale = 1.0 / step;
+      source = capacity * T / step;
+    }
+    const double amps = current(t1);
+    source += unit_heat * (amps * amps);
+
+    // The predictor extrapolates the last points to t1; it starts the
+    // solve and its distance from the result estimates the local error
+    Eigen::ArrayXXd predicted = T;
+    if (!history.empty()) {
+      std::vector<double> times{t, history_times[0]};
+      std::vector<const Eigen::ArrayXXd*> fields{&T, &history[0]};
+      if (history.size() > 1) {
+        times.push_back(history_times[1]);
+        fields.push_back(&history[1]);
+      }
+      predicted.setZero();
+      for (std::size_t a = 0; a < times.size(); ++a) {
+        double weight = 1.0;
+        for (std::size_t b = 0; b < times.size(); ++b) {
+          if (b != a) {
+            weight *= (t1 - times[b]) / (times[a] - times[b]);
+          }
+        }
+        predicted += weight * *fields[a];
       }
     }
+    Eigen::ArrayXXd next = predicted;
+    const double edge = ambient_temperature(t1);
+    next.row(0).setConstant(edge);
+    next.row(rows - 1).setConstant(edge);
+    next.col(0).setConstant(edge);
+    next.col(cols - 1).setConstant(edge);
+    MultigridSolver::Statistics stats;
+    solver->solve(next, source, solve_options, &stats);
+    results.solver_iterations += stats.iterations;
+
+    // Milne's estimate: 2/11 of the corrector-predictor gap for BDF2 on a
+    // quadratic predictor. With only a linear one the gap is mostly the
+    // predictor's own error, of which a third is taken.
+    double error = 0.0;
+    if (!history.empty()) {
+      const double constant = bdf2 && history.size() > 1 ? 2.0 / 11.0 : 1.0 / 3.0;
+      error = constant * (next - predicted).block(1, 1, rows - 2, cols - 2).abs().maxCoeff() / options.tolerance;
+    }
+    const double order = bdf2 ? 2.0 : 1.0;
+    const double factor =
+        error == 0.0 ? 2.0 : std::clamp(0.9 * std::pow(error, -1.0 / (order + 1.0)), 0.2, 2.0);
+    if (options.adaptive && error > 1.0) {
+      ++results.rejected_steps;
+      h = step * factor;
+      continue;
+    }
+
+    ++results.steps;
+    history.insert(history.begin(), std::move(T));
+    history_times.insert(history_times.begin(), t);
+    history.resize(std::min<std::size_t>(history.size(), 2));
+    history_times.resize(history.size());
+    T = std::move(next);
+    t = t1;
+    bool snapshot = !writer || options.snapshot_interval == 0.0;
+    if (writer && options.snapshot_interval > 0.0 && t >= next_snapshot * (1.0 - 1e-12)) {
+      snapshot = true;
+      next_snapshot += options.snapshot_interval;
+    }
+    record(snapshot);
+
+    if (last && t == breakpoints[next_break] && next_break + 1 < breakpoints.size()) {
+      // The heat or edge jumps here, so the history no longer applies
+      ++next_break;
+      history.clear();
+      history_times.clear();
+      h = std::min(options.initial_step, options.max_step);
+    } else if (!options.adaptive) {
+      h = options.initial_step;
+    } else if (!(last && step < h)) {
+      // A step cut short at a landing says nothing about the next one
+      h = std::min(step * factor, options.max_step);
+    }
+  }
+
+  wafer->setTemperatureProfile(T);
+  SEMIPRO_LOGF(INFO, PHYSICS, "Transient thermal simulation completed: {} steps, {} rejected, {} solver iterations. "
+               "Final max temperature: {} K", results.steps, results.rejected_steps, results.solver_iterations,
+               T.maxCoeff());
+  return results;
+}
+
+namespace {
+
+// Bulk conductivity (W/m/K) of the materials recipes name
+double layerConductivity(const std::string& material, const std::unordered_map<std::string, double>& overrides) {
+  std::string name = material;
+  std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+  if (auto it = overrides.find(name); it != overrides.end()) {
+    return it->second;
+  }
+  static const std::unordered_map<std::string, double> table = {
+      {"si", 150.0},       {"silicon", 150.0},  {"polysilicon", 30.0}, {"poly", 30.0},
+      {"sio2", 1.4},       {"oxide", 1.4},      {"si3n4", 30.0},       {"nitride", 30.0},
+      {"cu", 400.0},       {"copper", 400.0},   {"al", 237.0},         {"aluminum", 237.0},
+      {"w", 173.0},        {"tungsten", 173.0}, {"ti", 22.0},          {"tin", 29.0},
+      {"ta", 57.0},        {"tan", 36.0},       {"gaas", 55.0},        {"sic", 370.0},
+      {"gan", 130.0},      {"ceramic", 20.0},   {"alumina", 30.0},     {"photoresist", 0.2}};
+  if (auto it = table.find(name); it != table.end()) {
+    return it->second;
+  }
+  throw std::invalid_argument("No thermal conductivity for material: " + material);
+}
+
+} // namespace
+
+LayeredThermalResults ThermalSimulationModel::simulateLayered(std::shared_ptr<Wafer> wafer, double ambient_temperature,
+                                                              double current, const LayeredThermalOptions& options) {
+  PROFILE_SCOPE("ThermalSimulationModel::simulateLayered");
+  if (ambient_temperature <= 0) {
+    throw std::invalid_argument("Ambient temperature must be positive Kelvin");
+  }
+  if (current < 0) {
+    throw std::invalid_argument("Current must be non-negative");
+  }
+  if (!(options.max_plane_thickness > 0.0)) {
+    throw std::invalid_argument("Layered thermal plane thickness must be positive");
+  }
+  const int rows = wafer->getGrid().rows();
+  const int cols = wafer->getGrid().cols();
+  const double dx = 1e-6; // Grid spacing: 1 um
+
+  std::vector<std::pair<double, std::string>> stack = options.stack;
+  const bool from_wafer = stack.empty();
+  if (from_wafer) {
+    stack.insert(stack.end(), wafer->getMetalLayers().rbegin(), wafer->getMetalLayers().rend());
+    stack.insert(stack.end(), wafer->getFilmLayers().rbegin(), wafer->getFilmLayers().rend());
+  }
+  if (from_wafer || options.include_substrate) {
+    stack.emplace_back(wafer->getThickness(), wafer->getMaterialId());
+  }
+
+  LayeredThermalResults results;
+  std::vector<LayeredHeatSolver::Plane> planes;
+  double depth = 0.0;
+  for (std::size_t i = 0; i < stack.size(); ++i) {
+    const double thickness = stack[i].first;
+    if (!(thickness > 0.0)) {
+      throw std::invalid_argument("Layer thickness must be positive: " + stack[i].second);
+    }
+    const double conductivity = layerConductivity(stack[i].second, options.conductivities);
+    const int count = static_cast<int>(std::ceil(thickness / options.max_plane_thickness));
+    const bool substrate = i + 1 == stack.size() && (from_wafer || options.include_substrate);
+    for (int p = 0; p < count; ++p) {
+      planes.push_back({thickness / count * 1e-6, conductivity});
+      results.layer.push_back(substrate ? -1 : static_cast<int>(i));
+      results.depth.push_back(depth + (p + 0.5) * thickness / count);
+    }
+    depth += thickness;
+  }
+
+  // The metal's Joule heat per unit area goes into the top plane
+  Eigen::ArrayXXd heat_source(rows, cols);
+  computeHeatSources(wafer, current, heat_source);
+  double metal_thickness = 0.0;
+  for (const auto& layer : wafer->getMetalLayers()) {
+    metal_thickness += layer.first * 1e-6; // um to m
   }
+  std::vector<Eigen::ArrayXXd> source(planes.size());
+  source[0] = heat_source * (metal_thickness / planes[0].thickness);
 
-  A.setFromTriplets(triplets.begin(), triplets.end());
-  Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
-  solver.compute(A);
-  if (solver.info() != Eigen::Success) {
-    throw std::runtime_error("Thermal solver decomposition failed");
+  LayeredHeatSolver::Options solver_options;
+  solver_options.top_transfer = options.top_transfer;
+  solver_options.bottom_transfer = options.bottom_transfer;
+  const LayeredHeatSolver solver(rows, cols, dx, planes, solver_options);
+  results.temperature = solver.solve(source);
+  for (Eigen::ArrayXXd& plane : results.temperature) {
+    plane += ambient_temperature;
   }
 
-  Eigen::VectorXd T_vec = solver.solve(b);
-  if (solver.info() != Eigen::Success) {
-    throw std::runtime_error("Thermal solver failed");
+  wafer->setTemperatureProfile(results.temperature.front());
+  SEMIPRO_LOGF(INFO, PHYSICS, "Layered thermal simulation completed on {} planes ({} transform). Max temperature: {} K",
+               planes.size(), solver.usesFft() ? "fft" : "dense", results.temperature.front().maxCoeff());
+  return results;
+}
+
+ElectroThermalResults ThermalSimulationModel::simulateElectroThermal(std::shared_ptr<Wafer> wafer,
+                                                                     double ambient_temperature, double current,
+                                                                     const ElectroThermalOptions& options) {
+  PROFILE_SCOPE("ThermalSimulationModel::simulateElectroThermal");
+  if (ambient_temperature <= 0) {
+    throw std::invalid_argument("Ambient temperature must be positive Kelvin");
+  }
+  if (current < 0) {
+    throw std::invalid_argument("Current must be non-negative");
+  }
+  if (!(options.resistivity > 0.0) || !(options.temperature_coefficient >= 0.0) ||
+      !(options.insulator_ratio > 0.0) || !(options.tolerance > 0.0) || options.max_iterations < 1 ||
+      !(options.relaxation > 0.0 && options.relaxation <= 1.0) || !(options.rebuild_ratio > 1.0)) {
+    throw std::invalid_argument("Electro-thermal resistivity, tolerance, relaxation and rebuild ratio out of range");
+  }
+  double thickness = 0.0;
+  for (const auto& layer : wafer->getMetalLayers()) {
+    thickness += layer.first * 1e-6; // um to m
+  }
+  if (thickness <= 0.0) {
+    throw std::invalid_argument("Electro-thermal simulation needs a metal layer");
+  }
+  const int rows = wafer->getGrid().rows();
+  const int cols = wafer->getGrid().cols();
+  const double dx2 = 1e-6 * 1e-6; // Grid spacing: 1 um
+
+  initializeThermalProperties(wafer);
+  const Eigen::ArrayXXd k = wafer->getThermalConductivity();
+  const SemiPRO::CacheKey key = ThermalOperatorCache::key(k);
+  const ThermalOperatorCache::Entry thermal = ThermalOperatorCache::instance().get(key, k);
+
+  // Sheet conductance (S) of each cell, sigma t, with the metal's
+  // resistivity rising linearly from 300 K
+  Eigen::ArrayXXd metal = Eigen::ArrayXXd::Zero(rows, cols);
+  wafer->getPhotoresistMask().forEachClear([&](int i, int j) { metal(i, j) = 1.0; });
+  const double metal_sheet = thickness / options.resistivity;
+  const double insulator_sheet = metal_sheet * options.insulator_ratio;
+  const auto sheet = [&](const Eigen::ArrayXXd& T) {
+    const Eigen::ArrayXXd heated = metal_sheet / (1.0 + options.temperature_coefficient * (T - 300.0)).max(1e-3);
+    return Eigen::ArrayXXd((metal > 0.0).select(heated, insulator_sheet));
+  };
+  const auto harmonic = [](double a, double b) { return 2.0 * a * b / (a + b); };
+
+  // Unit potential on the first column falling to zero on the last, and
+  // linearly along the insulating top and bottom edges
+  ElectroThermalResults results;
+  Eigen::ArrayXXd phi(rows, cols);
+  for (int j = 0; j < cols; ++j) {
+    phi.col(j).setConstant(cols > 1 ? 1.0 - static_cast<double>(j) / (cols - 1) : 1.0);
   }
+  const Eigen::ArrayXXd zero = Eigen::ArrayXXd::Zero(rows, cols);
+  std::unique_ptr<MultigridSolver> electrical;
+  MultigridSolver::Options solve_options;
+  solve_options.mixed_precision = options.mixed_precision;
+  Eigen::ArrayXXd built_from;
+  Eigen::ArrayXXd T = Eigen::ArrayXXd::Constant(rows, cols, ambient_temperature);
+  Eigen::ArrayXXd rise = Eigen::ArrayXXd::Zero(rows, cols);
+  Eigen::ArrayXXd g;
+  Eigen::ArrayXXd power(rows, cols);
+  double voltage = 0.0;
+
+  for (results.iterations = 1; results.iterations <= options.max_iterations; ++results.iterations) {
+    g = sheet(T);
+    if (!electrical || (g / built_from).maxCoeff() > options.rebuild_ratio ||
+        (built_from / g).maxCoeff() > options.rebuild_ratio) {
+      electrical = std::make_unique<MultigridSolver>(g);
+      built_from = g;
+      ++results.rebuilds;
+    } else {
+      electrical->updateConductivity(g);
+    }
+    MultigridSolver::Statistics stats;
+    electrical->solve(phi, zero, solve_options, &stats);
+    results.solver_iterations += stats.iterations;
+
+    // Current through the entry column at unit potential gives the
+    // resistance, and the drive that carries the requested current
+    double unit_current = 0.0;
+    for (int i = 1; i + 1 < rows; ++i) {
+      unit_current += harmonic(g(i, 0), g(i, 1)) * (phi(i, 0) - phi(i, 1));
+    }
+    if (!(unit_current > 0.0)) {
+      throw std::runtime_error("No current path between the contacts");
+    }
+    results.resistance = 1.0 / unit_current;
+    voltage = current * results.resistance;
 
-  Eigen::ArrayXXd T(rows, cols);
-  for (int i = 0; i < rows; ++i) {
+    // Each face dissipates g (delta phi)^2, shared between its two cells
+    power.setZero();
     for (int j = 0; j < cols; ++j) {
-      T(i, j) = T_vec(i * cols + j);
+      for (int i = 0; i < rows; ++i) {
+        if (j > 0) {
+          const double drop = phi(i, j) - phi(i, j - 1);
+          const double p = 0.5 * harmonic(g(i, j), g(i, j - 1)) * drop * drop;
+          power(i, j) += p;
+          power(i, j - 1) += p;
+        }
+        if (i > 0) {
+          const double drop = phi(i, j) - phi(i - 1, j);
+          const double p = 0.5 * harmonic(g(i, j), g(i - 1, j)) * drop * drop;
+          power(i, j) += p;
+          power(i - 1, j) += p;
+        }
+      }
+    }
+    const Eigen::ArrayXXd joule = power * (voltage * voltage / (dx2 * thickness)); // W/m^3
+
+    // The rise is warm-started from the last iterate's
+    thermal->solve(rise, dx2 * joule, solve_options, &stats);
+    results.solver_iterations += stats.iterations;
+    const Eigen::ArrayXXd target = rise + ambient_temperature;
+    const double change = (target - T).abs().maxCoeff();
+    T += options.relaxation * (target - T);
+    results.joule_heat = joule;
+    if (change <= options.tolerance) {
+      break;
     }
   }
+  if (results.iterations > options.max_iterations) {
+    throw std::runtime_error("Electro-thermal iteration did not settle in " +
+                             std::to_string(options.max_iterations) + " iterations");
+  }
 
+  results.potential = voltage * phi;
+  // q = sigma |grad phi|^2 = |J|^2 / sigma, with sigma = g / t
+  results.current_density = (results.joule_heat * g / thickness).sqrt();
   wafer->setTemperatureProfile(T);
-  Logger::getInstance().log("Thermal simulation completed. Max temperature: " + std::to_string(T.maxCoeff()) + " K");
-}
\ No newline at end of file
+  SEMIPRO_LOGF(INFO, PHYSICS, "Electro-thermal simulation converged in {} iterations ({} rebuilds, {} solver "
+               "iterations). Resistance: {} Ohm, max temperature: {} K", results.iterations, results.rebuilds,
+               results.solver_iterations, results.resistance, T.maxCoeff());
+  return results;
+}
+
+AdaptiveThermalResults ThermalSimulationModel::simulateThermalAdaptive(std::shared_ptr<Wafer> wafer,
+                                                                       double ambient_temperature, double current,
+                                                                       const AdaptiveThermalOptions& options) {
+  PROFILE_SCOPE("ThermalSimulationModel::simulateThermalAdaptive");
+  if (ambient_temperature <= 0) {
+    throw std::invalid_argument("Ambient temperature must be positive Kelvin");
+  }
+  if (current < 0) {
+    throw std::invalid_argument("Current must be non-negative");
+  }
+  if (options.max_level < 0 || options.max_level > 15) {
+    throw std::invalid_argument("Adaptive thermal max_level must be in 0..15");
+  }
+  if (!(options.conductivity_threshold >= 0.0) || !(options.source_threshold >= 0.0)) {
+    throw std::invalid_argument("Adaptive thermal thresholds must be non-negative");
+  }
+  const int rows = wafer->getGrid().rows();
+  const int cols = wafer->getGrid().cols();
+  const double dx = 1e-6; // Grid spacing: 1 um
+
+  initializeThermalProperties(wafer);
+  const Eigen::ArrayXXd k = wafer->getThermalConductivity();
+  Eigen::ArrayXXd heat_source(rows, cols);
+  computeHeatSources(wafer, current, heat_source);
+
+  SemiPRO::AdaptiveMesh mesh(rows, cols, options.max_level);
+  mesh.refine_mesh(k, options.conductivity_threshold * k.maxCoeff());
+  if (heat_source.maxCoeff() > 0.0) {
+    mesh.refine_mesh(heat_source, options.source_threshold * heat_source.maxCoeff());
+  }
+
+  // Each leaf's heat in units of the spacing squared, as on the grid
+  Eigen::VectorXd source = mesh.restrict_from_regular_grid(heat_source);
+  for (std::size_t n = 0; n < mesh.size(); ++n) {
+    const double side = mesh.leaves()[n].size();
+    source(n) *= side * side * dx * dx;
+  }
+  const Eigen::VectorXd rise = mesh.solve_diffusion(mesh.restrict_from_regular_grid(k), source);
+  Eigen::ArrayXXd T;
+  mesh.interpolate_to_regular_grid(rise, T);
+  T += ambient_temperature;
+
+  wafer->setTemperatureProfile(T);
+  AdaptiveThermalResults results;
+  results.leaves = mesh.size();
+  results.cells = static_cast<std::size_t>(rows) * cols;
+  SEMIPRO_LOGF(INFO, PHYSICS, "Adaptive thermal simulation completed on {} leaves for {} cells. Max temperature: {} K",
+               results.leaves, results.cells, T.maxCoeff());
+  return results;
+}
@@ -1,15 +1,174 @@
 #pragma once
 #include "thermal_interface.hpp"
 #include "../../core/utils.hpp"
+#include "../../core/performance_utils.hpp"
 #include <Eigen/Dense>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class FieldStreamWriter;
+
+struct TransientThermalOptions {
+    double end_time = 1e-3;       // s
+    double initial_step = 1e-7;   // s, and the step throughout when not adaptive
+    double min_step = 1e-12;      // s
+    double max_step = std::numeric_limits<double>::infinity(); // s
+    double tolerance = 0.01;      // K, local error allowed per step
+    bool adaptive = true;
+    int max_steps = 100000;
+    // Where the current or ambient jumps (pulse edges, recipe steps). Steps
+    // land on them and start over from backward Euler at initial_step.
+    std::vector<double> breakpoints; // s
+    double snapshot_interval = 0.0;  // s between streamed frames; 0 streams every step
+    bool mixed_precision = false;    // Multigrid cycles in single precision, refined in double
+};
+
+struct TransientThermalResults {
+    std::vector<double> times;            // s, from 0 through every accepted step
+    std::vector<double> peak_temperature; // K at each of times
+    int steps = 0;
+    int rejected_steps = 0;
+    int solver_iterations = 0;            // Multigrid iterations over all steps
+    int frames = 0;                       // Frames handed to the writer
+};
+
+struct LayeredThermalOptions {
+    // The stack from the top down as (thickness in um, material), such as
+    // WaferEnhanced::getLayers() gives. Empty takes the wafer's metal
+    // layers over its films, newest first, over the substrate.
+    std::vector<std::pair<double, std::string>> stack;
+    bool include_substrate = true;  // Adds the wafer's own thickness below an explicit stack
+    double max_plane_thickness = 10.0; // um; thicker layers are split into planes
+    double top_transfer = 0.0;      // W/m^2/K from the top surface, 0 for adiabatic
+    double bottom_transfer = std::numeric_limits<double>::infinity(); // W/m^2/K, infinite for a heat sink
+    // W/m/K by lower-case material name, ahead of the built-in table
+    std::unordered_map<std::string, double> conductivities;
+};
+
+struct LayeredThermalResults {
+    std::vector<Eigen::ArrayXXd> temperature; // K per plane, top first
+    std::vector<int> layer;                   // Stack index of each plane, -1 for the substrate
+    std::vector<double> depth;                // um from the top surface to each plane's centre
+};
+
+struct ElectroThermalOptions {
+    double resistivity = 1.68e-8;           // Ohm m of the metal at 300 K (Cu)
+    double temperature_coefficient = 3.9e-3; // 1/K, resistivity rise per kelvin above 300 K
+    double insulator_ratio = 1e-9;          // Conductivity of cells without metal, relative to the metal's
+    double tolerance = 1e-3;                // K, on the largest temperature change of an iteration
+    int max_iterations = 50;
+    double relaxation = 1.0;                // Fraction of each temperature update taken
+    // The electrical hierarchy is rebuilt once the conductivity has moved
+    // by this factor from the one it was built from, and otherwise only
+    // its finest level is refreshed
+    double rebuild_ratio = 1.5;
+    bool mixed_precision = false;           // Multigrid cycles in single precision, refined in double
+};
+
+struct ElectroThermalResults {
+    int iterations = 0;
+    int rebuilds = 0;                // Electrical hierarchies built
+    int solver_iterations = 0;       // Multigrid iterations, electrical and thermal
+    double resistance = 0.0;         // Ohm between the contacts at the final temperature
+    Eigen::ArrayXXd potential;       // V
+    Eigen::ArrayXXd current_density; // A/m^2
+    Eigen::ArrayXXd joule_heat;      // W/m^3
+};
+
+struct AdaptiveThermalOptions {
+    int max_level = 4;                   // Coarsest leaves span 2^max_level cells a side
+    // A leaf splits when the conductivity or the heat source varies across
+    // it by more than this fraction of the field's largest value
+    double conductivity_threshold = 0.05;
+    double source_threshold = 0.05;
+};
+
+struct AdaptiveThermalResults {
+    std::size_t leaves = 0; // Unknowns solved for
+    std::size_t cells = 0;  // Cells of the wafer grid
+};
 
 class ThermalSimulationModel : public ThermalInterface {
 public:
     ThermalSimulationModel();
     void simulateThermal(std::shared_ptr<Wafer> wafer, double ambient_temperature, double current) override;
+    // Runs simulateThermal's multigrid cycles in single precision; the
+    // solve still meets the double-precision tolerance
+    void setMixedPrecision(bool enable) { mixed_precision_ = enable; }
+
+    // Heats the wafer from a uniform ambient_temperature(0) while the
+    // current and the edge temperature follow the given functions of time
+    // (s, giving A and K). rho c dT/dt = div(k grad T) + q is stepped with
+    // variable-step BDF2, started by backward Euler, on one cached
+    // operator whose capacity term is rescaled for each step length. Steps
+    // are sized to the local error tolerance unless options.adaptive is
+    // false. The wafer keeps the final temperature; with a writer, the
+    // temperature is also set and appended at t = 0 and at each snapshot.
+    // Throws std::invalid_argument for bad options and std::runtime_error
+    // when the step size collapses or max_steps is reached.
+    TransientThermalResults simulateTransient(std::shared_ptr<Wafer> wafer,
+                                              const std::function<double(double)>& ambient_temperature,
+                                              const std::function<double(double)>& current,
+                                              const TransientThermalOptions& options = TransientThermalOptions(),
+                                              FieldStreamWriter* writer = nullptr);
+
+    // Steady temperature with the Joule heat of the current actually
+    // flowing through the metal layout, rather than of a single
+    // resistance spread evenly. The current enters along the first column
+    // and leaves along the last; the metal is where the photoresist mask
+    // is clear and the other cells barely conduct. The potential, with
+    // the metal's resistivity at the current temperature, and the
+    // temperature, heated by the potential's Joule heat, are iterated to
+    // a fixed point (Picard). The thermal operator comes from the cache
+    // and serves every iteration. The electrical hierarchy is kept while
+    // the conductivity drifts, only its finest level refreshed. Both
+    // solves start from the previous iterate. The wafer keeps the
+    // temperature. Throws std::invalid_argument for bad options or a wafer
+    // without metal, and std::runtime_error when the iteration does not
+    // settle (thermal runaway).
+    ElectroThermalResults simulateElectroThermal(std::shared_ptr<Wafer> wafer, double ambient_temperature,
+                                                 double current,
+                                                 const ElectroThermalOptions& options = ElectroThermalOptions());
+
+    // Steady temperature through the vertical stack rather than the wafer
+    // plane alone. Each layer conducts with its material's bulk value and
+    // the Joule heat of the metal layers is deposited in the top plane;
+    // the sides are adiabatic. Solved by LayeredHeatSolver, in-plane
+    // transforms and a tridiagonal solve per mode. The wafer keeps the top
+    // plane's temperature. Throws std::invalid_argument for bad options or
+    // a material without a known conductivity.
+    LayeredThermalResults simulateLayered(std::shared_ptr<Wafer> wafer, double ambient_temperature, double current,
+                                          const LayeredThermalOptions& options = LayeredThermalOptions());
+
+    // Steady temperature as simulateThermal solves it, on an adaptive
+    // quadtree that is fine only where the conductivity or the heat source
+    // varies, around metal lines and hot spots, and coarse over the rest.
+    // Leaves take the average conductivity and heat of their cells, the
+    // finite-volume system is factored directly, and the temperature is
+    // reconstructed linearly back onto the grid, which the wafer keeps.
+    // The ambient is held on the grid's outer edge. Throws
+    // std::invalid_argument for bad options.
+    AdaptiveThermalResults simulateThermalAdaptive(std::shared_ptr<Wafer> wafer, double ambient_temperature,
+                                                   double current,
+                                                   const AdaptiveThermalOptions& options = AdaptiveThermalOptions());
 
 private:
     void initializeThermalProperties(std::shared_ptr<Wafer> wafer);
     void computeHeatSources(std::shared_ptr<Wafer> wafer, double current, Eigen::ArrayXXd& heat_source);
+    // Volumetric heat capacity (J/m^3/K) of the materials initializeThermalProperties picks
+    void computeHeatCapacity(std::shared_ptr<Wafer> wafer, Eigen::ArrayXXd& capacity);
     void solveHeatEquation(std::shared_ptr<Wafer> wafer, double ambient_temperature, const Eigen::ArrayXXd& heat_source);
-};
\ No newline at end of file
+
+    // The last solve's rise above ambient and the total heat that caused
+    // it. The rise is linear in the heat, so a later solve on the same
+    // operator starts from it scaled to its own heat.
+    SemiPRO::CacheKey last_operator_;
+    Eigen::ArrayXXd last_rise_;
+    double last_heat_ = 0.0;
+    bool mixed_precision_ = false;
+};
@@ -0,0 +1,92 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "thermal_operator_cache.hpp"
+#include "../../core/profiler.hpp"
+
+ThermalOperatorCache& ThermalOperatorCache::instance() {
+  // Never destroyed, so solves running during static destruction stay valid
+  static ThermalOperatorCache* cache = new ThermalOperatorCache();
+  return *cache;
+}
+
+ThermalOperatorCache::ThermalOperatorCache(std::size_t memory_budget) : memory_budget_(memory_budget) {}
+
+SemiPRO::CacheKey ThermalOperatorCache::key(const Eigen::ArrayXXd& conductivity, const Eigen::ArrayXXd& capacity) {
+  SemiPRO::ContentHasher hasher;
+  hasher.update_string(capacity.size() > 0 ? "multigrid-transient" : "multigrid");
+  hasher.update_value(conductivity.rows()).update_value(conductivity.cols());
+  hasher.update(conductivity.data(), static_cast<std::size_t>(conductivity.size()) * sizeof(double));
+  hasher.update(capacity.data(), static_cast<std::size_t>(capacity.size()) * sizeof(double));
+  return hasher.finish();
+}
+
+ThermalOperatorCache::Entry ThermalOperatorCache::get(const SemiPRO::CacheKey& key,
+                                                      const Eigen::ArrayXXd& conductivity,
+                                                      const Eigen::ArrayXXd& capacity) {
+  Entry found;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = slots_.find(key);
+    if (it != slots_.end()) {
+      ++hits_;
+      lru_.splice(lru_.begin(), lru_, it->second.lru);
+      found = it->second.entry;
+    } else {
+      ++misses_;
+    }
+  }
+  Profiler::getInstance().recordCacheAccess("ThermalOperatorCache", found != nullptr);
+  if (found) {
+    return found;
+  }
+
+  auto entry = capacity.size() > 0 ? std::make_shared<const MultigridSolver>(conductivity, capacity)
+                                    : std::make_shared<const MultigridSolver>(conductivity);
+  const std::size_t bytes = entry->bytes();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = slots_.find(key);
+  if (it != slots_.end()) {
+    return it->second.entry;
+  }
+  if (bytes > memory_budget_) {
+    return entry;
+  }
+  lru_.push_front(key);
+  slots_.emplace(key, Slot{entry, bytes, lru_.begin()});
+  bytes_ += bytes;
+  trim();
+  return entry;
+}
+
+void ThermalOperatorCache::setMemoryBudget(std::size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  memory_budget_ = bytes;
+  trim();
+}
+
+ThermalOperatorCache::Statistics ThermalOperatorCache::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Statistics statistics;
+  statistics.hits = hits_;
+  statistics.misses = misses_;
+  statistics.entries = slots_.size();
+  statistics.bytes = bytes_;
+  return statistics;
+}
+
+void ThermalOperatorCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  slots_.clear();
+  lru_.clear();
+  bytes_ = 0;
+  hits_ = 0;
+  misses_ = 0;
+}
+
+void ThermalOperatorCache::trim() {
+  while (bytes_ > memory_budget_ && !lru_.empty()) {
+    auto it = slots_.find(lru_.back());
+    bytes_ -= it->second.bytes;
+    slots_.erase(it);
+    lru_.pop_back();
+  }
+}
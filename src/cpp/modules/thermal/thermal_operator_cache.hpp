@@ -0,0 +1,65 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "../../core/multigrid.hpp"
+#include "../../core/performance_utils.hpp"
+#include <Eigen/Dense>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Process-wide cache of heat-equation operators.
+//
+// Sweeps over current or ambient temperature leave the conductivity field
+// alone, so its multigrid hierarchy is built once and every later solve
+// only brings a new right-hand side. Transient operators also carry the
+// heat capacity, and serve every time step length. Entries are keyed by a
+// content hash of the conductivity, the capacity if any and their shape,
+// and are evicted least recently used first once they exceed the memory
+// budget. Hits and misses go to the profiler as ThermalOperatorCache.
+class ThermalOperatorCache {
+public:
+  using Entry = std::shared_ptr<const MultigridSolver>;
+
+  struct Statistics {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+  };
+
+  static ThermalOperatorCache& instance();
+  explicit ThermalOperatorCache(std::size_t memory_budget = 256u << 20);
+
+  // An empty capacity stands for a steady operator
+  static SemiPRO::CacheKey key(const Eigen::ArrayXXd& conductivity,
+                               const Eigen::ArrayXXd& capacity = Eigen::ArrayXXd());
+
+  // The operator of conductivity and capacity, whose hash is key, built on
+  // a miss. An operator larger than the budget is returned without being
+  // kept.
+  Entry get(const SemiPRO::CacheKey& key, const Eigen::ArrayXXd& conductivity,
+            const Eigen::ArrayXXd& capacity = Eigen::ArrayXXd());
+
+  void setMemoryBudget(std::size_t bytes);
+  Statistics statistics() const;
+  void clear();
+
+private:
+  struct Slot {
+    Entry entry;
+    std::size_t bytes;
+    std::list<SemiPRO::CacheKey>::iterator lru;
+  };
+
+  void trim(); // Caller holds mutex_
+
+  mutable std::mutex mutex_;
+  std::size_t memory_budget_;
+  std::size_t bytes_ = 0;
+  std::size_t hits_ = 0;
+  std::size_t misses_ = 0;
+  std::list<SemiPRO::CacheKey> lru_; // Most recently used first
+  std::unordered_map<SemiPRO::CacheKey, Slot, SemiPRO::CacheKeyHash> slots_;
+};
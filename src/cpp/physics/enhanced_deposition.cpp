@@ -1,14 +1,132 @@
 #include "enhanced_deposition.hpp"
+#include "../core/philox.hpp"
+#include "../core/reproducibility.hpp"
 #include <algorithm>
+#include <array>
 #include <cmath>
-#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace SemiPRO {
 
-EnhancedDepositionPhysics::EnhancedDepositionPhysics() {
-    initializeMaterialDatabase();
-    initializeTechniqueNames();
-    
+namespace {
+
+// Indexed by DepositionTechnique
+constexpr const char* kTechniqueNames[] = {"CVD", "LPCVD", "PECVD", "MOCVD", "PVD Sputtering",
+                                           "PVD Evaporation", "ALD", "Electroplating", "Spin Coating", "Epitaxy"};
+static_assert(sizeof(kTechniqueNames) / sizeof(kTechniqueNames[0]) ==
+              static_cast<std::size_t>(DepositionTechnique::EPITAXY) + 1, "A technique has no name");
+
+constexpr std::size_t kTechniques = static_cast<std::size_t>(DepositionTechnique::EPITAXY) + 1;
+
+// μm/min before the reaction mechanism's factor
+constexpr double baseDepositionRate(MaterialType material) {
+    switch (material) {
+        case MaterialType::ALUMINUM:
+            return 0.1; // Sputtering rate
+        case MaterialType::COPPER:
+            return 0.5; // Electroplating rate
+        case MaterialType::TUNGSTEN:
+            return 0.05; // CVD rate
+        case MaterialType::SILICON_DIOXIDE:
+            return 0.015; // PECVD rate
+        case MaterialType::SILICON_NITRIDE:
+            return 0.01; // PECVD rate
+        case MaterialType::POLYSILICON:
+            return 0.02; // LPCVD rate
+        default:
+            return 0.05;
+    }
+}
+
+// Typical ALD growth at 200°C (Angstroms per cycle)
+constexpr double aldGrowthPerCycle(MaterialType material) {
+    switch (material) {
+        case MaterialType::ALUMINUM_OXIDE:
+            return 1.1; // Al2O3
+        case MaterialType::HAFNIUM_OXIDE:
+            return 1.0; // HfO2
+        case MaterialType::TITANIUM_NITRIDE:
+            return 0.4; // TiN
+        default:
+            return 1.0;
+    }
+}
+
+template <double (*Value)(MaterialType)>
+constexpr std::array<double, EnhancedDepositionPhysics::kMaterials> materialTable() {
+    std::array<double, EnhancedDepositionPhysics::kMaterials> table{};
+    for (std::size_t material = 0; material < table.size(); ++material) {
+        table[material] = Value(static_cast<MaterialType>(material));
+    }
+    return table;
+}
+
+constexpr auto kBaseDepositionRates = materialTable<baseDepositionRate>();
+constexpr auto kALDGrowthPerCycle = materialTable<aldGrowthPerCycle>();
+
+// The models simulateDeposition routes each technique to
+enum class DepositionFamily { kCVD, kSputtering, kEvaporation, kALD, kGeneric };
+
+constexpr DepositionFamily depositionFamily(DepositionTechnique technique) {
+    switch (technique) {
+        case DepositionTechnique::CVD:
+        case DepositionTechnique::LPCVD:
+        case DepositionTechnique::PECVD:
+        case DepositionTechnique::MOCVD:
+            return DepositionFamily::kCVD;
+        case DepositionTechnique::PVD_SPUTTERING:
+            return DepositionFamily::kSputtering;
+        case DepositionTechnique::PVD_EVAPORATION:
+            return DepositionFamily::kEvaporation;
+        case DepositionTechnique::ALD:
+            return DepositionFamily::kALD;
+        default:
+            return DepositionFamily::kGeneric;
+    }
+}
+
+// Calls f with the technique as a std::integral_constant
+template <typename F>
+void withTechnique(DepositionTechnique technique, F&& f) {
+    switch (technique) {
+        case DepositionTechnique::CVD:
+            f(std::integral_constant<DepositionTechnique, DepositionTechnique::CVD>{});
+            break;
+        case DepositionTechnique::LPCVD:
+            f(std::integral_constant<DepositionTechnique, DepositionTechnique::LPCVD>{});
+            break;
+        case DepositionTechnique::PECVD:
+            f(std::integral_constant<DepositionTechnique, DepositionTechnique::PECVD>{});
+            break;
+        case DepositionTechnique::MOCVD:
+            f(std::integral_constant<DepositionTechnique, DepositionTechnique::MOCVD>{});
+            break;
+        case DepositionTechnique::PVD_SPUTTERING:
+            f(std::integral_constant<DepositionTechnique, DepositionTechnique::PVD_SPUTTERING>{});
+            break;
+        case DepositionTechnique::PVD_EVAPORATION:
+            f(std::integral_constant<DepositionTechnique, DepositionTechnique::PVD_EVAPORATION>{});
+            break;
+        case DepositionTechnique::ALD:
+            f(std::integral_constant<DepositionTechnique, DepositionTechnique::ALD>{});
+            break;
+        case DepositionTechnique::ELECTROPLATING:
+            f(std::integral_constant<DepositionTechnique, DepositionTechnique::ELECTROPLATING>{});
+            break;
+        case DepositionTechnique::SPIN_COATING:
+            f(std::integral_constant<DepositionTechnique, DepositionTechnique::SPIN_COATING>{});
+            break;
+        case DepositionTechnique::EPITAXY:
+            f(std::integral_constant<DepositionTechnique, DepositionTechnique::EPITAXY>{});
+            break;
+    }
+}
+
+} // namespace
+
+EnhancedDepositionPhysics::EnhancedDepositionPhysics() : materials_(defaultMaterials()) {
     // Only log once per process (static flag)
     static bool logged = false;
     if (!logged) {
@@ -84,27 +202,31 @@ DepositionResults EnhancedDepositionPhysics::simulateDeposition(
         // Analyze quality
         results.quality_metrics = analyzeDepositionQuality(results, conditions);
         
-        // Apply results to wafer
-        auto grid = wafer->getGrid();
-        int rows = grid.rows();
-        int cols = grid.cols();
-        
-        for (int i = 0; i < rows; ++i) {
-            for (int j = 0; j < cols; ++j) {
-                // Use spatial variation if available
-                double local_thickness = results.final_thickness;
-                if (!results.thickness_profile.empty()) {
-                    int index = i * cols + j;
-                    if (index < results.thickness_profile.size()) {
-                        local_thickness = results.thickness_profile[index];
-                    }
+        // Apply results to wafer: the surface grows as a level set for as
+        // long as the target thickness takes, each column's speed scaled by
+        // the thickness profile's spatial variation
+        FieldView grid = wafer->getGrid();
+        const int rows = grid.rows();
+        const int cols = grid.cols();
+        const double rate = calculateDepositionRate(conditions);
+        if (rate > 0.0 && results.final_thickness > 0.0) {
+            const LevelSet::Velocity velocity = depositionVelocity(conditions);
+            const std::vector<double>& profile = results.thickness_profile;
+            LevelSet::evolveHeights(grid, cell_size_, results.final_thickness / rate, results.final_thickness,
+                                    [&](const LevelSet::Site& site) {
+                LevelSet::Speed speed = velocity(site);
+                const int i = std::clamp(static_cast<int>(std::lround(site.surface.x())), 0, rows - 1);
+                const int j = std::clamp(static_cast<int>(std::lround(site.surface.y())), 0, cols - 1);
+                const std::size_t index = static_cast<std::size_t>(i) * cols + j;
+                if (index < profile.size()) {
+                    const double scale = profile[index] / results.final_thickness;
+                    speed.normal *= scale;
+                    speed.vertical *= scale;
                 }
-                grid(i, j) += local_thickness;
-            }
+                return speed;
+            });
         }
         
-        wafer->setGrid(grid);
-        
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::PHYSICS,
                           "Enhanced deposition completed: " + 
                           std::to_string(results.final_thickness) + " μm " +
@@ -131,7 +253,6 @@ DepositionResults EnhancedDepositionPhysics::simulateCVD(
     double base_rate = calculateDepositionRate(conditions, SurfaceReaction::REACTION_LIMITED);
     
     // Temperature dependence (Arrhenius)
-    auto material_props = getMaterialProperties(conditions.material);
     double activation_energy = 1.5; // eV (typical for CVD)
     double temp_factor = calculateTemperatureDependence(1.0, activation_energy, conditions.temperature);
     
@@ -145,7 +266,16 @@ DepositionResults EnhancedDepositionPhysics::simulateCVD(
     }
     
     results.deposition_rate = base_rate * temp_factor * pressure_factor * plasma_factor;
+    
+    // Grow on open ground for as long as the target takes at that rate,
+    // through the adsorption transient
     results.final_thickness = conditions.target_thickness;
+    if (results.deposition_rate > 0.0) {
+        SurfaceState state;
+        runCVD(cvdKinetics(conditions, results.deposition_rate), {1.0},
+               60.0 * conditions.target_thickness / results.deposition_rate, state);
+        results.final_thickness = state.thickness[0];
+    }
     
     // CVD typically has good conformality
     results.step_coverage = 0.8 + 0.15 * (conditions.pressure / 10.0); // Better at higher pressure
@@ -195,7 +325,12 @@ DepositionResults EnhancedDepositionPhysics::simulateALD(
     int cycles = calculateALDCycles(conditions.target_thickness, growth_per_cycle);
     
     results.deposition_rate = growth_per_cycle * 60.0; // Assume 1 cycle per minute
-    results.final_thickness = cycles * growth_per_cycle;
+    
+    // What the cycles grow on open ground, short of cycles * growth_per_cycle
+    // where the pulses leave sites free
+    SurfaceState state;
+    runALDCycles(aldCycle(conditions), {1.0}, cycles, state);
+    results.final_thickness = state.thickness[0];
     
     // ALD has perfect conformality
     results.step_coverage = 1.0; // Perfect step coverage
@@ -204,37 +339,122 @@ DepositionResults EnhancedDepositionPhysics::simulateALD(
     return results;
 }
 
+template <DepositionTechnique Technique>
+void EnhancedDepositionPhysics::calculateBatchGroup(
+    const DepositionBatch& batch,
+    Eigen::Index begin,
+    Eigen::Index size,
+    DepositionBatchResults& results) const {
+    
+    constexpr DepositionFamily family = depositionFamily(Technique);
+    const Eigen::ArrayXd kelvin = batch.temperature.segment(begin, size) + 273.15;
+    const auto pressure = batch.pressure.segment(begin, size);
+    
+    // Per-material constant of the technique's model, one gather per entry
+    std::array<double, kMaterials> constants;
+    if constexpr (family == DepositionFamily::kSputtering) {
+        for (std::size_t material = 0; material < kMaterials; ++material) {
+            constants[material] = calculateSputteringYield(static_cast<MaterialType>(material), 500.0);
+        }
+    } else if constexpr (family == DepositionFamily::kEvaporation) {
+        for (std::size_t material = 0; material < kMaterials; ++material) {
+            constants[material] = materials_->properties[material].melting_point;
+        }
+    } else if constexpr (family == DepositionFamily::kALD) {
+        constants = kALDGrowthPerCycle;
+    } else {
+        constants = kBaseDepositionRates;
+    }
+    Eigen::ArrayXd value(size);
+    for (Eigen::Index k = 0; k < size; ++k) {
+        value[k] = constants[static_cast<std::size_t>(batch.material[begin + k])];
+    }
+    
+    Eigen::ArrayXd rate;
+    if constexpr (family == DepositionFamily::kCVD) {
+        // simulateCVD: reaction limited, Arrhenius at 1.5 eV about 400°C and
+        // square root in pressure
+        const double k_boltzmann = 8.617e-5; // eV/K
+        rate = value * (-1.5 * (1.0 / kelvin - 1.0 / (400.0 + 273.15)) / k_boltzmann).exp() * pressure.sqrt();
+        if constexpr (Technique == DepositionTechnique::PECVD) {
+            // calculatePlasmaEnhancement where there is power
+            const auto power = batch.power.segment(begin, size);
+            rate *= (power > 0.0).select((1.0 + 2.0 * (power / 100.0).sqrt()) * pressure.sqrt(), 1.0);
+        }
+    } else if constexpr (family == DepositionFamily::kSputtering) {
+        rate = value * 0.1;
+    } else if constexpr (family == DepositionFamily::kEvaporation) {
+        // calculateEvaporationRate
+        rate = 1e-6 * (-value / kelvin).exp() / kelvin.sqrt() * 0.001;
+    } else if constexpr (family == DepositionFamily::kALD) {
+        // calculateALDGrowthPerCycle, one cycle a minute
+        rate = value * (1.0 + 0.001 * (kelvin - 273.15 - 200.0)) * 1e-4 * 60.0;
+    } else {
+        rate = value;
+    }
+    results.deposition_rate.segment(begin, size) = rate;
+}
+
+DepositionBatchResults EnhancedDepositionPhysics::calculateBatch(const DepositionBatch& batch) const {
+    const Eigen::Index n = static_cast<Eigen::Index>(batch.size());
+    if (batch.temperature.size() != n || batch.pressure.size() != n || batch.target_thickness.size() != n ||
+        batch.power.size() != n || batch.material.size() != batch.size()) {
+        throw PhysicsException("Deposition batch columns differ in length");
+    }
+    
+    DepositionBatchResults results;
+    results.status.assign(batch.size(), KernelStatus::Ok);
+    for (Eigen::Index i = 0; i < n; ++i) {
+        const std::size_t material = static_cast<std::size_t>(batch.material[i]);
+        if (material >= kMaterials || !materials_->known[material]) {
+            results.status[i] = KernelStatus::UnknownMaterial;
+        }
+    }
+    
+    // Entries of each technique side by side, each run then swept by the
+    // kernel built for its technique
+    const BatchGroups groups(batch.technique, kTechniques);
+    DepositionBatch arranged;
+    if (!groups.inOrder()) {
+        arranged.temperature = groups.permute(batch.temperature);
+        arranged.pressure = groups.permute(batch.pressure);
+        arranged.target_thickness = groups.permute(batch.target_thickness);
+        arranged.power = groups.permute(batch.power);
+        arranged.technique = groups.permute(batch.technique);
+        arranged.material = groups.permute(batch.material);
+    }
+    const DepositionBatch& grouped = groups.inOrder() ? batch : arranged;
+    
+    results.deposition_rate.resize(n);
+    for (std::size_t key = 0; key < groups.keyCount(); ++key) {
+        if (groups.size(key) > 0) {
+            withTechnique(static_cast<DepositionTechnique>(key), [&](auto technique) {
+                calculateBatchGroup<decltype(technique)::value>(grouped, groups.begin(key), groups.size(key), results);
+            });
+        }
+    }
+    groups.restore(results.deposition_rate);
+    
+    // Same ranges as validateConditions, in its order
+    markFailed(results.status, batch.temperature >= 0.0 && batch.temperature <= 2000.0,
+               KernelStatus::TemperatureOutOfRange);
+    markFailed(results.status, batch.target_thickness > 0.0 && batch.target_thickness <= 100.0,
+               KernelStatus::ThicknessOutOfRange);
+    markFailed(results.status, batch.pressure > 0.0 && batch.pressure <= 1000.0, KernelStatus::PressureOutOfRange);
+    markFailed(results.status, results.deposition_rate.isFinite(), KernelStatus::NonFinite);
+    results.deposition_rate = statusOk(results.status).select(results.deposition_rate, 0.0);
+    return results;
+}
+
 double EnhancedDepositionPhysics::calculateDepositionRate(
     const DepositionConditions& conditions,
     SurfaceReaction mechanism) const {
     
-    auto material_props = getMaterialProperties(conditions.material);
+    // Throws for an unknown material before it indexes the rate table
+    getMaterialProperties(conditions.material);
     
     // Base rate depends on material and technique
-    double base_rate = 0.1; // μm/min default
-    
-    switch (conditions.material) {
-        case MaterialType::ALUMINUM:
-            base_rate = 0.1; // Sputtering rate
-            break;
-        case MaterialType::COPPER:
-            base_rate = 0.5; // Electroplating rate
-            break;
-        case MaterialType::TUNGSTEN:
-            base_rate = 0.05; // CVD rate
-            break;
-        case MaterialType::SILICON_DIOXIDE:
-            base_rate = 0.015; // PECVD rate
-            break;
-        case MaterialType::SILICON_NITRIDE:
-            base_rate = 0.01; // PECVD rate
-            break;
-        case MaterialType::POLYSILICON:
-            base_rate = 0.02; // LPCVD rate
-            break;
-        default:
-            base_rate = 0.05;
-    }
+    double base_rate = kBaseDepositionRates[static_cast<std::size_t>(conditions.material)];
     
     // Apply reaction mechanism effects
     switch (mechanism) {
@@ -254,6 +474,103 @@ double EnhancedDepositionPhysics::calculateDepositionRate(
     return base_rate;
 }
 
+LevelSet::Velocity EnhancedDepositionPhysics::depositionVelocity(
+    const DepositionConditions& conditions) const {
+    
+    const double rate = calculateDepositionRate(conditions);
+    const double coverage = std::clamp(calculateStepCoverage(conditions, 0.0), 0.0, 1.0);
+    return LevelSet::directional(rate, 1.0 - coverage);
+}
+
+FluxTracer::Source EnhancedDepositionPhysics::depositionSource(
+    const DepositionConditions& conditions) const {
+    
+    FluxTracer::Source source;
+    switch (conditions.technique) {
+        case DepositionTechnique::PVD_EVAPORATION:
+            source.exponent = 50.0; // Line of sight from a distant source
+            break;
+        case DepositionTechnique::PVD_SPUTTERING:
+            source.exponent = 4.0;  // Forward-peaked, broadened by gas scattering
+            break;
+        default:
+            source.exponent = 1.0;  // Precursor gas arriving from every direction
+            break;
+    }
+    source.sticking = calculateStickingCoefficient(conditions.material, conditions.temperature, conditions.pressure);
+    return source;
+}
+
+int EnhancedDepositionPhysics::simulateFeatureProfile(
+    LevelSet& surface,
+    const DepositionConditions& conditions,
+    double time,
+    FluxTracer& tracer) const {
+    
+    SEMIPRO_PERF_TIMER("feature_deposition", "EnhancedDeposition");
+    
+    const double rate = calculateDepositionRate(conditions);
+    const FluxTracer::Source source = depositionSource(conditions);
+    return tracer.evolve(surface, time, [&](const FluxTracer& traced) {
+        std::vector<double> speeds = traced.trace(source);
+        for (double& speed : speeds) {
+            speed *= rate;
+        }
+        return speeds;
+    });
+}
+
+double EnhancedDepositionPhysics::calculateStickingCoefficient(
+    MaterialType material,
+    double temperature,
+    double pressure) const {
+    
+    // Probability an arriving atom or precursor molecule stays where it lands
+    double sticking = 0.1;
+    switch (material) {
+        case MaterialType::ALUMINUM:
+        case MaterialType::COPPER:
+        case MaterialType::TUNGSTEN:
+        case MaterialType::TITANIUM:
+        case MaterialType::TANTALUM:
+            sticking = 0.9; // Metal atoms condense almost everywhere
+            break;
+        case MaterialType::TITANIUM_NITRIDE:
+        case MaterialType::TANTALUM_NITRIDE:
+            sticking = 0.5;
+            break;
+        case MaterialType::POLYSILICON:
+        case MaterialType::AMORPHOUS_SI:
+        case MaterialType::SILICON_CARBIDE:
+            sticking = 0.1;
+            break;
+        case MaterialType::SILICON_DIOXIDE:
+        case MaterialType::SILICON_NITRIDE:
+            sticking = 0.05; // TEOS and silane chemistries
+            break;
+        case MaterialType::HAFNIUM_OXIDE:
+        case MaterialType::ALUMINUM_OXIDE:
+            sticking = 0.01; // Self-limiting ALD precursors
+            break;
+        case MaterialType::PHOTORESIST:
+            sticking = 1.0;
+            break;
+    }
+    
+    // Desorption before reaction grows with temperature; collisions in the
+    // gas return some of what desorbs, more so at higher pressure
+    const double desorption = 1.0 + 1e-3 * std::max(0.0, temperature);
+    const double readsorption = 1.0 + 0.01 * std::max(0.0, pressure);
+    return std::clamp(sticking * readsorption / desorption, 1e-3, 1.0);
+}
+
+void EnhancedDepositionPhysics::setCellSize(double cell_size) {
+    if (!(cell_size > 0.0)) {
+        throw std::invalid_argument("Deposition cell size must be positive");
+    }
+    cell_size_ = cell_size;
+}
+
 double EnhancedDepositionPhysics::calculateStepCoverage(
     const DepositionConditions& conditions,
     double aspect_ratio) const {
@@ -293,111 +610,110 @@ double EnhancedDepositionPhysics::calculateConformality(
     return calculateStepCoverage(conditions, aspect_ratio);
 }
 
-void EnhancedDepositionPhysics::initializeMaterialDatabase() {
-    // Aluminum
-    MaterialProperties aluminum;
-    aluminum.name = "Aluminum";
-    aluminum.chemical_formula = "Al";
-    aluminum.density = 2.70;
-    aluminum.melting_point = 660.0;
-    aluminum.thermal_conductivity = 237.0;
-    aluminum.electrical_resistivity = 2.65e-6;
-    aluminum.stress_intrinsic = -200.0; // Compressive
-    aluminum.etch_selectivity = 0.1;
-    aluminum.refractive_index = 1.44;
-    aluminum.is_conductor = true;
-    aluminum.is_barrier_metal = false;
-    material_database_[MaterialType::ALUMINUM] = aluminum;
-    
-    // Silicon Dioxide
-    MaterialProperties sio2;
-    sio2.name = "Silicon Dioxide";
-    sio2.chemical_formula = "SiO2";
-    sio2.density = 2.20;
-    sio2.melting_point = 1713.0;
-    sio2.thermal_conductivity = 1.4;
-    sio2.electrical_resistivity = 1e16;
-    sio2.stress_intrinsic = 300.0; // Tensile
-    sio2.etch_selectivity = 1.0; // Reference
-    sio2.refractive_index = 1.46;
-    sio2.is_conductor = false;
-    sio2.is_barrier_metal = false;
-    material_database_[MaterialType::SILICON_DIOXIDE] = sio2;
-
-    // Polysilicon
-    MaterialProperties polysilicon;
-    polysilicon.name = "Polysilicon";
-    polysilicon.chemical_formula = "poly-Si";
-    polysilicon.density = 2.33;
-    polysilicon.melting_point = 1414.0;
-    polysilicon.thermal_conductivity = 150.0;
-    polysilicon.electrical_resistivity = 1e-3; // Doped polysilicon
-    polysilicon.stress_intrinsic = -100.0; // Compressive
-    polysilicon.etch_selectivity = 0.5;
-    polysilicon.refractive_index = 3.88;
-    polysilicon.is_conductor = true;
-    polysilicon.is_barrier_metal = false;
-    material_database_[MaterialType::POLYSILICON] = polysilicon;
-
-    // Silicon Nitride
-    MaterialProperties si3n4;
-    si3n4.name = "Silicon Nitride";
-    si3n4.chemical_formula = "Si3N4";
-    si3n4.density = 3.17;
-    si3n4.melting_point = 1900.0;
-    si3n4.thermal_conductivity = 30.0;
-    si3n4.electrical_resistivity = 1e14;
-    si3n4.stress_intrinsic = 1000.0; // Tensile
-    si3n4.etch_selectivity = 10.0;
-    si3n4.refractive_index = 2.01;
-    si3n4.is_conductor = false;
-    si3n4.is_barrier_metal = false;
-    material_database_[MaterialType::SILICON_NITRIDE] = si3n4;
-
-    // Copper
-    MaterialProperties copper;
-    copper.name = "Copper";
-    copper.chemical_formula = "Cu";
-    copper.density = 8.96;
-    copper.melting_point = 1085.0;
-    copper.thermal_conductivity = 401.0;
-    copper.electrical_resistivity = 1.68e-6;
-    copper.stress_intrinsic = -50.0; // Compressive
-    copper.etch_selectivity = 0.01;
-    copper.refractive_index = 0.94;
-    copper.is_conductor = true;
-    copper.is_barrier_metal = false;
-    material_database_[MaterialType::COPPER] = copper;
-
-    // Tungsten
-    MaterialProperties tungsten;
-    tungsten.name = "Tungsten";
-    tungsten.chemical_formula = "W";
-    tungsten.density = 19.25;
-    tungsten.melting_point = 3422.0;
-    tungsten.thermal_conductivity = 173.0;
-    tungsten.electrical_resistivity = 5.6e-6;
-    tungsten.stress_intrinsic = -500.0; // Compressive
-    tungsten.etch_selectivity = 0.1;
-    tungsten.refractive_index = 3.5;
-    tungsten.is_conductor = true;
-    tungsten.is_barrier_metal = true;
-    material_database_[MaterialType::TUNGSTEN] = tungsten;
-
-    // Add more materials as needed...
-}
-
-void EnhancedDepositionPhysics::initializeTechniqueNames() {
-    technique_names_[DepositionTechnique::CVD] = "CVD";
-    technique_names_[DepositionTechnique::LPCVD] = "LPCVD";
-    technique_names_[DepositionTechnique::PECVD] = "PECVD";
-    technique_names_[DepositionTechnique::MOCVD] = "MOCVD";
-    technique_names_[DepositionTechnique::PVD_SPUTTERING] = "PVD Sputtering";
-    technique_names_[DepositionTechnique::PVD_EVAPORATION] = "PVD Evaporation";
-    technique_names_[DepositionTechnique::ALD] = "ALD";
-    technique_names_[DepositionTechnique::ELECTROPLATING] = "Electroplating";
-    technique_names_[DepositionTechnique::SPIN_COATING] = "Spin Coating";
-    technique_names_[DepositionTechnique::EPITAXY] = "Epitaxy";
+std::shared_ptr<const EnhancedDepositionPhysics::MaterialTable> EnhancedDepositionPhysics::defaultMaterials() {
+    // Built once; every engine starts out pointing at it
+    static const std::shared_ptr<const MaterialTable> defaults = [] {
+        auto table = std::make_shared<MaterialTable>();
+        auto add = [&table](MaterialType material, const MaterialProperties& properties) {
+            const std::size_t index = static_cast<std::size_t>(material);
+            table->properties[index] = properties;
+            table->known[index] = true;
+        };
+    
+        // Aluminum
+        MaterialProperties aluminum;
+        aluminum.name = "Aluminum";
+        aluminum.chemical_formula = "Al";
+        aluminum.density = 2.70;
+        aluminum.melting_point = 660.0;
+        aluminum.thermal_conductivity = 237.0;
+        aluminum.electrical_resistivity = 2.65e-6;
+        aluminum.stress_intrinsic = -200.0; // Compressive
+        aluminum.etch_selectivity = 0.1;
+        aluminum.refractive_index = 1.44;
+        aluminum.is_conductor = true;
+        aluminum.is_barrier_metal = false;
+        add(MaterialType::ALUMINUM, aluminum);
+    
+        // Silicon Dioxide
+        MaterialProperties sio2;
+        sio2.name = "Silicon Dioxide";
+        sio2.chemical_formula = "SiO2";
+        sio2.density = 2.20;
+        sio2.melting_point = 1713.0;
+        sio2.thermal_conductivity = 1.4;
+        sio2.electrical_resistivity = 1e16;
+        sio2.stress_intrinsic = 300.0; // Tensile
+        sio2.etch_selectivity = 1.0; // Reference
+        sio2.refractive_index = 1.46;
+        sio2.is_conductor = false;
+        sio2.is_barrier_metal = false;
+        add(MaterialType::SILICON_DIOXIDE, sio2);
+
+        // Polysilicon
+        MaterialProperties polysilicon;
+        polysilicon.name = "Polysilicon";
+        polysilicon.chemical_formula = "poly-Si";
+        polysilicon.density = 2.33;
+        polysilicon.melting_point = 1414.0;
+        polysilicon.thermal_conductivity = 150.0;
+        polysilicon.electrical_resistivity = 1e-3; // Doped polysilicon
+        polysilicon.stress_intrinsic = -100.0; // Compressive
+        polysilicon.etch_selectivity = 0.5;
+        polysilicon.refractive_index = 3.88;
+        polysilicon.is_conductor = true;
+        polysilicon.is_barrier_metal = false;
+        add(MaterialType::POLYSILICON, polysilicon);
+
+        // Silicon Nitride
+        MaterialProperties si3n4;
+        si3n4.name = "Silicon Nitride";
+        si3n4.chemical_formula = "Si3N4";
+        si3n4.density = 3.17;
+        si3n4.melting_point = 1900.0;
+        si3n4.thermal_conductivity = 30.0;
+        si3n4.electrical_resistivity = 1e14;
+        si3n4.stress_intrinsic = 1000.0; // Tensile
+        si3n4.etch_selectivity = 10.0;
+        si3n4.refractive_index = 2.01;
+        si3n4.is_conductor = false;
+        si3n4.is_barrier_metal = false;
+        add(MaterialType::SILICON_NITRIDE, si3n4);
+
+        // Copper
+        MaterialProperties copper;
+        copper.name = "Copper";
+        copper.chemical_formula = "Cu";
+        copper.density = 8.96;
+        copper.melting_point = 1085.0;
+        copper.thermal_conductivity = 401.0;
+        copper.electrical_resistivity = 1.68e-6;
+        copper.stress_intrinsic = -50.0; // Compressive
+        copper.etch_selectivity = 0.01;
+        copper.refractive_index = 0.94;
+        copper.is_conductor = true;
+        copper.is_barrier_metal = false;
+        add(MaterialType::COPPER, copper);
+
+        // Tungsten
+        MaterialProperties tungsten;
+        tungsten.name = "Tungsten";
+        tungsten.chemical_formula = "W";
+        tungsten.density = 19.25;
+        tungsten.melting_point = 3422.0;
+        tungsten.thermal_conductivity = 173.0;
+        tungsten.electrical_resistivity = 5.6e-6;
+        tungsten.stress_intrinsic = -500.0; // Compressive
+        tungsten.etch_selectivity = 0.1;
+        tungsten.refractive_index = 3.5;
+        tungsten.is_conductor = true;
+        tungsten.is_barrier_metal = true;
+        add(MaterialType::TUNGSTEN, tungsten);
+
+        // Add more materials as needed...
+        return std::shared_ptr<const MaterialTable>(std::move(table));
+    }();
+    return defaults;
 }
 
 double EnhancedDepositionPhysics::calculateTemperatureDependence(
@@ -438,26 +754,156 @@ double EnhancedDepositionPhysics::calculatePlasmaEnhancement(
     return base_rate * enhancement * pressure_factor;
 }
 
+namespace {
+
+constexpr double kBoltzmann = 8.617e-5;       // eV/K
+constexpr double kAttemptFrequency = 1e13;    // 1/s
+constexpr double kLangmuir = 1e-6;            // Torr s of exposure to fill a monolayer at unit sticking
+constexpr double kDesorptionEnergy = 2.0;     // eV, chemisorbed precursor
+constexpr double kReactionEnergy = 1.5;       // eV, CVD surface reaction
+constexpr double kCoreactantRate = 1e3;       // 1/s, ALD co-reactant on open ground
+
+} // namespace
+
+ALDCycle EnhancedDepositionPhysics::aldCycle(
+    const DepositionConditions& conditions) const {
+    
+    const double temperature = conditions.temperature + 273.15;
+    ALDCycle cycle;
+    cycle.adsorption_rate = calculateStickingCoefficient(conditions.material, conditions.temperature,
+                                                         conditions.pressure) * conditions.pressure / kLangmuir;
+    cycle.desorption_rate = kAttemptFrequency * std::exp(-kDesorptionEnergy / (kBoltzmann * temperature));
+    cycle.reaction_rate = kCoreactantRate;
+    cycle.growth_per_cycle = calculateALDGrowthPerCycle(conditions.material, conditions.temperature);
+    return cycle;
+}
+
+CVDKinetics EnhancedDepositionPhysics::cvdKinetics(
+    const DepositionConditions& conditions,
+    double deposition_rate) const {
+    
+    const double temperature = conditions.temperature + 273.15;
+    CVDKinetics kinetics;
+    kinetics.adsorption_rate = calculateStickingCoefficient(conditions.material, conditions.temperature,
+                                                            conditions.pressure) * conditions.pressure / kLangmuir;
+    kinetics.desorption_rate = kAttemptFrequency * std::exp(-kDesorptionEnergy / (kBoltzmann * temperature));
+    kinetics.reaction_rate = kAttemptFrequency * std::exp(-kReactionEnergy / (kBoltzmann * temperature));
+    // The steady coverage reacting at reaction_rate grows deposition_rate
+    const double coverage = kinetics.adsorption_rate /
+        (kinetics.adsorption_rate + kinetics.desorption_rate + kinetics.reaction_rate);
+    kinetics.growth_per_monolayer = deposition_rate / 60.0 / (kinetics.reaction_rate * coverage);
+    return kinetics;
+}
+
+void EnhancedDepositionPhysics::runALDCycles(
+    const ALDCycle& cycle,
+    const std::vector<double>& exposure,
+    int cycles,
+    SurfaceState& state) const {
+    
+    if (cycles < 0) {
+        throw std::invalid_argument("ALD cycle count must not be negative");
+    }
+    const int n = static_cast<int>(exposure.size());
+    if (state.coverage.empty() && state.thickness.empty()) {
+        state.coverage.assign(n, 0.0);
+        state.thickness.assign(n, 0.0);
+    }
+    if (static_cast<int>(state.coverage.size()) != n || static_cast<int>(state.thickness.size()) != n) {
+        throw std::invalid_argument("Surface state does not match the exposures");
+    }
+    
+    const double kept = std::exp(-cycle.desorption_rate * cycle.purge);
+    #pragma omp parallel for schedule(static)
+    for (int e = 0; e < n; ++e) {
+        // Coverage after each step of the cycle, from coverage c before it:
+        // adsorption leaves a c + (1 - a), the purge keeps a fraction, and the
+        // co-reactant grows film from r of it and leaves the rest
+        const double x = std::max(0.0, exposure[e]);
+        const double a = std::exp(-cycle.adsorption_rate * x * cycle.precursor_pulse);
+        const double r = 1.0 - std::exp(-cycle.reaction_rate * x * cycle.reactant_pulse);
+        const double g = cycle.growth_per_cycle;
+        // Acting on (coverage, thickness, 1)
+        Eigen::Matrix3d step;
+        step << (1.0 - r) * kept * a, 0.0, (1.0 - r) * kept * (1.0 - a),
+                g * r * kept * a,     1.0, g * r * kept * (1.0 - a),
+                0.0,                  0.0, 1.0;
+        Eigen::Matrix3d power = Eigen::Matrix3d::Identity();
+        for (int remaining = cycles; remaining > 0; remaining >>= 1) {
+            if (remaining & 1) {
+                power = step * power;
+            }
+            step = step * step;
+        }
+        const Eigen::Vector3d next = power * Eigen::Vector3d(state.coverage[e], state.thickness[e], 1.0);
+        state.coverage[e] = next[0];
+        state.thickness[e] = next[1];
+    }
+}
+
+void EnhancedDepositionPhysics::runCVD(
+    const CVDKinetics& kinetics,
+    const std::vector<double>& exposure,
+    double time,
+    SurfaceState& state) const {
+    
+    const int n = static_cast<int>(exposure.size());
+    if (state.coverage.empty() && state.thickness.empty()) {
+        state.coverage.assign(n, 0.0);
+        state.thickness.assign(n, 0.0);
+    }
+    if (static_cast<int>(state.coverage.size()) != n || static_cast<int>(state.thickness.size()) != n) {
+        throw std::invalid_argument("Surface state does not match the exposures");
+    }
+    
+    #pragma omp parallel for schedule(static)
+    for (int e = 0; e < n; ++e) {
+        // dc/dt = k_a (1 - c) - (k_d + k_r) c relaxes to its steady value
+        // exponentially; the film grows with the integral of k_r c
+        const double adsorption = kinetics.adsorption_rate * std::max(0.0, exposure[e]);
+        const double total = adsorption + kinetics.desorption_rate + kinetics.reaction_rate;
+        if (total <= 0.0) {
+            continue;
+        }
+        const double steady = adsorption / total;
+        const double offset = state.coverage[e] - steady;
+        const double relaxed = -std::expm1(-total * time); // 1 - exp(-total t)
+        const double integral = steady * time + offset * relaxed / total;
+        state.thickness[e] += kinetics.growth_per_monolayer * kinetics.reaction_rate * integral;
+        state.coverage[e] = steady + offset * (1.0 - relaxed);
+    }
+}
+
+int EnhancedDepositionPhysics::simulateFeatureALD(
+    LevelSet& surface,
+    const DepositionConditions& conditions,
+    int cycles,
+    FluxTracer& tracer) const {
+    
+    SEMIPRO_PERF_TIMER("feature_ald", "EnhancedDeposition");
+    
+    const ALDCycle cycle = aldCycle(conditions);
+    const FluxTracer::Source source = depositionSource(conditions);
+    const int batch = std::max(1, static_cast<int>(0.5 * surface.spacing() / cycle.growth_per_cycle));
+    int traces = 0;
+    for (int done = 0; done < cycles; done += batch) {
+        tracer.update(surface);
+        const std::vector<double> exposure = tracer.trace(source);
+        ++traces;
+        SurfaceState state;
+        runALDCycles(cycle, exposure, std::min(batch, cycles - done), state);
+        // Each element's growth, moved in one unit of time
+        surface.advance(1.0, tracer.velocity(state.thickness));
+    }
+    return traces;
+}
+
 double EnhancedDepositionPhysics::calculateALDGrowthPerCycle(
     MaterialType material,
     double temperature) const {
 
     // Typical ALD growth rates (Angstroms per cycle)
-    double growth_per_cycle = 1.0; // Angstroms
-
-    switch (material) {
-        case MaterialType::ALUMINUM_OXIDE:
-            growth_per_cycle = 1.1; // Al2O3
-            break;
-        case MaterialType::HAFNIUM_OXIDE:
-            growth_per_cycle = 1.0; // HfO2
-            break;
-        case MaterialType::TITANIUM_NITRIDE:
-            growth_per_cycle = 0.4; // TiN
-            break;
-        default:
-            growth_per_cycle = 1.0;
-    }
+    double growth_per_cycle = kALDGrowthPerCycle[static_cast<std::size_t>(material)];
 
     // Temperature dependence (mild for ALD)
     double temp_factor = 1.0 + 0.001 * (temperature - 200.0);
@@ -498,7 +944,7 @@ double EnhancedDepositionPhysics::calculateEvaporationRate(
     double temperature,
     double pressure) const {
 
-    auto material_props = getMaterialProperties(material);
+    const MaterialProperties& material_props = getMaterialProperties(material);
 
     // Simplified evaporation rate (Hertz-Knudsen equation)
     double vapor_pressure = 1e-6 * std::exp(-material_props.melting_point / (temperature + 273.15));
@@ -512,21 +958,18 @@ std::vector<double> EnhancedDepositionPhysics::calculateThicknessProfile(
     const DepositionConditions& conditions,
     double base_thickness) {
 
-    auto grid = wafer->getGrid();
+    const auto& grid = wafer->getGrid();
     int rows = grid.rows();
     int cols = grid.cols();
 
     std::vector<double> profile(rows * cols, base_thickness);
 
-    // Add small random variations (±5%)
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::normal_distribution<> dis(1.0, 0.05);
-
+    // Add small random variations (±5%), each cell's from its own counter
+    const Philox4x32 philox(Reproducibility::key());
     for (int i = 0; i < rows; ++i) {
         for (int j = 0; j < cols; ++j) {
             int index = i * cols + j;
-            profile[index] = base_thickness * dis(gen);
+            profile[index] = base_thickness * (1.0 + 0.05 * Philox4x32::normals(philox(index))[0]);
         }
     }
 
@@ -557,22 +1000,33 @@ double EnhancedDepositionPhysics::calculateUniformity(
     return (1.0 - sigma / mean) * 100.0; // Uniformity percentage
 }
 
-MaterialProperties EnhancedDepositionPhysics::getMaterialProperties(MaterialType material) const {
-    auto it = material_database_.find(material);
-    if (it == material_database_.end()) {
+const MaterialProperties& EnhancedDepositionPhysics::getMaterialProperties(MaterialType material) const {
+    const std::size_t index = static_cast<std::size_t>(material);
+    if (index >= kMaterials || !materials_->known[index]) {
         throw PhysicsException("Unknown material type");
     }
-    return it->second;
+    return materials_->properties[index];
+}
+
+void EnhancedDepositionPhysics::setMaterialProperties(MaterialType material, const MaterialProperties& properties) {
+    const std::size_t index = static_cast<std::size_t>(material);
+    if (index >= kMaterials) {
+        throw std::invalid_argument("Unknown material type");
+    }
+    // Copy on write, leaving engines that share the table untouched
+    auto table = std::make_shared<MaterialTable>(*materials_);
+    table->properties[index] = properties;
+    table->known[index] = true;
+    materials_ = std::move(table);
 }
 
 std::string EnhancedDepositionPhysics::techniqueToString(DepositionTechnique technique) const {
-    auto it = technique_names_.find(technique);
-    return (it != technique_names_.end()) ? it->second : "Unknown";
+    const std::size_t index = static_cast<std::size_t>(technique);
+    return index < std::size(kTechniqueNames) ? kTechniqueNames[index] : "Unknown";
 }
 
 std::string EnhancedDepositionPhysics::materialToString(MaterialType material) const {
-    auto props = getMaterialProperties(material);
-    return props.name;
+    return getMaterialProperties(material).name;
 }
 
 bool EnhancedDepositionPhysics::validateConditions(
@@ -640,7 +1094,7 @@ double EnhancedDepositionPhysics::calculateIntrinsicStress(
     MaterialType material,
     const DepositionConditions& conditions) const {
 
-    auto material_props = getMaterialProperties(material);
+    const MaterialProperties& material_props = getMaterialProperties(material);
     double base_stress = material_props.stress_intrinsic;
 
     // Temperature dependence
@@ -4,6 +4,11 @@
 #include "../core/enhanced_error_handling.hpp"
 #include "../core/config_manager.hpp"
 #include "../core/wafer_enhanced.hpp"
+#include "../core/level_set.hpp"
+#include "../core/flux_tracer.hpp"
+#include "../core/batch_groups.hpp"
+#include "../core/kernel_status.hpp"
+#include <array>
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -118,11 +123,73 @@ struct DepositionResults {
                          grain_size(0), surface_roughness(0) {}
 };
 
+// Conditions for depositing on many wafers at once, one column entry per
+// wafer
+struct DepositionBatch {
+    Eigen::ArrayXd temperature;       // °C
+    Eigen::ArrayXd pressure;          // Torr
+    Eigen::ArrayXd target_thickness;  // μm
+    Eigen::ArrayXd power;             // W
+    std::vector<DepositionTechnique> technique;
+    std::vector<MaterialType> material;
+    
+    explicit DepositionBatch(size_t n = 0)
+        : temperature(Eigen::ArrayXd::Constant(n, 400.0)), pressure(Eigen::ArrayXd::Ones(n)),
+          target_thickness(Eigen::ArrayXd::Constant(n, 0.1)), power(Eigen::ArrayXd::Zero(n)),
+          technique(n, DepositionTechnique::CVD), material(n, MaterialType::SILICON_DIOXIDE) {}
+    size_t size() const { return technique.size(); }
+};
+
+struct DepositionBatchResults {
+    Eigen::ArrayXd deposition_rate;  // μm/min, 0 where invalid
+    std::vector<KernelStatus> status; // Ok where the conditions passed validateConditions
+
+    bool ok(size_t i) const { return status[i] == KernelStatus::Ok; }
+};
+
+// One ALD cycle as first-order surface kinetics: the precursor pulse
+// fills free sites at the adsorption rate, the purge lets some desorb, and
+// the co-reactant pulse turns what is left into film at the reaction rate.
+// Rates are per second on open ground; an element's exposure scales both
+// pulses' rates.
+struct ALDCycle {
+    double precursor_pulse = 0.05;  // s
+    double purge = 5.0;             // s
+    double reactant_pulse = 0.05;   // s
+    double adsorption_rate = 1e3;   // 1/s
+    double desorption_rate = 0.0;   // 1/s
+    double reaction_rate = 1e3;     // 1/s
+    double growth_per_cycle = 1e-4; // μm from a saturated surface
+};
+
+// Continuous CVD surface kinetics: precursor adsorbs onto free sites,
+// desorbs, and reacts into film, each first order in the sites involved
+struct CVDKinetics {
+    double adsorption_rate = 1e3;      // 1/s on open ground
+    double desorption_rate = 0.0;      // 1/s
+    double reaction_rate = 1.0;        // 1/s
+    double growth_per_monolayer = 1e-4; // μm per full layer of sites reacted
+};
+
+// Precursor coverage and film grown on each surface element
+struct SurfaceState {
+    std::vector<double> coverage;  // Fraction of sites holding precursor
+    std::vector<double> thickness; // μm
+};
+
 // Enhanced deposition physics engine
 class EnhancedDepositionPhysics {
+public:
+    static constexpr std::size_t kMaterials = static_cast<std::size_t>(MaterialType::PHOTORESIST) + 1;
+    
 private:
-    std::unordered_map<MaterialType, MaterialProperties> material_database_;
-    std::unordered_map<DepositionTechnique, std::string> technique_names_;
+    // Properties indexed by MaterialType; known marks the materials with data
+    struct MaterialTable {
+        std::array<MaterialProperties, kMaterials> properties;
+        std::array<bool, kMaterials> known{};
+    };
+    // Shared between engines until one sets its own properties
+    std::shared_ptr<const MaterialTable> materials_;
     
     // Configuration
     bool enable_surface_kinetics_ = true;
@@ -130,6 +197,7 @@ private:
     bool enable_grain_growth_ = true;
     bool enable_conformality_analysis_ = true;
     double numerical_precision_ = 1e-8;
+    double cell_size_ = 0.01; // um per wafer grid cell, the profile's voxel size
     
 public:
     EnhancedDepositionPhysics();
@@ -156,6 +224,12 @@ public:
         const DepositionConditions& conditions
     );
     
+    // The deposition rate simulateDeposition finds for each batch entry.
+    // Entries are grouped by technique and each group runs a kernel
+    // specialized for it, so the loops over a group hold no branches on
+    // the technique and take per-material constants from flat tables.
+    DepositionBatchResults calculateBatch(const DepositionBatch& batch) const;
+    
     // Surface kinetics modeling
     double calculateDepositionRate(
         const DepositionConditions& conditions,
@@ -167,6 +241,31 @@ public:
         double time
     ) const;
     
+    // Level-set surface velocity in um/min: the film grows at the
+    // deposition rate, the part of it a flat step's coverage misses
+    // arriving straight down
+    LevelSet::Velocity depositionVelocity(
+        const DepositionConditions& conditions
+    ) const;
+    
+    // The depositing species for the flux tracer: evaporated and sputtered
+    // atoms arrive more directionally than CVD precursors, and stick with
+    // calculateStickingCoefficient() of their hits
+    FluxTracer::Source depositionSource(
+        const DepositionConditions& conditions
+    ) const;
+    
+    // Grows a film on a feature's surface for time minutes by the traced
+    // flux of depositionSource(), so overhangs and shaded floors come out
+    // thin: each element grows at the deposition rate times its flux
+    // relative to open ground. Returns the number of traces.
+    int simulateFeatureProfile(
+        LevelSet& surface,
+        const DepositionConditions& conditions,
+        double time,
+        FluxTracer& tracer
+    ) const;
+    
     double calculateStickingCoefficient(
         MaterialType material,
         double temperature,
@@ -229,6 +328,51 @@ public:
         double pressure
     ) const;
     
+    // Time-resolved surface kinetics
+    ALDCycle aldCycle(
+        const DepositionConditions& conditions
+    ) const;
+    
+    // Kinetics under conditions whose steady growth on open ground is
+    // deposition_rate μm/min
+    CVDKinetics cvdKinetics(
+        const DepositionConditions& conditions,
+        double deposition_rate
+    ) const;
+    
+    // Runs identical ALD cycles on elements under their exposures relative
+    // to open ground, sizing an empty state to match. One cycle maps each
+    // element's coverage and thickness affinely, so the run applies that
+    // map raised to the number of cycles by squaring, and 500 cycles cost
+    // about what 5 do. Throws std::invalid_argument for a negative count
+    // or a state of another size.
+    void runALDCycles(
+        const ALDCycle& cycle,
+        const std::vector<double>& exposure,
+        int cycles,
+        SurfaceState& state
+    ) const;
+    
+    // Advances continuous growth by time seconds, in closed form
+    void runCVD(
+        const CVDKinetics& kinetics,
+        const std::vector<double>& exposure,
+        double time,
+        SurfaceState& state
+    ) const;
+    
+    // ALD on a feature's surface: the precursor exposure of every element
+    // is traced with depositionSource(), the cycles run in batches that
+    // grow the film at most half a cell, and the surface is moved and
+    // re-traced between batches. Coverage starts empty in each batch.
+    // Returns the number of traces.
+    int simulateFeatureALD(
+        LevelSet& surface,
+        const DepositionConditions& conditions,
+        int cycles,
+        FluxTracer& tracer
+    ) const;
+    
     // ALD-specific modeling
     double calculateALDGrowthPerCycle(
         MaterialType material,
@@ -276,6 +420,8 @@ public:
     
     // Configuration and calibration
     void setMaterialProperties(MaterialType material, const MaterialProperties& properties);
+    // Side of one wafer grid cell in um; throws std::invalid_argument unless positive
+    void setCellSize(double cell_size);
     void enablePhysicsEffects(bool surface_kinetics = true, bool stress = true,
                              bool grain_growth = true, bool conformality = true);
     
@@ -284,11 +430,20 @@ public:
     std::string materialToString(MaterialType material) const;
     std::string reactionToString(SurfaceReaction reaction) const;
     
-    MaterialProperties getMaterialProperties(MaterialType material) const;
+    // Throws PhysicsException for a material without data
+    const MaterialProperties& getMaterialProperties(MaterialType material) const;
     
 private:
-    void initializeMaterialDatabase();
-    void initializeTechniqueNames();
+    static std::shared_ptr<const MaterialTable> defaultMaterials();
+    
+    // calculateBatch on the size entries of one technique from begin
+    template <DepositionTechnique Technique>
+    void calculateBatchGroup(
+        const DepositionBatch& batch,
+        Eigen::Index begin,
+        Eigen::Index size,
+        DepositionBatchResults& results
+    ) const;
     
     // Numerical methods
     double solveKineticsEquation(
@@ -1,14 +1,171 @@
 #include "enhanced_doping.hpp"
+#include "../modules/doping/coupled_diffusion_solver.hpp"
+#include "../modules/doping/implant_moments.hpp"
+#include "../core/depth_mesh.hpp"
+#include "../core/vector_math.hpp"
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <random>
+#include <stdexcept>
 
 namespace SemiPRO {
 
-EnhancedDopingPhysics::EnhancedDopingPhysics() {
-    initializeIonDatabase();
-    initializeChannelingFactors();
+namespace {
+
+constexpr double kCelsiusToKelvin = 273.15;
+
+// Fair's charged-defect model for the species the solver knows; others
+// diffuse with the database's D0 and Ea alone
+CoupledDiffusionSolver::Dopant diffusionModel(IonSpecies species, const IonProperties& properties) {
+    switch (species) {
+    case IonSpecies::BORON_11:
+        return CoupledDiffusionSolver::Dopant::boron();
+    case IonSpecies::PHOSPHORUS_31:
+        return CoupledDiffusionSolver::Dopant::phosphorus();
+    case IonSpecies::ARSENIC_75:
+        return CoupledDiffusionSolver::Dopant::arsenic();
+    case IonSpecies::ANTIMONY_121:
+        return CoupledDiffusionSolver::Dopant::antimony();
+    default: {
+        CoupledDiffusionSolver::Dopant dopant;
+        dopant.charge = properties.is_p_type ? -1.0 : 1.0;
+        dopant.prefactor[0] = properties.diffusivity_d0;
+        dopant.activation[0] = properties.diffusion_ea;
+        return dopant;
+    }
+    }
+}
+
+// Grid spacing of evenly spaced depths, in cm
+double depthStep(const std::vector<double>& depths) {
+    if (depths.size() < 2 || depths.back() <= depths.front()) {
+        throw PhysicsException("Diffusion needs at least two increasing depths");
+    }
+    return (depths.back() - depths.front()) / (depths.size() - 1) * 1e-4;
+}
+
+// Runs the anneal's temperature segments back to back (or the single
+// temperature), carrying dopants and interstitials from one to the next
+CoupledDiffusionSolver::Result annealSegments(const CoupledDiffusionSolver& solver,
+                                              const CoupledDiffusionSolver::Dopant& dopant,
+                                              const Eigen::ArrayXd& profile, const Eigen::ArrayXd& interstitials,
+                                              const AnnealingConditions& conditions, double dx) {
+    std::vector<double> temperatures = conditions.temperature_profile;
+    if (temperatures.empty()) {
+        temperatures.push_back(conditions.temperature);
+    }
+    const double segment = conditions.time * 60.0 / temperatures.size();
+
+    // Free and clustered interstitials are carried together
+    CoupledDiffusionSolver::Result total;
+    total.dopants = {profile};
+    total.interstitials = interstitials;
+    for (double temperature : temperatures) {
+        auto result = solver.anneal({dopant}, total.dopants, total.interstitials, temperature + kCelsiusToKelvin,
+                                    segment, dx);
+        total.dopants = std::move(result.dopants);
+        total.interstitials = result.interstitials.size() != 0 ? Eigen::ArrayXd(result.interstitials + result.clusters)
+                                                               : Eigen::ArrayXd();
+        total.time += result.time;
+        total.steps += result.steps;
+        total.rejected_steps += result.rejected_steps;
+        total.newton_iterations += result.newton_iterations;
+        total.factorizations += result.factorizations;
+    }
+    return total;
+}
+
+// Caughey-Thomas mobility parameters (cm²/V·s, cm⁻³) of the carrier
+// type, with the temperature factor folded in
+struct MobilityModel {
+    double mu_min, mu_span, n_ref, alpha, temp_factor;
+
+    MobilityModel(bool is_p_type, double temperature) {
+        if (is_p_type) {
+            // Hole mobility parameters
+            mu_min = 44.9;
+            mu_span = 470.5 - mu_min;
+            n_ref = 2.23e17;
+            alpha = 0.719;
+        } else {
+            // Electron mobility parameters
+            mu_min = 68.5;
+            mu_span = 1414.0 - mu_min;
+            n_ref = 9.20e16;
+            alpha = 0.711;
+        }
+        temp_factor = std::pow(temperature / 300.0, -2.3);
+    }
+};
+
+constexpr double kElementaryCharge = 1.602e-19; // C
+// Depths evaluated at a time by streamed profile kernels
+constexpr size_t kProfileBlock = 256;
+
+double secondMoment(const std::vector<double>& profile, const std::vector<double>& depths) {
+    double dose = 0.0, first = 0.0, second = 0.0;
+    for (size_t i = 0; i < profile.size(); ++i) {
+        dose += profile[i];
+        first += profile[i] * depths[i];
+        second += profile[i] * depths[i] * depths[i];
+    }
+    if (dose <= 0.0) {
+        return 0.0;
+    }
+    first /= dose;
+    return second / dose - first * first;
+}
 
+} // namespace
+
+ProfileMetricsAccumulator::ProfileMetricsAccumulator(bool is_p_type, double temperature, double background_doping)
+    : background_(background_doping) {
+    MobilityModel model(is_p_type, temperature);
+    mu_min_ = model.mu_min;
+    mu_span_ = model.mu_span;
+    inverse_n_ref_ = 1.0 / model.n_ref;
+    alpha_ = model.alpha;
+    temp_factor_ = model.temp_factor;
+}
+
+void ProfileMetricsAccumulator::add(const double* depths, const double* concentrations, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const double depth = depths[i];
+        const double concentration = concentrations[i];
+        if (metrics_.points > 0) {
+            // The previous point's conductivity over the step to this one
+            const double step = depth - previous_depth_;
+            const double mobility =
+                (mu_min_ + mu_span_ / (1.0 + std::pow(previous_concentration_ * inverse_n_ref_, alpha_))) * temp_factor_;
+            sheet_conductance_ += kElementaryCharge * previous_concentration_ * mobility * step * 1e-4;
+            metrics_.dose += 0.5 * (previous_concentration_ + concentration) * step * 1e-4;
+        }
+        if (metrics_.points == 0 || concentration > metrics_.peak_concentration) {
+            metrics_.peak_concentration = concentration;
+            metrics_.peak_depth = depth;
+        }
+        if (!junction_found_ && concentration <= background_) {
+            metrics_.junction_depth = depth;
+            junction_found_ = true;
+        }
+        previous_depth_ = depth;
+        previous_concentration_ = concentration;
+        ++metrics_.points;
+    }
+}
+
+ProfileMetrics ProfileMetricsAccumulator::result() const {
+    ProfileMetrics metrics = metrics_;
+    // Without a crossing, the junction is at the last depth
+    if (!junction_found_) {
+        metrics.junction_depth = metrics.points > 0 ? previous_depth_ : 0.0;
+    }
+    metrics.sheet_resistance = sheet_conductance_ > 0 ? 1.0 / sheet_conductance_ : 1e6;
+    return metrics;
+}
+
+EnhancedDopingPhysics::EnhancedDopingPhysics() {
     // Only log once per process (static flag)
     static bool logged = false;
     if (!logged) {
@@ -48,18 +205,32 @@ ImplantationResults EnhancedDopingPhysics::simulateIonImplantation(
             results.sputtering_yield = calculateSputteringYield(conditions);
         }
         
-        // Generate depth grid for calculations
+        // Depth mesh adapted to the profile: sampled on 1000 even points,
+        // then re-evaluated on nodes placed for that sample
         int num_points = 1000;
         double max_depth = results.projected_range + 5.0 * results.range_straggling;
-        std::vector<double> depths(num_points);
-        for (int i = 0; i < num_points; ++i) {
-            depths[i] = (static_cast<double>(i) / (num_points - 1)) * max_depth;
-        }
+        DepthMesh::Refinement refinement;
+        refinement.surface_spacing = 0.01 * results.range_straggling;
+        refinement.junction_spacing = 0.01 * results.range_straggling;
+        refinement.background = 1e15; // calculateJunctionDepth's default
+        const DepthMesh dense(Eigen::ArrayXd::LinSpaced(num_points, 0.0, max_depth));
+        const Eigen::ArrayXd& dense_depths = dense.nodes();
+        std::vector<double> dense_profile = calculateConcentrationProfile(
+            conditions, std::vector<double>(dense_depths.data(), dense_depths.data() + num_points),
+            enable_channeling_effects_
+        );
+        const DepthMesh mesh = DepthMesh::adapted(
+            dense, Eigen::Map<const Eigen::ArrayXd>(dense_profile.data(), num_points), refinement
+        );
+        std::vector<double> depths(mesh.nodes().data(), mesh.nodes().data() + mesh.size());
         
         // Calculate concentration profile
+        results.species = conditions.species;
+        results.depths = depths;
         results.concentration_profile = calculateConcentrationProfile(
             conditions, depths, enable_channeling_effects_
         );
+        const Eigen::Map<const Eigen::ArrayXd> concentration(results.concentration_profile.data(), mesh.size());
         
         // Calculate damage profile
         if (enable_damage_modeling_) {
@@ -71,18 +242,17 @@ ImplantationResults EnhancedDopingPhysics::simulateIonImplantation(
         
         // Calculate electrical properties
         results.peak_concentration = calculatePeakConcentration(conditions);
-        results.sheet_resistance = calculateSheetResistance(
+        ProfileMetrics metrics = calculateProfileMetrics(
             results.concentration_profile, depths, conditions.species
         );
-        results.junction_depth = calculateJunctionDepth(
-            results.concentration_profile, depths
-        );
+        results.sheet_resistance = metrics.sheet_resistance;
+        results.junction_depth = metrics.junction_depth;
         
         // Analyze quality
         results.quality_metrics = analyzeImplantationQuality(results, conditions);
         
         // Apply results to wafer
-        auto grid = wafer->getGrid();
+        FieldView grid = wafer->getGrid();
         int rows = grid.rows();
         int cols = grid.cols();
         
@@ -94,20 +264,12 @@ ImplantationResults EnhancedDopingPhysics::simulateIonImplantation(
                 double depth = (static_cast<double>(i) / rows) * wafer_thickness;
                 
                 // Interpolate concentration at this depth
-                double concentration = 0.0;
-                if (depth <= max_depth) {
-                    int index = static_cast<int>((depth / max_depth) * (num_points - 1));
-                    if (index < results.concentration_profile.size()) {
-                        concentration = results.concentration_profile[index];
-                    }
-                }
+                double value = depth <= max_depth ? mesh.sample(concentration, depth) : 0.0;
                 
-                grid(i, j) += concentration * 1e-15; // Scale for grid representation
+                grid(i, j) += value * 1e-15; // Scale for grid representation
             }
         }
         
-        wafer->setGrid(grid);
-        
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::PHYSICS,
                           "Enhanced ion implantation completed: " + 
                           ionSpeciesToString(conditions.species) + 
@@ -127,58 +289,30 @@ ImplantationResults EnhancedDopingPhysics::simulateIonImplantation(
 
 double EnhancedDopingPhysics::calculateProjectedRange(
     const ImplantationConditions& conditions) const {
-    
-    auto ion_props = getIonProperties(conditions.species);
-    
-    // Target: Silicon properties
-    double target_z = 14.0;
-    double target_mass = 28.09;
-    double target_density = 2.33; // g/cm³
-    
-    // Calculate reduced energy
-    double epsilon = calculateReducedEnergy(conditions);
-    
-    // LSS range calculation (Biersack-Haggmark formula)
-    double reduced_range;
-    if (epsilon < 10.0) {
-        reduced_range = epsilon / (1.0 + 6.35 * std::sqrt(epsilon) + 
-                                  epsilon * (6.882 * std::sqrt(epsilon) - 1.708));
-    } else {
-        reduced_range = std::log(epsilon) / (2.0 * std::log(epsilon / 10.0));
-    }
-    
-    // Convert to physical range in μm
-    double range = 8.74e-3 * reduced_range * (ion_props.atomic_mass + target_mass) /
-                  (target_density * target_z * ion_props.atomic_mass *
-                   std::pow(ion_props.atomic_number + target_z, 1.0/3.0)); // μm
-    
-    return range;
+    return momentTable(conditions.species).at(conditions.energy).projected_range *
+           getMomentCorrection(conditions.species).range; // μm
 }
 
 double EnhancedDopingPhysics::calculateRangeStraggling(
     const ImplantationConditions& conditions,
     double projected_range) const {
-    
-    // Bohr straggling model with improvements
-    double base_straggling = 0.42 * projected_range;
-    
-    // Energy dependence
-    double energy_factor = 1.0 + 0.1 * std::log(conditions.energy / 50.0);
-    
-    // Mass dependence
-    auto ion_props = getIonProperties(conditions.species);
-    double mass_factor = std::sqrt(ion_props.atomic_mass / 11.0); // Normalized to boron
-    
-    return base_straggling * energy_factor * mass_factor;
+    // The tabulated straggling-to-range ratio, as corrected, at the given range
+    auto moments = momentTable(conditions.species).at(conditions.energy);
+    const MomentCorrection correction = getMomentCorrection(conditions.species);
+    return projected_range * moments.range_straggling * correction.straggling /
+           (moments.projected_range * correction.range);
 }
 
 double EnhancedDopingPhysics::calculateLateralStraggling(
     const ImplantationConditions& conditions,
     double projected_range) const {
-    
-    // Lateral straggling is typically 0.6-0.8 times the longitudinal straggling
-    double longitudinal_straggling = calculateRangeStraggling(conditions, projected_range);
-    return 0.7 * longitudinal_straggling;
+    auto moments = momentTable(conditions.species).at(conditions.energy);
+    return projected_range * moments.lateral_straggling / moments.projected_range;
+}
+
+const ImplantMoments& EnhancedDopingPhysics::momentTable(IonSpecies species) const {
+    auto ion_props = getIonProperties(species);
+    return ImplantMoments::table({static_cast<double>(ion_props.atomic_number), ion_props.atomic_mass});
 }
 
 double EnhancedDopingPhysics::calculateChannelingFraction(
@@ -189,8 +323,9 @@ double EnhancedDopingPhysics::calculateChannelingFraction(
     }
     
     // Get channeling factor for direction
-    auto it = channeling_factors_.find(conditions.channeling);
-    double base_fraction = (it != channeling_factors_.end()) ? it->second : 0.1;
+    const auto& factors = channelingFactors();
+    auto it = factors.find(conditions.channeling);
+    double base_fraction = (it != factors.end()) ? it->second : 0.1;
     
     // Tilt angle reduces channeling
     double tilt_factor = std::exp(-std::pow(conditions.tilt_angle / 2.0, 2));
@@ -207,6 +342,16 @@ std::vector<double> EnhancedDopingPhysics::calculateConcentrationProfile(
     bool include_channeling) const {
     
     std::vector<double> profile(depths.size(), 0.0);
+    evaluateConcentrationProfile(conditions, depths.data(), profile.data(), depths.size(), include_channeling);
+    return profile;
+}
+
+void EnhancedDopingPhysics::evaluateConcentrationProfile(
+    const ImplantationConditions& conditions,
+    const double* depths,
+    double* profile,
+    size_t n,
+    bool include_channeling) const {
     
     double rp = calculateProjectedRange(conditions);
     double delta_rp = calculateRangeStraggling(conditions, rp);
@@ -215,32 +360,28 @@ std::vector<double> EnhancedDopingPhysics::calculateConcentrationProfile(
     double delta_rp_cm = delta_rp * 1e-4; // Convert μm to cm
     double normalization = conditions.dose / (delta_rp_cm * std::sqrt(2.0 * M_PI));
     
-    for (size_t i = 0; i < depths.size(); ++i) {
-        double depth = depths[i];
-        
-        // Random component (Gaussian) - depth in μm, convert for calculation
-        double depth_cm = depth * 1e-4; // Convert μm to cm
-        double rp_cm = rp * 1e-4; // Convert μm to cm
-        double random_component = normalization *
-            std::exp(-std::pow(depth_cm - rp_cm, 2) / (2.0 * delta_rp_cm * delta_rp_cm));
-        
-        profile[i] = random_component;
-        
-        // Add channeling component if enabled
-        if (include_channeling && enable_channeling_effects_) {
-            double channeling_fraction = calculateChannelingFraction(conditions);
-            if (channeling_fraction > 0) {
-                // Channeled ions penetrate deeper with exponential tail
-                double channel_range = rp * (1.0 + 2.0 * channeling_fraction);
-                double channel_component = (conditions.dose * channeling_fraction) / channel_range *
-                    std::exp(-depth / channel_range);
-                
-                profile[i] += channel_component;
+    // Random component (Gaussian); depths and range both in μm
+    VectorMath::gaussian(depths, profile, n, rp, delta_rp, normalization);
+    
+    // Add channeling component if enabled
+    double channeling_fraction = include_channeling && enable_channeling_effects_
+                                     ? calculateChannelingFraction(conditions) : 0.0;
+    if (channeling_fraction > 0) {
+        // Channeled ions penetrate deeper with exponential tail
+        double channel_range = rp * (1.0 + 2.0 * channeling_fraction);
+        double amplitude = (conditions.dose * channeling_fraction) / channel_range;
+        double tail[kProfileBlock];
+        for (size_t first = 0; first < n; first += kProfileBlock) {
+            const size_t count = std::min(kProfileBlock, n - first);
+            for (size_t i = 0; i < count; ++i) {
+                tail[i] = -depths[first + i] / channel_range;
+            }
+            VectorMath::exp(tail, tail, count);
+            for (size_t i = 0; i < count; ++i) {
+                profile[first + i] += amplitude * tail[i];
             }
         }
     }
-    
-    return profile;
 }
 
 double EnhancedDopingPhysics::calculatePeakConcentration(
@@ -258,34 +399,47 @@ double EnhancedDopingPhysics::calculatePeakConcentration(
     return std::min(peak_conc, 1e21);
 }
 
-double EnhancedDopingPhysics::calculateSheetResistance(
-    const std::vector<double>& concentration_profile,
-    const std::vector<double>& depths,
+template <typename Scalar>
+GaussianImplant<Scalar> EnhancedDopingPhysics::calculateGaussianImplant(
     IonSpecies species,
-    double temperature) const {
+    const Scalar& energy,
+    const Scalar& dose,
+    double background_doping) const {
     
-    if (concentration_profile.empty() || depths.empty()) {
-        return 1e6; // Very high resistance for empty profile
-    }
+    using std::log;
+    using std::sqrt;
     
-    auto ion_props = getIonProperties(species);
+    const auto moments = momentTable(species).momentsAt(energy);
+    const MomentCorrection correction = getMomentCorrection(species);
+    GaussianImplant<Scalar> implant;
+    implant.projected_range = moments[0] * correction.range;
+    implant.range_straggling = moments[1] * correction.straggling;
+    implant.peak_concentration = dose / (implant.range_straggling * 1e-4 * std::sqrt(2.0 * M_PI));
     
-    // Calculate sheet conductance by integrating
-    double sheet_conductance = 0.0;
-    double q = 1.602e-19; // Elementary charge (C)
-    
-    for (size_t i = 0; i < concentration_profile.size() - 1; ++i) {
-        double conc = concentration_profile[i] * 1e6; // Convert cm⁻³ to m⁻³
-        double mobility = DopingUtils::calculateMobility(species, conc / 1e6, temperature);
-        mobility *= 1e-4; // Convert cm²/V·s to m²/V·s
-        
-        double conductivity = q * conc * mobility;
-        double layer_thickness = (depths[i+1] - depths[i]) * 1e-6; // Convert μm to m
-        
-        sheet_conductance += conductivity * layer_thickness;
+    // The Gaussian falls to the background at Rp + ΔRp sqrt(2 ln(peak / background))
+    if (scalarValue(implant.peak_concentration) > background_doping) {
+        implant.junction_depth = implant.projected_range +
+            implant.range_straggling * sqrt(2.0 * log(implant.peak_concentration / background_doping));
+    } else {
+        implant.junction_depth = implant.projected_range * 0.0;
     }
+    return implant;
+}
+
+template GaussianImplant<double> EnhancedDopingPhysics::calculateGaussianImplant<double>(
+    IonSpecies, const double&, const double&, double) const;
+template GaussianImplant<ADScalar> EnhancedDopingPhysics::calculateGaussianImplant<ADScalar>(
+    IonSpecies, const ADScalar&, const ADScalar&, double) const;
+
+double EnhancedDopingPhysics::calculateSheetResistance(
+    const std::vector<double>& concentration_profile,
+    const std::vector<double>& depths,
+    IonSpecies species,
+    double temperature) const {
     
-    return (sheet_conductance > 0) ? 1.0 / sheet_conductance : 1e6;
+    ProfileMetricsAccumulator sheet(getIonProperties(species).is_p_type, temperature);
+    sheet.add(depths.data(), concentration_profile.data(), std::min(concentration_profile.size(), depths.size()));
+    return sheet.result().sheet_resistance; // Very high resistance for an empty profile
 }
 
 double EnhancedDopingPhysics::calculateJunctionDepth(
@@ -304,52 +458,349 @@ double EnhancedDopingPhysics::calculateJunctionDepth(
     return depths.empty() ? 0.0 : depths.back();
 }
 
-void EnhancedDopingPhysics::initializeIonDatabase() {
-    // Boron-11
-    IonProperties boron;
-    boron.symbol = "B";
-    boron.atomic_mass = 10.81;
-    boron.atomic_number = 5;
-    boron.binding_energy = 8.3;
-    boron.is_p_type = true;
-    boron.diffusivity_d0 = 0.76;      // cm²/s
-    boron.diffusion_ea = 3.46;        // eV
-    boron.solubility_limit = 5e20;    // cm⁻³
-    ion_database_[IonSpecies::BORON_11] = boron;
+ProfileMetrics EnhancedDopingPhysics::calculateProfileMetrics(
+    const std::vector<double>& concentration_profile,
+    const std::vector<double>& depths,
+    IonSpecies species,
+    double background_doping,
+    double temperature) const {
     
-    // Phosphorus-31
-    IonProperties phosphorus;
-    phosphorus.symbol = "P";
-    phosphorus.atomic_mass = 30.97;
-    phosphorus.atomic_number = 15;
-    phosphorus.binding_energy = 10.5;
-    phosphorus.is_p_type = false;
-    phosphorus.diffusivity_d0 = 3.85;     // cm²/s
-    phosphorus.diffusion_ea = 3.66;       // eV
-    phosphorus.solubility_limit = 1e21;   // cm⁻³
-    ion_database_[IonSpecies::PHOSPHORUS_31] = phosphorus;
+    ProfileMetricsAccumulator metrics(getIonProperties(species).is_p_type, temperature, background_doping);
+    metrics.add(depths.data(), concentration_profile.data(), std::min(concentration_profile.size(), depths.size()));
+    return metrics.result();
+}
+
+ProfileMetrics EnhancedDopingPhysics::calculateImplantationMetrics(
+    const ImplantationConditions& conditions,
+    double background_doping) const {
     
-    // Arsenic-75
-    IonProperties arsenic;
-    arsenic.symbol = "As";
-    arsenic.atomic_mass = 74.92;
-    arsenic.atomic_number = 33;
-    arsenic.binding_energy = 9.8;
-    arsenic.is_p_type = false;
-    arsenic.diffusivity_d0 = 0.066;       // cm²/s
-    arsenic.diffusion_ea = 4.05;          // eV
-    arsenic.solubility_limit = 2e21;      // cm⁻³
-    ion_database_[IonSpecies::ARSENIC_75] = arsenic;
-}
-
-void EnhancedDopingPhysics::initializeChannelingFactors() {
-    channeling_factors_[ChannelingDirection::RANDOM] = 0.0;
-    channeling_factors_[ChannelingDirection::CHANNEL_100] = 0.3;
-    channeling_factors_[ChannelingDirection::CHANNEL_110] = 0.2;
-    channeling_factors_[ChannelingDirection::CHANNEL_111] = 0.4;
-    channeling_factors_[ChannelingDirection::PLANAR_100] = 0.15;
-    channeling_factors_[ChannelingDirection::PLANAR_110] = 0.1;
-    channeling_factors_[ChannelingDirection::PLANAR_111] = 0.2;
+    std::string error_msg;
+    if (!validateImplantationConditions(conditions, error_msg)) {
+        throw PhysicsException("Invalid implantation conditions: " + error_msg);
+    }
+    const int num_points = 1000;
+    const double rp = calculateProjectedRange(conditions);
+    const double max_depth = rp + 5.0 * calculateRangeStraggling(conditions, rp);
+    
+    ProfileMetricsAccumulator metrics(getIonProperties(conditions.species).is_p_type, 300.0, background_doping);
+    double depths[kProfileBlock], profile[kProfileBlock];
+    for (int first = 0; first < num_points; first += static_cast<int>(kProfileBlock)) {
+        const int count = std::min(static_cast<int>(kProfileBlock), num_points - first);
+        for (int i = 0; i < count; ++i) {
+            depths[i] = (static_cast<double>(first + i) / (num_points - 1)) * max_depth;
+        }
+        evaluateConcentrationProfile(conditions, depths, profile, count, enable_channeling_effects_);
+        metrics.add(depths, profile, count);
+    }
+    return metrics.result();
+}
+
+AnnealingResults EnhancedDopingPhysics::simulateAnnealing(
+    std::shared_ptr<WaferEnhanced> wafer,
+    const AnnealingConditions& conditions,
+    const ImplantationResults& implant_results) {
+
+    SEMIPRO_PERF_TIMER("annealing_simulation", "EnhancedDoping");
+
+    AnnealingResults results;
+
+    try {
+        std::string error_msg;
+        if (!validateAnnealingConditions(conditions, error_msg)) {
+            throw PhysicsException("Invalid annealing conditions: " + error_msg);
+        }
+        const auto& implant = implant_results.concentration_profile;
+        if (implant.empty() || implant.size() != implant_results.depths.size()) {
+            throw PhysicsException("Implantation results carry no depth profile");
+        }
+        if (implant.size() < 2 || implant_results.depths.back() <= implant_results.depths.front()) {
+            throw PhysicsException("Implantation results need at least two increasing depths");
+        }
+
+        auto ion_props = getIonProperties(implant_results.species);
+        auto dopant = diffusionModel(implant_results.species, ion_props);
+        // Solve on cells no finer than 1 nm (at most 250 across the implant),
+        // reaching six intrinsic diffusion lengths at the hottest temperature
+        // past the implant so the profile does not pile up at the far end
+        double extent = (implant_results.depths.back() - implant_results.depths.front()) * 1e-4; // cm
+        double dx = std::max(extent / 250.0, 1e-7);
+        double hottest = conditions.temperature;
+        for (double temperature : conditions.temperature_profile) {
+            hottest = std::max(hottest, temperature);
+        }
+        double peak = *std::max_element(implant.begin(), implant.end());
+        double diffusivity = calculateDiffusivity(implant_results.species, hottest, peak);
+        double length = std::sqrt(diffusivity * conditions.time * 60.0);
+        const size_t max_points = 1000;
+        size_t points = std::min(max_points, static_cast<size_t>(std::ceil((extent + 6.0 * length) / dx)) + 1);
+
+        // Implant remapped onto the cells, conserving its dose
+        results.depths.resize(points);
+        for (size_t i = 0; i < points; ++i) {
+            results.depths[i] = implant_results.depths.front() + i * dx * 1e4;
+        }
+        const DepthMesh implant_mesh(Eigen::Map<const Eigen::ArrayXd>(implant_results.depths.data(), implant.size()));
+        const Eigen::Map<const Eigen::ArrayXd> implant_values(implant.data(), implant.size());
+        const DepthMesh cells(Eigen::Map<const Eigen::ArrayXd>(results.depths.data(), points),
+                              results.depths.front() - 0.5 * dx * 1e4, results.depths.back() + 0.5 * dx * 1e4);
+        Eigen::ArrayXd profile = implant_mesh.remap(implant_values, cells);
+
+        // "+1" model: each implanted ion leaves one excess interstitial
+        CoupledDiffusionSolver solver;
+        Eigen::ArrayXd interstitials;
+        if (enable_damage_modeling_) {
+            interstitials = profile + solver.getInterstitials().equilibrium(conditions.temperature + kCelsiusToKelvin);
+        }
+
+        auto annealed = annealSegments(solver, dopant, profile, interstitials, conditions, dx);
+        const Eigen::ArrayXd& final_profile = annealed.dopants.front();
+        results.final_concentration_profile.assign(final_profile.data(), final_profile.data() + points);
+
+        // Electrically active dopants, up to the solubility limit
+        results.electrical_profile.resize(points);
+        for (size_t i = 0; i < points; ++i) {
+            results.electrical_profile[i] = std::min(results.final_concentration_profile[i], ion_props.solubility_limit);
+        }
+        results.dopant_activation = calculateDopantActivation(
+            results.final_concentration_profile, implant_results.species, conditions.temperature
+        );
+        results.final_junction_depth = calculateJunctionDepth(results.final_concentration_profile, results.depths);
+        results.final_sheet_resistance = calculateSheetResistance(
+            results.electrical_profile, results.depths, implant_results.species
+        );
+
+        double spread = secondMoment(results.final_concentration_profile, results.depths) -
+                        secondMoment(std::vector<double>(profile.data(), profile.data() + points), results.depths);
+        results.diffusion_length = std::sqrt(std::max(0.0, 2.0 * spread)); // 2 sqrt(Dt), μm
+        if (annealed.interstitials.size() != 0) {
+            double equilibrium = solver.getInterstitials().equilibrium(
+                (conditions.temperature_profile.empty() ? conditions.temperature : conditions.temperature_profile.back()) +
+                kCelsiusToKelvin
+            );
+            results.defect_density = std::max(0.0, annealed.interstitials.maxCoeff() - equilibrium);
+        }
+
+        // Solid-phase epitaxial regrowth of the amorphous layers
+        double amorphous_thickness = 0.0;
+        for (size_t i = 0; i + 1 < implant_results.amorphous_regions.size(); i += 2) {
+            amorphous_thickness = std::max(amorphous_thickness,
+                implant_results.amorphous_regions[i + 1] - implant_results.amorphous_regions[i]);
+        }
+        double kt = 8.617e-5 * (conditions.temperature + kCelsiusToKelvin);
+        double regrowth = 4.64e8 * std::exp(-2.68 / kt) * conditions.time * 60.0 * 1e4; // μm
+        results.recrystallization_complete = regrowth >= amorphous_thickness;
+
+        double initial_dose = profile.sum();
+        results.annealing_metrics["dose_retained"] = initial_dose > 0.0 ? final_profile.sum() / initial_dose : 1.0;
+        results.annealing_metrics["time_steps"] = annealed.steps;
+        results.annealing_metrics["rejected_steps"] = annealed.rejected_steps;
+        results.annealing_metrics["newton_iterations"] = annealed.newton_iterations;
+        results.annealing_metrics["jacobian_factorizations"] = annealed.factorizations;
+
+        // Replace the implant's contribution to the wafer grid with the
+        // annealed profile, on the mapping simulateIonImplantation uses
+        FieldView grid = wafer->getGrid();
+        int rows = grid.rows();
+        int cols = grid.cols();
+        double wafer_thickness = 10.0; // μm (assumed)
+        double implant_depth = implant_mesh.upper();
+        double annealed_depth = results.depths.back();
+        for (int i = 0; i < rows; ++i) {
+            double depth = (static_cast<double>(i) / rows) * wafer_thickness;
+            double before = 0.0;
+            if (depth <= implant_depth) {
+                before = implant_mesh.sample(implant_values, depth);
+            }
+            double after = 0.0;
+            if (depth <= annealed_depth) {
+                size_t index = static_cast<size_t>((depth / annealed_depth) * (points - 1));
+                after = results.final_concentration_profile[index];
+            }
+            for (int j = 0; j < cols; ++j) {
+                grid(i, j) += (after - before) * 1e-15; // Scale for grid representation
+            }
+        }
+
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::PHYSICS,
+                          "Annealing completed: " + ionSpeciesToString(implant_results.species) +
+                          ", Junction: " + std::to_string(results.final_junction_depth) + " μm" +
+                          ", " + std::to_string(annealed.steps) + " steps",
+                          "EnhancedDoping");
+
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::PHYSICS,
+                          "Annealing failed: " + std::string(e.what()),
+                          "EnhancedDoping");
+        throw;
+    }
+
+    return results;
+}
+
+std::vector<double> EnhancedDopingPhysics::simulateDiffusion(
+    const std::vector<double>& initial_profile,
+    const std::vector<double>& depths,
+    const AnnealingConditions& conditions,
+    IonSpecies species) const {
+
+    if (initial_profile.size() != depths.size()) {
+        throw PhysicsException("Profile and depth grid differ in size");
+    }
+    CoupledDiffusionSolver solver;
+    Eigen::ArrayXd profile = Eigen::Map<const Eigen::ArrayXd>(initial_profile.data(), initial_profile.size());
+    auto annealed = annealSegments(solver, diffusionModel(species, getIonProperties(species)), profile,
+                                   Eigen::ArrayXd(), conditions, depthStep(depths));
+    const Eigen::ArrayXd& result = annealed.dopants.front();
+    return std::vector<double>(result.data(), result.data() + result.size());
+}
+
+double EnhancedDopingPhysics::calculateDiffusivity(
+    IonSpecies species,
+    double temperature,
+    double concentration) const {
+
+    double temperature_k = temperature + kCelsiusToKelvin;
+    // n/ni (p/ni for acceptors) of this dopant alone in intrinsic silicon
+    double ni = CoupledDiffusionSolver::intrinsicConcentration(temperature_k);
+    double eta = (concentration + std::sqrt(concentration * concentration + 4.0 * ni * ni)) / (2.0 * ni);
+    return diffusionModel(species, getIonProperties(species)).diffusivity(temperature_k, eta);
+}
+
+double EnhancedDopingPhysics::calculateDopantActivation(
+    const std::vector<double>& concentration_profile,
+    IonSpecies species,
+    double annealing_temperature) const {
+
+    // The database holds one solubility limit (at 1000 °C), used at any
+    // annealing temperature
+    (void)annealing_temperature;
+    double limit = getIonProperties(species).solubility_limit;
+    double total = 0.0, active = 0.0;
+    for (double concentration : concentration_profile) {
+        total += concentration;
+        active += std::min(concentration, limit);
+    }
+    return total > 0.0 ? active / total : 0.0;
+}
+
+double EnhancedDopingPhysics::calculateTransientEnhancedDiffusion(
+    double damage_density,
+    double temperature,
+    double time) const {
+
+    CoupledDiffusionSolver::Interstitials interstitials;
+    double temperature_k = temperature + kCelsiusToKelvin;
+    double seconds = time * 60.0;
+    double equilibrium = interstitials.equilibrium(temperature_k);
+    double held = equilibrium * interstitials.clusterSupersaturation(temperature_k);
+    double tau = interstitials.lifetime(temperature_k);
+    if (seconds <= 0.0) {
+        return 1.0 + std::min(damage_density, held) / equilibrium;
+    }
+
+    // Clusters hold the free excess at `held` until recombination has
+    // used them up, after which it decays with the lifetime
+    double clustered_time = damage_density > held ? tau * (damage_density - held) / held : 0.0;
+    double free_excess = std::min(damage_density, held);
+    double integral = free_excess * std::min(seconds, clustered_time);
+    if (seconds > clustered_time) {
+        integral += free_excess * tau * (1.0 - std::exp(-(seconds - clustered_time) / tau));
+    }
+    return 1.0 + integral / (seconds * equilibrium);
+}
+
+bool EnhancedDopingPhysics::validateAnnealingConditions(
+    const AnnealingConditions& conditions,
+    std::string& error_message) const {
+
+    auto in_range = [](double temperature) { return temperature >= 400.0 && temperature <= 1400.0; };
+    if (!in_range(conditions.temperature)) {
+        error_message = "Temperature out of range (400-1400°C)";
+        return false;
+    }
+    for (double temperature : conditions.temperature_profile) {
+        if (!in_range(temperature)) {
+            error_message = "Temperature profile out of range (400-1400°C)";
+            return false;
+        }
+    }
+    if (conditions.time <= 0) {
+        error_message = "Annealing time must be positive";
+        return false;
+    }
+    return true;
+}
+
+std::vector<double> EnhancedDopingPhysics::solveDiffusionEquation(
+    const std::vector<double>& initial_profile,
+    const std::vector<double>& depths,
+    double diffusivity,
+    double time) const {
+
+    CoupledDiffusionSolver solver;
+    Eigen::ArrayXd profile = Eigen::Map<const Eigen::ArrayXd>(initial_profile.data(), initial_profile.size());
+    // Constant diffusivity, so the temperature only has to be positive
+    auto result = solver.anneal({CoupledDiffusionSolver::Dopant::constant(diffusivity)}, {profile}, Eigen::ArrayXd(),
+                                kCelsiusToKelvin, time * 60.0, depthStep(depths));
+    const Eigen::ArrayXd& annealed = result.dopants.front();
+    return std::vector<double>(annealed.data(), annealed.data() + annealed.size());
+}
+
+const std::unordered_map<IonSpecies, IonProperties>& EnhancedDopingPhysics::ionDatabase() {
+    static const std::unordered_map<IonSpecies, IonProperties> database = [] {
+        std::unordered_map<IonSpecies, IonProperties> table;
+
+        // Boron-11
+        IonProperties boron;
+        boron.symbol = "B";
+        boron.atomic_mass = 10.81;
+        boron.atomic_number = 5;
+        boron.binding_energy = 8.3;
+        boron.is_p_type = true;
+        boron.diffusivity_d0 = 0.76;      // cm²/s
+        boron.diffusion_ea = 3.46;        // eV
+        boron.solubility_limit = 5e20;    // cm⁻³
+        table[IonSpecies::BORON_11] = boron;
+
+        // Phosphorus-31
+        IonProperties phosphorus;
+        phosphorus.symbol = "P";
+        phosphorus.atomic_mass = 30.97;
+        phosphorus.atomic_number = 15;
+        phosphorus.binding_energy = 10.5;
+        phosphorus.is_p_type = false;
+        phosphorus.diffusivity_d0 = 3.85;     // cm²/s
+        phosphorus.diffusion_ea = 3.66;       // eV
+        phosphorus.solubility_limit = 1e21;   // cm⁻³
+        table[IonSpecies::PHOSPHORUS_31] = phosphorus;
+
+        // Arsenic-75
+        IonProperties arsenic;
+        arsenic.symbol = "As";
+        arsenic.atomic_mass = 74.92;
+        arsenic.atomic_number = 33;
+        arsenic.binding_energy = 9.8;
+        arsenic.is_p_type = false;
+        arsenic.diffusivity_d0 = 0.066;       // cm²/s
+        arsenic.diffusion_ea = 4.05;          // eV
+        arsenic.solubility_limit = 2e21;      // cm⁻³
+        table[IonSpecies::ARSENIC_75] = arsenic;
+        return table;
+    }();
+    return database;
+}
+
+const std::unordered_map<ChannelingDirection, double>& EnhancedDopingPhysics::channelingFactors() {
+    static const std::unordered_map<ChannelingDirection, double> factors = {
+        {ChannelingDirection::RANDOM, 0.0},
+        {ChannelingDirection::CHANNEL_100, 0.3},
+        {ChannelingDirection::CHANNEL_110, 0.2},
+        {ChannelingDirection::CHANNEL_111, 0.4},
+        {ChannelingDirection::PLANAR_100, 0.15},
+        {ChannelingDirection::PLANAR_110, 0.1},
+        {ChannelingDirection::PLANAR_111, 0.2},
+    };
+    return factors;
 }
 
 double EnhancedDopingPhysics::calculateReducedEnergy(
@@ -365,13 +816,26 @@ double EnhancedDopingPhysics::calculateReducedEnergy(
 }
 
 IonProperties EnhancedDopingPhysics::getIonProperties(IonSpecies species) const {
-    auto it = ion_database_.find(species);
-    if (it == ion_database_.end()) {
+    const auto& database = ionDatabase();
+    auto it = database.find(species);
+    if (it == database.end()) {
         throw PhysicsException("Unknown ion species");
     }
     return it->second;
 }
 
+void EnhancedDopingPhysics::setMomentCorrection(IonSpecies species, const MomentCorrection& correction) {
+    if (!(correction.range > 0.0) || !(correction.straggling > 0.0)) {
+        throw std::invalid_argument("Moment corrections must be positive");
+    }
+    moment_corrections_[species] = correction;
+}
+
+MomentCorrection EnhancedDopingPhysics::getMomentCorrection(IonSpecies species) const {
+    auto it = moment_corrections_.find(species);
+    return it == moment_corrections_.end() ? MomentCorrection() : it->second;
+}
+
 bool EnhancedDopingPhysics::validateImplantationConditions(
     const ImplantationConditions& conditions,
     std::string& error_message) const {
@@ -402,29 +866,20 @@ std::string EnhancedDopingPhysics::ionSpeciesToString(IonSpecies species) const
 // DopingUtils implementation
 namespace DopingUtils {
     double calculateMobility(IonSpecies species, double concentration, double temperature) {
-        // Simplified mobility model (Caughey-Thomas)
-        double mu_min, mu_max, n_ref, alpha;
-        
-        auto props = EnhancedDopingPhysics().getIonProperties(species);
-        
-        if (props.is_p_type) {
-            // Hole mobility parameters
-            mu_min = 44.9;
-            mu_max = 470.5;
-            n_ref = 2.23e17;
-            alpha = 0.719;
-        } else {
-            // Electron mobility parameters  
-            mu_min = 68.5;
-            mu_max = 1414.0;
-            n_ref = 9.20e16;
-            alpha = 0.711;
-        }
-        
-        // Temperature dependence
-        double temp_factor = std::pow(temperature / 300.0, -2.3);
-        
-        return (mu_min + (mu_max - mu_min) / (1.0 + std::pow(concentration / n_ref, alpha))) * temp_factor;
+        // Simplified mobility model (Caughey-Thomas), for the default
+        // database's carrier type
+        static const EnhancedDopingPhysics physics;
+        MobilityModel model(physics.getIonProperties(species).is_p_type, temperature);
+        return (model.mu_min + model.mu_span / (1.0 + std::pow(concentration / model.n_ref, model.alpha))) *
+               model.temp_factor;
+    }
+
+    double calculateResistivity(double concentration, double mobility, bool is_p_type) {
+        // Ω·cm; electrons and holes carry the same charge, so the carrier
+        // type only selects which mobility was passed
+        (void)is_p_type;
+        double conductivity = kElementaryCharge * concentration * mobility;
+        return conductivity > 0 ? 1.0 / conductivity : std::numeric_limits<double>::infinity();
     }
 }
 
@@ -437,23 +892,13 @@ std::vector<double> EnhancedDopingPhysics::calculateDamageProfile(
     auto ion_props = getIonProperties(conditions.species);
     double rp = calculateProjectedRange(conditions);
 
-    // Simplified damage model based on nuclear stopping power
-    for (size_t i = 0; i < depths.size(); ++i) {
-        double depth = depths[i];
-
-        // Damage peaks before projected range
-        double damage_peak_depth = rp * 0.6;
-        double damage_width = rp * 0.3;
-
-        // Gaussian-like damage distribution
-        double damage_density = conditions.dose *
-            std::exp(-std::pow(depth - damage_peak_depth, 2) / (2.0 * damage_width * damage_width));
-
-        // Scale by atomic number (heavier ions cause more damage)
-        damage_density *= ion_props.atomic_number / 5.0; // Normalized to boron
-
-        damage[i] = damage_density;
-    }
+    // Simplified damage model based on nuclear stopping power: a Gaussian
+    // peaking before the projected range, scaled by atomic number (heavier
+    // ions cause more damage), normalized to boron
+    double damage_peak_depth = rp * 0.6;
+    double damage_width = rp * 0.3;
+    VectorMath::gaussian(depths.data(), damage.data(), depths.size(), damage_peak_depth, damage_width,
+                         conditions.dose * (ion_props.atomic_number / 5.0));
 
     return damage;
 }
@@ -4,12 +4,15 @@
 #include "../core/enhanced_error_handling.hpp"
 #include "../core/config_manager.hpp"
 #include "../core/wafer_enhanced.hpp"
+#include "../core/autodiff.hpp"
 #include <memory>
 #include <vector>
 #include <unordered_map>
 #include <functional>
 #include <cmath>
 
+class ImplantMoments;
+
 namespace SemiPRO {
 
 /**
@@ -114,14 +117,23 @@ struct IonProperties {
                      solubility_limit(0) {}
 };
 
+// Scales on a species' tabulated range moments, e.g. fitted to SIMS
+// profiles; 1 leaves the LSS tables as they are
+struct MomentCorrection {
+    double range = 1.0;       // On the projected range
+    double straggling = 1.0;  // On the range straggling
+};
+
 // Implantation results with detailed analysis
 struct ImplantationResults {
+    IonSpecies species;
     double projected_range;    // μm (Rp)
     double range_straggling;   // μm (ΔRp)
     double lateral_straggling; // μm
     double peak_concentration; // cm⁻³
     double sheet_resistance;   // Ω/sq
     double junction_depth;     // μm
+    std::vector<double> depths;                // μm, grid of the profiles
     std::vector<double> concentration_profile; // vs depth
     std::vector<double> damage_profile;        // damage density vs depth
     std::vector<double> amorphous_regions;     // amorphous layer boundaries
@@ -129,17 +141,27 @@ struct ImplantationResults {
     double sputtering_yield;    // Atoms sputtered per ion
     std::unordered_map<std::string, double> quality_metrics;
     
-    ImplantationResults() : projected_range(0), range_straggling(0), lateral_straggling(0),
+    ImplantationResults() : species(IonSpecies::BORON_11), projected_range(0), range_straggling(0), lateral_straggling(0),
                            peak_concentration(0), sheet_resistance(0), junction_depth(0),
                            channeling_fraction(0), sputtering_yield(0) {}
 };
 
+// The Gaussian part of an implant in closed form, for any scalar type
+template <typename Scalar>
+struct GaussianImplant {
+    Scalar projected_range;    // μm
+    Scalar range_straggling;   // μm
+    Scalar peak_concentration; // cm⁻³
+    Scalar junction_depth;     // μm, zero when the peak stays under the background
+};
+
 // Annealing results
 struct AnnealingResults {
     double final_junction_depth;     // μm
     double final_sheet_resistance;   // Ω/sq
     double dopant_activation;        // Fraction activated
     double defect_density;           // cm⁻³
+    std::vector<double> depths;                    // μm, may reach past the implant grid
     std::vector<double> final_concentration_profile;
     std::vector<double> electrical_profile; // Electrically active dopants
     double diffusion_length;         // μm
@@ -151,18 +173,50 @@ struct AnnealingResults {
                         recrystallization_complete(false) {}
 };
 
+// Scalar electrical metrics of a depth profile
+struct ProfileMetrics {
+    double junction_depth;     // μm, first depth at or below the background
+    double sheet_resistance;   // Ω/sq
+    double peak_concentration; // cm⁻³
+    double peak_depth;         // μm
+    double dose;               // cm⁻², trapezoidal
+    size_t points;
+
+    ProfileMetrics() : junction_depth(0), sheet_resistance(1e6), peak_concentration(0), peak_depth(0), dose(0),
+                       points(0) {}
+};
+
+// Reduces a profile to its ProfileMetrics in one pass, fed in blocks of
+// increasing depth as they are evaluated; the profile itself need not be
+// kept. Sheet conductance weights each point's Caughey-Thomas
+// conductivity by the depth step to the next point, as
+// calculateSheetResistance always has.
+class ProfileMetricsAccumulator {
+public:
+    ProfileMetricsAccumulator(bool is_p_type, double temperature = 300.0, double background_doping = 1e15);
+
+    void add(const double* depths, const double* concentrations, size_t n);
+    ProfileMetrics result() const;
+
+private:
+    double mu_min_, mu_span_, inverse_n_ref_, alpha_, temp_factor_;
+    double background_;
+    double sheet_conductance_ = 0.0; // S
+    bool junction_found_ = false;
+    double previous_depth_ = 0.0, previous_concentration_ = 0.0;
+    ProfileMetrics metrics_;
+};
+
 // Enhanced doping physics engine
 class EnhancedDopingPhysics {
 private:
-    std::unordered_map<IonSpecies, IonProperties> ion_database_;
-    std::unordered_map<ChannelingDirection, double> channeling_factors_;
-    
     // Configuration
     bool enable_channeling_effects_ = true;
     bool enable_damage_modeling_ = true;
     bool enable_sputtering_ = true;
     bool enable_clustering_ = true;
     double numerical_precision_ = 1e-8;
+    std::unordered_map<IonSpecies, MomentCorrection> moment_corrections_;
     
 public:
     EnhancedDopingPhysics();
@@ -231,6 +285,19 @@ public:
         const ImplantationConditions& conditions
     ) const;
     
+    // Range moments, peak and junction depth of the Gaussian profile, with
+    // no channeling tail and no cap on the peak. With ADScalar energy
+    // (keV) and dose (cm⁻²) seeded as variables every field carries its
+    // derivatives with respect to them. Instantiated for double and
+    // ADScalar.
+    template <typename Scalar>
+    GaussianImplant<Scalar> calculateGaussianImplant(
+        IonSpecies species,
+        const Scalar& energy,
+        const Scalar& dose,
+        double background_doping = 1e15
+    ) const;
+    
     // Electrical properties
     double calculateSheetResistance(
         const std::vector<double>& concentration_profile,
@@ -245,7 +312,27 @@ public:
         double background_doping = 1e15
     ) const;
     
-    // Annealing and diffusion
+    // Junction depth, sheet resistance, peak and dose in one pass
+    ProfileMetrics calculateProfileMetrics(
+        const std::vector<double>& concentration_profile,
+        const std::vector<double>& depths,
+        IonSpecies species,
+        double background_doping = 1e15,
+        double temperature = 300.0
+    ) const;
+    
+    // The metrics of the implant profile alone, streamed through the
+    // reduction block by block on the even grid simulateIonImplantation
+    // adapts its mesh from: no profile is kept and the wafer is untouched.
+    // Agrees with the full simulation's metrics to the mesh tolerance.
+    ProfileMetrics calculateImplantationMetrics(
+        const ImplantationConditions& conditions,
+        double background_doping = 1e15
+    ) const;
+    
+    // Annealing and diffusion, on the coupled diffusion solver. Temperatures
+    // are in °C and times in minutes, as in AnnealingConditions; depths
+    // must be evenly spaced.
     std::vector<double> simulateDiffusion(
         const std::vector<double>& initial_profile,
         const std::vector<double>& depths,
@@ -281,6 +368,10 @@ public:
         double temperature
     ) const;
     
+    // Time-averaged interstitial supersaturation of a uniform excess
+    // interstitial density (cm⁻³), clusters holding it at their solubility
+    // while they last, lost to bulk recombination alone: an upper bound on
+    // the TED enhancement
     double calculateTransientEnhancedDiffusion(
         double damage_density,
         double temperature,
@@ -305,6 +396,11 @@ public:
     
     // Configuration and calibration
     void setIonProperties(IonSpecies species, const IonProperties& properties);
+    // Every model reading the species' projected range or range
+    // straggling sees them scaled. Throws std::invalid_argument unless
+    // both scales are positive.
+    void setMomentCorrection(IonSpecies species, const MomentCorrection& correction);
+    MomentCorrection getMomentCorrection(IonSpecies species) const;
     void setChannelingFactor(ChannelingDirection direction, double factor);
     void enablePhysicsEffects(bool channeling = true, bool damage = true, 
                              bool sputtering = true, bool clustering = true);
@@ -318,8 +414,9 @@ public:
     IonProperties getIonProperties(IonSpecies species) const;
     
 private:
-    void initializeIonDatabase();
-    void initializeChannelingFactors();
+    // Process-wide and immutable, built on first use rather than per engine
+    static const std::unordered_map<IonSpecies, IonProperties>& ionDatabase();
+    static const std::unordered_map<ChannelingDirection, double>& channelingFactors();
     
     // Numerical methods
     std::vector<double> solveDiffusionEquation(
@@ -329,10 +426,23 @@ private:
         double time
     ) const;
     
+    // calculateConcentrationProfile into a caller's buffer
+    void evaluateConcentrationProfile(
+        const ImplantationConditions& conditions,
+        const double* depths,
+        double* profile,
+        size_t n,
+        bool include_channeling
+    ) const;
+    
     double calculateReducedEnergy(
         const ImplantationConditions& conditions
     ) const;
     
+    // Range moments of the species in silicon, shared with the other
+    // implant models
+    const ImplantMoments& momentTable(IonSpecies species) const;
+    
     double calculateNuclearStoppingPower(
         const ImplantationConditions& conditions,
         double energy
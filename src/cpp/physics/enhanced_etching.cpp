@@ -1,13 +1,138 @@
 #include "enhanced_etching.hpp"
+#include "../core/philox.hpp"
+#include "../core/reproducibility.hpp"
 #include <algorithm>
+#include <array>
 #include <cmath>
-#include <random>
+#include <stdexcept>
+#include <type_traits>
 
 namespace SemiPRO {
 
-EnhancedEtchingPhysics::EnhancedEtchingPhysics() {
-    initializeEtchRateDatabase();
-    initializeTechniqueNames();
+namespace {
+
+// Built at compile time, so every engine starts from the same read-only copy
+constexpr EnhancedEtchingPhysics::EtchRateTable defaultEtchRates() {
+    EnhancedEtchingPhysics::EtchRateTable rates{};
+    for (double& rate : rates) {
+        rate = 0.1;
+    }
+    auto set = [&rates](EtchMaterial material, EtchChemistry chemistry, double rate) {
+        rates[static_cast<std::size_t>(material) * EnhancedEtchingPhysics::kChemistries +
+              static_cast<std::size_t>(chemistry)] = rate;
+    };
+    // Silicon etch rates (μm/min)
+    set(EtchMaterial::SILICON, EtchChemistry::FLUORINE_BASED, 0.5);
+    set(EtchMaterial::SILICON, EtchChemistry::CHLORINE_BASED, 0.3);
+    set(EtchMaterial::SILICON, EtchChemistry::BROMINE_BASED, 0.2);
+    
+    // Silicon dioxide etch rates
+    set(EtchMaterial::SILICON_DIOXIDE, EtchChemistry::FLUORINE_BASED, 0.1);
+    set(EtchMaterial::SILICON_DIOXIDE, EtchChemistry::WET_ACID, 0.05);
+    
+    // Silicon nitride etch rates
+    set(EtchMaterial::SILICON_NITRIDE, EtchChemistry::FLUORINE_BASED, 0.02);
+    set(EtchMaterial::SILICON_NITRIDE, EtchChemistry::WET_ACID, 0.001);
+    
+    // Aluminum etch rates
+    set(EtchMaterial::ALUMINUM, EtchChemistry::CHLORINE_BASED, 0.2);
+    set(EtchMaterial::ALUMINUM, EtchChemistry::WET_ACID, 0.1);
+    
+    // Photoresist etch rates
+    set(EtchMaterial::PHOTORESIST, EtchChemistry::OXYGEN_BASED, 0.3);
+    set(EtchMaterial::PHOTORESIST, EtchChemistry::FLUORINE_BASED, 0.01);
+    return rates;
+}
+
+constexpr EnhancedEtchingPhysics::EtchRateTable kDefaultEtchRates = defaultEtchRates();
+
+// Indexed by EtchingTechnique
+constexpr const char* kTechniqueNames[] = {"Wet Chemical", "RIE", "DRIE", "ICP", "CCP",
+                                           "IBE", "CAIBE", "XeF2", "TMAH", "KOH"};
+static_assert(sizeof(kTechniqueNames) / sizeof(kTechniqueNames[0]) ==
+              static_cast<std::size_t>(EtchingTechnique::KOH) + 1, "A technique has no name");
+
+constexpr std::size_t kTechniques = static_cast<std::size_t>(EtchingTechnique::KOH) + 1;
+
+// The models simulateEtching routes each technique to
+enum class EtchFamily { kPlasma, kWet, kIonBeam, kGeneric };
+
+constexpr EtchFamily etchFamily(EtchingTechnique technique) {
+    switch (technique) {
+        case EtchingTechnique::RIE:
+        case EtchingTechnique::DRIE:
+        case EtchingTechnique::ICP:
+        case EtchingTechnique::CCP:
+            return EtchFamily::kPlasma;
+        case EtchingTechnique::WET_CHEMICAL:
+        case EtchingTechnique::TMAH:
+        case EtchingTechnique::KOH:
+            return EtchFamily::kWet;
+        case EtchingTechnique::IBE:
+        case EtchingTechnique::CAIBE:
+            return EtchFamily::kIonBeam;
+        default:
+            return EtchFamily::kGeneric;
+    }
+}
+
+// calculateAnisotropy before the bias enhancement
+constexpr double baseAnisotropy(EtchingTechnique technique) {
+    switch (technique) {
+        case EtchingTechnique::RIE:
+        case EtchingTechnique::DRIE:
+            return 0.8; // Good anisotropy
+        case EtchingTechnique::ICP:
+            return 0.9; // Excellent anisotropy
+        case EtchingTechnique::WET_CHEMICAL:
+            return 0.1; // Poor anisotropy (isotropic)
+        case EtchingTechnique::IBE:
+            return 0.95; // Excellent anisotropy
+        default:
+            return 0.5;
+    }
+}
+
+// Calls f with the technique as a std::integral_constant
+template <typename F>
+void withTechnique(EtchingTechnique technique, F&& f) {
+    switch (technique) {
+        case EtchingTechnique::WET_CHEMICAL:
+            f(std::integral_constant<EtchingTechnique, EtchingTechnique::WET_CHEMICAL>{});
+            break;
+        case EtchingTechnique::RIE:
+            f(std::integral_constant<EtchingTechnique, EtchingTechnique::RIE>{});
+            break;
+        case EtchingTechnique::DRIE:
+            f(std::integral_constant<EtchingTechnique, EtchingTechnique::DRIE>{});
+            break;
+        case EtchingTechnique::ICP:
+            f(std::integral_constant<EtchingTechnique, EtchingTechnique::ICP>{});
+            break;
+        case EtchingTechnique::CCP:
+            f(std::integral_constant<EtchingTechnique, EtchingTechnique::CCP>{});
+            break;
+        case EtchingTechnique::IBE:
+            f(std::integral_constant<EtchingTechnique, EtchingTechnique::IBE>{});
+            break;
+        case EtchingTechnique::CAIBE:
+            f(std::integral_constant<EtchingTechnique, EtchingTechnique::CAIBE>{});
+            break;
+        case EtchingTechnique::XeF2:
+            f(std::integral_constant<EtchingTechnique, EtchingTechnique::XeF2>{});
+            break;
+        case EtchingTechnique::TMAH:
+            f(std::integral_constant<EtchingTechnique, EtchingTechnique::TMAH>{});
+            break;
+        case EtchingTechnique::KOH:
+            f(std::integral_constant<EtchingTechnique, EtchingTechnique::KOH>{});
+            break;
+    }
+}
+
+} // namespace
+
+EnhancedEtchingPhysics::EnhancedEtchingPhysics() : etch_rates_(kDefaultEtchRates) {
     
     // Only log once per process (static flag)
     static bool logged = false;
@@ -84,33 +209,37 @@ EtchingResults EnhancedEtchingPhysics::simulateEtching(
         // Analyze quality
         results.quality_metrics = analyzeEtchingQuality(results, conditions);
         
-        // Apply results to wafer (etching removes material)
-        auto grid = wafer->getGrid();
-        int rows = grid.rows();
-        int cols = grid.cols();
-        
-        for (int i = 0; i < rows; ++i) {
-            for (int j = 0; j < cols; ++j) {
-                // Use spatial variation if available
-                double local_depth = results.final_depth;
-                if (!results.etch_profile.empty()) {
-                    int index = i * cols + j;
-                    if (index < results.etch_profile.size()) {
-                        local_depth = results.etch_profile[index];
-                    }
+        // Apply results to wafer: the surface recedes as a level set for as
+        // long as the target depth takes, each column's speed scaled by the
+        // etch profile's spatial variation. Height 0 is the floor the etch
+        // stops at.
+        FieldView grid = wafer->getGrid();
+        const int rows = grid.rows();
+        const int cols = grid.cols();
+        const double rate = calculateEtchRate(conditions);
+        if (rate > 0.0 && results.final_depth > 0.0) {
+            const LevelSet::Velocity velocity = etchVelocity(conditions);
+            const Eigen::ArrayXXd floor = grid.min(0.0);
+            const std::vector<double>& profile = results.etch_profile;
+            LevelSet::evolveHeights(grid, cell_size_, results.final_depth / rate, results.final_depth,
+                                    [&](const LevelSet::Site& site) {
+                if (site.surface.z() <= 0.0) {
+                    return LevelSet::Speed{};
                 }
-                
-                // Etch removes material
-                if (grid(i, j) > local_depth) {
-                    grid(i, j) -= local_depth;
-                } else {
-                    grid(i, j) = 0.0; // Completely etched
+                LevelSet::Speed speed = velocity(site);
+                const int i = std::clamp(static_cast<int>(std::lround(site.surface.x())), 0, rows - 1);
+                const int j = std::clamp(static_cast<int>(std::lround(site.surface.y())), 0, cols - 1);
+                const std::size_t index = static_cast<std::size_t>(i) * cols + j;
+                if (index < profile.size()) {
+                    const double scale = profile[index] / results.final_depth;
+                    speed.normal *= scale;
+                    speed.vertical *= scale;
                 }
-            }
+                return speed;
+            });
+            grid = grid.max(floor);
         }
         
-        wafer->setGrid(grid);
-        
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::PHYSICS,
                           "Enhanced etching completed: " + 
                           std::to_string(results.final_depth) + " μm " +
@@ -206,19 +335,110 @@ EtchingResults EnhancedEtchingPhysics::simulateIonBeamEtching(
     return results;
 }
 
-double EnhancedEtchingPhysics::calculateEtchRate(
-    const EtchingConditions& conditions) const {
+template <EtchingTechnique Technique>
+void EnhancedEtchingPhysics::calculateBatchGroup(
+    const EtchingBatch& batch,
+    Eigen::Index begin,
+    Eigen::Index size,
+    EtchingBatchResults& results) const {
+    
+    constexpr EtchFamily family = etchFamily(Technique);
+    const auto pressure = batch.pressure.segment(begin, size);
+    const auto power = batch.power.segment(begin, size);
+    const auto bias = batch.bias_voltage.segment(begin, size);
+    
+    Eigen::ArrayXd rate(size);
+    if constexpr (family == EtchFamily::kIonBeam) {
+        // simulateIonBeamEtching: physical sputtering at 500 eV
+        std::array<double, kMaterials> yields;
+        for (std::size_t material = 0; material < kMaterials; ++material) {
+            yields[material] = calculateSputteringYield(static_cast<EtchMaterial>(material), 500.0) * 0.01;
+        }
+        for (Eigen::Index k = 0; k < size; ++k) {
+            rate[k] = yields[static_cast<std::size_t>(batch.target_material[begin + k])];
+        }
+    } else {
+        // calculateEtchRate
+        for (Eigen::Index k = 0; k < size; ++k) {
+            const Eigen::Index i = begin + k;
+            rate[k] = etch_rates_[etchRateIndex(batch.target_material[i], batch.chemistry[i])];
+        }
+        rate *= (power / 100.0).sqrt() * (10.0 / pressure).sqrt();
+    }
+    if constexpr (family == EtchFamily::kPlasma) {
+        // simulatePlasmaEtching: radicals at sqrt(power) sqrt(pressure) times
+        // their reference density, and ions at the sheath's energy
+        rate *= (power / 100.0 * (pressure / 10.0)).sqrt().sqrt();
+        if (enable_ion_bombardment_) {
+            const Eigen::ArrayXd ion_energy = bias * 0.8 / (1.0 + pressure / 10.0);
+            rate *= 1.0 + 0.1 * (ion_energy / 100.0).sqrt();
+        }
+    } else if constexpr (family == EtchFamily::kWet) {
+        // simulateWetEtching
+        const Eigen::ArrayXd kelvin = batch.temperature.segment(begin, size) + 273.15;
+        rate *= (-0.5 * (1.0 / kelvin - 1.0 / 298.15)).exp();
+    }
     
-    // Base etch rates (μm/min) for different material/chemistry combinations
-    double base_rate = 0.1; // Default
+    results.etch_rate.segment(begin, size) = rate;
+    results.anisotropy.segment(begin, size) = (baseAnisotropy(Technique) * (1.0 + 0.002 * bias)).min(1.0);
+}
+
+EtchingBatchResults EnhancedEtchingPhysics::calculateBatch(const EtchingBatch& batch) const {
+    const Eigen::Index n = static_cast<Eigen::Index>(batch.size());
+    if (batch.target_depth.size() != n || batch.pressure.size() != n || batch.power.size() != n ||
+        batch.bias_voltage.size() != n || batch.temperature.size() != n ||
+        batch.chemistry.size() != batch.size() || batch.target_material.size() != batch.size()) {
+        throw PhysicsException("Etching batch columns differ in length");
+    }
     
-    auto material_it = etch_rates_.find(conditions.target_material);
-    if (material_it != etch_rates_.end()) {
-        auto chemistry_it = material_it->second.find(conditions.chemistry);
-        if (chemistry_it != material_it->second.end()) {
-            base_rate = chemistry_it->second;
+    // Entries of each technique side by side, each run then swept by the
+    // kernel built for its technique
+    const BatchGroups groups(batch.technique, kTechniques);
+    EtchingBatch arranged;
+    if (!groups.inOrder()) {
+        arranged.target_depth = groups.permute(batch.target_depth);
+        arranged.pressure = groups.permute(batch.pressure);
+        arranged.power = groups.permute(batch.power);
+        arranged.bias_voltage = groups.permute(batch.bias_voltage);
+        arranged.temperature = groups.permute(batch.temperature);
+        arranged.technique = groups.permute(batch.technique);
+        arranged.chemistry = groups.permute(batch.chemistry);
+        arranged.target_material = groups.permute(batch.target_material);
+    }
+    const EtchingBatch& grouped = groups.inOrder() ? batch : arranged;
+    
+    EtchingBatchResults results;
+    results.etch_rate.resize(n);
+    results.anisotropy.resize(n);
+    for (std::size_t key = 0; key < groups.keyCount(); ++key) {
+        if (groups.size(key) > 0) {
+            withTechnique(static_cast<EtchingTechnique>(key), [&](auto technique) {
+                calculateBatchGroup<decltype(technique)::value>(grouped, groups.begin(key), groups.size(key), results);
+            });
         }
     }
+    groups.restore(results.etch_rate);
+    groups.restore(results.anisotropy);
+    
+    // Same ranges as validateConditions, in its order
+    results.status.assign(batch.size(), KernelStatus::Ok);
+    markFailed(results.status, batch.target_depth > 0.0 && batch.target_depth <= 1000.0,
+               KernelStatus::DepthOutOfRange);
+    markFailed(results.status, batch.pressure > 0.0 && batch.pressure <= 1000.0, KernelStatus::PressureOutOfRange);
+    markFailed(results.status, batch.power >= 0.0 && batch.power <= 10000.0, KernelStatus::PowerOutOfRange);
+    markFailed(results.status, results.etch_rate.isFinite() && results.anisotropy.isFinite(),
+               KernelStatus::NonFinite);
+    const Eigen::Array<bool, Eigen::Dynamic, 1> valid = statusOk(results.status);
+    results.etch_rate = valid.select(results.etch_rate, 0.0);
+    results.anisotropy = valid.select(results.anisotropy, 0.0);
+    return results;
+}
+
+double EnhancedEtchingPhysics::calculateEtchRate(
+    const EtchingConditions& conditions) const {
+    
+    // Base etch rates (μm/min) for different material/chemistry combinations
+    const double base_rate = etch_rates_[etchRateIndex(conditions.target_material, conditions.chemistry)];
     
     // Power dependence
     double power_factor = std::sqrt(conditions.power / 100.0); // Normalize to 100W
@@ -254,69 +474,148 @@ double EnhancedEtchingPhysics::calculateSelectivity(
     return base_selectivity * temp_factor;
 }
 
-double EnhancedEtchingPhysics::calculateAnisotropy(
+LevelSet::Velocity EnhancedEtchingPhysics::etchVelocity(
     const EtchingConditions& conditions) const {
     
-    double base_anisotropy = 0.5;
+    const double rate = calculateEtchRate(conditions);
+    const double anisotropy = std::clamp(calculateAnisotropy(conditions), 0.0, 1.0);
+    return LevelSet::directional(-rate, anisotropy);
+}
+
+FluxTracer::Source EnhancedEtchingPhysics::ionSource(
+    const EtchingConditions& conditions) const {
     
-    switch (conditions.technique) {
-        case EtchingTechnique::RIE:
-        case EtchingTechnique::DRIE:
-            base_anisotropy = 0.8; // Good anisotropy
+    // A sheath of energy E gives ions of transverse temperature kT an
+    // angular spread of about sqrt(kT / E), which a cos^n lobe matches at
+    // n = E / kT
+    constexpr double kTransverseTemperature = 0.5; // eV
+    const double energy = calculateIonEnergy(conditions.bias_voltage, conditions.pressure);
+    FluxTracer::Source source;
+    source.exponent = std::max(1.0, energy / kTransverseTemperature);
+    source.sticking = 1.0;
+    source.max_bounces = 0;
+    return source;
+}
+
+FluxTracer::Source EnhancedEtchingPhysics::radicalSource(
+    const EtchingConditions& conditions) const {
+    
+    const double energy = calculateIonEnergy(conditions.bias_voltage, conditions.pressure);
+    FluxTracer::Source source;
+    source.exponent = 1.0;
+    source.sticking = calculateReactionProbability(conditions.chemistry, conditions.target_material, energy);
+    return source;
+}
+
+int EnhancedEtchingPhysics::simulateFeatureProfile(
+    LevelSet& surface,
+    const EtchingConditions& conditions,
+    double time,
+    FluxTracer& tracer) const {
+    
+    SEMIPRO_PERF_TIMER("feature_etching", "EnhancedEtching");
+    
+    const double rate = calculateEtchRate(conditions);
+    const double anisotropy = std::clamp(calculateAnisotropy(conditions), 0.0, 1.0);
+    const FluxTracer::Source ions = ionSource(conditions);
+    const FluxTracer::Source radicals = radicalSource(conditions);
+    return tracer.evolve(surface, time, [&](const FluxTracer& traced) {
+        const std::vector<double> ion_flux = traced.trace(ions);
+        std::vector<double> speeds = traced.trace(radicals);
+        for (std::size_t e = 0; e < speeds.size(); ++e) {
+            speeds[e] = -rate * (anisotropy * ion_flux[e] + (1.0 - anisotropy) * speeds[e]);
+        }
+        return speeds;
+    });
+}
+
+double EnhancedEtchingPhysics::calculateReactionProbability(
+    EtchChemistry chemistry,
+    EtchMaterial material,
+    double ion_energy) const {
+    
+    // Probability a radical reacts on hitting the surface
+    double probability = 0.05;
+    switch (chemistry) {
+        case EtchChemistry::FLUORINE_BASED:
+            probability = material == EtchMaterial::SILICON || material == EtchMaterial::POLYSILICON ? 0.1 : 0.02;
             break;
-        case EtchingTechnique::ICP:
-            base_anisotropy = 0.9; // Excellent anisotropy
+        case EtchChemistry::CHLORINE_BASED:
+        case EtchChemistry::BROMINE_BASED:
+            probability = 0.02;
             break;
-        case EtchingTechnique::WET_CHEMICAL:
-            base_anisotropy = 0.1; // Poor anisotropy (isotropic)
+        case EtchChemistry::OXYGEN_BASED:
+            probability = material == EtchMaterial::PHOTORESIST ? 0.1 : 0.01;
             break;
-        case EtchingTechnique::IBE:
-            base_anisotropy = 0.95; // Excellent anisotropy
+        case EtchChemistry::WET_ACID:
+        case EtchChemistry::WET_BASE:
+            probability = 1.0; // Reactant-limited in solution
             break;
         default:
-            base_anisotropy = 0.5;
+            break;
     }
     
-    // Bias voltage enhances anisotropy
-    double bias_factor = 1.0 + 0.002 * conditions.bias_voltage;
-    
-    return std::min(1.0, base_anisotropy * bias_factor);
+    // Ion bombardment clears passivation and damages the lattice, helping
+    // the radicals react
+    const double enhancement = 1.0 + 0.05 * std::sqrt(std::max(0.0, ion_energy));
+    return std::clamp(probability * enhancement, 1e-3, 1.0);
 }
 
-void EnhancedEtchingPhysics::initializeEtchRateDatabase() {
-    // Silicon etch rates (μm/min)
-    etch_rates_[EtchMaterial::SILICON][EtchChemistry::FLUORINE_BASED] = 0.5;
-    etch_rates_[EtchMaterial::SILICON][EtchChemistry::CHLORINE_BASED] = 0.3;
-    etch_rates_[EtchMaterial::SILICON][EtchChemistry::BROMINE_BASED] = 0.2;
+void EnhancedEtchingPhysics::setCellSize(double cell_size) {
+    if (!(cell_size > 0.0)) {
+        throw std::invalid_argument("Etching cell size must be positive");
+    }
+    cell_size_ = cell_size;
+}
+
+void EnhancedEtchingPhysics::setLoadingScales(const std::vector<EtchLoadingScale>& scales) {
+    for (const auto& scale : scales) {
+        if (!(scale.length > 0.0) || !(scale.coefficient >= 0.0)) {
+            throw std::invalid_argument("Loading scales need a positive length and a non-negative coefficient");
+        }
+    }
+    loading_scales_ = scales;
+}
+
+Eigen::ArrayXXd EnhancedEtchingPhysics::calculateLoadingFactor(
+    const BitMask& resist) const {
     
-    // Silicon dioxide etch rates
-    etch_rates_[EtchMaterial::SILICON_DIOXIDE][EtchChemistry::FLUORINE_BASED] = 0.1;
-    etch_rates_[EtchMaterial::SILICON_DIOXIDE][EtchChemistry::WET_ACID] = 0.05;
+    Eigen::ArrayXXd factor = Eigen::ArrayXXd::Ones(resist.rows(), resist.cols());
+    if (resist.empty() || loading_scales_.empty()) {
+        return factor;
+    }
     
-    // Silicon nitride etch rates
-    etch_rates_[EtchMaterial::SILICON_NITRIDE][EtchChemistry::FLUORINE_BASED] = 0.02;
-    etch_rates_[EtchMaterial::SILICON_NITRIDE][EtchChemistry::WET_ACID] = 0.001;
+    std::vector<PatternDensity::Scale> scales;
+    for (const auto& scale : loading_scales_) {
+        scales.push_back({scale.length / cell_size_, PatternDensity::Window::kGaussian});
+    }
+    const PatternDensity::Maps resist_density = PatternDensity::maps(resist, scales);
+    for (std::size_t s = 0; s < loading_scales_.size(); ++s) {
+        const double k = loading_scales_[s].coefficient;
+        const Eigen::ArrayXXd open = 1.0 - (*resist_density)[s];
+        factor *= (1.0 + k) / (1.0 + k * open);
+    }
+    return factor;
+}
+
+double EnhancedEtchingPhysics::calculateAnisotropy(
+    const EtchingConditions& conditions) const {
     
-    // Aluminum etch rates
-    etch_rates_[EtchMaterial::ALUMINUM][EtchChemistry::CHLORINE_BASED] = 0.2;
-    etch_rates_[EtchMaterial::ALUMINUM][EtchChemistry::WET_ACID] = 0.1;
+    // Bias voltage enhances anisotropy
+    double bias_factor = 1.0 + 0.002 * conditions.bias_voltage;
     
-    // Photoresist etch rates
-    etch_rates_[EtchMaterial::PHOTORESIST][EtchChemistry::OXYGEN_BASED] = 0.3;
-    etch_rates_[EtchMaterial::PHOTORESIST][EtchChemistry::FLUORINE_BASED] = 0.01;
+    return std::min(1.0, baseAnisotropy(conditions.technique) * bias_factor);
 }
 
-void EnhancedEtchingPhysics::initializeTechniqueNames() {
-    technique_names_[EtchingTechnique::WET_CHEMICAL] = "Wet Chemical";
-    technique_names_[EtchingTechnique::RIE] = "RIE";
-    technique_names_[EtchingTechnique::DRIE] = "DRIE";
-    technique_names_[EtchingTechnique::ICP] = "ICP";
-    technique_names_[EtchingTechnique::CCP] = "CCP";
-    technique_names_[EtchingTechnique::IBE] = "IBE";
-    technique_names_[EtchingTechnique::CAIBE] = "CAIBE";
-    technique_names_[EtchingTechnique::XeF2] = "XeF2";
-    technique_names_[EtchingTechnique::TMAH] = "TMAH";
-    technique_names_[EtchingTechnique::KOH] = "KOH";
+void EnhancedEtchingPhysics::setEtchRate(EtchMaterial material, EtchChemistry chemistry, double rate) {
+    if (!(rate >= 0.0)) {
+        throw std::invalid_argument("Etch rate must not be negative");
+    }
+    etch_rates_[etchRateIndex(material, chemistry)] = rate;
+}
+
+double EnhancedEtchingPhysics::getEtchRate(EtchMaterial material, EtchChemistry chemistry) const {
+    return etch_rates_[etchRateIndex(material, chemistry)];
 }
 
 double EnhancedEtchingPhysics::calculateIonEnergy(
@@ -360,21 +659,29 @@ std::vector<double> EnhancedEtchingPhysics::calculateEtchProfile(
     const EtchingConditions& conditions,
     double base_depth) {
 
-    auto grid = wafer->getGrid();
+    const auto& grid = wafer->getGrid();
     int rows = grid.rows();
     int cols = grid.cols();
 
     std::vector<double> profile(rows * cols, base_depth);
 
-    // Add small random variations (±3%)
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::normal_distribution<> dis(1.0, 0.03);
-
+    // Add small random variations (±3%), each cell's from its own counter
+    const Philox4x32 philox(Reproducibility::key());
     for (int i = 0; i < rows; ++i) {
         for (int j = 0; j < cols; ++j) {
             int index = i * cols + j;
-            profile[index] = base_depth * dis(gen);
+            profile[index] = base_depth * (1.0 + 0.03 * Philox4x32::normals(philox(index))[0]);
+        }
+    }
+
+    // Openings etch faster the less open area around them shares the reactant
+    const BitMask& resist = wafer->getPhotoresistMask();
+    if (enable_loading_effects_ && resist.rows() == rows && resist.cols() == cols && resist.count() > 0) {
+        const Eigen::ArrayXXd loading = calculateLoadingFactor(resist);
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+                profile[i * cols + j] *= loading(i, j);
+            }
         }
     }
 
@@ -487,8 +794,23 @@ double EnhancedEtchingPhysics::calculateSurfaceRoughness(
 }
 
 std::string EnhancedEtchingPhysics::techniqueToString(EtchingTechnique technique) const {
-    auto it = technique_names_.find(technique);
-    return (it != technique_names_.end()) ? it->second : "Unknown";
+    const std::size_t index = static_cast<std::size_t>(technique);
+    return index < std::size(kTechniqueNames) ? kTechniqueNames[index] : "Unknown";
+}
+
+std::string EnhancedEtchingPhysics::chemistryToString(EtchChemistry chemistry) const {
+    switch (chemistry) {
+        case EtchChemistry::FLUORINE_BASED: return "Fluorine";
+        case EtchChemistry::CHLORINE_BASED: return "Chlorine";
+        case EtchChemistry::BROMINE_BASED: return "Bromine";
+        case EtchChemistry::OXYGEN_BASED: return "Oxygen";
+        case EtchChemistry::HYDROGEN_BASED: return "Hydrogen";
+        case EtchChemistry::NOBLE_GAS: return "Noble Gas";
+        case EtchChemistry::WET_ACID: return "Wet Acid";
+        case EtchChemistry::WET_BASE: return "Wet Base";
+        case EtchChemistry::MIXED_CHEMISTRY: return "Mixed";
+        default: return "Unknown";
+    }
 }
 
 std::string EnhancedEtchingPhysics::materialToString(EtchMaterial material) const {
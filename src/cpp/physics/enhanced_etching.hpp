@@ -4,6 +4,12 @@
 #include "../core/enhanced_error_handling.hpp"
 #include "../core/config_manager.hpp"
 #include "../core/wafer_enhanced.hpp"
+#include "../core/level_set.hpp"
+#include "../core/flux_tracer.hpp"
+#include "../core/pattern_density.hpp"
+#include "../core/batch_groups.hpp"
+#include "../core/kernel_status.hpp"
+#include <array>
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -104,11 +110,51 @@ struct EtchingResults {
                       surface_roughness(0), mask_erosion(0) {}
 };
 
+// Conditions for etching many wafers at once, one column entry per wafer
+struct EtchingBatch {
+    Eigen::ArrayXd target_depth;   // μm
+    Eigen::ArrayXd pressure;       // mTorr
+    Eigen::ArrayXd power;          // W
+    Eigen::ArrayXd bias_voltage;   // V
+    Eigen::ArrayXd temperature;    // °C
+    std::vector<EtchingTechnique> technique;
+    std::vector<EtchChemistry> chemistry;
+    std::vector<EtchMaterial> target_material;
+    
+    explicit EtchingBatch(size_t n = 0)
+        : target_depth(Eigen::ArrayXd::Ones(n)), pressure(Eigen::ArrayXd::Constant(n, 10.0)),
+          power(Eigen::ArrayXd::Constant(n, 100.0)), bias_voltage(Eigen::ArrayXd::Constant(n, 100.0)),
+          temperature(Eigen::ArrayXd::Constant(n, 25.0)), technique(n, EtchingTechnique::RIE),
+          chemistry(n, EtchChemistry::FLUORINE_BASED), target_material(n, EtchMaterial::SILICON) {}
+    size_t size() const { return technique.size(); }
+};
+
+struct EtchingBatchResults {
+    Eigen::ArrayXd etch_rate;    // μm/min, 0 where invalid
+    Eigen::ArrayXd anisotropy;
+    std::vector<KernelStatus> status; // Ok where the conditions passed validateConditions
+
+    bool ok(size_t i) const { return status[i] == KernelStatus::Ok; }
+};
+
+// One length scale of etch loading: the reactant reaching a point is
+// shared by the open area within length of it
+struct EtchLoadingScale {
+    double length;      // μm, sigma of the Gaussian the open area is averaged over
+    double coefficient; // k of the rate factor (1 + k) / (1 + k ρ)
+};
+
 // Enhanced etching physics engine
 class EnhancedEtchingPhysics {
+public:
+    static constexpr std::size_t kMaterials = static_cast<std::size_t>(EtchMaterial::BARRIER_METAL) + 1;
+    static constexpr std::size_t kChemistries = static_cast<std::size_t>(EtchChemistry::MIXED_CHEMISTRY) + 1;
+    // Base etch rate in μm/min of each material, row by row, in each
+    // chemistry, so a lookup is one index; pairs without data hold 0.1
+    using EtchRateTable = std::array<double, kMaterials * kChemistries>;
+    
 private:
-    std::unordered_map<EtchMaterial, std::unordered_map<EtchChemistry, double>> etch_rates_;
-    std::unordered_map<EtchingTechnique, std::string> technique_names_;
+    EtchRateTable etch_rates_;
     
     // Configuration
     bool enable_surface_chemistry_ = true;
@@ -116,6 +162,9 @@ private:
     bool enable_sidewall_passivation_ = true;
     bool enable_loading_effects_ = true;
     double numerical_precision_ = 1e-8;
+    double cell_size_ = 0.01; // um per wafer grid cell, the profile's voxel size
+    // Microloading within a die and macroloading across the wafer
+    std::vector<EtchLoadingScale> loading_scales_ = {{10.0, 0.2}, {1000.0, 0.5}};
     
 public:
     EnhancedEtchingPhysics();
@@ -142,6 +191,12 @@ public:
         const EtchingConditions& conditions
     );
     
+    // The etch rate and anisotropy simulateEtching finds for each batch
+    // entry. Entries are grouped by technique and each group runs a kernel
+    // specialized for it, so the loops over a group hold no branches on
+    // the technique and only index the rate table.
+    EtchingBatchResults calculateBatch(const EtchingBatch& batch) const;
+    
     // Etch rate calculations
     double calculateEtchRate(
         const EtchingConditions& conditions
@@ -157,6 +212,45 @@ public:
         const EtchingConditions& conditions
     ) const;
     
+    // Etch rate relative to a blanket wafer's at each cell of a resist mask,
+    // by Mogab's loading model: every loading scale multiplies it by
+    // (1 + k) / (1 + k ρ), with ρ the open fraction of the pattern within
+    // the scale's length, so sparse openings etch faster than wide open
+    // fields. The density maps come from PatternDensity's shared cache.
+    Eigen::ArrayXXd calculateLoadingFactor(
+        const BitMask& resist
+    ) const;
+    
+    // Level-set surface velocity in um/min: the surface recedes at the etch
+    // rate, a calculateAnisotropy() fraction of it arriving straight down
+    LevelSet::Velocity etchVelocity(
+        const EtchingConditions& conditions
+    ) const;
+    
+    // Species a feature is etched by, for the flux tracer: ions leave the
+    // sheath nearly straight down and are spent on their first hit;
+    // radicals arrive from every direction and react with
+    // calculateReactionProbability() of the hits
+    FluxTracer::Source ionSource(
+        const EtchingConditions& conditions
+    ) const;
+    
+    FluxTracer::Source radicalSource(
+        const EtchingConditions& conditions
+    ) const;
+    
+    // Etches a feature's surface for time minutes by traced fluxes, so deep
+    // and narrow openings shade their own floors: each element recedes at
+    // the etch rate times a calculateAnisotropy() share of its ion flux and
+    // the rest of its radical flux, both relative to open ground. Returns
+    // the number of traces.
+    int simulateFeatureProfile(
+        LevelSet& surface,
+        const EtchingConditions& conditions,
+        double time,
+        FluxTracer& tracer
+    ) const;
+    
     // Surface chemistry modeling
     double calculateSurfaceCoverage(
         EtchChemistry chemistry,
@@ -263,7 +357,15 @@ public:
     ) const;
     
     // Configuration and calibration
+    // Throws std::invalid_argument for a negative rate
     void setEtchRate(EtchMaterial material, EtchChemistry chemistry, double rate);
+    // Base rate (μm/min) at 100 W and 10 mTorr
+    double getEtchRate(EtchMaterial material, EtchChemistry chemistry) const;
+    // Side of one wafer grid cell in um; throws std::invalid_argument unless positive
+    void setCellSize(double cell_size);
+    // Throws std::invalid_argument for a length that is not positive or a
+    // negative coefficient; no scales turns loading off
+    void setLoadingScales(const std::vector<EtchLoadingScale>& scales);
     void enablePhysicsEffects(bool surface_chemistry = true, bool ion_bombardment = true,
                              bool sidewall_passivation = true, bool loading_effects = true);
     
@@ -273,8 +375,18 @@ public:
     std::string materialToString(EtchMaterial material) const;
     
 private:
-    void initializeEtchRateDatabase();
-    void initializeTechniqueNames();
+    static std::size_t etchRateIndex(EtchMaterial material, EtchChemistry chemistry) {
+        return static_cast<std::size_t>(material) * kChemistries + static_cast<std::size_t>(chemistry);
+    }
+    
+    // calculateBatch on the size entries of one technique from begin
+    template <EtchingTechnique Technique>
+    void calculateBatchGroup(
+        const EtchingBatch& batch,
+        Eigen::Index begin,
+        Eigen::Index size,
+        EtchingBatchResults& results
+    ) const;
     
     // Numerical methods
     double solveEtchKinetics(
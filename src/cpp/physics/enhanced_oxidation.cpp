@@ -1,10 +1,105 @@
 #include "enhanced_oxidation.hpp"
+#include "../core/grid_stencil_matrix.hpp"
+#include "../core/philox.hpp"
+#include "../core/reproducibility.hpp"
+#include <Eigen/Sparse>
 #include <algorithm>
+#include <array>
 #include <cmath>
-#include <random>
+#include <type_traits>
 
 namespace SemiPRO {
 
+namespace {
+
+// Deal-Grove constants of each tabulated atmosphere at 1000°C, where the
+// batch kernels can fold them in; initializeDefaultParameters copies them
+// into the runtime table
+template <OxidationAtmosphere Atmosphere>
+struct AtmosphereKinetics;
+
+template <>
+struct AtmosphereKinetics<OxidationAtmosphere::DRY_O2> {
+    static constexpr double A = 0.165;              // μm
+    static constexpr double B = 0.0117;             // μm²/h
+    static constexpr double tau = 0.0;              // h
+    static constexpr double activation_A = 2.05;    // eV
+    static constexpr double activation_B = 1.23;    // eV
+    static constexpr double pressure_exponent = 1.0;
+};
+
+template <>
+struct AtmosphereKinetics<OxidationAtmosphere::WET_H2O> {
+    static constexpr double A = 0.226;
+    static constexpr double B = 0.51;
+    static constexpr double tau = 0.0;
+    static constexpr double activation_A = 2.05;
+    static constexpr double activation_B = 0.78;
+    static constexpr double pressure_exponent = 1.0;
+};
+
+// Similar to wet
+template <>
+struct AtmosphereKinetics<OxidationAtmosphere::PYROGENIC> : AtmosphereKinetics<OxidationAtmosphere::WET_H2O> {};
+
+template <typename Kinetics>
+DealGroveParameters dealGroveParameters() {
+    DealGroveParameters params;
+    params.A = Kinetics::A;
+    params.B = Kinetics::B;
+    params.tau = Kinetics::tau;
+    params.activation_energy_A = Kinetics::activation_A;
+    params.activation_energy_B = Kinetics::activation_B;
+    params.pressure_exponent = Kinetics::pressure_exponent;
+    return params;
+}
+
+// Relative to <100>
+template <CrystalOrientation Orientation>
+constexpr double kOrientationFactor = 1.0;
+template <>
+constexpr double kOrientationFactor<CrystalOrientation::SILICON_110> = 1.4; // Faster oxidation
+template <>
+constexpr double kOrientationFactor<CrystalOrientation::SILICON_111> = 0.7; // Slower oxidation
+
+constexpr std::size_t kAtmospheres = static_cast<std::size_t>(OxidationAtmosphere::PLASMA_ENHANCED) + 1;
+
+// Calls f with the atmosphere as a std::integral_constant, for those with
+// tabulated kinetics
+template <typename F>
+void withAtmosphere(OxidationAtmosphere atmosphere, F&& f) {
+    switch (atmosphere) {
+        case OxidationAtmosphere::DRY_O2:
+            f(std::integral_constant<OxidationAtmosphere, OxidationAtmosphere::DRY_O2>{});
+            break;
+        case OxidationAtmosphere::WET_H2O:
+            f(std::integral_constant<OxidationAtmosphere, OxidationAtmosphere::WET_H2O>{});
+            break;
+        case OxidationAtmosphere::PYROGENIC:
+            f(std::integral_constant<OxidationAtmosphere, OxidationAtmosphere::PYROGENIC>{});
+            break;
+        default:
+            throw PhysicsException("Unknown oxidation atmosphere");
+    }
+}
+
+template <typename F>
+void withOrientation(CrystalOrientation orientation, F&& f) {
+    switch (orientation) {
+        case CrystalOrientation::SILICON_100:
+            f(std::integral_constant<CrystalOrientation, CrystalOrientation::SILICON_100>{});
+            break;
+        case CrystalOrientation::SILICON_110:
+            f(std::integral_constant<CrystalOrientation, CrystalOrientation::SILICON_110>{});
+            break;
+        case CrystalOrientation::SILICON_111:
+            f(std::integral_constant<CrystalOrientation, CrystalOrientation::SILICON_111>{});
+            break;
+    }
+}
+
+} // namespace
+
 EnhancedOxidationPhysics::EnhancedOxidationPhysics() {
     initializeDefaultParameters();
     initializeOrientationFactors();
@@ -63,7 +158,7 @@ OxidationResults EnhancedOxidationPhysics::simulateOxidation(
         results.quality_metrics = analyzeOxideQuality(results, conditions);
         
         // Apply results to wafer
-        auto grid = wafer->getGrid();
+        FieldView grid = wafer->getGrid();
         int rows = grid.rows();
         int cols = grid.cols();
         
@@ -81,8 +176,6 @@ OxidationResults EnhancedOxidationPhysics::simulateOxidation(
             }
         }
         
-        wafer->setGrid(grid);
-        
         SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::PHYSICS,
                           "Enhanced oxidation completed: " + 
                           std::to_string(results.final_thickness) + " μm oxide grown",
@@ -98,6 +191,440 @@ OxidationResults EnhancedOxidationPhysics::simulateOxidation(
     return results;
 }
 
+template <OxidationAtmosphere Atmosphere, CrystalOrientation Orientation>
+void EnhancedOxidationPhysics::calculateBatchGroup(
+    const OxidationBatch& batch,
+    Eigen::Index begin,
+    Eigen::Index size,
+    OxidationBatchResults& results) const {
+    
+    using Kinetics = AtmosphereKinetics<Atmosphere>;
+    constexpr double orientation = kOrientationFactor<Orientation>;
+    const auto temperature = batch.temperature.segment(begin, size);
+    const auto time = batch.time.segment(begin, size);
+    const auto pressure = batch.pressure.segment(begin, size);
+    
+    // calculateEnhancedParameters
+    const double k_boltzmann = 8.617e-5; // eV/K
+    const Eigen::ArrayXd inverse_temp = (1.0 / (temperature + 273.15) - 1.0 / (1000.0 + 273.15)) / k_boltzmann;
+    Eigen::ArrayXd A = Kinetics::A * (-Kinetics::activation_A * inverse_temp).exp();
+    Eigen::ArrayXd B = Kinetics::B * (-Kinetics::activation_B * inverse_temp).exp();
+    if (enable_pressure_effects_) {
+        if constexpr (Kinetics::pressure_exponent == 1.0) {
+            B *= pressure;
+        } else {
+            B *= Eigen::pow(pressure, Kinetics::pressure_exponent);
+        }
+    }
+    if constexpr (orientation != 1.0) {
+        if (enable_orientation_effects_) {
+            A *= orientation;
+            B *= orientation;
+        }
+    }
+    
+    // calculateThickness: positive root of x² + Ax - B(t + τ) = 0
+    Eigen::ArrayXd thickness =
+        (-A + (A.square() + 4.0 * B * (time + Kinetics::tau)).sqrt()) / 2.0 + batch.initial_oxide;
+    
+    // calculateOxidationStress is proportional to (T - 25) and to
+    // (1 + 1000 x), so one evaluation gives its coefficient
+    const double stress_coefficient = calculateOxidationStress(0.0, 26.0, Orientation);
+    auto stress = [&](const Eigen::ArrayXd& x) -> Eigen::ArrayXd {
+        return stress_coefficient * (temperature - 25.0) * (1.0 + x * 1000.0);
+    };
+    if (enable_stress_effects_) {
+        thickness *= stress(thickness).unaryExpr([this](double s) { return calculateStressEffect(s, 1.0); });
+    }
+    thickness = (thickness < 0.005).select(
+        thickness * thickness.binaryExpr(temperature, [this](double x, double t) {
+            return calculateQuantumEffects(x, t);
+        }),
+        thickness);
+    thickness = thickness.max(0.0);
+    
+    results.final_thickness.segment(begin, size) = thickness;
+    results.growth_rate.segment(begin, size) = B / (2.0 * thickness + A).max(numerical_precision_);
+    results.stress_level.segment(begin, size) = stress(thickness);
+}
+
+OxidationBatchResults EnhancedOxidationPhysics::calculateBatch(const OxidationBatch& batch) const {
+    const Eigen::Index n = static_cast<Eigen::Index>(batch.size());
+    if (batch.temperature.size() != n || batch.time.size() != n || batch.pressure.size() != n) {
+        throw PhysicsException("Oxidation batch columns differ in length");
+    }
+    
+    // Entries of each atmosphere side by side, each run then swept by the
+    // kernel built for its atmosphere and the batch's orientation
+    const BatchGroups groups(batch.atmosphere, kAtmospheres);
+    OxidationBatch arranged;
+    if (!groups.inOrder()) {
+        arranged.temperature = groups.permute(batch.temperature);
+        arranged.time = groups.permute(batch.time);
+        arranged.pressure = groups.permute(batch.pressure);
+        arranged.atmosphere = groups.permute(batch.atmosphere);
+        arranged.orientation = batch.orientation;
+        arranged.initial_oxide = batch.initial_oxide;
+    }
+    const OxidationBatch& grouped = groups.inOrder() ? batch : arranged;
+    
+    OxidationBatchResults results;
+    results.final_thickness.resize(n);
+    results.growth_rate.resize(n);
+    results.stress_level.resize(n);
+    for (std::size_t key = 0; key < groups.keyCount(); ++key) {
+        if (groups.size(key) == 0) {
+            continue;
+        }
+        withAtmosphere(static_cast<OxidationAtmosphere>(key), [&](auto atmosphere) {
+            withOrientation(batch.orientation, [&](auto orientation) {
+                calculateBatchGroup<decltype(atmosphere)::value, decltype(orientation)::value>(
+                    grouped, groups.begin(key), groups.size(key), results);
+            });
+        });
+    }
+    groups.restore(results.final_thickness);
+    groups.restore(results.growth_rate);
+    groups.restore(results.stress_level);
+    
+    // Same ranges as validateConditions, in its order
+    results.status.assign(static_cast<size_t>(n), KernelStatus::Ok);
+    markFailed(results.status, batch.temperature >= 600.0 && batch.temperature <= 1200.0,
+               KernelStatus::TemperatureOutOfRange);
+    markFailed(results.status, batch.time > 0.0 && batch.time <= 100.0, KernelStatus::TimeOutOfRange);
+    markFailed(results.status, batch.pressure > 0.0 && batch.pressure <= 10.0, KernelStatus::PressureOutOfRange);
+    markFailed(results.status, results.final_thickness.isFinite() && results.growth_rate.isFinite(),
+               KernelStatus::NonFinite);
+    const Eigen::Array<bool, Eigen::Dynamic, 1> valid = statusOk(results.status);
+    results.final_thickness = valid.select(results.final_thickness, 0.0);
+    results.growth_rate = valid.select(results.growth_rate, 0.0);
+    results.stress_level = valid.select(results.stress_level, 0.0);
+    return results;
+}
+
+OxidationBatchResults EnhancedOxidationPhysics::simulateOxidationBatch(
+    const std::vector<std::shared_ptr<WaferEnhanced>>& wafers,
+    const OxidationBatch& batch) {
+
+    SEMIPRO_PERF_TIMER("oxidation_batch_simulation", "EnhancedOxidation");
+
+    if (wafers.size() != batch.size()) {
+        throw PhysicsException("Oxidation batch has " + std::to_string(batch.size()) +
+                               " entries for " + std::to_string(wafers.size()) + " wafers");
+    }
+    OxidationBatchResults results = calculateBatch(batch);
+
+    // ±2% variation drawn straight into the grid, each cell's from its own
+    // counter of its wafer's stream
+    for (size_t w = 0; w < wafers.size(); ++w) {
+        if (!results.ok(w) || !wafers[w]) {
+            continue;
+        }
+        const double thickness = results.final_thickness[static_cast<Eigen::Index>(w)];
+        const Philox4x32 philox(w < batch.noise_keys.size() ? batch.noise_keys[w] : Reproducibility::key(w));
+        FieldView grid = wafers[w]->getGrid();
+        for (int i = 0; i < grid.rows(); ++i) {
+            for (int j = 0; j < grid.cols(); ++j) {
+                const std::uint64_t cell = static_cast<std::uint64_t>(i) * grid.cols() + j;
+                grid(i, j) += thickness * (1.0 + 0.02 * Philox4x32::normals(philox(cell))[0]);
+            }
+        }
+    }
+    return results;
+}
+
+OxidationMap EnhancedOxidationPhysics::calculateOxidationMap(
+    const WaferEnhanced& wafer,
+    const OxidationConditions& conditions) const {
+    
+    std::string error_msg;
+    if (!validateConditions(conditions, error_msg)) {
+        throw PhysicsException("Invalid oxidation conditions: " + error_msg);
+    }
+    auto it = atmosphere_params_.find(conditions.atmosphere);
+    if (it == atmosphere_params_.end()) {
+        throw PhysicsException("Unknown oxidation atmosphere");
+    }
+    const DealGroveParameters& base = it->second;
+    
+    OxidationMap map;
+    const ConstFieldView field = wafer.getTemperatureField();
+    if (field.size() == 0) {
+        return map;
+    }
+    const Eigen::ArrayXXd temperature = field - field.mean() + conditions.temperature; // °C
+    const double coldest = temperature.minCoeff();
+    const double hottest = temperature.maxCoeff();
+    if (coldest < 600.0 || hottest > 1200.0) {
+        throw PhysicsException("Local oxidation temperature out of range (600-1200°C)");
+    }
+    
+    // calculateEnhancedParameters at every cell
+    const double reference = 1000.0 + 273.15;
+    const Eigen::ArrayXXd kelvin = temperature + 273.15;
+    const ArrheniusTable linear(base.activation_energy_A, coldest + 273.15, hottest + 273.15, 0.1, reference);
+    const ArrheniusTable parabolic(base.activation_energy_B, coldest + 273.15, hottest + 273.15, 0.1, reference);
+    double shared_factor = 1.0;
+    if (enable_orientation_effects_) {
+        shared_factor *= calculateOrientationEffect(conditions.orientation);
+    }
+    Eigen::ArrayXXd A = base.A * shared_factor * linear(kelvin);
+    Eigen::ArrayXXd B = base.B * shared_factor * parabolic(kelvin);
+    if (enable_pressure_effects_) {
+        B *= calculatePressureEffect(1.0, conditions.pressure, base.pressure_exponent);
+    }
+    auto dopant = dopant_effects_.find(conditions.dopant_type);
+    if (enable_dopant_effects_ && dopant != dopant_effects_.end()) {
+        const Eigen::ArrayXXd surface = wafer.getDopantProfileAtDepth(0.0);
+        const Eigen::ArrayXXd concentration = (surface.size() == temperature.size())
+            ? Eigen::ArrayXXd((surface > 0.0).select(surface, conditions.dopant_concentration))
+            : Eigen::ArrayXXd::Constant(temperature.rows(), temperature.cols(), conditions.dopant_concentration);
+        // calculateDopantEffect, where there is any dopant
+        const Eigen::ArrayXXd factor = (concentration > 0.0).select(
+            1.0 + dopant->second * (concentration.max(1e10).log10() - 16.0), 1.0);
+        A *= factor;
+        B *= factor;
+    }
+    
+    // calculateThickness: positive root of x² + Ax - B(t + τ) = 0
+    Eigen::ArrayXXd thickness =
+        (-A + (A.square() + 4.0 * B * (conditions.time + base.tau)).sqrt()) / 2.0 + conditions.initial_oxide;
+    
+    // calculateOxidationStress is proportional to (T - 25) and to
+    // (1 + 1000 x), so one evaluation gives its coefficient
+    const double stress_coefficient = calculateOxidationStress(0.0, 26.0, conditions.orientation);
+    auto stress = [&](const Eigen::ArrayXXd& x) -> Eigen::ArrayXXd {
+        return stress_coefficient * (temperature - 25.0) * (1.0 + x * 1000.0);
+    };
+    if (enable_stress_effects_) {
+        thickness *= stress(thickness).unaryExpr([this](double s) { return calculateStressEffect(s, 1.0); });
+    }
+    thickness = (thickness < 0.005).select(
+        thickness * thickness.binaryExpr(temperature, [this](double x, double t) {
+            return calculateQuantumEffects(x, t);
+        }),
+        thickness);
+    map.thickness = thickness.max(0.0);
+    map.growth_rate = B / (2.0 * map.thickness + A).max(numerical_precision_);
+    map.stress_level = stress(map.thickness);
+    return map;
+}
+
+ScheduledOxidationResults EnhancedOxidationPhysics::simulateScheduledOxidation(
+    const TemperatureSchedule& schedule,
+    const OxidationConditions& conditions,
+    double tolerance) const {
+    
+    if (schedule.empty()) {
+        throw PhysicsException("Empty temperature schedule");
+    }
+    if (schedule.peak() > 1200.0) {
+        throw PhysicsException("Schedule temperature out of range (above 1200°C)");
+    }
+    if (!(tolerance > 0.0)) {
+        throw PhysicsException("Integration tolerance must be positive");
+    }
+    
+    // Only the temperature changes along the schedule, so every other
+    // factor is taken once at the reference temperature and A and B follow
+    // T(t) through their Arrhenius factors alone
+    OxidationConditions reference = conditions;
+    reference.temperature = 1000.0;
+    reference.time = schedule.duration() / 60.0;
+    std::string error_msg;
+    if (!validateConditions(reference, error_msg)) {
+        throw PhysicsException("Invalid oxidation conditions: " + error_msg);
+    }
+    const DealGroveParameters params = calculateEnhancedParameters(reference);
+    auto linear = [&](double celsius) {
+        return calculateTemperatureDependence(params.A, params.activation_energy_A, celsius);
+    };
+    auto parabolic = [&](double celsius) {
+        return calculateTemperatureDependence(params.B, params.activation_energy_B, celsius);
+    };
+    
+    // Starting from the oxide of x² + Ax = Bτ makes a plateau reproduce the
+    // closed form; the initial oxide is added on top as calculateThickness does
+    const double start = schedule.temperatures().front();
+    AdaptiveOde::Vector grown(1);
+    grown(0) = (-linear(start) + std::sqrt(linear(start) * linear(start) + 4.0 * parabolic(start) * params.tau)) / 2.0;
+    
+    auto rate = [&](double hours, const AdaptiveOde::Vector& x) {
+        const double celsius = schedule.temperature(hours * 60.0);
+        return AdaptiveOde::Vector::Constant(1, parabolic(celsius) / (2.0 * std::max(x(0), 0.0) + linear(celsius)));
+    };
+    std::vector<double> knots;
+    knots.reserve(schedule.times().size());
+    for (double minutes : schedule.times()) {
+        knots.push_back(minutes / 60.0);
+    }
+    AdaptiveOde::Options options;
+    options.relative = tolerance;
+    
+    ScheduledOxidationResults results;
+    grown = AdaptiveOde::integrate(rate, schedule.start() / 60.0, schedule.end() / 60.0, grown, knots, options,
+                                   &results.statistics);
+    
+    const double x = std::max(grown(0), 0.0);
+    results.final_thickness = x + conditions.initial_oxide;
+    results.growth_rate = rate(schedule.end() / 60.0, grown)(0);
+    const double peak = schedule.peak();
+    results.equivalent_time = std::max((x * x + linear(peak) * x) / parabolic(peak) - params.tau, 0.0);
+    return results;
+}
+
+IsolationOxidationResults EnhancedOxidationPhysics::simulateIsolationOxidation(
+    const IsolationProfile& initial,
+    const OxidationConditions& conditions,
+    int vertical_cells) const {
+    
+    SEMIPRO_PERF_TIMER("isolation_oxidation", "EnhancedOxidation");
+    
+    std::string error_msg;
+    if (!validateConditions(conditions, error_msg)) {
+        throw PhysicsException("Invalid oxidation conditions: " + error_msg);
+    }
+    const int nx = static_cast<int>(initial.silicon.size());
+    const int nz = vertical_cells;
+    if (nx < 2 || initial.oxide.size() != nx || static_cast<int>(initial.masked.size()) != nx ||
+        !(initial.spacing > 0.0) || nz < 1 || (initial.oxide < initial.silicon).any()) {
+        throw PhysicsException("Isolation profile needs two or more consistent columns, a positive "
+                               "spacing and oxide on top of the silicon");
+    }
+    const double h = initial.spacing;
+    
+    // Deal-Grove with the oxidant's concentration scaled so C*/N1 = 1: the
+    // flux through the oxide is then its growth rate, D = B/2 and the
+    // interface reacts at B/A, which gives dx/dt = B/(2x + A) in 1D
+    const DealGroveParameters params = calculateEnhancedParameters(conditions);
+    const double diffusivity = params.B / 2.0;      // μm²/h
+    const double reaction = params.B / params.A;    // μm/h
+    const double consumed = calculateSiliconConsumption(1.0);
+    const double min_thickness = 1e-3;              // μm, native oxide
+    
+    // Bound on the growth, from an open column of the thickest oxide
+    const double start = (initial.oxide - initial.silicon).maxCoeff();
+    const double growth = (-params.A + std::sqrt(params.A * params.A +
+        4.0 * (start * start + params.A * start + params.B * (conditions.time + params.tau)))) / 2.0 - start;
+    const double margin = 4.0 * h;
+    LevelSet silicon(initial.silicon.transpose(), h,
+                     initial.silicon.minCoeff() - consumed * growth - margin, initial.silicon.maxCoeff() + margin);
+    LevelSet oxide(initial.oxide.transpose(), h,
+                   initial.oxide.minCoeff() - margin, initial.oxide.maxCoeff() + (1.0 - consumed) * growth + margin);
+    
+    // Cell (j, k) is column j's k-th oxide cell up from the silicon. The
+    // couplings never change which cells they join, so the matrix keeps its
+    // pattern and only the values in it are rewritten each step.
+    const int n = nx * nz;
+    GridStencilMatrix system(nx, nz);
+    auto cell = [&system](int j, int k) { return system.cell(j, k); };
+    Eigen::ArrayXXd lateral(nx - 1, nz), vertical(nx, nz - 1), diagonal(nx, nz);
+    
+    IsolationOxidationResults results;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver;
+    solver.analyzePattern(system.matrix());
+    ++results.analyses;
+    
+    Eigen::ArrayXd silicon_height = initial.silicon;
+    Eigen::ArrayXd oxide_height = initial.oxide;
+    Eigen::VectorXd rhs(n), concentration(n);
+    Eigen::ArrayXd flux(nx), dz(nx);
+    double elapsed = 0.0;
+    while (elapsed < conditions.time) {
+        dz = (oxide_height - silicon_height).max(min_thickness) / nz;
+        
+        rhs.setZero();
+        for (int j = 0; j + 1 < nx; ++j) {
+            lateral.row(j).setConstant(diffusivity * 0.5 * (dz[j] + dz[j + 1]) / h);
+        }
+        for (int j = 0; j < nx; ++j) {
+            vertical.row(j).setConstant(diffusivity * h / dz[j]);
+        }
+        // Reaction through half a cell below the lowest cells, and the
+        // surface held at C* half a cell above the top ones where it is open
+        diagonal.setZero();
+        for (int j = 0; j < nx; ++j) {
+            diagonal(j, 0) += h / (dz[j] / (2.0 * diffusivity) + 1.0 / reaction);
+            if (!initial.masked[j]) {
+                const double source = h * 2.0 * diffusivity / dz[j];
+                diagonal(j, nz - 1) += source;
+                rhs[cell(j, nz - 1)] += source;
+            }
+        }
+        system.assemble(lateral, vertical, diagonal);
+        solver.factorize(system.matrix());
+        ++results.factorizations;
+        if (solver.info() != Eigen::Success) {
+            throw PhysicsException("Oxidant diffusion system could not be factorized");
+        }
+        concentration = solver.solve(rhs);
+        for (int j = 0; j < nx; ++j) {
+            flux[j] = std::max(0.0, concentration[cell(j, 0)]) / (dz[j] / (2.0 * diffusivity) + 1.0 / reaction);
+        }
+        
+        // Steps short enough that no column's oxide grows by more than a
+        // tenth, for the quasi-steady diffusion, or any surface moves more
+        // than half a cell
+        const double fastest = flux.maxCoeff();
+        if (!(fastest > 0.0)) {
+            break;
+        }
+        double dt = std::min(conditions.time - elapsed, 0.5 * h / fastest);
+        for (int j = 0; j < nx; ++j) {
+            if (flux[j] > 0.0) {
+                dt = std::min(dt, 0.1 * dz[j] * nz / flux[j]);
+            }
+        }
+        
+        auto columnFlux = [&flux, nx](const LevelSet::Site& site) {
+            const double position = std::clamp(site.surface.y(), 0.0, nx - 1.0);
+            const int j = std::min(static_cast<int>(position), nx - 2);
+            const double fraction = position - j;
+            return flux[j] + fraction * (flux[j + 1] - flux[j]);
+        };
+        silicon.advance(dt, [&](const LevelSet::Site& site) {
+            return LevelSet::Speed{-consumed * columnFlux(site), 0.0};
+        });
+        oxide.advance(dt, [&](const LevelSet::Site& site) {
+            return LevelSet::Speed{(1.0 - consumed) * columnFlux(site), 0.0};
+        });
+        silicon_height = silicon.heights().row(0).transpose();
+        oxide_height = oxide.heights().row(0).transpose().max(silicon_height);
+        elapsed += dt;
+        ++results.steps;
+    }
+    
+    results.profile = initial;
+    results.profile.silicon = silicon_height;
+    results.profile.oxide = oxide_height;
+    results.thickness = oxide_height - silicon_height;
+    
+    // Farthest masked column from the open field whose oxide grew by a
+    // tenth of what the open field's did
+    const Eigen::ArrayXd grown = results.thickness - (initial.oxide - initial.silicon);
+    double open_growth = 0.0;
+    for (int j = 0; j < nx; ++j) {
+        if (!initial.masked[j]) {
+            open_growth = std::max(open_growth, grown[j]);
+        }
+    }
+    for (int j = 0; j < nx; ++j) {
+        if (!initial.masked[j] || !(grown[j] > 0.1 * open_growth)) {
+            continue;
+        }
+        int distance = nx;
+        for (int k = 0; k < nx; ++k) {
+            if (!initial.masked[k]) {
+                distance = std::min(distance, std::abs(j - k));
+            }
+        }
+        if (distance < nx) {
+            results.encroachment = std::max(results.encroachment, (distance - 0.5) * h);
+        }
+    }
+    return results;
+}
+
 DealGroveParameters EnhancedOxidationPhysics::calculateEnhancedParameters(
     const OxidationConditions& conditions) const {
     
@@ -195,19 +722,86 @@ double EnhancedOxidationPhysics::calculateGrowthRate(
     return params.B / denominator;
 }
 
+template <typename Scalar>
+Scalar EnhancedOxidationPhysics::calculateDifferentiableThickness(
+    const OxidationConditions& conditions,
+    const Scalar& temperature,
+    const Scalar& time,
+    const Scalar& pressure) const {
+    
+    using std::pow;
+    using std::sqrt;
+    
+    // calculateEnhancedParameters
+    auto it = atmosphere_params_.find(conditions.atmosphere);
+    if (it == atmosphere_params_.end()) {
+        throw PhysicsException("Unknown oxidation atmosphere");
+    }
+    const DealGroveParameters& params = it->second;
+    
+    Scalar A = params.A * temperatureFactor(temperature, params.activation_energy_A, 1000.0);
+    Scalar B = params.B * temperatureFactor(temperature, params.activation_energy_B, 1000.0);
+    if (enable_pressure_effects_) {
+        B *= pow(pressure, params.pressure_exponent);
+    }
+    double factor = 1.0;
+    if (enable_orientation_effects_) {
+        factor *= calculateOrientationEffect(conditions.orientation);
+    }
+    if (enable_dopant_effects_ && conditions.dopant_concentration > 0) {
+        factor *= calculateDopantEffect(conditions.dopant_type, conditions.dopant_concentration);
+    }
+    A *= factor;
+    B *= factor;
+    
+    // calculateThickness: the positive root of x² + Ax - B(t + τ) = 0, in
+    // the form that keeps its precision when B(t + τ) is small against A²
+    const Scalar c = B * (time + params.tau);
+    const Scalar discriminant = A * A + 4.0 * c;
+    if (scalarValue(discriminant) < 0) {
+        throw PhysicsException("Negative discriminant in quadratic equation");
+    }
+    Scalar thickness = 2.0 * c / (A + sqrt(discriminant)) + conditions.initial_oxide;
+    
+    if (enable_stress_effects_) {
+        thickness *= stressFactor(oxidationStress(thickness, temperature, conditions.orientation));
+    }
+    if (scalarValue(thickness) < 0.005) {
+        thickness *= calculateQuantumEffects(scalarValue(thickness), scalarValue(temperature));
+    }
+    if (scalarValue(thickness) < 0.0) {
+        thickness *= 0.0;
+    }
+    return thickness;
+}
+
+template double EnhancedOxidationPhysics::calculateDifferentiableThickness<double>(
+    const OxidationConditions&, const double&, const double&, const double&) const;
+template ADScalar EnhancedOxidationPhysics::calculateDifferentiableThickness<ADScalar>(
+    const OxidationConditions&, const ADScalar&, const ADScalar&, const ADScalar&) const;
+
 double EnhancedOxidationPhysics::calculateTemperatureDependence(
     double base_value,
     double activation_energy,
     double temperature,
     double reference_temp) const {
     
+    return base_value * temperatureFactor(temperature, activation_energy, reference_temp);
+}
+
+template <typename Scalar>
+Scalar EnhancedOxidationPhysics::temperatureFactor(
+    const Scalar& temperature,
+    double activation_energy,
+    double reference_temp) const {
+    
+    using std::exp;
+    
     const double k_boltzmann = 8.617e-5; // eV/K
-    double temp_kelvin = temperature + 273.15;
+    const Scalar temp_kelvin = temperature + 273.15;
     double ref_temp_kelvin = reference_temp + 273.15;
     
-    double exponent = -activation_energy * (1.0/temp_kelvin - 1.0/ref_temp_kelvin) / k_boltzmann;
-    
-    return base_value * std::exp(exponent);
+    return Scalar(exp(-activation_energy * (1.0 / temp_kelvin - 1.0 / ref_temp_kelvin) / k_boltzmann));
 }
 
 double EnhancedOxidationPhysics::calculatePressureEffect(
@@ -244,18 +838,27 @@ double EnhancedOxidationPhysics::calculateOxidationStress(
     double temperature,
     CrystalOrientation orientation) const {
     
+    return oxidationStress(oxide_thickness, temperature, orientation);
+}
+
+template <typename Scalar>
+Scalar EnhancedOxidationPhysics::oxidationStress(
+    const Scalar& oxide_thickness,
+    const Scalar& temperature,
+    CrystalOrientation orientation) const {
+    
     // Thermal expansion mismatch stress
     double alpha_si = 2.6e-6;   // Silicon thermal expansion (/K)
     double alpha_sio2 = 0.5e-6; // SiO2 thermal expansion (/K)
     double delta_alpha = alpha_si - alpha_sio2;
     
-    double delta_temp = temperature - 25.0; // Stress-free temperature
+    const Scalar delta_temp = temperature - 25.0; // Stress-free temperature
     
     // Young's modulus and Poisson's ratio for SiO2
     double E_sio2 = 70e9;  // Pa
     double nu_sio2 = 0.17;
     
-    double stress = E_sio2 * delta_alpha * delta_temp / (1.0 - nu_sio2);
+    Scalar stress = E_sio2 * delta_alpha * delta_temp / (1.0 - nu_sio2);
     
     // Thickness dependence
     stress *= (1.0 + oxide_thickness * 1000.0); // Convert μm to nm
@@ -271,9 +874,16 @@ double EnhancedOxidationPhysics::calculateStressEffect(
     double stress_level,
     double base_rate) const {
     
+    return base_rate * stressFactor(stress_level);
+}
+
+template <typename Scalar>
+Scalar EnhancedOxidationPhysics::stressFactor(const Scalar& stress_level) const {
+    using std::abs;
+    
     // Stress enhances oxidation rate (compressive stress)
     double stress_coefficient = 1e-3; // MPa⁻¹
-    return base_rate * (1.0 + stress_coefficient * std::abs(stress_level));
+    return 1.0 + stress_coefficient * abs(stress_level);
 }
 
 OxidationRegime EnhancedOxidationPhysics::classifyRegime(
@@ -331,35 +941,37 @@ double EnhancedOxidationPhysics::calculateSiliconConsumption(
     return oxide_thickness * 0.44;
 }
 
+void EnhancedOxidationPhysics::setAtmosphereParameters(
+    OxidationAtmosphere atmosphere,
+    const DealGroveParameters& params) {
+    
+    if (!(params.A >= 0.0) || !(params.B > 0.0)) {
+        throw PhysicsException("Deal-Grove constants need A >= 0 and B > 0");
+    }
+    atmosphere_params_[atmosphere] = params;
+}
+
+DealGroveParameters EnhancedOxidationPhysics::getAtmosphereParameters(OxidationAtmosphere atmosphere) const {
+    auto it = atmosphere_params_.find(atmosphere);
+    if (it == atmosphere_params_.end()) {
+        throw PhysicsException("Unknown oxidation atmosphere");
+    }
+    return it->second;
+}
+
 void EnhancedOxidationPhysics::initializeDefaultParameters() {
-    // Dry oxidation parameters
-    DealGroveParameters dry_params;
-    dry_params.A = 0.165;                    // μm
-    dry_params.B = 0.0117;                   // μm²/h at 1000°C
-    dry_params.tau = 0.0;                    // h
-    dry_params.activation_energy_A = 2.05;   // eV
-    dry_params.activation_energy_B = 1.23;   // eV
-    dry_params.pressure_exponent = 1.0;
-    atmosphere_params_[OxidationAtmosphere::DRY_O2] = dry_params;
-    
-    // Wet oxidation parameters
-    DealGroveParameters wet_params;
-    wet_params.A = 0.226;                    // μm
-    wet_params.B = 0.51;                     // μm²/h at 1000°C
-    wet_params.tau = 0.0;                    // h
-    wet_params.activation_energy_A = 2.05;   // eV
-    wet_params.activation_energy_B = 0.78;   // eV
-    wet_params.pressure_exponent = 1.0;
-    atmosphere_params_[OxidationAtmosphere::WET_H2O] = wet_params;
-    
-    // Add other atmospheres...
-    atmosphere_params_[OxidationAtmosphere::PYROGENIC] = wet_params; // Similar to wet
+    atmosphere_params_[OxidationAtmosphere::DRY_O2] =
+        dealGroveParameters<AtmosphereKinetics<OxidationAtmosphere::DRY_O2>>();
+    atmosphere_params_[OxidationAtmosphere::WET_H2O] =
+        dealGroveParameters<AtmosphereKinetics<OxidationAtmosphere::WET_H2O>>();
+    atmosphere_params_[OxidationAtmosphere::PYROGENIC] =
+        dealGroveParameters<AtmosphereKinetics<OxidationAtmosphere::PYROGENIC>>();
 }
 
 void EnhancedOxidationPhysics::initializeOrientationFactors() {
-    orientation_factors_[CrystalOrientation::SILICON_100] = 1.0;   // Reference
-    orientation_factors_[CrystalOrientation::SILICON_110] = 1.4;   // Faster oxidation
-    orientation_factors_[CrystalOrientation::SILICON_111] = 0.7;   // Slower oxidation
+    orientation_factors_[CrystalOrientation::SILICON_100] = kOrientationFactor<CrystalOrientation::SILICON_100>;
+    orientation_factors_[CrystalOrientation::SILICON_110] = kOrientationFactor<CrystalOrientation::SILICON_110>;
+    orientation_factors_[CrystalOrientation::SILICON_111] = kOrientationFactor<CrystalOrientation::SILICON_111>;
 }
 
 void EnhancedOxidationPhysics::initializeDopantEffects() {
@@ -433,21 +1045,16 @@ std::vector<double> EnhancedOxidationPhysics::calculateSpatialVariation(
     const OxidationConditions& conditions,
     double base_thickness) {
 
-    auto grid = wafer->getGrid();
-    int rows = grid.rows();
-    int cols = grid.cols();
-
-    std::vector<double> variation(rows * cols, base_thickness);
-
-    // Add small random variations (±2%)
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::normal_distribution<> dis(1.0, 0.02);
+    const OxidationMap map = calculateOxidationMap(*wafer, conditions);
+    const int rows = static_cast<int>(map.thickness.rows());
+    const int cols = static_cast<int>(map.thickness.cols());
+    const double nominal = calculateThickness(calculateEnhancedParameters(conditions), conditions);
+    const double scale = nominal > 0.0 ? base_thickness / nominal : 0.0;
 
+    std::vector<double> variation(static_cast<size_t>(rows) * cols);
     for (int i = 0; i < rows; ++i) {
         for (int j = 0; j < cols; ++j) {
-            int index = i * cols + j;
-            variation[index] = base_thickness * dis(gen);
+            variation[static_cast<size_t>(i) * cols + j] = map.thickness(i, j) * scale;
         }
     }
 
@@ -470,6 +1077,17 @@ std::unordered_map<std::string, double> EnhancedOxidationPhysics::analyzeOxideQu
     // Growth rate stability
     quality["growth_rate"] = results.growth_rate;
 
+    // Half the thickness range over the mean, in percent
+    if (!results.thickness_profile.empty()) {
+        const auto range = std::minmax_element(results.thickness_profile.begin(), results.thickness_profile.end());
+        double mean = 0.0;
+        for (double thickness : results.thickness_profile) {
+            mean += thickness;
+        }
+        mean /= results.thickness_profile.size();
+        quality["thickness_nonuniformity"] = mean > 0.0 ? 50.0 * (*range.second - *range.first) / mean : 0.0;
+    }
+
     // Overall quality score (0-100)
     double quality_score = 100.0 - (uniformity * 50.0 + std::abs(results.stress_level) * 0.01);
     quality["overall_score"] = std::max(0.0, std::min(100.0, quality_score));
@@ -4,11 +4,19 @@
 #include "../core/enhanced_error_handling.hpp"
 #include "../core/config_manager.hpp"
 #include "../core/wafer_enhanced.hpp"
+#include "../core/arrhenius_table.hpp"
+#include "../core/level_set.hpp"
+#include "../core/adaptive_ode.hpp"
+#include "../core/batch_groups.hpp"
+#include "../core/kernel_status.hpp"
+#include "../core/temperature_schedule.hpp"
+#include "../core/autodiff.hpp"
 #include <memory>
 #include <vector>
 #include <unordered_map>
 #include <functional>
 #include <cmath>
+#include <cstdint>
 
 namespace SemiPRO {
 
@@ -92,6 +100,69 @@ struct OxidationResults {
                         consumed_silicon(0.0), regime(OxidationRegime::THIN_OXIDE) {}
 };
 
+// Oxide grown at every cell of a wafer's grid
+struct OxidationMap {
+    Eigen::ArrayXXd thickness;     // μm
+    Eigen::ArrayXXd growth_rate;   // μm/h at the end of the step
+    Eigen::ArrayXXd stress_level;  // MPa
+};
+
+// Oxide grown through a whole thermal cycle, ramps included
+struct ScheduledOxidationResults {
+    double final_thickness = 0.0;   // μm
+    double growth_rate = 0.0;       // μm/h at the schedule's end
+    double equivalent_time = 0.0;   // h at the peak temperature growing the same oxide
+    AdaptiveOde::Statistics statistics;
+};
+
+// Cross-section of a wafer for LOCOS or STI oxidation, one entry per
+// column across it: the silicon's surface, the top of the oxide over it
+// and whether nitride masks the column
+struct IsolationProfile {
+    Eigen::ArrayXd silicon;   // μm
+    Eigen::ArrayXd oxide;     // μm, at or above silicon
+    std::vector<bool> masked;
+    double spacing = 0.01;    // μm between columns
+};
+
+struct IsolationOxidationResults {
+    IsolationProfile profile;
+    Eigen::ArrayXd thickness;   // μm of oxide per column
+    double encroachment = 0.0;  // μm the bird's beak reaches under the mask
+    int steps = 0;
+    int factorizations = 0;     // Numeric, one per step
+    int analyses = 0;           // Symbolic, one per run
+};
+
+// Conditions for oxidizing many wafers at once, one column entry per
+// wafer. Orientation and initial oxide are shared; dopant effects do not
+// apply in batches.
+struct OxidationBatch {
+    Eigen::ArrayXd temperature;   // °C
+    Eigen::ArrayXd time;          // h
+    Eigen::ArrayXd pressure;      // atm
+    std::vector<OxidationAtmosphere> atmosphere;
+    CrystalOrientation orientation = CrystalOrientation::SILICON_100;
+    double initial_oxide = 0.0;   // μm
+    // Random stream of each entry's spatial variation (Reproducibility::key
+    // of its wafer's step); drawn per call when missing
+    std::vector<std::uint64_t> noise_keys;
+
+    explicit OxidationBatch(size_t n = 0)
+        : temperature(Eigen::ArrayXd::Constant(n, 1000.0)), time(Eigen::ArrayXd::Ones(n)),
+          pressure(Eigen::ArrayXd::Ones(n)), atmosphere(n, OxidationAtmosphere::DRY_O2) {}
+    size_t size() const { return atmosphere.size(); }
+};
+
+struct OxidationBatchResults {
+    Eigen::ArrayXd final_thickness;  // μm, 0 where invalid
+    Eigen::ArrayXd growth_rate;      // μm/h
+    Eigen::ArrayXd stress_level;     // MPa
+    std::vector<KernelStatus> status; // Ok where the conditions passed validateConditions
+
+    bool ok(size_t i) const { return status[i] == KernelStatus::Ok; }
+};
+
 // Enhanced oxidation physics engine
 class EnhancedOxidationPhysics {
 private:
@@ -115,6 +186,63 @@ public:
         const OxidationConditions& conditions
     );
     
+    // Deal-Grove for every batch entry; gives the thickness, growth rate and
+    // stress of simulateOxidation for the same conditions. Entries are
+    // grouped by atmosphere and each group runs a kernel specialized for
+    // its atmosphere and the batch's orientation, so the loops over it
+    // carry no table lookups or branches on either.
+    OxidationBatchResults calculateBatch(const OxidationBatch& batch) const;
+
+    // Grows each wafer's entry, with the spatial variation of
+    // simulateOxidation, on wafers whose entry is Ok
+    OxidationBatchResults simulateOxidationBatch(
+        const std::vector<std::shared_ptr<WaferEnhanced>>& wafers,
+        const OxidationBatch& batch
+    );
+    
+    // Deal-Grove in closed form at every grid cell at once, each cell at
+    // its own temperature and surface dopant concentration: the wafer's
+    // temperature field sets how far each cell runs above or below the
+    // furnace's conditions.temperature, and the first layer's composition,
+    // where set, replaces conditions.dopant_concentration. Arrhenius factors
+    // are tabulated once over the map's temperature range. Throws
+    // PhysicsException for invalid conditions or a cell outside 600-1200°C.
+    OxidationMap calculateOxidationMap(
+        const WaferEnhanced& wafer,
+        const OxidationConditions& conditions
+    ) const;
+    
+    // Deal-Grove through a temperature schedule (minutes, °C) in place of
+    // conditions.temperature and conditions.time: dx/dt = B(T)/(2x + A(T))
+    // is integrated adaptively to the relative tolerance, breaking at each
+    // knot, so a plateau takes a dozen steps however long it is and only
+    // the ramps cost more. On a plateau it gives the root of
+    // x² + Ax = B(t + τ) plus the initial oxide; calculateThickness's stress
+    // and quantum corrections are not applied. Throws PhysicsException for
+    // invalid conditions, an empty schedule or one peaking above 1200°C;
+    // growth below 600°C is slow, not invalid.
+    ScheduledOxidationResults simulateScheduledOxidation(
+        const TemperatureSchedule& schedule,
+        const OxidationConditions& conditions,
+        double tolerance = 1e-6
+    ) const;
+    
+    // Oxidizes a cross-section for conditions.time in two dimensions:
+    // oxidant diffuses through the oxide, across as well as down, from the
+    // unmasked surface to react at the silicon, so it reaches in under the
+    // nitride's edges and grows a bird's beak. The oxide is split into
+    // vertical_cells cells per column that stretch with its thickness, so
+    // the sparse system keeps one structure: it is analysed once and only
+    // refactorized each step. The silicon surface and the oxide's top move
+    // as level sets, by the silicon consumed and the oxide's expansion.
+    // With nothing masked every column follows Deal-Grove. Throws
+    // PhysicsException for invalid conditions or an inconsistent profile.
+    IsolationOxidationResults simulateIsolationOxidation(
+        const IsolationProfile& initial,
+        const OxidationConditions& conditions,
+        int vertical_cells = 8
+    ) const;
+    
     // Advanced physics calculations
     DealGroveParameters calculateEnhancedParameters(
         const OxidationConditions& conditions
@@ -131,6 +259,20 @@ public:
         double current_thickness
     ) const;
     
+    // calculateThickness(calculateEnhancedParameters(conditions), conditions)
+    // with the temperature (°C), time (h) and pressure (atm) of any scalar
+    // type: with ADScalar inputs seeded as variables the thickness (μm)
+    // carries its derivatives with respect to them. The ultra-thin quantum
+    // correction enters as a constant factor. Instantiated for double and
+    // ADScalar.
+    template <typename Scalar>
+    Scalar calculateDifferentiableThickness(
+        const OxidationConditions& conditions,
+        const Scalar& temperature,
+        const Scalar& time,
+        const Scalar& pressure
+    ) const;
+    
     // Environmental effects
     double calculateTemperatureDependence(
         double base_value,
@@ -196,7 +338,9 @@ public:
         const OxidationConditions& conditions
     ) const;
     
-    // Spatial variation modeling
+    // Spatial variation modeling: calculateOxidationMap's thickness by
+    // rows, scaled so that a wafer uniform at the conditions gives
+    // base_thickness everywhere
     std::vector<double> calculateSpatialVariation(
         std::shared_ptr<WaferEnhanced> wafer,
         const OxidationConditions& conditions,
@@ -204,10 +348,14 @@ public:
     );
     
     // Configuration and calibration
+    // Deal-Grove constants of an atmosphere at the 1000 °C reference, used
+    // by the per-wafer models; the batched kernels keep the built-in ones.
+    // Throws PhysicsException for a negative A or a non-positive B.
     void setAtmosphereParameters(
         OxidationAtmosphere atmosphere,
         const DealGroveParameters& params
     );
+    DealGroveParameters getAtmosphereParameters(OxidationAtmosphere atmosphere) const;
     
     void setOrientationFactor(
         CrystalOrientation orientation,
@@ -247,6 +395,26 @@ private:
     void initializeOrientationFactors();
     void initializeDopantEffects();
     
+    // calculateBatch on the size entries of one atmosphere from begin, with
+    // its Deal-Grove constants and the orientation's factor compiled in
+    template <OxidationAtmosphere Atmosphere, CrystalOrientation Orientation>
+    void calculateBatchGroup(
+        const OxidationBatch& batch,
+        Eigen::Index begin,
+        Eigen::Index size,
+        OxidationBatchResults& results
+    ) const;
+    
+    // Scalar-generic bodies of calculateTemperatureDependence (base value 1),
+    // calculateOxidationStress and calculateStressEffect (base rate 1)
+    template <typename Scalar>
+    Scalar temperatureFactor(const Scalar& temperature, double activation_energy, double reference_temp) const;
+    template <typename Scalar>
+    Scalar oxidationStress(const Scalar& oxide_thickness, const Scalar& temperature,
+                           CrystalOrientation orientation) const;
+    template <typename Scalar>
+    Scalar stressFactor(const Scalar& stress_level) const;
+    
     // Numerical methods
     double solveQuadraticEquation(
         double a, double b, double c,
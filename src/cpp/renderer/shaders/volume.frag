@@ -0,0 +1,68 @@
+#version 450
+// Author: Dr. Mazharuddin Mohammed
+// Ray marches the field volume front to back through the transfer
+// function, stepping over bricks the occupancy map marks empty and
+// stopping once the ray is nearly opaque
+
+layout(binding = 0) uniform sampler3D volume;     // Normalized to the volume's range
+layout(binding = 1) uniform usampler3D occupancy; // One texel per BRICK^3 cells
+layout(binding = 2) uniform sampler1D transfer;
+
+layout(push_constant) uniform VolumeRenderParams {
+  vec4 eye;
+  vec4 right;
+  vec4 up;
+  vec4 forward;
+  vec4 extent;
+  float valueScale;
+  float valueOffset;
+  float density;
+} params;
+
+layout(location = 0) in vec2 ndc;
+
+layout(location = 0) out vec4 outColor;
+
+const int BRICK = 8;
+const float STEP = 0.5;     // Cells per sample
+const float OPAQUE = 0.99;
+
+void main() {
+  // March in cell units, so t counts cells along the ray
+  vec3 dims = vec3(textureSize(volume, 0));
+  vec3 toCells = dims / params.extent.xyz;
+  vec3 origin = params.eye.xyz * toCells;
+  vec3 dir = normalize((params.forward.xyz + ndc.x * params.right.xyz - ndc.y * params.up.xyz) * toCells);
+  vec3 safe = mix(dir, vec3(1e-8), lessThan(abs(dir), vec3(1e-8)));
+  vec3 inv = 1.0 / safe;
+
+  vec3 near = min(-origin * inv, (dims - origin) * inv);
+  vec3 far = max(-origin * inv, (dims - origin) * inv);
+  float t = max(max(near.x, near.y), max(near.z, 0.0));
+  float tEnd = min(min(far.x, far.y), far.z);
+
+  ivec3 bricks = textureSize(occupancy, 0);
+  float entries = float(textureSize(transfer, 0));
+  vec4 color = vec4(0.0);
+  while (t < tEnd && color.a < OPAQUE) {
+    vec3 cell = origin + dir * t;
+    ivec3 brick = clamp(ivec3(cell) / BRICK, ivec3(0), bricks - 1);
+    if (texelFetch(occupancy, brick, 0).r == 0u) {
+      // To where the ray leaves the brick, on the same lattice of samples
+      vec3 low = vec3(brick * BRICK);
+      vec3 high = min(low + float(BRICK), dims);
+      vec3 leave = max((low - origin) * inv, (high - origin) * inv);
+      float tLeave = min(min(leave.x, leave.y), leave.z);
+      t += max(ceil((tLeave - t) / STEP), 1.0) * STEP;
+      continue;
+    }
+    float value = clamp(texture(volume, cell / dims).r * params.valueScale + params.valueOffset, 0.0, 1.0);
+    vec4 sampleColor = texture(transfer, (value * (entries - 1.0) + 0.5) / entries);
+    // The table's opacity is per cell; a sample covers STEP cells
+    float alpha = 1.0 - pow(max(1.0 - sampleColor.a, 0.0), params.density * STEP);
+    color.rgb += (1.0 - color.a) * alpha * sampleColor.rgb;
+    color.a += (1.0 - color.a) * alpha;
+    t += STEP;
+  }
+  outColor = vec4(color.rgb, 1.0);
+}
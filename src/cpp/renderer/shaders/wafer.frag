@@ -1,7 +1,122 @@
 #version 450
-layout(location = 0) in vec3 fragColor;
+// Author: Dr. Mazharuddin Mohammed
+// Colormaps one wafer field cell per fragment from the field texture
+
+layout(binding = 0) uniform sampler2DArray fields;
+layout(std430, binding = 1) readonly buffer DopantProfile { float dopant[]; };
+layout(std430, binding = 2) readonly buffer WireBonds { ivec4 bonds[]; };
+
+layout(push_constant) uniform FieldRenderParams {
+  int rows;
+  int cols;
+  int mode;
+  int overlay;
+  int material;
+  int flags;
+  int dopantCount;
+  int bondCount;
+  float resistanceTint;
+  float relief;
+  float viewRow;
+  float viewCol;
+  float zoom;
+} params;
+
+layout(location = 0) in vec2 fragUV;
+
 layout(location = 0) out vec4 outColor;
 
+// Field texture layers
+const int GRID = 0;
+const int PHOTORESIST = 1;
+const int TEMPERATURE = 2;
+const int MTTF = 3;
+const int STRESS = 4;
+const int DIELECTRIC = 5;
+
+// VulkanRenderer::RenderingMode values with a colormap of their own
+const int TEMPERATURE_FIELD_MODE = 3;
+const int DOPANT_DISTRIBUTION_MODE = 4;
+const int STRESS_ANALYSIS_MODE = 5;
+
+const int PACKAGING_FLAG = 1;
+const int METAL_FLAG = 2;
+const int FILM_FLAG = 4;
+const int TEMPERATURE_OVERLAY_FLAG = 8;
+
+const float T_MIN = 300.0;        // K
+const float T_RANGE = 100.0;      // K
+const float MTTF_THRESHOLD = 3.15e8; // 10 years in seconds
+const float STRESS_MAX = 500.0;   // MPa
+const float E_BD = 1e7;           // Breakdown field (V/cm) for SiO2
+
+float field(ivec2 cell, int layer) {
+  return texelFetch(fields, ivec3(cell, layer), 0).r;
+}
+
+vec3 ramp(float t) {
+  t = clamp(t, 0.0, 1.0);
+  return vec3(t, 0.0, 1.0 - t); // Blue to red
+}
+
+vec3 cellColor(ivec2 cell) {
+  float doping = cell.x < params.dopantCount ? dopant[cell.x] : 0.0;
+  if (params.mode == TEMPERATURE_FIELD_MODE) {
+    return ramp((field(cell, TEMPERATURE) - T_MIN) / T_RANGE);
+  }
+  if (params.mode == DOPANT_DISTRIBUTION_MODE) {
+    return ramp(doping);
+  }
+  if (params.mode == STRESS_ANALYSIS_MODE) {
+    return ramp(field(cell, STRESS) / STRESS_MAX);
+  }
+
+  for (int b = 0; b < params.bondCount; ++b) {
+    if (bonds[b].xy == cell || bonds[b].zw == cell) {
+      return vec3(1.0, 0.84, 0.0); // Gold for wire bonds
+    }
+  }
+  if (params.overlay == 1) {
+    float mttf = field(cell, MTTF);
+    if (mttf > 0.0 && mttf < MTTF_THRESHOLD) {
+      return vec3(min(1.0, MTTF_THRESHOLD / mttf), 0.0, 0.0); // Red for low MTTF
+    }
+  } else if (params.overlay == 2) {
+    float stress = field(cell, STRESS);
+    if (stress > 0.0) {
+      return ramp(stress / STRESS_MAX);
+    }
+  } else if (params.overlay == 3) {
+    if (field(cell, DIELECTRIC) > 0.9 * E_BD) {
+      return vec3(1.0, 1.0, 0.0); // Yellow for breakdown risk
+    }
+  }
+  float temperature = field(cell, TEMPERATURE);
+  if ((params.flags & TEMPERATURE_OVERLAY_FLAG) != 0 && temperature > T_MIN) {
+    return ramp((temperature - T_MIN) / T_RANGE);
+  }
+  if (field(cell, GRID) < 0.0) {
+    return vec3(0.5); // Gray for etched
+  }
+  if ((params.flags & PACKAGING_FLAG) != 0) {
+    return vec3(0.6, 0.4, 0.2); // Brown for substrate
+  }
+  if ((params.flags & METAL_FLAG) != 0) {
+    float t = params.resistanceTint;
+    return vec3(0.8 * (1.0 - t) + t, 0.8, 0.8); // Silver with a red tint for resistance
+  }
+  if ((params.flags & FILM_FLAG) != 0) {
+    return vec3(0.0, 0.0, 1.0); // Blue for dielectric
+  }
+  if (field(cell, PHOTORESIST) > 0.5) {
+    return vec3(1.0); // White for photoresist
+  }
+  // Red for silicon, green for oxide, blue for doping
+  vec3 base = params.material == 1 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+  return vec3(base.rg * (1.0 - doping), doping);
+}
+
 void main() {
-  outColor = vec4(fragColor, 1.0);
-}
\ No newline at end of file
+  ivec2 cell = min(ivec2(fragUV * vec2(params.rows, params.cols)), ivec2(params.rows - 1, params.cols - 1));
+  outColor = vec4(cellColor(cell), 1.0);
+}
@@ -1,10 +1,52 @@
 #version 450
-layout(location = 0) in vec2 inPosition;
-layout(location = 1) in vec3 inColor;
+// Author: Dr. Mazharuddin Mohammed
+// Wafer patch vertex: one quadtree tile instance, displaced by the height
+// layer of the field texture or, for coarse tiles, the height pyramid
 
-layout(location = 0) out vec3 fragColor;
+layout(binding = 0) uniform sampler2DArray fields;
+layout(binding = 3) uniform sampler2D heightPyramid;
+
+layout(push_constant) uniform FieldRenderParams {
+  int rows;
+  int cols;
+  int mode;
+  int overlay;
+  int material;
+  int flags;
+  int dopantCount;
+  int bondCount;
+  float resistanceTint;
+  float relief;
+  float viewRow;
+  float viewCol;
+  float zoom;
+} params;
+
+layout(location = 0) in vec2 inPatch;
+// Tile origin (row, col), size and level, in wafer coordinates
+layout(location = 1) in vec4 inTile;
+
+layout(location = 0) out vec2 fragUV;
 
 void main() {
-  gl_Position = vec4(inPosition, 0.0, 1.0);
-  fragColor = inColor;
-}
\ No newline at end of file
+  vec2 uv = inTile.xy + inPatch * inTile.z;
+  int level = int(inTile.w);
+  ivec2 cell = min(ivec2(uv * vec2(params.rows, params.cols)), ivec2(params.rows - 1, params.cols - 1));
+  float height;
+  if (level == 0) {
+    height = texelFetch(fields, ivec3(cell, 0), 0).r;
+  } else {
+    // Pyramid level k - 1 spans 2^k x 2^k cells; a coarse tile takes their
+    // maximum so features never sink below the surface
+    ivec2 size = textureSize(heightPyramid, level - 1);
+    height = texelFetch(heightPyramid, min(cell >> level, size - 1), level - 1).g;
+  }
+  // The top of the pyramid holds the whole field's range
+  vec2 range = texelFetch(heightPyramid, ivec2(0), textureQueryLevels(heightPyramid) - 1).rg;
+  height = range.y > range.x ? (height - range.x) / (range.y - range.x) : 0.0;
+
+  // Columns run along x and rows along y; relief tilts the height into y
+  vec2 view = (uv - vec2(params.viewRow, params.viewCol)) * 2.0 * params.zoom;
+  gl_Position = vec4(view.y, view.x - params.relief * height, 0.0, 1.0);
+  fragUV = uv;
+}
@@ -0,0 +1,617 @@
+// Author: Dr. Mazharuddin Mohammed
+#include "vulkan_compute.hpp"
+#include "../core/utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#ifndef SEMIPRO_SHADER_DIR
+#define SEMIPRO_SHADER_DIR "shaders"
+#endif
+
+namespace {
+
+// Below these the transfers cost more than the CPU kernels
+constexpr std::size_t kMinimumPoints = std::size_t(1) << 16;
+constexpr long kMinimumIons = 1L << 20;
+
+// Workgroup sizes of the shaders
+constexpr uint32_t kFftGroupSize = 64;
+constexpr uint32_t kGridGroupSize = 16;
+constexpr uint32_t kImplantGroupSize = 256;
+// Ion pairs per implant dispatch, so no 32-bit device count can overflow
+constexpr uint64_t kMaxImplantPairs = uint64_t(1) << 24;
+
+// Descriptor sets of one call: the two directions of a ping-pong
+constexpr uint32_t kCallSets = 2;
+constexpr uint32_t kMaxBindings = 5;
+
+const char* const kKernelNames[] = {"FFT", "explicit diffusion", "red-black smoother", "implant depths"};
+
+// Push constants, laid out as the shaders declare them
+struct FftStageParams {
+    double scale;
+    int32_t n;
+    int32_t count;
+    int32_t stride;
+    int32_t batch_stride;
+    int32_t p;
+    int32_t twiddle_offset;
+    int32_t inverse;
+    int32_t pad;
+};
+static_assert(sizeof(FftStageParams) == 40, "fft_stage.comp push constants");
+
+struct DiffusionParams {
+    double ratio;
+    int32_t rows;
+    int32_t cols;
+};
+static_assert(sizeof(DiffusionParams) == 16, "ftcs_diffusion.comp push constants");
+
+struct SweepParams {
+    int32_t rows;
+    int32_t cols;
+    int32_t colour;
+    int32_t pad;
+};
+
+struct ImplantParams {
+    double mean;
+    double stdev;
+    double bin_width;
+    uint32_t key0;
+    uint32_t key1;
+    uint32_t stream0;
+    uint32_t stream1;
+    uint32_t first_pair0;
+    uint32_t first_pair1;
+    uint32_t ions;
+    uint32_t bins;
+};
+static_assert(sizeof(ImplantParams) == 56, "implant_depths.comp push constants");
+
+const vk::PipelineStageFlags kDeviceStages = vk::PipelineStageFlagBits::eComputeShader |
+                                             vk::PipelineStageFlagBits::eTransfer;
+
+// Orders a dispatch or copy after the previous ones' writes
+void deviceBarrier(vk::CommandBuffer command_buffer) {
+    vk::MemoryBarrier barrier(vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+                              vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite |
+                                  vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+    command_buffer.pipelineBarrier(kDeviceStages, kDeviceStages, {}, barrier, nullptr, nullptr);
+}
+
+// Makes the final readback visible to the host
+void hostBarrier(vk::CommandBuffer command_buffer) {
+    vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+                                   barrier, nullptr, nullptr);
+}
+
+uint32_t groups(uint64_t threads, uint32_t group_size) {
+    return static_cast<uint32_t>((threads + group_size - 1) / group_size);
+}
+
+bool isPowerOfTwo(int n) { return n > 0 && (n & (n - 1)) == 0; }
+
+} // namespace
+
+// The coefficients of one multigrid level, resident for the smoother's
+// lifetime; each call uploads u (and f, when given) and reads u back
+class VulkanCompute::RedBlackSmoother : public GpuCompute::Smoother {
+public:
+    RedBlackSmoother(std::shared_ptr<VulkanCompute> owner, Eigen::Index rows, Eigen::Index cols)
+        : owner_(std::move(owner)), rows_(rows), cols_(cols) {}
+
+    ~RedBlackSmoother() override {
+        std::lock_guard<std::mutex> lock(owner_->mutex_);
+        for (Buffer& buffer : buffers_) owner_->destroyBuffer(buffer);
+        owner_->device_.destroyDescriptorPool(pool_);
+    }
+
+    // The caller holds the owner's lock
+    void upload(const Eigen::ArrayXXd& west, const Eigen::ArrayXXd& north, const Eigen::ArrayXXd& inverse_diagonal) {
+        const vk::DeviceSize bytes = gridBytes();
+        for (Buffer& buffer : buffers_) owner_->reserve(buffer, bytes);
+        char* host = static_cast<char*>(owner_->staging(3 * bytes));
+        std::memcpy(host, west.data(), bytes);
+        std::memcpy(host + bytes, north.data(), bytes);
+        std::memcpy(host + 2 * bytes, inverse_diagonal.data(), bytes);
+        vk::DescriptorPoolSize pool_size(vk::DescriptorType::eStorageBuffer, kBuffers);
+        pool_ = owner_->device_.createDescriptorPool(vk::DescriptorPoolCreateInfo({}, 1, 1, &pool_size));
+        set_ = owner_->bind(kRedBlack, pool_,
+                            {buffers_[kU].buffer, buffers_[kF].buffer, buffers_[kWest].buffer,
+                             buffers_[kNorth].buffer, buffers_[kInverseDiagonal].buffer});
+        owner_->submit([&](vk::CommandBuffer command_buffer) {
+            const vk::Buffer staging = owner_->staging_.buffer;
+            command_buffer.copyBuffer(staging, buffers_[kWest].buffer, vk::BufferCopy(0, 0, bytes));
+            command_buffer.copyBuffer(staging, buffers_[kNorth].buffer, vk::BufferCopy(bytes, 0, bytes));
+            command_buffer.copyBuffer(staging, buffers_[kInverseDiagonal].buffer, vk::BufferCopy(2 * bytes, 0, bytes));
+        });
+    }
+
+    bool smooth(Eigen::ArrayXXd& u, const Eigen::ArrayXXd* source, int sweeps, bool reverse) override {
+        if (u.rows() != rows_ + 2 || u.cols() != cols_ + 2 ||
+            (source && (source->rows() != u.rows() || source->cols() != u.cols()))) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(owner_->mutex_);
+        if (!owner_->usable(kRedBlack) || (!source && !has_source_)) {
+            return false;
+        }
+        try {
+            const vk::DeviceSize bytes = gridBytes();
+            char* host = static_cast<char*>(owner_->staging(2 * bytes));
+            std::memcpy(host, u.data(), bytes);
+            if (source) {
+                std::memcpy(host + bytes, source->data(), bytes);
+            }
+            const Kernel& kernel = owner_->kernels_[kRedBlack];
+            SweepParams params{static_cast<int32_t>(rows_), static_cast<int32_t>(cols_), 0, 0};
+            const int first = reverse ? 1 : 0;
+            owner_->submit([&](vk::CommandBuffer command_buffer) {
+                const vk::Buffer staging = owner_->staging_.buffer;
+                command_buffer.copyBuffer(staging, buffers_[kU].buffer, vk::BufferCopy(0, 0, bytes));
+                if (source) {
+                    command_buffer.copyBuffer(staging, buffers_[kF].buffer, vk::BufferCopy(bytes, 0, bytes));
+                }
+                command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernel.pipeline);
+                command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, kernel.layout, 0, set_, nullptr);
+                for (int s = 0; s < sweeps; ++s) {
+                    for (int colour : {first, 1 - first}) {
+                        deviceBarrier(command_buffer);
+                        params.colour = colour;
+                        command_buffer.pushConstants(kernel.layout, vk::ShaderStageFlagBits::eCompute, 0,
+                                                     sizeof(params), &params);
+                        command_buffer.dispatch(groups((rows_ + 1) / 2, kGridGroupSize),
+                                                groups(cols_, kGridGroupSize), 1);
+                    }
+                }
+                deviceBarrier(command_buffer);
+                command_buffer.copyBuffer(buffers_[kU].buffer, staging, vk::BufferCopy(0, 0, bytes));
+                hostBarrier(command_buffer);
+            });
+            std::memcpy(u.data(), host, bytes);
+            has_source_ = has_source_ || source;
+            return true;
+        } catch (const std::exception& e) {
+            owner_->fail(kRedBlack, e.what());
+            return false;
+        }
+    }
+
+private:
+    enum { kU, kF, kWest, kNorth, kInverseDiagonal, kBuffers };
+
+    vk::DeviceSize gridBytes() const {
+        return static_cast<vk::DeviceSize>((rows_ + 2) * (cols_ + 2)) * sizeof(double);
+    }
+
+    std::shared_ptr<VulkanCompute> owner_;
+    Eigen::Index rows_;
+    Eigen::Index cols_;
+    Buffer buffers_[kBuffers];
+    vk::DescriptorPool pool_;
+    vk::DescriptorSet set_;
+    bool has_source_ = false;
+};
+
+std::shared_ptr<VulkanCompute> VulkanCompute::shared() {
+    static std::mutex mutex;
+    static std::shared_ptr<VulkanCompute> compute;
+    static bool opened = false;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!opened) {
+        opened = true;
+        std::shared_ptr<VulkanCompute> candidate(new VulkanCompute());
+        try {
+            if (candidate->open()) {
+                compute = std::move(candidate);
+            }
+        } catch (const std::exception& e) {
+            Logger::getInstance().log(std::string("Vulkan compute unavailable: ") + e.what());
+        }
+    }
+    return compute;
+}
+
+VulkanCompute::~VulkanCompute() {
+    if (device_) {
+        device_.waitIdle();
+        destroyBuffer(staging_);
+        destroyBuffer(ping_);
+        destroyBuffer(pong_);
+        destroyBuffer(twiddles_);
+        for (Kernel& kernel : kernels_) {
+            device_.destroyPipeline(kernel.pipeline);
+            device_.destroyPipelineLayout(kernel.layout);
+            device_.destroyDescriptorSetLayout(kernel.set_layout);
+            device_.destroyShaderModule(kernel.shader);
+        }
+        device_.destroyDescriptorPool(descriptor_pool_);
+        device_.destroyFence(fence_);
+        device_.destroyCommandPool(command_pool_);
+        device_.destroy();
+    }
+    if (instance_) instance_.destroy();
+}
+
+bool VulkanCompute::open() {
+    vk::ApplicationInfo app_info("Semiconductor Simulator", 1, "Simulator Engine", 1, VK_API_VERSION_1_0);
+    instance_ = vk::createInstance(vk::InstanceCreateInfo({}, &app_info));
+    // The first device with double-precision shaders and a compute queue
+    for (vk::PhysicalDevice candidate : instance_.enumeratePhysicalDevices()) {
+        if (!candidate.getFeatures().shaderFloat64) {
+            continue;
+        }
+        auto queue_props = candidate.getQueueFamilyProperties();
+        for (size_t i = 0; i < queue_props.size(); ++i) {
+            if (queue_props[i].queueFlags & vk::QueueFlagBits::eCompute) {
+                physical_device_ = candidate;
+                queue_family_index_ = static_cast<uint32_t>(i);
+                break;
+            }
+        }
+        if (physical_device_) {
+            break;
+        }
+    }
+    if (!physical_device_) {
+        return false;
+    }
+
+    float queue_priority = 1.0f;
+    vk::DeviceQueueCreateInfo queue_info({}, queue_family_index_, 1, &queue_priority);
+    vk::PhysicalDeviceFeatures features;
+    features.shaderFloat64 = true;
+    device_ = physical_device_.createDevice(vk::DeviceCreateInfo({}, 1, &queue_info, 0, nullptr, 0, nullptr, &features));
+    queue_ = device_.getQueue(queue_family_index_, 0);
+    const vk::PhysicalDeviceProperties properties = physical_device_.getProperties();
+    device_name_ = static_cast<const char*>(properties.deviceName);
+    for (int axis = 0; axis < 3; ++axis) {
+        max_group_count_[axis] = properties.limits.maxComputeWorkGroupCount[axis];
+    }
+
+    command_pool_ = device_.createCommandPool({vk::CommandPoolCreateFlagBits::eTransient, queue_family_index_});
+    fence_ = device_.createFence({});
+    vk::DescriptorPoolSize pool_size(vk::DescriptorType::eStorageBuffer, kCallSets * kMaxBindings);
+    descriptor_pool_ = device_.createDescriptorPool(vk::DescriptorPoolCreateInfo({}, kCallSets, 1, &pool_size));
+
+    createKernel(kFftStage, "fft_stage.comp.spv", 3, sizeof(FftStageParams));
+    createKernel(kDiffusion, "ftcs_diffusion.comp.spv", 2, sizeof(DiffusionParams));
+    createKernel(kRedBlack, "red_black.comp.spv", 5, sizeof(SweepParams));
+    createKernel(kImplantDepths, "implant_depths.comp.spv", 1, sizeof(ImplantParams));
+    return true;
+}
+
+void VulkanCompute::createKernel(KernelId id, const std::string& shader, uint32_t buffers, uint32_t push_bytes) {
+    // SPIR-V compiled from the shaders/ directory at build time
+    const std::string path = std::string(SEMIPRO_SHADER_DIR) + "/" + shader;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        fail(id, "failed to open shader " + path);
+        return;
+    }
+    std::vector<uint32_t> code(static_cast<size_t>(file.tellg()) / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+
+    Kernel& kernel = kernels_[id];
+    try {
+        kernel.shader = device_.createShaderModule(
+            vk::ShaderModuleCreateInfo({}, code.size() * sizeof(uint32_t), code.data()));
+        std::vector<vk::DescriptorSetLayoutBinding> bindings;
+        for (uint32_t binding = 0; binding < buffers; ++binding) {
+            bindings.emplace_back(binding, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute);
+        }
+        kernel.set_layout = device_.createDescriptorSetLayout(
+            vk::DescriptorSetLayoutCreateInfo({}, static_cast<uint32_t>(bindings.size()), bindings.data()));
+        vk::PushConstantRange range(vk::ShaderStageFlagBits::eCompute, 0, push_bytes);
+        kernel.layout = device_.createPipelineLayout(vk::PipelineLayoutCreateInfo({}, 1, &kernel.set_layout, 1, &range));
+        vk::ComputePipelineCreateInfo compute_info(
+            {}, vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, kernel.shader, "main"),
+            kernel.layout);
+        auto compute = device_.createComputePipeline({}, compute_info);
+        if (compute.result != vk::Result::eSuccess) {
+            fail(id, "failed to create its pipeline");
+            return;
+        }
+        kernel.pipeline = compute.value;
+    } catch (const std::exception& e) {
+        fail(id, e.what());
+    }
+}
+
+void VulkanCompute::fail(KernelId id, const std::string& what) {
+    kernels_[id].failed = true;
+    Logger::getInstance().log(std::string("GPU ") + kKernelNames[id] + " kernel runs on the CPU from now on: " + what);
+}
+
+uint32_t VulkanCompute::findMemoryType(uint32_t type_bits, vk::MemoryPropertyFlags properties) const {
+    vk::PhysicalDeviceMemoryProperties memory = physical_device_.getMemoryProperties();
+    for (uint32_t i = 0; i < memory.memoryTypeCount; ++i) {
+        if ((type_bits & (1u << i)) && (memory.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("No suitable memory type");
+}
+
+void VulkanCompute::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                                 Buffer& buffer) {
+    buffer.buffer = device_.createBuffer(vk::BufferCreateInfo({}, size, usage));
+    vk::MemoryRequirements mem_reqs = device_.getBufferMemoryRequirements(buffer.buffer);
+    buffer.memory = device_.allocateMemory(
+        vk::MemoryAllocateInfo(mem_reqs.size, findMemoryType(mem_reqs.memoryTypeBits, properties)));
+    device_.bindBufferMemory(buffer.buffer, buffer.memory, 0);
+    buffer.size = size;
+}
+
+void VulkanCompute::destroyBuffer(Buffer& buffer) {
+    if (buffer.mapped) device_.unmapMemory(buffer.memory);
+    if (buffer.buffer) device_.destroyBuffer(buffer.buffer);
+    if (buffer.memory) device_.freeMemory(buffer.memory);
+    buffer = Buffer();
+}
+
+void VulkanCompute::reserve(Buffer& buffer, vk::DeviceSize size) {
+    if (buffer.size >= size) {
+        return;
+    }
+    destroyBuffer(buffer);
+    createBuffer(size,
+                 vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc |
+                     vk::BufferUsageFlagBits::eTransferDst,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal, buffer);
+}
+
+void* VulkanCompute::staging(vk::DeviceSize size) {
+    if (staging_.size < size) {
+        destroyBuffer(staging_);
+        createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, staging_);
+        staging_.mapped = device_.mapMemory(staging_.memory, 0, size);
+    }
+    return staging_.mapped;
+}
+
+vk::DescriptorSet VulkanCompute::bind(KernelId id, vk::DescriptorPool pool, std::initializer_list<vk::Buffer> buffers) {
+    vk::DescriptorSet set =
+        device_.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(pool, 1, &kernels_[id].set_layout)).front();
+    std::vector<vk::DescriptorBufferInfo> infos;
+    for (vk::Buffer buffer : buffers) {
+        infos.emplace_back(buffer, 0, VK_WHOLE_SIZE);
+    }
+    std::vector<vk::WriteDescriptorSet> writes;
+    for (size_t i = 0; i < infos.size(); ++i) {
+        writes.emplace_back(set, static_cast<uint32_t>(i), 0, 1, vk::DescriptorType::eStorageBuffer, nullptr,
+                            &infos[i]);
+    }
+    device_.updateDescriptorSets(writes, nullptr);
+    return set;
+}
+
+void VulkanCompute::submit(const std::function<void(vk::CommandBuffer)>& record) {
+    vk::CommandBuffer command_buffer = device_.allocateCommandBuffers(
+        vk::CommandBufferAllocateInfo(command_pool_, vk::CommandBufferLevel::ePrimary, 1)).front();
+    vk::Result result = vk::Result::eSuccess;
+    try {
+        command_buffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        record(command_buffer);
+        command_buffer.end();
+        device_.resetFences(fence_);
+        queue_.submit(vk::SubmitInfo(0, nullptr, nullptr, 1, &command_buffer), fence_);
+        result = device_.waitForFences(fence_, true, std::numeric_limits<uint64_t>::max());
+    } catch (...) {
+        device_.freeCommandBuffers(command_pool_, command_buffer);
+        throw;
+    }
+    device_.freeCommandBuffers(command_pool_, command_buffer);
+    if (result != vk::Result::eSuccess) {
+        throw std::runtime_error("compute submission did not complete");
+    }
+}
+
+bool VulkanCompute::transform(Complex* data, int rows, int cols, bool inverse) {
+    const std::size_t points = static_cast<std::size_t>(rows) * cols;
+    if (!isPowerOfTwo(rows) || !isPowerOfTwo(cols) || points < kMinimumPoints) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    // One workgroup row per transform of a pass
+    if (!usable(kFftStage) || static_cast<uint32_t>(std::max(rows, cols)) > max_group_count_[1]) {
+        return false;
+    }
+    try {
+        // exp(-2 pi i m / n), m < n / 2, for the row length, then the column
+        // length
+        std::vector<Complex> twiddles;
+        for (int n : {cols, rows}) {
+            for (int m = 0; m < n / 2; ++m) {
+                twiddles.push_back(std::polar(1.0, -2.0 * M_PI * m / n));
+            }
+        }
+        const vk::DeviceSize bytes = points * sizeof(Complex);
+        const vk::DeviceSize twiddle_bytes = twiddles.size() * sizeof(Complex);
+        reserve(ping_, bytes);
+        reserve(pong_, bytes);
+        reserve(twiddles_, twiddle_bytes);
+        char* host = static_cast<char*>(staging(bytes + twiddle_bytes));
+        std::memcpy(host, data, bytes);
+        std::memcpy(host + bytes, twiddles.data(), twiddle_bytes);
+
+        device_.resetDescriptorPool(descriptor_pool_);
+        const vk::DescriptorSet sets[2] = {
+            bind(kFftStage, descriptor_pool_, {ping_.buffer, pong_.buffer, twiddles_.buffer}),
+            bind(kFftStage, descriptor_pool_, {pong_.buffer, ping_.buffer, twiddles_.buffer})};
+        // Every stage of the row pass, then of the column pass; the last
+        // one scales an inverse
+        std::vector<FftStageParams> stages;
+        for (int p = 1; p < cols; p *= 2) {
+            stages.push_back({1.0, cols, rows, 1, cols, p, 0, inverse, 0});
+        }
+        for (int p = 1; p < rows; p *= 2) {
+            stages.push_back({1.0, rows, cols, cols, 1, p, cols / 2, inverse, 0});
+        }
+        if (inverse) {
+            stages.back().scale = 1.0 / static_cast<double>(points);
+        }
+        const Kernel& kernel = kernels_[kFftStage];
+        const vk::Buffer result = stages.size() % 2 == 1 ? pong_.buffer : ping_.buffer;
+        submit([&](vk::CommandBuffer command_buffer) {
+            command_buffer.copyBuffer(staging_.buffer, ping_.buffer, vk::BufferCopy(0, 0, bytes));
+            command_buffer.copyBuffer(staging_.buffer, twiddles_.buffer, vk::BufferCopy(bytes, 0, twiddle_bytes));
+            command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernel.pipeline);
+            for (size_t s = 0; s < stages.size(); ++s) {
+                deviceBarrier(command_buffer);
+                command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, kernel.layout, 0, sets[s % 2],
+                                                  nullptr);
+                command_buffer.pushConstants(kernel.layout, vk::ShaderStageFlagBits::eCompute, 0,
+                                             sizeof(FftStageParams), &stages[s]);
+                command_buffer.dispatch(groups(stages[s].n / 2, kFftGroupSize), stages[s].count, 1);
+            }
+            deviceBarrier(command_buffer);
+            command_buffer.copyBuffer(result, staging_.buffer, vk::BufferCopy(0, 0, bytes));
+            hostBarrier(command_buffer);
+        });
+        std::memcpy(data, host, bytes);
+        return true;
+    } catch (const std::exception& e) {
+        fail(kFftStage, e.what());
+        return false;
+    }
+}
+
+bool VulkanCompute::diffuseExplicit(Eigen::ArrayXXd& field, double ratio, int steps) {
+    const Eigen::Index rows = field.rows(), cols = field.cols();
+    if (static_cast<std::size_t>(field.size()) < kMinimumPoints || steps <= 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!usable(kDiffusion) || groups(rows, kGridGroupSize) > max_group_count_[0] ||
+        groups(cols, kGridGroupSize) > max_group_count_[1]) {
+        return false;
+    }
+    try {
+        const vk::DeviceSize bytes = static_cast<vk::DeviceSize>(field.size()) * sizeof(double);
+        reserve(ping_, bytes);
+        reserve(pong_, bytes);
+        char* host = static_cast<char*>(staging(bytes));
+        std::memcpy(host, field.data(), bytes);
+
+        device_.resetDescriptorPool(descriptor_pool_);
+        const vk::DescriptorSet sets[2] = {bind(kDiffusion, descriptor_pool_, {ping_.buffer, pong_.buffer}),
+                                           bind(kDiffusion, descriptor_pool_, {pong_.buffer, ping_.buffer})};
+        const DiffusionParams params{ratio, static_cast<int32_t>(rows), static_cast<int32_t>(cols)};
+        const Kernel& kernel = kernels_[kDiffusion];
+        const vk::Buffer result = steps % 2 == 1 ? pong_.buffer : ping_.buffer;
+        submit([&](vk::CommandBuffer command_buffer) {
+            command_buffer.copyBuffer(staging_.buffer, ping_.buffer, vk::BufferCopy(0, 0, bytes));
+            command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernel.pipeline);
+            command_buffer.pushConstants(kernel.layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(params), &params);
+            for (int step = 0; step < steps; ++step) {
+                deviceBarrier(command_buffer);
+                command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, kernel.layout, 0, sets[step % 2],
+                                                  nullptr);
+                command_buffer.dispatch(groups(rows, kGridGroupSize), groups(cols, kGridGroupSize), 1);
+            }
+            deviceBarrier(command_buffer);
+            command_buffer.copyBuffer(result, staging_.buffer, vk::BufferCopy(0, 0, bytes));
+            hostBarrier(command_buffer);
+        });
+        std::memcpy(field.data(), host, bytes);
+        return true;
+    } catch (const std::exception& e) {
+        fail(kDiffusion, e.what());
+        return false;
+    }
+}
+
+std::unique_ptr<GpuCompute::Smoother> VulkanCompute::smoother(const Eigen::ArrayXXd& west,
+                                                              const Eigen::ArrayXXd& north,
+                                                              const Eigen::ArrayXXd& inverse_diagonal) {
+    const Eigen::Index rows = west.rows() - 2, cols = west.cols() - 2;
+    if (rows <= 0 || cols <= 0 || static_cast<std::size_t>(rows * cols) < kMinimumPoints ||
+        north.rows() != west.rows() || north.cols() != west.cols() ||
+        inverse_diagonal.rows() != west.rows() || inverse_diagonal.cols() != west.cols()) {
+        return nullptr;
+    }
+    // Declared before the lock, so a smoother that failed to upload is
+    // released after it: its destructor takes the lock
+    std::unique_ptr<RedBlackSmoother> smoother;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!usable(kRedBlack) || groups((rows + 1) / 2, kGridGroupSize) > max_group_count_[0] ||
+        groups(cols, kGridGroupSize) > max_group_count_[1]) {
+        return nullptr;
+    }
+    smoother = std::make_unique<RedBlackSmoother>(shared_from_this(), rows, cols);
+    try {
+        smoother->upload(west, north, inverse_diagonal);
+    } catch (const std::exception& e) {
+        fail(kRedBlack, e.what());
+        return nullptr;
+    }
+    return smoother;
+}
+
+bool VulkanCompute::countGaussianDepths(std::uint64_t key, std::uint64_t stream, long ions, double mean, double stdev,
+                                        double bin_width, std::vector<std::uint64_t>& counts) {
+    if (ions < kMinimumIons || counts.empty() || counts.size() > std::numeric_limits<uint32_t>::max() ||
+        !(bin_width > 0.0)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!usable(kImplantDepths)) {
+        return false;
+    }
+    try {
+        const uint32_t bins = static_cast<uint32_t>(counts.size());
+        const vk::DeviceSize bytes = static_cast<vk::DeviceSize>(bins) * sizeof(uint32_t);
+        reserve(ping_, bytes);
+        const uint32_t* host = static_cast<const uint32_t*>(staging(bytes));
+        device_.resetDescriptorPool(descriptor_pool_);
+        const vk::DescriptorSet set = bind(kImplantDepths, descriptor_pool_, {ping_.buffer});
+        const Kernel& kernel = kernels_[kImplantDepths];
+        // Added to the caller's counts only once every dispatch succeeded
+        std::vector<std::uint64_t> total(bins, 0);
+
+        const uint64_t pairs = (static_cast<uint64_t>(ions) + 1) / 2;
+        const uint64_t pairs_per_dispatch =
+            std::min<uint64_t>(kMaxImplantPairs, uint64_t(max_group_count_[0]) * kImplantGroupSize);
+        for (uint64_t first = 0; first < pairs; first += pairs_per_dispatch) {
+            const uint64_t batch = std::min(pairs_per_dispatch, pairs - first);
+            const uint64_t batch_ions = std::min<uint64_t>(2 * batch, static_cast<uint64_t>(ions) - 2 * first);
+            const ImplantParams params{mean, stdev, bin_width,
+                                       static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32),
+                                       static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32),
+                                       static_cast<uint32_t>(first), static_cast<uint32_t>(first >> 32),
+                                       static_cast<uint32_t>(batch_ions), bins};
+            submit([&](vk::CommandBuffer command_buffer) {
+                command_buffer.fillBuffer(ping_.buffer, 0, bytes, 0);
+                deviceBarrier(command_buffer);
+                command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernel.pipeline);
+                command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, kernel.layout, 0, set, nullptr);
+                command_buffer.pushConstants(kernel.layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(params),
+                                             &params);
+                command_buffer.dispatch(groups(batch, kImplantGroupSize), 1, 1);
+                deviceBarrier(command_buffer);
+                command_buffer.copyBuffer(ping_.buffer, staging_.buffer, vk::BufferCopy(0, 0, bytes));
+                hostBarrier(command_buffer);
+            });
+            for (uint32_t b = 0; b < bins; ++b) {
+                total[b] += host[b];
+            }
+        }
+        for (uint32_t b = 0; b < bins; ++b) {
+            counts[b] += total[b];
+        }
+        return true;
+    } catch (const std::exception& e) {
+        fail(kImplantDepths, e.what());
+        return false;
+    }
+}
@@ -0,0 +1,105 @@
+// Author: Dr. Mazharuddin Mohammed
+#pragma once
+#include "../core/gpu_compute.hpp"
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// GpuCompute on a Vulkan compute queue, headless: the simulation's kernels
+// need no window, surface or renderer.
+//
+// The device is opened once per process, by shared(), on the first device
+// with a compute queue and 64-bit float shaders; the kernels are all
+// double precision, as on the CPU, so devices without them get no backend.
+// Calls are serialized on the one queue. A call uploads its fields once
+// through a host-visible staging buffer into device-local buffers, records
+// every stage or step as a dispatch in one command buffer, and reads the
+// result back after a single fence wait. The buffers grow to the largest
+// call so far and are reused.
+//
+// A kernel whose shader fails to load, or whose call throws, is marked
+// failed and declines from then on; the others keep running.
+class VulkanCompute : public GpuCompute, public std::enable_shared_from_this<VulkanCompute> {
+public:
+    // Null when no suitable device is present
+    static std::shared_ptr<VulkanCompute> shared();
+
+    ~VulkanCompute() override;
+    VulkanCompute(const VulkanCompute&) = delete;
+    VulkanCompute& operator=(const VulkanCompute&) = delete;
+
+    std::string deviceName() const override { return device_name_; }
+    bool transform(Complex* data, int rows, int cols, bool inverse) override;
+    bool diffuseExplicit(Eigen::ArrayXXd& field, double ratio, int steps) override;
+    std::unique_ptr<Smoother> smoother(const Eigen::ArrayXXd& west, const Eigen::ArrayXXd& north,
+                                       const Eigen::ArrayXXd& inverse_diagonal) override;
+    bool countGaussianDepths(std::uint64_t key, std::uint64_t stream, long ions, double mean, double stdev,
+                             double bin_width, std::vector<std::uint64_t>& counts) override;
+
+private:
+    class RedBlackSmoother;
+
+    enum KernelId { kFftStage, kDiffusion, kRedBlack, kImplantDepths, kKernelCount };
+
+    struct Kernel {
+        vk::ShaderModule shader;
+        vk::DescriptorSetLayout set_layout;
+        vk::PipelineLayout layout;
+        vk::Pipeline pipeline;
+        bool failed = false;
+    };
+
+    struct Buffer {
+        vk::Buffer buffer;
+        vk::DeviceMemory memory;
+        vk::DeviceSize size = 0;
+        void* mapped = nullptr; // Host-visible buffers only
+    };
+
+    VulkanCompute() = default;
+    // False, leaving nothing to release but what the destructor frees,
+    // when the process has no suitable device
+    bool open();
+    void createKernel(KernelId id, const std::string& shader, uint32_t buffers, uint32_t push_bytes);
+    // Whether the kernel can run; a failed call marks it failed
+    bool usable(KernelId id) const { return kernels_[id].pipeline && !kernels_[id].failed; }
+    void fail(KernelId id, const std::string& what);
+
+    uint32_t findMemoryType(uint32_t type_bits, vk::MemoryPropertyFlags properties) const;
+    void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                      Buffer& buffer);
+    void destroyBuffer(Buffer& buffer);
+    // Device-local storage buffer of at least `size` bytes
+    void reserve(Buffer& buffer, vk::DeviceSize size);
+    // Mapped staging of at least `size` bytes
+    void* staging(vk::DeviceSize size);
+    vk::DescriptorSet bind(KernelId id, vk::DescriptorPool pool, std::initializer_list<vk::Buffer> buffers);
+    // Records, submits and waits for one command buffer
+    void submit(const std::function<void(vk::CommandBuffer)>& record);
+
+    vk::Instance instance_;
+    vk::PhysicalDevice physical_device_;
+    vk::Device device_;
+    vk::Queue queue_;
+    uint32_t queue_family_index_ = 0;
+    vk::CommandPool command_pool_;
+    vk::Fence fence_;
+    // Sets of one call, reset at the start of the next
+    vk::DescriptorPool descriptor_pool_;
+    Kernel kernels_[kKernelCount];
+    uint32_t max_group_count_[3] = {0, 0, 0};
+    std::string device_name_;
+
+    Buffer staging_;
+    Buffer ping_;
+    Buffer pong_;
+    Buffer twiddles_;
+
+    // Serializes calls on the queue and their shared buffers
+    std::mutex mutex_;
+};
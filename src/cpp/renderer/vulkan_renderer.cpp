@@ -1,22 +1,100 @@
 // Author: Dr. Mazharuddin Mohammed
 #include "vulkan_renderer.hpp"
+#include "../../core/iso_mesh.hpp"
+#include "../../core/png_writer.hpp"
+#include "../../core/task_scheduler.hpp"
 #include <stdexcept>
 #include <array>
 #include <algorithm>
 #include <string>
-#include <iostream>
+#include <cstddef>
+#include <cmath>
 #include <cstring>
+#include <fstream>
 
-VulkanRenderer::VulkanRenderer(uint32_t width, uint32_t height) : width_(width), height_(height) {
-    glfwInit();
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    window_ = glfwCreateWindow(width, height, "Semiconductor Simulator", nullptr, nullptr);
+#ifndef SEMIPRO_SHADER_DIR
+#define SEMIPRO_SHADER_DIR "shaders"
+#endif
+
+namespace {
+
+// Stages that read the field texture
+const vk::PipelineStageFlags kFieldReaders = vk::PipelineStageFlagBits::eVertexShader |
+                                             vk::PipelineStageFlagBits::eFragmentShader |
+                                             vk::PipelineStageFlagBits::eComputeShader;
+
+// Pipeline statistics of the scene pass; results come in bit order
+const vk::QueryPipelineStatisticFlags kSceneStatistics =
+    vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+    vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+    vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+    vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
+
+// Half-float bits of a finite float, truncated
+uint16_t toHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const int exponent = static_cast<int>((bits >> 23) & 0xffu) - 127 + 15;
+    const uint32_t mantissa = bits & 0x7fffffu;
+    if (exponent <= 0) {
+        // Subnormal, or zero
+        return exponent < -10 ? sign : static_cast<uint16_t>(sign | ((mantissa | 0x800000u) >> (14 - exponent)));
+    }
+    if (exponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7c00u);
+    }
+    return static_cast<uint16_t>(sign | (exponent << 10) | (mantissa >> 13));
+}
+
+} // namespace
+
+VulkanRenderer::VulkanRenderer(uint32_t width, uint32_t height, Target target)
+    : width_(width), height_(height), target_(target) {
+    if (target_ == Target::Window) {
+        glfwInit();
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        window_ = glfwCreateWindow(width, height, "Semiconductor Simulator", nullptr, nullptr);
+    }
 }
 
 VulkanRenderer::~VulkanRenderer() {
-    device_.destroySemaphore(image_available_semaphore_);
-    device_.destroySemaphore(render_finished_semaphore_);
-    device_.destroyFence(in_flight_fence_);
+    if (device_) device_.waitIdle();
+    destroyExportTarget();
+    destroyFieldTexture();
+    destroyHeightPyramid();
+    destroyVolumeImage(volume_image_, volume_memory_, volume_view_);
+    destroyVolumeImage(occupancy_image_, occupancy_memory_, occupancy_view_);
+    destroyVolumeImage(transfer_image_, transfer_memory_, transfer_view_);
+    for (StagingSlot& slot : tile_ring_) destroyBuffer(slot.buffer, slot.memory);
+    destroyBuffer(vertex_buffer_, vertex_buffer_memory_);
+    destroyBuffer(index_buffer_, index_buffer_memory_);
+    destroyBuffer(dopant_buffer_, dopant_memory_);
+    destroyBuffer(bond_buffer_, bond_memory_);
+    for (FrameQueries& queries : frame_queries_) {
+        device_.destroyQueryPool(queries.timestamps);
+        device_.destroyQueryPool(queries.statistics);
+    }
+    device_.destroySampler(field_sampler_);
+    device_.destroySampler(volume_sampler_);
+    device_.destroyDescriptorPool(descriptor_pool_);
+    device_.destroyDescriptorSetLayout(descriptor_set_layout_);
+    device_.destroyShaderModule(vertex_shader_);
+    device_.destroyShaderModule(fragment_shader_);
+    device_.destroyShaderModule(pyramid_shader_);
+    device_.destroyPipeline(pyramid_pipeline_);
+    device_.destroyPipelineLayout(pyramid_pipeline_layout_);
+    device_.destroyDescriptorSetLayout(pyramid_set_layout_);
+    device_.destroyShaderModule(volume_vertex_shader_);
+    device_.destroyShaderModule(volume_fragment_shader_);
+    device_.destroyPipeline(volume_pipeline_);
+    device_.destroyPipelineLayout(volume_pipeline_layout_);
+    device_.destroyDescriptorSetLayout(volume_set_layout_);
+    for (uint32_t frame = 0; frame < kFramesInFlight; ++frame) {
+        device_.destroySemaphore(image_available_semaphores_[frame]);
+        device_.destroySemaphore(render_finished_semaphores_[frame]);
+        device_.destroyFence(in_flight_fences_[frame]);
+    }
     device_.destroyCommandPool(command_pool_);
     for (auto framebuffer : framebuffers_) device_.destroyFramebuffer(framebuffer);
     device_.destroyPipeline(pipeline_);
@@ -27,26 +105,40 @@ VulkanRenderer::~VulkanRenderer() {
     instance_.destroySurfaceKHR(surface_);
     device_.destroy();
     instance_.destroy();
-    glfwDestroyWindow(window_);
-    glfwTerminate();
+    if (window_) {
+        glfwDestroyWindow(window_);
+        glfwTerminate();
+    }
 }
 
 void VulkanRenderer::initialize() {
     createInstance();
     setupDevice();
-    createSwapchain();
+    if (target_ == Target::Window) {
+        createSwapchain();
+    }
     createRenderPass();
+    createDescriptors();
     createPipeline();
-    createFramebuffers();
+    if (target_ == Target::Window) {
+        createFramebuffers();
+    }
     createCommandBuffers();
-    image_available_semaphore_ = device_.createSemaphore({});
-    render_finished_semaphore_ = device_.createSemaphore({});
-    in_flight_fence_ = device_.createFence({vk::FenceCreateFlagBits::eSignaled});
+    createQueryPools();
+    createPatchMesh();
+    for (uint32_t frame = 0; frame < kFramesInFlight; ++frame) {
+        image_available_semaphores_[frame] = device_.createSemaphore({});
+        render_finished_semaphores_[frame] = device_.createSemaphore({});
+        in_flight_fences_[frame] = device_.createFence({vk::FenceCreateFlagBits::eSignaled});
+    }
 }
 
 void VulkanRenderer::createInstance() {
     vk::ApplicationInfo app_info("Semiconductor Simulator", 1, "Simulator Engine", 1, VK_API_VERSION_1_0);
-    std::vector<const char*> extensions = {"VK_KHR_surface", "VK_KHR_xcb_surface"};
+    std::vector<const char*> extensions;
+    if (target_ == Target::Window) {
+        extensions = {"VK_KHR_surface", "VK_KHR_xcb_surface"};
+    }
     vk::InstanceCreateInfo create_info({}, &app_info, 0, nullptr, extensions.size(), extensions.data());
     instance_ = vk::createInstance(create_info);
 }
@@ -57,15 +149,34 @@ void VulkanRenderer::setupDevice() {
     uint32_t queue_family_index = 0;
     for (size_t i = 0; i < queue_props.size(); ++i) {
         if (queue_props[i].queueFlags & vk::QueueFlagBits::eGraphics) {
-            queue_family_index = i;
+            queue_family_index = static_cast<uint32_t>(i);
             break;
         }
     }
     float queue_priority = 1.0f;
     vk::DeviceQueueCreateInfo queue_info({}, queue_family_index, 1, &queue_priority);
-    vk::DeviceCreateInfo device_info({}, 1, &queue_info);
+    // The height pyramid is a two-channel float storage image
+    const vk::PhysicalDeviceFeatures available = physical_device_.getFeatures();
+    vk::PhysicalDeviceFeatures features;
+    features.shaderStorageImageExtendedFormats = available.shaderStorageImageExtendedFormats;
+    if (!features.shaderStorageImageExtendedFormats) {
+        throw std::runtime_error("Device lacks RG32F storage images for the height pyramid");
+    }
+    // Frame timing uses whichever queries the device has
+    features.pipelineStatisticsQuery = available.pipelineStatisticsQuery;
+    pipeline_statistics_ = available.pipelineStatisticsQuery;
+    const uint32_t timestamp_bits = queue_props[queue_family_index].timestampValidBits;
+    if (timestamp_bits > 0) {
+        timestamp_period_ns_ = physical_device_.getProperties().limits.timestampPeriod;
+        timestamp_mask_ = timestamp_bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << timestamp_bits) - 1;
+    }
+    vk::DeviceCreateInfo device_info({}, 1, &queue_info, 0, nullptr, 0, nullptr, &features);
     device_ = physical_device_.createDevice(device_info);
     graphics_queue_ = device_.getQueue(queue_family_index, 0);
+    queue_family_index_ = queue_family_index;
+    if (target_ == Target::Offscreen) {
+        return;
+    }
     VkSurfaceKHR surface;
     if (glfwCreateWindowSurface(static_cast<VkInstance>(instance_), window_, nullptr, &surface) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create window surface");
@@ -81,7 +192,8 @@ void VulkanRenderer::createSwapchain() {
     swapchain_images_ = device_.getSwapchainImagesKHR(swapchain_);
     swapchain_image_views_.resize(swapchain_images_.size());
     for (size_t i = 0; i < swapchain_images_.size(); ++i) {
-        vk::ImageViewCreateInfo view_info({}, swapchain_images_[i], vk::ImageViewType::e2D, vk::Format::eB8G8R8A8Unorm);
+        vk::ImageViewCreateInfo view_info({}, swapchain_images_[i], vk::ImageViewType::e2D, vk::Format::eB8G8R8A8Unorm, {},
+                                          vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
         swapchain_image_views_[i] = device_.createImageView(view_info);
     }
 }
@@ -97,18 +209,80 @@ void VulkanRenderer::createRenderPass() {
     render_pass_ = device_.createRenderPass(render_pass_info);
 }
 
+void VulkanRenderer::createDescriptors() {
+    std::array<vk::DescriptorSetLayoutBinding, 4> bindings = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, 1,
+                                       vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment),
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment),
+        vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eVertex)};
+    descriptor_set_layout_ = device_.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo({}, static_cast<uint32_t>(bindings.size()), bindings.data()));
+    // Pyramid level k reads the field (k = 0) or level k - 1 and writes level k
+    std::array<vk::DescriptorSetLayoutBinding, 3> pyramid_bindings = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute)};
+    pyramid_set_layout_ = device_.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo({}, static_cast<uint32_t>(pyramid_bindings.size()), pyramid_bindings.data()));
+
+    std::array<vk::DescriptorSetLayoutBinding, 3> volume_bindings = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment),
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment)};
+    volume_set_layout_ = device_.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo({}, static_cast<uint32_t>(volume_bindings.size()), volume_bindings.data()));
+
+    std::array<vk::DescriptorPoolSize, 3> sizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 5 + kMaxPyramidLevels),
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 2),
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, 2 * kMaxPyramidLevels)};
+    descriptor_pool_ = device_.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo({}, 2 + kMaxPyramidLevels, static_cast<uint32_t>(sizes.size()), sizes.data()));
+    descriptor_set_ = device_.allocateDescriptorSets(
+        vk::DescriptorSetAllocateInfo(descriptor_pool_, 1, &descriptor_set_layout_)).front();
+    std::vector<vk::DescriptorSetLayout> pyramid_layouts(kMaxPyramidLevels, pyramid_set_layout_);
+    std::vector<vk::DescriptorSet> pyramid_sets = device_.allocateDescriptorSets(
+        vk::DescriptorSetAllocateInfo(descriptor_pool_, kMaxPyramidLevels, pyramid_layouts.data()));
+    std::copy(pyramid_sets.begin(), pyramid_sets.end(), pyramid_sets_.begin());
+    volume_set_ = device_.allocateDescriptorSets(
+        vk::DescriptorSetAllocateInfo(descriptor_pool_, 1, &volume_set_layout_)).front();
+    field_sampler_ = device_.createSampler(
+        vk::SamplerCreateInfo({}, vk::Filter::eNearest, vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest,
+                              vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge,
+                              vk::SamplerAddressMode::eClampToEdge));
+    volume_sampler_ = device_.createSampler(
+        vk::SamplerCreateInfo({}, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eNearest,
+                              vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge,
+                              vk::SamplerAddressMode::eClampToEdge));
+}
+
 void VulkanRenderer::createPipeline() {
     loadShaders();
-    vk::PipelineLayoutCreateInfo layout_info;
+    vk::PushConstantRange push_range(vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0,
+                                     sizeof(FieldRenderParams));
+    vk::PipelineLayoutCreateInfo layout_info({}, 1, &descriptor_set_layout_, 1, &push_range);
     pipeline_layout_ = device_.createPipelineLayout(layout_info);
-    // Create a minimal pipeline for now - this needs proper shader stages
-    vk::PipelineVertexInputStateCreateInfo vertex_input_info;
+    std::array<vk::PipelineShaderStageCreateInfo, 2> stages = {
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, vertex_shader_, "main"),
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, fragment_shader_, "main")};
+    std::array<vk::VertexInputBindingDescription, 2> vertex_bindings = {
+        vk::VertexInputBindingDescription(0, sizeof(PatchVertex), vk::VertexInputRate::eVertex),
+        vk::VertexInputBindingDescription(1, sizeof(TileInstance), vk::VertexInputRate::eInstance)};
+    std::array<vk::VertexInputAttributeDescription, 2> vertex_attributes = {
+        vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32Sfloat, offsetof(PatchVertex, uv)),
+        vk::VertexInputAttributeDescription(1, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(TileInstance, origin))};
+    vk::PipelineVertexInputStateCreateInfo vertex_input_info({}, static_cast<uint32_t>(vertex_bindings.size()),
+                                                             vertex_bindings.data(),
+                                                             static_cast<uint32_t>(vertex_attributes.size()),
+                                                             vertex_attributes.data());
     vk::PipelineInputAssemblyStateCreateInfo input_assembly({}, vk::PrimitiveTopology::eTriangleList);
     vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(width_), static_cast<float>(height_), 0.0f, 1.0f);
     vk::Rect2D scissor({0, 0}, {width_, height_});
     vk::PipelineViewportStateCreateInfo viewport_state({}, 1, &viewport, 1, &scissor);
+    // Relief can fold the mesh over itself, so both faces are drawn
     vk::PipelineRasterizationStateCreateInfo rasterizer({}, false, false, vk::PolygonMode::eFill,
-                                                        vk::CullModeFlagBits::eBack, vk::FrontFace::eClockwise,
+                                                        vk::CullModeFlagBits::eNone, vk::FrontFace::eClockwise,
                                                         false, 0.0f, 0.0f, 0.0f, 1.0f);
     vk::PipelineMultisampleStateCreateInfo multisampling({}, vk::SampleCountFlagBits::e1);
     vk::PipelineColorBlendAttachmentState color_blend_attachment(false);
@@ -116,7 +290,8 @@ void VulkanRenderer::createPipeline() {
                                            vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
     vk::PipelineColorBlendStateCreateInfo color_blending({}, false, vk::LogicOp::eCopy, 1, &color_blend_attachment);
 
-    vk::GraphicsPipelineCreateInfo pipeline_info({}, {}, &vertex_input_info, &input_assembly, nullptr,
+    vk::GraphicsPipelineCreateInfo pipeline_info({}, static_cast<uint32_t>(stages.size()), stages.data(),
+                                                &vertex_input_info, &input_assembly, nullptr,
                                                 &viewport_state, &rasterizer, &multisampling, nullptr,
                                                 &color_blending, nullptr, pipeline_layout_, render_pass_, 0);
     auto result = device_.createGraphicsPipeline({}, pipeline_info);
@@ -124,6 +299,36 @@ void VulkanRenderer::createPipeline() {
         throw std::runtime_error("Failed to create graphics pipeline");
     }
     pipeline_ = result.value;
+
+    // The volume is a full-screen triangle, ray marched per fragment
+    vk::PushConstantRange volume_range(vk::ShaderStageFlagBits::eFragment, 0, sizeof(VolumeRenderParams));
+    volume_pipeline_layout_ = device_.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, 1, &volume_set_layout_, 1, &volume_range));
+    std::array<vk::PipelineShaderStageCreateInfo, 2> volume_stages = {
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, volume_vertex_shader_, "main"),
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, volume_fragment_shader_, "main")};
+    vk::PipelineVertexInputStateCreateInfo no_vertices;
+    vk::GraphicsPipelineCreateInfo volume_info({}, static_cast<uint32_t>(volume_stages.size()), volume_stages.data(),
+                                              &no_vertices, &input_assembly, nullptr, &viewport_state, &rasterizer,
+                                              &multisampling, nullptr, &color_blending, nullptr,
+                                              volume_pipeline_layout_, render_pass_, 0);
+    auto volume_result = device_.createGraphicsPipeline({}, volume_info);
+    if (volume_result.result != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to create volume pipeline");
+    }
+    volume_pipeline_ = volume_result.value;
+
+    vk::PushConstantRange level_range(vk::ShaderStageFlagBits::eCompute, 0, sizeof(int32_t));
+    pyramid_pipeline_layout_ = device_.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, 1, &pyramid_set_layout_, 1, &level_range));
+    vk::ComputePipelineCreateInfo compute_info(
+        {}, vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, pyramid_shader_, "main"),
+        pyramid_pipeline_layout_);
+    auto compute = device_.createComputePipeline({}, compute_info);
+    if (compute.result != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to create height pyramid pipeline");
+    }
+    pyramid_pipeline_ = compute.value;
 }
 
 void VulkanRenderer::createFramebuffers() {
@@ -135,172 +340,1202 @@ void VulkanRenderer::createFramebuffers() {
 }
 
 void VulkanRenderer::createCommandBuffers() {
-    command_pool_ = device_.createCommandPool({{}, 0});
-    vk::CommandBufferAllocateInfo alloc_info(command_pool_, vk::CommandBufferLevel::ePrimary, framebuffers_.size());
+    // Frame command buffers are re-recorded every frame with the current
+    // push constants, so they are reset individually
+    command_pool_ = device_.createCommandPool({vk::CommandPoolCreateFlagBits::eResetCommandBuffer, queue_family_index_});
+    vk::CommandBufferAllocateInfo alloc_info(command_pool_, vk::CommandBufferLevel::ePrimary, kFramesInFlight);
     command_buffers_ = device_.allocateCommandBuffers(alloc_info);
+    images_in_flight_.assign(swapchain_images_.size(), nullptr);
+}
+
+void VulkanRenderer::createQueryPools() {
+    for (FrameQueries& queries : frame_queries_) {
+        if (timestamp_period_ns_ > 0.0f) {
+            queries.timestamps = device_.createQueryPool({{}, vk::QueryType::eTimestamp, 2 * kGpuPassCount});
+        }
+        if (pipeline_statistics_) {
+            queries.statistics = device_.createQueryPool({{}, vk::QueryType::ePipelineStatistics, 1, kSceneStatistics});
+        }
+    }
 }
 
 void VulkanRenderer::loadShaders() {
-    // Placeholder: Load SPIR-V shaders (wafer.vert, wafer.frag)
-}
-
-void VulkanRenderer::createVertexBuffer(const Eigen::ArrayXXd& grid, const Eigen::ArrayXd& dopant_profile,
-                                       const Eigen::ArrayXXd& photoresist_pattern,
-                                       const std::vector<std::pair<double, std::string>>& film_layers,
-                                       const std::vector<std::pair<double, std::string>>& metal_layers,
-                                       const std::pair<double, std::string>& packaging_substrate,
-                                       const std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>>& wire_bonds,
-                                       const std::vector<std::pair<std::string, double>>& electrical_properties,
-                                       const Eigen::ArrayXXd& temperature_profile,
-                                       const Eigen::ArrayXXd& electromigration_mttf,
-                                       const Eigen::ArrayXXd& thermal_stress,
-                                       const Eigen::ArrayXXd& dielectric_field,
-                                       const std::string& material_id,
-                                       bool show_temp_overlay,
-                                       const std::string& reliability_metric) {
-    std::vector<Vertex> vertices;
-    float base_color[3] = {1.0f, 0.0f, 0.0f}; // Red for silicon
-    if (material_id == "oxide") {
-        base_color[0] = 0.0f; base_color[1] = 1.0f; base_color[2] = 0.0f; // Green for oxide
-    }
-
-    double max_concentration = dopant_profile.maxCoeff();
-    double min_concentration = dopant_profile.minCoeff();
-    double range = max_concentration - min_concentration > 0 ? max_concentration - min_concentration : 1.0;
+    // SPIR-V compiled from the shaders/ directory at build time
+    auto load = [this](const std::string& name) {
+        const std::string path = std::string(SEMIPRO_SHADER_DIR) + "/" + name;
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            throw std::runtime_error("Failed to open shader " + path);
+        }
+        std::vector<uint32_t> code(static_cast<size_t>(file.tellg()) / sizeof(uint32_t));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+        return device_.createShaderModule(vk::ShaderModuleCreateInfo({}, code.size() * sizeof(uint32_t), code.data()));
+    };
+    vertex_shader_ = load("wafer.vert.spv");
+    fragment_shader_ = load("wafer.frag.spv");
+    pyramid_shader_ = load("height_pyramid.comp.spv");
+    volume_vertex_shader_ = load("volume.vert.spv");
+    volume_fragment_shader_ = load("volume.frag.spv");
+}
 
-    double max_resistance = 0.0;
-    for (const auto& prop : electrical_properties) {
-        if (prop.first == "Resistance") max_resistance = std::max(max_resistance, prop.second);
-    }
-    max_resistance = max_resistance > 0 ? max_resistance : 1.0;
-
-    double T_min = 300.0; // K
-    double T_max = 400.0; // K
-    double T_range = T_max - T_min;
-
-    double MTTF_threshold = 3.15e8; // 10 years in seconds
-    double stress_max = 500.0; // MPa
-    double E_bd = 1e7; // Breakdown field (V/cm) for SiO2
-
-    for (int i = 0; i < grid.rows(); ++i) {
-        for (int j = 0; j < grid.cols(); ++j) {
-            float x = (2.0f * j / grid.cols()) - 1.0f;
-            float y = (2.0f * i / grid.rows()) - 1.0f;
-            float doping_intensity = 0.0f;
-            if (i < dopant_profile.size()) {
-                doping_intensity = static_cast<float>((dopant_profile[i] - min_concentration) / range);
-            }
+uint32_t VulkanRenderer::findMemoryType(uint32_t type_bits, vk::MemoryPropertyFlags properties) const {
+    vk::PhysicalDeviceMemoryProperties memory = physical_device_.getMemoryProperties();
+    for (uint32_t i = 0; i < memory.memoryTypeCount; ++i) {
+        if ((type_bits & (1u << i)) && (memory.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("No suitable memory type");
+}
 
-            float color[3];
-            bool is_wire = false;
-            for (const auto& wire : wire_bonds) {
-                if ((wire.first.first == i && wire.first.second == j) || 
-                    (wire.second.first == i && wire.second.second == j)) {
-                    color[0] = 1.0f; color[1] = 0.84f; color[2] = 0.0f; // Gold for wire bonds
-                    is_wire = true;
-                    break;
-                }
-            }
+void VulkanRenderer::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                                  vk::Buffer& buffer, vk::DeviceMemory& memory) {
+    buffer = device_.createBuffer(vk::BufferCreateInfo({}, size, usage));
+    vk::MemoryRequirements mem_reqs = device_.getBufferMemoryRequirements(buffer);
+    memory = device_.allocateMemory(vk::MemoryAllocateInfo(mem_reqs.size, findMemoryType(mem_reqs.memoryTypeBits, properties)));
+    device_.bindBufferMemory(buffer, memory, 0);
+}
+
+void VulkanRenderer::destroyBuffer(vk::Buffer& buffer, vk::DeviceMemory& memory) {
+    if (buffer) device_.destroyBuffer(buffer);
+    if (memory) device_.freeMemory(memory);
+    buffer = nullptr;
+    memory = nullptr;
+}
+
+void VulkanRenderer::submitOnce(const std::function<void(vk::CommandBuffer)>& record) {
+    vk::CommandBuffer command_buffer = device_.allocateCommandBuffers(
+        vk::CommandBufferAllocateInfo(command_pool_, vk::CommandBufferLevel::ePrimary, 1)).front();
+    command_buffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    record(command_buffer);
+    command_buffer.end();
+    graphics_queue_.submit(vk::SubmitInfo(0, nullptr, nullptr, 1, &command_buffer), nullptr);
+    graphics_queue_.waitIdle();
+    device_.freeCommandBuffers(command_pool_, command_buffer);
+}
+
+void VulkanRenderer::createFieldTexture(uint32_t rows, uint32_t cols) {
+    // Width runs over rows and height over columns, so a column-major
+    // field is already in the image's row-major texel order
+    const uint32_t layers = static_cast<uint32_t>(kFieldLayers.size());
+    vk::ImageCreateInfo image_info({}, vk::ImageType::e2D, vk::Format::eR32Sfloat, vk::Extent3D(rows, cols, 1), 1,
+                                   layers, vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+                                   vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled);
+    field_image_ = device_.createImage(image_info);
+    vk::MemoryRequirements mem_reqs = device_.getImageMemoryRequirements(field_image_);
+    field_image_memory_ = device_.allocateMemory(vk::MemoryAllocateInfo(
+        mem_reqs.size, findMemoryType(mem_reqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)));
+    device_.bindImageMemory(field_image_, field_image_memory_, 0);
+    field_image_view_ = device_.createImageView(vk::ImageViewCreateInfo(
+        {}, field_image_, vk::ImageViewType::e2DArray, vk::Format::eR32Sfloat, {},
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, layers)));
+
+    const vk::DeviceSize layer_bytes = static_cast<vk::DeviceSize>(rows) * cols * sizeof(float);
+    for (StagingSlot& slot : staging_ring_) {
+        createBuffer(layer_bytes, vk::BufferUsageFlagBits::eTransferSrc,
+                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     slot.buffer, slot.memory);
+        slot.data = static_cast<float*>(device_.mapMemory(slot.memory, 0, layer_bytes));
+        slot.capacity = layer_bytes;
+    }
+    field_rows_ = rows;
+    field_cols_ = cols;
+    uploaded_versions_.fill(0);
+
+    // Every layer starts at zero in the layout the shaders read, so region
+    // uploads can always transition from it
+    const vk::ImageSubresourceRange all_layers(vk::ImageAspectFlagBits::eColor, 0, 1, 0, layers);
+    submitOnce([&](vk::CommandBuffer command_buffer) {
+        vk::ImageMemoryBarrier to_transfer({}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined,
+                                           vk::ImageLayout::eTransferDstOptimal, VK_QUEUE_FAMILY_IGNORED,
+                                           VK_QUEUE_FAMILY_IGNORED, field_image_, all_layers);
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+                                       {}, nullptr, nullptr, to_transfer);
+        command_buffer.clearColorImage(field_image_, vk::ImageLayout::eTransferDstOptimal,
+                                       vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f}), all_layers);
+        vk::ImageMemoryBarrier to_shader(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                                         vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                                         VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, field_image_, all_layers);
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                       kFieldReaders,
+                                       {}, nullptr, nullptr, to_shader);
+    });
+}
+
+void VulkanRenderer::destroyFieldTexture() {
+    for (StagingSlot& slot : staging_ring_) {
+        if (slot.data) {
+            device_.unmapMemory(slot.memory);
+            slot.data = nullptr;
+        }
+        destroyBuffer(slot.buffer, slot.memory);
+        slot.capacity = 0;
+    }
+    if (field_image_view_) device_.destroyImageView(field_image_view_);
+    if (field_image_) device_.destroyImage(field_image_);
+    if (field_image_memory_) device_.freeMemory(field_image_memory_);
+    field_image_view_ = nullptr;
+    field_image_ = nullptr;
+    field_image_memory_ = nullptr;
+    field_rows_ = field_cols_ = 0;
+}
+
+void VulkanRenderer::createPatchMesh() {
+    const uint32_t side = kPatchQuads + 1;
+    std::vector<PatchVertex> vertices;
+    vertices.reserve(side * side);
+    for (uint32_t i = 0; i < side; ++i) {
+        for (uint32_t j = 0; j < side; ++j) {
+            vertices.push_back({{static_cast<float>(i) / kPatchQuads, static_cast<float>(j) / kPatchQuads}});
+        }
+    }
+    std::vector<uint32_t> indices;
+    indices.reserve(kPatchQuads * kPatchQuads * 6);
+    for (uint32_t i = 0; i < kPatchQuads; ++i) {
+        for (uint32_t j = 0; j < kPatchQuads; ++j) {
+            const uint32_t v = i * side + j;
+            indices.insert(indices.end(), {v, v + 1, v + side, v + 1, v + side + 1, v + side});
+        }
+    }
+    const auto host = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    const vk::DeviceSize vertex_bytes = vertices.size() * sizeof(PatchVertex);
+    const vk::DeviceSize index_bytes = indices.size() * sizeof(uint32_t);
+    createBuffer(vertex_bytes, vk::BufferUsageFlagBits::eVertexBuffer, host, vertex_buffer_, vertex_buffer_memory_);
+    createBuffer(index_bytes, vk::BufferUsageFlagBits::eIndexBuffer, host, index_buffer_, index_buffer_memory_);
+    std::memcpy(device_.mapMemory(vertex_buffer_memory_, 0, vertex_bytes), vertices.data(), vertex_bytes);
+    device_.unmapMemory(vertex_buffer_memory_);
+    std::memcpy(device_.mapMemory(index_buffer_memory_, 0, index_bytes), indices.data(), index_bytes);
+    device_.unmapMemory(index_buffer_memory_);
+    index_count_ = static_cast<uint32_t>(indices.size());
+
+    const vk::DeviceSize tile_bytes = kMaxTiles * sizeof(TileInstance);
+    for (StagingSlot& slot : tile_ring_) {
+        createBuffer(tile_bytes, vk::BufferUsageFlagBits::eVertexBuffer, host, slot.buffer, slot.memory);
+        slot.data = static_cast<float*>(device_.mapMemory(slot.memory, 0, tile_bytes));
+        slot.capacity = tile_bytes;
+    }
+}
 
-            if (!is_wire) {
-                if (reliability_metric == "Electromigration" && 
-                    electromigration_mttf.rows() > i && electromigration_mttf.cols() > j &&
-                    electromigration_mttf(i, j) > 0 && electromigration_mttf(i, j) < MTTF_threshold) {
-                    float mttf_norm = std::min(1.0f, static_cast<float>(MTTF_threshold / electromigration_mttf(i, j)));
-                    color[0] = mttf_norm; color[1] = 0.0f; color[2] = 0.0f; // Red for low MTTF
-                } else if (reliability_metric == "Thermal Stress" && 
-                           thermal_stress.rows() > i && thermal_stress.cols() > j &&
-                           thermal_stress(i, j) > 0) {
-                    float stress_norm = std::min(1.0f, static_cast<float>(thermal_stress(i, j) / stress_max));
-                    color[0] = stress_norm; color[1] = 0.0f; color[2] = 1.0f - stress_norm; // Blue to red
-                } else if (reliability_metric == "Dielectric Breakdown" && 
-                           dielectric_field.rows() > i && dielectric_field.cols() > j &&
-                           dielectric_field(i, j) > 0.9 * E_bd) {
-                    color[0] = 1.0f; color[1] = 1.0f; color[2] = 0.0f; // Yellow for breakdown risk
-                } else if (show_temp_overlay && temperature_profile.rows() > i && temperature_profile.cols() > j &&
-                           temperature_profile(i, j) > T_min) {
-                    float T_norm = std::min(std::max((temperature_profile(i, j) - T_min) / T_range, 0.0), 1.0);
-                    color[0] = T_norm; color[1] = 0.0f; color[2] = 1.0f - T_norm; // Blue to red
-                } else if (grid(i, j) < 0.0) {
-                    color[0] = 0.5f; color[1] = 0.5f; color[2] = 0.5f; // Gray for etched
-                } else if (packaging_substrate.first > 0) {
-                    color[0] = 0.6f; color[1] = 0.4f; color[2] = 0.2f; // Brown for substrate
-                } else if (!metal_layers.empty()) {
-                    color[0] = 0.8f; color[1] = 0.8f; color[2] = 0.8f; // Silver/gray for metal
-                    for (const auto& prop : electrical_properties) {
-                        if (prop.first == "Resistance") {
-                            float intensity = static_cast<float>(prop.second / max_resistance);
-                            color[0] = 0.8f * (1.0f - intensity) + intensity; // Red tint
-                        }
-                    }
-                } else if (!film_layers.empty()) {
-                    color[0] = 0.0f; color[1] = 0.0f; color[2] = 1.0f; // Blue for dielectric
-                } else if (i < photoresist_pattern.rows() && j < photoresist_pattern.cols() && 
-                           photoresist_pattern(i, j) > 0.5) {
-                    color[0] = 1.0f; color[1] = 1.0f; color[2] = 1.0f; // White for photoresist
-                } else {
-                    color[0] = base_color[0] * (1.0f - doping_intensity);
-                    color[1] = base_color[1] * (1.0f - doping_intensity);
-                    color[2] = doping_intensity; // Blue for doping
-                }
+void VulkanRenderer::createHeightPyramid(uint32_t rows, uint32_t cols) {
+    const uint32_t base_rows = std::max(1u, rows / 2);
+    const uint32_t base_cols = std::max(1u, cols / 2);
+    uint32_t levels = 1;
+    while ((std::max(base_rows, base_cols) >> levels) > 0) ++levels;
+    if (levels > kMaxPyramidLevels) {
+        throw std::invalid_argument("Wafer grid too large for the height pyramid");
+    }
+    vk::ImageCreateInfo image_info({}, vk::ImageType::e2D, vk::Format::eR32G32Sfloat,
+                                   vk::Extent3D(base_rows, base_cols, 1), levels, 1, vk::SampleCountFlagBits::e1,
+                                   vk::ImageTiling::eOptimal,
+                                   vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled);
+    pyramid_image_ = device_.createImage(image_info);
+    vk::MemoryRequirements mem_reqs = device_.getImageMemoryRequirements(pyramid_image_);
+    pyramid_memory_ = device_.allocateMemory(vk::MemoryAllocateInfo(
+        mem_reqs.size, findMemoryType(mem_reqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)));
+    device_.bindImageMemory(pyramid_image_, pyramid_memory_, 0);
+    const vk::ImageSubresourceRange all_levels(vk::ImageAspectFlagBits::eColor, 0, levels, 0, 1);
+    pyramid_view_ = device_.createImageView(vk::ImageViewCreateInfo(
+        {}, pyramid_image_, vk::ImageViewType::e2D, vk::Format::eR32G32Sfloat, {}, all_levels));
+    for (uint32_t level = 0; level < levels; ++level) {
+        pyramid_level_views_.push_back(device_.createImageView(vk::ImageViewCreateInfo(
+            {}, pyramid_image_, vk::ImageViewType::e2D, vk::Format::eR32G32Sfloat, {},
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level, 1, 0, 1))));
+    }
+
+    // Written by compute and sampled by the vertex shader, the pyramid
+    // stays in the general layout
+    submitOnce([&](vk::CommandBuffer command_buffer) {
+        vk::ImageMemoryBarrier to_general({}, vk::AccessFlagBits::eShaderWrite, vk::ImageLayout::eUndefined,
+                                          vk::ImageLayout::eGeneral, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                                          pyramid_image_, all_levels);
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader,
+                                       {}, nullptr, nullptr, to_general);
+    });
+    for (uint32_t level = 0; level < levels; ++level) {
+        vk::DescriptorImageInfo field_info(field_sampler_, field_image_view_, vk::ImageLayout::eShaderReadOnlyOptimal);
+        vk::DescriptorImageInfo source_info({}, pyramid_level_views_[level > 0 ? level - 1 : 0], vk::ImageLayout::eGeneral);
+        vk::DescriptorImageInfo target_info({}, pyramid_level_views_[level], vk::ImageLayout::eGeneral);
+        std::array<vk::WriteDescriptorSet, 3> writes = {
+            vk::WriteDescriptorSet(pyramid_sets_[level], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &field_info),
+            vk::WriteDescriptorSet(pyramid_sets_[level], 1, 0, 1, vk::DescriptorType::eStorageImage, &source_info),
+            vk::WriteDescriptorSet(pyramid_sets_[level], 2, 0, 1, vk::DescriptorType::eStorageImage, &target_info)};
+        device_.updateDescriptorSets(writes, nullptr);
+    }
+    pyramid_dirty_ = true;
+}
+
+void VulkanRenderer::destroyHeightPyramid() {
+    for (vk::ImageView view : pyramid_level_views_) device_.destroyImageView(view);
+    pyramid_level_views_.clear();
+    if (pyramid_view_) device_.destroyImageView(pyramid_view_);
+    if (pyramid_image_) device_.destroyImage(pyramid_image_);
+    if (pyramid_memory_) device_.freeMemory(pyramid_memory_);
+    pyramid_view_ = nullptr;
+    pyramid_image_ = nullptr;
+    pyramid_memory_ = nullptr;
+}
+
+void VulkanRenderer::recordHeightPyramid(vk::CommandBuffer command_buffer) {
+    if (!pyramid_dirty_ || !pyramid_image_) {
+        return;
+    }
+    const uint32_t levels = static_cast<uint32_t>(pyramid_level_views_.size());
+    const vk::ImageSubresourceRange all_levels(vk::ImageAspectFlagBits::eColor, 0, levels, 0, 1);
+    // The previous frame's vertex shader may still read the pyramid
+    vk::ImageMemoryBarrier before(vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eShaderWrite,
+                                  vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, VK_QUEUE_FAMILY_IGNORED,
+                                  VK_QUEUE_FAMILY_IGNORED, pyramid_image_, all_levels);
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eVertexShader, vk::PipelineStageFlagBits::eComputeShader,
+                                   {}, nullptr, nullptr, before);
+    command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, pyramid_pipeline_);
+    for (uint32_t level = 0; level < levels; ++level) {
+        if (level > 0) {
+            vk::ImageMemoryBarrier written(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead,
+                                           vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral,
+                                           VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, pyramid_image_,
+                                           vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level - 1, 1, 0, 1));
+            command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                           vk::PipelineStageFlagBits::eComputeShader, {}, nullptr, nullptr, written);
+        }
+        const int32_t index = static_cast<int32_t>(level);
+        command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pyramid_pipeline_layout_, 0,
+                                          pyramid_sets_[level], nullptr);
+        command_buffer.pushConstants(pyramid_pipeline_layout_, vk::ShaderStageFlagBits::eCompute, 0, sizeof(int32_t),
+                                     &index);
+        const uint32_t level_rows = std::max(1u, (field_rows_ / 2) >> level);
+        const uint32_t level_cols = std::max(1u, (field_cols_ / 2) >> level);
+        command_buffer.dispatch((level_rows + 7) / 8, (level_cols + 7) / 8, 1);
+    }
+    vk::ImageMemoryBarrier after(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead,
+                                 vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, VK_QUEUE_FAMILY_IGNORED,
+                                 VK_QUEUE_FAMILY_IGNORED, pyramid_image_, all_levels);
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eVertexShader,
+                                   {}, nullptr, nullptr, after);
+    pyramid_dirty_ = false;
+}
+
+void VulkanRenderer::setView(float center_row, float center_col, float zoom) {
+    if (!(zoom > 0.0f)) {
+        throw std::invalid_argument("View zoom must be positive");
+    }
+    field_params_.view_row = center_row;
+    field_params_.view_col = center_col;
+    field_params_.zoom = zoom;
+}
+
+void VulkanRenderer::selectTiles(const FieldRenderParams& params) {
+    tiles_.clear();
+    if (field_rows_ == 0 || field_cols_ == 0 || drawsVolume(params)) {
+        return;
+    }
+    // Part of the wafer in view; relief lifts points by up to `relief` in
+    // clip space, so rows past the bottom edge may rise into view
+    const float zoom = params.zoom;
+    const float half = 0.5f / zoom;
+    const float row_low = params.view_row - half;
+    const float row_high = params.view_row + half + params.relief / (2.0f * zoom);
+    const float col_low = params.view_col - half;
+    const float col_high = params.view_col + half;
+    const float split_pixels = kPatchQuads * kPixelsPerQuad / quality_level_;
+
+    std::vector<TileInstance> pending = {{{0.0f, 0.0f}, 1.0f, 0.0f}};
+    while (!pending.empty() && tiles_.size() < kMaxTiles) {
+        TileInstance tile = pending.back();
+        pending.pop_back();
+        const float row = tile.origin[0], col = tile.origin[1], size = tile.size;
+        if (row > row_high || row + size < row_low || col > col_high || col + size < col_low) {
+            continue;
+        }
+        // Rows run down the framebuffer's height and columns across its width
+        const float row_cells = size * field_rows_, col_cells = size * field_cols_;
+        const bool rows_fine = size * zoom * height_ <= split_pixels || row_cells <= kPatchQuads;
+        const bool cols_fine = size * zoom * width_ <= split_pixels || col_cells <= kPatchQuads;
+        if (!rows_fine || !cols_fine) {
+            const float child = 0.5f * size;
+            pending.push_back({{row, col}, child, 0.0f});
+            pending.push_back({{row + child, col}, child, 0.0f});
+            pending.push_back({{row, col + child}, child, 0.0f});
+            pending.push_back({{row + child, col + child}, child, 0.0f});
+            continue;
+        }
+        const float cells_per_quad = std::max(row_cells, col_cells) / kPatchQuads;
+        tile.level = cells_per_quad > 1.0f ? std::floor(std::log2(cells_per_quad)) : 0.0f;
+        tiles_.push_back(tile);
+    }
+}
+
+void VulkanRenderer::uploadFieldLayer(const FieldStore& fields, int channel, uint32_t layer) {
+    // Only called with the queue idle, so any slot is free
+    const StagingSlot& slot = staging_ring_[current_frame_];
+    Eigen::Map<Eigen::ArrayXXf>(slot.data, field_rows_, field_cols_) = fields.view(channel).cast<float>();
+    const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, layer, 1);
+    submitOnce([&](vk::CommandBuffer command_buffer) {
+        vk::ImageMemoryBarrier to_transfer(
+            vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferWrite,
+            vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferDstOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, field_image_, range);
+        command_buffer.pipelineBarrier(kFieldReaders,
+                                       vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, to_transfer);
+        vk::BufferImageCopy region(0, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, layer, 1),
+                                   vk::Offset3D(0, 0, 0), vk::Extent3D(field_rows_, field_cols_, 1));
+        command_buffer.copyBufferToImage(slot.buffer, field_image_, vk::ImageLayout::eTransferDstOptimal, region);
+        vk::ImageMemoryBarrier to_shader(
+            vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, field_image_, range);
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                       kFieldReaders,
+                                       {}, nullptr, nullptr, to_shader);
+    });
+    uploaded_versions_[layer] = fields.version(channel);
+    ++field_uploads_;
+}
+
+void VulkanRenderer::uploadStorage(vk::Buffer& buffer, vk::DeviceMemory& memory, vk::DeviceSize& capacity,
+                                   const void* data, vk::DeviceSize bytes) {
+    // Storage buffer descriptors cannot be empty
+    const vk::DeviceSize needed = std::max<vk::DeviceSize>(bytes, 16);
+    if (needed > capacity) {
+        destroyBuffer(buffer, memory);
+        createBuffer(needed, vk::BufferUsageFlagBits::eStorageBuffer,
+                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     buffer, memory);
+        capacity = needed;
+    }
+    if (bytes > 0) {
+        std::memcpy(device_.mapMemory(memory, 0, bytes), data, bytes);
+        device_.unmapMemory(memory);
+    }
+}
+
+void VulkanRenderer::updateDescriptors() {
+    vk::DescriptorImageInfo image_info(field_sampler_, field_image_view_, vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::DescriptorBufferInfo dopant_info(dopant_buffer_, 0, VK_WHOLE_SIZE);
+    vk::DescriptorBufferInfo bond_info(bond_buffer_, 0, VK_WHOLE_SIZE);
+    vk::DescriptorImageInfo pyramid_info(field_sampler_, pyramid_view_, vk::ImageLayout::eGeneral);
+    std::array<vk::WriteDescriptorSet, 4> writes = {
+        vk::WriteDescriptorSet(descriptor_set_, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &image_info),
+        vk::WriteDescriptorSet(descriptor_set_, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &dopant_info),
+        vk::WriteDescriptorSet(descriptor_set_, 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bond_info),
+        vk::WriteDescriptorSet(descriptor_set_, 3, 0, 1, vk::DescriptorType::eCombinedImageSampler, &pyramid_info)};
+    device_.updateDescriptorSets(writes, nullptr);
+}
+
+void VulkanRenderer::createVolumeImage(vk::ImageType type, vk::Format format, vk::Extent3D extent, vk::Image& image,
+                                       vk::DeviceMemory& memory, vk::ImageView& view) {
+    image = device_.createImage(vk::ImageCreateInfo(
+        {}, type, format, extent, 1, 1, vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled));
+    vk::MemoryRequirements mem_reqs = device_.getImageMemoryRequirements(image);
+    memory = device_.allocateMemory(vk::MemoryAllocateInfo(
+        mem_reqs.size, findMemoryType(mem_reqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)));
+    device_.bindImageMemory(image, memory, 0);
+    const vk::ImageViewType view_type = type == vk::ImageType::e3D ? vk::ImageViewType::e3D : vk::ImageViewType::e1D;
+    view = device_.createImageView(vk::ImageViewCreateInfo(
+        {}, image, view_type, format, {}, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)));
+}
+
+void VulkanRenderer::destroyVolumeImage(vk::Image& image, vk::DeviceMemory& memory, vk::ImageView& view) {
+    if (view) device_.destroyImageView(view);
+    if (image) device_.destroyImage(image);
+    if (memory) device_.freeMemory(memory);
+    view = nullptr;
+    image = nullptr;
+    memory = nullptr;
+}
+
+void VulkanRenderer::uploadVolumeImage(vk::Image image, vk::Extent3D extent, vk::DeviceSize texel_bytes,
+                                       const std::function<void(void*, uint32_t, uint32_t)>& fill) {
+    const vk::DeviceSize slice_bytes = static_cast<vk::DeviceSize>(extent.width) * extent.height * texel_bytes;
+    const uint32_t slab = static_cast<uint32_t>(
+        std::max<vk::DeviceSize>(1, std::min<vk::DeviceSize>(extent.depth, kVolumeSlabBytes / slice_bytes)));
+    vk::Buffer staging;
+    vk::DeviceMemory staging_memory;
+    createBuffer(slab * slice_bytes, vk::BufferUsageFlagBits::eTransferSrc,
+                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                 staging, staging_memory);
+    void* texels = device_.mapMemory(staging_memory, 0, slab * slice_bytes);
+    const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    for (uint32_t first = 0; first < extent.depth; first += slab) {
+        const uint32_t count = std::min(slab, extent.depth - first);
+        fill(texels, first, count);
+        submitOnce([&](vk::CommandBuffer command_buffer) {
+            if (first == 0) {
+                vk::ImageMemoryBarrier to_transfer({}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined,
+                                                   vk::ImageLayout::eTransferDstOptimal, VK_QUEUE_FAMILY_IGNORED,
+                                                   VK_QUEUE_FAMILY_IGNORED, image, range);
+                command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                                               vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, to_transfer);
             }
-            vertices.push_back({{x, y}, {color[0], color[1], color[2]}});
-
-            // Log reliability metrics for console-based text overlay
-            if (!reliability_metric.empty() && 
-                (electromigration_mttf(i, j) > 0 || thermal_stress(i, j) > 0 || dielectric_field(i, j) > 0)) {
-                std::cout << "At (" << i << "," << j << "): ";
-                if (reliability_metric == "Electromigration") {
-                    std::cout << "MTTF=" << electromigration_mttf(i, j) << " s";
-                } else if (reliability_metric == "Thermal Stress") {
-                    std::cout << "Stress=" << thermal_stress(i, j) << " MPa";
-                } else if (reliability_metric == "Dielectric Breakdown") {
-                    std::cout << "Field=" << dielectric_field(i, j) << " V/cm";
-                }
-                std::cout << "\n";
+            vk::BufferImageCopy region(0, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+                                       vk::Offset3D(0, 0, static_cast<int32_t>(first)),
+                                       vk::Extent3D(extent.width, extent.height, count));
+            command_buffer.copyBufferToImage(staging, image, vk::ImageLayout::eTransferDstOptimal, region);
+            if (first + count == extent.depth) {
+                vk::ImageMemoryBarrier to_shader(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                                                 vk::ImageLayout::eTransferDstOptimal,
+                                                 vk::ImageLayout::eShaderReadOnlyOptimal, VK_QUEUE_FAMILY_IGNORED,
+                                                 VK_QUEUE_FAMILY_IGNORED, image, range);
+                command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                               vk::PipelineStageFlagBits::eFragmentShader, {}, nullptr, nullptr,
+                                               to_shader);
             }
+        });
+    }
+    device_.unmapMemory(staging_memory);
+    destroyBuffer(staging, staging_memory);
+}
+
+void VulkanRenderer::setVolume(const FieldVolume& volume, const TransferFunction& transfer) {
+    if (!device_) {
+        throw std::logic_error("setVolume needs an initialized renderer");
+    }
+    if (volume.empty()) {
+        throw std::invalid_argument("Volume is empty");
+    }
+    const uint32_t limit = physical_device_.getProperties().limits.maxImageDimension3D;
+    const vk::Extent3D extent(static_cast<uint32_t>(volume.rows()), static_cast<uint32_t>(volume.cols()),
+                              static_cast<uint32_t>(volume.slices()));
+    if (std::max({extent.width, extent.height, extent.depth}) > limit) {
+        throw std::invalid_argument("Volume exceeds the device's 3D texture size of " + std::to_string(limit));
+    }
+    // Frames in flight may still sample the old volume
+    device_.waitIdle();
+    destroyVolumeImage(volume_image_, volume_memory_, volume_view_);
+
+    // Half floats over the volume's range halve the memory of R32F, 256 MB
+    // at 512^3, with about three significant digits
+    volume_range_ = volume.range();
+    const float low = volume_range_.first;
+    const float span = volume_range_.second > low ? volume_range_.second - low : 1.0f;
+    createVolumeImage(vk::ImageType::e3D, vk::Format::eR16Sfloat, extent, volume_image_, volume_memory_, volume_view_);
+    const std::size_t slice_cells = static_cast<std::size_t>(extent.width) * extent.height;
+    uploadVolumeImage(volume_image_, extent, sizeof(uint16_t), [&](void* texels, uint32_t first, uint32_t count) {
+        const float* values = volume.data() + first * slice_cells;
+        uint16_t* out = static_cast<uint16_t*>(texels);
+        const std::ptrdiff_t cells = static_cast<std::ptrdiff_t>(count * slice_cells);
+#pragma omp parallel for schedule(static)
+        for (std::ptrdiff_t i = 0; i < cells; ++i) {
+            out[i] = toHalf((values[i] - low) / span);
         }
+    });
+    volume_bricks_ = BrickMap(volume);
+
+    const float longest = static_cast<float>(std::max({extent.width, extent.height, extent.depth}));
+    volume_params_.extent[0] = extent.width / longest;
+    volume_params_.extent[1] = extent.height / longest;
+    volume_params_.extent[2] = extent.depth / longest;
+    setTransferFunction(transfer);
+    updateVolumeCamera();
+}
+
+void VulkanRenderer::setTransferFunction(const TransferFunction& transfer) {
+    if (!volume_image_) {
+        throw std::logic_error("setTransferFunction needs a volume");
     }
+    device_.waitIdle();
+    destroyVolumeImage(occupancy_image_, occupancy_memory_, occupancy_view_);
+    destroyVolumeImage(transfer_image_, transfer_memory_, transfer_view_);
 
-    vk::BufferCreateInfo buffer_info({}, vertices.size() * sizeof(Vertex), vk::BufferUsageFlagBits::eVertexBuffer);
-    vertex_buffer_ = device_.createBuffer(buffer_info);
-    vk::MemoryRequirements mem_reqs = device_.getBufferMemoryRequirements(vertex_buffer_);
-    vk::MemoryAllocateInfo alloc_info(mem_reqs.size, 0);
-    vertex_buffer_memory_ = device_.allocateMemory(alloc_info);
-    device_.bindBufferMemory(vertex_buffer_, vertex_buffer_memory_, 0);
-    void* data = device_.mapMemory(vertex_buffer_memory_, 0, mem_reqs.size);
-    memcpy(data, vertices.data(), vertices.size() * sizeof(Vertex));
-    device_.unmapMemory(vertex_buffer_memory_);
+    const std::vector<uint8_t> occupancy = volume_bricks_.occupancy(transfer, kTransferEntries);
+    const vk::Extent3D bricks(static_cast<uint32_t>(volume_bricks_.rows()), static_cast<uint32_t>(volume_bricks_.cols()),
+                              static_cast<uint32_t>(volume_bricks_.slices()));
+    createVolumeImage(vk::ImageType::e3D, vk::Format::eR8Uint, bricks, occupancy_image_, occupancy_memory_,
+                      occupancy_view_);
+    uploadVolumeImage(occupancy_image_, bricks, 1, [&](void* texels, uint32_t first, uint32_t count) {
+        const std::size_t slice = static_cast<std::size_t>(bricks.width) * bricks.height;
+        std::memcpy(texels, occupancy.data() + first * slice, count * slice);
+    });
+
+    const std::vector<std::array<float, 4>> table = transfer.table(kTransferEntries);
+    createVolumeImage(vk::ImageType::e1D, vk::Format::eR16G16B16A16Sfloat, vk::Extent3D(kTransferEntries, 1, 1),
+                      transfer_image_, transfer_memory_, transfer_view_);
+    uploadVolumeImage(transfer_image_, vk::Extent3D(kTransferEntries, 1, 1), 4 * sizeof(uint16_t),
+                      [&](void* texels, uint32_t, uint32_t) {
+        uint16_t* out = static_cast<uint16_t*>(texels);
+        for (uint32_t k = 0; k < kTransferEntries; ++k) {
+            for (int c = 0; c < 4; ++c) {
+                out[4 * k + c] = toHalf(std::clamp(table[k][c], 0.0f, 1.0f));
+            }
+        }
+    });
+
+    // Stored values are (v - low) / span; the table covers the function's
+    // own range
+    const float span = volume_range_.second > volume_range_.first ? volume_range_.second - volume_range_.first : 1.0f;
+    const float width = transfer.high() > transfer.low() ? transfer.high() - transfer.low() : 1.0f;
+    volume_params_.value_scale = span / width;
+    volume_params_.value_offset = (volume_range_.first - transfer.low()) / width;
+
+    vk::DescriptorImageInfo volume_info(volume_sampler_, volume_view_, vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::DescriptorImageInfo occupancy_info(field_sampler_, occupancy_view_, vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::DescriptorImageInfo transfer_info(volume_sampler_, transfer_view_, vk::ImageLayout::eShaderReadOnlyOptimal);
+    std::array<vk::WriteDescriptorSet, 3> writes = {
+        vk::WriteDescriptorSet(volume_set_, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &volume_info),
+        vk::WriteDescriptorSet(volume_set_, 1, 0, 1, vk::DescriptorType::eCombinedImageSampler, &occupancy_info),
+        vk::WriteDescriptorSet(volume_set_, 2, 0, 1, vk::DescriptorType::eCombinedImageSampler, &transfer_info)};
+    device_.updateDescriptorSets(writes, nullptr);
+}
+
+void VulkanRenderer::setVolumeCamera(float yaw, float pitch, float distance) {
+    if (!(distance > 0.0f)) {
+        throw std::invalid_argument("Volume camera distance must be positive");
+    }
+    volume_yaw_ = yaw;
+    // Looking straight down the normal leaves no horizon to orient by
+    volume_pitch_ = std::clamp(pitch, -1.55f, 1.55f);
+    volume_distance_ = distance;
+    updateVolumeCamera();
+}
+
+void VulkanRenderer::updateVolumeCamera() {
+    // Slices run down from the surface, so the surface normal is -z
+    const Eigen::Vector3f centre = 0.5f * Eigen::Vector3f(volume_params_.extent[0], volume_params_.extent[1],
+                                                          volume_params_.extent[2]);
+    const Eigen::Vector3f normal(0.0f, 0.0f, -1.0f);
+    const Eigen::Vector3f away(std::cos(volume_pitch_) * std::cos(volume_yaw_),
+                               std::cos(volume_pitch_) * std::sin(volume_yaw_), -std::sin(volume_pitch_));
+    const Eigen::Vector3f eye = centre + volume_distance_ * away;
+    const Eigen::Vector3f forward = -away;
+    const Eigen::Vector3f right = forward.cross(normal).normalized();
+    const Eigen::Vector3f up = right.cross(forward);
+    // 45 degree vertical field of view
+    const float half_height = std::tan(0.5f * 0.785398f);
+    const float half_width = half_height * static_cast<float>(width_) / static_cast<float>(height_);
+    for (int k = 0; k < 3; ++k) {
+        volume_params_.eye[k] = eye[k];
+        volume_params_.forward[k] = forward[k];
+        volume_params_.right[k] = half_width * right[k];
+        volume_params_.up[k] = half_height * up[k];
+    }
+}
+
+void VulkanRenderer::resizeFields(uint32_t rows, uint32_t cols) {
+    destroyHeightPyramid();
+    destroyFieldTexture();
+    createFieldTexture(rows, cols);
+    createHeightPyramid(rows, cols);
+    field_params_.rows = static_cast<int32_t>(rows);
+    field_params_.cols = static_cast<int32_t>(cols);
+    deferred_updates_.clear();
+}
+
+int VulkanRenderer::fieldLayer(int channel) const {
+    for (size_t layer = 0; layer < kFieldLayers.size(); ++layer) {
+        if (kFieldLayers[layer] == channel) return static_cast<int>(layer);
+    }
+    return -1;
+}
+
+void VulkanRenderer::takeBridgeUpdates() {
+    if (!update_bridge_) {
+        return;
+    }
+    for (FieldUpdate& update : update_bridge_->take()) {
+        if (fieldLayer(update.channel) < 0) {
+            continue;
+        }
+        if (static_cast<uint32_t>(update.field_rows) != field_rows_ ||
+            static_cast<uint32_t>(update.field_cols) != field_cols_) {
+            // A reshaped field: the texture is rebuilt, which is the one
+            // case that waits for frames in flight
+            device_.waitIdle();
+            resizeFields(static_cast<uint32_t>(update.field_rows), static_cast<uint32_t>(update.field_cols));
+            updateDescriptors();
+        }
+        deferred_updates_.push_back(std::move(update));
+    }
+}
+
+void VulkanRenderer::recordRegionUploads(vk::CommandBuffer command_buffer) {
+    if (deferred_updates_.empty()) {
+        return;
+    }
+    // This frame's fence has been waited on, so its slot is free
+    StagingSlot& slot = staging_ring_[current_frame_];
+    std::vector<vk::BufferImageCopy> regions;
+    vk::DeviceSize offset = 0;
+    size_t taken = 0;
+    for (; taken < deferred_updates_.size(); ++taken) {
+        const FieldUpdate& update = deferred_updates_[taken];
+        const int layer = fieldLayer(update.channel);
+        if (update.version < uploaded_versions_[layer]) {
+            continue; // Superseded by a whole-layer upload
+        }
+        const vk::DeviceSize bytes = update.values.size() * sizeof(float);
+        if (offset + bytes > slot.capacity) {
+            break;
+        }
+        std::memcpy(reinterpret_cast<char*>(slot.data) + offset, update.values.data(), bytes);
+        const FieldRect& rect = update.rect;
+        regions.emplace_back(offset, static_cast<uint32_t>(rect.rows), static_cast<uint32_t>(rect.cols),
+                             vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, layer, 1),
+                             vk::Offset3D(rect.row, rect.col, 0),
+                             vk::Extent3D(static_cast<uint32_t>(rect.rows), static_cast<uint32_t>(rect.cols), 1));
+        offset += bytes;
+        uploaded_versions_[layer] = update.version;
+        pyramid_dirty_ = pyramid_dirty_ || layer == 0;
+    }
+    deferred_updates_.erase(deferred_updates_.begin(), deferred_updates_.begin() + taken);
+    if (regions.empty()) {
+        return;
+    }
+
+    const vk::ImageSubresourceRange all_layers(vk::ImageAspectFlagBits::eColor, 0, 1, 0,
+                                               static_cast<uint32_t>(kFieldLayers.size()));
+    vk::ImageMemoryBarrier to_transfer(vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferWrite,
+                                       vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferDstOptimal,
+                                       VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, field_image_, all_layers);
+    command_buffer.pipelineBarrier(kFieldReaders,
+                                   vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, to_transfer);
+    command_buffer.copyBufferToImage(slot.buffer, field_image_, vk::ImageLayout::eTransferDstOptimal, regions);
+    vk::ImageMemoryBarrier to_shader(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                                     vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                                     VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, field_image_, all_layers);
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                   kFieldReaders,
+                                   {}, nullptr, nullptr, to_shader);
+    region_uploads_ += regions.size();
+}
+
+void VulkanRenderer::updateWaferData(std::shared_ptr<Wafer> wafer) {
+    const FieldStore& fields = wafer->getFieldStore();
+    const uint32_t rows = static_cast<uint32_t>(fields.rows());
+    const uint32_t cols = static_cast<uint32_t>(fields.cols());
+    if (rows == 0 || cols == 0) {
+        throw std::invalid_argument("Wafer grid must be initialized before rendering");
+    }
+    // Nothing below may change under a frame still in flight
+    graphics_queue_.waitIdle();
+
+    bool rebind = false;
+    if (rows != field_rows_ || cols != field_cols_) {
+        resizeFields(rows, cols);
+        rebind = true;
+    }
+    for (uint32_t layer = 0; layer < kFieldLayers.size(); ++layer) {
+        if (fields.version(kFieldLayers[layer]) != uploaded_versions_[layer]) {
+            pyramid_dirty_ = pyramid_dirty_ || layer == 0;
+            uploadFieldLayer(fields, kFieldLayers[layer], layer);
+        }
+    }
+
+    // Dopant levels normalized over the profile, as one float per row
+    const Eigen::ArrayXd& dopant = wafer->getDopantProfile();
+    if (dopant_capacity_ == 0 || dopant.size() != uploaded_dopant_.size() || !(dopant == uploaded_dopant_).all()) {
+        Eigen::ArrayXf levels;
+        if (dopant.size() > 0) {
+            const double low = dopant.minCoeff();
+            const double range = dopant.maxCoeff() - low > 0 ? dopant.maxCoeff() - low : 1.0;
+            levels = ((dopant - low) / range).cast<float>();
+        }
+        const vk::DeviceSize old_capacity = dopant_capacity_;
+        uploadStorage(dopant_buffer_, dopant_memory_, dopant_capacity_, levels.data(), levels.size() * sizeof(float));
+        rebind = rebind || dopant_capacity_ != old_capacity;
+        uploaded_dopant_ = dopant;
+        field_params_.dopant_count = static_cast<int32_t>(levels.size());
+    }
+    const auto& wire_bonds = wafer->getWireBonds();
+    if (bond_capacity_ == 0 || wire_bonds != uploaded_bonds_) {
+        std::vector<int32_t> cells;
+        cells.reserve(wire_bonds.size() * 4);
+        for (const auto& wire : wire_bonds) {
+            cells.insert(cells.end(), {wire.first.first, wire.first.second, wire.second.first, wire.second.second});
+        }
+        const vk::DeviceSize old_capacity = bond_capacity_;
+        uploadStorage(bond_buffer_, bond_memory_, bond_capacity_, cells.data(), cells.size() * sizeof(int32_t));
+        rebind = rebind || bond_capacity_ != old_capacity;
+        uploaded_bonds_ = wire_bonds;
+        field_params_.bond_count = static_cast<int32_t>(wire_bonds.size());
+    }
+    if (rebind) {
+        updateDescriptors();
+    }
+
+    field_params_.material = wafer->getMaterialId() == "oxide" ? 1 : 0;
+    field_params_.flags = (wafer->getPackagingSubstrate().first > 0 ? 1 : 0) |
+                          (!wafer->getMetalLayers().empty() ? 2 : 0) |
+                          (!wafer->getFilmLayers().empty() ? 4 : 0);
+    // The last resistance listed, relative to the largest
+    double max_resistance = 0.0;
+    double resistance = 0.0;
+    for (const auto& prop : wafer->getElectricalProperties()) {
+        if (prop.first == "Resistance") {
+            max_resistance = std::max(max_resistance, prop.second);
+            resistance = prop.second;
+        }
+    }
+    field_params_.resistance_tint = static_cast<float>(resistance / (max_resistance > 0 ? max_resistance : 1.0));
+}
+
+VulkanRenderer::FieldRenderParams VulkanRenderer::sceneParams(RenderingMode mode, const std::string& reliability_metric,
+                                                              bool show_temp_overlay) const {
+    FieldRenderParams params = field_params_;
+    params.mode = static_cast<int32_t>(mode);
+    params.overlay = reliability_metric == "Electromigration" ? 1
+                   : reliability_metric == "Thermal Stress" ? 2
+                   : reliability_metric == "Dielectric Breakdown" ? 3 : 0;
+    params.flags |= show_temp_overlay ? 8 : 0;
+    params.relief = mode == VOLUMETRIC_RENDERING ? 0.15f : 0.0f;
+    return params;
+}
+
+bool VulkanRenderer::drawsVolume(const FieldRenderParams& params) const {
+    return params.mode == VOLUMETRIC_RENDERING && volumetric_enabled_ && volume_image_;
+}
+
+void VulkanRenderer::recordScene(vk::CommandBuffer command_buffer, const vk::RenderPassBeginInfo& pass_info,
+                                 const FieldRenderParams& params, vk::Buffer tiles, vk::DeviceSize tile_offset,
+                                 uint32_t tile_count) {
+    command_buffer.beginRenderPass(pass_info, vk::SubpassContents::eInline);
+    if (drawsVolume(params)) {
+        command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, volume_pipeline_);
+        command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, volume_pipeline_layout_, 0, volume_set_,
+                                          nullptr);
+        command_buffer.pushConstants(volume_pipeline_layout_, vk::ShaderStageFlagBits::eFragment, 0,
+                                     sizeof(VolumeRenderParams), &volume_params_);
+        command_buffer.draw(3, 1, 0, 0);
+    } else if (tile_count > 0) {
+        command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline_);
+        const std::array<vk::Buffer, 2> vertex_buffers = {vertex_buffer_, tiles};
+        const std::array<vk::DeviceSize, 2> offsets = {0, tile_offset};
+        command_buffer.bindVertexBuffers(0, 2, vertex_buffers.data(), offsets.data());
+        command_buffer.bindIndexBuffer(index_buffer_, 0, vk::IndexType::eUint32);
+        command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout_, 0, descriptor_set_, nullptr);
+        command_buffer.pushConstants(pipeline_layout_, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+                                     0, sizeof(FieldRenderParams), &params);
+        command_buffer.drawIndexed(index_count_, tile_count, 0, 0, 0);
+    }
+    command_buffer.endRenderPass();
+}
+
+void VulkanRenderer::writeTimestamp(vk::CommandBuffer command_buffer, GpuPass pass, bool end) {
+    const vk::QueryPool pool = frame_queries_[current_frame_].timestamps;
+    if (pool) {
+        command_buffer.writeTimestamp(end ? vk::PipelineStageFlagBits::eBottomOfPipe : vk::PipelineStageFlagBits::eTopOfPipe,
+                                      pool, 2 * pass + (end ? 1 : 0));
+    }
+}
+
+void VulkanRenderer::recordCommandBuffer(vk::CommandBuffer command_buffer, uint32_t image_index) {
+    const auto record_start = std::chrono::high_resolution_clock::now();
+    const FieldRenderParams params = sceneParams(rendering_mode_, reliability_metric_, show_temp_overlay_);
+    selectTiles(params);
+    const StagingSlot& tile_slot = tile_ring_[current_frame_];
+    std::memcpy(tile_slot.data, tiles_.data(), tiles_.size() * sizeof(TileInstance));
+
+    FrameQueries& queries = frame_queries_[current_frame_];
+    command_buffer.reset();
+    command_buffer.begin(vk::CommandBufferBeginInfo());
+    if (queries.timestamps) {
+        command_buffer.resetQueryPool(queries.timestamps, 0, 2 * kGpuPassCount);
+    }
+    if (queries.statistics) {
+        command_buffer.resetQueryPool(queries.statistics, 0, 1);
+    }
+    writeTimestamp(command_buffer, kUploadPass, false);
+    recordRegionUploads(command_buffer);
+    writeTimestamp(command_buffer, kUploadPass, true);
+    writeTimestamp(command_buffer, kPyramidPass, false);
+    recordHeightPyramid(command_buffer);
+    writeTimestamp(command_buffer, kPyramidPass, true);
+    vk::ClearValue clear(vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}));
+    vk::RenderPassBeginInfo pass_info(render_pass_, framebuffers_[image_index], vk::Rect2D({0, 0}, {width_, height_}),
+                                      1, &clear);
+    writeTimestamp(command_buffer, kScenePass, false);
+    if (queries.statistics) {
+        command_buffer.beginQuery(queries.statistics, 0, {});
+    }
+    recordScene(command_buffer, pass_info, params, tile_slot.buffer, 0, static_cast<uint32_t>(tiles_.size()));
+    if (queries.statistics) {
+        command_buffer.endQuery(queries.statistics, 0);
+    }
+    writeTimestamp(command_buffer, kScenePass, true);
+    command_buffer.end();
+
+    queries.pending = true;
+    queries.frame = frame_count_ + 1;
+    queries.cpu_record_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                                     record_start).count();
 }
 
 void VulkanRenderer::drawFrame() {
-    auto wait_result = device_.waitForFences(in_flight_fence_, true, UINT64_MAX);
+    const vk::Fence frame_fence = in_flight_fences_[current_frame_];
+    const auto wait_start = std::chrono::high_resolution_clock::now();
+    auto wait_result = device_.waitForFences(frame_fence, true, UINT64_MAX);
     if (wait_result != vk::Result::eSuccess) {
         throw std::runtime_error("Failed to wait for fences");
     }
-    device_.resetFences(in_flight_fence_);
-    uint32_t image_index = device_.acquireNextImageKHR(swapchain_, UINT64_MAX, image_available_semaphore_, {}).value;
-    vk::SubmitInfo submit_info(1, &image_available_semaphore_, nullptr, 1, &command_buffers_[image_index], 
-                               1, &render_finished_semaphore_);
-    graphics_queue_.submit(submit_info, in_flight_fence_);
-    vk::PresentInfoKHR present_info(1, &render_finished_semaphore_, 1, &swapchain_, &image_index);
+    collectFrameTimings(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                                 wait_start).count(),
+                        Profiler::getInstance().clockNs());
+    takeBridgeUpdates();
+    uint32_t image_index = device_.acquireNextImageKHR(swapchain_, UINT64_MAX,
+                                                       image_available_semaphores_[current_frame_], {}).value;
+    // The other frame may still be drawing to this swapchain image
+    if (images_in_flight_[image_index] && images_in_flight_[image_index] != frame_fence) {
+        wait_result = device_.waitForFences(images_in_flight_[image_index], true, UINT64_MAX);
+        if (wait_result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to wait for fences");
+        }
+    }
+    images_in_flight_[image_index] = frame_fence;
+    device_.resetFences(frame_fence);
+
+    recordCommandBuffer(command_buffers_[current_frame_], image_index);
+    vk::PipelineStageFlags wait_stage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    vk::SubmitInfo submit_info(1, &image_available_semaphores_[current_frame_], &wait_stage,
+                               1, &command_buffers_[current_frame_], 1, &render_finished_semaphores_[current_frame_]);
+    graphics_queue_.submit(submit_info, frame_fence);
+    frame_queries_[current_frame_].submitted_ns = Profiler::getInstance().clockNs();
+    vk::PresentInfoKHR present_info(1, &render_finished_semaphores_[current_frame_], 1, &swapchain_, &image_index);
     auto present_result = graphics_queue_.presentKHR(present_info);
     if (present_result != vk::Result::eSuccess) {
         throw std::runtime_error("Failed to present");
     }
+    current_frame_ = (current_frame_ + 1) % kFramesInFlight;
+    updatePerformanceMetrics();
+}
+
+void VulkanRenderer::updatePerformanceMetrics() const {
+    const auto now = std::chrono::high_resolution_clock::now();
+    if (frame_count_ > 0) {
+        last_render_time_ = std::chrono::duration<float, std::milli>(now - last_frame_time_).count();
+        const float rate = last_render_time_ > 0.0f ? 1000.0f / last_render_time_ : 0.0f;
+        frame_rate_ = frame_count_ == 1 ? rate : frame_rate_ + (rate - frame_rate_) / 30.0f;
+    }
+    last_frame_time_ = now;
+    ++frame_count_;
+}
+
+void VulkanRenderer::collectFrameTimings(float cpu_wait_ms, int64_t woke_ns) {
+    FrameQueries& queries = frame_queries_[current_frame_];
+    if (!queries.pending) {
+        return;
+    }
+    queries.pending = false;
+    FrameTimings timings;
+    timings.frame = queries.frame;
+    timings.cpu_record_ms = queries.cpu_record_ms;
+    timings.cpu_wait_ms = cpu_wait_ms;
+
+    std::array<uint64_t, 2 * kGpuPassCount> stamps = {};
+    if (queries.timestamps &&
+        device_.getQueryPoolResults(queries.timestamps, 0, 2 * kGpuPassCount, sizeof(stamps), stamps.data(),
+                                    sizeof(uint64_t), vk::QueryResultFlagBits::e64) == vk::Result::eSuccess) {
+        // Counters wrap at their valid bits
+        auto elapsed_ns = [this, &stamps](uint32_t from, uint32_t to) {
+            return static_cast<int64_t>(static_cast<double>((stamps[to] - stamps[from]) & timestamp_mask_) *
+                                        timestamp_period_ns_);
+        };
+        const uint32_t last = 2 * kGpuPassCount - 1;
+        timings.upload_ms = static_cast<float>(elapsed_ns(2 * kUploadPass, 2 * kUploadPass + 1) * 1e-6);
+        timings.pyramid_ms = static_cast<float>(elapsed_ns(2 * kPyramidPass, 2 * kPyramidPass + 1) * 1e-6);
+        timings.scene_ms = static_cast<float>(elapsed_ns(2 * kScenePass, 2 * kScenePass + 1) * 1e-6);
+        timings.gpu_ms = static_cast<float>(elapsed_ns(0, last) * 1e-6);
+        if (last_render_time_ > 0.0f) {
+            timings.gpu_busy = std::min(timings.gpu_ms / last_render_time_, 1.0f);
+        }
+        if (gpu_trace_) {
+            // GPU clocks are not the CPU's: the frame starts at its
+            // submission, or ends when the fence woke a waiting CPU
+            const int64_t start = cpu_wait_ms > 0.05f ? woke_ns - elapsed_ns(0, last) : queries.submitted_ns;
+            Profiler& profiler = Profiler::getInstance();
+            profiler.recordSpan(gpu_track_, gpu_zones_[kGpuPassCount], start, start + elapsed_ns(0, last));
+            for (uint32_t pass = 0; pass < kGpuPassCount; ++pass) {
+                profiler.recordSpan(gpu_track_, gpu_zones_[pass], start + elapsed_ns(0, 2 * pass),
+                                    start + elapsed_ns(0, 2 * pass + 1), 1);
+            }
+        }
+    }
+    std::array<uint64_t, 4> statistics = {};
+    if (queries.statistics &&
+        device_.getQueryPoolResults(queries.statistics, 0, 1, sizeof(statistics), statistics.data(),
+                                    sizeof(statistics), vk::QueryResultFlagBits::e64) == vk::Result::eSuccess) {
+        timings.input_primitives = statistics[0];
+        timings.vertex_invocations = statistics[1];
+        timings.clipping_primitives = statistics[2];
+        timings.fragment_invocations = statistics[3];
+    }
+    frame_timings_ = timings;
+    adaptQuality();
+}
+
+void VulkanRenderer::adaptQuality() {
+    const float gpu_ms = frame_timings_.gpu_ms;
+    if (frame_budget_ms_ <= 0.0f || gpu_ms <= 0.0f) {
+        return;
+    }
+    // The patch count, and with it most of the frame, goes with the square
+    // of the quality. A tenth of the step per frame keeps one slow frame
+    // from making the detail jump.
+    const float target = quality_level_ * std::sqrt(frame_budget_ms_ / gpu_ms);
+    setQualityLevel(quality_level_ + 0.1f * (target - quality_level_));
+}
+
+void VulkanRenderer::setQualityLevel(float quality) {
+    quality_level_ = std::clamp(quality, kMinQuality, 1.0f);
+}
+
+void VulkanRenderer::enableGpuTrace(bool enable) {
+    if (enable && !gpu_track_registered_) {
+        Profiler& profiler = Profiler::getInstance();
+        gpu_track_ = profiler.registerTrack("GPU");
+        gpu_zones_[kUploadPass] = profiler.registerZone("gpu/upload");
+        gpu_zones_[kPyramidPass] = profiler.registerZone("gpu/pyramid");
+        gpu_zones_[kScenePass] = profiler.registerZone("gpu/scene");
+        gpu_zones_[kGpuPassCount] = profiler.registerZone("gpu/frame");
+        gpu_track_registered_ = true;
+    }
+    gpu_trace_ = enable;
+}
+
+void VulkanRenderer::renderFrame(const std::shared_ptr<Wafer>& wafer) {
+    if (target_ == Target::Offscreen) {
+        throw std::logic_error("An offscreen renderer has no window to draw to; use exportImages");
+    }
+    updateWaferData(wafer);
+    glfwPollEvents();
+    drawFrame();
 }
 
 void VulkanRenderer::render(const std::shared_ptr<Wafer>& wafer, bool show_temp_overlay, 
                            const std::string& reliability_metric) {
-    createVertexBuffer(wafer->getGrid(), wafer->getDopantProfile(), wafer->getPhotoresistPattern(),
-                      wafer->getFilmLayers(), wafer->getMetalLayers(), wafer->getPackagingSubstrate(),
-                      wafer->getWireBonds(), wafer->getElectricalProperties(), wafer->getTemperatureProfile(),
-                      wafer->getElectromigrationMTTF(), wafer->getThermalStress(), wafer->getDielectricField(),
-                      wafer->getMaterialId(), show_temp_overlay, reliability_metric);
+    if (target_ == Target::Offscreen) {
+        throw std::logic_error("An offscreen renderer has no window to draw to; use exportImages");
+    }
+    show_temp_overlay_ = show_temp_overlay;
+    reliability_metric_ = reliability_metric;
+    updateWaferData(wafer);
     while (!glfwWindowShouldClose(window_)) {
         glfwPollEvents();
         drawFrame();
     }
 }
 
-GLFWwindow* VulkanRenderer::getWindow() const { return window_; }
\ No newline at end of file
+GLFWwindow* VulkanRenderer::getWindow() const { return window_; }
+
+void VulkanRenderer::createExportTarget() {
+    // As the window's pass, so the pipelines stay compatible, but ending
+    // ready to copy out
+    vk::AttachmentDescription color_attachment({}, vk::Format::eB8G8R8A8Unorm, vk::SampleCountFlagBits::e1,
+                                               vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
+                                               vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+                                               vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferSrcOptimal);
+    vk::AttachmentReference color_ref(0, vk::ImageLayout::eColorAttachmentOptimal);
+    vk::SubpassDescription subpass({}, vk::PipelineBindPoint::eGraphics, 0, nullptr, 1, &color_ref);
+    export_render_pass_ = device_.createRenderPass(vk::RenderPassCreateInfo({}, 1, &color_attachment, 1, &subpass));
+
+    export_image_ = device_.createImage(vk::ImageCreateInfo(
+        {}, vk::ImageType::e2D, vk::Format::eB8G8R8A8Unorm, vk::Extent3D(width_, height_, 1), 1, kExportLayers,
+        vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc));
+    vk::MemoryRequirements mem_reqs = device_.getImageMemoryRequirements(export_image_);
+    export_memory_ = device_.allocateMemory(vk::MemoryAllocateInfo(
+        mem_reqs.size, findMemoryType(mem_reqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)));
+    device_.bindImageMemory(export_image_, export_memory_, 0);
+    for (uint32_t layer = 0; layer < kExportLayers; ++layer) {
+        export_views_.push_back(device_.createImageView(vk::ImageViewCreateInfo(
+            {}, export_image_, vk::ImageViewType::e2D, vk::Format::eB8G8R8A8Unorm, {},
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, layer, 1))));
+        export_framebuffers_.push_back(device_.createFramebuffer(
+            vk::FramebufferCreateInfo({}, export_render_pass_, 1, &export_views_.back(), width_, height_, 1)));
+    }
+
+    const auto host = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    const vk::DeviceSize image_bytes = static_cast<vk::DeviceSize>(width_) * height_ * 4;
+    const vk::DeviceSize tile_bytes = kExportLayers * kMaxTiles * sizeof(TileInstance);
+    std::vector<vk::CommandBuffer> command_buffers = device_.allocateCommandBuffers(
+        vk::CommandBufferAllocateInfo(command_pool_, vk::CommandBufferLevel::ePrimary, kReadbackSlots));
+    for (uint32_t k = 0; k < kReadbackSlots; ++k) {
+        ReadbackSlot& slot = readback_slots_[k];
+        slot.command_buffer = command_buffers[k];
+        slot.fence = device_.createFence({});
+        createBuffer(kExportLayers * image_bytes, vk::BufferUsageFlagBits::eTransferDst, host, slot.buffer, slot.memory);
+        slot.data = static_cast<const uint8_t*>(device_.mapMemory(slot.memory, 0, kExportLayers * image_bytes));
+        createBuffer(tile_bytes, vk::BufferUsageFlagBits::eVertexBuffer, host, slot.tiles, slot.tile_memory);
+        slot.tile_data = static_cast<TileInstance*>(device_.mapMemory(slot.tile_memory, 0, tile_bytes));
+    }
+}
+
+void VulkanRenderer::destroyExportTarget() {
+    if (!export_image_) {
+        return;
+    }
+    for (ReadbackSlot& slot : readback_slots_) {
+        try {
+            finishReadback(slot);
+        } catch (const std::exception&) {
+            // Reported by the exportImages call that queued it
+        }
+        destroyBuffer(slot.buffer, slot.memory);
+        destroyBuffer(slot.tiles, slot.tile_memory);
+        device_.destroyFence(slot.fence);
+        device_.freeCommandBuffers(command_pool_, slot.command_buffer);
+    }
+    for (vk::Framebuffer framebuffer : export_framebuffers_) device_.destroyFramebuffer(framebuffer);
+    for (vk::ImageView view : export_views_) device_.destroyImageView(view);
+    device_.destroyImage(export_image_);
+    device_.freeMemory(export_memory_);
+    device_.destroyRenderPass(export_render_pass_);
+    export_framebuffers_.clear();
+    export_views_.clear();
+    export_image_ = nullptr;
+}
+
+void VulkanRenderer::dispatchEncodes(ReadbackSlot& slot) {
+    if (slot.files.empty() || !slot.encodes.empty() || device_.getFenceStatus(slot.fence) != vk::Result::eSuccess) {
+        return;
+    }
+    const uint32_t width = width_, height = height_;
+    const std::size_t image_bytes = static_cast<std::size_t>(width) * height * 4;
+    for (std::size_t layer = 0; layer < slot.files.size(); ++layer) {
+        const uint8_t* pixels = slot.data + layer * image_bytes;
+        const std::string file = slot.files[layer];
+        slot.encodes.push_back(TaskScheduler::getInstance().submit([pixels, width, height, image_bytes, file]() {
+            // The target is BGRA
+            std::vector<uint8_t> rgba(pixels, pixels + image_bytes);
+            for (std::size_t i = 0; i < image_bytes; i += 4) {
+                std::swap(rgba[i], rgba[i + 2]);
+            }
+            PngWriter::write(file, rgba.data(), width, height);
+        }));
+    }
+}
+
+void VulkanRenderer::finishReadback(ReadbackSlot& slot) {
+    if (slot.files.empty()) {
+        return;
+    }
+    if (device_.waitForFences(slot.fence, true, UINT64_MAX) != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to wait for fences");
+    }
+    dispatchEncodes(slot);
+    // Every encode reads the slot's buffer, so all must finish before a
+    // failure is passed on
+    std::exception_ptr failure;
+    for (std::future<void>& encode : slot.encodes) {
+        try {
+            TaskScheduler::getInstance().wait(encode);
+        } catch (...) {
+            if (!failure) failure = std::current_exception();
+        }
+    }
+    slot.encodes.clear();
+    slot.files.clear();
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+void VulkanRenderer::exportImages(const std::vector<ExportView>& views) {
+    if (!device_) {
+        throw std::logic_error("exportImages needs an initialized renderer");
+    }
+    for (const ExportView& view : views) {
+        if (!(view.zoom > 0.0f)) {
+            throw std::invalid_argument("View zoom must be positive");
+        }
+    }
+    if (!export_image_) {
+        createExportTarget();
+    }
+    const vk::Rect2D area({0, 0}, {width_, height_});
+    vk::ClearValue clear(vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}));
+    std::exception_ptr failure;
+    auto finish = [&](ReadbackSlot& slot) {
+        try {
+            finishReadback(slot);
+        } catch (...) {
+            if (!failure) failure = std::current_exception();
+        }
+    };
+
+    for (std::size_t first = 0; first < views.size();) {
+        std::size_t last = first + 1;
+        while (last < views.size() && last - first < kExportLayers && views[last].wafer == views[first].wafer) {
+            ++last;
+        }
+        ReadbackSlot& slot = readback_slots_[next_readback_];
+        next_readback_ = (next_readback_ + 1) % kReadbackSlots;
+        finish(slot);
+        if (views[first].wafer) {
+            updateWaferData(views[first].wafer);
+        }
+        if (field_rows_ == 0) {
+            throw std::logic_error("No wafer fields to export");
+        }
+        // Batches already copied out encode while this one renders
+        for (ReadbackSlot& other : readback_slots_) {
+            dispatchEncodes(other);
+        }
+
+        vk::CommandBuffer command_buffer = slot.command_buffer;
+        command_buffer.reset();
+        command_buffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        recordHeightPyramid(command_buffer);
+        // An earlier batch may still be copying the layers out
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                       vk::PipelineStageFlagBits::eColorAttachmentOutput, {}, nullptr, nullptr, nullptr);
+        for (std::size_t k = first; k < last; ++k) {
+            const ExportView& view = views[k];
+            const uint32_t layer = static_cast<uint32_t>(k - first);
+            FieldRenderParams params = sceneParams(view.mode, view.reliability_metric, view.show_temp_overlay);
+            params.view_row = view.center_row;
+            params.view_col = view.center_col;
+            params.zoom = view.zoom;
+            selectTiles(params);
+            std::copy(tiles_.begin(), tiles_.end(), slot.tile_data + layer * kMaxTiles);
+            recordScene(command_buffer, vk::RenderPassBeginInfo(export_render_pass_, export_framebuffers_[layer], area, 1, &clear),
+                        params, slot.tiles, layer * kMaxTiles * sizeof(TileInstance), static_cast<uint32_t>(tiles_.size()));
+            slot.files.push_back(view.filename);
+        }
+        const uint32_t layers = static_cast<uint32_t>(last - first);
+        vk::ImageMemoryBarrier rendered(vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eTransferRead,
+                                        vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eTransferSrcOptimal,
+                                        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, export_image_,
+                                        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, layers));
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                                       vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, rendered);
+        vk::BufferImageCopy region(0, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, layers),
+                                   vk::Offset3D(0, 0, 0), vk::Extent3D(width_, height_, 1));
+        command_buffer.copyImageToBuffer(export_image_, vk::ImageLayout::eTransferSrcOptimal, slot.buffer, region);
+        command_buffer.end();
+        device_.resetFences(slot.fence);
+        graphics_queue_.submit(vk::SubmitInfo(0, nullptr, nullptr, 1, &command_buffer), slot.fence);
+        first = last;
+    }
+    for (ReadbackSlot& slot : readback_slots_) {
+        finish(slot);
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+void VulkanRenderer::exportImage(const std::string& filename, int width, int height) {
+    if (width != static_cast<int>(width_) || height != static_cast<int>(height_)) {
+        throw std::invalid_argument("Exported images are rendered at the renderer's size");
+    }
+    ExportView view;
+    view.mode = rendering_mode_;
+    view.reliability_metric = reliability_metric_;
+    view.show_temp_overlay = show_temp_overlay_;
+    view.center_row = field_params_.view_row;
+    view.center_col = field_params_.view_col;
+    view.zoom = field_params_.zoom;
+    view.filename = filename;
+    exportImages({view});
+}
+
+void VulkanRenderer::exportSTL(const std::shared_ptr<Wafer>& wafer, const std::string& filename) {
+    if (!wafer) {
+        throw std::invalid_argument("Wafer pointer is null");
+    }
+    const Wafer& source = *wafer;
+    const ConstFieldView grid = source.getGrid();
+    const std::unique_ptr<MeshSink> sink = openMeshWriter(filename);
+    meshHeightField(grid, static_cast<float>(source.getDiameter() / grid.rows()),
+                    static_cast<float>(source.getDiameter() / grid.cols()), *sink);
+}
@@ -1,27 +1,77 @@
 // Author: Dr. Mazharuddin Mohammed
 #pragma once
 #include "../../core/wafer.hpp"
+#include "../../core/field_update_bridge.hpp"
+#include "../../core/field_volume.hpp"
+#include "../../core/profiler.hpp"
 #include <vulkan/vulkan.hpp>
 #include <GLFW/glfw3.h>
 #include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <vector>
 #include <string>
 #include <chrono>
 #include <memory>
 
-struct Vertex {
-    std::array<float, 2> position;
-    std::array<float, 3> color;
-};
-
+// Renders a wafer from GPU-resident fields. The wafer's field channels live
+// as layers of one R32F texture array, uploaded through a staging buffer
+// only when FieldStore reports a new version of the channel. The fragment
+// shader colormaps each field cell. Overlays and the rendering mode are
+// push constants, so switching them never touches the uploaded fields.
+//
+// Geometry is a quadtree of instanced 33 x 33 vertex patches, chosen each
+// frame for the current view: a tile is split until its quads cover at
+// most four pixels (more below quality level 1) or one field cell, and
+// tiles outside the view are culled, so the tile count, and the frame
+// time, depend on the framebuffer rather than the grid. A compute pass
+// keeps a min/max pyramid of the height layer, rebuilt when the grid
+// changes; a patch samples it at the level matching its cells per quad
+// (the highest point under each vertex, so peaks do not alias away), and
+// its top level gives the exact height range that scales the relief.
+//
+// In volumetric mode, with volumetric rendering enabled, a FieldVolume
+// set on the renderer (a dopant or temperature volume, say) is drawn
+// instead by ray marching it in the fragment shader. The volume lives in
+// a half-float 3D texture, normalized to its range, beside a byte per 8^3
+// brick marking the bricks the transfer function can show: rays step
+// over empty bricks whole, and stop once nearly opaque. Colour and
+// opacity come from the transfer function sampled into a 1D table, so
+// changing it re-uploads the table and occupancy but never the volume.
+//
+// Images are exported through an offscreen target: a layered colour image
+// that a batch of views renders into, one layer each, within one command
+// buffer. A batch is copied into one of a small pool of mapped readback
+// buffers, and each image is encoded as PNG on the TaskScheduler while
+// later batches render. An Offscreen renderer creates no window, surface
+// or swapchain, for exports on headless nodes.
+//
+// For live rendering, simulation threads publish dirty rectangles to a
+// FieldUpdateBridge. Each frame takes the pending updates and copies only
+// those regions into the texture, from a ring of persistently mapped
+// staging buffers (one per frame in flight), in the frame's own command
+// buffer. Neither side waits on the other: the simulation only copies its
+// rectangles under the bridge's lock, and updates that do not fit in a
+// frame's staging buffer wait for the next frame.
 class VulkanRenderer {
 public:
-    VulkanRenderer(uint32_t width, uint32_t height);
+    enum class Target { Window, Offscreen };
+
+    VulkanRenderer(uint32_t width, uint32_t height, Target target = Target::Window);
     ~VulkanRenderer();
     void initialize();
     void render(const std::shared_ptr<Wafer>& wafer, bool show_temp_overlay = false,
                 const std::string& reliability_metric = ""); // MODIFIED
-    GLFWwindow* getWindow() const;
+    // Uploads what changed since the last frame and draws one frame, for
+    // live monitoring
+    void renderFrame(const std::shared_ptr<Wafer>& wafer);
+    GLFWwindow* getWindow() const; // Null when offscreen
+    // Once set, frames apply the bridge's updates; the wafer passed to
+    // render() is then only read for the initial upload
+    void setUpdateBridge(std::shared_ptr<FieldUpdateBridge> bridge) { update_bridge_ = std::move(bridge); }
 
     // Enhanced visualization features
     enum RenderingMode {
@@ -33,68 +83,385 @@ public:
         STRESS_ANALYSIS
     };
 
+    // One image of a batch export, at the renderer's size
+    struct ExportView {
+        std::shared_ptr<Wafer> wafer; // Null renders the fields last uploaded
+        RenderingMode mode = SURFACE_RENDERING;
+        std::string reliability_metric;
+        bool show_temp_overlay = false;
+        float center_row = 0.5f;
+        float center_col = 0.5f;
+        float zoom = 1.0f;
+        std::string filename; // PNG
+    };
+
     void setRenderingMode(RenderingMode mode) { rendering_mode_ = mode; }
+    // Centre of the view in [0, 1] along rows and columns; zoom 1 fits the
+    // whole wafer
+    void setView(float center_row, float center_col, float zoom);
     void enableBloom(bool enable) { bloom_enabled_ = enable; }
     void enableAntiAliasing(bool enable) { anti_aliasing_enabled_ = enable; }
-    void setQualityLevel(float quality) { quality_level_ = quality; }
+    // Detail of the surface patches: quality 1 splits tiles down to
+    // kPixelsPerQuad pixels per quad, lower quality proportionally coarser.
+    // Clamped to [kMinQuality, 1].
+    void setQualityLevel(float quality);
+    float getQualityLevel() const { return quality_level_; }
+    // GPU milliseconds per frame to aim for: after each completed frame the
+    // quality level moves toward the level expected to meet the budget.
+    // 0 turns the adaptation off.
+    void setFrameBudget(float budget_ms) { frame_budget_ms_ = std::max(budget_ms, 0.0f); }
     void enableVolumetricRendering(bool enable) { volumetric_enabled_ = enable; }
+    // Replaces the volume drawn in volumetric mode; needs initialize()
+    void setVolume(const FieldVolume& volume, const TransferFunction& transfer);
+    void setTransferFunction(const TransferFunction& transfer); // Needs a volume
+    // Orbit about the volume's centre: yaw around the surface normal and
+    // pitch above the surface in radians, distance in the volume's longest
+    // side
+    void setVolumeCamera(float yaw, float pitch, float distance);
+    // Opacity per cell crossed, as a multiple of the transfer function's
+    void setVolumeDensity(float density) { volume_params_.density = density; }
+    void setTemperatureOverlay(bool enable) { show_temp_overlay_ = enable; }
+    // "Electromigration", "Thermal Stress", "Dielectric Breakdown" or empty
+    void setReliabilityMetric(const std::string& metric) { reliability_metric_ = metric; }
 
-    // Performance monitoring
+    // Performance monitoring: frames per second averaged over about 30
+    // frames, and the last frame's time in ms
     float getFrameRate() const { return frame_rate_; }
     float getRenderTime() const { return last_render_time_; }
+
+    // The last completed window frame, from timestamp and pipeline
+    // statistics queries read back once its fence signalled. GPU fields
+    // stay zero on devices without the queries. Bloom and anti-aliasing
+    // record no passes yet, so they have no entries.
+    struct FrameTimings {
+        uint64_t frame = 0;            // Frame number, from 1
+        float upload_ms = 0.0f;        // Dirty regions copied into the field texture
+        float pyramid_ms = 0.0f;       // Height pyramid compute pass
+        float scene_ms = 0.0f;         // Surface or volume render pass
+        float gpu_ms = 0.0f;           // First timestamp to last
+        float cpu_record_ms = 0.0f;    // Recording the frame's command buffer
+        float cpu_wait_ms = 0.0f;      // Blocked on the frame's fence
+        // GPU time over the frame interval: near 1 the GPU bounds the frame
+        // rate, well below with little fence wait the CPU does
+        float gpu_busy = 0.0f;
+        uint64_t input_primitives = 0; // Scene pass pipeline statistics
+        uint64_t vertex_invocations = 0;
+        uint64_t clipping_primitives = 0;
+        uint64_t fragment_invocations = 0;
+    };
+    const FrameTimings& getFrameTimings() const { return frame_timings_; }
+    // Also records each frame's GPU passes on a "GPU" Profiler track, placed
+    // on the profiler clock at the frame's submission (or at its fence, if
+    // the CPU waited on it), so Profiler::exportChromeTrace shows them with
+    // the simulation's zones
+    void enableGpuTrace(bool enable);
+    size_t getTileCount() const { return tiles_.size(); } // Patches drawn last frame
+    // Field layers, and dirty rectangles, uploaded since initialize()
+    uint64_t getFieldUploadCount() const { return field_uploads_; }
+    uint64_t getRegionUploadCount() const { return region_uploads_; }
+    // Renders the views offscreen and writes each as a PNG. Consecutive
+    // views of one wafer share a command buffer, up to kExportLayers; the
+    // wafer's fields are uploaded once for them. Returns once every file
+    // is written, rethrowing the first encoding or write failure.
+    void exportImages(const std::vector<ExportView>& views);
+    // The current wafer and settings; width and height must be the
+    // renderer's
     void exportImage(const std::string& filename, int width, int height);
+    // The wafer's surface as a closed solid down to z = 0, meshed on the
+    // CPU by meshHeightField and streamed to binary STL or PLY by the
+    // file's extension
     void exportSTL(const std::shared_ptr<Wafer>& wafer, const std::string& filename);
 
 private:
+    static constexpr uint32_t kFramesInFlight = 2;
+    static constexpr uint32_t kPatchQuads = 32;       // Quads along a patch side
+    static constexpr float kPixelsPerQuad = 4.0f;     // Split tiles whose quads are larger
+    static constexpr uint32_t kMaxTiles = 4096;
+    static constexpr uint32_t kMaxPyramidLevels = 16; // Grids up to 131072 cells a side
+    static constexpr uint32_t kTransferEntries = 256;
+    static constexpr vk::DeviceSize kVolumeSlabBytes = 64ull << 20; // Staging for volume uploads
+    static constexpr uint32_t kExportLayers = 8;  // Views per export command buffer
+    static constexpr uint32_t kReadbackSlots = 3; // Export batches in flight or encoding
+    static constexpr float kMinQuality = 0.125f;
+
+    // Timed passes of a window frame, a timestamp pair each
+    enum GpuPass : uint32_t { kUploadPass, kPyramidPass, kScenePass, kGpuPassCount };
+
+    // Wafer channels held in the field texture, in layer order
+    static constexpr std::array<Wafer::FieldChannel, 6> kFieldLayers = {
+        Wafer::kGridField, Wafer::kPhotoresistField, Wafer::kTemperatureField,
+        Wafer::kElectromigrationMTTFField, Wafer::kThermalStressField, Wafer::kDielectricFieldField};
+
+    // Push constants of wafer.vert and wafer.frag, in their declared order
+    struct FieldRenderParams {
+        int32_t rows = 0;             // Field cells
+        int32_t cols = 0;
+        int32_t mode = 0;             // RenderingMode
+        int32_t overlay = 0;          // 1 electromigration, 2 thermal stress, 3 dielectric breakdown
+        int32_t material = 0;         // 0 silicon, 1 oxide
+        int32_t flags = 0;            // Packaging, metal layers, film layers, temperature overlay
+        int32_t dopant_count = 0;
+        int32_t bond_count = 0;
+        float resistance_tint = 0.0f; // Last resistance over the largest, for metal
+        float relief = 0.0f;          // Height displacement in clip space
+        float view_row = 0.5f;        // View centre in wafer coordinates [0, 1]
+        float view_col = 0.5f;
+        float zoom = 1.0f;            // 1 fits the whole wafer
+    };
+
+    // Push constants of volume.frag. The camera is in volume space, the box
+    // [0, extent]; right and up are scaled to the view's half-width and
+    // half-height at unit distance.
+    struct VolumeRenderParams {
+        float eye[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float right[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float up[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float forward[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float extent[4] = {1.0f, 1.0f, 1.0f, 0.0f}; // Longest side 1
+        float value_scale = 1.0f;                   // Stored value to transfer coordinate
+        float value_offset = 0.0f;
+        float density = 1.0f;
+    };
+
+    // Persistently mapped upload buffer
+    struct StagingSlot {
+        vk::Buffer buffer;
+        vk::DeviceMemory memory;
+        float* data = nullptr;
+        vk::DeviceSize capacity = 0;
+    };
+
+    // Patch vertex in [0, 1], rows then columns
+    struct PatchVertex {
+        float uv[2];
+    };
+
+    // Per-instance placement of a patch: origin over the wafer in [0, 1],
+    // side, and the height level it samples (0 is the field itself)
+    struct TileInstance {
+        float origin[2];
+        float size;
+        float level;
+    };
+
+    // Export batch: its command buffer, the tiles of each view, and the
+    // mapped buffer its layers are copied to, busy until its files are
+    // encoded
+    struct ReadbackSlot {
+        vk::CommandBuffer command_buffer;
+        vk::Fence fence;
+        vk::Buffer buffer;
+        vk::DeviceMemory memory;
+        const uint8_t* data = nullptr;
+        vk::Buffer tiles;
+        vk::DeviceMemory tile_memory;
+        TileInstance* tile_data = nullptr;
+        std::vector<std::string> files; // Layer order; empty when idle
+        std::vector<std::future<void>> encodes;
+    };
+
     void createInstance();
     void setupDevice();
     void createSwapchain();
     void createRenderPass();
+    void createDescriptors();
     void createPipeline();
     void createFramebuffers();
     void createCommandBuffers();
-    void createVertexBuffer(const Eigen::ArrayXXd& grid, const Eigen::ArrayXd& dopant_profile,
-                           const Eigen::ArrayXXd& photoresist_pattern,
-                           const std::vector<std::pair<double, std::string>>& film_layers,
-                           const std::vector<std::pair<double, std::string>>& metal_layers,
-                           const std::pair<double, std::string>& packaging_substrate,
-                           const std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>>& wire_bonds,
-                           const std::vector<std::pair<std::string, double>>& electrical_properties,
-                           const Eigen::ArrayXXd& temperature_profile,
-                           const Eigen::ArrayXXd& electromigration_mttf,
-                           const Eigen::ArrayXXd& thermal_stress,
-                           const Eigen::ArrayXXd& dielectric_field,
-                           const std::string& material_id,
-                           bool show_temp_overlay,
-                           const std::string& reliability_metric); // MODIFIED
     void loadShaders();
     void drawFrame();
+    void recordCommandBuffer(vk::CommandBuffer command_buffer, uint32_t image_index);
+    FieldRenderParams sceneParams(RenderingMode mode, const std::string& reliability_metric,
+                                  bool show_temp_overlay) const;
+    bool drawsVolume(const FieldRenderParams& params) const;
+    // One render pass drawing the volume, or `tile_count` patches from `tiles`
+    void recordScene(vk::CommandBuffer command_buffer, const vk::RenderPassBeginInfo& pass_info,
+                     const FieldRenderParams& params, vk::Buffer tiles, vk::DeviceSize tile_offset,
+                     uint32_t tile_count);
+
+    // Field residency
+    uint32_t findMemoryType(uint32_t type_bits, vk::MemoryPropertyFlags properties) const;
+    void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                      vk::Buffer& buffer, vk::DeviceMemory& memory);
+    void destroyBuffer(vk::Buffer& buffer, vk::DeviceMemory& memory);
+    // Allocates the texture cleared to zero, and the staging ring
+    void createFieldTexture(uint32_t rows, uint32_t cols);
+    void destroyFieldTexture();
+    // Texture and pyramid for a new field shape; deferred updates are dropped
+    void resizeFields(uint32_t rows, uint32_t cols);
+    int fieldLayer(int channel) const; // -1 if the channel is not rendered
+    void takeBridgeUpdates();
+    // Copies the deferred updates that fit in this frame's staging slot
+    void recordRegionUploads(vk::CommandBuffer command_buffer);
+    void createPatchMesh();
+    void createHeightPyramid(uint32_t rows, uint32_t cols);
+    void destroyHeightPyramid();
+    void recordHeightPyramid(vk::CommandBuffer command_buffer);
+    void selectTiles(const FieldRenderParams& params); // None under a volume
+    void uploadFieldLayer(const FieldStore& fields, int channel, uint32_t layer);
+    // Grows a host-visible storage buffer to hold `bytes` and copies them in
+    void uploadStorage(vk::Buffer& buffer, vk::DeviceMemory& memory, vk::DeviceSize& capacity,
+                       const void* data, vk::DeviceSize bytes);
+    void updateDescriptors();
+    // Volume rendering
+    void createVolumeImage(vk::ImageType type, vk::Format format, vk::Extent3D extent, vk::Image& image,
+                           vk::DeviceMemory& memory, vk::ImageView& view);
+    void destroyVolumeImage(vk::Image& image, vk::DeviceMemory& memory, vk::ImageView& view);
+    // Fills the image from `fill(texels, first_slice, slices)`, a slab of
+    // slices at a time, and leaves it ready for sampling
+    void uploadVolumeImage(vk::Image image, vk::Extent3D extent, vk::DeviceSize texel_bytes,
+                           const std::function<void(void*, uint32_t, uint32_t)>& fill);
+    void updateVolumeCamera();
+    // Offscreen export
+    void createExportTarget();
+    void destroyExportTarget();
+    // Queues the slot's PNG encodes once its copies have completed
+    void dispatchEncodes(ReadbackSlot& slot);
+    // Waits for the slot's batch and encodes, leaving it idle
+    void finishReadback(ReadbackSlot& slot);
+    void submitOnce(const std::function<void(vk::CommandBuffer)>& record);
 
     uint32_t width_;
     uint32_t height_;
-    GLFWwindow* window_;
+    Target target_;
+    GLFWwindow* window_ = nullptr;
     vk::Instance instance_;
     vk::PhysicalDevice physical_device_;
     vk::Device device_;
+    uint32_t queue_family_index_ = 0;
     vk::Queue graphics_queue_;
     vk::SurfaceKHR surface_;
     vk::SwapchainKHR swapchain_;
     std::vector<vk::Image> swapchain_images_;
     std::vector<vk::ImageView> swapchain_image_views_;
     vk::RenderPass render_pass_;
+    vk::ShaderModule vertex_shader_;
+    vk::ShaderModule fragment_shader_;
+    vk::ShaderModule pyramid_shader_;
+    vk::ShaderModule volume_vertex_shader_;
+    vk::ShaderModule volume_fragment_shader_;
+    vk::DescriptorSetLayout descriptor_set_layout_;
+    vk::DescriptorPool descriptor_pool_;
+    vk::DescriptorSet descriptor_set_;
     vk::PipelineLayout pipeline_layout_;
     vk::Pipeline pipeline_;
+    vk::DescriptorSetLayout pyramid_set_layout_;
+    std::array<vk::DescriptorSet, kMaxPyramidLevels> pyramid_sets_; // One per level built
+    vk::PipelineLayout pyramid_pipeline_layout_;
+    vk::Pipeline pyramid_pipeline_;
+    vk::DescriptorSetLayout volume_set_layout_;
+    vk::DescriptorSet volume_set_;
+    vk::PipelineLayout volume_pipeline_layout_;
+    vk::Pipeline volume_pipeline_;
     std::vector<vk::Framebuffer> framebuffers_;
     vk::CommandPool command_pool_;
+    // One command buffer, semaphore pair, fence and staging slot per frame
+    // in flight
     std::vector<vk::CommandBuffer> command_buffers_;
+    std::array<vk::Semaphore, kFramesInFlight> image_available_semaphores_;
+    std::array<vk::Semaphore, kFramesInFlight> render_finished_semaphores_;
+    std::array<vk::Fence, kFramesInFlight> in_flight_fences_;
+    std::array<StagingSlot, kFramesInFlight> staging_ring_;
+    std::array<StagingSlot, kFramesInFlight> tile_ring_; // TileInstance arrays
+    std::vector<vk::Fence> images_in_flight_; // Fence of the frame using each swapchain image
+    uint32_t current_frame_ = 0;
+
+    // Per frame in flight: timestamp and pipeline statistics queries, and
+    // the CPU side of the frame, kept until its fence signals
+    struct FrameQueries {
+        vk::QueryPool timestamps;
+        vk::QueryPool statistics;
+        bool pending = false;
+        uint64_t frame = 0;
+        float cpu_record_ms = 0.0f;
+        int64_t submitted_ns = 0; // Profiler clock
+    };
+    std::array<FrameQueries, kFramesInFlight> frame_queries_;
+    float timestamp_period_ns_ = 0.0f; // 0 without timestamp support
+    uint64_t timestamp_mask_ = 0;
+    bool pipeline_statistics_ = false;
+    FrameTimings frame_timings_;
+    float frame_budget_ms_ = 0.0f;
+    bool gpu_trace_ = false;
+    ProfileTrackId gpu_track_ = 0;
+    bool gpu_track_registered_ = false;
+    std::array<ProfileZoneId, kGpuPassCount + 1> gpu_zones_ = {}; // The passes, then the whole frame
+
+    // Field texture, one layer per kFieldLayers entry
+    vk::Image field_image_;
+    vk::DeviceMemory field_image_memory_;
+    vk::ImageView field_image_view_;
+    vk::Sampler field_sampler_;
+    uint32_t field_rows_ = 0;
+    uint32_t field_cols_ = 0;
+    std::array<uint64_t, kFieldLayers.size()> uploaded_versions_{};
+    uint64_t field_uploads_ = 0;
+    uint64_t region_uploads_ = 0;
+
+    // Min/max heights (RG32F); level k covers 2^(k+1) field cells a side
+    vk::Image pyramid_image_;
+    vk::DeviceMemory pyramid_memory_;
+    vk::ImageView pyramid_view_;
+    std::vector<vk::ImageView> pyramid_level_views_;
+    bool pyramid_dirty_ = false;
+
+    // Volume (R16F, normalized to volume_range_), brick occupancy (R8UI)
+    // and transfer table (RGBA16F)
+    vk::Image volume_image_;
+    vk::DeviceMemory volume_memory_;
+    vk::ImageView volume_view_;
+    vk::Image occupancy_image_;
+    vk::DeviceMemory occupancy_memory_;
+    vk::ImageView occupancy_view_;
+    vk::Image transfer_image_;
+    vk::DeviceMemory transfer_memory_;
+    vk::ImageView transfer_view_;
+    vk::Sampler volume_sampler_;
+    BrickMap volume_bricks_;
+    std::pair<float, float> volume_range_{0.0f, 1.0f};
+    VolumeRenderParams volume_params_;
+    float volume_yaw_ = 0.6f;
+    float volume_pitch_ = 0.5f;
+    float volume_distance_ = 2.0f;
+
+    // Offscreen target, one layer, view and framebuffer per batch slot; its
+    // render pass leaves the layers ready to copy
+    vk::RenderPass export_render_pass_;
+    vk::Image export_image_;
+    vk::DeviceMemory export_memory_;
+    std::vector<vk::ImageView> export_views_;
+    std::vector<vk::Framebuffer> export_framebuffers_;
+    std::array<ReadbackSlot, kReadbackSlots> readback_slots_;
+    uint32_t next_readback_ = 0;
+
+    // Updates taken from the bridge and not yet copied, oldest first
+    std::shared_ptr<FieldUpdateBridge> update_bridge_;
+    std::vector<FieldUpdate> deferred_updates_;
+
+    // Patch mesh and the tiles selected for the current frame
     vk::Buffer vertex_buffer_;
     vk::DeviceMemory vertex_buffer_memory_;
-    vk::Semaphore image_available_semaphore_;
-    vk::Semaphore render_finished_semaphore_;
-    vk::Fence in_flight_fence_;
+    vk::Buffer index_buffer_;
+    vk::DeviceMemory index_buffer_memory_;
+    uint32_t index_count_ = 0;
+    std::vector<TileInstance> tiles_;
+
+    // Per-row dopant level in [0, 1] and wire bond cells (ivec4 each),
+    // re-uploaded only when they change
+    vk::Buffer dopant_buffer_;
+    vk::DeviceMemory dopant_memory_;
+    vk::DeviceSize dopant_capacity_ = 0;
+    vk::Buffer bond_buffer_;
+    vk::DeviceMemory bond_memory_;
+    vk::DeviceSize bond_capacity_ = 0;
+    Eigen::ArrayXd uploaded_dopant_;
+    std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>> uploaded_bonds_;
+    FieldRenderParams field_params_;
 
     // Enhanced rendering features
     RenderingMode rendering_mode_ = SURFACE_RENDERING;
+    bool show_temp_overlay_ = false;
+    std::string reliability_metric_;
     bool bloom_enabled_ = false;
     bool anti_aliasing_enabled_ = true;
     bool volumetric_enabled_ = false;
@@ -106,14 +473,15 @@ private:
     mutable uint32_t frame_count_ = 0;
     mutable std::chrono::high_resolution_clock::time_point last_frame_time_;
 
-    // Vertex structure
-    struct Vertex {
-        float pos[2];
-        float color[3];
-    };
-
     // Enhanced rendering methods
     void updatePerformanceMetrics() const;
+    void createQueryPools();
+    void writeTimestamp(vk::CommandBuffer command_buffer, GpuPass pass, bool end);
+    // Reads back the queries of the frame last drawn in the current slot,
+    // whose fence has just signalled after the CPU waited cpu_wait_ms on it
+    // and woke at woke_ns on the profiler clock
+    void collectFrameTimings(float cpu_wait_ms, int64_t woke_ns);
+    void adaptQuality();
     void beginFrame();
     void endFrame();
     void renderSurface(std::shared_ptr<Wafer> wafer);
@@ -123,5 +491,6 @@ private:
     void renderDopantDistribution(std::shared_ptr<Wafer> wafer);
     void applyBloomEffect();
     void applyAntiAliasing();
+    // Uploads the fields and profiles that changed since the last call
     void updateWaferData(std::shared_ptr<Wafer> wafer);
-};
\ No newline at end of file
+};
@@ -1,13 +1,93 @@
 #include "visualization_engine.hpp"
+#include "../core/json_value.hpp"
+#include "../core/task_scheduler.hpp"
 #include <algorithm>
 #include <cmath>
 #include <chrono>
+#include <future>
+#include <limits>
 #include <numeric>
 #include <iomanip>
 #include <filesystem>
 
 namespace SemiPRO {
 
+namespace {
+
+// A series decimated together with its x axis
+struct ReducedSeries {
+    std::string name;
+    std::string x_name;  // Empty when plotted against the index
+    size_t full_length = 0;
+    std::vector<float> x;
+    std::vector<float> y;
+};
+
+// Every series but the x axes, "time" and "generation", each against
+// whichever of them is present, in name order
+std::vector<ReducedSeries> reduceSeries(const VisualizationData& data, size_t max_points) {
+    const std::vector<double>* x_axis = nullptr;
+    std::string x_name;
+    for (const char* name : {"time", "generation"}) {
+        auto it = data.series.find(name);
+        if (it != data.series.end()) {
+            x_axis = &it->second;
+            x_name = name;
+            break;
+        }
+    }
+    std::vector<std::string> names;
+    for (const auto& series : data.series) {
+        if (series.first != "time" && series.first != "generation") {
+            names.push_back(series.first);
+        }
+    }
+    std::sort(names.begin(), names.end());
+
+    std::vector<ReducedSeries> reduced;
+    for (const auto& name : names) {
+        const std::vector<double>& y = data.series.at(name);
+        const bool paired = x_axis && x_axis->size() == y.size();
+        ReducedSeries part;
+        part.name = name;
+        part.x_name = paired ? x_name : "";
+        part.full_length = y.size();
+        for (size_t i : VisualizationUtils::decimateSeries(paired ? *x_axis : std::vector<double>(), y, max_points)) {
+            part.x.push_back(static_cast<float>(paired ? (*x_axis)[i] : static_cast<double>(i)));
+            part.y.push_back(static_cast<float>(y[i]));
+        }
+        reduced.push_back(std::move(part));
+    }
+    return reduced;
+}
+
+std::string base64Floats(const std::vector<float>& values) {
+    return VisualizationUtils::encodeBase64(values.data(), values.size() * sizeof(float));
+}
+
+// The samples from `from` on that every ring still holds, one column per
+// ring, all starting at the returned sample number
+uint64_t readAligned(const std::vector<std::unique_ptr<SampleRing>>& rings, uint64_t from,
+                     std::vector<std::vector<double>>& columns) {
+    columns.resize(rings.size());
+    std::vector<uint64_t> firsts(rings.size());
+    uint64_t begin = from;
+    uint64_t end = std::numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < rings.size(); ++i) {
+        firsts[i] = rings[i]->read(from, columns[i]);
+        begin = std::max(begin, firsts[i]);
+        end = std::min(end, firsts[i] + columns[i].size());
+    }
+    end = std::max(begin, end);
+    for (size_t i = 0; i < rings.size(); ++i) {
+        columns[i].erase(columns[i].begin(), columns[i].begin() + static_cast<std::ptrdiff_t>(begin - firsts[i]));
+        columns[i].resize(static_cast<size_t>(end - begin));
+    }
+    return begin;
+}
+
+} // namespace
+
 VisualizationEngine::VisualizationEngine() {
     initializeVisualizationEngine();
     
@@ -15,6 +95,10 @@ VisualizationEngine::VisualizationEngine() {
                       "Visualization Engine initialized", "VisualizationEngine");
 }
 
+VisualizationEngine::~VisualizationEngine() {
+    stopRealTimePublisher();
+}
+
 VisualizationData VisualizationEngine::createWafer2DMap(
     std::shared_ptr<WaferEnhanced> wafer,
     const std::string& property) {
@@ -198,6 +282,243 @@ VisualizationData VisualizationEngine::createOptimizationPlot(
     return viz_data;
 }
 
+VisualizationData VisualizationEngine::createRealTimeMonitor(
+    const std::vector<std::string>& parameter_names) {
+    
+    VisualizationData viz_data;
+    viz_data.title = "Real-Time Monitor";
+    viz_data.description = "Live process parameters";
+    viz_data.type = VisualizationType::REAL_TIME_MONITOR;
+    
+    try {
+        auto monitor = std::make_shared<RealTimeMonitor>();
+        for (const auto& name : parameter_names.empty() ? realtime_config_.monitored_parameters : parameter_names) {
+            if (name != "time" && std::find(monitor->names.begin(), monitor->names.end(), name) == monitor->names.end()) {
+                monitor->names.push_back(name);
+            }
+        }
+        const size_t capacity = static_cast<size_t>(std::max(realtime_config_.max_history_points, 1));
+        for (size_t i = 0; i <= monitor->names.size(); ++i) {
+            monitor->rings.push_back(std::make_unique<SampleRing>(capacity));
+        }
+        monitor->start = std::chrono::steady_clock::now();
+        
+        viz_data.series["time"] = {};
+        for (const auto& name : monitor->names) {
+            viz_data.series[name] = {};
+        }
+        viz_data.labels = {"Time (s)", "Value"};
+        viz_data.legends = monitor->names;
+        viz_data.metadata["parameters"] = std::to_string(monitor->names.size());
+        viz_data.metadata["history_points"] = std::to_string(capacity);
+        
+        std::string id;
+        {
+            std::lock_guard<std::mutex> lock(monitors_mutex_);
+            id = "realtime_monitor_" + std::to_string(next_monitor_++);
+            auto next = std::make_shared<MonitorMap>(*std::atomic_load(&monitors_));
+            (*next)[id] = monitor;
+            std::atomic_store(&monitors_, std::shared_ptr<const MonitorMap>(std::move(next)));
+        }
+        viz_data.metadata["monitor_id"] = id;
+        addVisualization(id, viz_data);
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::USER_INTERFACE,
+                          "Created real-time monitor " + id + " with " + std::to_string(monitor->names.size()) +
+                          " parameters",
+                          "VisualizationEngine");
+
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::USER_INTERFACE,
+                          "Failed to create real-time monitor: " + std::string(e.what()),
+                          "VisualizationEngine");
+    }
+    
+    return viz_data;
+}
+
+void VisualizationEngine::updateRealTimeData(
+    const std::string& visualization_id,
+    const std::unordered_map<std::string, double>& new_data) {
+    
+    const std::shared_ptr<const MonitorMap> monitors = std::atomic_load(&monitors_);
+    auto found = monitors->find(visualization_id);
+    if (found == monitors->end()) {
+        SEMIPRO_LOG_MODULE(LogLevel::WARNING, LogCategory::USER_INTERFACE,
+                          "No real-time monitor: " + visualization_id,
+                          "VisualizationEngine");
+        return;
+    }
+    RealTimeMonitor& monitor = *found->second;
+    for (size_t i = 0; i < monitor.names.size(); ++i) {
+        auto value = new_data.find(monitor.names[i]);
+        monitor.rings[i + 1]->push(value == new_data.end() ? std::numeric_limits<double>::quiet_NaN() : value->second);
+    }
+    auto time = new_data.find("time");
+    monitor.rings[0]->push(time != new_data.end()
+                               ? time->second
+                               : std::chrono::duration<double>(std::chrono::steady_clock::now() - monitor.start).count());
+}
+
+VisualizationData VisualizationEngine::snapshotRealTimeMonitor(const std::string& visualization_id) const {
+    const std::shared_ptr<const MonitorMap> monitors = std::atomic_load(&monitors_);
+    auto found = monitors->find(visualization_id);
+    if (found == monitors->end()) {
+        throw std::invalid_argument("No real-time monitor: " + visualization_id);
+    }
+    const RealTimeMonitor& monitor = *found->second;
+    
+    VisualizationData viz_data = getVisualization(visualization_id);
+    std::vector<std::vector<double>> columns;
+    const uint64_t first = readAligned(monitor.rings, 0, columns);
+    viz_data.series["time"] = std::move(columns[0]);
+    for (size_t i = 0; i < monitor.names.size(); ++i) {
+        viz_data.series[monitor.names[i]] = std::move(columns[i + 1]);
+    }
+    
+    const std::vector<double>& time = viz_data.series["time"];
+    if (!time.empty()) {
+        viz_data.x_range = {time.front(), time.back()};
+    }
+    double low = std::numeric_limits<double>::infinity();
+    double high = -std::numeric_limits<double>::infinity();
+    for (const auto& name : monitor.names) {
+        for (double value : viz_data.series[name]) {
+            if (!std::isnan(value)) {
+                low = std::min(low, value);
+                high = std::max(high, value);
+            }
+        }
+    }
+    if (low <= high) {
+        viz_data.y_range = {low, high};
+    }
+    viz_data.metadata["first_sample"] = std::to_string(first);
+    viz_data.metadata["data_points"] = std::to_string(time.size());
+    return viz_data;
+}
+
+void VisualizationEngine::publishRealTimeSnapshots(std::function<void(const std::string&)> publish) {
+    stopRealTimePublisher();
+    if (!publish) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(publisher_mutex_);
+    publish_ = std::move(publish);
+    publisher_stop_ = false;
+    publisher_ = std::thread(&VisualizationEngine::runRealTimePublisher, this);
+}
+
+void VisualizationEngine::setRealTimeConfig(const RealTimeConfig& config) {
+    // The publisher reads update_interval under this lock
+    std::lock_guard<std::mutex> lock(publisher_mutex_);
+    realtime_config_ = config;
+}
+
+void VisualizationEngine::stopRealTimePublisher() {
+    {
+        std::lock_guard<std::mutex> lock(publisher_mutex_);
+        publisher_stop_ = true;
+    }
+    publisher_wake_.notify_all();
+    if (publisher_.joinable()) {
+        publisher_.join();
+    }
+    publish_ = nullptr;
+}
+
+void VisualizationEngine::runRealTimePublisher() {
+    std::unique_lock<std::mutex> lock(publisher_mutex_);
+    for (;;) {
+        const std::chrono::duration<double> interval(std::max(realtime_config_.update_interval, 0.01));
+        if (publisher_wake_.wait_for(lock, interval, [this] { return publisher_stop_; })) {
+            return;
+        }
+        lock.unlock();
+        for (const auto& entry : *std::atomic_load(&monitors_)) {
+            const std::string message = realTimeSnapshotJSON(entry.first, *entry.second);
+            if (message.empty()) {
+                continue;
+            }
+            try {
+                publish_(message);
+            } catch (const std::exception& e) {
+                SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::USER_INTERFACE,
+                                  "Failed to publish real-time snapshot: " + std::string(e.what()),
+                                  "VisualizationEngine");
+            }
+        }
+        lock.lock();
+    }
+}
+
+std::string VisualizationEngine::realTimeSnapshotJSON(const std::string& id, RealTimeMonitor& monitor) const {
+    std::vector<std::vector<double>> columns;
+    const uint64_t first = readAligned(monitor.rings, monitor.published, columns);
+    const uint64_t dropped = first - monitor.published;
+    if (columns[0].empty() && dropped == 0) {
+        return "";
+    }
+    monitor.published = first + columns[0].size();
+    
+    std::string text;
+    JsonWriter json(text);
+    json.beginObject();
+    json.key("id").string(id);
+    json.key("first").integer(static_cast<long long>(first));
+    json.key("dropped").integer(static_cast<long long>(dropped));
+    json.key("time").numbers(columns[0].data(), columns[0].size());
+    for (size_t i = 0; i < monitor.names.size(); ++i) {
+        json.key(monitor.names[i]).numbers(columns[i + 1].data(), columns[i + 1].size());
+    }
+    json.endObject();
+    return text;
+}
+
+VisualizationData VisualizationEngine::createAnimatedSequence(
+    const std::vector<std::string>& visualization_ids,
+    double frame_duration) {
+    
+    VisualizationData viz_data;
+    viz_data.title = "Animated Sequence";
+    viz_data.description = "Sequence of " + std::to_string(visualization_ids.size()) + " frames";
+    
+    try {
+        if (!(frame_duration > 0.0)) {
+            throw std::invalid_argument("Frame duration must be positive");
+        }
+        std::string frames;
+        std::vector<double> starts;
+        for (const auto& id : visualization_ids) {
+            const VisualizationData& frame = getVisualization(id);
+            if (starts.empty()) {
+                viz_data.type = frame.type;
+                viz_data.labels = frame.labels;
+                viz_data.x_range = frame.x_range;
+                viz_data.y_range = frame.y_range;
+                viz_data.z_range = frame.z_range;
+            }
+            frames += (frames.empty() ? "" : ",") + id;
+            starts.push_back(frame_duration * starts.size());
+        }
+        viz_data.series["time"] = std::move(starts);
+        viz_data.metadata["frames"] = frames;
+        viz_data.metadata["frame_duration"] = std::to_string(frame_duration);
+        viz_data.metadata["frame_count"] = std::to_string(visualization_ids.size());
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::USER_INTERFACE,
+                          "Created animated sequence with " + std::to_string(visualization_ids.size()) + " frames",
+                          "VisualizationEngine");
+
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::USER_INTERFACE,
+                          "Failed to create animated sequence: " + std::string(e.what()),
+                          "VisualizationEngine");
+    }
+    
+    return viz_data;
+}
+
 VisualizationOutput VisualizationEngine::generateHTMLReport(
     const std::vector<std::string>& visualization_ids,
     const std::string& report_title) {
@@ -227,36 +548,18 @@ VisualizationOutput VisualizationEngine::generateHTMLReport(
         html << "<p>Visualizations: " << visualization_ids.size() << "</p>\n";
         html << "</div>\n";
         
-        // Add each visualization
+        // Sections are independent, so each is built as its own task
+        std::vector<std::future<std::string>> sections;
         for (const auto& viz_id : visualization_ids) {
             auto viz_it = visualizations_.find(viz_id);
             if (viz_it != visualizations_.end()) {
-                const auto& viz_data = viz_it->second;
-                
-                html << "<div class='visualization-section'>\n";
-                html << "<h2>" << viz_data.title << "</h2>\n";
-                html << "<p>" << viz_data.description << "</p>\n";
-                
-                // Generate visualization-specific content
-                html << "<div class='visualization-container' id='" << viz_id << "'>\n";
-                html << generatePlotlyScript(viz_data);
-                html << "</div>\n";
-                
-                // Add metadata table
-                if (!viz_data.metadata.empty()) {
-                    html << "<div class='metadata-table'>\n";
-                    html << "<h3>Metadata</h3>\n";
-                    html << "<table>\n";
-                    for (const auto& meta : viz_data.metadata) {
-                        html << "<tr><td>" << meta.first << "</td><td>" << meta.second << "</td></tr>\n";
-                    }
-                    html << "</table>\n";
-                    html << "</div>\n";
-                }
-                
-                html << "</div>\n";
+                sections.push_back(TaskScheduler::getInstance().submit(
+                    [this, &viz_id, &viz_data = viz_it->second]() { return generateSection(viz_id, viz_data); }));
             }
         }
+        for (auto& section : sections) {
+            html << TaskScheduler::getInstance().wait(section);
+        }
         
         html << "</div>\n";
         html << generateHTMLFooter();
@@ -288,6 +591,191 @@ VisualizationOutput VisualizationEngine::generateHTMLReport(
     return output;
 }
 
+VisualizationOutput VisualizationEngine::generateInteractiveHTML(const std::string& visualization_id) {
+    VisualizationOutput output;
+    output.format = OutputFormat::HTML_REPORT;
+    output.output_id = "interactive_" + visualization_id;
+    
+    auto start_time = std::chrono::steady_clock::now();
+    
+    try {
+        const VisualizationData& viz_data = getVisualization(visualization_id);
+        ensureOutputDirectory();
+        
+        std::stringstream html;
+        html << generateHTMLHeader(viz_data.title);
+        html << "<div class='container'>\n";
+        html << generateSection(visualization_id, viz_data);
+        html << "</div>\n";
+        html << generateHTMLFooter();
+        
+        output.file_path = output_directory_ + output.output_id + ".html";
+        output.content = html.str();
+        if (!writeToFile(output.file_path, output.content)) {
+            throw std::runtime_error("Failed to write interactive HTML to file");
+        }
+        output.file_size = output.content.size();
+        output.generation_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::USER_INTERFACE,
+                          "Generated interactive HTML: " + output.file_path +
+                          " (" + std::to_string(output.file_size) + " bytes)",
+                          "VisualizationEngine");
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::USER_INTERFACE,
+                          "Failed to generate interactive HTML: " + std::string(e.what()),
+                          "VisualizationEngine");
+    }
+    
+    return output;
+}
+
+VisualizationOutput VisualizationEngine::exportToJSON(const std::string& visualization_id) {
+    VisualizationOutput output;
+    output.format = OutputFormat::JSON_DATA;
+    output.output_id = "json_" + visualization_id;
+    
+    auto start_time = std::chrono::steady_clock::now();
+    
+    try {
+        const VisualizationData& viz_data = getVisualization(visualization_id);
+        const size_t budget = static_cast<size_t>(std::max(interactive_config_.max_data_points, 1));
+        ensureOutputDirectory();
+        
+        // Arrays are base64 float32, little-endian, row-major
+        std::string text;
+        JsonWriter json(text);
+        json.beginObject();
+        json.key("id").string(visualization_id);
+        json.key("title").string(viz_data.title);
+        json.key("description").string(viz_data.description);
+        json.key("type").integer(static_cast<int>(viz_data.type));
+        json.key("labels").beginArray();
+        for (const auto& label : viz_data.labels) {
+            json.string(label);
+        }
+        json.endArray();
+        json.key("x_range").beginArray().number(viz_data.x_range.first).number(viz_data.x_range.second).endArray();
+        json.key("y_range").beginArray().number(viz_data.y_range.first).number(viz_data.y_range.second).endArray();
+        json.key("z_range").beginArray().number(viz_data.z_range.first).number(viz_data.z_range.second).endArray();
+        json.key("metadata").beginObject();
+        for (const auto& meta : viz_data.metadata) {
+            json.key(meta.first).string(meta.second);
+        }
+        json.endObject();
+        if (!data_endpoint_.empty()) {
+            json.key("data_url").string(data_endpoint_);
+        }
+        if (!viz_data.data_2d.empty()) {
+            const VisualizationUtils::MapLevel map = VisualizationUtils::decimateMap(viz_data.data_2d, budget);
+            json.key("map").beginObject();
+            json.key("level").integer(map.level);
+            json.key("rows").integer(map.rows);
+            json.key("cols").integer(map.cols);
+            json.key("full_rows").integer(static_cast<long long>(viz_data.data_2d.size()));
+            json.key("full_cols").integer(static_cast<long long>(viz_data.data_2d[0].size()));
+            json.key("dtype").string("float32");
+            json.key("mean").string(base64Floats(map.mean));
+            if (map.level > 0) {
+                json.key("min").string(base64Floats(map.min));
+                json.key("max").string(base64Floats(map.max));
+            }
+            json.endObject();
+        }
+        json.key("series").beginArray();
+        for (const auto& series : reduceSeries(viz_data, budget)) {
+            json.beginObject();
+            json.key("name").string(series.name);
+            json.key("x_name").string(series.x_name);
+            json.key("length").integer(static_cast<long long>(series.y.size()));
+            json.key("full_length").integer(static_cast<long long>(series.full_length));
+            json.key("dtype").string("float32");
+            json.key("x").string(base64Floats(series.x));
+            json.key("y").string(base64Floats(series.y));
+            json.endObject();
+        }
+        json.endArray().endObject();
+        text += '\n';
+        
+        output.file_path = output_directory_ + output.output_id + ".json";
+        output.content = std::move(text);
+        if (!writeToFile(output.file_path, output.content)) {
+            throw std::runtime_error("Failed to write JSON export to file");
+        }
+        output.file_size = output.content.size();
+        output.generation_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::USER_INTERFACE,
+                          "Exported JSON: " + output.file_path,
+                          "VisualizationEngine");
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::USER_INTERFACE,
+                          "Failed to export JSON: " + std::string(e.what()),
+                          "VisualizationEngine");
+    }
+    
+    return output;
+}
+
+VisualizationOutput VisualizationEngine::exportToCSV(const std::string& visualization_id) {
+    VisualizationOutput output;
+    output.format = OutputFormat::CSV_TABLE;
+    output.output_id = "csv_" + visualization_id;
+    
+    auto start_time = std::chrono::steady_clock::now();
+    
+    try {
+        const VisualizationData& viz_data = getVisualization(visualization_id);
+        const size_t budget = static_cast<size_t>(std::max(interactive_config_.max_data_points, 1));
+        ensureOutputDirectory();
+        
+        std::stringstream csv;
+        csv << "# " << viz_data.title << "\n";
+        if (!data_endpoint_.empty()) {
+            csv << "# Full resolution: " << data_endpoint_ << "?id=" << visualization_id << "\n";
+        }
+        if (!viz_data.data_2d.empty()) {
+            // The pyramid level's block means, one map row per line
+            const VisualizationUtils::MapLevel map = VisualizationUtils::decimateMap(viz_data.data_2d, budget);
+            csv << "# Map level " << map.level << ": " << map.rows << " x " << map.cols << " of "
+                << viz_data.data_2d.size() << " x " << viz_data.data_2d[0].size() << "\n";
+            for (int r = 0; r < map.rows; ++r) {
+                for (int c = 0; c < map.cols; ++c) {
+                    csv << (c ? "," : "") << formatNumber(map.mean[static_cast<size_t>(r) * map.cols + c], 6);
+                }
+                csv << "\n";
+            }
+        }
+        const std::vector<ReducedSeries> series = reduceSeries(viz_data, budget);
+        if (!series.empty()) {
+            csv << "series,x,y\n";
+            for (const auto& part : series) {
+                for (size_t i = 0; i < part.y.size(); ++i) {
+                    csv << part.name << "," << formatNumber(part.x[i], 6) << "," << formatNumber(part.y[i], 6) << "\n";
+                }
+            }
+        }
+        
+        output.file_path = output_directory_ + output.output_id + ".csv";
+        output.content = csv.str();
+        if (!writeToFile(output.file_path, output.content)) {
+            throw std::runtime_error("Failed to write CSV export to file");
+        }
+        output.file_size = output.content.size();
+        output.generation_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        
+        SEMIPRO_LOG_MODULE(LogLevel::INFO, LogCategory::USER_INTERFACE,
+                          "Exported CSV: " + output.file_path,
+                          "VisualizationEngine");
+    } catch (const std::exception& e) {
+        SEMIPRO_LOG_MODULE(LogLevel::ERROR, LogCategory::USER_INTERFACE,
+                          "Failed to export CSV: " + std::string(e.what()),
+                          "VisualizationEngine");
+    }
+    
+    return output;
+}
+
 VisualizationOutput VisualizationEngine::generatePythonScript(
     const std::string& visualization_id) {
     
@@ -471,6 +959,34 @@ std::string VisualizationEngine::generateHTMLHeader(const std::string& title) co
     header << "    <meta name='viewport' content='width=device-width, initial-scale=1.0'>\n";
     header << "    <title>" << title << "</title>\n";
     header << "    <script src='https://cdn.plot.ly/plotly-latest.min.js'></script>\n";
+    // Payload decoding, and swapping a decimated map for the full one
+    header << "    <script>\n";
+    header << "    function semiproFloats(id) {\n";
+    header << "        var text = atob(document.getElementById(id).textContent);\n";
+    header << "        var bytes = new Uint8Array(text.length);\n";
+    header << "        for (var i = 0; i < text.length; ++i) bytes[i] = text.charCodeAt(i);\n";
+    header << "        return new Float32Array(bytes.buffer);\n";
+    header << "    }\n";
+    header << "    function semiproRows(values, rows, cols) {\n";
+    header << "        var z = [];\n";
+    header << "        for (var r = 0; r < rows; ++r) z.push(Array.from(values.subarray(r * cols, (r + 1) * cols)));\n";
+    header << "        return z;\n";
+    header << "    }\n";
+    header << "    function semiproFullButton(id, endpoint, rows, cols) {\n";
+    header << "        var button = document.createElement('button');\n";
+    header << "        button.textContent = 'Full resolution';\n";
+    header << "        button.onclick = function() {\n";
+    header << "            fetch(endpoint + '?id=' + encodeURIComponent(id) + '&field=z&level=0')\n";
+    header << "                .then(function(response) { return response.arrayBuffer(); })\n";
+    header << "                .then(function(buffer) {\n";
+    header << "                    Plotly.restyle(id, {z: [semiproRows(new Float32Array(buffer), rows, cols)],\n";
+    header << "                                        customdata: [null], hovertemplate: [null]});\n";
+    header << "                    button.remove();\n";
+    header << "                });\n";
+    header << "        };\n";
+    header << "        document.getElementById(id).before(button);\n";
+    header << "    }\n";
+    header << "    </script>\n";
     header << "    <style>\n";
     header << getThemeCSS();
     header << "    </style>\n";
@@ -501,7 +1017,10 @@ std::string VisualizationEngine::getThemeCSS() const {
     return css.str();
 }
 
-std::string VisualizationEngine::generatePlotlyScript(const VisualizationData& data) const {
+std::string VisualizationEngine::generatePlotlyScript(const VisualizationData& data,
+                                                      const std::string& element_id) const {
+    const size_t budget = static_cast<size_t>(std::max(interactive_config_.max_data_points, 1));
+    std::stringstream payloads;
     std::stringstream script;
 
     script << "<script>\n";
@@ -516,54 +1035,51 @@ std::string VisualizationEngine::generatePlotlyScript(const VisualizationData& d
     switch (data.type) {
         case VisualizationType::WAFER_2D_MAP:
             if (!data.data_2d.empty()) {
-                script << "var z = [\n";
-                for (const auto& row : data.data_2d) {
-                    script << "    [";
-                    for (size_t i = 0; i < row.size(); ++i) {
-                        script << formatNumber(row[i]);
-                        if (i < row.size() - 1) script << ", ";
-                    }
-                    script << "],\n";
-                }
-                script << "];\n";
-                script << "plotData.push({\n";
+                const VisualizationUtils::MapLevel map = VisualizationUtils::decimateMap(data.data_2d, budget);
+                const auto low = std::min_element(map.min.begin(), map.min.end());
+                const auto high = std::max_element(map.max.begin(), map.max.end());
+                payloads << payloadTag(element_id + "-z", map.mean);
+                script << "var z = semiproRows(semiproFloats('" << element_id << "-z'), "
+                       << map.rows << ", " << map.cols << ");\n";
+                script << "var trace = {\n";
                 script << "    z: z,\n";
                 script << "    type: 'heatmap',\n";
-                script << "    colorscale: 'Viridis'\n";
-                script << "});\n";
+                script << "    colorscale: 'Viridis',\n";
+                // Block means would narrow the scale; keep the map's own range
+                script << "    zmin: " << formatNumber(*low, 6) << ",\n";
+                script << "    zmax: " << formatNumber(*high, 6) << "\n";
+                script << "};\n";
+                if (map.level > 0) {
+                    payloads << payloadTag(element_id + "-zmin", map.min);
+                    payloads << payloadTag(element_id + "-zmax", map.max);
+                    script << "var zmin = semiproFloats('" << element_id << "-zmin');\n";
+                    script << "var zmax = semiproFloats('" << element_id << "-zmax');\n";
+                    script << "trace.customdata = z.map(function(row, r) { return row.map(function(v, c) {\n";
+                    script << "    return [zmin[r * " << map.cols << " + c], zmax[r * " << map.cols << " + c]]; }); });\n";
+                    script << "trace.hovertemplate = 'mean %{z}<br>min %{customdata[0]}<br>max %{customdata[1]}<extra></extra>';\n";
+                }
+                script << "plotData.push(trace);\n";
+                if (map.level > 0 && !data_endpoint_.empty()) {
+                    script << "layout.title += ' (1:" << (1 << map.level) << ")';\n";
+                    script << "semiproFullButton('" << element_id << "', '" << data_endpoint_ << "', "
+                           << data.data_2d.size() << ", " << data.data_2d[0].size() << ");\n";
+                }
             }
             break;
 
         case VisualizationType::TEMPERATURE_MAP:
         case VisualizationType::OPTIMIZATION_PLOT:
-            for (const auto& series : data.series) {
-                if (series.first == "time" || series.first == "generation") {
-                    continue; // Skip x-axis data
-                }
-
-                script << "var x_data = [";
-                auto x_it = data.series.find(series.first == "temperature" ? "time" : "generation");
-                if (x_it != data.series.end()) {
-                    for (size_t i = 0; i < x_it->second.size(); ++i) {
-                        script << formatNumber(x_it->second[i]);
-                        if (i < x_it->second.size() - 1) script << ", ";
-                    }
-                }
-                script << "];\n";
-
-                script << "var y_data = [";
-                for (size_t i = 0; i < series.second.size(); ++i) {
-                    script << formatNumber(series.second[i]);
-                    if (i < series.second.size() - 1) script << ", ";
-                }
-                script << "];\n";
+            for (const auto& series : reduceSeries(data, budget)) {
+                const std::string tag = element_id + "-" + series.name;
+                payloads << payloadTag(tag + "-x", series.x);
+                payloads << payloadTag(tag + "-y", series.y);
 
                 script << "plotData.push({\n";
-                script << "    x: x_data,\n";
-                script << "    y: y_data,\n";
+                script << "    x: Array.from(semiproFloats('" << tag << "-x')),\n";
+                script << "    y: Array.from(semiproFloats('" << tag << "-y')),\n";
                 script << "    type: 'scatter',\n";
                 script << "    mode: 'lines+markers',\n";
-                script << "    name: '" << series.first << "'\n";
+                script << "    name: '" << series.name << "'\n";
                 script << "});\n";
             }
             break;
@@ -573,10 +1089,59 @@ std::string VisualizationEngine::generatePlotlyScript(const VisualizationData& d
             break;
     }
 
-    script << "Plotly.newPlot('" << data.title << "', plotData, layout, {responsive: true});\n";
+    script << "Plotly.newPlot('" << element_id << "', plotData, layout, {responsive: true});\n";
     script << "</script>\n";
 
-    return script.str();
+    return payloads.str() + script.str();
+}
+
+std::string VisualizationEngine::generateSection(const std::string& id, const VisualizationData& data) const {
+    std::stringstream html;
+    html << "<div class='visualization-section'>\n";
+    html << "<h2>" << data.title << "</h2>\n";
+    html << "<p>" << data.description << "</p>\n";
+    html << "<div class='visualization-container' id='" << id << "'></div>\n";
+    html << generatePlotlyScript(data, id);
+
+    // Add metadata table
+    if (!data.metadata.empty()) {
+        html << "<div class='metadata-table'>\n";
+        html << "<h3>Metadata</h3>\n";
+        html << "<table>\n";
+        for (const auto& meta : data.metadata) {
+            html << "<tr><td>" << meta.first << "</td><td>" << meta.second << "</td></tr>\n";
+        }
+        html << "</table>\n";
+        html << "</div>\n";
+    }
+
+    html << "</div>\n";
+    return html.str();
+}
+
+std::string VisualizationEngine::payloadTag(const std::string& tag_id, const std::vector<float>& values) const {
+    return "<script type='application/octet-stream' id='" + tag_id + "'>" + base64Floats(values) + "</script>\n";
+}
+
+std::vector<float> VisualizationEngine::getFieldData(const std::string& id, const std::string& field, int level,
+                                                     int& rows, int& cols) const {
+    const VisualizationData& data = getVisualization(id);
+    if (field == "z" || field == "z_min" || field == "z_max") {
+        if (data.data_2d.empty()) {
+            throw std::invalid_argument("Visualization has no map: " + id);
+        }
+        VisualizationUtils::MapLevel map = VisualizationUtils::buildMapLevel(data.data_2d, level);
+        rows = map.rows;
+        cols = map.cols;
+        return std::move(field == "z" ? map.mean : field == "z_min" ? map.min : map.max);
+    }
+    auto it = data.series.find(field);
+    if (it == data.series.end()) {
+        throw std::invalid_argument("Visualization " + id + " has no field " + field);
+    }
+    rows = 1;
+    cols = static_cast<int>(it->second.size());
+    return std::vector<float>(it->second.begin(), it->second.end());
 }
 
 void VisualizationEngine::addVisualization(const std::string& id, const VisualizationData& data) {
@@ -716,6 +1281,154 @@ namespace VisualizationUtils {
         return {min_val, max_val};
     }
 
+    MapLevel buildMapLevel(const std::vector<std::vector<double>>& data, int level) {
+        if (data.empty() || data[0].empty()) {
+            throw std::invalid_argument("Map is empty");
+        }
+        if (level < 0 || level > 30) {
+            throw std::invalid_argument("Map pyramid level out of range");
+        }
+        const int full_rows = static_cast<int>(data.size());
+        const int full_cols = static_cast<int>(data[0].size());
+        for (const auto& row : data) {
+            if (static_cast<int>(row.size()) != full_cols) {
+                throw std::invalid_argument("Map rows differ in length");
+            }
+        }
+        const long block = 1L << level;
+        MapLevel map;
+        map.level = level;
+        map.rows = static_cast<int>((full_rows + block - 1) / block);
+        map.cols = static_cast<int>((full_cols + block - 1) / block);
+        const size_t cells = static_cast<size_t>(map.rows) * map.cols;
+        map.mean.resize(cells);
+        map.min.resize(cells);
+        map.max.resize(cells);
+        TaskScheduler::getInstance().parallelFor(0, map.rows, [&](int begin, int end) {
+            std::vector<double> sum(map.cols);
+            for (int r = begin; r < end; ++r) {
+                const int r0 = static_cast<int>(r * block), r1 = static_cast<int>(std::min<long>(r0 + block, full_rows));
+                float* low = map.min.data() + static_cast<size_t>(r) * map.cols;
+                float* high = map.max.data() + static_cast<size_t>(r) * map.cols;
+                std::fill(sum.begin(), sum.end(), 0.0);
+                std::fill(low, low + map.cols, std::numeric_limits<float>::infinity());
+                std::fill(high, high + map.cols, -std::numeric_limits<float>::infinity());
+                for (int fr = r0; fr < r1; ++fr) {
+                    const std::vector<double>& row = data[fr];
+                    for (int c = 0; c < full_cols; ++c) {
+                        const int cell = static_cast<int>(c / block);
+                        sum[cell] += row[c];
+                        low[cell] = std::min(low[cell], static_cast<float>(row[c]));
+                        high[cell] = std::max(high[cell], static_cast<float>(row[c]));
+                    }
+                }
+                for (int c = 0; c < map.cols; ++c) {
+                    const long width = std::min<long>(block, full_cols - c * block);
+                    map.mean[static_cast<size_t>(r) * map.cols + c] = static_cast<float>(sum[c] / ((r1 - r0) * width));
+                }
+            }
+        });
+        return map;
+    }
+
+    MapLevel decimateMap(const std::vector<std::vector<double>>& data, size_t max_cells) {
+        if (data.empty() || data[0].empty()) {
+            throw std::invalid_argument("Map is empty");
+        }
+        int level = 0;
+        size_t rows = data.size(), cols = data[0].size();
+        while (rows * cols > std::max<size_t>(max_cells, 1)) {
+            rows = (rows + 1) / 2;
+            cols = (cols + 1) / 2;
+            ++level;
+        }
+        return buildMapLevel(data, level);
+    }
+
+    std::vector<size_t> decimateSeries(const std::vector<double>& x, const std::vector<double>& y,
+                                       size_t threshold) {
+        const size_t n = y.size();
+        std::vector<size_t> kept;
+        if (threshold >= n || threshold < 3) {
+            kept.resize(n);
+            std::iota(kept.begin(), kept.end(), size_t(0));
+            return kept;
+        }
+        auto xAt = [&](size_t i) { return x.empty() ? static_cast<double>(i) : x[i]; };
+        const auto extremes = std::minmax_element(y.begin(), y.end());
+        const size_t lowest = extremes.first - y.begin(), highest = extremes.second - y.begin();
+
+        // Points 1 to n - 2 split into threshold - 2 buckets; each keeps the
+        // point spanning the largest triangle with the point kept before it
+        // and the mean of the next bucket
+        const double every = static_cast<double>(n - 2) / (threshold - 2);
+        kept.push_back(0);
+        size_t previous = 0;
+        for (size_t b = 0; b < threshold - 2; ++b) {
+            const size_t begin = static_cast<size_t>(b * every) + 1;
+            const size_t end = std::min(static_cast<size_t>((b + 1) * every) + 1, n - 1);
+            const size_t next_begin = end;
+            const size_t next_end = std::min(static_cast<size_t>((b + 2) * every) + 1, n);
+            double mean_x = 0.0, mean_y = 0.0;
+            for (size_t i = next_begin; i < next_end; ++i) {
+                mean_x += xAt(i);
+                mean_y += y[i];
+            }
+            mean_x /= std::max<size_t>(next_end - next_begin, 1);
+            mean_y /= std::max<size_t>(next_end - next_begin, 1);
+
+            const bool has_low = lowest >= begin && lowest < end;
+            const bool has_high = highest >= begin && highest < end;
+            if (has_low || has_high) {
+                if (has_low && has_high && lowest != highest) {
+                    kept.push_back(std::min(lowest, highest));
+                    kept.push_back(std::max(lowest, highest));
+                } else {
+                    kept.push_back(has_low ? lowest : highest);
+                }
+                previous = kept.back();
+                continue;
+            }
+            double best_area = -1.0;
+            size_t best = begin;
+            for (size_t i = begin; i < end; ++i) {
+                const double area = std::abs((xAt(previous) - mean_x) * (y[i] - y[previous]) -
+                                             (xAt(previous) - xAt(i)) * (mean_y - y[previous]));
+                if (area > best_area) {
+                    best_area = area;
+                    best = i;
+                }
+            }
+            kept.push_back(best);
+            previous = best;
+        }
+        kept.push_back(n - 1);
+        return kept;
+    }
+
+    std::string encodeBase64(const void* data, size_t bytes) {
+        static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        const unsigned char* in = static_cast<const unsigned char*>(data);
+        std::string out;
+        out.reserve((bytes + 2) / 3 * 4);
+        size_t i = 0;
+        for (; i + 2 < bytes; i += 3) {
+            const uint32_t group = uint32_t(in[i]) << 16 | uint32_t(in[i + 1]) << 8 | in[i + 2];
+            out += digits[group >> 18];
+            out += digits[(group >> 12) & 63];
+            out += digits[(group >> 6) & 63];
+            out += digits[group & 63];
+        }
+        if (i < bytes) {
+            const uint32_t group = uint32_t(in[i]) << 16 | (i + 1 < bytes ? uint32_t(in[i + 1]) << 8 : 0);
+            out += digits[group >> 18];
+            out += digits[(group >> 12) & 63];
+            out += i + 1 < bytes ? digits[(group >> 6) & 63] : '=';
+            out += '=';
+        }
+        return out;
+    }
+
     std::string rgbToHex(int r, int g, int b) {
         std::stringstream ss;
         ss << "#" << std::hex << std::setfill('0') << std::setw(2) << r
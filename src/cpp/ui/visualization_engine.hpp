@@ -8,7 +8,13 @@
 #include "../advanced/temperature_controller.hpp"
 #include "../advanced/process_optimizer.hpp"
 #include "../advanced/process_integrator.hpp"
+#include "../core/sample_ring.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -92,14 +98,14 @@ struct InteractiveControls {
     bool enable_selection = true;                   // Enable data selection
     bool enable_export = true;                      // Enable export functionality
     double animation_speed = 1.0;                   // Animation speed multiplier
-    int max_data_points = 10000;                    // Maximum data points for performance
+    int max_data_points = 10000;                    // Points per series and cells per map embedded in outputs
 };
 
 // Real-time monitoring configuration
 struct RealTimeConfig {
     bool enable_real_time = false;                  // Enable real-time updates
-    double update_interval = 1.0;                   // Update interval (seconds)
-    int max_history_points = 1000;                  // Maximum history points
+    double update_interval = 1.0;                   // Seconds between published snapshots
+    int max_history_points = 1000;                  // Samples each monitor channel holds
     bool auto_scale = true;                         // Auto-scale axes
     bool show_statistics = true;                    // Show real-time statistics
     std::vector<std::string> monitored_parameters;  // Parameters to monitor
@@ -132,6 +138,7 @@ private:
     
     // Output settings
     std::string output_directory_ = "output/visualizations/";
+    std::string data_endpoint_;                     // REST route serving getFieldData, if any
     bool enable_high_quality_ = true;
     bool enable_interactive_ = true;
     bool enable_responsive_ = true;
@@ -139,9 +146,32 @@ private:
     int default_height_ = 800;
     int default_dpi_ = 300;
     
+    // Real-time monitors: ring 0 holds the sample times, ring i + 1 the
+    // values of names[i]. The map is replaced, never modified, so updates
+    // look monitors up without a lock.
+    struct RealTimeMonitor {
+        std::vector<std::string> names;
+        std::vector<std::unique_ptr<SampleRing>> rings;
+        std::chrono::steady_clock::time_point start;
+        uint64_t published = 0;                     // Publisher thread only
+    };
+    using MonitorMap = std::unordered_map<std::string, std::shared_ptr<RealTimeMonitor>>;
+    std::shared_ptr<const MonitorMap> monitors_ = std::make_shared<MonitorMap>();
+    std::mutex monitors_mutex_;                     // Serializes replacing monitors_
+    int next_monitor_ = 0;
+    
+    // Snapshot publisher
+    std::function<void(const std::string&)> publish_;
+    std::thread publisher_;
+    std::mutex publisher_mutex_;
+    std::condition_variable publisher_wake_;
+    bool publisher_stop_ = false;
+    
 public:
     VisualizationEngine();
-    ~VisualizationEngine() = default;
+    ~VisualizationEngine();
+    VisualizationEngine(const VisualizationEngine&) = delete;
+    VisualizationEngine& operator=(const VisualizationEngine&) = delete;
     
     // Wafer visualization
     VisualizationData createWafer2DMap(
@@ -177,16 +207,35 @@ public:
         const ProcessOptimizationResults& optimization_results
     );
     
-    // Real-time monitoring
+    // Real-time monitoring. A monitor keeps the last
+    // RealTimeConfig::max_history_points samples of each parameter in
+    // fixed rings, so its memory does not grow however long it runs. It is
+    // registered under the id in the returned data's metadata["monitor_id"];
+    // no parameters means RealTimeConfig::monitored_parameters.
     VisualizationData createRealTimeMonitor(
         const std::vector<std::string>& parameter_names
     );
     
+    // Appends one sample of every parameter of the monitor, NaN for those
+    // missing from new_data; other names are ignored. new_data["time"], if
+    // present, is the sample's time, else the seconds since the monitor was
+    // created. Lock-free and allocation-free, but each monitor must be fed
+    // by one thread at a time.
     void updateRealTimeData(
         const std::string& visualization_id,
         const std::unordered_map<std::string, double>& new_data
     );
     
+    // The monitor's held history as series "time" and one per parameter
+    VisualizationData snapshotRealTimeMonitor(const std::string& visualization_id) const;
+    
+    // Starts a thread that every RealTimeConfig::update_interval passes each
+    // monitor's new samples to `publish` as a JSON object {"id", "first",
+    // "dropped", "time", "<parameter>": [...]}, "first" numbering the
+    // first sample and "dropped" counting those overwritten unpublished;
+    // e.g. RestServer::webSocketBroadcaster(path). An empty function stops it.
+    void publishRealTimeSnapshots(std::function<void(const std::string&)> publish);
+    
     // Statistical visualization
     VisualizationData createStatisticalChart(
         const std::unordered_map<std::string, std::vector<double>>& data,
@@ -197,7 +246,11 @@ public:
         const std::unordered_map<std::string, double>& quality_metrics
     );
     
-    // Output generation
+    // Output generation. Reports and exports carry data decimated to
+    // InteractiveControls::max_data_points: series by
+    // VisualizationUtils::decimateSeries, maps by the first level of their
+    // min/max pyramid that fits. HTML and JSON embed the values as base64
+    // float32 arrays; sections are built in parallel on the TaskScheduler.
     VisualizationOutput generateHTMLReport(
         const std::vector<std::string>& visualization_ids,
         const std::string& report_title = "SemiPRO Simulation Report"
@@ -229,6 +282,9 @@ public:
         const std::string& comparison_type = "overlay"
     );
     
+    // Frames are the listed visualizations, referenced by id in
+    // metadata["frames"] and read when the sequence is output rather than
+    // copied into it; series "time" holds each frame's start
     VisualizationData createAnimatedSequence(
         const std::vector<std::string>& visualization_ids,
         double frame_duration = 0.5
@@ -245,12 +301,22 @@ public:
     void setRealTimeConfig(const RealTimeConfig& config);
     void setOutputDirectory(const std::string& directory);
     void setDefaultDimensions(int width, int height, int dpi = 300);
+    // Base URL of a route answering GET ?id=&field=&level= with
+    // getFieldData (see RestServer::serveFieldData). Decimated reports
+    // then offer the full resolution data from it.
+    void setDataEndpoint(const std::string& url) { data_endpoint_ = url; }
     
     // Data management
     void addVisualization(const std::string& id, const VisualizationData& data);
     VisualizationData& getVisualization(const std::string& id);
     const VisualizationData& getVisualization(const std::string& id) const;
     void removeVisualization(const std::string& id);
+    // Full or reduced data of a visualization as float32: "z", "z_min" or
+    // "z_max" for level `level` of its map pyramid (0 is the map itself),
+    // row-major rows x cols, or any series in full as 1 x n. Throws
+    // std::invalid_argument for an unknown visualization or field.
+    std::vector<float> getFieldData(const std::string& id, const std::string& field, int level,
+                                    int& rows, int& cols) const;
     
     // Utility functions
     std::vector<std::string> getAvailableVisualizations() const;
@@ -268,11 +334,18 @@ public:
     
 private:
     void initializeVisualizationEngine();
+    void stopRealTimePublisher();
+    void runRealTimePublisher();
+    std::string realTimeSnapshotJSON(const std::string& id, RealTimeMonitor& monitor) const;
     
     // HTML generation helpers
     std::string generateHTMLHeader(const std::string& title) const;
     std::string generateHTMLFooter() const;
-    std::string generatePlotlyScript(const VisualizationData& data) const;
+    std::string generatePlotlyScript(const VisualizationData& data, const std::string& element_id) const;
+    std::string generateSection(const std::string& id, const VisualizationData& data) const;
+    // Script tag carrying values as base64 float32, read back by the
+    // header's semiproFloats()
+    std::string payloadTag(const std::string& tag_id, const std::vector<float>& values) const;
     std::string generateD3Script(const VisualizationData& data) const;
     
     // Data processing helpers
@@ -300,6 +373,33 @@ private:
 
 // Utility functions for visualization
 namespace VisualizationUtils {
+    // One level of a map's min/max pyramid: each cell covers a
+    // 2^level x 2^level block of the map (less at the far edges). Row-major.
+    struct MapLevel {
+        int level = 0;
+        int rows = 0;
+        int cols = 0;
+        std::vector<float> mean;
+        std::vector<float> min;
+        std::vector<float> max;
+    };
+
+    // Pyramid level `level` of a rectangular map, rows built in parallel
+    MapLevel buildMapLevel(const std::vector<std::vector<double>>& data, int level);
+    // The finest level with at most max_cells cells
+    MapLevel decimateMap(const std::vector<std::vector<double>>& data, size_t max_cells);
+
+    // Indices, ascending, of the points of (x, y) kept by
+    // largest-triangle-three-buckets reduction to `threshold` points. The
+    // first and last points and the smallest and largest y are always
+    // kept, which may add one point when both extremes share a bucket.
+    // An empty x stands for the indices. Every index when threshold < 3
+    // or the series already fits.
+    std::vector<size_t> decimateSeries(const std::vector<double>& x, const std::vector<double>& y,
+                                       size_t threshold);
+
+    std::string encodeBase64(const void* data, size_t bytes);
+
     // Data processing utilities
     std::vector<std::vector<double>> resampleData(
         const std::vector<std::vector<double>>& data,
@@ -1,4 +1,5 @@
 #include "integration_validator.hpp"
+#include "../core/autotuner.hpp"
 #include <algorithm>
 #include <cmath>
 #include <chrono>
@@ -431,6 +432,16 @@ std::vector<std::string> IntegrationValidator::generateValidationReport(
     
     report.push_back("Total Execution Time: " + std::to_string(results.total_execution_time) + " seconds");
     
+    // Kernel variants the autotuner picked for this machine
+    const auto choices = Autotuner::getInstance().choices();
+    if (!choices.empty()) {
+        report.push_back("Tuned Kernels (" + Autotuner::machineKey() + "):");
+        for (const auto& choice : choices) {
+            report.push_back("  " + choice.kernel + " @ " + choice.size_class + ": " + choice.variant + " (" +
+                             std::to_string(choice.seconds * 1e3) + " ms)");
+        }
+    }
+    
     // Recommendations
     if (success_rate >= 95.0) {
         report.push_back("✅ Excellent validation results - system ready for production");
@@ -1,6 +1,6 @@
 # Author: Dr. Mazharuddin Mohammed
 # distutils: language = c++
-# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/defect_inspection/defect_inspection_model.cpp ../cpp/core/utils.cpp
+# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/defect_inspection/defect_inspection_model.cpp ../cpp/modules/defect_inspection/defect_summary.cpp ../cpp/modules/defect_inspection/die_inspection.cpp ../cpp/core/utils.cpp
 
 from libcpp.memory cimport shared_ptr
 from libcpp.string cimport string
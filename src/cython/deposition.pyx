@@ -1,5 +1,5 @@
 # distutils: language = c++
-# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/deposition/deposition_model.cpp ../cpp/core/utils.cpp
+# distutils: sources = ../cpp/core/wafer.cpp ../cpp/core/field_store.cpp ../cpp/modules/deposition/deposition_model.cpp ../cpp/core/utils.cpp
 
 from libcpp.memory cimport shared_ptr
 from libcpp.string cimport string
@@ -64,8 +64,8 @@ cdef extern from "../cpp/modules/deposition/deposition_model.hpp":
 
     cppclass DepositionModel:
         DepositionModel() except +
-        void simulateDeposition(shared_ptr[Wafer], double, string, string) except +
-        DepositionResults simulateEnhancedDeposition(shared_ptr[Wafer], const DepositionConditions&) except +
+        void simulateDeposition(shared_ptr[Wafer], double, string, string) except + nogil
+        DepositionResults simulateEnhancedDeposition(shared_ptr[Wafer], const DepositionConditions&) except + nogil
 
 # Python wrapper classes
 cdef class PyDepositionConditions:
@@ -180,11 +180,19 @@ cdef class PyDepositionModel:
 
     def simulate_deposition(self, wafer: PyWafer, thickness: float, material: str, type: str):
         """Basic deposition simulation"""
-        self.thisptr.simulateDeposition(wafer.thisptr, thickness, material.encode('utf-8'), type.encode('utf-8'))
+        cdef shared_ptr[Wafer] target = wafer.thisptr
+        cdef double cpp_thickness = thickness
+        cdef string cpp_material = material.encode('utf-8'), cpp_type = type.encode('utf-8')
+        with nogil:
+            self.thisptr.simulateDeposition(target, cpp_thickness, cpp_material, cpp_type)
 
     def simulate_enhanced_deposition(self, wafer: PyWafer, conditions: PyDepositionConditions):
         """Enhanced deposition simulation with detailed parameters"""
-        cdef DepositionResults cpp_results = self.thisptr.simulateEnhancedDeposition(wafer.thisptr, conditions.conditions)
+        cdef shared_ptr[Wafer] target = wafer.thisptr
+        cdef DepositionConditions cpp_conditions = conditions.conditions
+        cdef DepositionResults cpp_results
+        with nogil:
+            cpp_results = self.thisptr.simulateEnhancedDeposition(target, cpp_conditions)
 
         py_results = PyDepositionResults()
         py_results.results = cpp_results
@@ -1,5 +1,5 @@
 # distutils: language = c++
-# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/doping/monte_carlo_solver.cpp ../cpp/modules/doping/diffusion_solver.cpp ../cpp/modules/doping/doping_manager.cpp ../cpp/core/utils.cpp
+# distutils: sources = ../cpp/core/wafer.cpp ../cpp/core/field_store.cpp ../cpp/modules/doping/monte_carlo_solver.cpp ../cpp/modules/doping/diffusion_solver.cpp ../cpp/modules/doping/doping_manager.cpp ../cpp/core/utils.cpp
 
 from libcpp.memory cimport shared_ptr
 from libcpp.string cimport string
@@ -62,10 +62,10 @@ cdef extern from "../cpp/modules/doping/doping_manager.hpp":
 
     cppclass DopingManager:
         DopingManager() except +
-        void simulateIonImplantation(shared_ptr[Wafer], double, double) except +
-        void simulateDiffusion(shared_ptr[Wafer], double, double) except +
-        DopingResults simulateEnhancedImplantation(shared_ptr[Wafer], const ImplantationConditions&) except +
-        DopingResults simulateEnhancedDiffusion(shared_ptr[Wafer], const DiffusionConditions&) except +
+        void simulateIonImplantation(shared_ptr[Wafer], double, double) except + nogil
+        void simulateDiffusion(shared_ptr[Wafer], double, double) except + nogil
+        DopingResults simulateEnhancedImplantation(shared_ptr[Wafer], const ImplantationConditions&) except + nogil
+        DopingResults simulateEnhancedDiffusion(shared_ptr[Wafer], const DiffusionConditions&) except + nogil
 
 # Python wrapper classes
 cdef class PyImplantationConditions:
@@ -186,15 +186,25 @@ cdef class PyDopingManager:
 
     def simulate_ion_implantation(self, wafer: PyWafer, energy: float, dose: float):
         """Basic ion implantation simulation"""
-        self.thisptr.simulateIonImplantation(wafer.thisptr, energy, dose)
+        cdef shared_ptr[Wafer] target = wafer.thisptr
+        cdef double cpp_energy = energy, cpp_dose = dose
+        with nogil:
+            self.thisptr.simulateIonImplantation(target, cpp_energy, cpp_dose)
 
     def simulate_diffusion(self, wafer: PyWafer, temperature: float, time: float):
         """Basic diffusion simulation"""
-        self.thisptr.simulateDiffusion(wafer.thisptr, temperature, time)
+        cdef shared_ptr[Wafer] target = wafer.thisptr
+        cdef double cpp_temperature = temperature, cpp_time = time
+        with nogil:
+            self.thisptr.simulateDiffusion(target, cpp_temperature, cpp_time)
 
     def simulate_enhanced_implantation(self, wafer: PyWafer, conditions: PyImplantationConditions):
         """Enhanced ion implantation with detailed parameters"""
-        cdef DopingResults cpp_results = self.thisptr.simulateEnhancedImplantation(wafer.thisptr, conditions.conditions)
+        cdef shared_ptr[Wafer] target = wafer.thisptr
+        cdef ImplantationConditions cpp_conditions = conditions.conditions
+        cdef DopingResults cpp_results
+        with nogil:
+            cpp_results = self.thisptr.simulateEnhancedImplantation(target, cpp_conditions)
 
         py_results = PyDopingResults()
         py_results.results = cpp_results
@@ -202,7 +212,11 @@ cdef class PyDopingManager:
 
     def simulate_enhanced_diffusion(self, wafer: PyWafer, conditions: PyDiffusionConditions):
         """Enhanced diffusion simulation with detailed parameters"""
-        cdef DopingResults cpp_results = self.thisptr.simulateEnhancedDiffusion(wafer.thisptr, conditions.conditions)
+        cdef shared_ptr[Wafer] target = wafer.thisptr
+        cdef DiffusionConditions cpp_conditions = conditions.conditions
+        cdef DopingResults cpp_results
+        with nogil:
+            cpp_results = self.thisptr.simulateEnhancedDiffusion(target, cpp_conditions)
 
         py_results = PyDopingResults()
         py_results.results = cpp_results
@@ -53,6 +53,7 @@ cdef extern from "../cpp/modules/design_rule_check/drc_model.hpp":
         
         DRCViolation(const string& rule, ViolationType vtype, 
                      const pair[double, double]& loc, double measured, double required)
+        string text()
     
     cdef cppclass DRCModel:
         DRCModel() except +
@@ -69,6 +70,7 @@ cdef extern from "../cpp/modules/design_rule_check/drc_model.hpp":
         
         # DRC checking
         void runFullDRC(shared_ptr[Wafer] wafer) except +
+        void runIncrementalDRC(shared_ptr[Wafer] wafer) except +
         void runIncrementalDRC(shared_ptr[Wafer] wafer, 
                               const pair[double, double]& region_start,
                               const pair[double, double]& region_end) except +
@@ -200,7 +202,7 @@ cdef class PyDRCViolation:
     
     @property
     def description(self):
-        return self.thisptr.description.decode('utf-8')
+        return self.thisptr.text().decode('utf-8')
     
     @property
     def waived(self):
@@ -236,7 +238,10 @@ cdef class PyDRCModel:
     def run_full_drc(self, PyWafer wafer):
         self.thisptr.runFullDRC(wafer.thisptr)
     
-    def run_incremental_drc(self, PyWafer wafer, tuple region_start, tuple region_end):
+    def run_incremental_drc(self, PyWafer wafer, tuple region_start=None, tuple region_end=None):
+        if region_start is None or region_end is None:
+            self.thisptr.runIncrementalDRC(wafer.thisptr)
+            return
         cdef pair[double, double] start = pair[double, double](region_start[0], region_start[1])
         cdef pair[double, double] end = pair[double, double](region_end[0], region_end[1])
         self.thisptr.runIncrementalDRC(wafer.thisptr, start, end)
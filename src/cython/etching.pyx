@@ -1,5 +1,5 @@
 # distutils: language = c++
-# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/etching/etching_model.cpp ../cpp/core/utils.cpp
+# distutils: sources = ../cpp/core/wafer.cpp ../cpp/core/field_store.cpp ../cpp/modules/etching/etching_model.cpp ../cpp/core/utils.cpp
 
 from libcpp.memory cimport shared_ptr
 from libcpp.string cimport string
@@ -63,8 +63,8 @@ cdef extern from "../cpp/modules/etching/etching_model.hpp":
 
     cppclass EtchingModel:
         EtchingModel() except +
-        void simulateEtching(shared_ptr[Wafer], double, string) except +
-        EtchingResults simulateEnhancedEtching(shared_ptr[Wafer], const EtchingConditions&) except +
+        void simulateEtching(shared_ptr[Wafer], double, string) except + nogil
+        EtchingResults simulateEnhancedEtching(shared_ptr[Wafer], const EtchingConditions&) except + nogil
 
 # Python wrapper classes
 cdef class PyEtchingConditions:
@@ -180,11 +180,19 @@ cdef class PyEtchingModel:
 
     def simulate_etching(self, wafer: PyWafer, depth: float, type: str):
         """Basic etching simulation"""
-        self.thisptr.simulateEtching(wafer.thisptr, depth, type.encode('utf-8'))
+        cdef shared_ptr[Wafer] target = wafer.thisptr
+        cdef double cpp_depth = depth
+        cdef string cpp_type = type.encode('utf-8')
+        with nogil:
+            self.thisptr.simulateEtching(target, cpp_depth, cpp_type)
 
     def simulate_enhanced_etching(self, wafer: PyWafer, conditions: PyEtchingConditions):
         """Enhanced etching simulation with detailed parameters"""
-        cdef EtchingResults cpp_results = self.thisptr.simulateEnhancedEtching(wafer.thisptr, conditions.conditions)
+        cdef shared_ptr[Wafer] target = wafer.thisptr
+        cdef EtchingConditions cpp_conditions = conditions.conditions
+        cdef EtchingResults cpp_results
+        with nogil:
+            cpp_results = self.thisptr.simulateEnhancedEtching(target, cpp_conditions)
 
         py_results = PyEtchingResults()
         py_results.results = cpp_results
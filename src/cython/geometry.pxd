@@ -7,40 +7,50 @@ from libcpp.vector cimport vector
 from libcpp.pair cimport pair
 cimport numpy as np
 
+cdef extern from "../cpp/core/field_store.hpp":
+    cppclass FieldSnapshot:
+        FieldSnapshot()
+        bint valid()
+        int rows()
+        int cols()
+
 cdef extern from "../cpp/core/wafer.hpp":
+    cdef enum FieldChannel "Wafer::FieldChannel":
+        kGridField "Wafer::kGridField"
+        kPhotoresistField "Wafer::kPhotoresistField"
+        kTemperatureField "Wafer::kTemperatureField"
+        kThermalConductivityField "Wafer::kThermalConductivityField"
+        kElectromigrationMTTFField "Wafer::kElectromigrationMTTFField"
+        kThermalStressField "Wafer::kThermalStressField"
+        kDielectricFieldField "Wafer::kDielectricFieldField"
+
+    # Field getters and setters are Eigen-typed; they are reached through
+    # wafer_buffers.hpp below
     cppclass Wafer:
         Wafer(double, double, string) except +
         void initializeGrid(int, int) except +
         void applyLayer(double, string) except +
-        void setDopantProfile(const double*) except +
-        void setPhotoresistPattern(const double*, int, int) except +
         void addFilmLayer(double, string) except +
         void addMetalLayer(double, string) except +
         void addPackaging(double, string, vector[pair[pair[int, int], pair[int, int]]]) except +
         void setElectricalProperties(vector[pair[string, double]]) except +
-        void setTemperatureProfile(const double*, int, int) except +
-        void setThermalConductivity(const double*, int, int) except +
-        void setElectromigrationMTTF(const double*, int, int) except +
-        void setThermalStress(const double*, int, int) except +
-        void setDielectricField(const double*, int, int) except +
-        void updateGrid(const double*, int, int) except +
-        double* getGrid(int*, int*) except +
-        double* getDopantProfile(int*) except +
-        double* getPhotoresistPattern(int*, int*) except +
+        FieldSnapshot snapshotField(FieldChannel) except +
         vector[pair[double, string]]& getFilmLayers() except +
         vector[pair[double, string]]& getMetalLayers() except +
         pair[double, string] getPackagingSubstrate() except +
         const vector[pair[pair[int, int], pair[int, int]]]& getWireBonds() except +
         const vector[pair[string, double]]& getElectricalProperties() except +
-        double* getTemperatureProfile(int*, int*) except +
-        double* getThermalConductivity(int*, int*) except +
-        double* getElectromigrationMTTF(int*, int*) except +
-        double* getThermalStress(int*, int*) except +
-        double* getDielectricField(int*, int*) except +
         string getMaterialId() except +
         double getDiameter() except +
         double getThickness() except +
 
+cdef extern from "wafer_buffers.hpp" namespace "wafer_buffers":
+    double* mutableField(Wafer&, FieldChannel, int*, int*) except +
+    const double* snapshotData(const FieldSnapshot&)
+    double* dopantData(Wafer&, int*)
+    void setField(Wafer&, FieldChannel, const double*, int, int, Py_ssize_t, Py_ssize_t) except +
+    void setDopantProfile(Wafer&, const double*, int, Py_ssize_t) except +
+
 cdef extern from "../cpp/modules/geometry/geometry_manager.hpp":
     cppclass GeometryManager:
         GeometryManager() except +
@@ -1,7 +1,8 @@
 # Author: Dr. Mazharuddin Mohammed
 # distutils: language = c++
-# distutils: sources = ../cpp/core/wafer.cpp ../cpp/core/utils.cpp
+# distutils: sources = ../cpp/core/wafer.cpp ../cpp/core/field_store.cpp ../cpp/core/utils.cpp
 
+from cpython.buffer cimport PyBUF_WRITABLE, PyBUF_FORMAT, PyBUF_ND, PyBUF_STRIDES
 from libcpp.memory cimport shared_ptr
 from libcpp.string cimport string
 from libcpp.vector cimport vector
@@ -10,9 +11,103 @@ cimport numpy as np
 import numpy as np
 
 # Import declarations from .pxd file
-from geometry cimport PyWafer, PyGeometryManager, Wafer, GeometryManager
+from geometry cimport PyWafer, PyGeometryManager, Wafer, GeometryManager, FieldChannel, FieldSnapshot
+from geometry cimport (kGridField, kPhotoresistField, kTemperatureField, kThermalConductivityField,
+                       kElectromigrationMTTFField, kThermalStressField, kDielectricFieldField)
+from geometry cimport mutableField, snapshotData, dopantData, setField, setDopantProfile
+
+cdef double _empty_storage = 0.0
+
+# Exports wafer storage through the buffer protocol without copying. Arrays
+# built on it keep `owner` (the PyWafer) and, for snapshots, the snapshot's
+# copy-on-write buffer alive, so the memory outlives the array's users.
+cdef class FieldBuffer:
+    cdef object owner
+    cdef FieldSnapshot snapshot
+    cdef double* data
+    cdef Py_ssize_t shape[2]
+    cdef Py_ssize_t strides[2]
+    cdef int ndim
+    cdef bint readonly
+
+    def __getbuffer__(self, Py_buffer* buffer, int flags):
+        if self.readonly and (flags & PyBUF_WRITABLE):
+            raise BufferError("wafer field view is read-only")
+        buffer.buf = <void*>self.data
+        buffer.obj = self
+        buffer.len = self.shape[0] * (self.shape[1] if self.ndim == 2 else 1) * sizeof(double)
+        buffer.readonly = self.readonly
+        buffer.itemsize = sizeof(double)
+        buffer.format = "d" if (flags & PyBUF_FORMAT) else NULL
+        buffer.ndim = self.ndim
+        buffer.shape = self.shape if (flags & PyBUF_ND) else NULL
+        buffer.strides = self.strides if (flags & PyBUF_STRIDES) == PyBUF_STRIDES else NULL
+        buffer.suboffsets = NULL
+        buffer.internal = NULL
+
+    def __releasebuffer__(self, Py_buffer* buffer):
+        pass
+
+# Eigen stores fields column-major: element (i, j) sits at data[i + j * rows]
+cdef FieldBuffer _matrix_buffer(object owner, double* data, int rows, int cols, bint readonly):
+    cdef FieldBuffer buf = FieldBuffer.__new__(FieldBuffer)
+    buf.owner = owner
+    buf.data = data if data != NULL else &_empty_storage
+    buf.ndim = 2
+    buf.shape[0] = rows
+    buf.shape[1] = cols
+    buf.strides[0] = sizeof(double)
+    buf.strides[1] = rows * sizeof(double)
+    buf.readonly = readonly
+    return buf
+
+cdef object _live_field(PyWafer wafer, FieldChannel channel):
+    cdef int rows, cols
+    cdef double* data = mutableField(wafer.thisptr.get()[0], channel, &rows, &cols)
+    return np.asarray(_matrix_buffer(wafer, data, rows, cols, False))
+
+cdef object _snapshot_field(PyWafer wafer, FieldChannel channel):
+    cdef FieldSnapshot snapshot = wafer.thisptr.get().snapshotField(channel)
+    cdef FieldBuffer buf
+    if not snapshot.valid():
+        buf = _matrix_buffer(wafer, NULL, 0, 0, True)
+    else:
+        buf = _matrix_buffer(wafer, <double*>snapshotData(snapshot), snapshot.rows(), snapshot.cols(), True)
+    buf.snapshot = snapshot
+    return np.asarray(buf)
+
+# Hands any 2-D float64 buffer to the C++ setter with its strides; only
+# layouts Eigen cannot address (negative or misaligned strides) are copied
+# here first
+cdef void _set_field(PyWafer wafer, FieldChannel channel, object values) except *:
+    cdef const double[:, :] view = np.asarray(values, dtype=np.float64)
+    cdef Py_ssize_t row_stride = view.strides[0] // sizeof(double)
+    cdef Py_ssize_t col_stride = view.strides[1] // sizeof(double)
+    if (view.strides[0] % sizeof(double) or view.strides[1] % sizeof(double)
+            or row_stride < 0 or col_stride < 0):
+        view = np.asfortranarray(view)
+        row_stride = 1
+        col_stride = view.shape[0]
+    if view.shape[0] == 0 or view.shape[1] == 0:
+        setField(wafer.thisptr.get()[0], channel, &_empty_storage, view.shape[0], view.shape[1], 1,
+                 max(view.shape[0], 1))
+        return
+    setField(wafer.thisptr.get()[0], channel, &view[0, 0], view.shape[0], view.shape[1],
+             row_stride, col_stride)
 
 # Implementation of PyWafer class (declaration is in .pxd file)
+#
+# Field getters return NumPy views rather than copies. The grid,
+# photoresist pattern and dopant profile are live and writable; a view
+# stops tracking the wafer once initialize_grid or a process reshapes the
+# field, so fetch a fresh one afterwards. The derived thermal and
+# reliability fields are read-only snapshots: they stay valid, but show the
+# values from when they were taken. Setters accept any array-like and only
+# copy into the wafer's own storage.
+#
+# The process models release the GIL while they run, so separate wafers
+# can be simulated from separate Python threads. A wafer itself is not
+# synchronised: keep each one on a single thread at a time.
 cdef class PyWafer:
     def __cinit__(self, diameter: float, thickness: float, material_id: str):
         self.thisptr = shared_ptr[Wafer](new Wafer(diameter, thickness, material_id.encode('utf-8')))
@@ -23,11 +118,19 @@ cdef class PyWafer:
     def apply_layer(self, thickness: float, material_id: str):
         self.thisptr.get().applyLayer(thickness, material_id.encode('utf-8'))
 
-    def set_dopant_profile(self, np.ndarray[np.float64_t, ndim=1] profile):
-        self.thisptr.get().setDopantProfile(&profile[0])
+    def set_dopant_profile(self, profile):
+        cdef const double[:] view = np.asarray(profile, dtype=np.float64).ravel()
+        cdef Py_ssize_t stride = view.strides[0] // sizeof(double)
+        if view.strides[0] % sizeof(double) or stride < 0:
+            view = np.ascontiguousarray(view)
+            stride = 1
+        if view.shape[0] == 0:
+            setDopantProfile(self.thisptr.get()[0], &_empty_storage, 0, 1)
+        else:
+            setDopantProfile(self.thisptr.get()[0], &view[0], view.shape[0], stride)
 
-    def set_photoresist_pattern(self, np.ndarray[np.float64_t, ndim=2] pattern):
-        self.thisptr.get().setPhotoresistPattern(&pattern[0, 0], pattern.shape[0], pattern.shape[1])
+    def set_photoresist_pattern(self, pattern):
+        _set_field(self, kPhotoresistField, pattern)
 
     def add_film_layer(self, thickness: float, material: str):
         self.thisptr.get().addFilmLayer(thickness, material.encode('utf-8'))
@@ -49,38 +152,36 @@ cdef class PyWafer:
             cpp_props.push_back(pair[string, double](name.encode('utf-8'), value))
         self.thisptr.get().setElectricalProperties(cpp_props)
 
-    def set_temperature_profile(self, np.ndarray[np.float64_t, ndim=2] profile):
-        self.thisptr.get().setTemperatureProfile(&profile[0, 0], profile.shape[0], profile.shape[1])
+    def set_temperature_profile(self, profile):
+        _set_field(self, kTemperatureField, profile)
 
-    def set_thermal_conductivity(self, np.ndarray[np.float64_t, ndim=2] conductivity):
-        self.thisptr.get().setThermalConductivity(&conductivity[0, 0], conductivity.shape[0], conductivity.shape[1])
+    def set_thermal_conductivity(self, conductivity):
+        _set_field(self, kThermalConductivityField, conductivity)
 
-    def set_electromigration_mttf(self, np.ndarray[np.float64_t, ndim=2] mttf):
-        self.thisptr.get().setElectromigrationMTTF(&mttf[0, 0], mttf.shape[0], mttf.shape[1])
+    def set_electromigration_mttf(self, mttf):
+        _set_field(self, kElectromigrationMTTFField, mttf)
 
-    def set_thermal_stress(self, np.ndarray[np.float64_t, ndim=2] stress):
-        self.thisptr.get().setThermalStress(&stress[0, 0], stress.shape[0], stress.shape[1])
+    def set_thermal_stress(self, stress):
+        _set_field(self, kThermalStressField, stress)
 
-    def set_dielectric_field(self, np.ndarray[np.float64_t, ndim=2] field):
-        self.thisptr.get().setDielectricField(&field[0, 0], field.shape[0], field.shape[1])
+    def set_dielectric_field(self, field):
+        _set_field(self, kDielectricFieldField, field)
 
-    def update_grid(self, np.ndarray[np.float64_t, ndim=2] grid):
-        self.thisptr.get().updateGrid(&grid[0, 0], grid.shape[0], grid.shape[1])
+    def update_grid(self, grid):
+        _set_field(self, kGridField, grid)
 
     def get_grid(self):
-        cdef int rows, cols
-        cdef double* grid_ptr = self.thisptr.get().getGrid(&rows, &cols)
-        return np.asarray(<np.float64_t[:rows, :cols]> grid_ptr)
+        return _live_field(self, kGridField)
 
     def get_dopant_profile(self):
         cdef int size
-        cdef double* profile_ptr = self.thisptr.get().getDopantProfile(&size)
-        return np.asarray(<np.float64_t[:size]> profile_ptr)
+        cdef double* data = dopantData(self.thisptr.get()[0], &size)
+        cdef FieldBuffer buf = _matrix_buffer(self, data, size, 1, False)
+        buf.ndim = 1
+        return np.asarray(buf)
 
     def get_photoresist_pattern(self):
-        cdef int rows, cols
-        cdef double* pattern_ptr = self.thisptr.get().getPhotoresistPattern(&rows, &cols)
-        return np.asarray(<np.float64_t[:rows, :cols]> pattern_ptr)
+        return _live_field(self, kPhotoresistField)
     def get_film_layers(self):
         layers = self.thisptr.get().getFilmLayers()
         return [(layer.first, layer.second.decode('utf-8')) for layer in layers]
@@ -97,29 +198,19 @@ cdef class PyWafer:
         props = self.thisptr.get().getElectricalProperties()
         return [(prop.first.decode('utf-8'), prop.second) for prop in props]
     def get_temperature_profile(self):
-        cdef int rows, cols
-        cdef double* profile_ptr = self.thisptr.get().getTemperatureProfile(&rows, &cols)
-        return np.asarray(<np.float64_t[:rows, :cols]> profile_ptr)
+        return _snapshot_field(self, kTemperatureField)
 
     def get_thermal_conductivity(self):
-        cdef int rows, cols
-        cdef double* conductivity_ptr = self.thisptr.get().getThermalConductivity(&rows, &cols)
-        return np.asarray(<np.float64_t[:rows, :cols]> conductivity_ptr)
+        return _snapshot_field(self, kThermalConductivityField)
 
     def get_electromigration_mttf(self):
-        cdef int rows, cols
-        cdef double* mttf_ptr = self.thisptr.get().getElectromigrationMTTF(&rows, &cols)
-        return np.asarray(<np.float64_t[:rows, :cols]> mttf_ptr)
+        return _snapshot_field(self, kElectromigrationMTTFField)
 
     def get_thermal_stress(self):
-        cdef int rows, cols
-        cdef double* stress_ptr = self.thisptr.get().getThermalStress(&rows, &cols)
-        return np.asarray(<np.float64_t[:rows, :cols]> stress_ptr)
+        return _snapshot_field(self, kThermalStressField)
 
     def get_dielectric_field(self):
-        cdef int rows, cols
-        cdef double* field_ptr = self.thisptr.get().getDielectricField(&rows, &cols)
-        return np.asarray(<np.float64_t[:rows, :cols]> field_ptr)
+        return _snapshot_field(self, kDielectricFieldField)
     def get_material_id(self):
         return self.thisptr.get().getMaterialId().decode('utf-8')
     def get_diameter(self):
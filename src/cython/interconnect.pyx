@@ -1,6 +1,6 @@
 # Author: Dr. Mazharuddin Mohammed
 # distutils: language = c++
-# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/interconnect/damascene_model.cpp ../cpp/core/utils.cpp
+# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/interconnect/damascene_model.cpp ../cpp/modules/interconnect/line_capacitance.cpp ../cpp/modules/interconnect/cmp_model.cpp ../cpp/modules/interconnect/superfill_model.cpp ../cpp/core/utils.cpp
 
 from libcpp.memory cimport shared_ptr
 from libcpp.string cimport string
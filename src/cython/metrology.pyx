@@ -1,6 +1,6 @@
 # Author: Dr. Mazharuddin Mohammed
 # distutils: language = c++
-# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/metrology/metrology_model.cpp ../cpp/core/utils.cpp
+# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/metrology/metrology_model.cpp ../cpp/modules/metrology/optical_library.cpp ../cpp/modules/metrology/spc_engine.cpp ../cpp/core/utils.cpp
 
 from libcpp.memory cimport shared_ptr
 from libcpp.string cimport string
@@ -1,6 +1,6 @@
 # Author: Dr. Mazharuddin Mohammed
 # distutils: language = c++
-# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/multi_die/multi_die_model.cpp ../cpp/core/utils.cpp
+# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/multi_die/multi_die_model.cpp ../cpp/modules/multi_die/coupling_tree.cpp ../cpp/modules/multi_die/interconnect_router.cpp ../cpp/modules/multi_die/unit_cell_homogenizer.cpp ../cpp/modules/advanced_processes/advanced_interconnects.cpp ../cpp/modules/interconnect/line_capacitance.cpp ../cpp/modules/interconnect/cmp_model.cpp ../cpp/core/laminate_plate_solver.cpp ../cpp/core/utils.cpp
 
 from libcpp.memory cimport shared_ptr
 from libcpp.string cimport string
@@ -0,0 +1,201 @@
+// Author: Dr. Mazharuddin Mohammed
+// Glue for the asyncio binding of the orchestrator: runs and batches are
+// waited for on C++ threads, and their completions and the orchestrator's
+// progress reports are posted to a lock-free queue that the event loop
+// drains when a pipe becomes readable. No C++ thread ever needs the GIL,
+// and the binding only takes it to submit and to drain.
+#pragma once
+#include "../cpp/core/simulation_orchestrator.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace orchestrator_async {
+
+struct CompletionEvent {
+  enum Kind { kRun = 0, kBatch = 1, kProgress = 2, kFailed = 3 };
+  int kind = kRun;
+  std::uint64_t ticket = 0;   // Of the submission; 0 for progress
+  bool success = false;       // kRun
+  std::vector<bool> results;  // kBatch, one per submitted pair
+  std::string message;        // kFailed: what the run threw
+  // kProgress: the orchestrator's SimulationProgress, flattened
+  int state = 0;
+  std::size_t current_step = 0;
+  std::size_t total_steps = 0;
+  double percentage = 0.0;
+  std::string operation;
+};
+
+// Multi-producer queue drained by the event loop. Producers push onto a
+// Treiber stack; the consumer takes the whole stack in one exchange and
+// reverses it, so neither side ever waits for the other. A push onto an
+// empty stack writes a byte to the wake pipe, and the consumer empties the
+// pipe before taking the stack, so no push is left unannounced.
+class CompletionQueue : public std::enable_shared_from_this<CompletionQueue> {
+public:
+  using Orchestrator = SemiPRO::SimulationOrchestrator;
+
+  // Throws std::runtime_error if the wake pipe cannot be made
+  static std::shared_ptr<CompletionQueue> create() {
+    return std::shared_ptr<CompletionQueue>(new CompletionQueue());
+  }
+
+  ~CompletionQueue() {
+    Node* node = head_.exchange(nullptr);
+    while (node) {
+      Node* next = node->next;
+      delete node;
+      node = next;
+    }
+    ::close(wake_[0]);
+    ::close(wake_[1]);
+  }
+  CompletionQueue(const CompletionQueue&) = delete;
+  CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+  // Readable whenever events are waiting
+  int fd() const { return wake_[0]; }
+
+  // A flow run; an empty flow name runs the current flow
+  std::uint64_t submitRun(Orchestrator& orchestrator, const std::string& wafer_name, const std::string& flow_name) {
+    const std::uint64_t ticket = next_ticket_++;
+    std::future<bool> run = flow_name.empty() ? orchestrator.executeSimulation(wafer_name)
+                                              : orchestrator.executeSimulationFlow(flow_name, wafer_name);
+    wait(ticket, std::move(run));
+    return ticket;
+  }
+
+  // A progressive run (SimulationOrchestrator::executeProgressive)
+  std::uint64_t submitProgressive(Orchestrator& orchestrator, const std::string& wafer_name) {
+    const std::uint64_t ticket = next_ticket_++;
+    wait(ticket, orchestrator.executeProgressive(wafer_name));
+    return ticket;
+  }
+
+  // A batch of (wafer, flow) pairs in one call; an empty list runs the
+  // orchestrator's queued batch
+  std::uint64_t submitBatch(Orchestrator& orchestrator, std::vector<std::pair<std::string, std::string>> batch) {
+    const std::uint64_t ticket = next_ticket_++;
+    std::future<std::vector<bool>> run =
+        batch.empty() ? orchestrator.executeBatch() : orchestrator.executeBatch(std::move(batch));
+    wait(ticket, std::move(run));
+    return ticket;
+  }
+
+  // Posts the orchestrator's progress reports from now on; the callback
+  // stays registered but goes quiet once the queue is gone
+  void watchProgress(Orchestrator& orchestrator) {
+    if (watching_.exchange(true)) {
+      return;
+    }
+    std::weak_ptr<CompletionQueue> weak = shared_from_this();
+    orchestrator.setProgressCallback([weak](const Orchestrator::SimulationProgress& progress) {
+      if (auto queue = weak.lock()) {
+        CompletionEvent event;
+        event.kind = CompletionEvent::kProgress;
+        event.state = static_cast<int>(progress.state);
+        event.current_step = progress.current_step;
+        event.total_steps = progress.total_steps;
+        event.percentage = progress.progress_percentage;
+        event.operation = progress.current_operation;
+        queue->push(std::move(event));
+      }
+    });
+  }
+
+  // Posts an event; safe from any thread
+  void push(CompletionEvent event) {
+    Node* node = new Node{std::move(event), nullptr};
+    // Once published the node belongs to the consumer, which may drain and
+    // delete it at once, so only the local copy of the old head is read
+    Node* expected = head_.load(std::memory_order_relaxed);
+    do {
+      node->next = expected;
+    } while (!head_.compare_exchange_weak(expected, node, std::memory_order_release, std::memory_order_relaxed));
+    if (!expected) {
+      // A full pipe already has the loop's attention
+      const char byte = 1;
+      while (::write(wake_[1], &byte, 1) < 0 && errno == EINTR) {
+      }
+    }
+  }
+
+  // Takes every waiting event, oldest first, into events
+  void drain(std::vector<CompletionEvent>& events) {
+    char buffer[64];
+    while (::read(wake_[0], buffer, sizeof(buffer)) > 0) {
+    }
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    Node* oldest = nullptr;
+    while (node) {
+      Node* next = node->next;
+      node->next = oldest;
+      oldest = node;
+      node = next;
+    }
+    while (oldest) {
+      events.push_back(std::move(oldest->event));
+      Node* next = oldest->next;
+      delete oldest;
+      oldest = next;
+    }
+  }
+
+private:
+  struct Node {
+    CompletionEvent event;
+    Node* next = nullptr;
+  };
+
+  CompletionQueue() {
+    if (::pipe(wake_) != 0) {
+      throw std::runtime_error("Cannot create completion pipe");
+    }
+    for (int end : wake_) {
+      ::fcntl(end, F_SETFL, ::fcntl(end, F_GETFL) | O_NONBLOCK);
+      ::fcntl(end, F_SETFD, FD_CLOEXEC);
+    }
+  }
+
+  // Waits for the run on a thread of its own, which keeps the queue alive
+  // until it has posted the outcome
+  template <typename Result>
+  void wait(std::uint64_t ticket, std::future<Result> run) {
+    std::thread([queue = shared_from_this(), ticket, run = std::move(run)]() mutable {
+      CompletionEvent event;
+      event.ticket = ticket;
+      try {
+        Result result = run.get();
+        if constexpr (std::is_same_v<Result, bool>) {
+          event.kind = CompletionEvent::kRun;
+          event.success = result;
+        } else {
+          event.kind = CompletionEvent::kBatch;
+          event.results = std::move(result);
+        }
+      } catch (const std::exception& e) {
+        event.kind = CompletionEvent::kFailed;
+        event.message = e.what();
+      }
+      queue->push(std::move(event));
+    }).detach();
+  }
+
+  int wake_[2] = {-1, -1};
+  std::atomic<Node*> head_{nullptr};
+  std::atomic<std::uint64_t> next_ticket_{1};
+  std::atomic<bool> watching_{false};
+};
+
+} // namespace orchestrator_async
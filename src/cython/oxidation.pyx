@@ -1,5 +1,5 @@
 # distutils: language = c++
-# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/oxidation/oxidation_model.cpp ../cpp/core/utils.cpp
+# distutils: sources = ../cpp/core/wafer.cpp ../cpp/core/field_store.cpp ../cpp/modules/oxidation/oxidation_model.cpp ../cpp/core/utils.cpp
 
 from libcpp.memory cimport shared_ptr
 from libcpp.string cimport string
@@ -44,8 +44,8 @@ cdef extern from "../cpp/modules/oxidation/oxidation_model.hpp":
 
     cppclass OxidationModel:
         OxidationModel() except +
-        void simulateOxidation(shared_ptr[Wafer], double, double) except +
-        OxidationResults simulateEnhancedOxidation(shared_ptr[Wafer], const OxidationConditions&) except +
+        void simulateOxidation(shared_ptr[Wafer], double, double) except + nogil
+        OxidationResults simulateEnhancedOxidation(shared_ptr[Wafer], const OxidationConditions&) except + nogil
 
 # Python wrapper classes
 cdef class PyOxidationConditions:
@@ -146,11 +146,18 @@ cdef class PyOxidationModel:
 
     def simulate_oxidation(self, wafer: PyWafer, temperature: float, time: float):
         """Basic oxidation simulation"""
-        self.thisptr.simulateOxidation(wafer.thisptr, temperature, time)
+        cdef shared_ptr[Wafer] target = wafer.thisptr
+        cdef double cpp_temperature = temperature, cpp_time = time
+        with nogil:
+            self.thisptr.simulateOxidation(target, cpp_temperature, cpp_time)
 
     def simulate_enhanced_oxidation(self, wafer: PyWafer, conditions: PyOxidationConditions):
         """Enhanced oxidation simulation with detailed parameters"""
-        cdef OxidationResults cpp_results = self.thisptr.simulateEnhancedOxidation(wafer.thisptr, conditions.conditions)
+        cdef shared_ptr[Wafer] target = wafer.thisptr
+        cdef OxidationConditions cpp_conditions = conditions.conditions
+        cdef OxidationResults cpp_results
+        with nogil:
+            cpp_results = self.thisptr.simulateEnhancedOxidation(target, cpp_conditions)
 
         py_results = PyOxidationResults()
         py_results.results = cpp_results
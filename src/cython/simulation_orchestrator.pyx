@@ -6,10 +6,11 @@ from libcpp.string cimport string
 from libcpp.vector cimport vector
 from libcpp.unordered_map cimport unordered_map
 from libcpp.memory cimport shared_ptr, make_shared
+from libcpp.utility cimport pair
 from libcpp cimport bool
 from libcpp.future cimport future
 import asyncio
-from typing import Dict, List, Optional, Callable, Any
+from typing import Dict, List, Optional, Callable, Any, Tuple
 
 # C++ declarations
 cdef extern from "src/cpp/core/simulation_orchestrator.hpp" namespace "SemiPRO":
@@ -50,6 +51,8 @@ cdef extern from "src/cpp/core/simulation_orchestrator.hpp" namespace "SemiPRO":
         double estimated_duration
         int priority
         bool parallel_compatible
+        vector[string] reads
+        vector[string] writes
 
     cdef struct SimulationProgress:
         SimulationState state
@@ -85,6 +88,7 @@ cdef extern from "src/cpp/core/simulation_orchestrator.hpp" namespace "SemiPRO":
         void addProcessStep(const ProcessStepDefinition& step)
         void removeProcessStep(const string& step_name)
         void reorderSteps(const vector[string]& step_order)
+        void setStepParameter(const string& step_name, const string& key, double value) except +
         
         # Execution control
         future[bool] executeSimulation(const string& wafer_name)
@@ -117,6 +121,20 @@ cdef extern from "src/cpp/core/simulation_orchestrator.hpp" namespace "SemiPRO":
         ExecutionMode getExecutionMode()
         void setMaxParallelSteps(int max_steps)
         int getMaxParallelSteps()
+        void setStageWorkers(StepType type, int workers)
+        int getStageWorkers(StepType type)
+        void setStageQueueCapacity(StepType type, int capacity)
+        int getStageQueueCapacity(StepType type)
+        
+        # Incremental re-simulation
+        void enableIncrementalResimulation(bool enable)
+        bool isIncrementalResimulationEnabled()
+        void clearStepSnapshots(const string& wafer_name)
+        
+        # Progressive refinement
+        future[bool] executeProgressive(const string& wafer_name)
+        void setPreviewResolution(int max_cells) except +
+        int getPreviewResolution()
         
         # Checkpointing
         void enableCheckpointing(bool enable, int interval_minutes)
@@ -127,6 +145,41 @@ cdef extern from "src/cpp/core/simulation_orchestrator.hpp" namespace "SemiPRO":
         ExecutionStatistics getExecutionStatistics()
         void generateExecutionReport(const string& filename)
 
+# Completion queue the asyncio binding waits on (orchestrator_async.hpp)
+cdef extern from "orchestrator_async.hpp" namespace "orchestrator_async":
+    cdef cppclass CompletionEvent:
+        int kind
+        unsigned long long ticket
+        bool success
+        vector[bool] results
+        string message
+        int state
+        size_t current_step
+        size_t total_steps
+        double percentage
+        string operation
+
+    cdef cppclass CompletionQueue:
+        @staticmethod
+        shared_ptr[CompletionQueue] create() except +
+        int fd()
+        unsigned long long submitRun(SimulationOrchestrator& orchestrator, const string& wafer_name,
+                                     const string& flow_name) nogil except +
+        unsigned long long submitBatch(SimulationOrchestrator& orchestrator,
+                                       vector[pair[string, string]] batch) nogil except +
+        unsigned long long submitProgressive(SimulationOrchestrator& orchestrator,
+                                             const string& wafer_name) nogil except +
+        void watchProgress(SimulationOrchestrator& orchestrator) nogil except +
+        void drain(vector[CompletionEvent]& events) nogil
+
+cdef enum:
+    EVENT_RUN = 0
+    EVENT_BATCH = 1
+    EVENT_PROGRESS = 2
+    EVENT_FAILED = 3
+
+_STATE_NAMES = ["idle", "initializing", "running", "paused", "completed", "error", "cancelled"]
+
 # Python wrapper classes
 cdef class PyProcessStepDefinition:
     """Python wrapper for ProcessStepDefinition"""
@@ -210,6 +263,26 @@ cdef class PyProcessStepDefinition:
         for d in value:
             self._step.dependencies.push_back(d.encode('utf-8'))
     
+    @property
+    def reads(self) -> List[str]:
+        return [f.decode('utf-8') for f in self._step.reads]
+    
+    @reads.setter
+    def reads(self, value: List[str]):
+        self._step.reads.clear()
+        for f in value:
+            self._step.reads.push_back(f.encode('utf-8'))
+    
+    @property
+    def writes(self) -> List[str]:
+        return [f.decode('utf-8') for f in self._step.writes]
+    
+    @writes.setter
+    def writes(self, value: List[str]):
+        self._step.writes.clear()
+        for f in value:
+            self._step.writes.push_back(f.encode('utf-8'))
+    
     @property
     def estimated_duration(self) -> float:
         return self._step.estimated_duration
@@ -316,9 +389,20 @@ cdef class PyExecutionStatistics:
 cdef class PySimulationOrchestrator:
     """Python wrapper for SimulationOrchestrator"""
     cdef SimulationOrchestrator* _orchestrator
+    # Awaitables of the asyncio binding: C++ threads wait for the runs and
+    # post to _completions, which the event loop drains when its pipe turns
+    # readable
+    cdef shared_ptr[CompletionQueue] _completions
+    cdef object _loop
+    cdef dict _pending
+    cdef list _progress_callbacks
     
     def __cinit__(self):
         self._orchestrator = &SimulationOrchestrator.getInstance()
+        self._completions = CompletionQueue.create()
+        self._loop = None
+        self._pending = {}
+        self._progress_callbacks = []
     
     # Configuration management
     def load_configuration(self, config_file: str):
@@ -354,6 +438,10 @@ cdef class PySimulationOrchestrator:
         """Remove a process step from the current flow"""
         self._orchestrator.removeProcessStep(step_name.encode('utf-8'))
     
+    def set_step_parameter(self, step_name: str, key: str, value: float):
+        """Change one parameter of a step in the current flow"""
+        self._orchestrator.setStepParameter(step_name.encode('utf-8'), key.encode('utf-8'), value)
+    
     def reorder_steps(self, step_order: List[str]):
         """Reorder process steps"""
         cdef vector[string] cpp_order
@@ -362,28 +450,85 @@ cdef class PySimulationOrchestrator:
         self._orchestrator.reorderSteps(cpp_order)
 
     # Execution control
-    async def execute_simulation(self, wafer_name: str) -> bool:
-        """Execute simulation asynchronously"""
-        # Note: This is a simplified async wrapper
-        # In a real implementation, you'd need proper async/await integration
-        return await asyncio.get_event_loop().run_in_executor(
-            None, self._execute_simulation_sync, wafer_name)
+    cdef object _attach(self):
+        """Future on the running event loop, which from now on drains the queue"""
+        loop = asyncio.get_running_loop()
+        if loop is not self._loop:
+            if self._loop is not None and not self._loop.is_closed():
+                self._loop.remove_reader(self._completions.get().fd())
+            loop.add_reader(self._completions.get().fd(), self._drain)
+            self._loop = loop
+        return loop.create_future()
+
+    def _drain(self):
+        """Resolve finished submissions and deliver progress, on the event loop"""
+        cdef vector[CompletionEvent] events
+        cdef CompletionEvent event
+        with nogil:
+            self._completions.get().drain(events)
+        for event in events:
+            if event.kind == EVENT_PROGRESS:
+                report = {
+                    "state": _STATE_NAMES[event.state],
+                    "current_step": event.current_step,
+                    "total_steps": event.total_steps,
+                    "progress_percentage": event.percentage,
+                    "current_operation": event.operation.decode('utf-8', 'replace'),
+                }
+                for callback in list(self._progress_callbacks):
+                    callback(report)
+                continue
+            waiter = self._pending.pop(event.ticket, None)
+            if waiter is None or waiter.done():
+                continue
+            if event.kind == EVENT_RUN:
+                waiter.set_result(event.success)
+            elif event.kind == EVENT_BATCH:
+                waiter.set_result([r for r in event.results])
+            else:
+                waiter.set_exception(RuntimeError(event.message.decode('utf-8', 'replace')))
+
+    def submit_simulation(self, wafer_name: str, flow_name: Optional[str] = None) -> "asyncio.Future":
+        """Start a run of a flow (default: the current flow) on a wafer; the
+        future resolves to its success. Call from a coroutine."""
+        waiter = self._attach()
+        cdef string wafer = wafer_name.encode('utf-8')
+        cdef string flow = (flow_name or "").encode('utf-8')
+        cdef unsigned long long ticket
+        with nogil:
+            ticket = self._completions.get().submitRun(self._orchestrator[0], wafer, flow)
+        self._pending[ticket] = waiter
+        return waiter
+
+    def submit_batch(self, items: Optional[List[Tuple[str, str]]] = None) -> "asyncio.Future":
+        """Start a batch of (wafer, flow) pairs in one call (default: the queued
+        batch); the future resolves to one success per pair. Call from a coroutine."""
+        waiter = self._attach()
+        cdef vector[pair[string, string]] batch
+        if items:
+            batch.reserve(len(items))
+            for wafer_name, flow_name in items:
+                batch.push_back(pair[string, string](wafer_name.encode('utf-8'), flow_name.encode('utf-8')))
+        cdef unsigned long long ticket
+        with nogil:
+            ticket = self._completions.get().submitBatch(self._orchestrator[0], batch)
+        self._pending[ticket] = waiter
+        return waiter
 
-    def _execute_simulation_sync(self, wafer_name: str) -> bool:
-        """Synchronous execution wrapper"""
-        cdef future[bool] result = self._orchestrator.executeSimulation(wafer_name.encode('utf-8'))
-        return result.get()  # This blocks until completion
+    async def execute_simulation(self, wafer_name: str) -> bool:
+        """Run the current flow on a wafer without blocking the event loop"""
+        return await self.submit_simulation(wafer_name)
 
     async def execute_simulation_flow(self, flow_name: str, wafer_name: str) -> bool:
-        """Execute specific simulation flow asynchronously"""
-        return await asyncio.get_event_loop().run_in_executor(
-            None, self._execute_simulation_flow_sync, flow_name, wafer_name)
+        """Run a named flow on a wafer without blocking the event loop"""
+        return await self.submit_simulation(wafer_name, flow_name)
 
-    def _execute_simulation_flow_sync(self, flow_name: str, wafer_name: str) -> bool:
-        """Synchronous flow execution wrapper"""
-        cdef future[bool] result = self._orchestrator.executeSimulationFlow(
-            flow_name.encode('utf-8'), wafer_name.encode('utf-8'))
-        return result.get()
+    def add_progress_callback(self, callback: Callable[[Dict[str, Any]], None]):
+        """Call callback(progress) on the event loop for every progress report;
+        progress holds the fields of PySimulationProgress"""
+        self._progress_callbacks.append(callback)
+        with nogil:
+            self._completions.get().watchProgress(self._orchestrator[0])
 
     def pause_simulation(self):
         """Pause the current simulation"""
@@ -406,16 +551,9 @@ cdef class PySimulationOrchestrator:
         """Add wafer to batch processing queue"""
         self._orchestrator.addWaferToBatch(wafer_name.encode('utf-8'), flow_name.encode('utf-8'))
 
-    async def execute_batch(self) -> List[bool]:
-        """Execute batch processing asynchronously"""
-        return await asyncio.get_event_loop().run_in_executor(
-            None, self._execute_batch_sync)
-
-    def _execute_batch_sync(self) -> List[bool]:
-        """Synchronous batch execution wrapper"""
-        cdef future[vector[bool]] result = self._orchestrator.executeBatch()
-        cdef vector[bool] cpp_results = result.get()
-        return [r for r in cpp_results]
+    async def execute_batch(self, items: Optional[List[Tuple[str, str]]] = None) -> List[bool]:
+        """Run (wafer, flow) pairs, or the queued batch, without blocking the event loop"""
+        return await self.submit_batch(items)
 
     def clear_batch(self):
         """Clear batch processing queue"""
@@ -499,6 +637,54 @@ cdef class PySimulationOrchestrator:
         """Get maximum number of parallel steps"""
         return self._orchestrator.getMaxParallelSteps()
 
+    def set_stage_workers(self, step_type: str, workers: int):
+        """Set how many wafers a stage processes at once in batch mode"""
+        self._orchestrator.setStageWorkers(PyProcessStepDefinition._string_to_step_type(step_type), workers)
+
+    def get_stage_workers(self, step_type: str) -> int:
+        """Get the worker quota of a batch-mode stage"""
+        return self._orchestrator.getStageWorkers(PyProcessStepDefinition._string_to_step_type(step_type))
+
+    def set_stage_queue_capacity(self, step_type: str, capacity: int):
+        """Set how many wafers may wait for a stage in batch mode"""
+        self._orchestrator.setStageQueueCapacity(PyProcessStepDefinition._string_to_step_type(step_type), capacity)
+
+    def get_stage_queue_capacity(self, step_type: str) -> int:
+        """Get the queue capacity of a batch-mode stage"""
+        return self._orchestrator.getStageQueueCapacity(PyProcessStepDefinition._string_to_step_type(step_type))
+
+    # Incremental re-simulation
+    def enable_incremental_resimulation(self, enable: bool):
+        """Keep per-step wafer snapshots so a re-run only recomputes changed steps"""
+        self._orchestrator.enableIncrementalResimulation(enable)
+
+    def is_incremental_resimulation_enabled(self) -> bool:
+        """Check whether incremental re-simulation is enabled"""
+        return self._orchestrator.isIncrementalResimulationEnabled()
+
+    def clear_step_snapshots(self, wafer_name: str = ""):
+        """Drop the step snapshots of one wafer, or of all wafers"""
+        self._orchestrator.clearStepSnapshots(wafer_name.encode('utf-8'))
+
+    # Progressive refinement
+    async def execute_progressive(self, wafer_name: str) -> bool:
+        """Run the flow on a coarse copy of the wafer, then on the wafer itself"""
+        waiter = self._attach()
+        cdef string wafer = wafer_name.encode('utf-8')
+        cdef unsigned long long ticket
+        with nogil:
+            ticket = self._completions.get().submitProgressive(self._orchestrator[0], wafer)
+        self._pending[ticket] = waiter
+        return await waiter
+
+    def set_preview_resolution(self, max_cells: int):
+        """Set the longest side, in cells, of the coarse preview grid"""
+        self._orchestrator.setPreviewResolution(max_cells)
+
+    def get_preview_resolution(self) -> int:
+        """Get the longest side, in cells, of the coarse preview grid"""
+        return self._orchestrator.getPreviewResolution()
+
     # Checkpointing
     def enable_checkpointing(self, enable: bool, interval_minutes: int = 10):
         """Enable/disable automatic checkpointing"""
@@ -541,6 +727,10 @@ def create_process_step(step_type: str, name: str, **kwargs) -> PyProcessStepDef
         step.priority = kwargs['priority']
     if 'parallel_compatible' in kwargs:
         step.parallel_compatible = kwargs['parallel_compatible']
+    if 'reads' in kwargs:
+        step.reads = kwargs['reads']
+    if 'writes' in kwargs:
+        step.writes = kwargs['writes']
 
     return step
 
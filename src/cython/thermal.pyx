@@ -1,5 +1,5 @@
 # distutils: language = c++
-# distutils: sources = ../cpp/core/wafer.cpp ../cpp/modules/thermal/thermal_model.cpp ../cpp/core/utils.cpp
+# distutils: sources = ../cpp/core/wafer.cpp ../cpp/core/field_store.cpp ../cpp/modules/thermal/thermal_model.cpp ../cpp/core/utils.cpp
 
 from libcpp.memory cimport shared_ptr
 from libcpp.string cimport string
@@ -8,7 +8,7 @@ from geometry cimport PyWafer, Wafer
 cdef extern from "../cpp/modules/thermal/thermal_model.hpp":
     cppclass ThermalSimulationModel:
         ThermalSimulationModel() except +
-        void simulateThermal(shared_ptr[Wafer], double, double) except +
+        void simulateThermal(shared_ptr[Wafer], double, double) except + nogil
 
 cdef class PyThermalSimulationModel:
     cdef ThermalSimulationModel* thisptr
@@ -17,4 +17,7 @@ cdef class PyThermalSimulationModel:
     def __dealloc__(self):
         del self.thisptr
     def simulate_thermal(self, wafer: PyWafer, ambient_temperature: float, current: float):
-        self.thisptr.simulateThermal(wafer.thisptr, ambient_temperature, current)
\ No newline at end of file
+        cdef shared_ptr[Wafer] target = wafer.thisptr
+        cdef double cpp_ambient = ambient_temperature, cpp_current = current
+        with nogil:
+            self.thisptr.simulateThermal(target, cpp_ambient, cpp_current)
\ No newline at end of file
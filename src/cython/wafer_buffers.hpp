@@ -0,0 +1,61 @@
+// Author: Dr. Mazharuddin Mohammed
+// Glue for the Cython bindings: hands wafer fields to NumPy as raw
+// column-major storage and feeds NumPy buffers to the Eigen-typed Wafer
+// setters, so neither direction converts element by element in Python.
+#pragma once
+#include "../cpp/core/wafer.hpp"
+#include <cstddef>
+#include <stdexcept>
+
+namespace wafer_buffers {
+
+// Live storage of the channels Wafer exposes mutably (grid and photoresist
+// pattern); other channels only change through their setters.
+inline double* mutableField(Wafer& wafer, Wafer::FieldChannel channel, int* rows, int* cols) {
+  FieldView view = channel == Wafer::kGridField          ? wafer.getGrid()
+                   : channel == Wafer::kPhotoresistField ? wafer.getPhotoresistPattern()
+                   : throw std::invalid_argument("Wafer field is read-only");
+  *rows = static_cast<int>(view.rows());
+  *cols = static_cast<int>(view.cols());
+  return view.data();
+}
+
+inline const double* snapshotData(const FieldSnapshot& snapshot) { return snapshot.view().data(); }
+
+inline double* dopantData(Wafer& wafer, int* size) {
+  Eigen::ArrayXd& profile = wafer.getDopantProfile();
+  *size = static_cast<int>(profile.size());
+  return profile.data();
+}
+
+// Strides are in elements. A Fortran-ordered buffer binds to the setters'
+// Eigen::Ref as is; any other layout is gathered once by Eigen.
+inline void setField(Wafer& wafer, Wafer::FieldChannel channel, const double* data, int rows, int cols,
+                     std::ptrdiff_t row_stride, std::ptrdiff_t col_stride) {
+  auto apply = [&](const Eigen::Ref<const Eigen::ArrayXXd>& values) {
+    switch (channel) {
+    case Wafer::kGridField: wafer.updateGrid(values); break;
+    case Wafer::kPhotoresistField: wafer.setPhotoresistPattern(values); break;
+    case Wafer::kTemperatureField: wafer.setTemperatureProfile(values); break;
+    case Wafer::kThermalConductivityField: wafer.setThermalConductivity(values); break;
+    case Wafer::kElectromigrationMTTFField: wafer.setElectromigrationMTTF(values); break;
+    case Wafer::kThermalStressField: wafer.setThermalStress(values); break;
+    case Wafer::kDielectricFieldField: wafer.setDielectricField(values); break;
+    default: throw std::invalid_argument("Unknown wafer field");
+    }
+  };
+  if (row_stride == 1) {
+    apply(Eigen::Map<const Eigen::ArrayXXd, 0, Eigen::OuterStride<>>(data, rows, cols,
+                                                                     Eigen::OuterStride<>(col_stride)));
+  } else {
+    using Strided = Eigen::Map<const Eigen::ArrayXXd, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+    apply(Strided(data, rows, cols, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(col_stride, row_stride)));
+  }
+}
+
+inline void setDopantProfile(Wafer& wafer, const double* data, int size, std::ptrdiff_t stride) {
+  wafer.setDopantProfile(Eigen::Map<const Eigen::ArrayXd, 0, Eigen::InnerStride<>>(data, size,
+                                                                                   Eigen::InnerStride<>(stride)));
+}
+
+} // namespace wafer_buffers
@@ -1,18 +1,141 @@
 # Author: Dr. Mazharuddin Mohammed
 """
 C++ Bridge for SemiPRO - Direct interface to C++ backend
-This module provides a bridge to the C++ backend without requiring Cython
+This module provides a bridge to the C++ backend without requiring Cython.
+
+All bridges created for one simulator executable share a single
+long-lived ``simulator --serve`` process. Requests travel as JSON lines
+over a Unix socket; wafer fields stay in POSIX shared memory owned by
+the C++ FieldStore, and results are NumPy views of that memory, so a
+call costs a socket round trip rather than a process launch plus file
+parsing.
 """
 
-import subprocess
+import atexit
 import json
+import mmap
 import os
+import shutil
+import socket
+import subprocess
 import tempfile
+import time
 import numpy as np
 from pathlib import Path
 
+class SimulatorServer:
+    """Client of a ``simulator --serve`` process"""
+
+    _shared = {}
+
+    @classmethod
+    def shared(cls, simulator_path):
+        """Server for an executable, started on first use"""
+        key = str(Path(simulator_path).resolve())
+        server = cls._shared.get(key)
+        if server is None or not server.alive():
+            server = cls._shared[key] = cls(simulator_path)
+        return server
+
+    def __init__(self, simulator_path, startup_timeout=10.0):
+        self.temp_dir = Path(tempfile.mkdtemp(prefix="semipro_server_"))
+        self.socket_path = str(self.temp_dir / "simulator.sock")
+        self.log_path = self.temp_dir / "simulator.log"
+        self._layouts = {}
+        self._segments = {}
+        with open(self.log_path, "w") as log:
+            self.process = subprocess.Popen(
+                [str(simulator_path), "--serve", self.socket_path],
+                stdout=log, stderr=subprocess.STDOUT)
+
+        deadline = time.monotonic() + startup_timeout
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        while True:
+            try:
+                self.sock.connect(self.socket_path)
+                break
+            except (FileNotFoundError, ConnectionRefusedError):
+                if self.process.poll() is not None or time.monotonic() > deadline:
+                    self.close()
+                    raise RuntimeError(f"C++ simulator server failed to start, see {self.log_path}")
+                time.sleep(0.01)
+        self._reader = self.sock.makefile("rb")
+        atexit.register(self.close)
+
+    def alive(self):
+        return self.process is not None and self.process.poll() is None
+
+    def request(self, op, **fields):
+        """Sends one request and returns the decoded reply"""
+        self.sock.sendall((json.dumps(dict(op=op, **fields)) + "\n").encode())
+        line = self._reader.readline()
+        if not line:
+            raise RuntimeError(f"C++ simulator server exited, see {self.log_path}")
+        reply = json.loads(line)
+        if not reply.get("ok"):
+            raise RuntimeError(f"C++ simulation failed: {reply.get('error')}")
+        return reply
+
+    def run_process(self, process_type, config, wafer="main_wafer"):
+        """Runs a bridge operation; True if the process succeeded"""
+        reply = self.request("process", wafer=wafer, process=process_type, config=config)
+        self._layouts[wafer] = reply.get("fields")
+        return reply["success"]
+
+    def fields(self, wafer="main_wafer"):
+        """Field name -> writable NumPy view of the wafer's C++ storage
+
+        Views stay valid across requests, but a request that gives the
+        wafer a new segment generation (e.g. a grid resize) detaches them
+        from the live fields; call fields() again after each request.
+        """
+        layout = self._layouts.get(wafer)
+        if layout is None:
+            layout = self.request("fields", wafer=wafer)["fields"]
+            if layout is None:
+                return {}
+            self._layouts[wafer] = layout
+
+        segment = self._segments.get(wafer)
+        if segment is None or segment[0] != layout["generation"]:
+            fd = os.open("/dev/shm" + layout["segment"], os.O_RDWR)
+            try:
+                buffer = mmap.mmap(fd, layout["bytes"])
+            finally:
+                os.close(fd)
+            # Earlier maps close once the last view of them is gone
+            segment = self._segments[wafer] = (layout["generation"], buffer)
+        buffer = segment[1]
+
+        shape = (layout["rows"], layout["cols"])
+        stride = layout["stride"] * 8
+        views = {
+            name: np.ndarray(shape, dtype=np.float64, buffer=buffer, offset=index * stride, order="F")
+            for index, name in enumerate(layout["channels"])
+        }
+        views["dopant_profile"] = np.ndarray((layout["dopant_length"],), dtype=np.float64, buffer=buffer,
+                                             offset=layout["dopant_offset"] * 8)
+        return views
+
+    def close(self):
+        """Stops the server; safe to call more than once"""
+        process, self.process = getattr(self, "process", None), None
+        if process is not None and process.poll() is None:
+            try:
+                self.request("shutdown")
+            except (OSError, RuntimeError, ValueError):
+                pass
+            try:
+                process.wait(timeout=5)
+            except subprocess.TimeoutExpired:
+                process.kill()
+                process.wait()
+        if getattr(self, "sock", None) is not None:
+            self.sock.close()
+        shutil.rmtree(self.temp_dir, ignore_errors=True)
+
 class CPPBridge:
-    """Bridge to C++ backend using subprocess calls"""
+    """Bridge to the C++ backend through a shared simulator server"""
     
     def __init__(self, build_dir="build"):
         self.build_dir = Path(build_dir)
@@ -27,70 +150,25 @@ class CPPBridge:
     def __del__(self):
         """Cleanup temporary files"""
         try:
-            import shutil
             if hasattr(self, 'temp_dir') and self.temp_dir and self.temp_dir.exists():
                 shutil.rmtree(self.temp_dir, ignore_errors=True)
         except (ImportError, AttributeError):
             # Ignore cleanup errors during shutdown
             pass
-    
-    def create_config_file(self, config_data):
-        """Create a configuration file for C++ backend"""
-        config_file = self.temp_dir / "config.json"
-        with open(config_file, 'w') as f:
-            json.dump(config_data, f, indent=2)
-        return config_file
+
+    @property
+    def server(self):
+        return SimulatorServer.shared(self.simulator_path)
     
     def run_simulation(self, process_type, parameters):
-        """Run a simulation process"""
-        # Create config with just the parameters (not nested)
-        config_file = self.create_config_file(parameters)
-        
-        try:
-            # Run the C++ simulator
-            result = subprocess.run([
-                str(self.simulator_path),
-                "--config", str(config_file),
-                "--process", process_type
-            ], capture_output=True, text=True, timeout=60)
-            
-            if result.returncode != 0:
-                raise RuntimeError(f"C++ simulation failed: {result.stderr}")
-            
-            return self.parse_results()
-            
-        except subprocess.TimeoutExpired:
-            raise RuntimeError("Simulation timed out")
+        """Run a simulation process on the shared wafer"""
+        if not self.server.run_process(process_type, parameters):
+            raise RuntimeError(f"C++ simulation failed: {process_type}")
+        return self.parse_results()
     
     def parse_results(self):
-        """Parse simulation results from output files"""
-        results = {}
-        
-        # Look for common output files
-        output_files = [
-            "concentration.dat",
-            "temperature.dat", 
-            "stress.dat",
-            "results.json"
-        ]
-        
-        for filename in output_files:
-            filepath = self.temp_dir / filename
-            if filepath.exists():
-                if filename.endswith('.json'):
-                    with open(filepath, 'r') as f:
-                        results[filename[:-5]] = json.load(f)
-                elif filename.endswith('.dat'):
-                    # Assume binary data files contain numpy arrays
-                    try:
-                        data = np.fromfile(filepath, dtype=np.float64)
-                        results[filename[:-4]] = data
-                    except:
-                        # Fallback to text format
-                        data = np.loadtxt(filepath)
-                        results[filename[:-4]] = data
-        
-        return results
+        """Wafer fields as NumPy views of the simulator's memory"""
+        return self.server.fields()
 
 class GeometryBridge(CPPBridge):
     """Bridge for geometry operations"""
@@ -169,12 +247,12 @@ class ThermalBridge(CPPBridge):
     
     def simulate_thermal(self, temperature_profile, time_step, total_time):
         """Simulate thermal effects"""
-        # Save temperature profile to file
-        temp_file = self.temp_dir / "temperature_profile.dat"
-        np.savetxt(temp_file, temperature_profile)
+        # Written straight into the wafer's temperature field
+        fields = self.parse_results()
+        if "temperature_profile" in fields:
+            fields["temperature_profile"][...] = temperature_profile
         
         return self.run_simulation("thermal", {
-            "temperature_file": str(temp_file),
             "time_step": time_step,
             "total_time": total_time
         })
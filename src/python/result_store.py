@@ -0,0 +1,93 @@
+# Author: Dr. Mazharuddin Mohammed
+"""
+Reader of the columnar result stores the C++ ResultStore writes.
+
+A store is a directory holding ``schema.json`` and one ``.npy`` file per
+column of its two tables: ``records`` (one row per batch job, optimizer
+evaluation, measurement or inspection) and ``values`` (one row per named
+value of a record). String columns are stored as int32 codes into the
+dictionaries listed in the schema.
+
+Columns are memory-mapped, so opening a store of 10^5 runs reads a few
+kilobytes of schema; Arrow tables wrap the mapped columns without
+copying, the coded columns as dictionary arrays.
+"""
+
+import json
+from pathlib import Path
+
+import numpy as np
+
+
+class ResultStore:
+    """A result store directory, opened read-only"""
+
+    def __init__(self, path):
+        self.path = Path(path)
+        with open(self.path / "schema.json") as f:
+            self.schema = json.load(f)
+        if self.schema.get("format", 0) > 1:
+            raise ValueError(f"{path} was written by a newer version of SemiPRO")
+        self.dictionaries = self.schema["dictionaries"]
+
+    def tables(self):
+        return list(self.schema["tables"])
+
+    def columns(self, table):
+        """The table's columns as read-only NumPy views of the files, codes
+        left as they are. Only rows of complete record batches are
+        included, so a store still being written reads consistently."""
+        spec = self.schema["tables"][table]
+        rows = spec["rows"]
+        return {column["name"]: np.load(self.path / table / f"{column['name']}.npy", mmap_mode="r")[:rows]
+                for column in spec["columns"]}
+
+    def decode(self, table, column, codes=None):
+        """Strings of a coded column, or of the given codes"""
+        dictionary = self._dictionary_of(table, column)
+        if codes is None:
+            codes = self.columns(table)[column]
+        return np.asarray(self.dictionaries[dictionary], dtype=object)[codes]
+
+    def to_arrow(self, table):
+        """The table as a pyarrow.Table over the mapped columns"""
+        import pyarrow as pa
+
+        arrays = {}
+        for name, data in self.columns(table).items():
+            array = pa.array(data)
+            dictionary = self._dictionary_of(table, name)
+            if dictionary is not None:
+                array = pa.DictionaryArray.from_arrays(array, pa.array(self.dictionaries[dictionary], pa.string()))
+            arrays[name] = array
+        return pa.table(arrays)
+
+    def to_pandas(self):
+        """One row per record, one column per (group, name) of its values,
+        NaN where a record has no such value"""
+        import pandas as pd
+
+        records = self.columns("records")
+        frame = pd.DataFrame({
+            "id": records["id"],
+            "source": pd.Categorical.from_codes(records["source"], self.dictionaries["source"]),
+            "label": pd.Categorical.from_codes(records["label"], self.dictionaries["label"]),
+            "ok": records["ok"].astype(bool),
+            "seconds": records["seconds"],
+        }).set_index("id").sort_index()
+
+        values = self.columns("values")
+        groups = np.asarray(self.dictionaries["group"], dtype=object)
+        names = np.asarray(self.dictionaries["name"], dtype=object)
+        wide = pd.DataFrame({
+            "record": values["record"],
+            "key": groups[values["group"]] + "." + names[values["name"]],
+            "value": values["value"],
+        }).pivot_table(index="record", columns="key", values="value", aggfunc="last")
+        return frame.join(wide)
+
+    def _dictionary_of(self, table, column):
+        for spec in self.schema["tables"][table]["columns"]:
+            if spec["name"] == column:
+                return spec.get("dictionary")
+        raise KeyError(f"No column {column} in table {table}")
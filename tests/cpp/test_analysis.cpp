@@ -0,0 +1,155 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/bit_mask.hpp"
+#include "../../src/cpp/core/layer_connectivity.hpp"
+#include "../../src/cpp/core/phase_correlation.hpp"
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("Layer connectivity labels nets across bands and connected layers", "[Analysis]") {
+  // Two metal1 bars, one joined through a via to a metal2 strap, and an L
+  // of metal1 running down through every band
+  BitMask metal1(12, 16), metal2(12, 16), via(12, 16);
+  for (int i = 1; i <= 2; ++i) metal1.setSpan(i, 0, 11);
+  for (int i = 6; i <= 7; ++i) metal1.setSpan(i, 0, 6);
+  for (int i = 3; i <= 10; ++i) metal1.set(i, 12);
+  metal1.setSpan(10, 12, 16);
+  for (int i = 1; i <= 7; ++i) metal2.setSpan(i, 8, 10);
+  via.set(1, 8);
+
+  LayerConnectivity stack(12, 16);
+  REQUIRE(stack.addLayer("metal1", metal1) == 0);
+  stack.addLayer("metal2", metal2);
+  stack.addLayer("via1", via);
+  REQUIRE_THROWS_AS(stack.addLayer("metal2", metal2), std::invalid_argument);
+  REQUIRE_THROWS_AS(stack.addLayer("poly", BitMask(12, 15)), std::invalid_argument);
+  REQUIRE_THROWS_AS(stack.connect("via1", "metal3"), std::invalid_argument);
+  stack.connect("via1", "metal1");
+  stack.connect("via1", "metal2");
+
+  const NetDatabase nets = stack.extract();
+  REQUIRE(nets.netCount() == 3);
+  const int m1 = nets.layerIndex("metal1"), m2 = nets.layerIndex("metal2");
+  REQUIRE(nets.layerIndex("poly") == -1);
+  REQUIRE(nets.netAt(m1, 1, 0) == 0);
+  REQUIRE(nets.netAt(m1, 3, 12) == 1);
+  REQUIRE(nets.netAt(m1, 10, 15) == 1);
+  REQUIRE(nets.netAt(m1, 6, 0) == 2);
+  REQUIRE(nets.netAt(m2, 7, 9) == 0);
+  REQUIRE(nets.netAt(m1, 4, 0) == -1);
+  REQUIRE(nets.netAt(m1, -1, 0) == -1);
+  REQUIRE(nets.area(0, m1) == 22);
+  REQUIRE(nets.perimeter(0, m1) == 26);
+  REQUIRE(nets.area(0, m2) == 14);
+  REQUIRE(nets.perimeter(0, m2) == 18);
+  REQUIRE(nets.area(2, m2) == 0);
+  REQUIRE(nets.perimeter(1, m1) == 2 * (8 + 1) + 2 * 3);
+  REQUIRE(nets.bounds(0).row_begin == 1);
+  REQUIRE(nets.bounds(0).row_end == 8);
+  REQUIRE(nets.bounds(0).col_end == 11);
+
+  // Random layers against a flood fill, whatever the banding
+  const BitMask lower = BitMask::fromField(Eigen::ArrayXXd::Random(60, 50), 0.1);
+  const BitMask upper = BitMask::fromField(Eigen::ArrayXXd::Random(60, 50), 0.3);
+  LayerConnectivity random(60, 50);
+  random.addLayer("lower", lower);
+  random.addLayer("upper", upper);
+  random.connect("lower", "upper");
+  std::vector<int> label(2 * 60 * 50, -1);
+  int components = 0;
+  const auto isSet = [&](int l, int i, int j) { return (l == 0 ? lower : upper).test(i, j); };
+  for (int l = 0; l < 2; ++l) {
+    for (int i = 0; i < 60; ++i) {
+      for (int j = 0; j < 50; ++j) {
+        if (!isSet(l, i, j) || label[(l * 60 + i) * 50 + j] >= 0) continue;
+        std::vector<std::array<int, 3>> stack_cells{{l, i, j}};
+        label[(l * 60 + i) * 50 + j] = components;
+        while (!stack_cells.empty()) {
+          const auto c = stack_cells.back();
+          stack_cells.pop_back();
+          const std::array<int, 3> next[] = {{c[0], c[1] - 1, c[2]}, {c[0], c[1] + 1, c[2]}, {c[0], c[1], c[2] - 1},
+                                             {c[0], c[1], c[2] + 1}, {1 - c[0], c[1], c[2]}};
+          for (const auto& n : next) {
+            if (n[1] < 0 || n[1] >= 60 || n[2] < 0 || n[2] >= 50 || !isSet(n[0], n[1], n[2])) continue;
+            if (n[0] != c[0] && !isSet(c[0], n[1], n[2])) continue;
+            int& seen = label[(n[0] * 60 + n[1]) * 50 + n[2]];
+            if (seen < 0) {
+              seen = components;
+              stack_cells.push_back(n);
+            }
+          }
+        }
+        ++components;
+      }
+    }
+  }
+  for (int band_rows : {0, 1, 7, 60}) {
+    const NetDatabase found = random.extract(band_rows);
+    REQUIRE(found.netCount() == components);
+    std::vector<int> net_of(components, -1);
+    bool consistent = true;
+    for (int l = 0; l < 2; ++l) {
+      for (int i = 0; i < 60; ++i) {
+        for (int j = 0; j < 50; ++j) {
+          const int expected = label[(l * 60 + i) * 50 + j];
+          const int net = found.netAt(l, i, j);
+          if (expected < 0) {
+            consistent = consistent && net < 0;
+          } else {
+            if (net_of[expected] < 0) net_of[expected] = net;
+            consistent = consistent && net >= 0 && net_of[expected] == net;
+          }
+        }
+      }
+    }
+    REQUIRE(consistent);
+    REQUIRE(found.runNets(0) == random.extract().runNets(0));
+  }
+}
+
+TEST_CASE("Phase correlation registers targets to a fraction of a pixel", "[Analysis]") {
+  // Gaussian blobs away from the window edges, smooth enough to shift by
+  // any fraction of a pixel
+  auto pattern = [](double r, double c) {
+    double value = 0.0;
+    for (int b = 0; b < 24; ++b) {
+      const double br = 12.0 + std::fmod(b * 37.3, 40.0), bc = 12.0 + std::fmod(b * 59.1, 40.0);
+      const double width = 1.5 + (b % 5) * 0.5;
+      value += (1.0 + b % 3) * std::exp(-((r - br) * (r - br) + (c - bc) * (c - bc)) / (2.0 * width * width));
+    }
+    return value;
+  };
+  const std::vector<std::array<double, 2>> shifts = {{0.0, 0.0}, {0.3, -1.7}, {-4.2, 2.6}, {0.5, 0.5}};
+  PhaseCorrelator correlator(64);
+  const auto found = correlator.registerBatch(shifts.size(), [&](std::size_t k, int dr, int dc, double* a, double* b) {
+    for (int r = 0; r < 64; ++r) {
+      for (int c = 0; c < 64; ++c) {
+        a[r * 64 + c] = pattern(r, c);
+        b[r * 64 + c] = pattern(r + dr - shifts[k][0], c + dc - shifts[k][1]);
+      }
+    }
+  });
+  REQUIRE(found.size() == shifts.size());
+  REQUIRE(std::abs(found[0].peak - 1.0) < 0.01);
+  for (std::size_t k = 0; k < shifts.size(); ++k) {
+    REQUIRE(std::abs(found[k].rows - shifts[k][0]) < 0.05);
+    REQUIRE(std::abs(found[k].cols - shifts[k][1]) < 0.05);
+    REQUIRE(found[k].peak > 0.5);
+  }
+
+  // One pair on its own matches the batch's first pass
+  std::vector<double> a(64 * 64), b(64 * 64);
+  for (int r = 0; r < 64; ++r) {
+    for (int c = 0; c < 64; ++c) {
+      a[r * 64 + c] = pattern(r, c);
+      b[r * 64 + c] = pattern(r - 0.3, c + 1.7);
+    }
+  }
+  const PhaseCorrelator::Shift single = correlator.registerImages(a.data(), b.data());
+  REQUIRE(std::abs(single.rows - 0.3) < 0.1);
+  REQUIRE(std::abs(single.cols + 1.7) < 0.1);
+
+  REQUIRE_THROWS_AS(PhaseCorrelator(48), std::invalid_argument);
+  REQUIRE_THROWS_AS(PhaseCorrelator(64, nullptr, 0.0), std::invalid_argument);
+}
@@ -0,0 +1,357 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/api/rest_server.hpp"
+#include "../../src/cpp/api/simulation_jobs.hpp"
+#include "../../src/cpp/core/json_value.hpp"
+#include "../../src/cpp/core/simulation_engine.hpp"
+#include "../../src/cpp/core/task_scheduler.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+
+SemiPRO::SimulationJobs::State jobState(const std::string& id) {
+  SemiPRO::SimulationJobs::Status status;
+  REQUIRE(SemiPRO::SimulationJobs::getInstance().status(id, status));
+  return status.state;
+}
+
+// Polls until the job has finished, for at most a minute
+SemiPRO::SimulationJobs::State awaitJob(const std::string& id) {
+  using State = SemiPRO::SimulationJobs::State;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+  State state = jobState(id);
+  while ((state == State::QUEUED || state == State::RUNNING) && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    state = jobState(id);
+  }
+  return state;
+}
+
+SemiPRO::HttpRequest resultsRequest(const std::string& id, const std::string& field, const std::string& range = "") {
+  SemiPRO::HttpRequest request;
+  request.method = "GET";
+  request.query_params["id"] = id;
+  if (!field.empty()) {
+    request.query_params["field"] = field;
+  }
+  if (!range.empty()) {
+    request.headers["range"] = range;
+  }
+  return request;
+}
+
+} // namespace
+
+TEST_CASE("REST server answers pipelined keep-alive requests in order", "[API]") {
+  SemiPRO::RestServer server("127.0.0.1", 0);
+  server.setEventLoops(2);
+  server.get("/sims/:id", [](const SemiPRO::HttpRequest& request) {
+    SemiPRO::HttpResponse response;
+    response.body = request.query_params.at("id") + "|" + request.query_params.at("note");
+    return response;
+  });
+  server.offload("POST", "/run", [](const SemiPRO::HttpRequest& request) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    SemiPRO::HttpResponse response;
+    response.body = "ran " + request.body;
+    return response;
+  });
+  REQUIRE(server.start());
+  REQUIRE(server.getPort() > 0);
+
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(static_cast<uint16_t>(server.getPort()));
+  ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+  REQUIRE(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+  // Split mid-request, so the parser has to resume
+  const std::string requests = "GET /sims/7?note=a%20b HTTP/1.1\r\nHost: x\r\n\r\n"
+                               "POST /run HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+                               "DELETE /sims/7 HTTP/1.1\r\n\r\n"
+                               "GET /none HTTP/1.1\r\nConnection: close\r\n\r\n";
+  const std::size_t half = requests.size() / 2;
+  REQUIRE(::send(fd, requests.data(), half, 0) == static_cast<ssize_t>(half));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  REQUIRE(::send(fd, requests.data() + half, requests.size() - half, 0) ==
+          static_cast<ssize_t>(requests.size() - half));
+  std::string replies;
+  char buffer[4096];
+  for (ssize_t n; (n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0;) {
+    replies.append(buffer, static_cast<size_t>(n));
+  }
+  ::close(fd);
+  server.stop();
+
+  const size_t first = replies.find("7|a b");
+  const size_t second = replies.find("ran abc");
+  const size_t third = replies.find("HTTP/1.1 405");
+  const size_t fourth = replies.find("HTTP/1.1 404");
+  REQUIRE(first != std::string::npos);
+  REQUIRE(second != std::string::npos);
+  REQUIRE(third != std::string::npos);
+  REQUIRE(fourth != std::string::npos);
+  REQUIRE((first < second && second < third && third < fourth));
+  REQUIRE(replies.find("Connection: close") > third);
+}
+
+TEST_CASE("REST rate limits refill a bucket per client", "[API]") {
+  SemiPRO::RestServer server("127.0.0.1", 0);
+  REQUIRE(server.checkRateLimit("10.0.0.1"));
+  SemiPRO::RateLimitConfig limit;
+  limit.requests_per_minute = 6000;
+  limit.burst_size = 3;
+  server.setRateLimit(limit);
+  for (int i = 0; i < 3; ++i) {
+    REQUIRE(server.checkRateLimit("10.0.0.1"));
+  }
+  REQUIRE_FALSE(server.checkRateLimit("10.0.0.1"));
+  REQUIRE(server.checkRateLimit("10.0.0.2"));
+  // 100 requests a second: one token back after 10 ms
+  std::this_thread::sleep_for(std::chrono::milliseconds(15));
+  REQUIRE(server.checkRateLimit("10.0.0.1"));
+  REQUIRE_FALSE(server.checkRateLimit("10.0.0.1"));
+}
+
+TEST_CASE("JSON writer streams text that parses back", "[API]") {
+  std::ostringstream stream;
+  const std::vector<double> values = {0.1, 1e-300, -2.5e15, std::nan("")};
+  {
+    SemiPRO::JsonWriter json(stream, 16);
+    json.beginObject();
+    json.key("name\t\"q\"").string("a\\b\x01");
+    json.key("count").integer(-9007199254740993LL);
+    json.key("values").numbers(values.data(), values.size());
+    json.key("empty").beginArray().endArray();
+    json.key("nested").beginObject().key("ok").boolean(true).key("none").null().endObject();
+    json.endObject();
+  }
+  const std::string text = stream.str();
+  REQUIRE(text.find("-9007199254740993") != std::string::npos);
+
+  const SemiPRO::JsonValue parsed = SemiPRO::JsonValue::parse(text);
+  REQUIRE(parsed["name\t\"q\""].asString() == "a\\b\x01");
+  const auto& items = parsed["values"].items();
+  REQUIRE(items.size() == 4);
+  REQUIRE(items[0].asNumber() == 0.1);
+  REQUIRE(items[1].asNumber() == 1e-300);
+  REQUIRE(items[2].asNumber() == -2.5e15);
+  REQUIRE(items[3].isNull());
+  REQUIRE(parsed["empty"].size() == 0);
+  REQUIRE(parsed["nested"]["ok"].asBool());
+
+  // Pretty printing changes only the layout
+  REQUIRE(SemiPRO::JsonValue::parse(parsed.dump(2)).dump() == parsed.dump());
+  REQUIRE(parsed.dump(2).find("\n    \"ok\": true") != std::string::npos);
+}
+
+TEST_CASE("REST WebSocket clients get replies, broadcasts and pongs", "[API]") {
+  SemiPRO::RestServer server("127.0.0.1", 0);
+  server.setEventLoops(1);
+  server.addWebSocketHandler("/ws", [&server](const SemiPRO::WebSocketMessage& message) {
+    server.sendWebSocketMessage(message.client_id, "echo " + message.data);
+  });
+  REQUIRE(server.start());
+
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(static_cast<uint16_t>(server.getPort()));
+  ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+  REQUIRE(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+  const timeval timeout{5, 0};
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  std::string received;
+  auto receive = [&](size_t bytes) {
+    char buffer[4096];
+    while (received.size() < bytes) {
+      const ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+      if (n <= 0) {
+        return false;
+      }
+      received.append(buffer, static_cast<size_t>(n));
+    }
+    return true;
+  };
+  // Client frames are masked
+  auto frame = [](unsigned opcode, const std::string& payload) {
+    const char mask[4] = {0x11, 0x22, 0x33, 0x44};
+    std::string bytes = {static_cast<char>(0x80 | opcode), static_cast<char>(0x80 | payload.size())};
+    bytes.append(mask, 4);
+    for (size_t i = 0; i < payload.size(); ++i) {
+      bytes += static_cast<char>(payload[i] ^ mask[i & 3]);
+    }
+    return bytes;
+  };
+
+  // The handshake example of RFC 6455
+  const std::string upgrade = "GET /ws HTTP/1.1\r\nHost: x\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                              "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+  REQUIRE(::send(fd, upgrade.data(), upgrade.size(), 0) == static_cast<ssize_t>(upgrade.size()));
+  REQUIRE(receive(4));
+  while (received.find("\r\n\r\n") == std::string::npos && receive(received.size() + 1)) {
+  }
+  const size_t head = received.find("\r\n\r\n") + 4;
+  REQUIRE(received.compare(0, 12, "HTTP/1.1 101") == 0);
+  REQUIRE(received.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") < head);
+  received.erase(0, head);
+
+  const std::string messages = frame(0x1, "hello") + frame(0x9, "p");
+  REQUIRE(::send(fd, messages.data(), messages.size(), 0) == static_cast<ssize_t>(messages.size()));
+  // Unmasked text "echo hello", then the pong, in either order
+  REQUIRE(receive(12 + 3));
+  const std::string echo = std::string("\x81\x0a", 2) + "echo hello";
+  const std::string pong = std::string("\x8a\x01", 2) + "p";
+  REQUIRE((received == echo + pong || received == pong + echo));
+  received.clear();
+
+  server.broadcastWebSocket("/ws", std::string("\x00\x01", 2), true, "job");
+  REQUIRE(receive(4));
+  REQUIRE(received == std::string("\x82\x02\x00\x01", 4));
+  received.clear();
+
+  const std::string close = frame(0x8, std::string("\x03\xe8", 2));
+  REQUIRE(::send(fd, close.data(), close.size(), 0) == static_cast<ssize_t>(close.size()));
+  REQUIRE(receive(4));
+  REQUIRE(received == std::string("\x88\x02\x03\xe8", 4));
+  ::close(fd);
+  server.stop();
+}
+
+TEST_CASE("Simulation jobs move from queued to their final state", "[API]") {
+  using State = SemiPRO::SimulationJobs::State;
+  SimulationEngine::getInstance().initialize("");
+  auto& jobs = SemiPRO::SimulationJobs::getInstance();
+  auto& pool = TaskScheduler::getInstance();
+
+  // Every worker busy, so submitted jobs wait their turn in the queue
+  std::atomic<int> started{0};
+  std::atomic<bool> release{false};
+  std::vector<std::future<void>> blockers;
+  for (int i = 0; i < pool.threadCount(); ++i) {
+    blockers.push_back(pool.submit([&] {
+      ++started;
+      while (!release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }));
+  }
+  while (started < pool.threadCount()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  const std::string first = jobs.submit("api_jobs_wafer", "oxidation", SemiPRO::JsonValue());
+  const std::string second = jobs.submit("api_jobs_wafer", "oxidation", SemiPRO::JsonValue());
+  const std::string failing = jobs.submit("api_jobs_other", "no_such_process", SemiPRO::JsonValue());
+  REQUIRE(first != second);
+  REQUIRE(jobState(first) == State::QUEUED);
+  REQUIRE(jobState(second) == State::QUEUED);
+  REQUIRE(jobs.results(first) == nullptr);
+
+  // A queued job is skipped when its turn comes
+  REQUIRE(jobs.cancel(second));
+  REQUIRE(jobState(second) == State::CANCELLED);
+  release = true;
+  for (auto& blocker : blockers) {
+    pool.wait(blocker);
+  }
+
+  REQUIRE(awaitJob(first) == State::COMPLETED);
+  REQUIRE(jobs.results(first) != nullptr);
+  REQUIRE(!jobs.cancel(first));
+  REQUIRE(awaitJob(failing) == State::FAILED);
+  SemiPRO::SimulationJobs::Status status;
+  REQUIRE(jobs.status(failing, status));
+  REQUIRE(status.error == "process failed");
+  REQUIRE(jobs.results(failing) == nullptr);
+  REQUIRE(jobState(second) == State::CANCELLED);
+  REQUIRE(jobs.results(second) == nullptr);
+
+  // Results are not there until a job completes, and never for unknown ids
+  REQUIRE(SemiPRO::ApiHandlers::getSimulationResults(resultsRequest(second, "")).status_code == 409);
+  REQUIRE(SemiPRO::ApiHandlers::getSimulationResults(resultsRequest("sim-none", "")).status_code == 404);
+  REQUIRE(SemiPRO::ApiHandlers::getSimulation(resultsRequest(first, "")).body.find("\"completed\"") !=
+          std::string::npos);
+
+  REQUIRE(jobs.remove(first));
+  REQUIRE(!jobs.status(first, status));
+  REQUIRE(jobs.remove(second));
+  REQUIRE(jobs.remove(failing));
+  REQUIRE(!jobs.remove(first));
+}
+
+TEST_CASE("Simulation result fields are served whole or by byte range", "[API]") {
+  SimulationEngine::getInstance().initialize("");
+  auto& jobs = SemiPRO::SimulationJobs::getInstance();
+  const std::string id = jobs.submit("api_results_wafer", "oxidation", SemiPRO::JsonValue());
+  REQUIRE(awaitJob(id) == SemiPRO::SimulationJobs::State::COMPLETED);
+
+  const auto listing = SemiPRO::ApiHandlers::getSimulationResults(resultsRequest(id, ""));
+  REQUIRE(listing.status_code == 200);
+  const auto fields = SemiPRO::JsonValue::parse(listing.body)["fields"].items();
+  REQUIRE(!fields.empty());
+  const std::string name = fields.front()["name"].asString();
+  const size_t rows = static_cast<size_t>(fields.front()["rows"].asNumber());
+  const size_t cols = static_cast<size_t>(fields.front()["cols"].asNumber());
+  const size_t row_bytes = cols * sizeof(double);
+  const size_t total = rows * row_bytes;
+  REQUIRE(rows > 1);
+
+  const auto whole = SemiPRO::ApiHandlers::getSimulationResults(resultsRequest(id, name));
+  REQUIRE(whole.status_code == 200);
+  REQUIRE(whole.body.size() == total);
+  REQUIRE(whole.headers.at("X-Shape") == std::to_string(rows) + "," + std::to_string(cols));
+  const auto* snapshot = jobs.results(id)->find(name);
+  REQUIRE(snapshot != nullptr);
+  std::vector<double> values(rows * cols);
+  snapshot->snapshot.copyBlock(0, 0, static_cast<int>(rows), static_cast<int>(cols), values.data(),
+                               static_cast<int>(cols), true);
+  REQUIRE(whole.body == std::string(reinterpret_cast<const char*>(values.data()), total));
+
+  // A range across a row boundary, starting and ending mid-value
+  const size_t first = row_bytes - 5;
+  const size_t last = row_bytes + 10;
+  auto part = SemiPRO::ApiHandlers::getSimulationResults(
+      resultsRequest(id, name, "bytes=" + std::to_string(first) + "-" + std::to_string(last)));
+  REQUIRE(part.status_code == 206);
+  REQUIRE(part.body == whole.body.substr(first, last - first + 1));
+  REQUIRE(part.headers.at("Content-Range") ==
+          "bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(total));
+
+  // Open-ended and suffix ranges, the last clipped to the field
+  part = SemiPRO::ApiHandlers::getSimulationResults(resultsRequest(id, name, "bytes=" + std::to_string(total - 3) + "-"));
+  REQUIRE(part.status_code == 206);
+  REQUIRE(part.body == whole.body.substr(total - 3));
+  part = SemiPRO::ApiHandlers::getSimulationResults(resultsRequest(id, name, "bytes=-12"));
+  REQUIRE(part.body == whole.body.substr(total - 12));
+  part = SemiPRO::ApiHandlers::getSimulationResults(
+      resultsRequest(id, name, "bytes=0-" + std::to_string(2 * total)));
+  REQUIRE(part.status_code == 200);
+  REQUIRE(part.body == whole.body);
+
+  // Ranges past the end, or backwards, cannot be served
+  for (const std::string range : {"bytes=" + std::to_string(total) + "-", std::string("bytes=20-10"),
+                                  std::string("bytes=-0")}) {
+    const auto refused = SemiPRO::ApiHandlers::getSimulationResults(resultsRequest(id, name, range));
+    REQUIRE(refused.status_code == 416);
+    REQUIRE(refused.headers.at("Content-Range") == "bytes */" + std::to_string(total));
+    REQUIRE(refused.body.empty());
+  }
+
+  REQUIRE(SemiPRO::ApiHandlers::getSimulationResults(resultsRequest(id, "no_such_field")).status_code == 404);
+  const auto dopant = SemiPRO::ApiHandlers::getSimulationResults(resultsRequest(id, "dopant"));
+  REQUIRE(dopant.status_code == 200);
+  REQUIRE(dopant.body.size() == jobs.results(id)->dopant_profile.size() * sizeof(double));
+  REQUIRE(jobs.remove(id));
+}
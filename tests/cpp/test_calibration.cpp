@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/advanced/model_calibration.hpp"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+bool closeTo(double value, double expected, double relative) {
+  return std::abs(value - expected) <= relative * std::abs(expected);
+}
+
+// Thicknesses the physics predicts with the given constants, measured
+// without noise at every temperature and time
+std::vector<SemiPRO::OxideThicknessMeasurement> generateThicknesses(SemiPRO::EnhancedOxidationPhysics& physics,
+                                                                    const SemiPRO::DealGroveParameters& truth,
+                                                                    const std::vector<double>& temperatures) {
+  const auto base = physics.getAtmosphereParameters(SemiPRO::OxidationAtmosphere::DRY_O2);
+  physics.setAtmosphereParameters(SemiPRO::OxidationAtmosphere::DRY_O2, truth);
+  std::vector<SemiPRO::OxideThicknessMeasurement> measurements;
+  for (double temperature : temperatures) {
+    for (double time : {0.1, 0.5, 2.0, 8.0, 24.0}) {
+      SemiPRO::OxideThicknessMeasurement measurement;
+      measurement.conditions.atmosphere = SemiPRO::OxidationAtmosphere::DRY_O2;
+      measurement.conditions.temperature = temperature;
+      measurement.conditions.time = time;
+      measurement.thickness =
+          physics.calculateThickness(physics.calculateEnhancedParameters(measurement.conditions), measurement.conditions);
+      measurements.push_back(measurement);
+    }
+  }
+  physics.setAtmosphereParameters(SemiPRO::OxidationAtmosphere::DRY_O2, base);
+  return measurements;
+}
+
+} // namespace
+
+TEST_CASE("Deal-Grove calibration recovers the constants that generated the thicknesses", "[Calibration]") {
+  SemiPRO::EnhancedOxidationPhysics physics;
+  const auto base = physics.getAtmosphereParameters(SemiPRO::OxidationAtmosphere::DRY_O2);
+  auto truth = base;
+  truth.A = base.A * 1.6;
+  truth.B = base.B * 0.7;
+  const auto measurements = generateThicknesses(physics, truth, {1000.0});
+
+  const auto result = SemiPRO::calibrateDealGrove(physics, SemiPRO::OxidationAtmosphere::DRY_O2, measurements);
+  REQUIRE(result.converged);
+  REQUIRE(result.values.size() == 2);
+  REQUIRE(closeTo(result.parameters.at("A"), truth.A, 1e-4));
+  REQUIRE(closeTo(result.parameters.at("B"), truth.B, 1e-4));
+  REQUIRE(result.final_cost < 1e-8);
+  REQUIRE(result.final_cost < result.initial_cost);
+  for (double residual : result.residuals) {
+    REQUIRE(std::abs(residual) < 1e-4);
+  }
+
+  // The fit is written back, and the activation energies are left alone
+  const auto fitted = physics.getAtmosphereParameters(SemiPRO::OxidationAtmosphere::DRY_O2);
+  REQUIRE(fitted.A == result.values[0]);
+  REQUIRE(fitted.B == result.values[1]);
+  REQUIRE(fitted.activation_energy_A == base.activation_energy_A);
+  REQUIRE(fitted.activation_energy_B == base.activation_energy_B);
+}
+
+TEST_CASE("Deal-Grove calibration over several temperatures fits the activation energies", "[Calibration]") {
+  SemiPRO::EnhancedOxidationPhysics physics;
+  const auto base = physics.getAtmosphereParameters(SemiPRO::OxidationAtmosphere::DRY_O2);
+  auto truth = base;
+  truth.A = base.A * 1.3;
+  truth.B = base.B * 0.8;
+  truth.activation_energy_A = base.activation_energy_A + 0.15;
+  truth.activation_energy_B = base.activation_energy_B - 0.1;
+  const auto measurements = generateThicknesses(physics, truth, {900.0, 1000.0, 1100.0});
+
+  const auto result = SemiPRO::calibrateDealGrove(physics, SemiPRO::OxidationAtmosphere::DRY_O2, measurements);
+  REQUIRE(result.converged);
+  REQUIRE(result.values.size() == 4);
+  REQUIRE(closeTo(result.parameters.at("A"), truth.A, 1e-3));
+  REQUIRE(closeTo(result.parameters.at("B"), truth.B, 1e-3));
+  REQUIRE(closeTo(result.parameters.at("activation_energy_A"), truth.activation_energy_A, 1e-3));
+  REQUIRE(closeTo(result.parameters.at("activation_energy_B"), truth.activation_energy_B, 1e-3));
+
+  const auto fitted = physics.getAtmosphereParameters(SemiPRO::OxidationAtmosphere::DRY_O2);
+  REQUIRE(fitted.activation_energy_A == result.values[2]);
+  REQUIRE(fitted.activation_energy_B == result.values[3]);
+}
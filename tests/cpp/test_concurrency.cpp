@@ -0,0 +1,93 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/sample_ring.hpp"
+#include "../../src/cpp/core/sharded_registry.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Sample rings keep a fixed history readable while written", "[Concurrency]") {
+  SemiPRO::SampleRing ring(16);
+  std::vector<double> out;
+  REQUIRE(ring.read(0, out) == 0);
+  REQUIRE(out.empty());
+  for (int i = 0; i < 40; ++i) {
+    ring.push(i);
+  }
+  REQUIRE(ring.written() == 40);
+  REQUIRE(ring.read(0, out) == 24);
+  REQUIRE(out.size() == 16);
+  REQUIRE(out.front() == 24.0);
+  REQUIRE(out.back() == 39.0);
+  REQUIRE(ring.read(35, out) == 35);
+  REQUIRE(out.size() == 5);
+
+  // Whatever a reader copies under a running writer is what was pushed
+  SemiPRO::SampleRing live(64);
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int i = 0; i < 2000000; ++i) {
+      live.push(i);
+    }
+    done = true;
+  });
+  bool consistent = true;
+  while (!done) {
+    const uint64_t first = live.read(0, out);
+    for (size_t i = 0; i < out.size(); ++i) {
+      consistent = consistent && out[i] == static_cast<double>(first + i);
+    }
+  }
+  writer.join();
+  REQUIRE(consistent);
+  REQUIRE_THROWS_AS(SemiPRO::SampleRing(0), std::invalid_argument);
+}
+
+TEST_CASE("Sharded registry handles outlive their entries", "[Concurrency]") {
+  ShardedRegistry<std::atomic<int>> registry;
+  for (int i = 0; i < 64; ++i) {
+    REQUIRE_FALSE(registry.insert("w" + std::to_string(i), std::make_shared<std::atomic<int>>(i)));
+  }
+  REQUIRE(registry.size() == 64);
+  REQUIRE(registry.find("missing") == nullptr);
+
+  auto handle = registry.find("w7");
+  REQUIRE(handle);
+  REQUIRE(registry.insert("w7", std::make_shared<std::atomic<int>>(-1)));
+  REQUIRE(registry.erase("w8"));
+  REQUIRE_FALSE(registry.erase("w8"));
+  REQUIRE(*handle == 7);
+  REQUIRE(*registry.find("w7") == -1);
+  REQUIRE(registry.size() == 63);
+
+  // Readers of every shard run beside writers of their own names
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&registry, t] {
+      for (int round = 0; round < 200; ++round) {
+        const std::string own = "t" + std::to_string(t);
+        registry.insert(own, std::make_shared<std::atomic<int>>(round));
+        for (int i = 0; i < 64; ++i) {
+          if (auto entry = registry.find("w" + std::to_string(i))) {
+            entry->fetch_add(1);
+          }
+        }
+        registry.erase(own);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  REQUIRE(registry.size() == 63);
+  REQUIRE(*registry.find("w0") == 800);
+  REQUIRE(registry.snapshot().size() == 63);
+
+  registry.assign({{"a", std::make_shared<std::atomic<int>>(1)}, {"a", std::make_shared<std::atomic<int>>(2)}});
+  REQUIRE(registry.size() == 1);
+  REQUIRE(*registry.find("a") == 2);
+  REQUIRE(*handle == 7);
+}
@@ -0,0 +1,117 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/config_manager.hpp"
+#include "../../src/cpp/core/job_manifest.hpp"
+#include "../../src/cpp/core/json_value.hpp"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool contains(const std::string& text, const std::string& part) {
+  return text.find(part) != std::string::npos;
+}
+
+// The message readConfigJobs rejects a document with, or "" if it passes
+std::string manifestError(const std::string& json) {
+  try {
+    SemiPRO::readConfigJobs(SemiPRO::JsonValue::parse(json));
+  } catch (const std::invalid_argument& e) {
+    return e.what();
+  }
+  return "";
+}
+
+} // namespace
+
+TEST_CASE("JSON configuration loads typed values into sections", "[Config]") {
+  auto& config = SemiPRO::ConfigManager::getInstance();
+  config.setValue("tests.json.steps", 2);
+  REQUIRE(config.loadFromJSON(R"({"tests": {"json": {"steps": 3, "rate": 1.5, "gas": "O2", "dry": true,
+                                   "levels": [1, 2.5], "names": ["a", "b"], "unset": null}}})"));
+  REQUIRE(config.getValue<int>("tests.json.steps") == 3);
+  REQUIRE(config.getValue<double>("tests.json.rate") == 1.5);
+  REQUIRE(config.getValue<std::string>("tests.json.gas") == std::string("O2"));
+  REQUIRE(config.getValue<bool>("tests.json.dry") == true);
+  REQUIRE(config.getValue<std::vector<double>>("tests.json.levels") == std::vector<double>{1.0, 2.5});
+  REQUIRE(config.getValue<std::vector<std::string>>("tests.json.names") == std::vector<std::string>{"a", "b"});
+  REQUIRE_FALSE(config.hasValue("tests.json.unset"));
+
+  // An int parameter stays an int, and rejects a fraction
+  REQUIRE_FALSE(config.loadFromJSON(R"({"tests": {"json": {"steps": 3.5}}})"));
+  REQUIRE(config.getValue<int>("tests.json.steps") == 3);
+  REQUIRE_FALSE(config.loadFromJSON(R"({"tests": {"json": {"levels": [1, "a"]}}})"));
+  REQUIRE_FALSE(config.loadFromJSON(R"({"tests": )"));
+}
+
+TEST_CASE("JSON syntax errors name the line and column", "[Config]") {
+  std::string error;
+  try {
+    SemiPRO::JsonValue::parse("{\n  \"a\": 1,\n  \"b\": tru\n}");
+  } catch (const std::runtime_error& e) {
+    error = e.what();
+  }
+  REQUIRE(contains(error, "line 3, column 8"));
+  const auto number = SemiPRO::JsonValue::parse(R"({"dose": 1e15})")["dose"];
+  REQUIRE(number.asNumber() == 1e15);
+  REQUIRE(number.scalarText() == "1e15");
+  REQUIRE_THROWS_AS(number.asString(), std::invalid_argument);
+}
+
+TEST_CASE("Job manifests read every layout and name the offending path", "[Config]") {
+  const auto jobs = SemiPRO::readConfigJobs(SemiPRO::JsonValue::parse(R"({"jobs": [
+      {"process": "oxidation", "parameters": {"temperature": 1000}, "grid": {"x_dimension": 20, "y_dimension": 10}},
+      {"name": "implant", "wafer": "w1",
+       "simulation": {"process": {"operation": "doping", "parameters": {"species": "boron"}}}},
+      {"temperature": 950, "time": 0.5}]})"));
+  REQUIRE(jobs.size() == 3);
+  REQUIRE(jobs[0].name == "job0");
+  REQUIRE(jobs[0].process == "oxidation");
+  REQUIRE(jobs[0].parameters["temperature"].asNumber() == 1000.0);
+  REQUIRE(jobs[0].grid["x_dimension"].asNumber() == 20.0);
+  REQUIRE(jobs[0].geometry.isNull());
+  REQUIRE(jobs[1].name == "implant");
+  REQUIRE(jobs[1].wafer == "w1");
+  REQUIRE(jobs[1].process == "doping");
+  REQUIRE(jobs[1].parameters["species"].asString() == "boron");
+  REQUIRE(jobs[2].process.empty());
+  REQUIRE(jobs[2].parameters["time"].asNumber() == 0.5);
+
+  // Nothing is returned from a document with one bad job
+  REQUIRE(manifestError(R"({"jobs": [{"process": "oxidation"}, {"process": "etching", "grid": {"x_dimension": 0}}]})") ==
+          "jobs[1].grid.x_dimension must be a positive integer");
+  REQUIRE(manifestError(R"([{"process": "oxidation", "parameters": {"temperature": [1, 2]}}])") ==
+          "[0].parameters.temperature must be a number, string or boolean");
+  REQUIRE(contains(manifestError("3"), "must be an object"));
+}
+
+TEST_CASE("Configuration keys follow every change through snapshots", "[Config]") {
+  auto& config = SemiPRO::ConfigManager::getInstance();
+  const SemiPRO::ConfigKey<double> rate("tests.keys.rate", 1.0);
+  const SemiPRO::ConfigKey<std::string> gas("tests.keys.gas", "N2");
+  REQUIRE(rate.get() == 1.0);
+  REQUIRE(gas.get() == "N2");
+
+  const auto before = config.version();
+  config.setValue("tests.keys.rate", 2.5);
+  REQUIRE(config.version() > before);
+  REQUIRE(rate.get() == 2.5);
+  const SemiPRO::ConfigSnapshot& old = config.snapshot();
+  const double& held = rate.get();
+
+  // A reload is seen at once; what was read before stays valid
+  REQUIRE(config.loadFromJSON(R"({"tests": {"keys": {"rate": 4.0, "gas": "O2"}}})"));
+  REQUIRE(rate.get() == 4.0);
+  REQUIRE(gas.get() == "O2");
+  REQUIRE(config.snapshot().version() > old.version());
+  REQUIRE(held == 2.5);
+
+  // A value of another type reads as the default
+  config.setValue("tests.keys.rate", std::string("fast"));
+  REQUIRE(rate.get() == 1.0);
+
+  // A key registered after the snapshot was taken finds its value too
+  config.setValue("tests.keys.late", 7);
+  const SemiPRO::ConfigKey<int> late("tests.keys.late", 0);
+  REQUIRE(late.get() == 7);
+}
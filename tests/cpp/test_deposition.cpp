@@ -1,7 +1,11 @@
 #include <catch2/catch_test_macros.hpp>
 #include "../../src/cpp/modules/deposition/deposition_model.hpp"
 #include "../../src/cpp/core/wafer.hpp"
+#include "../../src/cpp/core/distance_transform.hpp"
 #include "../../src/cpp/modules/photolithography/lithography_model.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 TEST_CASE("Uniform deposition simulation", "[Deposition]") {
   auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
@@ -28,4 +32,94 @@ TEST_CASE("Conformal deposition simulation", "[Deposition]") {
   double initial_sum = wafer->getGrid().sum();
   deposition.simulateDeposition(wafer, 0.1, "SiO2", "conformal");
   REQUIRE(wafer->getGrid().sum() > initial_sum);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Level-set deposition lines a trench", "[Deposition]") {
+  const int n = 40;
+  // A 100 nm deep, ten-cell wide trench
+  auto trench = [&] {
+    auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    wafer->initializeGrid(n, n);
+    wafer->getGrid().middleCols(15, 10) -= 0.1;
+    return wafer;
+  };
+  DepositionModel deposition;
+  deposition.setCellSize(0.01);
+
+  auto conformal = trench();
+  deposition.simulateDeposition(conformal, 0.03, "SiO2", "conformal");
+  auto uniform = trench();
+  deposition.simulateDeposition(uniform, 0.03, "SiO2", "uniform");
+  for (const auto& wafer : {conformal, uniform}) {
+    // Heights from the wafer's initial surface
+    const Eigen::ArrayXXd grid = wafer->getGrid() - 775.0;
+    // Flat tops and the trench floor both rise by the thickness
+    REQUIRE(std::abs(grid(20, 5) - 0.03) < 1e-6);
+    REQUIRE(std::abs(grid(20, 20) + 0.07) < 1e-3);
+  }
+  // Film on the walls closes in on the trench's mouth only when conformal
+  REQUIRE(conformal->getGrid()(20, 15) > uniform->getGrid()(20, 15));
+  REQUIRE(conformal->getFilmLayers().size() == 1);
+}
+
+TEST_CASE("Conformal deposition is the exact distance offset of the surface", "[Deposition]") {
+  // The transform against the minimum taken over every source
+  const double inf = std::numeric_limits<double>::infinity();
+  Eigen::ArrayXXd cost = Eigen::ArrayXXd::Constant(23, 31, inf);
+  cost(3, 4) = 0.0;
+  cost(17, 25) = 0.5;
+  cost(9, 30) = 2.0;
+  const Eigen::ArrayXXd squared = DistanceTransform::squared(cost, 0.5);
+  for (int i = 0; i < 23; ++i) {
+    for (int j = 0; j < 31; ++j) {
+      double expected = inf;
+      for (int p = 0; p < 23; ++p) {
+        for (int q = 0; q < 31; ++q) {
+          expected = std::min(expected, cost(p, q) + 0.25 * ((i - p) * (i - p) + (j - q) * (j - q)));
+        }
+      }
+      REQUIRE(std::abs(squared(i, j) - expected) < 1e-9);
+    }
+  }
+  REQUIRE((DistanceTransform::squared(Eigen::ArrayXXd::Constant(4, 5, inf)) == inf).all());
+  REQUIRE_THROWS_AS(DistanceTransform::squared(cost, 0.0), std::invalid_argument);
+
+  // A film on a pillar and a pit is the top of the balls about the solid,
+  // to within the layers' linear interpolation, however thick
+  const int n = 30;
+  const double cell = 0.01;
+  Eigen::ArrayXXd heights = Eigen::ArrayXXd::Zero(n, n);
+  heights.block(5, 5, 4, 3) = 0.08;
+  heights.block(18, 16, 6, 8) = -0.12;
+  for (double thickness : {0.02, 0.05, 0.2}) {
+    Eigen::ArrayXXd grown = heights;
+    DistanceTransform::offsetHeights(grown, cell, thickness);
+    double worst = 0.0;
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        double top = -inf;
+        for (int p = 0; p < n; ++p) {
+          for (int q = 0; q < n; ++q) {
+            const double d2 = cell * cell * ((i - p) * (i - p) + (j - q) * (j - q));
+            if (d2 <= thickness * thickness) {
+              top = std::max(top, heights(p, q) + std::sqrt(thickness * thickness - d2));
+            }
+          }
+        }
+        worst = std::max(worst, std::abs(grown(i, j) - top));
+      }
+    }
+    REQUIRE(worst < 0.5 * cell);
+  }
+
+  // Cells under resist keep their height and cast no film past its top
+  BitMask resist(n, n);
+  for (int j = 10; j < 20; ++j) {
+    resist.set(4, j);
+  }
+  Eigen::ArrayXXd masked = Eigen::ArrayXXd::Zero(n, n);
+  DistanceTransform::offsetHeights(masked, cell, 0.03, &resist);
+  REQUIRE(masked(4, 15) == 0.0);
+  REQUIRE(std::abs(masked(5, 15) - 0.03) < 1e-12);
+  REQUIRE_THROWS_AS(DistanceTransform::offsetHeights(masked, cell, -1.0), std::invalid_argument);
+}
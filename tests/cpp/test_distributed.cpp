@@ -0,0 +1,313 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/distributed_batch.hpp"
+#include "../../src/cpp/core/distributed_field.hpp"
+#include "../../src/cpp/core/distributed_fft.hpp"
+#include "../../src/cpp/core/distributed_multigrid.hpp"
+#include "../../src/cpp/core/fft.hpp"
+#include "../../src/cpp/core/grid_comm.hpp"
+#include "../../src/cpp/core/multigrid.hpp"
+#include "../../src/cpp/core/reproducibility.hpp"
+#include "../../src/cpp/core/tiled_grid.hpp"
+#include "../../src/cpp/integration/artifact_store.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Distributed batches keep wafers on their nodes and back up stragglers", "[Distributed]") {
+  using namespace SemiPRO;
+  const std::string root = (std::filesystem::temp_directory_path() / "semipro_distributed_test").string();
+  std::filesystem::remove_all(root);
+
+  // A flow appends its name to the state; node "slow" takes seconds per
+  // flow until stopped, node "flaky" fails its first shard
+  std::atomic<int> flaky_runs{0};
+  auto runner = [](int delay_ms) {
+    return [delay_ms](const std::string& flow, std::vector<unsigned char>& state, const CancellationToken& stop) {
+      for (int waited = 0; waited < delay_ms && !stop.stopRequested(); waited += 5) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      }
+      state.insert(state.end(), flow.begin(), flow.end());
+      return flow != "bad";
+    };
+  };
+  auto fast = std::make_shared<LocalExecutionNode>("fast", 2, runner(1));
+  auto slow = std::make_shared<LocalExecutionNode>("slow", 1, runner(5000));
+  auto flaky = std::make_shared<LocalExecutionNode>(
+      "flaky", 1, [&](const std::string& flow, std::vector<unsigned char>& state, const CancellationToken& stop) {
+        if (flaky_runs++ == 0) {
+          throw std::runtime_error("node lost");
+        }
+        return runner(1)(flow, state, stop);
+      });
+
+  DistributedBatchExecutor::Options options;
+  options.speculation_factor = 3.0;
+  options.locality_wait = 1000.0;
+  DistributedBatchExecutor executor(std::make_shared<DirectoryObjectStore>(root), options);
+  executor.addNode(fast);
+  executor.addNode(slow);
+  executor.addNode(flaky);
+
+  std::map<std::string, std::vector<unsigned char>> wafers;
+  DistributedBatchExecutor::WaferStates states;
+  states.capture = [&](const std::string& wafer) { return wafers[wafer]; };
+  states.restore = [&](const std::string& wafer, std::vector<unsigned char> state) { wafers[wafer] = std::move(state); };
+
+  std::vector<DistributedBatchExecutor::Item> batch;
+  for (int w = 0; w < 12; ++w) {
+    batch.push_back({"w" + std::to_string(w), "a", 1.0 + w % 3});
+  }
+  for (int w = 0; w < 12; w += 2) {
+    batch.push_back({"w" + std::to_string(w), w == 4 ? "bad" : "b", 1.0});
+  }
+  std::vector<int> delivered(batch.size(), 0);
+  const auto results = executor.run(batch, states, [&](const DistributedBatchExecutor::ItemResult& result) {
+    ++delivered[result.index];
+  });
+
+  REQUIRE(results.size() == batch.size());
+  REQUIRE(std::all_of(delivered.begin(), delivered.end(), [](int count) { return count == 1; }));
+  // The slow node took a shard, which a backup finished long before it
+  for (const auto& result : results) {
+    REQUIRE(result.success == (batch[result.index].flow != "bad"));
+    REQUIRE(result.node != "slow");
+    REQUIRE(result.seconds < 5.0);
+  }
+  for (int w = 0; w < 12; ++w) {
+    const std::string expected = w == 4 ? "abad" : w % 2 == 0 ? "ab" : "a";
+    REQUIRE(std::string(wafers["w" + std::to_string(w)].begin(), wafers["w" + std::to_string(w)].end()) == expected);
+  }
+
+  // Unchanged wafers go back to the nodes holding them; a changed one is
+  // uploaded again and may run anywhere
+  wafers["w1"].push_back('x');
+  std::vector<DistributedBatchExecutor::Item> again;
+  for (int w = 0; w < 12; ++w) {
+    again.push_back({"w" + std::to_string(w), "c", 1.0});
+  }
+  std::map<std::string, std::string> first_node;
+  for (const auto& result : results) {
+    first_node[batch[result.index].wafer] = result.node;
+  }
+  const auto second = executor.run(again, states);
+  for (const auto& result : second) {
+    REQUIRE(result.success);
+    const std::string& wafer = again[result.index].wafer;
+    if (wafer != "w1" && first_node[wafer] != "slow") {
+      REQUIRE(result.node == first_node[wafer]);
+    }
+  }
+  REQUIRE(std::string(wafers["w1"].begin(), wafers["w1"].end()) == "axc");
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Distributed grids on thread ranks match the single-node solvers", "[Distributed]") {
+  const int ranks = 3, rows = 16, cols = 32;
+  Eigen::ArrayXXd conductivity(rows, cols), source(rows, cols), field(rows, cols);
+  std::vector<FftBackend::Complex> grid(static_cast<size_t>(rows) * cols);
+  for (int j = 0; j < cols; ++j) {
+    for (int i = 0; i < rows; ++i) {
+      conductivity(i, j) = 1.0 + 0.5 * std::sin(0.3 * i) * std::cos(0.2 * j);
+      source(i, j) = std::exp(-0.02 * ((i - 8) * (i - 8) + (j - 20) * (j - 20)));
+      field(i, j) = (i * 7 + j * 3) % 11;
+      grid[static_cast<size_t>(i) * cols + j] = FftBackend::Complex(field(i, j), source(i, j));
+    }
+  }
+  Eigen::ArrayXXd expected_u = Eigen::ArrayXXd::Zero(rows, cols);
+  MultigridSolver::Options options;
+  options.tolerance = 1e-9;
+  MultigridSolver(conductivity).solve(expected_u, source, options);
+  std::vector<FftBackend::Complex> expected_spectrum = grid;
+  Radix2Fft().transform(expected_spectrum.data(), rows, cols, false);
+  // Two cells of halo: each sweep reads two rows from the neighbouring rank
+  const auto blur = [](const TiledGrid::Tile& in, TiledGrid::Tile& out) {
+    for (int j = 0; j < in.cols; ++j) {
+      for (int i = 0; i < in.rows; ++i) {
+        out(i, j) = 0.5 * in(i, j) + 0.125 * (in(i - 2, j) + in(i + 2, j) + in(i, j - 1) + in(i, j + 1));
+      }
+    }
+  };
+  TiledGrid serial(rows, cols, 4, 2);
+  serial.load(field);
+  serial.applyStencil(3, blur);
+  Eigen::ArrayXXd expected_field(rows, cols);
+  serial.store(expected_field);
+
+  const SlabDecomposition slabs = SlabDecomposition::balanced(rows, ranks);
+  Eigen::ArrayXXd u = Eigen::ArrayXXd::Zero(rows, cols), blurred;
+  std::vector<FftBackend::Complex> spectrum(grid.size()), round_trip(grid.size());
+  std::atomic<int> failures{0};
+  std::vector<std::thread> threads;
+  for (auto& comm : LocalCommunicator::group(ranks)) {
+    threads.emplace_back([&, comm] {
+      try {
+        const int first = slabs.firstRow(comm->rank()), count = slabs.rowCount(comm->rank());
+        DistributedMultigridSolver solver(comm, conductivity.middleRows(first, count), rows);
+        Eigen::ArrayXXd local_u = Eigen::ArrayXXd::Zero(count, cols);
+        solver.solve(local_u, source.middleRows(first, count), options);
+        u.middleRows(first, count) = local_u;
+
+        DistributedFft fft(comm, rows, cols);
+        std::vector<FftBackend::Complex> data(grid.begin() + first * cols, grid.begin() + (first + count) * cols);
+        fft.forward(data);
+        const int first_col = fft.columnSlabs().firstRow(comm->rank());
+        for (int c = 0; c < fft.columnSlabs().rowCount(comm->rank()); ++c) {
+          for (int i = 0; i < rows; ++i) {
+            spectrum[static_cast<size_t>(i) * cols + first_col + c] = data[static_cast<size_t>(c) * rows + i];
+          }
+        }
+        fft.inverse(data);
+        std::copy(data.begin(), data.end(), round_trip.begin() + first * cols);
+
+        DistributedField distributed(comm, rows, cols, 4, 2);
+        distributed.scatter(comm->rank() == 0 ? field : Eigen::ArrayXXd());
+        distributed.applyStencil(3, blur);
+        Eigen::ArrayXXd gathered = distributed.gather();
+        if (comm->rank() == 0) {
+          blurred = gathered;
+        }
+      } catch (...) {
+        ++failures;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  REQUIRE(failures == 0);
+  REQUIRE((u - expected_u).abs().maxCoeff() < 1e-7 * expected_u.abs().maxCoeff());
+  double spectrum_error = 0.0, round_trip_error = 0.0;
+  for (size_t k = 0; k < grid.size(); ++k) {
+    spectrum_error = std::max(spectrum_error, std::abs(spectrum[k] - expected_spectrum[k]));
+    round_trip_error = std::max(round_trip_error, std::abs(round_trip[k] - grid[k]));
+  }
+  REQUIRE(spectrum_error < 1e-9);
+  REQUIRE(round_trip_error < 1e-12);
+  REQUIRE(blurred.rows() == rows);
+  REQUIRE((blurred - expected_field).abs().maxCoeff() < 1e-12);
+}
+
+TEST_CASE("Artifact store sends only the chunks an edit changed", "[Distributed]") {
+  using namespace SemiPRO;
+  const auto root = std::filesystem::temp_directory_path() / "semipro_artifact_test";
+  std::filesystem::remove_all(root);
+  auto bucket = std::make_shared<DirectoryObjectStore>((root / "bucket").string());
+
+  // A checkpoint-like artifact: smooth fields compress, noise does not
+  std::vector<unsigned char> base(3 << 20);
+  std::uint32_t state = 12345;
+  for (size_t i = 0; i < base.size(); ++i) {
+    state = state * 1664525u + 1013904223u;
+    base[i] = i < base.size() / 2 ? static_cast<unsigned char>(i / 4096) : static_cast<unsigned char>(state >> 24);
+  }
+  ArtifactStore::Options options;
+  options.cache_directory = (root / "node").string();
+  ArtifactStore store(bucket, options);
+  const std::string id = store.put(base);
+  const auto first = store.statistics();
+  REQUIRE(first.chunks_sent > 0);
+  REQUIRE(first.bytes_sent < base.size());
+
+  // The same artifact again sends nothing; an edit sends the chunks around it
+  REQUIRE(store.put(base) == id);
+  REQUIRE(store.statistics().bytes_sent == first.bytes_sent);
+  std::vector<unsigned char> edited = base;
+  edited.insert(edited.begin() + 2000000, {1, 2, 3, 4, 5, 6, 7});
+  const std::string edited_id = store.put(edited);
+  REQUIRE(edited_id != id);
+  REQUIRE(store.statistics().bytes_sent - first.bytes_sent < 4 * options.max_chunk);
+
+  // A node reads chunks it already holds from its cache; another fetches
+  // them all and checks them
+  std::vector<unsigned char> fetched;
+  REQUIRE(store.get(edited_id, fetched));
+  REQUIRE(fetched == edited);
+  REQUIRE(store.statistics().chunks_fetched == 0);
+  ArtifactStore other(bucket);
+  REQUIRE(other.get(id, fetched));
+  REQUIRE(fetched == base);
+  REQUIRE(other.statistics().chunks_fetched > 0);
+  REQUIRE_FALSE(other.get("0123", fetched));
+
+  CloudJob job;
+  const auto input = root / "wafer.ckpt";
+  std::ofstream(input, std::ios::binary).write(reinterpret_cast<const char*>(base.data()), base.size());
+  job.input_files["wafer.ckpt"] = input.string();
+  stageJobInputs(job, store);
+  REQUIRE(job.metadata["artifact:wafer.ckpt"] == id);
+  fetchJobInputs(job, other, (root / "run").string());
+  REQUIRE(std::filesystem::file_size(root / "run" / "wafer.ckpt") == base.size());
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Reproducible reductions and random streams do not depend on threads", "[Distributed]") {
+  // Magnitudes spread over 30 decades make the sum order-sensitive
+  std::vector<double> values(100000);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = std::pow(10.0, static_cast<double>(i % 31) - 15.0) * (i % 2 ? -1.0 : 1.0) + 1e-3 * std::sin(i);
+  }
+  const double parallel_sum = reproducibleSum(values.data(), values.size(), true);
+  REQUIRE(parallel_sum == reproducibleSum(values.data(), values.size(), false));
+  long double reference = 0.0L;
+  double magnitude = 0.0;
+  for (double v : values) {
+    reference += v;
+    magnitude += std::abs(v);
+  }
+  REQUIRE(std::abs(parallel_sum - static_cast<double>(reference)) <= 1e-15 * magnitude);
+  REQUIRE(reproducibleSum(values.data(), 0) == 0.0);
+
+  // Fixed chunks, so a vector-valued fold matches a serial one bit for bit
+  auto histogram = [&values](bool parallel) {
+    return orderedReduce(
+        values.size(), std::vector<double>(4, 0.0),
+        [&values](std::vector<double>& bins, std::size_t i) { bins[i % 4] += values[i]; },
+        [](std::vector<double>& into, const std::vector<double>& from) {
+          for (std::size_t b = 0; b < into.size(); ++b) {
+            into[b] += from[b];
+          }
+        },
+        parallel, 777);
+  };
+  REQUIRE(histogram(true) == histogram(false));
+
+  Reproducibility::enable(1234);
+  REQUIRE(Reproducibility::isEnabled());
+  std::uint64_t step_key = 0;
+  {
+    Reproducibility::Step step("wafer_a", 3);
+    step_key = Reproducibility::key();
+    REQUIRE(Reproducibility::key() == step_key);
+    REQUIRE(Reproducibility::key(1) != step_key);
+    {
+      Reproducibility::Step next("wafer_a", 4);
+      REQUIRE(Reproducibility::key() != step_key);
+    }
+    REQUIRE(Reproducibility::key() == step_key);
+    std::uint64_t other_thread = 0;
+    std::thread([&] {
+      Reproducibility::Step same("wafer_a", 3);
+      other_thread = Reproducibility::key();
+    }).join();
+    REQUIRE(other_thread == step_key);
+  }
+  REQUIRE(Reproducibility::key() != step_key);
+  REQUIRE(Reproducibility::key("metrology") == Reproducibility::key("metrology"));
+  REQUIRE(Reproducibility::key("metrology") != Reproducibility::key("damascene"));
+  Reproducibility::enable(1235);
+  {
+    Reproducibility::Step step("wafer_a", 3);
+    REQUIRE(Reproducibility::key() != step_key);
+  }
+  Reproducibility::disable();
+  REQUIRE(Reproducibility::key("metrology") != Reproducibility::key("metrology"));
+}
@@ -1,6 +1,17 @@
 #include <catch2/catch_test_macros.hpp>
 #include "../../src/cpp/modules/doping/doping_manager.hpp"
+#include "../../src/cpp/modules/doping/coupled_diffusion_solver.hpp"
+#include "../../src/cpp/modules/doping/implant_moments.hpp"
 #include "../../src/cpp/core/wafer.hpp"
+#include "../../src/cpp/core/task_scheduler.hpp"
+#include "../../src/cpp/core/vector_math.hpp"
+#include "../../src/cpp/core/depth_mesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
 
 TEST_CASE("Ion implantation", "[Doping]") {
   auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
@@ -21,4 +32,208 @@ TEST_CASE("Diffusion", "[Doping]") {
   auto final_profile = wafer->getDopantProfile();
   REQUIRE(final_profile.sum() > 0.0);
   REQUIRE(final_profile.maxCoeff() < initial_profile.maxCoeff()); // Diffusion spreads profile
-}
\ No newline at end of file
+}
+TEST_CASE("Cancelled diffusion keeps the partial profile", "[Doping]") {
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(100, 100);
+  DopingManager doping;
+  doping.simulateIonImplantation(wafer, 50.0, 1e15);
+  Eigen::ArrayXd initial_profile = wafer->getDopantProfile();
+
+  CancellationSource source;
+  source.requestStop();
+  {
+    CancellationScope scope(source.token());
+    doping.simulateDiffusion(wafer, 1000.0, 3600.0);
+  }
+  REQUIRE(wafer->getDopantProfile().isApprox(initial_profile)); // Stopped before the first step
+}
+
+TEST_CASE("Seeded implantation is reproducible on any thread count", "[Doping]") {
+  auto wafer = std::make_shared<Wafer>(300.0, 1.0, "silicon"); // Thin, so the profile spans many cells
+  wafer->initializeGrid(100, 100);
+  auto implant = [&](int threads) {
+    TaskScheduler::getInstance().resize(threads);
+    MonteCarloSolver solver(42);
+    solver.setParticleCount(300000);
+    return solver.simulateImplantation(wafer, 50.0, 1e15);
+  };
+  Eigen::ArrayXd serial = implant(1);
+  Eigen::ArrayXd parallel = implant(4);
+  TaskScheduler::getInstance().resize(0);
+  REQUIRE(serial.sum() > 0.0);
+  REQUIRE((serial == parallel).all());
+}
+
+TEST_CASE("Binary-collision transport stops ions inside the wafer", "[Doping]") {
+  auto wafer = std::make_shared<Wafer>(300.0, 1.0, "silicon");
+  wafer->initializeGrid(200, 10);
+  MonteCarloSolver solver(7);
+  solver.setTransport(MonteCarloSolver::Transport::BinaryCollision);
+  solver.setParticleCount(1000);
+  Eigen::ArrayXd profile = solver.simulateImplantation(wafer, 50.0, 1e15);
+  Eigen::Index peak;
+  profile.maxCoeff(&peak);
+  const double dz = wafer->getThickness() / profile.size();
+  REQUIRE(profile.sum() * dz * 1e-4 <= 1e15 * 1.0001); // Ions at rest never exceed the dose
+  REQUIRE(peak * dz > 0.1);                             // 50 keV boron peaks near 0.2 um
+  REQUIRE(peak * dz < 0.3);
+}
+
+TEST_CASE("Crank-Nicolson diffusion matches explicit at a hundredfold step", "[Doping]") {
+  Eigen::ArrayXd initial(201);
+  for (int i = 0; i < initial.size(); ++i) {
+    double x = (i - 100) / 10.0;
+    initial[i] = 1e18 * std::exp(-x * x);
+  }
+  // alpha = 0.3 for the explicit step, 30 for the implicit one
+  DiffusionSolver explicit_solver;
+  Eigen::ArrayXd reference = explicit_solver.simulateDiffusion(initial, 10000.0, 1.0, 1e-9, 1e-3);
+
+  DiffusionSolver solver;
+  solver.setScheme(DiffusionSolver::Scheme::CrankNicolson);
+  Eigen::ArrayXd fixed = solver.simulateDiffusion(initial, 10000.0, 1.0, 1e-9, 0.1);
+  REQUIRE((fixed - reference).abs().maxCoeff() < 1e-2 * reference.maxCoeff());
+
+  solver.setAdaptiveStepping(true, 1e-4);
+  Eigen::ArrayXd adaptive = solver.simulateDiffusion(initial, 10000.0, 1.0, 1e-9, 0.1);
+  REQUIRE((adaptive - reference).abs().maxCoeff() < 1e-3 * reference.maxCoeff());
+}
+
+TEST_CASE("Coupled diffusion spreads a dilute Gaussian and conserves dose", "[Doping]") {
+  const double dx = 1e-6;
+  auto spread = [dx](const Eigen::ArrayXd& c) {
+    double mean = 0.0;
+    for (int i = 0; i < c.size(); ++i) mean += c[i] * i * dx;
+    mean /= c.sum();
+    double variance = 0.0;
+    for (int i = 0; i < c.size(); ++i) variance += c[i] * (i * dx - mean) * (i * dx - mean);
+    return variance / c.sum();
+  };
+
+  Eigen::ArrayXd boron(400);
+  for (int i = 0; i < boron.size(); ++i) {
+    double x = (i - 200) * dx;
+    boron[i] = 1e15 * std::exp(-x * x / 2e-10);
+  }
+  CoupledDiffusionSolver solver;
+  auto result = solver.anneal({CoupledDiffusionSolver::Dopant::boron()}, {boron}, Eigen::ArrayXd(),
+                              1273.0, 3600.0, dx);
+  double expected = 1e-10 + 2.0 * CoupledDiffusionSolver::Dopant::boron().diffusivity(1273.0) * 3600.0;
+  REQUIRE(std::abs(spread(result.dopants[0]) - expected) < 1e-2 * expected);
+  REQUIRE(std::abs(result.dopants[0].sum() - boron.sum()) < 1e-6 * boron.sum());
+
+  // An interstitial excess enhances the spread
+  Eigen::ArrayXd excess = boron * 1e4 + solver.getInterstitials().equilibrium(1273.0);
+  auto enhanced = solver.anneal({CoupledDiffusionSolver::Dopant::boron()}, {boron}, excess, 1273.0,
+                                3600.0, dx);
+  REQUIRE(spread(enhanced.dopants[0]) > spread(result.dopants[0]));
+  REQUIRE(std::abs(enhanced.dopants[0].sum() - boron.sum()) < 1e-6 * boron.sum());
+}
+
+TEST_CASE("Implant moment tables give tabulated ranges in silicon", "[Doping]") {
+  const ImplantMoments& phosphorus = ImplantMoments::table({15.0, 30.97});
+  REQUIRE(&phosphorus == &ImplantMoments::table({15.0, 30.97}));
+
+  // 0.042 um tabulated for 30 keV phosphorus, arsenic shallower
+  auto moments = phosphorus.at(30.0);
+  REQUIRE(std::abs(moments.projected_range - 0.042) < 0.2 * 0.042);
+  REQUIRE(moments.range_straggling < moments.projected_range);
+  REQUIRE(ImplantMoments::table({33.0, 74.92}).at(30.0).projected_range < moments.projected_range);
+
+  double previous = 0.0;
+  for (double energy = 1.0; energy < 1e4; energy *= 1.37) {
+    double range = phosphorus.at(energy).projected_range;
+    REQUIRE(range > previous);
+    previous = range;
+  }
+}
+
+TEST_CASE("Adaptive-mesh implant and anneal keep the dose", "[Doping]") {
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(100, 100);
+  DopingManager doping;
+  doping.setAdaptiveMesh(true);
+  doping.simulateIonImplantation(wafer, 50.0, 1e15);
+
+  // Resolves the 0.2 um implant in a 775 um wafer on a couple hundred nodes
+  const DepthMesh& mesh = wafer->getDopantMesh();
+  REQUIRE(mesh.size() < 200);
+  REQUIRE(std::abs(mesh.integrate(wafer->getDopantMeshProfile()) * 1e-4 / 1e15 - 1.0) < 0.01);
+  REQUIRE(std::abs(wafer->getDopantProfile().sum() * 7.75e-4 / 1e15 - 1.0) < 0.01);
+
+  doping.simulateDiffusion(wafer, 1000.0, 3600.0);
+  const double dose = wafer->getDopantMesh().integrate(wafer->getDopantMeshProfile()) * 1e-4;
+  REQUIRE(std::abs(dose / 1e15 - 1.0) < 0.02);
+}
+
+TEST_CASE("Vectorized exp is within an ulp of std::exp and the same on every path", "[Doping]") {
+  std::vector<double> x;
+  for (double v = -760.0; v < 720.0; v += 0.0137) {
+    x.push_back(v);
+  }
+  x.push_back(0.0);
+  x.push_back(std::numeric_limits<double>::quiet_NaN());
+  auto ulps = [](double a, double b) {
+    std::int64_t i, j;
+    std::memcpy(&i, &a, sizeof i);
+    std::memcpy(&j, &b, sizeof j);
+    return i > j ? i - j : j - i;
+  };
+
+  const VectorMath::Path widest = VectorMath::activePath();
+  std::vector<double> generic(x.size()), y(x.size());
+  VectorMath::setPath(VectorMath::Path::Generic);
+  VectorMath::exp(x.data(), generic.data(), x.size());
+  std::int64_t worst = 0;
+  for (std::size_t i = 0; i + 1 < x.size(); ++i) {
+    worst = std::max(worst, ulps(generic[i], std::exp(x[i])));
+  }
+  REQUIRE(worst <= 1);
+  REQUIRE(std::isnan(generic.back()));
+
+  for (auto path : {VectorMath::Path::AVX2, VectorMath::Path::AVX512}) {
+    if (!VectorMath::isSupported(path)) {
+      continue;
+    }
+    VectorMath::setPath(path);
+    VectorMath::exp(x.data(), y.data(), x.size());
+    REQUIRE(std::memcmp(y.data(), generic.data(), (x.size() - 1) * sizeof(double)) == 0);
+    VectorMath::gaussian(x.data(), y.data(), x.size(), 1.0, 3.0, 2.0);
+    std::vector<double> reference(x.size());
+    VectorMath::setPath(VectorMath::Path::Generic);
+    VectorMath::gaussian(x.data(), reference.data(), x.size(), 1.0, 3.0, 2.0);
+    REQUIRE(std::memcmp(y.data(), reference.data(), (x.size() - 1) * sizeof(double)) == 0);
+  }
+  VectorMath::setPath(widest);
+}
+
+TEST_CASE("Adapted depth mesh keeps a Gaussian profile on a tenth of the points", "[Doping]") {
+  auto gaussian = [](double depth) { return 1e20 * std::exp(-0.5 * std::pow((depth - 0.3) / 0.05, 2)) + 1e15; };
+  const DepthMesh dense = DepthMesh::cells(1.0, 2000);
+  const Eigen::ArrayXd values = dense.nodes().unaryExpr(gaussian);
+  const DepthMesh mesh = DepthMesh::adapted(dense, values);
+  REQUIRE(mesh.size() * 10 <= dense.size());
+
+  const Eigen::ArrayXd exact = mesh.nodes().unaryExpr(gaussian);
+  double worst = 0.0;
+  for (int i = 0; i < dense.size(); ++i) {
+    worst = std::max(worst, std::abs(mesh.sample(exact, dense.nodes()[i]) - values[i]) / values[i]);
+  }
+  REQUIRE(worst < 0.02);
+
+  const Eigen::ArrayXd remapped = dense.remap(values, mesh);
+  REQUIRE(std::abs(mesh.integrate(remapped) / dense.integrate(values) - 1.0) < 1e-9);
+  REQUIRE(std::abs(dense.integrate(mesh.remap(remapped, dense)) / dense.integrate(values) - 1.0) < 0.01);
+
+  Wafer wafer(300.0, 1.0, "silicon");
+  wafer.initializeGrid(100, 10);
+  wafer.setDopantProfile(mesh, exact);
+  REQUIRE(wafer.getDopantMesh().size() == mesh.size());
+  REQUIRE(std::abs(wafer.getDopantConcentration(0.3) / gaussian(0.3) - 1.0) < 0.02);
+  REQUIRE(std::abs(wafer.getDopantProfile().sum() * 0.01 / dense.integrate(values) - 1.0) < 0.01);
+
+  wafer.getDopantProfile()[0] = 5e15; // Editing the uniform profile moves the mesh back onto it
+  REQUIRE(wafer.getDopantMesh().size() == 100);
+  REQUIRE(wafer.getDopantConcentration(0.005) == 5e15);
+}
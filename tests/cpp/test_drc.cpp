@@ -0,0 +1,244 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/modules/design_rule_check/drc_model.hpp"
+#include "../../src/cpp/modules/design_rule_check/polygon_drc.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// DRCModel leaves DRCInterface's rule-set entry points to subclasses; these
+// tests drive its own checks, so those are stubbed out. Starts without the
+// default rules, one mask cell to the um.
+class TestDRC : public DRCModel {
+public:
+  TestDRC() {
+    while (!getRules().empty()) {
+      removeRule(getRules().front().name);
+    }
+    setCellSize(1.0);
+  }
+
+  DRCResult performDRC(std::shared_ptr<Wafer>, const std::vector<DesignRule>&) override { return {}; }
+  std::vector<Violation> checkMinimumWidth(std::shared_ptr<Wafer>, const std::string&, double) override {
+    return {};
+  }
+  std::vector<Violation> checkMinimumSpacing(std::shared_ptr<Wafer>, const std::string&, double) override {
+    return {};
+  }
+  std::vector<Violation> checkMinimumArea(std::shared_ptr<Wafer>, const std::string&, double) override {
+    return {};
+  }
+  std::vector<Violation> checkEnclosure(std::shared_ptr<Wafer>, const std::string&, const std::string&,
+                                        double) override {
+    return {};
+  }
+  std::vector<Violation> checkDensity(std::shared_ptr<Wafer>, const std::string&, double, double, double) override {
+    return {};
+  }
+  std::vector<Violation> checkAntennaRatio(std::shared_ptr<Wafer>, const std::string&, const std::string&,
+                                           double) override {
+    return {};
+  }
+  std::vector<Violation> checkAspectRatio(std::shared_ptr<Wafer>, const std::string&, double) override {
+    return {};
+  }
+  void loadRuleSet(const std::string&) override {}
+  void saveRuleSet(const std::string&, const std::vector<DesignRule>&) override {}
+  std::vector<DesignRule> getStandardRules(const std::string&) override { return {}; }
+  void generateDRCReport(const DRCResult&, const std::string&) override {}
+  std::unordered_map<std::string, double> analyzeDRCStatistics(const DRCResult&) override { return {}; }
+  void addWaiver(const Violation&, const std::string&) override {}
+  bool isWaived(const Violation&) override { return false; }
+  std::vector<Violation> checkRegion(std::shared_ptr<Wafer>, const std::vector<DesignRule>&, double, double, double,
+                                     double) override {
+    return {};
+  }
+  void highlightViolations(std::shared_ptr<Wafer>, const std::vector<Violation>&) override {}
+};
+
+SemiPRO::GDSPolygon rectangle(double x0, double y0, double x1, double y1) {
+  SemiPRO::GDSPolygon polygon;
+  polygon.layer = 1;
+  polygon.datatype = 0;
+  polygon.points = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+  return polygon;
+}
+
+bool near(const std::pair<double, double>& location, double x, double y) {
+  return std::abs(location.first - x) < 1e-9 && std::abs(location.second - y) < 1e-9;
+}
+
+// Violations as (rule, location, measurement), in a fixed order
+std::vector<std::tuple<std::string, double, double, double>> summary(const std::vector<DRCViolation>& violations) {
+  std::vector<std::tuple<std::string, double, double, double>> rows;
+  for (const auto& v : violations) {
+    rows.emplace_back(v.rule_name, v.location.first, v.location.second, v.measured_value);
+  }
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
+// Cells [row_begin, row_end) x [col_begin, col_end) set to 1
+void fill(Eigen::ArrayXXd& pattern, int row_begin, int row_end, int col_begin, int col_end) {
+  pattern.block(row_begin, col_begin, row_end - row_begin, col_end - col_begin).setConstant(1.0);
+}
+
+} // namespace
+
+TEST_CASE("Mask DRC counts only photoresist above 0.5 as metal", "[DRC]") {
+  // A line two cells wide, with a column at exactly 0.5 beside it
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(20, 20);
+  Eigen::ArrayXXd pattern = Eigen::ArrayXXd::Zero(20, 20);
+  pattern.col(5).setConstant(1.0);
+  pattern.col(6).setConstant(1.0);
+  pattern.col(7).setConstant(0.5);
+  wafer->setPhotoresistPattern(pattern);
+
+  TestDRC drc;
+  drc.addRule(DRCRule("metal_width", ViolationType::WIDTH, "metal", 2.5));
+  drc.addRule(DRCRule("metal_area", ViolationType::AREA, "metal", 1000.0));
+  drc.runFullDRC(wafer);
+
+  const auto widths = drc.getViolationsByType(ViolationType::WIDTH);
+  REQUIRE(widths.size() == 20);
+  for (const auto& violation : widths) {
+    REQUIRE(violation.measured_value == 2.0);
+  }
+  const auto areas = drc.getViolationsByType(ViolationType::AREA);
+  REQUIRE(areas.size() == 1);
+  REQUIRE(areas[0].measured_value == 40.0);
+}
+
+TEST_CASE("Polygon DRC measures width, spacing, enclosure and area", "[DRC]") {
+  PolygonLayers layers;
+  // A bar 1 wide, two blocks 1 apart and a lone square of area 1
+  layers["metal"] = PolygonLayer::fromPolygons({rectangle(0, 0, 10, 1), rectangle(0, 5, 4, 9), rectangle(5, 5, 9, 9),
+                                                rectangle(20, 20, 21, 21)});
+  // A via 0.5 inside the left side of its landing pad, 2 or more elsewhere
+  layers["via"] = PolygonLayer::fromPolygons({rectangle(32, 2, 33, 3)});
+  layers["pad"] = PolygonLayer::fromPolygons({rectangle(31.5, 0, 40, 10)});
+  REQUIRE(layers["metal"].areas().size() == 4);
+
+  std::vector<DRCRule> rules = {DRCRule("width", ViolationType::WIDTH, "metal", 1.5),
+                                DRCRule("space", ViolationType::SPACING, "metal", 2.0),
+                                DRCRule("area", ViolationType::AREA, "metal", 2.0),
+                                DRCRule("enclosure", ViolationType::ENCLOSURE, "via", 1.0),
+                                DRCRule("missing", ViolationType::WIDTH, "poly", 5.0)};
+  rules[3].enclosing_layer = "pad";
+  const auto violations = PolygonDRC::check(rules, layers);
+
+  std::vector<DRCViolation> width, space, area, enclosure;
+  for (const auto& v : violations) {
+    if (v.rule_name == "width") width.push_back(v);
+    if (v.rule_name == "space") space.push_back(v);
+    if (v.rule_name == "area") area.push_back(v);
+    if (v.rule_name == "enclosure") enclosure.push_back(v);
+  }
+  REQUIRE(violations.size() == 5);
+  // The bar across its long sides and the square across either pair
+  REQUIRE(width.size() == 2);
+  REQUIRE(std::abs(width[0].measured_value - 1.0) < 1e-9);
+  REQUIRE(std::abs(width[1].measured_value - 1.0) < 1e-9);
+  REQUIRE(std::any_of(width.begin(), width.end(), [](const DRCViolation& v) { return near(v.location, 5.0, 0.5); }));
+  REQUIRE(space.size() == 1);
+  REQUIRE(std::abs(space[0].measured_value - 1.0) < 1e-9);
+  REQUIRE(near(space[0].location, 4.5, 7.0));
+  REQUIRE(area.size() == 1);
+  REQUIRE(std::abs(area[0].measured_value - 1.0) < 1e-9);
+  REQUIRE(near(area[0].location, 20.5, 20.5));
+  REQUIRE(enclosure.size() == 1);
+  REQUIRE(std::abs(enclosure[0].measured_value - 0.5) < 1e-9);
+  REQUIRE(near(enclosure[0].location, 31.75, 2.5));
+}
+
+TEST_CASE("Polygon DRC reports violations across tile boundaries once", "[DRC]") {
+  // With tiles 8 wide from x = 0, the gap between the blocks straddles
+  // the boundary at x = 16 and the thin bar crosses four tiles
+  PolygonLayers layers;
+  layers["metal"] = PolygonLayer::fromPolygons(
+      {rectangle(0, 0, 15.5, 4), rectangle(16.5, 0, 30, 4), rectangle(0, 10, 30, 10.5)});
+  const std::vector<DRCRule> rules = {DRCRule("width", ViolationType::WIDTH, "metal", 1.0),
+                                      DRCRule("space", ViolationType::SPACING, "metal", 2.0)};
+
+  const auto tiled = PolygonDRC::check(rules, layers, 8.0);
+  REQUIRE(tiled.size() == 2);
+  const auto named = [&tiled](const std::string& rule) {
+    return std::find_if(tiled.begin(), tiled.end(), [&rule](const DRCViolation& v) { return v.rule_name == rule; });
+  };
+  const auto gap = named("space");
+  REQUIRE(gap != tiled.end());
+  REQUIRE(near(gap->location, 16.0, 2.0));
+  const auto bar = named("width");
+  REQUIRE(bar != tiled.end());
+  REQUIRE(std::abs(bar->measured_value - 0.5) < 1e-9);
+
+  // One tile, and the default tiling, find the same
+  REQUIRE(summary(PolygonDRC::check(rules, layers, 1000.0)) == summary(tiled));
+  REQUIRE(summary(PolygonDRC::check(rules, layers)) == summary(tiled));
+}
+
+TEST_CASE("Mask DRC finds features apart only across a corner", "[DRC]") {
+  // Two 3 x 3 squares facing each other along no row or column, two clear
+  // cells apart in each direction
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(12, 12);
+  Eigen::ArrayXXd pattern = Eigen::ArrayXXd::Zero(12, 12);
+  fill(pattern, 2, 5, 2, 5);
+  fill(pattern, 7, 10, 7, 10);
+  wafer->setPhotoresistPattern(pattern);
+
+  TestDRC drc;
+  drc.addRule(DRCRule("space", ViolationType::SPACING, "metal", 3.0));
+  drc.runFullDRC(wafer);
+  REQUIRE(drc.getViolationCount() == 1);
+  const DRCViolation& corner = drc.getViolations()[0];
+  REQUIRE(std::abs(corner.measured_value - std::sqrt(8.0)) < 1e-9);
+  REQUIRE(near(corner.location, 5.5, 5.5));
+
+  TestDRC loose;
+  loose.addRule(DRCRule("space", ViolationType::SPACING, "metal", 2.5));
+  loose.runFullDRC(wafer);
+  REQUIRE(loose.getViolationCount() == 0);
+}
+
+TEST_CASE("Incremental DRC rechecks changed regions to the full result", "[DRC]") {
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(256, 256);
+  Eigen::ArrayXXd pattern = Eigen::ArrayXXd::Zero(256, 256);
+  fill(pattern, 10, 20, 10, 20);
+  fill(pattern, 10, 20, 22, 32); // 2 cells from the first square
+  wafer->setPhotoresistPattern(pattern);
+  const std::vector<DRCRule> rules = {DRCRule("width", ViolationType::WIDTH, "metal", 2.0),
+                                      DRCRule("space", ViolationType::SPACING, "metal", 3.0)};
+  const auto fullRun = [&] {
+    TestDRC full;
+    for (const auto& rule : rules) full.addRule(rule);
+    full.runFullDRC(wafer);
+    return summary(full.getViolations());
+  };
+
+  TestDRC drc;
+  for (const auto& rule : rules) drc.addRule(rule);
+  drc.runFullDRC(wafer);
+  REQUIRE(drc.getViolationCount() == 10);
+
+  // A one-cell line far away; the mask comparison finds it
+  fill(pattern, 100, 110, 150, 151);
+  wafer->setPhotoresistPattern(pattern);
+  drc.runIncrementalDRC(wafer);
+  REQUIRE(drc.getViolationCount() == 20);
+  REQUIRE(summary(drc.getViolations()) == fullRun());
+
+  // Closing the gap, with the caller naming the region it touched
+  fill(pattern, 10, 20, 20, 22);
+  wafer->setPhotoresistPattern(pattern);
+  drc.runIncrementalDRC(wafer, {10.0, 20.0}, {20.0, 22.0});
+  REQUIRE(drc.getViolationCount() == 10);
+  REQUIRE(summary(drc.getViolations()) == fullRun());
+}
@@ -2,6 +2,10 @@
 #include "../../src/cpp/modules/etching/etching_model.hpp"
 #include "../../src/cpp/core/wafer.hpp"
 #include "../../src/cpp/modules/photolithography/lithography_model.hpp"
+#include "../../src/cpp/core/level_set.hpp"
+#include "../../src/cpp/core/flux_tracer.hpp"
+#include "../../src/cpp/core/pattern_density.hpp"
+#include <cmath>
 
 TEST_CASE("Isotropic etching simulation", "[Etching]") {
   auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
@@ -25,4 +29,151 @@ TEST_CASE("Anisotropic etching simulation", "[Etching]") {
   double initial_sum = wafer->getGrid().sum();
   etching.simulateEtching(wafer, 0.05, "anisotropic");
   REQUIRE(wafer->getGrid().sum() < initial_sum);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Level-set etching cuts trenches and undercuts the resist", "[Etching]") {
+  const int n = 40;
+  const double cell = 0.01;
+  // Resist everywhere but a ten-cell stripe
+  BitMask resist(n, n);
+  for (int i = 0; i < n; ++i) {
+    resist.setSpan(i, 0, 15);
+    resist.setSpan(i, 25, n);
+  }
+
+  auto etch = [&](const std::string& type) {
+    auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    wafer->initializeGrid(n, n);
+    wafer->setPhotoresistMask(resist);
+    EtchingModel etching;
+    etching.setCellSize(cell);
+    etching.simulateEtching(wafer, 0.1, type);
+    return Eigen::ArrayXXd(wafer->getGrid());
+  };
+  for (const std::string type : {"anisotropic", "isotropic"}) {
+    // Heights from the wafer's initial surface
+    Eigen::ArrayXXd grid = etch(type) - 775.0;
+    // The stripe's floor lands at the depth and the resist holds its cells
+    REQUIRE(std::abs(grid(20, 20) + 0.1) < 1e-4);
+    REQUIRE((grid.leftCols(15).abs() < 1e-9).all());
+    REQUIRE((grid.rightCols(15).abs() < 1e-9).all());
+    REQUIRE((grid.middleCols(15, 10) < -0.05).all());
+  }
+
+  // Under the resist edge only the isotropic etch reaches sideways
+  auto profile = [&](double directionality) {
+    Eigen::ArrayXXd heights = Eigen::ArrayXXd::Zero(n, n);
+    return LevelSet::evolveHeights(heights, cell, 0.1, 0.1, LevelSet::directional(-1.0, directionality), &resist);
+  };
+  LevelSet anisotropic = profile(1.0);
+  LevelSet isotropic = profile(0.0);
+  const int k = static_cast<int>(std::lround((-0.05 - isotropic.zMin()) / cell)); // 50 nm down
+  REQUIRE(anisotropic.value(20, 13, k) < 0.0);
+  REQUIRE(isotropic.value(20, 13, k) > 0.0);
+  REQUIRE(isotropic.value(20, 4, k) < 0.0);
+  // The band follows the surface, leaving most of the volume unallocated
+  const std::size_t blocks = static_cast<std::size_t>((n + 7) / 8) * ((n + 7) / 8) * ((isotropic.layers() + 7) / 8);
+  REQUIRE(isotropic.allocatedBlocks() < blocks);
+  REQUIRE(isotropic.bandSize() < static_cast<std::size_t>(n) * n * isotropic.layers() / 2);
+
+  REQUIRE_THROWS_AS(EtchingModel().setCellSize(0.0), std::invalid_argument);
+  REQUIRE_THROWS_AS(LevelSet(Eigen::ArrayXXd::Zero(n, n), cell, 0.0, 0.0), std::invalid_argument);
+}
+
+TEST_CASE("Traced flux shades trench floors and drives the surface", "[Etching]") {
+  const double cell = 0.01;
+  // A trench eight cells wide and thirty deep across the middle rows
+  Eigen::ArrayXXd heights = Eigen::ArrayXXd::Zero(24, 6);
+  heights.middleRows(8, 8) = -0.3;
+  LevelSet surface(heights, cell, -0.5, 0.1);
+  FluxTracer tracer(100);
+  tracer.update(surface);
+
+  auto average = [&](const std::vector<double>& flux, bool floor) {
+    double sum = 0.0;
+    int count = 0;
+    for (std::size_t e = 0; e < flux.size(); ++e) {
+      const FluxTracer::Element& element = tracer.elements()[e];
+      const bool on_floor = element.center.z() < -0.29 && element.i >= 10 && element.i <= 13;
+      const bool on_top = element.center.z() > -0.01 && (element.i < 6 || element.i > 17);
+      if (floor ? on_floor : on_top) {
+        sum += flux[e];
+        ++count;
+      }
+    }
+    REQUIRE(count > 0);
+    return sum / count;
+  };
+  const std::vector<double> neutrals = tracer.trace({1.0, 1.0, 10});
+  const std::vector<double> ions = tracer.trace({100.0, 1.0, 0});
+  const std::vector<double> bouncing = tracer.trace({1.0, 0.1, 10});
+  // Open ground sees the source's flux; the floor sees the sky through the
+  // opening, more of it for a narrow beam and for species that bounce
+  REQUIRE(std::abs(average(neutrals, false) - 1.0) < 0.05);
+  REQUIRE(std::abs(average(ions, false) - 1.0) < 0.05);
+  REQUIRE(average(neutrals, true) < 0.3);
+  REQUIRE(average(ions, true) > 2.0 * average(neutrals, true));
+  REQUIRE(average(bouncing, true) > 2.0 * average(neutrals, true));
+  // The same surface traces the same
+  REQUIRE(tracer.trace({1.0, 1.0, 10}) == neutrals);
+
+  // Ions etch the open ground at full rate and the shaded floor slower,
+  // the hierarchy patched rather than rebuilt while the walls stand still
+  const int traces = tracer.evolve(surface, 0.05, [](const FluxTracer& traced) {
+    std::vector<double> speeds = traced.trace({100.0, 1.0, 0});
+    for (double& speed : speeds) {
+      speed = -speed;
+    }
+    return speeds;
+  });
+  REQUIRE(traces > 1);
+  REQUIRE(tracer.statistics().refits > 0);
+  const Eigen::ArrayXXd etched = surface.heights();
+  REQUIRE(std::abs(etched(2, 3) + 0.05) < 0.01);
+  REQUIRE(etched(12, 3) < -0.3 - 0.01);
+  REQUIRE(etched(12, 3) + 0.3 > etched(2, 3) + 0.005);
+
+  REQUIRE_THROWS_AS(FluxTracer(0), std::invalid_argument);
+  REQUIRE_THROWS_AS(tracer.velocity({}), std::invalid_argument);
+}
+
+TEST_CASE("Pattern density averages the mask over each scale", "[Etching]") {
+  // Resist over the left half, with a single opening in it
+  BitMask mask = BitMask::fromPredicate(40, 60, [](int, int j) { return j < 30; });
+  mask.set(20, 10, false);
+  const Eigen::ArrayXXd field = mask.toField();
+
+  // Boxes match a direct average over the window, cut at the grid's edge
+  const Eigen::ArrayXXd box = PatternDensity::density(mask, {4.0, PatternDensity::Window::kBox});
+  for (int i : {0, 3, 20, 39}) {
+    for (int j : {0, 10, 27, 30, 59}) {
+      const int i0 = std::max(0, i - 4), i1 = std::min(40, i + 5);
+      const int j0 = std::max(0, j - 4), j1 = std::min(60, j + 5);
+      const double direct = field.block(i0, j0, i1 - i0, j1 - j0).mean();
+      REQUIRE(std::abs(box(i, j) - direct) < 1e-12);
+    }
+  }
+
+  // A Gaussian blurs the resist edge into a ramp and fills in the opening
+  const Eigen::ArrayXXd gaussian = PatternDensity::density(mask, {3.0});
+  REQUIRE(gaussian(20, 10) > 0.9);
+  REQUIRE(gaussian(5, 22) > 0.99);
+  REQUIRE(gaussian(5, 29) > 0.5);
+  REQUIRE(gaussian(5, 30) < 0.5);
+  REQUIRE(gaussian(5, 37) < 0.01);
+  REQUIRE(PatternDensity::density(mask, {0.0}).isApprox(field));
+
+  // Maps of the same mask and scales are computed once and shared
+  PatternDensity::clearCache();
+  const std::vector<PatternDensity::Scale> scales = {{2.0}, {1e6, PatternDensity::Window::kBox}};
+  const PatternDensity::Maps first = PatternDensity::maps(mask, scales);
+  const PatternDensity::Maps again = PatternDensity::maps(BitMask(mask), scales);
+  REQUIRE(first == again);
+  REQUIRE(first->size() == 2);
+  REQUIRE((*first)[1].isApprox(Eigen::ArrayXXd::Constant(40, 60, field.mean())));
+  mask.set(0, 0, false);
+  REQUIRE(PatternDensity::maps(mask, scales) != first);
+
+  REQUIRE_THROWS_AS(PatternDensity::density(mask, {-1.0}), std::invalid_argument);
+  REQUIRE_THROWS_AS(PatternDensity::density(BitMask(), {1.0}), std::invalid_argument);
+}
@@ -0,0 +1,79 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/advanced/gaussian_process.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+double smooth(double x, double y) {
+  return std::sin(3.0 * x) + 0.5 * std::cos(5.0 * y);
+}
+
+} // namespace
+
+TEST_CASE("Gaussian process posterior interpolates its samples", "[GaussianProcess]") {
+  SemiPRO::GaussianProcess gp;
+  const auto prior = gp.predict({0.5, 0.5});
+  REQUIRE(prior.mean == 0.0);
+  REQUIRE(prior.stddev > 0.0);
+
+  // Enough samples on a grid to pass the first length-scale refit
+  std::vector<std::vector<double>> points;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      points.push_back({0.1 + 0.25 * i, 0.1 + 0.25 * j});
+      gp.addSample(points.back(), smooth(points.back()[0], points.back()[1]));
+    }
+  }
+  REQUIRE(gp.size() == 16);
+  REQUIRE_THROWS_AS(gp.addSample({0.5}, 1.0), std::invalid_argument);
+
+  double spread = 0.0;
+  for (const auto& p : points) {
+    spread = std::max(spread, gp.predict(p).stddev);
+  }
+  for (const auto& p : points) {
+    const auto at = gp.predict(p);
+    REQUIRE(std::abs(at.mean - smooth(p[0], p[1])) < 1e-3);
+    REQUIRE(at.stddev < 1e-2);
+  }
+  // Between samples the posterior is less sure, and far outside it
+  // returns towards the prior
+  REQUIRE(gp.predict({0.225, 0.225}).stddev > spread);
+  REQUIRE(gp.predict({3.0, 3.0}).stddev > gp.predict({0.225, 0.225}).stddev);
+
+  gp.clear();
+  REQUIRE(gp.size() == 0);
+  REQUIRE(gp.predict({0.5, 0.5}).mean == 0.0);
+}
+
+TEST_CASE("Expected improvement points at the minimizer of a quadratic", "[GaussianProcess]") {
+  // Minimizing (x - 0.37)^2 is maximizing its negative
+  const double minimizer = 0.37;
+  auto objective = [&](double x) { return -(x - minimizer) * (x - minimizer); };
+  SemiPRO::GaussianProcess gp;
+  double best = -1e300;
+  for (double x : {0.0, 0.15, 0.55, 0.7, 0.85, 1.0}) {
+    gp.addSample({x}, objective(x));
+    best = std::max(best, objective(x));
+  }
+
+  double argmax = -1.0;
+  double largest = -1.0;
+  for (int i = 0; i <= 1000; ++i) {
+    const double x = i / 1000.0;
+    const double ei = gp.expectedImprovement({x}, best, 0.0);
+    REQUIRE(ei >= 0.0);
+    if (ei > largest) {
+      largest = ei;
+      argmax = x;
+    }
+  }
+  REQUIRE(largest > 0.0);
+  REQUIRE(std::abs(argmax - minimizer) < 0.03);
+
+  // No improvement is expected at a sample worse than the best
+  REQUIRE(gp.expectedImprovement({1.0}, best, 0.0) < 1e-9);
+}
@@ -1,5 +1,13 @@
 #include <catch2/catch_test_macros.hpp>
 #include "../../src/cpp/modules/geometry/geometry_manager.hpp"
+#include "../../src/cpp/core/edge_map.hpp"
+#include "../../src/cpp/core/point_grid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 TEST_CASE("Geometry grid initialization", "[Geometry]") {
   auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
@@ -15,4 +23,85 @@ TEST_CASE("Geometry apply layer", "[Geometry]") {
   geometry.applyLayer(wafer, 0.1, "oxide");
   REQUIRE(wafer->getThickness() == 775.1);
   REQUIRE(wafer->getMaterialId() == "oxide");
-}
\ No newline at end of file
+}
+
+TEST_CASE("Edge map places sub-pixel edges and measures runs and gaps", "[Geometry]") {
+  // A block whose sides ramp to 0.375 and 0.25 beside a sharp one: the 0.5
+  // level sits a third and a half of the way down the ramps
+  Eigen::ArrayXXd field = Eigen::ArrayXXd::Zero(8, 20);
+  for (int i = 2; i < 6; ++i) {
+    field(i, 3) = 0.375;
+    field(i, 4) = field(i, 5) = field(i, 6) = 0.75;
+    field(i, 7) = 0.25;
+    field(i, 12) = field(i, 13) = 1.0;
+  }
+  EdgeMap edges = EdgeMap::extract(field, 0.5);
+  const auto& crossings = edges.rowCrossings(3);
+  REQUIRE(crossings.size() == 4);
+  REQUIRE(std::abs(crossings[0].position - (3.0 + 1.0 / 3.0)) < 1e-12);
+  REQUIRE(std::abs(crossings[1].position - 6.5) < 1e-12);
+  REQUIRE(crossings[0].rising);
+  REQUIRE(!crossings[1].rising);
+
+  auto runs = edges.rowRuns();
+  REQUIRE(runs.size() == 8);
+  REQUIRE(std::abs(runs[0].width() - (3.5 - 1.0 / 3.0)) < 1e-12);
+  REQUIRE(std::abs(runs[1].width() - 2.0) < 1e-12);
+  auto gaps = edges.rowGaps();
+  REQUIRE(gaps.size() == 4);
+  REQUIRE(std::abs(gaps[0].width() - 5.0) < 1e-12);
+  REQUIRE(edges.colRuns().size() == 5);
+
+  // The outlines close and run one way: every segment end starts one
+  // segment and ends another, and the inside is on their left
+  std::map<std::pair<long, long>, int> ends;
+  double area = 0.0;
+  for (const auto& segment : edges.segments()) {
+    ++ends[{std::lround(segment.from.row * 1e6), std::lround(segment.from.col * 1e6)}];
+    --ends[{std::lround(segment.to.row * 1e6), std::lround(segment.to.col * 1e6)}];
+    area += 0.5 * (segment.from.row * segment.to.col - segment.to.row * segment.from.col);
+  }
+  REQUIRE(!ends.empty());
+  REQUIRE(std::all_of(ends.begin(), ends.end(), [](const auto& end) { return end.second == 0; }));
+  REQUIRE(area > 0.0);
+
+  // A mask's edges fall midway between set and clear cells
+  EdgeMap outline = EdgeMap::extract(BitMask::fromField(field, 0.5));
+  REQUIRE(outline.rowRuns().size() == 8);
+  REQUIRE(std::abs(outline.rowRuns()[0].width() - 3.0) < 1e-12);
+  REQUIRE(std::abs(outline.rowCrossings(2)[0].position - 3.5) < 1e-12);
+}
+
+TEST_CASE("Point grid finds neighbours and clusters by density", "[Geometry]") {
+  // Two dense blobs, a line of points a little under eps apart, and one
+  // far-off point
+  std::vector<PointGrid::Point> points;
+  for (int k = 0; k < 30; ++k) {
+    points.push_back({10.0 + 0.1 * (k % 6), 10.0 + 0.1 * (k / 6)});
+    points.push_back({-40.0 + 0.1 * (k % 5), 25.0 + 0.1 * (k / 5)});
+  }
+  for (int k = 0; k < 20; ++k) {
+    points.push_back({-20.0 + 0.9 * k, -30.0});
+  }
+  points.push_back({100.0, 100.0});
+  const PointGrid grid(points, 1.0);
+  REQUIRE(grid.size() == points.size());
+
+  std::vector<int> near;
+  grid.forEachWithin(10.0, 10.0, 0.15, [&near](int k) { near.push_back(k); });
+  std::sort(near.begin(), near.end());
+  REQUIRE(near == std::vector<int>{0, 2, 12, 14});
+
+  const std::vector<int> labels = grid.cluster(1.0, 3);
+  REQUIRE(labels[0] == 0);
+  REQUIRE(labels[1] == 1);
+  for (int k = 0; k < 30; ++k) {
+    REQUIRE(labels[2 * k] == 0);
+    REQUIRE(labels[2 * k + 1] == 1);
+  }
+  for (int k = 0; k < 20; ++k) {
+    REQUIRE(labels[60 + k] == 2);
+  }
+  REQUIRE(labels.back() == -1);
+  REQUIRE_THROWS_AS(PointGrid(points, 0.0), std::invalid_argument);
+}
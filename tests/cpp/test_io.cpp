@@ -0,0 +1,467 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/chunked_text_writer.hpp"
+#include "../../src/cpp/core/result_store.hpp"
+#include "../../src/cpp/core/task_scheduler.hpp"
+#include "../../src/cpp/core/json_value.hpp"
+#include "../../src/cpp/core/wafer_enhanced.hpp"
+#include "../../src/cpp/integration/gds_library.hpp"
+#include "../../src/cpp/core/field_stream_writer.hpp"
+#include "../../src/cpp/core/field_volume.hpp"
+#include "../../src/cpp/core/iso_mesh.hpp"
+#include "../../src/cpp/core/keyframe_store.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <zlib.h>
+#include <unistd.h>
+
+namespace {
+
+// GDSII records, big-endian, in the database units' integer form
+void gdsRecord(std::vector<unsigned char>& out, unsigned char type, unsigned char datatype,
+               const std::vector<unsigned char>& payload = {}) {
+  const std::size_t length = 4 + payload.size();
+  out.insert(out.end(), {static_cast<unsigned char>(length >> 8), static_cast<unsigned char>(length), type, datatype});
+  out.insert(out.end(), payload.begin(), payload.end());
+}
+
+std::vector<unsigned char> gdsInt16(int value) {
+  return {static_cast<unsigned char>(value >> 8), static_cast<unsigned char>(value)};
+}
+
+std::vector<unsigned char> gdsPoints(const std::vector<std::pair<std::int32_t, std::int32_t>>& points) {
+  std::vector<unsigned char> bytes;
+  for (const auto& p : points) {
+    for (std::int32_t v : {p.first, p.second}) {
+      const auto u = static_cast<std::uint32_t>(v);
+      bytes.insert(bytes.end(), {static_cast<unsigned char>(u >> 24), static_cast<unsigned char>(u >> 16),
+                                 static_cast<unsigned char>(u >> 8), static_cast<unsigned char>(u)});
+    }
+  }
+  return bytes;
+}
+
+std::vector<unsigned char> gdsName(const std::string& name) {
+  std::vector<unsigned char> bytes(name.begin(), name.end());
+  if (bytes.size() % 2) {
+    bytes.push_back(0);
+  }
+  return bytes;
+}
+
+// Rectangle corners in nm, the default database unit
+void gdsBoundary(std::vector<unsigned char>& out, int layer, std::int32_t x0, std::int32_t y0, std::int32_t x1,
+                 std::int32_t y1) {
+  gdsRecord(out, 0x08, 0x00);
+  gdsRecord(out, 0x0D, 0x02, gdsInt16(layer));
+  gdsRecord(out, 0x0E, 0x02, gdsInt16(0));
+  gdsRecord(out, 0x10, 0x03, gdsPoints({{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}, {x0, y0}}));
+  gdsRecord(out, 0x11, 0x00);
+}
+
+void gdsReference(std::vector<unsigned char>& out, const std::string& cell, std::int32_t x, std::int32_t y) {
+  gdsRecord(out, 0x0A, 0x00);
+  gdsRecord(out, 0x12, 0x06, gdsName(cell));
+  gdsRecord(out, 0x10, 0x03, gdsPoints({{x, y}}));
+  gdsRecord(out, 0x11, 0x00);
+}
+
+// Gathers a streamed mesh, checking that chunks keep to their contract
+struct MeshCollector : MeshSink {
+  std::vector<std::array<float, 3>> vertices;
+  std::vector<std::array<uint32_t, 3>> triangles;
+  uint64_t previous_first = 0;
+  bool finished = false;
+  void add(const MeshChunk& chunk) override {
+    REQUIRE(chunk.first_vertex == vertices.size());
+    for (const auto& triangle : chunk.triangles) {
+      for (uint32_t index : triangle) {
+        REQUIRE(index >= previous_first);
+        REQUIRE(index < chunk.first_vertex + chunk.vertices.size());
+      }
+    }
+    previous_first = chunk.first_vertex;
+    vertices.insert(vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+    triangles.insert(triangles.end(), chunk.triangles.begin(), chunk.triangles.end());
+  }
+  void finish() override { finished = true; }
+
+  // Every edge runs once each way when the surface is closed and
+  // consistently oriented
+  bool closed() const {
+    std::map<std::pair<uint32_t, uint32_t>, int> edges;
+    for (const auto& t : triangles) {
+      for (int e = 0; e < 3; ++e) {
+        ++edges[{t[e], t[(e + 1) % 3]}];
+      }
+    }
+    for (const auto& edge : edges) {
+      const auto reverse = edges.find({edge.first.second, edge.first.first});
+      if (edge.second != 1 || reverse == edges.end() || reverse->second != 1) {
+        return false;
+      }
+    }
+    return true;
+  }
+  double volume() const {
+    double sum = 0.0;
+    for (const auto& t : triangles) {
+      const auto& a = vertices[t[0]];
+      const auto& b = vertices[t[1]];
+      const auto& c = vertices[t[2]];
+      sum += a[0] * (b[1] * c[2] - b[2] * c[1]) - a[1] * (b[0] * c[2] - b[2] * c[0]) +
+             a[2] * (b[0] * c[1] - b[1] * c[0]);
+    }
+    return sum / 6.0;
+  }
+};
+
+} // namespace
+
+TEST_CASE("Chunked text writer formats records in parallel and keeps their order", "[IO]") {
+  TextBuffer numbers;
+  numbers << 0.25 << ' ' << 1e-7 << ' ' << 3.0 << ' ' << -42 << ' ' << std::size_t(7) << ' ' << "C" << std::string("1");
+  REQUIRE(numbers.str() == "0.25 1e-07 3 -42 7 C1");
+
+  const auto record = [](std::size_t i, TextBuffer& out) {
+    out << "C" << i << " n" << i % 97 << " 0 " << 1e-15 * static_cast<double>(i) << "\n";
+  };
+  std::string expected = "* header\n";
+  for (std::size_t i = 0; i < 50000; ++i) {
+    TextBuffer line;
+    record(i, line);
+    expected += line.str();
+  }
+  expected += ".end\n";
+
+  const std::string base =
+      (std::filesystem::temp_directory_path() / ("semipro-text-" + std::to_string(::getpid()))).string();
+  for (const std::string& path : {base + ".sp", base + ".sp.gz"}) {
+    ChunkedTextWriter::Options options;
+    options.chunk_records = 1000;
+    ChunkedTextWriter writer(path, options);
+    REQUIRE(writer.gzipped() == (path.back() == 'z'));
+    writer.write("* header\n");
+    writer.writeRecords(50000, record);
+    writer.write(".end\n");
+    writer.close();
+    writer.close();
+    REQUIRE(writer.bytesWritten() == expected.size());
+
+    // gzread passes plain files through as they are
+    std::string text;
+    gzFile file = gzopen(path.c_str(), "rb");
+    REQUIRE(file != nullptr);
+    char buffer[1 << 16];
+    int got;
+    while ((got = gzread(file, buffer, sizeof(buffer))) > 0) {
+      text.append(buffer, got);
+    }
+    gzclose(file);
+    REQUIRE(text == expected);
+    if (writer.gzipped()) {
+      REQUIRE(std::filesystem::file_size(path) < expected.size() / 2);
+    }
+    std::remove(path.c_str());
+  }
+  REQUIRE_THROWS_AS(ChunkedTextWriter("/nonexistent-directory/out.sp"), std::runtime_error);
+}
+
+TEST_CASE("Result store appends record batches from many threads as npy columns", "[IO]") {
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / ("semipro-results-" + std::to_string(::getpid()));
+  ResultStore::Options options;
+  options.batch_records = 16;
+  {
+    ResultStore store(path.string(), options);
+    TaskScheduler::getInstance().parallelFor(0, 100, [&](int begin, int end) {
+      for (int i = begin; i < end; ++i) {
+        ResultRecord record("optimizer", "oxidation", i % 10 != 0, 0.5);
+        record.add("parameter", "temperature", 900.0 + i);
+        record.add("objective", "yield", i * 0.01);
+        store.append(record);
+      }
+    }, 1);
+    REQUIRE(store.recordCount() == 100);
+    REQUIRE(store.recordsWritten() % 16 == 0);
+    store.close();
+    REQUIRE(store.recordsWritten() == 100);
+    REQUIRE(store.valuesWritten() == 200);
+    REQUIRE_THROWS_AS(store.append(ResultRecord("optimizer", "oxidation")), std::runtime_error);
+  }
+
+  const SemiPRO::JsonValue schema = SemiPRO::JsonValue::parseFile((path / "schema.json").string());
+  REQUIRE(schema["tables"]["records"]["rows"].asNumber() == 100);
+  REQUIRE(schema["tables"]["values"]["rows"].asNumber() == 200);
+  REQUIRE(schema["dictionaries"]["name"].size() == 2);
+  REQUIRE(schema["dictionaries"]["source"].items().front().asString() == "optimizer");
+
+  std::ifstream ok_file(path / "records" / "ok.npy", std::ios::binary);
+  const std::string ok((std::istreambuf_iterator<char>(ok_file)), std::istreambuf_iterator<char>());
+  REQUIRE(ok.size() == 128 + 100);
+  REQUIRE(ok.compare(0, 6, "\x93NUMPY") == 0);
+  REQUIRE(ok.find("'shape': (100,)") != std::string::npos);
+  REQUIRE(std::count(ok.begin() + 128, ok.end(), '\0') == 10);
+
+  // A record's values land in its batch, next to each other
+  std::ifstream record_file(path / "values" / "record.npy", std::ios::binary);
+  record_file.seekg(128);
+  std::vector<std::int64_t> owners(200);
+  record_file.read(reinterpret_cast<char*>(owners.data()), 200 * sizeof(std::int64_t));
+  REQUIRE(record_file);
+  std::vector<std::int64_t> ids;
+  for (std::size_t v = 0; v < owners.size(); v += 2) {
+    REQUIRE(owners[v] == owners[v + 1]);
+    ids.push_back(owners[v]);
+  }
+  std::sort(ids.begin(), ids.end());
+  for (std::int64_t i = 0; i < 100; ++i) {
+    REQUIRE(ids[i] == i);
+  }
+
+  std::filesystem::remove_all(path);
+  std::filesystem::create_directories(path);
+  REQUIRE_THROWS_AS(ResultStore(path.string()), std::runtime_error);
+  std::filesystem::remove_all(path);
+}
+
+TEST_CASE("Wafer state history keeps every step, compressed and through a file", "[IO]") {
+  auto wafer = std::make_shared<WaferEnhanced>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(48, 32);
+  wafer->enableStateHistory(true, 4);
+  // Each step warms a band of rows and leaves the rest as it was
+  Eigen::ArrayXXd temperature = Eigen::ArrayXXd::Constant(48, 32, 300.0);
+  std::vector<std::vector<unsigned char>> images;
+  for (int step = 0; step < 10; ++step) {
+    for (int i = 4 * step; i < 4 * step + 4; ++i) {
+      for (int j = 0; j < 32; ++j) {
+        temperature(i, j) += 10.0 + std::sin(0.2 * i * j);
+      }
+    }
+    wafer->setTemperatureField(temperature);
+    if (step % 3 == 0) {
+      wafer->addLayer("oxide", 0.01 * (step + 1));
+    }
+    wafer->recordProcessStep(WaferEnhanced::ProcessStep(step % 3 == 0 ? "oxidation" : "annealing"));
+    images.push_back(wafer->stateImage());
+  }
+
+  REQUIRE(wafer->getStateHistorySize() == 10);
+  const StateHistory* history = wafer->getStateHistory();
+  REQUIRE(history->rawBytes() > 4 * history->storedBytes());
+  for (std::size_t step : {0, 3, 5, 9}) {
+    REQUIRE(wafer->getStateAfterStep(step)->stateImage() == images[step]);
+  }
+  REQUIRE_THROWS_AS(wafer->getStateAfterStep(10), std::out_of_range);
+
+  const std::string path =
+      (std::filesystem::temp_directory_path() / ("semipro-history-" + std::to_string(::getpid()) + ".wafer")).string();
+  wafer->saveToFile(path);
+  auto loaded = std::make_shared<WaferEnhanced>(300.0, 775.0, "silicon");
+  loaded->loadFromFile(path);
+  std::remove(path.c_str());
+  REQUIRE(loaded->getStateHistorySize() == 10);
+  for (std::size_t step = 0; step < images.size(); ++step) {
+    REQUIRE(loaded->getStateAfterStep(step)->stateImage() == images[step]);
+  }
+}
+
+TEST_CASE("GDS layouts flatten and rasterize only the window asked for", "[IO]") {
+  // A 1 um via cell placed near the origin and far away, under a metal bar
+  std::vector<unsigned char> stream;
+  gdsRecord(stream, 0x00, 0x02, gdsInt16(600));
+  gdsRecord(stream, 0x02, 0x06, gdsName("LIB"));
+  gdsRecord(stream, 0x05, 0x02, std::vector<unsigned char>(24, 0));
+  gdsRecord(stream, 0x06, 0x06, gdsName("VIA"));
+  gdsBoundary(stream, 2, 0, 0, 1000, 1000);
+  gdsRecord(stream, 0x07, 0x00);
+  gdsRecord(stream, 0x05, 0x02, std::vector<unsigned char>(24, 0));
+  gdsRecord(stream, 0x06, 0x06, gdsName("TOP"));
+  gdsBoundary(stream, 1, 0, 0, 10000, 2000);
+  gdsReference(stream, "VIA", 5000, 5000);
+  gdsReference(stream, "VIA", 100000, 100000);
+  gdsRecord(stream, 0x07, 0x00);
+  gdsRecord(stream, 0x04, 0x00);
+
+  const std::string path =
+      (std::filesystem::temp_directory_path() / ("semipro-layout-" + std::to_string(::getpid()) + ".gds.gz")).string();
+  gzFile file = gzopen(path.c_str(), "wb");
+  REQUIRE(file != nullptr);
+  REQUIRE(gzwrite(file, stream.data(), static_cast<unsigned>(stream.size())) == static_cast<int>(stream.size()));
+  gzclose(file);
+  const auto library = SemiPRO::GDSLibrary::read(path);
+  std::remove(path.c_str());
+
+  REQUIRE(library.name() == "LIB");
+  REQUIRE(library.structures().size() == 2);
+  REQUIRE(library.topStructure() == library.findStructure("TOP"));
+  const SemiPRO::LayoutWindow window{0.0, 0.0, 10.0, 10.0};
+  const auto vias = library.flatten(2, window);
+  REQUIRE(vias.size() == 1);
+  for (const auto& point : vias[0].points) {
+    REQUIRE(point.first >= 5.0 - 1e-9);
+    REQUIRE(point.first <= 6.0 + 1e-9);
+    REQUIRE(point.second >= 5.0 - 1e-9);
+    REQUIRE(point.second <= 6.0 + 1e-9);
+  }
+  REQUIRE(library.flatten(2, {0.0, 0.0, 200.0, 200.0}).size() == 2);
+  REQUIRE(library.flatten(2, {20.0, 20.0, 50.0, 50.0}).empty());
+
+  // One cell per um, rows along x
+  const BitMask via_mask = SemiPRO::rasterizeLayout(vias, window, 10, 10);
+  REQUIRE(via_mask.count() == 1);
+  REQUIRE(via_mask.test(5, 5));
+  const BitMask metal = SemiPRO::rasterizeLayout(library.flatten(1, window), window, 10, 10);
+  REQUIRE(metal.count() == 20);
+  REQUIRE(metal.test(9, 1));
+  REQUIRE_FALSE(metal.test(0, 2));
+  const BitMask block = SemiPRO::rasterizeLayout(vias, window, 10, 10, 4, 4, 4, 4);
+  REQUIRE(block.count() == 1);
+  REQUIRE(block.test(1, 1));
+
+  stream.resize(stream.size() - 4);
+  REQUIRE_THROWS_AS(SemiPRO::GDSLibrary::parse(stream), std::runtime_error);
+}
+
+TEST_CASE("Streamed Zarr frames keep each step's fields", "[IO]") {
+  const std::string path = "test_io_stream.zarr";
+  Wafer wafer(300.0, 775.0, "silicon");
+  wafer.initializeGrid(10, 7);
+  wafer.getGrid() = Eigen::ArrayXXd::Random(10, 7);
+  const Eigen::ArrayXXd first = wafer.getGrid();
+
+  FieldStreamWriter::Options options;
+  options.chunk_rows = 4;
+  options.chunk_cols = 3;
+  options.queue_bytes = 1; // Every append waits for the previous frame
+  {
+    FieldStreamWriter writer(path, {"grid", "temperature_profile"}, options);
+    writer.append(wafer, 0.0);
+    wafer.getGrid() += 1.0; // Detaches the queued snapshot
+    writer.append(wafer, 0.5);
+    REQUIRE_THROWS_AS(writer.append(Wafer(300.0, 775.0, "silicon").getFieldStore(), 1.0),
+                      std::invalid_argument);
+    writer.flush();
+    REQUIRE(writer.framesWritten() == 2);
+    Wafer resized(300.0, 775.0, "silicon");
+    resized.initializeGrid(3, 3);
+    REQUIRE_THROWS_AS(writer.append(resized, 1.0), std::invalid_argument);
+    writer.close();
+    REQUIRE(writer.bytesWritten() > 0);
+  }
+
+  std::ifstream meta(path + "/grid/.zarray");
+  std::string zarray((std::istreambuf_iterator<char>(meta)), std::istreambuf_iterator<char>());
+  REQUIRE(zarray.find("\"shape\": [2, 10, 7]") != std::string::npos);
+  REQUIRE(zarray.find("\"chunks\": [1, 4, 3]") != std::string::npos);
+
+  // Edge chunk (rows 8-9, column 6) of the first frame, padded to 4 x 3
+  std::ifstream in(path + "/grid/0.2.2", std::ios::binary);
+  std::vector<unsigned char> packed((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::vector<double> tile(12);
+  uLongf size = tile.size() * sizeof(double);
+  REQUIRE(uncompress(reinterpret_cast<Bytef*>(tile.data()), &size, packed.data(), packed.size()) == Z_OK);
+  REQUIRE(tile[0] == first(8, 6));
+  REQUIRE(tile[1] == first(9, 6));
+  REQUIRE(tile[2] == 0.0);
+  REQUIRE(std::filesystem::exists(path + "/grid/1.0.0"));
+  REQUIRE(std::filesystem::exists(path + "/time/0"));
+
+  std::filesystem::remove_all(path);
+  REQUIRE_THROWS_AS(FieldStreamWriter(path, {"time"}), std::invalid_argument);
+}
+
+TEST_CASE("Isosurfaces stream out closed welded meshes", "[IO]") {
+  // A ball cut by the grid's faces, meshed over several slabs
+  FieldVolume ball(14, 14, 14);
+  for (int s = 0; s < 14; ++s) {
+    for (int c = 0; c < 14; ++c) {
+      for (int r = 0; r < 14; ++r) {
+        ball(r, c, s) = 6.0f - std::sqrt(float((r - 6.5) * (r - 6.5) + (c - 6.5) * (c - 6.5) + (s - 4.0) * (s - 4.0)));
+      }
+    }
+  }
+  IsoMesher::Options options;
+  options.slab_slices = 3;
+  MeshCollector mesh;
+  const IsoMesher::Stats stats = IsoMesher(options).extract(ball, 0.0f, mesh);
+  REQUIRE(mesh.finished);
+  REQUIRE(stats.vertices == mesh.vertices.size());
+  REQUIRE(stats.triangles == mesh.triangles.size());
+  REQUIRE(mesh.closed());
+  // A ball of radius 6 less the cap of height 2 cut off at slice 0
+  const double expected = M_PI * (4.0 / 3.0 * 216.0 - 4.0 * (18.0 - 2.0) / 3.0);
+  REQUIRE(std::abs(mesh.volume() - expected) < 0.03 * expected);
+
+  // A flat height map is a box
+  MeshCollector box;
+  meshHeightField(Eigen::ArrayXXd::Constant(4, 3, 2.0), 0.5f, 1.0f, box);
+  REQUIRE(box.closed());
+  REQUIRE(std::abs(box.volume() - 1.5 * 2.0 * 2.0) < 1e-4);
+
+  const std::string stl = "test_io_mesh.stl", ply = "test_io_mesh.PLY";
+  const IsoMesher::Stats written = meshHeightField(Eigen::ArrayXXd::Constant(4, 3, 2.0), 0.5f, 1.0f, *openMeshWriter(stl));
+  REQUIRE(std::filesystem::file_size(stl) == 84 + 50 * written.triangles);
+  meshHeightField(Eigen::ArrayXXd::Constant(4, 3, 2.0), 0.5f, 1.0f, *openMeshWriter(ply));
+  std::ifstream in(ply, std::ios::binary);
+  std::string line, header;
+  while (std::getline(in, line) && line != "end_header") {
+    header += line + "\n";
+  }
+  REQUIRE(header.find("element vertex " + std::string(20 - std::to_string(written.vertices).size(), '0') +
+                      std::to_string(written.vertices)) != std::string::npos);
+  const auto body = std::filesystem::file_size(ply) - static_cast<uint64_t>(in.tellg());
+  REQUIRE(body == 12 * written.vertices + 13 * written.triangles);
+  REQUIRE(!std::filesystem::exists(ply + ".faces"));
+  in.close();
+  std::remove(stl.c_str());
+  std::remove(ply.c_str());
+  REQUIRE_THROWS_AS(openMeshWriter("mesh.obj"), std::invalid_argument);
+  REQUIRE_THROWS_AS(meshHeightField(Eigen::ArrayXXd::Zero(2, 2), 1.0f, 1.0f, box), std::invalid_argument);
+}
+
+TEST_CASE("Keyframes stream to disk and blend on playback", "[IO]") {
+  const std::string path = "test_io_keyframes.skf";
+  Wafer wafer(300.0, 775.0, "silicon");
+  wafer.initializeGrid(6, 4);
+  {
+    KeyframeWriter out(path);
+    for (int i = 0; i < 3; ++i) {
+      wafer.getGrid().setConstant(10.0 * i);
+      out.append(wafer, 2.0 * i, "step " + std::to_string(i));
+    }
+    REQUIRE_THROWS_AS(out.append(wafer, 1.0), std::invalid_argument);
+    out.finish();
+  }
+
+  KeyframeReader in(path);
+  REQUIRE(in.size() == 3);
+  REQUIRE(in.time(2) == 4.0);
+  REQUIRE(in.description(1) == "step 1");
+  REQUIRE(in.channel(1, "grid").rows() == 6);
+  REQUIRE((in.channel(2, "grid") == 20.0).all());
+  REQUIRE(in.frameAt(-1.0) == 0);
+  REQUIRE(in.frameAt(3.0) == 1);
+  REQUIRE(in.frameAt(9.0) == 2);
+  in.prefetch(0, 3);
+
+  Eigen::ArrayXXd grid;
+  in.sample(3.0, "grid", grid);
+  REQUIRE((grid == 15.0).all());
+  in.sample(9.0, "grid", grid);
+  REQUIRE((grid == 20.0).all());
+  REQUIRE_THROWS_AS(in.channel(0, "missing"), std::invalid_argument);
+  REQUIRE_THROWS_AS(in.channel(3, "grid"), std::out_of_range);
+  std::remove(path.c_str());
+}
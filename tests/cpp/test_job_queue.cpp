@@ -0,0 +1,149 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/job_queue.hpp"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+
+SemiPRO::JobTicket makeJob(const std::string& id, const std::string& tenant, int priority = 0,
+                           size_t memory = 0) {
+  SemiPRO::JobTicket job;
+  job.id = id;
+  job.tenant = tenant;
+  job.priority = priority;
+  job.memory_estimate = memory;
+  return job;
+}
+
+SemiPRO::JobQueue::Limits roomyLimits() {
+  SemiPRO::JobQueue::Limits limits;
+  limits.max_running = 16;
+  limits.memory_budget = size_t(1) << 40;
+  return limits;
+}
+
+// Ids of the jobs the queue starts, in order, while any may start
+std::vector<std::string> drain(SemiPRO::JobQueue& queue) {
+  std::vector<std::string> started;
+  SemiPRO::JobTicket job;
+  while (queue.acquireFor(job, std::chrono::milliseconds(0))) {
+    started.push_back(job.id);
+  }
+  return started;
+}
+
+} // namespace
+
+TEST_CASE("Job queue starts by priority, then the least busy tenant", "[JobQueue]") {
+  SemiPRO::JobQueue queue(roomyLimits());
+  const auto now = std::chrono::steady_clock::now();
+  REQUIRE(queue.submit(makeJob("a1", "alice")) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(makeJob("a2", "alice")) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(makeJob("a3", "alice")) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(makeJob("b1", "bob")) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(makeJob("urgent", "alice", 5)) == SemiPRO::JobAdmission::ACCEPTED);
+  auto soon = makeJob("b2", "bob");
+  soon.deadline = now + std::chrono::hours(1);
+  REQUIRE(queue.submit(soon) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.queuedCount() == 6);
+  REQUIRE(queue.tenantCount() == 2);
+
+  // The higher priority goes first whoever submitted it; after that bob,
+  // with nothing running, goes before alice, his nearer deadline before
+  // his earlier submission, and each tenant's jobs in submission order
+  const std::vector<std::string> expected = {"urgent", "b2", "a1", "b1", "a2", "a3"};
+  REQUIRE(drain(queue) == expected);
+  REQUIRE(queue.queuedCount() == 0);
+  REQUIRE(queue.runningCount() == 6);
+
+  // Tenants stay while they have jobs running
+  for (const auto& id : expected) {
+    queue.finish(makeJob(id, id[0] == 'b' ? "bob" : "alice"));
+  }
+  REQUIRE(queue.runningCount() == 0);
+  REQUIRE(queue.tenantCount() == 0);
+}
+
+TEST_CASE("Job queue turns work away at the tenant and queue limits", "[JobQueue]") {
+  auto limits = roomyLimits();
+  limits.capacity = 3;
+  limits.tenant_capacity = 2;
+  SemiPRO::JobQueue queue(limits);
+
+  REQUIRE(queue.submit(makeJob("a1", "alice")) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(makeJob("a2", "alice")) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(makeJob("a3", "alice")) == SemiPRO::JobAdmission::TENANT_LIMIT);
+  REQUIRE(queue.submit(makeJob("b1", "bob")) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(makeJob("c1", "carol")) == SemiPRO::JobAdmission::QUEUE_FULL);
+  REQUIRE(queue.queuedCount() == 3);
+
+  // Starting a job frees its place in both limits
+  SemiPRO::JobTicket job;
+  REQUIRE(queue.acquireFor(job, std::chrono::milliseconds(0)));
+  REQUIRE(job.id == "a1");
+  REQUIRE(queue.submit(makeJob("a3", "alice")) == SemiPRO::JobAdmission::ACCEPTED);
+
+  queue.close();
+  REQUIRE(queue.submit(makeJob("c1", "carol")) == SemiPRO::JobAdmission::CLOSED);
+  // Closed queues still hand out what they hold, then report the end
+  REQUIRE(drain(queue) == std::vector<std::string>{"b1", "a2", "a3"});
+  REQUIRE(!queue.acquire(job));
+}
+
+TEST_CASE("Job queue holds the next job until its memory fits the budget", "[JobQueue]") {
+  auto limits = roomyLimits();
+  limits.memory_budget = 1000;
+  SemiPRO::JobQueue queue(limits);
+
+  REQUIRE(queue.submit(makeJob("huge", "alice", 0, 1500)) == SemiPRO::JobAdmission::INSUFFICIENT_MEMORY);
+  REQUIRE(queue.submit(makeJob("big1", "alice", 0, 700)) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(makeJob("big2", "alice", 0, 600)) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(makeJob("small", "alice", 0, 100)) == SemiPRO::JobAdmission::ACCEPTED);
+
+  SemiPRO::JobTicket first;
+  REQUIRE(queue.acquireFor(first, std::chrono::milliseconds(0)));
+  REQUIRE(first.id == "big1");
+
+  // big2 does not fit next to big1 and the small job behind it must not
+  // overtake it
+  SemiPRO::JobTicket job;
+  REQUIRE(!queue.acquireFor(job, std::chrono::milliseconds(20)));
+  REQUIRE(queue.runningCount() == 1);
+  REQUIRE(queue.queuedCount() == 2);
+
+  queue.finish(first);
+  REQUIRE(drain(queue) == std::vector<std::string>{"big2", "small"});
+  REQUIRE(queue.runningCount() == 2);
+}
+
+TEST_CASE("Job queue drops expired and cancelled jobs with their idle tenants", "[JobQueue]") {
+  SemiPRO::JobQueue queue(roomyLimits());
+  const auto now = std::chrono::steady_clock::now();
+  auto late = makeJob("late", "alice");
+  late.deadline = now - std::chrono::milliseconds(1);
+  auto stale = makeJob("stale", "bob");
+  stale.deadline = now - std::chrono::milliseconds(1);
+  REQUIRE(queue.submit(late) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(stale) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(makeJob("kept", "bob")) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.tenantCount() == 2);
+
+  REQUIRE(drain(queue) == std::vector<std::string>{"kept"});
+  auto expired = queue.takeExpired();
+  REQUIRE(expired.size() == 2);
+  REQUIRE(queue.takeExpired().empty());
+  // alice had only the expired job; bob still has one running
+  REQUIRE(queue.tenantCount() == 1);
+  queue.finish(makeJob("kept", "bob"));
+  REQUIRE(queue.tenantCount() == 0);
+
+  REQUIRE(queue.submit(makeJob("c1", "carol")) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.submit(makeJob("c2", "carol")) == SemiPRO::JobAdmission::ACCEPTED);
+  REQUIRE(queue.cancel("c1"));
+  REQUIRE(!queue.cancel("c1"));
+  REQUIRE(queue.tenantCount() == 1);
+  REQUIRE(queue.cancel("c2"));
+  REQUIRE(queue.queuedCount() == 0);
+  REQUIRE(queue.tenantCount() == 0);
+}
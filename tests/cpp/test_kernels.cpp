@@ -0,0 +1,215 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/kernel_status.hpp"
+#include "../../src/cpp/core/gpu_compute.hpp"
+#include "../../src/cpp/core/fft.hpp"
+#include "../../src/cpp/core/multigrid.hpp"
+#include "../../src/cpp/core/autotuner.hpp"
+#include "../../src/cpp/core/stencil.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+TEST_CASE("Kernel statuses name the first failed check and faults stay per thread", "[Kernels]") {
+  Eigen::ArrayXd temperature(4), time(4);
+  temperature << 900.0, 1500.0, 1500.0, 1000.0;
+  time << 1.0, -1.0, 1.0, -1.0;
+  std::vector<KernelStatus> status(4, KernelStatus::Ok);
+  markFailed(status, temperature <= 1200.0, KernelStatus::TemperatureOutOfRange);
+  markFailed(status, time > 0.0, KernelStatus::TimeOutOfRange);
+  REQUIRE(status == std::vector<KernelStatus>{KernelStatus::Ok, KernelStatus::TemperatureOutOfRange,
+                                              KernelStatus::TemperatureOutOfRange, KernelStatus::TimeOutOfRange});
+  const Eigen::Array<bool, Eigen::Dynamic, 1> ok = statusOk(status);
+  REQUIRE(ok[0]);
+  REQUIRE(ok.count() == 1);
+  REQUIRE(std::string(kernelStatusMessage(KernelStatus::MissingWafer)) == "wafer not registered");
+
+  std::vector<KernelFaults::Fault> faults;
+  REQUIRE(KernelFaults::take(faults) == 0);
+  REQUIRE(faults.empty());
+  KernelFaults::record(KernelStatus::TimeOutOfRange, 3);
+  std::size_t other_dropped = 0;
+  std::vector<KernelFaults::Fault> other;
+  std::thread([&] {
+    for (std::uint32_t i = 0; i < KernelFaults::kCapacity + 5; ++i) {
+      KernelFaults::record(KernelStatus::NonFinite, i);
+    }
+    other_dropped = KernelFaults::take(other);
+  }).join();
+  REQUIRE(other.size() == KernelFaults::kCapacity);
+  REQUIRE(other_dropped == 5);
+  REQUIRE(KernelFaults::take(faults) == 0);
+  REQUIRE(faults.size() == 1);
+  REQUIRE(faults[0].status == KernelStatus::TimeOutOfRange);
+  REQUIRE(faults[0].entry == 3);
+  faults.clear();
+  REQUIRE(KernelFaults::take(faults) == 0);
+  REQUIRE(faults.empty());
+}
+
+TEST_CASE("Wafer grid kernels run on the active GPU device and fall back without one", "[Kernels]") {
+  // A stand-in device that runs the CPU kernels and counts its calls
+  struct CountingDevice : GpuCompute {
+    struct CountingSmoother : Smoother {
+      Eigen::ArrayXXd west, north, inverse_diagonal, source;
+      int* calls = nullptr;
+      bool smooth(Eigen::ArrayXXd& u, const Eigen::ArrayXXd* f, int sweeps, bool reverse) override {
+        if (f) {
+          source = *f;
+        }
+        ++*calls;
+        const auto sweep = [&](int colour) {
+          for (Eigen::Index j = 1; j + 1 < u.cols(); ++j) {
+            for (Eigen::Index i = 2 - ((j + colour) & 1); i + 1 < u.rows(); i += 2) {
+              u(i, j) = (source(i, j) + west(i, j) * u(i, j - 1) + west(i, j + 1) * u(i, j + 1) +
+                         north(i, j) * u(i - 1, j) + north(i + 1, j) * u(i + 1, j)) *
+                        inverse_diagonal(i, j);
+            }
+          }
+        };
+        for (int s = 0; s < sweeps; ++s) {
+          sweep(reverse ? 1 : 0);
+          sweep(reverse ? 0 : 1);
+        }
+        return true;
+      }
+    };
+
+    int transforms = 0;
+    int smooths = 0;
+    std::string deviceName() const override { return "counting"; }
+    bool transform(Complex* data, int rows, int cols, bool inverse) override {
+      ++transforms;
+      Radix2Fft().transform(data, rows, cols, inverse);
+      return true;
+    }
+    bool diffuseExplicit(Eigen::ArrayXXd&, double, int) override { return false; }
+    std::unique_ptr<Smoother> smoother(const Eigen::ArrayXXd& west, const Eigen::ArrayXXd& north,
+                                       const Eigen::ArrayXXd& inverse_diagonal) override {
+      auto smoother = std::make_unique<CountingSmoother>();
+      smoother->west = west;
+      smoother->north = north;
+      smoother->inverse_diagonal = inverse_diagonal;
+      smoother->calls = &smooths;
+      return smoother;
+    }
+    bool countGaussianDepths(std::uint64_t, std::uint64_t, long, double, double, double,
+                             std::vector<std::uint64_t>&) override {
+      return false;
+    }
+  };
+
+  const int rows = 16, cols = 8;
+  std::vector<double> image(rows * cols);
+  for (int i = 0; i < rows * cols; ++i) {
+    image[i] = std::sin(0.37 * i) + 0.1 * (i % 5);
+  }
+  std::vector<FftBackend::Complex> expected(rows * (cols / 2 + 1)), spectrum(expected.size());
+  Radix2Fft().forward(image.data(), expected.data(), rows, cols);
+
+  Eigen::ArrayXXd conductivity = Eigen::ArrayXXd::Constant(34, 34, 1.0);
+  conductivity.block(10, 4, 12, 20) = 5.0;
+  MultigridSolver solver(conductivity);
+  Eigen::ArrayXXd source = Eigen::ArrayXXd::Zero(34, 34);
+  source.block(8, 8, 16, 16) = 1.0;
+  Eigen::ArrayXXd on_cpu = Eigen::ArrayXXd::Zero(34, 34);
+  solver.solve(on_cpu, source);
+
+  GpuFft fft;
+  auto device = std::make_shared<CountingDevice>();
+  Gpu::setActive(device);
+  fft.forward(image.data(), spectrum.data(), rows, cols);
+  std::vector<double> round_trip(rows * cols);
+  fft.inverse(spectrum.data(), round_trip.data(), rows, cols);
+  Eigen::ArrayXXd on_device = Eigen::ArrayXXd::Zero(34, 34);
+  solver.solve(on_device, source);
+  Gpu::setActive(nullptr);
+
+  REQUIRE(device->transforms == 2);
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    REQUIRE(std::abs(spectrum[i] - expected[i]) < 1e-12);
+  }
+  for (int i = 0; i < rows * cols; ++i) {
+    REQUIRE(std::abs(round_trip[i] - image[i]) < 1e-12);
+  }
+  // The finest level's sweeps went to the device, in the CPU's order
+  REQUIRE(device->smooths > 0);
+  REQUIRE((on_device == on_cpu).all());
+
+  // Without a device the backend is radix2's
+  fft.forward(image.data(), spectrum.data(), rows, cols);
+  REQUIRE(device->transforms == 2);
+  REQUIRE(spectrum == expected);
+}
+
+TEST_CASE("Autotuner keeps the fastest variant per machine and size class", "[Kernels]") {
+  using SemiPRO::Autotuner;
+  Autotuner& tuner = Autotuner::getInstance();
+  const std::string database =
+      (std::filesystem::temp_directory_path() / ("semipro-tuning-" + std::to_string(::getpid()) + ".json")).string();
+  std::remove(database.c_str());
+  tuner.clear();
+  tuner.setDatabasePath(database);
+
+  REQUIRE(Autotuner::sizeClass(1) == "2^0");
+  REQUIRE(Autotuner::sizeClass(300 * 200) == "2^15");
+  REQUIRE(Autotuner::sizeClass(1 << 16) == Autotuner::sizeClass((1 << 17) - 1));
+  REQUIRE_THROWS_AS(tuner.select("empty", 100, {}), std::invalid_argument);
+
+  // The slow variant, the one that throws and the first pick are all timed
+  // once; afterwards the choice is returned without running anything
+  int runs = 0;
+  const auto spin = [&runs](int iterations) {
+    return [&runs, iterations] {
+      ++runs;
+      volatile double sink = 0.0;
+      for (int i = 0; i < iterations; ++i) {
+        sink = sink + std::sqrt(static_cast<double>(i));
+      }
+    };
+  };
+  const std::vector<Autotuner::Variant> variants = {
+      {"slow", spin(2000000)}, {"broken", [] { throw std::runtime_error("no backend"); }}, {"fast", spin(1000)}};
+  tuner.setTrials(2);
+  REQUIRE(tuner.select("spin", 5000, variants) == "fast");
+  REQUIRE(runs == 4);
+  REQUIRE(tuner.select("spin", 7000, variants) == "fast");
+  REQUIRE(runs == 4);
+  REQUIRE(tuner.lookup("spin", 20000).empty());
+  const std::vector<Autotuner::Choice> choices = tuner.choices();
+  REQUIRE(choices.size() == 1);
+  REQUIRE(choices[0].kernel == "spin");
+  REQUIRE(choices[0].size_class == "2^12");
+  REQUIRE(choices[0].variant == "fast");
+
+  // The database outlives the process's choices, and explicit records win
+  tuner.record("spin", 20000, "slow");
+  tuner.clear();
+  REQUIRE(tuner.lookup("spin", 5000).empty());
+  tuner.setDatabasePath(database);
+  REQUIRE(tuner.lookup("spin", 5000) == "fast");
+  REQUIRE(tuner.lookup("spin", 20000) == "slow");
+
+  // Untuned stencil blocking on a large field is chosen and then reused,
+  // and gives the same field as any fixed blocking
+  Eigen::ArrayXXd field = Eigen::ArrayXXd::Random(300, 256);
+  Eigen::ArrayXXd fixed = field;
+  ExplicitStencil stencil(ExplicitStencil::diffusion(0.2));
+  stencil.apply(field.data(), 300, 256, 6);
+  REQUIRE(!tuner.lookup("stencil5", 300 * 256).empty());
+  ExplicitStencil blocked(ExplicitStencil::diffusion(0.2));
+  blocked.setBlocking(3, 100, 100);
+  blocked.apply(fixed.data(), 300, 256, 6);
+  REQUIRE((field - fixed).abs().maxCoeff() < 1e-12);
+
+  tuner.setDatabasePath("");
+  tuner.clear();
+  tuner.setTrials(3);
+  std::remove(database.c_str());
+}
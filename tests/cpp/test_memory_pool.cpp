@@ -0,0 +1,134 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/performance_utils.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+
+bool alignedTo(const void* ptr, size_t alignment) {
+  return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+}
+
+// Frees its block from a thread_local destructor. Constructed before the
+// pool's thread cache, so it is destroyed after the cache is gone.
+struct LateFree {
+  void* block = nullptr;
+  size_t size = 0;
+  ~LateFree() { SemiPRO::SmallObjectPool::instance().deallocate(block, size); }
+};
+
+} // namespace
+
+TEST_CASE("Small object pool rounds requests up to their size class", "[SmallObjectPool]") {
+  SemiPRO::SmallObjectPool& pool = SemiPRO::SmallObjectPool::instance();
+  pool.flush_thread_cache();
+
+  // Sizes in one class reuse the block just freed
+  void* a = pool.allocate(17);
+  REQUIRE(alignedTo(a, SemiPRO::SmallObjectPool::GRANULARITY));
+  pool.deallocate(a, 17);
+  void* b = pool.allocate(32);
+  REQUIRE(b == a);
+  pool.deallocate(b, 32);
+
+  void* c = pool.allocate(1);
+  pool.deallocate(c, 1);
+  REQUIRE(pool.allocate(SemiPRO::SmallObjectPool::GRANULARITY) == c);
+  pool.deallocate(c, SemiPRO::SmallObjectPool::GRANULARITY);
+
+  // The next size up lands in the next class
+  void* d = pool.allocate(SemiPRO::SmallObjectPool::GRANULARITY + 1);
+  REQUIRE(d != c);
+  pool.deallocate(d, SemiPRO::SmallObjectPool::GRANULARITY + 1);
+
+  // Blocks of one class never overlap
+  std::vector<char*> blocks;
+  for (int i = 0; i < 100; ++i) {
+    blocks.push_back(static_cast<char*>(pool.allocate(48)));
+  }
+  std::sort(blocks.begin(), blocks.end());
+  for (size_t i = 1; i < blocks.size(); ++i) {
+    REQUIRE(blocks[i] - blocks[i - 1] >= 48);
+  }
+  for (char* block : blocks) {
+    pool.deallocate(block, 48);
+  }
+  pool.flush_thread_cache();
+}
+
+TEST_CASE("Small object pool passes large and over-aligned requests to operator new", "[SmallObjectPool]") {
+  SemiPRO::SmallObjectPool& pool = SemiPRO::SmallObjectPool::instance();
+  pool.flush_thread_cache();
+  const size_t reserved = pool.get_reserved_bytes();
+
+  void* large = pool.allocate(SemiPRO::SmallObjectPool::MAX_SIZE + 1);
+  void* aligned = pool.allocate(32, 64);
+  REQUIRE(alignedTo(aligned, 64));
+  pool.deallocate(large, SemiPRO::SmallObjectPool::MAX_SIZE + 1);
+  pool.deallocate(aligned, 32, 64);
+  pool.deallocate(nullptr, 32);
+  REQUIRE(pool.get_reserved_bytes() == reserved);
+
+  // Over-aligned element types reach the pool through the allocator
+  struct alignas(64) Wide {
+    double values[8];
+  };
+  std::vector<Wide, SemiPRO::PoolAllocator<Wide>> wide(5);
+  REQUIRE(alignedTo(wide.data(), 64));
+  REQUIRE(pool.get_reserved_bytes() == reserved);
+}
+
+TEST_CASE("Blocks freed on another thread refill the depot", "[SmallObjectPool]") {
+  SemiPRO::SmallObjectPool& pool = SemiPRO::SmallObjectPool::instance();
+  constexpr size_t size = 400;
+  const size_t count = 3 * SemiPRO::SmallObjectPool::BATCH_SIZE;
+  pool.flush_thread_cache();
+
+  std::vector<void*> blocks;
+  std::thread([&] {
+    for (size_t i = 0; i < count; ++i) {
+      blocks.push_back(pool.allocate(size));
+    }
+  }).join();
+  const size_t reserved = pool.get_reserved_bytes();
+
+  // Freed on a second thread, which hands them on as it exits
+  std::thread([&] {
+    for (void* block : blocks) {
+      pool.deallocate(block, size);
+    }
+  }).join();
+
+  std::vector<void*> again;
+  for (size_t i = 0; i < count; ++i) {
+    again.push_back(pool.allocate(size));
+  }
+  REQUIRE(pool.get_reserved_bytes() == reserved);
+  std::sort(blocks.begin(), blocks.end());
+  std::sort(again.begin(), again.end());
+  REQUIRE(again == blocks);
+  for (void* block : again) {
+    pool.deallocate(block, size);
+  }
+  pool.flush_thread_cache();
+}
+
+TEST_CASE("Blocks freed after a thread's cache is torn down go to the depot", "[SmallObjectPool]") {
+  SemiPRO::SmallObjectPool& pool = SemiPRO::SmallObjectPool::instance();
+  constexpr size_t size = 272;
+  pool.flush_thread_cache();
+
+  void* freed = nullptr;
+  std::thread([&] {
+    thread_local LateFree late;
+    late.size = size;
+    late.block = pool.allocate(size);
+    freed = late.block;
+  }).join();
+
+  REQUIRE(pool.allocate(size) == freed);
+  pool.deallocate(freed, size);
+  pool.flush_thread_cache();
+}
@@ -0,0 +1,211 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/advanced/process_optimizer.hpp"
+#include "../../src/cpp/advanced/pareto_sorting.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+SemiPRO::OptimizationParameter continuous(const std::string& name, double min_value, double max_value, double current) {
+  SemiPRO::OptimizationParameter param;
+  param.name = name;
+  param.min_value = min_value;
+  param.max_value = max_value;
+  param.current_value = current;
+  return param;
+}
+
+std::shared_ptr<WaferEnhanced> makeWafer() {
+  auto wafer = std::make_shared<WaferEnhanced>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(8, 8);
+  return wafer;
+}
+
+} // namespace
+
+TEST_CASE("Non-dominated sorting ranks fronts and archives the first", "[Optimizer]") {
+  const std::vector<std::vector<double>> points = {{1, 4}, {2, 2}, {4, 1}, {3, 3}, {4, 4}, {2, 2},
+                                                   {std::nan(""), 0}};
+  REQUIRE(SemiPRO::nonDominatedRanks(points) == std::vector<int>{0, 0, 0, 1, 2, 0, 0});
+  REQUIRE(SemiPRO::dominates({1, 1}, {1, 2}));
+  REQUIRE_FALSE(SemiPRO::dominates({1, 2}, {1, 2}));
+
+  // The extremes of a front are kept whatever the crowding
+  const auto crowding = SemiPRO::crowdingDistances(points, {0, 1, 2});
+  REQUIRE(std::isinf(crowding[0]));
+  REQUIRE(std::isinf(crowding[2]));
+  REQUIRE(std::abs(crowding[1] - 2.0) < 1e-12);
+
+  SemiPRO::ParetoArchive archive;
+  for (size_t i = 0; i < points.size() - 1; ++i) {
+    archive.insert(points[i], i);
+  }
+  REQUIRE(archive.ids() == std::vector<size_t>{0, 1, 2});
+  // A point dominating two archived ones replaces them
+  REQUIRE(archive.insert({1.5, 1.5}, 9));
+  REQUIRE(archive.ids() == std::vector<size_t>{0, 9, 2});
+  REQUIRE_FALSE(archive.insert({1.5, 1.5}, 10));
+}
+
+TEST_CASE("NSGA-II returns a non-dominated front along the trade-off", "[Optimizer]") {
+  // Cost falls and stress rises along x; y only adds stress, so the
+  // Pareto-optimal designs have y = 0
+  SemiPRO::ProcessOptimizer optimizer;
+  optimizer.addParameter("x", continuous("x", 0.0, 1.0, 0.5));
+  optimizer.addParameter("y", continuous("y", 0.0, 1.0, 0.5));
+  optimizer.setProcessEvaluator([](std::shared_ptr<WaferEnhanced>, const std::string&,
+                                   const std::unordered_map<std::string, double>& p, double) {
+    return std::unordered_map<std::string, double>{{"cost", p.at("x")},
+                                                   {"stress", 1.0 - std::sqrt(p.at("x")) + p.at("y")}};
+  });
+  optimizer.setGAParameters({24, 60});
+  optimizer.setMaxEvaluations(5000);
+
+  const auto results = optimizer.optimizeProcess(
+      makeWafer(), "oxidation", SemiPRO::OptimizationAlgorithm::MULTI_OBJECTIVE_GA,
+      {SemiPRO::OptimizationObjective::MINIMIZE_COST, SemiPRO::OptimizationObjective::MINIMIZE_STRESS});
+  REQUIRE(results.total_evaluations > 24);
+  REQUIRE(results.pareto_front.size() >= 10);
+  std::vector<std::vector<double>> front;
+  double lowest = std::numeric_limits<double>::infinity(), highest = 0.0;
+  for (const auto& evaluation : results.pareto_front) {
+    REQUIRE(evaluation.parameters.at("y") < 0.05);
+    lowest = std::min(lowest, evaluation.parameters.at("x"));
+    highest = std::max(highest, evaluation.parameters.at("x"));
+    front.push_back({evaluation.objectives.at("cost"), evaluation.objectives.at("stress")});
+  }
+  for (const auto& a : front) {
+    for (const auto& b : front) {
+      REQUIRE_FALSE(SemiPRO::dominates(b, a));
+    }
+  }
+  // Spread along the front rather than bunched at one end
+  REQUIRE(highest - lowest > 0.5);
+  // The archive keeps one of equal points; sorting every evaluation
+  // finds the same front with the repeats
+  const auto sorted = optimizer.calculateParetoFront(results.evaluations);
+  REQUIRE(sorted.size() >= front.size());
+  for (const auto& evaluation : sorted) {
+    const std::vector<double> point = {evaluation.objectives.at("cost"), evaluation.objectives.at("stress")};
+    REQUIRE(std::find(front.begin(), front.end(), point) != front.end());
+  }
+}
+
+TEST_CASE("Gradient optimization stops at a hard constraint", "[Optimizer]") {
+  // The unconstrained optimum, x = 3 and y = 1.4, lies past the cap on y
+  SemiPRO::OptimizationConstraint cap;
+  cap.parameter = "y";
+  cap.min_limit = 0.0;
+  cap.max_limit = 1.0;
+  const auto optimizerFor = [&cap](std::atomic<int>& simulations) {
+    auto optimizer = std::make_unique<SemiPRO::ProcessOptimizer>();
+    optimizer->addParameter("x", continuous("x", 0.0, 10.0, 8.0));
+    optimizer->addParameter("y", continuous("y", 0.0, 2.0, 0.2));
+    optimizer->addConstraint("y_cap", cap);
+    optimizer->setProcessEvaluator([&simulations](std::shared_ptr<WaferEnhanced>, const std::string&,
+                                                  const std::unordered_map<std::string, double>& p, double) {
+      ++simulations;
+      const double dx = p.at("x") - 3.0, dy = p.at("y") - 1.4;
+      return std::unordered_map<std::string, double>{{"uniformity", -(dx * dx) - 2.0 * dy * dy}};
+    });
+    return optimizer;
+  };
+
+  SECTION("with a differentiable fitness") {
+    std::atomic<int> simulations{0};
+    auto optimizer = optimizerFor(simulations);
+    optimizer->setDifferentiableFitness([](const std::unordered_map<std::string, ADScalar>& p) {
+      const ADScalar dx = p.at("x") - 3.0, dy = p.at("y") - 1.4;
+      return ADScalar(-(dx * dx) - 2.0 * dy * dy);
+    });
+    const auto results = optimizer->optimizeProcess(makeWafer(), "oxidation",
+                                                    SemiPRO::OptimizationAlgorithm::GRADIENT_DESCENT,
+                                                    {SemiPRO::OptimizationObjective::MAXIMIZE_UNIFORMITY});
+    REQUIRE(results.has_converged);
+    REQUIRE(std::abs(results.best_solution.parameters.at("x") - 3.0) < 1e-3);
+    REQUIRE(std::abs(results.best_solution.parameters.at("y") - 1.0) < 1e-9);
+    // Only the optimum is simulated, for its objectives
+    REQUIRE(simulations == 1);
+    REQUIRE(std::abs(results.best_solution.objectives.at("uniformity") + 0.32) < 1e-3);
+  }
+
+  SECTION("with finite differences") {
+    std::atomic<int> simulations{0};
+    auto optimizer = optimizerFor(simulations);
+    const auto results = optimizer->optimizeProcess(makeWafer(), "oxidation",
+                                                    SemiPRO::OptimizationAlgorithm::GRADIENT_DESCENT,
+                                                    {SemiPRO::OptimizationObjective::MAXIMIZE_UNIFORMITY});
+    REQUIRE(std::abs(results.best_solution.parameters.at("x") - 3.0) < 1e-2);
+    REQUIRE(std::abs(results.best_solution.parameters.at("y") - 1.0) < 1e-9);
+    REQUIRE(simulations == results.total_evaluations);
+    for (const auto& evaluation : results.evaluations) {
+      REQUIRE(evaluation.parameters.at("y") <= 1.0 + 1e-12);
+    }
+  }
+
+  // A cap outside the parameter's range leaves nothing to search
+  cap.min_limit = 3.0;
+  cap.max_limit = 4.0;
+  std::atomic<int> simulations{0};
+  const auto infeasible = optimizerFor(simulations)->optimizeProcess(
+      makeWafer(), "oxidation", SemiPRO::OptimizationAlgorithm::GRADIENT_DESCENT,
+      {SemiPRO::OptimizationObjective::MAXIMIZE_UNIFORMITY});
+  REQUIRE(simulations == 0);
+  REQUIRE(infeasible.evaluations.empty());
+}
+
+TEST_CASE("Hyperband judges candidates at full fidelity within its budget", "[Optimizer]") {
+  // Low fidelities are biased towards small x; the full model peaks at 0.6
+  std::atomic<int> simulations{0}, full{0};
+  SemiPRO::ProcessOptimizer optimizer;
+  optimizer.addParameter("x", continuous("x", 0.0, 1.0, 0.5));
+  optimizer.setProcessEvaluator([&](std::shared_ptr<WaferEnhanced>, const std::string&,
+                                    const std::unordered_map<std::string, double>& p, double fidelity) {
+    ++simulations;
+    if (fidelity == 1.0) ++full;
+    const double x = p.at("x");
+    return std::unordered_map<std::string, double>{{"uniformity", -(x - 0.6) * (x - 0.6) - (1.0 - fidelity) * x},
+                                                   {"fidelity", fidelity}};
+  });
+  optimizer.setHyperbandParameters({1.0 / 27.0, 3.0});
+  optimizer.setMaxEvaluations(40);
+
+  const auto run = [&] {
+    return optimizer.optimizeProcess(makeWafer(), "oxidation", SemiPRO::OptimizationAlgorithm::HYPERBAND,
+                                     {SemiPRO::OptimizationObjective::MAXIMIZE_UNIFORMITY});
+  };
+  const auto results = run();
+  // The budget is in full simulations; the last bracket may overrun it
+  // by at most one bracket's cost, four full simulations here
+  const double cost = results.statistics.at("simulation_cost");
+  REQUIRE(cost >= 40.0);
+  REQUIRE(cost < 44.0);
+  REQUIRE(results.total_evaluations == simulations);
+  REQUIRE(simulations > full);
+
+  // The best is chosen among full-fidelity evaluations only
+  REQUIRE(results.best_solution.fidelity == 1.0);
+  double best = -std::numeric_limits<double>::infinity();
+  for (const auto& evaluation : results.evaluations) {
+    REQUIRE(evaluation.objectives.at("fidelity") == evaluation.fidelity);
+    if (evaluation.fidelity == 1.0) best = std::max(best, evaluation.fitness_score);
+  }
+  REQUIRE(results.best_solution.fitness_score == best);
+  REQUIRE(std::abs(results.best_solution.parameters.at("x") - 0.6) < 0.1);
+
+  // Cached low-fidelity results never answer for a promotion
+  optimizer.enableEvaluationCache(true);
+  simulations = 0;
+  const auto cached = run();
+  REQUIRE(cached.statistics.at("cached_evaluations") == 0.0);
+  REQUIRE(cached.total_evaluations == simulations);
+  for (const auto& evaluation : cached.evaluations) {
+    REQUIRE(evaluation.objectives.at("fidelity") == evaluation.fidelity);
+  }
+}
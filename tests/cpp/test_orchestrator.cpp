@@ -0,0 +1,482 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/simulation_orchestrator.hpp"
+#include "../../src/cpp/core/simulation_engine.hpp"
+#include "../../src/cpp/core/wafer_enhanced.hpp"
+#include "../../src/cython/orchestrator_async.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Writes a YAML flow for loadSimulationFlow and returns its path
+std::string writeFlow(const std::string& name, const std::string& yaml) {
+  const auto path =
+      std::filesystem::temp_directory_path() / ("semipro-flow-" + name + "-" + std::to_string(::getpid()) + ".yaml");
+  std::ofstream(path) << "name: " << name << "\n" << yaml;
+  return path.string();
+}
+
+size_t position(const std::vector<std::string>& order, const std::string& name) {
+  return static_cast<size_t>(std::find(order.begin(), order.end(), name) - order.begin());
+}
+
+// CUSTOM step module: raises the grid by "amount" after "delay_ms" and
+// logs the "id" of each step it runs
+class StepPlugin : public SemiPRO::ProcessModulePlugin {
+public:
+  std::string getName() const override { return "orchestrator_step"; }
+  std::string getVersion() const override { return "2.0"; }
+  std::string getDescription() const override { return "Raises the grid and logs the steps run"; }
+  bool initialize() override { return true; }
+  void cleanup() override {}
+  void setParameters(const std::unordered_map<std::string, double>& params) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    params_ = params;
+  }
+  void execute(Wafer& wafer) override {
+    std::unordered_map<std::string, double> params;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      params = params_;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(params["delay_ms"])));
+    wafer.getGrid() += params["amount"];
+    std::lock_guard<std::mutex> lock(mutex_);
+    log_.push_back(static_cast<int>(params["id"]));
+  }
+  std::unordered_map<std::string, double> getResults() const override { return {}; }
+  std::vector<std::string> reads() const override { return {"grid"}; }
+  std::vector<std::string> writes() const override { return {"grid"}; }
+
+  std::vector<int> takeLog() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<int> log;
+    log.swap(log_);
+    return log;
+  }
+
+private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, double> params_;
+  std::vector<int> log_;
+};
+
+// Names of the steps the orchestrator reports complete, in order
+struct CompletedSteps {
+  std::mutex mutex;
+  std::vector<std::string> names;
+
+  std::vector<std::string> take() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> taken;
+    taken.swap(names);
+    return taken;
+  }
+};
+
+std::shared_ptr<CompletedSteps> recordCompletedSteps(SemiPRO::SimulationOrchestrator& orchestrator) {
+  auto steps = std::make_shared<CompletedSteps>();
+  orchestrator.setStepCompletedCallback([steps](const std::string& name, bool) {
+    std::lock_guard<std::mutex> lock(steps->mutex);
+    steps->names.push_back(name);
+  });
+  return steps;
+}
+
+} // namespace
+
+TEST_CASE("Orchestrator runs flows through their step graph", "[Orchestrator]") {
+  using namespace SemiPRO;
+  using Mode = SimulationOrchestrator::ExecutionMode;
+  auto& orchestrator = SimulationOrchestrator::getInstance();
+  orchestrator.setMaxParallelSteps(4);
+
+  // litho and anneal touch different state and may overlap; inspect waits
+  // for both, and cmp writes the films inspect reads, so it keeps its
+  // place after it
+  const std::string flow = writeFlow("graph", R"(steps:
+  - name: litho
+    type: lithography
+    parallel_compatible: true
+    parameters: {wavelength: 193.0, numerical_aperture: 1.35}
+  - name: anneal
+    type: annealing
+    parallel_compatible: true
+    parameters: {temperature: 1000.0, time: 10.0}
+  - name: inspect
+    type: inspection
+    parallel_compatible: true
+    dependencies: [litho, anneal]
+  - name: cmp
+    type: cmp
+    parallel_compatible: true
+    parameters: {pressure: 3.0, time: 1.0}
+)");
+  orchestrator.loadSimulationFlow(flow);
+
+  for (Mode mode : {Mode::PARALLEL, Mode::PIPELINE}) {
+    orchestrator.setExecutionMode(mode);
+    REQUIRE(orchestrator.executeSimulationFlow("graph", "graph_wafer").get());
+    const auto progress = orchestrator.getProgress();
+    REQUIRE(progress.state == SimulationOrchestrator::SimulationState::COMPLETED);
+    REQUIRE(progress.current_step == 4);
+    const auto& order = progress.completed_steps;
+    REQUIRE(order.size() == 4);
+    REQUIRE(position(order, "litho") < position(order, "inspect"));
+    REQUIRE(position(order, "anneal") < position(order, "inspect"));
+    REQUIRE(position(order, "inspect") < position(order, "cmp"));
+  }
+
+  // A cycle is reported before anything runs
+  const std::string cyclic = writeFlow("cyclic", R"(steps:
+  - name: a
+    type: inspection
+    dependencies: [b]
+  - name: b
+    type: inspection
+    dependencies: [a]
+)");
+  orchestrator.loadSimulationFlow(cyclic);
+  orchestrator.setExecutionMode(Mode::PARALLEL);
+  REQUIRE_FALSE(orchestrator.executeSimulationFlow("cyclic", "graph_wafer").get());
+  const auto progress = orchestrator.getProgress();
+  REQUIRE(progress.completed_steps.empty());
+  REQUIRE(std::any_of(progress.errors.begin(), progress.errors.end(),
+                      [](const std::string& error) { return error.find("cycle") != std::string::npos; }));
+
+  orchestrator.setExecutionMode(Mode::SEQUENTIAL);
+  std::filesystem::remove(flow);
+  std::filesystem::remove(cyclic);
+}
+
+TEST_CASE("Orchestrator batches pipeline wafers through per-step-type stages", "[Orchestrator]") {
+  using namespace SemiPRO;
+  auto& orchestrator = SimulationOrchestrator::getInstance();
+  auto& engine = SimulationEngine::getInstance();
+  engine.initialize("");
+  auto plugin = std::make_shared<StepPlugin>();
+  auto plugins = std::make_shared<PluginManager>();
+  REQUIRE(plugins->addPlugin(plugin));
+  orchestrator.setPluginManager(plugins);
+  auto completed = recordCompletedSteps(orchestrator);
+
+  // Three stages, the middle one slow: while a wafer bakes, the next one
+  // goes through lithography
+  const std::string flow = writeFlow("line", R"(steps:
+  - name: litho
+    type: lithography
+    parameters: {wavelength: 193.0, numerical_aperture: 1.35}
+  - name: bake
+    type: custom
+    plugin: orchestrator_step
+    parameters: {amount: 1.0, delay_ms: 20.0}
+  - name: inspect
+    type: inspection
+)");
+  orchestrator.loadSimulationFlow(flow);
+
+  std::vector<std::pair<std::string, std::string>> batch;
+  for (int w = 0; w < 3; ++w) {
+    const std::string name = "line_w" + std::to_string(w);
+    engine.registerWafer(engine.createWafer(300.0, 775.0, "silicon", 8, 8), name);
+    batch.emplace_back(name, "line");
+  }
+  const std::vector<std::vector<double>> before = [&] {
+    std::vector<std::vector<double>> grids;
+    for (const auto& item : batch) {
+      const auto grid = engine.getWafer(item.first)->getGrid();
+      grids.emplace_back(grid.data(), grid.data() + grid.size());
+    }
+    return grids;
+  }();
+
+  orchestrator.setExecutionMode(SimulationOrchestrator::ExecutionMode::BATCH);
+  REQUIRE(orchestrator.getStageWorkers(SimulationOrchestrator::StepType::CUSTOM) == 1);
+  const std::vector<bool> results = orchestrator.executeBatch(batch).get();
+  REQUIRE(results == std::vector<bool>{true, true, true});
+
+  const auto order = completed->take();
+  REQUIRE(order.size() == 9);
+  for (const auto& item : batch) {
+    const std::string& wafer = item.first;
+    REQUIRE(position(order, wafer + "/litho") < position(order, wafer + "/bake"));
+    REQUIRE(position(order, wafer + "/bake") < position(order, wafer + "/inspect"));
+  }
+  // Run wafer by wafer, no wafer would start before the previous finished
+  REQUIRE(position(order, "line_w1/litho") < position(order, "line_w0/inspect"));
+  REQUIRE(position(order, "line_w2/litho") < position(order, "line_w1/inspect"));
+
+  // Each wafer baked once
+  REQUIRE(plugin->takeLog().size() == 3);
+  for (size_t w = 0; w < batch.size(); ++w) {
+    const auto grid = engine.getWafer(batch[w].first)->getGrid();
+    for (Eigen::Index i = 0; i < grid.size(); ++i) {
+      REQUIRE(grid.data()[i] == before[w][i] + 1.0);
+    }
+    engine.unregisterWafer(batch[w].first);
+  }
+
+  orchestrator.setExecutionMode(SimulationOrchestrator::ExecutionMode::SEQUENTIAL);
+  orchestrator.setPluginManager(nullptr);
+  std::filesystem::remove(flow);
+}
+
+TEST_CASE("Incremental re-simulation re-runs only an edited step and its dependents", "[Orchestrator]") {
+  using namespace SemiPRO;
+  using Mode = SimulationOrchestrator::ExecutionMode;
+  auto& orchestrator = SimulationOrchestrator::getInstance();
+  auto& engine = SimulationEngine::getInstance();
+  engine.initialize("");
+  auto plugin = std::make_shared<StepPlugin>();
+  auto plugins = std::make_shared<PluginManager>();
+  REQUIRE(plugins->addPlugin(plugin));
+  orchestrator.setPluginManager(plugins);
+  orchestrator.enableIncrementalResimulation(true);
+  // One step at a time, so every step leaves a snapshot
+  orchestrator.setMaxParallelSteps(1);
+
+  // Each section on a wafer of its own; heights are relative to its start
+  std::string wafer;
+  double start = 0.0;
+  auto freshWafer = [&](const std::string& name) {
+    wafer = name;
+    engine.registerWafer(engine.createWafer(300.0, 775.0, "silicon", 8, 8), wafer);
+    start = engine.getWafer(wafer)->getGrid().data()[0];
+  };
+  auto height = [&] { return engine.getWafer(wafer)->getGrid().data()[0] - start; };
+
+  SECTION("Sequential flows re-run from the edited step on") {
+    freshWafer("incremental_wafer");
+    const std::string flow = writeFlow("incremental", R"(steps:
+  - {name: s1, type: custom, plugin: orchestrator_step, parameters: {id: 1, amount: 1.0}}
+  - {name: s2, type: custom, plugin: orchestrator_step, parameters: {id: 2, amount: 2.0}}
+  - {name: s3, type: custom, plugin: orchestrator_step, parameters: {id: 3, amount: 3.0}}
+  - {name: s4, type: custom, plugin: orchestrator_step, parameters: {id: 4, amount: 4.0}}
+)");
+    orchestrator.loadSimulationFlow(flow);
+    orchestrator.setExecutionMode(Mode::SEQUENTIAL);
+    REQUIRE(orchestrator.executeSimulationFlow("incremental", wafer).get());
+    REQUIRE(plugin->takeLog() == std::vector<int>{1, 2, 3, 4});
+    REQUIRE(height() == 10.0);
+
+    orchestrator.setStepParameter("s3", "amount", 5.0);
+    REQUIRE(orchestrator.executeSimulationFlow("incremental", wafer).get());
+    REQUIRE(plugin->takeLog() == std::vector<int>{3, 4});
+    // From the wafer's initial state, not on top of the first run
+    REQUIRE(height() == 12.0);
+    REQUIRE(orchestrator.getProgress().completed_steps.size() == 4);
+
+    // Unchanged, nothing runs again
+    REQUIRE(orchestrator.executeSimulationFlow("incremental", wafer).get());
+    REQUIRE(plugin->takeLog().empty());
+    REQUIRE(height() == 12.0);
+    std::filesystem::remove(flow);
+  }
+
+  SECTION("Graph flows keep steps the edit does not reach") {
+    freshWafer("incremental_graph_wafer");
+    // side touches other state than base and top, so an edit of base
+    // leaves it alone though it comes first
+    const std::string flow = writeFlow("incremental_graph", R"(steps:
+  - {name: side, type: custom, plugin: orchestrator_step, reads: [dopant], writes: [dopant],
+     parameters: {id: 1, amount: 0.0}}
+  - {name: base, type: custom, plugin: orchestrator_step, reads: [grid], writes: [grid],
+     parameters: {id: 2, amount: 1.0}}
+  - {name: top, type: custom, plugin: orchestrator_step, reads: [grid], writes: [grid], dependencies: [base],
+     parameters: {id: 3, amount: 2.0}}
+)");
+    orchestrator.loadSimulationFlow(flow);
+    orchestrator.setExecutionMode(Mode::PARALLEL);
+    REQUIRE(orchestrator.executeSimulationFlow("incremental_graph", wafer).get());
+    REQUIRE(plugin->takeLog() == std::vector<int>{1, 2, 3});
+    REQUIRE(height() == 3.0);
+
+    orchestrator.setStepParameter("base", "amount", 4.0);
+    REQUIRE(orchestrator.executeSimulationFlow("incremental_graph", wafer).get());
+    REQUIRE(plugin->takeLog() == std::vector<int>{2, 3});
+    REQUIRE(height() == 6.0);
+
+    orchestrator.setStepParameter("top", "amount", 1.0);
+    REQUIRE(orchestrator.executeSimulationFlow("incremental_graph", wafer).get());
+    REQUIRE(plugin->takeLog() == std::vector<int>{3});
+    REQUIRE(height() == 5.0);
+    std::filesystem::remove(flow);
+  }
+
+  engine.unregisterWafer(wafer);
+  orchestrator.enableIncrementalResimulation(false);
+  orchestrator.setExecutionMode(Mode::SEQUENTIAL);
+  orchestrator.setMaxParallelSteps(4);
+  orchestrator.setPluginManager(nullptr);
+}
+
+TEST_CASE("Coarsened wafers average blocks of cells", "[Orchestrator]") {
+  WaferEnhanced wafer(300.0, 775.0, "silicon");
+  wafer.initializeGrid(8, 6);
+  Eigen::ArrayXXd grid(8, 6);
+  Eigen::ArrayXXd resist = Eigen::ArrayXXd::Zero(8, 6);
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 6; ++j) {
+      grid(i, j) = i * 6 + j;
+    }
+  }
+  // Five of the nine cells of the first block, four of the second's
+  resist.block(0, 0, 3, 3) << 1, 1, 1, 1, 1, 0, 0, 0, 0;
+  resist.block(0, 3, 3, 3) << 1, 1, 1, 1, 0, 0, 0, 0, 0;
+  wafer.getGrid() = grid;
+  wafer.setPhotoresistPattern(resist);
+  wafer.setDopantProfile(Eigen::ArrayXd::LinSpaced(8, 0.0, 7.0));
+
+  // At most 3 cells a side: blocks of 3, the last row of blocks cut short
+  const auto coarse = wafer.coarsened(3);
+  const auto coarse_grid = coarse->getGrid();
+  REQUIRE(coarse_grid.rows() == 3);
+  REQUIRE(coarse_grid.cols() == 2);
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 2; ++c) {
+      const int rows = std::min(3, 8 - 3 * r);
+      REQUIRE(std::abs(coarse_grid(r, c) - grid.block(3 * r, 3 * c, rows, 3).mean()) < 1e-12);
+    }
+  }
+  const auto coarse_resist = coarse->getPhotoresistPattern();
+  REQUIRE(coarse_resist(0, 0) == 1.0);
+  REQUIRE(coarse_resist(0, 1) == 0.0);
+  REQUIRE(coarse->getDopantProfile().size() == 3);
+  REQUIRE(std::abs(coarse->getDopantProfile()(2) - 6.5) < 1e-12);
+  // The source is untouched
+  REQUIRE(wafer.getGrid().rows() == 8);
+  REQUIRE((Eigen::ArrayXXd(wafer.getGrid()) == grid).all());
+
+  // Small enough already: a plain copy
+  const auto copy = wafer.coarsened(8);
+  REQUIRE((Eigen::ArrayXXd(copy->getGrid()) == grid).all());
+  REQUIRE_THROWS_AS(wafer.coarsened(0), std::invalid_argument);
+}
+
+TEST_CASE("Progressive runs publish a preview capped at the preview resolution", "[Orchestrator]") {
+  using namespace SemiPRO;
+  auto& orchestrator = SimulationOrchestrator::getInstance();
+  auto& engine = SimulationEngine::getInstance();
+  engine.initialize("");
+  auto plugin = std::make_shared<StepPlugin>();
+  auto plugins = std::make_shared<PluginManager>();
+  REQUIRE(plugins->addPlugin(plugin));
+  orchestrator.setPluginManager(plugins);
+  orchestrator.setExecutionMode(SimulationOrchestrator::ExecutionMode::SEQUENTIAL);
+
+  REQUIRE_THROWS_AS(orchestrator.setPreviewResolution(0), std::invalid_argument);
+  REQUIRE(orchestrator.getPreviewResolution() == 64);
+  orchestrator.setPreviewResolution(8);
+  REQUIRE(orchestrator.getPreviewResolution() == 8);
+
+  struct Published {
+    int level;
+    Eigen::ArrayXXd grid;
+  };
+  auto published = std::make_shared<std::vector<Published>>();
+  auto published_mutex = std::make_shared<std::mutex>();
+  orchestrator.setPreviewCallback(
+      [published, published_mutex](const std::string& wafer, int level, std::shared_ptr<const WaferEnhanced> result) {
+        if (wafer == "progressive_wafer") {
+          std::lock_guard<std::mutex> lock(*published_mutex);
+          published->push_back({level, Eigen::ArrayXXd(result->getGrid())});
+        }
+      });
+
+  engine.registerWafer(engine.createWafer(300.0, 775.0, "silicon", 32, 24), "progressive_wafer");
+  Eigen::ArrayXXd grid(32, 24);
+  for (int i = 0; i < 32; ++i) {
+    for (int j = 0; j < 24; ++j) {
+      grid(i, j) = i + 0.5 * j;
+    }
+  }
+  engine.getWafer("progressive_wafer")->getGrid() = grid;
+  const std::string flow = writeFlow("progressive", R"(steps:
+  - {name: raise, type: custom, plugin: orchestrator_step, parameters: {id: 1, amount: 1.0}}
+)");
+  orchestrator.loadSimulationFlow(flow);
+
+  REQUIRE(orchestrator.executeProgressive("progressive_wafer").get());
+  REQUIRE(published->size() == 2);
+  // Level 0 on blocks of 4 x 4, the longest side cut to 8 cells
+  const Published& preview = (*published)[0];
+  REQUIRE(preview.level == 0);
+  REQUIRE(preview.grid.rows() == 8);
+  REQUIRE(preview.grid.cols() == 6);
+  for (int r = 0; r < 8; ++r) {
+    for (int c = 0; c < 6; ++c) {
+      REQUIRE(std::abs(preview.grid(r, c) - (grid.block(4 * r, 4 * c, 4, 4).mean() + 1.0)) < 1e-12);
+    }
+  }
+  const Published& full = (*published)[1];
+  REQUIRE(full.level == 1);
+  REQUIRE(full.grid.rows() == 32);
+  REQUIRE((full.grid == grid + 1.0).all());
+  int level = -1;
+  REQUIRE(orchestrator.getPreview("progressive_wafer", &level) != nullptr);
+  REQUIRE(level == 1);
+  REQUIRE(plugin->takeLog().size() == 2);
+
+  engine.unregisterWafer("progressive_wafer");
+  engine.unregisterWafer("progressive_wafer#preview");
+  orchestrator.setPreviewResolution(64);
+  orchestrator.enableIncrementalResimulation(false);
+  orchestrator.setPluginManager(nullptr);
+  std::filesystem::remove(flow);
+}
+
+TEST_CASE("Completion queue hands every push to a draining consumer once", "[Orchestrator]") {
+  using orchestrator_async::CompletionEvent;
+  auto queue = orchestrator_async::CompletionQueue::create();
+  constexpr int kProducers = 4;
+  constexpr int kEvents = 20000;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&queue, p] {
+      for (int i = 0; i < kEvents; ++i) {
+        CompletionEvent event;
+        event.ticket = static_cast<std::uint64_t>(p) * kEvents + i;
+        queue->push(std::move(event));
+      }
+    });
+  }
+
+  // The consumer sleeps on the wake pipe like the event loop; a push that
+  // went unannounced would leave it waiting with events queued
+  std::vector<int> next(kProducers, 0);
+  bool in_order = true;
+  bool woken = true;
+  int received = 0;
+  std::vector<CompletionEvent> events;
+  while (received < kProducers * kEvents && woken) {
+    pollfd readable{queue->fd(), POLLIN, 0};
+    woken = ::poll(&readable, 1, 5000) == 1;
+    events.clear();
+    queue->drain(events);
+    for (const auto& event : events) {
+      const int p = static_cast<int>(event.ticket / kEvents);
+      in_order = in_order && static_cast<int>(event.ticket % kEvents) == next[p]++;
+    }
+    received += static_cast<int>(events.size());
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  REQUIRE(woken);
+  REQUIRE(in_order);
+  REQUIRE(received == kProducers * kEvents);
+  events.clear();
+  queue->drain(events);
+  REQUIRE(events.empty());
+}
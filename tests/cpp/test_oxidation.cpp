@@ -1,6 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 #include "../../src/cpp/modules/oxidation/oxidation_model.hpp"
 #include "../../src/cpp/core/wafer.hpp"
+#include <cmath>
 
 TEST_CASE("Oxidation thickness calculation", "[Oxidation]") {
   auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
@@ -8,4 +9,34 @@ TEST_CASE("Oxidation thickness calculation", "[Oxidation]") {
   oxidation.simulateOxidation(wafer, 1000.0, 3600.0);
   REQUIRE(wafer->getMaterialId() == "oxide");
   REQUIRE(wafer->getThickness() > 775.0); // Oxide layer added
-}
\ No newline at end of file
+}
+
+TEST_CASE("Oxidation follows the wafer's temperature field cell by cell", "[Oxidation]") {
+  OxidationModel oxidation;
+  auto uniform = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  uniform->initializeGrid(6, 8);
+  const Eigen::ArrayXXd before = uniform->getGrid();
+  oxidation.simulateOxidation(uniform, 1000.0, 1.0);
+  const Eigen::ArrayXXd grown = uniform->getGrid() - before;
+  REQUIRE(uniform->getFilmLayers().size() == 1);
+  REQUIRE(grown.maxCoeff() - grown.minCoeff() < 1e-12);
+  REQUIRE(std::abs(grown(0, 0) - uniform->getFilmLayers().back().first) < 1e-12);
+
+  // Columns hotter by up to 20 K grow thicker oxide, the recipe's
+  // temperature holding at the field's mean
+  auto graded = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  graded->initializeGrid(6, 8);
+  Eigen::ArrayXXd temperature(6, 8);
+  for (int j = 0; j < 8; ++j) {
+    temperature.col(j).setConstant(1263.15 + 20.0 * j / 7.0);
+  }
+  graded->setTemperatureProfile(temperature);
+  oxidation.simulateOxidation(graded, 1000.0, 1.0);
+  const Eigen::ArrayXXd graded_growth = graded->getGrid() - before;
+  for (int j = 1; j < 8; ++j) {
+    REQUIRE(graded_growth(0, j) > graded_growth(0, j - 1));
+    REQUIRE(std::abs(graded_growth(5, j) - graded_growth(0, j)) < 1e-12);
+  }
+  REQUIRE(graded_growth(0, 0) < grown(0, 0));
+  REQUIRE(graded_growth(0, 7) > grown(0, 0));
+}
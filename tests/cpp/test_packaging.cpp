@@ -1,8 +1,10 @@
 #include <catch2/catch_test_macros.hpp>
 #include "../../src/cpp/modules/packaging/packaging_model.hpp"
 #include "../../src/cpp/core/wafer.hpp"
+#include "../../src/cpp/core/laminate_plate_solver.hpp"
 #include "../../src/cpp/modules/photolithography/lithography_model.hpp"
 #include "../../src/cpp/modules/metallization/metallization_model.hpp"
+#include <cmath>
 
 TEST_CASE("Packaging simulation", "[Packaging]") {
   auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
@@ -50,4 +52,67 @@ TEST_CASE("Electrical capacitance test", "[Packaging]") {
   REQUIRE(!properties.empty());
   REQUIRE(properties[0].first == "Capacitance");
   REQUIRE(properties[0].second > 0.0);
-}
\ No newline at end of file
+}
+TEST_CASE("Batched package parasitics", "[Packaging]") {
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(10, 10);
+  LithographyModel lithography;
+  std::vector<std::vector<int>> mask = {{1, 0, 1}, {0, 1, 0}, {1, 0, 1}};
+  lithography.simulateExposure(wafer, 13.5, 0.33, mask);
+  MetallizationModel metallization;
+  metallization.simulateMetallization(wafer, 0.5, "Cu", "pvd");
+  wafer->addPackaging(1000.0, "Ceramic", {{{0, 0}, {3, 4}}, {{1, 1}, {1, 2}}});
+  PackagingModel packaging;
+  packaging.performElectricalTest(wafer, "resistance");
+  const double resistance = wafer->getElectricalProperties()[0].second;
+
+  PackageVariant thin;
+  PackageVariant thick = thin;
+  thick.wire_diameter = 2.0 * thin.wire_diameter;
+  auto results = packaging.performElectricalTests(wafer, {thin, thick});
+  REQUIRE(results.size() == 2);
+  REQUIRE(results[0].line_resistance == resistance);
+  REQUIRE(results[0].bond_resistance.size() == 2);
+  // The longer bond has more of everything; a wire twice as thick a
+  // quarter the resistance and less inductance
+  REQUIRE(results[0].bond_resistance(0) > results[0].bond_resistance(1));
+  REQUIRE(results[0].bond_inductance(0) > results[0].bond_inductance(1));
+  REQUIRE(results[0].bond_capacitance(0) > results[0].bond_capacitance(1));
+  REQUIRE(std::abs(results[1].bond_resistance(0) * 4.0 - results[0].bond_resistance(0)) <
+          1e-12 * results[0].bond_resistance(0));
+  REQUIRE(results[1].bond_inductance(0) < results[0].bond_inductance(0));
+  // A 1 mm gold bond is about a nanohenry
+  PackageVariant millimetre;
+  millimetre.pad_pitch = 140.0; // 5 cells across plus two 150 um loops
+  results = packaging.performElectricalTests(wafer, {millimetre});
+  REQUIRE(results[0].bond_inductance(0) > 0.5);
+  REQUIRE(results[0].bond_inductance(0) < 1.5);
+  millimetre.pad_pitch = 0.0;
+  REQUIRE_THROWS_AS(packaging.performElectricalTests(wafer, {millimetre}), std::invalid_argument);
+}
+
+TEST_CASE("Laminate plate warps a bilayer as Timoshenko's strip", "[Packaging]") {
+  // Silicon on an organic substrate, heated to reflow from flat
+  const double t_die = 0.5e-3, t_substrate = 0.5e-3, side = 10e-3;
+  const int cells = 30;
+  const std::vector<LaminatePlateSolver::Material> materials = {{130e9, 0.28, 2.6e-6}, {25e9, 0.28, 17e-6}};
+  const std::vector<LaminatePlateSolver::Stack> stacks = {{{0, t_die}, {1, t_substrate}}};
+  const LaminatePlateSolver solver(Eigen::ArrayXXi::Zero(cells, cells), side / cells, materials, stacks);
+  const double dT = 235.0;
+  const auto result = solver.solve(298.15 + dT);
+  REQUIRE(result.residual <= 1e-8);
+
+  // Biaxial moduli, equal Poisson ratios: the curvature of the strip
+  // holds over the whole free plate
+  const double m = t_die / t_substrate, n = (130e9 / 0.72) / (25e9 / 0.72), h = t_die + t_substrate;
+  const double curvature = 6.0 * (17e-6 - 2.6e-6) * dT * (1.0 + m) * (1.0 + m) /
+                           (h * (3.0 * (1.0 + m) * (1.0 + m) + (1.0 + m * n) * (m * m + 1.0 / (m * n))));
+  REQUIRE(std::abs(result.warpage_range - curvature * side * side / 4.0) < 1e-3 * result.warpage_range);
+
+  // A sweep solves once per regime and extrapolates the rest exactly
+  const auto sweep = solver.solve(std::vector<double>{298.15 + dT / 2.0, 298.15 + dT, 298.15 + 1.5 * dT});
+  REQUIRE(solver.operators() == 1);
+  REQUIRE(sweep[2].iterations == 0);
+  REQUIRE(std::abs(sweep[1].warpage_range - result.warpage_range) < 1e-6 * result.warpage_range);
+  REQUIRE(std::abs(sweep[2].warpage_range - 1.5 * result.warpage_range) < 1e-6 * result.warpage_range);
+}
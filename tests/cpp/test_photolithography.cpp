@@ -1,6 +1,19 @@
 #include <catch2/catch_test_macros.hpp>
 #include "../../src/cpp/modules/photolithography/lithography_model.hpp"
+#include "../../src/cpp/modules/photolithography/hopkins_imaging.hpp"
+#include "../../src/cpp/modules/photolithography/model_opc.hpp"
+#include "../../src/cpp/modules/photolithography/resist_development.hpp"
+#include "../../src/cpp/modules/advanced_processes/euv_lithography.hpp"
 #include "../../src/cpp/core/wafer.hpp"
+#include "../../src/cpp/core/fft.hpp"
+#include "../../src/cpp/core/bit_mask.hpp"
+#include "../../src/cpp/core/profiler.hpp"
+#include "../../src/cpp/core/spectrum_cache.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <stdexcept>
 
 TEST_CASE("Exposure simulation", "[Photolithography]") {
   auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
@@ -33,4 +46,482 @@ TEST_CASE("Exposure simulation with Gaussian PSF", "[Photolithography]") {
   REQUIRE(pattern.sum() > 0.0);
   REQUIRE((pattern >= 0.0).all()); // Pattern values >= 0
   REQUIRE((pattern <= 1.0).all()); // Pattern values <= 1
-}
\ No newline at end of file
+}
+TEST_CASE("FFT aerial image matches the direct PSF sum", "[Photolithography]") {
+  const int n = 32;
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(n, n);
+  BitMask mask(n / 2, n / 2);
+  for (int m = 0; m < n / 2; ++m) {
+    for (int k = 0; k < n / 2; ++k) {
+      mask.set(m, k, (m / 4 + k / 4) % 2 == 0);
+    }
+  }
+  LithographyModel lithography;
+  lithography.simulateExposure(wafer, 13.5, 0.33, mask);
+  auto pattern = wafer->getPhotoresistPattern();
+
+  const double resolution = 0.25 * 13.5 / 0.33;
+  const double sigma_psf = 0.5 * resolution;
+  int exposed = 0;
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      double intensity = 0.0;
+      mask.forEachSet([&](int m, int k) {
+        double dx = (i - m) * resolution / n;
+        double dy = (j - k) * resolution / n;
+        intensity += std::exp(-(dx * dx + dy * dy) / (2 * sigma_psf * sigma_psf));
+      });
+      const bool expected = intensity / (2 * M_PI * sigma_psf * sigma_psf) > 0.5;
+      REQUIRE((pattern(i, j) > 0.5) == expected);
+      exposed += expected;
+    }
+  }
+  REQUIRE(exposed > 0);
+  REQUIRE(exposed < n * n);
+}
+
+TEST_CASE("FFT backends round-trip and plug into the aerial image", "[Photolithography]") {
+  const int rows = 8, cols = 16;
+  std::vector<double> image(rows * cols), back(rows * cols);
+  for (size_t k = 0; k < image.size(); ++k) {
+    image[k] = std::sin(0.7 * k) + 0.25 * (k % 5);
+  }
+  Radix2Fft fft;
+  std::vector<FftBackend::Complex> spectrum(rows * (cols / 2 + 1));
+  fft.forward(image.data(), spectrum.data(), rows, cols);
+  // The DC term is the sum of the image
+  double total = 0.0;
+  for (double v : image) {
+    total += v;
+  }
+  REQUIRE(std::abs(spectrum[0] - FftBackend::Complex(total, 0.0)) < 1e-9);
+  fft.inverse(spectrum.data(), back.data(), rows, cols);
+  for (size_t k = 0; k < image.size(); ++k) {
+    REQUIRE(std::abs(back[k] - image[k]) < 1e-12);
+  }
+  REQUIRE_THROWS_AS(fft.forward(image.data(), spectrum.data(), 6, cols), std::invalid_argument);
+
+  // A registered backend is picked up by name
+  struct CountingFft : Radix2Fft {
+    std::string name() const override { return "counting"; }
+    void forward(const double* in, Complex* out, int r, int c) const override {
+      ++calls;
+      Radix2Fft::forward(in, out, r, c);
+    }
+    mutable int calls = 0;
+  };
+  auto counting = std::make_shared<CountingFft>();
+  Fft::registerBackend("counting", [counting] { return counting; });
+  REQUIRE(Fft::create("counting")->name() == "counting");
+  REQUIRE_THROWS_AS(Fft::create("missing"), std::invalid_argument);
+
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(10, 10);
+  SpectrumCache::instance().clear();
+  LithographyModel lithography;
+  lithography.setFftBackend(Fft::create("counting"));
+  std::vector<std::vector<int>> mask = {{1, 0, 1}, {0, 1, 0}, {1, 0, 1}};
+  lithography.simulateExposure(wafer, 13.5, 0.33, mask);
+  lithography.simulateExposure(wafer, 13.5, 0.33, mask);
+  // The PSF and mask spectra are transformed once, then reused
+  REQUIRE(counting->calls == 2);
+}
+
+TEST_CASE("Hopkins imaging resolves a grating the coherent limit cannot", "[Photolithography]") {
+  const std::string path = "test_hopkins_kernels";
+  std::filesystem::remove_all(path);
+  const int n = 64;
+  HopkinsImaging::Optics optics(193.0, 0.9, 0.5, 20.0, 20.0);
+
+  // An open frame images to unit intensity away from its edges
+  HopkinsImaging imaging(path);
+  auto open = imaging.aerialImage(Eigen::ArrayXXd::Ones(3 * n, 3 * n), optics, 2 * n, 2 * n);
+  REQUIRE(std::abs(open(n, n) - 1.0) < 1e-2);
+  auto kernels = imaging.kernels(optics, HopkinsImaging::kernelSize(optics, 3 * n, 3 * n));
+  REQUIRE(kernels->weights.size() == 12);
+  REQUIRE(std::is_sorted(kernels->weights.rbegin(), kernels->weights.rend()));
+
+  // 200 nm pitch lines: past the coherent cutoff NA / lambda, inside the
+  // partially coherent one (1 + sigma) NA / lambda
+  Eigen::ArrayXXd grating(3 * n, 3 * n);
+  for (int i = 0; i < 3 * n; ++i) {
+    for (int j = 0; j < 3 * n; ++j) {
+      grating(i, j) = (j / 5) % 2;
+    }
+  }
+  auto contrast = [&](const Eigen::ArrayXXd& image) {
+    Eigen::ArrayXd row = image.row(n).segment(n - 10, 20);
+    return (row.maxCoeff() - row.minCoeff()) / (row.maxCoeff() + row.minCoeff());
+  };
+  REQUIRE(contrast(imaging.aerialImage(grating, optics, 2 * n, 2 * n)) > 0.5);
+  HopkinsImaging::Optics coherent = optics;
+  coherent.sigma = 0.0;
+  REQUIRE(contrast(imaging.aerialImage(grating, coherent, 2 * n, 2 * n)) < 0.3);
+  REQUIRE(imaging.decompositions() == 2);
+
+  // A second engine reads the kernels back from disk
+  HopkinsImaging reloaded(path);
+  auto again = reloaded.aerialImage(grating, optics, 2 * n, 2 * n);
+  REQUIRE(reloaded.decompositions() == 0);
+  REQUIRE((again - imaging.aerialImage(grating, optics, 2 * n, 2 * n)).abs().maxCoeff() < 1e-12);
+  std::filesystem::remove_all(path);
+
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(10, 10);
+  LithographyModel lithography;
+  lithography.setHopkinsImaging(std::make_shared<HopkinsImaging>());
+  std::vector<std::vector<int>> mask = {{1, 0, 1}, {0, 1, 0}, {1, 0, 1}};
+  lithography.simulateExposure(wafer, 13.5, 0.33, mask);
+  auto pattern = wafer->getPhotoresistPattern();
+  REQUIRE((pattern >= 0.0).all());
+  REQUIRE((pattern <= 1.0).all());
+}
+
+TEST_CASE("Multi-patterning shares the optics and matches its single exposures", "[Photolithography]") {
+  const int n = 32;
+  // Each mask is clear but for one quadrant
+  std::vector<std::vector<std::vector<int>>> masks(4, std::vector<std::vector<int>>(n / 2, std::vector<int>(n / 2, 1)));
+  for (int k = 0; k < 4; ++k) {
+    for (int m = 0; m < n / 4; ++m) {
+      for (int j = 0; j < n / 4; ++j) {
+        masks[k][m + (k / 2) * n / 4][j + (k % 2) * n / 4] = 0;
+      }
+    }
+  }
+  LithographyModel lithography;
+  Eigen::ArrayXXd expected = Eigen::ArrayXXd::Zero(n, n);
+  for (const auto& mask : masks) {
+    auto single = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    single->initializeGrid(n, n);
+    lithography.simulateExposure(single, 13.5, 0.33, mask);
+    expected = expected.max(single->getPhotoresistPattern());
+  }
+
+  struct CountingFft : Radix2Fft {
+    std::string name() const override { return "counting"; }
+    void forward(const double* in, Complex* out, int r, int c) const override {
+      ++calls;
+      Radix2Fft::forward(in, out, r, c);
+    }
+    mutable std::atomic<int> calls{0};
+  };
+  auto counting = std::make_shared<CountingFft>();
+  lithography.setFftBackend(counting);
+  SpectrumCache::instance().clear();
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(n, n);
+  lithography.simulateMultiPatterning(wafer, 13.5, 0.33, masks);
+  // One PSF spectrum, then one transform per mask
+  REQUIRE(counting->calls == 5);
+  REQUIRE((wafer->getPhotoresistPattern() == expected).all());
+  REQUIRE(expected.sum() > 0.0);
+  REQUIRE(expected.sum() < n * n);
+}
+
+TEST_CASE("Tiled exposure matches the whole field", "[Photolithography]") {
+  const int rows = 150, cols = 200;
+  // Lines and spaces 8 cells each, with an opaque block across them
+  BitMask mask = BitMask::fromPredicate(rows, cols, [](int i, int j) {
+    return (j / 8) % 2 == 0 && !(i >= 40 && i < 90 && j >= 50 && j < 120);
+  });
+  LithographyModel lithography;
+
+  SECTION("in simulateExposure's geometry") {
+    auto whole = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    whole->initializeGrid(rows, cols);
+    lithography.simulateExposure(whole, 13.5, 0.33, mask);
+    auto tiled = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    tiled->initializeGrid(rows, cols);
+    LithographyModel::TiledExposureOptions options;
+    options.tile_size = 64;
+    lithography.simulateTiledExposure(tiled, 13.5, 0.33, LithographyModel::maskSource(mask), options);
+    REQUIRE((tiled->getPhotoresistPattern() == whole->getPhotoresistPattern()).all());
+  }
+
+  SECTION("with an explicit pitch and a halo smaller than the field") {
+    LithographyModel::TiledExposureOptions options;
+    options.pitch_x = options.pitch_y = 10.0;
+    options.tile_size = 1;
+    const auto tiles = lithography.planExposureTiles(rows, cols, 193.0, 0.9, options);
+    REQUIRE(tiles.size() == 12);
+    REQUIRE(tiles[0].rows == 64);
+    REQUIRE(tiles[0].halo_rows == 17);
+    REQUIRE(tiles.back().rows == rows - 128);
+    REQUIRE(tiles.back().cols == cols - 192);
+
+    auto tiled = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    tiled->initializeGrid(rows, cols);
+    lithography.simulateTiledExposure(tiled, 193.0, 0.9, LithographyModel::maskSource(mask), options);
+    options.tile_size = 256;
+    REQUIRE(lithography.planExposureTiles(rows, cols, 193.0, 0.9, options).size() == 1);
+    auto whole = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    whole->initializeGrid(rows, cols);
+    lithography.simulateTiledExposure(whole, 193.0, 0.9, LithographyModel::maskSource(mask), options);
+
+    const Eigen::ArrayXXd pattern = tiled->getPhotoresistPattern();
+    REQUIRE((pattern == whole->getPhotoresistPattern()).all());
+    // Resolved lines: an open line is printed, a dark one and the block are not
+    REQUIRE(pattern(10, 4) == 1.0);
+    REQUIRE(pattern(10, 12) == 0.0);
+    REQUIRE(pattern(65, 84) == 0.0);
+  }
+}
+
+TEST_CASE("Field exposure steps the reticle with per-field dose and focus", "[Photolithography]") {
+  // Lines and spaces 8 cells each, resolved at a 10 nm pitch
+  const BitMask reticle = BitMask::fromPredicate(64, 64, [](int, int j) { return (j / 8) % 2 == 0; });
+  LithographyModel lithography;
+
+  const auto shots = LithographyModel::planShotMap(130, 190, 64, 64);
+  REQUIRE(shots.size() == 9);
+  REQUIRE(shots[0].row == -31);
+  REQUIRE(shots[0].col == -1);
+  REQUIRE(shots.back().row == 97);
+  REQUIRE_THROWS_AS(LithographyModel::planShotMap(130, 190, 0, 64), std::invalid_argument);
+
+  SECTION("nominal fields print simulateExposure's pattern") {
+    auto single = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    single->initializeGrid(64, 64);
+    lithography.simulateExposure(single, 13.5, 0.33, reticle);
+    auto stepped = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    stepped->initializeGrid(128, 192);
+    lithography.simulateFieldExposure(stepped, 13.5, 0.33, reticle, LithographyModel::planShotMap(128, 192, 64, 64));
+    const Eigen::ArrayXXd field = single->getPhotoresistPattern();
+    const Eigen::ArrayXXd pattern = stepped->getPhotoresistPattern();
+    REQUIRE((pattern.block(0, 0, 64, 64) == field).all());
+    REQUIRE((pattern.block(64, 128, 64, 64) == field).all());
+  }
+
+  SECTION("dose moves the threshold and focus blurs the image") {
+    auto fields = LithographyModel::planShotMap(128, 192, 64, 64);
+    fields[1].dose = 0.6;
+    fields[2].dose = 1.5;
+    fields[3].focus = 400.0;
+    fields[4].focus = 400.0;
+    SpectrumCache::instance().clear();
+    auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    wafer->initializeGrid(128, 192);
+    lithography.simulateFieldExposure(wafer, 193.0, 0.9, reticle, fields, 10.0, 10.0);
+    // One reticle spectrum and a PSF per focus
+    REQUIRE(SpectrumCache::instance().statistics().misses == 3);
+
+    const Eigen::ArrayXXd pattern = wafer->getPhotoresistPattern();
+    auto printed = [&](int k) { return pattern.block(fields[k].row, fields[k].col, 64, 64).sum(); };
+    REQUIRE(printed(1) < printed(0));
+    REQUIRE(printed(2) > printed(0));
+    REQUIRE(printed(3) != printed(0));
+    REQUIRE((pattern.block(0, 64, 64, 64) != pattern.block(0, 0, 64, 64)).any());
+    REQUIRE((pattern.block(64, 0, 64, 64) == pattern.block(64, 64, 64, 64)).all());
+    REQUIRE((pattern.block(64, 128, 64, 64) == pattern.block(0, 0, 64, 64)).all());
+
+    fields[0].dose = 0.0;
+    REQUIRE_THROWS_AS(lithography.simulateFieldExposure(wafer, 193.0, 0.9, reticle, fields, 10.0, 10.0),
+                      std::invalid_argument);
+  }
+}
+
+TEST_CASE("Resist development marches the developer through the film", "[Photolithography]") {
+  ResistDevelopment::Parameters parameters;
+  parameters.absorption = 0.0;
+  const ResistDevelopment development(parameters);
+  const double layer = parameters.thickness / 32;
+
+  SECTION("a uniform image develops straight down at Mack's rate") {
+    const auto profile = development.develop(Eigen::ArrayXXd::Constant(6, 5, 0.8), 10.0, 10.0);
+    const double rate = development.rate(development.inhibitor(0.8, 0.0));
+    REQUIRE(std::abs(profile.arrival(3, 2, 31) - 31.5 * layer / rate) < 1e-9);
+    REQUIRE(std::abs(profile.remaining(10.0 * layer / rate)(0, 0) - (parameters.thickness - 10.0 * layer)) < 1e-9);
+    REQUIRE(profile.cleared(profile.arrival(0, 0, 31)).count() == 30);
+  }
+
+  SECTION("parallel slabs and narrow bands match the serial march") {
+    Eigen::ArrayXXd image(48, 40);
+    for (int i = 0; i < 48; ++i) {
+      for (int j = 0; j < 40; ++j) {
+        image(i, j) = 0.5 + 0.5 * std::cos(0.3 * j) * std::cos(0.2 * i);
+      }
+    }
+    const auto serial = development.develop(image, 10.0, 10.0, ResistDevelopment::Options(32, 1e300, 1));
+    const auto slabs = development.develop(image, 10.0, 10.0, ResistDevelopment::Options(32, 1e300, 4));
+    const auto band = development.develop(image, 10.0, 10.0, ResistDevelopment::Options(32, 2.0, 1));
+    REQUIRE(slabs.passes() > 1);
+    for (int i = 0; i < 48; ++i) {
+      for (int j = 0; j < 40; ++j) {
+        for (int k = 0; k < 32; ++k) {
+          const double t = serial.arrival(i, j, k);
+          REQUIRE(std::abs(slabs.arrival(i, j, k) - t) <= 1e-9 * t);
+          REQUIRE((t <= 2.0 ? band.arrival(i, j, k) == t : std::isinf(band.arrival(i, j, k))));
+        }
+      }
+    }
+
+    // A develop-time sweep over the one solve clears more and thins the film
+    std::size_t last = 0;
+    for (double time : {0.5, 1.0, 2.0, 5.0, 50.0}) {
+      const std::size_t clear = serial.cleared(time).count();
+      REQUIRE(clear >= last);
+      last = clear;
+    }
+    REQUIRE(last > 0);
+    REQUIRE(last < 48 * 40);
+    REQUIRE((serial.remaining(2.0) <= serial.remaining(1.0)).all());
+  }
+
+  SECTION("the lithography model develops its image") {
+    const BitMask mask = BitMask::fromPredicate(64, 64, [](int, int j) { return (j / 8) % 2 == 0; });
+    LithographyModel lithography;
+    const auto profile = lithography.developExposure(development, mask, 193.0, 0.9, 64, 64, 10.0, 10.0);
+    const BitMask printed = profile.cleared(5.0);
+    REQUIRE(printed.test(32, 4));
+    REQUIRE(!printed.test(32, 12));
+    const Eigen::ArrayXXd film = profile.remaining(5.0);
+    REQUIRE(film(32, 4) == 0.0);
+    REQUIRE(film(32, 12) > 0.5 * parameters.thickness);
+
+    auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    wafer->initializeGrid(64, 64);
+    lithography.setResistDevelopment(std::make_shared<ResistDevelopment>(parameters), 5.0);
+    lithography.simulateExposure(wafer, 193.0, 0.9, mask);
+    const BitMask developed = lithography.developExposure(development, mask, 193.0, 0.9, 64, 64).cleared(5.0);
+    REQUIRE((wafer->getPhotoresistPattern() == developed.toField()).all());
+  }
+
+  parameters.selectivity = 1.0;
+  REQUIRE_THROWS_AS(ResistDevelopment{parameters}, std::invalid_argument);
+}
+
+TEST_CASE("Model-based OPC places the printed edges on the target", "[Photolithography]") {
+  const int n = 128;
+  HopkinsImaging::Optics optics(193.0, 0.9, 0.5, 20.0, 20.0);
+  auto imaging = std::make_shared<HopkinsImaging>();
+
+  // Two 80 nm lines beside a box: line ends pull back and the narrow gap
+  // bridges without correction
+  BitMask target = BitMask::fromPredicate(n, n, [](int i, int j) {
+    const bool lines = i >= 32 && i < 96 && ((j >= 40 && j < 44) || (j >= 52 && j < 56));
+    const bool box = i >= 56 && i < 72 && j >= 72 && j < 88;
+    return lines || box;
+  });
+
+  ModelBasedOpc::Options options;
+  options.max_iterations = 0;
+  const auto uncorrected = ModelBasedOpc(imaging, options).correct(target, optics);
+  REQUIRE(uncorrected.fragments > 0);
+  REQUIRE(uncorrected.max_edge_error > options.tolerance);
+
+  ModelBasedOpc opc(imaging);
+  const auto result = opc.correct(target, optics);
+  REQUIRE(result.converged);
+  REQUIRE(result.iterations >= 1);
+  REQUIRE(result.max_edge_error <= ModelBasedOpc::Options().tolerance);
+  REQUIRE(result.cells_reconvolved > 0);
+  // The incrementally updated image is the mask's own
+  REQUIRE((opc.aerialImage(result.mask, optics) - result.image).abs().maxCoeff() < 1e-9);
+
+  REQUIRE_THROWS_AS(ModelBasedOpc(nullptr), std::invalid_argument);
+}
+
+TEST_CASE("Spectrum cache shares mask and kernel transforms across engines", "[Photolithography]") {
+  SpectrumCache& cache = SpectrumCache::instance();
+  cache.clear();
+  const std::size_t budget = cache.memoryBudget();
+  const auto mask_hits = Profiler::getInstance().getCacheStats("SpectrumCache/mask").hits;
+  const int n = 32;
+  HopkinsImaging::Optics optics(193.0, 0.9, 0.5, 20.0, 20.0);
+  Eigen::ArrayXXd grating(2 * n, 2 * n);
+  for (int i = 0; i < 2 * n; ++i) {
+    for (int j = 0; j < 2 * n; ++j) {
+      grating(i, j) = (j / 5) % 2;
+    }
+  }
+
+  // A second engine reuses the first one's mask and kernel spectra
+  HopkinsImaging first, second;
+  auto image = first.aerialImage(grating, optics, n, n);
+  const auto cold = cache.statistics();
+  REQUIRE(cold.hits == 0);
+  REQUIRE(cold.entries == 2);
+  REQUIRE((second.aerialImage(grating, optics, n, n) - image).abs().maxCoeff() < 1e-12);
+  REQUIRE(cache.statistics().hits == 2);
+  REQUIRE(cache.statistics().entries == 2);
+  REQUIRE(Profiler::getInstance().getCacheStats("SpectrumCache/mask").hits > mask_hits);
+
+  // Models with the same optics share the PSF and the reticle's spectrum
+  std::vector<std::vector<int>> mask = {{1, 0, 1}, {0, 1, 0}, {1, 0, 1}};
+  auto exposed = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  exposed->initializeGrid(10, 10);
+  LithographyModel().simulateExposure(exposed, 13.5, 0.33, mask);
+  const auto before = cache.statistics();
+  auto again = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  again->initializeGrid(10, 10);
+  LithographyModel().simulateExposure(again, 13.5, 0.33, mask);
+  REQUIRE(cache.statistics().hits == before.hits + 2);
+  REQUIRE(cache.statistics().misses == before.misses);
+  REQUIRE((again->getPhotoresistPattern() == exposed->getPhotoresistPattern()).all());
+
+  // Shrinking the budget evicts least recently used entries first
+  cache.setMemoryBudget(cache.statistics().bytes - 1);
+  REQUIRE(cache.statistics().entries < before.entries);
+  REQUIRE(cache.statistics().bytes < cache.memoryBudget());
+  cache.setMemoryBudget(budget);
+  cache.clear();
+}
+
+TEST_CASE("EUV shot noise is fixed by seed and realization", "[Photolithography]") {
+  // Bright lines 16 columns wide on a dark field
+  Eigen::ArrayXXd image = Eigen::ArrayXXd::Zero(64, 64);
+  image.middleCols(8, 16).setConstant(4.0);
+  image.middleCols(40, 16).setConstant(4.0);
+
+  EUVLithography euv, same, other;
+  euv.setStochasticSeed(11);
+  same.setStochasticSeed(11);
+  other.setStochasticSeed(12);
+  const Eigen::ArrayXXd noisy = euv.simulateStochasticEffects(image, 5);
+  REQUIRE((same.simulateStochasticEffects(image, 5) == noisy).all());
+  REQUIRE((euv.simulateStochasticEffects(image, 6) != noisy).any());
+  REQUIRE((other.simulateStochasticEffects(image, 5) != noisy).any());
+  // Successive draws take the realizations in turn
+  REQUIRE((same.simulateStochasticEffects(image) == euv.simulateStochasticEffects(image, 0)).all());
+  REQUIRE((same.simulateStochasticEffects(image) == euv.simulateStochasticEffects(image, 1)).all());
+
+  // A pixel expecting N photons varies by 1 / sqrt(N) about its intensity
+  const Eigen::ArrayXXd bright = noisy.middleCols(8, 16) - 4.0;
+  const double mean = bright.mean();
+  const double deviation = std::sqrt((bright - mean).square().mean());
+  const double expected = 1.0 / std::sqrt(4.0 * 20e-3 * 1e-14 / (6.626e-34 * 3e8 / 13.5e-9));
+  REQUIRE(std::abs(mean) < 0.02);
+  REQUIRE(std::abs(deviation - expected) < 0.1 * expected);
+}
+
+TEST_CASE("EUV stochastic statistics measure the printed lines reproducibly", "[Photolithography]") {
+  Eigen::ArrayXXd image = Eigen::ArrayXXd::Zero(64, 64);
+  image.middleCols(8, 16).setConstant(4.0);
+  image.middleCols(40, 16).setConstant(4.0);
+  EUVLithography euv, same;
+  euv.setStochasticSeed(3);
+  same.setStochasticSeed(3);
+
+  // At this dose the lines always print and dark cells print by noise alone
+  const auto stats = euv.simulateStochasticRealizations(image, 10.0, 64);
+  REQUIRE(stats.realizations == 64);
+  REQUIRE(stats.mean_width > 16.0);
+  REQUIRE(stats.line_width_roughness > 0.0);
+  REQUIRE(stats.local_cd_uniformity > 0.0);
+  REQUIRE(stats.defect_probability == 1.0);
+  REQUIRE(stats.flipped_cell_fraction > 0.0);
+  REQUIRE(stats.flipped_cell_fraction < 0.1);
+  const auto again = same.simulateStochasticRealizations(image, 10.0, 64);
+  REQUIRE(again.mean_width == stats.mean_width);
+  REQUIRE(again.line_width_roughness == stats.line_width_roughness);
+  REQUIRE(again.flipped_cell_fraction == stats.flipped_cell_fraction);
+
+  // A field far above threshold prints whole every time
+  const auto flat = euv.simulateStochasticRealizations(Eigen::ArrayXXd::Constant(32, 32, 4.0), 100.0, 16);
+  REQUIRE(flat.mean_width == 32.0);
+  REQUIRE(flat.line_width_roughness == 0.0);
+  REQUIRE(flat.local_cd_uniformity == 0.0);
+  REQUIRE(flat.defect_probability == 0.0);
+  REQUIRE_THROWS_AS(euv.simulateStochasticRealizations(image, 10.0, 0), std::invalid_argument);
+}
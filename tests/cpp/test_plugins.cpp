@@ -0,0 +1,146 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/wafer.hpp"
+#include "../../src/cpp/core/plugin_manager.hpp"
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+class ThinningPlugin : public SemiPRO::ProcessModulePlugin {
+public:
+  std::string getName() const override { return "thinning"; }
+  std::string getVersion() const override { return "2.0"; }
+  std::string getDescription() const override { return "Removes a fixed depth from the grid"; }
+  bool initialize() override { return true; }
+  void cleanup() override {}
+  void execute(Wafer& wafer) override { wafer.getGrid() -= depth_; }
+  void setParameters(const std::unordered_map<std::string, double>& params) override { depth_ = params.at("depth"); }
+  std::unordered_map<std::string, double> getResults() const override { return {}; }
+  std::vector<std::string> reads() const override { return {"grid"}; }
+  std::vector<std::string> writes() const override { return {"grid"}; }
+  std::vector<std::string> resultNames() const override { return {"mean_height"}; }
+  void executeBatch(Wafer* const* wafers, size_t count, SemiPRO::PluginResults& results) override {
+    double* mean = results.values(results.column("mean_height"));
+    for (size_t i = 0; i < count; ++i) {
+      execute(*wafers[i]);
+      mean[i] = wafers[i]->getGrid().mean();
+    }
+  }
+
+private:
+  double depth_ = 0.0;
+};
+
+// Single-wafer interface only
+class ThicknessPlugin : public SemiPRO::AnalysisPlugin {
+public:
+  std::string getName() const override { return "thickness"; }
+  std::string getVersion() const override { return "1.0"; }
+  std::string getDescription() const override { return "Reports the wafer thickness"; }
+  bool initialize() override { return true; }
+  void cleanup() override {}
+  std::unordered_map<std::string, double> analyze(const Wafer& wafer) override {
+    return {{"thickness", wafer.getThickness()}};
+  }
+  void generateReport(const std::string&) override {}
+};
+
+} // namespace
+
+TEST_CASE("Plugin handles run batches of wafers into typed results", "[Plugins]") {
+  SemiPRO::PluginManager manager;
+  auto thinning = std::make_shared<ThinningPlugin>();
+  thinning->setParameters({{"depth", 0.5}});
+  REQUIRE(manager.addPlugin(thinning));
+  REQUIRE(manager.addPlugin(std::make_shared<ThicknessPlugin>()));
+
+  const SemiPRO::ProcessModuleHandle process = manager.processModule("thinning");
+  const SemiPRO::AnalysisHandle analysis = manager.analysisPlugin("thickness");
+  REQUIRE(process);
+  REQUIRE(analysis);
+  REQUIRE_FALSE(manager.processModule("thickness"));
+  REQUIRE_FALSE(manager.analysisPlugin("missing"));
+  REQUIRE(process.abiVersion() == SemiPRO::kPluginAbiVersion);
+  REQUIRE(process.reads() == std::vector<std::string>{"grid"});
+  REQUIRE(process.writes() == std::vector<std::string>{"grid"});
+  REQUIRE(analysis.reads() == std::vector<std::string>{"*"});
+  REQUIRE(analysis.writes().empty());
+
+  std::vector<std::unique_ptr<Wafer>> wafers;
+  std::vector<Wafer*> span;
+  for (int i = 0; i < 3; ++i) {
+    wafers.push_back(std::make_unique<Wafer>(300.0, 700.0 + 25.0 * i, "silicon"));
+    wafers.back()->initializeGrid(8, 8);
+    wafers.back()->getGrid().setConstant(i);
+    span.push_back(wafers.back().get());
+  }
+  SemiPRO::PluginResults results;
+  process.execute(span.data(), span.size(), results);
+  REQUIRE(results.rows() == 3);
+  for (size_t i = 0; i < span.size(); ++i) {
+    REQUIRE(std::abs(results.get(i, "mean_height") - (i - 0.5)) < 1e-12);
+  }
+
+  // The default batch falls back to analyze() per wafer
+  std::vector<const Wafer*> const_span(span.begin(), span.end());
+  analysis.analyze(const_span.data(), const_span.size(), results);
+  REQUIRE(results.column("mean_height") == -1);
+  REQUIRE(std::abs(results.get(2, "thickness") - 750.0) < 1e-12);
+  REQUIRE(std::abs(results.row(1).at("thickness") - 725.0) < 1e-12);
+  REQUIRE(std::isnan(results.get(0, "missing")));
+
+  // Handles keep their plugin past unloading
+  REQUIRE(manager.unloadPlugin("thinning"));
+  REQUIRE_FALSE(manager.isPluginLoaded("thinning"));
+  process.execute(span.data(), 1, results);
+  REQUIRE(std::abs(results.get(0, "mean_height") + 1.0) < 1e-12);
+}
+
+TEST_CASE("Plugin discovery reads manifests and cached metadata without loading", "[Plugins]") {
+  const auto root = std::filesystem::temp_directory_path() / "semipro_plugin_discovery";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+  // Not loadable: any dlopen of these would fail
+  std::ofstream(root / "thinning.so") << "not a library";
+  std::ofstream(root / "cached.so") << "not a library either";
+  std::ofstream(root / "thinning.so.plugin") << "name=thinning\nversion=2.0\nabi=2\nreads=grid\nwrites=grid\n";
+  const auto cached = root / "cached.so";
+  const auto cache = root / "metadata.cache";
+  std::ofstream(cache) << cached.string() << '\t' << std::filesystem::file_size(cached) << '\t'
+                       << std::filesystem::last_write_time(cached).time_since_epoch().count()
+                       << "\t0\t1\tcached\t1.0\tFrom the cache\t*\t*\t\n";
+
+  SemiPRO::PluginManager manager;
+  manager.addPluginDirectory(root.string());
+  manager.setMetadataCache(cache.string());
+  manager.scanPluginDirectories();
+  REQUIRE(manager.isPluginAvailable("thinning"));
+  REQUIRE(manager.isPluginAvailable("cached"));
+  REQUIRE_FALSE(manager.isPluginLoaded("thinning"));
+  bool described = false;
+  for (const auto& info : manager.getAvailablePlugins()) {
+    if (info.name == "thinning") {
+      described = info.abi_version == 2 && info.reads == std::vector<std::string>{"grid"} && !info.instance;
+    }
+  }
+  REQUIRE(described);
+
+  // First use loads; a library that fails is dropped
+  REQUIRE_FALSE(manager.getPlugin("thinning"));
+  REQUIRE_FALSE(manager.isPluginAvailable("thinning"));
+
+  // A changed library is validated again rather than taken from the cache
+  std::ofstream(cached, std::ios::app) << "edited";
+  SemiPRO::PluginManager rescanned;
+  rescanned.addPluginDirectory(root.string());
+  rescanned.setMetadataCache(cache.string());
+  rescanned.scanPluginDirectories();
+  REQUIRE_FALSE(rescanned.isPluginAvailable("cached"));
+  REQUIRE(rescanned.isPluginAvailable("thinning"));
+  std::filesystem::remove_all(root);
+}
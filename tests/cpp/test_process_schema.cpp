@@ -0,0 +1,67 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/process_schema.hpp"
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+struct Bake {
+  double temperature = 0.0;
+  double time = 0.0;
+  std::string gas = "unset";
+  std::string species = "unset";
+};
+
+const ProcessSchema<Bake>& bakeSchema() {
+  static const ProcessSchema<Bake> schema(
+      {
+          {"temperature", [](Bake& b, double v) { b.temperature = v; }, 900.0, "tests.schema.bake_temperature"},
+          {"time", [](Bake& b, double v) { b.time = v; }, 2.0},
+          {"species", [](Bake& b, double v) { b.species = v > 0.5 ? "boron" : "arsenic"; }, 0.0},
+      },
+      {
+          {"gas", [](Bake& b, const std::string& v) { b.gas = v; }, "N2"},
+          {"species", [](Bake& b, const std::string& v) { b.species = v; }},
+      });
+  return schema;
+}
+
+} // namespace
+
+TEST_CASE("Process schemas bind declared keys and fill in defaults", "[ProcessSchema]") {
+  const auto& schema = bakeSchema();
+  const Bake defaults = schema.defaults();
+  REQUIRE(defaults.temperature == 900.0);
+  REQUIRE(defaults.time == 2.0);
+  REQUIRE(defaults.gas == "N2");
+  REQUIRE(defaults.species == "arsenic");
+
+  // Undeclared keys are ignored
+  const Bake bound = schema.bind({{"time", 0.5}, {"pressure", 3.0}, {"species", 1.0}}, {{"gas", "O2"}});
+  REQUIRE(bound.temperature == 900.0);
+  REQUIRE(bound.time == 0.5);
+  REQUIRE(bound.gas == "O2");
+  REQUIRE(bound.species == "boron");
+
+  // A text value wins over a numeric one for the same member
+  REQUIRE(schema.bind({{"species", 1.0}}, {{"species", "phosphorus"}}).species == "phosphorus");
+
+  // The same keys from a YAML mapping
+  const Bake yaml = schema.bind(YAML::Load("{temperature: 1050, gas: H2, species: 1}"));
+  REQUIRE(yaml.temperature == 1050.0);
+  REQUIRE(yaml.time == 2.0);
+  REQUIRE(yaml.gas == "H2");
+  REQUIRE(yaml.species == "1");
+  REQUIRE_THROWS_AS(schema.bind(YAML::Load("{time: long}")), YAML::Exception);
+}
+
+TEST_CASE("Process schema defaults follow their configuration path", "[ProcessSchema]") {
+  const auto& schema = bakeSchema();
+  CONFIG_SET("tests.schema.bake_temperature", 975.0);
+  REQUIRE(schema.defaults().temperature == 975.0);
+  // A key given with the step still wins
+  REQUIRE(schema.bind({{"temperature", 800.0}}).temperature == 800.0);
+
+  CONFIG_SET("tests.schema.bake_temperature", 1010.0);
+  REQUIRE(schema.defaults().temperature == 1010.0);
+}
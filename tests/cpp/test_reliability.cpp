@@ -4,8 +4,11 @@
 #include "../../src/cpp/modules/thermal/thermal_model.hpp"
 #include "../../src/cpp/modules/packaging/packaging_model.hpp"
 #include <memory>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
 
 void test_reliability() {
     // Initialize wafer
@@ -75,7 +78,107 @@ void test_reliability() {
     std::cout << "Reliability test passed\n";
 }
 
+void test_failure_sampling() {
+    auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    wafer->initializeGrid(10, 10);
+    Eigen::ArrayXXd mttf = Eigen::ArrayXXd::Zero(10, 10);
+    mttf.block(2, 2, 3, 3).setConstant(1e9); // Nine equal segments
+    wafer->setElectromigrationMTTF(mttf);
+
+    // The first of n equal Weibull segments is Weibull with its scale
+    // divided by n^(1/beta), so the chip median is t50 / 3 for beta = 2
+    ReliabilityModel reliability;
+    FailureSamplingOptions options;
+    options.distribution = FailureSamplingOptions::Distribution::WEIBULL;
+    options.samples = 200000;
+    auto chips = reliability.sampleChipFailures(wafer, options);
+    assert(chips.segments == 9);
+    assert(std::abs(chips.median / (1e9 / 3.0) - 1.0) < 0.01);
+    assert(std::is_sorted(chips.failure_times.begin(), chips.failure_times.end()));
+
+    // Lognormal chips fail before their segments' median, and more so in series
+    options.distribution = FailureSamplingOptions::Distribution::LOGNORMAL;
+    chips = reliability.sampleChipFailures(wafer, options);
+    assert(chips.median < 1e9);
+    assert(std::abs(chips.cdf(chips.median) - 0.5) < 1e-3);
+    options.copies = 4;
+    assert(reliability.sampleChipFailures(wafer, options).median < chips.median);
+
+    // The same seed gives the same samples
+    options.copies = 1;
+    assert(reliability.sampleChipFailures(wafer, options).failure_times == chips.failure_times);
+
+    wafer->setElectromigrationMTTF(Eigen::ArrayXXd::Zero(10, 10));
+    bool threw = false;
+    try {
+        reliability.sampleChipFailures(wafer, options);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Failure sampling test passed\n";
+}
+
+void test_thermal_fatigue() {
+    // ASTM E1049's rainflow example: half cycles of 3, 4, 6, 8 and 9 and a
+    // full cycle of 4, so with damage equal to the range the history's
+    // total is 23; 2.5 cycles close on the way, the rest is residue
+    ThermalFatigueOptions options;
+    options.reference_range = 1.0;
+    options.cycles_to_failure = 1.0;
+    options.exponent = 1.0;
+    options.hysteresis = 0.0;
+    ThermalFatigueCounter counter(1, 2, options);
+    const double history[] = {-2, 1, -3, 5, -1, 3, -4, 4, -2};
+    Eigen::ArrayXXd sample(1, 2);
+    for (double t : history) {
+        sample << t, 2.0 * t + 300.0; // The second cell swings twice as far
+        counter.addSample(sample);
+    }
+    assert(counter.samples() == 9);
+    assert(std::abs(counter.cycles()(0, 0) - 2.5) < 1e-12);
+    assert(std::abs(counter.damageWithResidue()(0, 0) - 23.0) < 1e-12);
+    assert(std::abs(counter.damageWithResidue()(0, 1) - 46.0) < 1e-12);
+    assert(std::abs(counter.lifetime(46.0)(0, 1) - 1.0) < 1e-12);
+
+    // A long cyclic history in a short stack: every cycle is counted, and
+    // swings within the hysteresis are not
+    options.reference_range = 100.0;
+    options.cycles_to_failure = 1000.0;
+    options.exponent = 2.0;
+    options.hysteresis = 0.5;
+    options.max_reversals = 3;
+    ThermalFatigueCounter cycling(4, 4, options);
+    for (int cycle = 0; cycle < 500; ++cycle) {
+        cycling.addSample(25.0);
+        cycling.addSample(25.3);
+        cycling.addSample(125.0);
+    }
+    assert(std::abs(cycling.damageWithResidue()(2, 3) - 0.5) < 0.002); // 500 cycles of 100 K
+    assert((cycling.damageWithResidue() == cycling.damageWithResidue()(0, 0)).all());
+
+    // The wafer's temperature profile feeds a counter of its grid
+    auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+    wafer->initializeGrid(10, 10);
+    ReliabilityModel reliability;
+    ThermalFatigueCounter grid(10, 10);
+    reliability.accumulateThermalFatigue(wafer, grid);
+    assert(grid.samples() == 1);
+    bool threw = false;
+    try {
+        reliability.accumulateThermalFatigue(wafer, cycling);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Thermal fatigue test passed\n";
+}
+
 int main() {
     test_reliability();
+    test_failure_sampling();
+    test_thermal_fatigue();
     return 0;
 }
\ No newline at end of file
@@ -8,6 +8,18 @@
 #include "../../src/cpp/modules/metallization/metallization_model.hpp"
 #include "../../src/cpp/modules/packaging/packaging_model.hpp"
 #include "../../src/cpp/modules/thermal/thermal_model.hpp"
+#include "../../src/cpp/core/field_update_bridge.hpp"
+#include "../../src/cpp/core/depth_mesh.hpp"
+#include "../../src/cpp/core/field_volume.hpp"
+#include "../../src/cpp/core/png_writer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
 
 TEST_CASE("Renderer initialization", "[Renderer]") {
   VulkanRenderer renderer(400, 400);
@@ -114,4 +126,143 @@ TEST_CASE("Renderer with thermal simulation", "[Renderer]") {
   VulkanRenderer renderer(400, 400);
   renderer.initialize();
   REQUIRE_NOTHROW(renderer.render(wafer));
-}
\ No newline at end of file
+}
+
+TEST_CASE("Field update bridge coalesces dirty rectangles per channel", "[Renderer]") {
+  Wafer wafer(300.0, 775.0, "silicon");
+  wafer.initializeGrid(8, 6);
+  const FieldStore& fields = wafer.getFieldStore();
+  FieldUpdateBridge bridge;
+
+  wafer.getGrid().block(1, 1, 2, 2) = 1.0;
+  bridge.publish(fields, Wafer::kGridField, FieldRect{1, 1, 2, 2});
+  wafer.getGrid()(5, 4) = 2.0;
+  bridge.publish(fields, Wafer::kGridField, FieldRect{5, 4, 1, 1});
+  bridge.publish(fields, Wafer::kTemperatureField, FieldRect{0, 0, 0, 3});
+  REQUIRE(bridge.pendingCount() == 1);
+  REQUIRE_THROWS_AS(bridge.publish(fields, Wafer::kGridField, FieldRect{7, 5, 2, 1}), std::invalid_argument);
+
+  std::vector<FieldUpdate> updates = bridge.take();
+  REQUIRE(updates.size() == 1);
+  const FieldUpdate& grid = updates.front();
+  REQUIRE(grid.rect.row == 1);
+  REQUIRE(grid.rect.col == 1);
+  REQUIRE(grid.rect.rows == 5);
+  REQUIRE(grid.rect.cols == 4);
+  REQUIRE(grid.version == fields.version(Wafer::kGridField));
+  Eigen::Map<const Eigen::ArrayXXf> values(grid.values.data(), 5, 4);
+  REQUIRE((values == wafer.getGrid().block(1, 1, 5, 4).cast<float>()).all());
+  REQUIRE(bridge.pendingCount() == 0);
+
+  // Publishing from another thread while the consumer takes never loses
+  // the latest values
+  std::thread producer([&] {
+    for (int step = 0; step < 200; ++step) {
+      wafer.getGrid()(step % 8, 0) = step;
+      bridge.publish(fields, Wafer::kGridField, FieldRect{step % 8, 0, 1, 1});
+    }
+  });
+  Eigen::ArrayXXf mirror = Eigen::ArrayXXf::Zero(8, 6);
+  auto apply = [&](const std::vector<FieldUpdate>& batch) {
+    for (const FieldUpdate& u : batch) {
+      mirror.block(u.rect.row, u.rect.col, u.rect.rows, u.rect.cols) =
+          Eigen::Map<const Eigen::ArrayXXf>(u.values.data(), u.rect.rows, u.rect.cols);
+    }
+  };
+  while (bridge.publishedCount() < 202) {
+    apply(bridge.take());
+  }
+  producer.join();
+  apply(bridge.take());
+  REQUIRE((mirror.col(0) == wafer.getGrid().col(0).cast<float>()).all());
+}
+
+TEST_CASE("Field volumes skip bricks the transfer function hides", "[Renderer]") {
+  // A dopant profile spread under an implant window
+  DepthMesh mesh = DepthMesh::cells(1.0, 40);
+  Eigen::ArrayXd profile = (-((mesh.nodes() - 0.2) / 0.05).square()).exp() * 1e18;
+  Eigen::ArrayXXd window = Eigen::ArrayXXd::Zero(20, 12);
+  window.block(2, 3, 6, 2) = 1.0;
+  FieldVolume volume = FieldVolume::fromProfile(window, mesh, profile, 20);
+  REQUIRE(volume.rows() == 20);
+  REQUIRE(volume.slices() == 20);
+  double column = 0.0;
+  for (int s = 0; s < volume.slices(); ++s) {
+    column += volume(3, 3, s) * 0.05;
+  }
+  REQUIRE(std::abs(column - mesh.integrate(profile)) < 1e-4 * mesh.integrate(profile));
+  REQUIRE(volume(10, 10, 4) == 0.0f);
+
+  TransferFunction transfer = TransferFunction::heat(1e16f, 1e18f);
+  REQUIRE(transfer(0.0f)[3] == 0.0f);
+  REQUIRE(transfer(2e18f)[3] == 1.0f);
+  REQUIRE(std::abs(transfer(1e16f + (1e18f - 1e16f) / 6.0f)[3] - 0.05f) < 1e-6f);
+
+  BrickMap bricks(volume);
+  REQUIRE(bricks.rows() == 3);
+  REQUIRE(bricks.cols() == 2);
+  REQUIRE(bricks.slices() == 3);
+  std::vector<uint8_t> occupied = bricks.occupancy(transfer);
+  // Only the window's column at the profile's depth is drawn; the window
+  // ends on row 7, which the next brick down takes in as its border
+  auto at = [&](int r, int c, int s) { return occupied[r + bricks.rows() * (c + bricks.cols() * s)]; };
+  REQUIRE(at(0, 0, 0) == 1);
+  REQUIRE(at(0, 1, 0) == 0);
+  REQUIRE(at(1, 0, 0) == 1);
+  REQUIRE(at(2, 0, 0) == 0);
+  REQUIRE(at(0, 0, 2) == 0);
+  REQUIRE(std::count(occupied.begin(), occupied.end(), 1) == 2);
+
+  REQUIRE_THROWS_AS(TransferFunction({{1.0f, {0, 0, 0, 0}}, {1.0f, {1, 1, 1, 1}}}), std::invalid_argument);
+  REQUIRE_THROWS_AS(FieldVolume::fromPlanes({Eigen::ArrayXXd::Zero(2, 2), Eigen::ArrayXXd::Zero(3, 2)}),
+                    std::invalid_argument);
+}
+
+TEST_CASE("PNG writer round trips RGBA pixels", "[Renderer]") {
+  const uint32_t width = 5, height = 3;
+  std::vector<uint8_t> rgba(width * height * 4);
+  for (std::size_t i = 0; i < rgba.size(); ++i) {
+    rgba[i] = static_cast<uint8_t>(i * 37 + 11);
+  }
+  const std::vector<uint8_t> png = PngWriter::encode(rgba.data(), width, height);
+  const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  REQUIRE(std::equal(signature, signature + 8, png.begin()));
+
+  // Walk the chunks, checking each CRC and gathering the image data
+  auto u32 = [&](std::size_t at) {
+    return uint32_t(png[at]) << 24 | uint32_t(png[at + 1]) << 16 | uint32_t(png[at + 2]) << 8 | png[at + 3];
+  };
+  std::vector<std::string> types;
+  std::vector<uint8_t> idat;
+  for (std::size_t at = 8; at < png.size();) {
+    const uint32_t bytes = u32(at);
+    const std::string type(png.begin() + at + 4, png.begin() + at + 8);
+    REQUIRE(u32(at + 8 + bytes) == crc32(0L, png.data() + at + 4, bytes + 4));
+    if (type == "IHDR") {
+      REQUIRE(u32(at + 8) == width);
+      REQUIRE(u32(at + 12) == height);
+      REQUIRE(png[at + 16] == 8);
+      REQUIRE(png[at + 17] == 6);
+    } else if (type == "IDAT") {
+      idat.insert(idat.end(), png.begin() + at + 8, png.begin() + at + 8 + bytes);
+    }
+    types.push_back(type);
+    at += 12 + bytes;
+  }
+  REQUIRE(types == std::vector<std::string>{"IHDR", "IDAT", "IEND"});
+
+  std::vector<uint8_t> filtered(height * (width * 4 + 1));
+  uLongf size = filtered.size();
+  REQUIRE(uncompress(filtered.data(), &size, idat.data(), idat.size()) == Z_OK);
+  REQUIRE(size == filtered.size());
+  std::vector<uint8_t> decoded;
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint8_t* row = filtered.data() + y * (width * 4 + 1);
+    REQUIRE(row[0] == 1);
+    for (uint32_t i = 0; i < width * 4; ++i) {
+      decoded.push_back(static_cast<uint8_t>(row[i + 1] + (i >= 4 ? decoded[decoded.size() - 4] : 0)));
+    }
+  }
+  REQUIRE(decoded == rgba);
+  REQUIRE_THROWS_AS(PngWriter::encode(rgba.data(), 0, height), std::invalid_argument);
+}
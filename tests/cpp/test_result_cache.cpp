@@ -0,0 +1,174 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/simulation_engine.hpp"
+#include "../../src/cpp/core/reproducibility.hpp"
+#include "../../src/cpp/core/performance_utils.hpp"
+#include "../../src/cpp/core/cancellation.hpp"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+bool runProcess(SimulationEngine& engine, const std::string& wafer, const std::string& operation) {
+  SimulationEngine::ProcessParameters params(operation, 1.0);
+  params.parameters["thickness"] = 0.1;
+  return engine.simulateProcessAsync(wafer, params).get();
+}
+
+bool oxidize(SimulationEngine& engine, const std::string& wafer, const CancellationToken& token = {}) {
+  SimulationEngine::ProcessParameters params("oxidation", 0.5);
+  params.parameters["temperature"] = 1050.0;
+  params.parameters["time"] = 0.5;
+  params.cancellation = token;
+  return engine.simulateProcessAsync(wafer, params).get();
+}
+
+// Replaces the wafer under `name` with a fresh 16 x 16 silicon one
+void freshWafer(SimulationEngine& engine, const std::string& name) {
+  engine.unregisterWafer(name);
+  engine.registerWafer(engine.createWafer(300.0, 775.0, "silicon", 16, 16), name);
+}
+
+// Rewrites a cache entry with a well-formed envelope around a delta that
+// writes past the end of the state
+void corruptDelta(const std::filesystem::path& file) {
+  std::ifstream in(file, std::ios::binary);
+  std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  const size_t header = 8 + sizeof(std::uint64_t) * 3; // Magic, size and key
+  REQUIRE(bytes.size() > header);
+
+  const std::vector<std::uint64_t> delta = {8, 1, 1 << 20, 8}; // Size, runs, offset, length
+  const std::uint64_t size = delta.size() * sizeof(std::uint64_t);
+  const std::uint64_t checksum = SemiPRO::ContentHasher().update(delta.data(), size).finish().low;
+  std::memcpy(bytes.data() + 8, &size, sizeof(size));
+  bytes.resize(header);
+  bytes.insert(bytes.end(), reinterpret_cast<const char*>(delta.data()),
+               reinterpret_cast<const char*>(delta.data()) + size);
+  bytes.insert(bytes.end(), reinterpret_cast<const char*>(&checksum),
+               reinterpret_cast<const char*>(&checksum) + sizeof(checksum));
+  std::ofstream(file, std::ios::binary | std::ios::trunc).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+} // namespace
+
+TEST_CASE("Cached stochastic steps keep each wafer's own noise", "[ResultCache]") {
+  auto& engine = SimulationEngine::getInstance();
+  engine.initialize("");
+  Reproducibility::enable(20240611);
+  engine.enableResultCache(true);
+  const size_t cached = engine.getStatistics().cached_processes;
+
+  // Identical wafers, so only the random stream tells their steps apart
+  const std::vector<std::string> names = {"cache_noise_a", "cache_noise_b"};
+  for (const auto& name : names) {
+    engine.registerWafer(engine.createWafer(300.0, 775.0, "silicon", 16, 16), name);
+  }
+  REQUIRE(engine.captureWaferState(names[0]) == engine.captureWaferState(names[1]));
+  for (const auto& name : names) {
+    REQUIRE(runProcess(engine, name, "deposition"));
+  }
+  REQUIRE(engine.getStatistics().cached_processes == cached);
+  REQUIRE(engine.captureWaferState(names[0]) != engine.captureWaferState(names[1]));
+
+  // The same wafer and step under the same seed is a hit, and replays the
+  // noise a fresh simulation would draw
+  const auto after = engine.captureWaferState(names[0]);
+  for (const auto& name : names) {
+    engine.unregisterWafer(name);
+  }
+  engine.registerWafer(engine.createWafer(300.0, 775.0, "silicon", 16, 16), names[0]);
+  REQUIRE(runProcess(engine, names[0], "deposition"));
+  REQUIRE(engine.getStatistics().cached_processes == cached + 1);
+  REQUIRE(engine.captureWaferState(names[0]) == after);
+
+  engine.unregisterWafer(names[0]);
+  engine.enableResultCache(false);
+  Reproducibility::disable();
+}
+
+TEST_CASE("Cache hits replay the stored step onto the wafer", "[ResultCache]") {
+  auto& engine = SimulationEngine::getInstance();
+  engine.initialize("");
+  engine.enableResultCache(true);
+  const size_t cached = engine.getStatistics().cached_processes;
+
+  freshWafer(engine, "cache_hit");
+  const auto before = engine.captureWaferState("cache_hit");
+  REQUIRE(oxidize(engine, "cache_hit"));
+  const auto simulated = engine.captureWaferState("cache_hit");
+  REQUIRE(simulated != before);
+  REQUIRE(engine.getStatistics().cached_processes == cached);
+
+  freshWafer(engine, "cache_hit");
+  REQUIRE(oxidize(engine, "cache_hit"));
+  REQUIRE(engine.getStatistics().cached_processes == cached + 1);
+  REQUIRE(engine.captureWaferState("cache_hit") == simulated);
+
+  // The next step starts from a state the cache has not seen
+  REQUIRE(oxidize(engine, "cache_hit"));
+  REQUIRE(engine.getStatistics().cached_processes == cached + 1);
+
+  engine.unregisterWafer("cache_hit");
+  engine.enableResultCache(false);
+}
+
+TEST_CASE("A corrupt cached delta falls back to simulating the step", "[ResultCache]") {
+  const auto directory = std::filesystem::temp_directory_path() / ("semipro-result-cache-" + std::to_string(::getpid()));
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  auto& engine = SimulationEngine::getInstance();
+  engine.initialize("");
+  engine.enableResultCache(true, directory.string());
+  const size_t cached = engine.getStatistics().cached_processes;
+
+  freshWafer(engine, "cache_corrupt");
+  REQUIRE(oxidize(engine, "cache_corrupt"));
+  const auto simulated = engine.captureWaferState("cache_corrupt");
+
+  // A new cache starts with nothing in memory, so the lookup reads the file
+  size_t entries = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    corruptDelta(entry.path());
+    ++entries;
+  }
+  REQUIRE(entries == 1);
+  engine.enableResultCache(true, directory.string());
+
+  freshWafer(engine, "cache_corrupt");
+  REQUIRE(oxidize(engine, "cache_corrupt"));
+  REQUIRE(engine.getStatistics().cached_processes == cached);
+  REQUIRE(engine.captureWaferState("cache_corrupt") == simulated);
+
+  engine.unregisterWafer("cache_corrupt");
+  engine.enableResultCache(false);
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Cancelled steps are not stored in the result cache", "[ResultCache]") {
+  auto& engine = SimulationEngine::getInstance();
+  engine.initialize("");
+  engine.enableResultCache(true);
+  const size_t cached = engine.getStatistics().cached_processes;
+
+  CancellationSource source;
+  source.requestStop();
+  freshWafer(engine, "cache_cancelled");
+  REQUIRE_FALSE(oxidize(engine, "cache_cancelled", source.token()));
+
+  // The same step from the same state simulates, and is stored this time
+  freshWafer(engine, "cache_cancelled");
+  REQUIRE(oxidize(engine, "cache_cancelled"));
+  REQUIRE(engine.getStatistics().cached_processes == cached);
+  freshWafer(engine, "cache_cancelled");
+  REQUIRE(oxidize(engine, "cache_cancelled"));
+  REQUIRE(engine.getStatistics().cached_processes == cached + 1);
+
+  engine.unregisterWafer("cache_cancelled");
+  engine.enableResultCache(false);
+}
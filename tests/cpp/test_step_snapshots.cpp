@@ -0,0 +1,134 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/step_snapshots.hpp"
+#include "../../src/cpp/core/wafer_enhanced.hpp"
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kSteps = 4;
+
+std::shared_ptr<WaferEnhanced> makeWafer() {
+  auto wafer = std::make_shared<WaferEnhanced>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(24, 16);
+  return wafer;
+}
+
+// One workflow step: a layer and a temperature field only this step gives
+void runStep(WaferEnhanced& wafer, size_t step) {
+  wafer.addLayer(step % 2 == 0 ? "oxide" : "nitride", 0.01 * (step + 1));
+  Eigen::ArrayXXd temperature(wafer.getGrid().rows(), wafer.getGrid().cols());
+  for (Eigen::Index i = 0; i < temperature.rows(); ++i) {
+    for (Eigen::Index j = 0; j < temperature.cols(); ++j) {
+      temperature(i, j) = 300.0 + 25.0 * step + std::sin(0.3 * i * (step + 1)) + 0.01 * j;
+    }
+  }
+  wafer.setTemperatureField(temperature);
+}
+
+std::string scratchDirectory(const std::string& name) {
+  const auto path = std::filesystem::temp_directory_path() / (name + "-" + std::to_string(::getpid()));
+  std::filesystem::remove_all(path);
+  std::filesystem::create_directories(path);
+  return path.string();
+}
+
+} // namespace
+
+TEST_CASE("Step snapshots let a failed run resume at the failed step", "[StepSnapshots]") {
+  auto reference = makeWafer();
+  for (size_t step = 0; step < kSteps; ++step) {
+    runStep(*reference, step);
+  }
+
+  SemiPRO::StepSnapshotStore store;
+  auto wafer = makeWafer();
+  std::vector<size_t> ran;
+  auto run = [&](WaferEnhanced& target, size_t from, bool fail_at_two) {
+    for (size_t step = from; step < kSteps; ++step) {
+      if (fail_at_two && step == 2) {
+        throw std::runtime_error("step 2 failed");
+      }
+      runStep(target, step);
+      ran.push_back(step);
+      store.record("exec", step, target);
+    }
+  };
+  REQUIRE_THROWS_AS(run(*wafer, 0, true), std::runtime_error);
+  REQUIRE(store.size() == 2);
+  // The failed step left the live wafer mid-way; the retry must not see it
+  runStep(*wafer, 99);
+
+  // A retry from step 2 starts from the state after step 1
+  REQUIRE(store.latest("exec", 1) == 1);
+  REQUIRE(store.latest("exec", 3) == 1);
+  auto resumed = store.restore("exec", 1);
+  REQUIRE(resumed != nullptr);
+  REQUIRE(resumed != wafer);
+  run(*resumed, 2, false);
+  REQUIRE(ran == std::vector<size_t>{0, 1, 2, 3});
+  REQUIRE(resumed->stateImage() == reference->stateImage());
+
+  // Recording step 1 again forgets the steps that followed from the old one
+  store.record("exec", 1, *resumed);
+  REQUIRE(store.latest("exec", 3) == 1);
+  REQUIRE(store.restore("exec", 2) == nullptr);
+  REQUIRE(store.latest("other", 3) == -1);
+
+  store.forget("exec");
+  REQUIRE(store.size() == 0);
+  REQUIRE(store.restore("exec", 0) == nullptr);
+}
+
+TEST_CASE("Spilled step snapshots restore bit-identical wafers", "[StepSnapshots]") {
+  const std::string directory = scratchDirectory("semipro-snapshots");
+  SemiPRO::StepSnapshotStore::Limits limits;
+  limits.memory_budget = 1; // Every snapshot but the newest spills
+  limits.spill_directory = directory;
+
+  std::vector<std::vector<unsigned char>> images;
+  {
+    SemiPRO::StepSnapshotStore store(limits);
+    auto wafer = makeWafer();
+    for (size_t step = 0; step < kSteps; ++step) {
+      runStep(*wafer, step);
+      store.record("exec", step, *wafer);
+      images.push_back(wafer->stateImage());
+    }
+    REQUIRE(store.size() == kSteps);
+    REQUIRE(store.spilledCount() == kSteps - 1);
+    REQUIRE(!std::filesystem::is_empty(directory));
+
+    for (size_t step = 0; step < kSteps; ++step) {
+      auto restored = store.restore("exec", step);
+      REQUIRE(restored != nullptr);
+      REQUIRE(restored->stateImage() == images[step]);
+    }
+    // A restored wafer is the caller's to change
+    auto restored = store.restore("exec", 0);
+    runStep(*restored, 5);
+    REQUIRE(store.restore("exec", 0)->stateImage() == images[0]);
+
+    store.clear();
+    REQUIRE(std::filesystem::is_empty(directory));
+  }
+
+  // Without a spill directory snapshots past the budget are dropped
+  limits.spill_directory.clear();
+  SemiPRO::StepSnapshotStore store(limits);
+  auto wafer = makeWafer();
+  for (size_t step = 0; step < kSteps; ++step) {
+    runStep(*wafer, step);
+    store.record("exec", step, *wafer);
+  }
+  REQUIRE(store.spilledCount() == 0);
+  REQUIRE(store.latest("exec", kSteps - 1) == static_cast<long>(kSteps - 1));
+  REQUIRE(store.restore("exec", 0) == nullptr);
+  REQUIRE(store.restore("exec", kSteps - 1)->stateImage() == images.back());
+  std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,131 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/task_scheduler.hpp"
+#include "../../src/cpp/core/simulation_engine.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Spawns and waits on a subtask per branch, so every level of the
+// recursion blocks a task on work queued behind it
+long long fibonacci(TaskScheduler& pool, int n) {
+  if (n < 2) {
+    return n;
+  }
+  auto left = pool.submit([&pool, n] { return fibonacci(pool, n - 1); });
+  const long long right = fibonacci(pool, n - 2);
+  return pool.wait(left) + right;
+}
+
+} // namespace
+
+TEST_CASE("Nested tasks wait on subtasks without starving a one-thread pool", "[TaskScheduler]") {
+  TaskScheduler pool(1);
+  REQUIRE(pool.threadCount() == 1);
+
+  auto outer = pool.submit([&pool] {
+    auto inner = pool.submit([] { return 21; });
+    return 2 * pool.wait(inner);
+  });
+  REQUIRE(pool.wait(outer) == 42);
+
+  auto deep = pool.submit([&pool] { return fibonacci(pool, 15); });
+  REQUIRE(pool.wait(deep) == 610);
+  REQUIRE(pool.queuedTasks() == 0);
+}
+
+TEST_CASE("Parallel loops rethrow a chunk's exception after the other chunks finish", "[TaskScheduler]") {
+  TaskScheduler pool(2);
+  std::atomic<int> done{0};
+  auto body = [&](int begin, int end) {
+    if (begin <= 50 && 50 < end) {
+      throw std::runtime_error("chunk failed");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    done += end - begin;
+  };
+  REQUIRE_THROWS_AS(pool.parallelFor(0, 100, body, 10), std::runtime_error);
+  REQUIRE(done == 90);
+
+  // The pool is still usable afterwards
+  done = 0;
+  pool.parallelFor(0, 100, [&](int begin, int end) { done += end - begin; }, 10);
+  REQUIRE(done == 100);
+}
+
+TEST_CASE("Resizing the pool keeps the tasks still queued", "[TaskScheduler]") {
+  TaskScheduler pool(1);
+  std::atomic<bool> release{false};
+  std::promise<void> spawned;
+  std::mutex mutex;
+  std::vector<int> ran;
+  std::vector<std::future<void>> subtasks;
+
+  // Subtasks spawned by a worker sit in its own deque behind the task
+  // that spawned them, which holds the only worker until released
+  auto blocker = pool.submit([&] {
+    for (int i = 0; i < 20; ++i) {
+      subtasks.push_back(pool.submit([&, i] {
+        std::lock_guard<std::mutex> lock(mutex);
+        ran.push_back(i);
+      }));
+    }
+    spawned.set_value();
+    while (!release) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  spawned.get_future().wait();
+  REQUIRE(pool.queuedTasks() == 20);
+
+  std::thread releaser([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    release = true;
+  });
+  pool.resize(3);
+  releaser.join();
+  REQUIRE(pool.threadCount() == 3);
+
+  pool.wait(blocker);
+  for (auto& subtask : subtasks) {
+    pool.wait(subtask);
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  REQUIRE(ran.size() == 20);
+}
+
+TEST_CASE("Engine batch results stay in queue order across wafers", "[TaskScheduler]") {
+  auto& engine = SimulationEngine::getInstance();
+  engine.initialize("");
+  const std::vector<std::string> wafers = {"sched_a", "sched_b", "sched_c"};
+  for (const auto& name : wafers) {
+    engine.registerWafer(engine.createWafer(300.0, 775.0, "silicon", 8, 8), name);
+  }
+
+  // Every wafer's processes run in one task and the wafers in parallel,
+  // yet each result lands at its entry's place in the queue
+  std::vector<bool> expected;
+  for (int round = 0; round < 3; ++round) {
+    for (size_t w = 0; w < wafers.size(); ++w) {
+      const bool valid = (round + w) % 2 == 0;
+      SimulationEngine::ProcessParameters params(valid ? "oxidation" : "no_such_process", 0.1);
+      params.parameters["temperature"] = 1000.0;
+      engine.addProcessToBatch(wafers[w], params);
+      expected.push_back(valid);
+    }
+  }
+  engine.addProcessToBatch("sched_missing", SimulationEngine::ProcessParameters("oxidation", 0.1));
+  expected.push_back(false);
+
+  auto batch = engine.executeBatch();
+  REQUIRE(TaskScheduler::getInstance().wait(batch) == expected);
+  for (const auto& name : wafers) {
+    engine.unregisterWafer(name);
+  }
+}
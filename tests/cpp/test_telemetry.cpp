@@ -0,0 +1,207 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/profiler.hpp"
+#include "../../src/cpp/core/hardware_counters.hpp"
+#include "../../src/cpp/core/telemetry.hpp"
+#include "../../src/cpp/core/json_value.hpp"
+#include "../../src/cpp/core/log_ring.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Profiler counts hardware events and cells per zone", "[Telemetry]") {
+  Profiler& profiler = Profiler::getInstance();
+  const bool counting = profiler.enableHardwareCounters(true);
+  if (!counting) {
+    REQUIRE_FALSE(HardwareCounters::lastError().empty());
+  }
+  volatile double sum = 0.0;
+  {
+    PROFILE_SCOPE("test_counters/outer");
+    {
+      PROFILE_SCOPE("test_counters/inner");
+      for (int i = 0; i < 100000; ++i) {
+        sum = sum + i * 0.5;
+      }
+      PROFILE_CELLS(100000);
+    }
+    PROFILE_CELLS(16);
+  }
+  profiler.enableHardwareCounters(false);
+
+  REQUIRE(profiler.getCells("test_counters/inner") == 100000);
+  REQUIRE(profiler.getCells("test_counters/outer") == 16);
+  const HardwareCounters::Sample inner = profiler.getCounters("test_counters/inner");
+  const HardwareCounters::Sample outer = profiler.getCounters("test_counters/outer");
+  if (counting) {
+    // Counts include nested zones
+    REQUIRE(inner.instructions > 100000);
+    REQUIRE(outer.instructions >= inner.instructions);
+  } else {
+    REQUIRE(inner.instructions == 0);
+    REQUIRE(profiler.getCallCount("test_counters/inner") == 1);
+  }
+}
+
+TEST_CASE("Metrics registry exports Prometheus text and OTLP spans", "[Telemetry]") {
+  SemiPRO::LatencyHistogram histogram;
+  for (int i = 1; i <= 1000; ++i) {
+    histogram.observe(i * 1e-6); // 1 us to 1 ms
+  }
+  REQUIRE(histogram.count() == 1000);
+  REQUIRE(std::abs(histogram.sumSeconds() - 0.5005) < 1e-6);
+  // Buckets are within 1/16 of their durations
+  REQUIRE(std::abs(histogram.quantile(0.5) / 500e-6 - 1.0) < 1.0 / 16);
+  REQUIRE(std::abs(histogram.quantile(0.99) / 990e-6 - 1.0) < 1.0 / 16);
+  for (std::uint64_t ns : {0ull, 15ull, 16ull, 1000ull, 123456789ull}) {
+    const std::size_t bucket = SemiPRO::LatencyHistogram::bucketOf(ns);
+    REQUIRE(ns <= SemiPRO::LatencyHistogram::bucketUpperNs(bucket));
+    REQUIRE((bucket == 0 || ns > SemiPRO::LatencyHistogram::bucketUpperNs(bucket - 1)));
+  }
+
+  auto& registry = SemiPRO::MetricsRegistry::getInstance();
+  registry.counter("test_metrics_events_total", "Test events", {{"kind", "a\"b"}}).add(3);
+  registry.histogram("test_metrics_seconds", "Test latency").observe(0.002);
+  double depth = 7;
+  registry.gaugeCallback("test_metrics_depth", "Test depth", [&depth] { return depth; });
+  REQUIRE_THROWS_AS(registry.gauge("test_metrics_events_total", "Wrong type"), std::invalid_argument);
+  const std::string text = registry.prometheusText();
+  REQUIRE(text.find("# TYPE test_metrics_events_total counter\n") != std::string::npos);
+  REQUIRE(text.find("test_metrics_events_total{kind=\"a\\\"b\"} 3\n") != std::string::npos);
+  REQUIRE(text.find("test_metrics_seconds_bucket{le=\"0.001\"} 0\n") != std::string::npos);
+  REQUIRE(text.find("test_metrics_seconds_bucket{le=\"0.0025\"} 1\n") != std::string::npos);
+  REQUIRE(text.find("test_metrics_seconds_count 1\n") != std::string::npos);
+  REQUIRE(text.find("test_metrics_depth 7\n") != std::string::npos);
+  registry.removeGaugeCallback("test_metrics_depth");
+  REQUIRE(registry.prometheusText().find("test_metrics_depth 7") == std::string::npos);
+
+  // Spans nest on a thread and continue on another through a Scope
+  const auto outer = SemiPRO::TraceContext::open();
+  const auto inner = SemiPRO::TraceContext::open();
+  REQUIRE(inner.trace_id == outer.trace_id);
+  REQUIRE(inner.parent_span_id == outer.span_id);
+  SemiPRO::TraceContext::Ids remote;
+  std::thread([&] {
+    SemiPRO::TraceContext::Scope scope(inner);
+    remote = SemiPRO::TraceContext::open();
+    SemiPRO::TraceContext::close(remote);
+  }).join();
+  REQUIRE(remote.parent_span_id == inner.span_id);
+  SemiPRO::TraceContext::close(inner);
+  REQUIRE(SemiPRO::TraceContext::current().span_id == outer.span_id);
+  SemiPRO::TraceContext::close(outer);
+  REQUIRE(SemiPRO::TraceContext::current().span_id == 0);
+
+  const std::string path = "test_telemetry_spans.jsonl";
+  std::remove(path.c_str());
+  {
+    SemiPRO::OtlpTraceWriter writer(path, "semipro-test", 2);
+    for (const auto& ids : {outer, inner, remote}) {
+      SemiPRO::TraceSpan span;
+      span.ids = ids;
+      span.name = "step";
+      span.start_unix_ns = 1000;
+      span.end_unix_ns = 2000;
+      span.number_attributes.emplace_back("ipc", 1.5);
+      writer.addSpan(span);
+    }
+  }
+  std::ifstream in(path);
+  std::string line;
+  std::vector<SemiPRO::JsonValue> batches;
+  while (std::getline(in, line)) {
+    batches.push_back(SemiPRO::JsonValue::parse(line));
+  }
+  REQUIRE(batches.size() == 2);
+  const auto& spans = batches[0]["resourceSpans"].items()[0]["scopeSpans"].items()[0]["spans"].items();
+  REQUIRE(spans.size() == 2);
+  REQUIRE(spans[0]["traceId"].asString().size() == 32);
+  REQUIRE(spans[0].find("parentSpanId") == nullptr);
+  REQUIRE(spans[1]["parentSpanId"].asString() == spans[0]["spanId"].asString());
+  REQUIRE(spans[1]["endTimeUnixNano"].asString() == "2000");
+  std::remove(path.c_str());
+}
+
+TEST_CASE("Log ring keeps records in order and drops them when full", "[Telemetry]") {
+  SemiPRO::LogRing ring(3); // Rounded up to 4 slots
+  std::uint64_t position = 0;
+  for (int i = 0; i < 4; ++i) {
+    SemiPRO::LogRecord* record = ring.claim(position);
+    REQUIRE(record != nullptr);
+    record->begin(SemiPRO::LogLevel::INFO, SemiPRO::LogCategory::GENERAL, "record {} of {}");
+    record->add(i);
+    record->add(std::string("four"));
+    ring.publish(position);
+  }
+  REQUIRE(ring.claim(position) == nullptr);
+  REQUIRE(ring.dropped() == 1);
+
+  std::vector<std::string> messages;
+  REQUIRE(ring.drain([&](const SemiPRO::LogRecord& record) { messages.push_back(record.message()); }) == 4);
+  REQUIRE(messages == std::vector<std::string>{"record 0 of four", "record 1 of four", "record 2 of four",
+                                               "record 3 of four"});
+  REQUIRE(ring.consumed() == 4);
+  REQUIRE(ring.claim(position) != nullptr);
+
+  // Arguments are formatted by type; markers past the last one stay as written
+  SemiPRO::LogRecord record;
+  record.begin(SemiPRO::LogLevel::WARNING, SemiPRO::LogCategory::PHYSICS, "Etched {} um in {} s: {} {} {}");
+  record.add(2.5);
+  record.add(-3);
+  record.add(true);
+  record.add("done");
+  REQUIRE(record.message() == "Etched 2.5 um in -3 s: true done {}");
+}
+
+TEST_CASE("Filtered log calls skip their arguments and the rest reach the sinks", "[Telemetry]") {
+  auto& dispatcher = SemiPRO::LogDispatcher::getInstance();
+  std::mutex mutex;
+  std::vector<std::string> seen;
+  const int sink = dispatcher.addSink([&](const SemiPRO::LogRecord& record, const std::string& message) {
+    if (message.rfind("log ring test", 0) == 0) {
+      std::lock_guard<std::mutex> lock(mutex);
+      seen.push_back(std::string(SemiPRO::logLevelName(record.level)) + " " + message);
+    }
+  });
+
+  int evaluated = 0;
+  auto argument = [&evaluated] { return ++evaluated; };
+  SemiPRO::setLogLevel(SemiPRO::LogLevel::WARNING);
+  SEMIPRO_LOGF(INFO, GENERAL, "log ring test {}", argument());
+  SEMIPRO_LOGF(ERROR, GENERAL, "log ring test {}", argument());
+  SemiPRO::setLogLevel(SemiPRO::LogLevel::INFO);
+  REQUIRE(evaluated == 1);
+
+  dispatcher.flush();
+  dispatcher.removeSink(sink);
+  std::lock_guard<std::mutex> lock(mutex);
+  REQUIRE(seen == std::vector<std::string>{"ERROR log ring test 1"});
+}
+
+TEST_CASE("Profiler tracks take spans timed elsewhere", "[Telemetry]") {
+  const std::string path = "test_telemetry_track_trace.json";
+  Profiler& profiler = Profiler::getInstance();
+  const ProfileTrackId track = profiler.registerTrack("Test GPU");
+  const ProfileZoneId frame = profiler.registerZone("test_track/frame");
+  const ProfileZoneId pass = profiler.registerZone("test_track/pass");
+  const std::int64_t start = profiler.clockNs();
+  profiler.recordSpan(track, frame, start, start + 4000000);
+  profiler.recordSpan(track, pass, start + 1000000, start + 3000000, 1);
+  REQUIRE(profiler.getCallCount("test_track/frame") == 1);
+  REQUIRE(profiler.getTotalTime("test_track/frame") == 4.0);
+  REQUIRE(profiler.getTotalTime("test_track/pass") == 2.0);
+  REQUIRE_THROWS_AS(profiler.recordSpan(track + 1000, frame, start, start + 1), std::out_of_range);
+
+  profiler.exportChromeTrace(path);
+  std::ifstream in(path);
+  const std::string trace((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  REQUIRE(trace.find("Test GPU") != std::string::npos);
+  REQUIRE(trace.find("test_track/pass") != std::string::npos);
+  std::remove(path.c_str());
+}
@@ -4,6 +4,16 @@
 #include "../../src/cpp/modules/photolithography/lithography_model.hpp"
 #include "../../src/cpp/modules/metallization/metallization_model.hpp"
 #include "../../src/cpp/modules/packaging/packaging_model.hpp"
+#include "../../src/cpp/modules/thermal/thermal_operator_cache.hpp"
+#include "../../src/cpp/core/adaptive_ode.hpp"
+#include "../../src/cpp/core/multigrid.hpp"
+#include "../../src/cpp/core/layered_heat_solver.hpp"
+#include "../../src/cpp/core/adaptive_mesh.hpp"
+#include "../../src/cpp/core/grid_stencil_matrix.hpp"
+#include "../../src/cpp/core/temperature_schedule.hpp"
+#include "../../src/cpp/core/thermal_profile.hpp"
+#include <cmath>
+#include <stdexcept>
 
 TEST_CASE("Thermal simulation", "[Thermal]") {
   auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
@@ -24,6 +34,197 @@ TEST_CASE("Thermal simulation", "[Thermal]") {
   REQUIRE(temp_profile.minCoeff() >= 300.0);
 }
 
+TEST_CASE("Repeated thermal solves reuse the operator", "[Thermal]") {
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(40, 40);
+  LithographyModel lithography;
+  std::vector<std::vector<int>> mask = {{1, 0, 1}, {0, 1, 0}, {1, 0, 1}};
+  lithography.simulateExposure(wafer, 13.5, 0.33, mask);
+  MetallizationModel metallization;
+  metallization.simulateMetallization(wafer, 0.5, "Cu", "pvd");
+  PackagingModel packaging;
+  packaging.performElectricalTest(wafer, "resistance");
+  ThermalSimulationModel thermal;
+  thermal.simulateThermal(wafer, 300.0, 0.001);
+  const Eigen::ArrayXXd rise = wafer->getTemperatureProfile() - 300.0;
+
+  // Twice the current is four times the heat and the rise, from the
+  // operator built for the first solve
+  const auto before = ThermalOperatorCache::instance().statistics();
+  thermal.simulateThermal(wafer, 350.0, 0.002);
+  const auto after = ThermalOperatorCache::instance().statistics();
+  REQUIRE(after.hits == before.hits + 1);
+  REQUIRE(after.misses == before.misses);
+  const Eigen::ArrayXXd scaled = wafer->getTemperatureProfile() - 350.0;
+  REQUIRE((scaled - 4.0 * rise).abs().maxCoeff() <= 1e-9 * scaled.maxCoeff());
+}
+
+TEST_CASE("Transient heating settles on the steady temperature", "[Thermal]") {
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(30, 30);
+  LithographyModel lithography;
+  std::vector<std::vector<int>> mask = {{1, 0, 1}, {0, 1, 0}, {1, 0, 1}};
+  lithography.simulateExposure(wafer, 13.5, 0.33, mask);
+  MetallizationModel metallization;
+  metallization.simulateMetallization(wafer, 0.5, "Cu", "pvd");
+  PackagingModel packaging;
+  packaging.performElectricalTest(wafer, "resistance");
+  ThermalSimulationModel thermal;
+  thermal.simulateThermal(wafer, 300.0, 0.01);
+  const Eigen::ArrayXXd steady = wafer->getTemperatureProfile();
+
+  TransientThermalOptions options;
+  options.end_time = 1e-3;
+  options.tolerance = 1e-4;
+  const auto results = thermal.simulateTransient(
+      wafer, [](double) { return 300.0; }, [](double) { return 0.01; }, options);
+  REQUIRE(results.times.back() == options.end_time);
+  REQUIRE(results.steps < 200);
+  REQUIRE(results.peak_temperature.front() == 300.0);
+  REQUIRE((wafer->getTemperatureProfile() - steady).abs().maxCoeff() < 1e-4);
+
+  options.tolerance = 0.0;
+  REQUIRE_THROWS_AS(thermal.simulateTransient(
+                        wafer, [](double) { return 300.0; }, [](double) { return 0.01; }, options),
+                    std::invalid_argument);
+}
+
+TEST_CASE("Layered heat solves conserve the heat through the stack", "[Thermal]") {
+  const std::vector<LayeredHeatSolver::Plane> planes = {
+      {0.5e-6, 400.0}, {1e-6, 1.4}, {2e-6, 1.4}, {10e-6, 150.0}, {10e-6, 150.0}};
+  std::vector<Eigen::ArrayXXd> source(planes.size());
+  source[0] = Eigen::ArrayXXd::Zero(8, 8);
+  source[0].block(2, 3, 3, 2).setConstant(1e15); // W/m^3
+  source[3] = Eigen::ArrayXXd::Constant(8, 8, 1e12);
+
+  const LayeredHeatSolver fft(8, 8, 1e-6, planes);
+  const LayeredHeatSolver dense(8, 8, 1e-6, planes, LayeredHeatSolver::Options(), nullptr);
+  REQUIRE(fft.usesFft());
+  REQUIRE_FALSE(dense.usesFft());
+  const auto rise = fft.solve(source);
+  const auto check = dense.solve(source);
+  for (std::size_t l = 0; l < planes.size(); ++l) {
+    REQUIRE((rise[l] - check[l]).abs().maxCoeff() <= 1e-9 * rise[0].maxCoeff());
+  }
+
+  // With an adiabatic top, every watt leaves through the sink
+  const double heat = (source[0] * planes[0].thickness).sum() + (source[3] * planes[3].thickness).sum();
+  const double sink = 2.0 * planes.back().conductivity / planes.back().thickness;
+  REQUIRE(std::abs(sink * rise.back().sum() - heat) <= 1e-9 * heat);
+  REQUIRE(rise[0].maxCoeff() > rise[1].maxCoeff());
+
+  LayeredHeatSolver::Options adiabatic;
+  adiabatic.bottom_transfer = 0.0;
+  REQUIRE_THROWS_AS(LayeredHeatSolver(8, 8, 1e-6, planes, adiabatic), std::invalid_argument);
+
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(12, 12);
+  ThermalSimulationModel thermal;
+  LayeredThermalOptions options;
+  options.stack = {{0.5, "Cu"}, {2.0, "SiO2"}};
+  const auto results = thermal.simulateLayered(wafer, 300.0, 0.0, options);
+  REQUIRE(results.layer.front() == 0);
+  REQUIRE(results.layer.back() == -1);
+  REQUIRE(results.temperature.size() == results.depth.size());
+  REQUIRE((results.temperature.front() - 300.0).abs().maxCoeff() < 1e-9); // No heat sources
+  options.stack = {{1.0, "unobtainium"}};
+  REQUIRE_THROWS_AS(thermal.simulateLayered(wafer, 300.0, 0.0, options), std::invalid_argument);
+}
+
+TEST_CASE("Electro-thermal iteration heats a metal strip self-consistently", "[Thermal]") {
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(32, 32);
+  Eigen::ArrayXXd pattern = Eigen::ArrayXXd::Ones(32, 32);
+  pattern.block(12, 0, 8, 32).setZero(); // 8 um wide strip from contact to contact
+  wafer->setPhotoresistPattern(pattern);
+  wafer->addMetalLayer(0.5, "Cu");
+  ThermalSimulationModel thermal;
+
+  ElectroThermalOptions options;
+  options.temperature_coefficient = 0.0;
+  const auto cold = thermal.simulateElectroThermal(wafer, 300.0, 0.3, options);
+  const double strip = 1.68e-8 * 32e-6 / (8e-6 * 0.5e-6);
+  REQUIRE(std::abs(cold.resistance / strip - 1.0) < 0.05);
+  REQUIRE(cold.iterations == 2);
+  // All the Joule heat is I^2 R
+  const double heat = cold.joule_heat.sum() * 1e-12 * 0.5e-6;
+  REQUIRE(std::abs(heat / (0.3 * 0.3 * cold.resistance) - 1.0) < 1e-6);
+  const double cold_peak = wafer->getTemperatureProfile().maxCoeff();
+
+  const auto hot = thermal.simulateElectroThermal(wafer, 300.0, 0.3);
+  REQUIRE(hot.resistance > cold.resistance);
+  REQUIRE(wafer->getTemperatureProfile().maxCoeff() > cold_peak);
+  REQUIRE(hot.rebuilds == 1);
+  REQUIRE(hot.current_density.maxCoeff() > 0.9 * 0.3 / (8e-6 * 0.5e-6));
+  const double hot_peak = wafer->getTemperatureProfile().maxCoeff();
+
+  ElectroThermalOptions mixed;
+  mixed.mixed_precision = true;
+  const auto single = thermal.simulateElectroThermal(wafer, 300.0, 0.3, mixed);
+  REQUIRE(std::abs(single.resistance / hot.resistance - 1.0) < 1e-6);
+  REQUIRE(std::abs(wafer->getTemperatureProfile().maxCoeff() - hot_peak) < 1e-3);
+
+  wafer->getMetalLayers().clear();
+  REQUIRE_THROWS_AS(thermal.simulateElectroThermal(wafer, 300.0, 0.3), std::invalid_argument);
+}
+
+TEST_CASE("Adaptive quadtree thermal solves match the uniform grid", "[Thermal]") {
+  // One level of refinement per region: the mesh stays 2:1 balanced and
+  // every grid cell lies in exactly one leaf
+  SemiPRO::AdaptiveMesh mesh(40, 24, 3);
+  REQUIRE(mesh.size() == 15);
+  Eigen::ArrayXXd indicator = Eigen::ArrayXXd::Zero(40, 24);
+  indicator(17, 9) = 1.0;
+  mesh.refine_mesh(indicator, 0.5);
+  Eigen::ArrayXXi cover = Eigen::ArrayXXi::Zero(40, 24);
+  for (const auto& leaf : mesh.leaves()) {
+    cover.block(leaf.row, leaf.col, leaf.size(), leaf.size()) += 1;
+  }
+  REQUIRE((cover == 1).all());
+  REQUIRE(mesh.leaves()[mesh.find_leaf(17, 9)].level == 0);
+  const Eigen::ArrayXXd ramp = Eigen::ArrayXXd::NullaryExpr(40, 24, [](Eigen::Index i, Eigen::Index j) {
+    return 2.0 * i - 0.5 * j;
+  });
+  Eigen::ArrayXXd back;
+  mesh.interpolate_to_regular_grid(mesh.restrict_from_regular_grid(ramp), back, 0.0);
+  // Away from the edge leaves, which also fit the boundary value, a
+  // linear field comes back exactly
+  REQUIRE((back - ramp).block(8, 8, 24, 8).abs().maxCoeff() < 1e-9);
+
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(96, 96);
+  Eigen::ArrayXXd pattern = Eigen::ArrayXXd::Ones(96, 96);
+  pattern.block(40, 20, 4, 56).setZero(); // A 4 um line across the middle
+  wafer->setPhotoresistPattern(pattern);
+  wafer->addMetalLayer(0.5, "Cu");
+  wafer->setElectricalProperties({{"Resistance", 10.0}});
+  ThermalSimulationModel thermal;
+
+  AdaptiveThermalOptions uniform;
+  uniform.max_level = 0;
+  REQUIRE(thermal.simulateThermalAdaptive(wafer, 300.0, 0.01, uniform).leaves == 96 * 96);
+  const Eigen::ArrayXXd reference = wafer->getTemperatureProfile();
+  const auto results = thermal.simulateThermalAdaptive(wafer, 300.0, 0.01);
+  REQUIRE(results.cells == 96 * 96);
+  REQUIRE(results.leaves * 4 < results.cells);
+  const Eigen::ArrayXXd T = wafer->getTemperatureProfile();
+  const double peak = reference.maxCoeff() - 300.0;
+  REQUIRE(peak > 0.0);
+  REQUIRE(std::abs(T.maxCoeff() - 300.0 - peak) < 0.03 * peak);
+  // Coarse leaves reconstruct the temperature linearly, so the error is
+  // largest in their corners
+  REQUIRE((T - reference).abs().maxCoeff() < 0.1 * peak);
+  REQUIRE((T - reference).abs().mean() < 0.02 * peak);
+
+  // The multigrid solve holds the edge cells, not the edge, at ambient
+  thermal.simulateThermal(wafer, 300.0, 0.01);
+  REQUIRE(std::abs(wafer->getTemperatureProfile().maxCoeff() - 300.0 - peak) < 0.1 * peak);
+
+  AdaptiveThermalOptions bad;
+  bad.max_level = 16;
+  REQUIRE_THROWS_AS(thermal.simulateThermalAdaptive(wafer, 300.0, 0.01, bad), std::invalid_argument);
+}
+
 TEST_CASE("Thermal simulation no metal", "[Thermal]") {
   auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
   wafer->initializeGrid(10, 10);
@@ -31,4 +232,126 @@ TEST_CASE("Thermal simulation no metal", "[Thermal]") {
   thermal.simulateThermal(wafer, 300.0, 0.001);
   auto temp_profile = wafer->getTemperatureProfile();
   REQUIRE((temp_profile == 300.0).all()); // No heat sources
-}
\ No newline at end of file
+}
+TEST_CASE("Adaptive integration follows a temperature schedule", "[Thermal]") {
+  TemperatureSchedule schedule;
+  schedule.add(0.0, 600.0);
+  schedule.ramp(1000.0, 100.0, 30.0);
+  schedule.ramp(700.0, -50.0);
+  REQUIRE(std::abs(schedule.end() - 40.0) < 1e-12);
+  REQUIRE(std::abs(schedule.temperature(2.0) - 800.0) < 1e-9);
+  REQUIRE(schedule.peak() == 1000.0);
+  REQUIRE_THROWS_AS(schedule.add(1.0, 800.0), std::invalid_argument);
+
+  // The integral of a piecewise-linear temperature is exact between knots
+  AdaptiveOde::Statistics stats;
+  auto temperature = [&](double t, const AdaptiveOde::Vector&) {
+    return AdaptiveOde::Vector::Constant(1, schedule.temperature(t));
+  };
+  const double budget = AdaptiveOde::integrate(temperature, schedule.start(), schedule.end(),
+                                               AdaptiveOde::Vector::Zero(1), schedule.times(),
+                                               AdaptiveOde::Options(), &stats)(0);
+  REQUIRE(std::abs(budget - (4.0 * 800.0 + 30.0 * 1000.0 + 6.0 * 850.0)) < 1e-6);
+  REQUIRE(stats.accepted < 40);
+
+  auto decay = [](double, const AdaptiveOde::Vector& y) -> AdaptiveOde::Vector { return -y; };
+  const AdaptiveOde::Vector y = AdaptiveOde::integrate(decay, 0.0, 3.0, AdaptiveOde::Vector::Ones(1));
+  REQUIRE(std::abs(y(0) - std::exp(-3.0)) < 1e-6);
+}
+
+TEST_CASE("Thermal profiles integrate exactly and events stop integration", "[Thermal]") {
+  ThermalProfile profile(600.0);
+  profile.ramp(1000.0, 100.0, 30.0);
+  profile.exponential(20.0, 700.0, 5.0);
+  profile.sinusoid(8.0, 50.0, 4.0);
+  REQUIRE(std::abs(profile.end() - 62.0) < 1e-12);
+  REQUIRE(profile.breakpoints().size() == 5);
+  REQUIRE(std::abs(profile.temperature(2.0) - 800.0) < 1e-9);
+  REQUIRE(std::abs(profile.temperature(39.0) - (700.0 + 300.0 * std::exp(-1.0))) < 1e-9);
+  const double exponential = 700.0 * 20.0 + 300.0 * 5.0 * (1.0 - std::exp(-4.0));
+  const double sinusoid = profile.temperature(54.0) * 8.0; // Two whole periods
+  REQUIRE(std::abs(profile.integral(0.0, 62.0) - (4.0 * 800.0 + 30.0 * 1000.0 + exponential + sinusoid)) < 1e-8);
+  REQUIRE(std::abs(profile.integral(-1.0, 0.0) - 600.0) < 1e-12);
+  REQUIRE_THROWS_AS(profile.exponential(1.0, 800.0, 0.0), std::invalid_argument);
+
+  // y' = 1 crosses 0.3 once
+  auto f = [](double, const AdaptiveOde::Vector& y) -> AdaptiveOde::Vector { return AdaptiveOde::Vector::Ones(1); };
+  auto event = [](double, const AdaptiveOde::Vector& y) -> AdaptiveOde::Vector {
+    return AdaptiveOde::Vector::Constant(1, y(0) - 0.3);
+  };
+  const AdaptiveOde::Stop stop =
+      AdaptiveOde::integrateUntil(f, event, 0.0, 1.0, AdaptiveOde::Vector::Zero(1), {}, AdaptiveOde::Options());
+  REQUIRE(stop.event == 0);
+  REQUIRE(stop.time >= 0.3);
+  REQUIRE(stop.time - 0.3 < 1e-9);
+}
+
+TEST_CASE("Multigrid reproduces a quadratic temperature exactly", "[Thermal]") {
+  // The five-point stencil is exact on x^2 + y^2, so with the ring holding
+  // it and a uniform source of -4k the discrete solution is the quadratic
+  const Eigen::Index rows = 45, cols = 70;
+  Eigen::ArrayXXd exact(rows, cols);
+  for (Eigen::Index j = 0; j < cols; ++j) {
+    for (Eigen::Index i = 0; i < rows; ++i) {
+      exact(i, j) = double(i * i + j * j);
+    }
+  }
+  const MultigridSolver solver(Eigen::ArrayXXd::Constant(rows, cols, 2.0));
+  REQUIRE(solver.levels() > 2);
+  const std::size_t bytes = solver.bytes();
+  // Single-precision cycles still reach the double-precision tolerance
+  for (bool mixed_precision : {false, true}) {
+    for (bool conjugate_gradient : {true, false}) {
+      MultigridSolver::Options options;
+      options.conjugate_gradient = conjugate_gradient;
+      options.mixed_precision = mixed_precision;
+      Eigen::ArrayXXd u = exact;
+      u.block(1, 1, rows - 2, cols - 2).setZero();
+      MultigridSolver::Statistics stats;
+      solver.solve(u, Eigen::ArrayXXd::Constant(rows, cols, -8.0), options, &stats);
+      REQUIRE(stats.residual <= options.tolerance);
+      REQUIRE((u - exact).abs().maxCoeff() < 1e-6);
+    }
+  }
+  REQUIRE(solver.bytes() == bytes + bytes / 2); // The single-precision copy
+  REQUIRE_THROWS_AS(MultigridSolver(Eigen::ArrayXXd::Zero(4, 4)), std::invalid_argument);
+}
+
+TEST_CASE("Grid stencil matrices match triplet assembly", "[Thermal]") {
+  const int outer = 7, inner = 5;
+  const Eigen::ArrayXXd outer_faces = Eigen::ArrayXXd::Random(outer - 1, inner) + 2.0;
+  const Eigen::ArrayXXd inner_faces = Eigen::ArrayXXd::Random(outer, inner - 1) + 2.0;
+  const Eigen::ArrayXXd diagonal = Eigen::ArrayXXd::Random(outer, inner) + 1.0;
+  GridStencilMatrix system(outer, inner);
+  system.assemble(outer_faces, inner_faces, diagonal);
+  REQUIRE(system.matrix().isCompressed());
+
+  std::vector<Eigen::Triplet<double>> triplets;
+  const auto couple = [&](int p, int q, double g) {
+    triplets.emplace_back(p, p, g);
+    triplets.emplace_back(q, q, g);
+    triplets.emplace_back(p, q, -g);
+    triplets.emplace_back(q, p, -g);
+  };
+  for (int a = 0; a < outer; ++a) {
+    for (int b = 0; b < inner; ++b) {
+      triplets.emplace_back(system.cell(a, b), system.cell(a, b), diagonal(a, b));
+      if (a + 1 < outer) {
+        couple(system.cell(a, b), system.cell(a + 1, b), outer_faces(a, b));
+      }
+      if (b + 1 < inner) {
+        couple(system.cell(a, b), system.cell(a, b + 1), inner_faces(a, b));
+      }
+    }
+  }
+  Eigen::SparseMatrix<double> check(outer * inner, outer * inner);
+  check.setFromTriplets(triplets.begin(), triplets.end());
+  REQUIRE(system.matrix().nonZeros() == check.nonZeros());
+  REQUIRE((Eigen::MatrixXd(system.matrix()) - Eigen::MatrixXd(check)).cwiseAbs().maxCoeff() < 1e-12);
+
+  GridStencilMatrix line(1, 4); // One run, no outer faces
+  line.assemble(Eigen::ArrayXXd(0, 4), Eigen::ArrayXXd::Ones(1, 3), Eigen::ArrayXXd::Zero(1, 4));
+  REQUIRE(line.matrix().nonZeros() == 10);
+  REQUIRE_THROWS_AS(system.assemble(inner_faces, outer_faces, diagonal), std::invalid_argument);
+  REQUIRE_THROWS_AS(GridStencilMatrix(0, 3), std::invalid_argument);
+}
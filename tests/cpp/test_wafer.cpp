@@ -1,5 +1,17 @@
 #include <catch2/catch_test_macros.hpp>
 #include "../../src/cpp/core/wafer.hpp"
+#include "../../src/cpp/core/tiled_grid.hpp"
+#include "../../src/cpp/core/stencil.hpp"
+#include "../../src/cpp/core/stencil_kernel.hpp"
+#include "../../src/cpp/core/performance_utils.hpp"
+#include "../../src/cpp/core/checkpoint_io.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <utility>
 
 TEST_CASE("Wafer initialization", "[Wafer]") {
   Wafer wafer(300.0, 775.0, "silicon");
@@ -14,4 +26,499 @@ TEST_CASE("Wafer grid initialization", "[Wafer]") {
   REQUIRE(wafer.getGrid().rows() == 10);
   REQUIRE(wafer.getGrid().cols() == 10);
   REQUIRE(wafer.getGrid().sum() == 0.0);
-}
\ No newline at end of file
+}
+TEST_CASE("Wafer fields share one aligned store", "[Wafer]") {
+  Wafer wafer(300.0, 775.0, "silicon");
+  wafer.initializeGrid(7, 5);
+  const FieldStore& fields = wafer.getFieldStore();
+  REQUIRE(fields.rows() == 7);
+  REQUIRE(fields.cols() == 5);
+  REQUIRE_FALSE(fields.isMaterialized(Wafer::kThermalStressField));
+  REQUIRE((wafer.getThermalStress() == 0.0).all());
+  REQUIRE_FALSE(fields.isMaterialized(Wafer::kThermalStressField));
+  for (int c = 0; c < fields.channelCount(); ++c) {
+    REQUIRE(reinterpret_cast<std::uintptr_t>(fields.data(c)) % FieldStore::kAlignment == 0);
+  }
+  REQUIRE((wafer.getTemperatureProfile() == 300.0).all());
+  REQUIRE_THROWS_AS(wafer.setThermalStress(Eigen::ArrayXXd::Zero(3, 3)), std::invalid_argument);
+}
+
+TEST_CASE("Wafer grid snapshots are copy-on-write", "[Wafer]") {
+  auto wafer = std::make_shared<Wafer>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(6, 4);
+  FieldSnapshot before = wafer->snapshotGrid();
+  REQUIRE(before.isShared());
+  REQUIRE(wafer->getFieldStore().liveSnapshotCount(Wafer::kGridField) == 1);
+
+  wafer->getGrid() -= 5.0;
+  REQUIRE_FALSE(before.isShared());
+  REQUIRE((before.view() == 775.0).all());
+  REQUIRE((wafer->getGrid() == 770.0).all());
+
+  Eigen::ArrayXXd replacement = Eigen::ArrayXXd::Constant(6, 4, 1.0);
+  wafer->updateGrid(std::move(replacement));
+  REQUIRE(replacement.size() == 0);
+  REQUIRE((wafer->getGrid() == 1.0).all());
+}
+
+TEST_CASE("Field versions change only at write points", "[Wafer]") {
+  Wafer wafer(300.0, 775.0, "silicon");
+  wafer.initializeGrid(6, 4);
+  const Wafer& reader = wafer;
+  const FieldStore& fields = wafer.getFieldStore();
+  const std::uint64_t grid = fields.version(Wafer::kGridField);
+  const std::uint64_t stress = fields.version(Wafer::kThermalStressField);
+
+  REQUIRE((reader.getGrid() == 775.0).all());
+  REQUIRE((reader.getThermalStress() == 0.0).all());
+  REQUIRE(fields.version(Wafer::kGridField) == grid);
+  REQUIRE(fields.version(Wafer::kThermalStressField) == stress);
+
+  wafer.getGrid() -= 1.0;
+  REQUIRE(fields.version(Wafer::kGridField) != grid);
+  REQUIRE(fields.version(Wafer::kThermalStressField) == stress);
+  wafer.setThermalStress(Eigen::ArrayXXd::Constant(6, 4, 50.0));
+  REQUIRE(fields.version(Wafer::kThermalStressField) != stress);
+
+  Wafer copy = wafer;
+  REQUIRE(copy.getFieldStore().version(Wafer::kGridField) == fields.version(Wafer::kGridField));
+  wafer.initializeGrid(3, 3);
+  REQUIRE(copy.getFieldStore().version(Wafer::kGridField) != fields.version(Wafer::kGridField));
+}
+
+TEST_CASE("Tiled grid stencil matches untiled sweep", "[Wafer]") {
+  const int rows = 37, cols = 29;
+  Eigen::ArrayXXd field = Eigen::ArrayXXd::Random(rows, cols);
+  TiledGrid tiles(rows, cols, 8, 1);
+  REQUIRE(tiles.tileCount() == 5 * 4);
+  tiles.load(field);
+
+  const double alpha = 0.2;
+  tiles.applyStencil(3, [alpha](const TiledGrid::Tile& in, TiledGrid::Tile& out) {
+    for (int j = 0; j < in.cols; ++j) {
+      for (int i = 0; i < in.rows; ++i) {
+        out(i, j) = in(i, j) + alpha * (in(i - 1, j) + in(i + 1, j) + in(i, j - 1) + in(i, j + 1) - 4.0 * in(i, j));
+      }
+    }
+  });
+  Eigen::ArrayXXd tiled(rows, cols);
+  tiles.store(tiled);
+
+  Eigen::ArrayXXd expected = field;
+  for (int step = 0; step < 3; ++step) {
+    Eigen::ArrayXXd next(rows, cols);
+    for (int j = 0; j < cols; ++j) {
+      for (int i = 0; i < rows; ++i) {
+        double up = expected(std::max(i - 1, 0), j), down = expected(std::min(i + 1, rows - 1), j);
+        double left = expected(i, std::max(j - 1, 0)), right = expected(i, std::min(j + 1, cols - 1));
+        next(i, j) = expected(i, j) + alpha * (up + down + left + right - 4.0 * expected(i, j));
+      }
+    }
+    expected = next;
+  }
+  REQUIRE((tiled - expected).abs().maxCoeff() < 1e-12);
+}
+
+TEST_CASE("Photoresist mask and dense pattern stay in sync", "[Wafer]") {
+  Wafer wafer(300.0, 775.0, "silicon");
+  wafer.initializeGrid(5, 70);
+  BitMask mask(5, 70);
+  for (int j = 10; j < 68; ++j) {
+    mask.set(2, j);
+  }
+  mask.set(4, 0);
+  REQUIRE(mask.count() == 59);
+  auto runs = mask.runs();
+  REQUIRE(runs.size() == 2);
+  REQUIRE(runs[0].row == 2);
+  REQUIRE(runs[0].col_begin == 10);
+  REQUIRE(runs[0].col_end == 68);
+  REQUIRE(BitMask::fromRuns(5, 70, runs).count() == mask.count());
+
+  wafer.setPhotoresistMask(mask);
+  const Wafer& view = wafer;
+  REQUIRE(view.getPhotoresistPattern().sum() == 59.0);
+  REQUIRE(view.getPhotoresistPattern()(2, 10) == 1.0);
+
+  wafer.getPhotoresistPattern()(0, 0) = 1.0;
+  REQUIRE(wafer.getPhotoresistMask().test(0, 0));
+  REQUIRE(wafer.getPhotoresistMask().count() == 60);
+
+  std::size_t clear = 0;
+  wafer.getPhotoresistMask().forEachClear([&](int, int) { ++clear; });
+  REQUIRE(clear == 5 * 70 - 60);
+}
+
+TEST_CASE("Checkpoint chunks round-trip with aligned field blocks", "[Wafer]") {
+  const std::string path = "test_wafer_checkpoint.bin";
+  Wafer wafer(300.0, 775.0, "silicon");
+  wafer.initializeGrid(13, 7);
+  wafer.getGrid() = Eigen::ArrayXXd::Random(13, 7);
+
+  {
+    CheckpointWriter out(path);
+    out.beginChunk(checkpointTag('T', 'E', 'S', 'T'));
+    out.writeString(wafer.getMaterialId());
+    out.write(std::int32_t(42));
+    out.writeBlock(wafer.getGrid().block(1, 1, 5, 3)); // Strided source
+    out.writeBlock(wafer.getGrid());
+    out.endChunk();
+    out.beginChunk(checkpointTag('S', 'K', 'I', 'P'), 7);
+    out.write(1.0);
+    out.endChunk();
+    out.finish();
+  }
+
+  {
+    CheckpointReader in(path);
+    REQUIRE(in.chunks().size() == 2);
+    auto cursor = in.cursor(in.chunks()[0]);
+    REQUIRE(cursor.readString() == "silicon");
+    REQUIRE(cursor.read<std::int32_t>() == 42);
+    Eigen::ArrayXXd corner = cursor.readBlock();
+    REQUIRE((corner == wafer.getGrid().block(1, 1, 5, 3)).all());
+    ConstFieldView grid = cursor.readBlock();
+    REQUIRE(reinterpret_cast<std::uintptr_t>(grid.data()) % FieldStore::kAlignment == 0);
+    REQUIRE((grid == wafer.getGrid()).all());
+    REQUIRE(cursor.atEnd());
+    REQUIRE_THROWS_AS(cursor.read<std::int32_t>(), std::runtime_error);
+    REQUIRE(in.chunks()[1].version == 7);
+  }
+
+  {
+    // Abandoned writers leave the previous checkpoint in place
+    CheckpointWriter out(path);
+    out.beginChunk(checkpointTag('T', 'E', 'S', 'T'));
+  }
+  REQUIRE(CheckpointReader(path).chunks().size() == 2);
+  std::remove(path.c_str());
+  REQUIRE_THROWS_AS(CheckpointReader(path), std::runtime_error);
+}
+
+TEST_CASE("Checkpoint blocks with corrupt headers are rejected", "[Wafer]") {
+  // A block header claiming more doubles than its chunk holds, and one
+  // whose rows * cols * 8 wraps to zero bytes
+  for (const auto& shape : {std::make_pair(std::uint32_t(4), std::uint32_t(4)),
+                            std::make_pair(std::uint32_t(1) << 31, std::uint32_t(1) << 30)}) {
+    auto image = std::make_shared<std::vector<unsigned char>>();
+    {
+      CheckpointWriter out(*image);
+      out.beginChunk(checkpointTag('T', 'E', 'S', 'T'));
+      out.beginBlock(1, 2);
+      out.writeFill(1.0, 2);
+      out.write(shape.first);
+      out.write(shape.second);
+      out.writeFill(2.0, 2);
+      out.endChunk();
+      out.finish();
+    }
+    CheckpointReader in(image);
+    auto cursor = in.cursor(in.chunks()[0]);
+    REQUIRE(cursor.readBlock().size() == 2);
+    REQUIRE_THROWS_AS(cursor.readBlock(), std::runtime_error);
+  }
+}
+
+TEST_CASE("Field store adopts a private checkpoint mapping", "[Wafer]") {
+  const std::string path = "test_wafer_arena.bin";
+  Wafer wafer(300.0, 775.0, "silicon");
+  wafer.initializeGrid(40, 30);
+  wafer.getGrid()(3, 4) = 5.0;
+  const FieldStore& source = wafer.getFieldStore();
+  {
+    CheckpointWriter out(path, CheckpointWriter::pageAlignment());
+    out.beginChunk(checkpointTag('T', 'E', 'S', 'T'));
+    out.writeBlock(Eigen::Map<const Eigen::ArrayXXd>(source.data(Wafer::kGridField), source.stride(),
+                                                     source.channelCount()));
+    out.endChunk();
+    out.finish();
+  }
+
+  Wafer restored(300.0, 775.0, "silicon");
+  {
+    CheckpointReader in(path, true);
+    auto cursor = in.cursor(in.chunks()[0]);
+    FieldView arena = cursor.readMutableBlock();
+    REQUIRE(reinterpret_cast<std::uintptr_t>(arena.data()) % CheckpointWriter::pageAlignment() == 0);
+    std::vector<bool> materialized(restored.getFieldStore().channelCount(), false);
+    materialized[Wafer::kGridField] = true;
+    restored.getFieldStore().adoptArena(40, 30, static_cast<std::size_t>(arena.rows()),
+                                        AlignedFieldBuffer(arena.data(), AlignedFieldFree{in.mapping()}),
+                                        materialized);
+  }
+  // The mapping outlives the reader and writes stay private to the process.
+  REQUIRE(restored.getGrid()(3, 4) == 5.0);
+  REQUIRE(restored.getThermalConductivity()(0, 0) == 150.0);
+  restored.getGrid()(3, 4) = 1.0;
+  CheckpointReader again(path);
+  auto cursor = again.cursor(again.chunks()[0]);
+  REQUIRE(cursor.readBlock()(3 + 4 * 40, Wafer::kGridField) == 5.0);
+  std::remove(path.c_str());
+}
+
+TEST_CASE("Wafer copies share their field arena until either writes", "[Wafer]") {
+  Wafer prototype(300.0, 775.0, "silicon");
+  prototype.initializeGrid(8, 6);
+  prototype.getGrid() -= 25.0;
+  FieldSnapshot before = prototype.snapshotGrid();
+
+  std::vector<Wafer> lot(4, prototype);
+  const double* shared = static_cast<const Wafer&>(prototype).getFieldStore().data(Wafer::kGridField);
+  for (const Wafer& wafer : lot) {
+    REQUIRE(wafer.getFieldStore().sharesArena());
+    REQUIRE(wafer.getFieldStore().data(Wafer::kGridField) == shared);
+    REQUIRE_FALSE(wafer.getFieldStore().isMaterialized(Wafer::kThermalStressField));
+  }
+
+  // Reading a lazy channel writes nothing: every reader sees one shared
+  // block of the default, and the arena stays shared
+  const Wafer& reader = lot[0];
+  REQUIRE((reader.getThermalStress() == 0.0).all());
+  REQUIRE(reader.getFieldStore().sharesArena());
+  REQUIRE_FALSE(reader.getFieldStore().isMaterialized(Wafer::kThermalStressField));
+  REQUIRE(reader.getFieldStore().data(Wafer::kThermalStressField) ==
+          static_cast<const Wafer&>(lot[3]).getFieldStore().data(Wafer::kThermalStressField));
+  // Filling it for the raw arena gives the reader its own copy only
+  lot[0].getFieldStore().materialize(Wafer::kThermalStressField);
+  REQUIRE_FALSE(reader.getFieldStore().sharesArena());
+  REQUIRE((reader.getThermalStress() == 0.0).all());
+  REQUIRE_FALSE(prototype.getFieldStore().isMaterialized(Wafer::kThermalStressField));
+
+  // Mutable access is a write point even when nothing is written
+  lot[1].getGrid() += 5.0;
+  const Wafer& untouched = lot[2];
+  REQUIRE((lot[1].getGrid() == 755.0).all());
+  REQUIRE((untouched.getGrid() == 750.0).all());
+  REQUIRE(untouched.getFieldStore().data(Wafer::kGridField) == shared);
+
+  // The prototype's own write leaves its snapshot and its copies intact
+  prototype.getGrid() -= 100.0;
+  REQUIRE((prototype.getGrid() == 650.0).all());
+  REQUIRE((before.view() == 750.0).all());
+  lot[2].getGrid() += 1.0;
+  lot[3].getGrid() += 2.0;
+  REQUIRE((lot[2].getGrid() == 751.0).all());
+  REQUIRE((lot[3].getGrid() == 752.0).all());
+  REQUIRE((before.view() == 750.0).all());
+}
+
+TEST_CASE("Wafer grid setup on large fields matches the serial fill", "[Wafer]") {
+  // Large enough for the fills and copies to run on every OpenMP thread
+  Wafer wafer(300.0, 775.0, "silicon");
+  wafer.initializeGrid(300, 200);
+  wafer.applyLayer(2.5, "oxide");
+  wafer.applyLayer(0.5, "nitride");
+  REQUIRE((wafer.getGrid() == 778.0).all());
+  REQUIRE((wafer.getTemperatureProfile() == 300.0).all());
+  REQUIRE(wafer.getFilmLayers().size() == 2);
+
+  // A copy's arena is copied by the same column shares before it writes
+  Wafer copy = wafer;
+  copy.applyLayer(1.0, "poly");
+  REQUIRE((copy.getGrid() == 779.0).all());
+  REQUIRE((wafer.getGrid() == 778.0).all());
+  REQUIRE((copy.getTemperatureProfile() == 300.0).all());
+
+  // Channels registered after the shape is set keep the old ones intact
+  FieldStore store;
+  int a = store.registerChannel("a", 1.0);
+  store.reshape(257, 129);
+  store.shift(a, 2.0);
+  int b = store.registerChannel("b", -1.0);
+  REQUIRE((store.view(a) == 3.0).all());
+  REQUIRE((store.view(b) == -1.0).all());
+}
+
+TEST_CASE("Wafer stencil steps are temporally blocked without changing the result", "[Wafer]") {
+  // Step by step with clamped neighbours, the definition of the stencil
+  const auto reference = [](Eigen::ArrayXXd field, const ExplicitStencil::Weights& w, ExplicitStencil::Edges edges,
+                            int steps) {
+    const int rows = static_cast<int>(field.rows()), cols = static_cast<int>(field.cols());
+    for (int step = 0; step < steps; ++step) {
+      Eigen::ArrayXXd next = field;
+      const auto at = [&](int i, int j) { return field(std::clamp(i, 0, rows - 1), std::clamp(j, 0, cols - 1)); };
+      for (int j = 0; j < cols; ++j) {
+        for (int i = 0; i < rows; ++i) {
+          if (edges == ExplicitStencil::Edges::Fixed && (i == 0 || j == 0 || i == rows - 1 || j == cols - 1)) {
+            continue;
+          }
+          const double c = field(i, j);
+          const double sides = w.north * (at(i - 1, j) - c) + w.south * (at(i + 1, j) - c) +
+                               w.west * (at(i, j - 1) - c) + w.east * (at(i, j + 1) - c);
+          const double corners = w.north_west * (at(i - 1, j - 1) - c) + w.north_east * (at(i - 1, j + 1) - c) +
+                                 w.south_west * (at(i + 1, j - 1) - c) + w.south_east * (at(i + 1, j + 1) - c);
+          next(i, j) = c + (sides + corners) + w.centre * c;
+        }
+      }
+      field = next;
+    }
+    return field;
+  };
+
+  ExplicitStencil::Weights nine;
+  nine.north = 0.1;
+  nine.south = 0.12;
+  nine.west = 0.08;
+  nine.east = 0.09;
+  nine.north_west = 0.02;
+  nine.north_east = 0.03;
+  nine.south_west = 0.01;
+  nine.south_east = 0.025;
+  nine.centre = -0.01;
+  for (const auto& weights : {ExplicitStencil::diffusion(0.2), nine}) {
+    for (auto edges : {ExplicitStencil::Edges::Fixed, ExplicitStencil::Edges::ZeroFlux}) {
+      for (int steps : {1, 3, 7}) {
+        // Small tiles, so passes cross tile edges and ghost cells run out
+        ExplicitStencil stencil(weights, edges);
+        stencil.setBlocking(3, 16, 8);
+        for (auto shape : {std::make_pair(1, 5), std::make_pair(37, 53)}) {
+          const Eigen::ArrayXXd initial = Eigen::ArrayXXd::Random(shape.first, shape.second);
+          Eigen::ArrayXXd field = initial;
+          stencil.apply(field.data(), shape.first, shape.second, steps);
+          REQUIRE((field == reference(initial, weights, edges, steps)).all());
+        }
+      }
+    }
+  }
+
+  // A uniform field stays exactly uniform, and fixed edges hold
+  Eigen::ArrayXXd uniform = Eigen::ArrayXXd::Constant(300, 200, 300.0);
+  ExplicitStencil(ExplicitStencil::diffusion(0.25)).apply(uniform.data(), 300, 200, 20);
+  REQUIRE((uniform == 300.0).all());
+  Eigen::MatrixXd concentration = Eigen::MatrixXd::Zero(40, 30);
+  concentration(20, 15) = 1.0;
+  concentration.row(0).setConstant(2.0);
+  SemiPRO::VectorizedOps::diffusion_step_2d(concentration, 1.0, 0.2, 1.0, 10);
+  REQUIRE((concentration.row(0).array() == 2.0).all());
+  REQUIRE(concentration(20, 15) < 1.0);
+  REQUIRE(concentration(21, 15) > 0.0);
+}
+
+TEST_CASE("Wafer stencil kernels sweep every boundary policy like the pointwise form", "[Wafer]") {
+  // Fields smaller than the stencil, wider than a column block and taller
+  // than a row band
+  const std::vector<std::pair<int, int>> shapes = {{1, 1}, {2, 3}, {37, 53}, {600, 7}, {4, 70}};
+  const auto check = [&](const auto& kernel, auto boundary) {
+    using Kernel = std::decay_t<decltype(kernel)>;
+    using Boundary = decltype(boundary);
+    const int radius = Kernel::Shape::kRadius;
+    for (const auto& shape : shapes) {
+      const int rows = shape.first, cols = shape.second;
+      const Eigen::ArrayXXd in = Eigen::ArrayXXd::Random(rows, cols);
+      Eigen::ArrayXXd out = Eigen::ArrayXXd::Constant(rows, cols, -5.0);
+      Stencil::sweep<Boundary>(kernel, in, out, [](double sum, double c, int i, int j) { return sum + 0.5 * c + i - j; });
+      for (int j = 0; j < cols; ++j) {
+        for (int i = 0; i < rows; ++i) {
+          const bool edge = i < radius || j < radius || i >= rows - radius || j >= cols - radius;
+          if (!Boundary::kWritesEdge && edge) {
+            REQUIRE(out(i, j) == -5.0);
+            continue;
+          }
+          const double sum = Stencil::at<Boundary>(kernel, in.data(), rows, rows, cols, i, j);
+          REQUIRE(std::abs(out(i, j) - (sum + 0.5 * in(i, j) + i - j)) < 1e-12);
+        }
+      }
+    }
+  };
+  const auto every_policy = [&](const auto& kernel) {
+    check(kernel, Stencil::Clamp());
+    check(kernel, Stencil::Periodic());
+    check(kernel, Stencil::Zero());
+    check(kernel, Stencil::Hold());
+  };
+  every_policy(Stencil::Laplacian());
+  every_policy(Stencil::IsotropicLaplacian());
+  every_policy(Stencil::BoxMean<2>());
+  every_policy(Stencil::Weighted<Stencil::NinePoint>{{0.5, 0.1, 0.2, 0.3, 0.4, -0.1, -0.2, -0.3, -0.4}});
+
+  // The policies against their definitions on the corner cell
+  Eigen::ArrayXXd field(3, 4);
+  field << 1, 2, 3, 4,
+           5, 6, 7, 8,
+           9, 10, 11, 12;
+  const auto corner = [&](auto boundary) {
+    return Stencil::at<decltype(boundary)>(Stencil::Laplacian(), field.data(), 3, 3, 4, 0, 0);
+  };
+  REQUIRE(corner(Stencil::Clamp()) == (1 + 5 + 1 + 2) - 4.0 * 1);
+  REQUIRE(corner(Stencil::Periodic()) == (9 + 5 + 4 + 2) - 4.0 * 1);
+  REQUIRE(corner(Stencil::Zero()) == (5 + 2) - 4.0 * 1);
+
+  // Uniform fields have no Laplacian and keep their mean
+  Eigen::ArrayXXd uniform = Eigen::ArrayXXd::Constant(50, 40, 3.0), result(50, 40);
+  Stencil::sweep<Stencil::Clamp>(Stencil::Laplacian(), uniform, result);
+  REQUIRE((result == 0.0).all());
+  Stencil::sweep<Stencil::Periodic>(Stencil::BoxMean<1>(), uniform, result);
+  REQUIRE((result - 3.0).abs().maxCoeff() < 1e-15);
+  Eigen::ArrayXXd small(2, 2);
+  REQUIRE_THROWS_AS(Stencil::sweep<Stencil::Clamp>(Stencil::Laplacian(), uniform, small), std::invalid_argument);
+
+  // The Laplacian at a point matches the one written out by hand
+  Eigen::MatrixXd grid = Eigen::MatrixXd::Random(10, 12);
+  REQUIRE(std::abs(SemiPRO::VectorizedOps::compute_laplacian_at_point(grid, 4, 5, 0.5) -
+                   (grid(3, 5) + grid(5, 5) + grid(4, 4) + grid(4, 6) - 4.0 * grid(4, 5)) / 0.25) < 1e-12);
+  REQUIRE(SemiPRO::VectorizedOps::compute_laplacian_at_point(grid, 0, 5, 0.5) == 0.0);
+}
+
+TEST_CASE("Wafer field channels round-trip through their precision policy", "[Wafer]") {
+  Wafer wafer(300.0, 775.0, "silicon");
+  wafer.initializeGrid(40, 30);
+  FieldStore& fields = wafer.getFieldStore();
+  const int temperature = fields.channelIndex("temperature_profile");
+  const int pattern = fields.channelIndex("photoresist_pattern");
+  REQUIRE(fields.channelPrecision(fields.channelIndex("grid")) == FieldPrecision::FLOAT64);
+  REQUIRE(fields.channelPrecision(temperature) == FieldPrecision::FLOAT32);
+  REQUIRE(fields.channelPrecision(pattern) == FieldPrecision::MASK8);
+
+  // Each precision against its error bound, and at a half, an eighth of
+  // the bytes
+  const Eigen::ArrayXXd heat = 300.0 + 900.0 * Eigen::ArrayXXd::Random(40, 30).abs();
+  const FieldPrecisionError heat_error = precisionError(heat, FieldPrecision::FLOAT32);
+  REQUIRE(heat_error.max_rel < 1e-7);
+  REQUIRE(heat_error.max_abs > 0.0);
+  REQUIRE(CompactField::encode(heat, FieldPrecision::FLOAT32).bytes() == heat.size() * sizeof(float));
+  Eigen::ArrayXXd dopant = Eigen::pow(10.0, 10.0 + 11.0 * Eigen::ArrayXXd::Random(40, 30).abs());
+  dopant(3, 4) = 0.0;
+  const CompactField logged = CompactField::encode(dopant, FieldPrecision::LOG_FLOAT32);
+  REQUIRE(logged.decode()(3, 4) == 0.0);
+  REQUIRE(compareFields(dopant, logged.decode(), 1.0).max_rel < 1e-5);
+  Eigen::ArrayXXd mask = (Eigen::ArrayXXd::Random(40, 30) > 0.0).cast<double>();
+  const CompactField bits = CompactField::encode(mask, FieldPrecision::MASK8);
+  REQUIRE(bits.bytes() == static_cast<std::size_t>(mask.size()));
+  REQUIRE((bits.decode() == mask).all());
+  REQUIRE(precisionError(heat, FieldPrecision::FLOAT64).max_abs == 0.0);
+
+  // Quantizing a run and comparing it with an all-double one reports the
+  // policy's error channel by channel
+  const FieldStore reference = fields;
+  fields.assign(temperature, heat);
+  FieldStore exact = fields;
+  fields.quantize(temperature);
+  fields.quantize(fields.channelIndex("grid"));
+  REQUIRE((fields.view(temperature).cast<float>().cast<double>() == fields.view(temperature)).all());
+  const std::vector<FieldPrecisionError> report = compareStores(exact, fields);
+  for (const auto& error : report) {
+    if (error.channel == "temperature_profile") {
+      REQUIRE(error.max_abs == heat_error.max_abs);
+      REQUIRE(error.row == heat_error.row);
+      REQUIRE(error.col == heat_error.col);
+    } else {
+      REQUIRE(error.max_abs == 0.0);
+    }
+  }
+  REQUIRE(std::none_of(report.begin(), report.end(),
+                       [](const FieldPrecisionError& error) { return error.channel == "thermal_stress"; }));
+  REQUIRE(reference.channelPrecision(temperature) == FieldPrecision::FLOAT32);
+
+  // Stencils over a narrow field read its storage and sum in double
+  const CompactField narrow = fields.compact(temperature);
+  Eigen::ArrayXXd from_narrow(40, 30), from_double(40, 30);
+  Stencil::sweep<Stencil::Clamp>(Stencil::IsotropicLaplacian(), narrow, from_narrow);
+  Stencil::sweep<Stencil::Clamp>(Stencil::IsotropicLaplacian(), narrow.decode(), from_double);
+  REQUIRE((from_narrow - from_double).abs().maxCoeff() < 1e-9);
+  Stencil::sweep<Stencil::Zero>(Stencil::Laplacian(), bits, from_narrow);
+  Stencil::sweep<Stencil::Zero>(Stencil::Laplacian(), mask, from_double);
+  REQUIRE((from_narrow == from_double).all());
+  Stencil::sweep<Stencil::Periodic>(Stencil::BoxMean<1>(), logged, from_narrow);
+  Stencil::sweep<Stencil::Periodic>(Stencil::BoxMean<1>(), logged.decode(), from_double);
+  REQUIRE((from_narrow == from_double).all());
+}
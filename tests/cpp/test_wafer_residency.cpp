@@ -0,0 +1,105 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/wafer_residency.hpp"
+#include "../../src/cpp/core/wafer_enhanced.hpp"
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+// A wafer whose layers and fields differ from every other seed's
+std::shared_ptr<WaferEnhanced> makeWafer(int seed) {
+  auto wafer = std::make_shared<WaferEnhanced>(300.0, 775.0, "silicon");
+  wafer->initializeGrid(32, 20);
+  wafer->addLayer("oxide", 0.01 * (seed + 1));
+  Eigen::ArrayXXd temperature(32, 20);
+  for (Eigen::Index i = 0; i < temperature.rows(); ++i) {
+    for (Eigen::Index j = 0; j < temperature.cols(); ++j) {
+      temperature(i, j) = 300.0 + seed + std::sin(0.1 * i * j + seed) * 1e-3;
+    }
+  }
+  wafer->setTemperatureField(temperature);
+  return wafer;
+}
+
+} // namespace
+
+TEST_CASE("Demoted wafers come back bit-identical from every tier", "[WaferResidency]") {
+  const auto directory =
+      std::filesystem::temp_directory_path() / ("semipro-residency-" + std::to_string(::getpid()));
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  SemiPRO::WaferResidency::Limits limits;
+  limits.spill_directory = directory.string();
+  SemiPRO::WaferResidency residency(limits);
+  const std::vector<std::string> names = {"w0", "w1", "w2"};
+  std::vector<std::vector<unsigned char>> images;
+  for (size_t i = 0; i < names.size(); ++i) {
+    auto wafer = makeWafer(static_cast<int>(i));
+    images.push_back(wafer->stateImage());
+    residency.admit(names[i], std::move(wafer));
+  }
+  REQUIRE(residency.count(SemiPRO::WaferResidency::Tier::HOT) == 3);
+  const size_t hot = residency.hotBytes();
+
+  // A step holds w2, so it stays hot whatever is asked for
+  auto held = residency.acquire("w2");
+
+  // A little room compresses the least recently used idle wafer only
+  REQUIRE(residency.demote(1) > 0);
+  REQUIRE(residency.tier("w0") == SemiPRO::WaferResidency::Tier::WARM);
+  REQUIRE(residency.tier("w1") == SemiPRO::WaferResidency::Tier::HOT);
+  REQUIRE(residency.warmBytes() > 0);
+  REQUIRE(residency.hotBytes() < hot);
+
+  // More than compression frees spills every idle wafer
+  residency.demote(std::numeric_limits<size_t>::max());
+  REQUIRE(residency.tier("w0") == SemiPRO::WaferResidency::Tier::COLD);
+  REQUIRE(residency.tier("w1") == SemiPRO::WaferResidency::Tier::COLD);
+  REQUIRE(residency.tier("w2") == SemiPRO::WaferResidency::Tier::HOT);
+  REQUIRE(residency.warmBytes() == 0);
+  REQUIRE(!std::filesystem::is_empty(directory));
+  held.reset();
+
+  for (size_t i = 0; i < names.size(); ++i) {
+    auto wafer = residency.acquire(names[i]);
+    REQUIRE(wafer != nullptr);
+    REQUIRE(residency.tier(names[i]) == SemiPRO::WaferResidency::Tier::HOT);
+    REQUIRE(wafer->stateImage() == images[i]);
+  }
+  REQUIRE(residency.acquire("missing") == nullptr);
+
+  // Reloaded wafers go round again unchanged
+  residency.demote(std::numeric_limits<size_t>::max());
+  REQUIRE(residency.count(SemiPRO::WaferResidency::Tier::COLD) == 3);
+  REQUIRE(residency.acquire("w1")->stateImage() == images[1]);
+
+  residency.clear();
+  REQUIRE(residency.size() == 0);
+  REQUIRE(std::filesystem::is_empty(directory));
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Without a spill directory wafers go no colder than warm", "[WaferResidency]") {
+  SemiPRO::WaferResidency residency;
+  auto wafer = makeWafer(7);
+  const auto image = wafer->stateImage();
+  residency.admit("w", std::move(wafer));
+
+  residency.demote(std::numeric_limits<size_t>::max());
+  REQUIRE(residency.tier("w") == SemiPRO::WaferResidency::Tier::WARM);
+  REQUIRE(residency.hotBytes() == 0);
+  REQUIRE(residency.acquire("w")->stateImage() == image);
+  REQUIRE(residency.warmBytes() == 0);
+
+  REQUIRE(residency.evict("w"));
+  REQUIRE(!residency.contains("w"));
+  REQUIRE_THROWS_AS(residency.tier("w"), std::out_of_range);
+}
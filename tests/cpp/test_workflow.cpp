@@ -0,0 +1,183 @@
+#include <catch2/catch_test_macros.hpp>
+#include "../../src/cpp/core/workflow_plan.hpp"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+SemiPRO::WorkflowStep makeStep(const std::string& id, const std::string& module,
+                               const std::vector<std::string>& dependencies = {}) {
+  SemiPRO::WorkflowStep step;
+  step.id = id;
+  step.module_name = module;
+  step.dependencies = dependencies;
+  return step;
+}
+
+std::unordered_map<std::string, SemiPRO::StepExecutor> executorsFor(const std::vector<std::string>& modules) {
+  std::unordered_map<std::string, SemiPRO::StepExecutor> executors;
+  for (const auto& module : modules) {
+    executors[module] = [](const SemiPRO::WorkflowStep&, const std::unordered_map<std::string, std::string>&) {
+      return std::unordered_map<std::string, std::string>();
+    };
+  }
+  return executors;
+}
+
+std::string compileError(const SemiPRO::Workflow& workflow,
+                         const std::unordered_map<std::string, SemiPRO::StepExecutor>& executors) {
+  try {
+    SemiPRO::WorkflowPlan::compile(workflow, executors);
+  } catch (const std::invalid_argument& e) {
+    return e.what();
+  }
+  return "";
+}
+
+bool contains(const std::string& text, const std::string& part) {
+  return text.find(part) != std::string::npos;
+}
+
+} // namespace
+
+TEST_CASE("Workflow plans report every problem in one diagnostic", "[Workflow]") {
+  SemiPRO::Workflow workflow;
+  workflow.id = "broken";
+  workflow.steps = {makeStep("a", "oxidation", {"c"}), makeStep("b", "doping", {"a"}),
+                    makeStep("c", "oxidation", {"b"}), makeStep("d", "etching", {"missing"}),
+                    makeStep("e", "oxidation")};
+  const auto executors = executorsFor({"oxidation", "doping"});
+
+  const std::string error = compileError(workflow, executors);
+  REQUIRE(contains(error, "'broken'"));
+  REQUIRE(contains(error, "no executor for module 'etching'"));
+  REQUIRE(contains(error, "unknown step 'missing'"));
+  REQUIRE(contains(error, "dependency cycle through 'a', 'b', 'c'"));
+  REQUIRE(!contains(error, "'e'"));
+
+  // Each problem alone is enough to refuse the workflow
+  workflow.steps = {makeStep("a", "oxidation"), makeStep("a", "oxidation")};
+  REQUIRE(contains(compileError(workflow, executors), "duplicate step id 'a'"));
+  workflow.steps = {makeStep("a", "oxidation", {"a"})};
+  REQUIRE(contains(compileError(workflow, executors), "'a' depends on itself"));
+  workflow.steps = {makeStep("a", "lithography")};
+  REQUIRE(contains(compileError(workflow, executors), "no executor for module 'lithography'"));
+  workflow.steps = {makeStep("a", "oxidation")};
+  REQUIRE(compileError(workflow, executors).empty());
+}
+
+TEST_CASE("Workflow plans order steps after their dependencies", "[Workflow]") {
+  SemiPRO::Workflow workflow;
+  workflow.id = "ordered";
+  // Defined out of dependency order, with independent steps between
+  workflow.steps = {makeStep("etch", "etching", {"expose", "deposit"}), makeStep("clean", "cleaning"),
+                    makeStep("expose", "lithography", {"oxidize"}), makeStep("oxidize", "oxidation", {"clean"}),
+                    makeStep("deposit", "deposition", {"clean"}), makeStep("anneal", "thermal")};
+  workflow.global_parameters = {{"temperature", "1000"}, {"dry", "true"}};
+  workflow.steps[3].parameters = {{"temperature", "1100"}, {"ambient", "O2"}};
+  auto plan = SemiPRO::WorkflowPlan::compile(
+      workflow, executorsFor({"etching", "cleaning", "lithography", "oxidation", "deposition", "thermal"}));
+
+  std::vector<std::string> order;
+  for (const auto& step : plan->steps()) {
+    order.push_back(step.definition->id);
+  }
+  // Kahn's algorithm taking the earliest defined ready step first
+  REQUIRE(order == std::vector<std::string>{"clean", "oxidize", "expose", "deposit", "etch", "anneal"});
+  for (size_t p = 0; p < plan->steps().size(); ++p) {
+    REQUIRE(plan->find(plan->steps()[p].definition->id) == p);
+    for (size_t d : plan->steps()[p].dependencies) {
+      REQUIRE(d < p);
+    }
+  }
+  REQUIRE(plan->find("missing") == SemiPRO::WorkflowPlan::npos);
+
+  const auto& etch = plan->steps()[plan->find("etch")];
+  REQUIRE(etch.dependencies == std::vector<size_t>{plan->find("expose"), plan->find("deposit")});
+  REQUIRE(etch.level == 3);
+  REQUIRE(plan->steps()[plan->find("anneal")].level == 0);
+  REQUIRE(plan->levelCount() == 4);
+
+  // Step parameters override the globals and are parsed once
+  const auto& oxidize = plan->steps()[plan->find("oxidize")];
+  REQUIRE(oxidize.parameters.at("temperature").isNumber());
+  REQUIRE(oxidize.parameters.at("temperature").number == 1100.0);
+  REQUIRE(oxidize.parameters.at("dry").asBool());
+  REQUIRE(oxidize.parameters.at("ambient").text == "O2");
+  REQUIRE(!oxidize.parameters.at("ambient").isNumber());
+  REQUIRE(plan->steps()[plan->find("clean")].parameters.at("temperature").number == 1000.0);
+}
+
+TEST_CASE("Workflow plans time the critical path with the cost models", "[Workflow]") {
+  SemiPRO::Workflow workflow;
+  workflow.id = "timed";
+  workflow.max_parallel_steps = 2;
+  workflow.steps = {makeStep("a", "slow"), makeStep("b", "fast"), makeStep("c", "fast", {"a"}),
+                    makeStep("d", "fast", {"b"}), makeStep("e", "slow", {"c", "d"}), makeStep("f", "plain")};
+  std::unordered_map<std::string, SemiPRO::StepCostModel> cost_models;
+  cost_models["slow"] = [](const SemiPRO::WorkflowStep&) { return SemiPRO::ResourceEstimate{5.0, 400}; };
+  cost_models["fast"] = [](const SemiPRO::WorkflowStep&) { return SemiPRO::ResourceEstimate{2.0, 100}; };
+  auto plan = SemiPRO::WorkflowPlan::compile(workflow, executorsFor({"slow", "fast", "plain"}), cost_models);
+
+  // "plain" has no cost model and is taken at 1 s and no memory
+  REQUIRE(std::abs(plan->totalSeconds() - 17.0) < 1e-12);
+  // a -> c -> e: 5 + 2 + 5
+  REQUIRE(std::abs(plan->criticalPathSeconds() - 12.0) < 1e-12);
+  // Level 0 holds a, b and f; two of them at once take at most 400 + 100
+  REQUIRE(plan->peakMemoryBytes() == 500);
+
+  // Lengthening the other branch moves the critical path onto it
+  cost_models["fast"] = [](const SemiPRO::WorkflowStep&) { return SemiPRO::ResourceEstimate{7.0, 100}; };
+  plan = SemiPRO::WorkflowPlan::compile(workflow, executorsFor({"slow", "fast", "plain"}), cost_models);
+  REQUIRE(std::abs(plan->criticalPathSeconds() - 19.0) < 1e-12);
+}
+
+TEST_CASE("Workflow plan cache keys plans by id and version", "[Workflow]") {
+  SemiPRO::WorkflowPlanCache cache;
+  const auto executors = executorsFor({"oxidation"});
+  SemiPRO::Workflow workflow;
+  workflow.id = "cached";
+  workflow.version = "1";
+  workflow.steps = {makeStep("a", "oxidation")};
+
+  auto first = cache.get(workflow, executors);
+  REQUIRE(cache.get(workflow, executors) == first);
+  REQUIRE(cache.hits() == 1);
+  REQUIRE(cache.misses() == 1);
+
+  // A new version compiles a plan of its own next to the old one
+  workflow.version = "2";
+  workflow.steps.push_back(makeStep("b", "oxidation", {"a"}));
+  auto second = cache.get(workflow, executors);
+  REQUIRE(second != first);
+  REQUIRE(second->steps().size() == 2);
+  REQUIRE(first->steps().size() == 1);
+  REQUIRE(cache.size() == 2);
+
+  SemiPRO::Workflow other = workflow;
+  other.id = "other";
+  cache.get(other, executors);
+  REQUIRE(cache.size() == 3);
+
+  // Invalidation drops every version of one workflow only
+  cache.invalidate("cached");
+  REQUIRE(cache.size() == 1);
+  auto recompiled = cache.get(workflow, executors);
+  REQUIRE(recompiled != second);
+  REQUIRE(cache.misses() == 4);
+  REQUIRE(cache.get(other, executors) != nullptr);
+  REQUIRE(cache.hits() == 2);
+
+  // Workflows that fail to compile are not cached
+  SemiPRO::Workflow broken = workflow;
+  broken.id = "broken";
+  broken.steps = {makeStep("a", "etching")};
+  REQUIRE_THROWS_AS(cache.get(broken, executors), std::invalid_argument);
+  REQUIRE(cache.size() == 2);
+
+  cache.clear();
+  REQUIRE(cache.size() == 0);
+}